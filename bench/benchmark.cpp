@@ -0,0 +1,196 @@
+#include "benchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct Benchmark {
+	std::string name;
+	bench::Setup setup;
+};
+
+std::vector<Benchmark>& benchmarks()
+{
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+std::atomic<std::uint64_t> allocations(0);
+std::atomic<std::uint64_t> allocated_bytes(0);
+
+/// What Untimed left out of the current measurement
+std::chrono::steady_clock::duration untimed_duration(0);
+std::uint64_t untimed_allocations = 0;
+std::uint64_t untimed_bytes = 0;
+
+void* allocate(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size != 0 ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+/// How long each benchmark runs for, at least.
+const std::chrono::milliseconds MIN_DURATION(300);
+
+struct Result {
+	double ns_per_op;
+	double allocs_per_op;
+	double bytes_per_op;
+};
+
+Result measure(const bench::Operation& op)
+{
+	// The first run fills caches and lazily initialized statics
+	op();
+
+	std::uint64_t iterations = 1;
+	while (true) {
+		untimed_duration = std::chrono::steady_clock::duration(0);
+		untimed_allocations = 0;
+		untimed_bytes = 0;
+		const auto allocs_before = allocations.load();
+		const auto bytes_before = allocated_bytes.load();
+		const auto start = std::chrono::steady_clock::now();
+		for (std::uint64_t i = 0; i < iterations; ++i) {
+			op();
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start
+			- untimed_duration;
+
+		if (elapsed >= MIN_DURATION || iterations >= (1ull << 40)) {
+			const double n = iterations;
+			const auto allocs = allocations.load() - allocs_before
+				- untimed_allocations;
+			const auto bytes = allocated_bytes.load() - bytes_before
+				- untimed_bytes;
+			return Result{
+				std::chrono::duration<double, std::nano>(elapsed).count() / n,
+				allocs / n,
+				bytes / n,
+			};
+		}
+		iterations *= 2;
+	}
+}
+
+}
+
+// Allocations are counted through operator new. That misses what the Rust
+// code allocates, e.g. inside FmtStrFormatter, which is only part of ns/op.
+void* operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+namespace bench {
+
+Registration::Registration(const std::string& name, Setup setup)
+{
+	benchmarks().push_back(Benchmark{name, std::move(setup)});
+}
+
+Untimed::Untimed()
+	: start(std::chrono::steady_clock::now())
+	, allocations_at_start(allocations.load())
+	, bytes_at_start(allocated_bytes.load())
+{
+}
+
+Untimed::~Untimed()
+{
+	untimed_duration += std::chrono::steady_clock::now() - start;
+	untimed_allocations += allocations.load() - allocations_at_start;
+	untimed_bytes += allocated_bytes.load() - bytes_at_start;
+}
+
+std::uint64_t env_setting(const char* name, std::uint64_t default_value)
+{
+	const char* value = std::getenv(name);
+	if (value == nullptr || *value == '\0') {
+		return default_value;
+	}
+	return std::strtoull(value, nullptr, 10);
+}
+
+std::string read_test_data(const std::string& name)
+{
+	const std::string path = "test/data/" + name;
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("couldn't read " + path);
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+} // namespace bench
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "--record") {
+		if (argc != 4) {
+			std::cerr << "usage: " << argv[0] << " --record <urls file> <dir>"
+				<< std::endl;
+			return EXIT_FAILURE;
+		}
+		return bench::record_archive(argv[2], argv[3]);
+	}
+
+	// Any arguments select the benchmarks whose names contain one of them
+	const std::vector<std::string> filters(argv + 1, argv + argc);
+
+	std::cout << std::left << std::setw(60) << "benchmark"
+		<< std::right << std::setw(14) << "ns/op"
+		<< std::setw(12) << "allocs/op"
+		<< std::setw(12) << "bytes/op" << std::endl;
+
+	for (const auto& benchmark : benchmarks()) {
+		bool selected = filters.empty();
+		for (const auto& filter : filters) {
+			selected = selected
+				|| benchmark.name.find(filter) != std::string::npos;
+		}
+		if (!selected) {
+			continue;
+		}
+
+		const auto result = measure(benchmark.setup());
+		std::cout << std::left << std::setw(60) << benchmark.name
+			<< std::right << std::fixed << std::setprecision(1)
+			<< std::setw(14) << result.ns_per_op
+			<< std::setw(12) << result.allocs_per_op
+			<< std::setw(12) << result.bytes_per_op << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#ifndef NEWSBOAT_BENCHMARK_H_
+#define NEWSBOAT_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace bench {
+
+/// One run of the code being measured.
+using Operation = std::function<void()>;
+
+/// Prepares whatever the benchmark needs, and returns the operation to
+/// measure. It's only called if the benchmark is selected to run.
+using Setup = std::function<Operation()>;
+
+/// \brief Adds a benchmark to the ones `bench/bench` runs.
+///
+/// Meant to be created as a static object, so each bench/*.cpp file
+/// registers its own benchmarks.
+class Registration {
+public:
+	Registration(const std::string& name, Setup setup);
+};
+
+/// \brief Leaves the time and allocations until its destruction out of the
+/// measurement.
+///
+/// For operations that change what they work on, and have to undo that
+/// before each run.
+class Untimed {
+public:
+	Untimed();
+	~Untimed();
+	Untimed(const Untimed&) = delete;
+	Untimed& operator=(const Untimed&) = delete;
+
+private:
+	const std::chrono::steady_clock::time_point start;
+	const std::uint64_t allocations_at_start;
+	const std::uint64_t bytes_at_start;
+};
+
+/// Reads an integer from the environment variable \a name, if it's set.
+std::uint64_t env_setting(const char* name, std::uint64_t default_value);
+
+/// Keeps the compiler from optimizing away the computation of \a value.
+template<typename T>
+void keep(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Reads a file from test/data, which bench/bench is run next to.
+std::string read_test_data(const std::string& name);
+
+/// Downloads the feeds in \a urls_file into a ReplayArchive in directory
+/// \a dir, for the reload benchmarks; `bench/bench --record` does it.
+int record_archive(const std::string& urls_file, const std::string& dir);
+
+} // namespace bench
+
+#endif /* NEWSBOAT_BENCHMARK_H_ */
@@ -0,0 +1,379 @@
+#include "cache.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "benchmark.h"
+#include "cacheloader.h"
+#include "configcontainer.h"
+#include "fmtstrformatter.h"
+#include "rssfeed.h"
+#include "rssignores.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// \brief The shape of the synthetic cache, from the environment.
+///
+/// BENCH_FEEDS and BENCH_ITEMS_PER_FEED give its size. The articles'
+/// lengths follow a log-normal distribution with a median of
+/// BENCH_CONTENT_BYTES, which is what real feeds roughly look like: most
+/// articles are short summaries, and a few are very long.
+struct Shape {
+	unsigned int feeds = bench::env_setting("BENCH_FEEDS", 100);
+	unsigned int items_per_feed = bench::env_setting("BENCH_ITEMS_PER_FEED",
+			1000);
+	unsigned int content_bytes = bench::env_setting("BENCH_CONTENT_BYTES",
+			1500);
+};
+
+std::string feed_url(unsigned int feed)
+{
+	return "http://example.com/feeds/" + std::to_string(feed) + ".xml";
+}
+
+std::vector<std::string> feed_urls()
+{
+	std::vector<std::string> urls;
+	for (unsigned int i = 0; i < Shape().feeds; ++i) {
+		urls.push_back(feed_url(i));
+	}
+	return urls;
+}
+
+const std::vector<std::string> WORDS = {
+	"newsboat", "feed", "article", "the", "a", "of", "and", "reload",
+	"cache", "release", "update", "security", "podcast", "episode",
+};
+
+std::string text(std::mt19937& random, std::size_t length)
+{
+	std::uniform_int_distribution<std::size_t> word(0, WORDS.size() - 1);
+	std::string result;
+	while (result.size() < length) {
+		result += WORDS[word(random)];
+		result += ' ';
+	}
+	return result;
+}
+
+std::shared_ptr<RssFeed> make_feed(Cache* cache, unsigned int feed,
+	std::mt19937& random)
+{
+	const Shape shape;
+	std::lognormal_distribution<double> content_length(
+		std::log(std::max(shape.content_bytes, 1u)), 1.0);
+
+	auto rssfeed = std::make_shared<RssFeed>(cache, feed_url(feed));
+	rssfeed->set_title("Feed number " + std::to_string(feed));
+	rssfeed->set_link("http://example.com/" + std::to_string(feed));
+	for (unsigned int i = 0; i < shape.items_per_feed; ++i) {
+		auto item = std::make_shared<RssItem>(cache);
+		const std::string id = std::to_string(feed) + "/" + std::to_string(i);
+		item->set_guid("http://example.com/items/" + id);
+		item->set_link("http://example.com/items/" + id);
+		item->set_feedurl(rssfeed->rssurl());
+		item->set_title("Item " + id + ": " + text(random, 40));
+		item->set_author("Author " + std::to_string(i % 17));
+		item->set_pubDate(1500000000 + 3600 * static_cast<time_t>(i));
+		item->set_description("<p>" + text(random,
+				static_cast<std::size_t>(content_length(random))) + "</p>",
+			"text/html");
+		item->set_unread_nowrite(i % 4 == 0);
+		rssfeed->add_item(item);
+	}
+	return rssfeed;
+}
+
+/// \brief Writes the synthetic cache, unless it's there already.
+///
+/// It's kept in BENCH_CACHE_FILE if that's set, so it can be reused by
+/// later runs; delete the file after changing the shape. Otherwise it's a
+/// temporary file that's removed at exit.
+std::string generate_cache()
+{
+	const char* kept = std::getenv("BENCH_CACHE_FILE");
+	std::string path;
+	if (kept != nullptr && *kept != '\0') {
+		path = kept;
+		if (::access(path.c_str(), F_OK) == 0) {
+			return path;
+		}
+	} else {
+		char dir[] = "/tmp/newsboat-bench.XXXXXX";
+		if (::mkdtemp(dir) == nullptr) {
+			throw std::runtime_error("couldn't create a temporary directory");
+		}
+		static std::string tmp_dir;
+		tmp_dir = dir;
+		path = tmp_dir + "/cache.db";
+		std::atexit([]() {
+			for (const std::string name : {
+					"cache.db", "cache.db.work", "cache.db.large-pages"
+				}) {
+				for (const std::string suffix : {
+						"", "-wal", "-shm", "-journal"
+					}) {
+					std::remove((tmp_dir + "/" + name + suffix).c_str());
+				}
+			}
+			::rmdir(tmp_dir.c_str());
+		});
+	}
+
+	const Shape shape;
+	std::cerr << "Generating a cache of " << shape.feeds << " feeds with "
+		<< shape.items_per_feed << " items each..." << std::endl;
+	ConfigContainer cfg;
+	Cache cache(path, &cfg);
+	std::mt19937 random(42);
+	for (unsigned int feed = 0; feed < shape.feeds; ++feed) {
+		cache.externalize_rssfeed(make_feed(&cache, feed, random), false);
+	}
+	// Some articles were deleted by the user
+	for (unsigned int feed = 0; feed < shape.feeds; feed += 2) {
+		for (unsigned int i = 0; i < shape.items_per_feed; i += 10) {
+			cache.mark_item_deleted("http://example.com/items/"
+				+ std::to_string(feed) + "/" + std::to_string(i), true);
+		}
+	}
+	return path;
+}
+
+const std::string& cache_file()
+{
+	static const std::string path = generate_cache();
+	return path;
+}
+
+/// Makes a copy of the synthetic cache for operations that change it.
+std::string copy_of_cache()
+{
+	const std::string copy = cache_file() + ".work";
+	std::ifstream src(cache_file(), std::ios::binary);
+	std::ofstream dst(copy, std::ios::binary | std::ios::trunc);
+	dst << src.rdbuf();
+	return copy;
+}
+
+/// A copy of the synthetic cache that `newsboat -X` gave pages of 16 KiB.
+const std::string& large_pages_cache_file()
+{
+	static const std::string path = []() {
+		const std::string copy = cache_file() + ".large-pages";
+		{
+			std::ifstream src(cache_file(), std::ios::binary);
+			std::ofstream dst(copy, std::ios::binary | std::ios::trunc);
+			dst << src.rdbuf();
+		}
+		ConfigContainer cfg;
+		cfg.set_configvalue("cache-page-size", "16384");
+		Cache cache(copy, &cfg);
+		cache.do_vacuum();
+		return copy;
+	}();
+	return path;
+}
+
+/// Config values to open a cache with, as pairs of name and value.
+using Settings = std::vector<std::pair<std::string, std::string>>;
+
+/// A cache that's opened once, for operations that don't change it much.
+struct OpenCache {
+	ConfigContainer cfg;
+	std::unique_ptr<Cache> cache_ptr;
+	Cache& cache;
+
+	explicit OpenCache(const Settings& settings = {},
+		const std::string& path = cache_file())
+		: cache_ptr(make_cache(cfg, settings, path))
+		, cache(*cache_ptr)
+	{
+	}
+
+private:
+	static Cache* make_cache(ConfigContainer& cfg, const Settings& settings,
+		const std::string& path)
+	{
+		for (const auto& setting : settings) {
+			cfg.set_configvalue(setting.first, setting.second);
+		}
+		return new Cache(path, &cfg);
+	}
+};
+
+/// Reads one feed's articles and the descriptions of all of them, the way
+/// opening the feed and scrolling through its articles does.
+bench::Setup read_feed(const Settings& settings,
+	const std::string& path = "")
+{
+	return [settings, path]() {
+		auto open = std::make_shared<OpenCache>(settings,
+				path.empty() ? cache_file() : path);
+		return [open]() {
+			auto feed = open->cache.internalize_rssfeed(feed_url(0), nullptr);
+			std::vector<std::string> guids;
+			for (const auto& item : feed->items()) {
+				guids.push_back(item->guid());
+			}
+			bench::keep(open->cache.fetch_descriptions(guids));
+		};
+	};
+}
+
+/// Runs \a op on a fresh copy of the cache every time.
+bench::Setup on_copy(std::function<void(Cache&)> op)
+{
+	return [op]() {
+		return [op]() {
+			std::unique_ptr<ConfigContainer> cfg;
+			std::unique_ptr<Cache> cache;
+			{
+				bench::Untimed untimed;
+				cfg.reset(new ConfigContainer());
+				cache.reset(new Cache(copy_of_cache(), cfg.get()));
+			}
+			op(*cache);
+			bench::Untimed untimed;
+			cache.reset();
+		};
+	};
+}
+
+/// Opens the cache, reads all the feeds, and formats the feed list the way
+/// the feed list dialog does with the default `feedlist-format`.
+bench::Operation start_up(bool lazy)
+{
+	const auto urls = feed_urls();
+	return [urls, lazy]() {
+		ConfigContainer cfg;
+		Cache cache(cache_file(), &cfg);
+		CacheLoader loader(cache, nullptr, 4, lazy);
+		const auto feeds = loader.load(urls);
+
+		FmtStrTemplate tmpl(cfg.get_configvalue("feedlist-format"));
+		std::vector<std::string> lines;
+		unsigned int i = 0;
+		for (const auto& feed : feeds) {
+			FmtStrFormatter fmt;
+			const auto unread = feed->unread_item_count();
+			fmt.register_fmt('i', std::to_string(++i));
+			fmt.register_fmt('n', unread > 0 ? "N" : " ");
+			fmt.register_fmt('u', "(" + std::to_string(unread) + "/"
+				+ std::to_string(feed->total_item_count()) + ")");
+			fmt.register_fmt('t', feed->title());
+			lines.push_back(fmt.do_format(tmpl, 80));
+		}
+		bench::keep(lines);
+	};
+}
+
+const bench::Registration benchmarks[] = {
+	{
+		"Cache::internalize_rssfeed one feed", []()
+		{
+			auto open = std::make_shared<OpenCache>();
+			return [open]() {
+				bench::keep(open->cache.internalize_rssfeed(feed_url(0), nullptr));
+			};
+		}
+	},
+	{
+		"Cache::externalize_rssfeed one unchanged feed", []()
+		{
+			auto open = std::make_shared<OpenCache>();
+			std::mt19937 random(42);
+			auto feed = make_feed(&open->cache, 0, random);
+			return [open, feed]() {
+				bench::keep(open->cache.externalize_rssfeed(feed, false));
+			};
+		}
+	},
+	{
+		"Cache::search_for_items all feeds", []()
+		{
+			auto open = std::make_shared<OpenCache>();
+			return [open]() {
+				RssIgnores ign;
+				bench::keep(open->cache.search_for_items("security update", "",
+						ign));
+			};
+		}
+	},
+	{
+		"Cache::cleanup_cache without a tenth of the feeds",
+		on_copy([](Cache& cache)
+		{
+			std::vector<std::shared_ptr<RssFeed>> feeds;
+			const auto urls = feed_urls();
+			for (std::size_t i = 0; i < urls.size(); ++i) {
+				if (i % 10 != 0) {
+					feeds.push_back(std::make_shared<RssFeed>(&cache, urls[i]));
+				}
+			}
+			bench::keep(cache.cleanup_cache(feeds, true));
+		})
+	},
+	{
+		"Cache::mark_all_read all feeds", on_copy([](Cache& cache)
+		{
+			cache.mark_all_read();
+		})
+	},
+	{
+		"Cache::remove_old_deleted_items one feed", on_copy([](Cache& cache)
+		{
+			// The download only has the newer half of the articles
+			const unsigned int items = Shape().items_per_feed;
+			RssFeed feed(&cache, feed_url(0));
+			{
+				bench::Untimed untimed;
+				for (unsigned int i = items / 2; i < items; ++i) {
+					auto item = std::make_shared<RssItem>(&cache);
+					item->set_guid("http://example.com/items/0/"
+						+ std::to_string(i));
+					feed.add_item(item);
+				}
+			}
+			cache.remove_old_deleted_items(&feed);
+		})
+	},
+	{
+		"Cache reading a feed's articles, mapped",
+		read_feed({})
+	},
+	{
+		"Cache reading a feed's articles, not mapped",
+		read_feed({{"cache-mmap-mb", "0"}, {"cache-memory-kb", "2000"}})
+	},
+	{
+		"Cache reading a feed's articles, mapped, 16 KiB pages", []()
+		{
+			return read_feed({{"cache-page-size", "16384"}},
+					large_pages_cache_file())();
+		}
+	},
+	{
+		"Startup to the feed list", []()
+		{
+			return start_up(false);
+		}
+	},
+	{
+		"Startup to the feed list, lazily", []()
+		{
+			return start_up(true);
+		}
+	},
+};
+
+}
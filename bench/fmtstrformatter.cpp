@@ -0,0 +1,48 @@
+#include "fmtstrformatter.h"
+
+#include <memory>
+
+#include "benchmark.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// The default articlelist-format.
+const std::string FORMAT = "%4i %f %D %6L  %?T?|%-17T|  &?%t";
+
+std::shared_ptr<FmtStrFormatter> formatter()
+{
+	auto fmt = std::make_shared<FmtStrFormatter>();
+	fmt->register_fmt('i', "42");
+	fmt->register_fmt('f', "N");
+	fmt->register_fmt('D', "Oct 14");
+	fmt->register_fmt('L', "1.2KB");
+	fmt->register_fmt('T', "Some feed title");
+	fmt->register_fmt('t', "The title of an article in the list");
+	return fmt;
+}
+
+const bench::Registration benchmarks[] = {
+	{
+		"FmtStrFormatter::do_format string", []()
+		{
+			auto fmt = formatter();
+			return [fmt]() {
+				bench::keep(fmt->do_format(FORMAT, 80));
+			};
+		}
+	},
+	{
+		"FmtStrFormatter::do_format template", []()
+		{
+			auto fmt = formatter();
+			auto tmpl = std::make_shared<FmtStrTemplate>(FORMAT);
+			return [fmt, tmpl]() {
+				bench::keep(fmt->do_format(*tmpl, 80));
+			};
+		}
+	},
+};
+
+}
@@ -0,0 +1,47 @@
+#include "htmlrenderer.h"
+
+#include "benchmark.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// An article with the markup that feeds commonly use.
+std::string article()
+{
+	std::string html = "<h1>A long article</h1>";
+	for (int i = 0; i < 50; ++i) {
+		html += "<p>Paragraph " + std::to_string(i) + " has <b>bold</b>, "
+			"<i>italic</i> and <a href=\"http://example.com/" +
+			std::to_string(i) + "\">linked</a> text, plus &amp; some "
+			"entities &lt;like these&gt; and enough words to wrap a "
+			"couple of times on an ordinary terminal.</p>";
+		if (i % 10 == 0) {
+			html += "<ul><li>one</li><li>two</li><li>three</li></ul>"
+				"<blockquote>A quote</blockquote>"
+				"<pre>  some\n  preformatted\n  code</pre>"
+				"<img src=\"http://example.com/image.png\" alt=\"image\">";
+		}
+	}
+	html += "<table><tr><th>a</th><th>b</th></tr>"
+		"<tr><td>1</td><td>2</td></tr></table>";
+	return html;
+}
+
+const bench::Registration benchmarks[] = {
+	{
+		"HtmlRenderer::render article", []()
+		{
+			const auto html = article();
+			return [html]() {
+				HtmlRenderer renderer;
+				std::vector<std::pair<LineType, std::string>> lines;
+				std::vector<LinkPair> links;
+				renderer.render(html, lines, links, "http://example.com/");
+				bench::keep(lines);
+			};
+		}
+	},
+};
+
+}
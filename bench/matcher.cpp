@@ -0,0 +1,54 @@
+#include "matcher.h"
+
+#include <memory>
+
+#include "benchmark.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// Items as a feed would have them, without any cache behind them.
+std::vector<std::shared_ptr<RssItem>> items()
+{
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (int i = 0; i < 1000; ++i) {
+		auto item = std::make_shared<RssItem>(nullptr);
+		item->set_title("Item number " + std::to_string(i)
+			+ (i % 7 == 0 ? " about newsboat" : " about something else"));
+		item->set_author(i % 3 == 0 ? "Alice" : "Bob");
+		item->set_link("http://example.com/items/" + std::to_string(i));
+		item->set_pubDate(1000000000 + 3600 * i);
+		item->set_unread_nowrite(i % 2 == 0);
+		items.push_back(item);
+	}
+	return items;
+}
+
+bench::Setup match(const std::string& expression)
+{
+	return [expression]() {
+		auto matcher = std::make_shared<Matcher>(expression);
+		const auto all = items();
+		return [matcher, all]() {
+			unsigned int matched = 0;
+			for (const auto& item : all) {
+				matched += matcher->matches(item.get()) ? 1 : 0;
+			}
+			bench::keep(matched);
+		};
+	};
+}
+
+const bench::Registration benchmarks[] = {
+	{"Matcher::matches 1000 items, =", match("author = \"Alice\"")},
+	{"Matcher::matches 1000 items, =~", match("title =~ \"newsboat\"")},
+	{"Matcher::matches 1000 items, #", match("title # \"about\"")},
+	{
+		"Matcher::matches 1000 items, and/or",
+		match("unread = \"yes\" and (author = \"Alice\" or title =~ \"[0-9]+5\")")
+	},
+};
+
+}
@@ -0,0 +1,46 @@
+#include "regexmanager.h"
+
+#include <memory>
+
+#include "benchmark.h"
+
+using namespace newsboat;
+
+namespace {
+
+bench::Setup highlight(bool multi_pattern)
+{
+	return [multi_pattern]() {
+		auto rxman = std::make_shared<RegexManager>();
+		rxman->set_multi_pattern(multi_pattern);
+		const std::vector<std::string> words = {
+			"newsboat", "podboat", "feed", "article", "reload",
+			"cache", "[0-9]+ items", "^Item",
+		};
+		for (const auto& word : words) {
+			rxman->handle_action("highlight", {"articlelist", word, "red"});
+		}
+
+		std::vector<std::string> lines;
+		for (int i = 0; i < 100; ++i) {
+			lines.push_back("Item " + std::to_string(i)
+				+ ": the newsboat feed had 42 items after the reload");
+		}
+		return [rxman, lines]() {
+			for (auto line : lines) {
+				rxman->quote_and_highlight(line, "articlelist");
+				bench::keep(line);
+			}
+		};
+	};
+}
+
+const bench::Registration benchmarks[] = {
+	{"RegexManager::quote_and_highlight 100 lines", highlight(false)},
+	{
+		"RegexManager::quote_and_highlight 100 lines, multi-pattern",
+		highlight(true)
+	},
+};
+
+}
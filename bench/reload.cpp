@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark.h"
+#include "test/test_helpers/replayserver.h"
+
+extern char** environ;
+
+using test_helpers::ReplayArchive;
+using test_helpers::ReplayServer;
+
+namespace {
+
+/// \brief An archive of generated feeds, for when BENCH_REPLAY_ARCHIVE
+/// doesn't name a recorded one.
+///
+/// BENCH_REPLAY_FEEDS feeds with BENCH_REPLAY_ITEMS articles each; every
+/// one of them has an ETag, so a reload with a warm cache only gets 304s.
+ReplayArchive synthetic_archive()
+{
+	const auto feeds = bench::env_setting("BENCH_REPLAY_FEEDS", 50);
+	const auto items = bench::env_setting("BENCH_REPLAY_ITEMS", 20);
+
+	ReplayArchive archive;
+	for (std::uint64_t feed = 0; feed < feeds; ++feed) {
+		const std::string id = std::to_string(feed);
+		ReplayArchive::Response response;
+		response.url = "http://example.com/feeds/" + id + ".xml";
+		response.headers = {
+			{"Content-Type", "application/rss+xml; charset=utf-8"},
+			{"ETag", "\"" + id + "\""},
+			{"Last-Modified", "Sat, 01 Jan 2022 00:00:00 GMT"},
+		};
+		response.body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+			"<rss version=\"2.0\"><channel><title>Feed number " + id +
+			"</title><link>http://example.com/" + id + "</link>";
+		for (std::uint64_t item = 0; item < items; ++item) {
+			const std::string item_id = id + "/" + std::to_string(item);
+			response.body += "<item><title>Item " + item_id + "</title>"
+				"<link>http://example.com/items/" + item_id + "</link>"
+				"<guid>http://example.com/items/" + item_id + "</guid>"
+				"<pubDate>Sat, 01 Jan 2022 00:00:00 GMT</pubDate>"
+				"<description>&lt;p&gt;" + std::string(1000, 'x') +
+				"&lt;/p&gt;</description></item>";
+		}
+		response.body += "</channel></rss>\n";
+		archive.responses.push_back(std::move(response));
+	}
+	return archive;
+}
+
+ReplayArchive load_archive()
+{
+	const char* dir = std::getenv("BENCH_REPLAY_ARCHIVE");
+	if (dir != nullptr && *dir != '\0') {
+		return ReplayArchive::load(dir);
+	}
+	return synthetic_archive();
+}
+
+/// \brief A replay server and a Newsboat home directory whose urls file
+/// points at it.
+///
+/// The time of a reload is that of running `newsboat -x reload` from
+/// BENCH_NEWSBOAT (./newsboat by default), start-up included. Extra
+/// settings, e.g. for connection reuse, are read from the file named by
+/// BENCH_RELOAD_CONFIG.
+class Reload {
+public:
+	explicit Reload(unsigned int threads)
+		: Reload(threads, load_archive())
+	{
+	}
+
+	~Reload()
+	{
+		if (reloads > 0) {
+			std::cerr << "With reload-threads " << threads << ": " << std::fixed << std::setprecision(1)
+				<< static_cast<double>(server.requests()) / reloads
+				<< " requests over "
+				<< static_cast<double>(server.connections()) / reloads
+				<< " connections per reload" << std::endl;
+		}
+		remove_cache();
+		for (const std::string file : {
+				"urls", "config"
+			}) {
+			std::remove((dir + "/" + file).c_str());
+		}
+		::rmdir(dir.c_str());
+	}
+
+	void remove_cache()
+	{
+		for (const std::string suffix : {
+				"", ".lock", "-wal", "-shm", "-journal"
+			}) {
+			std::remove((dir + "/cache.db" + suffix).c_str());
+		}
+	}
+
+	void run()
+	{
+		// The server's threads might hold locks at the fork, so the child
+		// does nothing but exec
+		const char* newsboat = std::getenv("BENCH_NEWSBOAT");
+		if (newsboat == nullptr || *newsboat == '\0') {
+			newsboat = "./newsboat";
+		}
+		const std::string urls = dir + "/urls";
+		const std::string cache = dir + "/cache.db";
+		const std::string config = dir + "/config";
+		const char* const argv[] = {
+			newsboat, "-u", urls.c_str(), "-c", cache.c_str(), "-C",
+			config.c_str(), "-x", "reload", nullptr
+		};
+		std::vector<std::string> environment = {"HOME=" + dir};
+		for (char** var = environ; *var != nullptr; ++var) {
+			if (std::string(*var).compare(0, 5, "HOME=") != 0) {
+				environment.push_back(*var);
+			}
+		}
+		std::vector<char*> envp;
+		for (auto& var : environment) {
+			envp.push_back(&var[0]);
+		}
+		envp.push_back(nullptr);
+
+		const pid_t pid = ::fork();
+		if (pid == -1) {
+			throw std::runtime_error("couldn't fork");
+		}
+		if (pid == 0) {
+			const int devnull = ::open("/dev/null", O_WRONLY);
+			::dup2(devnull, STDOUT_FILENO);
+			::execve(newsboat, const_cast<char* const*>(argv), envp.data());
+			::_exit(127);
+		}
+		int status = 0;
+		::waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			throw std::runtime_error("newsboat -x reload failed");
+		}
+		++reloads;
+	}
+
+private:
+	Reload(unsigned int threads, ReplayArchive archive)
+		: threads(threads)
+		, feeds(archive.responses.size())
+		, server(std::move(archive), options())
+		, reloads(0)
+	{
+		char dir_template[] = "/tmp/newsboat-bench.XXXXXX";
+		if (::mkdtemp(dir_template) == nullptr) {
+			throw std::runtime_error("couldn't create a temporary directory");
+		}
+		dir = dir_template;
+
+		std::ofstream urls(dir + "/urls");
+		for (std::size_t i = 0; i < feeds; ++i) {
+			urls << server.url_for(i) << '\n';
+		}
+
+		std::ofstream config(dir + "/config");
+		config << "reload-threads " << threads << '\n';
+		const char* extra = std::getenv("BENCH_RELOAD_CONFIG");
+		if (extra != nullptr && *extra != '\0') {
+			std::ifstream extra_config(extra);
+			config << extra_config.rdbuf();
+		}
+	}
+
+	/// BENCH_LATENCY_MS is added to every response. Recorded archives are
+	/// served as slowly as they were recorded, unless BENCH_RECORDED_TIMING
+	/// is 0.
+	static ReplayServer::Options options()
+	{
+		ReplayServer::Options options;
+		options.latency = std::chrono::milliseconds(
+				bench::env_setting("BENCH_LATENCY_MS", 20));
+		options.recorded_timing = bench::env_setting("BENCH_RECORDED_TIMING",
+				1) != 0;
+		return options;
+	}
+
+	const unsigned int threads;
+	const std::size_t feeds;
+	ReplayServer server;
+	std::string dir;
+	std::uint64_t reloads;
+};
+
+/// Runs a reload with a fresh cache every time, so every feed is downloaded
+/// and every article is new.
+bench::Setup cold(unsigned int threads)
+{
+	return [threads]() {
+		const auto reload = std::make_shared<Reload>(threads);
+		return [reload]() {
+			{
+				bench::Untimed untimed;
+				reload->remove_cache();
+			}
+			reload->run();
+		};
+	};
+}
+
+/// Reloads the same cache again and again; after the first time, the server
+/// answers with 304 for every feed that has an ETag or Last-Modified date.
+bench::Setup warm(unsigned int threads)
+{
+	return [threads]() {
+		const auto reload = std::make_shared<Reload>(threads);
+		return [reload]() {
+			reload->run();
+		};
+	};
+}
+
+const bench::Registration benchmarks[] = {
+	{"Reload, cold, 1 thread", cold(1)},
+	{"Reload, cold, 4 threads", cold(4)},
+	{"Reload, cold, 16 threads", cold(16)},
+	{"Reload, warm, 4 threads", warm(4)},
+};
+
+}
+
+namespace bench {
+
+int record_archive(const std::string& urls_file, const std::string& dir)
+{
+	std::ifstream urls(urls_file);
+	if (!urls) {
+		std::cerr << "couldn't read " << urls_file << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ReplayArchive archive;
+	std::string url;
+	while (std::getline(urls, url)) {
+		// Like in Newsboat's urls file, the URL is followed by tags
+		url = url.substr(0, url.find_first_of(" \t"));
+		if (url.empty() || url[0] == '#') {
+			continue;
+		}
+		std::cerr << "Recording " << url << "..." << std::endl;
+		if (!archive.record(url)) {
+			std::cerr << "couldn't download " << url << std::endl;
+		}
+	}
+
+	try {
+		archive.save(dir);
+	} catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+} // namespace bench
@@ -0,0 +1,65 @@
+#include "rss/parser.h"
+
+#include "benchmark.h"
+
+namespace {
+
+bench::Operation parse(const std::string& buffer, bool streaming)
+{
+	return [buffer, streaming]() {
+		rsspp::Parser parser;
+		parser.set_streaming(streaming);
+		bench::keep(parser.parse_buffer(buffer));
+	};
+}
+
+bench::Setup parse_file(const std::string& file, bool streaming)
+{
+	return [file, streaming]() {
+		return parse(bench::read_test_data(file), streaming);
+	};
+}
+
+/// An RSS 2.0 feed big enough that per-item work dominates.
+std::string large_feed()
+{
+	std::string feed = "<?xml version=\"1.0\"?>\n"
+		"<rss version=\"2.0\"><channel><title>Large feed</title>"
+		"<link>http://example.com/</link>"
+		"<description>Lots of items</description>";
+	for (int i = 0; i < 500; ++i) {
+		const std::string n = std::to_string(i);
+		feed += "<item><title>Item number " + n + "</title>"
+			"<link>http://example.com/items/" + n + "</link>"
+			"<guid>http://example.com/items/" + n + "</guid>"
+			"<author>someone@example.com (Some One)</author>"
+			"<pubDate>Sat, 07 Sep 2002 00:00:01 GMT</pubDate>"
+			"<description>&lt;p&gt;The description of item " + n +
+			", with &lt;a href=\"http://example.com/\"&gt;a link&lt;/a&gt;"
+			" and some more text to make it look real.&lt;/p&gt;"
+			"</description></item>";
+	}
+	return feed + "</channel></rss>";
+}
+
+const bench::Registration benchmarks[] = {
+	{"Parser::parse_buffer rss091_1.xml", parse_file("rss091_1.xml", true)},
+	{"Parser::parse_buffer rss092_1.xml", parse_file("rss092_1.xml", true)},
+	{"Parser::parse_buffer rss10_1.xml", parse_file("rss10_1.xml", true)},
+	{"Parser::parse_buffer rss20_1.xml", parse_file("rss20_1.xml", true)},
+	{"Parser::parse_buffer atom10_1.xml", parse_file("atom10_1.xml", true)},
+	{
+		"Parser::parse_buffer 500 items", []()
+		{
+			return parse(large_feed(), true);
+		}
+	},
+	{
+		"Parser::parse_buffer 500 items, no streaming", []()
+		{
+			return parse(large_feed(), false);
+		}
+	},
+};
+
+}
@@ -0,0 +1,55 @@
+#include "textformatter.h"
+
+#include <memory>
+
+#include "benchmark.h"
+#include "regexmanager.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::vector<std::pair<LineType, std::string>> article_lines()
+{
+	std::vector<std::pair<LineType, std::string>> lines;
+	for (int i = 0; i < 200; ++i) {
+		lines.emplace_back(LineType::wrappable,
+			"Line " + std::to_string(i) + " of the article, which is long "
+			"enough to be wrapped once or twice at the usual widths, "
+			"and mentions newsboat every now and then.");
+		if (i % 20 == 0) {
+			lines.emplace_back(LineType::nonwrappable, "  preformatted code");
+			lines.emplace_back(LineType::hr, "");
+		}
+	}
+	return lines;
+}
+
+bench::Operation format(std::shared_ptr<RegexManager> rxman)
+{
+	const auto lines = article_lines();
+	return [lines, rxman]() {
+		TextFormatter formatter;
+		formatter.add_lines(lines);
+		bench::keep(formatter.format_text_to_list(rxman.get(), "article", 72));
+	};
+}
+
+const bench::Registration benchmarks[] = {
+	{
+		"TextFormatter::format_text_to_list", []()
+		{
+			return format(nullptr);
+		}
+	},
+	{
+		"TextFormatter::format_text_to_list, highlighted", []()
+		{
+			auto rxman = std::make_shared<RegexManager>();
+			rxman->handle_action("highlight", {"article", "newsboat", "red"});
+			return format(rxman);
+		}
+	},
+};
+
+}
@@ -109,7 +109,8 @@ check_ssl_implementation() {
 
 echo "" > config.mk
 
-check_pkg "sqlite3" || fail "sqlite3"
+check_pkg "sqlite3" "" 3.34.0 || fail "sqlite3"
+check_pkg "zlib" || fail "zlib"
 check_pkg "libcurl" || check_custom "libcurl" "curl-config" || fail "libcurl"
 check_pkg "libxml-2.0" || check_custom "libxml2" "xml2-config" || fail "libxml2"
 check_pkg "stfl" || fail "stfl"
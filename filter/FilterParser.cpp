@@ -108,17 +108,14 @@ void FilterParser::cleanup_r(expression * e) {
 	}
 }
 
-expression::expression(const std::string& n, const std::string& lit, int o) : name(n), literal(lit), op(o), l(NULL), r(NULL), parent(NULL), regex(NULL) {
+expression::expression(const std::string& n, const std::string& lit, int o) : name(n), literal(lit), op(o), l(NULL), r(NULL), parent(NULL), attribute(-1), number(0), upper(0), has_range(false) {
 	if (literal[0] == '"' && literal[literal.length()-1] == '"') {
 		literal = literal.substr(1,literal.length()-2);
 	}
 }
 
-expression::expression(int o) : op(o), l(NULL), r(NULL), parent(NULL), regex(NULL) {
+expression::expression(int o) : op(o), l(NULL), r(NULL), parent(NULL), attribute(-1), number(0), upper(0), has_range(false) {
 }
 
 expression::~expression() {
-	if (regex)
-		regfree(regex);
-	delete regex;
 }
@@ -1,10 +1,13 @@
 #ifndef NEWSBOAT_FILTER_PARSER_H_
 #define NEWSBOAT_FILTER_PARSER_H_
 
+#include <memory>
 #include <string>
 #include <sys/types.h>
 #include <regex.h>
 
+#include "regexowner.h"
+
 
 enum { LOGOP_INVALID = 0, LOGOP_AND = 1, LOGOP_OR, MATCHOP_EQ, MATCHOP_NE, MATCHOP_RXEQ, MATCHOP_RXNE, MATCHOP_LT, MATCHOP_GT, MATCHOP_LE, MATCHOP_GE, MATCHOP_CONTAINS, MATCHOP_CONTAINSNOT, MATCHOP_BETWEEN };
 
@@ -18,7 +21,18 @@ struct expression {
 	int op;
 	expression * l, * r;
 	expression * parent;
-	regex_t * regex;
+	/// Compiled on first use by Matcher
+	std::shared_ptr<const newsboat::Regex> regex;
+	/// Id of the attribute \a name, looked up when the expression is first
+	/// matched; -1 until then
+	int attribute;
+	/// The literal of `<`, `>`, `<=` and `>=` as a number, and the ends of
+	/// that of `between`, lower first; parsed by Matcher::parse(). A
+	/// `between` without two ends has \a has_range unset, and matches
+	/// nothing
+	int number;
+	int upper;
+	bool has_range;
 };
 
 class FilterParser {
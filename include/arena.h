@@ -0,0 +1,86 @@
+#ifndef NEWSBOAT_ARENA_H_
+#define NEWSBOAT_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Hands out memory from large blocks, and frees all of them at once
+/// when it's destroyed.
+///
+/// Meant for objects that are made together and die together, like the
+/// articles of a feed that was just parsed: instead of a malloc() and a
+/// free() for each, there's one of each per block. Only one thread may
+/// allocate at a time; the memory can be used and given back from any.
+class Arena {
+public:
+	explicit Arena(std::size_t block_size = 64 * 1024);
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/// Returns \a size bytes aligned to \a alignment, which has to be a
+	/// power of two no larger than alignof(std::max_align_t).
+	void* allocate(std::size_t size, std::size_t alignment);
+
+	std::size_t block_count() const
+	{
+		return blocks.size();
+	}
+
+private:
+	const std::size_t block_size;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	/// The part of the last block that's still free
+	std::uintptr_t next;
+	std::uintptr_t end;
+};
+
+/// \brief A standard allocator that gets its memory from an Arena.
+///
+/// Every copy keeps the arena alive, so memory from it can't be freed
+/// before what's in it. In particular, objects made with
+/// std::allocate_shared() keep their arena until the last of them goes.
+/// Deallocating is a no-op.
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(std::shared_ptr<Arena> a)
+		: arena(std::move(a))
+	{
+	}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other)
+		: arena(other.arena)
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, std::size_t)
+	{
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const
+	{
+		return arena == other.arena;
+	}
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const
+	{
+		return arena != other.arena;
+	}
+
+	std::shared_ptr<Arena> arena;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_ARENA_H_ */
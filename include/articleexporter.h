@@ -0,0 +1,70 @@
+#ifndef NEWSBOAT_ARTICLEEXPORTER_H_
+#define NEWSBOAT_ARTICLEEXPORTER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace newsboat {
+
+class ConfigContainer;
+class JobProgress;
+class RssItem;
+
+/// \brief Writes many articles at once, for `save-all`.
+///
+/// Rendering an article with item_renderer::to_plain_text() takes much
+/// longer than writing it out, so the articles are rendered on a few
+/// threads, a batch at a time, while the calling thread writes each batch
+/// in order.
+class ArticleExporter {
+public:
+	/// What a single file that holds all the articles looks like
+	enum class Archive {
+		/// One message per article, in mboxrd format
+		MBOX,
+		/// One JSON object per article and line
+		JSONL,
+	};
+
+	/// The path to write an article to, and the article
+	using File = std::pair<std::string, std::shared_ptr<RssItem>>;
+
+	ArticleExporter(ConfigContainer& cfg, unsigned int num_threads);
+
+	/// \brief Writes each article to its own file, like `save` does.
+	///
+	/// Returns the paths that couldn't be written. If \a progress is
+	/// cancelled, the articles that weren't written by then are left out.
+	std::vector<std::string> write_files(const std::vector<File>& files,
+		JobProgress& progress);
+
+	/// \brief Writes all of \a items to the file \a path, in order.
+	///
+	/// The file is written next to \a path and renamed over it once it's
+	/// complete. Returns false, and leaves \a path alone, if it couldn't be
+	/// written or \a progress was cancelled.
+	bool write_archive(const std::string& path, Archive format,
+		const std::vector<std::shared_ptr<RssItem>>& items, JobProgress& progress);
+
+	/// The entry of \a format for \a item, whose rendered text is \a text.
+	static std::string archive_entry(Archive format, const RssItem& item,
+		const std::string& text);
+
+private:
+	/// Renders \a items and hands each text to \a write, in order, until
+	/// \a write returns false or \a progress is cancelled. Returns whether
+	/// it got through all of them.
+	bool for_each_rendered(const std::vector<std::shared_ptr<RssItem>>& items,
+		JobProgress& progress,
+		const std::function<bool(std::size_t, const std::string&)>& write);
+
+	ConfigContainer& cfg;
+	const unsigned int num_threads;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_ARTICLEEXPORTER_H_ */
@@ -0,0 +1,96 @@
+#ifndef NEWSBOAT_ARTICLEPRERENDERER_H_
+#define NEWSBOAT_ARTICLEPRERENDERER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rendercache.h"
+
+namespace newsboat {
+
+class ConfigContainer;
+class RegexManager;
+class RssItem;
+
+/// \brief Renders the articles that are likely to be opened next on a
+/// background thread.
+///
+/// The article view asks for the items next to the one it shows, so that
+/// going to the next or previous article finds its view in the RenderCache
+/// already. Only the internal HTML renderer is run this way; external ones
+/// are programs the user might not expect to be started speculatively.
+class ArticlePrerenderer {
+public:
+	ArticlePrerenderer(ConfigContainer& cfg, RenderCache& cache);
+	ArticlePrerenderer(const ArticlePrerenderer&) = delete;
+	ArticlePrerenderer& operator=(const ArticlePrerenderer&) = delete;
+	/// Waits for the article that's being rendered, and drops the rest.
+	~ArticlePrerenderer();
+
+	/// \brief Renders the views of \a items that the cache doesn't have
+	/// yet, in order.
+	///
+	/// \a rxman is copied whenever its rules change, so the background
+	/// thread never touches the one the UI uses. Replaces whatever is left
+	/// of the previous request.
+	void prerender(const std::vector<std::shared_ptr<RssItem>>& items,
+		const RenderCache::Options& options,
+		const RegexManager& rxman);
+
+	/// \brief Renders \a item before any of the items from prerender(),
+	/// and keeps its view for take_rendered().
+	///
+	/// The view is kept even if it's too large for the cache. Replaces
+	/// the item that was asked for before; if that one is being rendered
+	/// already, \a item is next.
+	void render_next(const std::shared_ptr<RssItem>& item,
+		const RenderCache::Options& options,
+		const RegexManager& rxman);
+	/// The view of render_next()'s \a item with \a options, once it's
+	/// done. Only handed out once.
+	nonstd::optional<RenderCache::Rendered> take_rendered(
+		const std::shared_ptr<RssItem>& item,
+		const RenderCache::Options& options);
+
+	/// \brief Renders \a item the way the article view shows it: the
+	/// enclosure link, if any, comes first in the links.
+	///
+	/// Unless \a max_body_size is 0, only that many bytes of the body are
+	/// rendered.
+	static RenderCache::Rendered render(ConfigContainer& cfg,
+		std::shared_ptr<RssItem> item,
+		const RenderCache::Options& options,
+		RegexManager* rxman,
+		std::size_t max_body_size = 0);
+
+private:
+	void run();
+	/// Makes sure \a rules is a copy of \a rxman. Expects mtx to be held.
+	void copy_rules_unlocked(const RegexManager& rxman);
+
+	ConfigContainer& cfg;
+	RenderCache& cache;
+	std::mutex mtx;
+	std::condition_variable wakeup;
+	std::deque<std::shared_ptr<RssItem>> pending;
+	RenderCache::Options options;
+	/// Copy of the latest rules that were passed in
+	std::shared_ptr<RegexManager> rules;
+	/// Set by render_next() until its view is taken
+	std::shared_ptr<RssItem> wanted;
+	RenderCache::Options wanted_options;
+	/// Whether the worker still has to start on \a wanted
+	bool wanted_pending;
+	nonstd::optional<RenderCache::Rendered> wanted_view;
+	bool stopping;
+	std::thread worker;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_ARTICLEPRERENDERER_H_ */
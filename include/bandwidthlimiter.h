@@ -0,0 +1,55 @@
+#ifndef PODBOAT_BANDWIDTHLIMITER_H_
+#define PODBOAT_BANDWIDTHLIMITER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+#include <vector>
+
+namespace podboat {
+
+/// \brief Keeps the transfers that share it under a common speed limit.
+///
+/// A token bucket: every byte that arrives takes a token, and the tokens
+/// come back at the limit's rate, up to a second's worth. A transfer that
+/// finds the bucket empty pauses itself (its write callback returns
+/// CURL_WRITEFUNC_PAUSE) until resumable() lets it go on.
+///
+/// Not thread-safe; it's meant for the transfers of a single curl multi
+/// handle.
+class BandwidthLimiter {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// A limit of 0 bytes per second means there's none.
+	explicit BandwidthLimiter(std::uint64_t bytes_per_second = 0);
+
+	void set_limit(std::uint64_t bytes_per_second);
+
+	/// Takes the tokens for \a bytes that arrived for \a handle, if there
+	/// are any left; the bucket may go into debt for the last of them.
+	/// Returns false, and remembers \a handle as paused, if there are none.
+	bool take(CURL* handle, std::size_t bytes);
+
+	/// Refills the bucket for the time up to \a now. Returns the paused
+	/// transfers if that brought tokens back, and forgets about them.
+	std::vector<CURL*> resumable(Clock::time_point now);
+
+	/// Drops \a handle from the paused transfers, e.g. once it's removed.
+	void forget(CURL* handle);
+
+	bool has_paused() const
+	{
+		return !paused.empty();
+	}
+
+private:
+	std::uint64_t rate;
+	double tokens;
+	Clock::time_point last_refill;
+	std::vector<CURL*> paused;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_BANDWIDTHLIMITER_H_ */
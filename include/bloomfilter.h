@@ -0,0 +1,51 @@
+#ifndef NEWSBOAT_BLOOMFILTER_H_
+#define NEWSBOAT_BLOOMFILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief A set of strings that can tell for sure that a string isn't in
+/// it, but only that one probably is.
+///
+/// Takes about 10 bits per string, whatever their length, and is wrong
+/// about 1% of the time about strings that aren't in it while it holds at
+/// most as many as it was made for.
+class BloomFilter {
+public:
+	/// Makes an empty filter for up to \a expected strings.
+	explicit BloomFilter(std::size_t expected = 0);
+
+	void add(const std::string& key);
+	/// False if \a key was never added; true if it probably was.
+	bool may_contain(const std::string& key) const;
+
+	/// How many strings were added
+	std::size_t size() const
+	{
+		return entries;
+	}
+	/// How many strings it was made for
+	std::size_t capacity() const
+	{
+		return expected;
+	}
+
+private:
+	/// The bit that the \a i-th hash function picks for the hashes \a h1
+	/// and \a h2 of a key.
+	std::size_t bit_index(std::uint64_t h1, std::uint64_t h2,
+		unsigned int i) const;
+
+	std::vector<std::uint64_t> bits;
+	std::size_t bit_count;
+	std::size_t expected;
+	std::size_t entries;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_BLOOMFILTER_H_ */
@@ -0,0 +1,54 @@
+#ifndef NEWSBOAT_BYTESCAN_H_
+#define NEWSBOAT_BYTESCAN_H_
+
+#include <cstddef>
+
+namespace newsboat {
+
+/// \brief Searches through text eight bytes at a time.
+///
+/// Article text is mostly long runs of bytes that none of the parsers and
+/// formatters care about. These functions test a whole machine word for the
+/// bytes they look for, and only go byte by byte in the word that has one.
+/// They use plain 64-bit arithmetic, so they work the same on every
+/// platform; single bytes are searched for with memchr(), which the C
+/// library vectorizes already.
+///
+/// All positions are indices into \a data, and `std::string::npos` means
+/// "not found".
+namespace bytescan {
+
+/// \brief Whether all \a size bytes at \a data are between ' ' and '~'.
+bool is_printable_ascii(const char* data, std::size_t size);
+
+/// \brief Whether all \a size bytes at \a data are below 0x80.
+bool is_ascii(const char* data, std::size_t size);
+
+/// \brief Whether the \a size bytes at \a data are valid UTF-8.
+///
+/// Overlong encodings, surrogates and code points past U+10FFFF aren't.
+bool is_valid_utf8(const char* data, std::size_t size);
+
+/// \brief Position of the first of the \a size bytes at \a data that is one
+/// of the (non-NUL) \a chars.
+std::size_t find_first_of(const char* data, std::size_t size,
+	const char* chars);
+
+/// \brief Position of the first soft hyphen (U+00AD) in the \a size bytes of
+/// UTF-8 at \a data.
+std::size_t find_soft_hyphen(const char* data, std::size_t size);
+
+/// \brief Whether utils::consolidate_whitespace() would return the \a size
+/// bytes at \a data unchanged.
+///
+/// That's the case if, after the leading spaces, no whitespace other than
+/// single spaces follows. Might return false for text that wouldn't change
+/// after all, e.g. if it contains a character that starts with the same
+/// byte as some Unicode whitespace.
+bool is_consolidated(const char* data, std::size_t size);
+
+} // namespace bytescan
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_BYTESCAN_H_ */
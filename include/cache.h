@@ -1,18 +1,36 @@
 #ifndef NEWSBOAT_CACHE_H_
 #define NEWSBOAT_CACHE_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <sqlite3.h>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include "bloomfilter.h"
 #include "configcontainer.h"
+#include "contentcodec.h"
+#include "itemchangelog.h"
+#include "refreshpolicy.h"
+#include "tracelog.h"
 
 namespace newsboat {
 
+class Cache;
 class RssFeed;
+
+using CacheMutex = TracedMutex<std::recursive_mutex>;
+class JobProgress;
 class RssIgnores;
 class RssItem;
+struct Description;
+struct ItemSummary;
 
 struct SchemaVersion {
 	unsigned int major, minor;
@@ -39,14 +57,146 @@ const SchemaVersion unknown_version = {0, 0};
 
 using schema_patches = std::map<SchemaVersion, std::vector<std::string>>;
 
+/// Compiled statements of a single connection, keyed by their SQL text.
+using StatementRegistry = std::unordered_map<std::string, sqlite3_stmt*>;
+
+/// Handle to a compiled SQL statement, usually borrowed from the statement
+/// registry of a Cache. When the handle goes out of scope, the statement is
+/// reset and its bindings are cleared, so it can be handed out again.
+class Statement {
+public:
+	/// If `owned` is true, the statement is finalized instead of being reset.
+	Statement(sqlite3* db, sqlite3_stmt* stmt, bool owned);
+	Statement(Statement&& other);
+	Statement(const Statement&) = delete;
+	Statement& operator=(const Statement&) = delete;
+	~Statement();
+
+	/// Binds a value to the 1-based parameter `index`.
+	Statement& bind(int index, const std::string& value);
+	Statement& bind(int index, int64_t value);
+	Statement& bind_blob(int index, const std::string& value);
+
+	/// Advances to the next row. Returns false once the statement is
+	/// done. Throws DbException if SQLite reports an error.
+	bool step();
+	/// Steps through the statement until it's done, discarding any rows.
+	void execute();
+
+	std::string column_string(int column) const;
+	int64_t column_int(int column) const;
+	bool column_is_null(int column) const;
+
+private:
+	sqlite3* db;
+	sqlite3_stmt* stmt;
+	bool owned;
+};
+
+/// An answer of the remote API, with the validators to ask the server
+/// whether it has changed since; see RemoteApi::revalidate().
+struct StoredResponse {
+	time_t last_modified = 0;
+	std::string etag;
+	std::string body;
+};
+
+/// A change to an article that the remote API is still to be told about;
+/// see RemoteOutbox. Changes to the same article are merged into one.
+struct OutboxEntry {
+	std::string guid;
+	/// Whether the article was marked read or unread, and which
+	bool has_read;
+	bool read;
+	/// Whether the flags changed, from what the API knew to what they are
+	bool has_flags;
+	std::string oldflags;
+	std::string flags;
+	/// How many times sending the change failed
+	unsigned int attempts;
+	/// Changes with every change that's merged into the entry
+	std::int64_t revision;
+};
+
+/// Runs all SQL issued during its lifetime in a single transaction, so that
+/// a batch of writes costs one journal sync instead of one per statement.
+/// Nested guards join the outermost transaction, which gets committed when
+/// the outermost guard goes out of scope. A guard that goes out of scope
+/// because of an exception undoes what was written during its lifetime
+/// instead. The cache stays locked for as long as the guard lives, so
+/// other threads' writes don't end up in the transaction.
+class ScopeTransaction {
+public:
+	explicit ScopeTransaction(Cache& cache);
+	ScopeTransaction(const ScopeTransaction&) = delete;
+	ScopeTransaction& operator=(const ScopeTransaction&) = delete;
+	~ScopeTransaction();
+
+private:
+	Cache& cache;
+	std::unique_lock<CacheMutex> lock;
+};
+
 class Cache {
 public:
 	Cache(const std::string& cachefile, ConfigContainer* c);
 	~Cache();
-	void externalize_rssfeed(std::shared_ptr<RssFeed> feed,
-		bool reset_unread);
+	/// Returns how many of the feed's articles weren't stored before.
+	/// If \a changes isn't null, the articles that were added or changed
+	/// are appended to it.
+	unsigned int externalize_rssfeed(std::shared_ptr<RssFeed> feed,
+		bool reset_unread, ItemChanges* changes = nullptr);
 	std::shared_ptr<RssFeed> internalize_rssfeed(std::string rssurl,
 		RssIgnores* ign);
+	/// \brief Stores \a newfeed like externalize_rssfeed(), and returns what
+	/// internalize_rssfeed() would then read back.
+	///
+	/// Rather than reading the whole feed back, the result is made from
+	/// \a newfeed and the items of \a oldfeed, which is the article list
+	/// being replaced. Only articles that \a oldfeed doesn't have are looked
+	/// up, and only the new and changed ones are checked against \a ign.
+	/// If \a oldfeed's items aren't loaded, this writes and reads after all.
+	/// If \a added isn't null, it's set to the number of articles that
+	/// weren't stored before. If \a changes isn't null, what happened to
+	/// the articles is appended to it, including the ones of \a oldfeed
+	/// that became read or unread.
+	std::shared_ptr<RssFeed> merge_rssfeed(
+		const std::shared_ptr<RssFeed>& oldfeed,
+		std::shared_ptr<RssFeed> newfeed,
+		bool reset_unread,
+		RssIgnores* ign,
+		unsigned int* added = nullptr,
+		ItemChanges* changes = nullptr);
+	/// \brief Fills several feeds at once, like internalize_rssfeed() does
+	/// for a single one.
+	///
+	/// The feeds need their rssurl set, and should be fresh. All of them
+	/// are read with a single pass over rss_feed and rss_item.
+	/// \a feed_done is called after each feed is ready.
+	void internalize_rssfeeds(
+		const std::vector<std::shared_ptr<RssFeed>>& feeds,
+		RssIgnores* ign,
+		const std::function<void()>& feed_done = nullptr);
+	/// Like internalize_rssfeed(), but only reads a summary of each item;
+	/// the items themselves are read by fetch_items() the first time the
+	/// feed's items are used. Ignores can't be applied to summaries.
+	std::shared_ptr<RssFeed> internalize_rssfeed_lazily(
+		const std::string& rssurl);
+	/// \brief Drops the summaries of articles that the cache doesn't keep,
+	/// like internalize_rssfeed_lazily() does with the ones it reads.
+	///
+	/// Those are articles older than `keep-articles-days`, which were
+	/// deleted when the cache was opened, and the unflagged ones beyond
+	/// `max-items`, which get deleted here. \a summaries have to be ordered
+	/// with the newest articles first.
+	void trim_item_summaries(std::vector<ItemSummary>& summaries);
+	/// \brief Reads the items of a lazily internalized feed into it.
+	///
+	/// With \a unread_only, only the unread and the flagged ones are read.
+	/// Items whose guids are in \a loaded are left out, since the feed
+	/// already has them. The caller is responsible for locking the feed.
+	void fetch_items(RssFeed& feed, bool unread_only = false,
+		const std::unordered_set<std::string>* loaded = nullptr);
 	void update_rssitem_unread_and_enqueued(std::shared_ptr<RssItem> item,
 		const std::string& feedurl);
 	void update_rssitem_unread_and_enqueued(RssItem* item,
@@ -56,13 +206,43 @@ public:
 	std::vector<std::string> cleanup_cache(std::vector<std::shared_ptr<RssFeed>> feeds,
 		bool always_clean = false);
 	void do_vacuum();
+	/// \brief Returns up to \a max_pages free pages of the cache file to the
+	/// filesystem.
+	///
+	/// Returns true if there are more pages left to reclaim. Returns false
+	/// right away if the cache isn't in incremental auto-vacuum mode.
+	bool compact(unsigned int max_pages);
+	/// \brief Compresses up to \a batch_size articles that were stored
+	/// before `cache-compress-content` was enabled.
+	///
+	/// The first call trains a dictionary on recent articles, unless the
+	/// cache already has one. Returns true if there are more articles left
+	/// to compress.
+	bool compress_stored_content(unsigned int batch_size);
+	/// \brief Moves the contents of up to \a batch_size articles that
+	/// predate rss_content there, and counts the characters of those whose
+	/// length isn't stored yet.
+	///
+	/// Returns true if there are more articles left to go through.
+	bool split_stored_content(unsigned int batch_size);
+	/// \brief The articles that contain \a querystr in their title or
+	/// content.
+	///
+	/// Once \a progress is cancelled, the query gives up and
+	/// DbException is thrown. The same goes for search_in_items().
 	std::vector<std::shared_ptr<RssItem>> search_for_items(
 			const std::string& querystr,
 			const std::string& feedurl,
-			RssIgnores& ign);
+			RssIgnores& ign,
+			const JobProgress* progress = nullptr);
 	std::unordered_set<std::string> search_in_items(
 		const std::string& querystr,
-		const std::unordered_set<std::string>& guids);
+		const std::unordered_set<std::string>& guids,
+		const JobProgress* progress = nullptr);
+	/// The URLs of the feeds that have articles, not deleted, for which
+	/// the SQL \a condition from Matcher::sql_condition() holds.
+	std::unordered_set<std::string> feeds_with_matches(
+		const std::string& condition);
 	void mark_all_read(const std::string& feedurl = "");
 	void mark_all_read(std::shared_ptr<RssFeed> feed);
 	void update_rssitem_flags(RssItem* item);
@@ -72,22 +252,290 @@ public:
 	void update_lastmodified(const std::string& uri,
 		time_t t,
 		const std::string& etag);
+	/// Returns the hash of the body the feed was last parsed from, or 0 if
+	/// there's none; see rsspp::Transfer::body_hash.
+	std::uint64_t fetch_body_hash(const std::string& uri);
+	/// Does nothing if the feed isn't in the cache yet.
+	void update_body_hash(const std::string& uri, std::uint64_t hash);
+	/// \brief Returns where the feed was permanently moved to, and since
+	/// when, in \a url and \a since; an empty \a url if it wasn't.
+	void fetch_moved_url(const std::string& uri, std::string& url,
+		time_t& since);
+	/// Does nothing if the feed isn't in the cache yet; an empty \a url
+	/// forgets that the feed moved.
+	void update_moved_url(const std::string& uri, const std::string& url,
+		time_t since);
+	/// \brief Reads what fetch_lastmodified(), fetch_body_hash() and
+	/// fetch_moved_url() return for every feed at once, for a reload of many
+	/// feeds.
+	///
+	/// Until flush_validators(), those are answered from memory without
+	/// taking the cache's lock, and update_lastmodified(),
+	/// update_body_hash() and update_moved_url() are put off until then.
+	void preload_validators();
+	/// Writes what was put off since preload_validators(), in one
+	/// transaction, and goes back to reading and writing the cache each
+	/// time.
+	void flush_validators();
+	/// Returns how long reloading each feed usually takes, in milliseconds,
+	/// keyed by feed URL. Feeds that were never timed are left out.
+	std::unordered_map<std::string, std::int64_t> fetch_download_times();
+	/// Returns how many of the articles published since \a since were
+	/// read, keyed by feed URL. Feeds without any are left out.
+	std::unordered_map<std::string, std::int64_t> fetch_read_counts(
+		time_t since);
+	/// Returns the guids of the unread articles, keyed by feed URL, without
+	/// reading the articles themselves.
+	std::unordered_map<std::string, std::vector<std::string>>
+	fetch_unread_guids();
+	/// Takes the reload times just measured into account; see
+	/// fetch_download_times().
+	void update_download_times(
+		const std::unordered_map<std::string, std::int64_t>& times);
+	/// Returns when each feed should be checked for updates next, keyed by
+	/// feed URL; see RefreshPolicy. Feeds without a time are left out.
+	std::unordered_map<std::string, time_t> fetch_next_checks();
+	void update_next_checks(const std::unordered_map<std::string, time_t>&
+		next_checks);
+	/// Returns how each feed has been failing to reload, keyed by feed URL.
+	/// Feeds that reloaded fine last time are left out.
+	std::unordered_map<std::string, FeedFailures> fetch_failures();
+	/// Stores the failures of the feeds in \a failures, replacing what was
+	/// there; a default FeedFailures marks the feed as working again.
+	void update_failures(const std::unordered_map<std::string, FeedFailures>&
+		failures);
+	/// Returns the average time between the latest articles of the feed,
+	/// in seconds, or 0 if it has less than two of them.
+	time_t estimate_update_interval(const std::string& feedurl);
 	void mark_item_deleted(const std::string& guid, bool b);
+	/// Like the above, but finds the article's row by its id if known.
+	void mark_item_deleted(const RssItem& item, bool b);
 	void remove_old_deleted_items(RssFeed* feed);
 	void mark_items_read_by_guid(const std::vector<std::string>& guids);
+	/// \brief Makes the articles of \a feedurls unread exactly if their
+	/// guid is one of \a unread_guids, in one transaction.
+	///
+	/// For a remote API that lists all the unread articles at once (see
+	/// RemoteApi::fetch_unread_guids()). Articles with a read state still
+	/// queued for the API (see queue_remote_read()) are left alone.
+	void sync_unread_by_guid(const std::vector<std::string>& feedurls,
+		const std::vector<std::string>& unread_guids);
 	std::vector<std::string> get_read_item_guids();
+	/// Calls \a callback with the guid of each read article, as they're
+	/// read from the cache, rather than collecting them all first.
+	void for_each_read_item_guid(
+		const std::function<void(const std::string&)>& callback);
+
+	/// Queues marking the article read or unread for the remote API,
+	/// replacing whatever it was to be marked before.
+	void queue_remote_read(const std::string& guid, bool read);
+	/// queue_remote_read() for each of \a guids, in one statement.
+	void queue_remote_reads(const std::vector<std::string>& guids, bool read);
+	/// Queues changing the article's flags for the remote API. If a change
+	/// is queued already, the API still gets \a oldflags from that one.
+	void queue_remote_flags(const std::string& guid,
+		const std::string& oldflags,
+		const std::string& flags);
+	/// Returns up to \a limit queued changes, oldest first.
+	std::vector<OutboxEntry> fetch_remote_outbox(unsigned int limit);
+	/// Takes the changes that were sent out of the queue. Whatever was
+	/// merged into them since they were fetched stays, to be sent next.
+	void remove_sent_outbox_entries(const std::vector<OutboxEntry>& entries);
+	/// Counts an attempt at sending the changes that the server turned
+	/// down, and drops the ones that were turned down \a max_attempts
+	/// times, telling the user.
+	void count_outbox_failures(const std::vector<OutboxEntry>& entries,
+		unsigned int max_attempts);
+
+	/// Replaces the list of feeds that the remote API \a source said the
+	/// account is subscribed to: each feed's URL and tags, in order.
+	void store_subscriptions(const std::string& source,
+		const std::vector<std::pair<std::string, std::vector<std::string>>>&
+		subscriptions);
+	/// The list that store_subscriptions() stored last for \a source, or
+	/// an empty one.
+	std::vector<std::pair<std::string, std::vector<std::string>>>
+	fetch_subscriptions(const std::string& source);
+	/// Keeps the answer to a conditional request for \a url, replacing the
+	/// one kept before.
+	void store_remote_response(const std::string& url,
+		const StoredResponse& response);
+	/// The answer store_remote_response() kept for \a url. Returns false
+	/// if there's none.
+	bool fetch_remote_response(const std::string& url,
+		StoredResponse& response);
+	/// Records the WebSub hub that feed \a rssurl announced, and the URL
+	/// \a topic the hub knows it by. An empty \a hub forgets the feed's.
+	void update_websub_hub(const std::string& rssurl,
+		const std::string& hub,
+		const std::string& topic);
+	/// The hub and topic update_websub_hub() recorded, keyed by feed URL.
+	std::unordered_map<std::string, std::pair<std::string, std::string>>
+	fetch_websub_hubs();
+	/// \brief The token that the last session left in the cache for its
+	/// startup snapshot (see FeedSnapshot), or an empty string.
+	///
+	/// The token is taken out of the cache when it's opened, so whatever
+	/// opens the cache after a snapshot was written makes the snapshot
+	/// stale, even if it doesn't write one.
+	const std::string& snapshot_token() const;
+	void set_snapshot_token(const std::string& token);
 	void fetch_descriptions(RssFeed* feed);
+	/// Reads the descriptions of the articles with the given guids. Articles
+	/// that aren't in the cache are left out.
+	std::unordered_map<std::string, Description> fetch_descriptions(
+		const std::vector<std::string>& guids);
 	std::string fetch_description(const RssItem& item);
+	/// The text of the article's content that filters match, see
+	/// content_text(). Reads it rather than the content where it's stored.
+	std::string fetch_content_text(const RssItem& item);
+
+	/// Adds up to `batch_size` articles that were stored before the search
+	/// index was introduced to that index. Returns false while there are
+	/// more articles left to index; until they're all in, searches fall
+	/// back to scanning the table.
+	bool index_items_for_search(unsigned int batch_size);
 
 private:
+	friend class ScopeTransaction;
+
+	void begin_transaction();
+	/// Commits the transaction, or the nested part of it, unless
+	/// \a commit is false; then rolls it back.
+	void end_transaction(bool commit);
+
+	/// A read-only connection to the cache file, used by UI queries so
+	/// they don't have to wait for the writer.
+	struct ReadConnection {
+		sqlite3* db;
+		StatementRegistry statements;
+		bool in_use;
+	};
+
+	/// Connection lent to a read-only query for the lifetime of the lease.
+	/// It's a free ReadConnection if there are any; otherwise (WAL is
+	/// disabled, or the calling thread has a transaction open and must see
+	/// its own writes) it's the main connection, with mtx held.
+	class ReadLease {
+	public:
+		explicit ReadLease(Cache& cache);
+		ReadLease(const ReadLease&) = delete;
+		ReadLease& operator=(const ReadLease&) = delete;
+		~ReadLease();
+
+		Statement prepare_statement(const std::string& sql);
+		/// The connection that prepare_statement() uses.
+		sqlite3* connection() const;
+
+	private:
+		Cache& cache;
+		ReadConnection* reader;
+		std::unique_lock<CacheMutex> lock;
+	};
+
+	/// \brief A set of strings in a temporary table of the main connection,
+	/// for as long as the object lives.
+	///
+	/// Queries check against it with `IN (SELECT value FROM temp.<table>)`
+	/// or join it, which uses the table's primary key; a literal list
+	/// of thousands of values would have to be parsed and planned first.
+	/// Needs mtx to be held.
+	class TempSet {
+	public:
+		/// Fills temp.\a table, creating it if needed, with \a values.
+		template<typename Values>
+		TempSet(Cache& cache, const std::string& table, const Values& values);
+		TempSet(const TempSet&) = delete;
+		TempSet& operator=(const TempSet&) = delete;
+		/// Empties the table again.
+		~TempSet();
+
+		/// `(SELECT value FROM temp.<table>)`, to use after `IN`.
+		std::string subquery() const;
+
+	private:
+		Cache& cache;
+		const std::string table;
+	};
+
+	void open_readers(const std::string& cachefile);
+	/// Waits until no ReadLease uses the readers, and closes them.
+	void close_readers();
+	/// An SQL condition, starting with "AND", that leaves out the items
+	/// that the rules of \a ign which Matcher can translate into SQL
+	/// ignore. Empty if there are no such rules.
+	std::string not_ignored_condition(RssIgnores& ign);
+	/// Sets up items that were just read into the feed, and applies
+	/// ignores, `max-items` and the sort order to them.
+	void finish_internalized_feed(const std::shared_ptr<RssFeed>& feed,
+		RssIgnores* ign);
+	/// \brief Creates the search index and the triggers that keep it up to
+	/// date, if SQLite can have it and it isn't there yet.
+	///
+	/// Where SQLite was built without FTS5, removes the triggers instead,
+	/// since they'd make storing articles fail; searches then scan the
+	/// articles.
+	void set_up_search_index();
+	void log_auto_vacuum_mode();
+	void log_page_size();
+	/// `cache-page-size`, or 0 if that's not a page size SQLite takes.
+	unsigned int configured_page_size();
+	unsigned int current_page_size();
+	/// The pragmas that set how much of the file each connection maps and
+	/// keeps in its page cache.
+	std::vector<std::string> memory_pragmas();
+	void load_content_dictionaries();
+	void train_content_dictionary();
+	/// Binds article content \a text, compressed if the user asked for it.
+	void bind_content(Statement& stmt, int index, const std::string& text);
+	/// Returns the id of the rss_content row holding \a text, adding one
+	/// if there's none yet.
+	int64_t store_content(const std::string& text);
+	void remove_orphaned_contents();
+	/// Compresses up to \a batch_size plain-text rows of \a table with
+	/// ids past \a up_to, and moves \a up_to past them. Returns the number
+	/// of rows looked at.
+	unsigned int compress_rows(const std::string& table, int64_t& up_to,
+		unsigned int batch_size);
+	bool use_search_index(const std::string& querystr) const;
+
 	SchemaVersion get_schema_version();
 	void populate_tables();
 	void set_pragmas();
 	void delete_item_unlocked(const std::shared_ptr<RssItem>& item);
+	void delete_item_unlocked(const std::string& guid);
 	void clean_old_articles();
-	void update_rssitem_unlocked(std::shared_ptr<RssItem> item,
+	/// Reads the snapshot token into opened_snapshot_token, and removes it
+	/// from the cache.
+	void take_snapshot_token();
+	/// \brief The id that `rss_item.feed_id` refers to the feed \a feedurl
+	/// by, or 0 if no article of it was ever stored.
+	///
+	/// Ids are looked up once and remembered.
+	std::int64_t find_feed_id(ReadLease& reader, const std::string& feedurl);
+	/// Like find_feed_id(), but gives \a feedurl an id if it has none yet.
+	/// Needs mtx to be held.
+	std::int64_t feed_id_unlocked(const std::string& feedurl);
+	/// Returns true if the item wasn't stored before. If \a changes isn't
+	/// null, the item is appended to it if it was added or changed.
+	bool update_rssitem_unlocked(std::shared_ptr<RssItem> item,
 		const std::string& feedurl,
-		bool reset_unread);
+		bool reset_unread,
+		ItemChanges* changes = nullptr);
+	/// Fills known_guids with the GUIDs of the stored articles, if it
+	/// wasn't filled yet or outgrew itself.
+	void load_known_guids();
+	void write_lastmodified_unlocked(const std::string& feedurl, time_t t,
+		const std::string& etag);
+	void write_body_hash_unlocked(const std::string& feedurl,
+		std::uint64_t hash);
+	void write_moved_url_unlocked(const std::string& feedurl,
+		const std::string& url, time_t since);
+
+	/// Returns a compiled statement for `sql`, compiling it on first use
+	/// and re-using it afterwards. Only meant for queries with a fixed
+	/// text; queries built on the fly should go through run_sql().
+	Statement prepare_statement(const std::string& sql);
 
 	std::string prepare_query(const std::string& format);
 	template<typename... Args>
@@ -111,7 +559,73 @@ private:
 
 	sqlite3* db;
 	ConfigContainer* cfg;
-	std::recursive_mutex mtx;
+	/// Guards `db` and `statements`; waits on it are recorded in the TraceLog
+	CacheMutex mtx;
+	StatementRegistry statements;
+	unsigned int transaction_depth;
+	std::atomic<std::thread::id> transaction_owner;
+	/// Whether there's a search index at all; set by set_up_search_index().
+	bool search_index_available;
+	std::atomic<bool> search_index_ready;
+	std::string opened_snapshot_token;
+
+	ContentCodec codec;
+	/// Dictionary that new articles are compressed against; 0 if none.
+	std::atomic<std::uint32_t> content_dictionary_id;
+	/// Rows of rss_item and rss_content up to these ids were already looked
+	/// at by compress_stored_content().
+	int64_t compressed_items_up_to;
+	int64_t compressed_contents_up_to;
+	/// Rows of rss_item up to this id were gone through by
+	/// split_stored_content().
+	int64_t split_items_up_to;
+
+	/// The GUIDs of the articles that are stored, and maybe a few that
+	/// were deleted since. Articles it doesn't know are new, so that
+	/// update_rssitem_unlocked() doesn't have to look for them. Articles
+	/// stored without going through it may be missing, which only costs
+	/// that look.
+	BloomFilter known_guids;
+	bool known_guids_loaded;
+
+	/// The ids of feed URLs that find_feed_id() and feed_id_unlocked()
+	/// looked up; forgotten if a transaction is rolled back, since that
+	/// takes back the ids it made.
+	std::mutex feed_ids_mtx;
+	std::unordered_map<std::string, std::int64_t> feed_ids;
+
+	/// What a conditional request for a feed sends, the hash of the
+	/// body it was last parsed from, and where the feed moved to
+	struct Validators {
+		Validators()
+			: lastmodified(0)
+			, body_hash(0)
+			, moved_since(0)
+		{
+		}
+		time_t lastmodified;
+		std::string etag;
+		std::uint64_t body_hash;
+		std::string moved_url;
+		time_t moved_since;
+	};
+	/// Guards everything below, instead of mtx
+	std::mutex validators_mtx;
+	/// Whether preload_validators() was called since flush_validators()
+	bool validators_preloaded;
+	/// Keyed by feed URL
+	std::unordered_map<std::string, Validators> preloaded_validators;
+	/// The updates that flush_validators() writes, keyed by feed URL. A
+	/// lastmodified of 0 or an empty etag is left as it's stored.
+	std::unordered_map<std::string, std::pair<time_t, std::string>>
+	pending_lastmodified;
+	std::unordered_map<std::string, std::uint64_t> pending_body_hashes;
+	std::unordered_map<std::string, std::pair<std::string, time_t>>
+	pending_moved_urls;
+
+	std::vector<std::unique_ptr<ReadConnection>> readers;
+	std::mutex readers_mtx;
+	std::condition_variable reader_released;
 };
 
 } // namespace newsboat
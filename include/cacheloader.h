@@ -0,0 +1,70 @@
+#ifndef NEWSBOAT_CACHELOADER_H_
+#define NEWSBOAT_CACHELOADER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+class Cache;
+class FeedSnapshot;
+class RssFeed;
+class RssIgnores;
+
+/// \brief Reads the feeds listed in the urls file from the cache at start up.
+///
+/// Normally all feeds are read with Cache::internalize_rssfeeds(), which
+/// makes a single pass over the cache instead of querying it per feed.
+///
+/// Lazily internalized feeds only need a small query each, so those are
+/// spread over several threads. With `cache-wal` enabled, each thread reads
+/// through its own connection.
+class CacheLoader {
+public:
+	/// Called after each loaded feed, from whichever thread loaded it.
+	/// Calls never overlap.
+	using ProgressCallback =
+		std::function<void(unsigned int loaded, unsigned int total)>;
+
+	/// \a ign is used to filter items, and may be null. If it is null and
+	/// \a lazy is set, feeds are internalized with
+	/// Cache::internalize_rssfeed_lazily() on \a num_threads threads.
+	CacheLoader(Cache& cache, RssIgnores* ign, unsigned int num_threads,
+		bool lazy = false);
+
+	/// When loading lazily, takes the feeds that \a snapshot has from it
+	/// instead of the cache. \a snapshot has to outlive load().
+	void use_snapshot(const FeedSnapshot* snapshot);
+
+	/// \brief Returns the feeds in the same order as \a urls.
+	///
+	/// If some feeds couldn't be loaded, rethrows the error of the first
+	/// of them once all threads are done; failed_url() then returns its
+	/// url.
+	std::vector<std::shared_ptr<RssFeed>> load(
+			const std::vector<std::string>& urls,
+			ProgressCallback progress = nullptr);
+
+	const std::string& failed_url() const;
+
+private:
+	std::vector<std::shared_ptr<RssFeed>> load_in_bulk(
+			const std::vector<std::string>& urls,
+			ProgressCallback progress);
+	std::vector<std::shared_ptr<RssFeed>> load_in_parallel(
+			const std::vector<std::string>& urls,
+			ProgressCallback progress);
+
+	Cache& cache;
+	RssIgnores* ign;
+	const unsigned int num_threads;
+	const bool lazy;
+	const FeedSnapshot* snapshot;
+	std::string failed;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CACHELOADER_H_ */
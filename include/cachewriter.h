@@ -0,0 +1,67 @@
+#ifndef NEWSBOAT_CACHEWRITER_H_
+#define NEWSBOAT_CACHEWRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace newsboat {
+
+class Cache;
+class RssFeed;
+
+/// A freshly downloaded feed that should replace its old version.
+struct FeedUpdate {
+	std::shared_ptr<RssFeed> oldfeed;
+	std::shared_ptr<RssFeed> newfeed;
+	unsigned int pos;
+	bool unattended;
+};
+
+/// \brief Background thread that writes reloaded feeds into the cache.
+///
+/// Reload workers push parsed feeds onto a bounded queue and go back to
+/// downloading; a single thread drains the queue and hands every update to
+/// the handler. All updates that are drained at once are written inside
+/// a single cache transaction.
+class CacheWriter {
+public:
+	using Handler = std::function<void(const FeedUpdate& update)>;
+
+	/// \a capacity is the number of updates that can be queued before push()
+	/// starts blocking.
+	CacheWriter(Cache& cache, Handler handler, std::size_t capacity);
+	CacheWriter(const CacheWriter&) = delete;
+	CacheWriter& operator=(const CacheWriter&) = delete;
+	~CacheWriter();
+
+	/// \brief Queues an update. Blocks while the queue is full.
+	void push(FeedUpdate update);
+
+	/// \brief Waits until all queued updates are written, then stops the
+	/// background thread. No updates can be pushed afterwards.
+	void finish();
+
+private:
+	void run();
+
+	Cache& cache;
+	Handler handler;
+	const std::size_t capacity;
+
+	std::mutex queue_mutex;
+	std::condition_variable queue_not_empty;
+	std::condition_variable queue_not_full;
+	std::deque<FeedUpdate> queue;
+	bool finished;
+
+	std::thread writer_thread;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CACHEWRITER_H_ */
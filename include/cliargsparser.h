@@ -4,6 +4,7 @@
 #include "libnewsboat-ffi/src/cliargsparser.rs.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "3rd-party/optional.hpp"
@@ -24,6 +25,10 @@ public:
 
 	bool do_cleanup() const;
 
+	/// If `true`, Newsboat should load the cache, print memory_stats() of
+	/// Controller and quit.
+	bool dump_memory_stats() const;
+
 	std::string importfile() const;
 
 	/// If non-null, Newsboat should import read articles info from this
@@ -79,6 +84,9 @@ public:
 
 	nonstd::optional<Level> log_level() const;
 
+	/// The loglevels given to particular modules with `--log-module`.
+	std::vector<std::pair<std::string, Level>> log_modules() const;
+
 	/// Returns the reference to the Rust object.
 	///
 	/// This is only meant to be used in situations when one wants to pass
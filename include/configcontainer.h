@@ -1,7 +1,10 @@
 #ifndef NEWSBOAT_CONFIGCONTAINER_H_
 #define NEWSBOAT_CONFIGCONTAINER_H_
 
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -56,6 +59,21 @@ struct ArticleSortStrategy {
 	}
 };
 
+enum class IgnoreMode { DOWNLOAD, DISPLAY };
+
+/// \brief The settings that are read for every feed or article, parsed once.
+///
+/// ConfigContainer publishes a new snapshot whenever one of them changes.
+struct ConfigSnapshot {
+	unsigned int max_items = 0;
+	unsigned int keep_articles_days = 0;
+	IgnoreMode ignore_mode = IgnoreMode::DOWNLOAD;
+	bool show_read_articles = true;
+	bool always_display_description = false;
+	bool download_full_page = false;
+	std::string datetime_format;
+};
+
 class ConfigContainer : public ConfigActionHandler {
 public:
 	ConfigContainer();
@@ -75,11 +93,41 @@ public:
 	FeedSortStrategy get_feed_sort_strategy() const;
 	ArticleSortStrategy get_article_sort_strategy() const;
 
+	/// \brief The current values of the settings in ConfigSnapshot.
+	///
+	/// Reading it takes no lock. Snapshots that were replaced are kept
+	/// until the container is destroyed, so the reference stays valid even
+	/// while the settings change; they only change at the user's request,
+	/// so there are few of them.
+	const ConfigSnapshot& snapshot() const
+	{
+		return *current_snapshot.load(std::memory_order_acquire);
+	}
+
+	/// \brief Has \a listener called with the name of every setting that
+	/// changes from now on, e.g. by `set` or `source`.
+	///
+	/// It's called with the container locked, so it should only take note
+	/// of the change.
+	void on_change(std::function<void(const std::string& key)> listener);
+
 	static const std::string PARTIAL_FILE_SUFFIX;
 
 private:
+	/// Publishes a new snapshot if needed, and tells the listeners.
+	/// Has to be called with config_data_mtx held.
+	void changed(const std::string& key);
+	/// Publishes a new ConfigSnapshot if \a key is one of its settings.
+	/// Has to be called with config_data_mtx held.
+	void update_snapshot(const std::string& key);
+	void publish_snapshot();
+
 	std::map<std::string, ConfigData> config_data;
 	mutable std::recursive_mutex config_data_mtx;
+
+	std::vector<std::unique_ptr<const ConfigSnapshot>> snapshots;
+	std::atomic<const ConfigSnapshot*> current_snapshot;
+	std::vector<std::function<void(const std::string&)>> change_listeners;
 };
 
 } // namespace newsboat
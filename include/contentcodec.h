@@ -0,0 +1,63 @@
+#ifndef NEWSBOAT_CONTENTCODEC_H_
+#define NEWSBOAT_CONTENTCODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Compresses article contents for storage in the cache.
+///
+/// Contents are deflated, optionally against a preset dictionary built from
+/// other articles by train_dictionary(). Short articles barely compress on
+/// their own, but most of a feed's markup repeats from one article to the
+/// next, and that's what the dictionary captures.
+///
+/// Compressed data starts with a small header: a format byte, the id of the
+/// dictionary (0 if none was used), and the length of the original text in
+/// bytes and in characters.
+class ContentCodec {
+public:
+	/// Makes dictionary \a data known under \a id, which must not be 0.
+	void add_dictionary(std::uint32_t id, const std::string& data);
+	bool has_dictionary(std::uint32_t id) const;
+
+	/// Compresses \a text against dictionary \a dictionary_id, or without
+	/// a dictionary if it's 0 or unknown.
+	std::string compress(const std::string& text,
+		std::uint32_t dictionary_id = 0) const;
+	/// Returns the text that compress() was given. Throws
+	/// std::runtime_error if \a data is corrupt, or was compressed against
+	/// a dictionary that isn't known.
+	std::string decompress(const void* data, std::size_t size) const;
+
+	/// Returns the length of the text compressed into \a data, or 0 if
+	/// \a data doesn't look like the output of compress().
+	static std::size_t decompressed_size(const void* data, std::size_t size);
+	/// Like decompressed_size(), but counts UTF-8 characters instead of
+	/// bytes.
+	static std::size_t decompressed_length(const void* data,
+		std::size_t size);
+
+	/// \brief Builds a dictionary of at most \a max_size bytes out of the
+	/// text that's common to several of \a samples.
+	///
+	/// Returns an empty string if the samples have nothing in common.
+	static std::string train_dictionary(const std::vector<std::string>& samples,
+		std::size_t max_size);
+
+private:
+	std::shared_ptr<const std::string> dictionary(std::uint32_t id) const;
+
+	mutable std::mutex mtx;
+	std::map<std::uint32_t, std::shared_ptr<const std::string>> dictionaries;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CONTENTCODEC_H_ */
@@ -0,0 +1,20 @@
+#ifndef NEWSBOAT_CONTENTTEXT_H_
+#define NEWSBOAT_CONTENTTEXT_H_
+
+#include <string>
+
+namespace newsboat {
+
+/// \brief The text of an article's content, as filters and searches match
+/// it.
+///
+/// Content of an HTML \a mime_type, which an empty one is taken as, has its
+/// markup stripped and its entities decoded; scripts and style sheets are
+/// left out, and block-level tags separate the text around them by a space.
+/// Content of other types is returned as it is.
+std::string content_text(const std::string& content,
+	const std::string& mime_type);
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CONTENTTEXT_H_ */
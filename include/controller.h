@@ -3,6 +3,8 @@
 
 #include <libxml/tree.h>
 
+#include "3rd-party/json.hpp"
+
 #include "cache.h"
 #include "colormanager.h"
 #include "configcontainer.h"
@@ -10,11 +12,13 @@
 #include "feedcontainer.h"
 #include "filtercontainer.h"
 #include "fslock.h"
+#include "itemchangelog.h"
 #include "opml.h"
 #include "queuemanager.h"
 #include "regexmanager.h"
 #include "reloader.h"
 #include "remoteapi.h"
+#include "remoteoutbox.h"
 #include "rssignores.h"
 #include "urlreader.h"
 
@@ -22,8 +26,14 @@ namespace newsboat {
 
 class CliArgsParser;
 class ConfigPaths;
+class JobProgress;
 class View;
 
+struct UnreadCounts {
+	unsigned int feeds;
+	unsigned int articles;
+};
+
 class Controller {
 public:
 	Controller(ConfigPaths& configpaths);
@@ -35,9 +45,15 @@ public:
 	}
 	int run(const CliArgsParser& args);
 
+	/// \brief Searches the cache for \a query, in \a feed or in all of them
+	/// if that's nullptr.
+	///
+	/// Returns nothing once \a progress is cancelled; see
+	/// View::run_job().
 	std::vector<std::shared_ptr<RssItem>> search_for_items(
 			const std::string& query,
-			std::shared_ptr<RssFeed> feed);
+			std::shared_ptr<RssFeed> feed,
+			const JobProgress* progress = nullptr);
 
 	void update_feedlist();
 	void update_visible_feeds();
@@ -53,6 +69,32 @@ public:
 	{
 		return refresh_on_start;
 	}
+	/// Whether the remote API's feeds were taken from the cache at startup
+	/// and are yet to be asked for; see RemoteApi::subscriptions().
+	bool subscriptions_were_cached() const
+	{
+		return api != nullptr && api->subscriptions_were_cached();
+	}
+	/// How many feeds have unread articles, and how many unread articles
+	/// there are in the feeds that aren't hidden. Asks the cache if the
+	/// feeds are stubs.
+	UnreadCounts unread_counts();
+	/// RuntimeStats::snapshot(), with what the caches of articles hold, and
+	/// memory_stats().
+	nlohmann::json runtime_stats();
+	/// \brief Bytes held by each part of Newsboat that keeps articles or
+	/// lines around, next to the resident size of the process.
+	///
+	/// The buffers of libxml2 and curl only live while feeds are reloaded,
+	/// and aren't counted; they're part of what's left of the resident size.
+	nlohmann::json memory_stats();
+	/// Whether the feeds only have their URLs, tags and order, because
+	/// Newsboat was started to reload them and nothing else. Their articles
+	/// are then written to the cache, but not read from it.
+	bool feeds_are_stubs() const
+	{
+		return stub_feeds;
+	}
 	EnqueueResult enqueue_url(std::shared_ptr<RssItem> item,
 		std::shared_ptr<RssFeed> feed);
 
@@ -82,11 +124,21 @@ public:
 		return reloader.get();
 	}
 
-	void replace_feed(std::shared_ptr<RssFeed> oldfeed,
+	/// Stores \a newfeed, and puts what's stored in \a oldfeed's place.
+	/// Returns how many articles weren't stored before. What happened to
+	/// the articles is published to item_changes().
+	unsigned int replace_feed(std::shared_ptr<RssFeed> oldfeed,
 		std::shared_ptr<RssFeed> newfeed,
 		unsigned int pos,
 		bool unattended);
 
+	/// What each reload added to the articles, changed of them, or marked
+	/// read or unread.
+	ItemChangeLog& item_changes()
+	{
+		return item_change_log;
+	}
+
 	ConfigContainer* get_config()
 	{
 		return &cfg;
@@ -122,14 +174,36 @@ private:
 	void export_opml();
 	void rec_find_rss_outlines(xmlNode* node, std::string tag);
 	int execute_commands(const std::vector<std::string>& cmds);
+	/// search_for_items(), which throws if the query is interrupted.
+	std::vector<std::shared_ptr<RssItem>> search_cache(
+			const std::string& query,
+			std::shared_ptr<RssFeed> feed,
+			const JobProgress* progress);
 
+	/// Asks the remote API which articles are unread, and marks the cached
+	/// articles accordingly; see RemoteApi::fetch_unread_guids().
+	void sync_unread_state();
 	void import_read_information(const std::string& readinfofile);
 	void export_read_information(const std::string& readinfofile);
+	/// Writes what the next lazy start up reads from the cache to a
+	/// FeedSnapshot, once the cache has been cleaned up.
+	void write_snapshot();
+	/// \brief Starts `newsboat --cleanup` with our files, in a session of
+	/// its own, so that quitting doesn't wait for the cleanup.
+	///
+	/// It waits for our lock, and other instances wait for it. Returns
+	/// false if it couldn't be started; the cache has to be cleaned up in
+	/// the foreground then.
+	bool start_background_cleanup(const std::string& program_name);
+	/// With `podcast-auto-enqueue`, enqueues the enclosures of the articles
+	/// that \a changes added or changed.
+	void autoenqueue(const ItemChanges& changes);
 
 	View* v;
 	UrlReader* urlcfg;
 	Cache* rsscache;
 	bool refresh_on_start;
+	bool stub_feeds;
 	ConfigContainer cfg;
 	RssIgnores ign;
 	FeedContainer feedcontainer;
@@ -139,6 +213,8 @@ private:
 	ColorManager colorman;
 	RegexManager rxman;
 	RemoteApi* api;
+	/// What tells api about read articles and flags, once there is one
+	std::unique_ptr<RemoteOutbox> outbox;
 
 	FsLock fslock;
 
@@ -147,6 +223,7 @@ private:
 	std::unique_ptr<Reloader> reloader;
 
 	QueueManager queueManager;
+	ItemChangeLog item_change_log;
 };
 
 } // namespace newsboat
@@ -0,0 +1,65 @@
+#ifndef NEWSBOAT_CONTROLSOCKET_H_
+#define NEWSBOAT_CONTROLSOCKET_H_
+
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief A Unix domain socket through which other processes send
+/// commands, one line each, to a running Newsboat.
+///
+/// Each connection carries a single command; the answer is whatever is
+/// written back before the connection is closed. Answers don't have to be
+/// given right away: a client waits until reply() is called for it.
+class ControlSocket {
+public:
+	struct Request {
+		/// What reply() answers
+		int client;
+		std::string command;
+	};
+
+	/// Listens at \a path, replacing whatever socket is there; the caller
+	/// makes sure no other process listens there, e.g. with an FsLock.
+	/// Throws std::runtime_error if that's impossible.
+	explicit ControlSocket(const std::string& path);
+	ControlSocket(const ControlSocket&) = delete;
+	ControlSocket& operator=(const ControlSocket&) = delete;
+	/// Hangs up on the clients that are still waiting, and removes the
+	/// socket.
+	~ControlSocket();
+
+	/// Waits up to \a timeout_ms milliseconds for new connections and for
+	/// their commands, and returns the commands that arrived complete.
+	std::vector<Request> poll(int timeout_ms);
+	/// Sends \a answer to the client that sent \a request, and hangs up.
+	void reply(const Request& request, const std::string& answer);
+
+	/// Sends \a command to the process listening at \a path, and waits for
+	/// the answer. Returns false if nobody listens there, or no answer
+	/// came.
+	static bool send(const std::string& path, const std::string& command,
+		std::string& answer);
+
+private:
+	struct Client {
+		int fd;
+		std::string received;
+		/// Whether the command arrived, and only the answer is left to do
+		bool complete;
+	};
+
+	void accept_clients();
+	/// Returns false once the client hung up or sent nonsense.
+	bool read_from(Client& client, std::vector<Request>& requests);
+	void drop(int fd);
+
+	std::string path;
+	int listen_fd;
+	std::vector<Client> clients;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CONTROLSOCKET_H_ */
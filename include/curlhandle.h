@@ -3,6 +3,9 @@
 
 #include <curl/curl.h>
 #include <stdexcept>
+#include <string>
+
+#include "curlshare.h"
 
 namespace newsboat {
 
@@ -11,6 +14,7 @@ namespace newsboat {
 class CurlHandle {
 private:
 	CURL* h;
+	CurlShare* shared;
 	CurlHandle(const CurlHandle&) = delete;
 	CurlHandle& operator=(const CurlHandle&) = delete;
 
@@ -24,6 +28,7 @@ private:
 public:
 	CurlHandle()
 		: h(curl_easy_init())
+		, shared(nullptr)
 	{
 		if (!h) {
 			throw std::runtime_error("Can't obtain curl handle");
@@ -35,6 +40,7 @@ public:
 	}
 	CurlHandle(CurlHandle&& other)
 		: h(other.h)
+		, shared(other.shared)
 	{
 		other.h = nullptr;
 	}
@@ -42,10 +48,43 @@ public:
 	{
 		cleanup();
 		h = other.h;
+		shared = other.shared;
 		other.h = nullptr;
 		return *this;
 	}
 
+	/// Makes this handle use \a share from now on, even across reset().
+	/// \a share has to outlive the handle.
+	void set_share(CurlShare& share)
+	{
+		shared = &share;
+		curl_easy_setopt(h, CURLOPT_SHARE, shared->ptr());
+	}
+
+	/// Resets all options, like curl_easy_reset(), except for the share.
+	void reset()
+	{
+		curl_easy_reset(h);
+		if (shared != nullptr) {
+			curl_easy_setopt(h, CURLOPT_SHARE, shared->ptr());
+		}
+	}
+
+	/// \brief Turns on the cookie engine, keeping cookies in
+	/// \a cookie_file.
+	///
+	/// If the handle's share keeps cookies, they're kept there instead,
+	/// and the file is left to the share to read and write.
+	void use_cookies(const std::string& cookie_file)
+	{
+		if (shared != nullptr && shared->keeps_cookies()) {
+			curl_easy_setopt(h, CURLOPT_COOKIEFILE, "");
+		} else {
+			curl_easy_setopt(h, CURLOPT_COOKIEFILE, cookie_file.c_str());
+			curl_easy_setopt(h, CURLOPT_COOKIEJAR, cookie_file.c_str());
+		}
+	}
+
 	CURL* ptr()
 	{
 		return h;
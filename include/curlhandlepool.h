@@ -0,0 +1,76 @@
+#ifndef NEWSBOAT_CURLHANDLEPOOL_H_
+#define NEWSBOAT_CURLHANDLEPOOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "curlhandle.h"
+#include "curlshare.h"
+
+namespace newsboat {
+
+/// \brief Keeps curl handles around between requests, so that the
+/// connections and TLS sessions they set up are used again.
+///
+/// The remote APIs talk to the same server over and over: to log in, to
+/// fetch the feeds, to mark articles read. With a fresh handle for each
+/// request, every one of them opened its own connection. Handles taken
+/// from a pool keep their connections alive while they're idle, and all
+/// of them share DNS lookups, TLS sessions and connections through a
+/// CurlShare. Safe to use from several threads at once.
+class CurlHandlePool {
+public:
+	/// \brief A handle taken from the pool, which gets it back when this
+	/// goes away.
+	class Lease {
+	public:
+		Lease(Lease&& other);
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+		~Lease();
+
+		CurlHandle& operator*() const
+		{
+			return *handle;
+		}
+		CurlHandle* operator->() const
+		{
+			return handle.get();
+		}
+
+	private:
+		friend class CurlHandlePool;
+		Lease(CurlHandlePool& pool, std::unique_ptr<CurlHandle> handle);
+
+		CurlHandlePool* pool;
+		std::unique_ptr<CurlHandle> handle;
+	};
+
+	/// Keeps up to \a max_idle handles around while they aren't used.
+	explicit CurlHandlePool(std::size_t max_idle = 4);
+	CurlHandlePool(const CurlHandlePool&) = delete;
+	CurlHandlePool& operator=(const CurlHandlePool&) = delete;
+	/// All leases must be gone by now.
+	~CurlHandlePool() = default;
+
+	/// Hands out an idle handle, or a new one if there's none. Its options
+	/// are all at their defaults, like those of a new handle.
+	Lease acquire();
+
+	std::size_t idle_count();
+
+private:
+	void give_back(std::unique_ptr<CurlHandle> handle);
+
+	// Declared before the handles, so that it outlives them
+	CurlShare share;
+	const std::size_t max_idle;
+	std::mutex mtx;
+	std::vector<std::unique_ptr<CurlHandle>> idle;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CURLHANDLEPOOL_H_ */
@@ -0,0 +1,105 @@
+#ifndef NEWSBOAT_CURLSHARE_H_
+#define NEWSBOAT_CURLSHARE_H_
+
+#include <atomic>
+#include <ctime>
+#include <curl/curl.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Lets several curl handles share their DNS cache, TLS sessions,
+/// connections and cookies, even if they're used from different threads.
+///
+/// Feeds often live on the same few hosts. Handles that share this don't
+/// have to look a host up, or negotiate TLS with it, again for every feed.
+/// With load() and save(), that carries over to the next run, too.
+class CurlShare {
+public:
+	CurlShare();
+	CurlShare(const CurlShare&) = delete;
+	CurlShare& operator=(const CurlShare&) = delete;
+	/// All handles using this must be gone by now.
+	~CurlShare();
+
+	CURLSH* ptr()
+	{
+		return share;
+	}
+
+	/// \brief Reads the addresses of hosts and the TLS sessions that save()
+	/// wrote to \a path, except for the ones that expired.
+	///
+	/// A missing or broken file is ignored; the hosts are just looked up
+	/// again. Should be called once, before the handles are used.
+	void load(const std::string& path);
+	/// \brief Writes the addresses that remember_address() noted, the ones
+	/// load() read that are still valid, and the TLS sessions curl kept, to
+	/// \a path. Returns false if it couldn't.
+	///
+	/// Only the user can read the file, since the sessions let whoever has
+	/// them resume them.
+	bool save(const std::string& path);
+
+	/// \brief Notes the address the last transfer of \a handle connected
+	/// to, for save(). It's used for an hour.
+	///
+	/// Mustn't be called for transfers that went through a proxy, since
+	/// the address is the proxy's then.
+	void remember_address(CURL* handle);
+	/// \brief Makes \a handle connect to the address load() read for the
+	/// host of \a url, if there is one, rather than looking the host up.
+	///
+	/// Has to be called once the rest of the handle's options are set,
+	/// since CurlHandle::reset() undoes it.
+	void use_saved_address(CURL* handle, const std::string& url);
+
+	/// \brief Reads the cookies in \a path into the ones the handles share,
+	/// and has save_cookies() write them back there.
+	///
+	/// From then on, handles that use this keep their cookies here rather
+	/// than reading and writing the file themselves; see keeps_cookies().
+	/// A missing file is ignored.
+	void load_cookies(const std::string& path);
+	/// Writes the shared cookies to the file load_cookies() read them from,
+	/// if it was called.
+	void save_cookies();
+	/// Whether load_cookies() was called
+	bool keeps_cookies() const
+	{
+		return cookies_kept;
+	}
+
+private:
+	static void lock(CURL* handle, curl_lock_data data,
+		curl_lock_access access, void* userptr);
+	static void unlock(CURL* handle, curl_lock_data data, void* userptr);
+
+	struct Address {
+		long port;
+		std::string address;
+		time_t expires;
+	};
+
+	CURLSH* share;
+	std::mutex mutexes[CURL_LOCK_DATA_LAST];
+
+	std::mutex addresses_mutex;
+	/// Keyed by host name
+	std::unordered_map<std::string, std::vector<Address>> addresses;
+	/// The CURLOPT_RESOLVE lists of the addresses load() read, keyed by
+	/// host name. The handles they're given to point at them.
+	std::unordered_map<std::string, curl_slist*> resolve_lists;
+
+	/// Held while the cookies are read or written
+	std::mutex cookie_mutex;
+	std::string cookie_file;
+	std::atomic<bool> cookies_kept;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_CURLSHARE_H_ */
@@ -0,0 +1,47 @@
+#ifndef NEWSBOAT_DATEFORMATCACHE_H_
+#define NEWSBOAT_DATEFORMATCACHE_H_
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+
+namespace newsboat {
+
+/// \brief Remembers timestamps formatted by utils::mt_strf_localtime().
+///
+/// Most of the articles in a list share their date with others as soon as
+/// the format doesn't show seconds, and a list formats the same articles
+/// over and over again as it's redrawn. Timestamps are looked up truncated
+/// to the finest unit that the format shows, so e.g. with "%b %d" all the
+/// articles from the same minute share one entry.
+///
+/// Not thread-safe; each list keeps a cache of its own.
+class DateFormatCache {
+public:
+	/// A \a max_entries of 0 means there's no limit.
+	explicit DateFormatCache(std::size_t max_entries = 4096);
+
+	/// Returns the same as utils::mt_strf_localtime(format, t). Forgets
+	/// everything that was formatted with a different format.
+	const std::string& format(const std::string& format, time_t t);
+
+	std::size_t size() const;
+
+	/// Returns the number of seconds that \a format can't tell apart: 1 if
+	/// it shows seconds, 60 otherwise.
+	///
+	/// Formats without a time of day could do with more, but local days
+	/// and hours don't start at a whole multiple of those in UTC everywhere.
+	static time_t resolution_of(const std::string& format);
+
+private:
+	std::size_t max_entries;
+	std::string current_format;
+	time_t resolution;
+	std::unordered_map<time_t, std::string> formatted;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_DATEFORMATCACHE_H_ */
@@ -0,0 +1,80 @@
+#ifndef NEWSBOAT_DESCRIPTIONLRU_H_
+#define NEWSBOAT_DESCRIPTIONLRU_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "3rd-party/optional.hpp"
+
+#include "rssitem.h"
+
+namespace newsboat {
+
+/// \brief Holds the descriptions that articles read from the cache, up to a
+/// total size.
+///
+/// When the descriptions grow past that size, the ones used least recently
+/// are dropped; their articles read them from the cache again when they're
+/// needed.
+class DescriptionLru {
+public:
+	struct Stats {
+		std::uint64_t hits;
+		std::uint64_t misses;
+		std::uint64_t evictions;
+		std::size_t entries;
+		std::size_t bytes;
+	};
+
+	/// A \a max_bytes of 0 means there's no limit.
+	explicit DescriptionLru(std::size_t max_bytes);
+	DescriptionLru(const DescriptionLru&) = delete;
+	DescriptionLru& operator=(const DescriptionLru&) = delete;
+
+	/// The instance that RssItems keep their descriptions in. Its limit is
+	/// set from `description-memory-limit` at start up.
+	static DescriptionLru& shared();
+
+	void set_max_bytes(std::size_t limit);
+
+	/// Returns the description of \a item and marks it as the most recently
+	/// used one.
+	nonstd::optional<Description> get(const RssItem* item);
+	/// Unlike get(), this doesn't count towards the statistics.
+	bool contains(const RssItem* item) const;
+	void put(const RssItem* item, const Description& description);
+	/// Keeps \a text as the plain text of the description of \a item, if
+	/// that's still there.
+	void set_plain_text(const RssItem* item,
+		std::shared_ptr<const std::string> text);
+	void erase(const RssItem* item);
+
+	Stats stats() const;
+
+private:
+	struct Entry {
+		const RssItem* item;
+		Description description;
+	};
+
+	static std::size_t size_of(const Description& description);
+	void evict_unlocked();
+
+	mutable std::mutex mtx;
+	std::size_t max_bytes;
+	std::size_t bytes;
+	std::uint64_t hits;
+	std::uint64_t misses;
+	std::uint64_t evictions;
+	/// Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<const RssItem*, std::list<Entry>::iterator> index;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_DESCRIPTIONLRU_H_ */
@@ -0,0 +1,51 @@
+#ifndef NEWSBOAT_DESCRIPTIONPREFETCHER_H_
+#define NEWSBOAT_DESCRIPTIONPREFETCHER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace newsboat {
+
+class Cache;
+class RssItem;
+
+/// \brief Reads article descriptions from the cache on a background thread.
+///
+/// Article lists ask for the descriptions of the items around the cursor, so
+/// that opening one of them doesn't have to wait for the cache. With
+/// `cache-wal` enabled, the reads don't even have to wait for a reload
+/// that's writing to the cache.
+class DescriptionPrefetcher {
+public:
+	/// Doesn't read anything if \a cache is nullptr.
+	explicit DescriptionPrefetcher(Cache* cache);
+	DescriptionPrefetcher(const DescriptionPrefetcher&) = delete;
+	DescriptionPrefetcher& operator=(const DescriptionPrefetcher&) = delete;
+	/// Waits for the batch that's being read, and drops the rest.
+	~DescriptionPrefetcher();
+
+	/// \brief Reads the descriptions of \a items that aren't loaded yet, in
+	/// order.
+	///
+	/// Replaces whatever is left of the previous request, since the user
+	/// has moved on from those items.
+	void prefetch(const std::vector<std::shared_ptr<RssItem>>& items);
+
+private:
+	void run();
+
+	Cache* cache;
+	std::mutex mtx;
+	std::condition_variable wakeup;
+	std::deque<std::shared_ptr<RssItem>> pending;
+	bool stopping;
+	std::thread worker;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_DESCRIPTIONPREFETCHER_H_ */
@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_DIRBROWSERFORMACTION_H
 #define NEWSBOAT_DIRBROWSERFORMACTION_H
 
+#include <cstdint>
 #include <sys/stat.h>
 #include <grp.h>
 
@@ -32,10 +33,19 @@ private:
 		std::vector<std::string>* args = nullptr) override;
 	void update_title(const std::string& working_directory);
 
-	void add_directory(ListFormatter& listfmt,
-		std::vector<file_system::FileSystemEntry>& id_at_position,
-		std::string dirname);
+	/// Hands STFL the lines around the cursor, describing the directories
+	/// in them first if that wasn't done yet.
+	void draw_directories();
+	/// lstat()s the directory at \a pos the first time it's asked for,
+	/// and returns its line in the list.
+	const std::string& describe_directory(std::uint32_t pos);
+	/// The directories in the current directory, in the order they're
+	/// listed. Their type is Unknown until describe_directory() looked at
+	/// them.
 	std::vector<file_system::FileSystemEntry> id_at_position;
+	/// The lines describe_directory() made, by position; empty where it
+	/// hasn't been yet
+	std::vector<std::string> directory_lines;
 
 	std::string get_formatted_dirname(std::string dirname, mode_t mode);
 
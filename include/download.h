@@ -1,6 +1,7 @@
 #ifndef PODBOAT_DOWNLOAD_H_
 #define PODBOAT_DOWNLOAD_H_
 
+#include <atomic>
 #include <functional>
 #include <string>
 
@@ -19,15 +20,22 @@ enum class DlStatus {
 	RENAME_FAILED
 };
 
+/// \brief A single entry of Podboat's queue.
+///
+/// The progress and the status are written by the download manager's
+/// thread and read by the UI, so they're atomic; the UI picks them up as it
+/// redraws, which keeps the downloads from forcing a redraw on every chunk.
 class Download {
 public:
 	explicit Download(std::function<void()> cb_require_view_update);
+	Download(const Download& other);
+	Download& operator=(const Download& other);
 	~Download();
 	double percents_finished() const;
 	const std::string status_text() const;
 	DlStatus status() const
 	{
-		return download_status;
+		return download_status.load();
 	}
 	const std::string& status_msg() const
 	{
@@ -46,22 +54,22 @@ public:
 
 	double current_size() const
 	{
-		return cursize + offs;
+		return cursize.load() + offs.load();
 	}
 	double total_size() const
 	{
-		return totalsize + offs;
+		return totalsize.load() + offs.load();
 	}
 
 private:
 	std::string fn;
 	std::string url_;
-	DlStatus download_status;
+	std::atomic<DlStatus> download_status;
 	std::string msg;
-	double cursize;
-	double totalsize;
-	double curkbps;
-	unsigned long offs;
+	std::atomic<double> cursize;
+	std::atomic<double> totalsize;
+	std::atomic<double> curkbps;
+	std::atomic<unsigned long> offs;
 	std::function<void()> cb_require_view_update;
 };
 
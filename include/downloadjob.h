@@ -0,0 +1,147 @@
+#ifndef PODBOAT_DOWNLOADJOB_H_
+#define PODBOAT_DOWNLOADJOB_H_
+
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "configcontainer.h"
+#include "curlhandle.h"
+#include "download.h"
+#include "downloadsegments.h"
+#include "filewriter.h"
+
+namespace podboat {
+
+class BandwidthLimiter;
+
+/// \brief The transfers that make up a single Download, for a
+/// DownloadManager to perform.
+///
+/// The job sets up easy handles, and the manager adds them to its multi
+/// handle, tells the job when each is done, and calls tick() regularly
+/// while it runs. Everything is called on the manager's I/O thread; the
+/// job reports its progress and its outcome in the Download.
+///
+/// A download goes through a single stream, which resumes a partial file
+/// with a Range request, or, with `download-segments`, in parallel Range
+/// requests; see DownloadSegments.
+class DownloadJob {
+public:
+	DownloadJob(Download& dl, newsboat::ConfigContainer& cfg,
+		BandwidthLimiter& limiter);
+	DownloadJob(const DownloadJob&) = delete;
+	DownloadJob& operator=(const DownloadJob&) = delete;
+	~DownloadJob();
+
+	/// The first transfers to perform.
+	std::vector<CURL*> start();
+	/// \a handle is done with \a result, and was removed from the multi
+	/// handle. Returns the transfers to perform next, if any.
+	std::vector<CURL*> transfer_done(CURL* handle, CURLcode result);
+	/// Updates the progress. Returns false once the download was
+	/// cancelled; the manager then removes its transfers and calls
+	/// abort().
+	bool tick();
+	/// Wraps up after the transfers were removed before they were done.
+	void abort();
+	/// Whether the outcome is known, and no transfers are left.
+	bool done() const
+	{
+		return phase == Phase::DONE;
+	}
+
+	Download& download()
+	{
+		return dl;
+	}
+
+	size_t write_stream(void* buffer, size_t length);
+	/// Notes the progress of the single stream, which tick() passes on to
+	/// the Download. Returns non-zero once the download was cancelled.
+	int progress(double dlnow, double dltotal);
+
+	/// Appended to the name of the partial file for the state of a
+	/// segmented download.
+	static const std::string SEGMENTS_SUFFIX;
+
+private:
+	enum class Phase {
+		PROBING,
+		STREAMING,
+		SEGMENTED,
+		DONE
+	};
+
+	/// The transfer of one segment, for its write callback
+	struct SegmentTransfer {
+		DownloadJob* job;
+		newsboat::CurlHandle handle;
+		DownloadSegments::Segment* segment;
+		/// What arrived after the end of segment->done, and isn't written
+		/// yet
+		std::vector<char> pending;
+	};
+
+	static size_t write_segment_data(void* buffer, size_t size, size_t nmemb,
+		void* userp);
+	size_t write_segment(void* buffer, size_t length,
+		SegmentTransfer& transfer);
+	/// Writes out what \a transfer collected; returns false on errors.
+	bool flush_segment(SegmentTransfer& transfer);
+	bool flush_segments();
+	/// Sets up a handle with what every transfer of the download needs.
+	void set_up_handle(newsboat::CurlHandle& handle, unsigned int transfers);
+	/// \brief Starts downloading through a single stream, resuming the
+	/// partial file if there is one.
+	std::vector<CURL*> start_stream();
+	/// Asks the server for the size of the file with a Range request for
+	/// its first byte, to find out whether it can hand out parts of it.
+	std::vector<CURL*> start_probe();
+	/// The size of the file, from the answer to the probe; 0 if the
+	/// server doesn't honour ranges.
+	std::uint64_t probed_size(CURLcode result);
+	/// Starts a transfer for each segment of a file of \a size bytes that
+	/// isn't complete; falls back to a single stream if it can't be split.
+	std::vector<CURL*> start_segments(std::uint64_t size);
+	std::vector<CURL*> stream_done(CURLcode result);
+	void segments_done();
+	/// Moves the partial file to its final name.
+	void finish();
+	/// Passes the progress and the speed on to the Download.
+	void report_progress();
+
+	Download& dl;
+	newsboat::ConfigContainer& cfg;
+	BandwidthLimiter& limiter;
+	Phase phase;
+	/// The partial file
+	std::string filename;
+
+	std::unique_ptr<newsboat::CurlHandle> single;
+	std::vector<std::string> probe_headers;
+	FileWriter file;
+	/// Whether room for the rest of the file was asked for yet
+	bool reserved;
+	bool resumed_download;
+
+	DownloadSegments segments;
+	std::vector<std::unique_ptr<SegmentTransfer>> transfers;
+	int fd;
+	unsigned int segments_running;
+	CURLcode segments_result;
+	std::chrono::steady_clock::time_point last_save;
+
+	std::chrono::time_point<std::chrono::steady_clock> tv1;
+	size_t bytecount;
+	double stream_now;
+	double stream_total;
+	std::chrono::steady_clock::time_point last_report;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_DOWNLOADJOB_H_ */
@@ -0,0 +1,112 @@
+#ifndef PODBOAT_DOWNLOADMANAGER_H_
+#define PODBOAT_DOWNLOADMANAGER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <curl/curl.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bandwidthlimiter.h"
+#include "configcontainer.h"
+#include "download.h"
+#include "speedschedule.h"
+
+namespace podboat {
+
+class DownloadJob;
+
+/// \brief Performs Podboat's downloads on a single I/O thread, through
+/// curl's multi interface.
+///
+/// Downloads that are queued wait until fewer than `max-downloads` are
+/// running, and fewer than `max-downloads-per-host` from the same server;
+/// those with a higher priority go first. Downloads started by hand don't
+/// wait, but count against the limits. `max-total-download-speed`, or the
+/// SpeedSchedule for the time of day, caps the bandwidth all of them take
+/// together. How each download goes shows in its Download, which the
+/// thread updates.
+class DownloadManager {
+public:
+	DownloadManager(newsboat::ConfigContainer& cfg,
+		const SpeedSchedule& schedule);
+	DownloadManager(const DownloadManager&) = delete;
+	DownloadManager& operator=(const DownloadManager&) = delete;
+	/// Stops the thread. Running downloads are interrupted, and keep their
+	/// partial files for later; their Downloads aren't touched anymore.
+	~DownloadManager();
+
+	/// Queues \a dl, unless it already is; if it is, it gets the higher of
+	/// the two priorities. Downloads that aren't QUEUED anymore when their
+	/// turn comes are skipped.
+	void enqueue(Download& dl, int priority = 0);
+	/// Starts \a dl right away, regardless of the limits, unless it's
+	/// being downloaded already.
+	void start_now(Download& dl);
+	/// Forgets about the queued downloads, e.g. before their Download
+	/// objects go away. Running downloads aren't affected.
+	void clear_queue();
+
+	void set_max_downloads(unsigned int max);
+
+private:
+	struct Queued {
+		Download* dl;
+		int priority;
+		bool now;
+	};
+
+	struct Running {
+		std::unique_ptr<DownloadJob> job;
+		std::string host;
+	};
+
+	void run();
+	/// Starts the queued downloads that the limits allow, in order.
+	void start_queued_unlocked();
+	void start_job(Download& dl, const std::string& host);
+	void add_transfers(DownloadJob& job, const std::vector<CURL*>& handles);
+	void complete_transfers();
+	/// Lets the jobs update their progress, and drops those that were
+	/// cancelled or are done.
+	void tick_jobs();
+	/// Removes the transfers of \a job that are still running.
+	void remove_transfers(DownloadJob& job);
+	/// Follows the schedule, once a second at most.
+	void update_speed_limit();
+	void wait_for_activity();
+	void wake_up_unlocked();
+
+	newsboat::ConfigContainer& cfg;
+	const SpeedSchedule& schedule;
+	CURLM* multi;
+
+	std::mutex mtx;
+	std::condition_variable queue_changed;
+	std::deque<Queued> queued;
+	unsigned int max_downloads;
+	unsigned int max_per_host;
+	bool stopping;
+
+	/// Only used by the thread
+	BandwidthLimiter limiter;
+	/// The limit outside of the schedule, in bytes per second
+	std::uint64_t default_limit;
+	std::uint64_t current_limit;
+	BandwidthLimiter::Clock::time_point next_limit_check;
+	std::vector<Running> jobs;
+	std::unordered_map<CURL*, DownloadJob*> owners;
+	/// How many downloads run from each host, by utils::host_of()
+	std::unordered_map<std::string, unsigned int> hosts;
+
+	std::thread worker;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_DOWNLOADMANAGER_H_ */
@@ -0,0 +1,53 @@
+#ifndef PODBOAT_DOWNLOADSEGMENTS_H_
+#define PODBOAT_DOWNLOADSEGMENTS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace podboat {
+
+/// \brief How a download that's fetched in parallel Range requests is
+/// split up, and how far each of the segments got.
+///
+/// The state is kept in a file next to the partial download, so that an
+/// interrupted download picks up where each segment stopped.
+class DownloadSegments {
+public:
+	/// A range of the file, from \a start up to, but not including,
+	/// \a end; the first \a done bytes of it are written.
+	struct Segment {
+		std::uint64_t start;
+		std::uint64_t end;
+		std::uint64_t done;
+	};
+
+	DownloadSegments();
+
+	/// Splits a file of \a size bytes into \a count segments of about the
+	/// same size, none of them smaller than \a min_segment bytes.
+	static DownloadSegments split(std::uint64_t size, unsigned int count,
+		std::uint64_t min_segment);
+
+	/// Reads the state stored in \a path. Returns false if there's none,
+	/// or it doesn't describe a file of \a expected_size bytes.
+	bool load(const std::string& path, std::uint64_t expected_size);
+	/// Stores the state in \a path, replacing it atomically.
+	bool save(const std::string& path) const;
+
+	std::uint64_t size() const
+	{
+		return total;
+	}
+	std::uint64_t downloaded() const;
+	bool complete() const;
+
+	std::vector<Segment> segments;
+
+private:
+	std::uint64_t total;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_DOWNLOADSEGMENTS_H_ */
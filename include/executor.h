@@ -0,0 +1,92 @@
+#ifndef NEWSBOAT_EXECUTOR_H_
+#define NEWSBOAT_EXECUTOR_H_
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace newsboat {
+
+/// \brief The threads that background work runs on, shared by all of it.
+///
+/// There are two pools: one for work that mostly waits for the network,
+/// and one for work that keeps a core busy. A pool starts its threads as
+/// jobs come in, up to its limit, and keeps them until the program exits,
+/// so that jobs don't start threads of their own. Jobs run in the order
+/// of their priority, and in the order they were submitted within the
+/// same priority.
+class Executor {
+public:
+	enum class Pool {
+		/// Reloads, and requests to remote APIs
+		IO,
+		/// Matching, sorting, loading and rendering
+		CPU,
+	};
+
+	enum class Priority {
+		/// Something the user is waiting for
+		HIGH,
+		NORMAL,
+		/// Housekeeping that can wait for everything else
+		LOW,
+	};
+
+	using Job = std::function<void()>;
+
+	/// The one executor of the program; it's never destroyed, so that
+	/// jobs can still be running while the program exits.
+	static Executor& instance();
+
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	/// \brief Sets the most threads that \a pool runs jobs on at once.
+	///
+	/// If there are more already, the extra ones stop once they're done
+	/// with their current jobs.
+	void set_max_threads(Pool pool, unsigned int threads);
+	unsigned int max_threads(Pool pool);
+
+	/// \brief Queues \a job to run on a thread of \a pool.
+	///
+	/// Nobody waits for \a job; anything it throws is logged and dropped.
+	void submit(Pool pool, Priority priority, Job job);
+
+	/// \brief Runs \a worker on the calling thread and on up to \a threads
+	/// - 1 threads of \a pool at once, and returns once all of them have
+	/// returned.
+	///
+	/// Meant for workers that take their share of the work from a common
+	/// queue until it's empty. The copies of \a worker that haven't started
+	/// by the time the calling thread's copy returns are skipped, so this
+	/// never waits for a pool that is busy, even when it's called from one
+	/// of the pool's own threads. \a worker shouldn't throw.
+	void run_workers(Pool pool, Priority priority, unsigned int threads,
+		const Job& worker);
+
+private:
+	struct Queue {
+		std::mutex mtx;
+		std::condition_variable not_empty;
+		/// One queue per Priority, highest first
+		std::array<std::deque<Job>, 3> jobs;
+		std::size_t pending = 0;
+		unsigned int max_threads = 1;
+		unsigned int threads = 0;
+		unsigned int idle = 0;
+	};
+
+	Executor();
+
+	Queue& queue(Pool pool);
+	void run(Queue& q);
+
+	std::array<Queue, 2> queues;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_EXECUTOR_H_ */
@@ -4,17 +4,24 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "configcontainer.h"
+#include "rssfeed.h"
+#include "tagindex.h"
+#include "titleindex.h"
 
 namespace newsboat {
 
-class RssFeed;
-
 class FeedContainer {
 public:
+	/// A version of the list of feeds, which doesn't change once it's made
+	using FeedList = std::vector<std::shared_ptr<RssFeed>>;
+
 	FeedContainer() = default;
+	~FeedContainer();
 
 	void sort_feeds(const FeedSortStrategy& sort_strategy);
 	std::shared_ptr<RssFeed> get_feed(const unsigned int pos);
@@ -36,13 +43,50 @@ public:
 	void reset_feeds_status();
 	void set_feeds(const std::vector<std::shared_ptr<RssFeed>> new_feeds);
 	std::vector<std::shared_ptr<RssFeed>> get_all_feeds() const;
+	/// \brief Returns the current list of feeds, without locking or copying
+	/// it.
+	///
+	/// Changes to the list make a new version, so this one stays as it is
+	/// for as long as the caller holds it.
+	std::shared_ptr<const FeedList> get_feeds_snapshot() const;
 	unsigned int unread_feed_count() const;
 	unsigned int unread_item_count() const;
+	/// \brief Returns the loaded articles whose title or author contains
+	/// \a query, which is UTF-8, without going to the cache.
+	///
+	/// See TitleIndex::search().
+	std::vector<std::shared_ptr<RssItem>> search_titles(
+		const std::string& query) const;
 
 	void replace_feed(unsigned int pos, std::shared_ptr<RssFeed> feed);
+	/// \brief Returns the URLs of the feeds that replace_feed() was called
+	/// for since the last call, so that query feeds can be updated for
+	/// just those.
+	std::unordered_set<std::string> take_replaced_feedurls();
 
 private:
-	std::vector<std::shared_ptr<RssFeed>> feeds;
+	/// Makes \a feed report to unread_guids, tag_index and title_index, or
+	/// stop.
+	void attach(const std::shared_ptr<RssFeed>& feed);
+	void detach(const std::shared_ptr<RssFeed>& feed);
+	/// Rebuilds feed_positions, with feeds_mutex held.
+	void index_feed_urls();
+	/// Makes feeds the current snapshot, with feeds_mutex held.
+	void publish_feeds();
+
+	/// What the changes are made to; readers use snapshot
+	FeedList feeds;
+	/// Only read and written with std::atomic_load() and std::atomic_store()
+	std::shared_ptr<const FeedList> snapshot = std::make_shared<const FeedList>();
+	/// The position in feeds of the first feed with each URL
+	std::unordered_map<std::string, std::size_t> feed_positions;
+	std::unordered_set<std::string> replaced_feedurls;
+	/// What unread_item_count() returns the size of; the feeds report to it
+	UnreadGuids unread_guids;
+	/// What the counts per tag come from
+	TagIndex tag_index;
+	/// What search_titles() looks in
+	TitleIndex title_index;
 	mutable std::mutex feeds_mutex;
 };
 } // namespace newsboat
@@ -1,9 +1,15 @@
 #ifndef NEWSBOAT_FEEDLISTFORMACTION_H_
 #define NEWSBOAT_FEEDLISTFORMACTION_H_
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "3rd-party/optional.hpp"
 
 #include "configcontainer.h"
+#include "fmtstrformatter.h"
 #include "history.h"
 #include "listformaction.h"
 #include "matcher.h"
@@ -25,6 +31,9 @@ public:
 	~FeedListFormAction() override;
 	void prepare() override;
 	void init() override;
+	/// While the search prompt is open, the matches in the titles and
+	/// authors of the loaded articles are shown as the query is typed.
+	unsigned int wait_time() const override;
 	void set_feedlist(std::vector<std::shared_ptr<RssFeed>>& feeds);
 	void update_visible_feeds(std::vector<std::shared_ptr<RssFeed>>& feeds);
 	const std::vector<KeyMapHintEntry>& get_keymap_hint() const override;
@@ -48,6 +57,10 @@ public:
 
 	void mark_pos_if_visible(unsigned int pos);
 
+	/// The feeds on the screen, along with those a screen or so above and
+	/// below it, since how far the list is scrolled isn't known here.
+	std::vector<std::shared_ptr<RssFeed>> feeds_on_screen();
+
 private:
 	void register_format_styles();
 
@@ -69,6 +82,10 @@ private:
 
 	void op_end_setfilter();
 	void op_start_search();
+	/// Shows how many articles match what's been typed into the search
+	/// prompt so far in place of the hints, or puts the hints back once the
+	/// prompt is closed.
+	void show_live_search_results();
 
 	void handle_cmdline_num(unsigned int idx);
 	void handle_tag(const std::string& params);
@@ -77,18 +94,64 @@ private:
 
 	std::string get_title(std::shared_ptr<RssFeed> feed);
 
-	std::string format_line(const std::string& feedlist_format,
+	std::string format_line(const FmtStrTemplate& feedlist_format,
 		std::shared_ptr<RssFeed> feed,
 		unsigned int pos,
 		unsigned int width);
 
+	/// Hands the lines of visible_feeds to the list, or only those around
+	/// the cursor with `feedlist-viewport-only`. Expects redraw_mtx to be
+	/// locked.
+	void draw_feeds();
+	/// Returns the line of \a feed, formatting it only if something that it
+	/// shows has changed since the last time.
+	const std::string& feed_line(const FeedPtrPosPair& feed,
+		unsigned int width);
+
+	/// A line of the list, and what it was formatted from.
+	struct FormattedFeed {
+		unsigned int pos;
+		std::uint64_t revision;
+		unsigned int unread;
+		unsigned int total;
+		std::string line;
+	};
+	/// The lines of the feeds that were visible at the last set_feedlist(),
+	/// all formatted with formatted_feeds_format and formatted_feeds_width.
+	std::unordered_map<std::shared_ptr<RssFeed>, FormattedFeed> formatted_feeds;
+	/// `feedlist-format`, parsed once for all the lines.
+	FmtStrTemplate formatted_feeds_format;
+	unsigned int formatted_feeds_width;
+
+	/// set_feedlist() is called by the reloader, while prepare() might be
+	/// moving the window of `feedlist-viewport-only`.
+	std::mutex redraw_mtx;
+
 	bool zero_feedpos;
 	std::vector<FeedPtrPosPair> visible_feeds;
 	std::string tag;
 
 	Matcher matcher;
 	bool filter_active;
+	/// Changes whenever the filter does, so that filter_matches can tell
+	/// which filter a result is for.
+	unsigned int filter_version;
 	void apply_filter(const std::string& filter_query);
+	/// Whether \a feed matches the filter, evaluating it only if the feed
+	/// has changed since the last time.
+	bool matches_filter(const std::shared_ptr<RssFeed>& feed);
+
+	/// What the filter said about a feed, and what it was evaluated on.
+	struct FilterMatch {
+		unsigned int filter_version;
+		std::uint64_t revision;
+		unsigned int unread;
+		unsigned int total;
+		bool matches;
+	};
+	/// The filter results of the feeds, as of the last
+	/// update_visible_feeds() that had a filter active.
+	std::unordered_map<std::shared_ptr<RssFeed>, FilterMatch> filter_matches;
 
 	History filterhistory;
 
@@ -102,6 +165,11 @@ private:
 	nonstd::optional<FeedSortStrategy> old_sort_strategy;
 
 	Cache* cache;
+
+	/// Whether the search prompt is open, and what was in it the last time
+	/// show_live_search_results() looked
+	bool live_search;
+	std::string live_search_query;
 };
 
 } // namespace newsboat
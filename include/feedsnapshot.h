@@ -0,0 +1,77 @@
+#ifndef NEWSBOAT_FEEDSNAPSHOT_H_
+#define NEWSBOAT_FEEDSNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace newsboat {
+
+class Cache;
+class RssFeed;
+
+/// \brief What a lazy start up (`lazy-load-articles`) reads from the cache,
+/// in a file written on quit: each feed's title, link and direction, and a
+/// summary of each of its articles.
+///
+/// The file is mapped into memory and read in place, so making the feeds
+/// from it takes no queries. A snapshot is only used if it was written for
+/// the token that Cache::snapshot_token() returns; the cache forgets that
+/// token whenever it's opened, so a snapshot is good for one start, and
+/// not after anything else used the cache in between.
+class FeedSnapshot {
+public:
+	/// Maps the snapshot at \a path; valid() tells if it is a well-formed
+	/// one that was written for \a token.
+	FeedSnapshot(const std::string& path, const std::string& token);
+	FeedSnapshot(const FeedSnapshot&) = delete;
+	FeedSnapshot& operator=(const FeedSnapshot&) = delete;
+	~FeedSnapshot();
+
+	bool valid() const
+	{
+		return valid_;
+	}
+
+	/// \brief Makes the lazily loaded feed \a url, like
+	/// Cache::internalize_rssfeed_lazily() would. Returns null if the
+	/// snapshot doesn't have it.
+	///
+	/// The summaries are trimmed with Cache::trim_item_summaries().
+	std::shared_ptr<RssFeed> make_feed(Cache& cache, const std::string& url) const;
+
+	/// \brief Writes the snapshot of \a feeds for \a token to \a path.
+	///
+	/// Query feeds are left out, as they are made from the other feeds.
+	/// The file is written next to \a path and renamed over it, so a
+	/// snapshot is never read half-written. Returns false if that failed.
+	static bool write(const std::string& path, const std::string& token,
+		const std::vector<std::shared_ptr<RssFeed>>& feeds);
+
+private:
+	/// Checks the header and every record, and fills feed_index.
+	bool check(const std::string& token);
+	std::uint32_t read_u32(std::size_t offset) const;
+	std::uint64_t read_u64(std::size_t offset) const;
+	/// Reads the reference to the strings at \a offset, and checks it
+	/// points into them.
+	bool read_string(std::size_t offset, std::string& out) const;
+
+	const char* data;
+	std::size_t size;
+	bool valid_;
+	std::uint32_t feed_count;
+	std::uint64_t item_count;
+	std::size_t items_start;
+	std::size_t strings_start;
+	std::size_t strings_size;
+	/// Which record has each feed's url
+	std::unordered_map<std::string, std::uint32_t> feed_index;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_FEEDSNAPSHOT_H_ */
@@ -0,0 +1,40 @@
+#ifndef NEWSBOAT_FETCHGROUPS_H_
+#define NEWSBOAT_FETCHGROUPS_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Groups the feeds of a reload that are fetched from the same
+/// place, so that each place is only fetched once.
+///
+/// Feeds are the same if their URLs only differ in what a server doesn't
+/// tell apart: the scheme, the case of the host, the default port, a
+/// trailing slash, the fragment and tracking parameters. The feed that's
+/// fetched for a group is its first one over HTTPS, or else its first one.
+class FetchGroups {
+public:
+	/// \a locations are the URLs the feeds are fetched from; empty for a
+	/// feed that can't be shared.
+	explicit FetchGroups(const std::vector<std::string>& locations);
+
+	/// Returns the indexes of the feeds that get what the feed at \a i
+	/// fetches; empty if there are none, or if \a i is one of them.
+	const std::vector<std::size_t>& followers(std::size_t i) const;
+	/// Whether the feed at \a i gets what another feed fetches.
+	bool is_follower(std::size_t i) const;
+
+	/// \brief Returns what two URLs of the same feed have in common, or an
+	/// empty string if \a url isn't HTTP.
+	static std::string canonical_url(const std::string& url);
+
+private:
+	std::vector<std::vector<std::size_t>> groups;
+	std::vector<bool> follower;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_FETCHGROUPS_H_ */
@@ -0,0 +1,73 @@
+#ifndef NEWSBOAT_FETCHRESULTS_H_
+#define NEWSBOAT_FETCHRESULTS_H_
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+class Cache;
+class RssFeed;
+
+/// \brief Feeds that fetch workers reloaded, exchanged with the coordinator
+/// through the directory set in `fetch-results-dir`.
+///
+/// A worker is an instance with `fetch-shard` set. It reloads only the
+/// feeds whose URL hashes into its shard, and after each reload writes the
+/// ones that changed to a file of its own in the directory, a line of JSON
+/// each with the parsed feed and its validators. Feeds that didn't change
+/// aren't written at all. The coordinator reloads by applying those files
+/// in the order they were written, and removes them. How the directory is
+/// shared between the machines (a network file system, rsync etc.) is up
+/// to the user.
+class FetchResults {
+public:
+	/// What a worker sent for a feed.
+	struct Result {
+		std::shared_ptr<RssFeed> feed;
+		time_t lastmodified = 0;
+		std::string etag;
+	};
+
+	explicit FetchResults(const std::string& dir);
+
+	/// \brief Reads a `fetch-shard` setting, "<index>/<count>" with the
+	/// index counting from 1.
+	///
+	/// Returns false if \a spec isn't like that.
+	static bool parse_shard(const std::string& spec, unsigned int& index,
+		unsigned int& count);
+	/// Whether the feed at \a url is reloaded by worker \a index of \a count.
+	static bool in_shard(const std::string& url, unsigned int index,
+		unsigned int count);
+
+	/// Adds \a feed, which was just parsed, to what write() writes.
+	/// Thread-safe.
+	void add(RssFeed& feed, time_t lastmodified, const std::string& etag);
+	/// \brief Writes what was added since the last call for the
+	/// coordinator, if anything. \a shard tells the worker's files apart.
+	///
+	/// Returns false if that failed; what was added is dropped either way.
+	bool write(const std::string& shard);
+
+	/// The files the workers wrote, oldest first.
+	std::vector<std::string> list_files() const;
+	/// \brief Reads the feeds in the file at \a path, making their articles
+	/// with \a cache.
+	///
+	/// Lines that can't be read are skipped.
+	static std::vector<Result> read(const std::string& path, Cache* cache);
+
+private:
+	std::string dir;
+	std::mutex mtx;
+	/// The lines added since the last write()
+	std::string lines;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_FETCHRESULTS_H_ */
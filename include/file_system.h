@@ -3,6 +3,7 @@
 
 #include <string>
 #include <sys/stat.h>
+#include <vector>
 
 #include "3rd-party/optional.hpp"
 
@@ -49,6 +50,16 @@ std::string get_group_padded(gid_t gid);
 /// Convert permissions into an rwxrwxrwx-style string.
 std::string permissions_string(mode_t mode);
 
+/// \brief The names in directory \a path, sorted, without "." and "..".
+///
+/// Only reads the directory itself, so it's quick even for big ones. With
+/// \a only_directories, leaves out everything that isn't a directory (not
+/// following symlinks); that needs an lstat() only for the entries the file
+/// system doesn't say the type of. Returns an empty list if the directory
+/// can't be read.
+std::vector<std::string> list_directory(const std::string& path,
+	bool only_directories);
+
 } // namespace file_system
 
 } // namespace newsboat
@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_FILEBROWSERFORMACTION_H_
 #define NEWSBOAT_FILEBROWSERFORMACTION_H_
 
+#include <cstdint>
 #include <sys/stat.h>
 #include <grp.h>
 
@@ -37,11 +38,19 @@ private:
 		std::vector<std::string>* args = nullptr) override;
 	void update_title(const std::string& working_directory);
 
-	void add_file(ListFormatter& listfmt,
-		std::vector<file_system::FileSystemEntry>& id_at_position,
-		std::string filename);
+	/// Hands STFL the lines around the cursor, describing the files in
+	/// them first if that wasn't done yet.
+	void draw_files();
+	/// lstat()s the file at \a pos the first time it's asked for, and
+	/// returns its line in the list.
+	const std::string& describe_file(std::uint32_t pos);
 	std::string get_filename_suggestion(const std::string& s);
+	/// The files in the current directory, in the order they're listed.
+	/// Their type is Unknown until describe_file() looked at them.
 	std::vector<file_system::FileSystemEntry> id_at_position;
+	/// The lines describe_file() made, by position; empty where it hasn't
+	/// been yet
+	std::vector<std::string> file_lines;
 
 	std::string get_formatted_filename(std::string filename, mode_t mode);
 
@@ -0,0 +1,49 @@
+#ifndef NEWSBOAT_FILESTAMP_H_
+#define NEWSBOAT_FILESTAMP_H_
+
+#include <cstdint>
+#include <string>
+
+namespace newsboat {
+
+/// \brief What tells one version of a file from another without reading
+/// it: its inode, size and times of modification.
+///
+/// Lets a reader skip a file that didn't change since it last looked.
+/// All files that don't exist have the same stamp, which is also the one
+/// a default-constructed FileStamp has.
+class FileStamp {
+public:
+	FileStamp() = default;
+
+	static FileStamp of(const std::string& path);
+
+	bool exists() const
+	{
+		return found;
+	}
+	std::uint64_t size() const
+	{
+		return bytes;
+	}
+
+	bool operator==(const FileStamp& other) const;
+	bool operator!=(const FileStamp& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	bool found = false;
+	std::uint64_t device = 0;
+	std::uint64_t inode = 0;
+	std::uint64_t bytes = 0;
+	std::int64_t mtime_sec = 0;
+	long mtime_nsec = 0;
+	std::int64_t ctime_sec = 0;
+	long ctime_nsec = 0;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_FILESTAMP_H_ */
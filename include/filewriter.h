@@ -0,0 +1,78 @@
+#ifndef PODBOAT_FILEWRITER_H_
+#define PODBOAT_FILEWRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace podboat {
+
+/// \brief Writes a download to disk in large blocks.
+///
+/// curl hands out the data in chunks of 16 KB or so; the writer collects
+/// them and writes a megabyte at a time, as few system calls as it takes.
+/// Full buffers are written on a thread of the executor's IO pool while the
+/// next one fills up, so that a slow disk doesn't hold up the thread that
+/// runs the transfers. A write that failed there is reported by the next
+/// call that has to wait for it. Methods that fail leave the reason in
+/// `errno`.
+class FileWriter {
+public:
+	/// Bytes collected before they are written, a multiple of the page size
+	static const std::size_t BUFFER_SIZE;
+
+	FileWriter();
+	FileWriter(const FileWriter&) = delete;
+	FileWriter& operator=(const FileWriter&) = delete;
+	/// Writes what's left, without syncing.
+	~FileWriter();
+
+	/// Creates \a path, truncating it, or appends to it.
+	bool open(const std::string& path, bool append);
+	bool is_open() const
+	{
+		return fd != -1;
+	}
+
+	/// Asks the filesystem to set aside room for \a bytes more, so that the
+	/// file doesn't get fragmented as it grows. The size of the file stays
+	/// as it is, so that an interrupted download can resume from it.
+	/// Where that's not supported, nothing happens.
+	void reserve(std::uint64_t bytes);
+
+	bool write(const char* data, std::size_t length);
+
+	/// Writes what's left and closes the file; with \a sync, waits until
+	/// it's on the disk.
+	bool close(bool sync);
+
+private:
+	/// Hands what's in the buffer over to be written, once the previous
+	/// write is done.
+	bool flush();
+	/// Waits until the write that flush() started, if any, is done.
+	bool wait_for_write();
+	bool write_all(const char* data, std::size_t length);
+
+	int fd;
+	std::vector<char> buffer;
+	std::size_t used;
+	/// The size of the file, counting what's in the buffers
+	std::uint64_t size;
+
+	/// The buffer that's being written, or the spare one
+	std::vector<char> writing;
+	std::size_t writing_used;
+	std::mutex write_mtx;
+	std::condition_variable write_done;
+	bool write_pending;
+	/// The errno of the write that failed, or 0
+	int write_error;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_FILEWRITER_H_ */
@@ -7,6 +7,30 @@
 
 namespace newsboat {
 
+/// \brief A format string that's parsed once, to be formatted many times by
+/// FmtStrFormatter::do_format().
+///
+/// Lists format every one of their lines with the same string, so they keep
+/// a template instead of having the string re-parsed for each line.
+class FmtStrTemplate {
+public:
+	FmtStrTemplate();
+	explicit FmtStrTemplate(const std::string& fmt);
+	FmtStrTemplate(FmtStrTemplate&&) = default;
+	FmtStrTemplate& operator=(FmtStrTemplate&&) = default;
+	~FmtStrTemplate() = default;
+
+	/// Parses \a fmt, unless it's the string that's already parsed.
+	void set_format(const std::string& fmt);
+	const std::string& get_format() const;
+
+private:
+	friend class FmtStrFormatter;
+
+	std::string format;
+	rust::Box<fmtstrformatter::bridged::FormatTemplate> rs_object;
+};
+
 class FmtStrFormatter {
 public:
 	FmtStrFormatter();
@@ -15,6 +39,8 @@ public:
 	~FmtStrFormatter() = default;
 	void register_fmt(char f, const std::string& value);
 	std::string do_format(const std::string& fmt, unsigned int width = 0);
+	std::string do_format(const FmtStrTemplate& tmpl,
+		unsigned int width = 0) const;
 
 private:
 	rust::Box<fmtstrformatter::bridged::FmtStrFormatter> rs_object;
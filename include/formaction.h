@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_FORMACTION_H_
 #define NEWSBOAT_FORMACTION_H_
 
+#include <climits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,6 +27,8 @@ enum class CommandType {
 	SET,
 	SOURCE,
 	DUMPCONFIG,
+	PROFILE,
+	STATS,
 	EXEC,
 	UNKNOWN,	/// Unknown/non-existing command. Tokenized input is stored in Command.args
 	INVALID, 	/// differs from UNKNOWN in that no input was parsed
@@ -46,6 +49,15 @@ public:
 	{
 		do_redraw = b;
 	}
+	/// \brief How long View::run() waits for a key before it calls prepare()
+	/// again, in milliseconds.
+	///
+	/// Dialogs that show something that is still being worked on in the
+	/// background wait less than forever.
+	virtual unsigned int wait_time() const
+	{
+		return INT_MAX;
+	}
 
 	virtual const std::vector<KeyMapHintEntry>& get_keymap_hint() const = 0;
 
@@ -133,6 +145,8 @@ private:
 	void handle_quit();
 	void handle_source(const std::vector<std::string>& args);
 	void handle_dumpconfig(const std::vector<std::string>& args);
+	void handle_profile(const std::vector<std::string>& args);
+	void handle_stats(const std::vector<std::string>& args);
 	void handle_exec(const std::vector<std::string>& args);
 
 	std::vector<QnaPair> qna_prompts;
@@ -1,7 +1,14 @@
 #ifndef NEWSBOAT_FRESHRSSAPI_H_
 #define NEWSBOAT_FRESHRSSAPI_H_
 
+#include <ctime>
+#include <functional>
 #include <libxml/tree.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "cache.h"
 #include "remoteapi.h"
@@ -24,13 +31,31 @@ public:
 	void add_custom_headers(curl_slist** custom_headers) override;
 	bool mark_all_read(const std::string& feedurl) override;
 	bool mark_article_read(const std::string& guid, bool read) override;
+	bool mark_articles_read(const std::vector<std::string>& guids) override;
 	bool update_article_flags(const std::string& oldflags,
 		const std::string& newflags,
 		const std::string& guid) override;
 	rsspp::Feed fetch_feed(const std::string& id);
 	rsspp::Feed fetch_feed(const std::string& id, CurlHandle& cached_handle);
 
+	/// With freshrss-single-stream, pulls everything that came in since
+	/// the last reload from the reading list, in a few requests, and has
+	/// fetch_feed() hand it out instead of asking for each feed.
+	void begin_reload() override;
+	void end_reload() override;
+	bool fetch_unread_guids(std::vector<std::string>& guids) override;
+
 private:
+	std::string stream_id_of(const std::string& feedurl);
+	/// Fetches a stream, calling \a on_entry with each of its items as
+	/// it's parsed; if \a continuation is given, it's set to where the
+	/// next page of the stream starts, or to "" if this was the last one.
+	/// \a list is the key of the items in the answer.
+	bool fetch_items(const std::string& url, CurlHandle& handle,
+		const std::function<void(nlohmann::json& entry)>& on_entry,
+		std::string* continuation = nullptr,
+		const std::string& list = "items");
+	bool sync_reading_list(time_t since);
 	std::vector<std::string> get_tags(xmlNode* node);
 	std::string get_new_token();
 	bool refresh_token();
@@ -46,6 +71,20 @@ private:
 	std::string auth_header;
 	bool token_expired;
 	std::string token;
+
+	/// Guards everything below, which the reload's parsers share.
+	std::mutex sync_mtx;
+	/// Streams of the subscribed feeds, as get_subscribed_urls() saw them.
+	std::set<std::string> subscribed_streams;
+	/// Articles pulled from the reading list that no reload has taken yet,
+	/// by the stream of their feed.
+	std::unordered_map<std::string, std::vector<rsspp::Item>> synced_items;
+	/// Whether the current reload pulled the reading list.
+	bool synced;
+	/// When the newest article seen was crawled by the server; the next
+	/// pull of the reading list starts there. 0 until a reload fetched
+	/// the feeds one by one.
+	time_t newest_crawl_time;
 };
 
 } // namespace newsboat
@@ -0,0 +1,69 @@
+#ifndef NEWSBOAT_GUIDINDEX_H_
+#define NEWSBOAT_GUIDINDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+class RssItem;
+
+/// \brief Finds articles by guid through their positions in a vector.
+///
+/// It's an open-addressing table of 64-bit guid hashes and positions, so
+/// the guids are only kept by the articles, and looking one up doesn't
+/// allocate. A hash that matches is checked against the article's guid.
+///
+/// Positions change when the articles are sorted or erased; the owner
+/// calls invalidate() then, and the table is built again by the next
+/// find(). Of the articles that share a guid, the last one is found.
+class GuidIndex {
+public:
+	using Items = std::vector<std::shared_ptr<RssItem>>;
+
+	static const std::size_t npos = static_cast<std::size_t>(-1);
+
+	/// Indexes the article at \a pos of \a items, which was just appended.
+	void add(const Items& items, std::size_t pos);
+
+	/// Forgets the positions.
+	void invalidate();
+
+	/// Returns the position of the article with \a guid in \a items, or
+	/// npos if there's none.
+	std::size_t find(const Items& items, const std::string& guid);
+
+	/// Number of distinct guids indexed.
+	std::size_t size() const
+	{
+		return used;
+	}
+	/// Memory taken up by the table.
+	std::size_t bytes() const
+	{
+		return slots.capacity() * sizeof(Slot);
+	}
+
+private:
+	struct Slot {
+		std::uint64_t hash;
+		std::uint32_t pos;
+	};
+	static const std::uint32_t EMPTY = static_cast<std::uint32_t>(-1);
+
+	static std::uint64_t hash_of(const std::string& guid);
+
+	void rebuild(const Items& items);
+	void insert(const Items& items, std::uint64_t hash, std::uint32_t pos);
+	void grow();
+
+	std::vector<Slot> slots;
+	std::size_t used = 0;
+	bool stale = false;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_GUIDINDEX_H_ */
@@ -1,9 +1,10 @@
 #ifndef NEWSBOAT_HTMLRENDERER_H_
 #define NEWSBOAT_HTMLRENDERER_H_
 
+#include <cstddef>
 #include <istream>
-#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "textformatter.h"
@@ -59,7 +60,10 @@ typedef std::pair<std::string, LinkType> LinkPair;
 
 class HtmlRenderer {
 public:
-	explicit HtmlRenderer(bool raw = false);
+	/// \brief Lines of table cells wider than \a max_table_cell_width are
+	/// wrapped; 0 leaves them as they are.
+	explicit HtmlRenderer(bool raw = false,
+		std::size_t max_table_cell_width = 0);
 	void render(const std::string& source,
 		std::vector<std::pair<LineType, std::string>>& lines,
 		std::vector<LinkPair>& links,
@@ -75,10 +79,15 @@ public:
 	struct TableCell {
 		explicit TableCell(size_t s)
 			: span(s)
+			, width(0)
 		{
 		}
 		size_t span;
 		std::vector<std::string> text; // multiline cell text
+		/// Display width of each line of text, measured as it's added
+		std::vector<size_t> widths;
+		/// The widest of widths
+		size_t width;
 	};
 
 	struct TableRow {
@@ -87,7 +96,9 @@ public:
 		{
 		}
 
-		void add_text(const std::string& str);
+		/// Adds \a str as a line of the current cell, wrapped at
+		/// \a max_width unless that's 0
+		void add_text(const std::string& str, size_t max_width);
 		void start_cell(size_t span);
 		void complete_cell();
 
@@ -96,9 +107,10 @@ public:
 	};
 
 	struct Table {
-		explicit Table(bool b)
+		Table(bool b, size_t max_cell_width)
 			: inside(false)
 			, has_border(b)
+			, max_cell_width(max_cell_width)
 		{
 		}
 
@@ -110,6 +122,7 @@ public:
 
 		bool inside; // inside a row
 		bool has_border;
+		size_t max_cell_width; // 0 if cells can be as wide as they like
 		std::vector<TableRow> rows;
 	};
 
@@ -122,7 +135,6 @@ private:
 	std::string absolute_url(const std::string& url,
 		const std::string& link);
 	std::string type2str(LinkType type);
-	std::map<std::string, HtmlTag> tags;
 	void render_table(const Table& table,
 		std::vector<std::pair<LineType, std::string>>& lines);
 	void add_nonempty_line(const std::string& curline,
@@ -143,7 +155,16 @@ private:
 		const std::string& media_title, unsigned int media_count,
 		LinkType type);
 	HtmlTag extract_tag(TagSoupPullParser& parser);
+	void render(TagSoupPullParser& xpp,
+		std::vector<std::pair<LineType, std::string>>& lines,
+		std::vector<LinkPair>& links,
+		const std::string& url);
 	bool raw_;
+	std::size_t max_table_cell_width;
+	/// The number add_link() gave each of the links, counting from 1
+	std::unordered_map<std::string, unsigned int> link_numbers;
+	/// How many of the links are in link_numbers
+	std::size_t indexed_links;
 };
 
 } // namespace newsboat
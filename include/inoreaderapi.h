@@ -18,6 +18,7 @@ public:
 	virtual void add_custom_headers(curl_slist** custom_headers);
 	virtual bool mark_all_read(const std::string& feedurl);
 	virtual bool mark_article_read(const std::string& guid, bool read);
+	virtual bool mark_articles_read(const std::vector<std::string>& guids);
 	virtual bool update_article_flags(const std::string& inoflags,
 		const std::string& newflags,
 		const std::string& guid);
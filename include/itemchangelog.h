@@ -0,0 +1,55 @@
+#ifndef NEWSBOAT_ITEMCHANGELOG_H_
+#define NEWSBOAT_ITEMCHANGELOG_H_
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// What storing a reloaded feed did to one of its articles.
+struct ItemChange {
+	enum class Kind {
+		/// The article wasn't stored before
+		ADDED,
+		/// What's stored of the article was rewritten: its title, content,
+		/// enclosure and so on, or the read state that a remote API gave it
+		CHANGED,
+		/// The article became read or unread, e.g. because its content
+		/// changed and `reset-unread-on-update` applies to the feed. Only
+		/// known for feeds whose articles were loaded.
+		UNREAD,
+	};
+
+	std::string guid;
+	std::string feedurl;
+	Kind kind;
+};
+
+using ItemChanges = std::vector<ItemChange>;
+
+/// \brief Hands the changes of each reload to whatever follows them, so
+/// that it can look at just the articles that changed rather than at
+/// whole feeds.
+///
+/// Subscribers are called on the thread that publishes, which is the one
+/// that stores the feeds, in the order they subscribed. An article can be
+/// in a set twice, with different kinds of change.
+class ItemChangeLog {
+public:
+	using Subscriber = std::function<void(const ItemChanges& changes)>;
+
+	void subscribe(Subscriber subscriber);
+
+	/// Calls the subscribers with \a changes, unless there are none.
+	void publish(const ItemChanges& changes);
+
+private:
+	std::mutex mtx;
+	std::vector<Subscriber> subscribers;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_ITEMCHANGELOG_H_ */
@@ -5,7 +5,10 @@
 
 #include "3rd-party/optional.hpp"
 
+#include "articleexporter.h"
 #include "configcontainer.h"
+#include "dateformatcache.h"
+#include "descriptionprefetcher.h"
 #include "fmtstrformatter.h"
 #include "history.h"
 #include "listformaction.h"
@@ -57,6 +60,9 @@ public:
 	bool jump_to_next_item(bool start_with_first);
 	bool jump_to_previous_item(bool start_with_last);
 	bool jump_to_random_unread_item();
+	/// \brief Returns the items that the article view is likely to go to
+	/// from the selected one: the next unread, the next and the previous.
+	std::vector<std::shared_ptr<RssItem>> get_neighbour_items();
 
 	void handle_cmdline(const std::string& cmd) override;
 
@@ -65,6 +71,18 @@ public:
 	void invalidate_list()
 	{
 		invalidation_mode = InvalidationMode::COMPLETE;
+		visible_items_stale = true;
+		changed_items.clear();
+	}
+
+	/// \brief Like invalidate_list(), but only \a items have changed, so
+	/// only they are checked against the filter again.
+	void invalidate_items(const std::vector<std::shared_ptr<RssItem>>& items)
+	{
+		invalidation_mode = InvalidationMode::COMPLETE;
+		if (!visible_items_stale) {
+			changed_items.insert(changed_items.end(), items.begin(), items.end());
+		}
 	}
 
 	void restore_selected_position();
@@ -101,7 +119,19 @@ private:
 	void register_format_styles();
 
 	void do_update_visible_items();
+	/// Whether only the unread articles are listed, see listed_items().
+	bool lists_unread_items();
+	/// The feed's articles, which may lack the read ones while those
+	/// aren't shown and `lazy-load-read-articles` is set.
+	std::vector<std::shared_ptr<RssItem>>& listed_items();
+	/// Brings visible_items up to date with changed_items, and moves the
+	/// cursor so it stays on the same item. Returns false if that can't be
+	/// done without going through all the items.
+	bool update_changed_visible_items();
 	void draw_items();
+	/// Asks the prefetcher for the descriptions of the items on screen and
+	/// of a screenful below them.
+	void prefetch_descriptions();
 
 	bool open_position_in_browser(unsigned int pos,
 		bool interactive) const;
@@ -132,12 +162,15 @@ private:
 
 	std::string item2formatted_line(const ItemPtrPosPair& item,
 		const unsigned int width,
-		const std::string& itemlist_format,
+		const FmtStrTemplate& itemlist_format,
 		const std::string& datetime_format);
 
 	void goto_item(const std::string& title);
 
 	void handle_op_saveall();
+	/// Writes all of visible_items to a single file, which the user picks.
+	void save_all_to_archive(ArticleExporter::Archive format,
+		const std::string& extension);
 
 	unsigned int pos;
 
@@ -155,10 +188,23 @@ private:
 
 	InvalidationMode invalidation_mode;
 	std::vector<unsigned int> invalidated_itempos;
+	/// Whether do_update_visible_items() has to go through all the items,
+	/// rather than just changed_items.
+	bool visible_items_stale;
+	/// `show-read-articles` as of the last time all items were gone through.
+	bool visible_items_show_read;
+	std::vector<std::shared_ptr<RssItem>> changed_items;
 
 	ListFormatter listfmt;
+	/// `articlelist-format`, re-parsed by draw_items() when it changes.
+	FmtStrTemplate itemlist_format;
+	/// Dates of the items, as shown by `datetime-format`.
+	DateFormatCache formatted_dates;
 	Cache* rsscache;
 	FilterContainer& filter_container;
+
+	DescriptionPrefetcher prefetcher;
+	std::vector<std::shared_ptr<RssItem>> prefetched_items;
 };
 
 } // namespace newsboat
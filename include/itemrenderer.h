@@ -44,7 +44,9 @@ std::string to_plain_text(
 /// where URLs are wrapped. \a rxman rules for \a location are used to
 /// highlight the resulting text. \a links is filled with all the links
 /// found in the article (which is useful for article view, which lets
-/// users open the links by their number).
+/// users open the links by their number). Unless \a max_body_size is 0,
+/// only that many bytes of the body are rendered, cut at a character
+/// boundary.
 std::pair<std::string, size_t> to_stfl_list(
 	ConfigContainer& cfg,
 	std::shared_ptr<RssItem> item,
@@ -52,7 +54,8 @@ std::pair<std::string, size_t> to_stfl_list(
 	unsigned int window_width,
 	RegexManager* rxman,
 	const std::string& location,
-	std::vector<LinkPair>& links);
+	std::vector<LinkPair>& links,
+	std::size_t max_body_size = 0);
 
 /// \brief Returns RssItem's text source as STFL list.
 ///
@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_ITEMVIEWFORMACTION_H_
 #define NEWSBOAT_ITEMVIEWFORMACTION_H_
 
+#include "articleprerenderer.h"
 #include "formaction.h"
 #include "htmlrenderer.h"
 #include "regexmanager.h"
@@ -41,6 +42,7 @@ public:
 		return "article";
 	}
 	std::string title() override;
+	unsigned int wait_time() const override;
 
 	void finished_qna(Operation op) override;
 
@@ -78,6 +80,9 @@ private:
 	std::string guid;
 	std::shared_ptr<RssFeed> feed;
 	std::shared_ptr<RssItem> item;
+	/// Everything that was shown since the article list was left, so the
+	/// list knows which articles might have changed.
+	std::vector<std::shared_ptr<RssItem>> shown_items;
 	bool show_source;
 	std::vector<LinkPair> links;
 	RegexManager& rxman;
@@ -86,6 +91,12 @@ private:
 	bool in_search;
 	Cache* rsscache;
 	TextviewWidget textview;
+	/// Renders the articles next to this one, in case the user goes there,
+	/// and the rest of a large one while the start of it is shown.
+	ArticlePrerenderer prerenderer;
+	/// The options that the rest of the article is being rendered with, if
+	/// only its start is shown
+	nonstd::optional<RenderCache::Options> rest_options;
 };
 
 } // namespace newsboat
@@ -0,0 +1,68 @@
+#ifndef NEWSBOAT_JOBPROGRESS_H_
+#define NEWSBOAT_JOBPROGRESS_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace newsboat {
+
+/// \brief What a job running on a thread of its own shares with the UI
+/// that waits for it (see View::run_job()): whether it should give up, and
+/// how far it got.
+///
+/// The job checks is_cancelled() in its inner loops, or hands
+/// cancel_flag() to what it calls. The counts are only for showing; a job
+/// that can't tell how much there is to do leaves the total at 0.
+class JobProgress {
+public:
+	JobProgress()
+		: cancelled(false)
+		, done(0)
+		, total(0)
+	{
+	}
+	JobProgress(const JobProgress&) = delete;
+	JobProgress& operator=(const JobProgress&) = delete;
+
+	void cancel()
+	{
+		cancelled.store(true, std::memory_order_relaxed);
+	}
+	bool is_cancelled() const
+	{
+		return cancelled.load(std::memory_order_relaxed);
+	}
+	const std::atomic<bool>* cancel_flag() const
+	{
+		return &cancelled;
+	}
+
+	void set_total(std::uint64_t count)
+	{
+		total.store(count, std::memory_order_relaxed);
+	}
+	void advance(std::uint64_t count = 1)
+	{
+		done.fetch_add(count, std::memory_order_relaxed);
+	}
+	/// How much of the total is done, in percent, or -1 if the total isn't
+	/// known.
+	int percent_done() const
+	{
+		const auto all = total.load(std::memory_order_relaxed);
+		if (all == 0) {
+			return -1;
+		}
+		const auto part = done.load(std::memory_order_relaxed);
+		return static_cast<int>(100 * (part < all ? part : all) / all);
+	}
+
+private:
+	std::atomic<bool> cancelled;
+	std::atomic<std::uint64_t> done;
+	std::atomic<std::uint64_t> total;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_JOBPROGRESS_H_ */
@@ -0,0 +1,31 @@
+#ifndef NEWSBOAT_JSONSTREAM_H_
+#define NEWSBOAT_JSONSTREAM_H_
+
+#include <functional>
+#include <string>
+
+#include "3rd-party/json.hpp"
+
+namespace newsboat {
+
+/// \brief Parses a JSON object whose bulk is one long array, an element of
+/// that array at a time.
+///
+/// The remote APIs answer with objects like `{"items": [...], ...}`,
+/// where the array holds every article with its whole content. Instead of
+/// building all of it at once, \a on_element is called with each element of
+/// the array under \a key as soon as it has been read; its strings were
+/// moved out of the input, and can be moved out of it in turn. Everything
+/// else in the object ends up in \a rest, without \a key if that was an
+/// array.
+///
+/// Returns false if \a input isn't valid JSON. \a rest is the whole of
+/// \a input if that isn't an object.
+bool stream_json_array(const std::string& input,
+	const std::string& key,
+	const std::function<void(nlohmann::json& element)>& on_element,
+	nlohmann::json& rest);
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_JSONSTREAM_H_ */
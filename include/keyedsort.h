@@ -0,0 +1,99 @@
+#ifndef NEWSBOAT_KEYEDSORT_H_
+#define NEWSBOAT_KEYEDSORT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "executor.h"
+
+namespace newsboat {
+
+/// \brief Stable sorts that work out each element's key once.
+///
+/// The feed and article lists are sorted by keys that are costly to read:
+/// strings that are copied or converted, counts that lock the feed. These
+/// read the keys once per element and sort them side by side with the
+/// elements' positions, then put the elements in that order. Long lists
+/// are sorted in several threads.
+namespace keyedsort {
+
+/// Lists shorter than this are sorted in one thread, since starting more
+/// would take longer than what they save.
+const std::size_t PARALLEL_THRESHOLD = 8192;
+
+/// \brief Stable-sorts \a entries in the order of \a in_order, in several
+/// threads if there are at least PARALLEL_THRESHOLD of them.
+///
+/// \a in_order is called from all of the threads at once.
+template<typename T, typename InOrder>
+void stable_sort(std::vector<T>& entries, InOrder in_order)
+{
+	const std::size_t threads = std::min<std::size_t>(8,
+			std::thread::hardware_concurrency());
+	if (entries.size() < PARALLEL_THRESHOLD || threads < 2) {
+		std::stable_sort(entries.begin(), entries.end(), in_order);
+		return;
+	}
+
+	std::vector<std::size_t> bounds;
+	for (std::size_t i = 0; i <= threads; ++i) {
+		bounds.push_back(entries.size() * i / threads);
+	}
+	const auto at = [&](std::size_t i) {
+		return entries.begin() + bounds[std::min(i, threads)];
+	};
+
+	std::atomic<std::size_t> next_run(0);
+	Executor::instance().run_workers(Executor::Pool::CPU,
+		Executor::Priority::NORMAL, threads, [&]() {
+		for (std::size_t i = next_run++; i < threads; i = next_run++) {
+			std::stable_sort(at(i), at(i + 1), in_order);
+		}
+	});
+
+	// Each run is merged with the one after it, so equal entries stay in
+	// the order they were in
+	for (std::size_t width = 1; width < threads; width *= 2) {
+		for (std::size_t i = 0; i + width < threads; i += 2 * width) {
+			std::inplace_merge(at(i), at(i + width), at(i + 2 * width),
+				in_order);
+		}
+	}
+}
+
+/// \brief Stable-sorts \a elements by the keys that \a key_of gives them, in
+/// the order of \a in_order.
+///
+/// \a key_of is called once for each element, in order; \a in_order
+/// compares two keys.
+template<typename Key, typename T, typename KeyOf, typename InOrder>
+void sort_by_key(std::vector<T>& elements, KeyOf key_of, InOrder in_order)
+{
+	std::vector<std::pair<Key, std::size_t>> keys;
+	keys.reserve(elements.size());
+	for (std::size_t i = 0; i < elements.size(); ++i) {
+		keys.emplace_back(key_of(elements[i]), i);
+	}
+	keyedsort::stable_sort(keys,
+	[&](const std::pair<Key, std::size_t>& a,
+	const std::pair<Key, std::size_t>& b) {
+		return in_order(a.first, b.first);
+	});
+
+	std::vector<T> sorted;
+	sorted.reserve(elements.size());
+	for (const auto& key : keys) {
+		sorted.push_back(std::move(elements[key.second]));
+	}
+	elements.swap(sorted);
+}
+
+} // namespace keyedsort
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_KEYEDSORT_H_ */
@@ -1,8 +1,10 @@
 #ifndef NEWSBOAT_KEYMAP_H_
 #define NEWSBOAT_KEYMAP_H_
 
+#include <array>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -222,7 +224,22 @@ private:
 	unsigned short get_flag_from_context(const std::string& context);
 	std::map<std::string, Operation> get_internal_operations() const;
 	std::string getopname(Operation op) const;
+
+	/// The bindings of one context, laid out for get_operation()
+	struct Dispatch {
+		/// Indexed by the key, for keys that are a single ASCII character
+		std::array<Operation, 128> ascii;
+		std::unordered_map<std::string, Operation> named;
+	};
+	/// Rebuilds dispatch_ from keymap_ if a binding changed since the last
+	/// time.
+	void compile_if_needed();
+
 	std::map<std::string, std::map<std::string, Operation>> keymap_;
+	/// What get_operation() looks keys up in; keymap_ stays the place where
+	/// bindings are changed and listed
+	std::unordered_map<std::string, Dispatch> dispatch_;
+	bool dispatch_stale_;
 	std::map<std::string, MacroBinding> macros_;
 	std::vector<MacroCmd> startup_operations_sequence;
 };
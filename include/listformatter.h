@@ -2,6 +2,7 @@
 #define NEWSBOAT_LISTFORMATTER_H_
 
 #include <climits>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,8 +21,15 @@ public:
 	void clear()
 	{
 		lines.clear();
+		formatted.clear();
 	}
 	std::string format_list() const;
+	/// \brief Line \a i the way format_list() puts it in a listitem:
+	/// highlighted, and quoted for STFL.
+	///
+	/// Kept until the line is set again or the highlighting rules change, so
+	/// the lines of a list that's drawn again cost nothing.
+	const std::string& format_line(unsigned int i) const;
 	unsigned int get_lines_count() const
 	{
 		return lines.size();
@@ -29,6 +37,10 @@ public:
 
 private:
 	std::vector<std::string> lines;
+	/// What format_line() returned for each line; empty if not asked yet
+	mutable std::vector<std::string> formatted;
+	/// The RegexManager::revision() that \a formatted was highlighted with
+	mutable std::uint64_t formatted_revision;
 	RegexManager* rxman;
 	std::string location;
 };
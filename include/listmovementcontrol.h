@@ -2,7 +2,9 @@
 #define NEWSBOAT_LISTMOVEMENTCONTROL_H_
 
 #include "listwidgetbackend.h"
+#include <algorithm>
 #include <string>
+#include <utility>
 
 namespace newsboat {
 
@@ -108,6 +110,27 @@ public:
 		return current_position;
 	}
 
+	/// \brief Returns the first line, and the line after the last one, of a
+	/// window of a list of \a num_lines that covers the screen however the
+	/// list is scrolled with the cursor where it is.
+	///
+	/// The window also has at least \a min_margin lines to spare beyond the
+	/// screen on either side, so the cursor can move a bit before the window
+	/// has to.
+	std::pair<std::uint32_t, std::uint32_t> window_around_cursor(
+		std::uint32_t num_lines, std::uint32_t min_margin)
+	{
+		if (num_lines == 0) {
+			return {0, 0};
+		}
+		const std::uint32_t h = Backend::get_height();
+		const std::uint32_t reach = h + std::max(h, min_margin);
+		const std::uint32_t pos = std::min(current_position, num_lines - 1);
+		const std::uint32_t first = pos > reach ? pos - reach : 0;
+		const std::uint32_t last = std::min(num_lines - pos, reach) + pos;
+		return {first, last};
+	}
+
 	void set_position(std::uint32_t pos)
 	{
 		// TODO: Check if in valid range?
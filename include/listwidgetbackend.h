@@ -2,19 +2,42 @@
 #define NEWSBOAT_LISTWIDGETBACKEND_H_
 
 #include <string>
+#include <vector>
 
 #include "listformatter.h"
 #include "stflpp.h"
 
 namespace newsboat {
 
+/// \brief Hands the lines of a list to STFL.
+///
+/// Remembers what each line was when it was last handed over, and when a
+/// list of the same lines at the same place is handed over again, only
+/// replaces the lines that changed, as their own listitems. STFL then
+/// doesn't parse and lay out all of them again on every redraw, e.g. when
+/// an article is marked read in a long list.
 class ListWidgetBackend {
 public:
 	ListWidgetBackend(const std::string& list_name, Stfl::Form& form);
-	virtual ~ListWidgetBackend() = default;
+	virtual ~ListWidgetBackend();
 
 	void stfl_replace_list(std::uint32_t number_of_lines, std::string stfl);
 	void stfl_replace_lines(const ListFormatter& listfmt);
+	/// \brief Hands STFL only the lines of \a listfmt, which are lines
+	/// \a first_line and onwards of a list that's \a total_lines long.
+	///
+	/// Positions and scroll offsets stay relative to the whole list; the
+	/// widget translates them when it talks to STFL.
+	void stfl_replace_window(const ListFormatter& listfmt,
+		std::uint32_t first_line, std::uint32_t total_lines);
+
+	/// Index of the first line that was handed to STFL.
+	std::uint32_t get_window_start();
+	/// Number of lines that were handed to STFL.
+	std::uint32_t get_window_size();
+	/// Whether all the lines that are on screen were handed to STFL. If not,
+	/// the window has to be replaced before the list is drawn.
+	bool window_covers_viewport();
 
 	std::uint32_t get_width();
 	std::uint32_t get_height();
@@ -26,9 +49,30 @@ protected:
 	virtual void on_list_changed() = 0;
 
 private:
+	void replace(const std::string& mode, const std::string& stfl);
+	/// \brief Replaces the lines handed to STFL with those of \a listfmt.
+	///
+	/// If \a same_place, they're the lines at the same place of the list
+	/// as last time, and only the ones that changed are replaced.
+	void replace_rows(const ListFormatter& listfmt, bool same_place);
+	/// The name of the listitem of line \a i of what was handed to STFL.
+	std::string row_name(std::size_t i) const;
+
 	const std::string list_name;
 	Stfl::Form& form;
 	std::uint32_t num_lines;
+	std::uint32_t window_start;
+	std::uint32_t window_size;
+	std::uint32_t position;
+	std::uint32_t scroll_offset;
+	/// Size of what the list was last replaced with, for RuntimeStats
+	std::size_t list_bytes;
+	/// What each line handed to STFL was, as ListFormatter::format_line()
+	/// made it
+	std::vector<std::string> rows;
+	/// Whether \a rows is what STFL has; not so before the lines were
+	/// handed over, or after the list was replaced with STFL markup.
+	bool rows_shown;
 };
 
 } // namespace newsboat
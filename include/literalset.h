@@ -0,0 +1,55 @@
+#ifndef NEWSBOAT_LITERALSET_H_
+#define NEWSBOAT_LITERALSET_H_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Finds several literal strings in a text in a single pass.
+///
+/// Built as an Aho-Corasick automaton, so the time a search takes depends
+/// on the length of the text and the number of occurrences, not on the
+/// number of literals. ASCII letters are compared case-insensitively, like
+/// REG_ICASE does for them.
+class LiteralSet {
+public:
+	struct Match {
+		/// Index of the literal in the vector the set was built from
+		std::size_t literal;
+		std::size_t start;
+		std::size_t end;
+	};
+
+	/// Literals must not be empty.
+	explicit LiteralSet(const std::vector<std::string>& literals);
+
+	/// Every occurrence of every literal in \a text, overlapping ones
+	/// included, ordered by where they end.
+	std::vector<Match> find_all(const std::string& text) const;
+
+	/// \brief Whether POSIX extended regex \a pattern, compiled with
+	/// REG_ICASE, matches exactly the occurrences of its own text.
+	///
+	/// That's the case for non-empty patterns made of printable ASCII
+	/// characters other than the ones that have a special meaning.
+	static bool is_literal(const std::string& pattern);
+
+private:
+	struct Node {
+		std::array<int, 256> next;
+		int fail;
+		/// Literals that end here, including the ones reached through
+		/// `fail`
+		std::vector<std::size_t> outputs;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<std::size_t> lengths;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_LITERALSET_H_ */
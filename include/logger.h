@@ -1,6 +1,10 @@
 #ifndef NEWSBOAT_LOGGER_H_
 #define NEWSBOAT_LOGGER_H_
 
+#include <atomic>
+#include <cstdint>
+#include <string>
+
 #include "config.h"
 #include "strprintf.h"
 
@@ -12,11 +16,45 @@ using Level = logger::Level;
 
 namespace logger {
 
+/// The loglevel of a module that wasn't given one of its own: the global
+/// loglevel applies.
+const std::int64_t GLOBAL_LOGLEVEL = -2;
+
+/// \brief Returns the loglevel of the module that \a file belongs to.
+///
+/// A module is a source file, named without its directory and extension:
+/// "src/reloader.cpp" belongs to "reloader". The returned value lives for
+/// the rest of the program, so each LOG() call looks it up only once.
+std::atomic<std::int64_t>& module_loglevel(const char* file);
+
+/// Makes messages from \a module be logged at \a level, regardless of the
+/// global loglevel.
+void set_module_loglevel(const std::string& module, Level level);
+
+/// Makes \a module follow the global loglevel again.
+void unset_module_loglevel(const std::string& module);
+
+inline bool is_enabled(Level l, const std::atomic<std::int64_t>& module)
+{
+	if (l == Level::USERERROR) {
+		return true;
+	}
+	const std::int64_t level = module.load(std::memory_order_relaxed);
+	return static_cast<int64_t>(l) <=
+		(level != GLOBAL_LOGLEVEL ? level : get_loglevel());
+}
+
+/// Writes a message that LOG() already checked with is_enabled().
 template<typename... Args>
-void log(Level l, const std::string& format, Args... args)
+void log(Level l, const std::atomic<std::int64_t>& module,
+	const std::string& format, Args... args)
 {
-	if (l == Level::USERERROR || static_cast<int64_t>(l) <= get_loglevel()) {
-		log_internal(l, strprintf::fmt(format, args...));
+	const std::string message = strprintf::fmt(format, args...);
+	if (module.load(std::memory_order_relaxed) == GLOBAL_LOGLEVEL) {
+		log_internal(l, message);
+	} else {
+		// The module's own loglevel might be above the global one
+		log_unfiltered(l, message);
 	}
 }
 };
@@ -24,14 +62,21 @@ void log(Level l, const std::string& format, Args... args)
 } // namespace newsboat
 
 // see https://kernelnewbies.org/FAQ/DoWhile0
+//
+// The level is checked before the arguments are evaluated, so they cost
+// nothing while the message isn't logged.
 #ifdef NDEBUG
 #define LOG(x, ...) \
 	do {        \
 	} while (0)
 #else
-#define LOG(x, ...)                                        \
-	do {                                               \
-		newsboat::logger::log(x, __VA_ARGS__); \
+#define LOG(x, ...)                                                    \
+	do {                                                               \
+		static std::atomic<std::int64_t>& newsboat_log_module =        \
+			newsboat::logger::module_loglevel(__FILE__);               \
+		if (newsboat::logger::is_enabled(x, newsboat_log_module)) {    \
+			newsboat::logger::log(x, newsboat_log_module, __VA_ARGS__); \
+		}                                                              \
 	} while (0)
 #endif
 
@@ -1,12 +1,57 @@
 #ifndef NEWSBOAT_MATCHABLE_H_
 #define NEWSBOAT_MATCHABLE_H_
 
+#include <array>
+#include <cstdint>
+#include <ctime>
 #include <string>
 
 #include "3rd-party/optional.hpp"
 
 namespace newsboat {
 
+/// \brief The attributes that RssItem and RssFeed provide.
+///
+/// Matcher looks up the attribute names of a filter expression once, so that
+/// matching an item doesn't have to compare them against every name there
+/// is.
+enum class MatchableAttribute {
+	UNKNOWN = 0,
+
+	TITLE,
+	LINK,
+	AUTHOR,
+	CONTENT,
+	DATE,
+	GUID,
+	UNREAD,
+	ENCLOSURE_URL,
+	ENCLOSURE_TYPE,
+	FLAGS,
+	AGE,
+	ARTICLEINDEX,
+
+	FEEDTITLE,
+	DESCRIPTION,
+	FEEDLINK,
+	FEEDDATE,
+	RSSURL,
+	UNREAD_COUNT,
+	TOTAL_COUNT,
+	TAGS,
+	FEEDINDEX,
+};
+
+/// \brief The color index that RegexManager found for an RssItem or an
+/// RssFeed, and what it was found from.
+struct HighlightMemo {
+	/// RegexManager's revision of the rules; 0 if nothing was found yet
+	std::uint64_t rules = 0;
+	/// Whatever RegexManager needs to tell that the result still holds
+	std::array<std::uint64_t, 3> stamp{};
+	int id = -1;
+};
+
 class Matchable {
 public:
 	Matchable() = default;
@@ -14,9 +59,39 @@ public:
 	virtual nonstd::optional<std::string> attribute_value(const std::string& attr)
 	const =
 		0;
+
+	/// \brief Like attribute_value(), for an attribute whose id was looked
+	/// up by attribute_id().
+	///
+	/// \a attr is the name of the attribute, for the ones that are
+	/// UNKNOWN. The default implementation just calls attribute_value().
+	virtual nonstd::optional<std::string> attribute_value_by_id(
+		MatchableAttribute id, const std::string& attr) const
+	{
+		(void)id;
+		return attribute_value(attr);
+	}
+
+	/// \brief The value of attribute \a id, if it's a number.
+	///
+	/// Matcher compares these with `<`, `>`, `<=`, `>=` and `between`
+	/// without formatting and parsing them. `age` is counted up to \a now,
+	/// which is the same for every item of a batch. Returns nullopt for
+	/// attributes that aren't numbers, which Matcher then parses from
+	/// attribute_value_by_id(); the default implementation always does.
+	virtual nonstd::optional<std::int64_t> attribute_number_by_id(
+		MatchableAttribute id, std::time_t now) const
+	{
+		(void)id;
+		(void)now;
+		return nonstd::nullopt;
+	}
+
+	/// Returns the id of the attribute named \a attr, or UNKNOWN if it
+	/// isn't one of MatchableAttribute.
+	static MatchableAttribute attribute_id(const std::string& attr);
 };
 
 } // namespace newsboat
 
 #endif /* NEWSBOAT_MATCHABLE_H_ */
-
@@ -1,11 +1,18 @@
 #ifndef NEWSBOAT_MATCHER_H_
 #define NEWSBOAT_MATCHER_H_
 
+#include <atomic>
+#include <ctime>
+#include <exception>
+#include <vector>
+
 #include "FilterParser.h"
+#include "3rd-party/optional.hpp"
 
 namespace newsboat {
 
 class Matchable;
+enum class MatchableAttribute;
 
 class Matcher {
 public:
@@ -13,6 +20,41 @@ public:
 	explicit Matcher(const std::string& expr);
 	bool parse(const std::string& expr);
 	bool matches(Matchable* item);
+	/// \brief Matches each of \a items against the expression.
+	///
+	/// Returns one flag per item, in the same order. Cheaper than calling
+	/// matches() for every item, since the batch is measured as a whole,
+	/// and large batches are split between several threads. Throws
+	/// MatcherException for the first item that matches() would throw for.
+	///
+	/// Once \a cancel is set, the items that haven't been looked at yet
+	/// are left unmatched, and the caller should throw the result away.
+	std::vector<bool> matches(const std::vector<Matchable*>& items,
+		const std::atomic<bool>* cancel = nullptr);
+
+	/// \brief Matches each of \a items against all of \a matchers at once.
+	///
+	/// Returns one list of flags per matcher, like matches() does for a
+	/// batch. Each item is only visited once, and an attribute that several
+	/// of the expressions look at is only read from it once. Large batches
+	/// are split between several threads. Instead of throwing, the
+	/// MatcherException that a matcher would throw ends up in \a errors, at
+	/// that matcher's position, and its flags are all false.
+	static std::vector<std::vector<bool>> matches_all(
+			const std::vector<Matcher*>& matchers,
+			const std::vector<Matchable*>& items,
+			std::vector<std::exception_ptr>& errors);
+	/// \brief The expression as an SQL condition on the columns of the
+	/// cache's `rss_item` table.
+	///
+	/// Only works for expressions that are made of unread, flags, guid,
+	/// link, enclosure_url, enclosure_type and age, and don't use regexes
+	/// or `#`; returns nullopt for the rest. The condition holds for
+	/// exactly the items that matches() returns true for. It doesn't
+	/// change between calls, so statements using it can be reused.
+	nonstd::optional<std::string> sql_condition();
+	/// Whether the expression looks at attribute \a attribute.
+	bool uses_attribute(MatchableAttribute attribute);
 	std::string get_parse_error();
 	std::string get_expression();
 
@@ -24,14 +66,39 @@ public:
 	static int string_to_num(const std::string& number);
 
 private:
-	bool matches_r(expression* e, Matchable* item);
+	/// \brief Puts the cheaper side of every `and` and `or` in \a e first,
+	/// so that the costly side is only evaluated if it has to be.
+	///
+	/// Returns the estimated cost of evaluating \a e.
+	static unsigned int order_by_cost(expression* e);
+
+	/// Parses the literals that are compared as numbers, so that it isn't
+	/// done for every item.
+	static void parse_numbers_r(expression* e);
+
+	/// \brief Compiles the regexes of \a e ahead of matching, so that the
+	/// threads of matches_parallel() don't race to do it.
+	///
+	/// Returns false if one of them doesn't compile; matching should then
+	/// be left to a single thread, which throws for it like matches()
+	/// would.
+	static bool compile_regexes_r(expression* e);
+	/// The batch matches() for \a items, split into chunks that \a threads
+	/// threads work through.
+	std::vector<bool> matches_parallel(const std::vector<Matchable*>& items,
+		time_t now, unsigned int threads, const std::atomic<bool>* cancel);
+
+	/// \a now is the time that `age` is counted up to.
+	bool matches_r(expression* e, Matchable* item, time_t now);
+	static nonstd::optional<std::string> sql_condition_r(expression* e);
+	static bool uses_attribute_r(expression* e, MatchableAttribute attribute);
 
-	bool matchop_lt(expression* e, Matchable* item);
-	bool matchop_gt(expression* e, Matchable* item);
+	bool matchop_lt(expression* e, Matchable* item, time_t now);
+	bool matchop_gt(expression* e, Matchable* item, time_t now);
 	bool matchop_rxeq(expression* e, Matchable* item);
 	bool matchop_cont(expression* e, Matchable* item);
 	bool matchop_eq(expression* e, Matchable* item);
-	bool matchop_between(expression* e, Matchable* item);
+	bool matchop_between(expression* e, Matchable* item, time_t now);
 
 	FilterParser p;
 	std::string errmsg;
@@ -20,12 +20,18 @@ public:
 	std::vector<TaggedFeedUrl> get_subscribed_urls() override;
 	bool mark_all_read(const std::string& feedurl) override;
 	bool mark_article_read(const std::string& guid, bool read) override;
+	bool mark_articles_read(const std::vector<std::string>& guids) override;
 	bool update_article_flags(const std::string& oldflags,
 		const std::string& newflags,
 		const std::string& guid) override;
 	void add_custom_headers(curl_slist**) override;
+	bool fetch_unread_guids(std::vector<std::string>& guids) override;
 	rsspp::Feed fetch_feed(const std::string& id);
-	rsspp::Feed fetch_feed(const std::string& id, CurlHandle& easyhandle);
+	/// Fetches the articles of feed \a id. If \a conditional is given,
+	/// the server is only asked whether they changed since it was last
+	/// answered; if they didn't, the feed's version is left UNKNOWN.
+	rsspp::Feed fetch_feed(const std::string& id, CurlHandle& easyhandle,
+		utils::ConditionalRequest* conditional = nullptr);
 
 private:
 	virtual nlohmann::json run_op(const std::string& path,
@@ -35,6 +41,14 @@ private:
 		const nlohmann::json& req_data,
 		CurlHandle& cached_handle,
 		const HTTPMethod method = HTTPMethod::GET);
+	/// Sends a GET request to \a path through revalidate().
+	nlohmann::json run_revalidated(const std::string& path);
+	/// Sends a request to \a path, and returns the raw reply.
+	std::string request(const std::string& path,
+		const nlohmann::json& req_data,
+		CurlHandle& cached_handle,
+		const HTTPMethod method,
+		utils::ConditionalRequest* conditional = nullptr);
 	TaggedFeedUrl feed_from_json(const nlohmann::json& jfeed,
 		const std::vector<std::string>& tags);
 	bool flag_changed(const std::string& oldflags,
@@ -0,0 +1,107 @@
+#ifndef NEWSBOAT_MULTIDOWNLOADER_H_
+#define NEWSBOAT_MULTIDOWNLOADER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <curl/curl.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace newsboat {
+
+class CurlHandle;
+
+/// \brief Runs many HTTP transfers at once on a single thread.
+///
+/// Downloading a feed is mostly waiting for the server, so rather than
+/// blocking a thread per transfer, all of them are driven through curl's
+/// multi interface by whichever thread calls run(). Transfers can be added
+/// from any thread, including while run() is going.
+///
+/// Transfers to a host that speaks HTTP/2 are multiplexed over a single
+/// connection. To stay polite to hosts that carry many feeds, each host can
+/// be given a limit on the transfers it gets at once, and a minimum delay
+/// between two transfers to it. Transfers that have to wait don't hold up
+/// the ones to other hosts.
+class MultiDownloader {
+public:
+	/// Called on the thread that's in run() once a transfer is over, with
+	/// the result curl_easy_perform() would've returned. By then the
+	/// downloader doesn't use the handle anymore.
+	using Callback = std::function<void(CURLcode result)>;
+
+	/// At most \a max_transfers run at the same time, and at most
+	/// \a max_per_host to a single host; the rest wait for their turn.
+	/// 0 means there's no limit. Transfers to the same host are started at
+	/// least \a host_delay apart.
+	explicit MultiDownloader(unsigned int max_transfers,
+		unsigned int max_per_host = 0,
+		std::chrono::milliseconds host_delay = std::chrono::milliseconds(0));
+	MultiDownloader(const MultiDownloader&) = delete;
+	MultiDownloader& operator=(const MultiDownloader&) = delete;
+	~MultiDownloader();
+
+	/// \brief Queues a transfer through \a handle.
+	///
+	/// The handle has to be set up already, and must stay alive until \a done
+	/// is called. Transfers with an empty \a host aren't subject to the
+	/// per-host limits.
+	void add(CurlHandle& handle, Callback done, const std::string& host = "");
+
+	/// \brief Lets run() return as soon as it runs out of transfers.
+	void finish();
+
+	/// \brief Performs the transfers, waiting for more to be added until
+	/// finish() is called.
+	void run();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Transfer {
+		CURL* handle;
+		Callback done;
+		std::string host;
+	};
+
+	struct Host {
+		Host()
+			: running(0)
+		{
+		}
+
+		unsigned int running;
+		Clock::time_point last_start;
+	};
+
+	/// Starts whatever the limits allow. Returns when the next of the
+	/// transfers that are held back by host_delay can start, or
+	/// Clock::time_point::max() if there's none.
+	Clock::time_point start_queued_unlocked();
+	void complete_transfers();
+	void wait_for_activity(Clock::time_point next_start);
+
+	const unsigned int max_transfers;
+	const unsigned int max_per_host;
+	const std::chrono::milliseconds host_delay;
+	CURLM* multi;
+
+	std::mutex queue_mutex;
+	std::condition_variable queue_changed;
+	std::deque<Transfer> queued;
+	bool finished;
+
+	/// Transfers that were handed to curl, ones that curl refused, and the
+	/// hosts they go to. Only used by run().
+	std::unordered_map<CURL*, Transfer> running;
+	std::vector<Callback> failed;
+	std::unordered_map<std::string, Host> hosts;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_MULTIDOWNLOADER_H_ */
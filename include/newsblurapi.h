@@ -24,6 +24,7 @@ public:
 	void add_custom_headers(curl_slist** custom_headers) override;
 	bool mark_all_read(const std::string& feedurl) override;
 	bool mark_article_read(const std::string& guid, bool read) override;
+	bool mark_articles_read(const std::vector<std::string>& guids) override;
 	bool update_article_flags(const std::string& oldflags,
 		const std::string& newflags,
 		const std::string& guid) override;
@@ -34,6 +35,8 @@ private:
 	json_object* query_api(const std::string& url,
 		const std::string* body,
 		const HTTPMethod method = HTTPMethod::GET);
+	/// Like query_api() with a GET request, through revalidate().
+	json_object* query_api_revalidated(const std::string& endpoint);
 	std::map<std::string, std::vector<std::string>> mk_feeds_to_tags(
 			json_object*);
 	std::string api_location;
@@ -1,7 +1,10 @@
 #ifndef NEWSBOAT_OPML_H_
 #define NEWSBOAT_OPML_H_
 
+#include <functional>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+#include <string>
 
 #include "feedcontainer.h"
 #include "fileurlreader.h"
@@ -9,6 +12,33 @@
 namespace newsboat {
 
 namespace opml {
+
+/// \brief The attributes of an `<outline>` that Newsboat looks at; those
+/// it doesn't have are empty.
+struct Outline {
+	std::string type;
+	std::string xml_url;
+	std::string url;
+	std::string text;
+	std::string title;
+	std::string filtercmd;
+};
+
+/// Given an outline and the tag of the outline it's in, returns the tag of
+/// the outlines in it.
+using OutlineVisitor = std::function<std::string(const Outline& outline,
+		const std::string& tag)>;
+
+/// \brief Calls \a visit for every outline in the body of the document that
+/// \a reader reads, in document order.
+///
+/// The document is read a node at a time, so a large one takes no more
+/// memory than its deepest nesting of outlines does. Outlines are at the
+/// top, with an empty tag. Returns false if \a reader is nullptr, or the
+/// document is empty or not well-formed; the outlines before the error were
+/// visited then.
+bool read_outlines(xmlTextReaderPtr reader, const OutlineVisitor& visit);
+
 xmlDocPtr generate(const FeedContainer& feedcontainer);
 nonstd::optional<std::string> import(
 	const std::string& filename,
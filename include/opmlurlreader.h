@@ -1,10 +1,13 @@
 #ifndef NEWSBOAT_OPMLURLREADER_H_
 #define NEWSBOAT_OPMLURLREADER_H_
 
-#include <libxml/tree.h>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "configcontainer.h"
+#include "curlhandle.h"
 #include "urlreader.h"
 
 namespace newsboat {
@@ -16,11 +19,21 @@ public:
 	std::string get_source() override;
 
 protected:
-	virtual void handle_node(xmlNode* node, const std::string& tag);
 	ConfigContainer* cfg;
 
 private:
-	void rec_find_rss_outlines(xmlNode* node, std::string tag);
+	/// \brief The feeds of an OPML file, and what its server said about
+	/// it, so that it's only downloaded again when it changed.
+	struct CachedOpml {
+		utils::ConditionalRequest request;
+		/// URLs and their tags, which are empty for feeds at the top
+		std::vector<std::pair<std::string, std::string>> feeds;
+	};
+
+	void add_feed(const std::string& url, const std::string& tag);
+
+	CurlHandle handle;
+	std::unordered_map<std::string, CachedOpml> cache;
 };
 
 }
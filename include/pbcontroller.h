@@ -8,9 +8,11 @@
 #include "colormanager.h"
 #include "configcontainer.h"
 #include "download.h"
+#include "downloadmanager.h"
 #include "fslock.h"
 #include "keymap.h"
 #include "queueloader.h"
+#include "speedschedule.h"
 
 namespace podboat {
 
@@ -23,6 +25,15 @@ public:
 
 	void initialize(int argc, char* argv[]);
 	int run(PbView& v);
+	/// Whether `--daemon` was given, asking for run_daemon() instead of
+	/// run().
+	bool daemon_mode() const
+	{
+		return daemon;
+	}
+	/// Downloads what's queued without a user interface, picking up
+	/// whatever gets queued later, until Podboat is interrupted.
+	int run_daemon();
 
 	std::vector<Download>& downloads()
 	{
@@ -33,7 +44,10 @@ public:
 	void purge_queue();
 
 	unsigned int get_maxdownloads();
+	/// Queues the downloads that are QUEUED, to start as the limits allow.
 	void start_downloads();
+	/// Keeps the queued downloads that didn't start yet from starting.
+	void stop_automatic_downloads();
 	void start_download(Download& item);
 
 	void increase_parallel_downloads();
@@ -67,11 +81,15 @@ private:
 	unsigned int max_dls;
 
 	std::unique_ptr<QueueLoader> ql;
+	/// Declared after downloads_, which its jobs point into
+	std::unique_ptr<DownloadManager> downloader;
 
 	std::string lock_file;
 	std::unique_ptr<newsboat::FsLock> fslock;
 
 	bool automatic_dl = false;
+	bool daemon = false;
+	SpeedSchedule schedule;
 	newsboat::ColorManager colorman;
 	newsboat::KeyMap keys;
 };
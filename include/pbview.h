@@ -1,6 +1,8 @@
 #ifndef PODBOAT_VIEW_H_
 #define PODBOAT_VIEW_H_
 
+#include <atomic>
+
 #include "colormanager.h"
 #include "listwidget.h"
 #include "textviewwidget.h"
@@ -38,13 +40,17 @@ private:
 	void set_help_keymap_hint();
 	std::pair<double, std::string> get_speed_human_readable(double kbps);
 	void handle_resize();
+	/// Hands STFL the lines of the downloads around the cursor, and the
+	/// title.
+	void draw_downloads();
 
 	std::string format_line(const std::string& podlist_format,
 		const Download& dl,
 		unsigned int pos,
 		unsigned int width);
 
-	bool update_view;
+	/// Set by the download manager's thread too
+	std::atomic<bool> update_view;
 	PbController* ctrl;
 	newsboat::Stfl::Form dllist_form;
 	newsboat::Stfl::Form help_form;
@@ -0,0 +1,148 @@
+#ifndef NEWSBOAT_PERFECTHASH_H_
+#define NEWSBOAT_PERFECTHASH_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace newsboat {
+
+/// \brief Lookup of a fixed set of names that takes one hash, one probe and
+/// one comparison, and never allocates.
+///
+/// The names come from a `Keys` type with these static members:
+///
+///     static constexpr std::size_t count;      // number of names
+///     static constexpr std::size_t slots;      // size of the slot array
+///     static constexpr std::uint32_t seed;     // picked so that no two
+///                                              // names share a slot
+///     static constexpr bool fold_case;         // ASCII case-insensitive?
+///     static constexpr const char* at(std::size_t i);
+///
+/// `static_assert(perfect_hash::is_perfect<Keys>(), ...)` checks at compile
+/// time that the seed still works for the names. If it fails after names
+/// were added, a new seed has to be searched for.
+namespace perfect_hash {
+
+constexpr char fold(char c, bool fold_case)
+{
+	return fold_case && c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr std::uint32_t xorshift(std::uint32_t h, unsigned int shift)
+{
+	return h ^ (h >> shift);
+}
+
+/// The finaliser of MurmurHash3, so that the low bits that pick the slot
+/// depend on all of the FNV-1a state.
+constexpr std::uint32_t finish(std::uint32_t h)
+{
+	return xorshift(xorshift(xorshift(h, 16) * 0x85ebca6bu, 13) * 0xc2b2ae35u, 16);
+}
+
+/// FNV-1a of \a length bytes at \a s, starting from \a h.
+constexpr std::uint32_t fnv1a(const char* s, std::size_t length, bool fold_case,
+	std::uint32_t h)
+{
+	return length == 0 ? h : fnv1a(s + 1, length - 1, fold_case,
+			(h ^ static_cast<unsigned char>(fold(*s, fold_case))) * 16777619u);
+}
+
+constexpr std::uint32_t hash(const char* s, std::size_t length, bool fold_case,
+	std::uint32_t seed)
+{
+	return finish(fnv1a(s, length, fold_case, seed));
+}
+
+constexpr std::size_t length(const char* s)
+{
+	return *s == '\0' ? 0 : 1 + length(s + 1);
+}
+
+template<typename Keys>
+constexpr std::size_t slot_of(std::size_t i)
+{
+	return hash(Keys::at(i), length(Keys::at(i)), Keys::fold_case, Keys::seed)
+		% Keys::slots;
+}
+
+/// Whether name \a i has a slot of its own among the names [lo, hi).
+/// Halves the range to keep the recursion shallow.
+template<typename Keys>
+constexpr bool has_own_slot(std::size_t i, std::size_t lo, std::size_t hi)
+{
+	return hi - lo == 0 ? true
+		: hi - lo == 1 ? slot_of<Keys>(i) != slot_of<Keys>(lo)
+		: has_own_slot<Keys>(i, lo, lo + (hi - lo) / 2)
+		&& has_own_slot<Keys>(i, lo + (hi - lo) / 2, hi);
+}
+
+/// Whether no two names share a slot.
+template<typename Keys>
+constexpr bool is_perfect(std::size_t lo = 0, std::size_t hi = Keys::count)
+{
+	return hi - lo == 0 ? true
+		: hi - lo == 1 ? has_own_slot<Keys>(lo, lo + 1, Keys::count)
+		: is_perfect<Keys>(lo, lo + (hi - lo) / 2)
+		&& is_perfect<Keys>(lo + (hi - lo) / 2, hi);
+}
+
+constexpr std::size_t larger(std::size_t a, std::size_t b)
+{
+	return a > b ? a : b;
+}
+
+/// The length of the longest name; anything longer can't be one of them.
+template<typename Keys>
+constexpr std::size_t max_length(std::size_t lo = 0, std::size_t hi = Keys::count)
+{
+	return hi - lo == 0 ? 0
+		: hi - lo == 1 ? length(Keys::at(lo))
+		: larger(max_length<Keys>(lo, lo + (hi - lo) / 2),
+			max_length<Keys>(lo + (hi - lo) / 2, hi));
+}
+
+template<typename Keys>
+class Table {
+public:
+	Table()
+		: longest(max_length<Keys>())
+	{
+		entries.fill(-1);
+		for (std::size_t i = 0; i < Keys::count; ++i) {
+			entries[slot_of<Keys>(i)] = static_cast<std::int16_t>(i);
+		}
+	}
+
+	/// Returns the index of the name that is equal to the \a size bytes at
+	/// \a s, or -1 if there's none.
+	int find(const char* s, std::size_t size) const
+	{
+		if (size == 0 || size > longest) {
+			return -1;
+		}
+		const int i = entries[hash(s, size, Keys::fold_case, Keys::seed) % Keys::slots];
+		if (i < 0) {
+			return -1;
+		}
+		const char* name = Keys::at(i);
+		for (std::size_t k = 0; k < size; ++k) {
+			if (name[k] == '\0' || fold(s[k], Keys::fold_case) != name[k]) {
+				return -1;
+			}
+		}
+		return name[size] == '\0' ? i : -1;
+	}
+
+private:
+	std::size_t longest;
+	/// Index of the name in each slot, or -1 if the slot is free
+	std::array<std::int16_t, Keys::slots> entries;
+};
+
+} // namespace perfect_hash
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_PERFECTHASH_H_ */
@@ -0,0 +1,98 @@
+#ifndef NEWSBOAT_PROCESSRUNNER_H_
+#define NEWSBOAT_PROCESSRUNNER_H_
+
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "3rd-party/optional.hpp"
+
+namespace newsboat {
+
+/// \brief Runs many programs at once, collecting what they write, on a
+/// single thread.
+///
+/// Like MultiDownloader, but for the scripts behind `exec:` and `filter:`
+/// feeds: those mostly wait for the network too, so rather than blocking a
+/// thread per script, whichever thread calls run() feeds their standard
+/// input and reads their standard output as they go, with poll(). Programs
+/// can be added from any thread, including while run() is going.
+class ProcessRunner {
+public:
+	/// Called on the thread that's in run() once the program is gone, with
+	/// its exit status and what it wrote to its standard output. The status
+	/// is -1 if it couldn't be started, or was killed by a signal; 127 if it
+	/// couldn't be found.
+	using Callback = std::function<void(int status, std::string output)>;
+
+	/// At most \a max_processes run at the same time; the rest wait for
+	/// their turn. 0 means there's no limit.
+	explicit ProcessRunner(unsigned int max_processes);
+	ProcessRunner(const ProcessRunner&) = delete;
+	ProcessRunner& operator=(const ProcessRunner&) = delete;
+	/// Kills the programs that are still running.
+	~ProcessRunner();
+
+	/// \brief Queues running \a argv, looked up in PATH.
+	///
+	/// \a input is written to the program's standard input, which is closed
+	/// afterwards. Without it, the program gets Newsboat's standard input,
+	/// so it can ask the user something. Its standard error is discarded.
+	void add(std::vector<std::string> argv,
+		nonstd::optional<std::string> input,
+		Callback done);
+
+	/// \brief Lets run() return as soon as it runs out of programs.
+	void finish();
+
+	/// \brief Runs the programs, waiting for more to be added until
+	/// finish() is called.
+	void run();
+
+private:
+	struct Process {
+		std::vector<std::string> argv;
+		nonstd::optional<std::string> input;
+		Callback done;
+		pid_t pid = -1;
+		int stdin_fd = -1;
+		int stdout_fd = -1;
+		std::size_t written = 0;
+		std::string output;
+	};
+
+	/// Starts whatever max_processes allows. The ones that couldn't be
+	/// started are moved to failed.
+	void start_queued_unlocked();
+	/// Forks and execs \a process with its pipes; false if that failed.
+	static bool spawn(Process& process);
+	/// Waits until a pipe or the wake-up pipe is ready, or for a while if
+	/// a program closed its output but hasn't exited, and handles the pipes.
+	void wait_for_activity();
+	static void read_output(Process& process);
+	static void write_input(Process& process);
+	/// Calls the callbacks of the programs that exited.
+	void reap();
+	void wake_up();
+
+	const unsigned int max_processes;
+	/// Written to by add() and finish(), so run() leaves poll()
+	int wake_pipe[2];
+
+	std::mutex queue_mutex;
+	std::deque<Process> queued;
+	bool finished;
+
+	/// Programs that were started, and those that couldn't be. Only used
+	/// by run().
+	std::list<Process> running;
+	std::vector<Callback> failed;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_PROCESSRUNNER_H_ */
@@ -8,6 +8,7 @@
 
 #include "configcontainer.h"
 #include "download.h"
+#include "filestamp.h"
 
 namespace podboat {
 
@@ -24,8 +25,12 @@ public:
 	/// Synchronize the queue file with \a downloads. Downloads with `DELETED`
 	/// status are removed. If \a also_remove_finished is `true`, `FINISHED`
 	/// downloads are removed too.
+	///
+	/// \a downloads is expected to be what the last call left in it: the
+	/// file is only read if it changed since then, and only written if its
+	/// contents would change.
 	void reload(std::vector<Download>& downloads,
-		bool also_remove_finished = false) const;
+		bool also_remove_finished = false);
 
 private:
 	std::string get_filename(const std::string& str) const;
@@ -34,6 +39,10 @@ private:
 	const newsboat::ConfigContainer& cfg;
 	std::function<void()> cb_require_view_update;
 
+	/// The queue file as the last reload() left it
+	newsboat::FileStamp loaded_stamp;
+	std::string loaded_contents;
+
 	/// A helper type for methods that process the queue file.
 	struct CategorizedDownloads {
 		/// Downloads that should be kept in the queue file.
@@ -55,11 +64,13 @@ private:
 	static nonstd::optional<CategorizedDownloads> categorize_downloads(
 		const std::vector<Download>& downloads, bool also_remove_finished);
 
-	/// Adds downloads from the queue file to the "to keep" category.
-	void update_from_queue_file(CategorizedDownloads& downloads) const;
+	/// Adds downloads from the queue file, which contains \a contents, to the
+	/// "to keep" category.
+	void update_from_queue_file(CategorizedDownloads& downloads,
+		const std::string& contents) const;
 
-	/// Writes "to keep" downloads to the queue file.
-	void write_queue_file(const CategorizedDownloads& downloads) const;
+	/// The contents of a queue file with the "to keep" downloads.
+	static std::string format_queue_file(const CategorizedDownloads& downloads);
 
 	/// If `delete-played-files` is enabled, deletes downloaded files
 	/// corresponding to downloads in the "to delete" category.
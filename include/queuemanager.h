@@ -2,7 +2,12 @@
 #define NEWSBOAT_QUEUEMANAGER_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "filestamp.h"
 
 namespace newsboat {
 
@@ -26,6 +31,13 @@ class QueueManager {
 	ConfigContainer* cfg = nullptr;
 	std::string queue_file;
 
+	/// Feeds may be reloaded, and their enclosures queued, in parallel
+	std::mutex index_mtx;
+	/// The URLs and filenames in the queue file, as of `indexed_stamp`
+	std::unordered_set<std::string> queued_urls;
+	std::unordered_set<std::string> queued_filenames;
+	FileStamp indexed_stamp;
+
 public:
 	/// Construct `QueueManager` instance out of a config container and a path
 	/// to the queue file.
@@ -37,8 +49,15 @@ public:
 
 	/// Add all HTTP and HTTPS enclosures to the queue file
 	EnqueueResult autoenqueue(std::shared_ptr<RssFeed> feed);
+	/// Like the above, but only for \a items of \a feed.
+	EnqueueResult autoenqueue(std::shared_ptr<RssFeed> feed,
+		const std::vector<std::shared_ptr<RssItem>>& items);
 
 private:
+	/// Re-reads the queue file into the index if it changed since the index
+	/// was built, e.g. because Podboat rewrote it.
+	void update_index();
+
 	std::string generate_enqueue_filename(std::shared_ptr<RssItem> item,
 		std::shared_ptr<RssFeed> feed);
 };
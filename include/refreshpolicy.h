@@ -0,0 +1,78 @@
+#ifndef NEWSBOAT_REFRESHPOLICY_H_
+#define NEWSBOAT_REFRESHPOLICY_H_
+
+#include <ctime>
+#include <string>
+
+namespace newsboat {
+
+/// \brief What a feed and its server said about when to check it again.
+///
+/// Every field is 0 if it wasn't given.
+struct RefreshHints {
+	/// RSS's ttl, in seconds.
+	time_t ttl = 0;
+	/// The Syndication module's updatePeriod divided by its
+	/// updateFrequency, in seconds.
+	time_t update_period = 0;
+	/// From Cache-Control's max-age or Expires, as an absolute time.
+	time_t expires = 0;
+	/// From Retry-After, as an absolute time.
+	time_t retry_after = 0;
+	/// Whether the WebSub relay tells when the feed changes, which leaves
+	/// polling as a fallback.
+	bool pushed = false;
+
+	/// Turns RSS's ttl (in minutes) into seconds; 0 if it's not a number.
+	static time_t parse_ttl(const std::string& ttl);
+	/// Turns the Syndication module's updatePeriod ("hourly", "daily" etc.)
+	/// and updateFrequency into seconds; 0 if the period is unknown.
+	static time_t parse_update_period(const std::string& period,
+		const std::string& frequency);
+};
+
+/// \brief How a feed has been failing to reload lately.
+struct FeedFailures {
+	/// Reloads in a row that failed.
+	unsigned int count = 0;
+	/// When the feed is worth trying again; 0 if right away.
+	time_t retry_at = 0;
+	/// Whether the server said the feed was removed for good (HTTP 410),
+	/// which leaves it out of reloads until it's reloaded on its own.
+	bool gone = false;
+};
+
+/// \brief Decides when a feed is worth checking again.
+///
+/// Feeds are checked about twice as often as they've been updating, but
+/// not more often than their publisher asks for, and never sooner than
+/// \a min_interval or later than \a max_interval seconds from now.
+class RefreshPolicy {
+public:
+	RefreshPolicy(time_t min_interval, time_t max_interval);
+
+	/// \brief Returns the time at which to check the feed again.
+	///
+	/// \a observed_interval is the average time between the feed's latest
+	/// articles, or 0 if it isn't known.
+	time_t next_check(const RefreshHints& hints,
+		time_t observed_interval,
+		time_t now) const;
+
+	/// \brief Returns how long to wait before trying a feed again that
+	/// failed \a failures times in a row.
+	///
+	/// The first failure doesn't hold the feed back; every one after that
+	/// doubles the wait, starting from \a first seconds, up to \a longest
+	/// seconds.
+	static time_t retry_delay(unsigned int failures, time_t first,
+		time_t longest);
+
+private:
+	time_t min_interval;
+	time_t max_interval;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_REFRESHPOLICY_H_ */
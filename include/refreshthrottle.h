@@ -0,0 +1,59 @@
+#ifndef NEWSBOAT_REFRESHTHROTTLE_H_
+#define NEWSBOAT_REFRESHTHROTTLE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace newsboat {
+
+/// \brief Runs a refresh at most a given number of times a second, however
+/// often and from however many threads it's asked for.
+///
+/// A request that comes in after a quiet spell refreshes right away, on the
+/// calling thread. Requests that come in sooner than that are merged into a
+/// single refresh that a background thread runs once the interval is over.
+class RefreshThrottle {
+public:
+	using Refresh = std::function<void()>;
+
+	/// A \a per_second of 0 turns throttling off: every request refreshes.
+	RefreshThrottle(Refresh refresh, unsigned int per_second);
+	RefreshThrottle(const RefreshThrottle&) = delete;
+	RefreshThrottle& operator=(const RefreshThrottle&) = delete;
+	/// Drops the refresh that's pending, if any.
+	~RefreshThrottle();
+
+	void set_rate(unsigned int per_second);
+
+	void request();
+	/// Like request(), but always leaves the refresh to the background
+	/// thread, so that the caller never waits for it.
+	void request_in_background();
+
+	/// Whether a refresh has been asked for but hasn't started yet.
+	bool pending();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void request(bool in_background);
+	void run();
+	/// Expects mtx to be locked.
+	Clock::duration interval() const;
+
+	const Refresh refresh;
+	std::mutex mtx;
+	std::condition_variable wakeup;
+	unsigned int per_second;
+	bool dirty;
+	bool stopping;
+	Clock::time_point last_refresh;
+	std::thread worker;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_REFRESHTHROTTLE_H_ */
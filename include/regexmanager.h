@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_REGEXMANAGER_H_
 #define NEWSBOAT_REGEXMANAGER_H_
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <regex.h>
@@ -11,11 +12,15 @@
 #include <vector>
 
 #include "configactionhandler.h"
+#include "literalset.h"
 #include "matcher.h"
 #include "regexowner.h"
 
 namespace newsboat {
 
+class RssFeed;
+class RssItem;
+
 class RegexManager : public ConfigActionHandler {
 public:
 	RegexManager();
@@ -23,9 +28,41 @@ public:
 		const std::vector<std::string>& params) override;
 	void dump_config(std::vector<std::string>& config_output) const override;
 	void quote_and_highlight(std::string& str, const std::string& location);
+	/// \brief Whether quote_and_highlight() finds all the rules whose
+	/// regexes are plain text in a single pass over the text, rather than
+	/// running each of their regexes.
+	///
+	/// Set from `highlight-engine`; off by default.
+	void set_multi_pattern(bool enabled);
 	void remove_last_regex(const std::string& location);
+	/// \brief Has `highlight` collect its regexes rather than compile them,
+	/// until compile_deferred() is called.
+	///
+	/// Everything else about the rules is still checked right away. Used
+	/// while the config file is read, so that a config with many rules
+	/// doesn't compile them one by one.
+	void defer_compiling();
+	/// \brief Compiles the regexes collected since defer_compiling(), on
+	/// all cores at once.
+	///
+	/// Throws ConfigException for the first of them that isn't valid.
+	void compile_deferred();
+	/// \brief Changes whenever a rule is added or removed.
+	///
+	/// Unique across all instances, so that results kept for one aren't
+	/// taken for another's.
+	std::uint64_t revision() const;
 	int article_matches(Matchable* item);
+	/// \brief Like article_matches(Matchable*), but remembers the result
+	/// on \a item until the item, its feed or the rules change.
+	///
+	/// Rules that look at `age` or at article counts are matched every
+	/// time, since those change without the item knowing.
+	int article_matches(RssItem* item);
 	int feed_matches(Matchable* feed);
+	/// Like feed_matches(Matchable*), but remembers the result on \a feed
+	/// until the feed, its article counts or the rules change.
+	int feed_matches(RssFeed* feed);
 	std::map<size_t, std::string> extract_style_tags(std::string& str);
 	void insert_style_tags(std::string& str, std::map<size_t, std::string>& tags);
 	void merge_style_tag(std::map<size_t, std::string>& tags,
@@ -34,12 +71,47 @@ public:
 	std::string get_attrs_stfl_string(const std::string& location, bool hasFocus);
 
 private:
-	typedef std::vector<std::pair<std::shared_ptr<Regex>, std::string>>
+	typedef std::vector<std::pair<std::shared_ptr<const Regex>, std::string>>
 		RegexStyleVector;
 	std::map<std::string, RegexStyleVector> locations;
+
+	/// The rules of a location whose regexes LiteralSet can stand in for
+	struct LiteralRules {
+		explicit LiteralRules(const std::vector<std::string>& literals)
+			: literals(literals)
+		{}
+
+		LiteralSet literals;
+		/// The index into the location's rules of every literal
+		std::vector<unsigned int> rules;
+	};
+	std::shared_ptr<const LiteralRules> literal_rules(const std::string& location);
+	bool multi_pattern = false;
+	/// Built when first needed; cleared whenever the rules change
+	std::map<std::string, std::shared_ptr<const LiteralRules>>
+	literal_rules_by_location;
 	std::vector<std::string> cheat_store_for_dump_config;
+
+	/// A regex of a `highlight` rule that is yet to be compiled
+	struct DeferredRegex {
+		std::string pattern;
+		/// The rule as it was given, for the error message
+		std::string command;
+		/// The location and index of the rules it's for; a rule for "all"
+		/// is one in each location.
+		std::vector<std::pair<std::string, std::size_t>> rules;
+	};
+	bool deferring = false;
+	std::vector<DeferredRegex> deferred;
 	std::vector<std::pair<std::shared_ptr<Matcher>, int>> matchers_article;
 	std::vector<std::pair<std::shared_ptr<Matcher>, int>> matchers_feed;
+	/// See revision()
+	std::uint64_t rules_revision;
+	/// Whether matchers_article look at attributes that neither
+	/// RssItem::revision() nor RssFeed::revision() cover
+	bool article_rules_vary = false;
+	/// Whether matchers_feed look at article counts
+	bool feed_rules_count = false;
 
 	void handle_highlight_action(const std::vector<std::string>& params);
 	void handle_highlight_item_action(const std::string& action,
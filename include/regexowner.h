@@ -12,18 +12,41 @@ namespace newsboat {
 
 class Regex {
 private:
-	explicit Regex(const regex_t& r);
+	Regex(const regex_t& r, const std::string& pattern);
 
 public:
 	~Regex();
 
 	static std::unique_ptr<Regex> compile(const std::string& reg_expression,
 		int regcomp_flags, std::string& error);
+	/// \brief Like compile(), but shares one instance between everyone
+	/// who asks for the same \a reg_expression and \a regcomp_flags.
+	///
+	/// Instances stay shared for as long as someone holds them. The most
+	/// recently requested ones are also kept a while after that, so that
+	/// filters which are parsed again don't compile their patterns again.
+	static std::shared_ptr<const Regex> compile_shared(
+		const std::string& reg_expression, int regcomp_flags, std::string& error);
 	std::vector<std::pair<int, int>> matches(const std::string& input, int max_matches,
 			int flags) const;
+	/// \brief Like matches(), but only looks at \a input from \a offset on.
+	///
+	/// The returned positions are still relative to the start of \a input.
+	/// Unlike matching `input.substr(offset)`, this doesn't copy \a input
+	/// where the platform has REG_STARTEND.
+	std::vector<std::pair<int, int>> matches(const std::string& input,
+			std::size_t offset, int max_matches, int flags) const;
+	/// Whether the regex matches anywhere in \a input.
+	bool is_match(const std::string& input) const;
+	/// The expression the regex was compiled from.
+	const std::string& pattern() const
+	{
+		return pattern_;
+	}
 
 private:
 	regex_t regex;
+	const std::string pattern_;
 };
 
 } // namespace newsboat
@@ -0,0 +1,70 @@
+#ifndef NEWSBOAT_RELOADDAEMON_H_
+#define NEWSBOAT_RELOADDAEMON_H_
+
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/optional.hpp"
+
+#include "configcontainer.h"
+#include "controlsocket.h"
+
+namespace newsboat {
+
+class Controller;
+
+/// \brief Keeps the feeds up to date without a user interface, and reloads
+/// them whenever another Newsboat asks.
+///
+/// Started by `newsboat -x daemon`, it holds on to the cache and the lock
+/// for as long as it runs. Other instances that were told to execute
+/// commands pass them on through the ControlSocket instead of loading the
+/// feeds themselves; see forward_commands(). A reload that's asked for
+/// while one is running doesn't start another one, but waits for it.
+class ReloadDaemon {
+public:
+	ReloadDaemon(Controller& ctrl, ConfigContainer& cfg,
+		const std::string& socket_path);
+	ReloadDaemon(const ReloadDaemon&) = delete;
+	ReloadDaemon& operator=(const ReloadDaemon&) = delete;
+	~ReloadDaemon();
+
+	/// Serves until SIGINT, SIGTERM, or the `quit` command. Returns the
+	/// exit code.
+	int run();
+
+	/// The socket of the daemon that uses \a cache_file.
+	static std::string socket_path(const std::string& cache_file);
+
+	/// Has the daemon listening at \a socket_path execute \a cmds, and
+	/// prints what it answers. Returns the exit code, or nullopt if no
+	/// daemon listens there.
+	static nonstd::optional<int> forward_commands(
+		const std::string& socket_path,
+		const std::vector<std::string>& cmds);
+
+private:
+	void handle(const ControlSocket::Request& request);
+	void start_reload();
+	/// Answers the clients that waited for the reload, once it's done.
+	void finish_reload();
+	std::string unread_message() const;
+
+	Controller& ctrl;
+	ConfigContainer& cfg;
+	ControlSocket socket;
+
+	std::thread reload_thread;
+	std::atomic<bool> reload_done;
+	bool reloading;
+	std::vector<ControlSocket::Request> waiting;
+	time_t next_reload;
+	bool stopping;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_RELOADDAEMON_H_ */
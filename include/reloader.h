@@ -2,32 +2,76 @@
 #define NEWSBOAT_RELOADER_H_
 
 #include <atomic>
+#include <condition_variable>
+#include <ctime>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "configcontainer.h"
+#include "curlshare.h"
+#include "refreshpolicy.h"
+#include "reloadreport.h"
 
 namespace newsboat {
 
+class AutoDiscardMessage;
 class Cache;
+class CacheWriter;
 class Controller;
 class CurlHandle;
+struct FeedUpdate;
+class FetchResults;
+class RssFeed;
+class RssParser;
 
 /// \brief Updates feeds (fetches, parses, puts results into Controller).
 class Reloader {
 public:
-	Reloader(Controller* c, Cache* cc, ConfigContainer* cfg);
+	/// If `connection-cache` is set, the addresses of the feeds' servers and
+	/// the TLS sessions with them are kept in \a connection_cache_file
+	/// between runs.
+	Reloader(Controller* c, Cache* cc, ConfigContainer* cfg,
+		const std::string& connection_cache_file = "");
 
 	/// \brief Creates detached thread that runs periodic updates.
+	///
+	/// Changes to the settings it goes by wake it up; see
+	/// wait_for_settings().
 	void spawn_reloadthread();
 
+	/// \brief Waits until \a until, or forever if it's 0, unless
+	/// `auto-reload`, `reload-time` or `websub-relay-dir` changes before.
+	///
+	/// Returns true if one of them changed, including before the call.
+	/// Used by ReloadThread, so that it sleeps until there's something to
+	/// do.
+	bool wait_for_settings(time_t until);
+
 	/// \brief Starts a thread that will reload feeds with specified
 	/// indexes.
 	///
 	/// If \a indexes is empty, all feeds will be reloaded.
 	void start_reload_all_thread(const std::vector<int>& indexes = {});
 
+	/// \brief Starts a thread that runs one of the periodic reloads.
+	///
+	/// Like start_reload_all_thread(), but with `reload-adaptive` enabled,
+	/// only the feeds that are due are reloaded.
+	void start_scheduled_reload_thread();
+
+	/// \brief Starts a thread that asks the remote API for the feeds the
+	/// account is subscribed to, and updates the feed list.
+	///
+	/// Used when startup went with the list that was stored last time.
+	/// If \a then_reload is true, all feeds are reloaded afterwards.
+	/// Reloads that start in the meantime wait or are skipped, so they
+	/// don't work on a list that's about to change.
+	void start_subscriptions_refresh_thread(bool then_reload);
+
 	/// \brief Reloads given feed.
 	///
 	/// Reloads the feed at position \a pos in the feeds list (as kept by
@@ -37,12 +81,13 @@ public:
 		reload(pos, false, unattended);
 	}
 
-	/// \brief Reloads all feeds, spawning threads as necessary.
+	/// \brief Reloads all feeds.
 	///
-	/// Only updates status bar if \a unattended is false. The number of
-	/// threads spawned is controlled by the user via reload-threads
-	/// setting.
-	void reload_all(bool unattended = false);
+	/// Only updates status bar if \a unattended is false. If \a only_due
+	/// is true, feeds that schedule_next_checks() or record_failures() put
+	/// off until later are skipped. Feeds that are gone are always
+	/// skipped. See reload_feeds() for how the work is spread out.
+	void reload_all(bool unattended = false, bool only_due = false);
 
 	/// \brief Reloads all feeds with given indexes in feedlist.
 	///
@@ -50,13 +95,20 @@ public:
 	void reload_indexes(const std::vector<int>& indexes,
 		bool unattended = false);
 
-	/// \brief Reloads feeds occupying positions from \a start to \a end in
-	/// feedlist.
+	/// \brief Reloads the feeds that the WebSub relay said changed; see
+	/// WebSubRelay.
 	///
-	/// Only updates status bar if \a unattended is false.
-	void reload_range(unsigned int start,
-		unsigned int end,
-		bool unattended = false);
+	/// Returns false if there's no relay, i.e. `websub-relay-dir` isn't
+	/// set. While other feeds are being reloaded, what the relay pushed is
+	/// left for a later call.
+	bool reload_pushed();
+
+	/// \brief Compresses a batch of stored articles or reclaims a small
+	/// part of the cache's free space, unless feeds are being reloaded
+	/// right now.
+	///
+	/// Returns true if there's more work left for later calls.
+	bool compact_cache();
 
 private:
 	/// \brief Reloads given feed.
@@ -66,8 +118,12 @@ private:
 	/// (`[<progress>/<total_feeds>]`) should be included when updating the status
 	/// message (at the bottom of the screen). Status messages are only shown
 	/// if \a unattended is false. All network requests are made through
-	/// \a easyhandle. If the handle is not provided, this method creates
-	/// a temporary handle which is destroyed before returning from it.
+	/// \a easyhandle, which is made to use curl_share. If the handle is not
+	/// provided, this method creates a temporary handle which is destroyed
+	/// before returning from it.
+	/// If \a writer is provided, the downloaded feed is queued on it rather
+	/// than written to the cache right away. If \a hints is provided, it's
+	/// set to what the feed said about when to check it again.
 	void reload(unsigned int pos,
 		bool show_progress,
 		bool unattended);
@@ -75,7 +131,68 @@ private:
 	void reload(unsigned int pos,
 		CurlHandle& easyhandle,
 		bool show_progress,
-		bool unattended);
+		bool unattended,
+		CacheWriter* writer = nullptr,
+		RefreshHints* hints = nullptr);
+
+	std::shared_ptr<AutoDiscardMessage> show_loading_message(
+		const RssFeed& feed, bool show_progress);
+	std::unique_ptr<RssParser> make_parser(const RssFeed& feed);
+	/// \brief Runs \a action, and returns the message to show the user if
+	/// it fails the way a reload of \a feed can fail; otherwise, returns an
+	/// empty string.
+	std::string catch_reload_errors(const RssFeed& feed,
+		const std::function<void()>& action);
+	/// \brief Hands \a newfeed over to \a writer, or replaces \a oldfeed
+	/// with it right away if there's no writer. \a newfeed may be null if
+	/// there was nothing new.
+	void store_feed(unsigned int pos,
+		std::shared_ptr<RssFeed> oldfeed,
+		std::shared_ptr<RssFeed> newfeed,
+		bool unattended,
+		CacheWriter* writer);
+	void report_reload_error(RssFeed& feed, const std::string& errmsg);
+
+	/// \brief Stores when to check each of the feeds in \a hints next,
+	/// counting from \a reload_start, if `reload-adaptive` is enabled.
+	///
+	/// \a hints is keyed by feed URL.
+	void schedule_next_checks(
+		const std::unordered_map<std::string, RefreshHints>& hints,
+		time_t reload_start);
+
+	/// \brief Counts the failures of the feeds that were just reloaded, and
+	/// puts off the next try of those that keep failing; see
+	/// `reload-backoff-max-time`.
+	///
+	/// \a http_statuses holds the last HTTP status of the feeds that were
+	/// reloaded, keyed by feed URL; 0 if there was none.
+	void record_failures(const std::unordered_map<std::string, long>&
+		http_statuses,
+		time_t reload_start);
+
+	/// \brief Lists the feeds' WebSub hubs for the relay, if
+	/// `websub-relay-dir` is set.
+	void update_websub_subscriptions();
+
+	/// \brief Has curl_share keep the cookies in `cookie-cache`, if it's
+	/// set, reading them from the file again.
+	///
+	/// curl_share.save_cookies() writes them back once the feeds are in.
+	void load_cookies();
+
+	/// \brief Puts a downloaded feed into the cache and the feeds list.
+	///
+	/// Runs on the CacheWriter thread during multi-feed reloads.
+	void write_feed(const FeedUpdate& update);
+
+	/// \brief Adds the articles cached by older versions to the search
+	/// index, a batch per job on the CPU pool at low priority.
+	///
+	/// Returns right away; while a backfill is going, calling it again does
+	/// nothing. Until the index is complete, searches scan the table.
+	void start_search_index_backfill();
+	void index_search_batch();
 
 	/// \brief Notify in various ways that there are new unread feeds or
 	/// articles.
@@ -97,16 +214,50 @@ private:
 	}
 	bool trylock_reload_mutex();
 
-	void partition_reload_to_threads(
-		std::function<void(unsigned int start, unsigned int end)> handle_range,
-		unsigned int num_feeds);
+	struct PendingReload;
+
+	/// \brief Reloads the feeds at \a positions in the feeds list.
+	///
+	/// Feeds that are fetched over plain HTTP are all downloaded by a single
+	/// thread, up to reload-max-downloads at a time, so a reload takes
+	/// about as long as the slowest server. As their downloads finish, they
+	/// are parsed by reload-parse-threads workers, one per core by default.
+	/// The scripts of `exec:` and `filter:` feeds are run by a
+	/// ProcessRunner, up to reload-plugin-processes at a time, and their
+	/// output is parsed by the same workers. Every other kind of feed is
+	/// fetched and parsed by reload-threads workers. The feeds in view and those the user reads are started
+	/// first; see ReloadOrder. A single CacheWriter puts the results into the cache; it's
+	/// drained before this method returns.
+	void reload_feeds(const std::vector<unsigned int>& positions,
+		bool unattended);
+
+	/// \brief Puts what the fetch workers sent into the cache and the
+	/// feeds list, instead of reloading the feeds; see FetchResults.
+	void apply_fetch_results(bool unattended);
 
 	Controller* ctrl;
 	Cache* rsscache;
 	ConfigContainer* cfg;
+	/// Used by every handle that reloads feeds, so feeds on the same host
+	/// reuse its DNS entry, TLS session and connections.
+	CurlShare curl_share;
+	const std::string connection_cache_file;
+	/// Whether curl_share has read connection_cache_file yet
+	bool connection_cache_loaded;
 	std::mutex reload_mutex;
 	std::atomic<unsigned int> reload_progress;
+	/// Whether start_search_index_backfill() has a job queued or running
+	std::atomic<bool> indexing_for_search;
 	unsigned int reload_progress_max;
+	/// What reload_feeds() measures, if `reload-report-file` is set
+	std::unique_ptr<ReloadReport> report;
+	/// What reload_feeds() sends to the coordinator, on a fetch worker
+	std::unique_ptr<FetchResults> fetch_results;
+
+	/// What wakes up the ReloadThread in wait_for_settings()
+	std::mutex settings_mtx;
+	std::condition_variable settings_changed;
+	bool settings_dirty;
 };
 
 } // namespace newsboat
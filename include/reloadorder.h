@@ -0,0 +1,44 @@
+#ifndef NEWSBOAT_RELOADORDER_H_
+#define NEWSBOAT_RELOADORDER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Decides in which order the feeds of a reload are started, so the
+/// ones the user is looking at are up to date first.
+///
+/// The feeds on the screen, or open, come first. Next are the feeds the
+/// user reads, most read first, and then the rest. Otherwise, feeds that
+/// took the longest to reload before are started first, so they aren't the
+/// only ones left at the end.
+class ReloadOrder {
+public:
+	/// \a in_view are the URLs of the feeds on the screen or open;
+	/// \a read_counts and \a download_times are keyed by feed URL, like
+	/// Cache::fetch_read_counts() and Cache::fetch_download_times().
+	ReloadOrder(std::unordered_set<std::string> in_view,
+		std::unordered_map<std::string, std::int64_t> read_counts,
+		std::unordered_map<std::string, std::int64_t> download_times);
+
+	/// Returns the indexes of \a feedurls in the order the feeds should be
+	/// started in.
+	std::vector<std::size_t> sort(const std::vector<std::string>& feedurls)
+	const;
+
+private:
+	std::int64_t lookup(const std::unordered_map<std::string, std::int64_t>&
+		values, const std::string& feedurl) const;
+
+	const std::unordered_set<std::string> in_view;
+	const std::unordered_map<std::string, std::int64_t> read_counts;
+	const std::unordered_map<std::string, std::int64_t> download_times;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_RELOADORDER_H_ */
@@ -0,0 +1,73 @@
+#ifndef NEWSBOAT_RELOADREPORT_H_
+#define NEWSBOAT_RELOADREPORT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "3rd-party/json.hpp"
+
+namespace newsboat {
+
+/// \brief What one reload did for each feed, and how long each step took,
+/// for `reload-report-file`.
+///
+/// The Reloader's threads report on the feeds as they go, in any order.
+/// The report is written as a JSON object with an entry per feed, in the
+/// order they were first reported on, and a summary with the totals and
+/// the percentiles of every duration.
+class ReloadReport {
+public:
+	ReloadReport();
+
+	/// Takes what curl measured while \a handle downloaded \a url.
+	void add_download(const std::string& url, CURL* handle);
+	/// \a unchanged is true if the body was the same as last time, so it
+	/// wasn't parsed.
+	void add_parse(const std::string& url,
+		std::chrono::steady_clock::duration time, bool unchanged);
+	void add_write(const std::string& url,
+		std::chrono::steady_clock::duration time, unsigned int articles_added);
+	void add_error(const std::string& url, const std::string& message);
+
+	nlohmann::json to_json() const;
+
+	/// Writes the report to \a path, replacing whatever is there, or to
+	/// stdout if \a path is "-". Returns false on errors.
+	bool write(const std::string& path) const;
+
+private:
+	struct Feed {
+		long http_status = 0;
+		/// The durations are in milliseconds; -1 if not measured
+		double dns = -1;
+		double connect = -1;
+		double tls = -1;
+		double ttfb = -1;
+		double transfer = -1;
+		double parse = -1;
+		double write = -1;
+		std::uint64_t bytes = 0;
+		unsigned int downloads = 0;
+		bool body_unchanged = false;
+		unsigned int articles_added = 0;
+		std::string error;
+	};
+
+	/// Returns the entry for \a url; the lock has to be held.
+	Feed& feed_unlocked(const std::string& url);
+
+	const std::chrono::system_clock::time_point started;
+	const std::chrono::steady_clock::time_point started_steady;
+	mutable std::mutex mtx;
+	std::vector<std::pair<std::string, Feed>> feeds;
+	std::unordered_map<std::string, std::size_t> positions;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_RELOADREPORT_H_ */
@@ -8,9 +8,14 @@
 #include <vector>
 
 #include "configcontainer.h"
+#include "curlhandlepool.h"
+#include "requestbudget.h"
+#include "utils.h"
 
 namespace newsboat {
 
+class Cache;
+
 typedef std::pair<std::string, std::vector<std::string>> TaggedFeedUrl;
 
 typedef struct {
@@ -35,6 +40,45 @@ public:
 	virtual bool update_article_flags(const std::string& oldflags,
 		const std::string& newflags,
 		const std::string& guid) = 0;
+	/// \brief Lists the guids of all the unread articles on the server,
+	/// without their content.
+	///
+	/// Lets the read state of the cached articles be brought up to date
+	/// at once (see Cache::sync_unread_by_guid()), instead of by fetching
+	/// each feed. Returns false if the backend can't list them, or the
+	/// list couldn't be fetched in full.
+	virtual bool fetch_unread_guids(std::vector<std::string>& /* guids */)
+	{
+		return false;
+	}
+	/// Called before a batch of feeds is reloaded, and after it has been,
+	/// for backends that fetch what the whole reload needs at once.
+	virtual void begin_reload() {}
+	virtual void end_reload() {}
+
+	/// \brief The feeds the account is subscribed to, for the URL readers.
+	///
+	/// Asks the server, through get_subscribed_urls(). Once
+	/// cache_subscriptions() was called, the list is stored in the cache,
+	/// and the first call may return the one stored last time instead,
+	/// without asking.
+	std::vector<TaggedFeedUrl> subscriptions();
+	/// Has subscriptions() keep the list in \a cache, under \a source. If
+	/// \a use_stored is false, it always asks the server.
+	void cache_subscriptions(Cache* cache, const std::string& source,
+		bool use_stored);
+	/// Whether the last subscriptions() call returned the stored list,
+	/// which the server may not agree with anymore.
+	bool subscriptions_were_cached() const
+	{
+		return stored_subscriptions_used;
+	}
+	/// How many more requests the server takes; reloads put off fetching
+	/// feeds, and the RemoteOutbox sending changes, while it's run out.
+	RequestBudget& request_budget()
+	{
+		return budget;
+	}
 	static const std::string read_password(const std::string& file);
 	static const std::string eval_password(const std::string& cmd);
 
@@ -42,10 +86,37 @@ protected:
 	static void update_flag(const std::string& oldflags,
 		const std::string& newflags,
 		char flag, std::function<void(bool added)>&& do_update);
+	/// Calls \a mark with consecutive batches of \a guids, each with at
+	/// most \a batch_size of them, for the backends whose requests take
+	/// several articles at once. Returns whether all of the calls succeeded.
+	static bool mark_in_batches(const std::vector<std::string>& guids,
+		std::size_t batch_size,
+		const std::function<bool(const std::vector<std::string>&)>& mark);
+
+	/// \brief Fetches the answer to a GET request for \a url through
+	/// \a fetch, asking the server only whether it changed if an earlier
+	/// one is kept in the cache.
+	///
+	/// \a fetch passes the request it's given to utils::retrieve_url().
+	/// Meant for what's requested once or twice per session, like the
+	/// subscription lists; the answers are kept once
+	/// cache_subscriptions() was called.
+	std::string revalidate(const std::string& url,
+		const std::function<std::string(utils::ConditionalRequest& request)>&
+		fetch);
 
 	ConfigContainer* cfg;
+	/// Handles for the requests to the server; see CurlHandlePool.
+	CurlHandlePool handles;
 	Credentials get_credentials(const std::string& scope,
 		const std::string& name);
+	RequestBudget budget;
+
+private:
+	Cache* subscription_cache = nullptr;
+	std::string subscription_source;
+	bool stored_subscriptions_usable = false;
+	bool stored_subscriptions_used = false;
 };
 
 } // namespace newsboat
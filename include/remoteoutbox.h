@@ -0,0 +1,80 @@
+#ifndef NEWSBOAT_REMOTEOUTBOX_H_
+#define NEWSBOAT_REMOTEOUTBOX_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace newsboat {
+
+class Cache;
+class RemoteApi;
+
+/// \brief Sends the changes to articles that the remote API should know
+/// about from a background thread, so the UI doesn't wait for the server.
+///
+/// The changes are queued in the cache first (see
+/// Cache::queue_remote_read()), so they survive until they're sent, even
+/// across restarts. Changes to the same article are merged, and articles
+/// that are marked read go out in the API's batch requests. When sending
+/// fails, the thread tries again later, waiting longer after each failure,
+/// and at least until the API's quota starts over if it ran out. A change
+/// is only dropped once the server turned it down while taking others;
+/// while nothing gets through, e.g. while offline, changes stay queued.
+class RemoteOutbox {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// How many changes are sent at once
+	static const unsigned int BATCH_SIZE = 500;
+	/// The number of times the server may turn down a change before it's
+	/// dropped
+	static const unsigned int MAX_ATTEMPTS = 20;
+
+	RemoteOutbox(Cache& cache, RemoteApi& api);
+	RemoteOutbox(const RemoteOutbox&) = delete;
+	RemoteOutbox& operator=(const RemoteOutbox&) = delete;
+	/// Stops the thread; see stop().
+	~RemoteOutbox();
+
+	void mark_article_read(const std::string& guid, bool read);
+	void mark_articles_read(const std::vector<std::string>& guids);
+	void update_article_flags(const std::string& oldflags,
+		const std::string& newflags,
+		const std::string& guid);
+
+	/// Starts the thread, which first sends what was left from last time.
+	void start();
+	/// Sends what's queued, unless the last attempt failed, and stops the
+	/// thread. Whatever isn't sent stays queued for the next start().
+	void stop();
+
+	/// Sends everything that's queued, on the calling thread. Returns
+	/// false if some of it couldn't be sent; that is left queued.
+	bool send_queued();
+
+	/// How long the thread waits after \a failures failed attempts in a
+	/// row before it tries again.
+	static Clock::duration retry_delay(unsigned int failures);
+
+private:
+	void run();
+	/// Tells the thread there's something new to send.
+	void notify();
+
+	Cache& cache;
+	RemoteApi& api;
+
+	std::mutex mtx;
+	std::condition_variable wakeup;
+	bool queued;
+	bool stopping;
+	std::thread worker;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_REMOTEOUTBOX_H_ */
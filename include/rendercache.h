@@ -0,0 +1,97 @@
+#ifndef NEWSBOAT_RENDERCACHE_H_
+#define NEWSBOAT_RENDERCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "3rd-party/optional.hpp"
+
+#include "htmlrenderer.h"
+
+namespace newsboat {
+
+class RssItem;
+
+/// \brief Holds the article views that item_renderer::to_stfl_list()
+/// produced, up to a total size.
+///
+/// Going back to an article, or resizing the terminal back and forth, then
+/// doesn't have to render its HTML again. A view is only handed out while
+/// the item, its feed and the options it was rendered with are the same.
+/// When the views grow past the size, the ones used least recently are
+/// dropped.
+class RenderCache {
+public:
+	/// What a view depends on, besides the item and its feed
+	struct Options {
+		unsigned int text_width;
+		unsigned int window_width;
+		/// `html-renderer`
+		std::string renderer;
+		/// RegexManager::revision()
+		std::uint64_t rules_revision;
+
+		bool operator==(const Options& other) const;
+	};
+
+	struct Rendered {
+		std::string text;
+		std::size_t num_lines;
+		std::vector<LinkPair> links;
+	};
+
+	/// A \a max_bytes of 0 means nothing is kept.
+	explicit RenderCache(std::size_t max_bytes);
+	RenderCache(const RenderCache&) = delete;
+	RenderCache& operator=(const RenderCache&) = delete;
+
+	/// The instance that the article view uses. Its limit is set from
+	/// `article-render-memory-limit` at start up.
+	static RenderCache& shared();
+
+	void set_max_bytes(std::size_t limit);
+
+	/// Returns the view of \a item that was put() with \a options, unless
+	/// the item or its feed changed since.
+	nonstd::optional<Rendered> get(const std::shared_ptr<RssItem>& item,
+		const Options& options);
+	/// Replaces whatever view of \a item was kept before.
+	void put(const std::shared_ptr<RssItem>& item, const Options& options,
+		const Rendered& rendered);
+
+	std::size_t size() const;
+	std::size_t bytes() const;
+
+private:
+	struct Entry {
+		const RssItem* key;
+		/// Tells the item apart from a later one that got the same address
+		std::weak_ptr<RssItem> item;
+		std::uint64_t revision;
+		std::uint64_t feed_revision;
+		std::string base;
+		Options options;
+		Rendered rendered;
+	};
+
+	static std::size_t size_of(const Entry& entry);
+	void erase_unlocked(const RssItem* item);
+	void evict_unlocked();
+
+	mutable std::mutex mtx;
+	std::size_t max_bytes;
+	std::size_t total_bytes;
+	/// Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<const RssItem*, std::list<Entry>::iterator> index;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_RENDERCACHE_H_ */
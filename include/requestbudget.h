@@ -0,0 +1,77 @@
+#ifndef NEWSBOAT_REQUESTBUDGET_H_
+#define NEWSBOAT_REQUESTBUDGET_H_
+
+#include <ctime>
+#include <mutex>
+#include <string>
+
+namespace newsboat {
+
+/// \brief Keeps track of how many more requests a remote API takes before
+/// its quota runs out, from what its responses say.
+///
+/// Inoreader counts the requests of a day in two zones, one for reading and
+/// one for changing things, and sends how much of each was used with every
+/// response (X-Reader-Zone1-Usage etc.). Other servers send the common
+/// X-RateLimit-* headers, or answer "429 Too Many Requests" with a
+/// Retry-After. Between responses, the requests sent are counted here.
+///
+/// Where reading and writing share a quota, reading stops a bit short of
+/// it, so that marking articles read still gets through: fetching a feed
+/// later costs less than the server disagreeing about what was read.
+/// Thread-safe.
+class RequestBudget {
+public:
+	/// What a request does, for the servers that count them apart.
+	enum class Kind {
+		READ,
+		WRITE,
+	};
+
+	RequestBudget() = default;
+	RequestBudget(const RequestBudget&) = delete;
+	RequestBudget& operator=(const RequestBudget&) = delete;
+
+	/// Takes in \a header, a line of the headers of a response from the
+	/// API, status line included.
+	void read_header(const std::string& header);
+	/// Counts a request of \a kind that's about to be sent.
+	void spend(Kind kind);
+
+	/// Whether a request of \a kind may be sent now.
+	bool allows(Kind kind) const;
+	/// How many seconds are left until allows() does; 0 if it does now.
+	time_t wait_time(Kind kind) const;
+
+private:
+	struct Quota {
+		unsigned long used = 0;
+		/// 0 if unknown
+		unsigned long limit = 0;
+	};
+
+	/// Starts the quotas over if they were reset by now.
+	void start_over(time_t now) const;
+	const Quota& quota(Kind kind) const;
+	/// How many requests of \a kind are left; ULONG_MAX if there's no
+	/// known limit.
+	unsigned long remaining(Kind kind) const;
+
+	mutable std::mutex mtx;
+	mutable Quota reads;
+	mutable Quota writes;
+	/// Whether the server counts writes on their own
+	bool separate_writes = false;
+	/// When the quotas start over; 0 if unknown
+	mutable time_t reset_at = 0;
+	/// Until when the server asked not to be sent anything
+	time_t blocked_until = 0;
+	/// Whether the response whose headers are read was a 429
+	bool too_many_requests = false;
+	/// From X-RateLimit-Remaining, until X-RateLimit-Limit comes
+	long pending_remaining = -1;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_REQUESTBUDGET_H_ */
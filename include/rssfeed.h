@@ -1,14 +1,19 @@
 #ifndef NEWSBOAT_RSSFEED_H_
 #define NEWSBOAT_RSSFEED_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "guidindex.h"
 #include "matchable.h"
 #include "rssitem.h"
+#include "sharedmutex.h"
 #include "utils.h"
 
 namespace newsboat {
@@ -16,8 +21,33 @@ namespace newsboat {
 enum class DlStatus { SUCCESS, TO_BE_DOWNLOADED, DURING_DOWNLOAD, DL_ERROR };
 
 class Cache;
+class TagIndex;
+class TitleIndex;
+
+/// What's known about an item of a feed whose items aren't loaded yet.
+struct ItemSummary {
+	std::string guid;
+	time_t pubDate;
+	bool unread;
+	std::string flags;
+};
 
-class RssFeed : public Matchable {
+/// \brief Counts the distinct guids of the unread articles of the feeds that
+/// report to it, see RssFeed::set_unread_guids().
+class UnreadGuids {
+public:
+	void add(const std::string& guid);
+	void remove(const std::string& guid);
+	unsigned int size() const;
+
+private:
+	/// How many of the reported unread articles have each guid
+	std::unordered_map<std::string, unsigned int> counts;
+	mutable std::mutex mtx;
+};
+
+class RssFeed : public Matchable,
+	public std::enable_shared_from_this<RssFeed> {
 public:
 	explicit RssFeed(Cache* c, const std::string& rssurl);
 	~RssFeed() override;
@@ -30,6 +60,7 @@ public:
 	{
 		title_ = t;
 		utils::trim(title_);
+		++revision_;
 	}
 
 	std::string description() const
@@ -39,6 +70,7 @@ public:
 	void set_description(const std::string& d)
 	{
 		description_ = d;
+		++revision_;
 	}
 
 	/// \brief Feed's canonical URL. Empty if feed was never fetched.
@@ -49,6 +81,7 @@ public:
 	void set_link(const std::string& l)
 	{
 		link_ = l;
+		++revision_;
 	}
 
 	std::string pubDate() const
@@ -58,26 +91,47 @@ public:
 	void set_pubDate(time_t t)
 	{
 		pubDate_ = t;
+		++revision_;
 	}
 
-	bool hidden() const;
+	/// Whether the feed has a tag starting with `!`, which hides it.
+	bool hidden() const
+	{
+		return hidden_;
+	}
 
 	std::vector<std::shared_ptr<RssItem>>& items()
 	{
+		load_items_if_needed();
 		return items_;
 	}
-	void add_item(std::shared_ptr<RssItem> item)
+	/// \brief Like items(), but of a lazy feed, only reads the unread and
+	/// the flagged articles.
+	///
+	/// The rest are read once items() is called. Those may be there
+	/// already, so callers that don't want read articles have to skip them
+	/// all the same.
+	std::vector<std::shared_ptr<RssItem>>& unread_items()
 	{
-		items_.push_back(item);
-		items_guid_map[item->guid()] = item;
+		load_unread_items_if_needed();
+		return items_;
 	}
-	void add_items(const std::vector<std::shared_ptr<RssItem>>& items)
+
+	/// \brief Makes the feed lazy: until its items are first used, it only
+	/// keeps these summaries, which are enough for the item counts.
+	void set_item_summaries(std::vector<ItemSummary> summaries);
+	bool items_loaded() const
 	{
-		for (const auto& item : items) {
-			items_.push_back(item);
-			items_guid_map[item->guid()] = item;
-		}
+		return items_loaded_;
 	}
+	/// \brief Summaries of the articles as they are now: made from the
+	/// articles if they're loaded, the ones set_item_summaries() got
+	/// otherwise. Leaves out deleted articles, and doesn't load any.
+	///
+	/// The caller is responsible for locking the feed.
+	std::vector<ItemSummary> item_summaries() const;
+	void add_item(std::shared_ptr<RssItem> item);
+	void add_items(const std::vector<std::shared_ptr<RssItem>>& items);
 	void set_items(std::vector<std::shared_ptr<RssItem>>& items)
 	{
 		erase_items(items_.begin(), items_.end());
@@ -85,18 +139,8 @@ public:
 	}
 
 	void erase_items(std::vector<std::shared_ptr<RssItem>>::iterator begin,
-		std::vector<std::shared_ptr<RssItem>>::iterator end)
-	{
-		for (auto it = begin; it != end; ++it) {
-			items_guid_map.erase((*it)->guid());
-		}
-		items_.erase(begin, end);
-	}
-	void erase_item(std::vector<std::shared_ptr<RssItem>>::iterator pos)
-	{
-		items_guid_map.erase((*pos)->guid());
-		items_.erase(pos);
-	}
+		std::vector<std::shared_ptr<RssItem>>::iterator end);
+	void erase_item(std::vector<std::shared_ptr<RssItem>>::iterator pos);
 
 	std::shared_ptr<RssItem> get_item_by_guid(const std::string& guid);
 	std::shared_ptr<RssItem> get_item_by_guid_unlocked(
@@ -108,21 +152,73 @@ public:
 		return rssurl_;
 	}
 
-	unsigned int unread_item_count() const;
+	/// \brief Number of unread articles, which is kept up to date as they
+	/// are added, removed, and read, so this doesn't look at them.
+	unsigned int unread_item_count() const
+	{
+		return items_loaded_ || unread_items_loaded_ ? unread_count_
+			: summary_unread_count_;
+	}
 	unsigned int total_item_count() const
 	{
-		return items_.size();
+		return items_loaded_ ? items_.size() : item_summaries_.size();
 	}
+	struct MemoryUsage {
+		/// What the articles take up, added up; see
+		/// RssItem::memory_usage(). Articles that weren't loaded yet don't
+		/// count.
+		std::size_t item_bytes;
+		std::size_t description_bytes;
+		/// The list of the articles and the guid index over it
+		std::size_t index_bytes;
+		/// The summaries kept for lazily loaded articles
+		std::size_t summary_bytes;
+	};
+	/// Roughly how much memory the feed takes up, for the `stats` dialog
+	/// and `--dump-memory-stats`. Query feeds share the articles of the
+	/// other feeds, so only their index_bytes are their own.
+	MemoryUsage memory_usage() const;
 
 	void set_tags(const std::vector<std::string>& tags);
 	bool matches_tag(const std::string& tag);
-	std::string get_tags() const;
+	/// The tags that aren't titles or hidden, each followed by a space.
+	const std::string& get_tags() const
+	{
+		return visible_tags_;
+	}
+	/// All the tags, as set_tags() got them.
+	const std::vector<std::string>& get_tag_list() const
+	{
+		return tags_;
+	}
 	std::string get_firsttag();
 
 	nonstd::optional<std::string> attribute_value(const std::string& attr) const
 	override;
+	nonstd::optional<std::string> attribute_value_by_id(MatchableAttribute id,
+		const std::string& attr) const override;
+	nonstd::optional<std::int64_t> attribute_number_by_id(MatchableAttribute id,
+		std::time_t now) const override;
 
 	void update_items(std::vector<std::shared_ptr<RssFeed>> feeds);
+	/// \brief Brings all the query feeds among \a feeds up to date at once.
+	///
+	/// Does what update_items() does for each of them, but walks the
+	/// articles of the other feeds only once, matching each one against all
+	/// the queries. If a query can't be matched, the MatcherException that
+	/// update_items() would throw for it is thrown once the others are done.
+	static void update_query_feeds(
+		const std::vector<std::shared_ptr<RssFeed>>& feeds);
+	/// \brief Brings a query feed up to date after the feeds with URLs in
+	/// \a replaced_feedurls were replaced in \a feeds.
+	///
+	/// Unlike the other overload, this only matches the items of those
+	/// feeds against the query, and merges the result into the articles
+	/// ordered by \a sort_strategy. Returns false without doing anything
+	/// if the articles were never collected by the other overload.
+	bool update_items(const std::vector<std::shared_ptr<RssFeed>>& feeds,
+		const std::unordered_set<std::string>& replaced_feedurls,
+		const ArticleSortStrategy& sort_strategy);
 
 	bool is_query_feed() const
 	{
@@ -155,7 +251,10 @@ public:
 
 	void set_index(unsigned int i)
 	{
-		idx = i;
+		if (idx != i) {
+			idx = i;
+			++revision_;
+		}
 	}
 
 	void set_order(unsigned int x)
@@ -170,16 +269,40 @@ public:
 	void set_feedptrs(std::shared_ptr<RssFeed> self);
 
 	std::string get_status();
+	DlStatus get_dl_status()
+	{
+		std::lock_guard<std::mutex> guard(status_mutex_);
+		return status_;
+	}
 
 	void reset_status()
 	{
 		std::lock_guard<std::mutex> guard(status_mutex_);
 		status_ = DlStatus::TO_BE_DOWNLOADED;
+		++revision_;
 	}
 	void set_status(DlStatus st)
 	{
 		std::lock_guard<std::mutex> guard(status_mutex_);
 		status_ = st;
+		++revision_;
+	}
+
+	/// \brief Changes whenever the title, description, link, date, tags,
+	/// status or index of the feed do.
+	///
+	/// Article counts aren't covered, since they change with the articles
+	/// rather than with the feed.
+	std::uint64_t revision() const
+	{
+		return revision_;
+	}
+
+	/// Kept for RegexManager::feed_matches(), which the feed list only
+	/// calls with its redraw lock held.
+	HighlightMemo& highlight_memo()
+	{
+		return highlight_memo_;
 	}
 
 	void unload();
@@ -187,20 +310,102 @@ public:
 
 	void mark_all_items_read();
 
+	/// \brief Makes the feed report the guids of its unread articles to
+	/// \a guids while it isn't hidden, or stop reporting if that's nullptr.
+	void set_unread_guids(UnreadGuids* guids);
+	/// \brief Makes the feed keep \a index up to date with its tags and its
+	/// unread count, or stop if that's nullptr.
+	void set_tag_index(TagIndex* index);
+	/// \brief Makes the feed add its articles to \a index and take them out
+	/// as it gains and loses them, or stop if that's nullptr.
+	///
+	/// Articles that haven't been loaded yet aren't added until they are.
+	void set_title_index(TitleIndex* index);
+
+	/// \brief Sets the unread flag of \a item, and updates the counts of
+	/// the feeds it's in. RssItem's setters go through this.
+	static void set_item_unread(RssItem& item, bool unread);
+	/// set_item_unread() for each of \a items, under one lock.
+	static void set_items_unread(
+		const std::vector<std::shared_ptr<RssItem>>& items, bool unread);
+
 	// this is ugly, but makes it possible to lock items use e.g. from the Cache class
-	mutable std::mutex item_mutex;
+	//
+	// Held for writing while the articles, or the feed itself, change, and
+	// through SharedLock while they're only read.
+	mutable SharedMutex item_mutex;
+
+	/// \brief Holds item_mutex for reading the articles, once they're
+	/// loaded.
+	///
+	/// Loading the articles of a lazy feed changes them, so that's done
+	/// first, while item_mutex is held for writing. With \a unread_only,
+	/// only what unread_items() reads is loaded.
+	SharedLock lock_items_for_reading(bool unread_only = false);
 
 private:
+	void load_items_if_needed();
+	void load_unread_items_if_needed();
+	/// Stops reporting the summaries once the unread articles they stand
+	/// for have been read in.
+	void unreport_summaries();
+	/// Sorts the articles that a query just collected and marks them as
+	/// collected; item_mutex has to be held.
+	void finish_query_items();
+
+	/// Adds \a item, which was just added to the items, to the counts.
+	void count_item(const std::shared_ptr<RssItem>& item);
+	/// Takes \a item, which is being removed from the items, out of the
+	/// counts.
+	void uncount_item(const std::shared_ptr<RssItem>& item);
+	/// The rest need the lock that guards the counts to be held.
+	void count_unread(const std::string& guid, bool unread);
+	void report_unread(const std::string& guid, bool unread);
+	/// Reports all of the unread articles, or takes them all back.
+	void report_all_unread(bool unread);
+	void report_summaries(bool unread);
+	/// Tells tag_index_ if unread_item_count() changed.
+	void report_unread_count();
+
 	std::string title_;
 	std::string description_;
 	std::string link_;
 	time_t pubDate_;
 	const std::string rssurl_;
 	std::vector<std::shared_ptr<RssItem>> items_;
-	std::unordered_map<std::string, std::shared_ptr<RssItem>>
-		items_guid_map;
+	GuidIndex guid_index_;
+	/// Readers of the articles build guid_index_ again while they hold
+	/// item_mutex for reading, so it needs a lock of its own
+	std::mutex guid_index_mutex_;
+	// Kept after the items are loaded, so that the counts can be read
+	// without waiting for the load to finish
+	std::vector<ItemSummary> item_summaries_;
+	std::atomic<bool> items_loaded_;
+	std::once_flag items_load_once_;
+	/// Whether unread_items() read what it reads, and items() hasn't yet
+	std::atomic<bool> unread_items_loaded_;
+	std::once_flag unread_items_load_once_;
+	/// Unread articles in items_, and in item_summaries_
+	std::atomic<unsigned int> unread_count_;
+	std::atomic<unsigned int> summary_unread_count_;
+	/// Whether unread_guids_ was told about the summaries rather than the
+	/// items, which is until the items are loaded
+	bool summaries_reported_;
+	UnreadGuids* unread_guids_;
+	TagIndex* tag_index_;
+	TitleIndex* title_index_;
+	/// The unread count that tag_index_ has
+	unsigned int reported_unread_;
 	std::vector<std::string> tags_;
+	std::string visible_tags_;
+	/// Set along with tags_, see hidden()
+	bool hidden_;
 	std::string query;
+	/// Whether update_items() collected the articles of this query feed.
+	bool query_items_collected;
+	/// How the articles were last sorted, unless they were shuffled or
+	/// added to since.
+	nonstd::optional<ArticleSortStrategy> sorted_by;
 
 	Cache* ch;
 
@@ -208,10 +413,12 @@ private:
 	bool is_rtl_;
 	unsigned int idx;
 	unsigned int order;
-	std::mutex items_guid_map_mutex;
 
 	DlStatus status_;
 	std::mutex status_mutex_;
+
+	std::atomic<std::uint64_t> revision_;
+	HighlightMemo highlight_memo_;
 };
 
 } // namespace newsboat
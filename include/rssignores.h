@@ -1,11 +1,15 @@
 #ifndef NEWSBOAT_RSSIGNORES_H_
 #define NEWSBOAT_RSSIGNORES_H_
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "configactionhandler.h"
 #include "matcher.h"
+#include "regexowner.h"
 #include "rssitem.h"
 
 namespace newsboat {
@@ -19,12 +23,55 @@ public:
 	void handle_action(const std::string& action,
 		const std::vector<std::string>& params) override;
 	void dump_config(std::vector<std::string>& config_output) const override;
+	/// \brief Whether \a item is ignored by any of the `ignore-article`
+	/// rules.
+	///
+	/// Only the rules that apply to the item's feed are evaluated; which
+	/// ones those are is worked out once per feed. Safe to call from
+	/// several threads at once.
 	bool matches(RssItem* item);
+	/// \brief Like matches(), for each of \a items.
+	///
+	/// Returns one flag per item, in the same order. Each rule is evaluated
+	/// over all the items of a feed at once. Throws MatcherException if
+	/// any of the rules can't be evaluated for one of the items.
+	std::vector<bool> matches(const std::vector<std::shared_ptr<RssItem>>& items);
+	/// \brief Whether any of the rules that apply to \a feedurl look at
+	/// \a attribute.
+	///
+	/// Lets RssParser evaluate the rules before it works out the parts of
+	/// an article that none of them look at.
+	bool uses_attribute(const std::string& feedurl, MatchableAttribute attribute);
+	/// \brief The `ignore-article` rules that Matcher::sql_condition() can
+	/// translate.
+	///
+	/// Each is a pair of the feed URL the rule applies to, "*" for all of
+	/// them, and the condition. Rules for `regex:` feeds are left out.
+	std::vector<std::pair<std::string, std::string>> sql_conditions();
 	bool matches_lastmodified(const std::string& url);
 	bool matches_resetunread(const std::string& url);
 
 private:
+	using Matchers = std::vector<std::shared_ptr<Matcher>>;
+
+	struct RegexRule {
+		std::shared_ptr<const Regex> regex;
+		std::shared_ptr<Matcher> matcher;
+	};
+
+	std::shared_ptr<const Matchers> matchers_for(const std::string& feedurl);
+
+	/// The rules in the order they were configured, for dump_config().
 	std::vector<FeedUrlExprPair> ignores;
+	/// The same rules again, sorted by what they apply to.
+	Matchers ignores_for_all_feeds;
+	std::unordered_map<std::string, Matchers> ignores_by_feedurl;
+	std::vector<RegexRule> ignores_by_regex;
+
+	std::mutex matchers_mtx;
+	std::unordered_map<std::string, std::shared_ptr<const Matchers>>
+	matchers_by_feedurl;
+
 	std::vector<std::string> ignores_lastmodified;
 	std::vector<std::string> resetflag;
 
@@ -1,9 +1,13 @@
 #ifndef NEWSBOAT_RSSITEM_H_
 #define NEWSBOAT_RSSITEM_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "matchable.h"
 #include "matcher.h"
@@ -16,6 +20,9 @@ class RssFeed;
 struct Description {
 	std::string text;
 	std::string mime;
+	/// What filters match the content against, see content_text(). Null
+	/// until it's first needed.
+	std::shared_ptr<const std::string> plain_text;
 };
 
 class RssItem : public Matchable {
@@ -33,23 +40,24 @@ public:
 	{
 		return link_;
 	}
-	void set_link(const std::string& l);
+	void set_link(std::string l);
 
 	std::string author() const
 	{
-		return author_;
+		return *author_;
 	}
 	void set_author(const std::string& a);
 
-	Description description() const
-	{
-		std::lock_guard<std::mutex> guard(description_mutex);
-		if (description_.has_value()) {
-			return description_.value();
-		}
-		return {"", ""};
-	}
-	void set_description(const std::string& content, const std::string& mime_type);
+	/// Returns the description, reading it from the cache first if it was
+	/// unloaded.
+	Description description() const;
+	void set_description(std::string content, std::string mime_type);
+	/// Sets a description that was read from the cache. Unlike one set by
+	/// set_description(), it's kept in DescriptionLru::shared(), which
+	/// drops it once it hasn't been used for a while.
+	void set_description_from_cache(const std::string& content,
+		const std::string& mime_type);
+	bool description_loaded() const;
 
 	unsigned int size() const
 	{
@@ -75,7 +83,20 @@ public:
 	{
 		return guid_;
 	}
-	void set_guid(const std::string& g);
+	void set_guid(std::string g);
+
+	/// \brief The id of the article's row in the cache, or 0 if that
+	/// isn't known, e.g. for an article that was just downloaded.
+	///
+	/// Lets Cache get at the row without looking its GUID up.
+	std::int64_t row_id() const
+	{
+		return row_id_;
+	}
+	void set_row_id(std::int64_t id)
+	{
+		row_id_ = id;
+	}
 
 	bool unread() const
 	{
@@ -89,14 +110,11 @@ public:
 	{
 		ch = c;
 	}
-	void set_feedurl(const std::string& f)
-	{
-		feedurl_ = f;
-	}
+	void set_feedurl(const std::string& f);
 
 	const std::string& feedurl() const
 	{
-		return feedurl_;
+		return *feedurl_;
 	}
 
 	const std::string& enclosure_url() const
@@ -108,10 +126,10 @@ public:
 		return enclosure_type_;
 	}
 
-	void set_enclosure_url(const std::string& url);
-	void set_enclosure_type(const std::string& type);
+	void set_enclosure_url(std::string url);
+	void set_enclosure_type(std::string type);
 
-	bool enqueued()
+	bool enqueued() const
 	{
 		return enqueued_;
 	}
@@ -134,13 +152,14 @@ public:
 
 	nonstd::optional<std::string> attribute_value(const std::string& attr) const
 	override;
+	nonstd::optional<std::string> attribute_value_by_id(MatchableAttribute id,
+		const std::string& attr) const override;
+	nonstd::optional<std::int64_t> attribute_number_by_id(MatchableAttribute id,
+		std::time_t now) const override;
 
 	void set_feedptr(std::shared_ptr<RssFeed> ptr);
 	void set_feedptr(const std::weak_ptr<RssFeed>& ptr);
-	std::shared_ptr<RssFeed> get_feedptr()
-	{
-		return feedptr_.lock();
-	}
+	std::shared_ptr<RssFeed> get_feedptr() const;
 
 	bool deleted() const
 	{
@@ -153,14 +172,23 @@ public:
 
 	void set_index(unsigned int i)
 	{
-		idx = i;
+		if (idx != i) {
+			idx = i;
+			++revision_;
+		}
+	}
+	/// One more than the position of the item in its feed, as of the last
+	/// time the article list was built.
+	unsigned int get_index() const
+	{
+		return idx;
 	}
 
-	void set_base(const std::string& b)
+	void set_base(std::string b)
 	{
-		base = b;
+		base = std::move(b);
 	}
-	const std::string& get_base()
+	const std::string& get_base() const
 	{
 		return base;
 	}
@@ -169,23 +197,51 @@ public:
 	{
 		override_unread_ = b;
 	}
-	bool override_unread()
+	bool override_unread() const
 	{
 		return override_unread_;
 	}
 
-	void unload()
+	/// Drops the description from memory. It's read back from the cache
+	/// when it's needed again.
+	void unload();
+
+	struct MemoryUsage {
+		/// The item and its strings, except for the interned ones
+		std::size_t item_bytes;
+		/// The description, unless DescriptionLru keeps it
+		std::size_t description_bytes;
+	};
+	/// Roughly how much memory the article takes up, for the `stats`
+	/// dialog.
+	MemoryUsage memory_usage() const;
+
+	/// \brief Changes whenever one of the attributes that filters can match
+	/// does, except for `age` and the ones of the feed.
+	std::uint64_t revision() const
 	{
-		std::lock_guard<std::mutex> guard(description_mutex);
-		description_.reset();
+		return revision_;
+	}
+
+	/// Kept for RegexManager::article_matches(), which is only called by
+	/// the thread that draws the lists.
+	HighlightMemo& highlight_memo()
+	{
+		return highlight_memo_;
 	}
 
 private:
+	/// The text of the description without the markup, which is worked out
+	/// once and then kept with the description.
+	std::shared_ptr<const std::string> plain_text() const;
+
 	std::string title_;
 	std::string link_;
-	std::string author_;
+	/// Interned, since many articles have the same author, and all of
+	/// the articles of a feed have the same URL
+	std::shared_ptr<const std::string> author_;
 	std::string guid_;
-	std::string feedurl_;
+	std::shared_ptr<const std::string> feedurl_;
 	Cache* ch;
 	std::string enclosure_url_;
 	std::string enclosure_type_;
@@ -196,13 +252,26 @@ private:
 	unsigned int idx;
 	unsigned int size_;
 	time_t pubDate_;
-	bool unread_;
-	bool enqueued_;
-	bool deleted_;
-	bool override_unread_;
-
-	mutable std::mutex description_mutex;
-	nonstd::optional<Description> description_;
+	bool unread_ : 1;
+	bool enqueued_ : 1;
+	bool deleted_ : 1;
+	bool override_unread_ : 1;
+
+	/// Guards the description and feedptr_, which merge_rssfeed() sets
+	/// on articles that other threads may be reading
+	mutable std::mutex state_mutex;
+	mutable nonstd::optional<Description> description_;
+	mutable bool description_in_cache_;
+
+	/// The feeds whose unread counts include this article, once for each
+	/// time it's in their items. Only touched by RssFeed, with its lock held.
+	std::vector<RssFeed*> counting_feeds_;
+	friend class RssFeed;
+
+	std::atomic<std::uint64_t> revision_;
+	/// See row_id(); set while other threads may be reading the article
+	std::atomic<std::int64_t> row_id_;
+	HighlightMemo highlight_memo_;
 };
 
 } // namespace newsboat
@@ -1,14 +1,20 @@
 #ifndef NEWSBOAT_RSSPARSER_H_
 #define NEWSBOAT_RSSPARSER_H_
 
+#include <curl/curl.h>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "3rd-party/optional.hpp"
+#include "refreshpolicy.h"
 #include "remoteapi.h"
 #include "rss/feed.h"
 
 namespace rsspp {
 class Item;
+class Parser;
+struct Transfer;
 }
 
 namespace newsboat {
@@ -19,6 +25,7 @@ class CurlHandle;
 class RssFeed;
 class RssIgnores;
 class RssItem;
+class SharedFetchCache;
 
 class RssParser {
 public:
@@ -36,6 +43,84 @@ public:
 		easyhandle = h;
 	}
 
+	/// \brief Whether parse() would download the feed over plain HTTP.
+	///
+	/// Such a download can be left to the caller: prepare_download() sets
+	/// \a handle up for it, and parse_download() takes over once it's done.
+	bool downloads_over_http() const;
+	void prepare_download(CurlHandle& handle, rsspp::Transfer& transfer);
+	/// \brief Like parse(), but for a download set up by prepare_download()
+	/// that ended with \a result.
+	std::shared_ptr<RssFeed> parse_download(CurlHandle& handle,
+		rsspp::Transfer& transfer,
+		CURLcode result);
+	/// \brief Makes the feed from what another instance on the host
+	/// fetched, if that's recent enough not to download it again; see
+	/// `shared-fetch-cache-dir`.
+	///
+	/// Returns false if the feed has to be downloaded. Otherwise, \a feed
+	/// is what parse_download() would have returned.
+	bool parse_shared(std::shared_ptr<RssFeed>& feed);
+	/// \brief Whether fetching the feed is put off because the remote API
+	/// is out of requests for now; see RemoteApi::request_budget().
+	///
+	/// parse() returns nullptr without fetching it then, so the feed keeps
+	/// the articles it has until a later reload.
+	bool defers_fetch() const;
+
+	/// \brief Whether parse() would run a script, for an `exec:` or
+	/// `filter:` feed.
+	///
+	/// Running it can be left to the caller: prepare_plugin() says what to
+	/// run, and parse_plugin_output() takes over once it's done.
+	bool runs_plugin() const;
+	/// \brief Sets \a argv to the command to run, and \a input to what to
+	/// write to its standard input, or to nothing if it reads the user's.
+	///
+	/// For a `filter:` feed, that's the feed, which is downloaded here.
+	/// Throws what parse() would if that fails.
+	void prepare_plugin(std::vector<std::string>& argv,
+		nonstd::optional<std::string>& input);
+	/// Like parse(), but for what the command prepare_plugin() gave wrote.
+	std::shared_ptr<RssFeed> parse_plugin_output(const std::string& output);
+
+	/// \brief Whether the last download got the same body as the one the
+	/// feed was last parsed from.
+	///
+	/// The body isn't parsed again then, so parse() and parse_download()
+	/// return nullptr, but the feed is up to date.
+	bool body_unchanged() const
+	{
+		return unchanged;
+	}
+
+	/// \brief Keeps what the next download parses, for parse_same_as() to
+	/// use for other feeds.
+	void keep_parsed_feed()
+	{
+		keep_parsed = true;
+	}
+	/// \brief Like parse_download(), but for a feed that's fetched from the
+	/// same place as \a source, which downloaded it already.
+	///
+	/// \a source has to have been told to keep_parsed_feed().
+	std::shared_ptr<RssFeed> parse_same_as(const RssParser& source);
+	/// \brief Makes the next download ask for the whole feed, even if it
+	/// was downloaded before.
+	void send_unconditional_request()
+	{
+		unconditional = true;
+	}
+
+	/// \brief What the last download said about when to check the feed
+	/// again.
+	///
+	/// Headers are recorded even if the download then failed.
+	const RefreshHints& refresh_hints() const
+	{
+		return hints;
+	}
+
 private:
 	void replace_newline_characters(std::string& str);
 	std::string render_xhtml_title(const std::string& title,
@@ -45,30 +130,61 @@ private:
 
 	void retrieve_uri(const std::string& uri);
 	void download_http(const std::string& uri);
+	/// Runs the transfer set up on \a handle, as a span in the TraceLog.
+	CURLcode perform(CurlHandle& handle) const;
+	std::unique_ptr<rsspp::Parser> make_http_parser() const;
+	/// The URL the feed at \a uri is fetched from.
+	std::string fetched_url(const std::string& uri) const;
+	/// Parses what another instance fetched from \a uri, if that's recent
+	/// enough. Returns false if there's nothing like that.
+	bool take_shared_response(const std::string& uri);
+	/// Whether feeds are read without building their document tree, as
+	/// the feed-parser setting says.
+	bool parses_streaming() const;
+	/// How many items of a feed are worth parsing: `max-items`, unless
+	/// some of them may get ignored, in which case all of them are.
+	unsigned int parsed_items_limit() const;
+	/// Fetches the feed from where it permanently moved to, if it did;
+	/// the original URL is tried again every so often, in case the
+	/// redirect was taken back.
+	void start_download(const std::string& uri,
+		CurlHandle& handle,
+		rsspp::Transfer& transfer);
+	void finish_download(const std::string& uri,
+		CurlHandle& handle,
+		rsspp::Transfer& transfer,
+		CURLcode result);
+	std::shared_ptr<RssFeed> make_feed();
 	void get_execplugin(const std::string& plugin);
 	void download_filterplugin(const std::string& filter,
 		const std::string& uri);
 	void parse_file(const std::string& file);
 
 	void fill_feed_fields(std::shared_ptr<RssFeed> feed);
-	void fill_feed_items(std::shared_ptr<RssFeed> feed);
+	/// Makes the articles of \a feed out of \a items, moving their
+	/// strings into them.
+	void fill_feed_items(std::shared_ptr<RssFeed> feed,
+		std::vector<rsspp::Item> items);
 
+	// These move what they use out of \a item
 	void set_item_title(std::shared_ptr<RssFeed> feed,
 		std::shared_ptr<RssItem> x,
-		const rsspp::Item& item);
+		rsspp::Item& item);
 	void set_item_author(std::shared_ptr<RssItem> x,
-		const rsspp::Item& item);
+		rsspp::Item& item);
 	void set_item_content(std::shared_ptr<RssItem> x,
-		const rsspp::Item& item);
+		rsspp::Item& item);
 	void set_item_enclosure(std::shared_ptr<RssItem> x,
-		const rsspp::Item& item);
-	std::string get_guid(const rsspp::Item& item) const;
+		rsspp::Item& item);
+	std::string get_guid(rsspp::Item& item) const;
 
+	/// Adds \a item to \a feed, unless \a check_ignores is set and an
+	/// `ignore-article` rule matches it.
 	void add_item_to_feed(std::shared_ptr<RssFeed> feed,
-		std::shared_ptr<RssItem> item);
+		std::shared_ptr<RssItem> item, bool check_ignores);
 
 	void handle_content_encoded(std::shared_ptr<RssItem> x,
-		const rsspp::Item& item) const;
+		rsspp::Item& item) const;
 	void handle_itunes_summary(std::shared_ptr<RssItem> x,
 		const rsspp::Item& item);
 	bool is_html_type(const std::string& type);
@@ -83,12 +199,18 @@ private:
 	ConfigContainer* cfgcont;
 	RssIgnores* ign;
 	rsspp::Feed f;
+	RefreshHints hints;
 	RemoteApi* api;
 	bool is_ttrss;
 	bool is_newsblur;
 	bool is_ocnews;
 	bool is_miniflux;
 	bool is_freshrss;
+	bool unchanged;
+	bool keep_parsed;
+	bool unconditional;
+	/// nullptr if responses aren't shared with other instances
+	std::unique_ptr<SharedFetchCache> shared_cache;
 
 	CurlHandle* easyhandle;
 };
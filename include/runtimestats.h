@@ -0,0 +1,99 @@
+#ifndef NEWSBOAT_RUNTIMESTATS_H_
+#define NEWSBOAT_RUNTIMESTATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "3rd-party/json.hpp"
+
+namespace newsboat {
+
+/// \brief Counters of what Newsboat is doing, for the `stats` command and
+/// the daemon's `stats` request.
+///
+/// Unlike ScopeStats, these are always kept, since they're only bumped a
+/// few times per feed or per statement: each of them is a relaxed atomic.
+/// snapshot() puts them together with the ScopeStats summaries, which
+/// include the SQL statements while `profile` is set.
+class RuntimeStats {
+public:
+	enum class Counter {
+		/// Compiled statements the cache found in its statement registry,
+		/// and those it had to prepare
+		STATEMENTS_REUSED,
+		STATEMENTS_PREPARED,
+		/// Feeds of the running reload that are being downloaded or
+		/// parsed, and those that haven't been started yet
+		FEEDS_IN_FLIGHT,
+		FEEDS_QUEUED,
+		BYTES_DOWNLOADED,
+		/// Nanoseconds spent parsing feeds, writing them to the cache,
+		/// and preparing the screen
+		PARSE_NS,
+		DATABASE_NS,
+		UI_NS,
+		MATCHER_EVALUATIONS,
+		/// Size of the lines that the lists on the stack of dialogs handed
+		/// to STFL last time
+		LIST_LINE_BYTES,
+	};
+
+	static void add(Counter counter, std::int64_t delta = 1)
+	{
+		counters[static_cast<std::size_t>(counter)].fetch_add(delta,
+			std::memory_order_relaxed);
+	}
+	static std::int64_t get(Counter counter)
+	{
+		return counters[static_cast<std::size_t>(counter)].load(
+				std::memory_order_relaxed);
+	}
+	/// Sets every counter back to zero.
+	static void reset();
+
+	/// \brief The counters and the ScopeStats summaries as a JSON object.
+	///
+	/// Controller::runtime_stats() adds what only it knows, like the
+	/// memory the articles take up.
+	static nlohmann::json snapshot();
+	/// \a snapshot as a table for the `stats` dialog, one value per line.
+	static std::string report(const nlohmann::json& snapshot);
+
+	/// The resident set size of the process, or 0 where it can't be read.
+	static std::size_t resident_bytes();
+
+private:
+	static const std::size_t COUNTERS =
+		static_cast<std::size_t>(Counter::LIST_LINE_BYTES) + 1;
+	static std::array<std::atomic<std::int64_t>, COUNTERS> counters;
+};
+
+/// Adds the time from its construction to its destruction to a counter of
+/// RuntimeStats.
+class RuntimeStatsTimer {
+public:
+	explicit RuntimeStatsTimer(RuntimeStats::Counter counter)
+		: counter(counter)
+		, start(std::chrono::steady_clock::now())
+	{
+	}
+	RuntimeStatsTimer(const RuntimeStatsTimer&) = delete;
+	RuntimeStatsTimer& operator=(const RuntimeStatsTimer&) = delete;
+	~RuntimeStatsTimer()
+	{
+		RuntimeStats::add(counter,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	const RuntimeStats::Counter counter;
+	const std::chrono::steady_clock::time_point start;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_RUNTIMESTATS_H_ */
@@ -1,20 +1,28 @@
 #ifndef NEWSBOAT_SCOPEMEASURE_H_
 #define NEWSBOAT_SCOPEMEASURE_H_
 
+#include <chrono>
 #include <string>
 
 #include "libnewsboat-ffi/src/scopemeasure.rs.h"
 
 namespace newsboat {
 
+/// \brief Writes the time spent in a scope to the log.
+///
+/// While ScopeStats are enabled, the time is also added to
+/// ScopeStats::named() for \a func, and for each stopover. While tracing,
+/// the scope is recorded as a span in the TraceLog.
 class ScopeMeasure {
 public:
 	explicit ScopeMeasure(const std::string& func);
-	~ScopeMeasure() = default;
+	~ScopeMeasure();
 	void stopover(const std::string& son = "");
 
 private:
 	rust::Box<scopemeasure::bridged::ScopeMeasure> rs_object;
+	std::string func;
+	std::chrono::steady_clock::time_point start;
 };
 
 } // namespace newsboat
@@ -0,0 +1,114 @@
+#ifndef NEWSBOAT_SCOPESTATS_H_
+#define NEWSBOAT_SCOPESTATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Collects how long a frequently run scope takes.
+///
+/// ScopeMeasure writes a log line every time its scope is left, which is too
+/// much for code that runs once per article. A ScopeStats instead counts the
+/// runs of its scope and how long they took, and log_all() writes a summary
+/// of every instance. Use it through SCOPE_STATS().
+///
+/// Statistics are only collected while enabled, which is whenever logging
+/// at the debug level or with `profile` set; otherwise timing a scope costs
+/// a single load. ScopeMeasure adds up its scopes in the instances returned
+/// by named().
+class ScopeStats {
+public:
+	struct Summary {
+		std::uint64_t count;
+		std::chrono::nanoseconds total;
+		/// Upper bound on the 99th percentile, exact to within a factor
+		/// of two
+		std::chrono::nanoseconds p99;
+	};
+
+	/// \a name has to outlive the instance; SCOPE_STATS() passes a string
+	/// literal.
+	explicit ScopeStats(const char* name);
+	ScopeStats(const ScopeStats&) = delete;
+	ScopeStats& operator=(const ScopeStats&) = delete;
+	~ScopeStats();
+
+	static void set_enabled(bool enabled);
+	static bool enabled()
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	/// \brief The instance for scope \a name, created on first use.
+	///
+	/// These live until the program exits.
+	static ScopeStats& named(const std::string& name);
+
+	void add(std::chrono::nanoseconds duration);
+	Summary summary() const;
+
+	/// The summaries of every instance that ran at least once, the one
+	/// with the largest total first.
+	static std::vector<std::pair<std::string, Summary>> summaries();
+	/// summaries() as a table, one line per scope.
+	static std::string report();
+	/// Writes report() to the log.
+	static void log_all();
+
+private:
+	/// Bucket i counts the durations below 2^i nanoseconds that didn't fit
+	/// a smaller bucket
+	static const std::size_t BUCKETS = 48;
+
+	static std::atomic<bool> enabled_;
+
+	const char* const name_;
+	std::atomic<std::uint64_t> count;
+	std::atomic<std::uint64_t> total_ns;
+	std::array<std::atomic<std::uint64_t>, BUCKETS> buckets;
+};
+
+/// Adds the time from its construction to its destruction to a ScopeStats.
+class ScopeStatsTimer {
+public:
+	explicit ScopeStatsTimer(ScopeStats& stats)
+		: stats(ScopeStats::enabled() ? &stats : nullptr)
+	{
+		if (this->stats != nullptr) {
+			start = std::chrono::steady_clock::now();
+		}
+	}
+	ScopeStatsTimer(const ScopeStatsTimer&) = delete;
+	ScopeStatsTimer& operator=(const ScopeStatsTimer&) = delete;
+	~ScopeStatsTimer()
+	{
+		if (stats != nullptr) {
+			stats->add(std::chrono::steady_clock::now() - start);
+		}
+	}
+
+private:
+	ScopeStats* const stats;
+	std::chrono::steady_clock::time_point start;
+};
+
+} // namespace newsboat
+
+#define SCOPE_STATS_CONCAT_(a, b) a##b
+#define SCOPE_STATS_CONCAT(a, b) SCOPE_STATS_CONCAT_(a, b)
+
+/// Collects statistics about the rest of the enclosing scope under \a name,
+/// which must be a string literal.
+#define SCOPE_STATS(name)                                                   \
+	static newsboat::ScopeStats SCOPE_STATS_CONCAT(scope_stats_, __LINE__)( \
+		name);                                                          \
+	newsboat::ScopeStatsTimer SCOPE_STATS_CONCAT(scope_stats_timer_,        \
+		__LINE__)(SCOPE_STATS_CONCAT(scope_stats_, __LINE__))
+
+#endif /* NEWSBOAT_SCOPESTATS_H_ */
@@ -0,0 +1,73 @@
+#ifndef NEWSBOAT_SHAREDFETCHCACHE_H_
+#define NEWSBOAT_SHAREDFETCHCACHE_H_
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace newsboat {
+
+/// \brief HTTP responses that the Newsboat instances on a host share,
+/// through the directory set in `shared-fetch-cache-dir`.
+///
+/// A body is stored once under the hash of its content, in `bodies/`.
+/// `urls/` has a file for every URL, named after the hash of the URL, that
+/// says when it was last fetched, its validators, and the hash of its body.
+/// Files are replaced at once, so instances read them while others write.
+///
+/// The users of the directory have to trust each other, since what one of
+/// them stores the others parse. A directory that others may write to is
+/// only used if it's sticky, so that nobody replaces the files of others.
+class SharedFetchCache {
+public:
+	/// What a response for a URL was; the body is read on its own.
+	struct Response {
+		/// When the URL was last fetched or revalidated; 0 if it wasn't.
+		time_t fetched = 0;
+		time_t lastmodified = 0;
+		std::string etag;
+		/// From the Content-Type header.
+		std::string charset;
+		std::uint64_t body_hash = 0;
+	};
+
+	/// Responses are fresh for \a max_age seconds after they're fetched.
+	SharedFetchCache(const std::string& dir, time_t max_age);
+
+	/// Whether responses for \a url may be shared: they aren't if it has a
+	/// user name, since they're probably not meant for everyone.
+	static bool shares(const std::string& url);
+
+	/// Looks up the last response for \a url. Returns false if there's
+	/// none, or its body is gone.
+	bool lookup(const std::string& url, Response& response) const;
+	/// Whether \a response is recent enough not to fetch its URL again.
+	bool is_fresh(const Response& response) const;
+	/// Reads the body of \a response into \a body. Returns false if it's
+	/// gone, or isn't the one with its hash anymore.
+	bool read_body(const Response& response, std::string& body) const;
+
+	/// Stores \a response with \a body as the last one for \a url.
+	void store(const std::string& url, Response response,
+		const std::string& body);
+	/// Marks \a response, which the server said is still current, as
+	/// fetched just now.
+	void revalidate(const std::string& url, Response response);
+
+	/// Removes the URLs and bodies that weren't fetched in \a age seconds.
+	void remove_unused(time_t age);
+
+private:
+	std::string url_path(const std::string& url) const;
+	std::string body_path(std::uint64_t body_hash) const;
+	/// Writes \a contents to \a path through a temporary file.
+	bool replace_file(const std::string& path,
+		const std::string& contents) const;
+
+	std::string dir;
+	time_t max_age;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_SHAREDFETCHCACHE_H_ */
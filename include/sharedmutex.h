@@ -0,0 +1,78 @@
+#ifndef NEWSBOAT_SHAREDMUTEX_H_
+#define NEWSBOAT_SHAREDMUTEX_H_
+
+#include <pthread.h>
+
+namespace newsboat {
+
+/// \brief A lock that many threads can hold for reading at once, or one
+/// thread for writing, like C++17's std::shared_mutex.
+///
+/// It's held for writing through std::lock_guard and std::unique_lock,
+/// and for reading through SharedLock. It isn't recursive in either mode:
+/// a thread that holds it mustn't take it again. Threads waiting to write
+/// go before new readers where the platform allows, so that a steady
+/// stream of readers doesn't keep writers out.
+class SharedMutex {
+public:
+	SharedMutex();
+	~SharedMutex();
+	SharedMutex(const SharedMutex&) = delete;
+	SharedMutex& operator=(const SharedMutex&) = delete;
+
+	void lock()
+	{
+		pthread_rwlock_wrlock(&rwlock);
+	}
+	bool try_lock()
+	{
+		return pthread_rwlock_trywrlock(&rwlock) == 0;
+	}
+	void unlock()
+	{
+		pthread_rwlock_unlock(&rwlock);
+	}
+
+	void lock_shared()
+	{
+		pthread_rwlock_rdlock(&rwlock);
+	}
+	void unlock_shared()
+	{
+		pthread_rwlock_unlock(&rwlock);
+	}
+
+private:
+	pthread_rwlock_t rwlock;
+};
+
+/// Holds a SharedMutex for reading for as long as it's around, like
+/// C++14's std::shared_lock.
+class SharedLock {
+public:
+	explicit SharedLock(SharedMutex& mtx)
+		: mtx(&mtx)
+	{
+		mtx.lock_shared();
+	}
+	SharedLock(SharedLock&& other)
+		: mtx(other.mtx)
+	{
+		other.mtx = nullptr;
+	}
+	SharedLock(const SharedLock&) = delete;
+	SharedLock& operator=(const SharedLock&) = delete;
+	~SharedLock()
+	{
+		if (mtx != nullptr) {
+			mtx->unlock_shared();
+		}
+	}
+
+private:
+	SharedMutex* mtx;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_SHAREDMUTEX_H_ */
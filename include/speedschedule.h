@@ -0,0 +1,45 @@
+#ifndef PODBOAT_SPEEDSCHEDULE_H_
+#define PODBOAT_SPEEDSCHEDULE_H_
+
+#include <string>
+#include <vector>
+
+#include "configactionhandler.h"
+
+#include "3rd-party/optional.hpp"
+
+namespace podboat {
+
+/// \brief The speed limits for all downloads together that the user set
+/// for parts of the day, through `download-speed-schedule`.
+///
+/// Outside of these parts, `max-total-download-speed` applies.
+class SpeedSchedule : public newsboat::ConfigActionHandler {
+public:
+	SpeedSchedule() = default;
+	~SpeedSchedule() override = default;
+	void handle_action(const std::string& action,
+		const std::vector<std::string>& params) override;
+	void dump_config(std::vector<std::string>& config_output) const override;
+
+	/// The limit in KB/s at \a minute of the day (0 to 1439), if a part of
+	/// the schedule covers it; the last of the overlapping parts wins.
+	nonstd::optional<unsigned int> limit_at(unsigned int minute) const;
+	/// The limit for the current local time.
+	nonstd::optional<unsigned int> current_limit() const;
+
+private:
+	struct Period {
+		/// Minutes of the day; a period that wraps around midnight ends
+		/// before it starts.
+		unsigned int start;
+		unsigned int end;
+		unsigned int kbps;
+	};
+
+	std::vector<Period> periods;
+};
+
+} // namespace podboat
+
+#endif /* PODBOAT_SPEEDSCHEDULE_H_ */
@@ -0,0 +1,36 @@
+#ifndef NEWSBOAT_STATSFORMACTION_H_
+#define NEWSBOAT_STATSFORMACTION_H_
+
+#include "formaction.h"
+#include "textviewwidget.h"
+
+namespace newsboat {
+
+/// \brief The dialog of the `stats` command, which shows
+/// Controller::runtime_stats() as they were when it was opened.
+///
+/// It's scrolled with the key bindings of the help dialog.
+class StatsFormAction : public FormAction {
+public:
+	StatsFormAction(View*, std::string formstr, ConfigContainer* cfg);
+	~StatsFormAction() override = default;
+	void prepare() override;
+	void init() override;
+	const std::vector<KeyMapHintEntry>& get_keymap_hint() const override;
+	std::string id() const override
+	{
+		return "help";
+	}
+	std::string title() override;
+
+private:
+	bool process_operation(Operation op,
+		bool automatic = false,
+		std::vector<std::string>* args = nullptr) override;
+	TextviewWidget textview;
+	std::string report;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_STATSFORMACTION_H_ */
@@ -1,11 +1,13 @@
 #ifndef NEWSBOAT_STATUSLINE_H_
 #define NEWSBOAT_STATUSLINE_H_
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace newsboat {
@@ -18,13 +20,22 @@ class IStatus {
 public:
 	virtual void set_status(const std::string& message) = 0;
 	virtual void show_error(const std::string& message) = 0;
+	/// Tells that messages from other threads wait for StatusLine::drain().
+	/// Called from those threads, so it shouldn't block.
+	virtual void messages_pending() {}
 };
 
 class AutoDiscardMessage;
 
+/// Messages from the thread that made the StatusLine, the UI thread, are
+/// passed on right away. The ones from other threads are put on a queue
+/// that they don't wait for each other on, and passed on by drain(). All
+/// the messages that drain() finds are merged, so only the last of, say,
+/// many progress updates gets to the IStatus.
 class StatusLine {
 public:
 	explicit StatusLine(IStatus& s);
+	~StatusLine();
 
 	void show_message(const std::string& message);
 	void show_error(const std::string& message);
@@ -32,11 +43,47 @@ public:
 	std::shared_ptr<AutoDiscardMessage> show_message_until_finished(
 		const std::string& message);
 	void mark_finished(std::uint32_t message_id);
+	/// Changes the text of a message of show_message_until_finished(),
+	/// e.g. to show progress; it's only shown if it's the latest.
+	void update_message(std::uint32_t message_id, const std::string& message);
+
+	/// Passes what the queued messages add up to on to the IStatus.
+	void drain();
 
 private:
+	struct Update {
+		enum class Kind {
+			MESSAGE,
+			ERROR,
+			UNTIL_FINISHED,
+			FINISHED,
+			CHANGED,
+		};
+
+		Kind kind;
+		std::uint32_t message_id;
+		std::string text;
+		Update* next;
+	};
+
+	/// Queues an update, and drains the queue if this is the UI thread.
+	void push(Update::Kind kind, std::uint32_t message_id,
+		const std::string& text = std::string());
+	/// Applies \a update to the messages; returns whether the one that's
+	/// shown changed. Expects m to be locked.
+	bool apply(const Update& update);
+
+	/// The queued updates, newest first; pushed onto without a lock, and
+	/// taken all at once by drain()
+	std::atomic<Update*> pending;
+	std::atomic<std::uint32_t> next_message_id;
+	const std::thread::id ui_thread;
+
+	/// The rest are only touched by drain(), with m locked
 	std::vector<std::pair<std::uint32_t, std::string>> active_messages;
-	std::uint32_t next_message_id;
 	std::uint32_t active_message;
+	std::string shown;
+	bool shown_is_error;
 
 	IStatus& iStatus;
 
@@ -48,6 +95,8 @@ public:
 	AutoDiscardMessage(StatusLine& s, std::uint32_t m_id);
 	~AutoDiscardMessage();
 
+	void update(const std::string& message);
+
 private:
 	StatusLine& status_line;
 	const std::uint32_t message_id;
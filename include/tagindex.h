@@ -0,0 +1,63 @@
+#ifndef NEWSBOAT_TAGINDEX_H_
+#define NEWSBOAT_TAGINDEX_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace newsboat {
+
+class RssFeed;
+
+/// \brief Which feeds have each tag, with the number of them and of their
+/// articles that are unread.
+///
+/// The feeds update it whenever their tags or unread counts change (see
+/// RssFeed::set_tag_index()), so asking for the counts of a tag doesn't go
+/// through the feeds. Tags are interned: each one is looked up once, and
+/// the feeds are indexed by the number it gets.
+class TagIndex {
+public:
+	TagIndex() = default;
+	TagIndex(const TagIndex&) = delete;
+	TagIndex& operator=(const TagIndex&) = delete;
+
+	/// Adds \a feed with \a tags and \a unread articles, replacing what was
+	/// known about it.
+	void add_feed(const RssFeed* feed, const std::vector<std::string>& tags,
+		unsigned int unread);
+	void remove_feed(const RssFeed* feed);
+	void set_unread(const RssFeed* feed, unsigned int unread);
+
+	unsigned int feed_count(const std::string& tag) const;
+	unsigned int unread_feed_count(const std::string& tag) const;
+	unsigned int unread_item_count(const std::string& tag) const;
+
+private:
+	struct TagCounts {
+		unsigned int feeds;
+		unsigned int unread_feeds;
+		unsigned int unread_items;
+	};
+
+	struct FeedEntry {
+		std::vector<unsigned int> tag_ids;
+		unsigned int unread;
+	};
+
+	unsigned int intern(const std::string& tag);
+	const TagCounts* find(const std::string& tag) const;
+	/// Adds the feed of \a entry to the counts of its tags, or takes it out.
+	void count(const FeedEntry& entry, bool add);
+
+	std::unordered_map<std::string, unsigned int> tag_ids;
+	/// Indexed by tag id
+	std::vector<TagCounts> counts;
+	std::unordered_map<const RssFeed*, FeedEntry> feeds;
+	mutable std::mutex mtx;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_TAGINDEX_H_ */
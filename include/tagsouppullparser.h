@@ -1,6 +1,8 @@
 #ifndef NEWSBOAT_TAGSOUPPULLPARSER_H_
 #define NEWSBOAT_TAGSOUPPULLPARSER_H_
 
+#include <cstddef>
+#include <istream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,30 +21,58 @@ public:
 		TEXT
 	};
 
+	/// \brief Parses \a source where it is, without copying it.
+	///
+	/// \a source has to outlive the parser.
+	explicit TagSoupPullParser(const std::string& source);
+	/// Reads everything from \a is up front.
 	TagSoupPullParser(std::istream& is);
+	TagSoupPullParser(const TagSoupPullParser&) = delete;
+	TagSoupPullParser& operator=(const TagSoupPullParser&) = delete;
 	virtual ~TagSoupPullParser();
+
+	/// \brief Whether the `src` of an `<img>` that is a data: URI is handed
+	/// out as just what comes before the data, e.g.
+	/// `data:image/png;base64,`.
+	///
+	/// Inline images can be megabytes of base64, which HtmlRenderer never
+	/// shows; this saves decoding and copying them. Off by default.
+	void set_skip_inline_images(bool skip);
 	nonstd::optional<std::string> get_attribute_value(const std::string& name) const;
 	Event get_event_type() const;
-	std::string get_text() const;
+	const std::string& get_text() const;
 	Event next();
 
 private:
-	std::istream& inputstream;
+	/// A part of the input, pointing into it
+	struct Piece;
+
+	/// What was read from the stream, if the parser was given one
+	std::string owned_input;
+	const char* input;
+	std::size_t input_size;
+	std::size_t pos;
+	/// Set once a read ran into the end of the input
+	bool at_eof;
+	bool skip_inline_images;
 
 	typedef std::pair<std::string, std::string> Attribute;
 	std::vector<Attribute> attributes;
 	std::string text;
 	Event current_event;
 
-	void add_attribute(std::string s);
-	nonstd::optional<std::string> read_tag();
+	Piece read_until(char delimiter, bool& found);
+	void add_attribute(Piece s);
 	Event determine_tag_type();
-	std::string decode_attribute(const std::string& s);
-	std::string decode_entities(const std::string& s);
-	std::string decode_entity(std::string s);
-	void parse_tag(const std::string& tagstr);
+	/// If \a s is a data: URI, with or without quotes, everything before
+	/// its data.
+	nonstd::optional<std::string> data_uri_header(Piece s);
+	std::string decode_attribute(Piece s);
+	void decode_entities(Piece s, std::string& result);
+	std::string decode_entity(Piece s);
+	void parse_tag(Piece tagstr);
 	void handle_tag();
-	void handle_text(char c);
+	void handle_text();
 };
 
 } // namespace newsboat
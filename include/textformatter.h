@@ -32,8 +32,8 @@ public:
 	TextFormatter() = default;
 	~TextFormatter() = default;
 	void add_line(LineType type, std::string line);
-	void add_lines(
-		const std::vector<std::pair<LineType, std::string>>& lines);
+	/// Pass the lines with std::move() if they aren't needed afterwards.
+	void add_lines(std::vector<std::pair<LineType, std::string>> lines);
 	std::pair<std::string, std::size_t> format_text_to_list(
 		RegexManager* r = nullptr,
 		const std::string& location = "",
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "stflpp.h"
 
@@ -14,6 +16,13 @@ public:
 	TextviewWidget(const std::string& textview_name,
 		Stfl::Form& form);
 	void stfl_replace_textview(std::uint32_t number_of_lines, std::string stfl);
+	/// \brief Replaces the lines of the textview with the `{listitem ...}`s
+	/// of \a stfl, a `{list ...}` like the ones ListFormatter makes.
+	///
+	/// Long texts aren't handed to STFL as a whole: only a window of lines
+	/// around the scroll offset is, and it is moved when scrolling gets
+	/// close to its edges. The scroll offsets below are always in lines of
+	/// the whole text.
 	void stfl_replace_lines(std::uint32_t number_of_lines, std::string stfl);
 
 	void scroll_up();
@@ -28,10 +37,28 @@ public:
 
 	std::uint32_t get_width();
 	std::uint32_t get_height();
+
+	/// The first line of the text that STFL has, and how many it has.
+	std::uint32_t get_window_start();
+	std::uint32_t get_window_size();
+
 private:
+	/// Finds where each `{listitem ...}` of text starts and ends; leaves
+	/// items empty if text doesn't look like a list of them.
+	void index_items();
+	/// Whether STFL has all the lines shown when scrolled to \a offset.
+	bool window_covers(std::uint32_t offset);
+	/// Hands STFL the lines around \a offset, or all of them if there
+	/// aren't many.
+	void replace_window(std::uint32_t offset);
+
 	const std::string textview_name;
 	Stfl::Form& form;
 	std::uint32_t num_lines;
+	std::string text;
+	std::vector<std::pair<std::size_t, std::size_t>> items;
+	std::uint32_t window_start;
+	std::uint32_t window_size;
 };
 
 } // namespace newsboat
@@ -0,0 +1,78 @@
+#ifndef NEWSBOAT_TITLEINDEX_H_
+#define NEWSBOAT_TITLEINDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace newsboat {
+
+class RssItem;
+
+/// \brief Which articles have each trigram (three bytes in a row) in their
+/// title or author, for showing matches while a search is being typed.
+///
+/// The feeds add their articles as they get them and take them out when
+/// they lose them (see RssFeed::set_title_index()), so a search doesn't go
+/// to the cache. Like `LIKE` in the cache's searches, it matches
+/// substrings and ignores the case of ASCII letters only. Candidates are
+/// checked against the title and author they have when searching, so an
+/// article whose title changed after it was added can be missed, but never
+/// turns up wrongly.
+class TitleIndex {
+public:
+	TitleIndex() = default;
+	TitleIndex(const TitleIndex&) = delete;
+	TitleIndex& operator=(const TitleIndex&) = delete;
+
+	/// Adds \a item; an article that is in several feeds is added by each
+	/// of them, and stays until each one has removed it.
+	void add_item(const std::shared_ptr<RssItem>& item);
+	void remove_item(const RssItem* item);
+
+	/// \brief Returns the articles whose title or author contains \a query,
+	/// which is UTF-8, leaving out deleted ones.
+	///
+	/// Queries shorter than a trigram check every article. The articles
+	/// come in the order they were added.
+	std::vector<std::shared_ptr<RssItem>> search(const std::string& query)
+	const;
+
+	/// The number of articles that are in the index.
+	std::size_t size() const;
+
+private:
+	struct Entry {
+		std::weak_ptr<RssItem> item;
+		/// What slots has for the article
+		const RssItem* key;
+		std::vector<std::uint32_t> trigrams;
+		/// How many feeds added the article; 0 for a free slot
+		unsigned int refs;
+	};
+
+	static void add_trigrams(const std::string& text,
+		std::vector<std::uint32_t>& trigrams);
+	/// Renumbers the slots without the free ones, once half of the
+	/// postings are theirs.
+	void compact_if_needed();
+
+	/// Indexed by slot. New articles always get a new slot, so the lists
+	/// in postings stay sorted.
+	std::vector<Entry> entries;
+	std::unordered_map<const RssItem*, std::uint32_t> slots;
+	/// The slots of the articles with each trigram, in ascending order. A
+	/// freed slot stays in them until compact_if_needed() runs, so that
+	/// removing an article doesn't scan the long lists of common trigrams.
+	std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings;
+	std::size_t stale_postings = 0;
+	std::size_t total_postings = 0;
+	mutable std::mutex mtx;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_TITLEINDEX_H_ */
@@ -0,0 +1,119 @@
+#ifndef NEWSBOAT_TRACELOG_H_
+#define NEWSBOAT_TRACELOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace newsboat {
+
+/// \brief Records what the threads spent their time on, for looking at it
+/// as a timeline.
+///
+/// Aggregates like ScopeStats tell what's slow, but not how the reload
+/// threads, the cache lock and the UI take turns. While tracing, which
+/// `trace-file` turns on, ScopeMeasure scopes, downloads, parsing, waits
+/// for Cache's lock and redraws are recorded as spans of the thread they
+/// ran on. finish() writes them to the file in the Chrome trace event
+/// format, which chrome://tracing and ui.perfetto.dev open. While not
+/// tracing, recording a span costs a single load.
+class TraceLog {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// The most spans kept; the ones after are dropped.
+	static const std::size_t MAX_SPANS = 1000000;
+
+	/// Starts recording, for finish() to write to \a path.
+	static void start(const std::string& path);
+	static bool enabled()
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	/// \brief Records that the calling thread spent the time from \a begin
+	/// to \a end on \a name.
+	///
+	/// \a detail, e.g. the URL of a download, is shown along with it if
+	/// not empty. Does nothing while not tracing.
+	static void add(const std::string& name, Clock::time_point begin,
+		Clock::time_point end, const std::string& detail = "");
+
+	/// \brief Stops recording, and writes what was recorded to the file
+	/// given to start().
+	///
+	/// Returns false if that couldn't be written. Does nothing if tracing
+	/// wasn't started.
+	static bool finish();
+
+private:
+	static std::atomic<bool> enabled_;
+};
+
+/// Records the time from its construction to its destruction as a span.
+class TraceSpan {
+public:
+	/// \a name has to outlive the instance, like a string literal does.
+	explicit TraceSpan(const char* name)
+		: name(TraceLog::enabled() ? name : nullptr)
+	{
+		if (this->name != nullptr) {
+			begin = TraceLog::Clock::now();
+		}
+	}
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+	~TraceSpan()
+	{
+		if (name != nullptr) {
+			TraceLog::add(name, begin, TraceLog::Clock::now());
+		}
+	}
+
+private:
+	const char* const name;
+	TraceLog::Clock::time_point begin;
+};
+
+/// \brief A \a Mutex whose lock() records the time it waited as a span,
+/// while tracing.
+///
+/// Only waits are recorded: locking it when it's free records nothing.
+template<typename Mutex>
+class TracedMutex {
+public:
+	/// \a name has to outlive the instance, like a string literal does.
+	explicit TracedMutex(const char* name)
+		: name(name)
+	{
+	}
+	TracedMutex(const TracedMutex&) = delete;
+	TracedMutex& operator=(const TracedMutex&) = delete;
+
+	void lock()
+	{
+		if (!TraceLog::enabled()) {
+			mtx.lock();
+		} else if (!mtx.try_lock()) {
+			const auto begin = TraceLog::Clock::now();
+			mtx.lock();
+			TraceLog::add(name, begin, TraceLog::Clock::now());
+		}
+	}
+	bool try_lock()
+	{
+		return mtx.try_lock();
+	}
+	void unlock()
+	{
+		mtx.unlock();
+	}
+
+private:
+	Mutex mtx;
+	const char* const name;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_TRACELOG_H_ */
@@ -1,6 +1,8 @@
 #ifndef NEWSBOAT_TTRSSAPI_H_
 #define NEWSBOAT_TTRSSAPI_H_
 
+#include <functional>
+
 #include "3rd-party/json.hpp"
 #include "cache.h"
 #include "remoteapi.h"
@@ -29,12 +31,14 @@ public:
 	void add_custom_headers(curl_slist** custom_headers) override;
 	bool mark_all_read(const std::string& feed_url) override;
 	bool mark_article_read(const std::string& guid, bool read) override;
+	bool mark_articles_read(const std::vector<std::string>& guids) override;
 	bool update_article_flags(const std::string& oldflags,
 		const std::string& newflags,
 		const std::string& guid) override;
 	rsspp::Feed fetch_feed(const std::string& id);
 	rsspp::Feed fetch_feed(const std::string& id, CurlHandle& cached_handle);
 	bool update_article(const std::string& guid, int field, int mode);
+	bool fetch_unread_guids(std::vector<std::string>& guids) override;
 
 private:
 	void fetch_feeds_per_category(const nlohmann::json& cat,
@@ -46,12 +50,30 @@ private:
 	int parse_category_id(const nlohmann::json& jcatid);
 	unsigned int query_api_level();
 	std::string url_to_id(const std::string& url);
+	/// Sends \a op, and calls \a on_element with each element of the list
+	/// it answers with, as it's parsed. Returns false if the request
+	/// failed, or the answer isn't a list.
+	bool run_list_op(const std::string& op,
+		const std::map<std::string, std::string>& args,
+		CurlHandle& cached_handle,
+		const std::function<void(nlohmann::json& element)>& on_element,
+		bool try_login = true);
+	/// Sends \a op with the session id, and returns the raw reply.
+	std::string send_op(const std::string& op,
+		const std::map<std::string, std::string>& args,
+		CurlHandle& cached_handle);
 	std::string retrieve_sid();
 	std::string sid;
 	std::string auth_info;
 	bool single;
 	std::mutex auth_lock;
 	int api_level = -1;
+	/// With ttrss-incremental-sync, the highest article id fetched so far
+	/// from each feed. Feeds are fetched in full the first time in a
+	/// session, so that changes made elsewhere to the older articles are
+	/// picked up, and only for what's newer from then on.
+	std::map<std::string, int> newest_ids;
+	std::mutex newest_ids_lock;
 };
 
 } // namespace newsboat
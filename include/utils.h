@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <curl/curl.h>
+#include <functional>
 #include <libxml/parser.h>
 #include <memory>
 #include <stdexcept>
@@ -34,6 +35,25 @@ enum class HTTPMethod {
 	DELETE
 };
 
+/// \brief Extra headers, and the validators of a conditional request, for
+/// retrieve_url().
+///
+/// If \a last_modified or \a etag are set, they're sent as
+/// If-Modified-Since and If-None-Match, and replaced with what the answer's
+/// Last-Modified and ETag headers say.
+struct ConditionalRequest {
+	/// Sent as they are, e.g. "X-Auth-Token: secret"
+	std::vector<std::string> headers;
+	time_t last_modified = 0;
+	std::string etag;
+	/// Set if the server answered "304 Not Modified"; the body is empty
+	/// then.
+	bool not_modified = false;
+	/// If set, called with every line of the response headers, status
+	/// line included, e.g. for the rate limits a server sends.
+	std::function<void(const std::string&)> on_header;
+};
+
 std::string strip_comments(const std::string& line);
 std::vector<std::string> tokenize(const std::string& str,
 	std::string delimiters = " \r\n\t");
@@ -60,6 +80,10 @@ std::string locale_to_utf8(const std::string& text);
 
 std::string convert_text(const std::string& text, const std::string& tocode,
 	const std::string& fromcode);
+/// \brief Whether text in \a charset can be taken as UTF-8 as it is.
+///
+/// That's the case for UTF-8 itself, and for ASCII, which is a subset of it.
+bool is_utf8_compatible_charset(const std::string& charset);
 
 std::string get_command_output(const std::string& cmd);
 std::string http_method_str(const HTTPMethod method);
@@ -75,7 +99,8 @@ std::string retrieve_url(const std::string& url,
 	ConfigContainer* cfgcont = nullptr,
 	const std::string& authinfo = "",
 	const std::string* body = nullptr,
-	const HTTPMethod method = HTTPMethod::GET);
+	const HTTPMethod method = HTTPMethod::GET,
+	ConditionalRequest* request = nullptr);
 std::string run_program(const char* argv[], const std::string& input);
 
 std::string resolve_tilde(const std::string&);
@@ -90,12 +115,33 @@ std::wstring str2wstr(const std::string& str);
 std::string wstr2str(const std::wstring& wstr);
 
 std::wstring clean_nonprintable_characters(std::wstring text);
+/// \brief Same as the std::wstring overload, but on \a text in the
+/// locale's encoding.
+///
+/// In UTF-8 locales, it decodes as it goes rather than converting the whole
+/// text to wide characters and back. Bytes that aren't valid UTF-8 are
+/// replaced too.
+std::string clean_nonprintable_characters(const std::string& text);
+
+/// \brief Whether \a text only consists of characters between ' ' and '~'.
+///
+/// Those have the same encoding and a width of 1 in every locale newsboat
+/// supports, so callers can skip decoding such text. Checks eight bytes at a
+/// time.
+bool is_printable_ascii(const std::string& text);
 
 std::string absolute_url(const std::string& url,
 	const std::string& link);
 
 std::string get_useragent(ConfigContainer* cfgcont);
 
+/// \brief Returns the width of \a str when displayed on screen.
+std::size_t strwidth(const std::string& str);
+
+/// \brief Like strwidth(), but STFL tags (e.g. `<b>`, `</>`) have no width,
+/// and the escaped less-than sign `<>` has a width of 1.
+std::size_t strwidth_stfl(const std::string& str);
+
 std::string substr_with_width(const std::string& str,
 	const size_t max_width);
 
@@ -115,6 +161,10 @@ std::string join(const std::vector<std::string>& strings,
 
 std::string censor_url(const std::string& url);
 
+/// The part of \a url that tells which server it's downloaded from,
+/// without the credentials; e.g. "example.com:8080".
+std::string host_of(const std::string& url);
+
 std::string quote_for_stfl(std::string str);
 
 void trim_end(std::string& str);
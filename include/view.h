@@ -2,13 +2,16 @@
 #define NEWSBOAT_VIEW_H_
 
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "3rd-party/optional.hpp"
 
 #include "htmlrenderer.h"
+#include "refreshthrottle.h"
 #include "statusline.h"
 
 namespace newsboat {
@@ -23,6 +26,7 @@ struct FilterNameExprPair;
 class FormAction;
 class ItemListFormAction;
 class ItemViewFormAction;
+class JobProgress;
 class KeyMap;
 struct MacroCmd;
 class RegexManager;
@@ -37,10 +41,25 @@ public:
 		const std::string& value = "");
 
 	void set_feedlist(std::vector<std::shared_ptr<RssFeed>> feeds);
+	/// \brief Rebuilds the feed list from the controller's feeds, at most
+	/// `feedlist-refresh-rate` times a second.
+	///
+	/// Meant for reloads, which change one feed after another from several
+	/// threads; requests that come in too quickly are merged into one.
+	void request_feedlist_update();
 	void update_visible_feeds(std::vector<std::shared_ptr<RssFeed>> feeds);
 	void set_keymap(KeyMap* k);
 	void set_config_container(ConfigContainer* cfgcontainer);
 	StatusLine& get_statusline();
+	/// \brief Runs \a job on a thread of its own, with \a message and the
+	/// job's progress in the status line, and waits for it.
+	///
+	/// Meanwhile, the current dialog is redrawn, and ESC or Ctrl-C cancel
+	/// the job through its JobProgress; it's expected to give up soon
+	/// after. The job mustn't touch the dialogs. What it throws is
+	/// rethrown here. Returns false if the job was cancelled.
+	bool run_job(const std::string& message,
+		const std::function<void(JobProgress&)>& job);
 	Controller* get_ctrl()
 	{
 		return ctrl;
@@ -76,6 +95,7 @@ public:
 		const std::string& searchphrase = "");
 	void push_empty_formaction();
 	void push_help();
+	void push_stats();
 	void push_urlview(const std::vector<LinkPair>& links,
 		std::shared_ptr<RssFeed>& feed);
 	void push_searchresult(std::shared_ptr<RssFeed> feed,
@@ -110,7 +130,12 @@ public:
 	bool get_next_feed(ItemListFormAction& itemlist);
 	bool get_prev_feed(ItemListFormAction& itemlist);
 
-	void prepare_query_feed(std::shared_ptr<RssFeed> feed);
+	/// \brief Collects the articles of query feed \a feed, and sorts them.
+	///
+	/// If \a replaced_feedurls is given, only the articles of those feeds
+	/// are looked at again, unless the articles were never collected.
+	void prepare_query_feed(std::shared_ptr<RssFeed> feed,
+		const std::unordered_set<std::string>* replaced_feedurls = nullptr);
 
 	void force_redraw();
 
@@ -118,6 +143,12 @@ public:
 
 	void feedlist_mark_pos_if_visible(unsigned int pos);
 
+	/// \brief The URLs of the feeds around the feed list's cursor, and of
+	/// the feed that was opened last.
+	///
+	/// Can be called from any thread; the reloader starts with these.
+	std::unordered_set<std::string> feeds_in_view();
+
 	void set_cache(Cache* c);
 
 	std::vector<std::pair<unsigned int, std::string>> get_formaction_names();
@@ -136,8 +167,15 @@ public:
 
 	void inside_qna(bool f);
 	void inside_cmdline(bool f);
+	bool is_in_qna() const
+	{
+		return is_inside_qna;
+	}
 
 	static void ctrl_c_action(int sig);
+	/// Returns whether Ctrl-C was hit since the main loop last looked, and
+	/// keeps the main loop from seeing it.
+	static bool take_ctrl_c();
 
 protected:
 	bool run_commands(const std::vector<MacroCmd>& commands);
@@ -151,6 +189,13 @@ protected:
 	void delete_word(std::shared_ptr<FormAction> fa);
 	bool handle_qna_event(const std::string& event, std::shared_ptr<FormAction> fa);
 	void handle_resize();
+	/// \brief Applies the cursor movements that are already waiting in the
+	/// input queue, without preparing and drawing \a fa for each one.
+	///
+	/// Holding down a key or pasting a run of movement keys then costs one
+	/// redraw rather than one per key. Stops at the first key that isn't a
+	/// movement, and leaves it in the queue.
+	void process_queued_movements(std::shared_ptr<FormAction> fa);
 
 	Controller* ctrl;
 
@@ -161,9 +206,12 @@ protected:
 	std::vector<std::shared_ptr<FormAction>> formaction_stack;
 	unsigned int current_formaction;
 	std::shared_ptr<FeedListFormAction> feedlist_form;
+	/// Guarded by mtx
+	std::string opened_feedurl;
 
 	void set_status(const std::string& msg) override;
 	void show_error(const std::string& msg) override;
+	void messages_pending() override;
 	StatusLine status_line;
 
 	std::vector<std::string> tags;
@@ -180,8 +228,16 @@ protected:
 	const ColorManager& colorman;
 	std::vector<std::string> suggestions;
 
+	// Last, so that their threads stop before the rest of the View is gone
+	RefreshThrottle feedlist_refresh;
+	/// Draws the messages of set_status(), which can come from any thread,
+	/// at most 20 times a second; passes on the messages that other threads
+	/// gave status_line first
+	RefreshThrottle status_redraw;
+
 private:
 	bool try_prepare_query_feed(std::shared_ptr<RssFeed> feed);
+	void redraw_status();
 };
 
 } // namespace newsboat
@@ -0,0 +1,37 @@
+#ifndef NEWSBOAT_WEBSUBRELAY_H_
+#define NEWSBOAT_WEBSUBRELAY_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief Exchanges files with an external WebSub subscriber, the relay,
+/// through the directory set in `websub-relay-dir`.
+///
+/// A WebSub hub notifies its subscribers by calling a public URL, which
+/// Newsboat doesn't have. The relay, running somewhere that has one,
+/// subscribes to what the directory's `subscriptions` file lists, a line of
+/// "<hub> <topic>" for each feed that announced a hub. For every
+/// notification it gets, it appends the topic as a line to `pushed`,
+/// opening the file anew each time.
+class WebSubRelay {
+public:
+	explicit WebSubRelay(const std::string& dir);
+
+	/// Lists \a hubs, pairs of a hub and a topic, in the subscriptions
+	/// file. The file is only replaced if they changed.
+	void write_subscriptions(
+		std::vector<std::pair<std::string, std::string>> hubs);
+
+	/// The topics the relay pushed since the last call, each once.
+	std::vector<std::string> take_pushed();
+
+private:
+	std::string dir;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_WEBSUBRELAY_H_ */
@@ -0,0 +1,45 @@
+#ifndef NEWSBOAT_WORKERPOOL_H_
+#define NEWSBOAT_WORKERPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace newsboat {
+
+/// \brief A fixed number of threads that run jobs from a shared queue, in the
+/// order they were pushed.
+class WorkerPool {
+public:
+	using Job = std::function<void()>;
+
+	explicit WorkerPool(unsigned int threads);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	/// \brief Queues a job. Can be called from within a job, too.
+	void push(Job job);
+
+	/// \brief Waits until all queued jobs are done, including the ones that
+	/// they push, then stops the threads. No jobs can be pushed afterwards.
+	void finish();
+
+private:
+	void run();
+
+	std::mutex queue_mutex;
+	std::condition_variable queue_not_empty;
+	std::deque<Job> queue;
+	bool finished;
+	bool stopped;
+
+	std::vector<std::thread> workers;
+};
+
+} // namespace newsboat
+
+#endif /* NEWSBOAT_WORKERPOOL_H_ */
@@ -82,6 +82,13 @@ void print_usage(const std::string& argv0, const std::string& config_path,
 				"1 to "
 				"6)")
 		},
+		{
+			'-',
+			"log-module",
+			_s("<module>:<loglevel>"),
+			_s("log messages from <module> (a source file, e.g. reloader) "
+				"at <loglevel> instead")
+		},
 		{
 			'd',
 			"log-file",
@@ -101,7 +108,13 @@ void print_usage(const std::string& argv0, const std::string& config_path,
 			_s("import list of read articles from <file>")
 		},
 		{'h', "help", "", _s("this help")},
-		{'-', "cleanup", "", _s("remove unreferenced items from cache")}
+		{'-', "cleanup", "", _s("remove unreferenced items from cache")},
+		{
+			'-',
+			"dump-memory-stats",
+			"",
+			_s("print how much memory the cached articles take up, and quit")
+		}
 	};
 
 	std::stringstream ss;
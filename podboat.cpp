@@ -33,6 +33,10 @@ int main(int argc, char* argv[])
 	try {
 		c.initialize(argc, argv);
 
+		if (c.daemon_mode()) {
+			return c.run_daemon();
+		}
+
 		podboat::PbView v(&c);
 
 		return c.run(v);
@@ -53,9 +53,15 @@ void AtomParser::parse_feed(Feed& f, xmlNode* rootNode)
 			if (rel == "alternate") {
 				f.link = newsboat::utils::absolute_url(
 						globalbase, get_prop(node, "href"));
+			} else if (rel == "hub") {
+				f.hub = newsboat::utils::absolute_url(
+						globalbase, get_prop(node, "href"));
+			} else if (rel == "self") {
+				f.self = newsboat::utils::absolute_url(
+						globalbase, get_prop(node, "href"));
 			}
 		} else if (node_is(node, "updated", ns)) {
-			f.pubDate = w3cdtf_to_rfc822(get_content(node));
+			f.pubDate_ts = parse_w3cdtf(get_content(node));
 		} else if (node_is(node, "author", ns)) {
 			parse_and_update_author(node, author);
 		} else if (node_is(node, "entry", ns)) {
@@ -77,7 +83,7 @@ Item AtomParser::parse_entry(xmlNode* entryNode)
 	Item it;
 	std::string summary;
 	std::string summary_mime_type;
-	std::string updated;
+	time_t updated = 0;
 
 	std::string base = get_prop(entryNode, "base", XML_URI);
 	if (base == "") {
@@ -115,9 +121,9 @@ Item AtomParser::parse_entry(xmlNode* entryNode)
 			it.guid = get_content(node);
 			it.guid_isPermaLink = false;
 		} else if (node_is(node, "published", ns)) {
-			it.pubDate = w3cdtf_to_rfc822(get_content(node));
+			it.pubDate_ts = parse_w3cdtf(get_content(node));
 		} else if (node_is(node, "updated", ns)) {
-			updated = w3cdtf_to_rfc822(get_content(node));
+			updated = parse_w3cdtf(get_content(node));
 		} else if (node_is(node, "link", ns)) {
 			const std::string rel = get_prop(node, "rel");
 			if (rel == "" || rel == "alternate") {
@@ -161,8 +167,8 @@ Item AtomParser::parse_entry(xmlNode* entryNode)
 		it.description_mime_type = summary_mime_type;
 	}
 
-	if (it.pubDate == "") {
-		it.pubDate = updated;
+	if (it.pubDate_ts == 0) {
+		it.pubDate_ts = updated;
 	}
 
 	return it;
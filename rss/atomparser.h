@@ -2,6 +2,7 @@
 #define NEWSBOAT_RSSPP_ATOMPARSER_H_
 
 #include <libxml/tree.h>
+#include <string>
 
 #include "rssparser.h"
 
@@ -19,10 +20,12 @@ struct AtomParser : public RssParser {
 	}
 	~AtomParser() override {}
 
+	/// The MIME type of text whose Atom type attribute is \a type.
+	static std::string content_type_to_mime(const std::string& type);
+
 private:
 	Item parse_entry(xmlNode* itemNode);
 	void parse_and_update_author(xmlNode* authorNode, std::string& author);
-	static std::string content_type_to_mime(const std::string& type);
 	const char* ns;
 };
 
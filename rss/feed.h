@@ -29,6 +29,7 @@ public:
 
 	Feed()
 		: rss_version(UNKNOWN)
+		, pubDate_ts(0)
 	{
 	}
 
@@ -42,7 +43,19 @@ public:
 	std::string language;
 	std::string managingeditor;
 	std::string dc_creator;
+	/// Like Item's
 	std::string pubDate;
+	time_t pubDate_ts;
+	/// How often the publisher says the feed should be checked: RSS's ttl
+	/// (in minutes), and the Syndication module's updatePeriod and
+	/// updateFrequency. Empty if not given.
+	std::string ttl;
+	std::string update_period;
+	std::string update_frequency;
+	/// The WebSub hub that announces the feed's updates, and the URL the
+	/// hub knows the feed by (its "self" link). Empty if not given.
+	std::string hub;
+	std::string self;
 
 	std::vector<Item> items;
 };
@@ -15,8 +15,8 @@ struct Enclosure {
 class Item {
 public:
 	Item()
-		: guid_isPermaLink(false)
-		, pubDate_ts(0)
+		: pubDate_ts(0)
+		, guid_isPermaLink(false)
 	{
 	}
 
@@ -29,7 +29,11 @@ public:
 	std::string author;
 	std::string author_email;
 
+	/// The date as the feed gives it, if it's RFC 822 text that has to be
+	/// parsed still, and the date the parser already made sense of, or 0.
+	/// Parsers of W3CDTF dates only set the latter.
 	std::string pubDate;
+	time_t pubDate_ts;
 	std::string guid;
 	bool guid_isPermaLink;
 
@@ -42,9 +46,6 @@ public:
 	// Atom-specific:
 	std::string base;
 	std::vector<std::string> labels;
-
-	// only required for ttrss support:
-	time_t pubDate_ts;
 };
 
 } // namespace rsspp
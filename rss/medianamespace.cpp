@@ -2,11 +2,10 @@
 
 #include <string>
 
+#include "rsspp_uris.h"
 #include "utils.h"
 #include "xmlutilities.h"
 
-#define MEDIA_RSS_URI "http://search.yahoo.com/mrss/"
-
 using namespace newsboat;
 
 namespace rsspp {
@@ -1,10 +1,17 @@
 #include "parser.h"
 
+#include <cctype>
 #include <cinttypes>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <curl/curl.h>
+#include <libxml/encoding.h>
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h>
 #include <libxml/tree.h>
+#include <mutex>
+#include <strings.h>
 #include <vector>
 
 #include "config.h"
@@ -15,6 +22,7 @@
 #include "rssparser.h"
 #include "rssparserfactory.h"
 #include "rsspp_uris.h"
+#include "streamparser.h"
 #include "strprintf.h"
 #include "utils.h"
 
@@ -23,11 +31,106 @@ using namespace newsboat;
 static size_t my_write_data(void* buffer, size_t size, size_t nmemb,
 	void* userp)
 {
-	std::string* pbuf = static_cast<std::string*>(userp);
-	pbuf->append(static_cast<const char*>(buffer), size * nmemb);
+	rsspp::Transfer* transfer = static_cast<rsspp::Transfer*>(userp);
+	if (!transfer->append_body(static_cast<const char*>(buffer),
+			size * nmemb)) {
+		// Makes curl abort the transfer
+		return 0;
+	}
 	return size * nmemb;
 }
 
+namespace {
+
+/// FNV-1a: much cheaper than the parse it saves, and a collision only makes
+/// us miss one update of a feed.
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+std::uint64_t add_to_hash(std::uint64_t hash, const char* data,
+	std::size_t length)
+{
+	for (std::size_t i = 0; i < length; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/// libxml2 needs this many bytes to detect the encoding of a document.
+const std::size_t XML_ENCODING_DETECTION_SIZE = 4;
+
+/// The documents are only read, so short text can be kept in the node
+/// itself instead of being allocated on its own.
+const int XML_PARSE_OPTIONS =
+	XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING
+	| XML_PARSE_COMPACT;
+
+/// At most this many contexts are kept for reuse. A reload has one in use
+/// for each feed that's downloading or waiting to be parsed.
+const std::size_t MAX_POOLED_CONTEXTS = 32;
+
+/// A context whose dictionary has grown past this many names is dropped
+/// rather than reused, so that a feed full of made-up element names doesn't
+/// stay in memory.
+const std::size_t MAX_DICTIONARY_SIZE = 100000;
+
+/// Push parser contexts that are done with their document. A transfer's
+/// context is set up on the thread that downloads the feed and finished on
+/// the one that parses it, so the pool is shared by all threads.
+class ContextPool {
+public:
+	ContextPool() = default;
+	ContextPool(const ContextPool&) = delete;
+	ContextPool& operator=(const ContextPool&) = delete;
+	~ContextPool()
+	{
+		clear();
+	}
+
+	xmlParserCtxtPtr take()
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		if (contexts.empty()) {
+			return nullptr;
+		}
+		xmlParserCtxtPtr context = contexts.back();
+		contexts.pop_back();
+		return context;
+	}
+
+	void give_back(xmlParserCtxtPtr context)
+	{
+		const std::size_t names = context->dict == nullptr ? 0
+			: static_cast<std::size_t>(xmlDictSize(context->dict));
+		if (names <= MAX_DICTIONARY_SIZE) {
+			std::lock_guard<std::mutex> guard(mtx);
+			if (contexts.size() < MAX_POOLED_CONTEXTS) {
+				contexts.push_back(context);
+				return;
+			}
+		}
+		xmlFreeParserCtxt(context);
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		for (const auto context : contexts) {
+			xmlFreeParserCtxt(context);
+		}
+		contexts.clear();
+	}
+
+private:
+	std::mutex mtx;
+	std::vector<xmlParserCtxtPtr> contexts;
+};
+
+ContextPool context_pool;
+
+}
+
 namespace rsspp {
 
 Parser::Parser(unsigned int timeout,
@@ -37,54 +140,217 @@ Parser::Parser(unsigned int timeout,
 	curl_proxytype proxy_type,
 	const bool ssl_verify)
 	: to(timeout)
+	, connect_to(0)
 	, ua(user_agent)
 	, prx(proxy)
 	, prxauth(proxy_auth)
 	, prxtype(proxy_type)
 	, verify_ssl(ssl_verify)
+	, streaming(true)
+	, max_items(0)
+	, shared_cache(nullptr)
 	, doc(0)
+	, doc_context(nullptr)
 	, lm(0)
 {
 }
 
 Parser::~Parser()
+{
+	free_doc();
+}
+
+void Parser::free_doc()
 {
 	if (doc) {
 		xmlFreeDoc(doc);
+		doc = nullptr;
+	}
+	if (doc_context) {
+		release_context(doc_context);
+		doc_context = nullptr;
 	}
 }
 
-namespace {
+xmlParserCtxtPtr Parser::acquire_context(const char* chunk, std::size_t size,
+	const std::string& url,
+	const xmlSAXHandler* sax)
+{
+	xmlParserCtxtPtr context = context_pool.take();
+	if (context != nullptr
+		&& xmlCtxtResetPush(context, chunk, size, url.c_str(), nullptr) != 0) {
+		xmlFreeParserCtxt(context);
+		context = nullptr;
+	}
+	if (context == nullptr) {
+		context = xmlCreatePushParserCtxt(nullptr, nullptr, chunk, size,
+				url.c_str());
+		if (context == nullptr) {
+			return nullptr;
+		}
+	}
+	// A pooled context still has the callbacks it was last used with.
+	// They're set before the options, which switch some of them off.
+	if (sax != nullptr) {
+		*context->sax = *sax;
+	} else {
+		xmlSAXVersion(context->sax, 2);
+	}
+	context->_private = nullptr;
+	xmlCtxtUseOptions(context, XML_PARSE_OPTIONS);
+	return context;
+}
+
+void Parser::release_context(xmlParserCtxtPtr context)
+{
+	context_pool.give_back(context);
+}
 
-struct HeaderValues {
-	time_t lastmodified;
-	std::string etag;
-	std::string charset;
+Transfer::Transfer()
+	: sent_lastmodified(0)
+	, sent_body_hash(0)
+	, body_size(0)
+	, body_hash(FNV_OFFSET_BASIS)
+	, status(0)
+	, redirects(0)
+	, temporary_redirects(false)
+	, keep_body(false)
+	, budget(nullptr)
+	, custom_headers(nullptr)
+	, xml_parser(nullptr)
+{
+	reset_headers();
+}
 
-	HeaderValues()
-	{
-		reset();
+Transfer::~Transfer()
+{
+	if (custom_headers) {
+		curl_slist_free_all(custom_headers);
+	}
+	if (xml_parser) {
+		xmlFreeDoc(xml_parser->myDoc);
+		xml_parser->myDoc = nullptr;
+		Parser::release_context(xml_parser);
 	}
+}
 
-	void reset()
-	{
-		lastmodified = 0;
-		charset = "utf-8";
-		etag = "";
+bool Transfer::start_parser()
+{
+	xml_parser = Parser::acquire_context(head.c_str(), head.length(), url,
+			stream ? StreamParser::sax_handler() : nullptr);
+	head.clear();
+	if (xml_parser == nullptr) {
+		LOG(Level::ERROR, "rsspp::Transfer::start_parser: couldn't create parser");
+		return false;
 	}
-};
+	if (stream) {
+		stream->attach(xml_parser);
+	}
+
+	// libxml2 works in UTF-8, so ASCII doesn't need a decoder either
+	if (!utils::is_utf8_compatible_charset(charset)) {
+		const xmlCharEncodingHandlerPtr handler =
+			xmlFindCharEncodingHandler(charset.c_str());
+		if (handler != nullptr) {
+			xmlSwitchToEncoding(xml_parser, handler);
+		} else {
+			LOG(Level::WARN,
+				"rsspp::Transfer::start_parser: unknown charset %s",
+				charset);
+		}
+	}
+	return true;
+}
+
+bool Transfer::append_body(const char* data, std::size_t length)
+{
+	body_size += length;
+	body_hash = add_to_hash(body_hash, data, length);
+	if (keep_body) {
+		body.append(data, length);
+	}
+	if (xml_parser == nullptr) {
+		head.append(data, length);
+		if (head.length() < XML_ENCODING_DETECTION_SIZE) {
+			return true;
+		}
+		return start_parser();
+	}
+	xmlParseChunk(xml_parser, data, length, 0);
+	return true;
+}
 
+xmlDocPtr Transfer::finish_body(xmlParserCtxtPtr& context)
+{
+	context = nullptr;
+	if (xml_parser == nullptr) {
+		if (head.empty() || !start_parser()) {
+			return nullptr;
+		}
+	}
+	xmlParseChunk(xml_parser, nullptr, 0, 1);
+	xmlDocPtr doc = xml_parser->myDoc;
+	xml_parser->myDoc = nullptr;
+	context = xml_parser;
+	xml_parser = nullptr;
+	return doc;
+}
+
+bool Transfer::body_unchanged() const
+{
+	return sent_body_hash != 0 && body_size > 0 && body_hash == sent_body_hash;
+}
+
+void Transfer::reset_headers()
+{
+	lastmodified = 0;
+	charset = "utf-8";
+	etag = "";
+	max_age = -1;
+	expires = 0;
+	retry_after = 0;
+}
+
+/// Whether \a header is the header named \a name (which ends in a colon).
+/// HTTP/2 servers send header names in lowercase, so the case doesn't
+/// matter.
+static bool is_header(const std::string& header, const char* name)
+{
+	return strncasecmp(header.c_str(), name, strlen(name)) == 0;
+}
+
+/// Parses an HTTP date like curl_getdate() does, but returns 0 if \a value
+/// isn't one.
+static time_t parse_http_date(std::string value)
+{
+	utils::trim(value);
+	const time_t result = curl_getdate(value.c_str(), nullptr);
+	return result == -1 ? 0 : result;
 }
 
 static size_t handle_headers(void* ptr, size_t size, size_t nmemb, void* data)
 {
 	const auto header = std::string(reinterpret_cast<const char*>(ptr), size * nmemb);
-	HeaderValues* values = static_cast<HeaderValues*>(data);
+	Transfer* values = static_cast<Transfer*>(data);
+	if (values->budget != nullptr) {
+		values->budget->read_header(header);
+	}
 
 	if (header.find("HTTP/") == 0) {
 		// Reset headers if a new response is detected (there might be multiple responses per request in case of a redirect)
-		values->reset();
-	} else if (header.find("Last-Modified:") == 0) {
+		values->reset_headers();
+		// Only a response that's followed by another one was a redirect;
+		// a 304 is the last one
+		if (values->status >= 300 && values->status < 400) {
+			++values->redirects;
+			if (values->status != 301 && values->status != 308) {
+				values->temporary_redirects = true;
+			}
+		}
+		const auto code_start = header.find(' ');
+		values->status = code_start == std::string::npos ? 0 :
+			std::strtol(header.c_str() + code_start, nullptr, 10);
+	} else if (is_header(header, "Last-Modified:")) {
 		const std::string header_value = header.substr(14);
 		time_t r = curl_getdate(header_value.c_str(), nullptr);
 		if (r == -1) {
@@ -103,11 +369,11 @@ static size_t handle_headers(void* ptr, size_t size, size_t nmemb, void* data)
 				// or an up-cast which is always safe.
 				static_cast<int64_t>(values->lastmodified));
 		}
-	} else if (header.find("ETag:") == 0) {
+	} else if (is_header(header, "ETag:")) {
 		values->etag = header.substr(5);
 		utils::trim(values->etag);
 		LOG(Level::DEBUG, "handle_headers: got etag %s", values->etag);
-	} else if (header.find("Content-Type:") == 0) {
+	} else if (is_header(header, "Content-Type:")) {
 		const std::string key = "charset=";
 		const auto charset_index = header.find(key);
 		if (charset_index != std::string::npos) {
@@ -120,6 +386,30 @@ static size_t handle_headers(void* ptr, size_t size, size_t nmemb, void* data)
 				values->charset = charset;
 			}
 		}
+	} else if (is_header(header, "Cache-Control:")) {
+		const std::string key = "max-age=";
+		const auto max_age_index = header.find(key);
+		if (max_age_index != std::string::npos) {
+			values->max_age = std::strtol(
+					header.c_str() + max_age_index + key.size(), nullptr, 10);
+			LOG(Level::DEBUG, "handle_headers: got max-age %ld", values->max_age);
+		}
+	} else if (is_header(header, "Expires:")) {
+		values->expires = parse_http_date(header.substr(8));
+	} else if (is_header(header, "Retry-After:")) {
+		// Either a number of seconds, or a date
+		std::string value = header.substr(12);
+		utils::trim(value);
+		if (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0]))) {
+			values->retry_after = time(nullptr) + std::strtol(value.c_str(),
+					nullptr, 10);
+		} else {
+			values->retry_after = parse_http_date(value);
+		}
+		LOG(Level::DEBUG,
+			"handle_headers: got retry-after %s (%" PRId64 ")",
+			value,
+			static_cast<int64_t>(values->retry_after));
 	}
 
 	return size * nmemb;
@@ -142,21 +432,59 @@ Feed Parser::parse_url(const std::string& url,
 	newsboat::RemoteApi* api,
 	const std::string& cookie_cache)
 {
-	std::string buf;
-	CURLcode ret;
-	curl_slist* custom_headers{};
+	{
+		Transfer transfer;
+		transfer.url = url;
+		Feed feed;
+		if (parse_shared(transfer, feed)) {
+			return feed;
+		}
+	}
+
+	Transfer transfer;
+	prepare_transfer(url, easyhandle, transfer, lastmodified, etag, api,
+		cookie_cache);
+	const CURLcode ret = curl_easy_perform(easyhandle.ptr());
+	return finish_transfer(url, easyhandle, transfer, ret, cookie_cache);
+}
+
+void Parser::prepare_transfer(const std::string& url,
+	newsboat::CurlHandle& easyhandle,
+	Transfer& transfer,
+	time_t lastmodified,
+	const std::string& etag,
+	newsboat::RemoteApi* api,
+	const std::string& cookie_cache)
+{
+	std::string sent_etag = etag;
+	transfer.shared = newsboat::SharedFetchCache::Response();
+	transfer.keep_body = shared_cache != nullptr
+		&& newsboat::SharedFetchCache::shares(url);
+	if (transfer.keep_body && shared_cache->lookup(url, transfer.shared)) {
+		// If what was shared is still current, it's parsed instead of ours
+		lastmodified = transfer.shared.lastmodified;
+		sent_etag = transfer.shared.etag;
+	}
+
+	transfer.sent_lastmodified = lastmodified;
+	transfer.sent_etag = sent_etag;
+	transfer.url = url;
+	transfer.stream.reset(streaming ? new StreamParser(max_items) : nullptr);
 
 	if (!ua.empty()) {
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_USERAGENT, ua.c_str());
 	}
 
+	transfer.budget = nullptr;
 	if (api) {
-		api->add_custom_headers(&custom_headers);
+		api->add_custom_headers(&transfer.custom_headers);
+		transfer.budget = &api->request_budget();
+		transfer.budget->spend(newsboat::RequestBudget::Kind::READ);
 	}
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_URL, url.c_str());
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_SSL_VERIFYPEER, verify_ssl);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_WRITEFUNCTION, my_write_data);
-	curl_easy_setopt(easyhandle.ptr(), CURLOPT_WRITEDATA, &buf);
+	curl_easy_setopt(easyhandle.ptr(), CURLOPT_WRITEDATA, &transfer);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_NOSIGNAL, 1);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_FOLLOWLOCATION, 1);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_MAXREDIRS, 10);
@@ -164,14 +492,14 @@ Feed Parser::parse_url(const std::string& url,
 	// Accept all of curl's built-in encodings
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_ACCEPT_ENCODING, "");
 	if (cookie_cache != "") {
-		curl_easy_setopt(
-			easyhandle.ptr(), CURLOPT_COOKIEFILE, cookie_cache.c_str());
-		curl_easy_setopt(
-			easyhandle.ptr(), CURLOPT_COOKIEJAR, cookie_cache.c_str());
+		easyhandle.use_cookies(cookie_cache);
 	}
 	if (to != 0) {
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_TIMEOUT, to);
 	}
+	if (connect_to != 0) {
+		curl_easy_setopt(easyhandle.ptr(), CURLOPT_CONNECTTIMEOUT, connect_to);
+	}
 
 	if (!prx.empty()) {
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_PROXY, prx.c_str());
@@ -190,8 +518,7 @@ Feed Parser::parse_url(const std::string& url,
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_CAINFO, curl_ca_bundle);
 	}
 
-	HeaderValues hdrs;
-	curl_easy_setopt(easyhandle.ptr(), CURLOPT_HEADERDATA, &hdrs);
+	curl_easy_setopt(easyhandle.ptr(), CURLOPT_HEADERDATA, &transfer);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_HEADERFUNCTION, handle_headers);
 
 	if (lastmodified != 0) {
@@ -201,34 +528,40 @@ Feed Parser::parse_url(const std::string& url,
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_TIMEVALUE, lastmodified);
 	}
 
-	if (etag.length() > 0) {
-		auto header = strprintf::fmt("If-None-Match: %s", etag);
-		custom_headers =
-			curl_slist_append(custom_headers, header.c_str());
+	if (sent_etag.length() > 0) {
+		auto header = strprintf::fmt("If-None-Match: %s", sent_etag);
+		transfer.custom_headers =
+			curl_slist_append(transfer.custom_headers, header.c_str());
 	}
 
-	if (lastmodified != 0 || etag.length() > 0) {
-		custom_headers =
-			curl_slist_append(custom_headers, "A-IM: feed");
+	if (lastmodified != 0 || sent_etag.length() > 0) {
+		transfer.custom_headers =
+			curl_slist_append(transfer.custom_headers, "A-IM: feed");
 	}
 
-	if (custom_headers) {
+	if (transfer.custom_headers) {
 		curl_easy_setopt(
-			easyhandle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
+			easyhandle.ptr(), CURLOPT_HTTPHEADER, transfer.custom_headers);
 	}
+}
 
-	ret = curl_easy_perform(easyhandle.ptr());
-
-	lm = hdrs.lastmodified;
-	et = hdrs.etag;
+Feed Parser::finish_transfer(const std::string& url,
+	newsboat::CurlHandle& easyhandle,
+	Transfer& transfer,
+	CURLcode ret,
+	const std::string& cookie_cache)
+{
+	lm = transfer.lastmodified;
+	et = transfer.etag;
 
-	if (custom_headers) {
+	if (transfer.custom_headers) {
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_HTTPHEADER, 0);
-		curl_slist_free_all(custom_headers);
+		curl_slist_free_all(transfer.custom_headers);
+		transfer.custom_headers = nullptr;
 	}
 
 	LOG(Level::DEBUG,
-		"rsspp::Parser::parse_url: ret = %d (%s)",
+		"rsspp::Parser::finish_transfer: ret = %d (%s)",
 		ret,
 		curl_easy_strerror(ret));
 
@@ -236,15 +569,24 @@ Feed Parser::parse_url(const std::string& url,
 	CURLcode infoOk =
 		curl_easy_getinfo(easyhandle.ptr(), CURLINFO_RESPONSE_CODE, &status);
 
-	curl_easy_reset(easyhandle.ptr());
+	char* effective_url = nullptr;
+	if (ret == CURLE_OK && transfer.redirects > 0 && !transfer.temporary_redirects
+		&& curl_easy_getinfo(easyhandle.ptr(), CURLINFO_EFFECTIVE_URL,
+			&effective_url) == CURLE_OK
+		&& effective_url != nullptr && transfer.url != effective_url) {
+		transfer.moved_to = effective_url;
+		LOG(Level::INFO, "Parser::finish_transfer: %s moved to %s", url,
+			transfer.moved_to);
+	}
+
+	easyhandle.reset();
 	if (cookie_cache != "") {
-		curl_easy_setopt(
-			easyhandle.ptr(), CURLOPT_COOKIEJAR, cookie_cache.c_str());
+		easyhandle.use_cookies(cookie_cache);
 	}
 
 	if (ret != 0) {
 		LOG(Level::ERROR,
-			"rsspp::Parser::parse_url: curl_easy_perform returned "
+			"rsspp::Parser::finish_transfer: transfer returned "
 			"err "
 			"%d: %s",
 			ret,
@@ -265,65 +607,155 @@ Feed Parser::parse_url(const std::string& url,
 	}
 
 	LOG(Level::INFO,
-		"Parser::parse_url: retrieved data for %s: %s",
-		url,
-		buf);
+		"Parser::finish_transfer: retrieved %" PRIu64 " bytes (%s) for %s",
+		static_cast<uint64_t>(transfer.body_size),
+		transfer.charset,
+		url);
+
+	if (transfer.keep_body && shared_cache != nullptr) {
+		if (transfer.status == 304 && transfer.shared.fetched != 0) {
+			shared_cache->revalidate(transfer.url, transfer.shared);
+			lm = transfer.shared.lastmodified;
+			et = transfer.shared.etag;
+			Feed feed;
+			parse_stored(transfer, transfer.shared, feed);
+			return feed;
+		}
+		// Other statuses, like 226 for a delta, aren't the whole feed
+		if (transfer.status == 200 && transfer.body_size > 0) {
+			newsboat::SharedFetchCache::Response response;
+			response.lastmodified = transfer.lastmodified;
+			response.etag = transfer.etag;
+			response.charset = transfer.charset;
+			shared_cache->store(transfer.url, response, transfer.body);
+		}
+		transfer.body.clear();
+	}
 
-	if (buf.length() > 0) {
-		LOG(Level::DEBUG, "Parser::parse_url: converting data from %s to utf-8", hdrs.charset);
-		const auto utf8_buf = utils::convert_text(buf, "utf-8", hdrs.charset);
+	if (transfer.body_unchanged()) {
+		LOG(Level::INFO,
+			"Parser::finish_transfer: %s sent the same body as last time",
+			url);
+		return Feed();
+	}
 
-		LOG(Level::DEBUG, "Parser::parse_url: handing over data to parse_buffer()");
-		return parse_buffer(utf8_buf, url);
+	if (transfer.body_size > 0) {
+		free_doc();
+		doc = transfer.finish_body(doc_context);
+		if (doc == nullptr) {
+			throw Exception(_("could not parse buffer"));
+		}
+		return parse_doc(url, transfer.stream.get());
 	}
 
 	return Feed();
 }
 
+bool Parser::parse_shared(Transfer& transfer, Feed& feed)
+{
+	if (shared_cache == nullptr
+		|| !newsboat::SharedFetchCache::shares(transfer.url)
+		|| !shared_cache->lookup(transfer.url, transfer.shared)
+		|| !shared_cache->is_fresh(transfer.shared)) {
+		return false;
+	}
+	transfer.stream.reset(streaming ? new StreamParser(max_items) : nullptr);
+	if (!parse_stored(transfer, transfer.shared, feed)) {
+		return false;
+	}
+	LOG(Level::INFO,
+		"Parser::parse_shared: %s was fetched by another instance",
+		transfer.url);
+	lm = transfer.shared.lastmodified;
+	et = transfer.shared.etag;
+	return true;
+}
+
+bool Parser::parse_stored(Transfer& transfer,
+	const newsboat::SharedFetchCache::Response& response,
+	Feed& feed)
+{
+	std::string body;
+	if (!shared_cache->read_body(response, body)) {
+		LOG(Level::WARN,
+			"Parser::parse_stored: the shared body of %s is gone",
+			transfer.url);
+		feed = Feed();
+		return false;
+	}
+
+	transfer.keep_body = false;
+	transfer.charset = response.charset;
+	transfer.body_size = body.size();
+	transfer.body_hash = response.body_hash;
+	if (transfer.body_unchanged()) {
+		feed = Feed();
+		return true;
+	}
+
+	transfer.body_size = 0;
+	transfer.body_hash = FNV_OFFSET_BASIS;
+	transfer.append_body(body.c_str(), body.length());
+	free_doc();
+	doc = transfer.finish_body(doc_context);
+	if (doc == nullptr) {
+		throw Exception(_("could not parse buffer"));
+	}
+	feed = parse_doc(transfer.url, transfer.stream.get());
+	return true;
+}
+
 Feed Parser::parse_buffer(const std::string& buffer, const std::string& url)
 {
-	doc = xmlReadMemory(buffer.c_str(),
-			buffer.length(),
-			url.c_str(),
-			nullptr,
-			XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+	free_doc();
+	StreamParser stream(max_items);
+	doc_context = acquire_context(buffer.c_str(), buffer.length(), url,
+			streaming ? StreamParser::sax_handler() : nullptr);
+	if (doc_context != nullptr) {
+		if (streaming) {
+			stream.attach(doc_context);
+		}
+		xmlParseChunk(doc_context, nullptr, 0, 1);
+		doc = doc_context->myDoc;
+		doc_context->myDoc = nullptr;
+	}
 	if (doc == nullptr) {
 		throw Exception(_("could not parse buffer"));
 	}
 
-	xmlNode* root_element = xmlDocGetRootElement(doc);
+	return parse_doc("buffer", streaming ? &stream : nullptr);
+}
 
-	Feed f = parse_xmlnode(root_element);
+Feed Parser::parse_doc(const std::string& origin, StreamParser* stream)
+{
+	Feed f = stream != nullptr ? stream->finish()
+		: parse_xmlnode(xmlDocGetRootElement(doc));
 
 	if (doc->encoding) {
 		f.encoding = (const char*)doc->encoding;
 	}
 
-	LOG(Level::INFO, "Parser::parse_buffer: encoding = %s", f.encoding);
+	LOG(Level::INFO,
+		"Parser::parse_doc: encoding of %s = %s",
+		origin,
+		f.encoding);
 
 	return f;
 }
 
 Feed Parser::parse_file(const std::string& filename)
 {
+	free_doc();
 	doc = xmlReadFile(filename.c_str(),
 			nullptr,
-			XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+			XML_PARSE_OPTIONS);
 	xmlNode* root_element = xmlDocGetRootElement(doc);
 
 	if (root_element == nullptr) {
 		throw Exception(_("could not parse file"));
 	}
 
-	Feed f = parse_xmlnode(root_element);
-
-	if (doc->encoding) {
-		f.encoding = (const char*)doc->encoding;
-	}
-
-	LOG(Level::INFO, "Parser::parse_file: encoding = %s", f.encoding);
-
-	return f;
+	return parse_doc(filename);
 }
 
 Feed Parser::parse_xmlnode(xmlNode* node)
@@ -418,6 +850,7 @@ void Parser::global_init()
 
 void Parser::global_cleanup()
 {
+	context_pool.clear();
 	xmlCleanupParser();
 	curl_global_cleanup();
 }
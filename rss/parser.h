@@ -1,12 +1,17 @@
 #ifndef NEWSBOAT_RSSPPPARSER_H_
 #define NEWSBOAT_RSSPPPARSER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <curl/curl.h>
+#include <ctime>
 #include <libxml/parser.h>
+#include <memory>
 #include <string>
 
 #include "remoteapi.h"
 #include "feed.h"
+#include "sharedfetchcache.h"
 
 namespace newsboat {
 
@@ -16,6 +21,103 @@ class CurlHandle;
 
 namespace rsspp {
 
+class StreamParser;
+
+/// \brief The state of an HTTP transfer set up by Parser::prepare_transfer().
+///
+/// Has to stay in place until the transfer is finished, since curl writes the
+/// response into it. The body isn't kept: it's handed to libxml2's push
+/// parser as it arrives, so the feed is parsed while it's downloading.
+struct Transfer {
+	Transfer();
+	Transfer(const Transfer&) = delete;
+	Transfer& operator=(const Transfer&) = delete;
+	~Transfer();
+
+	/// Resets everything that's taken from the response headers.
+	void reset_headers();
+
+	/// \brief Parses the next \a length bytes of the body.
+	///
+	/// The body is decoded from the charset of the Content-Type header,
+	/// unless that's UTF-8 or ASCII, in which case the XML declaration
+	/// decides.
+	/// Returns false if the parser couldn't be set up.
+	bool append_body(const char* data, std::size_t length);
+	/// \brief Parses the end of the body, and returns the document built
+	/// from all of it, which the caller has to free.
+	///
+	/// \a context is set to the parser context that built the document.
+	/// The document's names are in its dictionary, so the caller has to
+	/// pass it to Parser::release_context() once the document is freed.
+	/// Returns nullptr if there was no body, or nothing could be made of
+	/// it.
+	xmlDocPtr finish_body(xmlParserCtxtPtr& context);
+	/// Whether the body is the one whose hash was given in
+	/// sent_body_hash.
+	bool body_unchanged() const;
+
+	/// What was sent in the conditional request (0 and "" if nothing).
+	time_t sent_lastmodified;
+	std::string sent_etag;
+	/// Where the document came from, for resolving relative URLs in it.
+	std::string url;
+
+	/// The body_hash of the body the feed was last parsed from, or 0 if
+	/// unknown. Parser::finish_transfer() doesn't parse the body if it's the
+	/// same again.
+	std::uint64_t sent_body_hash;
+
+	/// Bytes of the body received so far.
+	std::size_t body_size;
+	/// FNV-1a hash of the body received so far, as it came over the wire.
+	std::uint64_t body_hash;
+	time_t lastmodified;
+	std::string etag;
+	std::string charset;
+	/// From Cache-Control; -1 if not given.
+	long max_age;
+	/// From Expires and Retry-After, as absolute times; 0 if not given.
+	time_t expires;
+	time_t retry_after;
+
+	/// The status of the response whose headers came last; 0 before any.
+	long status;
+	/// How many of the responses were redirects, and whether any of them
+	/// weren't permanent ones (301 and 308).
+	unsigned int redirects;
+	bool temporary_redirects;
+	/// Where the feed was permanently moved to, if the redirects that led
+	/// to it all were permanent; empty otherwise. Set by
+	/// Parser::finish_transfer().
+	std::string moved_to;
+
+	/// What the parser's shared cache had for the URL when the transfer
+	/// was prepared; its `fetched` is 0 if there was nothing.
+	newsboat::SharedFetchCache::Response shared;
+	/// Whether the body is kept in \a body, to share it.
+	bool keep_body;
+	std::string body;
+
+	/// Told about the response headers, for requests to a remote API;
+	/// nullptr otherwise.
+	newsboat::RequestBudget* budget;
+
+	curl_slist* custom_headers;
+
+	/// Builds the feed from the body as it's parsed; nullptr if the
+	/// document tree is built instead.
+	std::unique_ptr<StreamParser> stream;
+
+private:
+	bool start_parser();
+
+	/// The start of the body, until there's enough of it for libxml2 to
+	/// detect the encoding.
+	std::string head;
+	xmlParserCtxtPtr xml_parser;
+};
+
 class Parser {
 public:
 	Parser(unsigned int timeout = 30,
@@ -36,6 +138,40 @@ public:
 		const std::string& etag = "",
 		newsboat::RemoteApi* api = 0,
 		const std::string& cookie_cache = "");
+
+	/// \brief Sets \a easyhandle up to download \a url into \a transfer,
+	/// without starting the download.
+	///
+	/// This lets the caller perform the transfer however it likes, e.g. along
+	/// with many others through curl's multi interface. Once it's done, call
+	/// finish_transfer().
+	void prepare_transfer(const std::string& url,
+		newsboat::CurlHandle& easyhandle,
+		Transfer& transfer,
+		time_t lastmodified = 0,
+		const std::string& etag = "",
+		newsboat::RemoteApi* api = 0,
+		const std::string& cookie_cache = "");
+	/// \brief Parses what a transfer set up by prepare_transfer() has
+	/// received; \a result is what the transfer ended with.
+	///
+	/// Leaves \a easyhandle ready for reuse. Throws rsspp::Exception if the
+	/// transfer failed. Returns an empty Feed if nothing was received, or if
+	/// Transfer::body_unchanged().
+	Feed finish_transfer(const std::string& url,
+		newsboat::CurlHandle& easyhandle,
+		Transfer& transfer,
+		CURLcode result,
+		const std::string& cookie_cache = "");
+
+	/// \brief Parses what another instance fetched from transfer.url, if
+	/// that's recent enough not to fetch it again; see
+	/// set_shared_cache().
+	///
+	/// Returns false if it isn't. Otherwise, \a feed is empty if
+	/// Transfer::body_unchanged().
+	bool parse_shared(Transfer& transfer, Feed& feed);
+
 	Feed parse_buffer(const std::string& buffer,
 		const std::string& url = "");
 	Feed parse_file(const std::string& filename);
@@ -48,18 +184,97 @@ public:
 		return et;
 	}
 
+	/// \brief Whether feeds are read straight from the parser's SAX
+	/// events (the default), rather than from the document tree.
+	///
+	/// Both give the same Feed; streaming is faster and needs less
+	/// memory. Applies to transfers prepared afterwards and to
+	/// parse_buffer(); parse_file() always builds the tree.
+	void set_streaming(bool enabled)
+	{
+		streaming = enabled;
+	}
+
+	/// \brief How many items, in the order of the document, are read of
+	/// each feed while streaming; 0, the default, reads all of them.
+	///
+	/// Applies to transfers prepared afterwards and to parse_buffer().
+	void set_max_items(std::size_t max)
+	{
+		max_items = max;
+	}
+
+	/// \brief How many seconds transfers may take to connect to the
+	/// server, separately from the timeout of the whole transfer.
+	///
+	/// 0, the default, leaves it to curl. Applies to transfers prepared
+	/// afterwards.
+	void set_connect_timeout(unsigned int seconds)
+	{
+		connect_to = seconds;
+	}
+
+	/// \brief Shares the responses of transfers prepared afterwards with
+	/// other instances through \a cache, and asks it for theirs.
+	///
+	/// A transfer for a URL that \a cache has a response for asks the
+	/// server whether that one is still current, and parses it if it is.
+	/// nullptr, the default, shares nothing. \a cache has to outlive the
+	/// transfers.
+	void set_shared_cache(newsboat::SharedFetchCache* cache)
+	{
+		shared_cache = cache;
+	}
+
 	static void global_init();
 	static void global_cleanup();
 
+	/// \brief Returns a push parser context that will first parse the \a
+	/// size bytes at \a chunk of the document at \a url.
+	///
+	/// The context reports to \a sax, or builds the document tree if
+	/// that's nullptr. Contexts are reused: one keeps its dictionary when
+	/// it's reset, so the element and attribute names that feeds share
+	/// aren't allocated anew for every feed. Returns nullptr if libxml2
+	/// couldn't make one.
+	static xmlParserCtxtPtr acquire_context(const char* chunk,
+		std::size_t size,
+		const std::string& url,
+		const xmlSAXHandler* sax = nullptr);
+	/// \brief Keeps \a context for a later acquire_context().
+	///
+	/// The document it built, if any, has to be freed first, since another
+	/// thread might add names to the dictionary that the document still
+	/// looks its own up in.
+	static void release_context(xmlParserCtxtPtr context);
+
 private:
+	/// Frees doc, and gives back the context that built it.
+	void free_doc();
+	/// Parses the document that was just read into doc, or takes the feed
+	/// from \a stream if that read it; \a origin is what it was read from,
+	/// for the log.
+	Feed parse_doc(const std::string& origin,
+		StreamParser* stream = nullptr);
 	Feed parse_xmlnode(xmlNode* node);
+	/// Parses the body of \a response into \a feed as if \a transfer
+	/// received it. Returns false if the body is gone.
+	bool parse_stored(Transfer& transfer,
+		const newsboat::SharedFetchCache::Response& response,
+		Feed& feed);
 	unsigned int to;
+	unsigned int connect_to;
 	const std::string ua;
 	const std::string prx;
 	const std::string prxauth;
 	curl_proxytype prxtype;
 	const bool verify_ssl;
+	bool streaming;
+	std::size_t max_items;
+	newsboat::SharedFetchCache* shared_cache;
 	xmlDocPtr doc;
+	/// The context that built doc, if it was one from acquire_context()
+	xmlParserCtxtPtr doc_context;
 	time_t lm;
 	std::string et;
 };
@@ -40,12 +40,26 @@ void Rss09xParser::parse_feed(Feed& f, xmlNode* rootNode)
 		} else if (node_is(node, "link", ns)) {
 			f.link = utils::absolute_url(
 					globalbase, get_content(node));
+		} else if (node_is(node, "link", ATOM_1_0_URI)) {
+			// RSS 2.0 feeds announce their WebSub hub the Atom way
+			const std::string rel = get_prop(node, "rel");
+			if (rel == "hub") {
+				f.hub = utils::absolute_url(globalbase, get_prop(node, "href"));
+			} else if (rel == "self") {
+				f.self = utils::absolute_url(globalbase, get_prop(node, "href"));
+			}
 		} else if (node_is(node, "description", ns)) {
 			f.description = get_content(node);
 		} else if (node_is(node, "language", ns)) {
 			f.language = get_content(node);
 		} else if (node_is(node, "managingEditor", ns)) {
 			f.managingeditor = get_content(node);
+		} else if (node_is(node, "ttl", ns)) {
+			f.ttl = get_content(node);
+		} else if (node_is(node, "updatePeriod", SYNDICATION_URI)) {
+			f.update_period = get_content(node);
+		} else if (node_is(node, "updateFrequency", SYNDICATION_URI)) {
+			f.update_frequency = get_content(node);
 		} else if (node_is(node, "item", ns)) {
 			f.items.push_back(parse_item(node));
 		}
@@ -56,7 +70,7 @@ Item Rss09xParser::parse_item(xmlNode* itemNode)
 {
 	Item it;
 	std::string author;
-	std::string dc_date;
+	time_t dc_date = 0;
 
 	std::string base = get_prop(itemNode, "base", XML_URI);
 	if (base.empty()) {
@@ -93,25 +107,11 @@ Item Rss09xParser::parse_item(xmlNode* itemNode)
 			}
 		} else if (node_is(node, "pubDate", ns)) {
 			it.pubDate = get_content(node);
+			it.pubDate_ts = parse_rfc822(it.pubDate);
 		} else if (node_is(node, "date", DC_URI)) {
-			dc_date = w3cdtf_to_rfc822(get_content(node));
+			dc_date = parse_w3cdtf(get_content(node));
 		} else if (node_is(node, "author", ns)) {
-			const std::string authorfield = get_content(node);
-			if (authorfield.length() > 2 && authorfield.back() == ')') {
-				it.author_email =
-					utils::tokenize(authorfield, " ")[0];
-				unsigned int start, end;
-				end = authorfield.length() - 2;
-				for (start = end;
-					start > 0 && authorfield[start] != '(';
-					start--) {
-				}
-				it.author = authorfield.substr(
-						start + 1, end - start);
-			} else {
-				it.author_email = authorfield;
-				it.author = authorfield;
-			}
+			parse_author(get_content(node), it);
 		} else if (node_is(node, "creator", DC_URI)) {
 			author = get_content(node);
 		} else if (node_is(node, "enclosure", ns)) {
@@ -131,12 +131,31 @@ Item Rss09xParser::parse_item(xmlNode* itemNode)
 	}
 
 	if (it.pubDate == "") {
-		it.pubDate = dc_date;
+		it.pubDate_ts = dc_date;
 	}
 
 	return it;
 }
 
+void Rss09xParser::parse_author(const std::string& authorfield, Item& it)
+{
+	if (authorfield.length() > 2 && authorfield.back() == ')') {
+		it.author_email =
+			utils::tokenize(authorfield, " ")[0];
+		unsigned int start, end;
+		end = authorfield.length() - 2;
+		for (start = end;
+			start > 0 && authorfield[start] != '(';
+			start--) {
+		}
+		it.author = authorfield.substr(
+				start + 1, end - start);
+	} else {
+		it.author_email = authorfield;
+		it.author = authorfield;
+	}
+}
+
 Rss09xParser::~Rss09xParser()
 {
 	free((void*)ns);
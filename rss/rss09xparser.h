@@ -2,6 +2,7 @@
 #define NEWSBOAT_RSSPP_RSS09XPARSER_H_
 
 #include <libxml/tree.h>
+#include <string>
 
 #include "rssparser.h"
 
@@ -19,6 +20,10 @@ struct Rss09xParser : public RssParser {
 	}
 	~Rss09xParser() override;
 
+	/// Sets the author and their e-mail of \a it from an <author> element,
+	/// which is either "email (Name)" or just one of them.
+	static void parse_author(const std::string& authorfield, Item& it);
+
 protected:
 	const char* ns;
 
@@ -9,9 +9,6 @@
 #include "rsspp_uris.h"
 #include "xmlutilities.h"
 
-#define RSS_1_0_NS "http://purl.org/rss/1.0/"
-#define RDF_URI "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
-
 namespace rsspp {
 
 void Rss10Parser::parse_feed(Feed& f, xmlNode* rootNode)
@@ -35,10 +32,16 @@ void Rss10Parser::parse_feed(Feed& f, xmlNode* rootNode)
 						RSS_1_0_NS)) {
 					f.description = get_content(cnode);
 				} else if (node_is(cnode, "date", DC_URI)) {
-					f.pubDate = w3cdtf_to_rfc822(
+					f.pubDate_ts = parse_w3cdtf(
 							get_content(cnode));
 				} else if (node_is(cnode, "creator", DC_URI)) {
 					f.dc_creator = get_content(cnode);
+				} else if (node_is(cnode, "updatePeriod", SYNDICATION_URI)) {
+					f.update_period = get_content(cnode);
+				} else if (node_is(cnode,
+						"updateFrequency",
+						SYNDICATION_URI)) {
+					f.update_frequency = get_content(cnode);
 				}
 			}
 		} else if (node_is(node, "item", RSS_1_0_NS)) {
@@ -60,7 +63,7 @@ void Rss10Parser::parse_feed(Feed& f, xmlNode* rootNode)
 					it.description = get_content(itnode);
 					it.description_mime_type = "";
 				} else if (node_is(itnode, "date", DC_URI)) {
-					it.pubDate = w3cdtf_to_rfc822(
+					it.pubDate_ts = parse_w3cdtf(
 							get_content(itnode));
 				} else if (node_is(itnode,
 						"encoded",
@@ -7,10 +7,9 @@
 #include "feed.h"
 #include "item.h"
 #include "rss09xparser.h"
+#include "rsspp_uris.h"
 #include "utils.h"
 
-#define RSS20USERLAND_URI "http://backend.userland.com/rss2"
-
 using namespace newsboat;
 
 namespace rsspp {
@@ -1,76 +1,273 @@
 #include "rssparser.h"
 
+#include <cctype>
+#include <cstdint>
 #include <cstring>
-#include <ctime>
 #include <libxml/tree.h>
+#include <strings.h>
 
 #include "exception.h"
 #include "xmlutilities.h"
 
-#include "utils.h"
-
 namespace rsspp {
 
-std::string RssParser::w3cdtf_to_rfc822(const std::string& w3cdtf)
+namespace {
+
+/// Days from 1970-01-01 to the given day of the Gregorian calendar.
+std::int64_t days_from_civil(std::int64_t year, unsigned int month,
+	unsigned int day)
 {
-	if (w3cdtf.empty()) {
-		return "";
+	year -= month <= 2;
+	const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+	const unsigned int year_of_era = static_cast<unsigned int>(year - era * 400);
+	const unsigned int day_of_year =
+		(153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	const unsigned int day_of_era = year_of_era * 365 + year_of_era / 4 -
+		year_of_era / 100 + day_of_year;
+	return era * 146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+}
+
+/// Reads at least \a min_digits and at most \a max_digits decimal digits at
+/// \a pos of \a s, and moves \a pos past them. Returns false, leaving \a pos
+/// alone, if there are fewer than \a min_digits.
+bool read_number(const std::string& s, std::size_t& pos,
+	std::size_t min_digits, std::size_t max_digits, int& value)
+{
+	std::size_t end = pos;
+	int result = 0;
+	while (end < s.size() && end - pos < max_digits &&
+		std::isdigit(static_cast<unsigned char>(s[end]))) {
+		result = 10 * result + (s[end] - '0');
+		++end;
 	}
+	if (end - pos < min_digits) {
+		return false;
+	}
+	pos = end;
+	value = result;
+	return true;
+}
 
-	struct tm stm;
-	memset(&stm, 0, sizeof(stm));
-	stm.tm_mday = 1;
+bool read_char(const std::string& s, std::size_t& pos, char c)
+{
+	if (pos < s.size() && s[pos] == c) {
+		++pos;
+		return true;
+	}
+	return false;
+}
 
-	char* ptr = strptime(w3cdtf.c_str(), "%Y", &stm);
+void skip_spaces(const std::string& s, std::size_t& pos)
+{
+	while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos]))) {
+		++pos;
+	}
+}
 
-	if (ptr != nullptr) {
-		ptr = strptime(ptr, "-%m", &stm);
-	} else {
-		return "";
+std::size_t skip_letters(const std::string& s, std::size_t pos)
+{
+	while (pos < s.size() && std::isalpha(static_cast<unsigned char>(s[pos]))) {
+		++pos;
+	}
+	return pos;
+}
+
+/// Reads "hh:mm", "hhmm" or "hh" at \a pos, the offset of a timezone
+/// after its sign.
+bool read_offset(const std::string& s, std::size_t& pos, int& seconds)
+{
+	int hours = 0;
+	int minutes = 0;
+	if (!read_number(s, pos, 2, 2, hours)) {
+		return false;
+	}
+	std::size_t minutes_pos = pos;
+	read_char(s, minutes_pos, ':');
+	if (read_number(s, minutes_pos, 2, 2, minutes)) {
+		pos = minutes_pos;
+	}
+	seconds = 60 * (60 * hours + minutes);
+	return true;
+}
+
+time_t to_time(int year, int month, int day, int hour, int minute,
+	int second, int offset)
+{
+	if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 24 ||
+		minute > 59 || second > 60) {
+		return 0;
+	}
+	return static_cast<time_t>(days_from_civil(year, month, day) * 86400 +
+			3600 * hour + 60 * minute + second - offset);
+}
+
+}
+
+time_t RssParser::parse_w3cdtf(const std::string& w3cdtf)
+{
+	std::size_t pos = 0;
+	skip_spaces(w3cdtf, pos);
+
+	int year = 0;
+	if (!read_number(w3cdtf, pos, 4, 4, year)) {
+		return 0;
 	}
 
-	if (ptr != nullptr) {
-		ptr = strptime(ptr, "-%d", &stm);
+	// Like the strptime() calls this replaces, whatever follows the
+	// first part that can't be read is ignored
+	int month = 1;
+	int day = 1;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	int offset = 0;
+	if (read_char(w3cdtf, pos, '-') && read_number(w3cdtf, pos, 2, 2, month) &&
+		read_char(w3cdtf, pos, '-') && read_number(w3cdtf, pos, 2, 2, day) &&
+		(read_char(w3cdtf, pos, 'T') || read_char(w3cdtf, pos, 't') ||
+			read_char(w3cdtf, pos, ' ')) &&
+		read_number(w3cdtf, pos, 2, 2, hour)) {
+
+		if (read_char(w3cdtf, pos, ':') &&
+			read_number(w3cdtf, pos, 2, 2, minute) &&
+			read_char(w3cdtf, pos, ':') &&
+			read_number(w3cdtf, pos, 2, 2, second) &&
+			read_char(w3cdtf, pos, '.')) {
+			int fraction = 0;
+			read_number(w3cdtf, pos, 1, std::string::npos, fraction);
+		}
+
+		// Without a timezone, the time is taken to be in UTC
+		if (read_char(w3cdtf, pos, '+')) {
+			read_offset(w3cdtf, pos, offset);
+		} else if (read_char(w3cdtf, pos, '-')) {
+			if (read_offset(w3cdtf, pos, offset)) {
+				offset = -offset;
+			}
+		}
 	}
-	if (ptr != nullptr) {
-		ptr = strptime(ptr, "T%H", &stm);
+
+	return to_time(year, month, day, hour, minute, second, offset);
+}
+
+time_t RssParser::parse_rfc822(const std::string& rfc822)
+{
+	static const char* const months[] = {
+		"jan", "feb", "mar", "apr", "may", "jun",
+		"jul", "aug", "sep", "oct", "nov", "dec"
+	};
+	struct Zone {
+		const char* name;
+		int hours;
+	};
+	static const Zone zones[] = {
+		{"gmt", 0}, {"ut", 0}, {"utc", 0}, {"z", 0},
+		{"est", -5}, {"edt", -4}, {"cst", -6}, {"cdt", -5},
+		{"mst", -7}, {"mdt", -6}, {"pst", -8}, {"pdt", -7},
+	};
+
+	std::size_t pos = 0;
+	skip_spaces(rfc822, pos);
+
+	// The day of the week is optional, and isn't checked
+	const std::size_t weekday_end = skip_letters(rfc822, pos);
+	if (weekday_end != pos) {
+		pos = weekday_end;
+		read_char(rfc822, pos, ',');
+		skip_spaces(rfc822, pos);
+	}
+
+	int day = 0;
+	if (!read_number(rfc822, pos, 1, 2, day)) {
+		return 0;
+	}
+	skip_spaces(rfc822, pos);
+
+	const std::size_t month_end = skip_letters(rfc822, pos);
+	if (month_end - pos < 3) {
+		return 0;
 	}
-	if (ptr != nullptr) {
-		ptr = strptime(ptr, ":%M", &stm);
+	int month = 0;
+	for (int i = 0; i < 12 && month == 0; ++i) {
+		if (strncasecmp(rfc822.c_str() + pos, months[i], 3) == 0) {
+			month = i + 1;
+		}
 	}
-	if (ptr != nullptr) {
-		ptr = strptime(ptr, ":%S", &stm);
+	if (month == 0) {
+		return 0;
 	}
+	pos = month_end;
+	skip_spaces(rfc822, pos);
 
-	int offs = 0;
-	if (ptr != nullptr) {
-		if (ptr[0] == '+' || ptr[0] == '-') {
-			unsigned int hour, min;
-			if (sscanf(ptr + 1, "%02u:%02u", &hour, &min) == 2) {
-				offs = 60 * 60 * hour + 60 * min;
-				if (ptr[0] == '+') {
-					offs = -offs;
-				}
-				stm.tm_gmtoff = offs;
+	// Two-digit years are left to curl_getdate()
+	int year = 0;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	if (!read_number(rfc822, pos, 4, 4, year)) {
+		return 0;
+	}
+	skip_spaces(rfc822, pos);
+	if (!read_number(rfc822, pos, 1, 2, hour) || !read_char(rfc822, pos, ':') ||
+		!read_number(rfc822, pos, 2, 2, minute)) {
+		return 0;
+	}
+	if (read_char(rfc822, pos, ':') && !read_number(rfc822, pos, 2, 2, second)) {
+		return 0;
+	}
+	skip_spaces(rfc822, pos);
+
+	int offset = 0;
+	if (read_char(rfc822, pos, '+')) {
+		if (!read_offset(rfc822, pos, offset)) {
+			return 0;
+		}
+	} else if (read_char(rfc822, pos, '-')) {
+		if (!read_offset(rfc822, pos, offset)) {
+			return 0;
+		}
+		offset = -offset;
+	} else if (pos < rfc822.size()) {
+		const std::size_t zone_end = skip_letters(rfc822, pos);
+		const std::string zone = rfc822.substr(pos, zone_end - pos);
+		bool known = false;
+		for (const auto& candidate : zones) {
+			if (strcasecmp(zone.c_str(), candidate.name) == 0) {
+				offset = 3600 * candidate.hours;
+				known = true;
+				break;
 			}
-		} else if (ptr[0] == 'Z') {
-			stm.tm_gmtoff = 0;
 		}
+		if (!known) {
+			return 0;
+		}
+		pos = zone_end;
+	}
+
+	skip_spaces(rfc822, pos);
+	if (pos != rfc822.size()) {
+		return 0;
 	}
 
-	// tm_isdst will force mktime to consider DST, like localtime(), but
-	// then the offset will be zeroed out, since that was manually added
-	// https://github.com/akrennmair/newsbeuter/issues/369
-	stm.tm_isdst = -1;
+	return to_time(year, month, day, hour, minute, second, offset);
+}
 
-	const time_t local_time = mktime(&stm);
-	if (local_time == -1) {
+std::string RssParser::format_rfc822(time_t t)
+{
+	struct tm stm;
+	if (gmtime_r(&t, &stm) == nullptr) {
 		return "";
 	}
 
-	const time_t gmttime = local_time + offs;
-	return newsboat::utils::mt_strf_localtime("%a, %d %b %Y %H:%M:%S +0000",
-			gmttime);
+	char buffer[64];
+	const size_t written = strftime(buffer, sizeof(buffer),
+			"%a, %d %b %Y %H:%M:%S +0000", &stm);
+	return std::string(buffer, written);
+}
+
+std::string RssParser::w3cdtf_to_rfc822(const std::string& w3cdtf)
+{
+	const time_t t = parse_w3cdtf(w3cdtf);
+	return t != 0 ? format_rfc822(t) : "";
 }
 
 } // namespace rsspp
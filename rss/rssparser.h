@@ -1,6 +1,7 @@
 #ifndef NEWSBOAT_RSSPP_RSSPARSER_H_
 #define NEWSBOAT_RSSPP_RSSPARSER_H_
 
+#include <ctime>
 #include <libxml/tree.h>
 #include <string>
 
@@ -15,6 +16,22 @@ struct RssParser {
 	{
 	}
 	virtual ~RssParser() {}
+
+	/// \brief Parses a W3CDTF (RFC 3339) date, like
+	/// "2008-12-30T10:03:15-08:00".
+	///
+	/// Everything after the year is optional, and a time without a timezone
+	/// is taken to be in UTC. Returns 0 if \a w3cdtf doesn't start with a
+	/// year.
+	static time_t parse_w3cdtf(const std::string& w3cdtf);
+	/// \brief Parses an RFC 822 date, like "Tue, 30 Dec 2008 18:03:15 GMT".
+	///
+	/// Only takes four-digit years, and numeric, UT, GMT and North American
+	/// timezones. Returns 0 for anything else, which is left to
+	/// curl_getdate().
+	static time_t parse_rfc822(const std::string& rfc822);
+	/// \a t in UTC, as an RFC 822 date.
+	static std::string format_rfc822(time_t t);
 	static std::string w3cdtf_to_rfc822(const std::string& w3cdtf);
 
 protected:
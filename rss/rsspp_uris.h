@@ -4,8 +4,13 @@
 #define CONTENT_URI "http://purl.org/rss/1.0/modules/content/"
 #define ITUNES_URI "http://www.itunes.com/dtds/podcast-1.0.dtd"
 #define DC_URI "http://purl.org/dc/elements/1.1/"
+#define SYNDICATION_URI "http://purl.org/rss/1.0/modules/syndication/"
 #define ATOM_0_3_URI "http://purl.org/atom/ns#"
 #define ATOM_1_0_URI "http://www.w3.org/2005/Atom"
 #define XML_URI "http://www.w3.org/XML/1998/namespace"
+#define MEDIA_RSS_URI "http://search.yahoo.com/mrss/"
+#define RSS20USERLAND_URI "http://backend.userland.com/rss2"
+#define RSS_1_0_NS "http://purl.org/rss/1.0/"
+#define RDF_URI "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
 
 #endif /* NEWSBOAT_RSSPP_URIS_H_ */
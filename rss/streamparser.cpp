@@ -0,0 +1,1226 @@
+#include "streamparser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <libxml/SAX2.h>
+#include <libxml/entities.h>
+#include <libxml/parserInternals.h>
+#include <libxml/valid.h>
+
+#include "atomparser.h"
+#include "config.h"
+#include "exception.h"
+#include "rss09xparser.h"
+#include "rssparser.h"
+#include "rsspp_uris.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace rsspp {
+
+namespace {
+
+/// Entities in attribute values are expanded at most this deep, which only
+/// ever matters for entities that refer to each other.
+const int MAX_ENTITY_DEPTH = 20;
+
+const char* to_chars(const xmlChar* s)
+{
+	return reinterpret_cast<const char*>(s);
+}
+
+const xmlChar* to_xml(const char* s)
+{
+	return reinterpret_cast<const xmlChar*>(s);
+}
+
+bool has_namespace(const char* uri, const char* ns_uri)
+{
+	if (ns_uri == nullptr) {
+		return uri == nullptr;
+	}
+	return uri != nullptr && std::strcmp(uri, ns_uri) == 0;
+}
+
+/// Whether "prefix:local" (or just local, without a prefix) is \a name
+bool qname_is(const xmlChar* prefix, const xmlChar* local, const char* name)
+{
+	if (prefix != nullptr) {
+		const std::size_t length = std::strlen(to_chars(prefix));
+		if (std::strncmp(to_chars(prefix), name, length) != 0
+			|| name[length] != ':') {
+			return false;
+		}
+		name += length + 1;
+	}
+	return std::strcmp(to_chars(local), name) == 0;
+}
+
+void append_hex_reference(std::string& out, unsigned int code_point)
+{
+	char reference[16];
+	std::snprintf(reference, sizeof(reference), "&#x%X;", code_point);
+	out += reference;
+}
+
+/// Appends text like xmlNodeDump() writes a text node.
+void append_escaped_text(std::string& out, const char* data, std::size_t size)
+{
+	std::size_t done = 0;
+	for (std::size_t i = 0; i < size; ++i) {
+		const char* replacement;
+		switch (data[i]) {
+		case '<':
+			replacement = "&lt;";
+			break;
+		case '>':
+			replacement = "&gt;";
+			break;
+		case '&':
+			replacement = "&amp;";
+			break;
+		case '\r':
+			replacement = "&#13;";
+			break;
+		default:
+			continue;
+		}
+		out.append(data + done, i - done);
+		out += replacement;
+		done = i + 1;
+	}
+	out.append(data + done, size - done);
+}
+
+/// Appends the text of an attribute like xmlNodeDump() writes it, with
+/// characters that aren't ASCII as references if \a escape_non_ascii.
+void append_escaped_attribute(std::string& out, const std::string& value,
+	bool escape_non_ascii)
+{
+	for (std::size_t i = 0; i < value.length(); ++i) {
+		const unsigned char c = value[i];
+		switch (c) {
+		case '\n':
+			out += "&#10;";
+			break;
+		case '\r':
+			out += "&#13;";
+			break;
+		case '\t':
+			out += "&#9;";
+			break;
+		case '"':
+			out += "&quot;";
+			break;
+		case '<':
+			out += "&lt;";
+			break;
+		case '>':
+			out += "&gt;";
+			break;
+		case '&':
+			out += "&amp;";
+			break;
+		default:
+			if (c >= 0x80 && escape_non_ascii && i + 1 < value.length()) {
+				// libxml2 hands out valid UTF-8
+				std::size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+				length = std::min(length, value.length() - i);
+				unsigned int code_point = c & (0x7F >> length);
+				for (std::size_t k = 1; k < length; ++k) {
+					code_point = (code_point << 6) | (value[i + k] & 0x3F);
+				}
+				append_hex_reference(out, code_point);
+				i += length - 1;
+			} else {
+				out += static_cast<char>(c);
+			}
+		}
+	}
+}
+
+/// Appends \a uri in quotes, like xmlNodeDump() writes a namespace.
+void append_quoted(std::string& out, const char* uri)
+{
+	const std::string value(uri);
+	if (value.find('"') == std::string::npos) {
+		out += '"' + value + '"';
+	} else if (value.find('\'') == std::string::npos) {
+		out += '\'' + value + '\'';
+	} else {
+		out += '"';
+		for (const char c : value) {
+			if (c == '"') {
+				out += "&quot;";
+			} else {
+				out += c;
+			}
+		}
+		out += '"';
+	}
+}
+
+/// Splits an attribute value that still has entity references in it into
+/// text and references, like xmlStringLenGetNodeList() does when the tree
+/// is built. \a on_text gets the text, with character references and
+/// predefined entities replaced; \a on_reference the names of the other
+/// entities.
+template<typename OnText, typename OnReference>
+void split_value(xmlDocPtr doc, const char* cur, const char* end,
+	OnText on_text, OnReference on_reference)
+{
+	const char* text_start = cur;
+	while (cur < end) {
+		if (*cur != '&') {
+			cur++;
+			continue;
+		}
+		on_text(text_start, cur - text_start);
+
+		if (cur + 1 < end && cur[1] == '#') {
+			const bool hex = cur + 2 < end && cur[2] == 'x';
+			cur += hex ? 3 : 2;
+			unsigned int code_point = 0;
+			while (cur < end && *cur != ';') {
+				const char c = *cur;
+				unsigned int digit;
+				if (c >= '0' && c <= '9') {
+					digit = c - '0';
+				} else if (hex && c >= 'a' && c <= 'f') {
+					digit = c - 'a' + 10;
+				} else if (hex && c >= 'A' && c <= 'F') {
+					digit = c - 'A' + 10;
+				} else {
+					code_point = 0;
+					break;
+				}
+				code_point = code_point * (hex ? 16 : 10) + digit;
+				cur++;
+			}
+			if (cur < end && *cur == ';') {
+				cur++;
+			}
+			if (code_point != 0) {
+				xmlChar encoded[8];
+				const int length = xmlCopyCharMultiByte(encoded, code_point);
+				on_text(to_chars(encoded), length);
+			}
+		} else {
+			const char* name_start = cur + 1;
+			cur = name_start;
+			while (cur < end && *cur != ';') {
+				cur++;
+			}
+			if (cur >= end) {
+				// Unterminated; the tree stops at this point as well
+				return;
+			}
+			if (cur != name_start) {
+				const std::string name(name_start, cur);
+				const xmlEntityPtr entity = xmlGetDocEntity(doc, to_xml(name.c_str()));
+				if (entity != nullptr
+					&& entity->etype == XML_INTERNAL_PREDEFINED_ENTITY) {
+					on_text(to_chars(entity->content),
+						std::strlen(to_chars(entity->content)));
+				} else {
+					on_reference(name, entity);
+				}
+			}
+			cur++;
+		}
+		text_start = cur;
+	}
+	on_text(text_start, cur - text_start);
+}
+
+/// The value of an attribute with references, as xmlGetProp() returns it.
+void append_decoded_value(std::string& out, xmlDocPtr doc, const char* begin,
+	const char* end, int depth)
+{
+	split_value(doc, begin, end,
+	[&out](const char* text, std::size_t size) {
+		out.append(text, size);
+	},
+	[&out, doc, depth](const std::string&, xmlEntityPtr entity) {
+		if (entity != nullptr && entity->content != nullptr
+			&& depth < MAX_ENTITY_DEPTH) {
+			const char* content = to_chars(entity->content);
+			append_decoded_value(out, doc, content, content + std::strlen(content),
+				depth + 1);
+		}
+	});
+}
+
+/// The value of the SAX2 attribute at \a attribute. It's in the input as
+/// it is, unless it had entity references, in which case libxml2 gives a
+/// copy that ends in a NUL and still has some of them.
+std::string attribute_value(xmlDocPtr doc, const xmlChar** attribute)
+{
+	const char* begin = to_chars(attribute[3]);
+	const char* end = to_chars(attribute[4]);
+	if (*end != '\0') {
+		return std::string(begin, end);
+	}
+	std::string value;
+	append_decoded_value(value, doc, begin, end, 0);
+	return value;
+}
+
+}
+
+StreamParser::StreamParser(std::size_t max_items)
+	: context(nullptr)
+	, max_items(max_items)
+	, format(Format::UNKNOWN)
+	, root_seen(false)
+	, root_done(false)
+	, channel_seen(false)
+	, ns(nullptr)
+	, item_fallback_date(0)
+	, author(nullptr)
+	, field(Field::NONE)
+	, field_is_xml(false)
+	, field_is_permalink(false)
+	, tag_open(false)
+	, after_cdata(false)
+{
+}
+
+const xmlSAXHandler* StreamParser::sax_handler()
+{
+	static const xmlSAXHandler handler = []() {
+		// The document, its internal subset and the entities are still
+		// handled by libxml2's tree builder
+		xmlSAXHandler h;
+		xmlSAXVersion(&h, 2);
+		h.startElementNs = on_start_element;
+		h.endElementNs = on_end_element;
+		h.characters = on_characters;
+		// The same function, so that libxml2 doesn't look for whitespace
+		// to ignore, just like the tree builder
+		h.ignorableWhitespace = on_characters;
+		h.cdataBlock = on_cdata;
+		h.comment = on_comment;
+		h.processingInstruction = on_processing_instruction;
+		h.reference = on_reference;
+		return h;
+	}();
+	return &handler;
+}
+
+void StreamParser::attach(xmlParserCtxtPtr ctxt)
+{
+	context = ctxt;
+	context->_private = this;
+}
+
+Feed StreamParser::finish()
+{
+	if (context != nullptr) {
+		context->_private = nullptr;
+		context = nullptr;
+	}
+	while (!roles.empty() && error.empty()) {
+		end_element();
+	}
+
+	if (!error.empty()) {
+		throw Exception(error);
+	}
+	if (!root_seen) {
+		throw Exception(_("XML root node is NULL"));
+	}
+	return std::move(feed);
+}
+
+void StreamParser::fail(const std::string& message)
+{
+	if (error.empty()) {
+		error = message;
+	}
+	if (context != nullptr) {
+		xmlStopParser(context);
+	}
+}
+
+void StreamParser::on_start_element(void* ctx, const xmlChar* localname,
+	const xmlChar* prefix, const xmlChar* uri, int nb_namespaces,
+	const xmlChar** namespaces, int nb_attributes, int nb_defaulted,
+	const xmlChar** attributes)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	// Elements within entities aren't children in the tree either; only
+	// their text counts
+	if (self == nullptr || ctxt != self->context) {
+		return;
+	}
+
+	Element element;
+	element.name = to_chars(localname);
+	element.prefix = to_chars(prefix);
+	element.uri = to_chars(uri);
+	if (prefix != nullptr && uri == nullptr) {
+		// Like the tree builder, keep an undeclared prefix in the name
+		const xmlChar* qname = xmlDictQLookup(ctxt->dict, prefix, localname);
+		if (qname != nullptr) {
+			element.name = to_chars(qname);
+		}
+		element.prefix = nullptr;
+	}
+	element.nb_namespaces = nb_namespaces;
+	element.namespaces = namespaces;
+	// The tree builder leaves out the defaults too
+	element.nb_attributes = nb_attributes - nb_defaulted;
+	element.attributes = attributes;
+	self->start_element(element);
+}
+
+void StreamParser::on_end_element(void* ctx, const xmlChar*, const xmlChar*,
+	const xmlChar*)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || ctxt != self->context || self->roles.empty()) {
+		return;
+	}
+	self->end_element();
+}
+
+void StreamParser::on_characters(void* ctx, const xmlChar* ch, int len)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || self->field == Field::NONE) {
+		return;
+	}
+	if (self->field_is_xml) {
+		// An entity is written as a reference instead
+		if (ctxt == self->context) {
+			self->dump_children();
+			append_escaped_text(self->text, to_chars(ch), len);
+			self->after_cdata = false;
+		}
+	} else {
+		self->add_text(to_chars(ch), len);
+	}
+}
+
+void StreamParser::on_cdata(void* ctx, const xmlChar* value, int len)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || self->field == Field::NONE) {
+		return;
+	}
+	if (!self->field_is_xml) {
+		self->add_text(to_chars(value), len);
+	} else if (ctxt == self->context) {
+		self->dump_children();
+		if (self->after_cdata) {
+			// The tree adds a CDATA section that follows another one to it
+			self->text.resize(self->text.length() - 3);
+		} else {
+			self->text += "<![CDATA[";
+		}
+		self->text.append(to_chars(value), len);
+		self->text += "]]>";
+		self->after_cdata = true;
+	}
+}
+
+void StreamParser::on_comment(void* ctx, const xmlChar* value)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || ctxt != self->context || !self->field_is_xml) {
+		return;
+	}
+	self->dump_children();
+	self->text += "<!--";
+	self->text += to_chars(value);
+	self->text += "-->";
+	self->after_cdata = false;
+}
+
+void StreamParser::on_processing_instruction(void* ctx, const xmlChar* target,
+	const xmlChar* data)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || ctxt != self->context || !self->field_is_xml) {
+		return;
+	}
+	self->dump_children();
+	self->text += "<?";
+	self->text += to_chars(target);
+	if (data != nullptr) {
+		self->text += ' ';
+		self->text += to_chars(data);
+	}
+	self->text += "?>";
+	self->after_cdata = false;
+}
+
+void StreamParser::on_reference(void* ctx, const xmlChar* name)
+{
+	const xmlParserCtxtPtr ctxt = static_cast<xmlParserCtxtPtr>(ctx);
+	StreamParser* self = static_cast<StreamParser*>(ctxt->_private);
+	if (self == nullptr || ctxt != self->context || !self->field_is_xml) {
+		return;
+	}
+	self->dump_children();
+	self->text += '&';
+	self->text += to_chars(name);
+	self->text += ';';
+	self->after_cdata = false;
+}
+
+void StreamParser::add_text(const char* data, std::size_t size)
+{
+	text.append(data, size);
+}
+
+void StreamParser::start_element(const Element& element)
+{
+	if (field != Field::NONE) {
+		dump_start(element);
+		roles.push_back(Role::OTHER);
+		return;
+	}
+
+	Role role = Role::OTHER;
+	if (roles.empty()) {
+		// Anything after the root is an error that ends the document, but
+		// it's ignored just in case
+		if (!root_seen) {
+			role = start_root(element);
+		}
+	} else {
+		switch (roles.back()) {
+		case Role::ROOT:
+			role = start_root_child(element);
+			break;
+		case Role::CHANNEL:
+			role = start_channel_child(element);
+			break;
+		case Role::ITEM:
+			role = start_item_child(element);
+			break;
+		case Role::AUTHOR:
+			role = start_author_child(element);
+			break;
+		case Role::MEDIA:
+			role = start_media(element);
+			break;
+		case Role::FIELD:
+		case Role::OTHER:
+			break;
+		}
+	}
+	roles.push_back(role);
+}
+
+void StreamParser::end_element()
+{
+	const Role role = roles.back();
+	roles.pop_back();
+	switch (role) {
+	case Role::FIELD:
+		end_field();
+		break;
+	case Role::ITEM:
+		end_item();
+		break;
+	case Role::ROOT:
+		end_root();
+		break;
+	case Role::AUTHOR:
+		author = nullptr;
+		break;
+	case Role::OTHER:
+		if (field != Field::NONE) {
+			dump_end();
+		}
+		break;
+	case Role::CHANNEL:
+	case Role::MEDIA:
+		break;
+	}
+}
+
+StreamParser::Role StreamParser::start_root(const Element& element)
+{
+	root_seen = true;
+
+	// The same checks as Parser::parse_xmlnode()
+	if (std::strcmp(element.name, "rss") == 0) {
+		std::string version;
+		if (!find_prop(element, "version", nullptr, version)) {
+			fail(_("no RSS version"));
+			return Role::OTHER;
+		}
+		if (version == "0.91") {
+			feed.rss_version = Feed::RSS_0_91;
+		} else if (version == "0.92") {
+			feed.rss_version = Feed::RSS_0_92;
+		} else if (version == "0.94") {
+			feed.rss_version = Feed::RSS_0_94;
+		} else if (version == "2.0" || version == "2") {
+			feed.rss_version = Feed::RSS_2_0;
+		} else if (version == "1.0") {
+			feed.rss_version = Feed::RSS_0_91;
+		} else {
+			fail(_("invalid RSS version"));
+			return Role::OTHER;
+		}
+		format = Format::RSS_09X;
+		// Like Rss20Parser
+		if (feed.rss_version == Feed::RSS_2_0
+			&& has_namespace(element.uri, RSS20USERLAND_URI)) {
+			ns = RSS20USERLAND_URI;
+		}
+		globalbase = get_prop(element, "base", XML_URI);
+	} else if (std::strcmp(element.name, "RDF") == 0) {
+		feed.rss_version = Feed::RSS_1_0;
+		format = Format::RSS_10;
+	} else if (std::strcmp(element.name, "feed") == 0) {
+		if (element.uri == nullptr) {
+			fail(_("no Atom version"));
+			return Role::OTHER;
+		}
+		if (std::strcmp(element.uri, ATOM_0_3_URI) == 0) {
+			feed.rss_version = Feed::ATOM_0_3;
+			ns = ATOM_0_3_URI;
+		} else if (std::strcmp(element.uri, ATOM_1_0_URI) == 0) {
+			feed.rss_version = Feed::ATOM_1_0;
+			ns = ATOM_1_0_URI;
+		} else {
+			std::string version;
+			if (!find_prop(element, "version", nullptr, version)
+				|| version != "0.3") {
+				fail(_("invalid Atom version"));
+				return Role::OTHER;
+			}
+			feed.rss_version = Feed::ATOM_0_3_NONS;
+		}
+		format = Format::ATOM;
+		feed.language = get_prop(element, "lang");
+		globalbase = get_prop(element, "base", XML_URI);
+	} else {
+		fail(_("unsupported feed format"));
+		return Role::OTHER;
+	}
+	return Role::ROOT;
+}
+
+StreamParser::Role StreamParser::start_root_child(const Element& element)
+{
+	const auto is = [&element](const char* name, const char* ns_uri) {
+		return std::strcmp(element.name, name) == 0
+			&& has_namespace(element.uri, ns_uri);
+	};
+
+	switch (format) {
+	case Format::RSS_09X:
+		// Only the first channel, whatever its namespace
+		if (!channel_seen && std::strcmp(element.name, "channel") == 0) {
+			channel_seen = true;
+			return Role::CHANNEL;
+		}
+		break;
+	case Format::RSS_10:
+		if (is("channel", RSS_1_0_NS)) {
+			return Role::CHANNEL;
+		} else if (is("item", RSS_1_0_NS)) {
+			const Role role = start_item(element);
+			if (role == Role::ITEM) {
+				item.guid = get_prop(element, "about", RDF_URI);
+			}
+			return role;
+		}
+		break;
+	case Format::ATOM:
+		if (is("title", ns)) {
+			field_type = get_prop(element, "type");
+			return start_field(Field::FEED_TITLE);
+		} else if (is("subtitle", ns)) {
+			return start_field(Field::FEED_DESCRIPTION);
+		} else if (is("link", ns)) {
+			start_feed_link(element);
+		} else if (is("updated", ns)) {
+			return start_field(Field::FEED_PUBDATE);
+		} else if (is("author", ns)) {
+			author = &feed_author;
+			return Role::AUTHOR;
+		} else if (is("entry", ns)) {
+			return start_item(element);
+		}
+		break;
+	case Format::UNKNOWN:
+		break;
+	}
+	return Role::OTHER;
+}
+
+StreamParser::Role StreamParser::start_channel_child(const Element& element)
+{
+	const auto is = [&element](const char* name, const char* ns_uri) {
+		return std::strcmp(element.name, name) == 0
+			&& has_namespace(element.uri, ns_uri);
+	};
+
+	if (format == Format::RSS_09X) {
+		if (is("title", ns)) {
+			return start_field(Field::FEED_TITLE);
+		} else if (is("link", ns)) {
+			return start_field(Field::FEED_LINK);
+		} else if (is("link", ATOM_1_0_URI)) {
+			// RSS 2.0 feeds announce their WebSub hub the Atom way
+			start_feed_link(element);
+		} else if (is("description", ns)) {
+			return start_field(Field::FEED_DESCRIPTION);
+		} else if (is("language", ns)) {
+			return start_field(Field::FEED_LANGUAGE);
+		} else if (is("managingEditor", ns)) {
+			return start_field(Field::FEED_MANAGINGEDITOR);
+		} else if (is("ttl", ns)) {
+			return start_field(Field::FEED_TTL);
+		} else if (is("updatePeriod", SYNDICATION_URI)) {
+			return start_field(Field::FEED_UPDATE_PERIOD);
+		} else if (is("updateFrequency", SYNDICATION_URI)) {
+			return start_field(Field::FEED_UPDATE_FREQUENCY);
+		} else if (is("item", ns)) {
+			return start_item(element);
+		}
+	} else if (format == Format::RSS_10) {
+		if (is("title", RSS_1_0_NS)) {
+			return start_field(Field::FEED_TITLE);
+		} else if (is("link", RSS_1_0_NS)) {
+			return start_field(Field::FEED_LINK);
+		} else if (is("description", RSS_1_0_NS)) {
+			return start_field(Field::FEED_DESCRIPTION);
+		} else if (is("date", DC_URI)) {
+			return start_field(Field::FEED_PUBDATE);
+		} else if (is("creator", DC_URI)) {
+			return start_field(Field::FEED_DC_CREATOR);
+		} else if (is("updatePeriod", SYNDICATION_URI)) {
+			return start_field(Field::FEED_UPDATE_PERIOD);
+		} else if (is("updateFrequency", SYNDICATION_URI)) {
+			return start_field(Field::FEED_UPDATE_FREQUENCY);
+		}
+	}
+	return Role::OTHER;
+}
+
+void StreamParser::start_feed_link(const Element& element)
+{
+	const std::string rel = get_prop(element, "rel");
+	const std::string href = utils::absolute_url(globalbase,
+			get_prop(element, "href"));
+	if (rel == "alternate" && format == Format::ATOM) {
+		feed.link = href;
+	} else if (rel == "hub") {
+		feed.hub = href;
+	} else if (rel == "self") {
+		feed.self = href;
+	}
+}
+
+StreamParser::Role StreamParser::start_item(const Element& element)
+{
+	if (max_items != 0 && feed.items.size() >= max_items) {
+		return Role::OTHER;
+	}
+
+	item = Item();
+	item_dc_creator.clear();
+	item_fallback_date = 0;
+	summary.clear();
+	summary_mime_type.clear();
+	item_base = get_prop(element, "base", XML_URI);
+	if (item_base.empty()) {
+		item_base = globalbase;
+	}
+	return Role::ITEM;
+}
+
+StreamParser::Role StreamParser::start_item_child(const Element& element)
+{
+	const auto is = [&element](const char* name, const char* ns_uri) {
+		return std::strcmp(element.name, name) == 0
+			&& has_namespace(element.uri, ns_uri);
+	};
+
+	if (format == Format::RSS_09X) {
+		if (is("title", ns)) {
+			return start_field(Field::ITEM_TITLE);
+		} else if (is("link", ns)) {
+			return start_field(Field::ITEM_LINK);
+		} else if (is("description", ns)) {
+			field_base = get_prop(element, "base", XML_URI);
+			return start_field(Field::ITEM_DESCRIPTION);
+		} else if (is("encoded", CONTENT_URI)) {
+			return start_field(Field::ITEM_CONTENT_ENCODED);
+		} else if (is("summary", ITUNES_URI)) {
+			return start_field(Field::ITEM_ITUNES_SUMMARY);
+		} else if (is("guid", ns)) {
+			field_is_permalink = get_prop(element, "isPermaLink") != "false";
+			return start_field(Field::ITEM_GUID);
+		} else if (is("pubDate", ns)) {
+			return start_field(Field::ITEM_PUBDATE);
+		} else if (is("date", DC_URI)) {
+			return start_field(Field::ITEM_FALLBACK_DATE);
+		} else if (is("author", ns)) {
+			return start_field(Field::ITEM_AUTHOR);
+		} else if (is("creator", DC_URI)) {
+			return start_field(Field::ITEM_DC_CREATOR);
+		} else if (is("enclosure", ns)) {
+			item.enclosures.push_back(
+			Enclosure {
+				get_prop(element, "url"),
+				get_prop(element, "type"),
+			}
+			);
+			return Role::OTHER;
+		}
+		return start_media(element);
+	} else if (format == Format::RSS_10) {
+		if (is("title", RSS_1_0_NS)) {
+			return start_field(Field::ITEM_TITLE);
+		} else if (is("link", RSS_1_0_NS)) {
+			return start_field(Field::ITEM_LINK);
+		} else if (is("description", RSS_1_0_NS)) {
+			return start_field(Field::ITEM_DESCRIPTION);
+		} else if (is("date", DC_URI)) {
+			return start_field(Field::ITEM_PUBDATE);
+		} else if (is("encoded", CONTENT_URI)) {
+			return start_field(Field::ITEM_CONTENT_ENCODED);
+		} else if (is("summary", ITUNES_URI)) {
+			return start_field(Field::ITEM_ITUNES_SUMMARY);
+		} else if (is("creator", DC_URI)) {
+			return start_field(Field::ITEM_DC_CREATOR);
+		}
+		return Role::OTHER;
+	}
+
+	// Atom
+	if (is("author", ns)) {
+		author = &item.author;
+		return Role::AUTHOR;
+	} else if (is("title", ns)) {
+		field_type = get_prop(element, "type");
+		return start_field(Field::ITEM_TITLE);
+	} else if (is("content", ns)) {
+		field_mode = get_prop(element, "mode");
+		field_type = get_prop(element, "type");
+		field_base = get_prop(element, "base", XML_URI);
+		const bool is_text = field_type == "html" || field_type == "text"
+			|| field_type == "text/plain";
+		return start_field(Field::ATOM_CONTENT,
+				(field_mode == "xml" || field_mode == "") && !is_text);
+	} else if (is("id", ns)) {
+		return start_field(Field::ATOM_ID);
+	} else if (is("published", ns)) {
+		return start_field(Field::ITEM_PUBDATE);
+	} else if (is("updated", ns)) {
+		return start_field(Field::ITEM_FALLBACK_DATE);
+	} else if (is("link", ns)) {
+		const std::string rel = get_prop(element, "rel");
+		if (rel == "" || rel == "alternate") {
+			if (item.link.empty() || !utils::is_http_url(item.link)) {
+				item.link = utils::absolute_url(item_base,
+						get_prop(element, "href"));
+			}
+		} else if (rel == "enclosure") {
+			item.enclosures.push_back(
+			Enclosure {
+				get_prop(element, "href"),
+				get_prop(element, "type"),
+			}
+			);
+		}
+		return Role::OTHER;
+	} else if (is("summary", ns)) {
+		field_mode = get_prop(element, "mode");
+		field_type = get_prop(element, "type");
+		const bool is_text = field_type == "html" || field_type == "text";
+		return start_field(Field::ATOM_SUMMARY,
+				(field_mode == "xml" || field_mode == "") && !is_text);
+	} else if (is("category", ns)
+		&& get_prop(element, "scheme") == "http://www.google.com/reader/") {
+		item.labels.push_back(get_prop(element, "label"));
+		return Role::OTHER;
+	}
+	return start_media(element);
+}
+
+StreamParser::Role StreamParser::start_author_child(const Element& element)
+{
+	if (std::strcmp(element.name, "name") == 0
+		&& has_namespace(element.uri, ns)) {
+		return start_field(Field::AUTHOR_NAME);
+	}
+	return Role::OTHER;
+}
+
+StreamParser::Role StreamParser::start_media(const Element& element)
+{
+	// Like parse_media_node()
+	if (!has_namespace(element.uri, MEDIA_RSS_URI)) {
+		return Role::OTHER;
+	}
+	if (std::strcmp(element.name, "group") == 0) {
+		return Role::MEDIA;
+	} else if (std::strcmp(element.name, "content") == 0) {
+		item.enclosures.push_back(
+		Enclosure {
+			get_prop(element, "url"),
+			get_prop(element, "type"),
+		}
+		);
+		return Role::MEDIA;
+	} else if (std::strcmp(element.name, "description") == 0) {
+		field_type = get_prop(element, "type");
+		return start_field(Field::MEDIA_DESCRIPTION);
+	} else if (std::strcmp(element.name, "title") == 0) {
+		return start_field(Field::MEDIA_TITLE);
+	} else if (std::strcmp(element.name, "player") == 0) {
+		if (item.link.empty()) {
+			item.link = get_prop(element, "url");
+		}
+	}
+	return Role::OTHER;
+}
+
+StreamParser::Role StreamParser::start_field(Field f, bool is_xml)
+{
+	field = f;
+	field_is_xml = is_xml;
+	text.clear();
+	tag_open = false;
+	after_cdata = false;
+	return Role::FIELD;
+}
+
+void StreamParser::end_field()
+{
+	std::string value = std::move(text);
+	text.clear();
+	open_names.clear();
+	const Field f = field;
+	field = Field::NONE;
+	field_is_xml = false;
+
+	switch (f) {
+	case Field::NONE:
+		break;
+	case Field::FEED_TITLE:
+		feed.title = std::move(value);
+		feed.title_type = format == Format::ATOM && !field_type.empty()
+			? field_type : "text";
+		break;
+	case Field::FEED_LINK:
+		feed.link = format == Format::RSS_09X
+			? utils::absolute_url(globalbase, value) : value;
+		break;
+	case Field::FEED_DESCRIPTION:
+		feed.description = std::move(value);
+		break;
+	case Field::FEED_LANGUAGE:
+		feed.language = std::move(value);
+		break;
+	case Field::FEED_MANAGINGEDITOR:
+		feed.managingeditor = std::move(value);
+		break;
+	case Field::FEED_TTL:
+		feed.ttl = std::move(value);
+		break;
+	case Field::FEED_UPDATE_PERIOD:
+		feed.update_period = std::move(value);
+		break;
+	case Field::FEED_UPDATE_FREQUENCY:
+		feed.update_frequency = std::move(value);
+		break;
+	case Field::FEED_PUBDATE:
+		feed.pubDate_ts = RssParser::parse_w3cdtf(value);
+		break;
+	case Field::FEED_DC_CREATOR:
+		feed.dc_creator = std::move(value);
+		break;
+	case Field::AUTHOR_NAME:
+		if (author != nullptr) {
+			if (!author->empty()) {
+				*author += ", ";
+			}
+			*author += value;
+		}
+		break;
+	case Field::ITEM_TITLE:
+		item.title = std::move(value);
+		item.title_type = format == Format::ATOM && !field_type.empty()
+			? field_type : "text";
+		break;
+	case Field::ITEM_LINK:
+		if (format != Format::RSS_09X) {
+			item.link = std::move(value);
+		} else if (item.link.empty() || !utils::is_http_url(item.link)) {
+			item.link = utils::absolute_url(item_base, value);
+		}
+		break;
+	case Field::ITEM_DESCRIPTION:
+		if (format == Format::RSS_09X) {
+			item.base = field_base.empty() ? item_base : field_base;
+		}
+		item.description = std::move(value);
+		item.description_mime_type = "";
+		break;
+	case Field::ITEM_CONTENT_ENCODED:
+		item.content_encoded = std::move(value);
+		break;
+	case Field::ITEM_ITUNES_SUMMARY:
+		item.itunes_summary = std::move(value);
+		break;
+	case Field::ITEM_GUID:
+		item.guid_isPermaLink = field_is_permalink;
+		item.guid = field_is_permalink
+			? utils::absolute_url(item_base, value) : value;
+		break;
+	case Field::ITEM_PUBDATE:
+		if (format == Format::RSS_09X) {
+			item.pubDate_ts = RssParser::parse_rfc822(value);
+			item.pubDate = std::move(value);
+		} else {
+			item.pubDate_ts = RssParser::parse_w3cdtf(value);
+		}
+		break;
+	case Field::ITEM_FALLBACK_DATE:
+		item_fallback_date = RssParser::parse_w3cdtf(value);
+		break;
+	case Field::ITEM_AUTHOR:
+		Rss09xParser::parse_author(value, item);
+		break;
+	case Field::ITEM_DC_CREATOR:
+		if (format == Format::RSS_10) {
+			item.author = std::move(value);
+		} else {
+			item_dc_creator = std::move(value);
+		}
+		break;
+	case Field::ATOM_CONTENT:
+		if (field_mode == "xml" || field_mode == "" || field_mode == "escaped") {
+			item.description = std::move(value);
+		}
+		item.description_mime_type = AtomParser::content_type_to_mime(field_type);
+		item.base = field_base.empty() ? item_base : field_base;
+		break;
+	case Field::ATOM_SUMMARY:
+		if (field_mode == "xml" || field_mode == "" || field_mode == "escaped") {
+			summary = std::move(value);
+		}
+		summary_mime_type = AtomParser::content_type_to_mime(field_type);
+		break;
+	case Field::ATOM_ID:
+		item.guid = std::move(value);
+		item.guid_isPermaLink = false;
+		break;
+	case Field::MEDIA_DESCRIPTION:
+		if (item.description.empty()) {
+			item.description = std::move(value);
+			item.description_mime_type = field_type == "html"
+				? "text/html" : "text/plain";
+		}
+		break;
+	case Field::MEDIA_TITLE:
+		if (item.title.empty()) {
+			item.title = std::move(value);
+		}
+		break;
+	}
+}
+
+void StreamParser::end_item()
+{
+	if (format == Format::RSS_09X) {
+		if (item.author == "") {
+			item.author = item_dc_creator;
+		}
+		if (item.pubDate == "") {
+			item.pubDate_ts = item_fallback_date;
+		}
+	} else if (format == Format::ATOM) {
+		if (item.description == "") {
+			item.description = summary;
+			item.description_mime_type = summary_mime_type;
+		}
+		if (item.pubDate_ts == 0) {
+			item.pubDate_ts = item_fallback_date;
+		}
+	}
+	feed.items.push_back(std::move(item));
+	item = Item();
+}
+
+void StreamParser::end_root()
+{
+	root_done = true;
+	if (format == Format::RSS_09X && !channel_seen) {
+		fail(_("no RSS channel found"));
+	} else if (format == Format::ATOM && !feed_author.empty()) {
+		for (auto& it : feed.items) {
+			if (it.author.empty()) {
+				it.author = feed_author;
+			}
+		}
+	}
+}
+
+bool StreamParser::find_prop(const Element& element, const char* name,
+	const char* ns_uri, std::string& value) const
+{
+	const xmlDocPtr doc = context != nullptr ? context->myDoc : nullptr;
+	for (int i = 0; i < element.nb_attributes; ++i) {
+		const xmlChar** attribute = element.attributes + 5 * i;
+		const xmlChar* prefix = attribute[1];
+		const xmlChar* uri = attribute[2];
+		bool matches;
+		if (ns_uri == nullptr) {
+			// An undeclared prefix stays in the name
+			matches = qname_is(uri == nullptr ? prefix : nullptr, attribute[0],
+					name);
+		} else {
+			matches = uri != nullptr && std::strcmp(to_chars(uri), ns_uri) == 0
+				&& std::strcmp(to_chars(attribute[0]), name) == 0;
+		}
+		if (matches) {
+			value = attribute_value(doc, attribute);
+			return true;
+		}
+	}
+
+	// Like xmlGetProp(), fall back to a default from the internal subset
+	if (doc == nullptr || doc->intSubset == nullptr) {
+		return false;
+	}
+	xmlAttributePtr declaration = nullptr;
+	if (ns_uri == nullptr) {
+		declaration = xmlGetDtdAttrDesc(doc->intSubset, to_xml(element.name),
+				to_xml(name));
+	} else if (std::strcmp(ns_uri, XML_URI) == 0) {
+		const std::string qname = element.prefix != nullptr
+			? std::string(element.prefix) + ":" + element.name
+			: std::string(element.name);
+		declaration = xmlGetDtdQAttrDesc(doc->intSubset, to_xml(qname.c_str()),
+				to_xml(name), to_xml("xml"));
+	}
+	if (declaration == nullptr || declaration->defaultValue == nullptr) {
+		return false;
+	}
+	value = to_chars(declaration->defaultValue);
+	return true;
+}
+
+std::string StreamParser::get_prop(const Element& element, const char* name,
+	const char* ns_uri) const
+{
+	std::string value;
+	find_prop(element, name, ns_uri, value);
+	return value;
+}
+
+bool StreamParser::escapes_non_ascii() const
+{
+	// The encoding ends up in the document once it's parsed
+	const xmlDocPtr doc = context->myDoc;
+	return (doc == nullptr || doc->encoding == nullptr)
+		&& context->encoding == nullptr
+		&& (context->inputNr == 0 || context->inputTab[0]->encoding == nullptr);
+}
+
+void StreamParser::dump_children()
+{
+	if (tag_open) {
+		text += '>';
+		tag_open = false;
+	}
+}
+
+void StreamParser::dump_start(const Element& element)
+{
+	if (!field_is_xml) {
+		return;
+	}
+	dump_children();
+	after_cdata = false;
+
+	// As get_xml_content() leaves it: without the element's prefix, but
+	// with its namespace declarations and its attributes' prefixes
+	text += '<';
+	text += element.name;
+	for (int i = 0; i < element.nb_namespaces; ++i) {
+		const xmlChar* prefix = element.namespaces[2 * i];
+		const xmlChar* uri = element.namespaces[2 * i + 1];
+		if (uri == nullptr
+			|| (prefix != nullptr && std::strcmp(to_chars(prefix), "xml") == 0)) {
+			continue;
+		}
+		text += prefix != nullptr ? " xmlns:" : " xmlns";
+		if (prefix != nullptr) {
+			text += to_chars(prefix);
+		}
+		text += '=';
+		append_quoted(text, to_chars(uri));
+	}
+
+	const xmlDocPtr doc = context->myDoc;
+	const bool escape_non_ascii = escapes_non_ascii();
+	for (int i = 0; i < element.nb_attributes; ++i) {
+		const xmlChar** attribute = element.attributes + 5 * i;
+		text += ' ';
+		if (attribute[1] != nullptr) {
+			text += to_chars(attribute[1]);
+			text += ':';
+		}
+		text += to_chars(attribute[0]);
+		text += "=\"";
+		const char* begin = to_chars(attribute[3]);
+		const char* end = to_chars(attribute[4]);
+		if (*end != '\0') {
+			append_escaped_attribute(text, std::string(begin, end), escape_non_ascii);
+		} else {
+			split_value(doc, begin, end,
+			[this, escape_non_ascii](const char* data, std::size_t size) {
+				append_escaped_attribute(text, std::string(data, size),
+					escape_non_ascii);
+			},
+			[this](const std::string& name, xmlEntityPtr) {
+				text += '&' + name + ';';
+			});
+		}
+		text += '"';
+	}
+
+	tag_open = true;
+	open_names.push_back(element.name);
+}
+
+void StreamParser::dump_end()
+{
+	if (!field_is_xml) {
+		return;
+	}
+	if (tag_open) {
+		text += "/>";
+		tag_open = false;
+	} else {
+		text += "</";
+		text += open_names.back();
+		text += '>';
+	}
+	open_names.pop_back();
+	after_cdata = false;
+}
+
+} // namespace rsspp
@@ -0,0 +1,224 @@
+#ifndef NEWSBOAT_RSSPP_STREAMPARSER_H_
+#define NEWSBOAT_RSSPP_STREAMPARSER_H_
+
+#include <cstddef>
+#include <libxml/parser.h>
+#include <string>
+#include <vector>
+
+#include "feed.h"
+#include "item.h"
+
+namespace rsspp {
+
+/// \brief Builds a Feed from libxml2's SAX events while the document is
+/// parsed, instead of from the document tree once it's done.
+///
+/// The Feed is the one that Parser's tree path and the RssParser subclasses
+/// make of the same document: elements are picked by the same names and
+/// namespaces, in the same order, and their text and attributes come out
+/// the same. But no nodes are allocated, and only the text of the element
+/// that's being read is kept, so the memory doesn't grow with the size of
+/// the document.
+///
+/// The context still makes a document, which keeps the internal subset and
+/// the encoding; it just has no elements.
+class StreamParser {
+public:
+	/// \brief Only the first \a max_items items are read, 0 for all.
+	///
+	/// The rest are skipped over like unknown elements, so that nothing
+	/// is kept of them.
+	explicit StreamParser(std::size_t max_items = 0);
+	StreamParser(const StreamParser&) = delete;
+	StreamParser& operator=(const StreamParser&) = delete;
+
+	/// The SAX callbacks to give Parser::acquire_context().
+	static const xmlSAXHandler* sax_handler();
+
+	/// Makes \a context, which has to use sax_handler(), report to this.
+	/// Has to be called before anything is parsed.
+	void attach(xmlParserCtxtPtr context);
+
+	/// \brief Returns the feed once the whole document has been parsed.
+	///
+	/// Elements that weren't closed, e.g. because the document was cut
+	/// short, are ended first, just like the tree keeps what it got of
+	/// them. Throws Exception for the documents that the tree path throws
+	/// for, with the same message.
+	Feed finish();
+
+private:
+	/// What an element is to the feed
+	enum class Role {
+		ROOT,
+		CHANNEL,
+		ITEM,
+		/// An Atom author, whose names are read
+		AUTHOR,
+		/// A Media RSS group or content, whose Media RSS children are read
+		MEDIA,
+		/// The element whose text is being read
+		FIELD,
+		/// Anything else, including everything within a FIELD
+		OTHER,
+	};
+
+	enum class Format {
+		UNKNOWN,
+		RSS_09X,
+		RSS_10,
+		ATOM,
+	};
+
+	/// The element whose text is being read, named after where it ends up
+	enum class Field {
+		NONE,
+		FEED_TITLE,
+		FEED_LINK,
+		FEED_DESCRIPTION,
+		FEED_LANGUAGE,
+		FEED_MANAGINGEDITOR,
+		FEED_TTL,
+		FEED_UPDATE_PERIOD,
+		FEED_UPDATE_FREQUENCY,
+		FEED_PUBDATE,
+		FEED_DC_CREATOR,
+		AUTHOR_NAME,
+		ITEM_TITLE,
+		ITEM_LINK,
+		ITEM_DESCRIPTION,
+		ITEM_CONTENT_ENCODED,
+		ITEM_ITUNES_SUMMARY,
+		ITEM_GUID,
+		ITEM_PUBDATE,
+		/// RSS's dc:date and Atom's updated, for items without a pubDate
+		ITEM_FALLBACK_DATE,
+		ITEM_AUTHOR,
+		ITEM_DC_CREATOR,
+		ATOM_CONTENT,
+		ATOM_SUMMARY,
+		ATOM_ID,
+		MEDIA_DESCRIPTION,
+		MEDIA_TITLE,
+	};
+
+	/// A start tag as the SAX2 callbacks get it
+	struct Element {
+		/// The name the node in the tree would have: with the prefix if
+		/// that wasn't declared
+		const char* name;
+		const char* prefix;
+		/// The namespace, or nullptr if none
+		const char* uri;
+		int nb_namespaces;
+		const xmlChar** namespaces;
+		/// The attributes that were given, without the defaults from the
+		/// DTD, each as five pointers: name, prefix, URI, value and the
+		/// end of the value
+		int nb_attributes;
+		const xmlChar** attributes;
+	};
+
+	static void on_start_element(void* ctx, const xmlChar* localname,
+		const xmlChar* prefix, const xmlChar* uri, int nb_namespaces,
+		const xmlChar** namespaces, int nb_attributes, int nb_defaulted,
+		const xmlChar** attributes);
+	static void on_end_element(void* ctx, const xmlChar* localname,
+		const xmlChar* prefix, const xmlChar* uri);
+	static void on_characters(void* ctx, const xmlChar* ch, int len);
+	static void on_cdata(void* ctx, const xmlChar* value, int len);
+	static void on_comment(void* ctx, const xmlChar* value);
+	static void on_processing_instruction(void* ctx, const xmlChar* target,
+		const xmlChar* data);
+	static void on_reference(void* ctx, const xmlChar* name);
+
+	void start_element(const Element& element);
+	void end_element();
+	void add_text(const char* data, std::size_t size);
+
+	Role start_root(const Element& element);
+	Role start_root_child(const Element& element);
+	Role start_channel_child(const Element& element);
+	Role start_item_child(const Element& element);
+	Role start_author_child(const Element& element);
+	Role start_media(const Element& element);
+	Role start_item(const Element& element);
+	/// Takes the feed's link, WebSub hub or "self" link from an Atom link.
+	void start_feed_link(const Element& element);
+	Role start_field(Field f, bool is_xml = false);
+	void end_field();
+	void end_item();
+	void end_root();
+
+	/// Like get_prop() on the element's node: without \a ns_uri, the first
+	/// attribute called \a name in any namespace. Returns false if there's
+	/// none.
+	bool find_prop(const Element& element, const char* name,
+		const char* ns_uri, std::string& value) const;
+	std::string get_prop(const Element& element, const char* name,
+		const char* ns_uri = nullptr) const;
+
+	/// Writes what xmlNodeDump() writes for the element, up to its
+	/// children, if the field is read as XML.
+	void dump_start(const Element& element);
+	/// Writes the end of the innermost open element, if the field is read
+	/// as XML.
+	void dump_end();
+	/// Ends the start tag of the element the next child is in.
+	void dump_children();
+	/// Whether attributes are written with their non-ASCII characters as
+	/// references, which depends on the document's encoding.
+	bool escapes_non_ascii() const;
+
+	/// Stops the parser; finish() throws \a message.
+	void fail(const std::string& message);
+
+	xmlParserCtxtPtr context;
+	const std::size_t max_items;
+
+	Feed feed;
+	Format format;
+	std::string error;
+	bool root_seen;
+	bool root_done;
+	bool channel_seen;
+
+	/// The namespace of the feed's own elements
+	const char* ns;
+	std::string globalbase;
+
+	std::vector<Role> roles;
+
+	Item item;
+	std::string item_base;
+	std::string item_dc_creator;
+	time_t item_fallback_date;
+	std::string summary;
+	std::string summary_mime_type;
+	std::string feed_author;
+	/// Where the names of the AUTHOR that's open go
+	std::string* author;
+
+	Field field;
+	/// Whether the field is read as it's serialized, rather than as text
+	bool field_is_xml;
+	std::string text;
+	/// Attributes of the field's element, for what its text ends up in
+	std::string field_type;
+	std::string field_mode;
+	std::string field_base;
+	bool field_is_permalink;
+
+	/// Whether the start tag of the innermost element has yet to end
+	bool tag_open;
+	/// Whether the last thing in the XML was a CDATA section, which the
+	/// tree would add the next one to
+	bool after_cdata;
+	/// Names of the elements that are open within an XML field
+	std::vector<const char*> open_names;
+};
+
+} // namespace rsspp
+
+#endif /* NEWSBOAT_RSSPP_STREAMPARSER_H_ */
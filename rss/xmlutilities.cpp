@@ -4,10 +4,45 @@
 
 namespace rsspp {
 
+namespace {
+
+/// Appends the text of \a node to \a out if it's an element that holds
+/// nothing but text and CDATA, which is what nearly all elements of a feed
+/// hold. Returns false, leaving \a out alone, for any other node.
+bool append_text_children(xmlNode* node, std::string& out)
+{
+	if (node->type != XML_ELEMENT_NODE) {
+		return false;
+	}
+	std::size_t length = 0;
+	for (xmlNode* child = node->children; child != nullptr;
+		child = child->next) {
+		if ((child->type != XML_TEXT_NODE
+				&& child->type != XML_CDATA_SECTION_NODE)
+			|| child->content == nullptr) {
+			return false;
+		}
+		length += std::strlen(reinterpret_cast<const char*>(child->content));
+	}
+	out.reserve(out.size() + length);
+	for (xmlNode* child = node->children; child != nullptr;
+		child = child->next) {
+		out.append(reinterpret_cast<const char*>(child->content));
+	}
+	return true;
+}
+
+}
+
 std::string get_content(xmlNode* node)
 {
 	std::string retval;
 	if (node) {
+		// The text is read where it is, instead of having libxml2 put a
+		// copy of it together first
+		if (append_text_children(node, retval)) {
+			return retval;
+		}
 		xmlChar* content = xmlNodeGetContent(node);
 		if (content) {
 			retval = reinterpret_cast<const char*>(content);
@@ -87,7 +122,9 @@ bool has_namespace(xmlNode* node, const char* ns_uri)
 
 bool node_is(xmlNode* node, const char* name, const char* ns_uri)
 {
-	if (!node || !name || !node->name) {
+	// Feeds are indented, so every other child is whitespace, which
+	// can't be what's looked for
+	if (!node || !name || !node->name || node->type != XML_ELEMENT_NODE) {
 		return false;
 	}
 
@@ -6,12 +6,15 @@
 
 namespace rsspp {
 
+/// The text inside \a node, as xmlNodeGetContent() puts it together.
 std::string get_content(xmlNode* node);
 std::string get_xml_content(xmlNode* node, xmlDocPtr doc);
 void cleanup_namespaces(xmlNodePtr node);
 std::string get_prop(xmlNode* node, const std::string& prop,
 	const std::string& ns = "");
 bool has_namespace(xmlNode* node, const char* ns_uri = nullptr);
+/// Whether \a node is an element called \a name, in the namespace
+/// \a ns_uri (or in none, if that's nullptr).
 bool node_is(xmlNode* node, const char* name, const char* ns_uri = nullptr);
 
 } // namespace rsspp
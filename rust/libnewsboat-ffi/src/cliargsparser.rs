@@ -21,6 +21,12 @@ mod bridged {
         pub data: Vec<u8>,
     }
 
+    /// A module (source file) and the loglevel set for it with `--log-module`.
+    struct LogModule {
+        pub name: String,
+        pub level: i8,
+    }
+
     extern "Rust" {
         type CliArgsParser;
 
@@ -30,6 +36,7 @@ mod bridged {
         fn do_export(cliargsparser: &CliArgsParser) -> bool;
         fn do_vacuum(cliargsparser: &CliArgsParser) -> bool;
         fn do_cleanup(cliargsparser: &CliArgsParser) -> bool;
+        fn dump_memory_stats(cliargsparser: &CliArgsParser) -> bool;
         fn do_show_version(cliargsparser: &CliArgsParser) -> u64;
         fn silent(cliargsparser: &CliArgsParser) -> bool;
         fn using_nonstandard_configs(cliargsparser: &CliArgsParser) -> bool;
@@ -53,6 +60,7 @@ mod bridged {
         fn cmds_to_execute(cliargsparser: &CliArgsParser) -> Vec<String>;
 
         fn log_level(cliargsparser: &CliArgsParser, level: &mut i8) -> bool;
+        fn log_modules(cliargsparser: &CliArgsParser) -> Vec<LogModule>;
     }
 
     extern "C++" {
@@ -91,6 +99,10 @@ fn do_cleanup(cliargsparser: &CliArgsParser) -> bool {
     cliargsparser.0.do_cleanup
 }
 
+fn dump_memory_stats(cliargsparser: &CliArgsParser) -> bool {
+    cliargsparser.0.dump_memory_stats
+}
+
 fn do_show_version(cliargsparser: &CliArgsParser) -> u64 {
     cliargsparser.0.show_version as u64
 }
@@ -219,3 +231,15 @@ fn log_level(cliargsparser: &CliArgsParser, level: &mut i8) -> bool {
         None => false,
     }
 }
+
+fn log_modules(cliargsparser: &CliArgsParser) -> Vec<bridged::LogModule> {
+    cliargsparser
+        .0
+        .log_modules
+        .iter()
+        .map(|(name, level)| bridged::LogModule {
+            name: name.clone(),
+            level: *level as i8,
+        })
+        .collect()
+}
@@ -3,16 +3,24 @@ use libnewsboat::fmtstrformatter;
 // cxx doesn't allow to share types from other crates, so we have to wrap it
 // cf. https://github.com/dtolnay/cxx/issues/496
 struct FmtStrFormatter(fmtstrformatter::FmtStrFormatter);
+struct FormatTemplate(fmtstrformatter::FormatTemplate);
 
 #[cxx::bridge(namespace = "newsboat::fmtstrformatter::bridged")]
 mod bridged {
     extern "Rust" {
         type FmtStrFormatter;
+        type FormatTemplate;
 
         fn create() -> Box<FmtStrFormatter>;
+        fn create_template(format: &str) -> Box<FormatTemplate>;
 
         fn register_fmt(fmt: &mut FmtStrFormatter, key: u8, value: &str);
         fn do_format(fmt: &mut FmtStrFormatter, format: &str, width: u32) -> String;
+        fn do_format_template(
+            fmt: &FmtStrFormatter,
+            template: &FormatTemplate,
+            width: u32,
+        ) -> String;
     }
 }
 
@@ -20,6 +28,10 @@ fn create() -> Box<FmtStrFormatter> {
     Box::new(FmtStrFormatter(fmtstrformatter::FmtStrFormatter::new()))
 }
 
+fn create_template(format: &str) -> Box<FormatTemplate> {
+    Box::new(FormatTemplate(fmtstrformatter::FormatTemplate::new(format)))
+}
+
 fn register_fmt(fmt: &mut FmtStrFormatter, key: u8, value: &str) {
     fmt.0.register_fmt(key as char, value.to_string());
 }
@@ -27,3 +39,7 @@ fn register_fmt(fmt: &mut FmtStrFormatter, key: u8, value: &str) {
 fn do_format(fmt: &mut FmtStrFormatter, format: &str, width: u32) -> String {
     fmt.0.do_format(format, width)
 }
+
+fn do_format_template(fmt: &FmtStrFormatter, template: &FormatTemplate, width: u32) -> String {
+    fmt.0.do_format_template(&template.0, width)
+}
@@ -18,6 +18,7 @@ mod ffi {
         fn get_loglevel() -> i64;
         fn set_loglevel(level: Level);
         fn log_internal(level: Level, message: &str);
+        fn log_unfiltered(level: Level, message: &str);
         fn set_user_error_logfile(user_error_logfile: &str);
     }
 }
@@ -56,6 +57,11 @@ fn log_internal(level: ffi::Level, message: &str) {
     logger::get_instance().log(level, message);
 }
 
+fn log_unfiltered(level: ffi::Level, message: &str) {
+    let level = ffi_level_to_log_level(level);
+    logger::get_instance().log_unfiltered(level, message);
+}
+
 fn set_user_error_logfile(user_error_logfile: &str) {
     logger::get_instance().set_user_error_logfile(user_error_logfile);
 }
@@ -22,8 +22,6 @@ mod ffi {
         fn gentabs(string: &str) -> usize;
         fn run_command(cmd: &str, param: &str);
         fn strnaturalcmp(a: &str, b: &str) -> isize;
-        fn strwidth(rs_str: &str) -> usize;
-        fn strwidth_stfl(rs_str: &str) -> usize;
         fn extract_filter(line: &str) -> FilterUrlParts;
         fn newsboat_major_version() -> u32;
 
@@ -56,13 +54,14 @@ mod bridged {
         fn absolute_url(base_url: &str, link: &str) -> String;
         fn censor_url(url: &str) -> String;
         fn quote_for_stfl(string: &str) -> String;
-        fn trim(rs_str: String) -> String;
-        fn trim_end(rs_str: String) -> String;
+        fn trim(rs_str: &str) -> String;
         fn quote(input: String) -> String;
         fn quote_if_necessary(input: String) -> String;
         fn make_title(rs_str: String) -> String;
         fn get_default_browser() -> String;
         fn md5hash(input: &str) -> String;
+        fn strwidth(rs_str: &str) -> usize;
+        fn strwidth_stfl(rs_str: &str) -> usize;
         fn substr_with_width(string: &str, max_width: usize) -> String;
         fn substr_with_width_stfl(string: &str, max_width: usize) -> String;
         fn get_command_output(cmd: &str) -> String;
@@ -102,6 +101,12 @@ mod bridged {
     }
 }
 
+// C++ trims its own strings unless there's non-ASCII text at their ends, and then
+// only needs to lend them to us.
+fn trim(rs_str: &str) -> String {
+    rs_str.trim().to_owned()
+}
+
 fn get_auth_method(method: &str) -> u64 {
     utils::get_auth_method(method) as u64
 }
@@ -14,6 +14,7 @@ pub struct CliArgsParser {
     pub do_export: bool,
     pub do_vacuum: bool,
     pub do_cleanup: bool,
+    pub dump_memory_stats: bool,
     pub program_name: String,
     pub show_version: usize,
     pub silent: bool,
@@ -71,6 +72,9 @@ pub struct CliArgsParser {
 
     /// If this contains some value, it's the log level specified by the user.
     pub log_level: Option<Level>,
+
+    /// Log levels for particular modules (source files), which override `log_level` for them.
+    pub log_modules: Vec<(String, Level)>,
 }
 
 /// Returns new path with an added extension
@@ -174,6 +178,10 @@ pub fn parse_cliargs(opts: Vec<OsString>, args: &mut CliArgsParser) -> Result<()
             }
             Short('X') | Long("vacuum") => args.do_vacuum = true,
             Long("cleanup") => args.do_cleanup = true,
+            Long("dump-memory-stats") => {
+                args.dump_memory_stats = true;
+                args.silent = true;
+            }
             Short('v') | Long("version") | Short('V') | Long("-V") => args.show_version += 1,
             Short('x') | Long("execute") => {
                 for cmd in parser.values()? {
@@ -212,6 +220,26 @@ pub fn parse_cliargs(opts: Vec<OsString>, args: &mut CliArgsParser) -> Result<()
                     }
                 }
             }
+            Long("log-module") => {
+                let log_module_str = parser.value()?;
+                let log_module = log_module_str.to_string_lossy().to_string();
+                let parsed = log_module.rsplit_once(':').and_then(|(module, level)| {
+                    match Level::try_from(OsStr::new(level)) {
+                        Ok(level) if !module.is_empty() => Some((module.to_string(), level)),
+                        _ => None,
+                    }
+                });
+                match parsed {
+                    Some(module) => args.log_modules.push(module),
+                    None => {
+                        return Err(CliParseError::InvalidLogLevel(fmt!(
+                            &gettext("%s: %s: invalid log-module value"),
+                            &args.program_name,
+                            log_module
+                        )));
+                    }
+                }
+            }
             _ => return Err(CliParseError::from(arg.unexpected())),
         }
     }
@@ -546,6 +574,13 @@ mod tests {
         check(vec!["newsboat".into(), "--cleanup".into()]);
     }
 
+    #[test]
+    fn t_sets_dump_memory_stats_if_dash_dash_dump_memory_stats_is_provided() {
+        let args = CliArgsParser::new(vec!["newsboat".into(), "--dump-memory-stats".into()]);
+
+        assert!(args.dump_memory_stats);
+    }
+
     #[test]
     fn t_increases_show_version_with_each_dash_v_provided() {
         let check = |opts, expected_version| {
@@ -769,6 +804,39 @@ mod tests {
         check(vec!["newsboat".into(), "--log-level=90001".into()]);
     }
 
+    #[test]
+    fn t_collects_module_and_level_from_each_log_module_option() {
+        let args = CliArgsParser::new(vec![
+            "newsboat".into(),
+            "--log-module=reloader:6".into(),
+            "--log-module".into(),
+            "cache:3".into(),
+        ]);
+
+        assert_eq!(
+            args.log_modules,
+            vec![
+                ("reloader".to_string(), Level::Debug),
+                ("cache".to_string(), Level::Error),
+            ]
+        );
+        assert_eq!(args.log_level, None);
+    }
+
+    #[test]
+    fn t_sets_display_msg_and_asks_to_exit_with_failure_if_log_module_is_invalid() {
+        let check = |opts| {
+            let args = CliArgsParser::new(opts);
+
+            assert!(!args.display_msg.is_empty());
+            assert_eq!(args.return_code, Some(EXIT_FAILURE));
+        };
+
+        check(vec!["newsboat".into(), "--log-module=reloader".into()]);
+        check(vec!["newsboat".into(), "--log-module=reloader:7".into()]);
+        check(vec!["newsboat".into(), "--log-module=:6".into()]);
+    }
+
     #[test]
     fn t_sets_program_name_to_the_first_string_of_the_options_list() {
         let check = |opts, expected: String| {
@@ -73,11 +73,15 @@ impl FmtStrFormatter {
 
     /// Takes a format string and replaces format specifiers with their values.
     pub fn do_format(&self, format: &str, width: u32) -> String {
-        let ast = parse(format);
-        self.formatting_helper(&ast, width)
+        self.do_format_template(&FormatTemplate::new(format), width)
     }
 
-    fn format_spacing(&self, c: char, rest: &[Specifier], width: u32, result: &mut LimitedString) {
+    /// Same as `do_format`, but with a format string that's already been parsed.
+    pub fn do_format_template(&self, template: &FormatTemplate, width: u32) -> String {
+        self.formatting_helper(&template.ast, width)
+    }
+
+    fn format_spacing(&self, c: char, rest: &[Node], width: u32, result: &mut LimitedString) {
         let rest = self.formatting_helper(rest, 0);
         if width == 0 {
             result.push(c);
@@ -146,8 +150,8 @@ impl FmtStrFormatter {
     fn format_conditional(
         &self,
         cond: char,
-        then: &[Specifier],
-        els: &Option<Vec<Specifier>>,
+        then: &[Node],
+        els: &Option<Vec<Node>>,
         width: u32,
         result: &mut LimitedString,
     ) {
@@ -163,7 +167,7 @@ impl FmtStrFormatter {
         }
     }
 
-    fn formatting_helper(&self, format_ast: &[Specifier], width: u32) -> String {
+    fn formatting_helper(&self, format_ast: &[Node], width: u32) -> String {
         let mut result = LimitedString::new(if width == 0 {
             None
         } else {
@@ -172,18 +176,18 @@ impl FmtStrFormatter {
 
         for (i, specifier) in format_ast.iter().enumerate() {
             match *specifier {
-                Specifier::Spacing(c) => {
+                Node::Spacing(c) => {
                     let rest = &format_ast[i + 1..];
                     self.format_spacing(c, rest, width, &mut result);
                     // format_spacing will also format the rest of the string, so quit the loop
                     break;
                 }
 
-                Specifier::Format(c, ref padding) => {
+                Node::Format(c, ref padding) => {
                     self.format_format(c, padding, width, &mut result);
                 }
 
-                Specifier::Text(s) => {
+                Node::Text(ref s) => {
                     if width == 0 {
                         result.push_str(s);
                     } else {
@@ -197,7 +201,7 @@ impl FmtStrFormatter {
                     }
                 }
 
-                Specifier::Conditional(cond, ref then, ref els) => {
+                Node::Conditional(cond, ref then, ref els) => {
                     self.format_conditional(cond, then, els, width, &mut result)
                 }
             }
@@ -207,6 +211,46 @@ impl FmtStrFormatter {
     }
 }
 
+/// A format string that's been parsed once, so that it can be formatted many times over.
+///
+/// `FmtStrFormatter::do_format` parses its format string on every call. Lists that format all of
+/// their lines with the same string should parse it into a template once, and pass that to
+/// `FmtStrFormatter::do_format_template` instead.
+pub struct FormatTemplate {
+    ast: Vec<Node>,
+}
+
+impl FormatTemplate {
+    /// Parses `format`.
+    pub fn new(format: &str) -> FormatTemplate {
+        FormatTemplate {
+            ast: to_nodes(&parse(format)),
+        }
+    }
+}
+
+/// Same as `parser::Specifier`, except it owns its text, so it outlives the format string.
+enum Node {
+    Spacing(char),
+    Format(char, Padding),
+    Text(String),
+    Conditional(char, Vec<Node>, Option<Vec<Node>>),
+}
+
+fn to_nodes(specifiers: &[Specifier]) -> Vec<Node> {
+    specifiers
+        .iter()
+        .map(|specifier| match *specifier {
+            Specifier::Spacing(c) => Node::Spacing(c),
+            Specifier::Format(c, ref padding) => Node::Format(c, padding.clone()),
+            Specifier::Text(s) => Node::Text(s.to_string()),
+            Specifier::Conditional(cond, ref then, ref els) => {
+                Node::Conditional(cond, to_nodes(then), els.as_ref().map(|els| to_nodes(els)))
+            }
+        })
+        .collect()
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -594,6 +638,32 @@ mod tests {
         assert_eq!(fmt.do_format("%%", 0), "%");
     }
 
+    #[test]
+    fn t_do_format_template_formats_the_same_as_do_format() {
+        let format = "%4i %?T?|%-17T| ?%t%> %D";
+        let template = FormatTemplate::new(format);
+        let mut fmt = FmtStrFormatter::new();
+        fmt.register_fmt('i', "42".to_string());
+        fmt.register_fmt('t', "Title".to_string());
+        fmt.register_fmt('D', "Oct 14".to_string());
+
+        assert_eq!(
+            fmt.do_format_template(&template, 0),
+            fmt.do_format(format, 0)
+        );
+        assert_eq!(
+            fmt.do_format_template(&template, 30),
+            fmt.do_format(format, 30)
+        );
+
+        // The template can be reused with other values
+        fmt.register_fmt('T', "Feed".to_string());
+        assert_eq!(
+            fmt.do_format_template(&template, 40),
+            "  42 |Feed             | Title    Oct 14"
+        );
+    }
+
     #[test]
     fn t_ampersand_is_treated_literally_outside_of_conditionals() {
         let mut fmt = FmtStrFormatter::new();
@@ -1,12 +1,20 @@
 //! Keeps a record of what the program did.
 
-use chrono::{offset::Local, Datelike, Timelike};
+use chrono::{offset::Local, DateTime, Datelike, Timelike};
 use once_cell::sync::OnceCell;
 use std::fmt;
 use std::fs::{File, OpenOptions};
 use std::io::Write;
-use std::sync::atomic::{AtomicIsize, Ordering};
-use std::sync::Mutex;
+use std::sync::atomic::{AtomicIsize, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, Receiver, SyncSender, TrySendError};
+use std::sync::{Arc, Mutex, Once};
+use std::thread::{self, JoinHandle};
+
+/// How many messages can wait for the writer thread before new ones are dropped.
+const QUEUE_CAPACITY: usize = 4096;
+
+/// How many messages the writer thread takes from the queue before writing them out.
+const BATCH_SIZE: usize = 256;
 
 #[derive(Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Debug)]
 /// "Importance levels" for log messages.
@@ -74,6 +82,166 @@ struct LogFiles {
     user_error_logfile: Option<File>,
 }
 
+/// What the logging threads hand to the writer thread.
+enum Message {
+    Line {
+        level: Level,
+        timestamp: DateTime<Local>,
+        data: Vec<u8>,
+        /// Whether the line goes to the general log; it might only be meant for the error log.
+        to_logfile: bool,
+    },
+
+    /// Asks the writer to answer once it wrote everything queued before this.
+    Flush(mpsc::Sender<()>),
+
+    /// Asks the writer to write everything queued before this, and exit.
+    Stop,
+}
+
+/// Incremented in the child process after each `fork()`.
+///
+/// The writer thread doesn't survive a fork, so a Logger created in an earlier "generation" has
+/// to write the child's messages itself.
+static FORK_GENERATION: AtomicUsize = AtomicUsize::new(0);
+
+extern "C" fn count_fork() {
+    FORK_GENERATION.fetch_add(1, Ordering::SeqCst);
+}
+
+/// Formats `timestamp` the way it appears in the logs.
+fn format_timestamp(timestamp: &DateTime<Local>) -> String {
+    // DateTime::format() is extremely slow; format! is way faster. See
+    // https://github.com/chronotope/chrono/issues/94 for details.
+    format!(
+        "[{}-{:02}-{:02} {:02}:{:02}:{:02}] ",
+        timestamp.year(),
+        timestamp.month(),
+        timestamp.day(),
+        timestamp.hour(),
+        timestamp.minute(),
+        timestamp.second()
+    )
+}
+
+/// Accumulates a batch of lines for the logfile and the error logfile, so each of them is written
+/// with a single call.
+#[derive(Default)]
+struct Batch {
+    log: Vec<u8>,
+    user_error_log: Vec<u8>,
+
+    /// What the last timestamp was formatted into; most lines in a batch share it.
+    last_timestamp: Option<(i64, String)>,
+}
+
+impl Batch {
+    fn add(&mut self, level: Level, timestamp: &DateTime<Local>, data: &[u8], to_logfile: bool) {
+        let seconds = timestamp.timestamp();
+        let cached = matches!(self.last_timestamp, Some((s, _)) if s == seconds);
+        if !cached {
+            self.last_timestamp = Some((seconds, format_timestamp(timestamp)));
+        }
+        let timestamp = match self.last_timestamp {
+            Some((_, ref formatted)) => formatted.as_bytes(),
+            None => unreachable!(),
+        };
+
+        if to_logfile {
+            self.log.extend_from_slice(timestamp);
+            self.log
+                .extend_from_slice(format!("{}: ", level).as_bytes());
+            self.log.extend_from_slice(data);
+            self.log.push(b'\n');
+        }
+
+        if level == Level::UserError {
+            self.user_error_log.extend_from_slice(timestamp);
+            self.user_error_log.extend_from_slice(data);
+            self.user_error_log.push(b'\n');
+        }
+    }
+
+    /// Writes the lines out, and empties the batch.
+    fn write(&mut self, files: &Mutex<LogFiles>) {
+        if self.log.is_empty() && self.user_error_log.is_empty() {
+            return;
+        }
+
+        {
+            let mut files = files.lock().expect("Someone poisoned logger's mutex");
+            // Ignoring the errors since there is nobody to report them to.
+            if let Some(ref mut logfile) = files.logfile {
+                if !self.log.is_empty() {
+                    let _ = logfile.write_all(&self.log);
+                }
+            }
+            if let Some(ref mut user_error_logfile) = files.user_error_logfile {
+                if !self.user_error_log.is_empty() {
+                    let _ = user_error_logfile.write_all(&self.user_error_log);
+                }
+            }
+        }
+
+        self.log.clear();
+        self.user_error_log.clear();
+    }
+}
+
+/// The body of the writer thread: writes out the messages in batches, until it's told to stop.
+fn write_messages(
+    queue: Receiver<Message>,
+    files: Arc<Mutex<LogFiles>>,
+    dropped: Arc<AtomicUsize>,
+) {
+    let mut batch = Batch::default();
+    let mut flushes = vec![];
+
+    // recv() fails once every Logger's end of the queue is gone.
+    while let Ok(first) = queue.recv() {
+        let mut stop = false;
+        let mut next = Some(first);
+        let mut taken = 0;
+        while let Some(message) = next {
+            match message {
+                Message::Line {
+                    level,
+                    timestamp,
+                    data,
+                    to_logfile,
+                } => batch.add(level, &timestamp, &data, to_logfile),
+                Message::Flush(done) => flushes.push(done),
+                Message::Stop => {
+                    stop = true;
+                    break;
+                }
+            }
+
+            taken += 1;
+            next = if taken < BATCH_SIZE {
+                queue.try_recv().ok()
+            } else {
+                None
+            };
+        }
+
+        let lost = dropped.swap(0, Ordering::Relaxed);
+        if lost > 0 {
+            let message = format!("{} messages were dropped because the log fell behind", lost);
+            batch.add(Level::Warn, &Local::now(), message.as_bytes(), true);
+        }
+
+        batch.write(&files);
+        for done in flushes.drain(..) {
+            let _ = done.send(());
+        }
+
+        if stop {
+            break;
+        }
+    }
+}
+
 /// Keeps a record of what the program did.
 ///
 /// Each Logger object can write up to two logs.
@@ -86,6 +254,11 @@ struct LogFiles {
 ///
 /// Each message in the log is time-stamped, and marked with its importance level.
 ///
+/// The messages are written by a background thread, so `log()` doesn't wait for the disk. If that
+/// thread falls behind by more than a few thousand messages, further messages are dropped (and
+/// the log says how many); Level::UserError and Level::Critical messages are never dropped. Call
+/// `flush()` to wait until everything logged so far is written.
+///
 /// This is meant to be a long-lived, shared object that exists for the duration of the program.
 /// Users would call its `log` method to add messages to the log file, like this:
 ///
@@ -108,10 +281,21 @@ struct LogFiles {
 /// ```
 pub struct Logger {
     /// Handles for the files to which messages should be written.
-    files: Mutex<LogFiles>,
+    files: Arc<Mutex<LogFiles>>,
 
     /// Maximum "importance level" of the messages that will be written to the log.
     loglevel: AtomicIsize,
+
+    /// The messages on their way to the writer thread.
+    queue: SyncSender<Message>,
+
+    /// How many messages were dropped since the writer last noted it in the log.
+    dropped: Arc<AtomicUsize>,
+
+    writer: Mutex<Option<JoinHandle<()>>>,
+
+    /// The value of `FORK_GENERATION` when the writer thread was started.
+    generation: usize,
 }
 
 impl Logger {
@@ -119,15 +303,42 @@ impl Logger {
     ///
     /// To make that Logger useful, you need to call set_logfile() and set_loglevel().
     pub fn new() -> Logger {
+        static REGISTER_FORK_HANDLER: Once = Once::new();
+        REGISTER_FORK_HANDLER.call_once(|| unsafe {
+            libc::pthread_atfork(None, None, Some(count_fork));
+        });
+
+        let files = Arc::new(Mutex::new(LogFiles {
+            logfile: None,
+            user_error_logfile: None,
+        }));
+        let dropped = Arc::new(AtomicUsize::new(0));
+        let (queue, receiver) = mpsc::sync_channel(QUEUE_CAPACITY);
+
+        let writer = {
+            let files = Arc::clone(&files);
+            let dropped = Arc::clone(&dropped);
+            thread::Builder::new()
+                .name("logger".to_string())
+                .spawn(move || write_messages(receiver, files, dropped))
+                .expect("Couldn't start logger's writer thread")
+        };
+
         Logger {
-            files: Mutex::new(LogFiles {
-                logfile: None,
-                user_error_logfile: None,
-            }),
+            files,
             loglevel: AtomicIsize::new(-1_isize),
+            queue,
+            dropped,
+            writer: Mutex::new(Some(writer)),
+            generation: FORK_GENERATION.load(Ordering::SeqCst),
         }
     }
 
+    /// Returns `true` if this is a forked child, in which the writer thread doesn't exist.
+    fn is_orphaned(&self) -> bool {
+        FORK_GENERATION.load(Ordering::Relaxed) != self.generation
+    }
+
     /// Specifies the file to which the messages will be written.
     ///
     /// The file will be created if it doesn't exist yet. It will be opened in the append mode, so
@@ -144,6 +355,8 @@ impl Logger {
 
         match file {
             Ok(file) => {
+                // Whatever was logged so far still goes to the previous logfile.
+                self.flush();
                 let mut files = self.files.lock().expect("Someone poisoned logger's mutex");
                 files.logfile = Some(file);
             }
@@ -167,6 +380,7 @@ impl Logger {
 
         match file {
             Ok(file) => {
+                self.flush();
                 let mut files = self.files.lock().expect("Someone poisoned logger's mutex");
                 files.user_error_logfile = Some(file)
             }
@@ -177,15 +391,30 @@ impl Logger {
         }
     }
 
+    /// Returns `true` if messages at `level` would be written.
+    ///
+    /// Level::UserError messages are always written, to the error-logfile at least.
+    pub fn is_enabled(&self, level: Level) -> bool {
+        level == Level::UserError || level as isize <= self.get_loglevel()
+    }
+
     /// Writes a message to a log.
     ///
     /// This method is a wrapper around `log_raw()`.
     pub fn log(&self, level: Level, message: &str) {
-        if level == Level::UserError || level as isize <= self.get_loglevel() {
+        if self.is_enabled(level) {
             self.log_raw(level, message.as_bytes())
         }
     }
 
+    /// Writes a message to the log even if `level` is below the logger's current level.
+    ///
+    /// This is for callers that filter messages themselves, like the C++ code does with its
+    /// per-module loglevels.
+    pub fn log_unfiltered(&self, level: Level, message: &str) {
+        self.queue_line(level, message.as_bytes(), true);
+    }
+
     /// Writes binary data to the log.
     ///
     /// This method is primarily used for logging things received from C++. Since there is no
@@ -198,45 +427,65 @@ impl Logger {
     /// Level::UserError messages are written to two logs: the general one, and error-logfile. See
     /// Logger description for details.
     ///
+    /// The message is only queued here; see Logger description for when it's written.
+    ///
     /// # Errors
     ///
     /// If the message couldn't be written for whatever reason, this function ignores the failure.
     /// Were you to check the return value of every log() call, you'd just stop writing logs.
     pub fn log_raw(&self, level: Level, data: &[u8]) {
+        let to_logfile = level as isize <= self.get_loglevel();
+        self.queue_line(level, data, to_logfile);
+    }
+
+    /// Hands a message to the writer thread. It goes to the general log if `to_logfile` is true,
+    /// and to the error-logfile if it's a Level::UserError.
+    fn queue_line(&self, level: Level, data: &[u8], to_logfile: bool) {
+        if !to_logfile && level != Level::UserError {
+            return;
+        }
+
         let timestamp = Local::now();
-        // DateTime::format() is extremely slow; format! is way faster. See
-        // https://github.com/chronotope/chrono/issues/94 for details.
-        let timestamp = format!(
-            "[{}-{:02}-{:02} {:02}:{:02}:{:02}] ",
-            timestamp.year(),
-            timestamp.month(),
-            timestamp.day(),
-            timestamp.hour(),
-            timestamp.minute(),
-            timestamp.second()
-        );
-
-        let mut files = self.files.lock().expect("Someone poisoned logger's mutex");
-
-        if level as isize <= self.get_loglevel() {
-            if let Some(ref mut logfile) = files.logfile {
-                let level = format!("{}: ", level);
 
-                // Ignoring the error since checking every log() call will be too bothersome.
-                let _ = logfile.write_all(timestamp.as_bytes());
-                let _ = logfile.write_all(level.as_bytes());
-                let _ = logfile.write_all(data);
-                let _ = logfile.write_all(b"\n");
+        if self.is_orphaned() {
+            let mut batch = Batch::default();
+            batch.add(level, &timestamp, data, to_logfile);
+            // The writer thread might have held the lock at the time of the fork; then nobody
+            // will ever release it.
+            if let Ok(mut files) = self.files.try_lock() {
+                if let Some(ref mut logfile) = files.logfile {
+                    let _ = logfile.write_all(&batch.log);
+                }
+                if let Some(ref mut user_error_logfile) = files.user_error_logfile {
+                    let _ = user_error_logfile.write_all(&batch.user_error_log);
+                }
             }
+            return;
         }
 
-        if level == Level::UserError {
-            if let Some(ref mut user_error_logfile) = files.user_error_logfile {
-                // Ignoring the error since checking every log() call will be too bothersome.
-                let _ = user_error_logfile.write_all(timestamp.as_bytes());
-                let _ = user_error_logfile.write_all(data);
-                let _ = user_error_logfile.write_all(b"\n");
-            }
+        let message = Message::Line {
+            level,
+            timestamp,
+            data: data.to_vec(),
+            to_logfile,
+        };
+        if level <= Level::Critical {
+            // These are rare and important enough to wait for.
+            let _ = self.queue.send(message);
+        } else if let Err(TrySendError::Full(_)) = self.queue.try_send(message) {
+            self.dropped.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+
+    /// Waits until all the messages logged so far are written to the logfiles.
+    pub fn flush(&self) {
+        if self.is_orphaned() {
+            return;
+        }
+
+        let (done, wait) = mpsc::channel();
+        if self.queue.send(Message::Flush(done)).is_ok() {
+            let _ = wait.recv();
         }
     }
 
@@ -269,18 +518,51 @@ impl Default for Logger {
     }
 }
 
+impl Drop for Logger {
+    fn drop(&mut self) {
+        if self.is_orphaned() {
+            return;
+        }
+
+        let _ = self.queue.send(Message::Stop);
+        let writer = self
+            .writer
+            .lock()
+            .expect("Someone poisoned logger's mutex")
+            .take();
+        if let Some(writer) = writer {
+            let _ = writer.join();
+        }
+    }
+}
+
 static GLOBAL_LOGGER: OnceCell<Logger> = OnceCell::new();
 
+extern "C" fn flush_global_logger() {
+    if let Some(logger) = GLOBAL_LOGGER.get() {
+        logger.flush();
+    }
+}
+
 /// Returns a global logger instance.
 ///
 /// This logger exists for the duration of the program. It's better to set the loglevel and
 /// logfiles as early as possible, so no messages are lost.
+///
+/// The logger is never dropped, so it's flushed when the program exits.
 pub fn get_instance() -> &'static Logger {
-    GLOBAL_LOGGER.get_or_init(Logger::new)
+    GLOBAL_LOGGER.get_or_init(|| {
+        unsafe {
+            libc::atexit(flush_global_logger);
+        }
+        Logger::new()
+    })
 }
 
 /// Convenience macro for logging.
 ///
+/// The message is only formatted if its level is enabled.
+///
 /// Most of the time, you should just use this. For example:
 /// ```no_run
 /// use libnewsboat::{log, logger::{self, Level}};
@@ -294,9 +576,12 @@ macro_rules! log {
     ( $level:expr, $message:expr ) => {
         logger::get_instance().log($level, $message);
     };
-    ( $level:expr, $format:expr, $( $arg:expr ),+ ) => {
-        logger::get_instance().log($level, &format!($format, $( $arg ),+));
-    }
+    ( $level:expr, $format:expr, $( $arg:expr ),+ ) => {{
+        let level = $level;
+        if logger::get_instance().is_enabled(level) {
+            logger::get_instance().log(level, &format!($format, $( $arg ),+));
+        }
+    }}
 }
 
 #[cfg(test)]
@@ -737,6 +1022,82 @@ mod tests {
             .unwrap();
     }
 
+    #[test]
+    fn t_flush_writes_everything_logged_so_far() {
+        let (_tmp, logfile, error_logfile, logger) = setup_logger().unwrap();
+
+        logger.set_loglevel(Level::Debug);
+
+        for i in 0..1000 {
+            logger.log(Level::Debug, &format!("message #{}", i));
+        }
+        logger.log(Level::UserError, "the last one");
+
+        logger.flush();
+
+        log_contains_n_lines(&logfile, 1001).unwrap();
+        log_contains_n_lines(&error_logfile, 1).unwrap();
+    }
+
+    #[test]
+    fn t_messages_logged_before_set_logfile_go_to_the_previous_logfile() {
+        let (tmp, logfile, _error_logfile, logger) = setup_logger().unwrap();
+        let next_logfile = tmp.path().join("next.log");
+
+        logger.set_loglevel(Level::Debug);
+
+        logger.log(Level::Debug, "one");
+        logger.log(Level::Debug, "two");
+        logger.set_logfile(next_logfile.to_str().unwrap());
+        logger.log(Level::Debug, "three");
+
+        drop(logger);
+
+        log_contains_n_lines(&logfile, 2).unwrap();
+        log_contains_n_lines(&next_logfile, 1).unwrap();
+    }
+
+    #[test]
+    fn t_messages_from_many_threads_all_end_up_in_the_log() {
+        let (_tmp, logfile, _error_logfile, logger) = setup_logger().unwrap();
+
+        logger.set_loglevel(Level::Debug);
+
+        let logger = Arc::new(logger);
+        let threads = (0..4)
+            .map(|t| {
+                let logger = Arc::clone(&logger);
+                thread::spawn(move || {
+                    // Less than QUEUE_CAPACITY in total, so nothing is dropped.
+                    for i in 0..500 {
+                        logger.log(Level::Info, &format!("thread {}, message #{}", t, i));
+                    }
+                })
+            })
+            .collect::<Vec<_>>();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+
+        drop(logger);
+
+        log_contains_n_lines(&logfile, 2000).unwrap();
+    }
+
+    #[test]
+    fn t_log_unfiltered_ignores_the_loglevel() {
+        let (_tmp, logfile, _error_logfile, logger) = setup_logger().unwrap();
+
+        logger.unset_loglevel();
+        assert!(!logger.is_enabled(Level::Debug));
+        logger.log_unfiltered(Level::Debug, "written anyway");
+        logger.log(Level::Debug, "not written");
+
+        drop(logger);
+
+        log_contains_n_lines(&logfile, 1).unwrap();
+    }
+
     #[test]
     fn t_set_user_error_logfile_creates_a_file() {
         let (_tmp, _logfile, error_logfile, _logger) = setup_logger().unwrap();
@@ -1,17 +1,20 @@
 use crate::htmlrenderer;
 use crate::logger::{self, Level};
 use libc::{
-    c_char, c_int, c_ulong, c_void, close, execvp, exit, fork, size_t, waitpid, E2BIG, EILSEQ,
-    EINVAL,
+    c_char, c_int, c_ulong, c_void, close, execvp, exit, fcntl, fork, nfds_t, poll, pollfd, size_t,
+    waitpid, E2BIG, EILSEQ, EINVAL, F_GETFL, F_SETFL, O_NONBLOCK, POLLIN, POLLOUT,
 };
 use md5;
 use percent_encoding::*;
+use std::cell::RefCell;
+use std::collections::HashMap;
 use std::ffi::CString;
 use std::fs::DirBuilder;
-use std::io::{self, Write};
+use std::io::{self, Read, Write};
 use std::os::unix::fs::DirBuilderExt;
+use std::os::unix::io::AsRawFd;
 use std::path::{Path, PathBuf};
-use std::process::{Command, Stdio};
+use std::process::{ChildStdin, ChildStdout, Command, Stdio};
 use std::ptr;
 use unicode_width::{UnicodeWidthChar, UnicodeWidthStr};
 use url::Url;
@@ -397,18 +400,114 @@ pub fn unescape_url(rs_str: String) -> Option<String> {
 /// Runs given command in a shell, and returns the output (from stdout; stderr is printed to the
 /// screen).
 pub fn get_command_output(cmd: &str) -> String {
-    let cmd = Command::new("sh")
+    Command::new("sh")
         .arg("-c")
         .arg(cmd)
         // Inherit stdin so that the program can ask something of the user (see
         // https://github.com/newsboat/newsboat/issues/455 for an example).
         .stdin(Stdio::inherit())
-        .output();
-    // from_utf8_lossy will convert any bad bytes to U+FFFD
-    cmd.map(|cmd| String::from_utf8_lossy(&cmd.stdout).into_owned())
+        .stdout(Stdio::piped())
+        .stderr(Stdio::null())
+        .spawn()
+        .and_then(|mut child| {
+            let output = match child.stdout.take() {
+                Some(stdout) => pump_pipes(None, stdout, &[]),
+                None => Ok(Vec::new()),
+            };
+            child.wait()?;
+            output
+        })
+        // from_utf8_lossy will convert any bad bytes to U+FFFD
+        .map(|output| String::from_utf8_lossy(&output).into_owned())
         .unwrap_or_else(|_| String::from(""))
 }
 
+/// Writes `input` to `stdin` while reading `stdout` until the child closes it.
+///
+/// Both are done at once, with `poll()`, so a child that writes more than a pipe holds before it
+/// has read all of its input can't get stuck waiting for us to read. `stdin` is closed once all of
+/// `input` was written, or the child stopped reading it. The output is collected into a buffer
+/// that starts out as large as the input, since filters mostly give back about as much as they
+/// were given.
+fn pump_pipes(
+    stdin: Option<ChildStdin>,
+    mut stdout: ChildStdout,
+    input: &[u8],
+) -> io::Result<Vec<u8>> {
+    fn set_nonblocking(fd: c_int) {
+        unsafe {
+            let flags = fcntl(fd, F_GETFL);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        }
+    }
+
+    let mut stdin = stdin.filter(|_| !input.is_empty());
+    if let Some(stdin) = stdin.as_ref() {
+        set_nonblocking(stdin.as_raw_fd());
+    }
+    set_nonblocking(stdout.as_raw_fd());
+
+    let mut output = Vec::with_capacity(input.len().max(4096));
+    let mut written = 0;
+    let mut buffer = [0u8; 65536];
+    loop {
+        let mut fds = vec![pollfd {
+            fd: stdout.as_raw_fd(),
+            events: POLLIN,
+            revents: 0,
+        }];
+        if let Some(stdin) = stdin.as_ref() {
+            fds.push(pollfd {
+                fd: stdin.as_raw_fd(),
+                events: POLLOUT,
+                revents: 0,
+            });
+        }
+        if unsafe { poll(fds.as_mut_ptr(), fds.len() as nfds_t, -1) } < 0 {
+            let error = io::Error::last_os_error();
+            if error.kind() == io::ErrorKind::Interrupted {
+                continue;
+            }
+            return Err(error);
+        }
+
+        if fds.len() > 1 && fds[1].revents != 0 {
+            if let Some(pipe) = stdin.as_mut() {
+                match pipe.write(&input[written..]) {
+                    Ok(count) => written += count,
+                    Err(ref error)
+                        if error.kind() == io::ErrorKind::WouldBlock
+                            || error.kind() == io::ErrorKind::Interrupted => {}
+                    Err(error) => {
+                        // Most likely, the child exited without reading all of it
+                        log!(
+                            Level::Debug,
+                            "utils::pump_pipes: failed to write to child's stdin: {}",
+                            error
+                        );
+                        written = input.len();
+                    }
+                }
+            }
+            if written == input.len() {
+                stdin = None;
+            }
+        }
+
+        if fds[0].revents != 0 {
+            loop {
+                match stdout.read(&mut buffer) {
+                    Ok(0) => return Ok(output),
+                    Ok(count) => output.extend_from_slice(&buffer[..count]),
+                    Err(ref error) if error.kind() == io::ErrorKind::WouldBlock => break,
+                    Err(ref error) if error.kind() == io::ErrorKind::Interrupted => {}
+                    Err(error) => return Err(error),
+                }
+            }
+        }
+    }
+}
+
 // This function assumes that the user is not interested in the command's output (not even errors
 // on stderr!), so it will close the spawned command's fds.
 // This used to be a simple std::process::Command::Spawn(), but this caused child processes to not
@@ -490,18 +589,18 @@ pub fn run_program(cmd_with_args: &[&str], input: &str) -> String {
             );
         })
         .and_then(|mut child| {
-            if let Some(stdin) = child.stdin.as_mut() {
-                if let Err(error) = stdin.write_all(input.as_bytes()) {
-                    log!(
-                        Level::Debug,
-                        "utils::run_program: failed to write to child's stdin: {}",
-                        error
-                    );
-                }
+            let output = match child.stdout.take() {
+                Some(stdout) => pump_pipes(child.stdin.take(), stdout, input.as_bytes()),
+                None => Ok(Vec::new()),
+            };
+            if let Err(error) = child.wait() {
+                log!(
+                    Level::Debug,
+                    "utils::run_program: failed to wait for the child: {}",
+                    error
+                );
             }
-
-            child
-                .wait_with_output()
+            output
                 .map_err(|error| {
                     log!(
                         Level::Debug,
@@ -509,7 +608,7 @@ pub fn run_program(cmd_with_args: &[&str], input: &str) -> String {
                         error
                     );
                 })
-                .map(|output| String::from_utf8_lossy(&output.stdout).into_owned())
+                .map(|output| String::from_utf8_lossy(&output).into_owned())
         })
         .unwrap_or_else(|_| String::new())
 }
@@ -914,8 +1013,69 @@ pub fn translit(tocode: &str, fromcode: &str) -> String {
     }
 }
 
+/// An iconv conversion descriptor that is closed when dropped.
+struct Converter(iconv_t);
+
+impl Drop for Converter {
+    fn drop(&mut self) {
+        unsafe {
+            iconv_close(self.0);
+        }
+    }
+}
+
+thread_local! {
+    /// Descriptors opened by `convert_text()`, by `(tocode, fromcode)`. Opening one has to look up
+    /// and set up the conversion, which takes longer than converting a short UI string. They're
+    /// per thread because a descriptor can't be used by two threads at once.
+    static CONVERTERS: RefCell<HashMap<(String, String), Converter>> = RefCell::new(HashMap::new());
+}
+
+/// Returns a descriptor for converting from `fromcode` to `tocode`, opening it if this thread
+/// hasn't done so before.
+///
+/// The descriptor stays open until the thread exits, so it's fine to use it after the cache is
+/// released. Returns `None` if iconv doesn't support the conversion.
+fn converter(tocode: String, fromcode: &str) -> Option<iconv_t> {
+    CONVERTERS.with(|converters| {
+        let mut converters = converters.borrow_mut();
+        let key = (tocode, fromcode.to_string());
+        if let Some(converter) = converters.get(&key) {
+            return Some(converter.0);
+        }
+
+        let cd = unsafe {
+            // The following two `expect()`s can't panic because their input string come from
+            // trusted sources:
+            // - from our code, and we obviously won't put NUL inside one of those strings;
+            // - from the locale, which we interrogate via a C API which "filters out" any NULs.
+            let c_tocode = CString::new(key.0.as_str()).expect("tocode String contained NUL");
+            let c_fromcode = CString::new(fromcode).expect("fromcode str contained NUL");
+
+            iconv_open(c_tocode.as_ptr(), c_fromcode.as_ptr())
+        };
+        if cd == -1isize as iconv_t {
+            return None;
+        }
+        converters.insert(key, Converter(cd));
+        Some(cd)
+    })
+}
+
+fn is_utf8_encoding_name(code: &str) -> bool {
+    code.eq_ignore_ascii_case("utf-8") || code.eq_ignore_ascii_case("utf8")
+}
+
 /// Converts `text` from encoding `fromcode` to encoding `tocode`.
 pub fn convert_text(text: &[u8], tocode: &str, fromcode: &str) -> Vec<u8> {
+    // Feeds and the UI are UTF-8 most of the time, and iconv would just copy valid UTF-8
+    if is_utf8_encoding_name(tocode)
+        && is_utf8_encoding_name(fromcode)
+        && std::str::from_utf8(text).is_ok()
+    {
+        return text.to_vec();
+    }
+
     let mut result = vec![];
 
     let tocode_translit = translit(tocode, fromcode);
@@ -937,23 +1097,21 @@ pub fn convert_text(text: &[u8], tocode: &str, fromcode: &str) -> Vec<u8> {
         question_mark
     };
 
-    let cd = unsafe {
-        // The following two `expect()`s can't panic because their input string come from trusted
-        // sources:
-        // - from our code, and we obviously won't put NUL inside one of those strings;
-        // - from the locale, which we interrogate via a C API which "filters out" any NULs.
-        let c_tocode_translit =
-            CString::new(tocode_translit).expect("tocode_translit String contained NUL");
-        let c_fromcode = CString::new(fromcode).expect("fromcode str contained NUL");
-
-        iconv_open(c_tocode_translit.as_ptr(), c_fromcode.as_ptr())
+    let cd = match converter(tocode_translit, fromcode) {
+        Some(cd) => cd,
+        None => return result,
     };
 
-    if cd == -1isize as iconv_t {
-        return result;
-    }
-
     unsafe {
+        // A cached converter might have been left in a shift state by the previous text
+        iconv(
+            cd,
+            ptr::null_mut(),
+            ptr::null_mut(),
+            ptr::null_mut(),
+            ptr::null_mut(),
+        );
+
         let mut outbuf: [u8; 16] = [0; 16];
         let mut outbufp = outbuf.as_mut_ptr() as *mut c_char;
         let mut outbytesleft = outbuf.len();
@@ -1007,8 +1165,6 @@ pub fn convert_text(text: &[u8], tocode: &str, fromcode: &str) -> Vec<u8> {
                 copy_converted_chunk(&outbuf, old_outbufp, outbufp, &mut result);
             }
         }
-
-        iconv_close(cd);
     }
 
     result
@@ -1712,6 +1868,19 @@ mod tests {
         );
     }
 
+    #[test]
+    fn t_run_program_streams_input_larger_than_a_pipe() {
+        // The child writes most of its output before we're done writing its input
+        let input = "x".repeat(4 * 1024 * 1024);
+        assert_eq!(
+            run_program(&["tr", "x", "y"], &input),
+            "y".repeat(input.len())
+        );
+
+        // The child doesn't read its input at all
+        assert_eq!(run_program(&["true"], &input), "");
+    }
+
     #[test]
     fn t_make_title() {
         let mut input = String::from("http://example.com/Item");
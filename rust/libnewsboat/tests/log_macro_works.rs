@@ -30,5 +30,7 @@ fn t_log_macro_writes_messages_to_the_log() {
     log!(Level::UserError, "Please set some settings");
     log!(Level::Error, "Answer invalid: {}", 41);
 
+    get_instance().flush();
+
     log_contains_n_lines(&logfile, 3).unwrap();
 }
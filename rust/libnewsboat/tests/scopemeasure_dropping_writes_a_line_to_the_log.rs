@@ -28,5 +28,7 @@ fn droppping_a_scopemeasure_writes_a_line_to_the_log() {
         let _sm = ScopeMeasure::new(String::from("test"));
     }
 
+    logger::get_instance().flush();
+
     assert_eq!(file_lines_count(&logfile).unwrap(), 1);
 }
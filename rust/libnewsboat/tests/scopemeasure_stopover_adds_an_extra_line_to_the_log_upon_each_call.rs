@@ -33,6 +33,8 @@ fn stopover_adds_an_extra_line_to_the_log_upon_each_call() {
             }
         }
 
+        logger::get_instance().flush();
+
         // One line for each call to stopover(), plus one more for the call to drop()
         assert_eq!(file_lines_count(&logfile).unwrap(), calls + 1usize);
     }
@@ -0,0 +1,33 @@
+#include "arena.h"
+
+#include <algorithm>
+
+namespace newsboat {
+
+Arena::Arena(std::size_t block_size)
+	: block_size(block_size)
+	, next(0)
+	, end(0)
+{
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+	const auto align = [=](std::uintptr_t address) {
+		return (address + alignment - 1) & ~std::uintptr_t(alignment - 1);
+	};
+
+	auto start = align(next);
+	if (next == 0 || start + size > end) {
+		// Big allocations get a block of their own
+		const auto size_of_block = std::max(block_size, size + alignment);
+		blocks.emplace_back(new char[size_of_block]);
+		next = reinterpret_cast<std::uintptr_t>(blocks.back().get());
+		end = next + size_of_block;
+		start = align(next);
+	}
+	next = start + size;
+	return reinterpret_cast<void*>(start);
+}
+
+} // namespace newsboat
@@ -0,0 +1,203 @@
+#include "articleexporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include "3rd-party/json.hpp"
+#include "configcontainer.h"
+#include "executor.h"
+#include "itemrenderer.h"
+#include "jobprogress.h"
+#include "logger.h"
+#include "rssitem.h"
+#include "strprintf.h"
+#include "utils.h"
+
+namespace newsboat {
+
+namespace {
+
+/// How many articles are rendered before the next ones wait for them to
+/// be written; bounds the memory the rendered texts take up.
+const std::size_t BATCH_SIZE = 256;
+
+/// Formats \a t in UTC without looking at the locale, since mail readers
+/// only understand English names of days and months. \a rfc2822 picks the
+/// format of the Date header over that of the mbox "From " line.
+std::string format_utc(time_t t, bool rfc2822)
+{
+	static const char* const DAYS[] = {
+		"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+	};
+	static const char* const MONTHS[] = {
+		"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+		"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+	};
+	struct tm tm {};
+	::gmtime_r(&t, &tm);
+	if (rfc2822) {
+		return strprintf::fmt("%s, %02d %s %04d %02d:%02d:%02d +0000",
+				DAYS[tm.tm_wday], tm.tm_mday, MONTHS[tm.tm_mon], tm.tm_year + 1900,
+				tm.tm_hour, tm.tm_min, tm.tm_sec);
+	}
+	return strprintf::fmt("%s %s %2d %02d:%02d:%02d %04d",
+			DAYS[tm.tm_wday], MONTHS[tm.tm_mon], tm.tm_mday,
+			tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_year + 1900);
+}
+
+/// Header values can't span lines
+std::string header_value(const std::string& value)
+{
+	std::string result = value;
+	std::replace(result.begin(), result.end(), '\n', ' ');
+	std::replace(result.begin(), result.end(), '\r', ' ');
+	return result;
+}
+
+}
+
+ArticleExporter::ArticleExporter(ConfigContainer& cfg,
+	unsigned int num_threads)
+	: cfg(cfg)
+	, num_threads(std::max(num_threads, 1u))
+{
+}
+
+bool ArticleExporter::for_each_rendered(
+	const std::vector<std::shared_ptr<RssItem>>& items,
+	JobProgress& progress,
+	const std::function<bool(std::size_t, const std::string&)>& write)
+{
+	progress.set_total(items.size());
+	std::vector<std::string> texts;
+	for (std::size_t begin = 0; begin < items.size(); begin += BATCH_SIZE) {
+		const std::size_t end = std::min(items.size(), begin + BATCH_SIZE);
+		texts.assign(end - begin, std::string());
+
+		std::atomic<std::size_t> next(begin);
+		auto worker = [&]() {
+			for (;;) {
+				const std::size_t i = next++;
+				if (i >= end || progress.is_cancelled()) {
+					break;
+				}
+				texts[i - begin] = item_renderer::to_plain_text(cfg, items[i]);
+			}
+		};
+		const unsigned int thread_count = std::min<std::size_t>(num_threads,
+				end - begin);
+		Executor::instance().run_workers(Executor::Pool::CPU,
+			Executor::Priority::HIGH, thread_count, worker);
+
+		for (std::size_t i = begin; i < end; ++i) {
+			if (progress.is_cancelled() || !write(i, texts[i - begin])) {
+				return false;
+			}
+			progress.advance();
+		}
+	}
+	return true;
+}
+
+std::vector<std::string> ArticleExporter::write_files(
+	const std::vector<File>& files, JobProgress& progress)
+{
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (const auto& file : files) {
+		items.push_back(file.second);
+	}
+
+	std::vector<std::string> failed;
+	for_each_rendered(items, progress,
+	[&](std::size_t i, const std::string& text) {
+		const std::string& path = files[i].first;
+		std::ofstream f(path);
+		f << text << std::endl;
+		f.close();
+		if (f.fail()) {
+			LOG(Level::ERROR, "ArticleExporter::write_files: couldn't write %s",
+				path);
+			failed.push_back(path);
+		}
+		return true;
+	});
+	return failed;
+}
+
+bool ArticleExporter::write_archive(const std::string& path, Archive format,
+	const std::vector<std::shared_ptr<RssItem>>& items, JobProgress& progress)
+{
+	const std::string tmp_path = path + ".tmp";
+	std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+	const bool complete = f.is_open() && for_each_rendered(items, progress,
+	[&](std::size_t i, const std::string& text) {
+		f << archive_entry(format, *items[i], text);
+		return f.good();
+	});
+	f.close();
+
+	if (!complete || f.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		LOG(Level::ERROR, "ArticleExporter::write_archive: couldn't write %s%s",
+			path, progress.is_cancelled() ? " (cancelled)" : "");
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::string ArticleExporter::archive_entry(Archive format, const RssItem& item,
+	const std::string& text)
+{
+	// The rendered text is in the locale's encoding, like `save` writes it
+	const std::string body = utils::locale_to_utf8(text);
+
+	if (format == Archive::JSONL) {
+		const nlohmann::json entry = {
+			{"guid", item.guid()},
+			{"feedurl", item.feedurl()},
+			{"title", item.title()},
+			{"author", item.author()},
+			{"link", item.link()},
+			{"date", static_cast<std::int64_t>(item.pubDate_timestamp())},
+			{"unread", item.unread()},
+			{"flags", item.flags()},
+			{"text", body},
+		};
+		return entry.dump(-1, ' ', false,
+				nlohmann::json::error_handler_t::replace) + "\n";
+	}
+
+	std::ostringstream out;
+	out << "From newsboat " << format_utc(item.pubDate_timestamp(), false) << "\n"
+		<< "From: " << header_value(item.author().empty() ? "newsboat" :
+			item.author()) << "\n"
+		<< "Subject: " << header_value(item.title()) << "\n"
+		<< "Date: " << format_utc(item.pubDate_timestamp(), true) << "\n"
+		<< "Message-ID: <" << header_value(item.guid()) << ">\n"
+		<< "X-Newsboat-Feed: " << header_value(item.feedurl()) << "\n"
+		<< "X-Newsboat-Link: " << header_value(item.link()) << "\n"
+		<< "MIME-Version: 1.0\n"
+		<< "Content-Type: text/plain; charset=UTF-8\n"
+		<< "Content-Transfer-Encoding: 8bit\n"
+		<< "\n";
+	// mboxrd: lines that would look like the start of a message, even
+	// after being quoted before, get one more '>'
+	std::istringstream lines(body);
+	std::string line;
+	while (std::getline(lines, line)) {
+		const auto from = line.find_first_not_of('>');
+		if (from != std::string::npos && line.compare(from, 5, "From ") == 0) {
+			out << '>';
+		}
+		out << line << "\n";
+	}
+	out << "\n";
+	return out.str();
+}
+
+} // namespace newsboat
@@ -0,0 +1,177 @@
+#include "articleprerenderer.h"
+
+#include <cinttypes>
+#include <tuple>
+
+#include "configcontainer.h"
+#include "itemrenderer.h"
+#include "logger.h"
+#include "regexmanager.h"
+#include "rssitem.h"
+#include "utils.h"
+
+namespace newsboat {
+
+ArticlePrerenderer::ArticlePrerenderer(ConfigContainer& cfg,
+	RenderCache& cache)
+	: cfg(cfg)
+	, cache(cache)
+	, options{0, 0, "", 0}
+	, wanted_options{0, 0, "", 0}
+	, wanted_pending(false)
+	, stopping(false)
+	, worker(&ArticlePrerenderer::run, this)
+{
+}
+
+ArticlePrerenderer::~ArticlePrerenderer()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+		pending.clear();
+	}
+	wakeup.notify_one();
+	worker.join();
+}
+
+void ArticlePrerenderer::prerender(
+	const std::vector<std::shared_ptr<RssItem>>& items,
+	const RenderCache::Options& new_options,
+	const RegexManager& rxman)
+{
+	if (new_options.renderer != "internal") {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		copy_rules_unlocked(rxman);
+		options = new_options;
+		options.rules_revision = rxman.revision();
+		pending.assign(items.begin(), items.end());
+	}
+	wakeup.notify_one();
+}
+
+void ArticlePrerenderer::render_next(const std::shared_ptr<RssItem>& item,
+	const RenderCache::Options& new_options,
+	const RegexManager& rxman)
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		copy_rules_unlocked(rxman);
+		wanted = item;
+		wanted_options = new_options;
+		wanted_options.rules_revision = rxman.revision();
+		wanted_pending = true;
+		wanted_view = nonstd::nullopt;
+	}
+	wakeup.notify_one();
+}
+
+nonstd::optional<RenderCache::Rendered> ArticlePrerenderer::take_rendered(
+	const std::shared_ptr<RssItem>& item,
+	const RenderCache::Options& item_options)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	if (wanted != item || !wanted_view.has_value()
+		|| !(wanted_options == item_options)) {
+		return nonstd::nullopt;
+	}
+	nonstd::optional<RenderCache::Rendered> result = std::move(wanted_view);
+	wanted = nullptr;
+	wanted_view = nonstd::nullopt;
+	return result;
+}
+
+void ArticlePrerenderer::copy_rules_unlocked(const RegexManager& rxman)
+{
+	if (rules == nullptr || rules->revision() != rxman.revision()) {
+		// The worker keeps its own reference to the old copy for as long as
+		// it renders with it. The items that are left would be rendered
+		// with rules their options don't say
+		rules = std::make_shared<RegexManager>(rxman);
+		pending.clear();
+	}
+}
+
+RenderCache::Rendered ArticlePrerenderer::render(ConfigContainer& cfg,
+	std::shared_ptr<RssItem> item,
+	const RenderCache::Options& options,
+	RegexManager* rxman,
+	std::size_t max_body_size)
+{
+	RenderCache::Rendered rendered{"", 0, {}};
+	if (!item->enclosure_url().empty()) {
+		const auto link_type = utils::podcast_mime_to_link_type(item->enclosure_type());
+		if (link_type.has_value()) {
+			rendered.links.push_back(LinkPair(item->enclosure_url(), link_type.value()));
+		}
+	}
+
+	std::tie(rendered.text, rendered.num_lines) =
+		item_renderer::to_stfl_list(
+			cfg,
+			item,
+			options.text_width,
+			options.window_width,
+			rxman,
+			"article",
+			rendered.links,
+			max_body_size);
+	return rendered;
+}
+
+void ArticlePrerenderer::run()
+{
+	while (true) {
+		std::shared_ptr<RssItem> item;
+		RenderCache::Options item_options{0, 0, "", 0};
+		std::shared_ptr<RegexManager> item_rules;
+		bool is_wanted = false;
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			wakeup.wait(lock, [this]() {
+				return stopping || wanted_pending || !pending.empty();
+			});
+			if (stopping) {
+				return;
+			}
+			if (wanted_pending) {
+				item = wanted;
+				item_options = wanted_options;
+				wanted_pending = false;
+				is_wanted = true;
+			} else {
+				item = pending.front();
+				pending.pop_front();
+				item_options = options;
+			}
+			item_rules = rules;
+		}
+
+		if (!is_wanted && cache.get(item, item_options).has_value()) {
+			continue;
+		}
+
+		const std::uint64_t revision = item->revision();
+		const auto rendered = render(cfg, item, item_options, item_rules.get());
+		if (is_wanted) {
+			std::lock_guard<std::mutex> guard(mtx);
+			if (wanted == item && wanted_options == item_options && !wanted_pending) {
+				wanted_view = rendered;
+			}
+		}
+		// If the item changed while it was rendered, the view might be of
+		// neither its old nor its new contents
+		if (item->revision() == revision) {
+			cache.put(item, item_options, rendered);
+			LOG(Level::DEBUG,
+				"ArticlePrerenderer::run: rendered %" PRIu64 " line(s)",
+				static_cast<uint64_t>(rendered.num_lines));
+		}
+	}
+}
+
+} // namespace newsboat
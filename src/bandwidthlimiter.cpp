@@ -0,0 +1,59 @@
+#include "bandwidthlimiter.h"
+
+#include <algorithm>
+
+namespace podboat {
+
+BandwidthLimiter::BandwidthLimiter(std::uint64_t bytes_per_second)
+	: rate(bytes_per_second)
+	, tokens(bytes_per_second)
+	, last_refill(Clock::now())
+{
+}
+
+void BandwidthLimiter::set_limit(std::uint64_t bytes_per_second)
+{
+	// Without a limit, nothing was taken from the bucket all along
+	tokens = rate == 0 ? bytes_per_second : std::min<double>(tokens,
+			bytes_per_second);
+	rate = bytes_per_second;
+}
+
+bool BandwidthLimiter::take(CURL* handle, std::size_t bytes)
+{
+	if (rate == 0) {
+		return true;
+	}
+	if (tokens <= 0) {
+		if (std::find(paused.begin(), paused.end(), handle) == paused.end()) {
+			paused.push_back(handle);
+		}
+		return false;
+	}
+	tokens -= bytes;
+	return true;
+}
+
+std::vector<CURL*> BandwidthLimiter::resumable(Clock::time_point now)
+{
+	if (now > last_refill) {
+		const double elapsed =
+			std::chrono::duration<double>(now - last_refill).count();
+		tokens = std::min<double>(tokens + elapsed * rate, rate);
+		last_refill = now;
+	}
+
+	std::vector<CURL*> result;
+	if (rate == 0 || tokens > 0) {
+		result.swap(paused);
+	}
+	return result;
+}
+
+void BandwidthLimiter::forget(CURL* handle)
+{
+	paused.erase(std::remove(paused.begin(), paused.end(), handle),
+		paused.end());
+}
+
+} // namespace podboat
@@ -0,0 +1,68 @@
+#include "bloomfilter.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace newsboat {
+
+namespace {
+
+/// With 10 bits per string, 7 hash functions give the fewest false
+/// positives: about 0.8%.
+const std::size_t BITS_PER_ENTRY = 10;
+const unsigned int HASH_COUNT = 7;
+
+/// Spreads the bits of \a x, so that a second hash can be made of the
+/// first (the "fmix64" step of MurmurHash3).
+std::uint64_t mix(std::uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+}
+
+BloomFilter::BloomFilter(std::size_t expected)
+	: bits((std::max<std::size_t>(expected, 1) * BITS_PER_ENTRY + 63) / 64, 0)
+	, bit_count(bits.size() * 64)
+	, expected(expected)
+	, entries(0)
+{
+}
+
+std::size_t BloomFilter::bit_index(std::uint64_t h1, std::uint64_t h2,
+	unsigned int i) const
+{
+	// Double hashing: k hash functions out of two
+	return (h1 + i * h2) % bit_count;
+}
+
+void BloomFilter::add(const std::string& key)
+{
+	const std::uint64_t h1 = std::hash<std::string>()(key);
+	const std::uint64_t h2 = mix(h1) | 1;
+	for (unsigned int i = 0; i < HASH_COUNT; ++i) {
+		const std::size_t bit = bit_index(h1, h2, i);
+		bits[bit / 64] |= std::uint64_t(1) << (bit % 64);
+	}
+	++entries;
+}
+
+bool BloomFilter::may_contain(const std::string& key) const
+{
+	const std::uint64_t h1 = std::hash<std::string>()(key);
+	const std::uint64_t h2 = mix(h1) | 1;
+	for (unsigned int i = 0; i < HASH_COUNT; ++i) {
+		const std::size_t bit = bit_index(h1, h2, i);
+		if ((bits[bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace newsboat
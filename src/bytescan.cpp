@@ -0,0 +1,226 @@
+#include "bytescan.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace newsboat {
+
+namespace bytescan {
+
+namespace {
+
+const std::uint64_t ones = 0x0101010101010101ull;
+const std::uint64_t low_bits = 0x7f7f7f7f7f7f7f7full;
+const std::uint64_t high_bits = 0x8080808080808080ull;
+
+std::uint64_t load(const char* data)
+{
+	std::uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+/// Sets the top bit of each byte of \a word that is zero, and nothing else.
+/// Unlike the usual `(x - ones) & ~x` trick, no borrow crosses into the next
+/// byte, so the result is exact.
+std::uint64_t zero_bytes(std::uint64_t word)
+{
+	return ~(((word & low_bits) + low_bits) | word | low_bits);
+}
+
+std::uint64_t bytes_equal_to(std::uint64_t word, unsigned char c)
+{
+	return zero_bytes(word ^ (ones * c));
+}
+
+/// Sets the top bit of each byte of \a word that is below \a limit, which
+/// has to be between 1 and 128.
+std::uint64_t bytes_below(std::uint64_t word, unsigned char limit)
+{
+	return ~(((word & low_bits) + ones * (0x80 - limit)) | word) & high_bits;
+}
+
+/// Bytes that start a whitespace character which isn't ASCII: U+0085 and
+/// U+00A0 (0xC2), U+1680 (0xE1), U+2000 to U+205F (0xE2) and U+3000 (0xE3)
+bool starts_unicode_whitespace(unsigned char c)
+{
+	return c == 0xC2 || (c >= 0xE1 && c <= 0xE3);
+}
+
+bool is_ascii_whitespace_but_space(unsigned char c)
+{
+	return c >= '\t' && c <= '\r';
+}
+
+} // namespace
+
+bool is_printable_ascii(const char* data, std::size_t size)
+{
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+		const std::uint64_t word = load(data + i);
+		if ((bytes_below(word, ' ') | (~bytes_below(word, '~' + 1) & high_bits))
+			!= 0) {
+			return false;
+		}
+	}
+	for (; i < size; ++i) {
+		if (data[i] < ' ' || data[i] > '~') {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool is_ascii(const char* data, std::size_t size)
+{
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+		if ((load(data + i) & high_bits) != 0) {
+			return false;
+		}
+	}
+	for (; i < size; ++i) {
+		if (static_cast<unsigned char>(data[i]) >= 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool is_valid_utf8(const char* data, std::size_t size)
+{
+	const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(data);
+	std::size_t i = 0;
+	while (i < size) {
+		if (i + sizeof(std::uint64_t) <= size
+			&& (load(data + i) & high_bits) == 0) {
+			i += sizeof(std::uint64_t);
+			continue;
+		}
+
+		const unsigned char lead = bytes[i];
+		if (lead < 0x80) {
+			i++;
+			continue;
+		}
+
+		std::size_t length;
+		// The range of the second byte, which rules out overlong encodings,
+		// surrogates and code points past U+10FFFF
+		unsigned char min = 0x80;
+		unsigned char max = 0xBF;
+		if (lead >= 0xC2 && lead <= 0xDF) {
+			length = 2;
+		} else if (lead >= 0xE0 && lead <= 0xEF) {
+			length = 3;
+			if (lead == 0xE0) {
+				min = 0xA0;
+			} else if (lead == 0xED) {
+				max = 0x9F;
+			}
+		} else if (lead >= 0xF0 && lead <= 0xF4) {
+			length = 4;
+			if (lead == 0xF0) {
+				min = 0x90;
+			} else if (lead == 0xF4) {
+				max = 0x8F;
+			}
+		} else {
+			return false;
+		}
+
+		if (size - i < length || bytes[i + 1] < min || bytes[i + 1] > max) {
+			return false;
+		}
+		for (std::size_t k = 2; k < length; ++k) {
+			if ((bytes[i + k] & 0xC0) != 0x80) {
+				return false;
+			}
+		}
+		i += length;
+	}
+	return true;
+}
+
+std::size_t find_first_of(const char* data, std::size_t size,
+	const char* chars)
+{
+	const std::size_t count = std::strlen(chars);
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+		const std::uint64_t word = load(data + i);
+		std::uint64_t found = 0;
+		for (std::size_t k = 0; k < count; ++k) {
+			found |= bytes_equal_to(word, chars[k]);
+		}
+		if (found != 0) {
+			// The loop below finds it within this word
+			break;
+		}
+	}
+	for (; i < size; ++i) {
+		if (std::memchr(chars, data[i], count) != nullptr) {
+			return i;
+		}
+	}
+	return std::string::npos;
+}
+
+std::size_t find_soft_hyphen(const char* data, std::size_t size)
+{
+	// U+00AD is 0xC2 0xAD in UTF-8
+	std::size_t from = 0;
+	while (from + 1 < size) {
+		const void* found = std::memchr(data + from, 0xC2, size - from - 1);
+		if (found == nullptr) {
+			break;
+		}
+		const std::size_t i = static_cast<const char*>(found) - data;
+		if (static_cast<unsigned char>(data[i + 1]) == 0xAD) {
+			return i;
+		}
+		from = i + 1;
+	}
+	return std::string::npos;
+}
+
+bool is_consolidated(const char* data, std::size_t size)
+{
+	// Leading spaces are kept as they are...
+	std::size_t i = 0;
+	while (i < size && data[i] == ' ') {
+		i++;
+	}
+	if (i == size) {
+		// ...unless there's only whitespace, which becomes an empty string
+		return size == 0;
+	}
+
+	// data[i] isn't a space, so only the word loop below has to check for
+	// two spaces in a row that straddle two words
+	for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+		const std::uint64_t word = load(data + i);
+		const std::uint64_t spaces = bytes_equal_to(word, ' ');
+		std::uint64_t changed = (spaces & (spaces >> 8))
+			| (bytes_below(word, '\r' + 1) & ~bytes_below(word, '\t'));
+		changed |= bytes_equal_to(word, 0xC2) | bytes_equal_to(word, 0xE1)
+			| bytes_equal_to(word, 0xE2) | bytes_equal_to(word, 0xE3);
+		if (changed != 0 || (data[i] == ' ' && data[i - 1] == ' ')) {
+			return false;
+		}
+	}
+	for (; i < size; ++i) {
+		const unsigned char c = data[i];
+		if (is_ascii_whitespace_but_space(c) || starts_unicode_whitespace(c)
+			|| (c == ' ' && data[i - 1] == ' ')) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace bytescan
+
+} // namespace newsboat
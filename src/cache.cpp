@@ -1,26 +1,48 @@
 #include "cache.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cinttypes>
 #include <cstdlib>
-#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <sqlite3.h>
-#include <sstream>
 #include <time.h>
 
 #include "config.h"
 #include "configcontainer.h"
+#include "contenttext.h"
 #include "controller.h"
 #include "dbexception.h"
+#include "jobprogress.h"
 #include "logger.h"
 #include "matcherexception.h"
 #include "rssfeed.h"
+#include "rssignores.h"
+#include "runtimestats.h"
 #include "scopemeasure.h"
+#include "scopestats.h"
 #include "strprintf.h"
 #include "utils.h"
 
+/* Articles stored since schema 2.30 keep their content in rss_content,
+ * shared with every other article that has the same text; older ones still
+ * have it in rss_item.content, until Cache::split_stored_content() moves
+ * it. These read either, in queries on rss_item. The length is kept with
+ * the article, so that reading a list of them doesn't read the contents.
+ */
+#define STORED_CONTENT \
+	"IFNULL((SELECT content FROM rss_content " \
+	"WHERE id = rss_item.content_id), rss_item.content)"
+#define ITEM_CONTENT "newsboat_content(" STORED_CONTENT ")"
+#define ITEM_CONTENT_LENGTH \
+	"IFNULL(rss_item.content_length, newsboat_content_length(" \
+	STORED_CONTENT "))"
+/* What searches match the content against; see content_text() */
+#define ITEM_TEXT "IFNULL(rss_item.content_text, " ITEM_CONTENT ")"
+
 namespace newsboat {
 
 inline void Cache::run_sql_impl(const std::string& query,
@@ -54,112 +76,563 @@ void Cache::run_sql_nothrow(const std::string& query,
 	run_sql_impl(query, callback, callback_argument, false);
 }
 
+Statement::Statement(sqlite3* db, sqlite3_stmt* stmt, bool owned)
+	: db(db)
+	, stmt(stmt)
+	, owned(owned)
+{
+}
+
+Statement::Statement(Statement&& other)
+	: db(other.db)
+	, stmt(other.stmt)
+	, owned(other.owned)
+{
+	other.stmt = nullptr;
+}
+
+Statement::~Statement()
+{
+	if (stmt == nullptr) {
+		return;
+	}
+
+	if (owned) {
+		sqlite3_finalize(stmt);
+	} else {
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+	}
+}
+
+Statement& Statement::bind(int index, const std::string& value)
+{
+	const int rc = sqlite3_bind_text(stmt, index, value.c_str(), value.length(),
+			SQLITE_TRANSIENT);
+	if (rc != SQLITE_OK) {
+		throw DbException(db);
+	}
+	return *this;
+}
+
+Statement& Statement::bind(int index, int64_t value)
+{
+	const int rc = sqlite3_bind_int64(stmt, index, value);
+	if (rc != SQLITE_OK) {
+		throw DbException(db);
+	}
+	return *this;
+}
+
+Statement& Statement::bind_blob(int index, const std::string& value)
+{
+	const int rc = sqlite3_bind_blob(stmt, index, value.data(), value.length(),
+			SQLITE_TRANSIENT);
+	if (rc != SQLITE_OK) {
+		throw DbException(db);
+	}
+	return *this;
+}
+
+bool Statement::step()
+{
+	const int rc = sqlite3_step(stmt);
+	if (rc == SQLITE_ROW) {
+		return true;
+	}
+	if (rc == SQLITE_DONE) {
+		return false;
+	}
+
+	LOG(Level::CRITICAL,
+		"statement \"%s\" failed: (%d) %s",
+		sqlite3_sql(stmt),
+		rc,
+		sqlite3_errstr(rc));
+	throw DbException(db);
+}
+
+void Statement::execute()
+{
+	while (step()) {
+	}
+}
+
+std::string Statement::column_string(int column) const
+{
+	const auto text = sqlite3_column_text(stmt, column);
+	if (text == nullptr) {
+		return {};
+	}
+	return std::string(reinterpret_cast<const char*>(text),
+			sqlite3_column_bytes(stmt, column));
+}
+
+int64_t Statement::column_int(int column) const
+{
+	return sqlite3_column_int64(stmt, column);
+}
+
+bool Statement::column_is_null(int column) const
+{
+	return sqlite3_column_type(stmt, column) == SQLITE_NULL;
+}
+
+ScopeTransaction::ScopeTransaction(Cache& cache)
+	: cache(cache)
+	, lock(cache.mtx)
+{
+	cache.begin_transaction();
+}
+
+ScopeTransaction::~ScopeTransaction()
+{
+	// Whatever the scope wrote before the exception was thrown is undone
+	cache.end_transaction(!std::uncaught_exception());
+}
+
+void Cache::begin_transaction()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	if (transaction_depth == 0) {
+		run_sql("BEGIN TRANSACTION;");
+		transaction_owner = std::this_thread::get_id();
+	} else {
+		// So that a nested scope that fails can be undone on its own
+		run_sql("SAVEPOINT scope_transaction;");
+	}
+	++transaction_depth;
+}
+
+void Cache::end_transaction(bool commit)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	assert(transaction_depth > 0);
+	--transaction_depth;
+
+	// This is called from a destructor, so we can't throw. If a statement
+	// fails, all that's left to do is to get the connection out of the
+	// transaction.
+	bool rolled_back = false;
+	if (transaction_depth > 0) {
+		if (!commit) {
+			run_sql_nothrow("ROLLBACK TO scope_transaction;");
+			rolled_back = true;
+		}
+		run_sql_nothrow("RELEASE scope_transaction;");
+	} else {
+		transaction_owner = std::thread::id();
+		if (sqlite3_get_autocommit(db) == 0) {
+			if (commit) {
+				run_sql_nothrow("COMMIT;");
+			}
+			if (sqlite3_get_autocommit(db) == 0) {
+				run_sql_nothrow("ROLLBACK;");
+				rolled_back = true;
+			}
+		}
+	}
+	if (rolled_back) {
+		LOG(Level::WARN, "Cache::end_transaction: rolled back");
+		// Feeds added in the transaction are gone again
+		std::lock_guard<std::mutex> guard(feed_ids_mtx);
+		feed_ids.clear();
+	}
+}
+
 namespace {
 
-struct CbHandler {
-	CbHandler()
-		: c(-1)
+/// Number of read-only connections opened when the cache is in WAL mode.
+const unsigned int READ_CONNECTIONS = 2;
+
+/// Value of `PRAGMA auto_vacuum` for incremental mode.
+const int64_t INCREMENTAL_AUTO_VACUUM = 2;
+
+/// The trigram tokenizer can't match anything shorter than this.
+const std::size_t MIN_INDEXED_QUERY_LENGTH = 3;
+
+/// A content dictionary is only trained once there's this many articles to
+/// learn from; fewer would just teach it their particular wording.
+const unsigned int MIN_DICTIONARY_SAMPLES = 50;
+const unsigned int MAX_DICTIONARY_SAMPLES = 500;
+const std::size_t CONTENT_DICTIONARY_SIZE = 32768;
+
+/// How many articles older than `keep-articles-days` are deleted per
+/// statement, so that each one's journal stays small.
+const unsigned int EXPIRY_BATCH_SIZE = 1000;
+
+/// How many virtual machine instructions SQLite runs between the checks of
+/// InterruptOnCancel.
+const int CANCEL_CHECK_STEPS = 10000;
+
+/// \brief Makes the statements of a connection give up with
+/// SQLITE_INTERRUPT once a job is cancelled, for as long as it lives.
+///
+/// Does nothing if there's no job.
+class InterruptOnCancel {
+public:
+	InterruptOnCancel(sqlite3* db, const JobProgress* progress)
+		: db(progress != nullptr ? db : nullptr)
 	{
+		if (this->db != nullptr) {
+			sqlite3_progress_handler(this->db, CANCEL_CHECK_STEPS, &is_cancelled,
+				const_cast<JobProgress*>(progress));
+		}
 	}
-	void set_count(int i)
+	InterruptOnCancel(const InterruptOnCancel&) = delete;
+	InterruptOnCancel& operator=(const InterruptOnCancel&) = delete;
+	~InterruptOnCancel()
 	{
-		c = i;
+		if (db != nullptr) {
+			sqlite3_progress_handler(db, 0, nullptr, nullptr);
+		}
 	}
-	int count()
+
+private:
+	static int is_cancelled(void* progress)
 	{
-		return c;
+		return static_cast<const JobProgress*>(progress)->is_cancelled() ? 1 : 0;
 	}
 
-private:
-	int c;
+	sqlite3* const db;
 };
 
-struct HeaderValues {
-	time_t lastmodified;
-	std::string etag;
-};
+/// Turns a search query into an FTS5 phrase, so that the index matches it
+/// as a plain substring rather than interpreting its operators.
+std::string search_index_phrase(const std::string& querystr)
+{
+	return "\"" + utils::replace_all(querystr, "\"", "\"\"") + "\"";
+}
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
 
+/// FNV-1a of \a text, continuing from \a hash. It's much cheaper than a
+/// cryptographic hash.
+uint64_t add_to_hash(uint64_t hash, const std::string& text)
+{
+	for (const char c : text) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
 }
 
-static int count_callback(void* handler, int argc, char** argv,
-	char** /* azColName */)
+/// Identifies article contents in rss_content; equal hashes are only a hint
+/// that the contents are the same, and collisions only cost a comparison.
+int64_t content_hash(const std::string& text)
 {
-	CbHandler* cbh = static_cast<CbHandler*>(handler);
+	return static_cast<int64_t>(add_to_hash(FNV_OFFSET_BASIS, text));
+}
 
-	if (argc > 0) {
-		std::istringstream is(argv[0]);
-		int x;
-		is >> x;
-		cbh->set_count(x);
+/// Identifies what Cache::update_rssitem_unlocked() stores of an item, so
+/// that a row that would be written with the same values is left alone.
+/// Every field is followed by a NUL, so that text moving from the end of one
+/// field to the start of the next still changes the hash.
+int64_t item_hash(const RssItem& item, const std::string& feedurl,
+	const Description& description)
+{
+	const std::string fields[] = {
+		item.title(),
+		item.author(),
+		item.link(),
+		feedurl,
+		description.text,
+		description.mime,
+		item.enclosure_url(),
+		item.enclosure_type(),
+		item.get_base(),
+	};
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (const auto& field : fields) {
+		hash = add_to_hash(hash, field);
+		hash = add_to_hash(hash, std::string(1, '\0'));
 	}
+	return static_cast<int64_t>(hash);
+}
 
-	return 0;
+std::size_t count_codepoints(const std::string& str)
+{
+	// Count every byte that isn't a UTF-8 continuation byte
+	return std::count_if(str.begin(), str.end(), [](char c) {
+		return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+	});
 }
 
-static int single_string_callback(void* handler,
-	int argc,
-	char** argv,
-	char** /* azColName */)
+/* rss_item.content holds either plain TEXT or, with
+ * `cache-compress-content`, a BLOB made by ContentCodec. Queries read it
+ * through these two functions so they don't need to care which.
+ */
+void content_function(sqlite3_context* context, int /* argc */,
+	sqlite3_value** argv)
 {
-	std::string* value = reinterpret_cast<std::string*>(handler);
-	if (argc > 0 && argv[0]) {
-		*value = argv[0];
+	if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+		sqlite3_result_value(context, argv[0]);
+		return;
+	}
+	const auto codec = static_cast<const ContentCodec*>(
+			sqlite3_user_data(context));
+	const void* data = sqlite3_value_blob(argv[0]);
+	const int size = sqlite3_value_bytes(argv[0]);
+	try {
+		const std::string text = codec->decompress(data, size);
+		sqlite3_result_text(context, text.data(), text.length(),
+			SQLITE_TRANSIENT);
+	} catch (const std::runtime_error& e) {
+		sqlite3_result_error(context, e.what(), -1);
 	}
-	return 0;
 }
 
-static int rssfeed_callback(void* myfeed, int argc, char** argv,
-	char** /* azColName */)
+void content_length_function(sqlite3_context* context, int /* argc */,
+	sqlite3_value** argv)
 {
-	std::shared_ptr<RssFeed>* feed =
-		static_cast<std::shared_ptr<RssFeed>*>(myfeed);
-	// normaly, this shouldn't happen, but we keep the assert()s here
-	// nevertheless
-	assert(argc == 3);
-	assert(argv[0] != nullptr);
-	assert(argv[1] != nullptr);
-	assert(argv[2] != nullptr);
-	(*feed)->set_title(argv[0]);
-	(*feed)->set_link(argv[1]);
-	(*feed)->set_rtl(strcmp(argv[2], "1") == 0);
-	LOG(Level::INFO,
-		"rssfeed_callback: title = %s link = %s is_rtl = %s",
-		argv[0],
-		argv[1],
-		argv[2]);
-	return 0;
+	if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+		const auto text = reinterpret_cast<const char*>(
+				sqlite3_value_text(argv[0]));
+		sqlite3_result_int64(context,
+			text != nullptr ? count_codepoints(text) : 0);
+		return;
+	}
+	const void* data = sqlite3_value_blob(argv[0]);
+	const int size = sqlite3_value_bytes(argv[0]);
+	sqlite3_result_int64(context,
+		ContentCodec::decompressed_length(data, size));
 }
 
-static int lastmodified_callback(void* handler,
-	int argc,
-	char** argv,
-	char** /* azColName */)
+void register_content_functions(sqlite3* db, ContentCodec& codec)
 {
-	HeaderValues* result = static_cast<HeaderValues*>(handler);
-	assert(argc == 2);
-	assert(result != nullptr);
-	if (argv[0]) {
-		std::istringstream is(argv[0]);
-		is >> result->lastmodified;
-	} else {
-		result->lastmodified = 0;
+	const int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS;
+	sqlite3_create_function(db, "newsboat_content", 1, flags, &codec,
+		content_function, nullptr, nullptr);
+	sqlite3_create_function(db, "newsboat_content_length", 1, flags, &codec,
+		content_length_function, nullptr, nullptr);
+}
+
+/// Whether the next character of \a sql continues a name, like the digits of
+/// `rss_feed2`.
+bool in_identifier(const std::string& sql)
+{
+	if (sql.empty()) {
+		return false;
 	}
-	if (argv[1]) {
-		result->etag = argv[1];
-	} else {
-		result->etag = "";
+	const char last = sql.back();
+	return std::isalnum(static_cast<unsigned char>(last)) || last == '_';
+}
+
+/// The SQL of \a stmt with its literals replaced by `?`, so that queries
+/// built on the fly are added up with the others of their kind.
+std::string statement_shape(sqlite3_stmt* stmt)
+{
+	const char* sql = sqlite3_sql(stmt);
+	std::string shape;
+	for (const char* c = sql != nullptr ? sql : ""; *c != '\0'; ++c) {
+		if (*c == '\'') {
+			while (*++c != '\0' && *c != '\'') {
+			}
+			shape += '?';
+			if (*c == '\0') {
+				break;
+			}
+		} else if (std::isdigit(static_cast<unsigned char>(*c))
+			&& !in_identifier(shape)) {
+			while (std::isdigit(static_cast<unsigned char>(c[1]))) {
+				++c;
+			}
+			shape += '?';
+		} else {
+			shape += *c;
+		}
 	}
-	LOG(Level::INFO,
-		"lastmodified_callback: lastmodified = %" PRId64 " etag = %s",
-		// On GCC, `time_t` is `long int`, which is at least 32 bits long
-		// according to the spec. On x86_64, it's actually 64 bits. Thus,
-		// casting to int64_t is either a no-op, or an up-cast which are always
-		// safe.
-		static_cast<int64_t>(result->lastmodified),
-		result->etag);
+	const std::size_t MAX_LENGTH = 120;
+	if (shape.length() > MAX_LENGTH) {
+		shape = shape.substr(0, MAX_LENGTH) + "...";
+	}
+	return shape;
+}
+
+int add_statement_time(unsigned int /* type */, void* /* context */,
+	void* stmt, void* ns)
+{
+	ScopeStats::named("SQL: " + statement_shape(static_cast<sqlite3_stmt*>(
+				stmt))).add(std::chrono::nanoseconds(*static_cast<sqlite3_int64*>(ns)));
 	return 0;
 }
 
+/// Adds the time every statement on \a db takes to the ScopeStats, if
+/// they're enabled.
+void time_statements(sqlite3* db)
+{
+	if (ScopeStats::enabled()) {
+		sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, add_statement_time, nullptr);
+	}
+}
+
+/// Logs how SQLite is going to run `sql`, so that queries which stop using
+/// an index show up in debug logs.
+void log_query_plan(sqlite3* db, const std::string& sql)
+{
+	static auto& module = logger::module_loglevel(__FILE__);
+	if (!logger::is_enabled(Level::DEBUG, module)) {
+		return;
+	}
+
+	const std::string explain = "EXPLAIN QUERY PLAN " + sql;
+	sqlite3_stmt* stmt{};
+	if (sqlite3_prepare_v2(db, explain.c_str(), explain.length(), &stmt,
+			nullptr) != SQLITE_OK) {
+		sqlite3_finalize(stmt);
+		return;
+	}
+
+	LOG(Level::DEBUG, "query plan for \"%s\":", sql);
+	// Each row names its parent, so indent the steps by their depth
+	std::unordered_map<int, unsigned int> depths;
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		const int id = sqlite3_column_int(stmt, 0);
+		const int parent = sqlite3_column_int(stmt, 1);
+		const auto parent_depth = depths.find(parent);
+		const unsigned int depth =
+			(parent_depth == depths.end()) ? 0 : parent_depth->second + 1;
+		depths[id] = depth;
+
+		const auto detail = reinterpret_cast<const char*>(
+				sqlite3_column_text(stmt, 3));
+		LOG(Level::DEBUG,
+			"  %s%s",
+			std::string(2 * depth, ' '),
+			detail != nullptr ? detail : "");
+	}
+	sqlite3_finalize(stmt);
+}
+
+Statement compile_statement(sqlite3* db, StatementRegistry& statements,
+	const std::string& sql)
+{
+	LOG(Level::DEBUG, "running statement: %s", sql);
+
+	const auto cached = statements.find(sql);
+	if (cached != statements.end() && !sqlite3_stmt_busy(cached->second)) {
+		RuntimeStats::add(RuntimeStats::Counter::STATEMENTS_REUSED);
+		return Statement(db, cached->second, false);
+	}
+	RuntimeStats::add(RuntimeStats::Counter::STATEMENTS_PREPARED);
+
+	sqlite3_stmt* stmt{};
+	const int rc = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &stmt,
+			nullptr);
+	if (rc != SQLITE_OK) {
+		LOG(Level::CRITICAL,
+			"preparing statement \"%s\" failed: (%d) %s",
+			sql,
+			rc,
+			sqlite3_errstr(rc));
+		throw DbException(db);
+	}
+
+	if (cached != statements.end()) {
+		// The registered copy is still being stepped through further up the
+		// stack, so hand out a one-off statement instead.
+		return Statement(db, stmt, true);
+	}
+
+	log_query_plan(db, sql);
+
+	statements.emplace(sql, stmt);
+	return Statement(db, stmt, false);
+}
+
+void finalize_statements(StatementRegistry& statements)
+{
+	for (const auto& entry : statements) {
+		sqlite3_finalize(entry.second);
+	}
+	statements.clear();
+}
+
+}
+
+Statement Cache::prepare_statement(const std::string& sql)
+{
+	return compile_statement(db, statements, sql);
+}
+
+Cache::ReadLease::ReadLease(Cache& cache)
+	: cache(cache)
+	, reader(nullptr)
+{
+	if (cache.readers.empty()
+		|| cache.transaction_owner == std::this_thread::get_id()) {
+		lock = std::unique_lock<CacheMutex>(cache.mtx);
+		return;
+	}
+
+	std::unique_lock<std::mutex> readers_lock(cache.readers_mtx);
+	cache.reader_released.wait(readers_lock, [&]() {
+		for (const auto& candidate : cache.readers) {
+			if (!candidate->in_use) {
+				reader = candidate.get();
+				return true;
+			}
+		}
+		return false;
+	});
+	reader->in_use = true;
+}
+
+Cache::ReadLease::~ReadLease()
+{
+	if (reader != nullptr) {
+		{
+			std::lock_guard<std::mutex> readers_lock(cache.readers_mtx);
+			reader->in_use = false;
+		}
+		cache.reader_released.notify_one();
+	}
+}
+
+Statement Cache::ReadLease::prepare_statement(const std::string& sql)
+{
+	if (reader == nullptr) {
+		return cache.prepare_statement(sql);
+	}
+	return compile_statement(reader->db, reader->statements, sql);
+}
+
+sqlite3* Cache::ReadLease::connection() const
+{
+	return reader != nullptr ? reader->db : cache.db;
+}
+
+template<typename Values>
+Cache::TempSet::TempSet(Cache& cache, const std::string& table,
+	const Values& values)
+	: cache(cache)
+	, table(table)
+{
+	cache.run_sql("CREATE TEMP TABLE IF NOT EXISTS " + table + " ( "
+		" value TEXT PRIMARY KEY NOT NULL ) WITHOUT ROWID;");
+	cache.run_sql("DELETE FROM temp." + table + ";");
+
+	// One transaction rather than one per row
+	ScopeTransaction transaction(cache);
+	const std::string insert = "INSERT OR IGNORE INTO temp." + table
+		+ " (value) VALUES (?);";
+	for (const auto& value : values) {
+		auto stmt = cache.prepare_statement(insert);
+		stmt.bind(1, value);
+		stmt.execute();
+	}
+}
+
+Cache::TempSet::~TempSet()
+{
+	cache.run_sql_nothrow("DELETE FROM temp." + table + ";");
+}
+
+std::string Cache::TempSet::subquery() const
+{
+	return "(SELECT value FROM temp." + table + ")";
+}
+
 static int vectorofstring_callback(void* vp, int argc, char** argv,
 	char** /* azColName */)
 {
@@ -172,37 +645,102 @@ static int vectorofstring_callback(void* vp, int argc, char** argv,
 	return 0;
 }
 
-static int rssitem_callback(void* myfeed, int argc, char** argv,
-	char** /* azColName */)
+static std::shared_ptr<RssItem> item_from_row(const Statement& row)
 {
-	std::shared_ptr<RssFeed>* feed =
-		static_cast<std::shared_ptr<RssFeed>*>(myfeed);
-	assert(argc == 13);
 	std::shared_ptr<RssItem> item(new RssItem(nullptr));
-	item->set_guid(argv[0]);
-	item->set_title(argv[1]);
-	item->set_author(argv[2]);
-	item->set_link(argv[3]);
+	item->set_guid(row.column_string(0));
+	item->set_title(row.column_string(1));
+	item->set_author(row.column_string(2));
+	item->set_link(row.column_string(3));
+	item->set_pubDate(row.column_int(4));
+	item->set_size(row.column_int(5));
+	item->set_unread(row.column_int(6) == 1);
+	item->set_feedurl(row.column_string(7));
+	item->set_enclosure_url(row.column_string(8));
+	item->set_enclosure_type(row.column_string(9));
+	item->set_enqueued(row.column_int(10) == 1);
+	item->set_flags(row.column_string(11));
+	item->set_base(row.column_string(12));
+	item->set_row_id(row.column_int(13));
+	// The description is read when it's first needed
+	item->unload();
+	return item;
+}
 
-	std::istringstream is(argv[4]);
-	time_t t;
-	is >> t;
-	item->set_pubDate(t);
+/// Binds the row of \a item to parameter \a index: its id if it's known,
+/// otherwise its GUID.
+static void bind_item_row(Statement& stmt, int index, const RssItem& item)
+{
+	if (item.row_id() != 0) {
+		stmt.bind(index, item.row_id());
+	} else {
+		stmt.bind(index, item.guid());
+	}
+}
 
-	item->set_size(utils::to_u(argv[5]));
-	item->set_unread((std::string("1") == argv[6]));
+/// Copies \a item like internalize_rssfeed() would read it back: without
+/// its description, which is read when it's first needed.
+static std::shared_ptr<RssItem> copy_stored_item(const RssItem& item)
+{
+	std::shared_ptr<RssItem> copy(new RssItem(nullptr));
+	copy->set_guid(item.guid());
+	copy->set_title(item.title());
+	copy->set_author(item.author());
+	copy->set_link(item.link());
+	copy->set_pubDate(item.pubDate_timestamp());
+	copy->set_size(item.size());
+	copy->set_unread_nowrite(item.unread());
+	copy->set_feedurl(item.feedurl());
+	copy->set_enclosure_url(item.enclosure_url());
+	copy->set_enclosure_type(item.enclosure_type());
+	copy->set_enqueued(item.enqueued());
+	copy->set_flags(item.flags());
+	copy->set_base(item.get_base());
+	copy->set_row_id(item.row_id());
+	copy->unload();
+	return copy;
+}
 
-	item->set_feedurl(argv[7]);
+/// Whether \a a and \a b look the same in the article list, and have the
+/// same link and enclosure.
+static bool same_listing(const RssItem& a, const RssItem& b)
+{
+	return a.title() == b.title() && a.author() == b.author()
+		&& a.link() == b.link() && a.enclosure_url() == b.enclosure_url()
+		&& a.enclosure_type() == b.enclosure_type()
+		&& a.get_base() == b.get_base();
+}
 
-	item->set_enclosure_url(argv[8] ? argv[8] : "");
-	item->set_enclosure_type(argv[9] ? argv[9] : "");
-	item->set_enqueued((std::string("1") == (argv[10] ? argv[10] : "")));
-	item->set_flags(argv[11] ? argv[11] : "");
-	item->set_base(argv[12] ? argv[12] : "");
+/// Removes the items that \a ign ignores, keeping their order. Items for
+/// which the rules can't be evaluated are kept.
+static void remove_ignored_items(std::vector<std::shared_ptr<RssItem>>& items,
+	RssIgnores& ign)
+{
+	std::vector<bool> ignored;
+	try {
+		ignored = ign.matches(items);
+	} catch (const MatcherException& ex) {
+		// Find out which items the rules fail for, one at a time
+		LOG(Level::DEBUG, "oops, Matcher exception: %s", ex.what());
+		ignored.clear();
+		for (const auto& item : items) {
+			try {
+				ignored.push_back(ign.matches(item.get()));
+			} catch (const MatcherException& ex) {
+				LOG(Level::DEBUG, "oops, Matcher exception: %s", ex.what());
+				ignored.push_back(false);
+			}
+		}
+	}
 
-	//(*feed)->items().push_back(item);
-	(*feed)->add_item(item);
-	return 0;
+	std::vector<std::shared_ptr<RssItem>> kept;
+	kept.reserve(items.size());
+	for (std::size_t i = 0; i < items.size(); ++i) {
+		if (!ignored[i]) {
+			kept.push_back(items[i]);
+		}
+	}
+	items.swap(kept);
 }
 
 static int fill_content_callback(void* myfeed,
@@ -215,44 +753,12 @@ static int fill_content_callback(void* myfeed,
 	if (argv[0]) {
 		std::shared_ptr<RssItem> item =
 			feed->get_item_by_guid_unlocked(argv[0]);
-		item->set_description(argv[1] ? argv[1] : "", argv[2] ? argv[2] : "");
+		item->set_description_from_cache(argv[1] ? argv[1] : "",
+			argv[2] ? argv[2] : "");
 	}
 	return 0;
 }
 
-static int search_item_callback(void* myfeed,
-	int argc,
-	char** argv,
-	char** /* azColName */)
-{
-	std::vector<std::shared_ptr<RssItem>>* items =
-			static_cast<std::vector<std::shared_ptr<RssItem>>*>(myfeed);
-	assert(argc == 13);
-	std::shared_ptr<RssItem> item(new RssItem(nullptr));
-	item->set_guid(argv[0]);
-	item->set_title(argv[1]);
-	item->set_author(argv[2]);
-	item->set_link(argv[3]);
-
-	std::istringstream is(argv[4]);
-	time_t t;
-	is >> t;
-	item->set_pubDate(t);
-
-	item->set_size(utils::to_u(argv[5]));
-	item->set_unread((std::string("1") == argv[6]));
-	item->set_feedurl(argv[7]);
-
-	item->set_enclosure_url(argv[8] ? argv[8] : "");
-	item->set_enclosure_type(argv[9] ? argv[9] : "");
-	item->set_enqueued((std::string("1") == argv[10]));
-	item->set_flags(argv[11] ? argv[11] : "");
-	item->set_base(argv[12] ? argv[12] : "");
-
-	items->push_back(item);
-	return 0;
-}
-
 static int guid_callback(void* myguids, int argc, char** argv,
 	char** /* azColName */)
 {
@@ -265,6 +771,17 @@ static int guid_callback(void* myguids, int argc, char** argv,
 Cache::Cache(const std::string& cachefile, ConfigContainer* c)
 	: db(0)
 	, cfg(c)
+	, mtx("Cache::mtx wait")
+	, transaction_depth(0)
+	, transaction_owner(std::thread::id())
+	, search_index_available(false)
+	, search_index_ready(false)
+	, content_dictionary_id(0)
+	, compressed_items_up_to(0)
+	, compressed_contents_up_to(0)
+	, split_items_up_to(0)
+	, known_guids_loaded(false)
+	, validators_preloaded(false)
 {
 	const int error = sqlite3_open(cachefile.c_str(), &db);
 	if (error != SQLITE_OK) {
@@ -274,11 +791,29 @@ Cache::Cache(const std::string& cachefile, ConfigContainer* c)
 			error);
 		throw DbException(db);
 	}
+	register_content_functions(db, codec);
+	time_statements(db);
+
+	// Only take effect on new files; older ones are converted by the next
+	// full VACUUM (`newsboat -X`), see log_auto_vacuum_mode() and
+	// log_page_size(). The page size has to come first, as asking for the
+	// auto_vacuum mode settles it.
+	const unsigned int page_size = configured_page_size();
+	if (page_size != 0) {
+		run_sql_nothrow(prepare_query("PRAGMA page_size = %u;", page_size));
+	}
+	run_sql_nothrow("PRAGMA auto_vacuum = INCREMENTAL;");
 
 	populate_tables();
 	set_pragmas();
+	log_auto_vacuum_mode();
+	log_page_size();
+	load_content_dictionaries();
+	open_readers(cachefile);
+	set_up_search_index();
 
 	clean_old_articles();
+	take_snapshot_token();
 
 	// we need to manually lock all DB operations because SQLite has no
 	// explicit support for multithreading.
@@ -286,46 +821,162 @@ Cache::Cache(const std::string& cachefile, ConfigContainer* c)
 
 Cache::~Cache()
 {
+	close_readers();
+	finalize_statements(statements);
 	sqlite3_close(db);
 }
 
 void Cache::set_pragmas()
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 	// first, we need to swithc off synchronous writing as it's slow as hell
 	run_sql("PRAGMA synchronous = OFF;");
 
 	// then we disable case-sensitive matching for the LIKE operator in
 	// SQLite, for search operations
 	run_sql("PRAGMA case_sensitive_like=OFF;");
-}
 
-static const schema_patches schemaPatches{
-	{	{2, 10},
-		{
-			"CREATE TABLE rss_feed ( "
-			" rssurl VARCHAR(1024) PRIMARY KEY NOT NULL, "
-			" url VARCHAR(1024) NOT NULL, "
-			" title VARCHAR(1024) NOT NULL ); ",
+	// Write-ahead logging lets readers on other connections carry on while
+	// a reload is writing. The journal mode is persisted in the file, so it
+	// has to be switched back explicitly when the setting is turned off.
+	const bool use_wal = cfg->get_configvalue_as_bool("cache-wal");
+	run_sql_nothrow(use_wal
+		? "PRAGMA journal_mode = WAL;"
+		: "PRAGMA journal_mode = DELETE;");
 
-			"CREATE TABLE rss_item ( "
-			" id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL, "
-			" guid VARCHAR(64) NOT NULL, "
-			" title VARCHAR(1024) NOT NULL, "
-			" author VARCHAR(1024) NOT NULL, "
-			" url VARCHAR(1024) NOT NULL, "
-			" feedurl VARCHAR(1024) NOT NULL, "
-			" pubDate INTEGER NOT NULL, "
-			" content VARCHAR(65535) NOT NULL,"
-			" unread INTEGER(1) NOT NULL );",
+	for (const auto& pragma : memory_pragmas()) {
+		run_sql_nothrow(pragma);
+	}
+}
 
-			"CREATE TABLE google_replay ( "
-			" id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL, "
-			" guid VARCHAR(64) NOT NULL, "
-			" state INTEGER NOT NULL, "
-			" ts INTEGER NOT NULL );",
+std::vector<std::string> Cache::memory_pragmas()
+{
+	// Pages that are mapped are read straight from the OS's page cache,
+	// without a read() per page. A negative cache_size is in KiB.
+	const std::uint64_t mmap_mb = std::max(0,
+			cfg->get_configvalue_as_int("cache-mmap-mb"));
+	const unsigned int memory_kb = std::max(0,
+			cfg->get_configvalue_as_int("cache-memory-kb"));
+	return {
+		prepare_query("PRAGMA mmap_size = %" PRIu64 ";", mmap_mb * 1024 * 1024),
+		prepare_query("PRAGMA cache_size = -%u;", memory_kb),
+	};
+}
 
-			/* we need to do these ALTER TABLE statements because we
+unsigned int Cache::configured_page_size()
+{
+	const unsigned int page_size = cfg->get_configvalue_as_int("cache-page-size");
+	// SQLite ignores anything else
+	const bool power_of_two = (page_size & (page_size - 1)) == 0;
+	if (page_size < 512 || page_size > 65536 || !power_of_two) {
+		LOG(Level::WARN,
+			"Cache::configured_page_size: ignoring cache-page-size %u, which "
+			"isn't a power of two between 512 and 65536",
+			page_size);
+		return 0;
+	}
+	return page_size;
+}
+
+unsigned int Cache::current_page_size()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement("PRAGMA page_size;");
+	return stmt.step() ? stmt.column_int(0) : 0;
+}
+
+void Cache::close_readers()
+{
+	std::unique_lock<std::mutex> readers_lock(readers_mtx);
+	reader_released.wait(readers_lock, [&]() {
+		return std::none_of(readers.begin(), readers.end(),
+		[](const std::unique_ptr<ReadConnection>& reader) {
+			return reader->in_use;
+		});
+	});
+	for (const auto& reader : readers) {
+		finalize_statements(reader->statements);
+		sqlite3_close(reader->db);
+	}
+	readers.clear();
+}
+
+void Cache::open_readers(const std::string& cachefile)
+{
+	std::string journal_mode;
+	{
+		std::lock_guard<CacheMutex> lock(mtx);
+		auto stmt = prepare_statement("PRAGMA journal_mode;");
+		if (stmt.step()) {
+			journal_mode = stmt.column_string(0);
+		}
+	}
+	if (journal_mode != "wal") {
+		LOG(Level::DEBUG,
+			"Cache::open_readers: journal mode is `%s', using a single "
+			"connection",
+			journal_mode);
+		return;
+	}
+
+	for (unsigned int i = 0; i < READ_CONNECTIONS; ++i) {
+		sqlite3* reader_db{};
+		const int error = sqlite3_open_v2(cachefile.c_str(), &reader_db,
+				SQLITE_OPEN_READONLY, nullptr);
+		if (error != SQLITE_OK) {
+			LOG(Level::ERROR,
+				"Cache::open_readers: couldn't open read-only connection: "
+				"error = %d",
+				error);
+			sqlite3_close(reader_db);
+			break;
+		}
+		// The writer may be checkpointing the WAL when we start reading
+		sqlite3_busy_timeout(reader_db, 1000);
+		sqlite3_exec(reader_db, "PRAGMA case_sensitive_like=OFF;", nullptr,
+			nullptr, nullptr);
+		for (const auto& pragma : memory_pragmas()) {
+			sqlite3_exec(reader_db, pragma.c_str(), nullptr, nullptr, nullptr);
+		}
+		register_content_functions(reader_db, codec);
+		time_statements(reader_db);
+
+		std::unique_ptr<ReadConnection> reader(new ReadConnection());
+		reader->db = reader_db;
+		reader->in_use = false;
+		readers.push_back(std::move(reader));
+	}
+	LOG(Level::INFO,
+		"Cache::open_readers: opened %u read-only connection(s)",
+		static_cast<unsigned int>(readers.size()));
+}
+
+static const schema_patches schemaPatches{
+	{	{2, 10},
+		{
+			"CREATE TABLE rss_feed ( "
+			" rssurl VARCHAR(1024) PRIMARY KEY NOT NULL, "
+			" url VARCHAR(1024) NOT NULL, "
+			" title VARCHAR(1024) NOT NULL ); ",
+
+			"CREATE TABLE rss_item ( "
+			" id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL, "
+			" guid VARCHAR(64) NOT NULL, "
+			" title VARCHAR(1024) NOT NULL, "
+			" author VARCHAR(1024) NOT NULL, "
+			" url VARCHAR(1024) NOT NULL, "
+			" feedurl VARCHAR(1024) NOT NULL, "
+			" pubDate INTEGER NOT NULL, "
+			" content VARCHAR(65535) NOT NULL,"
+			" unread INTEGER(1) NOT NULL );",
+
+			"CREATE TABLE google_replay ( "
+			" id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL, "
+			" guid VARCHAR(64) NOT NULL, "
+			" state INTEGER NOT NULL, "
+			" ts INTEGER NOT NULL );",
+
+			/* we need to do these ALTER TABLE statements because we
 			 * need to store additional data for the podcast support
 			 */
 			"ALTER TABLE rss_item ADD enclosure_url VARCHAR(1024);",
@@ -392,14 +1043,304 @@ static const schema_patches schemaPatches{
 
 			"ALTER TABLE rss_item ADD COLUMN content_mime_type VARCHAR(255) NOT NULL DEFAULT \"\";"
 		}
+	},
+	{	{2, 30},
+		{
+			"UPDATE metadata SET db_schema_version_major = 2, db_schema_version_minor = 30;",
+
+			/* Aggregators republish the same articles under their own
+			 * guids, so article contents are stored once per distinct
+			 * text and referred to by content_id. Contents that nothing
+			 * refers to anymore are removed by
+			 * Cache::remove_orphaned_contents().
+			 */
+			"CREATE TABLE rss_content ( "
+			" id INTEGER PRIMARY KEY, "
+			" hash INTEGER NOT NULL, "
+			" content NOT NULL );",
+			"CREATE INDEX idx_rss_content_hash ON rss_content(hash);",
+			"ALTER TABLE rss_item ADD COLUMN content_id INTEGER;",
+			"CREATE INDEX idx_rss_item_content_id ON rss_item(content_id);",
+
+			/* Loading a feed, or a summary of it, reads its non-deleted
+			 * items newest first; this index hands them out in that order
+			 * and has all the columns a summary needs.
+			 */
+			"CREATE INDEX IF NOT EXISTS idx_rss_item_feed_pubdate ON "
+			"rss_item(feedurl, pubDate DESC, id DESC, guid, unread, flags, "
+			"deleted) "
+			"WHERE deleted = 0;",
+
+			/* Almost every item has deleted = 0, so this index never
+			 * narrows a query down, but it lured the planner away from
+			 * the one above.
+			 */
+			"DROP INDEX IF EXISTS idx_deleted;",
+
+			"CREATE INDEX IF NOT EXISTS idx_rss_item_unread_guid ON "
+			"rss_item(unread, guid);",
+
+			/* Dictionaries that compressed article contents refer to,
+			 * see ContentCodec.
+			 */
+			"CREATE TABLE content_dictionary ( "
+			" id INTEGER PRIMARY KEY, "
+			" data BLOB NOT NULL );",
+
+			/* How long reloading the feed usually takes, in milliseconds;
+			 * 0 if it was never timed. See Cache::update_download_times().
+			 */
+			"ALTER TABLE rss_feed ADD COLUMN download_time INTEGER NOT NULL "
+			"DEFAULT 0;",
+
+			/* When the feed should be checked for updates next, with
+			 * `reload-adaptive` enabled; 0 if it should be checked right
+			 * away. See Cache::update_next_checks().
+			 */
+			"ALTER TABLE rss_feed ADD COLUMN next_check INTEGER NOT NULL "
+			"DEFAULT 0;",
+
+			/* Hash of the body the feed was last parsed from, so that a
+			 * server that sends the same body again every time doesn't
+			 * make us parse it again; 0 if there's none. See
+			 * Cache::update_body_hash().
+			 */
+			"ALTER TABLE rss_feed ADD COLUMN body_hash INTEGER NOT NULL "
+			"DEFAULT 0;",
+
+			/* Articles are stored with an upsert on their guid, which
+			 * needs the guids to be unique. Every query on rss_item
+			 * already treats them as if they were, so of any duplicates
+			 * only the oldest row is kept.
+			 */
+			"DELETE FROM rss_item WHERE id NOT IN ("
+			"SELECT MIN(id) FROM rss_item GROUP BY guid);",
+			"CREATE UNIQUE INDEX IF NOT EXISTS idx_rss_item_guid ON "
+			"rss_item(guid);",
+			"DROP INDEX IF EXISTS idx_guid;",
+
+			/* Hash of the values the article was last stored with, so that
+			 * storing it again with the same ones doesn't write anything;
+			 * NULL for articles stored before. See item_hash().
+			 */
+			"ALTER TABLE rss_item ADD COLUMN item_hash INTEGER;",
+
+			/* Changes to articles that the remote API is still to be told
+			 * about, one row per article; see RemoteOutbox. read is NULL
+			 * if the article wasn't marked, flags is NULL if they didn't
+			 * change. This replaces google_replay, which was never used.
+			 */
+			"CREATE TABLE remote_outbox ( "
+			" guid VARCHAR(64) PRIMARY KEY NOT NULL, "
+			" read INTEGER(1), "
+			" oldflags VARCHAR(52), "
+			" flags VARCHAR(52), "
+			" attempts INTEGER NOT NULL DEFAULT 0, "
+			" revision INTEGER NOT NULL DEFAULT 0 );",
+			"DROP TABLE IF EXISTS google_replay;",
+
+			/* The feeds each remote API said the account is subscribed to
+			 * last time, so that startup doesn't have to wait for it to say
+			 * so again. tags are separated by newlines.
+			 */
+			"CREATE TABLE remote_subscriptions ( "
+			" source VARCHAR(32) NOT NULL, "
+			" position INTEGER NOT NULL, "
+			" url VARCHAR(1024) NOT NULL, "
+			" tags TEXT NOT NULL, "
+			" PRIMARY KEY (source, position) );",
+
+			/* The last answers to the remote API requests that are made
+			 * conditionally, e.g. for the subscription lists, so that a
+			 * "304 Not Modified" can be answered with the stored body.
+			 */
+			"CREATE TABLE remote_responses ( "
+			" url VARCHAR(1024) PRIMARY KEY NOT NULL, "
+			" lastmodified INTEGER NOT NULL DEFAULT 0, "
+			" etag VARCHAR(128) NOT NULL DEFAULT \"\", "
+			" body TEXT NOT NULL );",
+
+			/* The WebSub hub each feed announced, and the URL the hub knows
+			 * the feed by, for the relay that subscribes to them; see
+			 * WebSubRelay.
+			 */
+			"CREATE TABLE websub_hubs ( "
+			" rssurl VARCHAR(1024) PRIMARY KEY NOT NULL, "
+			" hub VARCHAR(1024) NOT NULL, "
+			" topic VARCHAR(1024) NOT NULL );",
+
+			/* Deleted articles are kept while they're still in their
+			 * feed; only they are in this index, which
+			 * remove_old_deleted_items() looks them up by.
+			 */
+			"CREATE INDEX IF NOT EXISTS idx_rss_item_deleted_feedurl ON "
+			"rss_item(feedurl) WHERE deleted = 1;",
+
+			/* The token of the startup snapshot that the last session
+			 * wrote on quit; see Cache::snapshot_token().
+			 */
+			"CREATE TABLE snapshot_token ( "
+			" token VARCHAR(64) NOT NULL );",
+
+			/* The number of characters of the content, or NULL if it
+			 * wasn't counted yet; see ITEM_CONTENT_LENGTH.
+			 */
+			"ALTER TABLE rss_item ADD COLUMN content_length INTEGER;",
+
+			/* How the feed has been failing to reload; see
+			 * Cache::update_failures().
+			 */
+			"ALTER TABLE rss_feed ADD COLUMN failures INTEGER NOT NULL "
+			"DEFAULT 0;",
+			"ALTER TABLE rss_feed ADD COLUMN retry_at INTEGER NOT NULL "
+			"DEFAULT 0;",
+			"ALTER TABLE rss_feed ADD COLUMN gone INTEGER(1) NOT NULL "
+			"DEFAULT 0;",
+
+			/* Where the feed was permanently moved to, so that it's
+			 * fetched from there directly, and since when; "" if it
+			 * wasn't. See Cache::update_moved_url().
+			 */
+			"ALTER TABLE rss_feed ADD COLUMN moved_url VARCHAR(1024) NOT NULL "
+			"DEFAULT \"\";",
+			"ALTER TABLE rss_feed ADD COLUMN moved_since INTEGER NOT NULL "
+			"DEFAULT 0;",
+
+			/* Articles refer to their feed by a number rather than by its
+			 * URL, so that the indexes which look articles up by feed
+			 * don't hold a copy of the URL for every article, and the
+			 * lookups compare numbers. rss_feed_id numbers every URL that
+			 * articles were stored for; see Cache::feed_id_unlocked().
+			 * rss_item.feedurl stays, for whatever reads the URL along
+			 * with the article.
+			 */
+			"CREATE TABLE rss_feed_id ( "
+			" id INTEGER PRIMARY KEY, "
+			" rssurl VARCHAR(1024) UNIQUE NOT NULL );",
+			"INSERT OR IGNORE INTO rss_feed_id (rssurl) "
+			"SELECT DISTINCT feedurl FROM rss_item;",
+			"ALTER TABLE rss_item ADD COLUMN feed_id INTEGER;",
+			"UPDATE rss_item SET feed_id = "
+			"(SELECT id FROM rss_feed_id WHERE rssurl = rss_item.feedurl);",
+
+			/* Older versions, which open the file too, only set feedurl */
+			"CREATE TRIGGER rss_item_feed_id_insert AFTER INSERT ON rss_item "
+			"WHEN new.feed_id IS NULL BEGIN "
+			" INSERT OR IGNORE INTO rss_feed_id (rssurl) VALUES (new.feedurl); "
+			" UPDATE rss_item SET feed_id = "
+			"  (SELECT id FROM rss_feed_id WHERE rssurl = new.feedurl) "
+			"  WHERE id = new.id; "
+			"END;",
+			"CREATE TRIGGER rss_item_feed_id_update "
+			"AFTER UPDATE OF feedurl ON rss_item "
+			"WHEN new.feed_id IS old.feed_id "
+			"AND new.feedurl IS NOT old.feedurl BEGIN "
+			" INSERT OR IGNORE INTO rss_feed_id (rssurl) VALUES (new.feedurl); "
+			" UPDATE rss_item SET feed_id = "
+			"  (SELECT id FROM rss_feed_id WHERE rssurl = new.feedurl) "
+			"  WHERE id = new.id; "
+			"END;",
+
+			"DROP INDEX IF EXISTS idx_feedurl;",
+			"DROP INDEX IF EXISTS idx_rss_item_feed_pubdate;",
+			"DROP INDEX IF EXISTS idx_rss_item_deleted_feedurl;",
+			"CREATE INDEX IF NOT EXISTS idx_rss_item_feed_id_pubdate ON "
+			"rss_item(feed_id, pubDate DESC, id DESC, guid, unread, flags, "
+			"deleted) "
+			"WHERE deleted = 0;",
+			"CREATE INDEX IF NOT EXISTS idx_rss_item_deleted_feed_id ON "
+			"rss_item(feed_id) WHERE deleted = 1;",
+
+			/* What filters and searches match an article's content
+			 * against: its text without the markup, see content_text().
+			 * It's NULL where that's the same as the content. The search
+			 * index is built from it; Cache::index_items_for_search()
+			 * fills it in for the articles stored before.
+			 */
+			"ALTER TABLE rss_item ADD COLUMN content_text;"
+		}
 	}
 
 	// Note: schema changes should use the version number of the release that introduced them.
 };
 
+/* A trigram index answers the same substring queries as `LIKE '%q%'`
+ * without scanning every article. It reads the text from rss_item, so the
+ * articles aren't stored twice. SQLite only has it if it was built with
+ * FTS5, so it isn't part of the schema patches; see
+ * Cache::set_up_search_index().
+ */
+static const std::vector<std::string> searchIndexTables{
+	"CREATE VIRTUAL TABLE IF NOT EXISTS rss_item_fts USING fts5("
+	" title, content, "
+	" content = 'rss_item', content_rowid = 'id', "
+	" tokenize = 'trigram' );",
+	/* What an earlier index held, if it was left behind by a SQLite
+	 * without FTS5 */
+	"INSERT INTO rss_item_fts(rss_item_fts) VALUES ('delete-all');",
+
+	/* Articles with ids in (indexed_up_to, backfill_end] predate the index
+	 * and are added to it in batches by Cache::index_items_for_search();
+	 * everything else is kept up to date by the triggers below.
+	 */
+	"DROP TABLE IF EXISTS search_index;",
+	"CREATE TABLE search_index ( "
+	" indexed_up_to INTEGER NOT NULL, "
+	" backfill_end INTEGER NOT NULL );",
+	"INSERT INTO search_index "
+	"SELECT 0, IFNULL(MAX(id), 0) FROM rss_item;",
+};
+
+static const std::vector<std::string> searchIndexTriggers{
+	"CREATE TRIGGER IF NOT EXISTS rss_item_fts_insert "
+	"AFTER INSERT ON rss_item "
+	"BEGIN "
+	" INSERT INTO rss_item_fts(rowid, title, content) "
+	" VALUES (new.id, new.title, IFNULL(new.content_text, "
+	"  newsboat_content(IFNULL( "
+	"  (SELECT content FROM rss_content WHERE id = new.content_id), "
+	"  new.content)))); "
+	"END;",
+
+	"CREATE TRIGGER IF NOT EXISTS rss_item_fts_delete "
+	"AFTER DELETE ON rss_item "
+	"WHEN old.id <= (SELECT indexed_up_to FROM search_index) "
+	" OR old.id > (SELECT backfill_end FROM search_index) "
+	"BEGIN "
+	" INSERT INTO rss_item_fts(rss_item_fts, rowid, title, content) "
+	" VALUES ('delete', old.id, old.title, IFNULL(old.content_text, "
+	"  newsboat_content(IFNULL( "
+	"  (SELECT content FROM rss_content WHERE id = old.content_id), "
+	"  old.content)))); "
+	"END;",
+
+	"CREATE TRIGGER IF NOT EXISTS rss_item_fts_update "
+	"AFTER UPDATE OF title, content, content_id, content_text "
+	"ON rss_item "
+	"WHEN (old.id <= (SELECT indexed_up_to FROM search_index) "
+	"  OR old.id > (SELECT backfill_end FROM search_index)) "
+	" AND (old.title IS NOT new.title "
+	"  OR old.content_id IS NOT new.content_id "
+	"  OR old.content_text IS NOT new.content_text "
+	"  OR newsboat_content(old.content) "
+	"   IS NOT newsboat_content(new.content)) "
+	"BEGIN "
+	" INSERT INTO rss_item_fts(rss_item_fts, rowid, title, content) "
+	" VALUES ('delete', old.id, old.title, IFNULL(old.content_text, "
+	"  newsboat_content(IFNULL( "
+	"  (SELECT content FROM rss_content WHERE id = old.content_id), "
+	"  old.content)))); "
+	" INSERT INTO rss_item_fts(rowid, title, content) "
+	" VALUES (new.id, new.title, IFNULL(new.content_text, "
+	"  newsboat_content(IFNULL( "
+	"  (SELECT content FROM rss_content WHERE id = new.content_id), "
+	"  new.content)))); "
+	"END;",
+};
+
 void Cache::populate_tables()
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 	const SchemaVersion version = get_schema_version();
 	LOG(Level::INFO,
 		"Cache::populate_tables: DB schema version %u.%u",
@@ -434,18 +1375,201 @@ void Cache::populate_tables()
 	}
 }
 
+void Cache::set_up_search_index()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	// Tried on a table of its own, since `CREATE VIRTUAL TABLE IF NOT
+	// EXISTS` succeeds for a table that's there even if its module isn't
+	char* errmsg = nullptr;
+	const bool fts5_available = sqlite3_exec(db,
+			"CREATE VIRTUAL TABLE temp.fts5_probe "
+			"USING fts5(x, tokenize = 'trigram');"
+			"DROP TABLE temp.fts5_probe;",
+			nullptr, nullptr, &errmsg) == SQLITE_OK;
+	if (!fts5_available) {
+		LOG(Level::ERROR,
+			"Cache::set_up_search_index: search index is unavailable, "
+			"searches scan the articles: %s",
+			errmsg != nullptr ? errmsg : "");
+	}
+	sqlite3_free(errmsg);
+
+	search_index_available = false;
+	search_index_ready = false;
+	try {
+		if (fts5_available) {
+			bool exists = false;
+			{
+				auto stmt = prepare_statement(
+						"SELECT COUNT(*) = 2 FROM sqlite_master "
+						"WHERE type = 'table' "
+						"AND name IN ('rss_item_fts', 'search_index');");
+				exists = stmt.step() && stmt.column_int(0) == 1;
+			}
+			if (!exists) {
+				LOG(Level::INFO,
+					"Cache::set_up_search_index: creating the search index");
+				for (const auto& query : searchIndexTables) {
+					run_sql(query);
+				}
+			}
+			for (const auto& query : searchIndexTriggers) {
+				run_sql(query);
+			}
+			auto stmt = prepare_statement(
+					"SELECT indexed_up_to >= backfill_end FROM search_index;");
+			search_index_ready = stmt.step() && stmt.column_int(0) == 1;
+			search_index_available = true;
+		}
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Cache::set_up_search_index: couldn't set up the search index: "
+			"%s",
+			e.what());
+	}
+
+	if (!search_index_available) {
+		// Triggers that refer to an index which isn't there would make
+		// storing articles fail. The index is built anew once it can be.
+		run_sql_nothrow("DROP TRIGGER IF EXISTS rss_item_fts_insert;");
+		run_sql_nothrow("DROP TRIGGER IF EXISTS rss_item_fts_delete;");
+		run_sql_nothrow("DROP TRIGGER IF EXISTS rss_item_fts_update;");
+		run_sql_nothrow("DROP TABLE IF EXISTS search_index;");
+		return;
+	}
+	LOG(Level::DEBUG,
+		"Cache::set_up_search_index: search index is %s",
+		search_index_ready ? "ready" : "incomplete");
+}
+
+bool Cache::use_search_index(const std::string& querystr) const
+{
+	return search_index_ready
+		&& count_codepoints(querystr) >= MIN_INDEXED_QUERY_LENGTH;
+}
+
+bool Cache::index_items_for_search(unsigned int batch_size)
+{
+	ScopeMeasure m1("Cache::index_items_for_search");
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	if (!search_index_available || search_index_ready) {
+		return true;
+	}
+
+	try {
+		ScopeTransaction transaction(*this);
+
+		int64_t indexed_up_to = 0;
+		int64_t backfill_end = 0;
+		{
+			auto stmt = prepare_statement(
+					"SELECT indexed_up_to, backfill_end FROM search_index;");
+			if (!stmt.step()) {
+				return true;
+			}
+			indexed_up_to = stmt.column_int(0);
+			backfill_end = stmt.column_int(1);
+		}
+
+		int64_t batch_end = backfill_end;
+		{
+			auto stmt = prepare_statement(
+					"SELECT MAX(id) FROM ("
+					" SELECT id FROM rss_item "
+					" WHERE id > ?1 AND id <= ?2 "
+					" ORDER BY id LIMIT ?3 );");
+			stmt.bind(1, indexed_up_to);
+			stmt.bind(2, backfill_end);
+			stmt.bind(3, static_cast<int64_t>(batch_size));
+			if (stmt.step() && !stmt.column_is_null(0)) {
+				batch_end = stmt.column_int(0);
+			}
+		}
+
+		// Articles stored before there was content_text get theirs here,
+		// before they're indexed by it
+		std::vector<std::pair<int64_t, std::string>> texts;
+		{
+			auto stmt = prepare_statement(
+					"SELECT id, " ITEM_CONTENT ", content_mime_type "
+					"FROM rss_item "
+					"WHERE id > ?1 AND id <= ?2 AND content_text IS NULL;");
+			stmt.bind(1, indexed_up_to);
+			stmt.bind(2, batch_end);
+			while (stmt.step()) {
+				const std::string content = stmt.column_string(1);
+				std::string text = content_text(content, stmt.column_string(2));
+				if (text != content) {
+					texts.emplace_back(stmt.column_int(0), std::move(text));
+				}
+			}
+		}
+		for (const auto& text : texts) {
+			auto stmt = prepare_statement(
+					"UPDATE rss_item SET content_text = ? WHERE id = ?;");
+			stmt.bind(1, text.second);
+			stmt.bind(2, text.first);
+			stmt.execute();
+		}
+
+		{
+			auto stmt = prepare_statement(
+					"INSERT INTO rss_item_fts(rowid, title, content) "
+					"SELECT id, title, " ITEM_TEXT " FROM rss_item "
+					"WHERE id > ?1 AND id <= ?2;");
+			stmt.bind(1, indexed_up_to);
+			stmt.bind(2, batch_end);
+			stmt.execute();
+		}
+		{
+			auto stmt = prepare_statement(
+					"UPDATE search_index SET indexed_up_to = ?;");
+			stmt.bind(1, batch_end);
+			stmt.execute();
+		}
+
+		LOG(Level::DEBUG,
+			"Cache::index_items_for_search: indexed articles up to id %"
+			PRId64 " of %" PRId64,
+			batch_end,
+			backfill_end);
+		search_index_ready = batch_end >= backfill_end;
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Cache::index_items_for_search: couldn't extend the search "
+			"index: %s",
+			e.what());
+		// Searches keep scanning the table; we'll retry on next start
+		return true;
+	}
+	return search_index_ready;
+}
+
 void Cache::fetch_lastmodified(const std::string& feedurl,
 	time_t& t,
 	std::string& etag)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::string query = prepare_query(
-			"SELECT lastmodified, etag FROM rss_feed WHERE rssurl = '%q';",
-			feedurl);
-	HeaderValues result = {0, ""};
-	run_sql(query, lastmodified_callback, &result);
-	t = result.lastmodified;
-	etag = result.etag;
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			const auto it = preloaded_validators.find(feedurl);
+			t = it != preloaded_validators.end() ? it->second.lastmodified : 0;
+			etag = it != preloaded_validators.end() ? it->second.etag : "";
+			return;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT lastmodified, etag FROM rss_feed WHERE rssurl = ?;");
+	stmt.bind(1, feedurl);
+	t = 0;
+	etag.clear();
+	if (stmt.step()) {
+		t = stmt.column_int(0);
+		etag = stmt.column_string(1);
+	}
 	LOG(Level::DEBUG,
 		"Cache::fetch_lastmodified: t = %" PRId64 " etag = %s",
 		// On GCC, `time_t` is `long int`, which is at least 32 bits. On
@@ -465,51 +1589,440 @@ void Cache::update_lastmodified(const std::string& feedurl,
 			"empty, not updating anything");
 		return;
 	}
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			auto& pending = pending_lastmodified[feedurl];
+			auto& preloaded = preloaded_validators[feedurl];
+			if (t > 0) {
+				pending.first = t;
+				preloaded.lastmodified = t;
+			}
+			if (etag.length() > 0) {
+				pending.second = etag;
+				preloaded.etag = etag;
+			}
+			return;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	write_lastmodified_unlocked(feedurl, t, etag);
+}
+
+void Cache::write_lastmodified_unlocked(const std::string& feedurl, time_t t,
+	const std::string& etag)
+{
 	std::string query = "UPDATE rss_feed SET ";
 	if (t > 0) {
-		query.append(prepare_query("lastmodified = '%d'", t));
+		query.append("lastmodified = ?");
 	}
 	if (etag.length() > 0) {
-		query.append(prepare_query("%c etag = %s",
-				(t > 0 ? ',' : ' '),
-				prepare_query("'%q'", etag)));
+		query.append(t > 0 ? ", etag = ?" : "etag = ?");
+	}
+	query.append(" WHERE rssurl = ?;");
+
+	try {
+		auto stmt = prepare_statement(query);
+		int index = 1;
+		if (t > 0) {
+			stmt.bind(index++, t);
+		}
+		if (etag.length() > 0) {
+			stmt.bind(index++, etag);
+		}
+		stmt.bind(index, feedurl);
+		stmt.execute();
+	} catch (const DbException&) {
+		// Already logged; failing to store the headers isn't fatal
+	}
+}
+
+std::uint64_t Cache::fetch_body_hash(const std::string& feedurl)
+{
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			const auto it = preloaded_validators.find(feedurl);
+			return it != preloaded_validators.end() ? it->second.body_hash : 0;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT body_hash FROM rss_feed WHERE rssurl = ?;");
+	stmt.bind(1, feedurl);
+	if (stmt.step()) {
+		return static_cast<std::uint64_t>(stmt.column_int(0));
+	}
+	return 0;
+}
+
+void Cache::update_body_hash(const std::string& feedurl, std::uint64_t hash)
+{
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			pending_body_hashes[feedurl] = hash;
+			preloaded_validators[feedurl].body_hash = hash;
+			return;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	write_body_hash_unlocked(feedurl, hash);
+}
+
+void Cache::write_body_hash_unlocked(const std::string& feedurl,
+	std::uint64_t hash)
+{
+	try {
+		auto stmt = prepare_statement(
+				"UPDATE rss_feed SET body_hash = ? WHERE rssurl = ?;");
+		// SQLite has no unsigned integers; the bits are stored as they are
+		stmt.bind(1, static_cast<std::int64_t>(hash));
+		stmt.bind(2, feedurl);
+		stmt.execute();
+	} catch (const DbException&) {
+		// Already logged; the feed is just parsed again next time
+	}
+}
+
+void Cache::fetch_moved_url(const std::string& feedurl, std::string& url,
+	time_t& since)
+{
+	url.clear();
+	since = 0;
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			const auto it = preloaded_validators.find(feedurl);
+			if (it != preloaded_validators.end()) {
+				url = it->second.moved_url;
+				since = it->second.moved_since;
+			}
+			return;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT moved_url, moved_since FROM rss_feed WHERE rssurl = ?;");
+	stmt.bind(1, feedurl);
+	if (stmt.step()) {
+		url = stmt.column_string(0);
+		since = stmt.column_int(1);
+	}
+}
+
+void Cache::update_moved_url(const std::string& feedurl,
+	const std::string& url, time_t since)
+{
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (validators_preloaded) {
+			pending_moved_urls[feedurl] = std::make_pair(url, since);
+			Validators& v = preloaded_validators[feedurl];
+			v.moved_url = url;
+			v.moved_since = url.empty() ? 0 : since;
+			return;
+		}
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	write_moved_url_unlocked(feedurl, url, since);
+}
+
+void Cache::write_moved_url_unlocked(const std::string& feedurl,
+	const std::string& url, time_t since)
+{
+	try {
+		auto stmt = prepare_statement(
+				"UPDATE rss_feed SET moved_url = ?, moved_since = ? "
+				"WHERE rssurl = ?;");
+		stmt.bind(1, url);
+		stmt.bind(2, static_cast<std::int64_t>(url.empty() ? 0 : since));
+		stmt.bind(3, feedurl);
+		stmt.execute();
+	} catch (const DbException&) {
+		// Already logged; the feed is just fetched through the redirect
 	}
-	query.append(" WHERE rssurl = ");
-	query.append(prepare_query("'%q'", feedurl));
-	run_sql_nothrow(query);
+}
+
+void Cache::preload_validators()
+{
+	std::unordered_map<std::string, Validators> validators;
+	{
+		std::lock_guard<CacheMutex> lock(mtx);
+		auto stmt = prepare_statement(
+				"SELECT rssurl, lastmodified, etag, body_hash, moved_url, "
+				"moved_since FROM rss_feed;");
+		while (stmt.step()) {
+			Validators& v = validators[stmt.column_string(0)];
+			v.lastmodified = stmt.column_int(1);
+			v.etag = stmt.column_string(2);
+			v.body_hash = static_cast<std::uint64_t>(stmt.column_int(3));
+			v.moved_url = stmt.column_string(4);
+			v.moved_since = stmt.column_int(5);
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(validators_mtx);
+	preloaded_validators = std::move(validators);
+	validators_preloaded = true;
+	LOG(Level::DEBUG, "Cache::preload_validators: read them for %" PRIu64
+		" feed(s)", static_cast<uint64_t>(preloaded_validators.size()));
+}
+
+void Cache::flush_validators()
+{
+	std::unordered_map<std::string, std::pair<time_t, std::string>> lastmodified;
+	std::unordered_map<std::string, std::uint64_t> body_hashes;
+	std::unordered_map<std::string, std::pair<std::string, time_t>> moved_urls;
+	{
+		std::lock_guard<std::mutex> guard(validators_mtx);
+		if (!validators_preloaded) {
+			return;
+		}
+		lastmodified.swap(pending_lastmodified);
+		body_hashes.swap(pending_body_hashes);
+		moved_urls.swap(pending_moved_urls);
+		preloaded_validators.clear();
+		validators_preloaded = false;
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		ScopeTransaction transaction(*this);
+		for (const auto& update : lastmodified) {
+			write_lastmodified_unlocked(update.first, update.second.first,
+				update.second.second);
+		}
+		for (const auto& update : body_hashes) {
+			write_body_hash_unlocked(update.first, update.second);
+		}
+		for (const auto& update : moved_urls) {
+			write_moved_url_unlocked(update.first, update.second.first,
+				update.second.second);
+		}
+	} catch (const DbException&) {
+		// Already logged; the feeds are just downloaded again next time
+	}
+	LOG(Level::DEBUG, "Cache::flush_validators: wrote %" PRIu64
+		" Last-Modified/ETag and %" PRIu64 " body hash update(s)",
+		static_cast<uint64_t>(lastmodified.size()),
+		static_cast<uint64_t>(body_hashes.size()));
+}
+
+std::unordered_map<std::string, std::int64_t> Cache::fetch_download_times()
+{
+	std::unordered_map<std::string, std::int64_t> times;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT rssurl, download_time FROM rss_feed "
+			"WHERE download_time > 0;");
+	while (stmt.step()) {
+		times[stmt.column_string(0)] = stmt.column_int(1);
+	}
+	return times;
+}
+
+std::unordered_map<std::string, std::int64_t> Cache::fetch_read_counts(
+	time_t since)
+{
+	std::unordered_map<std::string, std::int64_t> counts;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT feedurl, COUNT(*) FROM rss_item "
+			"WHERE unread = 0 AND deleted = 0 AND pubDate >= ? "
+			"GROUP BY feedurl;");
+	stmt.bind(1, static_cast<std::int64_t>(since));
+	while (stmt.step()) {
+		counts[stmt.column_string(0)] = stmt.column_int(1);
+	}
+	return counts;
+}
+
+std::unordered_map<std::string, std::vector<std::string>>
+Cache::fetch_unread_guids()
+{
+	std::unordered_map<std::string, std::vector<std::string>> guids;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT feedurl, guid FROM rss_item "
+			"WHERE unread = 1 AND deleted = 0;");
+	while (stmt.step()) {
+		guids[stmt.column_string(0)].push_back(stmt.column_string(1));
+	}
+	return guids;
+}
+
+void Cache::update_download_times(
+	const std::unordered_map<std::string, std::int64_t>& times)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		ScopeTransaction transaction(*this);
+		for (const auto& time : times) {
+			// Average with the previous time, so that a single slow reload
+			// doesn't push the feed to the front for good
+			auto stmt = prepare_statement(
+					"UPDATE rss_feed SET download_time = CASE "
+					" WHEN download_time = 0 THEN ?1 "
+					" ELSE (download_time + ?1) / 2 END "
+					"WHERE rssurl = ?2;");
+			stmt.bind(1, std::max<std::int64_t>(time.second, 1));
+			stmt.bind(2, time.first);
+			stmt.execute();
+		}
+	} catch (const DbException&) {
+		// Already logged; the feeds just get reloaded in the old order
+	}
+}
+
+std::unordered_map<std::string, time_t> Cache::fetch_next_checks()
+{
+	std::unordered_map<std::string, time_t> next_checks;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT rssurl, next_check FROM rss_feed "
+			"WHERE next_check > 0;");
+	while (stmt.step()) {
+		next_checks[stmt.column_string(0)] = stmt.column_int(1);
+	}
+	return next_checks;
+}
+
+void Cache::update_next_checks(
+	const std::unordered_map<std::string, time_t>& next_checks)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		ScopeTransaction transaction(*this);
+		for (const auto& next_check : next_checks) {
+			auto stmt = prepare_statement(
+					"UPDATE rss_feed SET next_check = ? WHERE rssurl = ?;");
+			stmt.bind(1, static_cast<std::int64_t>(next_check.second));
+			stmt.bind(2, next_check.first);
+			stmt.execute();
+		}
+	} catch (const DbException&) {
+		// Already logged; the feeds just get checked on the next reload
+	}
+}
+
+std::unordered_map<std::string, FeedFailures> Cache::fetch_failures()
+{
+	std::unordered_map<std::string, FeedFailures> failures;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT rssurl, failures, retry_at, gone FROM rss_feed "
+			"WHERE failures > 0 OR gone = 1;");
+	while (stmt.step()) {
+		FeedFailures& feed = failures[stmt.column_string(0)];
+		feed.count = stmt.column_int(1);
+		feed.retry_at = stmt.column_int(2);
+		feed.gone = stmt.column_int(3) != 0;
+	}
+	return failures;
+}
+
+void Cache::update_failures(
+	const std::unordered_map<std::string, FeedFailures>& failures)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		ScopeTransaction transaction(*this);
+		for (const auto& feed : failures) {
+			auto stmt = prepare_statement(
+					"UPDATE rss_feed SET failures = ?, retry_at = ?, gone = ? "
+					"WHERE rssurl = ?;");
+			stmt.bind(1, static_cast<std::int64_t>(feed.second.count));
+			stmt.bind(2, static_cast<std::int64_t>(feed.second.retry_at));
+			stmt.bind(3, static_cast<std::int64_t>(feed.second.gone ? 1 : 0));
+			stmt.bind(4, feed.first);
+			stmt.execute();
+		}
+	} catch (const DbException&) {
+		// Already logged; the feeds are just tried again on the next reload
+	}
+}
+
+time_t Cache::estimate_update_interval(const std::string& feedurl)
+{
+	// Enough articles to even out a burst of posts, few enough to follow a
+	// feed that changed its pace
+	const int articles = 10;
+
+	std::vector<std::int64_t> dates;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT pubDate FROM rss_item "
+			"WHERE feed_id = ? AND deleted = 0 "
+			"ORDER BY pubDate DESC LIMIT ?;");
+	stmt.bind(1, find_feed_id(reader, feedurl));
+	stmt.bind(2, articles);
+	while (stmt.step()) {
+		dates.push_back(stmt.column_int(0));
+	}
+	if (dates.size() < 2) {
+		return 0;
+	}
+	return static_cast<time_t>((dates.front() - dates.back())
+			/ static_cast<std::int64_t>(dates.size() - 1));
 }
 
 void Cache::mark_item_deleted(const std::string& guid, bool b)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::string query = prepare_query(
-			"UPDATE rss_item SET deleted = %u WHERE guid = '%q'",
-			b ? 1 : 0,
-			guid);
-	run_sql_nothrow(query);
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		auto stmt = prepare_statement(
+				"UPDATE rss_item SET deleted = ? WHERE guid = ?;");
+		stmt.bind(1, b ? 1 : 0);
+		stmt.bind(2, guid);
+		stmt.execute();
+	} catch (const DbException&) {
+		// Already logged
+	}
+}
+
+void Cache::mark_item_deleted(const RssItem& item, bool b)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		auto stmt = prepare_statement(item.row_id() != 0
+				? "UPDATE rss_item SET deleted = ?1 WHERE id = ?2;"
+				: "UPDATE rss_item SET deleted = ?1 WHERE guid = ?2;");
+		stmt.bind(1, b ? 1 : 0);
+		bind_item_row(stmt, 2, item);
+		stmt.execute();
+	} catch (const DbException&) {
+		// Already logged
+	}
 }
 
 // this function writes an RssFeed including all RssItems to the database
-void Cache::externalize_rssfeed(std::shared_ptr<RssFeed> feed,
-	bool reset_unread)
+unsigned int Cache::externalize_rssfeed(std::shared_ptr<RssFeed> feed,
+	bool reset_unread, ItemChanges* changes)
 {
 	ScopeMeasure m1("Cache::externalize_feed");
 	if (feed->is_query_feed()) {
-		return;
+		return 0;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::lock_guard<std::mutex> feedlock(feed->item_mutex);
-	// scope_transaction dbtrans(db);
+	std::lock_guard<CacheMutex> lock(mtx);
+	std::lock_guard<SharedMutex> feedlock(feed->item_mutex);
+	ScopeTransaction dbtrans(*this);
 
-	CbHandler count_cbh;
-	auto query = prepare_query(
-			"SELECT count(*) FROM rss_feed WHERE rssurl = '%q';",
-			feed->rssurl());
-	run_sql(query, count_callback, &count_cbh);
-
-	const int count = count_cbh.count();
+	int count = -1;
+	{
+		auto stmt = prepare_statement(
+				"SELECT count(*) FROM rss_feed WHERE rssurl = ?;");
+		stmt.bind(1, feed->rssurl());
+		if (stmt.step()) {
+			count = stmt.column_int(0);
+		}
+	}
 	LOG(Level::DEBUG,
 		"Cache::externalize_rss_feed: rss_feeds with rssurl = '%s': "
 		"found "
@@ -517,27 +2030,27 @@ void Cache::externalize_rssfeed(std::shared_ptr<RssFeed> feed,
 		feed->rssurl(),
 		count);
 	if (count > 0) {
-		const std::string updatequery = prepare_query(
+		auto update = prepare_statement(
 				"UPDATE rss_feed "
-				"SET title = '%q', url = '%q', is_rtl = %u "
-				"WHERE rssurl = '%q';",
-				feed->title_raw(),
-				feed->link(),
-				feed->is_rtl() ? 1 : 0,
-				feed->rssurl());
-		run_sql(updatequery);
+				"SET title = ?, url = ?, is_rtl = ? "
+				"WHERE rssurl = ?;");
+		update.bind(1, feed->title_raw());
+		update.bind(2, feed->link());
+		update.bind(3, feed->is_rtl() ? 1 : 0);
+		update.bind(4, feed->rssurl());
+		update.execute();
 	} else {
-		const std::string insertquery = prepare_query(
+		auto insert = prepare_statement(
 				"INSERT INTO rss_feed (rssurl, url, title, is_rtl) "
-				"VALUES ( '%q', '%q', '%q', %u );",
-				feed->rssurl(),
-				feed->link(),
-				feed->title_raw(),
-				feed->is_rtl() ? 1 : 0);
-		run_sql(insertquery);
+				"VALUES (?, ?, ?, ?);");
+		insert.bind(1, feed->rssurl());
+		insert.bind(2, feed->link());
+		insert.bind(3, feed->title_raw());
+		insert.bind(4, feed->is_rtl() ? 1 : 0);
+		insert.execute();
 	}
 
-	const unsigned int max_items = cfg->get_configvalue_as_int("max-items");
+	const unsigned int max_items = cfg->snapshot().max_items;
 
 	LOG(Level::INFO,
 		"Cache::externalize_feed: max_items = %u "
@@ -551,17 +2064,23 @@ void Cache::externalize_rssfeed(std::shared_ptr<RssFeed> feed,
 			feed->items().begin() + max_items, feed->items().end());
 	}
 
-	const unsigned int days = cfg->get_configvalue_as_int("keep-articles-days");
+	const unsigned int days = cfg->snapshot().keep_articles_days;
 	const time_t old_time = time(nullptr) - days * 24 * 60 * 60;
 
+	load_known_guids();
+
 	// the reverse iterator is there for the sorting foo below (think about
 	// it)
+	unsigned int added = 0;
 	for (auto it = feed->items().rbegin(); it != feed->items().rend();
 		++it) {
-		if (days == 0 || (*it)->pubDate_timestamp() >= old_time)
-			update_rssitem_unlocked(
-				*it, feed->rssurl(), reset_unread);
+		if ((days == 0 || (*it)->pubDate_timestamp() >= old_time)
+			&& update_rssitem_unlocked(*it, feed->rssurl(), reset_unread,
+				changes)) {
+			++added;
+		}
 	}
+	return added;
 }
 
 // this function reads an RssFeed including all of its RssItems.
@@ -577,68 +2096,313 @@ std::shared_ptr<RssFeed> Cache::internalize_rssfeed(std::string rssurl,
 		return feed;
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::lock_guard<std::mutex> feedlock(feed->item_mutex);
+	std::lock_guard<SharedMutex> feedlock(feed->item_mutex);
+
+	{
+		ReadLease reader(*this);
+
+		/* first, we read the feed from the database, if it's there at all */
+		auto stmt = reader.prepare_statement(
+				"SELECT title, url, is_rtl FROM rss_feed WHERE rssurl = ?;");
+		stmt.bind(1, rssurl);
+		if (!stmt.step()) {
+			return feed;
+		}
+		feed->set_title(stmt.column_string(0));
+		feed->set_link(stmt.column_string(1));
+		feed->set_rtl(stmt.column_int(2) == 1);
+		LOG(Level::INFO,
+			"Cache::internalize_rssfeed: title = %s link = %s is_rtl = %s",
+			feed->title_raw(),
+			feed->link(),
+			stmt.column_string(2));
+
+		/* ...and then the associated items */
+		auto items_stmt = reader.prepare_statement(
+				"SELECT guid, title, author, url, pubDate, " ITEM_CONTENT_LENGTH ", "
+				"unread, "
+				"feedurl, enclosure_url, enclosure_type, enqueued, flags, base, "
+				"rss_item.id "
+				"FROM rss_item "
+				"WHERE feed_id = ? "
+				"AND deleted = 0 "
+				"ORDER BY pubDate DESC, id DESC;");
+		items_stmt.bind(1, find_feed_id(reader, rssurl));
+		while (items_stmt.step()) {
+			feed->add_item(item_from_row(items_stmt));
+		}
+	}
 
-	/* first, we check whether the feed is there at all */
-	std::string query = prepare_query(
-			"SELECT count(*) FROM rss_feed WHERE rssurl = '%q';", rssurl);
-	CbHandler count_cbh;
-	run_sql(query, count_callback, &count_cbh);
+	finish_internalized_feed(feed, ign);
+	return feed;
+}
 
-	if (count_cbh.count() == 0) {
-		return feed;
+std::shared_ptr<RssFeed> Cache::merge_rssfeed(
+	const std::shared_ptr<RssFeed>& oldfeed,
+	std::shared_ptr<RssFeed> newfeed,
+	bool reset_unread,
+	RssIgnores* ign,
+	unsigned int* added,
+	ItemChanges* changes)
+{
+	ScopeMeasure m1("Cache::merge_rssfeed");
+
+	const std::string rssurl = oldfeed->rssurl();
+	if (newfeed->is_query_feed() || !oldfeed->items_loaded()) {
+		const unsigned int stored = externalize_rssfeed(newfeed, reset_unread,
+				changes);
+		if (added != nullptr) {
+			*added = stored;
+		}
+		return internalize_rssfeed(rssurl, ign);
+	}
+
+	std::lock_guard<CacheMutex> lock(mtx);
+
+	std::vector<std::shared_ptr<RssItem>> old_items;
+	std::unordered_map<std::string, std::shared_ptr<RssItem>> old_by_guid;
+	{
+		const auto oldlock = oldfeed->lock_items_for_reading();
+		old_items = oldfeed->items();
+	}
+	for (const auto& item : old_items) {
+		old_by_guid[item->guid()] = item;
+	}
+
+	// Has to be known before the new contents are stored
+	std::unordered_set<std::string> changed_contents;
+	if (reset_unread) {
+		const auto newlock = newfeed->lock_items_for_reading();
+		for (const auto& item : newfeed->items()) {
+			const auto old = old_by_guid.find(item->guid());
+			if (old != old_by_guid.end()
+				&& old->second->description().text != item->description().text) {
+				changed_contents.insert(item->guid());
+			}
+		}
+	}
+
+	ScopeTransaction dbtrans(*this);
+	const unsigned int new_articles = externalize_rssfeed(newfeed,
+			reset_unread, changes);
+	if (added != nullptr) {
+		*added = new_articles;
+	}
+	m1.stopover("storing");
+
+	std::shared_ptr<RssFeed> feed(new RssFeed(this, rssurl));
+	std::lock_guard<SharedMutex> feedlock(feed->item_mutex);
+	feed->set_title(newfeed->title_raw());
+	feed->set_link(newfeed->link());
+	feed->set_rtl(newfeed->is_rtl());
+
+	const unsigned int days = cfg->snapshot().keep_articles_days;
+	const time_t old_time = time(nullptr) - days * 24 * 60 * 60;
+
+	// The articles that were just stored, with what the database keeps of
+	// their old versions: pubDate, flags and the enqueued and unread flags
+	std::vector<std::shared_ptr<RssItem>> stored;
+	std::unordered_set<std::string> stored_guids;
+	{
+		std::lock_guard<SharedMutex> newlock(newfeed->item_mutex);
+		for (const auto& item : newfeed->items()) {
+			if ((days != 0 && item->pubDate_timestamp() < old_time)
+				|| !stored_guids.insert(item->guid()).second) {
+				continue;
+			}
+
+			const auto description = item->description();
+			const unsigned int size = count_codepoints(description.text);
+			const auto old = old_by_guid.find(item->guid());
+			if (old != old_by_guid.end() && !old->second->deleted()
+				&& same_listing(*old->second, *item)) {
+				// The article itself is reused, so that the lists and query
+				// feeds that hold it keep pointing at it. Only what has a
+				// lock of its own, or didn't change, is written.
+				const auto& existing = old->second;
+				if (existing->size() != size) {
+					existing->set_size(size);
+				}
+				const bool unread = item->override_unread() ? item->unread()
+					: existing->unread() || changed_contents.count(item->guid()) > 0;
+				if (existing->unread() != unread) {
+					existing->set_unread_nowrite(unread);
+					if (changes != nullptr) {
+						changes->push_back({item->guid(), rssurl,
+								ItemChange::Kind::UNREAD});
+					}
+				}
+				existing->set_description_from_cache(description.text,
+					description.mime);
+				stored.push_back(existing);
+				continue;
+			}
+
+			auto copy = copy_stored_item(*item);
+			copy->set_feedurl(rssurl);
+			copy->set_size(size);
+			if (old != old_by_guid.end()) {
+				if (old->second->deleted()) {
+					continue;
+				}
+				copy->set_pubDate(old->second->pubDate_timestamp());
+				if (copy->row_id() == 0) {
+					copy->set_row_id(old->second->row_id());
+				}
+				copy->set_flags(old->second->flags());
+				copy->set_enqueued(old->second->enqueued());
+				if (!item->override_unread()) {
+					copy->set_unread_nowrite(old->second->unread()
+						|| changed_contents.count(item->guid()) > 0);
+				}
+				if (changes != nullptr
+					&& copy->unread() != old->second->unread()) {
+					changes->push_back({item->guid(), rssurl,
+							ItemChange::Kind::UNREAD});
+				}
+			} else {
+				auto stmt = prepare_statement(
+						"SELECT pubDate, unread, enqueued, flags, deleted, id "
+						"FROM rss_item WHERE guid = ?;");
+				stmt.bind(1, item->guid());
+				if (!stmt.step() || stmt.column_int(4) != 0) {
+					continue;
+				}
+				copy->set_row_id(stmt.column_int(5));
+				copy->set_pubDate(stmt.column_int(0));
+				copy->set_unread_nowrite(stmt.column_int(1) == 1);
+				copy->set_enqueued(stmt.column_int(2) == 1);
+				copy->set_flags(stmt.column_string(3));
+			}
+			copy->set_description_from_cache(description.text, description.mime);
+			stored.push_back(copy);
+		}
+	}
+	m1.stopover("merging new articles");
+
+	// The articles that are still around were checked against the rules
+	// when they were read
+	if (ign != nullptr) {
+		remove_ignored_items(stored, *ign);
+	}
+	for (const auto& item : old_items) {
+		if (!item->deleted() && stored_guids.count(item->guid()) == 0) {
+			stored.push_back(item);
+		}
 	}
 
-	/* then we first read the feed from the database */
-	query = prepare_query(
-			"SELECT title, url, is_rtl FROM rss_feed WHERE rssurl = '%q';",
-			rssurl);
-	run_sql(query, rssfeed_callback, &feed);
-
-	/* ...and then the associated items */
-	query = prepare_query(
-			"SELECT guid, title, author, url, pubDate, length(content), "
-			"unread, "
-			"feedurl, enclosure_url, enclosure_type, enqueued, flags, base "
-			"FROM rss_item "
-			"WHERE feedurl = '%q' "
-			"AND deleted = 0 "
-			"ORDER BY pubDate DESC, id DESC;",
-			rssurl);
-	run_sql(query, rssitem_callback, &feed);
+	// That's the order finish_internalized_feed() expects; the articles
+	// that were just inserted have the highest ids, so they win ties
+	std::stable_sort(stored.begin(), stored.end(),
+	[](const std::shared_ptr<RssItem>& a, const std::shared_ptr<RssItem>& b) {
+		return a->pubDate_timestamp() > b->pubDate_timestamp();
+	});
+	feed->add_items(stored);
+	finish_internalized_feed(feed, nullptr);
+	return feed;
+}
+
+void Cache::internalize_rssfeeds(
+	const std::vector<std::shared_ptr<RssFeed>>& feeds,
+	RssIgnores* ign,
+	const std::function<void()>& feed_done)
+{
+	ScopeMeasure m1("Cache::internalize_rssfeeds");
+
+	std::unordered_map<std::string, std::vector<RssFeed*>> feeds_by_url;
+	for (const auto& feed : feeds) {
+		if (!utils::is_query_url(feed->rssurl())) {
+			feeds_by_url[feed->rssurl()].push_back(feed.get());
+		}
+	}
 
+	{
+		ReadLease reader(*this);
+
+		auto stmt = reader.prepare_statement(
+				"SELECT rssurl, title, url, is_rtl FROM rss_feed;");
+		while (stmt.step()) {
+			const auto it = feeds_by_url.find(stmt.column_string(0));
+			if (it == feeds_by_url.end()) {
+				continue;
+			}
+			for (const auto feed : it->second) {
+				feed->set_title(stmt.column_string(1));
+				feed->set_link(stmt.column_string(2));
+				feed->set_rtl(stmt.column_int(3) == 1);
+			}
+		}
+		m1.stopover("reading feeds");
+
+		// Rows come grouped by feed, so we only look the feed up when
+		// a new group starts
+		auto items_stmt = reader.prepare_statement(
+				"SELECT guid, title, author, url, pubDate, " ITEM_CONTENT_LENGTH ", "
+				"unread, "
+				"feedurl, enclosure_url, enclosure_type, enqueued, flags, base, "
+				"rss_item.id "
+				"FROM rss_item "
+				"WHERE deleted = 0 "
+				"ORDER BY feed_id, pubDate DESC, id DESC;");
+		bool in_group = false;
+		std::string current_url;
+		const std::vector<RssFeed*>* current_feeds = nullptr;
+		while (items_stmt.step()) {
+			const std::string feedurl = items_stmt.column_string(7);
+			if (!in_group || feedurl != current_url) {
+				in_group = true;
+				current_url = feedurl;
+				const auto it = feeds_by_url.find(feedurl);
+				current_feeds =
+					(it == feeds_by_url.end()) ? nullptr : &it->second;
+			}
+			if (current_feeds == nullptr) {
+				// Feed isn't in the urls file anymore
+				continue;
+			}
+			for (const auto feed : *current_feeds) {
+				feed->add_item(item_from_row(items_stmt));
+			}
+		}
+		m1.stopover("reading items");
+	}
+
+	for (const auto& feed : feeds) {
+		if (!utils::is_query_url(feed->rssurl())) {
+			std::lock_guard<SharedMutex> feedlock(feed->item_mutex);
+			finish_internalized_feed(feed, ign);
+		}
+		if (feed_done) {
+			feed_done();
+		}
+	}
+}
+
+void Cache::finish_internalized_feed(const std::shared_ptr<RssFeed>& feed,
+	RssIgnores* ign)
+{
 	auto feed_weak_ptr = std::weak_ptr<RssFeed>(feed);
 	for (const auto& item : feed->items()) {
 		item->set_cache(this);
 		item->set_feedptr(feed_weak_ptr);
-		item->set_feedurl(feed->rssurl());
+		// Articles that merge_rssfeed() reused may be read by other threads
+		if (item->feedurl() != feed->rssurl()) {
+			item->set_feedurl(feed->rssurl());
+		}
 	}
 
 	if (ign != nullptr) {
-		auto& items = feed->items();
-		items.erase(
-			std::remove_if(
-				items.begin(),
-				items.end(),
-		[&](std::shared_ptr<RssItem> item) -> bool {
-			try
-			{
-				return ign->matches(item.get());
-			} catch (const MatcherException& ex)
-			{
-				LOG(Level::DEBUG,
-					"oops, Matcher exception: %s",
-					ex.what());
-				return false;
-			}
-		}),
-		items.end());
+		auto items = feed->items();
+		remove_ignored_items(items, *ign);
+		if (items.size() != feed->total_item_count()) {
+			feed->set_items(items);
+		}
 	}
 
-	const unsigned int max_items = cfg->get_configvalue_as_int("max-items");
+	const unsigned int max_items = cfg->snapshot().max_items;
 
 	if (max_items > 0 && feed->total_item_count() > max_items) {
+		std::lock_guard<CacheMutex> lock(mtx);
 		std::vector<std::shared_ptr<RssItem>> flagged_items;
 		for (unsigned int j = max_items; j < feed->total_item_count();
 			++j) {
@@ -649,116 +2413,608 @@ std::shared_ptr<RssFeed> Cache::internalize_rssfeed(std::string rssurl,
 			}
 		}
 
-		auto it = feed->items().begin() + max_items;
-		feed->erase_items(
-			it, feed->items().end()); // delete old entries
+		auto it = feed->items().begin() + max_items;
+		feed->erase_items(
+			it, feed->items().end()); // delete old entries
+
+		// if some flagged articles were saved, append them
+		feed->add_items(flagged_items);
+	}
+	feed->sort_unlocked(cfg->get_article_sort_strategy());
+}
+
+std::shared_ptr<RssFeed> Cache::internalize_rssfeed_lazily(
+	const std::string& rssurl)
+{
+	ScopeMeasure m1("Cache::internalize_rssfeed_lazily");
+
+	std::shared_ptr<RssFeed> feed(new RssFeed(this, rssurl));
+
+	if (utils::is_query_url(rssurl)) {
+		return feed;
+	}
+
+	std::vector<ItemSummary> summaries;
+	{
+		ReadLease reader(*this);
+
+		auto stmt = reader.prepare_statement(
+				"SELECT title, url, is_rtl FROM rss_feed WHERE rssurl = ?;");
+		stmt.bind(1, rssurl);
+		if (!stmt.step()) {
+			return feed;
+		}
+		feed->set_title(stmt.column_string(0));
+		feed->set_link(stmt.column_string(1));
+		feed->set_rtl(stmt.column_int(2) == 1);
+
+		auto items_stmt = reader.prepare_statement(
+				"SELECT guid, pubDate, unread, flags "
+				"FROM rss_item "
+				"WHERE feed_id = ? "
+				"AND deleted = 0 "
+				"ORDER BY pubDate DESC, id DESC;");
+		items_stmt.bind(1, find_feed_id(reader, rssurl));
+		while (items_stmt.step()) {
+			ItemSummary summary;
+			summary.guid = items_stmt.column_string(0);
+			summary.pubDate = items_stmt.column_int(1);
+			summary.unread = items_stmt.column_int(2) == 1;
+			summary.flags = items_stmt.column_string(3);
+			summaries.push_back(std::move(summary));
+		}
+	}
+
+	trim_item_summaries(summaries);
+
+	LOG(Level::DEBUG,
+		"Cache::internalize_rssfeed_lazily: %s has %" PRIu64 " item(s)",
+		rssurl,
+		static_cast<uint64_t>(summaries.size()));
+	feed->set_item_summaries(std::move(summaries));
+	return feed;
+}
+
+void Cache::trim_item_summaries(std::vector<ItemSummary>& summaries)
+{
+	const unsigned int days = cfg->snapshot().keep_articles_days;
+	if (days > 0) {
+		const time_t old_date = time(nullptr) - days * 24 * 60 * 60;
+		summaries.erase(std::remove_if(summaries.begin(), summaries.end(),
+		[old_date](const ItemSummary& summary) {
+			return summary.pubDate < old_date;
+		}), summaries.end());
+	}
+
+	// Same trimming as in internalize_rssfeed(), so that the items loaded
+	// later on match the summaries
+	const unsigned int max_items = cfg->snapshot().max_items;
+	if (max_items > 0 && summaries.size() > max_items) {
+		std::lock_guard<CacheMutex> lock(mtx);
+		auto it = summaries.begin() + max_items;
+		while (it != summaries.end()) {
+			if (it->flags.empty()) {
+				delete_item_unlocked(it->guid);
+				it = summaries.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+void Cache::fetch_items(RssFeed& feed, bool unread_only,
+	const std::unordered_set<std::string>* loaded)
+{
+	ScopeMeasure m1("Cache::fetch_items");
+
+	const auto feed_ptr = feed.shared_from_this();
+	{
+		ReadLease reader(*this);
+		auto stmt = reader.prepare_statement(
+				"SELECT guid, title, author, url, pubDate, " ITEM_CONTENT_LENGTH ", "
+				"unread, "
+				"feedurl, enclosure_url, enclosure_type, enqueued, flags, base, "
+				"rss_item.id "
+				"FROM rss_item "
+				"WHERE feed_id = ? "
+				"AND deleted = 0 "
+				+ std::string(unread_only ?
+					"AND (unread = 1 OR IFNULL(flags, '') != '') " : "") +
+				"ORDER BY pubDate DESC, id DESC;");
+		stmt.bind(1, find_feed_id(reader, feed.rssurl()));
+		while (stmt.step()) {
+			if (loaded != nullptr && loaded->count(stmt.column_string(0)) > 0) {
+				continue;
+			}
+			auto item = item_from_row(stmt);
+			item->set_cache(this);
+			item->set_feedptr(feed_ptr);
+			item->set_feedurl(feed.rssurl());
+			feed.add_item(item);
+		}
+	}
+	feed.sort_unlocked(cfg->get_article_sort_strategy());
+}
+
+std::vector<std::shared_ptr<RssItem>> Cache::search_for_items(
+		const std::string& querystr, const std::string& feedurl,
+		RssIgnores& ign, const JobProgress* progress)
+{
+	assert(!utils::is_query_url(feedurl));
+	std::vector<std::shared_ptr<RssItem>> items;
+
+	// Leave out what the ignore rules can rule out in SQL; the rest of the
+	// rules are applied below
+	const std::string not_ignored = not_ignored_condition(ign);
+
+	if (use_search_index(querystr)) {
+		ReadLease reader(*this);
+		auto stmt = reader.prepare_statement(
+				"SELECT rss_item.guid, rss_item.title, author, url, pubDate, "
+				ITEM_CONTENT_LENGTH ", "
+				"unread, feedurl, enclosure_url, enclosure_type, "
+				"enqueued, flags, base, rss_item.id "
+				"FROM rss_item_fts "
+				"JOIN rss_item ON rss_item.id = rss_item_fts.rowid "
+				"WHERE rss_item_fts MATCH ?1 "
+				+ std::string(feedurl.length() > 0 ? "AND feed_id = ?2 " : "")
+				+ not_ignored +
+				"AND deleted = 0 "
+				"ORDER BY rank;");
+		const InterruptOnCancel interrupt(reader.connection(), progress);
+		stmt.bind(1, search_index_phrase(querystr));
+		if (feedurl.length() > 0) {
+			stmt.bind(2, find_feed_id(reader, feedurl));
+		}
+		while (stmt.step()) {
+			items.push_back(item_from_row(stmt));
+		}
+	} else {
+		ReadLease reader(*this);
+		auto stmt = reader.prepare_statement(
+				"SELECT guid, title, author, url, pubDate, "
+				ITEM_CONTENT_LENGTH ", "
+				"unread, feedurl, enclosure_url, enclosure_type, "
+				"enqueued, flags, base, rss_item.id "
+				"FROM rss_item "
+				"WHERE (title LIKE '%' || ?1 || '%' OR " ITEM_TEXT " LIKE '%' || ?1 || '%') "
+				+ std::string(feedurl.length() > 0 ? "AND feed_id = ?2 " : "")
+				+ not_ignored +
+				"AND deleted = 0 "
+				"ORDER BY pubDate DESC, id DESC;");
+		const InterruptOnCancel interrupt(reader.connection(), progress);
+		stmt.bind(1, querystr);
+		if (feedurl.length() > 0) {
+			stmt.bind(2, find_feed_id(reader, feedurl));
+		}
+		while (stmt.step()) {
+			items.push_back(item_from_row(stmt));
+		}
+	}
+	for (const auto& item : items) {
+		item->set_cache(this);
+	}
+	remove_ignored_items(items, ign);
+
+	return items;
+}
+
+std::string Cache::not_ignored_condition(RssIgnores& ign)
+{
+	std::string result;
+	for (const auto& rule : ign.sql_conditions()) {
+		if (rule.first == "*") {
+			result += "AND NOT " + rule.second + " ";
+		} else {
+			result += prepare_query("AND NOT (rss_item.feed_id IS "
+					"(SELECT id FROM rss_feed_id WHERE rssurl = %Q) AND ",
+					rule.first) + rule.second + ") ";
+		}
+	}
+	return result;
+}
+
+std::unordered_set<std::string> Cache::search_in_items(
+	const std::string& querystr,
+	const std::unordered_set<std::string>& guids,
+	const JobProgress* progress)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	const TempSet searched(*this, "searched_guids", guids);
+
+	std::string query;
+	if (use_search_index(querystr)) {
+		query = prepare_query(
+				"SELECT rss_item.guid "
+				"FROM rss_item_fts "
+				"JOIN rss_item ON rss_item.id = rss_item_fts.rowid "
+				"WHERE rss_item_fts MATCH %Q "
+				"AND rss_item.guid IN %s;",
+				search_index_phrase(querystr),
+				searched.subquery());
+	} else {
+		// Only the searched articles are looked at, through the guid index
+		query = prepare_query(
+				"SELECT rss_item.guid "
+				"FROM temp.searched_guids "
+				"JOIN rss_item ON rss_item.guid = searched_guids.value "
+				"WHERE (title LIKE '%%%q%%' OR " ITEM_TEXT " LIKE '%%%q%%');",
+				querystr,
+				querystr);
+	}
+
+	std::unordered_set<std::string> items;
+	const InterruptOnCancel interrupt(db, progress);
+	run_sql(query, guid_callback, &items);
+	return items;
+}
+
+std::unordered_set<std::string> Cache::feeds_with_matches(
+	const std::string& condition)
+{
+	std::unordered_set<std::string> feedurls;
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(
+			"SELECT DISTINCT rss_item.feedurl FROM rss_item "
+			"WHERE rss_item.deleted = 0 AND (" + condition + ");");
+	while (stmt.step()) {
+		feedurls.insert(stmt.column_string(0));
+	}
+	return feedurls;
+}
+
+void Cache::delete_item_unlocked(const std::shared_ptr<RssItem>& item)
+{
+	auto stmt = prepare_statement(item->row_id() != 0
+			? "DELETE FROM rss_item WHERE id = ?;"
+			: "DELETE FROM rss_item WHERE guid = ?;");
+	bind_item_row(stmt, 1, *item);
+	stmt.execute();
+}
+
+void Cache::delete_item_unlocked(const std::string& guid)
+{
+	auto stmt = prepare_statement("DELETE FROM rss_item WHERE guid = ?;");
+	stmt.bind(1, guid);
+	stmt.execute();
+}
+
+void Cache::do_vacuum()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	remove_orphaned_contents();
+
+	const unsigned int page_size = configured_page_size();
+	if (page_size == 0 || page_size == current_page_size()) {
+		run_sql("VACUUM;");
+		return;
+	}
+
+	// A file in WAL mode keeps its page size through a VACUUM, and it
+	// can't leave that mode while the readers have it open
+	std::string journal_mode;
+	{
+		auto stmt = prepare_statement("PRAGMA journal_mode;");
+		if (stmt.step()) {
+			journal_mode = stmt.column_string(0);
+		}
+	}
+	if (journal_mode == "wal") {
+		close_readers();
+		run_sql("PRAGMA journal_mode = DELETE;");
+	}
+	run_sql(prepare_query("PRAGMA page_size = %u;", page_size));
+	run_sql("VACUUM;");
+	if (journal_mode == "wal") {
+		run_sql("PRAGMA journal_mode = WAL;");
+		open_readers(sqlite3_db_filename(db, "main"));
+	}
+	LOG(Level::INFO, "Cache::do_vacuum: page size is now %u",
+		current_page_size());
+}
+
+void Cache::log_auto_vacuum_mode()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement("PRAGMA auto_vacuum;");
+	if (stmt.step() && stmt.column_int(0) != INCREMENTAL_AUTO_VACUUM) {
+		LOG(Level::INFO,
+			"Cache::log_auto_vacuum_mode: cache can't be compacted in the "
+			"background until it's vacuumed once with `newsboat -X'");
+	}
+}
+
+void Cache::log_page_size()
+{
+	const unsigned int page_size = configured_page_size();
+	const unsigned int current = current_page_size();
+	if (page_size != 0 && current != page_size) {
+		LOG(Level::INFO,
+			"Cache::log_page_size: cache has pages of %u bytes rather than "
+			"%u until it's vacuumed once with `newsboat -X'",
+			current,
+			page_size);
+	}
+}
+
+bool Cache::compact(unsigned int max_pages)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	if (transaction_depth > 0) {
+		// incremental_vacuum would become part of that transaction
+		return true;
+	}
+
+	{
+		auto stmt = prepare_statement("PRAGMA auto_vacuum;");
+		if (!stmt.step() || stmt.column_int(0) != INCREMENTAL_AUTO_VACUUM) {
+			return false;
+		}
+	}
+
+	const auto free_pages = [this]() -> int64_t {
+		auto stmt = prepare_statement("PRAGMA freelist_count;");
+		return stmt.step() ? stmt.column_int(0) : 0;
+	};
+	if (free_pages() == 0) {
+		return false;
+	}
 
-		// if some flagged articles were saved, append them
-		feed->add_items(flagged_items);
+	ScopeMeasure m1("Cache::compact");
+	run_sql_nothrow(prepare_query("PRAGMA incremental_vacuum(%u);",
+			max_pages));
+	const int64_t remaining = free_pages();
+	LOG(Level::DEBUG,
+		"Cache::compact: %" PRId64 " free page(s) left",
+		remaining);
+	return remaining > 0;
+}
+
+void Cache::load_content_dictionaries()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	try {
+		auto stmt = prepare_statement(
+				"SELECT id, data FROM content_dictionary ORDER BY id;");
+		while (stmt.step()) {
+			const auto id = static_cast<std::uint32_t>(stmt.column_int(0));
+			codec.add_dictionary(id, stmt.column_string(1));
+			content_dictionary_id = id;
+		}
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Cache::load_content_dictionaries: can't read dictionaries: %s",
+			e.what());
 	}
-	feed->sort_unlocked(cfg->get_article_sort_strategy());
-	return feed;
 }
 
-std::vector<std::shared_ptr<RssItem>> Cache::search_for_items(
-		const std::string& querystr, const std::string& feedurl,
-		RssIgnores& ign)
+void Cache::train_content_dictionary()
 {
-	assert(!utils::is_query_url(feedurl));
-	std::string query;
-	std::vector<std::shared_ptr<RssItem>> items;
+	std::vector<std::string> samples;
+	{
+		auto stmt = prepare_statement(
+				"SELECT " ITEM_CONTENT " FROM rss_item "
+				"ORDER BY id DESC LIMIT ?;");
+		stmt.bind(1, static_cast<int64_t>(MAX_DICTIONARY_SAMPLES));
+		while (stmt.step()) {
+			samples.push_back(stmt.column_string(0));
+		}
+	}
+	if (samples.size() < MIN_DICTIONARY_SAMPLES) {
+		LOG(Level::DEBUG,
+			"Cache::train_content_dictionary: only %" PRIu64 " article(s), "
+			"compressing without a dictionary",
+			static_cast<uint64_t>(samples.size()));
+		return;
+	}
 
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	if (feedurl.length() > 0) {
-		query = prepare_query(
-				"SELECT guid, title, author, url, pubDate, "
-				"length(content), "
-				"unread, feedurl, enclosure_url, enclosure_type, "
-				"enqueued, flags, base "
-				"FROM rss_item "
-				"WHERE (title LIKE '%%%q%%' OR content LIKE '%%%q%%') "
-				"AND feedurl = '%q' "
-				"AND deleted = 0 "
-				"ORDER BY pubDate DESC, id DESC;",
-				querystr,
-				querystr,
-				feedurl);
-	} else {
-		query = prepare_query(
-				"SELECT guid, title, author, url, pubDate, "
-				"length(content), "
-				"unread, feedurl, enclosure_url, enclosure_type, "
-				"enqueued, flags, base "
-				"FROM rss_item "
-				"WHERE (title LIKE '%%%q%%' OR content LIKE '%%%q%%') "
-				"AND deleted = 0 "
-				"ORDER BY pubDate DESC,  id DESC;",
-				querystr,
-				querystr);
+	const std::string dictionary = ContentCodec::train_dictionary(samples,
+			CONTENT_DICTIONARY_SIZE);
+	if (dictionary.empty()) {
+		return;
 	}
+	auto stmt = prepare_statement(
+			"INSERT INTO content_dictionary (data) VALUES (?);");
+	stmt.bind_blob(1, dictionary);
+	stmt.execute();
+
+	const auto id = static_cast<std::uint32_t>(sqlite3_last_insert_rowid(db));
+	codec.add_dictionary(id, dictionary);
+	content_dictionary_id = id;
+	LOG(Level::INFO,
+		"Cache::train_content_dictionary: trained a %" PRIu64 "-byte "
+		"dictionary on %" PRIu64 " articles",
+		static_cast<uint64_t>(dictionary.length()),
+		static_cast<uint64_t>(samples.size()));
+}
 
-	run_sql(query, search_item_callback, &items);
-	for (const auto& item : items) {
-		item->set_cache(this);
+void Cache::bind_content(Statement& stmt, int index, const std::string& text)
+{
+	if (cfg->get_configvalue_as_bool("cache-compress-content")) {
+		const std::string data = codec.compress(text, content_dictionary_id);
+		if (data.length() < text.length()) {
+			stmt.bind_blob(index, data);
+			return;
+		}
 	}
-	items.erase(
-		std::remove_if(
-			items.begin(),
-			items.end(),
-	[&](std::shared_ptr<RssItem> item) -> bool {
-		try
-		{
-			return ign.matches(item.get());
-		} catch (const MatcherException& ex)
-		{
-			LOG(Level::DEBUG,
-				"Cache::search_for_items: oops, Matcher exception: %s",
-				ex.what());
-			return false;
+	stmt.bind(index, text);
+}
+
+int64_t Cache::store_content(const std::string& text)
+{
+	const int64_t hash = content_hash(text);
+	{
+		auto stmt = prepare_statement(
+				"SELECT id FROM rss_content "
+				"WHERE hash = ?1 AND newsboat_content(content) = ?2 "
+				"LIMIT 1;");
+		stmt.bind(1, hash);
+		stmt.bind(2, text);
+		if (stmt.step()) {
+			return stmt.column_int(0);
 		}
-	}),
-	items.end());
+	}
 
-	return items;
+	auto stmt = prepare_statement(
+			"INSERT INTO rss_content (hash, content) VALUES (?, ?);");
+	stmt.bind(1, hash);
+	bind_content(stmt, 2, text);
+	stmt.execute();
+	return sqlite3_last_insert_rowid(db);
 }
 
-std::unordered_set<std::string> Cache::search_in_items(
-	const std::string& querystr,
-	const std::unordered_set<std::string>& guids)
+void Cache::remove_orphaned_contents()
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	run_sql("DELETE FROM rss_content WHERE NOT EXISTS ("
+		"SELECT 1 FROM rss_item WHERE content_id = rss_content.id);");
+	LOG(Level::DEBUG,
+		"Cache::remove_orphaned_contents: removed %d content(s)",
+		sqlite3_changes(db));
+}
 
-	std::string list = "(";
-	for (const auto& guid : guids) {
-		list.append(prepare_query("%Q, ", guid));
+bool Cache::compress_stored_content(unsigned int batch_size)
+{
+	if (!cfg->get_configvalue_as_bool("cache-compress-content")) {
+		return false;
 	}
-	list.append("'')");
 
-	std::string query = prepare_query(
-			"SELECT guid "
-			"FROM rss_item "
-			"WHERE (title LIKE '%%%q%%' OR content LIKE '%%%q%%') "
-			"AND guid IN %s;",
-			querystr,
-			querystr,
-			list);
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeMeasure m1("Cache::compress_stored_content");
+	try {
+		ScopeTransaction transaction(*this);
+		if (compressed_items_up_to == 0 && compressed_contents_up_to == 0
+			&& content_dictionary_id == 0) {
+			train_content_dictionary();
+		}
 
-	std::unordered_set<std::string> items;
-	run_sql(query, guid_callback, &items);
-	return items;
+		const unsigned int items = compress_rows("rss_item",
+				compressed_items_up_to, batch_size);
+		if (items == batch_size) {
+			return true;
+		}
+		const unsigned int left = batch_size - items;
+		return compress_rows("rss_content", compressed_contents_up_to,
+				left) == left;
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Cache::compress_stored_content: couldn't compress articles: %s",
+			e.what());
+		return false;
+	}
 }
 
-void Cache::delete_item_unlocked(const std::shared_ptr<RssItem>& item)
+bool Cache::split_stored_content(unsigned int batch_size)
 {
-	const std::string query = prepare_query(
-			"DELETE FROM rss_item WHERE guid = '%q';", item->guid());
-	run_sql(query);
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeMeasure m1("Cache::split_stored_content");
+	try {
+		ScopeTransaction transaction(*this);
+
+		struct Row {
+			int64_t id;
+			bool inline_content;
+			std::string content;
+			int64_t length;
+		};
+		std::vector<Row> batch;
+		{
+			auto stmt = prepare_statement(
+					"SELECT id, content_id IS NULL, newsboat_content(content), "
+					"newsboat_content_length(" STORED_CONTENT ") "
+					"FROM rss_item "
+					"WHERE id > ? AND content_length IS NULL "
+					"ORDER BY id LIMIT ?;");
+			stmt.bind(1, split_items_up_to);
+			stmt.bind(2, static_cast<int64_t>(batch_size));
+			while (stmt.step()) {
+				batch.push_back({stmt.column_int(0), stmt.column_int(1) != 0,
+						stmt.column_string(2), stmt.column_int(3)});
+			}
+		}
+
+		uint64_t moved = 0;
+		for (const auto& row : batch) {
+			if (row.inline_content && !row.content.empty()) {
+				auto stmt = prepare_statement(
+						"UPDATE rss_item "
+						"SET content = '', content_id = ?, content_length = ? "
+						"WHERE id = ?;");
+				stmt.bind(1, store_content(row.content));
+				stmt.bind(2, row.length);
+				stmt.bind(3, row.id);
+				stmt.execute();
+				++moved;
+			} else {
+				auto stmt = prepare_statement(
+						"UPDATE rss_item SET content_length = ? WHERE id = ?;");
+				stmt.bind(1, row.length);
+				stmt.bind(2, row.id);
+				stmt.execute();
+			}
+		}
+		if (!batch.empty()) {
+			split_items_up_to = batch.back().id;
+		}
+
+		LOG(Level::DEBUG,
+			"Cache::split_stored_content: counted %" PRIu64 " article(s) and "
+			"moved the contents of %" PRIu64 ", up to id %" PRId64,
+			static_cast<uint64_t>(batch.size()),
+			moved,
+			split_items_up_to);
+		return batch.size() == batch_size;
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Cache::split_stored_content: couldn't move contents: %s",
+			e.what());
+		return false;
+	}
 }
 
-void Cache::do_vacuum()
+unsigned int Cache::compress_rows(const std::string& table, int64_t& up_to,
+	unsigned int batch_size)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	run_sql("VACUUM;");
+	std::vector<std::pair<int64_t, std::string>> batch;
+	{
+		auto stmt = prepare_statement(
+				"SELECT id, content FROM " + table + " "
+				"WHERE id > ? AND typeof(content) = 'text' AND content != '' "
+				"ORDER BY id LIMIT ?;");
+		stmt.bind(1, up_to);
+		stmt.bind(2, static_cast<int64_t>(batch_size));
+		while (stmt.step()) {
+			batch.emplace_back(stmt.column_int(0), stmt.column_string(1));
+		}
+	}
+
+	uint64_t compressed = 0;
+	for (const auto& row : batch) {
+		const std::string data = codec.compress(row.second,
+				content_dictionary_id);
+		// Too short to gain anything; it stays plain text
+		if (data.length() >= row.second.length()) {
+			continue;
+		}
+		auto stmt = prepare_statement(
+				"UPDATE " + table + " SET content = ? WHERE id = ?;");
+		stmt.bind_blob(1, data);
+		stmt.bind(2, row.first);
+		stmt.execute();
+		++compressed;
+	}
+	if (!batch.empty()) {
+		up_to = batch.back().first;
+	}
+
+	LOG(Level::DEBUG,
+		"Cache::compress_rows: compressed %" PRIu64 " of %" PRIu64
+		" row(s) of %s, up to id %" PRId64,
+		compressed,
+		static_cast<uint64_t>(batch.size()),
+		table,
+		up_to);
+	return batch.size();
 }
 
 std::vector<std::string> Cache::cleanup_cache(std::vector<std::shared_ptr<RssFeed>> feeds,
@@ -768,14 +3024,11 @@ std::vector<std::string> Cache::cleanup_cache(std::vector<std::shared_ptr<RssFee
 	mtx.lock();
 
 	std::vector<std::string> unreachable_feeds{};
-	std::string list = "(";
-
+	std::vector<std::string> urls;
 	for (const auto& feed : feeds) {
-		const auto name = prepare_query("'%q'", feed->rssurl());
-		list.append(name);
-		list.append(", ");
+		urls.push_back(feed->rssurl());
 	}
-	list.append("'')");
+	const TempSet configured(*this, "configured_feeds", urls);
 
 	/*
 	 * cache cleanup means that all entries in both the RssFeed and
@@ -792,18 +3045,17 @@ std::vector<std::string> Cache::cleanup_cache(std::vector<std::shared_ptr<RssFee
 	if (always_clean || cfg->get_configvalue_as_bool("cleanup-on-quit")) {
 		LOG(Level::DEBUG, "Cache::cleanup_cache: cleaning up cache...");
 
-		std::string cleanup_rss_feeds_statement(
-			"DELETE FROM rss_feed WHERE rssurl NOT IN ");
-		cleanup_rss_feeds_statement.append(list);
-		cleanup_rss_feeds_statement.push_back(';');
+		const std::string cleanup_rss_feeds_statement =
+			"DELETE FROM rss_feed WHERE rssurl NOT IN "
+			+ configured.subquery() + ";";
 
-		std::string cleanup_rss_items_statement(
-			"DELETE FROM rss_item WHERE feedurl NOT IN ");
-		cleanup_rss_items_statement.append(list);
-		cleanup_rss_items_statement.push_back(';');
+		const std::string cleanup_rss_items_statement =
+			"DELETE FROM rss_item WHERE feedurl NOT IN "
+			+ configured.subquery() + ";";
 
+		// Articles that were deleted on an earlier quit aren't written again
 		std::string cleanup_read_items_statement(
-			"UPDATE rss_item SET deleted = 1 WHERE unread = 0");
+			"UPDATE rss_item SET deleted = 1 WHERE unread = 0 AND deleted = 0");
 
 		run_sql(cleanup_rss_feeds_statement);
 		run_sql(cleanup_rss_items_statement);
@@ -811,21 +3063,19 @@ std::vector<std::string> Cache::cleanup_cache(std::vector<std::shared_ptr<RssFee
 				"delete-read-articles-on-quit")) {
 			run_sql(cleanup_read_items_statement);
 		}
+		remove_orphaned_contents();
 	} else {
 		LOG(Level::DEBUG,
 			"Cache::cleanup_cache: NOT cleaning up cache...");
 
-		std::string query = (
-				"SELECT DISTINCT rss "
-				"FROM ("
-				"SELECT feedurl AS rss FROM rss_item "
-				"UNION ALL "
-				"SELECT rssurl FROM rss_feed"
-				") "
-				"WHERE rss NOT IN "
-			);
-		query.append(list);
-		query.push_back(';');
+		// Both sides use their index on the URL, and UNION drops the
+		// duplicates
+		const std::string query =
+			"SELECT DISTINCT feedurl FROM rss_item "
+			"WHERE feedurl NOT IN " + configured.subquery() + " "
+			"UNION "
+			"SELECT rssurl FROM rss_feed "
+			"WHERE rssurl NOT IN " + configured.subquery() + ";";
 
 		run_sql(query, vectorofstring_callback, &unreachable_feeds);
 	}
@@ -836,158 +3086,233 @@ std::vector<std::string> Cache::cleanup_cache(std::vector<std::shared_ptr<RssFee
 	return unreachable_feeds;
 }
 
-void Cache::update_rssitem_unlocked(std::shared_ptr<RssItem> item,
+void Cache::load_known_guids()
+{
+	// Past its capacity, the filter gives more and more false positives
+	if (known_guids_loaded && known_guids.size() <= known_guids.capacity()) {
+		return;
+	}
+
+	std::int64_t count = 0;
+	{
+		auto stmt = prepare_statement("SELECT count(*) FROM rss_item;");
+		if (stmt.step()) {
+			count = stmt.column_int(0);
+		}
+	}
+	// Room for the articles of a good many reloads to come
+	known_guids = BloomFilter(2 * count + 10000);
+	auto stmt = prepare_statement("SELECT guid FROM rss_item;");
+	while (stmt.step()) {
+		known_guids.add(stmt.column_string(0));
+	}
+	known_guids_loaded = true;
+	LOG(Level::DEBUG, "Cache::load_known_guids: %" PRIu64 " GUID(s)",
+		static_cast<uint64_t>(known_guids.size()));
+}
+
+std::int64_t Cache::find_feed_id(ReadLease& reader,
+	const std::string& feedurl)
+{
+	{
+		std::lock_guard<std::mutex> guard(feed_ids_mtx);
+		const auto it = feed_ids.find(feedurl);
+		if (it != feed_ids.end()) {
+			return it->second;
+		}
+	}
+
+	auto stmt = reader.prepare_statement(
+			"SELECT id FROM rss_feed_id WHERE rssurl = ?;");
+	stmt.bind(1, feedurl);
+	if (!stmt.step()) {
+		return 0;
+	}
+	const std::int64_t id = stmt.column_int(0);
+	std::lock_guard<std::mutex> guard(feed_ids_mtx);
+	feed_ids[feedurl] = id;
+	return id;
+}
+
+std::int64_t Cache::feed_id_unlocked(const std::string& feedurl)
+{
+	{
+		std::lock_guard<std::mutex> guard(feed_ids_mtx);
+		const auto it = feed_ids.find(feedurl);
+		if (it != feed_ids.end()) {
+			return it->second;
+		}
+	}
+
+	auto insert = prepare_statement(
+			"INSERT OR IGNORE INTO rss_feed_id (rssurl) VALUES (?);");
+	insert.bind(1, feedurl);
+	insert.execute();
+	auto stmt = prepare_statement(
+			"SELECT id FROM rss_feed_id WHERE rssurl = ?;");
+	stmt.bind(1, feedurl);
+	if (!stmt.step()) {
+		return 0;
+	}
+	const std::int64_t id = stmt.column_int(0);
+	std::lock_guard<std::mutex> guard(feed_ids_mtx);
+	feed_ids[feedurl] = id;
+	return id;
+}
+
+bool Cache::update_rssitem_unlocked(std::shared_ptr<RssItem> item,
 	const std::string& feedurl,
-	bool reset_unread)
+	bool reset_unread,
+	ItemChanges* changes)
 {
-	std::string query = prepare_query(
-			"SELECT count(*) FROM rss_item WHERE guid = '%q';",
-			item->guid());
-	CbHandler count_cbh;
-	run_sql(query, count_callback, &count_cbh);
 	const auto description = item->description();
-	if (count_cbh.count() > 0) {
-		if (reset_unread) {
-			std::string content;
-			query = prepare_query(
-					"SELECT content FROM rss_item WHERE guid = "
-					"'%q';",
-					item->guid());
-			run_sql(query, single_string_callback, &content);
-			if (content != description.text) {
-				LOG(Level::DEBUG,
-					"Cache::update_rssitem_unlocked: '%s' "
-					"is "
-					"different from '%s'",
-					content,
-					description.text);
-				query = prepare_query(
-						"UPDATE rss_item SET unread = 1 WHERE "
-						"guid = '%q';",
-						item->guid());
-				run_sql(query);
-			}
+	const int64_t hash = item_hash(*item, feedurl, description);
+
+	if (known_guids.may_contain(item->guid())) {
+		// The upsert below wouldn't change a row with the same hash, but
+		// it would store the content first, which costs more than this
+		auto stmt = prepare_statement(
+				"SELECT 1 FROM rss_item "
+				"WHERE guid = ?1 AND item_hash IS ?2 "
+				"AND (?3 = 0 OR unread IS ?4);");
+		stmt.bind(1, item->guid());
+		stmt.bind(2, hash);
+		stmt.bind(3, item->override_unread() ? 1 : 0);
+		stmt.bind(4, item->unread() ? 1 : 0);
+		if (stmt.step()) {
+			return false;
 		}
-		std::string update;
-		if (item->override_unread()) {
-			update = prepare_query(
-					"UPDATE rss_item "
-					"SET title = '%q', author = '%q', url = '%q', "
-					"feedurl = '%q', "
-					"content = '%q', content_mime_type = '%q', enclosure_url = '%q', "
-					"enclosure_type = '%q', base = '%q', unread = "
-					"'%d' "
-					"WHERE guid = '%q'",
-					item->title(),
-					item->author(),
-					item->link(),
-					feedurl,
-					description.text,
-					description.mime,
-					item->enclosure_url(),
-					item->enclosure_type(),
-					item->get_base(),
-					(item->unread() ? 1 : 0),
-					item->guid());
-		} else {
-			update = prepare_query(
-					"UPDATE rss_item "
-					"SET title = '%q', author = '%q', url = '%q', "
-					"feedurl = '%q', "
-					"content = '%q', content_mime_type = '%q', enclosure_url = '%q', "
-					"enclosure_type = '%q', base = '%q' "
-					"WHERE guid = '%q'",
-					item->title(),
-					item->author(),
-					item->link(),
-					feedurl,
-					description.text,
-					description.mime,
-					item->enclosure_url(),
-					item->enclosure_type(),
-					item->get_base(),
-					item->guid());
-		}
-		run_sql(update);
+	}
+
+	// An article that's already stored is only updated if something in it
+	// changed, so most of a reload doesn't write anything. The unread flag
+	// isn't part of the hash: it's only taken from the feed if the feed
+	// overrides it, and then a change of it is enough to update the row.
+	std::string query =
+		"INSERT INTO rss_item (guid, title, author, url, feedurl, pubDate, "
+		"content, content_id, content_mime_type, unread, enclosure_url, "
+		"enclosure_type, enqueued, base, item_hash, content_length, feed_id, "
+		"content_text) "
+		"VALUES (?1, ?2, ?3, ?4, ?5, ?6, '', ?7, ?8, ?9, ?10, ?11, ?12, ?13, "
+		"?14, ?16, ?17, ?18) "
+		"ON CONFLICT(guid) DO UPDATE "
+		"SET title = excluded.title, author = excluded.author, "
+		"url = excluded.url, feedurl = excluded.feedurl, "
+		"feed_id = excluded.feed_id, content = '', "
+		"content_id = excluded.content_id, "
+		"content_length = excluded.content_length, "
+		"content_mime_type = excluded.content_mime_type, "
+		"content_text = excluded.content_text, "
+		"enclosure_url = excluded.enclosure_url, "
+		"enclosure_type = excluded.enclosure_type, base = excluded.base, "
+		"item_hash = excluded.item_hash";
+	if (item->override_unread()) {
+		query.append(", unread = excluded.unread "
+			"WHERE item_hash IS NOT excluded.item_hash "
+			"OR unread IS NOT excluded.unread;");
+	} else if (reset_unread) {
+		// Equal contents almost always share a content_id, which spares
+		// us comparing the text
+		query.append(", unread = CASE "
+			"WHEN content_id IS NOT excluded.content_id "
+			"AND " ITEM_CONTENT " IS NOT ?15 THEN 1 "
+			"ELSE unread END "
+			"WHERE item_hash IS NOT excluded.item_hash;");
 	} else {
-		std::string insert = prepare_query(
-				"INSERT INTO rss_item (guid, title, author, url, "
-				"feedurl, "
-				"pubDate, content, content_mime_type, unread, enclosure_url, "
-				"enclosure_type, enqueued, base) "
-				"VALUES "
-				"('%q','%q','%q','%q','%q','%u','%q','%q','%d','%q','%q',%d,"
-				" "
-				"'%q')",
-				item->guid(),
-				item->title(),
-				item->author(),
-				item->link(),
-				feedurl,
-				item->pubDate_timestamp(),
-				description.text,
-				description.mime,
-				(item->unread() ? 1 : 0),
-				item->enclosure_url(),
-				item->enclosure_type(),
-				item->enqueued() ? 1 : 0,
-				item->get_base());
-		run_sql(insert);
+		query.append(" WHERE item_hash IS NOT excluded.item_hash;");
+	}
+
+	auto upsert = prepare_statement(query);
+	upsert.bind(1, item->guid());
+	upsert.bind(2, item->title());
+	upsert.bind(3, item->author());
+	upsert.bind(4, item->link());
+	upsert.bind(5, feedurl);
+	upsert.bind(17, feed_id_unlocked(feedurl));
+	upsert.bind(6, item->pubDate_timestamp());
+	upsert.bind(7, store_content(description.text));
+	upsert.bind(8, description.mime);
+	upsert.bind(9, item->unread() ? 1 : 0);
+	upsert.bind(10, item->enclosure_url());
+	upsert.bind(11, item->enclosure_type());
+	upsert.bind(12, item->enqueued() ? 1 : 0);
+	upsert.bind(13, item->get_base());
+	upsert.bind(14, hash);
+	if (reset_unread && !item->override_unread()) {
+		upsert.bind(15, description.text);
+	}
+	upsert.bind(16, static_cast<int64_t>(count_codepoints(description.text)));
+	// Left NULL where it's the same as the content
+	const std::string text = content_text(description.text, description.mime);
+	if (text != description.text) {
+		upsert.bind(18, text);
+	}
+	// An upsert that updates the row leaves the last rowid alone, and rowids
+	// start at 1
+	sqlite3_set_last_insert_rowid(db, 0);
+	upsert.execute();
+	const sqlite3_int64 row_id = sqlite3_last_insert_rowid(db);
+	const bool inserted = row_id != 0;
+	if (inserted) {
+		known_guids.add(item->guid());
+		item->set_row_id(row_id);
 	}
+	if (changes != nullptr && (inserted || sqlite3_changes(db) > 0)) {
+		// The upsert's WHERE leaves rows that wouldn't change alone
+		changes->push_back({item->guid(), feedurl,
+				inserted ? ItemChange::Kind::ADDED : ItemChange::Kind::CHANGED});
+	}
+	return inserted;
 }
 
 void Cache::mark_all_read(std::shared_ptr<RssFeed> feed)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::lock_guard<std::mutex> itemlock(feed->item_mutex);
-	std::string query =
-		"UPDATE rss_item SET unread = '0' WHERE unread != '0' AND guid "
-		"IN (";
-
-	for (const auto& item : feed->items()) {
-		query.append(prepare_query("'%q',", item->guid()));
+	// The articles that are read already are stored so
+	std::vector<std::string> guids;
+	{
+		const auto itemlock = feed->lock_items_for_reading();
+		for (const auto& item : feed->items()) {
+			if (item->unread()) {
+				guids.push_back(item->guid());
+			}
+		}
 	}
-	query.append("'');");
-
-	run_sql(query);
+	mark_items_read_by_guid(guids);
 }
 
 /* this function marks all RssItems (optionally of a certain feed url) as read
  */
 void Cache::mark_all_read(const std::string& feedurl)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 
-	std::string query;
 	if (feedurl.length() > 0) {
-		query = prepare_query(
+		auto stmt = prepare_statement(
 				"UPDATE rss_item "
 				"SET unread = '0' "
 				"WHERE unread != '0' "
-				"AND feedurl = '%q';",
-				feedurl);
+				"AND feed_id = ?;");
+		stmt.bind(1, feed_id_unlocked(feedurl));
+		stmt.execute();
 	} else {
-		query = prepare_query(
-				"UPDATE rss_item "
-				"SET unread = '0' "
-				"WHERE unread != '0';");
+		run_sql("UPDATE rss_item "
+			"SET unread = '0' "
+			"WHERE unread != '0';");
 	}
-	run_sql(query);
 }
 
 void Cache::update_rssitem_unread_and_enqueued(RssItem* item,
 	const std::string& /* feedurl */)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-
-	const auto query = prepare_query(
-			"UPDATE rss_item "
-			"SET unread = '%d', enqueued = '%d' "
-			"WHERE guid = '%q'",
-			item->unread() ? 1 : 0,
-			item->enqueued() ? 1 : 0,
-			item->guid());
-	run_sql(query);
+	std::lock_guard<CacheMutex> lock(mtx);
+
+	auto stmt = prepare_statement(item->row_id() != 0
+			? "UPDATE rss_item SET unread = ?1, enqueued = ?2 WHERE id = ?3;"
+			: "UPDATE rss_item SET unread = ?1, enqueued = ?2 WHERE guid = ?3;");
+	stmt.bind(1, item->unread() ? 1 : 0);
+	stmt.bind(2, item->enqueued() ? 1 : 0);
+	bind_item_row(stmt, 3, *item);
+	stmt.execute();
 }
 
 /* this function updates the unread and enqueued flags */
@@ -1031,22 +3356,22 @@ std::string Cache::prepare_query(const std::string& format, const T& argument,
 
 void Cache::update_rssitem_flags(RssItem* item)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-
-	const std::string update = prepare_query(
-			"UPDATE rss_item SET flags = '%q' WHERE guid = '%q';",
-			item->flags(),
-			item->guid());
-
-	run_sql(update);
+	std::lock_guard<CacheMutex> lock(mtx);
+
+	auto stmt = prepare_statement(item->row_id() != 0
+			? "UPDATE rss_item SET flags = ?1 WHERE id = ?2;"
+			: "UPDATE rss_item SET flags = ?1 WHERE guid = ?2;");
+	stmt.bind(1, item->flags());
+	bind_item_row(stmt, 2, *item);
+	stmt.execute();
 }
 
 void Cache::remove_old_deleted_items(RssFeed* feed)
 {
 	ScopeMeasure m1("Cache::remove_old_deleted_items");
 
-	std::lock_guard<std::recursive_mutex> cache_lock(mtx);
-	std::lock_guard<std::mutex> feed_lock(feed->item_mutex);
+	std::lock_guard<CacheMutex> cache_lock(mtx);
+	const auto feed_lock = feed->lock_items_for_reading();
 
 	std::vector<std::string> guids;
 	for (const auto& item : feed->items()) {
@@ -1060,60 +3385,352 @@ void Cache::remove_old_deleted_items(RssFeed* feed)
 			"(detected no changes)");
 		return;
 	}
-	std::string guidset = "(";
-	for (const auto& guid : guids) {
-		guidset.append(prepare_query("'%q', ", guid));
-	}
-	guidset.append("'')");
-	const std::string query = prepare_query(
+	const TempSet kept(*this, "kept_guids", guids);
+	auto stmt = prepare_statement(
 			"DELETE FROM rss_item "
-			"WHERE feedurl = '%q' "
+			"WHERE feed_id = ? "
 			"AND deleted = 1 "
-			"AND guid NOT IN %s;",
-			feed->rssurl(),
-			guidset);
-	run_sql(query);
+			"AND guid NOT IN " + kept.subquery() + ";");
+	stmt.bind(1, feed_id_unlocked(feed->rssurl()));
+	stmt.execute();
 }
 
 void Cache::mark_items_read_by_guid(const std::vector<std::string>& guids)
 {
 	ScopeMeasure m1("Cache::mark_items_read_by_guid");
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	std::string guidset("(");
-	for (const auto& guid : guids) {
-		guidset.append(prepare_query("'%q', ", guid));
+	if (guids.empty()) {
+		return;
 	}
-	guidset.append("'')");
+	std::lock_guard<CacheMutex> lock(mtx);
+	const TempSet read(*this, "read_guids", guids);
 
-	const std::string updatequery = prepare_query(
-			"UPDATE rss_item SET unread = 0 WHERE unread = 1 AND guid IN "
-			"%s;",
-			guidset);
+	run_sql("UPDATE rss_item SET unread = 0 WHERE unread = 1 AND guid IN "
+		+ read.subquery() + ";");
+}
 
-	run_sql(updatequery);
+void Cache::sync_unread_by_guid(const std::vector<std::string>& feedurls,
+	const std::vector<std::string>& unread_guids)
+{
+	ScopeMeasure m1("Cache::sync_unread_by_guid");
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeTransaction transaction(*this);
+
+	const TempSet synced_feeds(*this, "synced_feeds", feedurls);
+	const TempSet synced_unread(*this, "synced_unread", unread_guids);
+
+	// The server doesn't know yet about the changes still queued for it
+	run_sql("UPDATE rss_item "
+		"SET unread = (guid IN " + synced_unread.subquery() + ") "
+		"WHERE feed_id IN (SELECT id FROM rss_feed_id "
+		" WHERE rssurl IN " + synced_feeds.subquery() + ") "
+		"AND unread != (guid IN " + synced_unread.subquery() + ") "
+		"AND guid NOT IN "
+		" (SELECT guid FROM remote_outbox WHERE read IS NOT NULL);");
+	LOG(Level::DEBUG,
+		"Cache::sync_unread_by_guid: changed %d article(s)",
+		sqlite3_changes(db));
 }
 
 std::vector<std::string> Cache::get_read_item_guids()
 {
 	std::vector<std::string> guids;
-	const std::string query = "SELECT guid FROM rss_item WHERE unread = 0;";
+	for_each_read_item_guid([&](const std::string& guid) {
+		guids.push_back(guid);
+	});
+	return guids;
+}
 
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	run_sql(query, vectorofstring_callback, &guids);
+void Cache::for_each_read_item_guid(
+	const std::function<void(const std::string&)>& callback)
+{
+	ScopeMeasure m1("Cache::for_each_read_item_guid");
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement("SELECT guid FROM rss_item WHERE unread = 0;");
+	while (stmt.step()) {
+		callback(stmt.column_string(0));
+	}
+}
 
-	return guids;
+void Cache::queue_remote_read(const std::string& guid, bool read)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"INSERT INTO remote_outbox (guid, read) VALUES (?, ?) "
+			"ON CONFLICT (guid) DO UPDATE "
+			"SET read = excluded.read, revision = revision + 1;");
+	stmt.bind(1, guid);
+	stmt.bind(2, static_cast<std::int64_t>(read ? 1 : 0));
+	stmt.execute();
+}
+
+void Cache::queue_remote_reads(const std::vector<std::string>& guids,
+	bool read)
+{
+	if (guids.empty()) {
+		return;
+	}
+	std::lock_guard<CacheMutex> lock(mtx);
+	const TempSet queued(*this, "queued_guids", guids);
+	// "WHERE true" tells SQLite that ON CONFLICT isn't part of a join
+	auto stmt = prepare_statement(
+			"INSERT INTO remote_outbox (guid, read) "
+			"SELECT value, ? FROM temp.queued_guids WHERE true "
+			"ON CONFLICT (guid) DO UPDATE "
+			"SET read = excluded.read, revision = revision + 1;");
+	stmt.bind(1, static_cast<std::int64_t>(read ? 1 : 0));
+	stmt.execute();
+}
+
+void Cache::queue_remote_flags(const std::string& guid,
+	const std::string& oldflags,
+	const std::string& flags)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"INSERT INTO remote_outbox (guid, oldflags, flags) VALUES (?, ?, ?) "
+			"ON CONFLICT (guid) DO UPDATE "
+			"SET oldflags = IFNULL(oldflags, excluded.oldflags), "
+			" flags = excluded.flags, revision = revision + 1;");
+	stmt.bind(1, guid);
+	stmt.bind(2, oldflags);
+	stmt.bind(3, flags);
+	stmt.execute();
+}
+
+std::vector<OutboxEntry> Cache::fetch_remote_outbox(unsigned int limit)
+{
+	std::vector<OutboxEntry> entries;
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT guid, read, oldflags, flags, attempts, revision "
+			"FROM remote_outbox ORDER BY rowid LIMIT ?;");
+	stmt.bind(1, static_cast<std::int64_t>(limit));
+	while (stmt.step()) {
+		OutboxEntry entry;
+		entry.guid = stmt.column_string(0);
+		entry.has_read = !stmt.column_is_null(1);
+		entry.read = entry.has_read && stmt.column_int(1) != 0;
+		entry.has_flags = !stmt.column_is_null(3);
+		entry.oldflags = stmt.column_string(2);
+		entry.flags = stmt.column_string(3);
+		entry.attempts = stmt.column_int(4);
+		entry.revision = stmt.column_int(5);
+		entries.push_back(std::move(entry));
+	}
+	return entries;
+}
+
+void Cache::remove_sent_outbox_entries(const std::vector<OutboxEntry>&
+	entries)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeTransaction transaction(*this);
+	for (const auto& entry : entries) {
+		auto remove = prepare_statement(
+				"DELETE FROM remote_outbox WHERE guid = ? AND revision = ?;");
+		remove.bind(1, entry.guid);
+		remove.bind(2, entry.revision);
+		remove.execute();
+
+		if (entry.has_flags) {
+			// If the flags changed again, the API has the ones that were
+			// just sent to change from
+			auto update = prepare_statement(
+					"UPDATE remote_outbox SET oldflags = ? "
+					"WHERE guid = ? AND flags IS NOT NULL;");
+			update.bind(1, entry.flags);
+			update.bind(2, entry.guid);
+			update.execute();
+		}
+	}
+}
+
+void Cache::count_outbox_failures(const std::vector<OutboxEntry>& entries,
+	unsigned int max_attempts)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeTransaction transaction(*this);
+	for (const auto& entry : entries) {
+		auto stmt = prepare_statement(
+				"UPDATE remote_outbox SET attempts = attempts + 1 "
+				"WHERE guid = ?;");
+		stmt.bind(1, entry.guid);
+		stmt.execute();
+	}
+
+	auto stmt = prepare_statement(
+			"DELETE FROM remote_outbox WHERE attempts >= ?;");
+	stmt.bind(1, static_cast<std::int64_t>(max_attempts));
+	stmt.execute();
+	const int dropped = sqlite3_changes(db);
+	if (dropped > 0) {
+		// In the error log, since the server and Newsboat now disagree
+		// about these articles
+		LOG(Level::USERERROR,
+			"The server turned down changes to %d article(s) %u times; "
+			"they won't be sent again",
+			dropped,
+			max_attempts);
+	}
+}
+
+void Cache::store_subscriptions(const std::string& source,
+	const std::vector<std::pair<std::string, std::vector<std::string>>>&
+	subscriptions)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeTransaction transaction(*this);
+	auto clear = prepare_statement(
+			"DELETE FROM remote_subscriptions WHERE source = ?;");
+	clear.bind(1, source);
+	clear.execute();
+
+	std::int64_t position = 0;
+	for (const auto& subscription : subscriptions) {
+		std::string tags;
+		for (const auto& tag : subscription.second) {
+			if (!tags.empty()) {
+				tags.push_back('\n');
+			}
+			tags.append(tag);
+		}
+
+		auto stmt = prepare_statement(
+				"INSERT INTO remote_subscriptions (source, position, url, tags) "
+				"VALUES (?, ?, ?, ?);");
+		stmt.bind(1, source);
+		stmt.bind(2, position++);
+		stmt.bind(3, subscription.first);
+		stmt.bind(4, tags);
+		stmt.execute();
+	}
+}
+
+std::vector<std::pair<std::string, std::vector<std::string>>>
+Cache::fetch_subscriptions(const std::string& source)
+{
+	std::vector<std::pair<std::string, std::vector<std::string>>> subscriptions;
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT url, tags FROM remote_subscriptions WHERE source = ? "
+			"ORDER BY position;");
+	stmt.bind(1, source);
+	while (stmt.step()) {
+		subscriptions.emplace_back(stmt.column_string(0),
+			utils::tokenize(stmt.column_string(1), "\n"));
+	}
+	return subscriptions;
+}
+
+void Cache::store_remote_response(const std::string& url,
+	const StoredResponse& response)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"INSERT INTO remote_responses (url, lastmodified, etag, body) "
+			"VALUES (?, ?, ?, ?) "
+			"ON CONFLICT (url) DO UPDATE "
+			"SET lastmodified = excluded.lastmodified, "
+			"etag = excluded.etag, body = excluded.body;");
+	stmt.bind(1, url);
+	stmt.bind(2, static_cast<int64_t>(response.last_modified));
+	stmt.bind(3, response.etag);
+	stmt.bind(4, response.body);
+	stmt.execute();
+}
+
+bool Cache::fetch_remote_response(const std::string& url,
+	StoredResponse& response)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT lastmodified, etag, body FROM remote_responses "
+			"WHERE url = ?;");
+	stmt.bind(1, url);
+	if (!stmt.step()) {
+		return false;
+	}
+	response.last_modified = static_cast<time_t>(stmt.column_int(0));
+	response.etag = stmt.column_string(1);
+	response.body = stmt.column_string(2);
+	return true;
+}
+
+void Cache::update_websub_hub(const std::string& rssurl,
+	const std::string& hub,
+	const std::string& topic)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	if (hub.empty()) {
+		auto stmt = prepare_statement(
+				"DELETE FROM websub_hubs WHERE rssurl = ?;");
+		stmt.bind(1, rssurl);
+		stmt.execute();
+		return;
+	}
+	auto stmt = prepare_statement(
+			"INSERT INTO websub_hubs (rssurl, hub, topic) VALUES (?, ?, ?) "
+			"ON CONFLICT (rssurl) DO UPDATE "
+			"SET hub = excluded.hub, topic = excluded.topic "
+			"WHERE hub != excluded.hub OR topic != excluded.topic;");
+	stmt.bind(1, rssurl);
+	stmt.bind(2, hub);
+	stmt.bind(3, topic);
+	stmt.execute();
+}
+
+void Cache::take_snapshot_token()
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement("SELECT token FROM snapshot_token;");
+	if (stmt.step()) {
+		opened_snapshot_token = stmt.column_string(0);
+	}
+	run_sql("DELETE FROM snapshot_token;");
+}
+
+const std::string& Cache::snapshot_token() const
+{
+	return opened_snapshot_token;
+}
+
+void Cache::set_snapshot_token(const std::string& token)
+{
+	std::lock_guard<CacheMutex> lock(mtx);
+	ScopeTransaction transaction(*this);
+	run_sql("DELETE FROM snapshot_token;");
+	auto stmt = prepare_statement("INSERT INTO snapshot_token (token) VALUES (?);");
+	stmt.bind(1, token);
+	stmt.execute();
+}
+
+std::unordered_map<std::string, std::pair<std::string, std::string>>
+Cache::fetch_websub_hubs()
+{
+	std::unordered_map<std::string, std::pair<std::string, std::string>> hubs;
+	std::lock_guard<CacheMutex> lock(mtx);
+	auto stmt = prepare_statement(
+			"SELECT rssurl, hub, topic FROM websub_hubs;");
+	while (stmt.step()) {
+		hubs[stmt.column_string(0)] = std::make_pair(stmt.column_string(1),
+				stmt.column_string(2));
+	}
+	return hubs;
 }
 
 void Cache::clean_old_articles()
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 
-	const unsigned int days = cfg->get_configvalue_as_int("keep-articles-days");
+	const unsigned int days = cfg->snapshot().keep_articles_days;
 	if (days > 0) {
 		const time_t old_date = time(nullptr) - days * 24 * 60 * 60;
 
-		const std::string query(prepare_query(
-				"DELETE FROM rss_item WHERE pubDate < %d", old_date));
+		// Only worth its upkeep while articles expire; it turns finding
+		// them from a scan of all articles into reading the oldest ones
+		run_sql("CREATE INDEX IF NOT EXISTS idx_rss_item_pubdate ON "
+			"rss_item(pubDate);");
+
 		LOG(Level::DEBUG,
 			"Cache::clean_old_articles: about to delete articles "
 			"with a pubDate older than %" PRId64,
@@ -1122,56 +3739,109 @@ void Cache::clean_old_articles()
 			// casting to int64_t is either a no-op, or an up-cast which are
 			// always safe.
 			static_cast<int64_t>(old_date));
-		run_sql(query);
+		// Oldest first, a batch at a time, so that the deleted articles
+		// free whole pages, which compact() hands back later
+		int64_t deleted = 0;
+		int changes = 0;
+		do {
+			auto stmt = prepare_statement(
+					"DELETE FROM rss_item WHERE id IN ("
+					" SELECT id FROM rss_item WHERE pubDate < ?1 "
+					" ORDER BY pubDate LIMIT ?2);");
+			stmt.bind(1, static_cast<int64_t>(old_date));
+			stmt.bind(2, static_cast<int64_t>(EXPIRY_BATCH_SIZE));
+			stmt.execute();
+			changes = sqlite3_changes(db);
+			deleted += changes;
+		} while (changes == static_cast<int>(EXPIRY_BATCH_SIZE));
+		LOG(Level::DEBUG,
+			"Cache::clean_old_articles: deleted %" PRId64 " article(s)",
+			deleted);
+		if (deleted > 0) {
+			remove_orphaned_contents();
+		}
 	} else {
 		LOG(Level::DEBUG,
 			"Cache::clean_old_articles, days == 0, not cleaning up "
 			"anything");
+		run_sql("DROP INDEX IF EXISTS idx_rss_item_pubdate;");
 	}
 }
 
 void Cache::fetch_descriptions(RssFeed* feed)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 	std::vector<std::string> guids;
 	for (const auto& item : feed->items()) {
-		guids.push_back(prepare_query("'%q'", item->guid()));
+		guids.push_back(item->guid());
 	}
-	const std::string in_clause = utils::join(guids, ", ");
+	const TempSet feed_guids(*this, "feed_guids", guids);
 
-	const std::string query = prepare_query(
-			"SELECT guid, content, content_mime_type FROM rss_item WHERE guid IN (%s);",
-			in_clause);
+	run_sql("SELECT guid, " ITEM_CONTENT ", content_mime_type "
+		"FROM rss_item WHERE guid IN " + feed_guids.subquery() + ";",
+		fill_content_callback, feed);
+}
 
-	run_sql(query, fill_content_callback, feed);
+std::unordered_map<std::string, Description> Cache::fetch_descriptions(
+	const std::vector<std::string>& guids)
+{
+	std::unordered_map<std::string, Description> descriptions;
+	ReadLease reader(*this);
+	for (const auto& guid : guids) {
+		auto stmt = reader.prepare_statement(
+				"SELECT " ITEM_CONTENT ", content_mime_type FROM rss_item "
+				"WHERE guid = ?;");
+		stmt.bind(1, guid);
+		if (stmt.step()) {
+			descriptions[guid] = {stmt.column_string(0), stmt.column_string(1)};
+		}
+	}
+	return descriptions;
 }
 
 std::string Cache::fetch_description(const RssItem& item)
 {
-	std::lock_guard<std::recursive_mutex> lock(mtx);
-	const std::string in_clause = prepare_query("'%q'", item.guid());
-
-	const std::string query = prepare_query(
-			"SELECT content FROM rss_item WHERE guid = %s;",
-			in_clause);
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(item.row_id() != 0
+			? "SELECT " ITEM_CONTENT " FROM rss_item WHERE id = ?;"
+			: "SELECT " ITEM_CONTENT " FROM rss_item WHERE guid = ?;");
+	bind_item_row(stmt, 1, item);
 
 	std::string description;
-	auto store_description = [](void* d, int, char** argv, char**) -> int {
-		auto& desc = *static_cast<std::string*>(d);
-		desc = argv[0] ? argv[0] : "";
-		return 0;
-	};
-
-	run_sql(query, store_description, &description);
+	if (stmt.step()) {
+		description = stmt.column_string(0);
+	}
 	return description;
 }
 
+std::string Cache::fetch_content_text(const RssItem& item)
+{
+	ReadLease reader(*this);
+	auto stmt = reader.prepare_statement(item.row_id() != 0
+			? "SELECT content_text, "
+			"CASE WHEN content_text IS NULL THEN " ITEM_CONTENT " END, "
+			"content_mime_type FROM rss_item WHERE id = ?;"
+			: "SELECT content_text, "
+			"CASE WHEN content_text IS NULL THEN " ITEM_CONTENT " END, "
+			"content_mime_type FROM rss_item WHERE guid = ?;");
+	bind_item_row(stmt, 1, item);
+
+	if (!stmt.step()) {
+		return {};
+	}
+	if (!stmt.column_is_null(0)) {
+		return stmt.column_string(0);
+	}
+	// Either the same as the content, or stored by an older version
+	return content_text(stmt.column_string(1), stmt.column_string(2));
+}
+
 SchemaVersion Cache::get_schema_version()
 {
 	sqlite3_stmt* stmt{};
 	SchemaVersion result;
 
-	std::lock_guard<std::recursive_mutex> lock(mtx);
+	std::lock_guard<CacheMutex> lock(mtx);
 	int rc = sqlite3_prepare_v2(db,
 			"SELECT db_schema_version_major, db_schema_version_minor "
 			"FROM metadata",
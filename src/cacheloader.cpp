@@ -0,0 +1,143 @@
+#include "cacheloader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+#include "cache.h"
+#include "executor.h"
+#include "feedsnapshot.h"
+#include "logger.h"
+#include "rssfeed.h"
+#include "runtimestats.h"
+#include "scopemeasure.h"
+
+namespace newsboat {
+
+CacheLoader::CacheLoader(Cache& cache, RssIgnores* ign,
+	unsigned int num_threads, bool lazy)
+	: cache(cache)
+	, ign(ign)
+	, num_threads(std::max(num_threads, 1u))
+	, lazy(lazy && ign == nullptr)
+	, snapshot(nullptr)
+{
+}
+
+void CacheLoader::use_snapshot(const FeedSnapshot* s)
+{
+	snapshot = s;
+}
+
+std::vector<std::shared_ptr<RssFeed>> CacheLoader::load(
+		const std::vector<std::string>& urls,
+		ProgressCallback progress)
+{
+	ScopeMeasure m1("CacheLoader::load");
+	RuntimeStatsTimer timer(RuntimeStats::Counter::DATABASE_NS);
+	failed.clear();
+	return lazy ? load_in_parallel(urls, progress) : load_in_bulk(urls, progress);
+}
+
+std::vector<std::shared_ptr<RssFeed>> CacheLoader::load_in_bulk(
+		const std::vector<std::string>& urls,
+		ProgressCallback progress)
+{
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (const auto& url : urls) {
+		try {
+			feeds.push_back(std::make_shared<RssFeed>(&cache, url));
+		} catch (...) {
+			failed = url;
+			throw;
+		}
+	}
+
+	const unsigned int total = feeds.size();
+	unsigned int loaded = 0;
+	cache.internalize_rssfeeds(feeds, ign, [&]() {
+		++loaded;
+		if (progress) {
+			progress(loaded, total);
+		}
+	});
+	return feeds;
+}
+
+std::vector<std::shared_ptr<RssFeed>> CacheLoader::load_in_parallel(
+		const std::vector<std::string>& urls,
+		ProgressCallback progress)
+{
+	const unsigned int total = urls.size();
+	std::vector<std::shared_ptr<RssFeed>> feeds(total);
+	std::vector<std::exception_ptr> errors(total);
+
+	std::mutex progress_mutex;
+	unsigned int loaded = 0;
+
+	// The rest come from the cache
+	std::vector<unsigned int> pending;
+	for (unsigned int i = 0; i < total; ++i) {
+		if (snapshot != nullptr) {
+			feeds[i] = snapshot->make_feed(cache, urls[i]);
+		}
+		if (feeds[i] == nullptr) {
+			pending.push_back(i);
+		} else {
+			++loaded;
+			if (progress) {
+				progress(loaded, total);
+			}
+		}
+	}
+
+	std::atomic<unsigned int> next_index(0);
+	auto worker = [&]() {
+		for (;;) {
+			const unsigned int next = next_index++;
+			if (next >= pending.size()) {
+				break;
+			}
+			const unsigned int i = pending[next];
+			try {
+				feeds[i] = cache.internalize_rssfeed_lazily(urls[i]);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(progress_mutex);
+			++loaded;
+			if (progress) {
+				progress(loaded, total);
+			}
+		}
+	};
+
+	const unsigned int thread_count = std::min<unsigned int>(num_threads,
+			pending.size());
+	LOG(Level::DEBUG,
+		"CacheLoader::load: loading %u of %u feed(s) with %u thread(s)",
+		static_cast<unsigned int>(pending.size()),
+		total,
+		thread_count);
+
+	// The calling thread takes its share of the feeds too
+	Executor::instance().run_workers(Executor::Pool::CPU,
+		Executor::Priority::HIGH, thread_count, worker);
+
+	for (unsigned int i = 0; i < total; ++i) {
+		if (errors[i]) {
+			failed = urls[i];
+			std::rethrow_exception(errors[i]);
+		}
+	}
+	return feeds;
+}
+
+const std::string& CacheLoader::failed_url() const
+{
+	return failed;
+}
+
+} // namespace newsboat
@@ -0,0 +1,98 @@
+#include "cachewriter.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <exception>
+#include <vector>
+
+#include "cache.h"
+#include "logger.h"
+
+namespace newsboat {
+
+CacheWriter::CacheWriter(Cache& cache, Handler handler, std::size_t capacity)
+	: cache(cache)
+	, handler(handler)
+	, capacity(std::max<std::size_t>(capacity, 1))
+	, finished(false)
+	, writer_thread(&CacheWriter::run, this)
+{
+}
+
+CacheWriter::~CacheWriter()
+{
+	finish();
+}
+
+void CacheWriter::push(FeedUpdate update)
+{
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	queue_not_full.wait(lock, [this]() {
+		return queue.size() < capacity || finished;
+	});
+	if (finished) {
+		LOG(Level::ERROR, "CacheWriter::push: writer is finished, dropping update");
+		return;
+	}
+	queue.push_back(std::move(update));
+	queue_not_empty.notify_one();
+}
+
+void CacheWriter::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		finished = true;
+	}
+	queue_not_empty.notify_all();
+	queue_not_full.notify_all();
+
+	if (writer_thread.joinable()) {
+		writer_thread.join();
+	}
+}
+
+void CacheWriter::run()
+{
+	LOG(Level::DEBUG, "CacheWriter::run: started");
+	for (;;) {
+		std::vector<FeedUpdate> batch;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			queue_not_empty.wait(lock, [this]() {
+				return !queue.empty() || finished;
+			});
+			if (queue.empty()) {
+				// finished and drained
+				break;
+			}
+			batch.assign(std::make_move_iterator(queue.begin()),
+				std::make_move_iterator(queue.end()));
+			queue.clear();
+		}
+		queue_not_full.notify_all();
+
+		LOG(Level::DEBUG,
+			"CacheWriter::run: writing %" PRIu64 " feed(s)",
+			static_cast<uint64_t>(batch.size()));
+		try {
+			ScopeTransaction transaction(cache);
+			for (const auto& update : batch) {
+				try {
+					handler(update);
+				} catch (const std::exception& e) {
+					LOG(Level::ERROR,
+						"CacheWriter::run: failed to write a feed: %s",
+						e.what());
+				}
+			}
+		} catch (const std::exception& e) {
+			LOG(Level::ERROR,
+				"CacheWriter::run: failed to start a transaction: %s",
+				e.what());
+		}
+	}
+	LOG(Level::DEBUG, "CacheWriter::run: stopped");
+}
+
+} // namespace newsboat
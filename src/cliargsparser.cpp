@@ -46,6 +46,11 @@ bool CliArgsParser::do_cleanup() const
 	return newsboat::cliargsparser::bridged::do_cleanup(*rs_object);
 }
 
+bool CliArgsParser::dump_memory_stats() const
+{
+	return newsboat::cliargsparser::bridged::dump_memory_stats(*rs_object);
+}
+
 std::string CliArgsParser::importfile() const
 {
 	return std::string(newsboat::cliargsparser::bridged::importfile(*rs_object));
@@ -180,6 +185,17 @@ nonstd::optional<Level> CliArgsParser::log_level() const
 	return nonstd::nullopt;
 }
 
+std::vector<std::pair<std::string, Level>> CliArgsParser::log_modules() const
+{
+	std::vector<std::pair<std::string, Level>> modules;
+	for (const auto& module : newsboat::cliargsparser::bridged::log_modules(
+			*rs_object)) {
+		modules.emplace_back(std::string(module.name),
+			static_cast<Level>(module.level));
+	}
+	return modules;
+}
+
 const cliargsparser::bridged::CliArgsParser& CliArgsParser::get_rust_ref() const
 {
 	return *rs_object;
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <iostream>
 #include <pwd.h>
+#include <set>
 #include <sstream>
 #include <sys/types.h>
 
@@ -23,6 +24,9 @@ ConfigContainer::ConfigContainer()
 // create the config options and set their resp. default value and type
 	: config_data{{"always-display-description",
 		ConfigData("false", ConfigDataType::BOOL)},
+	{
+		"article-render-memory-limit",
+		ConfigData("8388608", ConfigDataType::INT)},
 	{
 		"article-sort-order",
 		ConfigData("date-asc", ConfigDataType::STR)},
@@ -30,6 +34,9 @@ ConfigContainer::ConfigContainer()
 		"articlelist-format",
 		ConfigData("%4i %f %D %6L  %?T?|%-17T|  &?%t",
 			ConfigDataType::STR)},
+	{
+		"articlelist-viewport-only",
+		ConfigData("no", ConfigDataType::BOOL)},
 	{"auto-reload", ConfigData("no", ConfigDataType::BOOL)},
 	{
 		"bookmark-autopilot",
@@ -42,33 +49,52 @@ ConfigContainer::ConfigContainer()
 		"browser",
 		ConfigData(utils::get_default_browser(),
 			ConfigDataType::PATH)},
+	{"cache-compress-content", ConfigData("no", ConfigDataType::BOOL)},
 	{"cache-file", ConfigData("", ConfigDataType::PATH)},
+	{"cache-memory-kb", ConfigData("16384", ConfigDataType::INT)},
+	{"cache-mmap-mb", ConfigData("256", ConfigDataType::INT)},
+	{"cache-page-size", ConfigData("4096", ConfigDataType::INT)},
+	{"cache-wal", ConfigData("no", ConfigDataType::BOOL)},
+	{"cleanup-in-background", ConfigData("yes", ConfigDataType::BOOL)},
 	{"cleanup-on-quit", ConfigData("yes", ConfigDataType::BOOL)},
 	{"confirm-delete-all-articles", ConfigData("yes", ConfigDataType::BOOL)},
 	{"confirm-mark-all-feeds-read", ConfigData("yes", ConfigDataType::BOOL)},
 	{"confirm-mark-feed-read", ConfigData("yes", ConfigDataType::BOOL)},
 	{"confirm-exit", ConfigData("no", ConfigDataType::BOOL)},
+	{"connection-cache", ConfigData("yes", ConfigDataType::BOOL)},
 	{"cookie-cache", ConfigData("", ConfigDataType::PATH)},
 	{"datetime-format", ConfigData("%b %d", ConfigDataType::STR)},
 	{
 		"delete-read-articles-on-quit",
 		ConfigData("false", ConfigDataType::BOOL)},
 	{"delete-played-files", ConfigData("false", ConfigDataType::BOOL)},
+	{
+		"description-memory-limit",
+		ConfigData("33554432", ConfigDataType::INT)},
 	{
 		"display-article-progress",
 		ConfigData("yes", ConfigDataType::BOOL)},
+	{"download-connect-timeout", ConfigData("10", ConfigDataType::INT)},
 	{
 		"download-filename-format",
 		ConfigData("%?u?%u&%Y-%b-%d-%H%M%S.unknown?",
 			ConfigDataType::STR)},
+	{"download-fsync", ConfigData("no", ConfigDataType::BOOL)},
 	{
 		"download-full-page",
 		ConfigData("false", ConfigDataType::BOOL)},
+	{"download-hedge-ip-family", ConfigData("no", ConfigDataType::BOOL)},
 	{"download-path", ConfigData("~/", ConfigDataType::PATH)},
 	{"download-retries", ConfigData("1", ConfigDataType::INT)},
+	{"download-segments", ConfigData("1", ConfigDataType::INT)},
 	{"download-timeout", ConfigData("30", ConfigDataType::INT)},
+	{"download-timeout-adaptive", ConfigData("yes", ConfigDataType::BOOL)},
 	{"error-log", ConfigData("", ConfigDataType::PATH)},
 	{"external-url-viewer", ConfigData("", ConfigDataType::PATH)},
+	{
+		"feed-parser",
+		ConfigData("streaming",
+		std::unordered_set<std::string>({"streaming", "tree"}))},
 	{
 		"feed-sort-order",
 		ConfigData("none-desc", ConfigDataType::STR)},
@@ -85,6 +111,8 @@ ConfigContainer::ConfigContainer()
 	{
 		"feedhq-url",
 		ConfigData("https://feedhq.org/", ConfigDataType::STR)},
+	{"fetch-results-dir", ConfigData("", ConfigDataType::PATH)},
+	{"fetch-shard", ConfigData("", ConfigDataType::STR)},
 	{"freshrss-flag-star", ConfigData("", ConfigDataType::STR)},
 	{"freshrss-login", ConfigData("", ConfigDataType::STR)},
 	{"freshrss-min-items", ConfigData("20", ConfigDataType::INT)},
@@ -94,16 +122,28 @@ ConfigContainer::ConfigContainer()
 	{
 		"freshrss-show-special-feeds",
 		ConfigData("true", ConfigDataType::BOOL)},
+	{
+		"freshrss-single-stream",
+		ConfigData("false", ConfigDataType::BOOL)},
 	{
 		"freshrss-url",
 		ConfigData("", ConfigDataType::STR)},
 	{
 		"feedlist-format",
 		ConfigData("%4i %n %11u %t", ConfigDataType::STR)},
+	{"feedlist-refresh-rate", ConfigData("4", ConfigDataType::INT)},
+	{
+		"feedlist-viewport-only",
+		ConfigData("no", ConfigDataType::BOOL)},
 	{"goto-first-unread", ConfigData("true", ConfigDataType::BOOL)},
 	{"goto-next-feed", ConfigData("yes", ConfigDataType::BOOL)},
+	{
+		"highlight-engine",
+		ConfigData("posix",
+		std::unordered_set<std::string>({"posix", "multi-pattern"}))},
 	{"history-limit", ConfigData("100", ConfigDataType::INT)},
 	{"html-renderer", ConfigData("internal", ConfigDataType::PATH)},
+	{"html-table-cell-width", ConfigData("0", ConfigDataType::INT)},
 	{
 		"http-auth-method",
 		ConfigData("any",
@@ -134,6 +174,8 @@ ConfigContainer::ConfigContainer()
 	{"inoreader-flag-star", ConfigData("", ConfigDataType::STR)},
 	{"inoreader-min-items", ConfigData("20", ConfigDataType::INT)},
 	{"keep-articles-days", ConfigData("0", ConfigDataType::INT)},
+	{"lazy-load-articles", ConfigData("no", ConfigDataType::BOOL)},
+	{"lazy-load-read-articles", ConfigData("no", ConfigDataType::BOOL)},
 	{
 		"mark-as-read-on-hover",
 		ConfigData("false", ConfigDataType::BOOL)},
@@ -143,7 +185,9 @@ ConfigContainer::ConfigContainer()
 		ConfigData("false", ConfigDataType::BOOL)},
 	{"max-download-speed", ConfigData("0", ConfigDataType::INT)},
 	{"max-downloads", ConfigData("1", ConfigDataType::INT)},
+	{"max-downloads-per-host", ConfigData("0", ConfigDataType::INT)},
 	{"max-items", ConfigData("0", ConfigDataType::INT)},
+	{"max-total-download-speed", ConfigData("0", ConfigDataType::INT)},
 	{"newsblur-login", ConfigData("", ConfigDataType::STR)},
 	{"newsblur-min-items", ConfigData("20", ConfigDataType::INT)},
 	{"newsblur-password", ConfigData("", ConfigDataType::STR)},
@@ -192,6 +236,7 @@ ConfigContainer::ConfigContainer()
 		ConfigData("false", ConfigDataType::BOOL)},
 	{"ssl-verifyhost", ConfigData("true", ConfigDataType::BOOL)},
 	{"ssl-verifypeer", ConfigData("true", ConfigDataType::BOOL)},
+	{"profile", ConfigData("no", ConfigDataType::BOOL)},
 	{"proxy", ConfigData("", ConfigDataType::STR)},
 	{"proxy-auth", ConfigData("", ConfigDataType::STR)},
 	{
@@ -213,12 +258,25 @@ ConfigContainer::ConfigContainer()
 			"socks5",
 			"socks5h"}))},
 	{"refresh-on-startup", ConfigData("no", ConfigDataType::BOOL)},
+	{"reload-adaptive", ConfigData("no", ConfigDataType::BOOL)},
+	{"reload-adaptive-max-time", ConfigData("1440", ConfigDataType::INT)},
+	{"reload-backoff-max-time", ConfigData("1440", ConfigDataType::INT)},
+	{"reload-host-delay", ConfigData("100", ConfigDataType::INT)},
+	{"reload-max-downloads", ConfigData("100", ConfigDataType::INT)},
+	{"reload-max-downloads-per-host", ConfigData("4", ConfigDataType::INT)},
 	{
 		"reload-only-visible-feeds",
 		ConfigData("false", ConfigDataType::BOOL)},
+	{"reload-parse-threads", ConfigData("0", ConfigDataType::INT)},
+	{"reload-plugin-processes", ConfigData("8", ConfigDataType::INT)},
+	{"reload-report-file", ConfigData("", ConfigDataType::PATH)},
 	{"reload-threads", ConfigData("1", ConfigDataType::INT)},
 	{"reload-time", ConfigData("60", ConfigDataType::INT)},
 	{"restrict-filename", ConfigData("yes", ConfigDataType::BOOL)},
+	{
+		"save-all-format",
+		ConfigData("files",
+			std::unordered_set<std::string>({"files", "mbox", "jsonl"}))},
 	{"save-path", ConfigData("~/", ConfigDataType::PATH)},
 	{"scrolloff", ConfigData("0", ConfigDataType::INT)},
 	{
@@ -229,6 +287,8 @@ ConfigContainer::ConfigContainer()
 	{
 		"selecttag-format",
 		ConfigData("%4i  %T (%u)", ConfigDataType::STR)},
+	{"shared-fetch-cache-dir", ConfigData("", ConfigDataType::PATH)},
+	{"shared-fetch-cache-max-age", ConfigData("15", ConfigDataType::INT)},
 	{"show-keymap-hint", ConfigData("yes", ConfigDataType::BOOL)},
 	{"show-title-bar", ConfigData("yes", ConfigDataType::BOOL)},
 	{"show-read-articles", ConfigData("yes", ConfigDataType::BOOL)},
@@ -240,11 +300,13 @@ ConfigContainer::ConfigContainer()
 		"swap-title-and-hints",
 		ConfigData("no", ConfigDataType::BOOL)},
 	{"text-width", ConfigData("0", ConfigDataType::INT)},
+	{"trace-file", ConfigData("", ConfigDataType::PATH)},
 	{
 		"toggleitemread-jumps-to-next-unread",
 		ConfigData("false", ConfigDataType::BOOL)},
 	{"ttrss-flag-publish", ConfigData("", ConfigDataType::STR)},
 	{"ttrss-flag-star", ConfigData("", ConfigDataType::STR)},
+	{"ttrss-incremental-sync", ConfigData("false", ConfigDataType::BOOL)},
 	{"ttrss-login", ConfigData("", ConfigDataType::STR)},
 	{
 		"ttrss-mode",
@@ -285,6 +347,7 @@ ConfigContainer::ConfigContainer()
 			"inoreader"}))},
 	{"use-proxy", ConfigData("no", ConfigDataType::BOOL)},
 	{"user-agent", ConfigData("", ConfigDataType::STR)},
+	{"websub-relay-dir", ConfigData("", ConfigDataType::PATH)},
 
 	/* title formats: */
 	{
@@ -332,7 +395,9 @@ ConfigContainer::ConfigContainer()
 		"wrap-scroll",
 		ConfigData("no", ConfigDataType::BOOL)},
 }
+, current_snapshot(nullptr)
 {
+	publish_snapshot();
 }
 
 ConfigContainer::~ConfigContainer()
@@ -402,6 +467,8 @@ void ConfigContainer::handle_action(const std::string& action,
 		// we already handled this at the beginning of the function
 		break;
 	}
+
+	changed(action);
 }
 
 std::string ConfigContainer::get_configvalue(const std::string& key) const
@@ -456,12 +523,14 @@ void ConfigContainer::set_configvalue(const std::string& key,
 		value);
 	std::lock_guard<std::recursive_mutex> guard(config_data_mtx);
 	config_data[key].set_value(value);
+	changed(key);
 }
 
 void ConfigContainer::reset_to_default(const std::string& key)
 {
 	std::lock_guard<std::recursive_mutex> guard(config_data_mtx);
 	config_data[key].reset_to_default();
+	changed(key);
 }
 
 void ConfigContainer::toggle(const std::string& key)
@@ -474,6 +543,58 @@ void ConfigContainer::toggle(const std::string& key)
 	}
 }
 
+void ConfigContainer::on_change(std::function<void(const std::string&)>
+	listener)
+{
+	std::lock_guard<std::recursive_mutex> guard(config_data_mtx);
+	change_listeners.push_back(std::move(listener));
+}
+
+void ConfigContainer::changed(const std::string& key)
+{
+	update_snapshot(key);
+	for (const auto& listener : change_listeners) {
+		listener(key);
+	}
+}
+
+void ConfigContainer::update_snapshot(const std::string& key)
+{
+	static const std::set<std::string> snapshot_keys = {
+		"always-display-description",
+		"datetime-format",
+		"download-full-page",
+		"ignore-mode",
+		"keep-articles-days",
+		"max-items",
+		"show-read-articles",
+	};
+	if (snapshot_keys.count(key) > 0) {
+		publish_snapshot();
+	}
+}
+
+void ConfigContainer::publish_snapshot()
+{
+	std::unique_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot);
+	snapshot->max_items = std::max(0, get_configvalue_as_int("max-items"));
+	snapshot->keep_articles_days =
+		std::max(0, get_configvalue_as_int("keep-articles-days"));
+	snapshot->ignore_mode = get_configvalue("ignore-mode") == "display"
+		? IgnoreMode::DISPLAY
+		: IgnoreMode::DOWNLOAD;
+	snapshot->show_read_articles =
+		get_configvalue_as_bool("show-read-articles");
+	snapshot->always_display_description =
+		get_configvalue_as_bool("always-display-description");
+	snapshot->download_full_page =
+		get_configvalue_as_bool("download-full-page");
+	snapshot->datetime_format = get_configvalue("datetime-format");
+
+	current_snapshot.store(snapshot.get(), std::memory_order_release);
+	snapshots.push_back(std::move(snapshot));
+}
+
 void ConfigContainer::dump_config(std::vector<std::string>& config_output) const
 {
 	std::lock_guard<std::recursive_mutex> guard(config_data_mtx);
@@ -0,0 +1,262 @@
+#include "contentcodec.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <zlib.h>
+
+namespace newsboat {
+
+namespace {
+
+const unsigned char FORMAT_DEFLATE = 1;
+const std::size_t HEADER_SIZE = 13;
+
+// Raw deflate streams; the header already says what's inside.
+const int WINDOW_BITS = -15;
+
+// Deflate can only refer back this far, so a larger dictionary is wasted.
+const std::size_t MAX_DICTIONARY_SIZE = 32768;
+
+// Markup shorter than this doesn't buy much when it's found in a dictionary.
+const std::size_t SEGMENT_SIZE = 16;
+const std::size_t MAX_SAMPLE_SIZE = 4096;
+
+void put_u32(std::string& out, std::uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+	}
+}
+
+std::uint32_t get_u32(const unsigned char* in)
+{
+	std::uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+std::uint64_t segment_hash(const char* segment)
+{
+	// FNV-1a
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < SEGMENT_SIZE; ++i) {
+		hash ^= static_cast<unsigned char>(segment[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+} // namespace
+
+void ContentCodec::add_dictionary(std::uint32_t id, const std::string& data)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	dictionaries[id] = std::make_shared<const std::string>(data);
+}
+
+bool ContentCodec::has_dictionary(std::uint32_t id) const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return dictionaries.count(id) > 0;
+}
+
+std::shared_ptr<const std::string> ContentCodec::dictionary(
+	std::uint32_t id) const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = dictionaries.find(id);
+	if (it == dictionaries.end()) {
+		return nullptr;
+	}
+	return it->second;
+}
+
+std::string ContentCodec::compress(const std::string& text,
+	std::uint32_t dictionary_id) const
+{
+	const auto dict = dictionary_id != 0 ? dictionary(dictionary_id) : nullptr;
+	if (dict == nullptr) {
+		dictionary_id = 0;
+	}
+
+	z_stream stream{};
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, WINDOW_BITS, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw std::runtime_error("ContentCodec: can't initialize deflate");
+	}
+	if (dict != nullptr) {
+		deflateSetDictionary(&stream,
+			reinterpret_cast<const Bytef*>(dict->data()),
+			dict->size());
+	}
+
+	std::string out;
+	out.push_back(static_cast<char>(FORMAT_DEFLATE));
+	put_u32(out, dictionary_id);
+	put_u32(out, text.size());
+	// Same count as SQLite's length(), so callers don't have to inflate
+	// the text just to find out how long it is
+	put_u32(out, std::count_if(text.begin(), text.end(), [](char c) {
+		return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+	}));
+	out.resize(HEADER_SIZE + deflateBound(&stream, text.size()));
+
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+	stream.avail_in = text.size();
+	stream.next_out = reinterpret_cast<Bytef*>(&out[HEADER_SIZE]);
+	stream.avail_out = out.size() - HEADER_SIZE;
+	const int rc = deflate(&stream, Z_FINISH);
+	out.resize(HEADER_SIZE + stream.total_out);
+	deflateEnd(&stream);
+	if (rc != Z_STREAM_END) {
+		throw std::runtime_error("ContentCodec: deflate failed");
+	}
+	return out;
+}
+
+std::string ContentCodec::decompress(const void* data, std::size_t size) const
+{
+	const auto in = static_cast<const unsigned char*>(data);
+	if (size < HEADER_SIZE || in[0] != FORMAT_DEFLATE) {
+		throw std::runtime_error("ContentCodec: unknown format");
+	}
+	const std::uint32_t dictionary_id = get_u32(in + 1);
+	const std::uint32_t length = get_u32(in + 5);
+
+	std::shared_ptr<const std::string> dict;
+	if (dictionary_id != 0) {
+		dict = dictionary(dictionary_id);
+		if (dict == nullptr) {
+			throw std::runtime_error("ContentCodec: unknown dictionary");
+		}
+	}
+
+	z_stream stream{};
+	if (inflateInit2(&stream, WINDOW_BITS) != Z_OK) {
+		throw std::runtime_error("ContentCodec: can't initialize inflate");
+	}
+	if (dict != nullptr) {
+		inflateSetDictionary(&stream,
+			reinterpret_cast<const Bytef*>(dict->data()),
+			dict->size());
+	}
+
+	std::string out(length, '\0');
+	stream.next_in = const_cast<Bytef*>(in + HEADER_SIZE);
+	stream.avail_in = size - HEADER_SIZE;
+	stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	stream.avail_out = length;
+	const int rc = inflate(&stream, Z_FINISH);
+	const auto total_out = stream.total_out;
+	inflateEnd(&stream);
+	if (rc != Z_STREAM_END || total_out != length) {
+		throw std::runtime_error("ContentCodec: corrupt data");
+	}
+	return out;
+}
+
+std::size_t ContentCodec::decompressed_size(const void* data, std::size_t size)
+{
+	const auto in = static_cast<const unsigned char*>(data);
+	if (size < HEADER_SIZE || in[0] != FORMAT_DEFLATE) {
+		return 0;
+	}
+	return get_u32(in + 5);
+}
+
+std::size_t ContentCodec::decompressed_length(const void* data,
+	std::size_t size)
+{
+	const auto in = static_cast<const unsigned char*>(data);
+	if (size < HEADER_SIZE || in[0] != FORMAT_DEFLATE) {
+		return 0;
+	}
+	return get_u32(in + 9);
+}
+
+std::string ContentCodec::train_dictionary(
+	const std::vector<std::string>& samples,
+	std::size_t max_size)
+{
+	max_size = std::min(max_size, MAX_DICTIONARY_SIZE);
+
+	// In how many samples does each segment occur?
+	std::unordered_map<std::uint64_t, unsigned int> counts;
+	for (const auto& sample : samples) {
+		const std::size_t size = std::min(sample.size(), MAX_SAMPLE_SIZE);
+		std::unordered_set<std::uint64_t> seen;
+		for (std::size_t pos = 0; pos + SEGMENT_SIZE <= size; ++pos) {
+			const auto hash = segment_hash(sample.data() + pos);
+			if (seen.insert(hash).second) {
+				counts[hash]++;
+			}
+		}
+	}
+
+	// Runs of common segments make up the candidates, scored by how
+	// often their segments occur.
+	const unsigned int threshold = std::max<std::size_t>(2, samples.size() / 10);
+	std::unordered_map<std::string, std::uint64_t> candidates;
+	for (const auto& sample : samples) {
+		const std::size_t size = std::min(sample.size(), MAX_SAMPLE_SIZE);
+		std::size_t begin = 0;
+		std::size_t end = 0;
+		std::uint64_t score = 0;
+		const auto add_run = [&]() {
+			if (end > begin) {
+				auto& best = candidates[sample.substr(begin, end - begin)];
+				best = std::max(best, score);
+			}
+		};
+		for (std::size_t pos = 0; pos + SEGMENT_SIZE <= size; ++pos) {
+			const unsigned int count = counts[segment_hash(sample.data() + pos)];
+			if (count < threshold) {
+				continue;
+			}
+			if (pos >= end) {
+				add_run();
+				begin = pos;
+				score = 0;
+			}
+			end = pos + SEGMENT_SIZE;
+			score += count;
+		}
+		add_run();
+	}
+
+	std::vector<std::pair<std::uint64_t, const std::string*>> ranked;
+	for (const auto& candidate : candidates) {
+		ranked.emplace_back(candidate.second, &candidate.first);
+	}
+	std::sort(ranked.begin(), ranked.end(),
+	[](const std::pair<std::uint64_t, const std::string*>& a,
+	const std::pair<std::uint64_t, const std::string*>& b) {
+		return a.first > b.first || (a.first == b.first && *a.second < *b.second);
+	});
+
+	std::vector<const std::string*> chosen;
+	std::size_t total = 0;
+	for (const auto& candidate : ranked) {
+		if (total + candidate.second->size() > max_size) {
+			continue;
+		}
+		chosen.push_back(candidate.second);
+		total += candidate.second->size();
+	}
+
+	// Deflate finds matches near the end of the dictionary more cheaply,
+	// so the most common text goes last.
+	std::string result;
+	result.reserve(total);
+	for (auto it = chosen.rbegin(); it != chosen.rend(); ++it) {
+		result.append(**it);
+	}
+	return result;
+}
+
+} // namespace newsboat
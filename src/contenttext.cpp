@@ -0,0 +1,110 @@
+#include "contenttext.h"
+
+#include <cctype>
+#include <strings.h>
+
+#include "tagsouppullparser.h"
+
+namespace newsboat {
+
+namespace {
+
+bool is_html(const std::string& mime_type)
+{
+	// The same types that ItemRenderer renders as HTML
+	return mime_type.empty()
+		|| mime_type == "html"
+		|| mime_type == "xhtml"
+		|| mime_type == "text/html"
+		|| mime_type == "application/xhtml+xml";
+}
+
+bool is_one_of(const std::string& tag, const char* const* names)
+{
+	for (; *names != nullptr; ++names) {
+		if (strcasecmp(tag.c_str(), *names) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Tags whose contents aren't text a reader sees
+bool hides_text(const std::string& tag)
+{
+	static const char* const names[] = {"script", "style", nullptr};
+	return is_one_of(tag, names);
+}
+
+/// Tags that start a new line or cell, so the words on either side of them
+/// don't run together
+bool breaks_text(const std::string& tag)
+{
+	static const char* const names[] = {
+		"address", "article", "aside", "blockquote", "br", "dd", "div",
+		"dl", "dt", "figcaption", "figure", "footer", "h1", "h2", "h3",
+		"h4", "h5", "h6", "header", "hr", "img", "li", "ol", "p", "pre",
+		"section", "table", "td", "th", "tr", "ul", nullptr
+	};
+	return is_one_of(tag, names);
+}
+
+void separate(std::string& text)
+{
+	if (!text.empty()
+		&& !std::isspace(static_cast<unsigned char>(text.back()))) {
+		text.push_back(' ');
+	}
+}
+
+}
+
+std::string content_text(const std::string& content,
+	const std::string& mime_type)
+{
+	if (!is_html(mime_type)
+		|| content.find_first_of("<&") == std::string::npos) {
+		return content;
+	}
+
+	TagSoupPullParser xpp(content);
+	xpp.set_skip_inline_images(true);
+	std::string text;
+	text.reserve(content.length() / 2);
+	unsigned int hidden = 0;
+	for (auto e = xpp.next(); e != TagSoupPullParser::Event::END_DOCUMENT;
+		e = xpp.next()) {
+		switch (e) {
+		case TagSoupPullParser::Event::START_TAG:
+			if (hides_text(xpp.get_text())) {
+				++hidden;
+			} else if (breaks_text(xpp.get_text())) {
+				separate(text);
+			}
+			break;
+		case TagSoupPullParser::Event::END_TAG:
+			if (hides_text(xpp.get_text())) {
+				if (hidden > 0) {
+					--hidden;
+				}
+			} else if (breaks_text(xpp.get_text())) {
+				separate(text);
+			}
+			break;
+		case TagSoupPullParser::Event::TEXT:
+			if (hidden == 0) {
+				text.append(xpp.get_text());
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	while (!text.empty()
+		&& std::isspace(static_cast<unsigned char>(text.back()))) {
+		text.pop_back();
+	}
+	return text;
+}
+
+} // namespace newsboat
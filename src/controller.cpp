@@ -1,11 +1,15 @@
 #include "controller.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <curl/curl.h>
+#include <fcntl.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -22,17 +26,25 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <thread>
 #include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "cacheloader.h"
 #include "cliargsparser.h"
 #include "colormanager.h"
 #include "config.h"
 #include "configcontainer.h"
 #include "configexception.h"
 #include "configpaths.h"
+#include "controlsocket.h"
 #include "dbexception.h"
+#include "descriptionlru.h"
 #include "exception.h"
+#include "executor.h"
 #include "feedhqapi.h"
+#include "feedsnapshot.h"
 #include "feedhqurlreader.h"
 #include "formaction.h"
 #include "freshrssapi.h"
@@ -41,23 +53,30 @@
 #include "inoreaderapi.h"
 #include "inoreaderurlreader.h"
 #include "itemrenderer.h"
+#include "jobprogress.h"
 #include "logger.h"
 #include "minifluxapi.h"
 #include "minifluxurlreader.h"
 #include "newsblurapi.h"
 #include "newsblururlreader.h"
+#include "nullconfigactionhandler.h"
 #include "ocnewsapi.h"
 #include "ocnewsurlreader.h"
 #include "oldreaderapi.h"
 #include "oldreaderurlreader.h"
 #include "opmlurlreader.h"
 #include "regexmanager.h"
+#include "reloaddaemon.h"
 #include "remoteapi.h"
+#include "rendercache.h"
 #include "rssfeed.h"
 #include "rssparser.h"
+#include "runtimestats.h"
 #include "scopemeasure.h"
+#include "scopestats.h"
 #include "stflpp.h"
 #include "strprintf.h"
+#include "tracelog.h"
 #include "ttrssapi.h"
 #include "ttrssurlreader.h"
 #include "utils.h"
@@ -77,19 +96,65 @@ void ignore_signal(int sig)
 	LOG(Level::WARN, "caught signal %d but ignored it", sig);
 }
 
+namespace {
+
+/// How many guids import_read_information() hands to the cache at once
+const std::size_t READINFO_CHUNK_SIZE = 10000;
+
+/// \brief Where the process that holds the lock, and is cleaning up the
+/// cache or is about to start a process that does, notes its PID.
+///
+/// Other instances wait for the lock rather than give up while it's held
+/// by that process.
+std::string cleanup_marker(const std::string& lock_file)
+{
+	return lock_file + ".cleanup";
+}
+
+pid_t read_cleanup_marker(const std::string& marker)
+{
+	std::ifstream f(marker);
+	pid_t pid = 0;
+	f >> pid;
+	return f ? pid : 0;
+}
+
+bool write_cleanup_marker(const std::string& marker)
+{
+	std::ofstream f(marker);
+	f << ::getpid();
+	f.close();
+	return !f.fail();
+}
+
+std::string snapshot_file(const std::string& cache_file)
+{
+	return cache_file + ".snapshot";
+}
+
+}
+
 Controller::Controller(ConfigPaths& configpaths)
 	: v(0)
 	, urlcfg(0)
 	, rsscache(0)
 	, refresh_on_start(false)
+	, stub_feeds(false)
 	, api(0)
 	, configpaths(configpaths)
 	, queueManager(&cfg, configpaths.queue_file())
 {
+	item_change_log.subscribe([this](const ItemChanges& changes) {
+		autoenqueue(changes);
+	});
 }
 
 Controller::~Controller()
 {
+	ScopeStats::log_all();
+	TraceLog::finish();
+
+	outbox.reset();
 	delete rsscache;
 	delete urlcfg;
 	delete api;
@@ -114,6 +179,11 @@ int Controller::run(const CliArgsParser& args)
 
 	if (args.log_level().has_value()) {
 		logger::set_loglevel(args.log_level().value());
+		ScopeStats::set_enabled(args.log_level().value() == Level::DEBUG);
+	}
+
+	for (const auto& module : args.log_modules()) {
+		logger::set_module_loglevel(module.first, module.second);
 	}
 
 	if (!args.display_msg().empty()) {
@@ -173,9 +243,16 @@ int Controller::run(const CliArgsParser& args)
 	cfgparser.register_handler("highlight-article", rxman);
 	cfgparser.register_handler("highlight-feed", rxman);
 
+	// Podboat's, which reads the same file
+	NullConfigActionHandler null_cah;
+	cfgparser.register_handler("download-speed-schedule", null_cah);
+
+	// The regexes of `highlight` rules are all compiled at once at the end
+	rxman.defer_compiling();
 	try {
 		cfgparser.parse_file("/etc/" PACKAGE "/config");
 		cfgparser.parse_file(configpaths.config_file());
+		rxman.compile_deferred();
 	} catch (const ConfigException& ex) {
 		LOG(Level::ERROR,
 			"an exception occurred while parsing the configuration "
@@ -197,10 +274,47 @@ int Controller::run(const CliArgsParser& args)
 		configpaths.set_cache_file(cachefilepath);
 	}
 
+	// A daemon that owns the cache executes the commands in its stead
+	const auto cmds_to_execute = args.cmds_to_execute();
+	const std::string daemon_socket = ReloadDaemon::socket_path(
+			configpaths.cache_file());
+	const bool starts_daemon = std::find(cmds_to_execute.begin(),
+			cmds_to_execute.end(), "daemon") != cmds_to_execute.end();
+	if (!cmds_to_execute.empty() && !starts_daemon) {
+		const auto forwarded = ReloadDaemon::forward_commands(daemon_socket,
+				cmds_to_execute);
+		if (forwarded.has_value()) {
+			return forwarded.value();
+		}
+	}
+
+	const std::string marker = cleanup_marker(configpaths.lock_file());
 	pid_t pid;
 	std::string error;
-	if (!fslock.try_lock(configpaths.lock_file(), pid, error)) {
-		if (pid != 0) {
+	bool waiting_for_cleanup = false;
+	while (!fslock.try_lock(configpaths.lock_file(), pid, error)) {
+		// The last session quit, and its cache is still being cleaned up
+		if (pid != 0 && pid == read_cleanup_marker(marker)) {
+			if (!waiting_for_cleanup && !args.silent()) {
+				std::cout << _("Waiting for the cache to be cleaned up...")
+					<< std::endl;
+			}
+			waiting_for_cleanup = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		std::string answer;
+		if (pid != 0 && ControlSocket::send(daemon_socket, "print-unread",
+				answer)) {
+			std::cout << strprintf::fmt(
+					_("Error: %s is running as a daemon (PID: %s); "
+						"`%s -x quit' stops it"),
+					PROGRAM_NAME,
+					std::to_string(pid),
+					PROGRAM_NAME)
+				<< std::endl;
+		} else if (pid != 0) {
 			std::cout << strprintf::fmt(
 					_("Error: an instance of %s is "
 						"already running (PID: %s)"),
@@ -212,11 +326,36 @@ int Controller::run(const CliArgsParser& args)
 		}
 		return EXIT_FAILURE;
 	}
+	// Whoever left the marker is gone, unless it's us starting a cleanup
+	if (args.do_cleanup()) {
+		write_cleanup_marker(marker);
+	} else {
+		std::remove(marker.c_str());
+	}
 
 	if (!args.silent()) {
 		std::cout << _("Opening cache...");
 		std::cout.flush();
 	}
+	rxman.set_multi_pattern(
+		cfg.get_configvalue("highlight-engine") == "multi-pattern");
+	if (cfg.get_configvalue_as_bool("profile")) {
+		ScopeStats::set_enabled(true);
+	}
+	if (!cfg.get_configvalue("trace-file").empty()) {
+		TraceLog::start(cfg.get_configvalue("trace-file"));
+	}
+	DescriptionLru::shared().set_max_bytes(std::max(0,
+			cfg.get_configvalue_as_int("description-memory-limit")));
+	RenderCache::shared().set_max_bytes(std::max(0,
+			cfg.get_configvalue_as_int("article-render-memory-limit")));
+	// The API requests of a remote source are made as many at a time as
+	// the feeds are reloaded
+	auto& executor = Executor::instance();
+	executor.set_max_threads(Executor::Pool::IO,
+		std::max<unsigned int>(executor.max_threads(Executor::Pool::IO),
+			std::max(0, cfg.get_configvalue_as_int("reload-threads"))));
+
 	try {
 		rsscache = new Cache(configpaths.cache_file(), &cfg);
 	} catch (const DbException& e) {
@@ -242,7 +381,8 @@ int Controller::run(const CliArgsParser& args)
 	}
 
 	reloader =
-		std::unique_ptr<Reloader>(new Reloader(this, rsscache, &cfg));
+		std::unique_ptr<Reloader>(new Reloader(this, rsscache, &cfg,
+				configpaths.cache_file() + ".connections"));
 
 	std::string type = cfg.get_configvalue("urls-source");
 	if (type == "local") {
@@ -359,6 +499,13 @@ int Controller::run(const CliArgsParser& args)
 			std::cout << "Authentication failed." << std::endl;
 			return EXIT_FAILURE;
 		}
+		// The UI starts with the feeds the server listed last time, and
+		// asks for them again once it's up. Everything else needs the
+		// current list right away.
+		const bool starts_ui = !args.do_export() && !args.do_vacuum()
+			&& !args.do_cleanup() && !args.readinfo_import_file()
+			&& !args.readinfo_export_file() && args.cmds_to_execute().empty();
+		api->cache_subscriptions(rsscache, type, starts_ui);
 	}
 	const auto error_message = urlcfg->reload();
 	if (error_message.has_value()) {
@@ -418,6 +565,19 @@ int Controller::run(const CliArgsParser& args)
 		return EXIT_FAILURE;
 	}
 
+	if (api) {
+		// The read state of the cached articles is brought up to date
+		// before they're loaded, which doesn't need their content. It's
+		// done before the outbox sends what's queued, which the server
+		// doesn't know about yet, and which is left alone.
+		if (!args.do_export() && !args.do_vacuum() && !args.do_cleanup()) {
+			sync_unread_state();
+		}
+		// This also sends the changes that couldn't be sent last time
+		outbox.reset(new RemoteOutbox(*rsscache, *api));
+		outbox->start();
+	}
+
 	if (args.do_vacuum()) {
 		std::cout << _("Opening cache...");
 		std::cout << _("done.") << std::endl;
@@ -428,50 +588,122 @@ int Controller::run(const CliArgsParser& args)
 		return EXIT_SUCCESS;
 	}
 
-	if (!args.do_export() && !args.silent()) {
-		std::cout << _("Loading articles from cache...");
+	const bool show_load_progress = !args.do_export() && !args.silent();
+	const std::string loading_msg = _("Loading articles from cache...");
+	if (show_load_progress) {
+		std::cout << loading_msg;
 	}
 	std::cout.flush();
 
-	unsigned int i = 0;
-	for (const auto& url : urlcfg->get_urls()) {
-		try {
-			bool ignore_disp =
-				(cfg.get_configvalue("ignore-mode") ==
-					"display");
-			std::shared_ptr<RssFeed> feed =
-				rsscache->internalize_rssfeed(
-					url, ignore_disp ? &ign : nullptr);
-			feed->set_tags(urlcfg->get_tags(url));
-			feed->set_order(i);
-			feedcontainer.add_feed(feed);
-		} catch (const DbException& e) {
-			std::cout << _("Error while loading feeds from "
-					"database: ")
-				<< e.what() << std::endl;
-			return EXIT_FAILURE;
-		} catch (const std::string& str) {
-			std::cout << strprintf::fmt(
-					_("Error while loading feed '%s': "
-						"%s"),
-					url,
-					str)
-				<< std::endl;
-			return EXIT_FAILURE;
+	// Reloads started from the command line write the articles to the
+	// cache, and count what's unread there; a cleanup only needs the URLs.
+	// Nothing needs the articles in memory
+	stub_feeds = args.do_cleanup() || (!cmds_to_execute.empty() && std::all_of(
+				cmds_to_execute.begin(), cmds_to_execute.end(),
+	[](const std::string& cmd) {
+		return cmd == "reload" || cmd == "print-unread";
+	}));
+
+	const bool ignore_disp = (cfg.snapshot().ignore_mode == IgnoreMode::DISPLAY);
+	CacheLoader loader(*rsscache,
+		ignore_disp ? &ign : nullptr,
+		std::thread::hardware_concurrency(),
+		cfg.get_configvalue_as_bool("lazy-load-articles"));
+	// Anything that synced with a remote API changed the cache since the
+	// snapshot was written
+	const bool lazy_load = !ignore_disp && !stub_feeds && api == nullptr
+		&& cfg.get_configvalue_as_bool("lazy-load-articles");
+	std::unique_ptr<FeedSnapshot> snapshot;
+	if (lazy_load) {
+		snapshot.reset(new FeedSnapshot(snapshot_file(configpaths.cache_file()),
+				rsscache->snapshot_token()));
+		loader.use_snapshot(snapshot.get());
+	}
+	auto urls = urlcfg->get_urls();
+	std::string counter;
+	try {
+		std::vector<std::shared_ptr<RssFeed>> feeds;
+		if (stub_feeds) {
+			// Query feeds have nothing to reload
+			urls.erase(std::remove_if(urls.begin(), urls.end(),
+			[](const std::string& url) {
+				return utils::is_query_url(url);
+			}), urls.end());
+			for (const auto& url : urls) {
+				feeds.push_back(std::make_shared<RssFeed>(rsscache, url));
+			}
+		} else {
+			feeds = loader.load(urls,
+			[&](unsigned int loaded, unsigned int total) {
+				if (show_load_progress) {
+					counter = strprintf::fmt(" %u/%u", loaded, total);
+					std::cout << "\r" << loading_msg << counter;
+					std::cout.flush();
+				}
+			});
+		}
+		for (unsigned int i = 0; i < feeds.size(); ++i) {
+			feeds[i]->set_tags(urlcfg->get_tags(urls[i]));
+			feeds[i]->set_order(i);
 		}
-		i++;
+		feedcontainer.set_feeds(feeds);
+	} catch (const DbException& e) {
+		std::cout << std::endl
+			<< _("Error while loading feeds from "
+				"database: ")
+			<< e.what() << std::endl;
+		return EXIT_FAILURE;
+	} catch (const std::string& str) {
+		std::cout << std::endl
+			<< strprintf::fmt(
+				_("Error while loading feed '%s': "
+					"%s"),
+				loader.failed_url(),
+				str)
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+	snapshot.reset();
+	if (show_load_progress) {
+		// Go back to overwrite the counter with "done."
+		std::cout << "\r" << loading_msg;
 	}
 
 	std::vector<std::string> tags = urlcfg->get_alltags();
 
-	if (!args.do_export() && !args.silent()) {
-		std::cout << _("done.") << std::endl;
+	if (show_load_progress) {
+		const std::string done = _("done.");
+		std::cout << done;
+		if (counter.length() > done.length()) {
+			std::cout << std::string(counter.length() - done.length(), ' ');
+		}
+		std::cout << std::endl;
 	}
 
 	if (args.do_cleanup()) {
 		std::cout << _("Cleaning up cache...");
 		std::cout.flush();
 		rsscache->cleanup_cache(feedcontainer.get_all_feeds(), true);
+		// The session that started us quit without writing a snapshot, as
+		// it would have been of the cache before the cleanup. The next
+		// start waits for the marker, so it gets this one.
+		if (!ignore_disp && cfg.get_configvalue_as_bool("lazy-load-articles")) {
+			try {
+				feedcontainer.set_feeds(loader.load(urls));
+				write_snapshot();
+			} catch (const DbException& e) {
+				LOG(Level::ERROR,
+					"Controller::run: couldn't read the feeds for a "
+					"snapshot: %s",
+					e.what());
+			} catch (const std::string& str) {
+				LOG(Level::ERROR,
+					"Controller::run: couldn't read %s for a snapshot: %s",
+					loader.failed_url(),
+					str);
+			}
+		}
+		std::remove(marker.c_str());
 		std::cout << _("done.") << std::endl;
 		return EXIT_SUCCESS;
 	}
@@ -494,6 +726,18 @@ int Controller::run(const CliArgsParser& args)
 
 	feedcontainer.sort_feeds(cfg.get_feed_sort_strategy());
 
+	if (args.dump_memory_stats()) {
+		// The most that this cache and configuration make Newsboat hold
+		for (const auto& feed : feedcontainer.get_all_feeds()) {
+			if (!feed->is_query_feed()) {
+				feed->items();
+			}
+		}
+		feedcontainer.populate_query_feeds();
+		std::cout << memory_stats().dump(2) << std::endl;
+		return EXIT_SUCCESS;
+	}
+
 	if (args.do_export()) {
 		export_opml();
 		return EXIT_SUCCESS;
@@ -527,10 +771,8 @@ int Controller::run(const CliArgsParser& args)
 	v->set_tags(tags);
 	v->set_cache(rsscache);
 
-	const auto cmds_to_execute = args.cmds_to_execute();
 	if (cmds_to_execute.size() >= 1) {
-		execute_commands(cmds_to_execute);
-		return EXIT_SUCCESS;
+		return execute_commands(cmds_to_execute);
 	}
 
 	// if the user wants to refresh on startup via configuration file, then
@@ -546,6 +788,10 @@ int Controller::run(const CliArgsParser& args)
 	// run the View
 	int ret = v->run();
 
+	if (outbox) {
+		outbox->stop();
+	}
+
 	unsigned int history_limit =
 		cfg.get_configvalue_as_int("history-limit");
 	LOG(Level::DEBUG, "Controller::run: history-limit = %u", history_limit);
@@ -553,6 +799,14 @@ int Controller::run(const CliArgsParser& args)
 		configpaths.cmdline_file(),
 		history_limit);
 
+	// Remote APIs would have to be asked for the feeds again
+	if (cfg.get_configvalue_as_bool("cleanup-on-quit")
+		&& cfg.get_configvalue_as_bool("cleanup-in-background")
+		&& cfg.get_configvalue("urls-source") == "local"
+		&& start_background_cleanup(args.program_name())) {
+		return ret;
+	}
+
 	if (!args.silent()) {
 		std::cout << _("Cleaning up cache...");
 		std::cout.flush();
@@ -560,6 +814,7 @@ int Controller::run(const CliArgsParser& args)
 	try {
 		const auto unreachable_feeds = rsscache->cleanup_cache(
 				feedcontainer.get_all_feeds());
+		write_snapshot();
 		if (!args.silent()) {
 			std::cout << _("done.") << std::endl;
 			if (!unreachable_feeds.empty()) {
@@ -585,6 +840,190 @@ int Controller::run(const CliArgsParser& args)
 	return ret;
 }
 
+void Controller::write_snapshot()
+{
+	if (api != nullptr || !cfg.get_configvalue_as_bool("lazy-load-articles")) {
+		return;
+	}
+	const auto now = std::chrono::system_clock::now().time_since_epoch();
+	const std::string token = strprintf::fmt("%" PRIu64 "-%u",
+			static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()),
+			static_cast<unsigned int>(::getpid()));
+	if (FeedSnapshot::write(snapshot_file(configpaths.cache_file()), token,
+			feedcontainer.get_all_feeds())) {
+		rsscache->set_snapshot_token(token);
+	}
+}
+
+bool Controller::start_background_cleanup(const std::string& program_name)
+{
+	const std::string marker = cleanup_marker(configpaths.lock_file());
+	if (!write_cleanup_marker(marker)) {
+		return false;
+	}
+
+	std::vector<std::string> arguments = {
+		program_name, "--cleanup",
+		"-u", configpaths.url_file(),
+		"-c", configpaths.cache_file(),
+		"-C", configpaths.config_file(),
+	};
+	std::vector<char*> argv;
+	for (auto& argument : arguments) {
+		argv.push_back(&argument[0]);
+	}
+	argv.push_back(nullptr);
+
+	// Closed by a successful exec, or written the errno of a failed one
+	int status_pipe[2];
+	if (::pipe(status_pipe) == -1) {
+		std::remove(marker.c_str());
+		return false;
+	}
+	::fcntl(status_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	// The child only starts the grandchild, which outlives us in a session
+	// of its own; nothing but async-signal-safe calls happen after fork
+	const pid_t child = ::fork();
+	if (child == 0) {
+		const pid_t grandchild = ::fork();
+		if (grandchild == -1) {
+			const int fork_errno = errno;
+			if (::write(status_pipe[1], &fork_errno, sizeof(fork_errno)) < 0) {
+				// Nothing left to report it to
+			}
+		} else if (grandchild == 0) {
+			::setsid();
+			const int devnull = ::open("/dev/null", O_RDWR);
+			::dup2(devnull, STDIN_FILENO);
+			::dup2(devnull, STDOUT_FILENO);
+			::dup2(devnull, STDERR_FILENO);
+			::execvp(argv[0], argv.data());
+			const int exec_errno = errno;
+			if (::write(status_pipe[1], &exec_errno, sizeof(exec_errno)) < 0) {
+				// Nothing left to report it to
+			}
+		}
+		::_exit(EXIT_SUCCESS);
+	}
+	::close(status_pipe[1]);
+
+	bool started = false;
+	if (child != -1) {
+		::waitpid(child, nullptr, 0);
+		int exec_errno = 0;
+		started = ::read(status_pipe[0], &exec_errno, sizeof(exec_errno)) == 0;
+		if (!started) {
+			LOG(Level::ERROR,
+				"Controller::start_background_cleanup: couldn't start %s: %s",
+				program_name,
+				std::strerror(exec_errno));
+		}
+	}
+	::close(status_pipe[0]);
+
+	if (!started) {
+		std::remove(marker.c_str());
+		return false;
+	}
+	LOG(Level::INFO,
+		"Controller::start_background_cleanup: cleaning up the cache in "
+		"the background");
+	return true;
+}
+
+UnreadCounts Controller::unread_counts()
+{
+	if (!stub_feeds) {
+		return UnreadCounts{feedcontainer.unread_feed_count(),
+				feedcontainer.unread_item_count()};
+	}
+
+	const auto unread_guids = rsscache->fetch_unread_guids();
+	UnreadCounts counts{0, 0};
+	// Like FeedContainer::unread_item_count(), articles that are in
+	// several feeds count once, and those of hidden feeds don't count
+	std::unordered_set<std::string> articles;
+	for (const auto& feed : *feedcontainer.get_feeds_snapshot()) {
+		const auto guids = unread_guids.find(feed->rssurl());
+		if (guids == unread_guids.end() || guids->second.empty()) {
+			continue;
+		}
+		++counts.feeds;
+		if (!feed->hidden()) {
+			articles.insert(guids->second.begin(), guids->second.end());
+		}
+	}
+	counts.articles = articles.size();
+	return counts;
+}
+
+nlohmann::json Controller::runtime_stats()
+{
+	auto stats = RuntimeStats::snapshot();
+
+	const auto descriptions = DescriptionLru::shared().stats();
+	const auto lookups = descriptions.hits + descriptions.misses;
+	stats["caches"]["descriptions"] = {
+		{"hits", descriptions.hits},
+		{"misses", descriptions.misses},
+		{"hit_rate_percent", lookups > 0 ? 100.0 * descriptions.hits / lookups : 0.0},
+		{"evictions", descriptions.evictions},
+		{"entries", descriptions.entries},
+		{"bytes", descriptions.bytes},
+	};
+	stats["caches"]["rendered_articles"] = {
+		{"entries", RenderCache::shared().size()},
+		{"bytes", RenderCache::shared().bytes()},
+	};
+	stats["memory"] = memory_stats();
+	return stats;
+}
+
+nlohmann::json Controller::memory_stats()
+{
+	// Query feeds hold articles of the other feeds, which count only once
+	std::size_t items = 0;
+	RssFeed::MemoryUsage usage{0, 0, 0, 0};
+	std::size_t query_feed_bytes = 0;
+	const auto feeds = feedcontainer.get_feeds_snapshot();
+	for (const auto& feed : *feeds) {
+		const auto feed_usage = feed->memory_usage();
+		if (feed->is_query_feed()) {
+			query_feed_bytes += feed_usage.index_bytes;
+			continue;
+		}
+		items += feed->items_loaded() ? feed->total_item_count() : 0;
+		usage.item_bytes += feed_usage.item_bytes;
+		usage.description_bytes += feed_usage.description_bytes;
+		usage.index_bytes += feed_usage.index_bytes;
+		usage.summary_bytes += feed_usage.summary_bytes;
+	}
+
+	const std::size_t description_bytes = usage.description_bytes
+		+ DescriptionLru::shared().stats().bytes;
+	const std::size_t list_line_bytes = std::max<std::int64_t>(0,
+			RuntimeStats::get(RuntimeStats::Counter::LIST_LINE_BYTES));
+	const std::size_t rendered_article_bytes = RenderCache::shared().bytes();
+	const std::size_t accounted_bytes = usage.item_bytes + description_bytes
+		+ usage.index_bytes + usage.summary_bytes + query_feed_bytes
+		+ list_line_bytes + rendered_article_bytes;
+	return {
+		{"feeds", feeds->size()},
+		{"items_loaded", items},
+		{"item_bytes", usage.item_bytes},
+		{"description_bytes", description_bytes},
+		{"guid_index_bytes", usage.index_bytes},
+		{"item_summary_bytes", usage.summary_bytes},
+		{"query_feed_bytes", query_feed_bytes},
+		{"list_line_bytes", list_line_bytes},
+		{"rendered_article_bytes", rendered_article_bytes},
+		{"accounted_bytes", accounted_bytes},
+		{"resident_bytes", RuntimeStats::resident_bytes()},
+	};
+}
+
 void Controller::update_feedlist()
 {
 	v->set_feedlist(feedcontainer.get_all_feeds());
@@ -608,7 +1047,7 @@ void Controller::mark_all_read(const std::string& feedurl)
 
 	if (feedurl.empty()) { // Mark all feeds as read
 		if (api) {
-			for (const auto& feed : feedcontainer.get_all_feeds()) {
+			for (const auto& feed : *feedcontainer.get_feeds_snapshot()) {
 				api->mark_all_read(feed->rssurl());
 			}
 		}
@@ -629,8 +1068,8 @@ void Controller::mark_all_read(const std::string& feedurl)
 
 void Controller::mark_article_read(const std::string& guid, bool read)
 {
-	if (api) {
-		api->mark_article_read(guid, read);
+	if (outbox) {
+		outbox->mark_article_read(guid, read);
 	}
 }
 
@@ -643,16 +1082,20 @@ void Controller::mark_all_read(unsigned int pos)
 	}
 
 	if (feed->is_query_feed()) {
-		if (api) {
-			std::vector<std::string> item_guids;
+		// Its articles are in other feeds, and only the unread ones change
+		std::vector<std::string> item_guids;
+		{
+			const auto lock = feed->lock_items_for_reading();
 			for (const auto& item : feed->items()) {
 				if (item->unread()) {
 					item_guids.push_back(item->guid());
 				}
 			}
-			api->mark_articles_read(item_guids);
 		}
-		rsscache->mark_all_read(feed);
+		if (outbox) {
+			outbox->mark_articles_read(item_guids);
+		}
+		rsscache->mark_items_read_by_guid(item_guids);
 	} else {
 		rsscache->mark_all_read(feed->rssurl());
 		if (api) {
@@ -669,34 +1112,85 @@ void Controller::mark_all_read(unsigned int pos)
 void Controller::mark_all_read(const std::vector<std::string>& item_guids)
 {
 	ScopeMeasure m("Controller::mark_all_read");
-	if (api) {
-		api->mark_articles_read(item_guids);
+	if (outbox) {
+		outbox->mark_articles_read(item_guids);
 	}
 }
 
-void Controller::replace_feed(std::shared_ptr<RssFeed> oldfeed,
+unsigned int Controller::replace_feed(std::shared_ptr<RssFeed> oldfeed,
 	std::shared_ptr<RssFeed> newfeed,
 	unsigned int pos,
 	bool unattended)
 {
 	LOG(Level::DEBUG, "Controller::replace_feed: saving");
-	rsscache->externalize_rssfeed(
-		newfeed, ign.matches_resetunread(newfeed->rssurl()));
-	LOG(Level::DEBUG,
-		"Controller::replace_feed: after externalize_rssfeed");
-
-	bool ignore_disp = (cfg.get_configvalue("ignore-mode") == "display");
-	std::shared_ptr<RssFeed> feed = rsscache->internalize_rssfeed(
-			oldfeed->rssurl(), ignore_disp ? &ign : nullptr);
+	ItemChanges changes;
+	// Unless the enqueued flags are needed, stubs stay as they are
+	if (stub_feeds && !cfg.get_configvalue_as_bool("podcast-auto-enqueue")) {
+		const unsigned int added = rsscache->externalize_rssfeed(newfeed,
+				ign.matches_resetunread(newfeed->rssurl()), &changes);
+		item_change_log.publish(changes);
+		return added;
+	}
+
+	bool ignore_disp = (cfg.snapshot().ignore_mode == IgnoreMode::DISPLAY);
+	unsigned int added = 0;
+	std::shared_ptr<RssFeed> feed = rsscache->merge_rssfeed(oldfeed, newfeed,
+			ign.matches_resetunread(newfeed->rssurl()),
+			ignore_disp ? &ign : nullptr,
+			&added,
+			&changes);
 	LOG(Level::DEBUG,
-		"Controller::replace_feed: after internalize_rssfeed");
+		"Controller::replace_feed: after merge_rssfeed");
 
 	feed->set_tags(urlcfg->get_tags(oldfeed->rssurl()));
 	feed->set_order(oldfeed->get_order());
 	feedcontainer.replace_feed(pos, feed);
+	item_change_log.publish(changes);
 
-	if (cfg.get_configvalue_as_bool("podcast-auto-enqueue")) {
-		const auto result = queueManager.autoenqueue(feed);
+	v->notify_itemlist_change(feed);
+	if (!unattended) {
+		v->request_feedlist_update();
+	}
+	return added;
+}
+
+void Controller::autoenqueue(const ItemChanges& changes)
+{
+	if (!cfg.get_configvalue_as_bool("podcast-auto-enqueue")) {
+		return;
+	}
+
+	// The articles that arrived or changed, by feed; the rest had their
+	// chance when they did
+	std::unordered_map<std::string, std::vector<std::string>> guids;
+	for (const auto& change : changes) {
+		if (change.kind != ItemChange::Kind::UNREAD) {
+			guids[change.feedurl].push_back(change.guid);
+		}
+	}
+
+	for (const auto& feed_guids : guids) {
+		const auto feed = feedcontainer.get_feed_by_url(feed_guids.first);
+		if (feed == nullptr) {
+			continue;
+		}
+		std::vector<std::shared_ptr<RssItem>> not_enqueued;
+		for (const auto& guid : feed_guids.second) {
+			const auto item = feed->get_item_by_guid(guid);
+			// Articles that the ignore rules hid aren't in the feed
+			if (item->guid() == guid && !item->enqueued()) {
+				not_enqueued.push_back(item);
+			}
+		}
+		if (not_enqueued.empty()) {
+			continue;
+		}
+		const auto result = queueManager.autoenqueue(feed, not_enqueued);
+		for (const auto& item : not_enqueued) {
+			if (item->enqueued()) {
+				rsscache->update_rssitem_unread_and_enqueued(item, feed->rssurl());
+			}
+		}
 		switch (result.status) {
 		case EnqueueStatus::QUEUED_SUCCESSFULLY:
 		case EnqueueStatus::URL_QUEUED_ALREADY:
@@ -713,15 +1207,6 @@ void Controller::replace_feed(std::shared_ptr<RssFeed> oldfeed,
 			break;
 		}
 	}
-
-	for (const auto& item : feed->items()) {
-		rsscache->update_rssitem_unread_and_enqueued(item, feed->rssurl());
-	}
-
-	v->notify_itemlist_change(feed);
-	if (!unattended) {
-		v->set_feedlist(feedcontainer.get_all_feeds());
-	}
 }
 
 int Controller::import_opml(const std::string& opmlFile,
@@ -766,7 +1251,26 @@ void Controller::export_opml()
 
 std::vector<std::shared_ptr<RssItem>> Controller::search_for_items(
 		const std::string& query,
-		std::shared_ptr<RssFeed> feed)
+		std::shared_ptr<RssFeed> feed,
+		const JobProgress* progress)
+{
+	std::vector<std::shared_ptr<RssItem>> items;
+	try {
+		items = search_cache(query, feed, progress);
+	} catch (const DbException&) {
+		if (progress == nullptr || !progress->is_cancelled()) {
+			throw;
+		}
+		// The query was interrupted
+		items.clear();
+	}
+	return items;
+}
+
+std::vector<std::shared_ptr<RssItem>> Controller::search_cache(
+		const std::string& query,
+		std::shared_ptr<RssFeed> feed,
+		const JobProgress* progress)
 {
 	std::vector<std::shared_ptr<RssItem>> items;
 	if (feed && (feed->is_query_feed() || feed->is_search_feed())) {
@@ -776,7 +1280,7 @@ std::vector<std::shared_ptr<RssItem>> Controller::search_for_items(
 				guids.insert(item->guid());
 			}
 		}
-		guids = rsscache->search_in_items(query, guids);
+		guids = rsscache->search_in_items(query, guids, progress);
 		for (const auto& item : feed->items()) {
 			if (guids.find(item->guid()) != guids.end()) {
 				items.push_back(item);
@@ -784,7 +1288,7 @@ std::vector<std::shared_ptr<RssItem>> Controller::search_for_items(
 		}
 	} else {
 		items = rsscache->search_for_items(
-				query, (feed != nullptr ? feed->rssurl() : ""), ign);
+				query, (feed != nullptr ? feed->rssurl() : ""), ign, progress);
 		for (const auto& item : items) {
 			item->set_feedptr(
 				feedcontainer.get_feed_by_url(item->feedurl()));
@@ -807,39 +1311,70 @@ void Controller::reload_urls_file()
 		return;
 	}
 
-	std::vector<std::shared_ptr<RssFeed>> new_feeds;
-	unsigned int i = 0;
+	const auto urls = urlcfg->get_urls();
+	const auto current = feedcontainer.get_feeds_snapshot();
+	std::unordered_map<std::string, std::shared_ptr<RssFeed>> feeds_by_url;
+	for (const auto& feed : *current) {
+		feeds_by_url.emplace(feed->rssurl(), feed);
+	}
 
-	for (const auto& url : urlcfg->get_urls()) {
-		const auto feed = feedcontainer.get_feed_by_url(url);
-		if (feed) {
-			feed->set_tags(urlcfg->get_tags(url));
+	// Only the feeds that are new to the urls file are read from the cache
+	std::vector<std::string> added_urls;
+	std::unordered_set<std::string> seen;
+	for (const auto& url : urls) {
+		if (feeds_by_url.count(url) == 0 && seen.insert(url).second) {
+			added_urls.push_back(url);
+		}
+	}
+	if (!added_urls.empty()) {
+		const bool ignore_disp =
+			(cfg.snapshot().ignore_mode == IgnoreMode::DISPLAY);
+		CacheLoader loader(*rsscache,
+			ignore_disp ? &ign : nullptr,
+			std::thread::hardware_concurrency(),
+			cfg.get_configvalue_as_bool("lazy-load-articles"));
+		std::vector<std::shared_ptr<RssFeed>> added_feeds;
+		try {
+			added_feeds = loader.load(added_urls);
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"Controller::reload_urls_file: caught exception: %s",
+				e.what());
+			throw;
+		}
+		for (unsigned int i = 0; i < added_urls.size(); ++i) {
+			feeds_by_url.emplace(added_urls[i], added_feeds[i]);
+		}
+	}
+
+	// Feeds whose tags didn't change keep their lines in the feed list
+	bool changed = !added_urls.empty() || urls.size() != current->size();
+	std::vector<std::shared_ptr<RssFeed>> new_feeds;
+	new_feeds.reserve(urls.size());
+	for (unsigned int i = 0; i < urls.size(); ++i) {
+		const auto& feed = feeds_by_url[urls[i]];
+		const auto tags = urlcfg->get_tags(urls[i]);
+		if (feed->get_tag_list() != tags) {
+			feed->set_tags(tags);
+			changed = true;
+		}
+		if (feed->get_order() != i) {
 			feed->set_order(i);
-			new_feeds.push_back(feed);
-		} else {
-			try {
-				bool ignore_disp =
-					(cfg.get_configvalue("ignore-mode") ==
-						"display");
-				std::shared_ptr<RssFeed> new_feed =
-					rsscache->internalize_rssfeed(url,
-						ignore_disp ? &ign : nullptr);
-				new_feed->set_tags(urlcfg->get_tags(url));
-				new_feed->set_order(i);
-				new_feeds.push_back(new_feed);
-			} catch (const DbException& e) {
-				LOG(Level::ERROR,
-					"Controller::reload_urls_file: caught "
-					"exception: %s",
-					e.what());
-				throw;
-			}
+			changed = true;
 		}
-		i++;
+		new_feeds.push_back(feed);
 	}
 
 	v->set_tags(urlcfg->get_alltags());
 
+	LOG(Level::DEBUG,
+		"Controller::reload_urls_file: %u new feed(s), %u feed(s) in all%s",
+		static_cast<unsigned int>(added_urls.size()),
+		static_cast<unsigned int>(new_feeds.size()),
+		changed ? "" : ", nothing changed");
+	if (!changed) {
+		return;
+	}
 	feedcontainer.set_feeds(new_feeds);
 	feedcontainer.sort_feeds(cfg.get_feed_sort_strategy());
 	update_feedlist();
@@ -881,11 +1416,31 @@ int Controller::execute_commands(const std::vector<std::string>& cmds)
 			"Controller::execute_commands: executing `%s'",
 			cmd);
 		if (cmd == "reload") {
-			reloader->reload_all(true);
+			reloader->reload_all(true, true);
 		} else if (cmd == "print-unread") {
 			std::cout << strprintf::fmt(_("%u unread articles"),
-					feedcontainer.unread_item_count())
+					unread_counts().articles)
+				<< std::endl;
+		} else if (cmd == "stats") {
+			std::cout << runtime_stats().dump(2) << std::endl;
+		} else if (cmd == "daemon") {
+			try {
+				ReloadDaemon daemon(*this, cfg,
+					ReloadDaemon::socket_path(configpaths.cache_file()));
+				return daemon.run();
+			} catch (const std::runtime_error& e) {
+				std::cerr << strprintf::fmt(
+						_("Error: couldn't start the daemon: %s"),
+						e.what())
+					<< std::endl;
+				return EXIT_FAILURE;
+			}
+		} else if (cmd == "quit") {
+			std::cerr << strprintf::fmt(_("%s: %s: no daemon is running"),
+					"newsboat",
+					cmd)
 				<< std::endl;
+			return EXIT_FAILURE;
 		} else {
 			std::cerr
 					<< strprintf::fmt(_("%s: %s: unknown command"),
@@ -954,33 +1509,74 @@ void Controller::write_item(std::shared_ptr<RssItem> item, std::ostream& ostr)
 	ostr << item_renderer::to_plain_text(cfg, item) << std::endl;
 }
 
-void Controller::import_read_information(const std::string& readinfofile)
+void Controller::sync_unread_state()
 {
-	std::vector<std::string> guids;
+	std::vector<std::string> unread_guids;
+	if (!api->fetch_unread_guids(unread_guids)) {
+		LOG(Level::INFO,
+			"Controller::sync_unread_state: no list of unread articles, "
+			"the feeds bring the read state along");
+		return;
+	}
 
+	std::vector<std::string> feedurls;
+	for (const auto& url : urlcfg->get_urls()) {
+		if (!utils::is_query_url(url)) {
+			feedurls.push_back(url);
+		}
+	}
+	try {
+		rsscache->sync_unread_by_guid(feedurls, unread_guids);
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Controller::sync_unread_state: couldn't update the cache: %s",
+			e.what());
+	}
+}
+
+void Controller::import_read_information(const std::string& readinfofile)
+{
 	std::ifstream f(readinfofile);
-	std::string line;
-	getline(f, line);
 	if (!f.is_open()) {
 		return;
 	}
-	while (f.is_open() && !f.eof()) {
-		guids.push_back(line);
-		getline(f, line);
+
+	// A chunk at a time, all in one transaction, so that a long history
+	// doesn't have to fit in memory at once
+	ScopeTransaction transaction(*rsscache);
+	std::vector<std::string> guids;
+	guids.reserve(READINFO_CHUNK_SIZE);
+	std::uint64_t imported = 0;
+	std::string line;
+	while (std::getline(f, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		guids.push_back(std::move(line));
+		if (guids.size() == READINFO_CHUNK_SIZE) {
+			rsscache->mark_items_read_by_guid(guids);
+			imported += guids.size();
+			guids.clear();
+		}
 	}
 	rsscache->mark_items_read_by_guid(guids);
+	imported += guids.size();
+	LOG(Level::INFO,
+		"Controller::import_read_information: read %" PRIu64 " guid(s) from %s",
+		imported,
+		readinfofile);
 }
 
 void Controller::export_read_information(const std::string& readinfofile)
 {
-	std::vector<std::string> guids = rsscache->get_read_item_guids();
-
-	std::fstream f(readinfofile, std::fstream::out);
-	if (f.is_open()) {
-		for (const auto& guid : guids) {
-			f << guid << std::endl;
-		}
+	std::ofstream f(readinfofile);
+	if (!f.is_open()) {
+		return;
 	}
+	// Written as they come from the cache, and not flushed line by line
+	rsscache->for_each_read_item_guid([&](const std::string& guid) {
+		f << guid << '\n';
+	});
 }
 
 void Controller::update_config()
@@ -1033,8 +1629,8 @@ void Controller::dump_config(const std::string& filename) const
 
 void Controller::update_flags(std::shared_ptr<RssItem> item)
 {
-	if (api) {
-		api->update_article_flags(
+	if (outbox) {
+		outbox->update_article_flags(
 			item->oldflags(), item->flags(), item->guid());
 	}
 	item->update_flags();
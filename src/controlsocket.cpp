@@ -0,0 +1,247 @@
+#include "controlsocket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+/// Commands are short; whoever sends more than this isn't a client.
+const std::size_t MAX_COMMAND_LENGTH = 4096;
+
+bool make_address(const std::string& path, sockaddr_un& address)
+{
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		return false;
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+bool write_all(int fd, const std::string& data)
+{
+	std::size_t written = 0;
+	while (written < data.size()) {
+		const ssize_t n = ::write(fd, data.data() + written,
+				data.size() - written);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		written += n;
+	}
+	return true;
+}
+
+}
+
+ControlSocket::ControlSocket(const std::string& path)
+	: path(path)
+	, listen_fd(-1)
+{
+	sockaddr_un address;
+	if (!make_address(path, address)) {
+		throw std::runtime_error(strprintf::fmt(
+				"the path of the socket is too long: %s", path));
+	}
+
+	listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd == -1) {
+		throw std::runtime_error(strprintf::fmt(
+				"can't create a socket: %s", strerror(errno)));
+	}
+	::fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+	::fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+	// Left behind by a process that didn't get to clean up
+	::unlink(path.c_str());
+	// Only the user may send commands
+	const mode_t old_umask = ::umask(0077);
+	const int rc = ::bind(listen_fd,
+			reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	const int bind_errno = errno;
+	::umask(old_umask);
+	if (rc != 0 || ::listen(listen_fd, SOMAXCONN) != 0) {
+		const std::string error = strerror(rc != 0 ? bind_errno : errno);
+		::close(listen_fd);
+		throw std::runtime_error(strprintf::fmt(
+				"can't listen at %s: %s", path, error));
+	}
+	LOG(Level::INFO, "ControlSocket: listening at %s", path);
+}
+
+ControlSocket::~ControlSocket()
+{
+	for (const auto& client : clients) {
+		::close(client.fd);
+	}
+	::close(listen_fd);
+	::unlink(path.c_str());
+}
+
+std::vector<ControlSocket::Request> ControlSocket::poll(int timeout_ms)
+{
+	std::vector<pollfd> fds;
+	fds.push_back(pollfd{listen_fd, POLLIN, 0});
+	for (const auto& client : clients) {
+		if (!client.complete) {
+			fds.push_back(pollfd{client.fd, POLLIN, 0});
+		}
+	}
+
+	std::vector<Request> requests;
+	if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+		return requests;
+	}
+
+	for (std::size_t i = 1; i < fds.size(); ++i) {
+		if (fds[i].revents == 0) {
+			continue;
+		}
+		const auto client = std::find_if(clients.begin(), clients.end(),
+		[&](const Client& c) {
+			return c.fd == fds[i].fd;
+		});
+		if (client != clients.end() && !read_from(*client, requests)) {
+			drop(client->fd);
+		}
+	}
+	if (fds[0].revents & POLLIN) {
+		accept_clients();
+	}
+	return requests;
+}
+
+void ControlSocket::reply(const Request& request, const std::string& answer)
+{
+	const auto client = std::find_if(clients.begin(), clients.end(),
+	[&](const Client& c) {
+		return c.fd == request.client;
+	});
+	if (client == clients.end()) {
+		return;
+	}
+
+	// The answer is short enough for the socket's buffer, unless the client
+	// stopped reading; it's cut off then rather than holding everyone up
+	::fcntl(client->fd, F_SETFL, 0);
+	if (!write_all(client->fd, answer)) {
+		LOG(Level::WARN,
+			"ControlSocket::reply: couldn't answer `%s': %s",
+			request.command,
+			strerror(errno));
+	}
+	drop(client->fd);
+}
+
+bool ControlSocket::send(const std::string& path, const std::string& command,
+	std::string& answer)
+{
+	sockaddr_un address;
+	if (!make_address(path, address)) {
+		return false;
+	}
+	const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1) {
+		return false;
+	}
+	if (::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+			sizeof(address)) != 0) {
+		::close(fd);
+		return false;
+	}
+	if (!write_all(fd, command + "\n")) {
+		::close(fd);
+		return false;
+	}
+	::shutdown(fd, SHUT_WR);
+
+	answer.clear();
+	char buffer[4096];
+	for (;;) {
+		const ssize_t n = ::read(fd, buffer, sizeof(buffer));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		answer.append(buffer, n);
+	}
+	::close(fd);
+	return !answer.empty();
+}
+
+void ControlSocket::accept_clients()
+{
+	for (;;) {
+		const int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+		::fcntl(fd, F_SETFL, O_NONBLOCK);
+		clients.push_back(Client{fd, std::string(), false});
+	}
+}
+
+bool ControlSocket::read_from(Client& client, std::vector<Request>& requests)
+{
+	char buffer[512];
+	for (;;) {
+		const ssize_t n = ::read(client.fd, buffer, sizeof(buffer));
+		if (n < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		if (n == 0) {
+			// A client that hung up without a command, or without waiting
+			// for the answer
+			return false;
+		}
+		client.received.append(buffer, n);
+
+		const auto end = client.received.find('\n');
+		if (end != std::string::npos) {
+			client.received.resize(end);
+			client.complete = true;
+			requests.push_back(Request{client.fd, client.received});
+			return true;
+		}
+		if (client.received.size() > MAX_COMMAND_LENGTH) {
+			LOG(Level::WARN,
+				"ControlSocket::read_from: dropping a client that sent too "
+				"much");
+			return false;
+		}
+	}
+}
+
+void ControlSocket::drop(int fd)
+{
+	::close(fd);
+	clients.erase(std::remove_if(clients.begin(), clients.end(),
+	[&](const Client& c) {
+		return c.fd == fd;
+	}), clients.end());
+}
+
+} // namespace newsboat
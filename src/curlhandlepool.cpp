@@ -0,0 +1,66 @@
+#include "curlhandlepool.h"
+
+#include <utility>
+
+namespace newsboat {
+
+CurlHandlePool::Lease::Lease(CurlHandlePool& pool,
+	std::unique_ptr<CurlHandle> handle)
+	: pool(&pool)
+	, handle(std::move(handle))
+{
+}
+
+CurlHandlePool::Lease::Lease(Lease&& other)
+	: pool(other.pool)
+	, handle(std::move(other.handle))
+{
+}
+
+CurlHandlePool::Lease::~Lease()
+{
+	if (handle) {
+		pool->give_back(std::move(handle));
+	}
+}
+
+CurlHandlePool::CurlHandlePool(std::size_t max_idle)
+	: max_idle(max_idle)
+{
+}
+
+CurlHandlePool::Lease CurlHandlePool::acquire()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		if (!idle.empty()) {
+			std::unique_ptr<CurlHandle> handle = std::move(idle.back());
+			idle.pop_back();
+			return Lease(*this, std::move(handle));
+		}
+	}
+
+	std::unique_ptr<CurlHandle> handle(new CurlHandle);
+	handle->set_share(share);
+	return Lease(*this, std::move(handle));
+}
+
+std::size_t CurlHandlePool::idle_count()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return idle.size();
+}
+
+void CurlHandlePool::give_back(std::unique_ptr<CurlHandle> handle)
+{
+	// The options may point at buffers and header lists that are gone by
+	// now; resetting them keeps the connections, though
+	handle->reset();
+
+	std::lock_guard<std::mutex> guard(mtx);
+	if (idle.size() < max_idle) {
+		idle.push_back(std::move(handle));
+	}
+}
+
+} // namespace newsboat
@@ -0,0 +1,381 @@
+#include "curlshare.h"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "3rd-party/json.hpp"
+#include "curlhandle.h"
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+/// How long a host's address is used without looking the host up again.
+/// curl doesn't tell the TTL of the DNS record.
+const time_t ADDRESS_LIFETIME = 60 * 60;
+
+bool write_all(int fd, const std::string& contents)
+{
+	const char* data = contents.data();
+	std::size_t left = contents.size();
+	while (left > 0) {
+		const ssize_t written = ::write(fd, data, left);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		left -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+/// The host name in \a url, or an empty string if it's an IP address, or
+/// there's no host at all.
+std::string host_name(const char* url)
+{
+	std::string result;
+	CURLU* parsed = curl_url();
+	if (parsed == nullptr) {
+		return result;
+	}
+	char* host = nullptr;
+	if (curl_url_set(parsed, CURLUPART_URL, url, 0) == CURLUE_OK
+		&& curl_url_get(parsed, CURLUPART_HOST, &host, 0) == CURLUE_OK) {
+		result = host;
+		curl_free(host);
+	}
+	curl_url_cleanup(parsed);
+
+	if (result.empty() || result[0] == '['
+		|| result.find_first_not_of("0123456789.") == std::string::npos) {
+		return "";
+	}
+	return result;
+}
+
+#if defined(CURL_VERSION_SSLS_EXPORT)
+std::string to_hex(const unsigned char* data, std::size_t length)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	result.reserve(2 * length);
+	for (std::size_t i = 0; i < length; ++i) {
+		result += digits[data[i] >> 4];
+		result += digits[data[i] & 0xf];
+	}
+	return result;
+}
+
+std::vector<unsigned char> from_hex(const std::string& hex)
+{
+	std::vector<unsigned char> result;
+	for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+		result.push_back(static_cast<unsigned char>(
+				std::stoi(hex.substr(i, 2), nullptr, 16)));
+	}
+	return result;
+}
+
+bool can_export_sessions()
+{
+	return (curl_version_info(CURLVERSION_NOW)->features
+			& CURL_VERSION_SSLS_EXPORT) != 0;
+}
+
+CURLcode export_session(CURL* /* handle */, void* userptr,
+	const char* session_key, const unsigned char* shmac, size_t shmac_len,
+	const unsigned char* sdata, size_t sdata_len, curl_off_t valid_until,
+	int /* ientry */, const char* /* alpn */, size_t /* earlydata_max */)
+{
+	auto& sessions = *static_cast<nlohmann::json*>(userptr);
+	sessions.push_back({
+		{"key", session_key != nullptr ? session_key : ""},
+		{"hmac", to_hex(shmac, shmac_len)},
+		{"data", to_hex(sdata, sdata_len)},
+		{"expires", static_cast<std::int64_t>(valid_until)},
+	});
+	return CURLE_OK;
+}
+#endif
+
+}
+
+CurlShare::CurlShare()
+	: share(curl_share_init())
+	, cookies_kept(false)
+{
+	if (!share) {
+		throw std::runtime_error("Can't obtain curl share handle");
+	}
+	curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &CurlShare::lock);
+	curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &CurlShare::unlock);
+	curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	// Only handles that turn the cookie engine on use these
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+	// Connections can be shared since curl 7.57.0. Multi handles use the
+	// shared connections too, so they're still around for the next reload.
+#if LIBCURL_VERSION_NUM >= 0x073900
+	const CURLSHcode rc = curl_share_setopt(share, CURLSHOPT_SHARE,
+			CURL_LOCK_DATA_CONNECT);
+	if (rc != CURLSHE_OK) {
+		LOG(Level::INFO,
+			"CurlShare::CurlShare: can't share connections: %s",
+			curl_share_strerror(rc));
+	}
+#endif
+}
+
+CurlShare::~CurlShare()
+{
+	const CURLSHcode rc = curl_share_cleanup(share);
+	if (rc != CURLSHE_OK) {
+		LOG(Level::ERROR,
+			"CurlShare::~CurlShare: curl_share_cleanup failed: %s",
+			curl_share_strerror(rc));
+	}
+	for (const auto& list : resolve_lists) {
+		curl_slist_free_all(list.second);
+	}
+}
+
+void CurlShare::load(const std::string& path)
+{
+	std::ifstream f(path);
+	if (!f) {
+		return;
+	}
+	nlohmann::json saved;
+	try {
+		f >> saved;
+	} catch (const nlohmann::json::exception& e) {
+		LOG(Level::INFO, "CurlShare::load: ignoring %s: %s", path, e.what());
+		return;
+	}
+
+	const time_t now = ::time(nullptr);
+	std::size_t loaded_addresses = 0;
+	std::lock_guard<std::mutex> guard(addresses_mutex);
+	try {
+		for (const auto& entry : saved.value("hosts", nlohmann::json::array())) {
+			const Address address{
+				entry.at("port").get<long>(),
+				entry.at("address").get<std::string>(),
+				entry.at("expires").get<time_t>()
+			};
+			if (address.expires <= now) {
+				continue;
+			}
+			const auto host = entry.at("host").get<std::string>();
+			addresses[host].push_back(address);
+
+			// With the "+", curl forgets the address after its usual DNS
+			// cache timeout, and looks the host up again. That needs curl
+			// 7.75.0.
+#if LIBCURL_VERSION_NUM >= 0x074b00
+			const std::string ip = address.address.find(':') != std::string::npos
+				? "[" + address.address + "]" : address.address;
+			const std::string resolve = "+" + host + ":" +
+				std::to_string(address.port) + ":" + ip;
+			resolve_lists[host] = curl_slist_append(resolve_lists[host],
+					resolve.c_str());
+			++loaded_addresses;
+#endif
+		}
+	} catch (const nlohmann::json::exception& e) {
+		LOG(Level::INFO, "CurlShare::load: ignoring the rest of %s: %s", path,
+			e.what());
+	}
+
+	std::size_t loaded_sessions = 0;
+#if defined(CURL_VERSION_SSLS_EXPORT)
+	if (can_export_sessions()) {
+		CurlHandle handle;
+		handle.set_share(*this);
+		try {
+			for (const auto& session : saved.value("tls_sessions",
+					nlohmann::json::array())) {
+				if (session.at("expires").get<std::int64_t>() <= now) {
+					continue;
+				}
+				const auto key = session.at("key").get<std::string>();
+				const auto hmac = from_hex(session.at("hmac").get<std::string>());
+				const auto data = from_hex(session.at("data").get<std::string>());
+				if (curl_easy_ssls_import(handle.ptr(),
+						key.empty() ? nullptr : key.c_str(),
+						hmac.data(), hmac.size(),
+						data.data(), data.size()) == CURLE_OK) {
+					++loaded_sessions;
+				}
+			}
+		} catch (const std::exception& e) {
+			LOG(Level::INFO,
+				"CurlShare::load: ignoring the rest of the TLS sessions: %s",
+				e.what());
+		}
+	}
+#endif
+
+	LOG(Level::DEBUG,
+		"CurlShare::load: read %" PRIu64 " address(es) and %" PRIu64
+		" TLS session(s) from %s",
+		static_cast<std::uint64_t>(loaded_addresses),
+		static_cast<std::uint64_t>(loaded_sessions),
+		path);
+}
+
+bool CurlShare::save(const std::string& path)
+{
+	const time_t now = ::time(nullptr);
+	nlohmann::json hosts = nlohmann::json::array();
+	{
+		std::lock_guard<std::mutex> guard(addresses_mutex);
+		for (const auto& host : addresses) {
+			for (const auto& address : host.second) {
+				if (address.expires > now) {
+					hosts.push_back({
+						{"host", host.first},
+						{"port", address.port},
+						{"address", address.address},
+						{"expires", address.expires},
+					});
+				}
+			}
+		}
+	}
+
+	nlohmann::json sessions = nlohmann::json::array();
+#if defined(CURL_VERSION_SSLS_EXPORT)
+	if (can_export_sessions()) {
+		CurlHandle handle;
+		handle.set_share(*this);
+		curl_easy_ssls_export(handle.ptr(), &export_session, &sessions);
+	}
+#endif
+
+	// The file holds TLS session tickets, so nobody else may read it, not
+	// even while it's being written. mkstemp() makes a file that nobody
+	// could have put there beforehand, not even a symlink.
+	std::string tmp = path + ".XXXXXX";
+	const int fd = ::mkstemp(&tmp[0]);
+	if (fd == -1) {
+		LOG(Level::ERROR, "CurlShare::save: couldn't create a file next to %s: %s",
+			path, std::strerror(errno));
+		return false;
+	}
+	const std::string contents =
+		nlohmann::json{{"hosts", hosts}, {"tls_sessions", sessions}}.dump()
+		+ '\n';
+	const bool written = ::fchmod(fd, S_IRUSR | S_IWUSR) == 0
+		&& write_all(fd, contents);
+	const int saved_errno = errno;
+	if (::close(fd) != 0 || !written) {
+		LOG(Level::ERROR, "CurlShare::save: couldn't write %s: %s", tmp,
+			std::strerror(written ? errno : saved_errno));
+		::unlink(tmp.c_str());
+		return false;
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		LOG(Level::ERROR, "CurlShare::save: couldn't replace %s: %s", path,
+			std::strerror(errno));
+		::unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+void CurlShare::remember_address(CURL* handle)
+{
+	char* url = nullptr;
+	char* ip = nullptr;
+	long port = 0;
+	if (curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK
+		|| url == nullptr
+		|| curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &ip) != CURLE_OK
+		|| ip == nullptr || *ip == '\0'
+		|| curl_easy_getinfo(handle, CURLINFO_PRIMARY_PORT, &port) != CURLE_OK
+		|| port <= 0) {
+		return;
+	}
+	const std::string host = host_name(url);
+	if (host.empty()) {
+		return;
+	}
+
+	const Address address{port, ip, ::time(nullptr) + ADDRESS_LIFETIME};
+	std::lock_guard<std::mutex> guard(addresses_mutex);
+	auto& known = addresses[host];
+	for (auto& entry : known) {
+		if (entry.port == port) {
+			entry = address;
+			return;
+		}
+	}
+	known.push_back(address);
+}
+
+void CurlShare::use_saved_address(CURL* handle, const std::string& url)
+{
+	const std::string host = host_name(url.c_str());
+	std::lock_guard<std::mutex> guard(addresses_mutex);
+	const auto list = resolve_lists.find(host);
+	if (list != resolve_lists.end()) {
+		curl_easy_setopt(handle, CURLOPT_RESOLVE, list->second);
+	}
+}
+
+void CurlShare::lock(CURL* /* handle */, curl_lock_data data,
+	curl_lock_access /* access */, void* userptr)
+{
+	static_cast<CurlShare*>(userptr)->mutexes[data].lock();
+}
+
+void CurlShare::unlock(CURL* /* handle */, curl_lock_data data, void* userptr)
+{
+	static_cast<CurlShare*>(userptr)->mutexes[data].unlock();
+}
+
+void CurlShare::load_cookies(const std::string& path)
+{
+	std::lock_guard<std::mutex> guard(cookie_mutex);
+	CurlHandle handle;
+	handle.set_share(*this);
+	curl_easy_setopt(handle.ptr(), CURLOPT_COOKIEFILE, path.c_str());
+	// Reads the file now, rather than when the handle's next transfer
+	// starts
+	curl_easy_setopt(handle.ptr(), CURLOPT_COOKIELIST, "RELOAD");
+	cookie_file = path;
+	cookies_kept = true;
+	LOG(Level::DEBUG, "CurlShare::load_cookies: read %s", path);
+}
+
+void CurlShare::save_cookies()
+{
+	std::lock_guard<std::mutex> guard(cookie_mutex);
+	if (!cookies_kept) {
+		return;
+	}
+	CurlHandle handle;
+	handle.set_share(*this);
+	curl_easy_setopt(handle.ptr(), CURLOPT_COOKIEJAR, cookie_file.c_str());
+	curl_easy_setopt(handle.ptr(), CURLOPT_COOKIELIST, "FLUSH");
+	// Or curl would write the file again when the handle is cleaned up
+	curl_easy_setopt(handle.ptr(), CURLOPT_COOKIEJAR, nullptr);
+	LOG(Level::DEBUG, "CurlShare::save_cookies: wrote %s", cookie_file);
+}
+
+} // namespace newsboat
@@ -0,0 +1,72 @@
+#include "dateformatcache.h"
+
+#include <cstring>
+
+#include "utils.h"
+
+namespace newsboat {
+
+DateFormatCache::DateFormatCache(std::size_t max_entries)
+	: max_entries(max_entries)
+	, resolution(1)
+{
+}
+
+const std::string& DateFormatCache::format(const std::string& format,
+	time_t t)
+{
+	if (format != current_format) {
+		formatted.clear();
+		current_format = format;
+		resolution = resolution_of(format);
+	}
+
+	// Round towards minus infinity, so that timestamps before the epoch
+	// land in the right minute as well
+	time_t key = t - t % resolution;
+	if (t % resolution < 0) {
+		key -= resolution;
+	}
+
+	const auto it = formatted.find(key);
+	if (it != formatted.end()) {
+		return it->second;
+	}
+
+	if (max_entries != 0 && formatted.size() >= max_entries) {
+		formatted.clear();
+	}
+	return formatted[key] = utils::mt_strf_localtime(format, key);
+}
+
+std::size_t DateFormatCache::size() const
+{
+	return formatted.size();
+}
+
+time_t DateFormatCache::resolution_of(const std::string& format)
+{
+	// Conversions that show seconds, directly or as part of a bigger one
+	const char* const with_seconds = "STcrsX+";
+
+	for (std::size_t i = 0; i < format.size(); ++i) {
+		if (format[i] != '%') {
+			continue;
+		}
+		++i;
+		// Skip flags, field width and the E and O modifiers
+		while (i < format.size()
+			&& (std::strchr("_-0^#EO", format[i]) != nullptr
+				|| (format[i] >= '0' && format[i] <= '9'))) {
+			++i;
+		}
+		if (i < format.size() && format[i] != '\0'
+			&& std::strchr(with_seconds, format[i]) != nullptr) {
+			return 1;
+		}
+	}
+
+	return 60;
+}
+
+} // namespace newsboat
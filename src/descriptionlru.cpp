@@ -0,0 +1,122 @@
+#include "descriptionlru.h"
+
+namespace newsboat {
+
+namespace {
+
+/// Same as the default of `description-memory-limit`.
+const std::size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+
+}
+
+DescriptionLru::DescriptionLru(std::size_t max_bytes)
+	: max_bytes(max_bytes)
+	, bytes(0)
+	, hits(0)
+	, misses(0)
+	, evictions(0)
+{
+}
+
+DescriptionLru& DescriptionLru::shared()
+{
+	static DescriptionLru instance(DEFAULT_MAX_BYTES);
+	return instance;
+}
+
+void DescriptionLru::set_max_bytes(std::size_t limit)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	max_bytes = limit;
+	evict_unlocked();
+}
+
+nonstd::optional<Description> DescriptionLru::get(const RssItem* item)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = index.find(item);
+	if (it == index.end()) {
+		++misses;
+		return nonstd::nullopt;
+	}
+	++hits;
+	entries.splice(entries.begin(), entries, it->second);
+	return it->second->description;
+}
+
+bool DescriptionLru::contains(const RssItem* item) const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return index.count(item) > 0;
+}
+
+void DescriptionLru::put(const RssItem* item, const Description& description)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = index.find(item);
+	if (it != index.end()) {
+		bytes -= size_of(it->second->description);
+		entries.erase(it->second);
+	}
+	entries.push_front({item, description});
+	index[item] = entries.begin();
+	bytes += size_of(description);
+	evict_unlocked();
+}
+
+void DescriptionLru::set_plain_text(const RssItem* item,
+	std::shared_ptr<const std::string> text)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = index.find(item);
+	if (it == index.end() || it->second->description.plain_text != nullptr) {
+		return;
+	}
+	it->second->description.plain_text = std::move(text);
+	bytes += it->second->description.plain_text->capacity();
+	evict_unlocked();
+}
+
+void DescriptionLru::erase(const RssItem* item)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = index.find(item);
+	if (it == index.end()) {
+		return;
+	}
+	bytes -= size_of(it->second->description);
+	entries.erase(it->second);
+	index.erase(it);
+}
+
+DescriptionLru::Stats DescriptionLru::stats() const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return {hits, misses, evictions, entries.size(), bytes};
+}
+
+std::size_t DescriptionLru::size_of(const Description& description)
+{
+	return sizeof(Entry) + description.text.capacity()
+		+ description.mime.capacity()
+		+ (description.plain_text != nullptr
+			? description.plain_text->capacity() : 0);
+}
+
+void DescriptionLru::evict_unlocked()
+{
+	if (max_bytes == 0) {
+		return;
+	}
+	// The newest entry stays even if it's too big on its own; someone is
+	// about to read it
+	while (bytes > max_bytes && entries.size() > 1) {
+		const auto& victim = entries.back();
+		bytes -= size_of(victim.description);
+		index.erase(victim.item);
+		entries.pop_back();
+		++evictions;
+	}
+}
+
+} // namespace newsboat
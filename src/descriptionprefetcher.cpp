@@ -0,0 +1,103 @@
+#include "descriptionprefetcher.h"
+
+#include <cinttypes>
+#include <string>
+
+#include "cache.h"
+#include "dbexception.h"
+#include "logger.h"
+#include "rssitem.h"
+
+namespace newsboat {
+
+namespace {
+
+/// Descriptions read per trip to the cache; small enough that a new request
+/// doesn't wait long for the current batch to finish.
+const std::size_t BATCH_SIZE = 32;
+
+}
+
+DescriptionPrefetcher::DescriptionPrefetcher(Cache* cache)
+	: cache(cache)
+	, stopping(false)
+	, worker(&DescriptionPrefetcher::run, this)
+{
+}
+
+DescriptionPrefetcher::~DescriptionPrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+		pending.clear();
+	}
+	wakeup.notify_one();
+	worker.join();
+}
+
+void DescriptionPrefetcher::prefetch(
+	const std::vector<std::shared_ptr<RssItem>>& items)
+{
+	if (cache == nullptr) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		pending.assign(items.begin(), items.end());
+	}
+	wakeup.notify_one();
+}
+
+void DescriptionPrefetcher::run()
+{
+	while (true) {
+		std::vector<std::shared_ptr<RssItem>> batch;
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			wakeup.wait(lock, [this]() {
+				return stopping || !pending.empty();
+			});
+			if (stopping) {
+				return;
+			}
+			while (!pending.empty() && batch.size() < BATCH_SIZE) {
+				if (!pending.front()->description_loaded()) {
+					batch.push_back(pending.front());
+				}
+				pending.pop_front();
+			}
+		}
+		if (batch.empty()) {
+			continue;
+		}
+
+		std::vector<std::string> guids;
+		for (const auto& item : batch) {
+			guids.push_back(item->guid());
+		}
+
+		try {
+			const auto descriptions = cache->fetch_descriptions(guids);
+			for (const auto& item : batch) {
+				const auto description = descriptions.find(item->guid());
+				if (description != descriptions.end()
+					&& !item->description_loaded()) {
+					item->set_description_from_cache(description->second.text,
+						description->second.mime);
+				}
+			}
+			LOG(Level::DEBUG,
+				"DescriptionPrefetcher::run: read %" PRIu64 " description(s)",
+				static_cast<uint64_t>(descriptions.size()));
+		} catch (const DbException& e) {
+			// The items read their descriptions themselves when needed
+			LOG(Level::ERROR,
+				"DescriptionPrefetcher::run: couldn't read descriptions: %s",
+				e.what());
+		}
+	}
+}
+
+} // namespace newsboat
@@ -23,6 +23,14 @@
 
 namespace newsboat {
 
+namespace {
+
+/// Lines described beyond the screen in each direction, unless the screen is
+/// taller than that.
+const std::uint32_t MIN_SCROLL_MARGIN = 64;
+
+}
+
 DirBrowserFormAction::DirBrowserFormAction(View* vv,
 	std::string formstr,
 	ConfigContainer* cfg)
@@ -59,6 +67,10 @@ bool DirBrowserFormAction::process_operation(Operation op,
 		if (focus.length() > 0) {
 			if (focus == "files") {
 				const auto selected_position = files_list.get_position();
+				if (selected_position >= id_at_position.size()) {
+					break;
+				}
+				describe_directory(selected_position);
 				const auto selection = id_at_position[selected_position];
 				switch (selection.filetype) {
 				case file_system::FileType::Directory: {
@@ -188,43 +200,6 @@ void DirBrowserFormAction::update_title(const std::string& working_directory)
 	set_value("head", title);
 }
 
-std::vector<std::string> get_sorted_dirlist()
-{
-	std::vector<std::string> ret;
-
-	const std::string cwdtmp = utils::getcwd();
-
-	DIR* dirp = ::opendir(cwdtmp.c_str());
-	if (dirp) {
-		struct dirent* de = ::readdir(dirp);
-		while (de) {
-			if (strcmp(de->d_name, ".") != 0 &&
-				strcmp(de->d_name, "..") != 0) {
-				struct stat sb;
-				auto dpath = strprintf::fmt(
-						"%s/%s", cwdtmp, de->d_name);
-				if (::lstat(dpath.c_str(), &sb) == 0) {
-					const auto ftype = file_system::mode_to_filetype(sb.st_mode);
-					if (ftype == file_system::FileType::Directory) {
-						ret.push_back(de->d_name);
-					}
-				}
-			}
-
-			de = ::readdir(dirp);
-		}
-		::closedir(dirp);
-	}
-
-	std::sort(ret.begin(), ret.end());
-
-	if (cwdtmp != "/") {
-		ret.insert(ret.begin(), "..");
-	}
-
-	return ret;
-}
-
 void DirBrowserFormAction::prepare()
 {
 	/*
@@ -236,17 +211,22 @@ void DirBrowserFormAction::prepare()
 		const std::string cwdtmp = utils::getcwd();
 		update_title(cwdtmp);
 
-		std::vector<std::string> directories = get_sorted_dirlist();
-
-		ListFormatter listfmt;
-
+		// Only the names are read here; the directories are lstat()ed once
+		// they come into view
 		id_at_position.clear();
-		for (std::string directory : directories) {
-			add_directory(listfmt, id_at_position, directory);
+		if (cwdtmp != "/") {
+			id_at_position.push_back({file_system::FileType::Unknown, ".."});
+		}
+		for (auto& dirname : file_system::list_directory(cwdtmp, true)) {
+			id_at_position.push_back({file_system::FileType::Unknown, std::move(dirname)});
 		}
+		directory_lines.assign(id_at_position.size(), std::string());
 
-		files_list.stfl_replace_lines(listfmt);
+		draw_directories();
 		do_redraw = false;
+	} else if (!files_list.window_covers_viewport()) {
+		// The cursor has scrolled out of the lines that were handed to STFL
+		draw_directories();
 	}
 
 	std::string focus = f.get_focus();
@@ -288,11 +268,26 @@ const std::vector<KeyMapHintEntry>& DirBrowserFormAction::get_keymap_hint() cons
 	return hints;
 }
 
-void DirBrowserFormAction::add_directory(
-	ListFormatter& listfmt,
-	std::vector<file_system::FileSystemEntry>& id_at_position,
-	std::string dirname)
+void DirBrowserFormAction::draw_directories()
 {
+	const auto window = files_list.window_around_cursor(id_at_position.size(),
+			MIN_SCROLL_MARGIN);
+	ListFormatter listfmt;
+	for (std::uint32_t i = window.first; i < window.second; ++i) {
+		listfmt.add_line(utils::quote_for_stfl(describe_directory(i)));
+	}
+	files_list.stfl_replace_window(listfmt, window.first, id_at_position.size());
+}
+
+const std::string& DirBrowserFormAction::describe_directory(std::uint32_t pos)
+{
+	std::string& line = directory_lines[pos];
+	if (!line.empty()) {
+		return line;
+	}
+
+	auto& entry = id_at_position[pos];
+	const std::string& dirname = entry.name;
 	struct stat sb;
 	if (::lstat(dirname.c_str(), &sb) == 0) {
 		const auto ftype = file_system::mode_to_filetype(sb.st_mode);
@@ -308,16 +303,21 @@ void DirBrowserFormAction::add_directory(
 				// unspecified size. We'll have to bet it's no larger than 64
 				// bits.
 				static_cast<int64_t>(sb.st_size));
-		std::string line = strprintf::fmt("%c%s %s %s %s %s",
+		line = strprintf::fmt("%c%s %s %s %s %s",
 				file_system::filetype_to_char(ftype),
 				rwxbits,
 				owner,
 				group,
 				sizestr,
 				formatteddirname);
-		listfmt.add_line(utils::quote_for_stfl(line));
-		id_at_position.push_back(file_system::FileSystemEntry{ftype, dirname});
+		entry.filetype = ftype;
+	} else {
+		// Gone since the directory was read, most likely
+		line = strprintf::fmt("%c????????? %-8s %-8s %12s %s",
+				file_system::filetype_to_char(file_system::FileType::Unknown),
+				"", "", "", dirname);
 	}
+	return line;
 }
 
 std::string DirBrowserFormAction::get_formatted_dirname(std::string dirname,
@@ -22,6 +22,33 @@ Download::Download(std::function<void()> cb_require_view_update_)
 {
 }
 
+Download::Download(const Download& other)
+	: fn(other.fn)
+	, url_(other.url_)
+	, download_status(other.download_status.load())
+	, msg(other.msg)
+	, cursize(other.cursize.load())
+	, totalsize(other.totalsize.load())
+	, curkbps(other.curkbps.load())
+	, offs(other.offs.load())
+	, cb_require_view_update(other.cb_require_view_update)
+{
+}
+
+Download& Download::operator=(const Download& other)
+{
+	fn = other.fn;
+	url_ = other.url_;
+	download_status = other.download_status.load();
+	msg = other.msg;
+	cursize = other.cursize.load();
+	totalsize = other.totalsize.load();
+	curkbps = other.curkbps.load();
+	offs = other.offs.load();
+	cb_require_view_update = other.cb_require_view_update;
+	return *this;
+}
+
 Download::~Download() {}
 
 const std::string Download::filename() const
@@ -51,10 +78,11 @@ void Download::set_filename(const std::string& str)
 
 double Download::percents_finished() const
 {
-	if (totalsize < 1) {
+	const double total = totalsize;
+	if (total < 1) {
 		return 0.0;
 	} else {
-		return (100 * (offs + cursize)) / (offs + totalsize);
+		return (100 * (offs + cursize)) / (offs + total);
 	}
 }
 
@@ -102,11 +130,12 @@ void Download::set_progress(double downloaded, double total)
 
 void Download::set_status(DlStatus dls, const std::string& msg_)
 {
-	if (download_status != dls) {
-		cb_require_view_update();
-	}
+	const bool changed = download_status != dls;
 	msg = msg_;
 	download_status = dls;
+	if (changed) {
+		cb_require_view_update();
+	}
 }
 
 void Download::set_kbps(double k)
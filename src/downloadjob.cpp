@@ -0,0 +1,626 @@
+#include "downloadjob.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "bandwidthlimiter.h"
+#include "logger.h"
+#include "strprintf.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace podboat {
+
+const std::string DownloadJob::SEGMENTS_SUFFIX = ".segments";
+
+namespace {
+
+/// Files that can't be split into at least two segments of this size are
+/// downloaded in a single stream
+const std::uint64_t MIN_SEGMENT_SIZE = 4 * 1024 * 1024;
+/// How often the state of a segmented download is written out
+const std::chrono::seconds SEGMENTS_SAVE_INTERVAL(2);
+/// How often the progress is passed on to the Download, and so to the UI
+const std::chrono::milliseconds PROGRESS_REPORT_INTERVAL(250);
+/// What each segment collects before it's written out
+const std::size_t SEGMENT_BUFFER_SIZE = 256 * 1024;
+
+size_t write_stream_data(void* buffer, size_t size, size_t nmemb,
+	void* userp)
+{
+	DownloadJob* job = static_cast<DownloadJob*>(userp);
+	return job->write_stream(buffer, size * nmemb);
+}
+
+int progress_callback(void* clientp,
+	double dltotal,
+	double dlnow,
+	double /* ultotal */,
+	double /*ulnow*/)
+{
+	DownloadJob* job = static_cast<DownloadJob*>(clientp);
+	return job->progress(dlnow, dltotal);
+}
+
+/// Whether \a handle got a "206 Partial Content" answer, which a Range
+/// request needs; a server that answers with the whole file instead would
+/// overwrite the other segments.
+bool is_partial_content(CURL* handle)
+{
+	long status = 0;
+	curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+	return status == 206;
+}
+
+size_t discard_data(void* /* buffer */, size_t size, size_t nmemb,
+	void* userp)
+{
+	return is_partial_content(static_cast<CURL*>(userp)) ? size * nmemb : 0;
+}
+
+size_t collect_header(char* buffer, size_t size, size_t nitems, void* userp)
+{
+	std::vector<std::string>* headers = static_cast<std::vector<std::string>*>
+		(userp);
+	headers->emplace_back(buffer, size * nitems);
+	return size * nitems;
+}
+
+void make_parent_dirs(const std::string& filename)
+{
+	// Have to copy the string into a vector in order to be able to
+	// get a char* pointer. std::string::c_str() won't do because it
+	// returns const char*, whereas ::dirname() needs non-const.
+	std::vector<char> directory(filename.begin(), filename.end());
+	directory.push_back('\0');
+	utils::mkdir_parents(dirname(&directory[0]));
+}
+
+}
+
+DownloadJob::DownloadJob(Download& dl_, newsboat::ConfigContainer& c,
+	BandwidthLimiter& limiter)
+	: dl(dl_)
+	, cfg(c)
+	, limiter(limiter)
+	, phase(Phase::DONE)
+	, filename(dl.filename() + newsboat::ConfigContainer::PARTIAL_FILE_SUFFIX)
+	, reserved(false)
+	, resumed_download(false)
+	, fd(-1)
+	, segments_running(0)
+	, segments_result(CURLE_OK)
+	, bytecount(0)
+	, stream_now(0)
+	, stream_total(0)
+{
+}
+
+DownloadJob::~DownloadJob()
+{
+	if (fd != -1) {
+		::close(fd);
+	}
+}
+
+std::vector<CURL*> DownloadJob::start()
+{
+	tv1 = std::chrono::steady_clock::now();
+	++bytecount;
+	dl.set_status(DlStatus::DOWNLOADING);
+
+	if (cfg.get_configvalue_as_int("download-segments") > 1) {
+		struct stat sb;
+		const bool have_part = stat(filename.c_str(), &sb) == 0;
+		const bool have_state =
+			stat((filename + SEGMENTS_SUFFIX).c_str(), &sb) == 0;
+		if (!have_part || have_state) {
+			return start_probe();
+		}
+		LOG(Level::INFO,
+			"DownloadJob::start: resuming what a single stream started");
+	}
+	return start_stream();
+}
+
+void DownloadJob::set_up_handle(CurlHandle& handle, unsigned int transfers)
+{
+	utils::set_common_curl_options(handle, &cfg);
+
+	curl_easy_setopt(handle.ptr(), CURLOPT_URL, dl.url().c_str());
+	curl_easy_setopt(handle.ptr(), CURLOPT_TIMEOUT, 0);
+
+	// set up max download speed, which the download's transfers share
+	int max_dl_speed = cfg.get_configvalue_as_int("max-download-speed");
+	if (max_dl_speed > 0) {
+		curl_easy_setopt(handle.ptr(),
+			CURLOPT_MAX_RECV_SPEED_LARGE,
+			(curl_off_t)(max_dl_speed * 1024 / std::max(1u, transfers)));
+	}
+}
+
+std::vector<CURL*> DownloadJob::start_stream()
+{
+	single.reset(new CurlHandle());
+	set_up_handle(*single, 1);
+
+	// set up write functions:
+	curl_easy_setopt(single->ptr(), CURLOPT_WRITEFUNCTION, write_stream_data);
+	curl_easy_setopt(single->ptr(), CURLOPT_WRITEDATA, this);
+
+	// set up progress notification:
+	curl_easy_setopt(single->ptr(), CURLOPT_NOPROGRESS, 0);
+	curl_easy_setopt(
+		single->ptr(), CURLOPT_PROGRESSFUNCTION, progress_callback);
+	curl_easy_setopt(single->ptr(), CURLOPT_PROGRESSDATA, this);
+
+	struct stat sb;
+	if (stat(filename.c_str(), &sb) == -1) {
+		LOG(Level::INFO,
+			"DownloadJob::start_stream: stat failed: starting normal "
+			"download");
+
+		make_parent_dirs(filename);
+
+		file.open(filename, false);
+		dl.set_offset(0);
+		resumed_download = false;
+	} else {
+		LOG(Level::INFO,
+			"DownloadJob::start_stream: stat ok: starting download from %"
+			PRIi64,
+			// That field is `long int`, which is at least 32 bits. On x86_64,
+			// it's 64 bits. Thus, this cast is either a no-op, or an up-cast
+			// which are always safe.
+			static_cast<int64_t>(sb.st_size));
+		curl_easy_setopt(single->ptr(), CURLOPT_RESUME_FROM, sb.st_size);
+		dl.set_offset(sb.st_size);
+		file.open(filename, true);
+		resumed_download = true;
+	}
+	reserved = false;
+
+	if (!file.is_open()) {
+		dl.set_status(DlStatus::FAILED, strerror(errno));
+		phase = Phase::DONE;
+		return {};
+	}
+	phase = Phase::STREAMING;
+	return {single->ptr()};
+}
+
+std::vector<CURL*> DownloadJob::start_probe()
+{
+	single.reset(new CurlHandle());
+	set_up_handle(*single, 1);
+	probe_headers.clear();
+
+	curl_easy_setopt(single->ptr(), CURLOPT_RANGE, "0-0");
+	curl_easy_setopt(single->ptr(), CURLOPT_WRITEFUNCTION, discard_data);
+	curl_easy_setopt(single->ptr(), CURLOPT_WRITEDATA, single->ptr());
+	curl_easy_setopt(single->ptr(), CURLOPT_HEADERFUNCTION, collect_header);
+	curl_easy_setopt(single->ptr(), CURLOPT_HEADERDATA, &probe_headers);
+	// Servers that ignore the range would send the whole file
+	curl_easy_setopt(single->ptr(), CURLOPT_MAXFILESIZE, 1L);
+
+	phase = Phase::PROBING;
+	return {single->ptr()};
+}
+
+std::uint64_t DownloadJob::probed_size(CURLcode result)
+{
+	if (result != CURLE_OK || !is_partial_content(single->ptr())) {
+		LOG(Level::DEBUG,
+			"DownloadJob::probed_size: no ranges, rc = %u (%s)",
+			result,
+			curl_easy_strerror(result));
+		return 0;
+	}
+
+	// "Content-Range: bytes 0-0/<size>", of the last of the answers if
+	// there were redirects
+	std::uint64_t size = 0;
+	for (auto header : probe_headers) {
+		std::transform(header.begin(), header.end(), header.begin(),
+			::tolower);
+		if (header.compare(0, 14, "content-range:") != 0) {
+			continue;
+		}
+		const auto slash = header.find('/');
+		size = (slash == std::string::npos)
+			? 0
+			: std::strtoull(header.c_str() + slash + 1, nullptr, 10);
+	}
+	return size;
+}
+
+std::vector<CURL*> DownloadJob::start_segments(std::uint64_t size)
+{
+	const int count = cfg.get_configvalue_as_int("download-segments");
+	const std::string state_file = filename + SEGMENTS_SUFFIX;
+	struct stat sb;
+	const bool have_part = stat(filename.c_str(), &sb) == 0;
+
+	const bool resumed = have_part && segments.load(state_file, size);
+	if (!resumed) {
+		segments = DownloadSegments::split(size, count, MIN_SEGMENT_SIZE);
+	}
+	if (segments.segments.size() < 2) {
+		LOG(Level::INFO,
+			"DownloadJob::start_segments: %" PRIu64 " bytes can't be "
+			"split, using a single stream",
+			size);
+		if (::unlink(state_file.c_str()) == 0) {
+			::unlink(filename.c_str());
+		}
+		return start_stream();
+	}
+
+	if (!resumed) {
+		make_parent_dirs(filename);
+	}
+	fd = ::open(filename.c_str(),
+			resumed ? O_RDWR : (O_RDWR | O_CREAT | O_TRUNC), 0644);
+	// The file gets its full size up front, so that each segment can be
+	// written at its offset as it arrives; allocating the space keeps it
+	// from ending up in pieces all over the disk
+	if (fd != -1) {
+		const int rc = ::posix_fallocate(fd, 0, size);
+		if (rc != 0) {
+			LOG(Level::DEBUG,
+				"DownloadJob::start_segments: posix_fallocate failed: %s",
+				strerror(rc));
+		}
+	}
+	if (fd == -1 || ::ftruncate(fd, size) != 0) {
+		dl.set_status(DlStatus::FAILED, strerror(errno));
+		phase = Phase::DONE;
+		return {};
+	}
+	segments.save(state_file);
+	last_save = std::chrono::steady_clock::now();
+	LOG(Level::INFO,
+		"DownloadJob::start_segments: %s %" PRIu64 " bytes in %" PRIu64
+		" segments, %" PRIu64 " of them there already",
+		resumed ? "resuming" : "starting",
+		size,
+		static_cast<uint64_t>(segments.segments.size()),
+		segments.downloaded());
+
+	dl.set_offset(0);
+	phase = Phase::SEGMENTED;
+	segments_result = CURLE_OK;
+	std::vector<CURL*> handles;
+	for (auto& segment : segments.segments) {
+		if (segment.done == segment.end - segment.start) {
+			continue;
+		}
+		transfers.emplace_back(new SegmentTransfer{this, CurlHandle(), &segment, {}});
+		CurlHandle& handle = transfers.back()->handle;
+		set_up_handle(handle, segments.segments.size());
+
+		const std::string range = strprintf::fmt("%" PRIu64 "-%" PRIu64,
+				segment.start + segment.done,
+				segment.end - 1);
+		curl_easy_setopt(handle.ptr(), CURLOPT_RANGE, range.c_str());
+		curl_easy_setopt(handle.ptr(), CURLOPT_WRITEFUNCTION,
+			write_segment_data);
+		curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, transfers.back().get());
+		handles.push_back(handle.ptr());
+	}
+	segments_running = handles.size();
+	if (handles.empty()) {
+		segments_done();
+	}
+	return handles;
+}
+
+size_t DownloadJob::write_segment_data(void* buffer, size_t size,
+	size_t nmemb, void* userp)
+{
+	auto transfer = static_cast<SegmentTransfer*>(userp);
+	if (!is_partial_content(transfer->handle.ptr())) {
+		return 0;
+	}
+	return transfer->job->write_segment(buffer, size * nmemb, *transfer);
+}
+
+std::vector<CURL*> DownloadJob::transfer_done(CURL* handle, CURLcode result)
+{
+	switch (phase) {
+	case Phase::PROBING: {
+		const std::uint64_t size = probed_size(result);
+		single.reset();
+		if (dl.status() == DlStatus::CANCELLED) {
+			phase = Phase::DONE;
+			return {};
+		}
+		return start_segments(size);
+	}
+	case Phase::STREAMING:
+		return stream_done(result);
+	case Phase::SEGMENTED: {
+		const auto transfer = std::find_if(transfers.begin(), transfers.end(),
+		[&](const std::unique_ptr<SegmentTransfer>& t) {
+			return t->handle.ptr() == handle;
+		});
+		if (transfer != transfers.end() && !flush_segment(**transfer)
+			&& result == CURLE_OK) {
+			result = CURLE_WRITE_ERROR;
+		}
+		if (result != CURLE_OK && segments_result == CURLE_OK) {
+			segments_result = result;
+		}
+		if (--segments_running == 0) {
+			segments_done();
+		}
+		LOG(Level::DEBUG,
+			"DownloadJob::transfer_done: segment transfer %p done, rc = %u",
+			static_cast<void*>(handle),
+			result);
+		return {};
+	}
+	case Phase::DONE:
+		break;
+	}
+	return {};
+}
+
+std::vector<CURL*> DownloadJob::stream_done(CURLcode success)
+{
+	report_progress();
+	if (!file.close(cfg.get_configvalue_as_bool("download-fsync"))
+		&& success == CURLE_OK) {
+		success = CURLE_WRITE_ERROR;
+	}
+	single.reset();
+	phase = Phase::DONE;
+
+	LOG(Level::INFO,
+		"DownloadJob::stream_done: curl_easy_perform rc = %u (%s)",
+		success,
+		curl_easy_strerror(success));
+
+	if (0 == success) {
+		LOG(Level::DEBUG,
+			"DownloadJob::stream_done: download complete, deleting "
+			"temporary suffix");
+		finish();
+	} else if (dl.status() != DlStatus::CANCELLED) {
+		// attempt complete re-download
+		if (resumed_download) {
+			::unlink(filename.c_str());
+			return start();
+		} else {
+			dl.set_status(DlStatus::FAILED, curl_easy_strerror(success));
+			::unlink(filename.c_str());
+		}
+	}
+	return {};
+}
+
+void DownloadJob::segments_done()
+{
+	if (!flush_segments() && segments_result == CURLE_OK) {
+		segments_result = CURLE_WRITE_ERROR;
+	}
+	if (segments_result == CURLE_OK && segments.complete()
+		&& cfg.get_configvalue_as_bool("download-fsync")
+		&& ::fsync(fd) != 0) {
+		segments_result = CURLE_WRITE_ERROR;
+	}
+	report_progress();
+	::close(fd);
+	fd = -1;
+	phase = Phase::DONE;
+	const std::string state_file = filename + SEGMENTS_SUFFIX;
+
+	LOG(Level::INFO,
+		"DownloadJob::segments_done: rc = %u (%s), %" PRIu64 " of %" PRIu64
+		" bytes",
+		segments_result,
+		curl_easy_strerror(segments_result),
+		segments.downloaded(),
+		segments.size());
+
+	if (segments_result == CURLE_OK && segments.complete()) {
+		::unlink(state_file.c_str());
+		finish();
+		return;
+	}
+
+	// What arrived stays, for the next attempt to resume
+	segments.save(state_file);
+	if (dl.status() != DlStatus::CANCELLED) {
+		dl.set_status(DlStatus::FAILED, segments_result == CURLE_OK
+			? "incomplete download"
+			: curl_easy_strerror(segments_result));
+	}
+}
+
+void DownloadJob::finish()
+{
+	if (rename(filename.c_str(), dl.filename().c_str()) == 0) {
+		dl.set_status(DlStatus::READY);
+	} else {
+		dl.set_status(DlStatus::RENAME_FAILED, strerror(errno));
+	}
+}
+
+bool DownloadJob::tick()
+{
+	if (phase == Phase::DONE) {
+		return true;
+	}
+	if (dl.status() == DlStatus::CANCELLED) {
+		return false;
+	}
+	const auto now = std::chrono::steady_clock::now();
+	if (now - last_report >= PROGRESS_REPORT_INTERVAL) {
+		report_progress();
+		last_report = now;
+	}
+	if (phase == Phase::SEGMENTED) {
+		if (now - last_save >= SEGMENTS_SAVE_INTERVAL) {
+			// The state only counts what's written
+			flush_segments();
+			segments.save(filename + SEGMENTS_SUFFIX);
+			last_save = now;
+		}
+	}
+	return true;
+}
+
+void DownloadJob::abort()
+{
+	switch (phase) {
+	case Phase::STREAMING:
+		file.close(false);
+		break;
+	case Phase::SEGMENTED:
+		flush_segments();
+		::close(fd);
+		fd = -1;
+		segments.save(filename + SEGMENTS_SUFFIX);
+		break;
+	case Phase::PROBING:
+	case Phase::DONE:
+		break;
+	}
+	single.reset();
+	transfers.clear();
+	phase = Phase::DONE;
+}
+
+size_t DownloadJob::write_stream(void* buffer, size_t length)
+{
+	if (dl.status() == DlStatus::CANCELLED) {
+		return 0;
+	}
+	if (!limiter.take(single->ptr(), length)) {
+		return CURL_WRITEFUNC_PAUSE;
+	}
+	if (!reserved) {
+		reserved = true;
+		double length_left = -1;
+		curl_easy_getinfo(single->ptr(), CURLINFO_CONTENT_LENGTH_DOWNLOAD,
+			&length_left);
+		if (length_left > 0) {
+			file.reserve(length_left);
+		}
+	}
+	if (!file.write(static_cast<char*>(buffer), length)) {
+		return 0;
+	}
+	bytecount += length;
+	return length;
+}
+
+size_t DownloadJob::write_segment(void* buffer, size_t length,
+	SegmentTransfer& transfer)
+{
+	if (dl.status() == DlStatus::CANCELLED) {
+		return 0;
+	}
+	if (!limiter.take(transfer.handle.ptr(), length)) {
+		return CURL_WRITEFUNC_PAUSE;
+	}
+	const DownloadSegments::Segment& segment = *transfer.segment;
+	const std::uint64_t left = segment.end - segment.start - segment.done
+		- transfer.pending.size();
+	const size_t wanted = std::min<std::uint64_t>(length, left);
+	const char* data = static_cast<char*>(buffer);
+	if (transfer.pending.capacity() == 0) {
+		transfer.pending.reserve(SEGMENT_BUFFER_SIZE);
+	}
+	transfer.pending.insert(transfer.pending.end(), data, data + wanted);
+	if (transfer.pending.size() >= SEGMENT_BUFFER_SIZE
+		&& !flush_segment(transfer)) {
+		return 0;
+	}
+	bytecount += wanted;
+	// More than the segment holds means the server sent something else
+	return wanted == length ? length : 0;
+}
+
+bool DownloadJob::flush_segment(SegmentTransfer& transfer)
+{
+	DownloadSegments::Segment& segment = *transfer.segment;
+	const char* data = transfer.pending.data();
+	size_t written = 0;
+	while (written < transfer.pending.size()) {
+		const ssize_t rc = ::pwrite(fd, data + written,
+				transfer.pending.size() - written,
+				segment.start + segment.done);
+		if (rc < 0 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			LOG(Level::ERROR,
+				"DownloadJob::flush_segment: pwrite failed: %s",
+				strerror(errno));
+			transfer.pending.erase(transfer.pending.begin(),
+				transfer.pending.begin() + written);
+			return false;
+		}
+		written += rc;
+		segment.done += rc;
+	}
+	transfer.pending.clear();
+	return true;
+}
+
+bool DownloadJob::flush_segments()
+{
+	bool ok = true;
+	for (auto& transfer : transfers) {
+		ok = flush_segment(*transfer) && ok;
+	}
+	return ok;
+}
+
+int DownloadJob::progress(double dlnow, double dltotal)
+{
+	if (dl.status() == DlStatus::CANCELLED) {
+		return -1;
+	}
+	stream_now = dlnow;
+	stream_total = dltotal;
+	return 0;
+}
+
+void DownloadJob::report_progress()
+{
+	double dlnow = 0;
+	double dltotal = 0;
+	switch (phase) {
+	case Phase::STREAMING:
+		dlnow = stream_now;
+		dltotal = stream_total;
+		break;
+	case Phase::SEGMENTED:
+		dlnow = segments.downloaded();
+		dltotal = segments.size();
+		break;
+	case Phase::PROBING:
+	case Phase::DONE:
+		return;
+	}
+
+	using fpseconds = std::chrono::duration<double>;
+	const auto tv2 = std::chrono::steady_clock::now();
+	const double elapsed = std::chrono::duration_cast<fpseconds>(tv2 - tv1).count();
+	dl.set_kbps((bytecount / elapsed) / 1024);
+	dl.set_progress(dlnow, dltotal);
+}
+
+} // namespace podboat
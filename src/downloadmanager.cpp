@@ -0,0 +1,335 @@
+#include "downloadmanager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <stdexcept>
+
+#include "downloadjob.h"
+#include "logger.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace podboat {
+
+namespace {
+
+/// curl_multi_wakeup() and curl_multi_poll() appeared in curl 7.68.0.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define PODBOAT_CURL_MULTI_WAKEUP
+#endif
+
+/// How often the jobs get to update their progress, at least
+const int POLL_TIMEOUT_MS = 500;
+#ifndef PODBOAT_CURL_MULTI_WAKEUP
+/// Without a way to wake up curl_multi_wait(), this is how late the thread
+/// can notice that a download was started.
+const int NO_WAKEUP_POLL_TIMEOUT_MS = 100;
+#endif
+/// How soon the transfers that the bandwidth limit paused are looked at
+/// again
+const int PAUSED_POLL_TIMEOUT_MS = 50;
+
+const std::chrono::seconds SPEED_LIMIT_CHECK_INTERVAL(1);
+
+}
+
+DownloadManager::DownloadManager(ConfigContainer& cfg,
+	const SpeedSchedule& schedule)
+	: cfg(cfg)
+	, schedule(schedule)
+	, multi(curl_multi_init())
+	, max_downloads(std::max(1, cfg.get_configvalue_as_int("max-downloads")))
+	, max_per_host(std::max(0,
+			cfg.get_configvalue_as_int("max-downloads-per-host")))
+	, stopping(false)
+	, default_limit(std::max(0,
+			cfg.get_configvalue_as_int("max-total-download-speed")) * 1024)
+	, current_limit(0)
+{
+	if (!multi) {
+		throw std::runtime_error("Can't obtain curl multi handle");
+	}
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	// The segments of a download are only faster if each of them gets a
+	// connection of its own, rather than sharing one through HTTP/2
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+#endif
+	worker = std::thread(&DownloadManager::run, this);
+}
+
+DownloadManager::~DownloadManager()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+		wake_up_unlocked();
+	}
+	worker.join();
+	curl_multi_cleanup(multi);
+}
+
+void DownloadManager::enqueue(Download& dl, int priority)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto existing = std::find_if(queued.begin(), queued.end(),
+	[&](const Queued& entry) {
+		return entry.dl == &dl;
+	});
+	if (existing != queued.end()) {
+		if (existing->now || existing->priority >= priority) {
+			return;
+		}
+		queued.erase(existing);
+	}
+
+	// After the downloads of the same priority that were queued earlier
+	const auto position = std::find_if(queued.begin(), queued.end(),
+	[&](const Queued& entry) {
+		return !entry.now && entry.priority < priority;
+	});
+	queued.insert(position, Queued{&dl, priority, false});
+	wake_up_unlocked();
+}
+
+void DownloadManager::start_now(Download& dl)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	queued.erase(std::remove_if(queued.begin(), queued.end(),
+	[&](const Queued& entry) {
+		return entry.dl == &dl;
+	}), queued.end());
+	queued.push_front(Queued{&dl, 0, true});
+	wake_up_unlocked();
+}
+
+void DownloadManager::clear_queue()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	queued.clear();
+}
+
+void DownloadManager::set_max_downloads(unsigned int max)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	max_downloads = std::max(1u, max);
+	wake_up_unlocked();
+}
+
+void DownloadManager::wake_up_unlocked()
+{
+	queue_changed.notify_one();
+#ifdef PODBOAT_CURL_MULTI_WAKEUP
+	curl_multi_wakeup(multi);
+#endif
+}
+
+void DownloadManager::run()
+{
+	LOG(Level::DEBUG, "DownloadManager::run: started");
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			if (stopping) {
+				break;
+			}
+			start_queued_unlocked();
+			if (jobs.empty()) {
+				queue_changed.wait(lock);
+				continue;
+			}
+		}
+
+		update_speed_limit();
+		for (CURL* handle : limiter.resumable(BandwidthLimiter::Clock::now())) {
+			curl_easy_pause(handle, CURLPAUSE_CONT);
+		}
+
+		int still_running = 0;
+		const CURLMcode rc = curl_multi_perform(multi, &still_running);
+		if (rc != CURLM_OK) {
+			LOG(Level::ERROR,
+				"DownloadManager::run: curl_multi_perform failed: %s",
+				curl_multi_strerror(rc));
+		}
+		complete_transfers();
+		tick_jobs();
+
+		if (!jobs.empty()) {
+			wait_for_activity();
+		}
+	}
+
+	// The partial files stay for the next time
+	for (auto& running : jobs) {
+		remove_transfers(*running.job);
+		running.job->abort();
+	}
+	jobs.clear();
+	hosts.clear();
+	LOG(Level::DEBUG, "DownloadManager::run: finished");
+}
+
+void DownloadManager::start_queued_unlocked()
+{
+	auto entry = queued.begin();
+	while (entry != queued.end()) {
+		Download& dl = *entry->dl;
+		const bool running = std::any_of(jobs.begin(), jobs.end(),
+		[&](const Running& job) {
+			return &job.job->download() == &dl;
+		});
+		if (running || (!entry->now && dl.status() != DlStatus::QUEUED)) {
+			entry = queued.erase(entry);
+			continue;
+		}
+
+		const std::string host = utils::host_of(dl.url());
+		if (!entry->now) {
+			if (jobs.size() >= max_downloads) {
+				break;
+			}
+			// Downloads from other hosts don't wait for this one
+			if (max_per_host != 0 && hosts[host] >= max_per_host) {
+				++entry;
+				continue;
+			}
+		}
+
+		entry = queued.erase(entry);
+		start_job(dl, host);
+	}
+	LOG(Level::DEBUG,
+		"DownloadManager::start_queued_unlocked: %" PRIu64 " running, %"
+		PRIu64 " queued",
+		static_cast<uint64_t>(jobs.size()),
+		static_cast<uint64_t>(queued.size()));
+}
+
+void DownloadManager::start_job(Download& dl, const std::string& host)
+{
+	Running running;
+	running.job.reset(new DownloadJob(dl, cfg, limiter));
+	running.host = host;
+	++hosts[host];
+	DownloadJob& job = *running.job;
+	jobs.push_back(std::move(running));
+
+	add_transfers(job, job.start());
+}
+
+void DownloadManager::add_transfers(DownloadJob& job,
+	const std::vector<CURL*>& handles)
+{
+	for (CURL* handle : handles) {
+		const CURLMcode rc = curl_multi_add_handle(multi, handle);
+		if (rc != CURLM_OK) {
+			LOG(Level::ERROR,
+				"DownloadManager::add_transfers: can't add a transfer: %s",
+				curl_multi_strerror(rc));
+			add_transfers(job, job.transfer_done(handle, CURLE_FAILED_INIT));
+			continue;
+		}
+		owners[handle] = &job;
+	}
+}
+
+void DownloadManager::complete_transfers()
+{
+	int messages_left = 0;
+	while (CURLMsg* msg = curl_multi_info_read(multi, &messages_left)) {
+		if (msg->msg != CURLMSG_DONE) {
+			continue;
+		}
+		CURL* handle = msg->easy_handle;
+		const CURLcode result = msg->data.result;
+		curl_multi_remove_handle(multi, handle);
+		limiter.forget(handle);
+
+		const auto owner = owners.find(handle);
+		if (owner == owners.end()) {
+			continue;
+		}
+		DownloadJob& job = *owner->second;
+		owners.erase(owner);
+		add_transfers(job, job.transfer_done(handle, result));
+	}
+}
+
+void DownloadManager::tick_jobs()
+{
+	auto running = jobs.begin();
+	while (running != jobs.end()) {
+		DownloadJob& job = *running->job;
+		if (!job.tick()) {
+			LOG(Level::DEBUG,
+				"DownloadManager::tick_jobs: %s was cancelled",
+				job.download().url());
+			remove_transfers(job);
+			job.abort();
+		}
+		if (!job.done()) {
+			++running;
+			continue;
+		}
+
+		auto host = hosts.find(running->host);
+		if (host != hosts.end() && --host->second == 0) {
+			hosts.erase(host);
+		}
+		running = jobs.erase(running);
+	}
+}
+
+void DownloadManager::remove_transfers(DownloadJob& job)
+{
+	auto owner = owners.begin();
+	while (owner != owners.end()) {
+		if (owner->second != &job) {
+			++owner;
+			continue;
+		}
+		curl_multi_remove_handle(multi, owner->first);
+		limiter.forget(owner->first);
+		owner = owners.erase(owner);
+	}
+}
+
+void DownloadManager::update_speed_limit()
+{
+	const auto now = BandwidthLimiter::Clock::now();
+	if (now < next_limit_check) {
+		return;
+	}
+	next_limit_check = now + SPEED_LIMIT_CHECK_INTERVAL;
+
+	const auto scheduled = schedule.current_limit();
+	const std::uint64_t limit = scheduled ? *scheduled * 1024ull : default_limit;
+	if (limit != current_limit) {
+		LOG(Level::INFO,
+			"DownloadManager::update_speed_limit: %" PRIu64 " bytes/s",
+			limit);
+		limiter.set_limit(limit);
+		current_limit = limit;
+	}
+}
+
+void DownloadManager::wait_for_activity()
+{
+	int timeout_ms = limiter.has_paused() ? PAUSED_POLL_TIMEOUT_MS :
+		POLL_TIMEOUT_MS;
+#ifdef PODBOAT_CURL_MULTI_WAKEUP
+	const CURLMcode rc = curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+#else
+	timeout_ms = std::min(timeout_ms, NO_WAKEUP_POLL_TIMEOUT_MS);
+	const CURLMcode rc = curl_multi_wait(multi, nullptr, 0, timeout_ms, nullptr);
+#endif
+	if (rc != CURLM_OK) {
+		LOG(Level::ERROR,
+			"DownloadManager::wait_for_activity: waiting failed: %s",
+			curl_multi_strerror(rc));
+	}
+}
+
+} // namespace podboat
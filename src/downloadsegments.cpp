@@ -0,0 +1,122 @@
+#include "downloadsegments.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace podboat {
+
+namespace {
+
+/// The first word of a state file, followed by the format's version
+const char* const STATE_HEADER = "segments";
+const unsigned int STATE_VERSION = 1;
+
+}
+
+DownloadSegments::DownloadSegments()
+	: total(0)
+{
+}
+
+DownloadSegments DownloadSegments::split(std::uint64_t size,
+	unsigned int count,
+	std::uint64_t min_segment)
+{
+	DownloadSegments result;
+	result.total = size;
+	if (size == 0) {
+		return result;
+	}
+
+	std::uint64_t segments = std::max(1u, count);
+	if (min_segment > 0) {
+		segments = std::min(segments, std::max<std::uint64_t>(1, size / min_segment));
+	}
+	const std::uint64_t length = size / segments;
+	for (std::uint64_t i = 0; i < segments; ++i) {
+		const std::uint64_t start = i * length;
+		// The last segment also takes what's left over from dividing
+		const std::uint64_t end = (i + 1 == segments) ? size : start + length;
+		result.segments.push_back(Segment{start, end, 0});
+	}
+	return result;
+}
+
+bool DownloadSegments::load(const std::string& path,
+	std::uint64_t expected_size)
+{
+	std::ifstream in(path);
+	if (!in.is_open()) {
+		return false;
+	}
+
+	std::string header;
+	unsigned int version = 0;
+	std::uint64_t size = 0;
+	if (!(in >> header >> version >> size) || header != STATE_HEADER
+		|| version != STATE_VERSION || size != expected_size || size == 0) {
+		return false;
+	}
+
+	// The segments have to cover the whole file, one after the other
+	std::vector<Segment> loaded;
+	std::uint64_t next = 0;
+	Segment segment;
+	while (in >> segment.start >> segment.end >> segment.done) {
+		if (segment.start != next || segment.end <= segment.start
+			|| segment.done > segment.end - segment.start) {
+			return false;
+		}
+		next = segment.end;
+		loaded.push_back(segment);
+	}
+	if (!in.eof() || next != size) {
+		return false;
+	}
+
+	segments = std::move(loaded);
+	total = size;
+	return true;
+}
+
+bool DownloadSegments::save(const std::string& path) const
+{
+	std::ostringstream out;
+	out << STATE_HEADER << ' ' << STATE_VERSION << ' ' << total << '\n';
+	for (const auto& segment : segments) {
+		out << segment.start << ' ' << segment.end << ' ' << segment.done << '\n';
+	}
+
+	const std::string tmp = path + ".tmp";
+	{
+		std::ofstream f(tmp, std::ofstream::trunc);
+		f << out.str();
+		f.close();
+		if (!f) {
+			std::remove(tmp.c_str());
+			return false;
+		}
+	}
+	return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+std::uint64_t DownloadSegments::downloaded() const
+{
+	std::uint64_t result = 0;
+	for (const auto& segment : segments) {
+		result += segment.done;
+	}
+	return result;
+}
+
+bool DownloadSegments::complete() const
+{
+	return std::all_of(segments.begin(), segments.end(),
+	[](const Segment& segment) {
+		return segment.done == segment.end - segment.start;
+	});
+}
+
+} // namespace podboat
@@ -0,0 +1,157 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+/// Network requests hardly take up a core, so a few of them at once don't
+/// depend on how many there are.
+const unsigned int DEFAULT_IO_THREADS = 4;
+
+}
+
+Executor& Executor::instance()
+{
+	static Executor* const executor = new Executor();
+	return *executor;
+}
+
+Executor::Executor()
+{
+	queue(Pool::IO).max_threads = DEFAULT_IO_THREADS;
+	queue(Pool::CPU).max_threads = std::max(1u,
+			std::thread::hardware_concurrency());
+}
+
+Executor::Queue& Executor::queue(Pool pool)
+{
+	return queues[pool == Pool::IO ? 0 : 1];
+}
+
+void Executor::set_max_threads(Pool pool, unsigned int threads)
+{
+	auto& q = queue(pool);
+	{
+		std::lock_guard<std::mutex> lock(q.mtx);
+		q.max_threads = std::max(threads, 1u);
+	}
+	q.not_empty.notify_all();
+}
+
+unsigned int Executor::max_threads(Pool pool)
+{
+	auto& q = queue(pool);
+	std::lock_guard<std::mutex> lock(q.mtx);
+	return q.max_threads;
+}
+
+void Executor::submit(Pool pool, Priority priority, Job job)
+{
+	auto& q = queue(pool);
+	bool start_thread = false;
+	{
+		std::lock_guard<std::mutex> lock(q.mtx);
+		q.jobs[static_cast<std::size_t>(priority)].push_back(std::move(job));
+		++q.pending;
+		if (q.pending > q.idle && q.threads < q.max_threads) {
+			++q.threads;
+			start_thread = true;
+		}
+	}
+	if (start_thread) {
+		std::thread(&Executor::run, this, std::ref(q)).detach();
+	} else {
+		q.not_empty.notify_one();
+	}
+}
+
+void Executor::run(Queue& q)
+{
+	std::unique_lock<std::mutex> lock(q.mtx);
+	for (;;) {
+		++q.idle;
+		q.not_empty.wait(lock, [&]() {
+			return q.pending > 0 || q.threads > q.max_threads;
+		});
+		--q.idle;
+		if (q.threads > q.max_threads) {
+			--q.threads;
+			return;
+		}
+
+		Job job;
+		for (auto& jobs : q.jobs) {
+			if (!jobs.empty()) {
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				break;
+			}
+		}
+		--q.pending;
+		lock.unlock();
+
+		try {
+			job();
+		} catch (const std::exception& e) {
+			LOG(Level::ERROR, "Executor::run: a job failed: %s", e.what());
+		} catch (...) {
+			LOG(Level::ERROR, "Executor::run: a job failed");
+		}
+
+		// Whatever the job captured goes away before the lock is taken
+		job = nullptr;
+		lock.lock();
+	}
+}
+
+void Executor::run_workers(Pool pool, Priority priority, unsigned int threads,
+	const Job& worker)
+{
+	struct Copies {
+		std::mutex mtx;
+		std::condition_variable finished;
+		unsigned int running = 0;
+		bool closed = false;
+	};
+	const auto copies = std::make_shared<Copies>();
+
+	for (unsigned int i = 1; i < threads; ++i) {
+		// The worker is only used by copies that started before the
+		// calling thread waits for them, so it outlives them
+		submit(pool, priority, [copies, &worker]() {
+			{
+				std::lock_guard<std::mutex> lock(copies->mtx);
+				if (copies->closed) {
+					return;
+				}
+				++copies->running;
+			}
+			try {
+				worker();
+			} catch (...) {
+				LOG(Level::ERROR, "Executor::run_workers: a worker threw");
+			}
+			std::lock_guard<std::mutex> lock(copies->mtx);
+			--copies->running;
+			copies->finished.notify_all();
+		});
+	}
+
+	worker();
+
+	std::unique_lock<std::mutex> lock(copies->mtx);
+	copies->closed = true;
+	copies->finished.wait(lock, [&]() {
+		return copies->running == 0;
+	});
+}
+
+} // namespace newsboat
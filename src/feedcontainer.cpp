@@ -1,145 +1,181 @@
 #include "feedcontainer.h"
 
-#include <algorithm> // stable_sort
-#include <numeric>   // accumulate
+#include <algorithm>
 #include <unordered_set>
 
+#include "keyedsort.h"
 #include "rssfeed.h"
 #include "utils.h"
 
 namespace newsboat {
 
+FeedContainer::~FeedContainer()
+{
+	for (const auto& feed : feeds) {
+		detach(feed);
+	}
+}
+
+void FeedContainer::attach(const std::shared_ptr<RssFeed>& feed)
+{
+	feed->set_unread_guids(&unread_guids);
+	feed->set_tag_index(&tag_index);
+	feed->set_title_index(&title_index);
+}
+
+void FeedContainer::detach(const std::shared_ptr<RssFeed>& feed)
+{
+	feed->set_unread_guids(nullptr);
+	feed->set_tag_index(nullptr);
+	feed->set_title_index(nullptr);
+}
+
 void FeedContainer::sort_feeds(const FeedSortStrategy& sort_strategy)
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
 
+	// Each feed's key is read once, rather than for every comparison
+	using Feed = std::shared_ptr<RssFeed>;
+	const auto sd = sort_strategy.sd;
 	switch (sort_strategy.sm) {
 	case FeedSortMethod::NONE:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			if (sort_strategy.sd == SortDirection::ASC) {
-				return a->get_order() > b->get_order();
-			} else {
-				return a->get_order() < b->get_order();
-			}
+		keyedsort::sort_by_key<unsigned int>(feeds, [](const Feed& feed) {
+			return feed->get_order();
+		}, [=](unsigned int a, unsigned int b) {
+			return sd == SortDirection::ASC ? a > b : a < b;
 		});
 		break;
 	case FeedSortMethod::FIRST_TAG:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			if (a->get_firsttag().length() == 0 ||
-				b->get_firsttag().length() == 0) {
-				bool result =
-					a->get_firsttag().length() > b->get_firsttag().length();
-				if (sort_strategy.sd == SortDirection::ASC) {
-					result = !result;
-				}
-				return result;
+		keyedsort::sort_by_key<std::string>(feeds, [](const Feed& feed) {
+			return feed->get_firsttag();
+		}, [=](const std::string& a, const std::string& b) {
+			bool result;
+			if (a.length() == 0 || b.length() == 0) {
+				result = a.length() > b.length();
+			} else {
+				result = utils::strnaturalcmp(a, b) < 0;
 			}
-			const auto left = a->get_firsttag();
-			const auto right = b->get_firsttag();
-			bool result = utils::strnaturalcmp(left, right) < 0;
-			if (sort_strategy.sd == SortDirection::ASC) {
+			if (sd == SortDirection::ASC) {
 				result = !result;
 			}
 			return result;
 		});
 		break;
 	case FeedSortMethod::TITLE:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			const auto left = a->title();
-			const auto right = b->title();
-			if (sort_strategy.sd == SortDirection::ASC) {
-				return utils::strnaturalcmp(left, right) > 0;
+		keyedsort::sort_by_key<std::string>(feeds, [](const Feed& feed) {
+			return feed->title();
+		}, [=](const std::string& a, const std::string& b) {
+			if (sd == SortDirection::ASC) {
+				return utils::strnaturalcmp(a, b) > 0;
 			} else {
-				return utils::strnaturalcmp(left, right) < 0;
+				return utils::strnaturalcmp(a, b) < 0;
 			}
 		});
 		break;
 	case FeedSortMethod::ARTICLE_COUNT:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			if (sort_strategy.sd == SortDirection::ASC) {
-				return a->total_item_count() > b->total_item_count();
-			} else {
-				return a->total_item_count() < b->total_item_count();
-			}
+		keyedsort::sort_by_key<unsigned int>(feeds, [](const Feed& feed) {
+			return feed->total_item_count();
+		}, [=](unsigned int a, unsigned int b) {
+			return sd == SortDirection::ASC ? a > b : a < b;
 		});
 		break;
 	case FeedSortMethod::UNREAD_ARTICLE_COUNT:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			if (sort_strategy.sd == SortDirection::DESC) {
-				return a->unread_item_count() < b->unread_item_count();
-			} else {
-				return a->unread_item_count() > b->unread_item_count();
-			}
+		keyedsort::sort_by_key<unsigned int>(feeds, [](const Feed& feed) {
+			return feed->unread_item_count();
+		}, [=](unsigned int a, unsigned int b) {
+			return sd == SortDirection::DESC ? a < b : a > b;
 		});
 		break;
 	case FeedSortMethod::LAST_UPDATED:
-		std::stable_sort(
-			feeds.begin(), feeds.end(),
-		[&](std::shared_ptr<RssFeed> a, std::shared_ptr<RssFeed> b) {
-			if (a->items().size() == 0 || b->items().size() == 0) {
-				bool result = a->items().size() > b->items().size();
-				if (sort_strategy.sd == SortDirection::ASC) {
+		// The number of articles, and the date of the newest one
+		using LastUpdated = std::pair<std::size_t, time_t>;
+		keyedsort::sort_by_key<LastUpdated>(feeds, [](const Feed& feed) {
+			const auto& items = feed->items();
+			time_t newest = 0;
+			for (const auto& item : items) {
+				newest = std::max(newest, item->pubDate_timestamp());
+			}
+			return LastUpdated(items.size(), newest);
+		}, [=](const LastUpdated& a, const LastUpdated& b) {
+			if (a.first == 0 || b.first == 0) {
+				bool result = a.first > b.first;
+				if (sd == SortDirection::ASC) {
 					result = !result;
 				}
 				return result;
 			}
-			auto cmp = [](std::shared_ptr<RssItem> a,
-			std::shared_ptr<RssItem> b) {
-				return *a < *b;
-			};
-			auto& a_item = *std::min_element(a->items().begin(),
-					a->items().end(), cmp);
-			auto& b_item = *std::min_element(b->items().begin(),
-					b->items().end(), cmp);
-
-			if (sort_strategy.sd == SortDirection::DESC) {
-				return *a_item < *b_item;
+			if (sd == SortDirection::DESC) {
+				return b.second < a.second;
 			} else {
-				return *b_item < *a_item;
+				return a.second < b.second;
 			}
 		});
 		break;
 	}
+	index_feed_urls();
+	publish_feeds();
+}
+
+void FeedContainer::index_feed_urls()
+{
+	feed_positions.clear();
+	feed_positions.reserve(feeds.size());
+	for (std::size_t pos = 0; pos < feeds.size(); ++pos) {
+		// Like a scan would, find the first of the feeds with the same URL
+		feed_positions.emplace(feeds[pos]->rssurl(), pos);
+	}
+}
+
+void FeedContainer::publish_feeds()
+{
+	std::atomic_store(&snapshot, std::make_shared<const FeedList>(feeds));
+}
+
+std::shared_ptr<const FeedContainer::FeedList>
+FeedContainer::get_feeds_snapshot() const
+{
+	return std::atomic_load(&snapshot);
 }
 
 std::shared_ptr<RssFeed> FeedContainer::get_feed(const unsigned int pos)
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	if (pos < feeds.size()) {
-		return feeds[pos];
+	const auto current = get_feeds_snapshot();
+	if (pos < current->size()) {
+		return (*current)[pos];
 	}
 	return nullptr;
 }
 
 void FeedContainer::mark_all_feed_items_read(std::shared_ptr<RssFeed> feed)
 {
-	std::lock_guard<std::mutex> lock(feed->item_mutex);
-	std::vector<std::shared_ptr<RssItem>>& items = feed->items();
-	if (items.size() > 0) {
-		bool notify = items[0]->feedurl() != feed->rssurl();
-		LOG(Level::DEBUG,
-			"FeedContainer::mark_all_read: notify = %s",
-			notify ? "yes" : "no");
-		for (const auto& item : items) {
-			item->set_unread_nowrite_notify(false, notify);
+	const auto lock = feed->lock_items_for_reading();
+	std::vector<std::shared_ptr<RssItem>> unread;
+	for (const auto& item : feed->items()) {
+		if (item->unread()) {
+			unread.push_back(item);
+		}
+	}
+	RssFeed::set_items_unread(unread, false);
+
+	// Query feeds share the articles of the feeds they're from, which are
+	// up to date now. Only articles that the feeds have copies of are left.
+	for (const auto& item : unread) {
+		if (item->feedurl() == feed->rssurl()) {
+			continue;
+		}
+		const auto owner = item->get_feedptr();
+		if (owner != nullptr && owner != feed) {
+			const auto owned = owner->get_item_by_guid(item->guid());
+			if (owned != item) {
+				owned->set_unread_nowrite(false);
+			}
 		}
 	}
 }
 
 void FeedContainer::mark_all_feeds_read()
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
+	for (const auto& feed : *get_feeds_snapshot()) {
 		feed->mark_all_items_read();
 	}
 }
@@ -148,67 +184,41 @@ void FeedContainer::add_feed(const std::shared_ptr<RssFeed> feed)
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
 	feeds.push_back(feed);
+	feed_positions.emplace(feed->rssurl(), feeds.size() - 1);
+	attach(feed);
+	publish_feeds();
 }
 
 void FeedContainer::populate_query_feeds()
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
-		if (feed->is_query_feed()) {
-			feed->update_items(feeds);
-		}
-	}
+	RssFeed::update_query_feeds(feeds);
 }
 
 unsigned int FeedContainer::get_feed_count_per_tag(const std::string& tag)
 {
-	unsigned int count = 0;
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
-		if (feed->matches_tag(tag)) {
-			count++;
-		}
-	}
-
-	return count;
+	return tag_index.feed_count(tag);
 }
 
 unsigned int FeedContainer::get_unread_feed_count_per_tag(
 	const std::string& tag)
 {
-	unsigned int count = 0;
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
-		if (feed->matches_tag(tag) && feed->unread_item_count() > 0) {
-			count++;
-		}
-	}
-
-	return count;
+	return tag_index.unread_feed_count(tag);
 }
 
 unsigned int FeedContainer::get_unread_item_count_per_tag(
 	const std::string& tag)
 {
-	unsigned int count = 0;
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
-		if (feed->matches_tag(tag)) {
-			count += feed->unread_item_count();
-		}
-	}
-
-	return count;
+	return tag_index.unread_item_count(tag);
 }
 
 std::shared_ptr<RssFeed> FeedContainer::get_feed_by_url(
 	const std::string& feedurl)
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (const auto& feed : feeds) {
-		if (feedurl == feed->rssurl()) {
-			return feed;
-		}
+	const auto it = feed_positions.find(feedurl);
+	if (it != feed_positions.end()) {
+		return feeds[it->second];
 	}
 	LOG(Level::ERROR,
 		"FeedContainer:get_feed_by_url failed for %s",
@@ -218,9 +228,9 @@ std::shared_ptr<RssFeed> FeedContainer::get_feed_by_url(
 
 unsigned int FeedContainer::get_pos_of_next_unread(unsigned int pos)
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	for (pos++; pos < feeds.size(); pos++) {
-		if (feeds[pos]->unread_item_count() > 0) {
+	const auto current = get_feeds_snapshot();
+	for (pos++; pos < current->size(); pos++) {
+		if ((*current)[pos]->unread_item_count() > 0) {
 			break;
 		}
 	}
@@ -229,14 +239,12 @@ unsigned int FeedContainer::get_pos_of_next_unread(unsigned int pos)
 
 unsigned int FeedContainer::feeds_size()
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	return feeds.size();
+	return get_feeds_snapshot()->size();
 }
 
 void FeedContainer::reset_feeds_status()
 {
-	std::lock_guard<std::mutex> feedlock(feeds_mutex);
-	for (const auto& feed : feeds) {
+	for (const auto& feed : *get_feeds_snapshot()) {
 		feed->reset_status();
 	}
 }
@@ -245,20 +253,27 @@ void FeedContainer::set_feeds(
 	const std::vector<std::shared_ptr<RssFeed>> new_feeds)
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
+	for (const auto& feed : feeds) {
+		detach(feed);
+	}
 	feeds = new_feeds;
+	for (const auto& feed : feeds) {
+		attach(feed);
+	}
+	index_feed_urls();
+	publish_feeds();
 }
 
 std::vector<std::shared_ptr<RssFeed>> FeedContainer::get_all_feeds() const
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	return feeds;
+	return *get_feeds_snapshot();
 }
 
 unsigned int FeedContainer::unread_feed_count() const
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-	return std::count_if(feeds.begin(),
-			feeds.end(),
+	const auto current = get_feeds_snapshot();
+	return std::count_if(current->begin(),
+			current->end(),
 	[](const std::shared_ptr<RssFeed> feed) {
 		return feed->unread_item_count() > 0;
 	});
@@ -266,41 +281,41 @@ unsigned int FeedContainer::unread_feed_count() const
 
 unsigned int FeedContainer::unread_item_count() const
 {
-	std::lock_guard<std::mutex> feedslock(feeds_mutex);
-
-	using guid_set = std::unordered_set<std::string>;
-	const auto unread_guids =
-		std::accumulate(feeds.begin(),
-			feeds.end(),
-			guid_set(),
-	[](guid_set guids, const std::shared_ptr<RssFeed> feed) {
-		// Hidden feeds can't be viewed. The only way to read their articles is
-		// via a query feed; items that aren't in query feeds are completely
-		// inaccessible. Thus, we skip hidden feeds altogether to avoid
-		// counting items that can't be accessed.
-		if (feed->hidden()) {
-			return guids;
-		}
-
-		std::lock_guard<std::mutex> itemslock(feed->item_mutex);
-		for (const auto& item : feed->items()) {
-			if (item->unread()) {
-				guids.insert(item->guid());
-			}
-		}
-
-		return guids;
-	});
-
+	// Hidden feeds can't be viewed. The only way to read their articles is
+	// via a query feed; items that aren't in query feeds are completely
+	// inaccessible. Thus, hidden feeds don't report their items at all, to
+	// avoid counting items that can't be accessed.
 	return unread_guids.size();
 }
 
+std::vector<std::shared_ptr<RssItem>> FeedContainer::search_titles(
+	const std::string& query) const
+{
+	return title_index.search(query);
+}
+
 void FeedContainer::replace_feed(unsigned int pos,
 	std::shared_ptr<RssFeed> feed)
 {
 	std::lock_guard<std::mutex> feedslock(feeds_mutex);
 	assert(pos < feeds.size());
+	detach(feeds[pos]);
+	const bool same_url = feeds[pos]->rssurl() == feed->rssurl();
 	feeds[pos] = feed;
+	attach(feed);
+	if (!same_url) {
+		index_feed_urls();
+	}
+	publish_feeds();
+	replaced_feedurls.insert(feed->rssurl());
+}
+
+std::unordered_set<std::string> FeedContainer::take_replaced_feedurls()
+{
+	std::lock_guard<std::mutex> feedslock(feeds_mutex);
+	std::unordered_set<std::string> result;
+	result.swap(replaced_feedurls);
+	return result;
 }
 
 } // namespace newsboat
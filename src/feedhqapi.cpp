@@ -1,5 +1,6 @@
 #include "feedhqapi.h"
 
+#include <cinttypes>
 #include <cstring>
 #include <curl/curl.h>
 #include <json.h>
@@ -22,6 +23,9 @@
 #define FEEDHQ_API_EDIT_TAG_URL FEEDHQ_API_PREFIX "edit-tag"
 #define FEEDHQ_API_TOKEN_URL FEEDHQ_API_PREFIX "token"
 
+// How many articles a single edit-tag request marks read
+#define FEEDHQ_MARK_READ_BATCH_SIZE 250
+
 namespace newsboat {
 
 FeedHqApi::FeedHqApi(ConfigContainer* c)
@@ -46,7 +50,8 @@ static size_t my_write_data(void* buffer, size_t size, size_t nmemb,
 
 std::string FeedHqApi::retrieve_auth()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 
 	Credentials cred = get_credentials("feedhq", "FeedHQ");
 	if (cred.user.empty() || cred.pass.empty()) {
@@ -93,7 +98,8 @@ std::vector<TaggedFeedUrl> FeedHqApi::get_subscribed_urls()
 {
 	std::vector<TaggedFeedUrl> urls;
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	curl_slist* custom_headers{};
 	add_custom_headers(&custom_headers);
@@ -215,6 +221,32 @@ bool FeedHqApi::mark_article_read(const std::string& guid, bool read)
 	return mark_article_read_with_token(guid, read, token);
 }
 
+bool FeedHqApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	const std::string token = get_new_token();
+	return mark_in_batches(guids, FEEDHQ_MARK_READ_BATCH_SIZE,
+	[&](const std::vector<std::string>& batch) {
+		std::string postcontent;
+		for (const auto& guid : batch) {
+			postcontent += "i=" + guid + "&";
+		}
+		postcontent += strprintf::fmt(
+				"a=user/-/state/com.google/read&r=user/-/state/"
+				"com.google/kept-unread&ac=edit&T=%s",
+				token);
+
+		const std::string result = post_content(cfg->get_configvalue("feedhq-url") + FEEDHQ_API_EDIT_TAG_URL, postcontent);
+
+		LOG(Level::DEBUG,
+			"FeedHqApi::mark_articles_read: %" PRIu64 " articles, "
+			"result = %s",
+			static_cast<uint64_t>(batch.size()),
+			result);
+
+		return result == "OK";
+	});
+}
+
 bool FeedHqApi::mark_article_read_with_token(const std::string& guid,
 	bool read,
 	const std::string& token)
@@ -252,7 +284,8 @@ bool FeedHqApi::mark_article_read_with_token(const std::string& guid,
 
 std::string FeedHqApi::get_new_token()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	curl_slist* custom_headers{};
 
@@ -350,7 +383,8 @@ std::string FeedHqApi::post_content(const std::string& url,
 	std::string result;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	utils::set_common_curl_options(handle, cfg);
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
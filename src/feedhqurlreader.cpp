@@ -69,7 +69,7 @@ nonstd::optional<utils::ReadTextFileError> FeedHqUrlReader::reload()
 		}
 	}
 
-	std::vector<TaggedFeedUrl> feedurls = api->get_subscribed_urls();
+	std::vector<TaggedFeedUrl> feedurls = api->subscriptions();
 	for (const auto& tagged : feedurls) {
 		std::string url = tagged.first;
 		std::vector<std::string> url_tags = tagged.second;
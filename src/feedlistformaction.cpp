@@ -7,12 +7,14 @@
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
 #include "config.h"
 #include "controller.h"
 #include "dbexception.h"
 #include "feedcontainer.h"
 #include "fmtstrformatter.h"
+#include "jobprogress.h"
 #include "listformatter.h"
 #include "logger.h"
 #include "reloader.h"
@@ -24,6 +26,18 @@
 
 namespace newsboat {
 
+namespace {
+
+/// Lines formatted beyond the screen in each direction with
+/// `feedlist-viewport-only`, unless the screen is taller than that.
+const std::uint32_t MIN_SCROLL_MARGIN = 64;
+
+/// How often the search prompt is looked at while it's open, in
+/// milliseconds.
+const unsigned int LIVE_SEARCH_INTERVAL = 150;
+
+}
+
 FeedListFormAction::FeedListFormAction(View* vv,
 	std::string formstr,
 	Cache* cc,
@@ -31,13 +45,16 @@ FeedListFormAction::FeedListFormAction(View* vv,
 	ConfigContainer* cfg,
 	RegexManager& r)
 	: ListFormAction(vv, formstr, "feeds", cfg)
+	, formatted_feeds_width(0)
 	, zero_feedpos(false)
 	, filter_active(false)
+	, filter_version(0)
 	, filterpos(0)
 	, set_filterpos(false)
 	, rxman(r)
 	, filter_container(f)
 	, cache(cc)
+	, live_search(false)
 {
 	valid_cmds.push_back("tag");
 	valid_cmds.push_back("goto");
@@ -51,7 +68,12 @@ void FeedListFormAction::init()
 
 	recalculate_widget_dimensions();
 
-	if (v->get_ctrl()->get_refresh_on_start()) {
+	if (v->get_ctrl()->subscriptions_were_cached()) {
+		// The feed list came from the cache; this updates it, and
+		// reloads once it's done
+		v->get_ctrl()->get_reloader()->start_subscriptions_refresh_thread(
+			v->get_ctrl()->get_refresh_on_start());
+	} else if (v->get_ctrl()->get_refresh_on_start()) {
 		v->get_ctrl()->get_reloader()->start_reload_all_thread();
 	}
 	v->get_ctrl()->update_feedlist();
@@ -69,6 +91,10 @@ FeedListFormAction::~FeedListFormAction() {}
 
 void FeedListFormAction::prepare()
 {
+	if (live_search) {
+		show_live_search_results();
+	}
+
 	const auto sort_strategy = cfg->get_feed_sort_strategy();
 	if (!old_sort_strategy || sort_strategy != *old_sort_strategy) {
 		v->get_ctrl()->get_feedcontainer()->sort_feeds(sort_strategy);
@@ -82,6 +108,17 @@ void FeedListFormAction::prepare()
 		set_pos();
 		do_redraw = false;
 	}
+
+	std::lock_guard<std::mutex> guard(redraw_mtx);
+	if (!list.window_covers_viewport()) {
+		// The cursor has scrolled out of the lines that were handed to STFL
+		draw_feeds();
+	}
+}
+
+unsigned int FeedListFormAction::wait_time() const
+{
+	return live_search ? LIVE_SEARCH_INTERVAL : FormAction::wait_time();
 }
 
 bool FeedListFormAction::process_operation(Operation op,
@@ -462,6 +499,8 @@ REDO:
 			qna.push_back(QnaPair(_("Search for: "), ""));
 			this->start_qna(
 				qna, OP_INT_START_SEARCH, &searchhistory);
+			live_search = true;
+			live_search_query.clear();
 		}
 		break;
 	case OP_GOTO_TITLE:
@@ -596,17 +635,57 @@ void FeedListFormAction::update_visible_feeds(
 
 	bool show_read = cfg->get_configvalue_as_bool("show-read-feeds");
 
+	if (!filter_active) {
+		filter_matches.clear();
+	}
+
 	unsigned int i = 0;
 	for (const auto& feed : feeds) {
 		feed->set_index(i + 1);
 		if ((tag == "" || feed->matches_tag(tag)) &&
 			(show_read || feed->unread_item_count() > 0) &&
-			(!filter_active || matcher.matches(feed.get())) &&
-			!feed->hidden()) {
+			!feed->hidden() &&
+			(!filter_active || matches_filter(feed))) {
 			visible_feeds.push_back(FeedPtrPosPair(feed, i));
 		}
 		i++;
 	}
+
+	// Forget the feeds that went away, e.g. replaced by a reload
+	if (filter_matches.size() > feeds.size()) {
+		const std::unordered_set<std::shared_ptr<RssFeed>> current(
+			feeds.begin(), feeds.end());
+		for (auto it = filter_matches.begin(); it != filter_matches.end(); ) {
+			if (current.count(it->first) == 0) {
+				it = filter_matches.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+bool FeedListFormAction::matches_filter(const std::shared_ptr<RssFeed>& feed)
+{
+	// A feed's attributes change along with its revision, except for the
+	// article counts
+	const std::uint64_t revision = feed->revision();
+	const unsigned int unread = feed->unread_item_count();
+	const unsigned int total = feed->total_item_count();
+
+	auto it = filter_matches.find(feed);
+	if (it != filter_matches.end()
+		&& it->second.filter_version == filter_version
+		&& it->second.revision == revision
+		&& it->second.unread == unread
+		&& it->second.total == total) {
+		return it->second.matches;
+	}
+
+	const bool matches = matcher.matches(feed.get());
+	filter_matches[feed] = FilterMatch{filter_version, revision, unread, total,
+			matches};
+	return matches;
 }
 
 void FeedListFormAction::set_feedlist(
@@ -614,24 +693,86 @@ void FeedListFormAction::set_feedlist(
 {
 	assert(cfg != nullptr); // must not happen
 
+	std::lock_guard<std::mutex> guard(redraw_mtx);
+
+	update_visible_feeds(feeds);
+
+	// Forget the lines of feeds that went away, e.g. replaced by a reload
+	std::unordered_set<std::shared_ptr<RssFeed>> visible;
+	for (const auto& feed : visible_feeds) {
+		visible.insert(feed.first);
+	}
+	for (auto it = formatted_feeds.begin(); it != formatted_feeds.end(); ) {
+		if (visible.count(it->first) == 0) {
+			it = formatted_feeds.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	draw_feeds();
+
+	update_form_title(list.get_width());
+}
+
+void FeedListFormAction::draw_feeds()
+{
 	const unsigned int width = list.get_width();
+	const std::string feedlist_format = cfg->get_configvalue("feedlist-format");
+	if (width != formatted_feeds_width
+		|| feedlist_format != formatted_feeds_format.get_format()) {
+		formatted_feeds.clear();
+		formatted_feeds_width = width;
+		formatted_feeds_format.set_format(feedlist_format);
+	}
 
-	std::string feedlist_format = cfg->get_configvalue("feedlist-format");
+	std::uint32_t first = 0;
+	std::uint32_t last = visible_feeds.size();
+	const bool viewport_only =
+		cfg->get_configvalue_as_bool("feedlist-viewport-only");
+	if (viewport_only) {
+		const auto window = list.window_around_cursor(visible_feeds.size(),
+				MIN_SCROLL_MARGIN);
+		first = window.first;
+		last = window.second;
+	}
 
 	ListFormatter listfmt(&rxman, "feedlist");
+	for (std::uint32_t i = first; i < last; ++i) {
+		listfmt.add_line(feed_line(visible_feeds[i], width));
+	}
 
-	update_visible_feeds(feeds);
-
-	for (const auto& feed : visible_feeds) {
-		listfmt.add_line(format_line(feedlist_format,
-				feed.first,
-				feed.second,
-				width));
+	if (viewport_only) {
+		list.stfl_replace_window(listfmt, first, visible_feeds.size());
+	} else {
+		list.stfl_replace_lines(listfmt);
 	}
+}
 
-	list.stfl_replace_lines(listfmt);
+const std::string& FeedListFormAction::feed_line(const FeedPtrPosPair& feed,
+	unsigned int width)
+{
+	const std::uint64_t revision = feed.first->revision();
+	const unsigned int unread = feed.first->unread_item_count();
+	const unsigned int total = feed.first->total_item_count();
+
+	auto it = formatted_feeds.find(feed.first);
+	if (it != formatted_feeds.end()
+		&& it->second.pos == feed.second
+		&& it->second.revision == revision
+		&& it->second.unread == unread
+		&& it->second.total == total) {
+		return it->second.line;
+	}
 
-	update_form_title(width);
+	FormattedFeed& formatted = formatted_feeds[feed.first];
+	formatted.pos = feed.second;
+	formatted.revision = revision;
+	formatted.unread = unread;
+	formatted.total = total;
+	formatted.line = format_line(formatted_feeds_format, feed.first, feed.second,
+			width);
+	return formatted.line;
 }
 
 const std::vector<KeyMapHintEntry>& FeedListFormAction::get_keymap_hint() const
@@ -915,6 +1056,17 @@ void FeedListFormAction::mark_pos_if_visible(unsigned int pos)
 	}
 }
 
+std::vector<std::shared_ptr<RssFeed>> FeedListFormAction::feeds_on_screen()
+{
+	std::lock_guard<std::mutex> guard(redraw_mtx);
+	const auto window = list.window_around_cursor(visible_feeds.size(), 0);
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (auto i = window.first; i < window.second; ++i) {
+		feeds.push_back(visible_feeds[i].first);
+	}
+	return feeds;
+}
+
 void FeedListFormAction::save_filterpos()
 {
 	const unsigned int i = list.get_position();
@@ -985,14 +1137,19 @@ void FeedListFormAction::op_start_search()
 		"`%s'",
 		searchphrase);
 	if (searchphrase.length() > 0) {
-		const auto message_lifetime = v->get_statusline().show_message_until_finished(
-				_("Searching..."));
 		searchhistory.add_line(searchphrase);
 		std::vector<std::shared_ptr<RssItem>> items;
 		try {
 			const auto utf8searchphrase = utils::locale_to_utf8(searchphrase);
-			items = v->get_ctrl()->search_for_items(
-					utf8searchphrase, nullptr);
+			const bool finished = v->run_job(_("Searching..."),
+			[&](JobProgress& progress) {
+				items = v->get_ctrl()->search_for_items(
+						utf8searchphrase, nullptr, &progress);
+			});
+			if (!finished) {
+				v->get_statusline().show_message(_("Search cancelled."));
+				return;
+			}
 		} catch (const DbException& e) {
 			v->get_statusline().show_error(strprintf::fmt(
 					_("Error while searching for `%s': %s"),
@@ -1011,6 +1168,42 @@ void FeedListFormAction::op_start_search()
 	}
 }
 
+void FeedListFormAction::show_live_search_results()
+{
+	if (!v->is_in_qna()) {
+		live_search = false;
+		set_keymap_hints();
+		return;
+	}
+
+	const std::string query = get_value("qna_value");
+	if (query == live_search_query) {
+		return;
+	}
+	live_search_query = query;
+	if (query.empty()) {
+		set_keymap_hints();
+		return;
+	}
+
+	// Only the loaded articles are looked at, and not their contents; the
+	// search that runs when the prompt is answered goes to the cache
+	const auto items = v->get_ctrl()->get_feedcontainer()->search_titles(
+			utils::locale_to_utf8(query));
+	std::string message;
+	if (items.empty()) {
+		message = _("No titles or authors match so far");
+	} else {
+		message = strprintf::fmt(
+				ngettext("%u title or author matches so far: %s",
+					"%u titles or authors match so far, e.g. %s",
+					items.size()),
+				static_cast<unsigned int>(items.size()),
+				utils::utf8_to_locale(items.front()->title()));
+	}
+	set_value("help", utils::quote_for_stfl(message));
+}
+
 void FeedListFormAction::handle_cmdline_num(unsigned int idx)
 {
 	if (idx > 0 &&
@@ -1058,7 +1251,8 @@ std::string FeedListFormAction::get_title(std::shared_ptr<RssFeed> feed)
 	return title;
 }
 
-std::string FeedListFormAction::format_line(const std::string& feedlist_format,
+std::string FeedListFormAction::format_line(
+	const FmtStrTemplate& feedlist_format,
 	std::shared_ptr<RssFeed> feed,
 	unsigned int pos,
 	unsigned int width)
@@ -1118,6 +1312,7 @@ void FeedListFormAction::apply_filter(const std::string& filtertext)
 	} else {
 		save_filterpos();
 		filter_active = true;
+		++filter_version;
 		do_redraw = true;
 	}
 }
@@ -0,0 +1,306 @@
+#include "feedsnapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "logger.h"
+#include "rssfeed.h"
+#include "utils.h"
+
+namespace newsboat {
+
+namespace {
+
+/*
+ * A snapshot is laid out as
+ *
+ *   header | feed records | item records | strings
+ *
+ * with all numbers in the byte order of the machine that wrote it; the
+ * byte order mark makes a snapshot from a different one look broken. A
+ * string is referred to by its offset into the strings and its length, as
+ * two 32-bit numbers. Each feed record refers to a run of item records,
+ * which are in the order Cache::internalize_rssfeed_lazily() reads them.
+ *
+ * header (48 bytes):
+ *   magic (8), version (4), byte order mark (4), number of feeds (4),
+ *   unused (4), number of items (8), size of the strings (8), token (8)
+ * feed record (40 bytes):
+ *   url (8), title (8), link (8), first item (8), number of items (4),
+ *   right-to-left (4)
+ * item record (32 bytes):
+ *   guid (8), flags (8), pubDate (8), unread (4), unused (4)
+ */
+const char MAGIC[8] = {'N', 'B', 'S', 'N', 'A', 'P', 'S', 'H'};
+const std::uint32_t VERSION = 1;
+const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+const std::size_t HEADER_SIZE = 48;
+const std::size_t FEED_RECORD_SIZE = 40;
+const std::size_t ITEM_RECORD_SIZE = 32;
+
+template<typename T>
+void append(std::string& out, T value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+class StringWriter {
+public:
+	/// Appends the reference to \a text to \a out, and \a text to the
+	/// strings.
+	bool add(std::string& out, const std::string& text)
+	{
+		if (strings.size() + text.size() > UINT32_MAX) {
+			return false;
+		}
+		append<std::uint32_t>(out, strings.size());
+		append<std::uint32_t>(out, text.size());
+		strings.append(text);
+		return true;
+	}
+
+	std::string strings;
+};
+
+}
+
+FeedSnapshot::FeedSnapshot(const std::string& path, const std::string& token)
+	: data(nullptr)
+	, size(0)
+	, valid_(false)
+	, feed_count(0)
+	, item_count(0)
+	, items_start(0)
+	, strings_start(0)
+	, strings_size(0)
+{
+	if (token.empty()) {
+		return;
+	}
+
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1) {
+		LOG(Level::DEBUG, "FeedSnapshot: no snapshot at %s", path);
+		return;
+	}
+	struct stat sb;
+	if (::fstat(fd, &sb) == 0 && sb.st_size > 0) {
+		void* mapped = ::mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) {
+			data = static_cast<const char*>(mapped);
+			size = sb.st_size;
+		}
+	}
+	::close(fd);
+
+	valid_ = data != nullptr && check(token);
+	LOG(Level::INFO, "FeedSnapshot: snapshot at %s is %s", path,
+		valid_ ? "valid" : "stale or broken");
+}
+
+FeedSnapshot::~FeedSnapshot()
+{
+	if (data != nullptr) {
+		::munmap(const_cast<char*>(data), size);
+	}
+}
+
+bool FeedSnapshot::check(const std::string& token)
+{
+	if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+		|| read_u32(8) != VERSION || read_u32(12) != BYTE_ORDER_MARK) {
+		return false;
+	}
+
+	feed_count = read_u32(16);
+	item_count = read_u64(24);
+	strings_size = read_u64(32);
+	// Compared one at a time, so that nothing overflows
+	if (feed_count > size / FEED_RECORD_SIZE
+		|| item_count > size / ITEM_RECORD_SIZE
+		|| strings_size > size) {
+		return false;
+	}
+	items_start = HEADER_SIZE + feed_count * FEED_RECORD_SIZE;
+	strings_start = items_start + item_count * ITEM_RECORD_SIZE;
+	if (strings_start + strings_size != size) {
+		return false;
+	}
+
+	std::string snapshot_token;
+	if (!read_string(40, snapshot_token) || snapshot_token != token) {
+		return false;
+	}
+
+	feed_index.reserve(feed_count);
+	for (std::uint32_t i = 0; i < feed_count; ++i) {
+		const std::size_t record = HEADER_SIZE + i * FEED_RECORD_SIZE;
+		std::string url;
+		const std::uint64_t first_item = read_u64(record + 24);
+		const std::uint32_t items = read_u32(record + 32);
+		if (!read_string(record, url) || first_item > item_count
+			|| items > item_count - first_item) {
+			return false;
+		}
+		feed_index.emplace(std::move(url), i);
+	}
+	return true;
+}
+
+std::uint32_t FeedSnapshot::read_u32(std::size_t offset) const
+{
+	std::uint32_t value;
+	std::memcpy(&value, data + offset, sizeof(value));
+	return value;
+}
+
+std::uint64_t FeedSnapshot::read_u64(std::size_t offset) const
+{
+	std::uint64_t value;
+	std::memcpy(&value, data + offset, sizeof(value));
+	return value;
+}
+
+bool FeedSnapshot::read_string(std::size_t offset, std::string& out) const
+{
+	const std::uint32_t start = read_u32(offset);
+	const std::uint32_t length = read_u32(offset + 4);
+	if (start > strings_size || length > strings_size - start) {
+		return false;
+	}
+	out.assign(data + strings_start + start, length);
+	return true;
+}
+
+std::shared_ptr<RssFeed> FeedSnapshot::make_feed(Cache& cache,
+	const std::string& url) const
+{
+	if (!valid_) {
+		return nullptr;
+	}
+	const auto it = feed_index.find(url);
+	if (it == feed_index.end()) {
+		return nullptr;
+	}
+
+	const std::size_t record = HEADER_SIZE + it->second * FEED_RECORD_SIZE;
+	std::string title;
+	std::string link;
+	if (!read_string(record + 8, title) || !read_string(record + 16, link)) {
+		return nullptr;
+	}
+	const std::uint64_t first_item = read_u64(record + 24);
+	const std::uint32_t items = read_u32(record + 32);
+
+	std::vector<ItemSummary> summaries(items);
+	for (std::uint32_t i = 0; i < items; ++i) {
+		const std::size_t item = items_start + (first_item + i) * ITEM_RECORD_SIZE;
+		auto& summary = summaries[i];
+		if (!read_string(item, summary.guid)
+			|| !read_string(item + 8, summary.flags)) {
+			return nullptr;
+		}
+		summary.pubDate = static_cast<time_t>(read_u64(item + 16));
+		summary.unread = read_u32(item + 24) != 0;
+	}
+	cache.trim_item_summaries(summaries);
+
+	auto feed = std::make_shared<RssFeed>(&cache, url);
+	feed->set_title(title);
+	feed->set_link(link);
+	feed->set_rtl(read_u32(record + 36) != 0);
+	feed->set_item_summaries(std::move(summaries));
+	return feed;
+}
+
+bool FeedSnapshot::write(const std::string& path, const std::string& token,
+	const std::vector<std::shared_ptr<RssFeed>>& feeds)
+{
+	StringWriter strings;
+	std::string token_ref;
+	strings.add(token_ref, token);
+
+	std::string feed_records;
+	std::string item_records;
+	std::uint32_t feed_count = 0;
+	std::uint64_t item_count = 0;
+	for (const auto& feed : feeds) {
+		if (utils::is_query_url(feed->rssurl())) {
+			continue;
+		}
+
+		std::vector<ItemSummary> summaries;
+		{
+			const SharedLock lock(feed->item_mutex);
+			summaries = feed->item_summaries();
+		}
+		// Newest first, like the cache hands them out
+		std::stable_sort(summaries.begin(), summaries.end(),
+		[](const ItemSummary& a, const ItemSummary& b) {
+			return a.pubDate > b.pubDate;
+		});
+
+		bool fits = strings.add(feed_records, feed->rssurl())
+			&& strings.add(feed_records, feed->title_raw())
+			&& strings.add(feed_records, feed->link());
+		append<std::uint64_t>(feed_records, item_count);
+		append<std::uint32_t>(feed_records, summaries.size());
+		append<std::uint32_t>(feed_records, feed->is_rtl() ? 1 : 0);
+		for (const auto& summary : summaries) {
+			fits = fits && strings.add(item_records, summary.guid)
+				&& strings.add(item_records, summary.flags);
+			append<std::int64_t>(item_records, summary.pubDate);
+			append<std::uint32_t>(item_records, summary.unread ? 1 : 0);
+			append<std::uint32_t>(item_records, 0);
+		}
+		if (!fits) {
+			LOG(Level::WARN, "FeedSnapshot::write: too much to fit in a snapshot");
+			return false;
+		}
+		++feed_count;
+		item_count += summaries.size();
+	}
+
+	std::string header(MAGIC, sizeof(MAGIC));
+	append<std::uint32_t>(header, VERSION);
+	append<std::uint32_t>(header, BYTE_ORDER_MARK);
+	append<std::uint32_t>(header, feed_count);
+	append<std::uint32_t>(header, 0);
+	append<std::uint64_t>(header, item_count);
+	append<std::uint64_t>(header, strings.strings.size());
+	header.append(token_ref);
+
+	const std::string tmp_path = path + ".tmp";
+	{
+		std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+		out << header << feed_records << item_records << strings.strings;
+		out.close();
+		if (out.fail()) {
+			LOG(Level::ERROR, "FeedSnapshot::write: couldn't write %s", tmp_path);
+			::unlink(tmp_path.c_str());
+			return false;
+		}
+	}
+	if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		LOG(Level::ERROR, "FeedSnapshot::write: couldn't rename %s to %s: %s",
+			tmp_path, path, std::strerror(errno));
+		::unlink(tmp_path.c_str());
+		return false;
+	}
+	LOG(Level::INFO, "FeedSnapshot::write: wrote %u feed(s) and %" PRIu64
+		" item(s) to %s", feed_count, item_count, path);
+	return true;
+}
+
+} // namespace newsboat
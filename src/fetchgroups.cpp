@@ -0,0 +1,132 @@
+#include "fetchgroups.h"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+namespace newsboat {
+
+namespace {
+
+/// Query parameters that tell where a link was clicked, not what it's for
+bool is_tracking_parameter(const std::string& parameter)
+{
+	const std::string name = parameter.substr(0, parameter.find('='));
+	return name.compare(0, 4, "utm_") == 0 || name == "fbclid"
+		|| name == "gclid" || name == "mc_cid" || name == "mc_eid";
+}
+
+bool starts_with_nocase(const std::string& str, const std::string& prefix)
+{
+	if (str.size() < prefix.size()) {
+		return false;
+	}
+	for (std::size_t i = 0; i < prefix.size(); ++i) {
+		if (std::tolower(static_cast<unsigned char>(str[i])) != prefix[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+FetchGroups::FetchGroups(const std::vector<std::string>& locations)
+	: groups(locations.size())
+	, follower(locations.size(), false)
+{
+	std::unordered_map<std::string, std::size_t> leaders;
+	for (std::size_t i = 0; i < locations.size(); ++i) {
+		const std::string key = canonical_url(locations[i]);
+		if (key.empty()) {
+			continue;
+		}
+		const auto leader = leaders.find(key);
+		if (leader == leaders.end()) {
+			leaders.emplace(key, i);
+			continue;
+		}
+
+		std::size_t& first = leader->second;
+		if (starts_with_nocase(locations[i], "https:")
+			&& !starts_with_nocase(locations[first], "https:")) {
+			// The one fetched over HTTPS takes the group over
+			groups[i] = std::move(groups[first]);
+			groups[first].clear();
+			groups[i].push_back(first);
+			follower[first] = true;
+			first = i;
+		} else {
+			groups[first].push_back(i);
+			follower[i] = true;
+		}
+	}
+	for (auto& group : groups) {
+		std::sort(group.begin(), group.end());
+	}
+}
+
+const std::vector<std::size_t>& FetchGroups::followers(std::size_t i) const
+{
+	return groups[i];
+}
+
+bool FetchGroups::is_follower(std::size_t i) const
+{
+	return follower[i];
+}
+
+std::string FetchGroups::canonical_url(const std::string& url)
+{
+	std::size_t start = 0;
+	if (starts_with_nocase(url, "http://")) {
+		start = 7;
+	} else if (starts_with_nocase(url, "https://")) {
+		start = 8;
+	} else {
+		return "";
+	}
+
+	std::string rest = url.substr(start);
+	rest.erase(std::min(rest.find('#'), rest.size()));
+	const auto path_start = std::min(rest.find_first_of("/?"), rest.size());
+	std::string host = rest.substr(0, path_start);
+	std::string path = rest.substr(path_start);
+
+	// The user name and password are left as they are
+	const auto at = host.rfind('@');
+	const auto name_start = at == std::string::npos ? 0 : at + 1;
+	std::transform(host.begin() + name_start, host.end(), host.begin() + name_start,
+		::tolower);
+	for (const std::string port : {
+			":80", ":443"
+		}) {
+		if (host.size() > port.size()
+			&& host.compare(host.size() - port.size(), port.size(), port) == 0) {
+			host.erase(host.size() - port.size());
+			break;
+		}
+	}
+
+	std::string query;
+	const auto query_start = path.find('?');
+	if (query_start != std::string::npos) {
+		std::size_t begin = query_start + 1;
+		while (begin <= path.size()) {
+			const auto end = std::min(path.find('&', begin), path.size());
+			const std::string parameter = path.substr(begin, end - begin);
+			if (!parameter.empty() && !is_tracking_parameter(parameter)) {
+				query += (query.empty() ? "?" : "&") + parameter;
+			}
+			begin = end + 1;
+		}
+		path.erase(query_start);
+	}
+	while (!path.empty() && path.back() == '/') {
+		path.pop_back();
+	}
+
+	return host + path + query;
+}
+
+} // namespace newsboat
@@ -0,0 +1,207 @@
+#include "fetchresults.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+#include "3rd-party/json.hpp"
+#include "file_system.h"
+#include "logger.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+const std::string FILE_SUFFIX = ".jsonl";
+
+/// FNV-1a, so that all workers agree on the shards whatever they're
+/// built with.
+std::uint64_t hash_of(const std::string& data)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const char c : data) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+}
+
+FetchResults::FetchResults(const std::string& dir)
+	: dir(dir)
+{
+}
+
+bool FetchResults::parse_shard(const std::string& spec, unsigned int& index,
+	unsigned int& count)
+{
+	const auto slash = spec.find('/');
+	if (slash == std::string::npos || slash == 0 || slash + 1 == spec.size()
+		|| spec.find_first_not_of("0123456789/") != std::string::npos
+		|| spec.find('/', slash + 1) != std::string::npos) {
+		return false;
+	}
+	const unsigned long parsed_index = std::strtoul(spec.c_str(), nullptr, 10);
+	const unsigned long parsed_count = std::strtoul(spec.c_str() + slash + 1,
+			nullptr, 10);
+	if (parsed_index == 0 || parsed_index > parsed_count) {
+		return false;
+	}
+	index = parsed_index;
+	count = parsed_count;
+	return true;
+}
+
+bool FetchResults::in_shard(const std::string& url, unsigned int index,
+	unsigned int count)
+{
+	return hash_of(url) % count == index - 1;
+}
+
+void FetchResults::add(RssFeed& feed, time_t lastmodified,
+	const std::string& etag)
+{
+	nlohmann::json items = nlohmann::json::array();
+	{
+		const auto lock = feed.lock_items_for_reading();
+		for (const auto& item : feed.items()) {
+			const Description description = item->description();
+			items.push_back({
+				{"guid", item->guid()},
+				{"title", item->title()},
+				{"link", item->link()},
+				{"author", item->author()},
+				{"content", description.text},
+				{"mime", description.mime},
+				{"date", static_cast<std::int64_t>(item->pubDate_timestamp())},
+				{"enclosure_url", item->enclosure_url()},
+				{"enclosure_type", item->enclosure_type()},
+				{"base", item->get_base()},
+			});
+		}
+	}
+	const nlohmann::json entry = {
+		{"url", feed.rssurl()},
+		{"title", feed.title_raw()},
+		{"description", feed.description()},
+		{"link", feed.link()},
+		{"rtl", feed.is_rtl()},
+		{"lastmodified", static_cast<std::int64_t>(lastmodified)},
+		{"etag", etag},
+		{"items", std::move(items)},
+	};
+	const std::string line = entry.dump(-1, ' ', false,
+			nlohmann::json::error_handler_t::replace) + "\n";
+
+	std::lock_guard<std::mutex> guard(mtx);
+	lines += line;
+}
+
+bool FetchResults::write(const std::string& shard)
+{
+	std::string contents;
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		contents.swap(lines);
+	}
+	if (contents.empty()) {
+		return true;
+	}
+
+	// Named so that sorting the names puts them in the order they were
+	// written; the coordinator only sees them once they're complete
+	std::string name = strprintf::fmt("%020" PRId64 "-%s-%d",
+			static_cast<int64_t>(time(nullptr)), shard,
+			static_cast<int>(::getpid()));
+	std::replace(name.begin(), name.end(), '/', '_');
+	const std::string path = dir + "/" + name + FILE_SUFFIX;
+	const std::string tmp = dir + "/." + name + ".tmp";
+	{
+		std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+		file << contents;
+		file.close();
+		if (!file) {
+			LOG(Level::ERROR, "FetchResults::write: couldn't write %s", tmp);
+			std::remove(tmp.c_str());
+			return false;
+		}
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		LOG(Level::ERROR, "FetchResults::write: couldn't create %s: %s", path,
+			std::strerror(errno));
+		std::remove(tmp.c_str());
+		return false;
+	}
+	LOG(Level::INFO, "FetchResults::write: wrote %s", path);
+	return true;
+}
+
+std::vector<std::string> FetchResults::list_files() const
+{
+	std::vector<std::string> files;
+	for (const auto& name : file_system::list_directory(dir, false)) {
+		if (name[0] != '.' && name.size() > FILE_SUFFIX.size()
+			&& name.compare(name.size() - FILE_SUFFIX.size(), FILE_SUFFIX.size(),
+				FILE_SUFFIX) == 0) {
+			files.push_back(dir + "/" + name);
+		}
+	}
+	return files;
+}
+
+std::vector<FetchResults::Result> FetchResults::read(const std::string& path,
+	Cache* cache)
+{
+	std::vector<Result> results;
+	std::ifstream file(path, std::ios::binary);
+	std::string line;
+	while (std::getline(file, line)) {
+		try {
+			const nlohmann::json entry = nlohmann::json::parse(line);
+			Result result;
+			result.feed = std::make_shared<RssFeed>(cache,
+					entry.at("url").get<std::string>());
+			RssFeed& feed = *result.feed;
+			feed.set_title(entry.at("title").get<std::string>());
+			feed.set_description(entry.at("description").get<std::string>());
+			feed.set_link(entry.at("link").get<std::string>());
+			feed.set_rtl(entry.at("rtl").get<bool>());
+			result.lastmodified = entry.at("lastmodified").get<std::int64_t>();
+			result.etag = entry.at("etag").get<std::string>();
+
+			for (const auto& element : entry.at("items")) {
+				auto item = std::make_shared<RssItem>(cache);
+				item->set_guid(element.at("guid").get<std::string>());
+				item->set_title(element.at("title").get<std::string>());
+				item->set_link(element.at("link").get<std::string>());
+				item->set_author(element.at("author").get<std::string>());
+				item->set_description(element.at("content").get<std::string>(),
+					element.at("mime").get<std::string>());
+				item->set_pubDate(element.at("date").get<std::int64_t>());
+				item->set_enclosure_url(element.at("enclosure_url").get<std::string>());
+				item->set_enclosure_type(
+					element.at("enclosure_type").get<std::string>());
+				item->set_base(element.at("base").get<std::string>());
+				item->set_feedurl(feed.rssurl());
+				item->set_feedptr(result.feed);
+				feed.add_item(item);
+			}
+			results.push_back(std::move(result));
+		} catch (const nlohmann::json::exception& e) {
+			LOG(Level::ERROR, "FetchResults::read: skipping a line of %s: %s", path,
+				e.what());
+		}
+	}
+	return results;
+}
+
+} // namespace newsboat
@@ -1,5 +1,8 @@
 #include "file_system.h"
 
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
 #include <grp.h>
 #include <pwd.h>
 #include <sys/types.h>
@@ -121,6 +124,39 @@ std::string permissions_string(mode_t mode)
 	return str;
 }
 
+std::vector<std::string> list_directory(const std::string& path,
+	bool only_directories)
+{
+	std::vector<std::string> names;
+
+	DIR* dirp = ::opendir(path.c_str());
+	if (dirp == nullptr) {
+		return names;
+	}
+	while (const struct dirent* de = ::readdir(dirp)) {
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+			continue;
+		}
+		if (only_directories) {
+			bool is_directory = de->d_type == DT_DIR;
+			if (de->d_type == DT_UNKNOWN) {
+				struct stat sb;
+				const auto entry_path = strprintf::fmt("%s/%s", path, de->d_name);
+				is_directory = ::lstat(entry_path.c_str(), &sb) == 0
+					&& mode_to_filetype(sb.st_mode) == FileType::Directory;
+			}
+			if (!is_directory) {
+				continue;
+			}
+		}
+		names.push_back(de->d_name);
+	}
+	::closedir(dirp);
+
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
 } // namespace file_system
 
 } // namespace newsboat
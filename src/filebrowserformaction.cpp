@@ -24,6 +24,14 @@
 
 namespace newsboat {
 
+namespace {
+
+/// Lines described beyond the screen in each direction, unless the screen is
+/// taller than that.
+const std::uint32_t MIN_SCROLL_MARGIN = 64;
+
+}
+
 FileBrowserFormAction::FileBrowserFormAction(View* vv,
 	std::string formstr,
 	ConfigContainer* cfg)
@@ -61,6 +69,10 @@ bool FileBrowserFormAction::process_operation(Operation op,
 		if (focus.length() > 0) {
 			if (focus == "files") {
 				const auto selected_position = files_list.get_position();
+				if (selected_position >= id_at_position.size()) {
+					break;
+				}
+				describe_file(selected_position);
 				const auto selection = id_at_position[selected_position];
 				switch (selection.filetype) {
 				case file_system::FileType::Directory: {
@@ -223,34 +235,6 @@ void FileBrowserFormAction::update_title(const std::string& working_directory)
 	set_value("head", title);
 }
 
-std::vector<std::string> get_sorted_filelist()
-{
-	std::vector<std::string> ret;
-
-	const std::string cwdtmp = utils::getcwd();
-
-	DIR* dirp = ::opendir(cwdtmp.c_str());
-	if (dirp) {
-		struct dirent* de = ::readdir(dirp);
-		while (de) {
-			if (strcmp(de->d_name, ".") != 0 &&
-				strcmp(de->d_name, "..") != 0) {
-				ret.push_back(de->d_name);
-			}
-			de = ::readdir(dirp);
-		}
-		::closedir(dirp);
-	}
-
-	std::sort(ret.begin(), ret.end());
-
-	if (cwdtmp != "/") {
-		ret.insert(ret.begin(), "..");
-	}
-
-	return ret;
-}
-
 void FileBrowserFormAction::prepare()
 {
 	/*
@@ -262,17 +246,22 @@ void FileBrowserFormAction::prepare()
 		const std::string cwdtmp = utils::getcwd();
 		update_title(cwdtmp);
 
-		std::vector<std::string> files = get_sorted_filelist();
-
-		ListFormatter listfmt;
-
+		// Only the names are read here; the files are lstat()ed once they
+		// come into view
 		id_at_position.clear();
-		for (std::string filename : files) {
-			add_file(listfmt, id_at_position, filename);
+		if (cwdtmp != "/") {
+			id_at_position.push_back({file_system::FileType::Unknown, ".."});
+		}
+		for (auto& filename : file_system::list_directory(cwdtmp, false)) {
+			id_at_position.push_back({file_system::FileType::Unknown, std::move(filename)});
 		}
+		file_lines.assign(id_at_position.size(), std::string());
 
-		files_list.stfl_replace_lines(listfmt);
+		draw_files();
 		do_redraw = false;
+	} else if (!files_list.window_covers_viewport()) {
+		// The cursor has scrolled out of the lines that were handed to STFL
+		draw_files();
 	}
 
 	std::string focus = f.get_focus();
@@ -313,11 +302,26 @@ const std::vector<KeyMapHintEntry>& FileBrowserFormAction::get_keymap_hint() con
 	return hints;
 }
 
-void FileBrowserFormAction::add_file(
-	ListFormatter& listfmt,
-	std::vector<file_system::FileSystemEntry>& id_at_position,
-	std::string filename)
+void FileBrowserFormAction::draw_files()
 {
+	const auto window = files_list.window_around_cursor(id_at_position.size(),
+			MIN_SCROLL_MARGIN);
+	ListFormatter listfmt;
+	for (std::uint32_t i = window.first; i < window.second; ++i) {
+		listfmt.add_line(utils::quote_for_stfl(describe_file(i)));
+	}
+	files_list.stfl_replace_window(listfmt, window.first, id_at_position.size());
+}
+
+const std::string& FileBrowserFormAction::describe_file(std::uint32_t pos)
+{
+	std::string& line = file_lines[pos];
+	if (!line.empty()) {
+		return line;
+	}
+
+	auto& entry = id_at_position[pos];
+	const std::string& filename = entry.name;
 	struct stat sb;
 	if (::lstat(filename.c_str(), &sb) == 0) {
 		const auto ftype = file_system::mode_to_filetype(sb.st_mode);
@@ -333,16 +337,21 @@ void FileBrowserFormAction::add_file(
 				// unspecified size. We'll have to bet it's no larger than 64
 				// bits.
 				static_cast<int64_t>(sb.st_size));
-		std::string line = strprintf::fmt("%c%s %s %s %s %s",
+		line = strprintf::fmt("%c%s %s %s %s %s",
 				file_system::filetype_to_char(ftype),
 				rwxbits,
 				owner,
 				group,
 				sizestr,
 				formattedfilename);
-		listfmt.add_line(utils::quote_for_stfl(line));
-		id_at_position.push_back(file_system::FileSystemEntry{ftype, filename});
+		entry.filetype = ftype;
+	} else {
+		// Gone since the directory was read, most likely
+		line = strprintf::fmt("%c????????? %-8s %-8s %12s %s",
+				file_system::filetype_to_char(file_system::FileType::Unknown),
+				"", "", "", filename);
 	}
+	return line;
 }
 
 std::string FileBrowserFormAction::get_formatted_filename(std::string filename,
@@ -0,0 +1,45 @@
+#include "filestamp.h"
+
+#include <sys/stat.h>
+
+namespace newsboat {
+
+FileStamp FileStamp::of(const std::string& path)
+{
+	FileStamp stamp;
+	struct stat sb;
+	if (::stat(path.c_str(), &sb) != 0) {
+		return stamp;
+	}
+
+	stamp.found = true;
+	stamp.device = sb.st_dev;
+	stamp.inode = sb.st_ino;
+	stamp.bytes = sb.st_size;
+#ifdef __APPLE__
+	stamp.mtime_sec = sb.st_mtimespec.tv_sec;
+	stamp.mtime_nsec = sb.st_mtimespec.tv_nsec;
+	stamp.ctime_sec = sb.st_ctimespec.tv_sec;
+	stamp.ctime_nsec = sb.st_ctimespec.tv_nsec;
+#else
+	stamp.mtime_sec = sb.st_mtim.tv_sec;
+	stamp.mtime_nsec = sb.st_mtim.tv_nsec;
+	stamp.ctime_sec = sb.st_ctim.tv_sec;
+	stamp.ctime_nsec = sb.st_ctim.tv_nsec;
+#endif
+	return stamp;
+}
+
+bool FileStamp::operator==(const FileStamp& other) const
+{
+	return found == other.found
+		&& device == other.device
+		&& inode == other.inode
+		&& bytes == other.bytes
+		&& mtime_sec == other.mtime_sec
+		&& mtime_nsec == other.mtime_nsec
+		&& ctime_sec == other.ctime_sec
+		&& ctime_nsec == other.ctime_nsec;
+}
+
+} // namespace newsboat
@@ -74,7 +74,7 @@ nonstd::optional<std::string> FileUrlReader::write_config()
 				f << " \"" << tag << "\"";
 			}
 		}
-		f << std::endl;
+		f << '\n';
 	}
 
 	return {};
@@ -0,0 +1,179 @@
+#include "filewriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "executor.h"
+#include "logger.h"
+
+using namespace newsboat;
+
+namespace podboat {
+
+const std::size_t FileWriter::BUFFER_SIZE = 1024 * 1024;
+
+FileWriter::FileWriter()
+	: fd(-1)
+	, used(0)
+	, size(0)
+	, writing_used(0)
+	, write_pending(false)
+	, write_error(0)
+{
+}
+
+FileWriter::~FileWriter()
+{
+	if (is_open()) {
+		close(false);
+	}
+}
+
+bool FileWriter::open(const std::string& path, bool append)
+{
+	fd = ::open(path.c_str(),
+			O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC),
+			0644);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat sb;
+	size = (::fstat(fd, &sb) == 0) ? sb.st_size : 0;
+	buffer.resize(BUFFER_SIZE);
+	used = 0;
+	write_error = 0;
+	return true;
+}
+
+void FileWriter::reserve(std::uint64_t bytes)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+	// posix_fallocate() would grow the file, and a resumed download would
+	// then start after the reserved space
+	if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, size, bytes) != 0) {
+		LOG(Level::DEBUG,
+			"FileWriter::reserve: fallocate failed: %s",
+			strerror(errno));
+	}
+#else
+	(void)bytes;
+#endif
+}
+
+bool FileWriter::write(const char* data, std::size_t length)
+{
+	size += length;
+	if (used + length <= buffer.size()) {
+		std::copy(data, data + length, buffer.begin() + used);
+		used += length;
+		if (used < buffer.size()) {
+			return true;
+		}
+		return flush();
+	}
+
+	if (!flush()) {
+		return false;
+	}
+	if (length >= buffer.size()) {
+		return wait_for_write() && write_all(data, length);
+	}
+	std::copy(data, data + length, buffer.begin());
+	used = length;
+	return true;
+}
+
+bool FileWriter::close(bool sync)
+{
+	bool ok = flush();
+	ok = wait_for_write() && ok;
+	if (ok && sync && ::fsync(fd) != 0) {
+		ok = false;
+	}
+	const int saved_errno = errno;
+	if (::close(fd) != 0) {
+		ok = false;
+	} else {
+		errno = saved_errno;
+	}
+	fd = -1;
+	buffer.clear();
+	buffer.shrink_to_fit();
+	writing.clear();
+	writing.shrink_to_fit();
+	return ok;
+}
+
+bool FileWriter::flush()
+{
+	if (used == 0) {
+		return true;
+	}
+	if (!wait_for_write()) {
+		used = 0;
+		return false;
+	}
+
+	std::swap(buffer, writing);
+	writing_used = used;
+	used = 0;
+	buffer.resize(BUFFER_SIZE);
+
+	{
+		std::lock_guard<std::mutex> guard(write_mtx);
+		write_pending = true;
+	}
+	// close() and the destructor wait for this, so the writer outlives it
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::NORMAL,
+	[this]() {
+		const bool ok = write_all(writing.data(), writing_used);
+		const int error = ok ? 0 : errno;
+		std::lock_guard<std::mutex> guard(write_mtx);
+		write_pending = false;
+		if (write_error == 0) {
+			write_error = error;
+		}
+		write_done.notify_all();
+	});
+	return true;
+}
+
+bool FileWriter::wait_for_write()
+{
+	std::unique_lock<std::mutex> guard(write_mtx);
+	write_done.wait(guard, [this]() {
+		return !write_pending;
+	});
+	if (write_error != 0) {
+		errno = write_error;
+		return false;
+	}
+	return true;
+}
+
+bool FileWriter::write_all(const char* data, std::size_t length)
+{
+	while (length > 0) {
+		const ssize_t rc = ::write(fd, data, length);
+		if (rc < 0 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			LOG(Level::ERROR,
+				"FileWriter::write_all: write failed: %s",
+				strerror(errno));
+			return false;
+		}
+		data += rc;
+		length -= rc;
+	}
+	return true;
+}
+
+} // namespace podboat
@@ -2,6 +2,30 @@
 
 namespace newsboat {
 
+FmtStrTemplate::FmtStrTemplate()
+	: FmtStrTemplate("")
+{
+}
+
+FmtStrTemplate::FmtStrTemplate(const std::string& fmt)
+	: format(fmt)
+	, rs_object(fmtstrformatter::bridged::create_template(fmt))
+{
+}
+
+void FmtStrTemplate::set_format(const std::string& fmt)
+{
+	if (fmt != format) {
+		format = fmt;
+		rs_object = fmtstrformatter::bridged::create_template(fmt);
+	}
+}
+
+const std::string& FmtStrTemplate::get_format() const
+{
+	return format;
+}
+
 FmtStrFormatter::FmtStrFormatter()
 	: rs_object(fmtstrformatter::bridged::create())
 {
@@ -19,4 +43,12 @@ std::string FmtStrFormatter::do_format(const std::string& fmt,
 	return std::string(formatted);
 }
 
+std::string FmtStrFormatter::do_format(const FmtStrTemplate& tmpl,
+	unsigned int width) const
+{
+	auto formatted = fmtstrformatter::bridged::do_format_template(*rs_object,
+			*tmpl.rs_object, width);
+	return std::string(formatted);
+}
+
 } // namespace newsboat
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cinttypes>
 #include <exception>
+#include <fstream>
 #include <ncurses.h>
 
 #include "config.h"
@@ -12,7 +13,9 @@
 #include "listwidgetbackend.h"
 #include "logger.h"
 #include "matcherexception.h"
+#include "scopestats.h"
 #include "strprintf.h"
+#include "tracelog.h"
 #include "utils.h"
 #include "view.h"
 
@@ -50,6 +53,7 @@ FormAction::FormAction(View* vv, std::string formstr, ConfigContainer* cfg)
 	valid_cmds.push_back("quit");
 	valid_cmds.push_back("source");
 	valid_cmds.push_back("dumpconfig");
+	valid_cmds.push_back("stats");
 	valid_cmds.push_back("exec");
 }
 
@@ -73,6 +77,7 @@ void FormAction::set_value(const std::string& name, const std::string& value)
 
 void FormAction::draw_form()
 {
+	TraceSpan span("redraw");
 	f.run(-1);
 }
 
@@ -324,6 +329,53 @@ void FormAction::handle_dumpconfig(const std::vector<std::string>& args)
 	}
 }
 
+void FormAction::handle_profile(const std::vector<std::string>& args)
+{
+	if (args.size() != 1) {
+		v->get_statusline().show_error(_("usage: profile <file>"));
+		return;
+	}
+	if (ScopeStats::summaries().empty()) {
+		v->get_statusline().show_error(
+			_("Nothing has been measured; set `profile` to `yes` and restart"));
+		return;
+	}
+
+	const std::string filename = utils::resolve_tilde(args[0]);
+	std::ofstream f(filename);
+	f << ScopeStats::report();
+	if (!f) {
+		v->get_statusline().show_error(strprintf::fmt(
+				_("Error: couldn't write profile to %s"), args[0]));
+		return;
+	}
+	v->get_statusline().show_message(strprintf::fmt(
+			_("Saved profile to %s"), args[0]));
+}
+
+void FormAction::handle_stats(const std::vector<std::string>& args)
+{
+	if (args.size() > 1) {
+		v->get_statusline().show_error(_("usage: stats [<file>]"));
+		return;
+	}
+	if (args.empty()) {
+		v->push_stats();
+		return;
+	}
+
+	const std::string filename = utils::resolve_tilde(args[0]);
+	std::ofstream f(filename);
+	f << v->get_ctrl()->runtime_stats().dump(2) << '\n';
+	if (!f) {
+		v->get_statusline().show_error(strprintf::fmt(
+				_("Error: couldn't write statistics to %s"), args[0]));
+		return;
+	}
+	v->get_statusline().show_message(strprintf::fmt(
+			_("Saved statistics to %s"), args[0]));
+}
+
 void FormAction::handle_exec(const std::vector<std::string>& args)
 {
 	if (args.size() != 1) {
@@ -353,6 +405,12 @@ void FormAction::handle_parsed_command(const Command& command)
 	case CommandType::DUMPCONFIG:
 		handle_dumpconfig(command.args);
 		break;
+	case CommandType::PROFILE:
+		handle_profile(command.args);
+		break;
+	case CommandType::STATS:
+		handle_stats(command.args);
+		break;
 	case CommandType::EXEC:
 		handle_exec(command.args);
 		break;
@@ -561,6 +619,10 @@ Command FormAction::parse_command(const std::string& input,
 			return Command { .type = CommandType::SOURCE, .args = std::move(tokens) };
 		} else if (cmd_name == "dumpconfig") {
 			return Command { .type = CommandType::DUMPCONFIG, .args = std::move(tokens) };
+		} else if (cmd_name == "profile") {
+			return Command { .type = CommandType::PROFILE, .args = std::move(tokens) };
+		} else if (cmd_name == "stats") {
+			return Command { .type = CommandType::STATS, .args = std::move(tokens) };
 		} else if (cmd_name == "exec") {
 			return Command { .type = CommandType::EXEC, .args = std::move(tokens) };
 		} else if (cmd_name == "tag") {
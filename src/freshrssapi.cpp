@@ -1,13 +1,18 @@
 #include "freshrssapi.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
 #include <cstring>
 #include <curl/curl.h>
 #include <json.h>
 #include <time.h>
+#include <unordered_set>
 #include <vector>
 
 #include "config.h"
 #include "curlhandle.h"
+#include "jsonstream.h"
 #include "strprintf.h"
 #include "utils.h"
 #include "rss/feed.h"
@@ -24,11 +29,30 @@
 #define FRESHRSS_API_MARK_ALL_READ_URL FRESHRSS_API_PREFIX "mark-all-as-read"
 #define FRESHRSS_API_EDIT_TAG_URL FRESHRSS_API_PREFIX "edit-tag"
 #define FRESHRSS_API_TOKEN_URL FRESHRSS_API_PREFIX "token"
+#define FRESHRSS_READING_LIST \
+	FRESHRSS_FEED_PREFIX "user/-/state/com.google/reading-list"
+#define FRESHRSS_UNREAD_IDS \
+	FRESHRSS_API_PREFIX "stream/items/ids" \
+	"?s=user/-/state/com.google/reading-list" \
+	"&xt=user/-/state/com.google/read&output=json"
+
+// How many articles a single edit-tag request marks read
+#define FRESHRSS_MARK_READ_BATCH_SIZE 250
+// How many articles a page of the reading list holds, and how many pages
+// a reload pulls at most before it gives up and fetches the feeds one by one
+#define FRESHRSS_SYNC_PAGE_SIZE 1000
+#define FRESHRSS_SYNC_MAX_PAGES 50
+// How many ids a page of the unread articles holds, and how many pages
+// fetch_unread_guids() reads at most
+#define FRESHRSS_UNREAD_PAGE_SIZE 10000
+#define FRESHRSS_UNREAD_MAX_PAGES 20
 
 namespace newsboat {
 
 FreshRssApi::FreshRssApi(ConfigContainer* c)
 	: RemoteApi(c)
+	, synced(false)
+	, newest_crawl_time(0)
 {
 	token_expired = true;
 }
@@ -50,7 +74,8 @@ static size_t my_write_data(void* buffer, size_t size, size_t nmemb,
 
 std::string FreshRssApi::retrieve_auth()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	Credentials cred = get_credentials("freshrss", "FreshRSS");
 	if (cred.user.empty() || cred.pass.empty()) {
 		return "";
@@ -95,7 +120,8 @@ std::vector<TaggedFeedUrl> FreshRssApi::get_subscribed_urls()
 {
 	std::vector<TaggedFeedUrl> urls;
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	curl_slist* custom_headers{};
 	add_custom_headers(&custom_headers);
@@ -124,6 +150,9 @@ std::vector<TaggedFeedUrl> FreshRssApi::get_subscribed_urls()
 		return urls;
 	}
 
+	std::lock_guard<std::mutex> guard(sync_mtx);
+	subscribed_streams.clear();
+
 	json_object* subscription_obj{};
 	json_object_object_get_ex(reply, "subscriptions", &subscription_obj);
 	array_list* subscriptions = json_object_get_array(subscription_obj);
@@ -142,6 +171,7 @@ std::vector<TaggedFeedUrl> FreshRssApi::get_subscribed_urls()
 			LOG(Level::WARN, "Skipping a subscription without an id");
 			continue;
 		}
+		subscribed_streams.insert(id);
 
 		json_object* title_str{};
 		json_object_object_get_ex(sub, "title", &title_str);
@@ -197,21 +227,34 @@ void FreshRssApi::add_custom_headers(curl_slist** custom_headers)
 		curl_slist_append(*custom_headers, auth_header.c_str());
 }
 
-bool FreshRssApi::mark_all_read(const std::string& feedurl)
+std::string FreshRssApi::stream_id_of(const std::string& feedurl)
 {
-	std::string prefix =
+	const std::string prefix =
 		cfg->get_configvalue("freshrss-url") + FRESHRSS_FEED_PREFIX;
-	std::string real_feedurl = feedurl.substr(
-			prefix.length(), feedurl.length() - prefix.length());
-	std::vector<std::string> elems = utils::tokenize(real_feedurl, "?");
+	if (feedurl.compare(0, prefix.length(), prefix) != 0) {
+		return "";
+	}
+	const std::vector<std::string> elems = utils::tokenize(
+			feedurl.substr(prefix.length()), "?");
+	if (elems.empty()) {
+		return "";
+	}
 	try {
-		real_feedurl = utils::unescape_url(elems[0]);
+		return utils::unescape_url(elems[0]);
 	} catch (const std::runtime_error& e) {
 		LOG(Level::DEBUG,
-			"FreshRssApi::mark_all_read: Failed to "
+			"FreshRssApi::stream_id_of: Failed to "
 			"unescape_url(%s): %s",
 			elems[0],
 			e.what());
+		return "";
+	}
+}
+
+bool FreshRssApi::mark_all_read(const std::string& feedurl)
+{
+	const std::string real_feedurl = stream_id_of(feedurl);
+	if (real_feedurl.empty()) {
 		return false;
 	}
 
@@ -233,6 +276,32 @@ bool FreshRssApi::mark_article_read(const std::string& guid, bool read)
 	return mark_article_read_with_token(guid, read, token);
 }
 
+bool FreshRssApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	refresh_token();
+	return mark_in_batches(guids, FRESHRSS_MARK_READ_BATCH_SIZE,
+	[&](const std::vector<std::string>& batch) {
+		std::string postcontent;
+		for (const auto& guid : batch) {
+			postcontent += "i=" + guid + "&";
+		}
+		postcontent += strprintf::fmt(
+				"a=user/-/state/com.google/read&r=user/-/state/"
+				"com.google/kept-unread&ac=edit&T=%s",
+				token);
+
+		const std::string result = post_content(cfg->get_configvalue("freshrss-url") + FRESHRSS_API_EDIT_TAG_URL, postcontent);
+
+		LOG(Level::DEBUG,
+			"FreshRssApi::mark_articles_read: %" PRIu64 " articles, "
+			"result = %s",
+			static_cast<uint64_t>(batch.size()),
+			result);
+
+		return result == "OK";
+	});
+}
+
 bool FreshRssApi::mark_article_read_with_token(const std::string& guid,
 	bool read,
 	const std::string& token)
@@ -270,7 +339,8 @@ bool FreshRssApi::mark_article_read_with_token(const std::string& guid,
 
 std::string FreshRssApi::get_new_token()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	curl_slist* custom_headers{};
 
@@ -381,7 +451,8 @@ std::string FreshRssApi::post_content(const std::string& url,
 	std::string result;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	utils::set_common_curl_options(handle, cfg);
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
@@ -403,150 +474,380 @@ std::string FreshRssApi::post_content(const std::string& url,
 
 rsspp::Feed FreshRssApi::fetch_feed(const std::string& id)
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	return fetch_feed(id, handle);
 }
 
+/// Moves the string out of \a value, which must be one.
+static std::string take_string(nlohmann::json& value)
+{
+	return std::move(value.get_ref<std::string&>());
+}
+
+/// Builds an article from \a entry, moving its strings out of it.
+static rsspp::Item parse_item(nlohmann::json& entry)
+{
+	rsspp::Item item;
+
+	// Title
+	if (entry.contains("title") && !entry["title"].is_null()) {
+		item.title = take_string(entry["title"]);
+	}
+
+	// Link
+	if (entry.contains("canonical") && !entry["canonical"].is_null()) {
+		for (auto& a : entry["canonical"]) {
+			if (a.contains("href") && !a["href"].is_null()) {
+				item.link = take_string(a["href"]);
+				break;
+			}
+		}
+	}
+
+	// Author
+	if (entry.contains("author") && !entry["author"].is_null()) {
+		item.author = take_string(entry["author"]);
+	}
+
+	// Content
+	if (entry.contains("summary") && !entry["summary"].is_null()) {
+		for (auto a : entry["summary"].items()) {
+			if (!a.value().is_null()) {
+				item.content_encoded = take_string(a.value());
+				break;
+			}
+		}
+	}
+
+	// Guid
+	if (entry.contains("id") && !entry["id"].is_null()) {
+		item.guid = take_string(entry["id"]);
+	}
+
+	// Publish date
+	if (entry.contains("published") && !entry["published"].is_null()) {
+		int pub_time = entry["published"];
+		time_t updated = static_cast<time_t>(pub_time);
+
+		item.pubDate = utils::mt_strf_localtime(
+				"%a, %d %b %Y %H:%M:%S %z",
+				updated);
+		item.pubDate_ts = pub_time;
+	}
+
+	// Podcast enclosure
+	if (entry.contains("enclosure") && !entry["enclosure"].is_null()) {
+		for (auto& a : entry["enclosure"]) {
+			if (a.contains("href") && a.contains("type")
+				&& !a["href"].is_null() && !a["type"].is_null()) {
+				item.enclosures.push_back(
+				rsspp::Enclosure {
+					take_string(a["href"]),
+					take_string(a["type"]),
+				}
+				);
+				break;
+			}
+		}
+	}
+
+	// Read/unread status
+	bool unread = true;
+	if (entry.contains("categories")
+		&& !entry["categories"].is_null()) {
+		for (const auto& a: entry["categories"]) {
+			if (a == "user/-/state/com.google/read") {
+				unread = false;
+			}
+		}
+	}
+	if (unread) {
+		item.labels.push_back("unread");
+	} else {
+		item.labels.push_back("read");
+	}
+
+	return item;
+}
+
+/// When the server crawled \a entry, or 0 if it doesn't say.
+static time_t crawl_time_of(const nlohmann::json& entry)
+{
+	if (!entry.contains("crawlTimeMsec")) {
+		return 0;
+	}
+	const auto& msec = entry["crawlTimeMsec"];
+	if (msec.is_string()) {
+		const std::string digits = msec;
+		return static_cast<time_t>(std::strtoll(digits.c_str(), nullptr, 10) / 1000);
+	}
+	if (msec.is_number()) {
+		return static_cast<time_t>(msec.get<int64_t>() / 1000);
+	}
+	return 0;
+}
+
 rsspp::Feed FreshRssApi::fetch_feed(const std::string& id, CurlHandle& cached_handle)
 {
 	rsspp::Feed feed;
 	feed.rss_version = rsspp::Feed::FRESHRSS_JSON;
 
+	bool from_sync = false;
+	const std::string stream = stream_id_of(id);
+	{
+		std::lock_guard<std::mutex> guard(sync_mtx);
+		const auto synced_stream = synced_items.find(stream);
+		if (synced_stream != synced_items.end()) {
+			feed.items = std::move(synced_stream->second);
+			synced_items.erase(synced_stream);
+		}
+		// The reading list only has the articles of actual feeds, not
+		// those of e.g. the starred items
+		from_sync = synced && subscribed_streams.count(stream) > 0;
+	}
+	if (from_sync) {
+		LOG(Level::DEBUG,
+			"FreshRssApi::fetch_feed: %" PRIu64 " items from the reading list",
+			static_cast<uint64_t>(feed.items.size()));
+		return feed;
+	}
+
 	const std::string query = strprintf::fmt("%s?n=%u",
 			id,
 			cfg->get_configvalue_as_int("freshrss-min-items"));
 
+	// Articles left over from the reading list may be fetched again here
+	std::unordered_set<std::string> guids;
+	for (const auto& item : feed.items) {
+		guids.insert(item.guid);
+	}
+	time_t newest = 0;
+	uint64_t count = 0;
+	try {
+		fetch_items(query, cached_handle, [&](nlohmann::json& entry) {
+			newest = std::max(newest, crawl_time_of(entry));
+			++count;
+			rsspp::Item item = parse_item(entry);
+			if (guids.count(item.guid) == 0) {
+				feed.items.push_back(std::move(item));
+			}
+		});
+	} catch (nlohmann::json::exception& e) {
+		LOG(Level::ERROR, "Exception occurred while parsing feed: ", e.what());
+	}
+	LOG(Level::DEBUG,
+		"FreshRssApi::fetch_feed: %" PRIu64 " items",
+		count);
+
+	std::lock_guard<std::mutex> guard(sync_mtx);
+	newest_crawl_time = std::max(newest_crawl_time, newest);
+	return feed;
+}
+
+bool FreshRssApi::fetch_items(const std::string& url, CurlHandle& handle,
+	const std::function<void(nlohmann::json& entry)>& on_entry,
+	std::string* continuation, const std::string& list)
+{
 	std::string result;
 	curl_slist* custom_headers{};
 	add_custom_headers(&custom_headers);
-	curl_easy_setopt(cached_handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
+	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
 
-	utils::set_common_curl_options(cached_handle, cfg);
-	curl_easy_setopt(cached_handle.ptr(), CURLOPT_WRITEFUNCTION, my_write_data);
-	curl_easy_setopt(cached_handle.ptr(), CURLOPT_WRITEDATA, &result);
-	curl_easy_setopt(cached_handle.ptr(),
+	utils::set_common_curl_options(handle, cfg);
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEFUNCTION, my_write_data);
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, &result);
+	curl_easy_setopt(handle.ptr(),
 		CURLOPT_URL,
-		query.c_str());
-	curl_easy_perform(cached_handle.ptr());
+		url.c_str());
+	curl_easy_perform(handle.ptr());
 
 	curl_slist_free_all(custom_headers);
 
 	if (result.empty()) {
 		LOG(Level::ERROR,
-			"FreshRssApi::fetch_feed: Empty response: %s",
+			"FreshRssApi::fetch_items: Empty response: %s",
 			result);
-		return feed;
+		return false;
 	}
 	nlohmann::json content;
-	try {
-		content = nlohmann::json::parse(result);
-	} catch (nlohmann::json::parse_error& e) {
+	if (!stream_json_array(result, list, on_entry, content)) {
 		LOG(Level::ERROR,
-			"FreshRssApi::fetch_feed: reply failed to parse: %s",
+			"FreshRssApi::fetch_items: reply failed to parse: %s",
 			result);
-		return feed;
+		return false;
 	}
 
-
-	const nlohmann::json entries = content["items"];
-	if (!entries.is_array()) {
+	if (!content.is_object() || content.contains(list)) {
 		LOG(Level::ERROR,
-			"FreshRssApi::fetch_feed: items is not an array");
-		return feed;
+			"FreshRssApi::fetch_items: %s is not an array",
+			list);
+		return false;
 	}
 
-	LOG(Level::DEBUG,
-		"FreshRssApi::fetch_feed: %" PRIu64 " items",
-		static_cast<uint64_t>(entries.size()));
-	try {
-		for (const auto& entry : entries) {
-			rsspp::Item item;
-
-			// Title
-			if (entry.contains("title") && !entry["title"].is_null()) {
-				item.title = entry["title"];
-			}
+	if (continuation != nullptr) {
+		continuation->clear();
+		if (content.contains("continuation")
+			&& content["continuation"].is_string()) {
+			*continuation = content["continuation"];
+		}
+	}
+	return true;
+}
 
-			// Link
-			if (entry.contains("canonical") && !entry["canonical"].is_null()) {
-				for (const auto& a : entry["canonical"]) {
-					if (a.contains("href") && !a["href"].is_null()) {
-						item.link = a["href"];
-						break;
-					}
-				}
-			}
+bool FreshRssApi::sync_reading_list(time_t since)
+{
+	std::unordered_map<std::string, std::vector<rsspp::Item>> items;
+	time_t newest = since;
+	std::uint64_t count = 0;
+
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+	std::string continuation;
+	for (unsigned int page = 0; page == 0 || !continuation.empty(); ++page) {
+		if (page == FRESHRSS_SYNC_MAX_PAGES) {
+			LOG(Level::WARN,
+				"FreshRssApi::sync_reading_list: more than %u pages came in "
+				"since the last reload, fetching the feeds one by one",
+				FRESHRSS_SYNC_MAX_PAGES);
+			return false;
+		}
 
-			// Author
-			if (entry.contains("author") && !entry["author"].is_null()) {
-				item.author = entry["author"];
-			}
+		std::string url = strprintf::fmt("%s%s?n=%u&ot=%" PRId64,
+				cfg->get_configvalue("freshrss-url"),
+				FRESHRSS_READING_LIST,
+				FRESHRSS_SYNC_PAGE_SIZE,
+				static_cast<int64_t>(since));
+		if (!continuation.empty()) {
+			char* escaped = curl_easy_escape(handle.ptr(),
+					continuation.c_str(), 0);
+			url += strprintf::fmt("&c=%s", escaped);
+			curl_free(escaped);
+		}
 
-			// Content
-			if (entry.contains("summary") && !entry["summary"].is_null()) {
-				for (const auto& a : entry["summary"].items()) {
-					if (!a.value().is_null()) {
-						item.content_encoded = a.value();
-						break;
-					}
+		try {
+			const bool fetched = fetch_items(url, handle,
+			[&](nlohmann::json& entry) {
+				if (!entry.contains("origin") || !entry["origin"].contains("streamId")
+					|| !entry["origin"]["streamId"].is_string()) {
+					return;
 				}
+				const std::string stream = entry["origin"]["streamId"];
+				newest = std::max(newest, crawl_time_of(entry));
+				items[stream].push_back(parse_item(entry));
+				++count;
+			}, &continuation);
+			if (!fetched) {
+				return false;
 			}
+		} catch (nlohmann::json::exception& e) {
+			LOG(Level::ERROR,
+				"FreshRssApi::sync_reading_list: Exception occurred while "
+				"parsing the reading list: %s",
+				e.what());
+			return false;
+		}
+	}
 
-			// Guid
-			if (entry.contains("id") && !entry["id"].is_null()) {
-				item.guid = entry["id"];
-			}
+	LOG(Level::DEBUG,
+		"FreshRssApi::sync_reading_list: %" PRIu64 " items since %" PRId64,
+		count,
+		static_cast<int64_t>(since));
+
+	std::lock_guard<std::mutex> guard(sync_mtx);
+	for (auto& stream : items) {
+		// Reloads that only look at some of the feeds leave the articles of
+		// the others for later; those of feeds that are gone are dropped
+		if (subscribed_streams.count(stream.first) == 0) {
+			continue;
+		}
+		auto& kept = synced_items[stream.first];
+		kept.insert(kept.end(),
+			std::make_move_iterator(stream.second.begin()),
+			std::make_move_iterator(stream.second.end()));
+	}
+	newest_crawl_time = std::max(newest_crawl_time, newest);
+	synced = true;
+	return true;
+}
 
-			// Publish date
-			if (entry.contains("published") && !entry["published"].is_null()) {
-				int pub_time = entry["published"];
-				time_t updated = static_cast<time_t>(pub_time);
+bool FreshRssApi::fetch_unread_guids(std::vector<std::string>& guids)
+{
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+	std::string continuation;
+	for (unsigned int page = 0; page == 0 || !continuation.empty(); ++page) {
+		if (page == FRESHRSS_UNREAD_MAX_PAGES) {
+			LOG(Level::WARN,
+				"FreshRssApi::fetch_unread_guids: more than %u pages of "
+				"unread articles, giving up",
+				FRESHRSS_UNREAD_MAX_PAGES);
+			return false;
+		}
 
-				item.pubDate = utils::mt_strf_localtime(
-						"%a, %d %b %Y %H:%M:%S %z",
-						updated);
-				item.pubDate_ts = pub_time;
-			}
+		std::string url = strprintf::fmt("%s%s&n=%u",
+				cfg->get_configvalue("freshrss-url"),
+				FRESHRSS_UNREAD_IDS,
+				FRESHRSS_UNREAD_PAGE_SIZE);
+		if (!continuation.empty()) {
+			char* escaped = curl_easy_escape(handle.ptr(),
+					continuation.c_str(), 0);
+			url += strprintf::fmt("&c=%s", escaped);
+			curl_free(escaped);
+		}
 
-			// Podcast enclosure
-			if (entry.contains("enclosure") && !entry["enclosure"].is_null()) {
-				for (const auto& a : entry["enclosure"]) {
-					if (a.contains("href") && a.contains("type")
-						&& !a["href"].is_null() && !a["type"].is_null()) {
-						item.enclosures.push_back(
-						rsspp::Enclosure {
-							a["href"],
-							a["type"],
-						}
-						);
-						break;
-					}
-				}
+		// The ids are listed as decimal numbers, while the articles carry
+		// them in the long form, in hexadecimal
+		try {
+			const bool fetched = fetch_items(url, handle,
+			[&](nlohmann::json& ref) {
+				const std::string id = ref["id"];
+				const auto number = std::strtoull(id.c_str(), nullptr, 10);
+				guids.push_back(strprintf::fmt(
+						"tag:google.com,2005:reader/item/%016" PRIx64,
+						static_cast<uint64_t>(number)));
+			}, &continuation, "itemRefs");
+			if (!fetched) {
+				return false;
 			}
+		} catch (nlohmann::json::exception& e) {
+			LOG(Level::ERROR,
+				"FreshRssApi::fetch_unread_guids: Exception occurred while "
+				"parsing the ids: %s",
+				e.what());
+			return false;
+		}
+	}
 
-			// Read/unread status
-			bool unread = true;
-			if (entry.contains("categories")
-				&& !entry["categories"].is_null()) {
-				for (const auto& a: entry["categories"]) {
-					if (a == "user/-/state/com.google/read") {
-						unread = false;
-					}
-				}
-			}
-			if (unread) {
-				item.labels.push_back("unread");
-			} else {
-				item.labels.push_back("read");
-			}
+	LOG(Level::DEBUG,
+		"FreshRssApi::fetch_unread_guids: %" PRIu64 " unread articles",
+		static_cast<uint64_t>(guids.size()));
+	return true;
+}
 
-			feed.items.push_back(item);
-		}
-	} catch (nlohmann::json::exception& e) {
-		LOG(Level::ERROR, "Exception occurred while parsing feed: ", e.what());
+void FreshRssApi::begin_reload()
+{
+	if (!cfg->get_configvalue_as_bool("freshrss-single-stream")) {
+		return;
 	}
 
-	return feed;
+	time_t since = 0;
+	{
+		std::lock_guard<std::mutex> guard(sync_mtx);
+		since = newest_crawl_time;
+	}
+	// The first reload fetches each feed, to get freshrss-min-items of
+	// each of them and to learn where the reading list should start
+	if (since != 0) {
+		sync_reading_list(since);
+	}
 }
 
+void FreshRssApi::end_reload()
+{
+	std::lock_guard<std::mutex> guard(sync_mtx);
+	synced = false;
+}
+
+
 } // namespace newsboat
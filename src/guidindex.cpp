@@ -0,0 +1,104 @@
+#include "guidindex.h"
+
+#include <functional>
+
+#include "rssitem.h"
+
+namespace newsboat {
+
+const std::size_t GuidIndex::npos;
+const std::uint32_t GuidIndex::EMPTY;
+
+std::uint64_t GuidIndex::hash_of(const std::string& guid)
+{
+	return std::hash<std::string>()(guid);
+}
+
+void GuidIndex::add(const Items& items, std::size_t pos)
+{
+	if (stale) {
+		// Everything gets indexed by the next find()
+		return;
+	}
+	insert(items, hash_of(items[pos]->guid()), pos);
+}
+
+void GuidIndex::invalidate()
+{
+	stale = true;
+}
+
+std::size_t GuidIndex::find(const Items& items, const std::string& guid)
+{
+	if (stale) {
+		rebuild(items);
+	}
+	if (slots.empty()) {
+		return npos;
+	}
+
+	const std::uint64_t hash = hash_of(guid);
+	const std::size_t mask = slots.size() - 1;
+	for (std::size_t i = hash & mask; slots[i].pos != EMPTY; i = (i + 1) & mask) {
+		const Slot& slot = slots[i];
+		if (slot.hash == hash && slot.pos < items.size()
+			&& items[slot.pos]->guid() == guid) {
+			return slot.pos;
+		}
+	}
+	return npos;
+}
+
+void GuidIndex::rebuild(const Items& items)
+{
+	slots.clear();
+	used = 0;
+	stale = false;
+	for (std::size_t pos = 0; pos < items.size(); ++pos) {
+		insert(items, hash_of(items[pos]->guid()), pos);
+	}
+}
+
+void GuidIndex::insert(const Items& items, std::uint64_t hash,
+	std::uint32_t pos)
+{
+	// At most half full, so that the runs stay short
+	if ((used + 1) * 2 > slots.size()) {
+		grow();
+	}
+
+	const std::string& guid = items[pos]->guid();
+	const std::size_t mask = slots.size() - 1;
+	std::size_t i = hash & mask;
+	for (; slots[i].pos != EMPTY; i = (i + 1) & mask) {
+		if (slots[i].hash == hash && items[slots[i].pos]->guid() == guid) {
+			slots[i].pos = pos;
+			return;
+		}
+	}
+	slots[i] = Slot{hash, pos};
+	++used;
+}
+
+void GuidIndex::grow()
+{
+	std::vector<Slot> old(slots.empty() ? 16 : slots.size() * 2,
+		Slot{0, EMPTY});
+	old.swap(slots);
+
+	// The guids in the old slots are distinct, so they're placed without
+	// comparing them
+	const std::size_t mask = slots.size() - 1;
+	for (const Slot& slot : old) {
+		if (slot.pos == EMPTY) {
+			continue;
+		}
+		std::size_t i = slot.hash & mask;
+		while (slots[i].pos != EMPTY) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = slot;
+	}
+}
+
+} // namespace newsboat
@@ -11,54 +11,80 @@
 
 #include "config.h"
 #include "logger.h"
+#include "perfecthash.h"
 #include "strprintf.h"
 #include "tagsouppullparser.h"
 #include "utils.h"
 
 namespace newsboat {
 
-HtmlRenderer::HtmlRenderer(bool raw)
+namespace {
+
+constexpr struct {
+	const char* name;
+	HtmlTag tag;
+} tag_table[] = {
+	{"a", HtmlTag::A},
+	{"embed", HtmlTag::EMBED},
+	{"iframe", HtmlTag::IFRAME},
+	{"br", HtmlTag::BR},
+	{"pre", HtmlTag::PRE},
+	{"ituneshack", HtmlTag::ITUNESHACK},
+	{"img", HtmlTag::IMG},
+	{"blockquote", HtmlTag::BLOCKQUOTE},
+	{"aside", HtmlTag::BLOCKQUOTE},
+	{"p", HtmlTag::P},
+	{"div", HtmlTag::DIV},
+	{"h1", HtmlTag::H1},
+	{"h2", HtmlTag::H2},
+	{"h3", HtmlTag::H3},
+	{"h4", HtmlTag::H4},
+	{"h5", HtmlTag::H5},
+	{"h6", HtmlTag::H6},
+	{"ol", HtmlTag::OL},
+	{"ul", HtmlTag::UL},
+	{"li", HtmlTag::LI},
+	{"dt", HtmlTag::DT},
+	{"dd", HtmlTag::DD},
+	{"dl", HtmlTag::DL},
+	{"sup", HtmlTag::SUP},
+	{"sub", HtmlTag::SUB},
+	{"hr", HtmlTag::HR},
+	{"b", HtmlTag::STRONG},
+	{"strong", HtmlTag::STRONG},
+	{"u", HtmlTag::UNDERLINE},
+	{"q", HtmlTag::QUOTATION},
+	{"script", HtmlTag::SCRIPT},
+	{"style", HtmlTag::STYLE},
+	{"table", HtmlTag::TABLE},
+	{"th", HtmlTag::TH},
+	{"tr", HtmlTag::TR},
+	{"td", HtmlTag::TD},
+	{"video", HtmlTag::VIDEO},
+	{"audio", HtmlTag::AUDIO},
+	{"source", HtmlTag::SOURCE},
+};
+
+struct TagNames {
+	static constexpr std::size_t count = sizeof(tag_table) / sizeof(tag_table[0]);
+	static constexpr std::size_t slots = 64;
+	static constexpr std::uint32_t seed = 2172366907u;
+	static constexpr bool fold_case = true;
+	static constexpr const char* at(std::size_t i)
+	{
+		return tag_table[i].name;
+	}
+};
+static_assert(perfect_hash::is_perfect<TagNames>(),
+	"two tag names share a slot, pick another TagNames::seed");
+
+}
+
+HtmlRenderer::HtmlRenderer(bool raw, std::size_t max_table_cell_width)
 	: raw_(raw)
+	, max_table_cell_width(max_table_cell_width)
+	, indexed_links(0)
 {
-	tags["a"] = HtmlTag::A;
-	tags["embed"] = HtmlTag::EMBED;
-	tags["iframe"] = HtmlTag::IFRAME;
-	tags["br"] = HtmlTag::BR;
-	tags["pre"] = HtmlTag::PRE;
-	tags["ituneshack"] = HtmlTag::ITUNESHACK;
-	tags["img"] = HtmlTag::IMG;
-	tags["blockquote"] = HtmlTag::BLOCKQUOTE;
-	tags["aside"] = HtmlTag::BLOCKQUOTE;
-	tags["p"] = HtmlTag::P;
-	tags["div"] = HtmlTag::DIV;
-	tags["h1"] = HtmlTag::H1;
-	tags["h2"] = HtmlTag::H2;
-	tags["h3"] = HtmlTag::H3;
-	tags["h4"] = HtmlTag::H4;
-	tags["h5"] = HtmlTag::H5;
-	tags["h6"] = HtmlTag::H6;
-	tags["ol"] = HtmlTag::OL;
-	tags["ul"] = HtmlTag::UL;
-	tags["li"] = HtmlTag::LI;
-	tags["dt"] = HtmlTag::DT;
-	tags["dd"] = HtmlTag::DD;
-	tags["dl"] = HtmlTag::DL;
-	tags["sup"] = HtmlTag::SUP;
-	tags["sub"] = HtmlTag::SUB;
-	tags["hr"] = HtmlTag::HR;
-	tags["b"] = HtmlTag::STRONG;
-	tags["strong"] = HtmlTag::STRONG;
-	tags["u"] = HtmlTag::UNDERLINE;
-	tags["q"] = HtmlTag::QUOTATION;
-	tags["script"] = HtmlTag::SCRIPT;
-	tags["style"] = HtmlTag::STYLE;
-	tags["table"] = HtmlTag::TABLE;
-	tags["th"] = HtmlTag::TH;
-	tags["tr"] = HtmlTag::TR;
-	tags["td"] = HtmlTag::TD;
-	tags["video"] = HtmlTag::VIDEO;
-	tags["audio"] = HtmlTag::AUDIO;
-	tags["source"] = HtmlTag::SOURCE;
 }
 
 void HtmlRenderer::render(const std::string& source,
@@ -66,44 +92,52 @@ void HtmlRenderer::render(const std::string& source,
 	std::vector<LinkPair>& links,
 	const std::string& url)
 {
-	std::istringstream input(source);
-	render(input, lines, links, url);
+	TagSoupPullParser xpp(source);
+	xpp.set_skip_inline_images(true);
+	render(xpp, lines, links, url);
 }
 
 unsigned int HtmlRenderer::add_link(std::vector<LinkPair>& links,
 	const std::string& link,
 	LinkType type)
 {
-	bool found = false;
-	unsigned int i = 1;
-	for (const auto& l : links) {
-		if (l.first == link) {
-			found = true;
-			break;
-		}
-		i++;
+	// Links that came with the vector, or that were added to it since
+	for (; indexed_links < links.size(); ++indexed_links) {
+		link_numbers.emplace(links[indexed_links].first, indexed_links + 1);
 	}
-	if (!found) {
+
+	const auto inserted = link_numbers.emplace(link, links.size() + 1);
+	if (inserted.second) {
 		links.push_back(LinkPair(link, type));
+		indexed_links = links.size();
 	}
-
-	return i;
+	return inserted.first->second;
 }
 
 HtmlTag HtmlRenderer::extract_tag(TagSoupPullParser& parser)
 {
-	std::string tagname = parser.get_text();
-	std::transform(tagname.begin(),
-		tagname.end(),
-		tagname.begin(),
-		::tolower);
-	return tags[tagname];
+	static const perfect_hash::Table<TagNames> tags;
+
+	const std::string& tagname = parser.get_text();
+	const int i = tags.find(tagname.data(), tagname.size());
+	// Tags we don't know about get a value that none of the cases match
+	return i >= 0 ? tag_table[i].tag : static_cast<HtmlTag>(0);
 }
 
 void HtmlRenderer::render(std::istream& input,
 	std::vector<std::pair<LineType, std::string>>& lines,
 	std::vector<LinkPair>& links,
 	const std::string& url)
+{
+	TagSoupPullParser xpp(input);
+	xpp.set_skip_inline_images(true);
+	render(xpp, lines, links, url);
+}
+
+void HtmlRenderer::render(TagSoupPullParser& xpp,
+	std::vector<std::pair<LineType, std::string>>& lines,
+	std::vector<LinkPair>& links,
+	const std::string& url)
 {
 	unsigned int image_count = 0;
 	unsigned int video_count = 0;
@@ -125,6 +159,8 @@ void HtmlRenderer::render(std::istream& input,
 	std::vector<char> ol_types;
 	int link_num = -1;
 	std::vector<Table> tables;
+	link_numbers.clear();
+	indexed_links = 0;
 
 	/*
 	 * to render the HTML, we use a self-developed "XML" pull parser.
@@ -135,7 +171,6 @@ void HtmlRenderer::render(std::istream& input,
 	 *   - we then can iterate over all continuous elements, such as start
 	 * tag, close tag, text element, ...
 	 */
-	TagSoupPullParser xpp(input);
 
 	for (TagSoupPullParser::Event e = xpp.next();
 		e != TagSoupPullParser::Event::END_DOCUMENT;
@@ -496,7 +531,7 @@ void HtmlRenderer::render(std::istream& input,
 				} else {
 					// is ok, no border then
 				}
-				tables.push_back(Table(has_border));
+				tables.push_back(Table(has_border, max_table_cell_width));
 				break;
 			}
 
@@ -1168,13 +1203,39 @@ void HtmlRenderer::TableRow::start_cell(size_t span)
 	cells.push_back(TableCell(span));
 }
 
-void HtmlRenderer::TableRow::add_text(const std::string& str)
+void HtmlRenderer::TableRow::add_text(const std::string& str,
+	size_t max_width)
 {
 	if (!inside) {
 		start_cell(1);        // colspan 1
 	}
 
-	cells.back().text.push_back(str);
+	TableCell& cell = cells.back();
+	const auto add_line = [&cell](const std::string& line, size_t width) {
+		cell.text.push_back(line);
+		cell.widths.push_back(width);
+		cell.width = std::max(cell.width, width);
+	};
+
+	size_t width = utils::strwidth_stfl(str);
+	if (max_width == 0 || width <= max_width) {
+		add_line(str, width);
+		return;
+	}
+
+	std::string rest = str;
+	while (width > max_width) {
+		std::string line = utils::substr_with_width_stfl(rest, max_width);
+		if (line.empty()) {
+			// Not even the first character fits
+			break;
+		}
+		rest.erase(0, line.size());
+		const size_t line_width = utils::strwidth_stfl(line);
+		add_line(line, line_width);
+		width -= line_width;
+	}
+	add_line(rest, width);
 }
 
 void HtmlRenderer::TableRow::complete_cell()
@@ -1211,7 +1272,7 @@ void HtmlRenderer::Table::add_text(const std::string& str)
 	if (!inside) {
 		start_row();
 	}
-	rows.back().add_text(str);
+	rows.back().add_text(str, max_cell_width);
 }
 
 void HtmlRenderer::Table::complete_row()
@@ -1222,43 +1283,30 @@ void HtmlRenderer::Table::complete_row()
 void HtmlRenderer::render_table(const HtmlRenderer::Table& table,
 	std::vector<std::pair<LineType, std::string>>& lines)
 {
-	// get number of rows
+	// The widths of the cells were measured as their text was added, so
+	// laying out the table only takes a pass over the cells to get the
+	// width of each column, and another to write out the rows.
 	size_t rows = table.rows.size();
 
 	// get maximum number of cells
 	size_t cells = 0;
-	for (size_t row = 0; row < rows; row++) {
+	for (const auto& row : table.rows) {
 		size_t count = 0;
-		for (size_t cell = 0; cell < table.rows[row].cells.size();
-			cell++) {
-			count += table.rows[row].cells[cell].span;
+		for (const auto& cell : row.cells) {
+			count += cell.span;
 		}
 		cells = std::max(cells, count);
 	}
 
-	// get width of each row
-	std::vector<size_t> cell_widths;
-	cell_widths.resize(cells, 0);
-	for (size_t row = 0; row < rows; row++) {
-		for (size_t cell = 0; cell < table.rows[row].cells.size();
-			cell++) {
-			size_t width = 0;
-			if (table.rows[row].cells[cell].text.size()) {
-				for (size_t idx = 0; idx <
-					table.rows[row].cells[cell].text.size();
-					idx++)
-					width = std::max(width,
-							utils::strwidth_stfl(
-								table.rows[row]
-								.cells[cell]
-								.text[idx]));
-			}
-			if (table.rows[row].cells[cell].span > 1) {
-				width += table.rows[row].cells[cell].span;
+	// get width of each column
+	std::vector<size_t> cell_widths(cells, 0);
+	for (const auto& row : table.rows) {
+		for (size_t cell = 0; cell < row.cells.size(); cell++) {
+			size_t width = row.cells[cell].width;
+			if (row.cells[cell].span > 1) {
+				width += row.cells[cell].span;
 				// divide size evenly on columns (can be done better, I know)
-				width /= table.rows[row]
-					.cells[cell]
-					.span;
+				width /= row.cells[cell].span;
 			}
 			cell_widths[cell] = std::max(cell_widths[cell], width);
 		}
@@ -1286,62 +1334,40 @@ void HtmlRenderer::render_table(const HtmlRenderer::Table& table,
 	if (table.has_border)
 		lines.push_back(
 			std::make_pair(LineType::nonwrappable, separator));
+	std::vector<size_t> reference_widths;
 	for (size_t row = 0; row < rows; row++) {
-		// calc height of this row
+		const auto& row_cells = table.rows[row].cells;
+
+		// calc height of this row, and the width each of its cells spans
 		size_t height = 0;
-		for (size_t cell = 0; cell < table.rows[row].cells.size();
-			cell++)
-			height = std::max(height,
-					table.rows[row].cells[cell].text.size());
+		reference_widths.assign(row_cells.size(), 0);
+		for (size_t cell = 0; cell < row_cells.size(); cell++) {
+			height = std::max(height, row_cells[cell].text.size());
+			size_t& reference_width = reference_widths[cell];
+			reference_width = cell_widths[cell];
+			for (size_t ic = cell + 1;
+				ic < cell + row_cells[cell].span && ic < cells;
+				++ic) {
+				reference_width += cell_widths[ic] + 1;
+			}
+		}
 
 		for (size_t idx = 0; idx < height; ++idx) {
 			std::string line;
 			if (table.has_border) {
 				line += vsep;
 			}
-			for (size_t cell = 0;
-				cell < table.rows[row].cells.size();
-				cell++) {
+			for (size_t cell = 0; cell < row_cells.size(); cell++) {
 				size_t cell_width = 0;
-				if (idx < table.rows[row]
-					.cells[cell]
-					.text.size()) {
-					LOG(Level::DEBUG,
-						"row = %" PRIu64 " cell = %" PRIu64 " text = %s",
-						static_cast<uint64_t>(row),
-						static_cast<uint64_t>(cell),
-						table.rows[row]
-						.cells[cell]
-						.text[idx]);
-					cell_width = utils::strwidth_stfl(
-							table.rows[row]
-							.cells[cell]
-							.text[idx]);
-					line += table.rows[row]
-						.cells[cell]
-						.text[idx];
-				}
-				size_t reference_width = cell_widths[cell];
-				if (table.rows[row].cells[cell].span > 1) {
-					for (size_t ic = cell + 1; ic < cell +
-						table.rows[row]
-						.cells[cell]
-						.span;
-						++ic)
-						reference_width +=
-							cell_widths[ic] + 1;
-				}
-				LOG(Level::DEBUG,
-					"cell_width = %" PRIu64 " reference_width = %" PRIu64,
-					static_cast<uint64_t>(cell_width),
-					static_cast<uint64_t>(reference_width));
-				if (cell_width <
-					reference_width) // pad, if necessary
-					line += std::string(
-							reference_width - cell_width,
-							' ');
-
-				if (cell < table.rows[row].cells.size() - 1) {
+				if (idx < row_cells[cell].text.size()) {
+					cell_width = row_cells[cell].widths[idx];
+					line += row_cells[cell].text[idx];
+				}
+				if (cell_width < reference_widths[cell]) { // pad, if necessary
+					line.append(reference_widths[cell] - cell_width, ' ');
+				}
+
+				if (cell < row_cells.size() - 1) {
 					line += vsep;
 				}
 			}
@@ -1349,7 +1375,7 @@ void HtmlRenderer::render_table(const HtmlRenderer::Table& table,
 				line += vsep;
 			}
 			lines.push_back(
-				std::make_pair(LineType::nonwrappable, line));
+				std::make_pair(LineType::nonwrappable, std::move(line)));
 		}
 		if (table.has_border)
 			lines.push_back(std::make_pair(
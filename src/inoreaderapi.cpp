@@ -1,13 +1,14 @@
 #include "inoreaderapi.h"
 
+#include <cinttypes>
 #include <cstring>
 #include <curl/curl.h>
 #include <json.h>
 #include <vector>
-#include <thread>
 
 #include "config.h"
 #include "curlhandle.h"
+#include "executor.h"
 #include "strprintf.h"
 #include "utils.h"
 
@@ -19,6 +20,9 @@
 #define INOREADER_API_MARK_ALL_READ_URL INOREADER_API_PREFIX "mark-all-as-read"
 #define INOREADER_API_EDIT_TAG_URL INOREADER_API_PREFIX "edit-tag"
 
+// How many articles a single edit-tag request marks read
+#define INOREADER_MARK_READ_BATCH_SIZE 250
+
 // for reference, see https://inoreader.com/developers
 
 namespace newsboat {
@@ -43,9 +47,18 @@ static size_t my_write_data(void* buffer, size_t size, size_t nmemb,
 	return size * nmemb;
 }
 
+static size_t read_budget_header(char* buffer, size_t size, size_t nitems,
+	void* userp)
+{
+	RequestBudget* budget = static_cast<RequestBudget*>(userp);
+	budget->read_header(std::string(buffer, size * nitems));
+	return size * nitems;
+}
+
 std::string InoreaderApi::retrieve_auth()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	Credentials cred = get_credentials("inoreader", "Inoreader");
 	if (cred.user.empty() || cred.pass.empty()) {
 		return "";
@@ -93,7 +106,8 @@ std::vector<TaggedFeedUrl> InoreaderApi::get_subscribed_urls()
 	std::vector<TaggedFeedUrl> urls;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
@@ -102,6 +116,9 @@ std::vector<TaggedFeedUrl> InoreaderApi::get_subscribed_urls()
 	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEFUNCTION, my_write_data);
 	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, &result);
 	curl_easy_setopt(handle.ptr(), CURLOPT_URL, INOREADER_SUBSCRIPTION_LIST);
+	curl_easy_setopt(handle.ptr(), CURLOPT_HEADERFUNCTION, read_budget_header);
+	curl_easy_setopt(handle.ptr(), CURLOPT_HEADERDATA, &budget);
+	budget.spend(RequestBudget::Kind::READ);
 	curl_easy_perform(handle.ptr());
 	curl_slist_free_all(custom_headers);
 
@@ -214,8 +231,8 @@ bool InoreaderApi::mark_article_read(const std::string& guid, bool read)
 {
 	// Do this in a thread, as we don't care about the result enough to wait
 	// for it.  borrowed from ttrssapi.cpp
-	std::thread t{[=]()
-	{
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
 		LOG(Level::DEBUG,
 			"InoreaderApi::mark_article_read: inside thread, marking "
 			"thread as read...");
@@ -241,8 +258,35 @@ bool InoreaderApi::mark_article_read(const std::string& guid, bool read)
 			result);
 
 		return result == "OK";
-	}};
-	t.detach();
+	});
+	return true;
+}
+
+bool InoreaderApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	// Like mark_article_read(), do this in a thread
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
+		mark_in_batches(guids, INOREADER_MARK_READ_BATCH_SIZE,
+		[&](const std::vector<std::string>& batch) {
+			std::string postcontent;
+			for (const auto& guid : batch) {
+				postcontent += "i=" + guid + "&";
+			}
+			postcontent += "a=user/-/state/com.google/read";
+
+			const std::string result =
+				post_content(INOREADER_API_EDIT_TAG_URL, postcontent);
+
+			LOG(Level::DEBUG,
+				"InoreaderApi::mark_articles_read: %" PRIu64 " articles, "
+				"result = %s",
+				static_cast<uint64_t>(batch.size()),
+				result);
+
+			return result == "OK";
+		});
+	});
 	return true;
 }
 
@@ -315,7 +359,8 @@ std::string InoreaderApi::post_content(const std::string& url,
 	std::string result;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	utils::set_common_curl_options(handle, cfg);
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
@@ -323,6 +368,9 @@ std::string InoreaderApi::post_content(const std::string& url,
 	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, &result);
 	curl_easy_setopt(handle.ptr(), CURLOPT_POSTFIELDS, postdata.c_str());
 	curl_easy_setopt(handle.ptr(), CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle.ptr(), CURLOPT_HEADERFUNCTION, read_budget_header);
+	curl_easy_setopt(handle.ptr(), CURLOPT_HEADERDATA, &budget);
+	budget.spend(RequestBudget::Kind::WRITE);
 	curl_easy_perform(handle.ptr());
 	curl_slist_free_all(custom_headers);
 
@@ -73,7 +73,7 @@ nonstd::optional<utils::ReadTextFileError> InoreaderUrlReader::reload()
 		}
 	}
 
-	std::vector<TaggedFeedUrl> feedurls = api->get_subscribed_urls();
+	std::vector<TaggedFeedUrl> feedurls = api->subscriptions();
 	for (const auto& url : feedurls) {
 		LOG(Level::DEBUG, "added %s to URL list", url.first);
 		urls.push_back(url.first);
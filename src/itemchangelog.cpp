@@ -0,0 +1,29 @@
+#include "itemchangelog.h"
+
+#include <utility>
+
+namespace newsboat {
+
+void ItemChangeLog::subscribe(Subscriber subscriber)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	subscribers.push_back(std::move(subscriber));
+}
+
+void ItemChangeLog::publish(const ItemChanges& changes)
+{
+	if (changes.empty()) {
+		return;
+	}
+	// Subscribers may subscribe others, or take locks of their own
+	std::vector<Subscriber> current;
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		current = subscribers;
+	}
+	for (const auto& subscriber : current) {
+		subscriber(changes);
+	}
+}
+
+} // namespace newsboat
@@ -1,5 +1,6 @@
 #include <itemlistformaction.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
 #include <cstdio>
@@ -8,13 +9,16 @@
 #include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 
 #include "config.h"
 #include "controller.h"
 #include "dbexception.h"
+#include "descriptionlru.h"
 #include "fmtstrformatter.h"
 #include "formaction.h"
 #include "itemutils.h"
+#include "jobprogress.h"
 #include "logger.h"
 #include "matcherexception.h"
 #include "rssfeed.h"
@@ -25,6 +29,20 @@
 
 namespace newsboat {
 
+namespace {
+
+/// Rows formatted beyond the screen in each direction with
+/// `articlelist-viewport-only`, unless the screen is taller than that.
+const std::uint32_t MIN_SCROLL_MARGIN = 64;
+
+/// Filters over at least this many articles run as a job that can be
+/// cancelled, in slices of this many articles, after each of which the
+/// progress is shown.
+const std::size_t FILTER_JOB_SIZE = 4096;
+const std::size_t FILTER_JOB_SLICE = 16384;
+
+}
+
 ItemListFormAction::ItemListFormAction(View* vv,
 	std::string formstr,
 	Cache* cc,
@@ -40,9 +58,12 @@ ItemListFormAction::ItemListFormAction(View* vv,
 	, rxman(r)
 	, old_width(0)
 	, invalidation_mode(InvalidationMode::NONE)
+	, visible_items_stale(true)
+	, visible_items_show_read(true)
 	, listfmt(&rxman, "articlelist")
 	, rsscache(cc)
 	, filter_container(f)
+	, prefetcher(cc)
 {
 	register_format_styles();
 }
@@ -91,7 +112,7 @@ bool ItemListFormAction::process_operation(Operation op,
 			visible_items[itempos].first->set_deleted(
 				!visible_items[itempos].first->deleted());
 			rsscache->mark_item_deleted(
-				visible_items[itempos].first->guid(),
+				*visible_items[itempos].first,
 				visible_items[itempos].first->deleted());
 			if (itempos < visible_items.size() - 1) {
 				list.set_position(itempos + 1);
@@ -123,7 +144,7 @@ bool ItemListFormAction::process_operation(Operation op,
 				item->set_unread(false);
 				// mark as deleted
 				item->set_deleted(true);
-				rsscache->mark_item_deleted(item->guid(), true);
+				rsscache->mark_item_deleted(*item, true);
 			}
 			invalidate_list();
 		}
@@ -242,8 +263,7 @@ bool ItemListFormAction::process_operation(Operation op,
 					visible_items[itempos]
 					.first->set_deleted(false);
 					rsscache->mark_item_deleted(
-						visible_items[itempos]
-						.first->guid(),
+						*visible_items[itempos].first,
 						false);
 					// toggle read
 					bool unread = visible_items[itempos]
@@ -405,6 +425,18 @@ bool ItemListFormAction::process_operation(Operation op,
 		v->feedlist_mark_pos_if_visible(pos);
 		feed->purge_deleted_items();
 		feed->unload();
+		{
+			const auto stats = DescriptionLru::shared().stats();
+			LOG(Level::DEBUG,
+				"ItemListFormAction: loaded descriptions: %" PRIu64 " hit(s), "
+				"%" PRIu64 " miss(es), %" PRIu64 " eviction(s); %" PRIu64
+				" kept, taking up %" PRIu64 " bytes",
+				stats.hits,
+				stats.misses,
+				stats.evictions,
+				static_cast<uint64_t>(stats.entries),
+				static_cast<uint64_t>(stats.bytes));
+		}
 		quit = true;
 		break;
 	case OP_HARDQUIT:
@@ -500,7 +532,7 @@ bool ItemListFormAction::process_operation(Operation op,
 				}
 
 				if (visible_items.size() > 0) {
-					std::lock_guard<std::mutex> lock(feed->item_mutex);
+					const SharedLock lock(feed->item_mutex);
 					bool notify = visible_items[0].first->feedurl() != feed->rssurl();
 					for (const auto& item : visible_items) {
 						item.first->set_unread_nowrite_notify(false, notify);
@@ -748,15 +780,15 @@ bool ItemListFormAction::process_operation(Operation op,
 		}
 		break;
 	case OP_ARTICLEFEED: {
-		auto feeds = v->get_ctrl()->get_feedcontainer()->get_all_feeds();
+		const auto feeds = v->get_ctrl()->get_feedcontainer()->get_feeds_snapshot();
 		size_t pos;
 		auto article_feed = visible_items[itempos].first->get_feedptr();
-		for (pos = 0; pos < feeds.size(); pos++) {
-			if (feeds[pos] == article_feed) {
+		for (pos = 0; pos < feeds->size(); pos++) {
+			if ((*feeds)[pos] == article_feed) {
 				break;
 			}
 		}
-		if (pos != feeds.size()) {
+		if (pos != feeds->size()) {
 			v->push_itemlist(pos);
 		}
 	}
@@ -883,11 +915,16 @@ void ItemListFormAction::qna_start_search()
 	searchhistory.add_line(searchphrase);
 	std::vector<std::shared_ptr<RssItem>> items;
 	try {
-		const auto message_lifetime = v->get_statusline().show_message_until_finished(
-				_("Searching..."));
 		const auto utf8searchphrase = utils::locale_to_utf8(searchphrase);
-		items = v->get_ctrl()->search_for_items(
-				utf8searchphrase, feed);
+		const bool finished = v->run_job(_("Searching..."),
+		[&](JobProgress& progress) {
+			items = v->get_ctrl()->search_for_items(
+					utf8searchphrase, feed, &progress);
+		});
+		if (!finished) {
+			v->get_statusline().show_message(_("Search cancelled."));
+			return;
+		}
 	} catch (const DbException& e) {
 		v->get_statusline().show_error(
 			strprintf::fmt(_("Error while searching for `%s': %s"),
@@ -913,8 +950,14 @@ void ItemListFormAction::do_update_visible_items()
 		return;
 	}
 
-	std::lock_guard<std::mutex> lock(feed->item_mutex);
-	std::vector<std::shared_ptr<RssItem>>& items = feed->items();
+	const auto lock = feed->lock_items_for_reading(lists_unread_items());
+	if (!visible_items_stale && update_changed_visible_items()) {
+		return;
+	}
+	changed_items.clear();
+	visible_items_stale = false;
+
+	std::vector<std::shared_ptr<RssItem>>& items = listed_items();
 
 	std::vector<ItemPtrPosPair> new_visible_items;
 
@@ -924,18 +967,61 @@ void ItemListFormAction::do_update_visible_items()
 	 * (if applicable) whether an items matches the currently active filter.
 	 */
 
-	bool show_read = cfg->get_configvalue_as_bool("show-read-articles");
+	bool show_read = cfg->snapshot().show_read_articles;
+	visible_items_show_read = show_read;
 
 	unsigned int i = 0;
 	for (const auto& item : items) {
 		item->set_index(i + 1);
-		if ((show_read || item->unread()) &&
-			(!filter_active || matcher.matches(item.get()))) {
+		if (show_read || item->unread()) {
 			new_visible_items.push_back(ItemPtrPosPair(item, i));
 		}
 		i++;
 	}
 
+	if (filter_active) {
+		std::vector<Matchable*> batch;
+		batch.reserve(new_visible_items.size());
+		for (const auto& item : new_visible_items) {
+			batch.push_back(item.first.get());
+		}
+		std::vector<bool> matched;
+		bool finished = true;
+		if (batch.size() < FILTER_JOB_SIZE) {
+			matched = matcher.matches(batch);
+		} else {
+			finished = v->run_job(_("Filtering..."), [&](JobProgress& progress) {
+				progress.set_total(batch.size());
+				for (std::size_t begin = 0; begin < batch.size();
+					begin += FILTER_JOB_SLICE) {
+					const auto end = std::min(batch.size(), begin + FILTER_JOB_SLICE);
+					const auto slice = matcher.matches(
+							std::vector<Matchable*>(batch.begin() + begin, batch.begin() + end),
+							progress.cancel_flag());
+					if (progress.is_cancelled()) {
+						return;
+					}
+					matched.insert(matched.end(), slice.begin(), slice.end());
+					progress.advance(slice.size());
+				}
+			});
+		}
+
+		if (!finished) {
+			// Cancelling a slow filter drops it
+			filter_active = false;
+			v->get_statusline().show_error(_("Filtering cancelled."));
+		} else {
+			std::vector<ItemPtrPosPair> filtered;
+			for (std::size_t n = 0; n < new_visible_items.size(); ++n) {
+				if (matched[n]) {
+					filtered.push_back(new_visible_items[n]);
+				}
+			}
+			new_visible_items.swap(filtered);
+		}
+	}
+
 	LOG(Level::DEBUG,
 		"ItemListFormAction::do_update_visible_items: size = %" PRIu64,
 		static_cast<uint64_t>(visible_items.size()));
@@ -966,46 +1052,181 @@ void ItemListFormAction::do_update_visible_items()
 	visible_items = new_visible_items;
 }
 
+bool ItemListFormAction::lists_unread_items()
+{
+	return !cfg->snapshot().show_read_articles
+		&& cfg->get_configvalue_as_bool("lazy-load-read-articles");
+}
+
+std::vector<std::shared_ptr<RssItem>>& ItemListFormAction::listed_items()
+{
+	if (lists_unread_items()) {
+		return feed->unread_items();
+	}
+	return feed->items();
+}
+
+bool ItemListFormAction::update_changed_visible_items()
+{
+	std::vector<std::shared_ptr<RssItem>>& items = listed_items();
+	for (const auto& item : changed_items) {
+		// The index is from the last time all the items were gone through;
+		// if it's off, the feed has changed since
+		const unsigned int index = item->get_index();
+		if (index == 0 || index > items.size() || items[index - 1] != item) {
+			LOG(Level::DEBUG,
+				"ItemListFormAction::update_changed_visible_items: "
+				"feed has changed, going through all items");
+			changed_items.clear();
+			return false;
+		}
+	}
+
+	const bool show_read = cfg->snapshot().show_read_articles;
+	if (show_read != visible_items_show_read) {
+		// Changed with `:set`, which affects more than the changed items
+		changed_items.clear();
+		return false;
+	}
+
+	// If the filter throws, it's not known which items are visible anymore
+	visible_items_stale = true;
+	unsigned int pos = list.get_position();
+	for (const auto& item : changed_items) {
+		const unsigned int feedpos = item->get_index() - 1;
+		const bool visible = (show_read || item->unread())
+			&& (!filter_active || matcher.matches(item.get()));
+
+		// visible_items are in the order of the feed
+		const auto it = std::lower_bound(visible_items.begin(),
+				visible_items.end(),
+				feedpos,
+		[](const ItemPtrPosPair& visible_item, unsigned int p) {
+			return visible_item.second < p;
+		});
+		const unsigned int itempos = it - visible_items.begin();
+		const bool was_visible = it != visible_items.end()
+			&& it->second == feedpos;
+
+		if (visible && !was_visible) {
+			visible_items.insert(it, ItemPtrPosPair(item, feedpos));
+			if (itempos < pos) {
+				pos++;
+			}
+		} else if (!visible && was_visible) {
+			visible_items.erase(it);
+			if (itempos < pos) {
+				pos--;
+			}
+		}
+	}
+	changed_items.clear();
+	visible_items_stale = false;
+
+	LOG(Level::DEBUG,
+		"ItemListFormAction::update_changed_visible_items: size = %" PRIu64,
+		static_cast<uint64_t>(visible_items.size()));
+
+	list.set_position(pos);
+	return true;
+}
+
 void ItemListFormAction::draw_items()
 {
 	const unsigned int width = list.get_width();
-	auto datetime_format = cfg->get_configvalue("datetime-format");
-	auto itemlist_format =
-		cfg->get_configvalue("articlelist-format");
+	const std::string& datetime_format = cfg->snapshot().datetime_format;
+	itemlist_format.set_format(cfg->get_configvalue("articlelist-format"));
+	const bool viewport_only =
+		cfg->get_configvalue_as_bool("articlelist-viewport-only");
+
+	if (!viewport_only && (list.get_window_start() != 0
+			|| list.get_window_size() != visible_items.size())) {
+		// `articlelist-viewport-only` was just turned off
+		invalidation_mode = InvalidationMode::COMPLETE;
+	}
+
+	std::size_t window_start = list.get_window_start();
 
 	switch (invalidation_mode) {
-	case InvalidationMode::COMPLETE:
+	case InvalidationMode::COMPLETE: {
 		listfmt.clear();
 
-		for (const auto& item : visible_items) {
-			auto line = item2formatted_line(item,
+		window_start = 0;
+		std::size_t window_end = visible_items.size();
+		if (viewport_only) {
+			const auto window = list.window_around_cursor(visible_items.size(),
+					MIN_SCROLL_MARGIN);
+			window_start = window.first;
+			window_end = window.second;
+		}
+
+		for (std::size_t i = window_start; i < window_end; ++i) {
+			auto line = item2formatted_line(visible_items[i],
 					width,
 					itemlist_format,
 					datetime_format);
 			listfmt.add_line(line);
 		}
 		break;
+	}
 
 	case InvalidationMode::PARTIAL:
 		for (const auto& itempos : invalidated_itempos) {
+			if (itempos < window_start
+				|| itempos >= window_start + listfmt.get_lines_count()) {
+				// Not handed to STFL; it's formatted when the window moves
+				continue;
+			}
 			auto item = visible_items[itempos];
 			auto line = item2formatted_line(item,
 					width,
 					itemlist_format,
 					datetime_format);
-			listfmt.set_line(itempos, line);
+			listfmt.set_line(itempos - window_start, line);
 		}
 		break;
 	case InvalidationMode::NONE:
 		break;
 	}
 
-	list.stfl_replace_lines(listfmt);
+	if (viewport_only) {
+		list.stfl_replace_window(listfmt, window_start, visible_items.size());
+	} else {
+		list.stfl_replace_lines(listfmt);
+	}
 
 	invalidated_itempos.clear();
 	invalidation_mode = InvalidationMode::NONE;
 }
 
+void ItemListFormAction::prefetch_descriptions()
+{
+	if (visible_items.empty()) {
+		return;
+	}
+
+	// Items below the cursor first, since that's where users usually go
+	const unsigned int height = std::max(list.get_height(), 1u);
+	const unsigned int itempos = std::min<std::size_t>(list.get_position(),
+			visible_items.size() - 1);
+	const unsigned int first = itempos > height ? itempos - height : 0;
+	const unsigned int last = std::min<std::size_t>(itempos + 2 * height,
+			visible_items.size());
+
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (unsigned int i = itempos; i < last; ++i) {
+		items.push_back(visible_items[i].first);
+	}
+	for (unsigned int i = itempos; i > first; --i) {
+		items.push_back(visible_items[i - 1].first);
+	}
+
+	if (items != prefetched_items) {
+		prefetcher.prefetch(items);
+		prefetched_items = std::move(items);
+	}
+}
+
 void ItemListFormAction::prepare()
 {
 	std::lock_guard<std::mutex> mtx(redraw_mtx);
@@ -1038,14 +1259,23 @@ void ItemListFormAction::prepare()
 		}
 	}
 
+	prefetch_descriptions();
+
 	const unsigned int width = list.get_width();
 
+	// visible_items are up to date by now; these only need to be drawn again
 	if (do_redraw || old_width != width) {
-		invalidate_list();
+		invalidation_mode = InvalidationMode::COMPLETE;
 		old_width = width;
 		do_redraw = false;
 	}
 
+	if (!list.window_covers_viewport()) {
+		// The cursor has scrolled out of the rows that were formatted for
+		// `articlelist-viewport-only`
+		invalidation_mode = InvalidationMode::COMPLETE;
+	}
+
 	if (invalidation_mode == InvalidationMode::NONE) {
 		return;
 	}
@@ -1062,7 +1292,7 @@ void ItemListFormAction::prepare()
 
 std::string ItemListFormAction::item2formatted_line(const ItemPtrPosPair& item,
 	const unsigned int width,
-	const std::string& itemlist_format,
+	const FmtStrTemplate& itemlist_format,
 	const std::string& datetime_format)
 {
 	FmtStrFormatter fmt;
@@ -1073,17 +1303,24 @@ std::string ItemListFormAction::item2formatted_line(const ItemPtrPosPair& item,
 	fmt.register_fmt('F', item.first->flags());
 	fmt.register_fmt('e', item.first->enclosure_url());
 
-	using namespace std::chrono;
-	const auto article_time_point = system_clock::from_time_t(
-			item.first->pubDate_timestamp());
-	using days = duration<int, std::ratio<86400>>;
-	const auto article_age = duration_cast<days>(
-			system_clock::now() - article_time_point).count();
-	const std::string new_datetime_format = utils::replace_all(
-			datetime_format, "%L", strprintf::fmt(
-				ngettext("1 day ago", "%u days ago", article_age), article_age));
-	fmt.register_fmt('D', utils::mt_strf_localtime(new_datetime_format,
-			item.first->pubDate_timestamp()));
+	if (datetime_format.find("%L") == std::string::npos) {
+		fmt.register_fmt('D', formatted_dates.format(datetime_format,
+				item.first->pubDate_timestamp()));
+	} else {
+		// The format differs with the age of each article, so there's
+		// little to share between them
+		using namespace std::chrono;
+		const auto article_time_point = system_clock::from_time_t(
+				item.first->pubDate_timestamp());
+		using days = duration<int, std::ratio<86400>>;
+		const auto article_age = duration_cast<days>(
+				system_clock::now() - article_time_point).count();
+		const std::string new_datetime_format = utils::replace_all(
+				datetime_format, "%L", strprintf::fmt(
+					ngettext("1 day ago", "%u days ago", article_age), article_age));
+		fmt.register_fmt('D', utils::mt_strf_localtime(new_datetime_format,
+				item.first->pubDate_timestamp()));
+	}
 
 	if (feed->rssurl() != item.first->feedurl() &&
 		item.first->get_feedptr() != nullptr) {
@@ -1272,6 +1509,39 @@ bool ItemListFormAction::jump_to_next_unread_item(bool start_with_first)
 	return false;
 }
 
+std::vector<std::shared_ptr<RssItem>> ItemListFormAction::get_neighbour_items()
+{
+	std::vector<std::shared_ptr<RssItem>> items;
+	const std::size_t itempos = list.get_position();
+	if (itempos >= visible_items.size()) {
+		return items;
+	}
+
+	const auto add = [&](std::size_t i) {
+		const auto& item = visible_items[i].first;
+		if (i != itempos
+			&& std::find(items.begin(), items.end(), item) == items.end()) {
+			items.push_back(item);
+		}
+	};
+
+	// Same search as jump_to_next_unread_item(false)
+	for (std::size_t n = 1; n <= visible_items.size(); ++n) {
+		const std::size_t i = (itempos + n) % visible_items.size();
+		if (visible_items[i].first->unread()) {
+			add(i);
+			break;
+		}
+	}
+	if (itempos + 1 < visible_items.size()) {
+		add(itempos + 1);
+	}
+	if (itempos > 0) {
+		add(itempos - 1);
+	}
+	return items;
+}
+
 bool ItemListFormAction::jump_to_previous_item(bool start_with_last)
 {
 	const unsigned int itempos = list.get_position();
@@ -1381,7 +1651,7 @@ void ItemListFormAction::restore_selected_position()
 	// this fix.
 	const unsigned int itempos = list.get_position();
 	if ((old_itempos != -1) && itempos > (unsigned int)old_itempos &&
-		!cfg->get_configvalue_as_bool("show-read-articles")) {
+		!cfg->snapshot().show_read_articles) {
 		list.set_position(old_itempos);
 		old_itempos = -1; // Reset
 	}
@@ -1486,7 +1756,6 @@ void ItemListFormAction::set_feed(std::shared_ptr<RssFeed> fd)
 		fd.get(),
 		fd->title());
 	feed = fd;
-	feed->load();
 	invalidate_list();
 	do_update_visible_items();
 }
@@ -1514,6 +1783,15 @@ void ItemListFormAction::handle_op_saveall()
 		return;
 	}
 
+	const std::string format = cfg->get_configvalue("save-all-format");
+	if (format != "files") {
+		save_all_to_archive(format == "mbox"
+			? ArticleExporter::Archive::MBOX
+			: ArticleExporter::Archive::JSONL,
+			"." + format);
+		return;
+	}
+
 	std::string directory = v->run_dirbrowser();
 
 	if (directory.empty()) {
@@ -1554,6 +1832,9 @@ void ItemListFormAction::handle_op_saveall()
 		return;
 	}
 
+	// The questions come first, so that the articles can be written in one
+	// go afterwards
+	std::vector<ArticleExporter::File> files;
 	bool overwrite_all = false;
 	for (size_t item_idx = 0; item_idx < filenames.size(); ++item_idx) {
 		const auto filename = filenames[item_idx];
@@ -1563,7 +1844,7 @@ void ItemListFormAction::handle_op_saveall()
 		struct stat sbuf;
 		if (::stat(filepath.c_str(), &sbuf) != -1) {
 			if (overwrite_all) {
-				save_article(filepath, item);
+				files.emplace_back(filepath, item);
 				continue;
 			}
 
@@ -1587,10 +1868,10 @@ void ItemListFormAction::handle_op_saveall()
 			}
 
 			if (c == input_options.at(0)) {
-				save_article(filepath, item);
+				files.emplace_back(filepath, item);
 			} else if (c == input_options.at(1)) {
 				overwrite_all = true;
-				save_article(filepath, item);
+				files.emplace_back(filepath, item);
 			} else if (c == input_options.at(2)) {
 				continue;
 			} else if (c == input_options.at(3)) {
@@ -1598,9 +1879,68 @@ void ItemListFormAction::handle_op_saveall()
 			}
 		} else {
 			// Create file since it does not exist
-			save_article(filepath, item);
+			files.emplace_back(filepath, item);
 		}
 	}
+	if (files.empty()) {
+		return;
+	}
+
+	ArticleExporter exporter(*cfg, std::thread::hardware_concurrency());
+	std::vector<std::string> failed;
+	const bool finished = v->run_job(_("Saving articles..."),
+	[&](JobProgress& progress) {
+		failed = exporter.write_files(files, progress);
+	});
+	if (!finished) {
+		v->get_statusline().show_error(_("Saving cancelled."));
+	} else if (!failed.empty()) {
+		v->get_statusline().show_error(strprintf::fmt(
+				_("Error: couldn't save %u article(s), e.g. to %s"),
+				static_cast<unsigned int>(failed.size()), failed.front()));
+	} else {
+		v->get_statusline().show_message(strprintf::fmt(
+				_("Saved %u article(s) to %s"),
+				static_cast<unsigned int>(files.size()), directory));
+	}
+}
+
+void ItemListFormAction::save_all_to_archive(ArticleExporter::Archive format,
+	const std::string& extension)
+{
+	auto suggestion = v->get_filename_suggestion(
+			utils::utf8_to_locale(feed->title()));
+	const std::string txt = ".txt";
+	if (suggestion.size() > txt.size()
+		&& suggestion.compare(suggestion.size() - txt.size(), txt.size(), txt) == 0) {
+		suggestion.erase(suggestion.size() - txt.size());
+	}
+	const std::string filename = v->run_filebrowser(suggestion + extension);
+	if (filename.empty()) {
+		v->get_statusline().show_error(_("Aborted saving."));
+		return;
+	}
+
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (const auto& item : visible_items) {
+		items.push_back(item.first);
+	}
+	ArticleExporter exporter(*cfg, std::thread::hardware_concurrency());
+	bool written = false;
+	const bool finished = v->run_job(_("Saving articles..."),
+	[&](JobProgress& progress) {
+		written = exporter.write_archive(filename, format, items, progress);
+	});
+	if (!finished) {
+		v->get_statusline().show_error(_("Saving cancelled."));
+	} else if (!written) {
+		v->get_statusline().show_error(strprintf::fmt(
+				_("Error: couldn't save articles to %s"), filename));
+	} else {
+		v->get_statusline().show_message(strprintf::fmt(
+				_("Saved %u article(s) to %s"),
+				static_cast<unsigned int>(items.size()), filename));
+	}
 }
 
 void ItemListFormAction::apply_filter(const std::string& filtertext)
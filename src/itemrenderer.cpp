@@ -1,7 +1,9 @@
 #include "itemrenderer.h"
 
+#include <algorithm>
 #include <set>
 #include <sstream>
+#include <utility>
 
 #include "configcontainer.h"
 #include "htmlrenderer.h"
@@ -117,7 +119,9 @@ void render_html(
 {
 	const std::string renderer = cfg.get_configvalue("html-renderer");
 	if (renderer == "internal") {
-		HtmlRenderer rnd(raw);
+		const int max_cell_width = cfg.get_configvalue_as_int(
+				"html-table-cell-width");
+		HtmlRenderer rnd(raw, std::max(max_cell_width, 0));
 		rnd.render(source, lines, thelinks, url);
 	} else {
 		const char* argv[4];
@@ -193,7 +197,7 @@ std::string item_renderer::to_plain_text(
 	}
 
 	TextFormatter txtfmt;
-	txtfmt.add_lines(lines);
+	txtfmt.add_lines(std::move(lines));
 
 	unsigned int width = cfg.get_configvalue_as_int("text-width");
 	if (width == 0) {
@@ -210,10 +214,19 @@ std::pair<std::string, size_t> item_renderer::to_stfl_list(
 	unsigned int window_width,
 	RegexManager* rxman,
 	const std::string& location,
-	std::vector<LinkPair>& links)
+	std::vector<LinkPair>& links,
+	std::size_t max_body_size)
 {
 	std::vector<std::pair<LineType, std::string>> lines;
-	const auto item_description = item->description();
+	auto item_description = item->description();
+	if (max_body_size != 0 && item_description.text.size() > max_body_size) {
+		// Don't split a UTF-8 sequence
+		std::size_t end = max_body_size;
+		while (end > 0 && (item_description.text[end] & 0xC0) == 0x80) {
+			--end;
+		}
+		item_description.text.erase(end);
+	}
 
 	prepare_header(item, lines, links);
 	const std::string baseurl = get_item_base_link(item);
@@ -226,7 +239,7 @@ std::pair<std::string, size_t> item_renderer::to_stfl_list(
 	}
 
 	TextFormatter txtfmt;
-	txtfmt.add_lines(lines);
+	txtfmt.add_lines(std::move(lines));
 
 	return txtfmt.format_text_to_list(rxman, location, text_width, window_width);
 }
@@ -268,7 +281,7 @@ std::pair<std::string, size_t> item_renderer::source_to_stfl_list(
 				item->description().text)));
 
 	TextFormatter txtfmt;
-	txtfmt.add_lines(lines);
+	txtfmt.add_lines(std::move(lines));
 
 	return txtfmt.format_text_to_list(rxman, location, text_width, window_width);
 }
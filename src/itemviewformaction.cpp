@@ -14,6 +14,7 @@
 #include "itemutils.h"
 #include "htmlrenderer.h"
 #include "logger.h"
+#include "rendercache.h"
 #include "rssfeed.h"
 #include "scopemeasure.h"
 #include "strprintf.h"
@@ -23,6 +24,15 @@
 
 namespace newsboat {
 
+namespace {
+
+/// Articles with a longer body are shown with just the start of it first,
+/// while the rest of it is rendered in the background
+const std::size_t LARGE_BODY_SIZE = 256 * 1024;
+const std::size_t PREVIEW_BODY_SIZE = 64 * 1024;
+
+}
+
 ItemViewFormAction::ItemViewFormAction(View* vv,
 	std::shared_ptr<ItemListFormAction> il,
 	std::string formstr,
@@ -37,6 +47,7 @@ ItemViewFormAction::ItemViewFormAction(View* vv,
 	, in_search(false)
 	, rsscache(cc)
 	, textview("article", FormAction::f)
+	, prerenderer(*cfg, RenderCache::shared())
 {
 	valid_cmds.push_back("save");
 	std::sort(valid_cmds.begin(), valid_cmds.end());
@@ -49,6 +60,7 @@ void ItemViewFormAction::init()
 {
 	set_value("msg", "");
 	do_redraw = true;
+	rest_options = nonstd::nullopt;
 	textview.set_scroll_offset(0);
 	links.clear();
 	num_lines = 0;
@@ -66,6 +78,9 @@ void ItemViewFormAction::init()
 	}
 	set_keymap_hints();
 	item = feed->get_item_by_guid(guid);
+	if (item != nullptr) {
+		shown_items.push_back(item);
+	}
 }
 
 void ItemViewFormAction::update_head(const std::shared_ptr<RssItem>& item)
@@ -92,7 +107,19 @@ void ItemViewFormAction::prepare()
 	 * flags and podcast download URL (enclosures) and then render the
 	 * HTML. The links extracted by the renderer are then appended, too.
 	 */
+	if (!do_redraw && rest_options.has_value()) {
+		const auto rest = prerenderer.take_rendered(item, rest_options.value());
+		if (rest.has_value()) {
+			num_lines = rest.value().num_lines;
+			links = rest.value().links;
+			textview.stfl_replace_lines(num_lines, rest.value().text);
+			update_percent();
+			rest_options = nonstd::nullopt;
+		}
+	}
+
 	if (do_redraw) {
+		rest_options = nonstd::nullopt;
 		{
 			ScopeMeasure sm("itemview::prepare: rendering");
 			// XXX HACK: render once so that we get a proper widget width
@@ -112,6 +139,8 @@ void ItemViewFormAction::prepare()
 			}
 		}
 
+		const RenderCache::Options options{text_width, window_width,
+			cfg->get_configvalue("html-renderer"), rxman.revision()};
 		std::string formatted_text;
 		if (show_source) {
 			std::tie(formatted_text, num_lines) =
@@ -122,25 +151,33 @@ void ItemViewFormAction::prepare()
 					&rxman,
 					"article");
 		} else {
-			links.clear();
-			if (!item->enclosure_url().empty()) {
-				const auto link_type = utils::podcast_mime_to_link_type(item->enclosure_type());
-				if (link_type.has_value()) {
-					links.push_back(LinkPair(item->enclosure_url(), link_type.value()));
+			auto& render_cache = RenderCache::shared();
+			const auto rendered = render_cache.get(item, options);
+			if (rendered.has_value()) {
+				formatted_text = rendered.value().text;
+				num_lines = rendered.value().num_lines;
+				links = rendered.value().links;
+			} else {
+				// Views with search results highlighted aren't kept, so
+				// they're rendered in one go
+				const bool preview = options.renderer == "internal" && !in_search
+					&& item->description().text.size() > LARGE_BODY_SIZE;
+				// cfg can't be nullptr because that's a long-lived object
+				// created at the very start of the program.
+				const auto fresh = ArticlePrerenderer::render(*cfg, item, options,
+						&rxman, preview ? PREVIEW_BODY_SIZE : 0);
+				formatted_text = fresh.text;
+				num_lines = fresh.num_lines;
+				links = fresh.links;
+
+				if (preview) {
+					prerenderer.render_next(item, options, rxman);
+					rest_options = options;
+				} else if (!in_search) {
+					// The highlighted search results won't be asked for again
+					render_cache.put(item, options, fresh);
 				}
 			}
-
-			std::tie(formatted_text, num_lines) =
-				item_renderer::to_stfl_list(
-					// cfg can't be nullptr because that's a long-lived object
-					// created at the very start of the program.
-					*cfg,
-					item,
-					text_width,
-					window_width,
-					&rxman,
-					"article",
-					links);
 		}
 
 		textview.stfl_replace_lines(num_lines, formatted_text);
@@ -151,6 +188,14 @@ void ItemViewFormAction::prepare()
 			in_search = false;
 		}
 
+		if (!show_source) {
+			// Not the options from above: the search highlights are gone
+			const RenderCache::Options neighbour_options{text_width, window_width,
+				options.renderer, rxman.revision()};
+			prerenderer.prerender(itemlist->get_neighbour_items(), neighbour_options,
+				rxman);
+		}
+
 		do_redraw = false;
 	}
 }
@@ -327,7 +372,7 @@ bool ItemViewFormAction::process_operation(Operation op,
 		LOG(Level::INFO,
 			"ItemViewFormAction::process_operation: deleting current article");
 		item->set_deleted(true);
-		rsscache->mark_item_deleted(guid, true);
+		rsscache->mark_item_deleted(*item, true);
 	/* fall-through! */
 	case OP_NEXTUNREAD:
 		LOG(Level::INFO,
@@ -460,15 +505,15 @@ bool ItemViewFormAction::process_operation(Operation op,
 	}
 	break;
 	case OP_ARTICLEFEED: {
-		auto feeds = v->get_ctrl()->get_feedcontainer()->get_all_feeds();
+		const auto feeds = v->get_ctrl()->get_feedcontainer()->get_feeds_snapshot();
 		size_t pos;
 		auto article_feed = item->get_feedptr();
-		for (pos = 0; pos < feeds.size(); pos++) {
-			if (feeds[pos] == article_feed) {
+		for (pos = 0; pos < feeds->size(); pos++) {
+			if ((*feeds)[pos] == article_feed) {
 				break;
 			}
 		}
-		if (pos != feeds.size()) {
+		if (pos != feeds->size()) {
 			v->push_itemlist(pos);
 		}
 	}
@@ -487,7 +532,8 @@ bool ItemViewFormAction::process_operation(Operation op,
 		auto parent_itemlist = std::dynamic_pointer_cast<ItemListFormAction>
 			(get_parent_formaction());
 		if (parent_itemlist != nullptr) {
-			parent_itemlist->invalidate_list();
+			// Only the articles shown here might have been marked read
+			parent_itemlist->invalidate_items(shown_items);
 			parent_itemlist->restore_selected_position();
 		}
 	}
@@ -650,7 +696,7 @@ void ItemViewFormAction::update_percent()
 {
 	if (cfg->get_configvalue_as_bool("display-article-progress")) {
 		unsigned int percent = 0;
-		unsigned int offset = utils::to_u(f.get("article_offset"), 0);
+		unsigned int offset = textview.get_scroll_offset();
 
 		if (num_lines > 0) {
 			percent = (100 * (offset + 1)) / num_lines;
@@ -675,6 +721,13 @@ void ItemViewFormAction::update_percent()
 	}
 }
 
+unsigned int ItemViewFormAction::wait_time() const
+{
+	// Soon enough for the rest of the article to show up while the start
+	// of it is read
+	return rest_options.has_value() ? 100 : FormAction::wait_time();
+}
+
 std::string ItemViewFormAction::title()
 {
 	auto title = item->title();
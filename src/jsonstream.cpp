@@ -0,0 +1,185 @@
+#include "jsonstream.h"
+
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace newsboat {
+
+namespace {
+
+/// Builds the values it's given like nlohmann::json::parse() does, except
+/// for the elements of the array being streamed, which are each built on
+/// their own and handed out.
+class ArrayStreamer : public json::json_sax_t {
+public:
+	ArrayStreamer(const std::string& key,
+		const std::function<void(json&)>& on_element,
+		json& rest)
+		: target(key)
+		, on_element(on_element)
+		, rest(rest)
+		, at_target(false)
+		, streaming(false)
+	{
+	}
+
+	bool null() override
+	{
+		return add(nullptr);
+	}
+	bool boolean(bool val) override
+	{
+		return add(val);
+	}
+	bool number_integer(number_integer_t val) override
+	{
+		return add(val);
+	}
+	bool number_unsigned(number_unsigned_t val) override
+	{
+		return add(val);
+	}
+	bool number_float(number_float_t val, const string_t& /* s */) override
+	{
+		return add(val);
+	}
+	bool string(string_t& val) override
+	{
+		// The parser clears its buffer before the next token anyway
+		return add(std::move(val));
+	}
+	bool binary(binary_t& val) override
+	{
+		return add(json::binary(std::move(val)));
+	}
+
+	bool start_object(std::size_t /* elements */) override
+	{
+		return open(json::object());
+	}
+	bool key(string_t& val) override
+	{
+		at_target = in_top_level() && val == target;
+		pending_key = std::move(val);
+		return true;
+	}
+	bool end_object() override
+	{
+		return close();
+	}
+
+	bool start_array(std::size_t /* elements */) override
+	{
+		if (at_target) {
+			at_target = false;
+			streaming = true;
+			return true;
+		}
+		return open(json::array());
+	}
+	bool end_array() override
+	{
+		if (streaming && in_top_level()) {
+			streaming = false;
+			return true;
+		}
+		return close();
+	}
+
+	bool parse_error(std::size_t /* position */,
+		const std::string& /* last_token */,
+		const nlohmann::detail::exception& /* ex */) override
+	{
+		return false;
+	}
+
+private:
+	/// Whether the next value is one of the top-level object's.
+	bool in_top_level() const
+	{
+		return open_values.size() == 1 && open_values[0] == &rest;
+	}
+
+	/// Where the next value goes, or nullptr if it's a whole element of the
+	/// array being streamed.
+	json* place_value(json&& value)
+	{
+		at_target = false;
+		if (open_values.empty()) {
+			rest = std::move(value);
+			return &rest;
+		}
+		if (streaming && in_top_level()) {
+			element = std::move(value);
+			return &element;
+		}
+		json& parent = *open_values.back();
+		if (parent.is_object()) {
+			return &(parent[pending_key] = std::move(value));
+		}
+		parent.push_back(std::move(value));
+		return &parent.back();
+	}
+
+	template<typename T>
+	bool add(T&& value)
+	{
+		const bool whole_element = streaming && in_top_level();
+		place_value(json(std::forward<T>(value)));
+		if (whole_element) {
+			hand_out();
+		}
+		return true;
+	}
+
+	bool open(json&& container)
+	{
+		open_values.push_back(place_value(std::move(container)));
+		return true;
+	}
+
+	bool close()
+	{
+		open_values.pop_back();
+		if (streaming && in_top_level()) {
+			hand_out();
+		}
+		return true;
+	}
+
+	void hand_out()
+	{
+		on_element(element);
+		element = nullptr;
+	}
+
+	const std::string& target;
+	const std::function<void(json&)>& on_element;
+	json& rest;
+
+	/// The objects and arrays that are being read, innermost last. Only the
+	/// innermost one gets new values, so the pointers stay valid.
+	std::vector<json*> open_values;
+	std::string pending_key;
+	json element;
+	/// The value that comes next is the one under the target key.
+	bool at_target;
+	/// The target array is being read.
+	bool streaming;
+};
+
+} // namespace
+
+bool stream_json_array(const std::string& input,
+	const std::string& key,
+	const std::function<void(json& element)>& on_element,
+	json& rest)
+{
+	rest = nullptr;
+	ArrayStreamer streamer(key, on_element, rest);
+	return json::sax_parse(input, &streamer);
+}
+
+} // namespace newsboat
@@ -517,6 +517,7 @@ static const std::map<std::string, std::uint32_t> contexts = {
 };
 
 KeyMap::KeyMap(unsigned flags)
+	: dispatch_stale_(true)
 {
 	/*
 	 * At startup, initialize the keymap with the default settings from the
@@ -589,6 +590,7 @@ void KeyMap::set_key(Operation op,
 	const std::string& context)
 {
 	LOG(Level::DEBUG, "KeyMap::set_key(%d,%s) called", op, key);
+	dispatch_stale_ = true;
 	if (context == "all") {
 		for (const auto& ctx : contexts) {
 			keymap_[ctx.first][key] = op;
@@ -601,6 +603,7 @@ void KeyMap::set_key(Operation op,
 void KeyMap::unset_key(const std::string& key, const std::string& context)
 {
 	LOG(Level::DEBUG, "KeyMap::unset_key(%s) called", key);
+	dispatch_stale_ = true;
 	if (context == "all") {
 		for (const auto& ctx : contexts) {
 			keymap_[ctx.first][key] = OP_NIL;
@@ -613,6 +616,7 @@ void KeyMap::unset_key(const std::string& key, const std::string& context)
 void KeyMap::unset_all_keys(const std::string& context)
 {
 	LOG(Level::DEBUG, "KeyMap::unset_all_keys(%s) called", context);
+	dispatch_stale_ = true;
 	auto internal_ops_only = get_internal_operations();
 	if (context == "all") {
 		for (const auto& ctx : contexts) {
@@ -651,17 +655,49 @@ char KeyMap::get_key(const std::string& keycode)
 Operation KeyMap::get_operation(const std::string& keycode,
 	const std::string& context)
 {
-	std::string key;
 	LOG(Level::DEBUG,
 		"KeyMap::get_operation: keycode = %s context = %s",
 		keycode,
 		context);
-	if (keycode.length() > 0) {
-		key = keycode;
-	} else {
-		key = "NIL";
+	compile_if_needed();
+
+	const auto dispatch = dispatch_.find(context);
+	if (dispatch == dispatch_.end()) {
+		return OP_NIL;
+	}
+	if (keycode.length() == 1
+		&& static_cast<unsigned char>(keycode[0]) < dispatch->second.ascii.size()) {
+		return dispatch->second.ascii[static_cast<unsigned char>(keycode[0])];
+	}
+	const auto& named = dispatch->second.named;
+	const auto op = named.find(keycode.empty() ? "NIL" : keycode);
+	if (op == named.end()) {
+		return OP_NIL;
+	}
+	return op->second;
+}
+
+void KeyMap::compile_if_needed()
+{
+	if (!dispatch_stale_) {
+		return;
+	}
+
+	dispatch_.clear();
+	for (const auto& context : keymap_) {
+		Dispatch& dispatch = dispatch_[context.first];
+		dispatch.ascii.fill(OP_NIL);
+		for (const auto& binding : context.second) {
+			const std::string& key = binding.first;
+			if (key.length() == 1
+				&& static_cast<unsigned char>(key[0]) < dispatch.ascii.size()) {
+				dispatch.ascii[static_cast<unsigned char>(key[0])] = binding.second;
+			} else {
+				dispatch.named[key] = binding.second;
+			}
+		}
 	}
-	return keymap_[context][key];
+	dispatch_stale_ = false;
 }
 
 void KeyMap::dump_config(std::vector<std::string>& config_output) const
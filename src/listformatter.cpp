@@ -4,13 +4,13 @@
 #include <limits.h>
 
 #include "stflpp.h"
-#include "strprintf.h"
 #include "utils.h"
 
 namespace newsboat {
 
 ListFormatter::ListFormatter(RegexManager* r, const std::string& loc)
-	: rxman(r)
+	: formatted_revision(0)
+	, rxman(r)
 	, location(loc)
 {}
 
@@ -27,30 +27,47 @@ void ListFormatter::set_line(const unsigned int itempos,
 {
 	std::vector<std::string> formatted_text;
 
-	formatted_text.push_back(utils::wstr2str(utils::clean_nonprintable_characters(
-				utils::str2wstr(text))));
+	formatted_text.push_back(utils::clean_nonprintable_characters(text));
 
 	if (itempos == UINT_MAX) {
 		lines.insert(lines.cend(),
 			formatted_text.cbegin(),
 			formatted_text.cend());
+		formatted.resize(lines.size());
 	} else {
 		lines[itempos] = formatted_text[0];
+		formatted[itempos].clear();
 	}
 }
 
 std::string ListFormatter::format_list() const
 {
 	std::string format_cache = "{list";
-	for (auto str : lines) {
+	for (unsigned int i = 0; i < lines.size(); ++i) {
+		format_cache.append("{listitem text:");
+		format_cache.append(format_line(i));
+		format_cache.push_back('}');
+	}
+	format_cache.push_back('}');
+	return format_cache;
+}
+
+const std::string& ListFormatter::format_line(unsigned int i) const
+{
+	const std::uint64_t revision = rxman ? rxman->revision() : 0;
+	if (revision != formatted_revision) {
+		formatted.assign(lines.size(), std::string());
+		formatted_revision = revision;
+	}
+	if (formatted[i].empty()) {
+		std::string str = lines[i];
 		if (rxman) {
 			rxman->quote_and_highlight(str, location);
 		}
-		format_cache.append(strprintf::fmt(
-				"{listitem text:%s}", Stfl::quote(str)));
+		// Never empty, since quoting adds the quotes
+		formatted[i] = Stfl::quote(str);
 	}
-	format_cache.push_back('}');
-	return format_cache;
+	return formatted[i];
 }
 
 } // namespace newsboat
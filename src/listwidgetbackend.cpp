@@ -1,5 +1,8 @@
 #include "listwidgetbackend.h"
 
+#include <algorithm>
+
+#include "runtimestats.h"
 #include "utils.h"
 
 namespace newsboat {
@@ -8,25 +11,129 @@ ListWidgetBackend::ListWidgetBackend(const std::string& list_name, Stfl::Form& f
 	: list_name(list_name)
 	, form(form)
 	, num_lines(0)
+	, window_start(0)
+	, window_size(0)
+	, position(0)
+	, scroll_offset(0)
+	, list_bytes(0)
+	, rows_shown(false)
+{
+}
+
+ListWidgetBackend::~ListWidgetBackend()
+{
+	RuntimeStats::add(RuntimeStats::Counter::LIST_LINE_BYTES,
+		-static_cast<std::int64_t>(list_bytes));
+}
+
+void ListWidgetBackend::replace(const std::string& mode,
+	const std::string& stfl)
 {
+	form.modify(list_name, mode, stfl);
+	RuntimeStats::add(RuntimeStats::Counter::LIST_LINE_BYTES,
+		static_cast<std::int64_t>(stfl.size())
+		- static_cast<std::int64_t>(list_bytes));
+	list_bytes = stfl.size();
 }
 
 void ListWidgetBackend::stfl_replace_list(std::uint32_t number_of_lines, std::string stfl)
 {
 	num_lines = number_of_lines;
-	form.modify(list_name, "replace", stfl);
+	window_start = 0;
+	window_size = number_of_lines;
+	rows.clear();
+	rows_shown = false;
+	replace("replace", stfl);
 
 	on_list_changed();
 }
 
 void ListWidgetBackend::stfl_replace_lines(const ListFormatter& listfmt)
 {
+	const bool window_moved = window_start != 0;
 	num_lines = listfmt.get_lines_count();
-	form.modify(list_name, "replace_inner", listfmt.format_list());
+	window_start = 0;
+	window_size = num_lines;
+	replace_rows(listfmt, !window_moved);
+	if (window_moved) {
+		update_position(position, scroll_offset);
+	}
 
 	on_list_changed();
 }
 
+void ListWidgetBackend::stfl_replace_window(const ListFormatter& listfmt,
+	std::uint32_t first_line, std::uint32_t total_lines)
+{
+	const bool same_place = first_line == window_start;
+	num_lines = total_lines;
+	window_start = first_line;
+	window_size = listfmt.get_lines_count();
+	replace_rows(listfmt, same_place);
+	// The window has moved under the cursor
+	update_position(position, scroll_offset);
+
+	on_list_changed();
+}
+
+void ListWidgetBackend::replace_rows(const ListFormatter& listfmt,
+	bool same_place)
+{
+	const std::size_t count = listfmt.get_lines_count();
+	if (same_place && rows_shown && count == rows.size()) {
+		std::vector<std::size_t> damaged;
+		for (std::size_t i = 0; i < count; ++i) {
+			if (listfmt.format_line(i) != rows[i]) {
+				damaged.push_back(i);
+			}
+		}
+		// Past that, STFL is quicker at taking the whole list at once
+		if (damaged.size() * 2 <= count) {
+			for (const auto i : damaged) {
+				rows[i] = listfmt.format_line(i);
+				form.modify(row_name(i), "replace",
+					"{listitem[" + row_name(i) + "] text:" + rows[i] + "}");
+			}
+			return;
+		}
+	}
+
+	rows.resize(count);
+	std::string stfl = "{list";
+	for (std::size_t i = 0; i < count; ++i) {
+		rows[i] = listfmt.format_line(i);
+		stfl.append("{listitem[" + row_name(i) + "] text:");
+		stfl.append(rows[i]);
+		stfl.push_back('}');
+	}
+	stfl.push_back('}');
+	replace("replace_inner", stfl);
+	rows_shown = true;
+}
+
+std::string ListWidgetBackend::row_name(std::size_t i) const
+{
+	return list_name + "_row" + std::to_string(i);
+}
+
+std::uint32_t ListWidgetBackend::get_window_start()
+{
+	return window_start;
+}
+
+std::uint32_t ListWidgetBackend::get_window_size()
+{
+	return window_size;
+}
+
+bool ListWidgetBackend::window_covers_viewport()
+{
+	const std::uint32_t viewport_end = std::min(scroll_offset + get_height(),
+			num_lines);
+	return scroll_offset >= window_start
+		&& viewport_end <= window_start + window_size;
+}
+
 std::uint32_t ListWidgetBackend::get_width()
 {
 	return utils::to_u(form.get(list_name + ":w"));
@@ -42,10 +149,18 @@ std::uint32_t ListWidgetBackend::get_num_lines()
 	return num_lines;
 }
 
-void ListWidgetBackend::update_position(std::uint32_t pos, std::uint32_t scroll_offset)
+void ListWidgetBackend::update_position(std::uint32_t pos,
+	std::uint32_t scroll_offset)
 {
-	form.set(list_name + "_pos", std::to_string(pos));
-	form.set(list_name + "_offset", std::to_string(scroll_offset));
+	position = pos;
+	this->scroll_offset = scroll_offset;
+	// Lines before the window aren't known to STFL. If the cursor has left
+	// the window, the window gets replaced before the list is drawn again
+	const std::uint32_t stfl_pos = pos > window_start ? pos - window_start : 0;
+	const std::uint32_t stfl_offset = scroll_offset > window_start
+		? scroll_offset - window_start : 0;
+	form.set(list_name + "_pos", std::to_string(stfl_pos));
+	form.set(list_name + "_offset", std::to_string(stfl_offset));
 }
 
 } // namespace newsboat
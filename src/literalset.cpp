@@ -0,0 +1,96 @@
+#include "literalset.h"
+
+#include <cstring>
+#include <queue>
+
+namespace newsboat {
+
+namespace {
+
+unsigned char fold_case(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+}
+
+LiteralSet::LiteralSet(const std::vector<std::string>& literals)
+{
+	Node root;
+	root.next.fill(-1);
+	root.fail = 0;
+	nodes.push_back(root);
+
+	for (std::size_t i = 0; i < literals.size(); ++i) {
+		int state = 0;
+		for (const auto c : literals[i]) {
+			const auto symbol = fold_case(c);
+			if (nodes[state].next[symbol] < 0) {
+				Node node;
+				node.next.fill(-1);
+				node.fail = 0;
+				nodes.push_back(node);
+				nodes[state].next[symbol] = nodes.size() - 1;
+			}
+			state = nodes[state].next[symbol];
+		}
+		nodes[state].outputs.push_back(i);
+		lengths.push_back(literals[i].length());
+	}
+
+	// Turn the trie into a complete automaton, breadth first so that the
+	// fail state of every node is done before the node itself
+	std::queue<int> pending;
+	for (auto& next : nodes[0].next) {
+		if (next < 0) {
+			next = 0;
+		} else {
+			pending.push(next);
+		}
+	}
+	while (!pending.empty()) {
+		const int state = pending.front();
+		pending.pop();
+		const int fail = nodes[state].fail;
+		nodes[state].outputs.insert(nodes[state].outputs.end(),
+			nodes[fail].outputs.begin(), nodes[fail].outputs.end());
+		for (std::size_t symbol = 0; symbol < 256; ++symbol) {
+			const int next = nodes[state].next[symbol];
+			if (next < 0) {
+				nodes[state].next[symbol] = nodes[fail].next[symbol];
+			} else {
+				nodes[next].fail = nodes[fail].next[symbol];
+				pending.push(next);
+			}
+		}
+	}
+}
+
+std::vector<LiteralSet::Match> LiteralSet::find_all(const std::string& text)
+const
+{
+	std::vector<Match> result;
+	int state = 0;
+	for (std::size_t i = 0; i < text.length(); ++i) {
+		state = nodes[state].next[fold_case(text[i])];
+		for (const auto literal : nodes[state].outputs) {
+			result.push_back({literal, i + 1 - lengths[literal], i + 1});
+		}
+	}
+	return result;
+}
+
+bool LiteralSet::is_literal(const std::string& pattern)
+{
+	if (pattern.empty()) {
+		return false;
+	}
+	for (const auto c : pattern) {
+		if (c < ' ' || c > '~' || std::strchr(".[]()*+?{}|^$\\", c) != nullptr) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace newsboat
@@ -0,0 +1,64 @@
+#include "logger.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace newsboat {
+
+namespace logger {
+
+namespace {
+
+std::mutex modules_mtx;
+
+std::map<std::string, std::unique_ptr<std::atomic<std::int64_t>>>& modules()
+{
+	// Never destroyed, since LOG() calls keep references into it until the
+	// very end
+	static auto modules =
+		new std::map<std::string, std::unique_ptr<std::atomic<std::int64_t>>>();
+	return *modules;
+}
+
+std::atomic<std::int64_t>& module_unlocked(const std::string& module)
+{
+	auto& level = modules()[module];
+	if (!level) {
+		level.reset(new std::atomic<std::int64_t>(GLOBAL_LOGLEVEL));
+	}
+	return *level;
+}
+
+std::string module_name(const char* file)
+{
+	const char* basename = std::strrchr(file, '/');
+	std::string name = basename != nullptr ? basename + 1 : file;
+	return name.substr(0, name.find('.'));
+}
+
+}
+
+std::atomic<std::int64_t>& module_loglevel(const char* file)
+{
+	const std::string module = module_name(file);
+	std::lock_guard<std::mutex> guard(modules_mtx);
+	return module_unlocked(module);
+}
+
+void set_module_loglevel(const std::string& module, Level level)
+{
+	std::lock_guard<std::mutex> guard(modules_mtx);
+	module_unlocked(module).store(static_cast<std::int64_t>(level));
+}
+
+void unset_module_loglevel(const std::string& module)
+{
+	std::lock_guard<std::mutex> guard(modules_mtx);
+	module_unlocked(module).store(GLOBAL_LOGLEVEL);
+}
+
+} // namespace logger
+
+} // namespace newsboat
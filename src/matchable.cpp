@@ -0,0 +1,38 @@
+#include "matchable.h"
+
+#include <unordered_map>
+
+namespace newsboat {
+
+MatchableAttribute Matchable::attribute_id(const std::string& attr)
+{
+	static const std::unordered_map<std::string, MatchableAttribute> ids = {
+		{"title", MatchableAttribute::TITLE},
+		{"link", MatchableAttribute::LINK},
+		{"author", MatchableAttribute::AUTHOR},
+		{"content", MatchableAttribute::CONTENT},
+		{"date", MatchableAttribute::DATE},
+		{"guid", MatchableAttribute::GUID},
+		{"unread", MatchableAttribute::UNREAD},
+		{"enclosure_url", MatchableAttribute::ENCLOSURE_URL},
+		{"enclosure_type", MatchableAttribute::ENCLOSURE_TYPE},
+		{"flags", MatchableAttribute::FLAGS},
+		{"age", MatchableAttribute::AGE},
+		{"articleindex", MatchableAttribute::ARTICLEINDEX},
+
+		{"feedtitle", MatchableAttribute::FEEDTITLE},
+		{"description", MatchableAttribute::DESCRIPTION},
+		{"feedlink", MatchableAttribute::FEEDLINK},
+		{"feeddate", MatchableAttribute::FEEDDATE},
+		{"rssurl", MatchableAttribute::RSSURL},
+		{"unread_count", MatchableAttribute::UNREAD_COUNT},
+		{"total_count", MatchableAttribute::TOTAL_COUNT},
+		{"tags", MatchableAttribute::TAGS},
+		{"feedindex", MatchableAttribute::FEEDINDEX},
+	};
+
+	const auto id = ids.find(attr);
+	return id != ids.end() ? id->second : MatchableAttribute::UNKNOWN;
+}
+
+} // namespace newsboat
@@ -1,20 +1,179 @@
 #include "matcher.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cinttypes>
 #include <ctime>
+#include <exception>
+#include <limits>
+#include <mutex>
 #include <regex.h>
 #include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "executor.h"
 #include "logger.h"
 #include "matchable.h"
 #include "matcherexception.h"
+#include "regexowner.h"
+#include "runtimestats.h"
 #include "scopemeasure.h"
+#include "scopestats.h"
 #include "utils.h"
 
 namespace newsboat {
 
+namespace {
+
+/// Batches smaller than this are matched on the calling thread, since
+/// starting threads would take longer.
+const std::size_t PARALLEL_BATCH_SIZE = 4096;
+/// The fewest items in a chunk of a parallel batch, and the most threads
+/// that work on one.
+const std::size_t MIN_CHUNK_SIZE = 512;
+const unsigned int MAX_MATCHER_THREADS = 8;
+
+unsigned int batch_threads(std::size_t items)
+{
+	if (items < PARALLEL_BATCH_SIZE) {
+		return 1;
+	}
+	const unsigned int cores = std::thread::hardware_concurrency();
+	return std::max(1u, std::min(cores, MAX_MATCHER_THREADS));
+}
+
+/// A rough guess of what reading attribute \a id costs, relative to the
+/// other attributes.
+unsigned int attribute_cost(MatchableAttribute id)
+{
+	switch (id) {
+	case MatchableAttribute::UNREAD:
+	case MatchableAttribute::FLAGS:
+	case MatchableAttribute::AGE:
+	case MatchableAttribute::DATE:
+	case MatchableAttribute::ARTICLEINDEX:
+	case MatchableAttribute::FEEDINDEX:
+	case MatchableAttribute::FEEDDATE:
+		return 1;
+	case MatchableAttribute::UNREAD_COUNT:
+	case MatchableAttribute::TOTAL_COUNT:
+		// Go through all the items of the feed
+		return 4;
+	case MatchableAttribute::CONTENT:
+		// Might have to be read from the cache
+		return 16;
+	default:
+		return 2;
+	}
+}
+
+/// The same guess for comparing an attribute using \a op.
+unsigned int operator_cost(int op)
+{
+	switch (op) {
+	case MATCHOP_RXEQ:
+	case MATCHOP_RXNE:
+		return 3;
+	case MATCHOP_CONTAINS:
+	case MATCHOP_CONTAINSNOT:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+/// \a text as an SQL string literal
+std::string sql_quote(const std::string& text)
+{
+	std::string result = "'";
+	for (const auto c : text) {
+		if (c == '\'') {
+			result += "''";
+		} else {
+			result += c;
+		}
+	}
+	return result + "'";
+}
+
+/// The `rss_item` column that holds string attribute \a id, if there is
+/// one that holds exactly what RssItem returns for it. Older rows may have
+/// NULL in the columns that were added later; RssItem reads those as empty.
+const char* sql_column(MatchableAttribute id)
+{
+	switch (id) {
+	case MatchableAttribute::FLAGS:
+		return "IFNULL(rss_item.flags, '')";
+	case MatchableAttribute::GUID:
+		return "rss_item.guid";
+	case MatchableAttribute::LINK:
+		return "rss_item.url";
+	case MatchableAttribute::ENCLOSURE_URL:
+		return "IFNULL(rss_item.enclosure_url, '')";
+	case MatchableAttribute::ENCLOSURE_TYPE:
+		return "IFNULL(rss_item.enclosure_type, '')";
+	default:
+		return nullptr;
+	}
+}
+
+/// Wraps a Matchable and remembers the attributes it was asked for, so that
+/// several expressions matched against it read each of them only once.
+class MemoizedMatchable : public Matchable {
+public:
+	explicit MemoizedMatchable(const Matchable& item)
+		: item(item)
+	{
+	}
+
+	nonstd::optional<std::string> attribute_value(const std::string& attr)
+	const override
+	{
+		return item.attribute_value(attr);
+	}
+
+	nonstd::optional<std::string> attribute_value_by_id(MatchableAttribute id,
+		const std::string& attr) const override
+	{
+		if (id == MatchableAttribute::UNKNOWN) {
+			return item.attribute_value_by_id(id, attr);
+		}
+		auto& value = values[static_cast<std::size_t>(id)];
+		if (!value.has_value()) {
+			value = item.attribute_value_by_id(id, attr);
+		}
+		return value.value();
+	}
+
+	/// Every expression is matched with the same \a now, so the numbers
+	/// don't depend on which one asked first.
+	nonstd::optional<std::int64_t> attribute_number_by_id(MatchableAttribute id,
+		std::time_t now) const override
+	{
+		auto& number = numbers[static_cast<std::size_t>(id)];
+		if (!number.has_value()) {
+			number = item.attribute_number_by_id(id, now);
+		}
+		return number.value();
+	}
+
+private:
+	static const std::size_t ATTRIBUTE_COUNT =
+		static_cast<std::size_t>(MatchableAttribute::FEEDINDEX) + 1;
+
+	const Matchable& item;
+	mutable std::array<nonstd::optional<nonstd::optional<std::string>>,
+		ATTRIBUTE_COUNT> values;
+	mutable std::array<nonstd::optional<nonstd::optional<std::int64_t>>,
+		ATTRIBUTE_COUNT> numbers;
+};
+
+}
+
 Matcher::Matcher() {}
 
 Matcher::Matcher(const std::string& expr)
@@ -38,6 +197,8 @@ bool Matcher::parse(const std::string& expr)
 
 	if (b) {
 		exp = expr;
+		order_by_cost(p.get_root());
+		parse_numbers_r(p.get_root());
 	} else {
 		errmsg = utils::wstr2str(p.get_error());
 	}
@@ -60,7 +221,9 @@ bool Matcher::matches(Matchable* item)
 	 * This makes it easy to use the Matcher virtually everywhere, since C++
 	 * allows multiple inheritance (i.e. deriving from Matchable can even be
 	 * used in class hierarchies), and deriving from Matchable means that
-	 * you only have to implement the method attribute_value().
+	 * you only have to implement the method attribute_value(). Classes that
+	 * know the ids of their attributes can also override
+	 * attribute_value_by_id() to skip looking them up by name.
 	 *
 	 * The whole matching code is speed-critical, as the matching happens on
 	 * a lot of different occassions, and slow matching can be easily
@@ -69,98 +232,333 @@ bool Matcher::matches(Matchable* item)
 	 */
 	bool retval = false;
 	if (item) {
-		ScopeMeasure m1("Matcher::matches");
-		retval = matches_r(p.get_root(), item);
+		SCOPE_STATS("Matcher::matches");
+		RuntimeStats::add(RuntimeStats::Counter::MATCHER_EVALUATIONS);
+		retval = matches_r(p.get_root(), item, time(nullptr));
 	}
 	return retval;
 }
 
-std::string get_attr_or_throw(Matchable* item, const std::string& attr_name)
+unsigned int Matcher::order_by_cost(expression* e)
 {
-	const auto attr = item->attribute_value(attr_name);
+	if (e == nullptr) {
+		return 0;
+	}
 
-	if (!attr.has_value()) {
-		LOG(Level::WARN,
-			"Matcher::matches: attribute %s is not available",
-			attr_name);
-		throw MatcherException(MatcherException::Type::ATTRIB_UNAVAIL, attr_name);
+	if (e->op == LOGOP_AND || e->op == LOGOP_OR) {
+		const auto left = order_by_cost(e->l);
+		const auto right = order_by_cost(e->r);
+		// Both operators are commutative, and evaluated lazily from the left
+		if (right < left) {
+			std::swap(e->l, e->r);
+		}
+		return left + right;
 	}
 
-	return attr.value();
+	if (e->attribute < 0) {
+		e->attribute = static_cast<int>(Matchable::attribute_id(e->name));
+	}
+	return attribute_cost(static_cast<MatchableAttribute>(e->attribute))
+		* operator_cost(e->op);
 }
 
-bool Matcher::matchop_lt(expression* e, Matchable* item)
+void Matcher::parse_numbers_r(expression* e)
 {
-	const int ilit = string_to_num(e->literal);
+	if (e == nullptr) {
+		return;
+	}
 
-	const auto attr = get_attr_or_throw(item, e->name);
-	const int iatt = string_to_num(attr);
+	switch (e->op) {
+	case LOGOP_AND:
+	case LOGOP_OR:
+		parse_numbers_r(e->l);
+		parse_numbers_r(e->r);
+		break;
+	case MATCHOP_LT:
+	case MATCHOP_GT:
+	case MATCHOP_LE:
+	case MATCHOP_GE:
+		e->number = string_to_num(e->literal);
+		break;
+	case MATCHOP_BETWEEN: {
+		const std::vector<std::string> lit = utils::tokenize(e->literal, ":");
+		e->has_range = lit.size() >= 2;
+		if (e->has_range) {
+			e->number = string_to_num(lit[0]);
+			e->upper = string_to_num(lit[1]);
+			if (e->number > e->upper) {
+				std::swap(e->number, e->upper);
+			}
+		}
+		break;
+	}
+	}
+}
+
+std::vector<bool> Matcher::matches(const std::vector<Matchable*>& items,
+	const std::atomic<bool>* cancel)
+{
+	ScopeMeasure m1("Matcher::matches (batch)");
+
+	expression* root = p.get_root();
+	// Every item's `age` is counted up to the same time
+	const time_t now = time(nullptr);
+	std::vector<bool> result;
+	const auto threads = batch_threads(items.size());
+	if (threads > 1 && compile_regexes_r(root)) {
+		result = matches_parallel(items, now, threads, cancel);
+	} else {
+		result.reserve(items.size());
+		for (const auto item : items) {
+			if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+				result.resize(items.size(), false);
+				break;
+			}
+			result.push_back(item != nullptr && matches_r(root, item, now));
+		}
+	}
+
+	LOG(Level::DEBUG,
+		"Matcher::matches: matched %" PRIu64 " item(s) against `%s'",
+		static_cast<uint64_t>(items.size()),
+		exp);
 
-	return iatt < ilit;
+	return result;
 }
 
-bool Matcher::matchop_between(expression* e, Matchable* item)
+std::vector<std::vector<bool>> Matcher::matches_all(
+	const std::vector<Matcher*>& matchers,
+	const std::vector<Matchable*>& items,
+	std::vector<std::exception_ptr>& errors)
 {
-	const auto attr = get_attr_or_throw(item, e->name);
-	const int att = string_to_num(attr);
+	ScopeMeasure m1("Matcher::matches_all");
+
+	const time_t now = time(nullptr);
+	// Bytes rather than bits, so that the chunks don't write to the same
+	// words
+	std::vector<std::vector<char>> matched(matchers.size(),
+		std::vector<char>(items.size(), 0));
+	errors.assign(matchers.size(), nullptr);
+	std::mutex error_mutex;
+	// Written only while error_mutex is held, and read without it just to
+	// skip the matchers that already failed
+	std::vector<std::atomic<bool>> failed(matchers.size());
+	for (auto& flag : failed) {
+		flag = false;
+	}
 
-	const std::vector<std::string> lit = utils::tokenize(e->literal, ":");
-	if (lit.size() < 2) {
-		return false;
+	bool regexes_compiled = true;
+	for (const auto matcher : matchers) {
+		regexes_compiled = compile_regexes_r(matcher->p.get_root())
+			&& regexes_compiled;
+	}
+
+	const auto match_chunk = [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			if (items[i] == nullptr) {
+				continue;
+			}
+			MemoizedMatchable item(*items[i]);
+			for (std::size_t m = 0; m < matchers.size(); ++m) {
+				if (failed[m].load(std::memory_order_relaxed)) {
+					continue;
+				}
+				try {
+					matched[m][i] = matchers[m]->matches_r(
+							matchers[m]->p.get_root(), &item, now);
+				} catch (const MatcherException&) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!failed[m]) {
+						failed[m] = true;
+						errors[m] = std::current_exception();
+					}
+				}
+			}
+		}
+	};
+
+	const auto threads = regexes_compiled ? batch_threads(items.size()) : 1;
+	if (threads > 1) {
+		const std::size_t chunk_size = std::max(MIN_CHUNK_SIZE,
+				items.size() / (4 * threads));
+		std::atomic<std::size_t> next_chunk(0);
+		Executor::instance().run_workers(Executor::Pool::CPU,
+			Executor::Priority::NORMAL, threads, [&]() {
+			for (std::size_t begin = next_chunk.fetch_add(chunk_size);
+				begin < items.size(); begin = next_chunk.fetch_add(chunk_size)) {
+				match_chunk(begin, std::min(items.size(), begin + chunk_size));
+			}
+		});
+	} else {
+		match_chunk(0, items.size());
+	}
+
+	std::vector<std::vector<bool>> result;
+	result.reserve(matchers.size());
+	for (std::size_t m = 0; m < matchers.size(); ++m) {
+		if (errors[m]) {
+			result.emplace_back(items.size(), false);
+		} else {
+			result.emplace_back(matched[m].begin(), matched[m].end());
+		}
+	}
+
+	LOG(Level::DEBUG,
+		"Matcher::matches_all: matched %" PRIu64 " item(s) against %" PRIu64
+		" expression(s)",
+		static_cast<uint64_t>(items.size()),
+		static_cast<uint64_t>(matchers.size()));
+
+	return result;
+}
+
+bool Matcher::compile_regexes_r(expression* e)
+{
+	if (e == nullptr) {
+		return true;
 	}
+	if (e->op == LOGOP_AND || e->op == LOGOP_OR) {
+		return compile_regexes_r(e->l) && compile_regexes_r(e->r);
+	}
+	if (e->op != MATCHOP_RXEQ && e->op != MATCHOP_RXNE) {
+		return true;
+	}
+	if (!e->regex) {
+		std::string error;
+		e->regex = Regex::compile_shared(e->literal,
+				REG_EXTENDED | REG_ICASE | REG_NOSUB, error);
+	}
+	return e->regex != nullptr;
+}
+
+std::vector<bool> Matcher::matches_parallel(
+	const std::vector<Matchable*>& items,
+	time_t now, unsigned int threads, const std::atomic<bool>* cancel)
+{
+	expression* root = p.get_root();
+	// Bytes rather than bits, so that the chunks don't write to the same
+	// words; each chunk writes its own, which keeps them in order
+	std::vector<char> matched(items.size(), 0);
+	// The first item that threw, and what it threw; the chunks after it
+	// don't need to be matched
+	std::mutex error_mutex;
+	std::atomic<std::size_t> error_pos(items.size());
+	std::exception_ptr error;
+
+	const std::size_t chunk_size = std::max(MIN_CHUNK_SIZE,
+			items.size() / (4 * threads));
+	const auto match_chunk = [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			if (i > error_pos.load(std::memory_order_relaxed) ||
+				(cancel != nullptr && cancel->load(std::memory_order_relaxed))) {
+				return;
+			}
+			try {
+				matched[i] = items[i] != nullptr
+					&& matches_r(root, items[i], now);
+			} catch (const MatcherException&) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (i < error_pos) {
+					error_pos = i;
+					error = std::current_exception();
+				}
+				return;
+			}
+		}
+	};
+	// The chunks are handed out in order, so every chunk before the first
+	// item that throws is matched
+	std::atomic<std::size_t> next_chunk(0);
+	Executor::instance().run_workers(Executor::Pool::CPU,
+		Executor::Priority::NORMAL, threads, [&]() {
+		for (std::size_t begin = next_chunk.fetch_add(chunk_size);
+			begin < items.size(); begin = next_chunk.fetch_add(chunk_size)) {
+			match_chunk(begin, std::min(items.size(), begin + chunk_size));
+		}
+	});
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return std::vector<bool>(matched.begin(), matched.end());
+}
+
+std::string get_attr_or_throw(Matchable* item, expression* e)
+{
+	if (e->attribute < 0) {
+		e->attribute = static_cast<int>(Matchable::attribute_id(e->name));
+	}
+	const auto attr = item->attribute_value_by_id(
+			static_cast<MatchableAttribute>(e->attribute), e->name);
+
+	if (!attr.has_value()) {
+		LOG(Level::WARN,
+			"Matcher::matches: attribute %s is not available",
+			e->name);
+		throw MatcherException(MatcherException::Type::ATTRIB_UNAVAIL, e->name);
+	}
+
+	return attr.value();
+}
 
-	int i1 = string_to_num(lit[0]);
-	int i2 = string_to_num(lit[1]);
-	if (i1 > i2) {
-		std::swap(i1, i2);
+/// The attribute as a number, the way string_to_num() would parse it if it
+/// were a string.
+int get_number_or_throw(Matchable* item, expression* e, time_t now)
+{
+	if (e->attribute < 0) {
+		e->attribute = static_cast<int>(Matchable::attribute_id(e->name));
+	}
+	const auto number = item->attribute_number_by_id(
+			static_cast<MatchableAttribute>(e->attribute), now);
+	if (!number.has_value()) {
+		return Matcher::string_to_num(get_attr_or_throw(item, e));
 	}
 
-	return (att >= i1 && att <= i2);
+	if (number.value() < std::numeric_limits<int>::min()) {
+		return std::numeric_limits<int>::min();
+	} else if (number.value() > std::numeric_limits<int>::max()) {
+		return std::numeric_limits<int>::max();
+	}
+	return static_cast<int>(number.value());
 }
 
-bool Matcher::matchop_gt(expression* e, Matchable* item)
+bool Matcher::matchop_lt(expression* e, Matchable* item, time_t now)
 {
-	const auto attr = get_attr_or_throw(item, e->name);
-	const int iatt = string_to_num(attr);
+	return get_number_or_throw(item, e, now) < e->number;
+}
 
-	const int ilit = string_to_num(e->literal);
+bool Matcher::matchop_between(expression* e, Matchable* item, time_t now)
+{
+	const int att = get_number_or_throw(item, e, now);
+	return e->has_range && att >= e->number && att <= e->upper;
+}
 
-	return iatt > ilit;
+bool Matcher::matchop_gt(expression* e, Matchable* item, time_t now)
+{
+	return get_number_or_throw(item, e, now) > e->number;
 }
 
 bool Matcher::matchop_rxeq(expression* e, Matchable* item)
 {
-	const auto attr = get_attr_or_throw(item, e->name);
+	const auto attr = get_attr_or_throw(item, e);
 
 	if (!e->regex) {
-		e->regex = new regex_t;
-		int err;
-		if ((err = regcomp(e->regex,
-						e->literal.c_str(),
-						REG_EXTENDED | REG_ICASE | REG_NOSUB)) != 0) {
-			delete e->regex;
-			e->regex = nullptr;
-			char buf[1024];
-			regerror(err, e->regex, buf, sizeof(buf));
+		std::string error;
+		e->regex = Regex::compile_shared(e->literal,
+				REG_EXTENDED | REG_ICASE | REG_NOSUB, error);
+		if (!e->regex) {
 			throw MatcherException(
 				MatcherException::Type::INVALID_REGEX,
 				e->literal,
-				buf);
+				error);
 		}
 	}
-	if (regexec(e->regex,
-			attr.c_str(),
-			0,
-			nullptr,
-			0) == 0) {
-		return true;
-	}
-	return false;
+	return e->regex->is_match(attr);
 }
 
 bool Matcher::matchop_cont(expression* e, Matchable* item)
 {
-	const auto attr = get_attr_or_throw(item, e->name);
+	const auto attr = get_attr_or_throw(item, e);
 
 	const std::vector<std::string> elements = utils::tokenize(attr, " ");
 	const std::string literal = e->literal;
@@ -174,12 +572,12 @@ bool Matcher::matchop_cont(expression* e, Matchable* item)
 
 bool Matcher::matchop_eq(expression* e, Matchable* item)
 {
-	const auto attr = get_attr_or_throw(item, e->name);
+	const auto attr = get_attr_or_throw(item, e);
 
 	return (attr == e->literal);
 }
 
-bool Matcher::matches_r(expression* e, Matchable* item)
+bool Matcher::matches_r(expression* e, Matchable* item, time_t now)
 {
 	if (e) {
 		switch (e->op) {
@@ -187,12 +585,12 @@ bool Matcher::matches_r(expression* e, Matchable* item)
 		 * subexpressions */
 		case LOGOP_AND:
 			// short-circuit evaluation in C -> short circuit evaluation in the filter language
-			return matches_r(e->l, item) &&
-				matches_r(e->r, item);
+			return matches_r(e->l, item, now) &&
+				matches_r(e->r, item, now);
 
 		case LOGOP_OR:
-			return matches_r(e->l, item) ||
-				matches_r(e->r, item); // same here
+			return matches_r(e->l, item, now) ||
+				matches_r(e->r, item, now); // same here
 
 		/* while the other operator connect an attribute with a value */
 		case MATCHOP_EQ:
@@ -202,19 +600,19 @@ bool Matcher::matches_r(expression* e, Matchable* item)
 			return !matchop_eq(e, item);
 
 		case MATCHOP_LT:
-			return matchop_lt(e, item);
+			return matchop_lt(e, item, now);
 
 		case MATCHOP_BETWEEN:
-			return matchop_between(e, item);
+			return matchop_between(e, item, now);
 
 		case MATCHOP_GT:
-			return matchop_gt(e, item);
+			return matchop_gt(e, item, now);
 
 		case MATCHOP_LE:
-			return !matchop_gt(e, item);
+			return !matchop_gt(e, item, now);
 
 		case MATCHOP_GE:
-			return !matchop_lt(e, item);
+			return !matchop_lt(e, item, now);
 
 		case MATCHOP_RXEQ:
 			return matchop_rxeq(e, item);
@@ -234,6 +632,120 @@ bool Matcher::matches_r(expression* e, Matchable* item)
 	}
 }
 
+nonstd::optional<std::string> Matcher::sql_condition()
+{
+	return sql_condition_r(p.get_root());
+}
+
+bool Matcher::uses_attribute(MatchableAttribute attribute)
+{
+	return uses_attribute_r(p.get_root(), attribute);
+}
+
+bool Matcher::uses_attribute_r(expression* e, MatchableAttribute attribute)
+{
+	if (e == nullptr) {
+		return false;
+	}
+
+	if (e->op == LOGOP_AND || e->op == LOGOP_OR) {
+		return uses_attribute_r(e->l, attribute)
+			|| uses_attribute_r(e->r, attribute);
+	}
+
+	if (e->attribute < 0) {
+		e->attribute = static_cast<int>(Matchable::attribute_id(e->name));
+	}
+	return static_cast<MatchableAttribute>(e->attribute) == attribute;
+}
+
+nonstd::optional<std::string> Matcher::sql_condition_r(expression* e)
+{
+	if (e == nullptr) {
+		return nonstd::nullopt;
+	}
+
+	if (e->op == LOGOP_AND || e->op == LOGOP_OR) {
+		const auto left = sql_condition_r(e->l);
+		const auto right = sql_condition_r(e->r);
+		if (!left.has_value() || !right.has_value()) {
+			return nonstd::nullopt;
+		}
+		return "(" + left.value() + (e->op == LOGOP_AND ? " AND " : " OR ")
+			+ right.value() + ")";
+	}
+
+	if (e->attribute < 0) {
+		e->attribute = static_cast<int>(Matchable::attribute_id(e->name));
+	}
+	const auto id = static_cast<MatchableAttribute>(e->attribute);
+
+	if (id == MatchableAttribute::UNREAD) {
+		// RssItem returns "yes" or "no"; any other literal never matches
+		std::string condition = "0";
+		if (e->literal == "yes") {
+			condition = "(rss_item.unread = 1)";
+		} else if (e->literal == "no") {
+			condition = "(rss_item.unread = 0)";
+		}
+		switch (e->op) {
+		case MATCHOP_EQ:
+			return condition;
+		case MATCHOP_NE:
+			return "(NOT " + condition + ")";
+		default:
+			return nonstd::nullopt;
+		}
+	}
+
+	if (id == MatchableAttribute::AGE) {
+		// Same integer division, rounding towards zero, as RssItem does
+		const std::string age =
+			"((CAST(strftime('%s', 'now') AS INTEGER) - rss_item.pubDate) "
+			"/ 86400)";
+		const auto number = std::to_string(string_to_num(e->literal));
+		switch (e->op) {
+		case MATCHOP_LT:
+			return "(" + age + " < " + number + ")";
+		case MATCHOP_GT:
+			return "(" + age + " > " + number + ")";
+		case MATCHOP_LE:
+			return "(" + age + " <= " + number + ")";
+		case MATCHOP_GE:
+			return "(" + age + " >= " + number + ")";
+		case MATCHOP_BETWEEN: {
+			const auto bounds = utils::tokenize(e->literal, ":");
+			if (bounds.size() < 2) {
+				return std::string("0");
+			}
+			int low = string_to_num(bounds[0]);
+			int high = string_to_num(bounds[1]);
+			if (low > high) {
+				std::swap(low, high);
+			}
+			return "(" + age + " BETWEEN " + std::to_string(low) + " AND "
+				+ std::to_string(high) + ")";
+		}
+		default:
+			// `=` compares the text, which SQL would compare differently
+			return nonstd::nullopt;
+		}
+	}
+
+	const auto column = sql_column(id);
+	if (column == nullptr) {
+		return nonstd::nullopt;
+	}
+	switch (e->op) {
+	case MATCHOP_EQ:
+		return "(" + std::string(column) + " = " + sql_quote(e->literal) + ")";
+	case MATCHOP_NE:
+		return "(" + std::string(column) + " != " + sql_quote(e->literal) + ")";
+	default:
+		return nonstd::nullopt;
+	}
+}
+
 std::string Matcher::get_parse_error()
 {
 	return errmsg;
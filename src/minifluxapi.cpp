@@ -6,6 +6,8 @@
 
 #include "3rd-party/json.hpp"
 #include "curlhandle.h"
+#include "executor.h"
+#include "jsonstream.h"
 #include "logger.h"
 #include "remoteapi.h"
 #include "rss/feed.h"
@@ -15,6 +17,13 @@
 using json = nlohmann::json;
 using HTTPMethod = newsboat::utils::HTTPMethod;
 
+// How many entries a single PUT /v1/entries request marks read
+#define MINIFLUX_MARK_READ_BATCH_SIZE 500
+// How many unread entries fetch_unread_guids() asks for at once, and how
+// many pages of them it reads at most
+#define MINIFLUX_UNREAD_PAGE_SIZE 250
+#define MINIFLUX_UNREAD_MAX_PAGES 100
+
 namespace newsboat {
 MinifluxApi::MinifluxApi(ConfigContainer* c)
 	: RemoteApi(c)
@@ -43,7 +52,8 @@ bool MinifluxApi::authenticate()
 		auth_info = strprintf::fmt("%s:%s", creds.user, creds.pass);
 	}
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	long response_code = 0;
 	run_op("/v1/me", json(), handle);
 	curl_easy_getinfo(handle.ptr(), CURLINFO_RESPONSE_CODE, &response_code);
@@ -77,7 +87,14 @@ std::vector<TaggedFeedUrl> MinifluxApi::get_subscribed_urls()
 {
 	std::vector<TaggedFeedUrl> feeds;
 
-	const json categories = run_op("/v1/categories", json());
+	// Both lists are asked for at once
+	json categories;
+	std::thread categories_request([&]() {
+		categories = run_revalidated("/v1/categories");
+	});
+	const json feed_list = run_revalidated("/v1/feeds");
+	categories_request.join();
+
 	std::map<int, std::string> category_names;
 	for (const auto& category : categories) {
 		const std::string name = category["title"];
@@ -85,7 +102,6 @@ std::vector<TaggedFeedUrl> MinifluxApi::get_subscribed_urls()
 		category_names[id] = name;
 	}
 
-	const json feed_list = run_op("/v1/feeds", json());
 	if (feed_list.is_null()) {
 		LOG(Level::ERROR,
 			"MinifluxApi::get_subscribed_urls: Failed to "
@@ -126,8 +142,8 @@ bool MinifluxApi::mark_article_read(const std::string& guid, bool read)
 {
 	// Do this in a thread, as we don't care about the result enough to wait
 	// for it.
-	std::thread t{[=]()
-	{
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
 		LOG(Level::DEBUG,
 			"MinifluxApi::mark_article_read: inside thread, marking "
 			"article as read...");
@@ -136,8 +152,22 @@ bool MinifluxApi::mark_article_read(const std::string& guid, bool read)
 		json args;
 		args["status"] = read ? "read" : "unread";
 		this->update_article(guid, args);
-	}};
-	t.detach();
+	});
+	return true;
+}
+
+bool MinifluxApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	// Like mark_article_read(), do this in a thread
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
+		mark_in_batches(guids, MINIFLUX_MARK_READ_BATCH_SIZE,
+		[this](const std::vector<std::string>& batch) {
+			json args;
+			args["status"] = "read";
+			return this->update_articles(batch, args);
+		});
+	});
 	return true;
 }
 
@@ -150,11 +180,14 @@ bool MinifluxApi::update_article_flags(const std::string& /* oldflags */,
 
 rsspp::Feed MinifluxApi::fetch_feed(const std::string& id)
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	return fetch_feed(id, handle);
 }
 
-rsspp::Feed MinifluxApi::fetch_feed(const std::string& id, CurlHandle& cached_handle)
+rsspp::Feed MinifluxApi::fetch_feed(const std::string& id,
+	CurlHandle& cached_handle,
+	utils::ConditionalRequest* conditional /* = nullptr */)
 {
 	rsspp::Feed feed;
 	feed.rss_version = rsspp::Feed::MINIFLUX_JSON;
@@ -164,45 +197,46 @@ rsspp::Feed MinifluxApi::fetch_feed(const std::string& id, CurlHandle& cached_ha
 			id,
 			cfg->get_configvalue_as_int("miniflux-min-items"));
 
-	const json content = run_op(query, json(), cached_handle, HTTPMethod::GET);
-	if (content.is_null()) {
+	const std::string result = request(query, json(), cached_handle,
+			HTTPMethod::GET, conditional);
+	if (conditional != nullptr && conditional->not_modified) {
+		LOG(Level::DEBUG, "MinifluxApi::fetch_feed: %s didn't change", id);
+		feed.rss_version = rsspp::Feed::UNKNOWN;
 		return feed;
 	}
-
-	const json entries = content["entries"];
-	if (!entries.is_array()) {
-		LOG(Level::ERROR,
-			"MinifluxApi::fetch_feed: items is not an array");
+	if (result.empty()) {
 		return feed;
 	}
 
-	LOG(Level::DEBUG,
-		"MinifluxApi::fetch_feed: %" PRIu64 " items",
-		static_cast<uint64_t>(entries.size()));
+	// The entries are turned into articles as they're parsed, so that the
+	// whole list, with every article's content, isn't built at once
+	json rest;
 	try {
-		for (const auto& entry : entries) {
+		const bool parsed = stream_json_array(result, "entries",
+		[&](json& entry) {
 			rsspp::Item item;
 
 			if (!entry["title"].is_null()) {
-				item.title = entry["title"];
+				item.title = std::move(entry["title"].get_ref<std::string&>());
 			}
 
 			if (!entry["url"].is_null()) {
-				item.link = entry["url"];
+				item.link = std::move(entry["url"].get_ref<std::string&>());
 			}
 
 			if (!entry["author"].is_null()) {
-				item.author = entry["author"];
+				item.author = std::move(entry["author"].get_ref<std::string&>());
 			}
 
 			if (!entry["content"].is_null()) {
-				item.content_encoded = entry["content"];
+				item.content_encoded =
+					std::move(entry["content"].get_ref<std::string&>());
 			}
 
 			const int entry_id = entry["id"];
 			item.guid = std::to_string(entry_id);
 
-			item.pubDate = entry["published_at"];
+			item.pubDate = std::move(entry["published_at"].get_ref<std::string&>());
 
 			const std::string status = entry["status"];
 			if (status == "unread") {
@@ -211,7 +245,18 @@ rsspp::Feed MinifluxApi::fetch_feed(const std::string& id, CurlHandle& cached_ha
 				item.labels.push_back("miniflux:read");
 			}
 
-			feed.items.push_back(item);
+			feed.items.push_back(std::move(item));
+		}, rest);
+		if (!parsed) {
+			LOG(Level::ERROR,
+				"MinifluxApi::fetch_feed: reply failed to parse: %s",
+				result);
+			return feed;
+		}
+		if (!rest.is_object() || rest.contains("entries")) {
+			LOG(Level::ERROR,
+				"MinifluxApi::fetch_feed: items is not an array");
+			return feed;
 		}
 	} catch (json::exception& e) {
 		LOG(Level::ERROR,
@@ -219,6 +264,10 @@ rsspp::Feed MinifluxApi::fetch_feed(const std::string& id, CurlHandle& cached_ha
 			e.what());
 	}
 
+	LOG(Level::DEBUG,
+		"MinifluxApi::fetch_feed: %" PRIu64 " items",
+		static_cast<uint64_t>(feed.items.size()));
+
 	std::sort(feed.items.begin(),
 		feed.items.end(),
 	[](const rsspp::Item& a, const rsspp::Item& b) {
@@ -228,6 +277,62 @@ rsspp::Feed MinifluxApi::fetch_feed(const std::string& id, CurlHandle& cached_ha
 	return feed;
 }
 
+bool MinifluxApi::fetch_unread_guids(std::vector<std::string>& guids)
+{
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+
+	// Miniflux can't leave out the content, but only the ids are kept
+	for (unsigned int page = 0; page < MINIFLUX_UNREAD_MAX_PAGES; ++page) {
+		const std::string query = strprintf::fmt(
+				"/v1/entries?status=unread&order=id&direction=asc"
+				"&limit=%u&offset=%u",
+				MINIFLUX_UNREAD_PAGE_SIZE,
+				page * MINIFLUX_UNREAD_PAGE_SIZE);
+		const std::string result = request(query, json(), handle,
+				HTTPMethod::GET);
+		if (result.empty()) {
+			return false;
+		}
+
+		unsigned int page_entries = 0;
+		json rest;
+		try {
+			const bool parsed = stream_json_array(result, "entries",
+			[&](json& entry) {
+				const int entry_id = entry["id"];
+				guids.push_back(std::to_string(entry_id));
+				++page_entries;
+			}, rest);
+			if (!parsed || !rest.is_object() || rest.contains("entries")) {
+				LOG(Level::ERROR,
+					"MinifluxApi::fetch_unread_guids: reply failed to "
+					"parse: %s",
+					result);
+				return false;
+			}
+		} catch (json::exception& e) {
+			LOG(Level::ERROR,
+				"MinifluxApi::fetch_unread_guids: Exception occurred while "
+				"parsing the entries: %s",
+				e.what());
+			return false;
+		}
+		if (page_entries < MINIFLUX_UNREAD_PAGE_SIZE) {
+			LOG(Level::DEBUG,
+				"MinifluxApi::fetch_unread_guids: %" PRIu64 " unread entries",
+				static_cast<uint64_t>(guids.size()));
+			return true;
+		}
+	}
+
+	LOG(Level::WARN,
+		"MinifluxApi::fetch_unread_guids: more than %u pages of unread "
+		"entries, giving up",
+		MINIFLUX_UNREAD_MAX_PAGES);
+	return false;
+}
+
 void MinifluxApi::add_custom_headers(curl_slist** /* custom_headers */)
 {
 	// nothing required
@@ -237,7 +342,8 @@ json MinifluxApi::run_op(const std::string& path,
 	const json& args,
 	const HTTPMethod method /* = GET */)
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	return run_op(path, args, handle, method);
 }
 
@@ -245,17 +351,65 @@ json MinifluxApi::run_op(const std::string& path,
 	const json& args,
 	CurlHandle& easyhandle,
 	const HTTPMethod method /* = GET */)
+{
+	const std::string result = request(path, args, easyhandle, method);
+
+	json content;
+	if (!result.empty()) {
+		try {
+			content = json::parse(result);
+		} catch (json::parse_error& e) {
+			LOG(Level::ERROR,
+				"MinifluxApi::run_op: reply failed to parse: %s",
+				result);
+			content = json(nullptr);
+		}
+	}
+
+	return content;
+}
+
+json MinifluxApi::run_revalidated(const std::string& path)
+{
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+	const std::string result = revalidate(server + path,
+	[&](utils::ConditionalRequest& conditional) {
+		return request(path, json(), handle, HTTPMethod::GET, &conditional);
+	});
+
+	json content;
+	if (!result.empty()) {
+		try {
+			content = json::parse(result);
+		} catch (json::parse_error& e) {
+			LOG(Level::ERROR,
+				"MinifluxApi::run_revalidated: reply failed to parse: %s",
+				result);
+			content = json(nullptr);
+		}
+	}
+
+	return content;
+}
+
+std::string MinifluxApi::request(const std::string& path,
+	const json& args,
+	CurlHandle& easyhandle,
+	const HTTPMethod method,
+	utils::ConditionalRequest* conditional /* = nullptr */)
 {
 	// follow redirects and keep the same request type
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_FOLLOWLOCATION, 1);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
 
+	utils::ConditionalRequest unconditional;
+	utils::ConditionalRequest& req =
+		conditional != nullptr ? *conditional : unconditional;
+	// The token is added for this request only
+	const std::size_t given_headers = req.headers.size();
 	if (!auth_token.empty()) {
-		std::string header = "X-Auth-Token: " + auth_token;
-
-		curl_slist* headers = NULL;
-		headers = curl_slist_append(headers, header.c_str());
-		curl_easy_setopt(easyhandle.ptr(), CURLOPT_HTTPHEADER, headers);
+		req.headers.push_back("X-Auth-Token: " + auth_token);
 	}
 
 	const std::string url = server + path;
@@ -268,29 +422,16 @@ json MinifluxApi::run_op(const std::string& path,
 	}
 
 	const std::string result = utils::retrieve_url(
-			url, easyhandle, cfg, auth_info, body, method);
-
+			url, easyhandle, cfg, auth_info, body, method, &req);
+	req.headers.resize(given_headers);
 
 	LOG(Level::DEBUG,
-		"MinifluxApi::run_op(%s %s,...): body=%s reply = %s",
+		"MinifluxApi::request(%s %s,...): body=%s reply = %s",
 		utils::http_method_str(method),
 		path,
 		arg_dump,
 		result);
-
-	json content;
-	if (!result.empty()) {
-		try {
-			content = json::parse(result);
-		} catch (json::parse_error& e) {
-			LOG(Level::ERROR,
-				"MinifluxApi::run_op: reply failed to parse: %s",
-				result);
-			content = json(nullptr);
-		}
-	}
-
-	return content;
+	return result;
 }
 
 bool MinifluxApi::update_articles(const std::vector<std::string> guids,
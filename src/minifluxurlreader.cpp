@@ -35,7 +35,7 @@ nonstd::optional<utils::ReadTextFileError> MinifluxUrlReader::reload()
 		}
 	}
 
-	const std::vector<TaggedFeedUrl> feedurls = api->get_subscribed_urls();
+	const std::vector<TaggedFeedUrl> feedurls = api->subscriptions();
 
 	for (const auto& url : feedurls) {
 		LOG(Level::INFO, "added %s to URL list", url.first);
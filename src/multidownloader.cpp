@@ -0,0 +1,235 @@
+#include "multidownloader.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "curlhandle.h"
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+/// curl_multi_wakeup() and curl_multi_poll() appeared in curl 7.68.0.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define NEWSBOAT_CURL_MULTI_WAKEUP
+#endif
+
+#ifdef NEWSBOAT_CURL_MULTI_WAKEUP
+/// Transfers added from other threads wake up the poll, so this only bounds
+/// how long run() sleeps when curl has nothing to say.
+const int POLL_TIMEOUT_MS = 1000;
+#else
+/// Without a way to wake up curl_multi_wait(), this is how late run() can
+/// notice that new transfers were added.
+const int POLL_TIMEOUT_MS = 100;
+#endif
+
+}
+
+MultiDownloader::MultiDownloader(unsigned int max_transfers,
+	unsigned int max_per_host,
+	std::chrono::milliseconds host_delay)
+	: max_transfers(max_transfers)
+	, max_per_host(max_per_host)
+	, host_delay(host_delay)
+	, multi(curl_multi_init())
+	, finished(false)
+{
+	if (!multi) {
+		throw std::runtime_error("Can't obtain curl multi handle");
+	}
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	// Transfers to the same HTTP/2 server share a single connection
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+}
+
+MultiDownloader::~MultiDownloader()
+{
+	for (const auto& transfer : running) {
+		curl_multi_remove_handle(multi, transfer.first);
+	}
+	curl_multi_cleanup(multi);
+}
+
+void MultiDownloader::add(CurlHandle& handle, Callback done,
+	const std::string& host)
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	curl_easy_setopt(handle.ptr(), CURLOPT_HTTP_VERSION,
+		CURL_HTTP_VERSION_2TLS);
+	// Rather than opening another connection to a host, wait for the one
+	// that's being set up and see if it can be multiplexed
+	curl_easy_setopt(handle.ptr(), CURLOPT_PIPEWAIT, 1L);
+#endif
+	{
+		std::lock_guard<std::mutex> guard(queue_mutex);
+		queued.push_back(Transfer{handle.ptr(), std::move(done), host});
+	}
+	queue_changed.notify_one();
+#ifdef NEWSBOAT_CURL_MULTI_WAKEUP
+	curl_multi_wakeup(multi);
+#endif
+}
+
+void MultiDownloader::finish()
+{
+	{
+		std::lock_guard<std::mutex> guard(queue_mutex);
+		finished = true;
+	}
+	queue_changed.notify_one();
+#ifdef NEWSBOAT_CURL_MULTI_WAKEUP
+	curl_multi_wakeup(multi);
+#endif
+}
+
+void MultiDownloader::run()
+{
+	LOG(Level::DEBUG, "MultiDownloader::run: started");
+	for (;;) {
+		Clock::time_point next_start;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			next_start = start_queued_unlocked();
+			if (running.empty() && failed.empty()) {
+				// curl has no sockets to wait on, so wait for new transfers,
+				// or for a host to be ready for the next one
+				if (queued.empty() && finished) {
+					break;
+				}
+				if (next_start == Clock::time_point::max()) {
+					queue_changed.wait(lock);
+				} else {
+					queue_changed.wait_until(lock, next_start);
+				}
+				continue;
+			}
+		}
+
+		int still_running = 0;
+		const CURLMcode rc = curl_multi_perform(multi, &still_running);
+		if (rc != CURLM_OK) {
+			LOG(Level::ERROR,
+				"MultiDownloader::run: curl_multi_perform failed: %s",
+				curl_multi_strerror(rc));
+		}
+		complete_transfers();
+
+		if (!running.empty()) {
+			wait_for_activity(next_start);
+		}
+	}
+	LOG(Level::DEBUG, "MultiDownloader::run: finished");
+}
+
+MultiDownloader::Clock::time_point MultiDownloader::start_queued_unlocked()
+{
+	const auto now = Clock::now();
+	auto next_start = Clock::time_point::max();
+
+	auto transfer = queued.begin();
+	while (transfer != queued.end()
+		&& (max_transfers == 0 || running.size() < max_transfers)) {
+		if (!transfer->host.empty()) {
+			const Host& host = hosts[transfer->host];
+			if (max_per_host != 0 && host.running >= max_per_host) {
+				++transfer;
+				continue;
+			}
+			if (host.last_start != Clock::time_point()) {
+				const auto ready = host.last_start + host_delay;
+				if (ready > now) {
+					next_start = std::min(next_start, ready);
+					++transfer;
+					continue;
+				}
+			}
+		}
+
+		Transfer started = std::move(*transfer);
+		transfer = queued.erase(transfer);
+
+		const CURLMcode rc = curl_multi_add_handle(multi, started.handle);
+		if (rc != CURLM_OK) {
+			LOG(Level::ERROR,
+				"MultiDownloader::start_queued_unlocked: can't add a transfer: "
+				"%s",
+				curl_multi_strerror(rc));
+			// Reported once the lock is released, like any other failure
+			failed.push_back(std::move(started.done));
+			continue;
+		}
+		if (!started.host.empty()) {
+			Host& host = hosts[started.host];
+			++host.running;
+			host.last_start = now;
+		}
+		running.emplace(started.handle, std::move(started));
+	}
+	LOG(Level::DEBUG,
+		"MultiDownloader::start_queued_unlocked: %" PRIu64 " running, %" PRIu64
+		" queued",
+		static_cast<uint64_t>(running.size()),
+		static_cast<uint64_t>(queued.size()));
+	return next_start;
+}
+
+void MultiDownloader::complete_transfers()
+{
+	std::vector<Callback> done = std::move(failed);
+	failed.clear();
+	for (auto& callback : done) {
+		callback(CURLE_FAILED_INIT);
+	}
+
+	int messages_left = 0;
+	while (CURLMsg* msg = curl_multi_info_read(multi, &messages_left)) {
+		if (msg->msg != CURLMSG_DONE) {
+			continue;
+		}
+		CURL* handle = msg->easy_handle;
+		const CURLcode result = msg->data.result;
+		curl_multi_remove_handle(multi, handle);
+
+		const auto transfer = running.find(handle);
+		if (transfer == running.end()) {
+			continue;
+		}
+		Transfer finished_transfer = std::move(transfer->second);
+		running.erase(transfer);
+		if (!finished_transfer.host.empty()) {
+			--hosts[finished_transfer.host].running;
+		}
+		finished_transfer.done(result);
+	}
+}
+
+void MultiDownloader::wait_for_activity(Clock::time_point next_start)
+{
+	int timeout_ms = POLL_TIMEOUT_MS;
+	if (next_start != Clock::time_point::max()) {
+		const auto until_next_start =
+			std::chrono::duration_cast<std::chrono::milliseconds>(
+				next_start - Clock::now()).count();
+		timeout_ms = std::max(0,
+				static_cast<int>(std::min<std::int64_t>(until_next_start, timeout_ms)));
+	}
+#ifdef NEWSBOAT_CURL_MULTI_WAKEUP
+	const CURLMcode rc = curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+#else
+	const CURLMcode rc = curl_multi_wait(multi, nullptr, 0, timeout_ms, nullptr);
+#endif
+	if (rc != CURLM_OK) {
+		LOG(Level::ERROR,
+			"MultiDownloader::wait_for_activity: waiting failed: %s",
+			curl_multi_strerror(rc));
+	}
+}
+
+} // namespace newsboat
@@ -1,6 +1,7 @@
 #include "newsblurapi.h"
 
 #include <algorithm>
+#include <map>
 #include <string.h>
 #include <time.h>
 
@@ -23,6 +24,8 @@
 #endif
 
 #define NEWSBLUR_ITEMS_PER_PAGE 6
+// How many stories of a feed a single mark_story_as_read request marks
+#define NEWSBLUR_MARK_READ_BATCH_SIZE 100
 
 using HTTPMethod = newsboat::utils::HTTPMethod;
 
@@ -86,7 +89,7 @@ std::vector<TaggedFeedUrl> NewsBlurApi::get_subscribed_urls()
 {
 	std::vector<TaggedFeedUrl> result;
 
-	json_object* response = query_api("/reader/feeds/", nullptr);
+	json_object* response = query_api_revalidated("/reader/feeds/");
 
 	json_object* feeds{};
 	json_object_object_get_ex(response, "feeds", &feeds);
@@ -231,6 +234,46 @@ bool NewsBlurApi::mark_article_read(const std::string& guid, bool read)
 	return request_successfull(query_result);
 }
 
+bool NewsBlurApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	// mark_story_as_read takes any number of stories, but of one feed. The
+	// story hashes that mark_story_hashes_as_read wants aren't kept.
+	std::vector<std::string> feed_ids;
+	std::map<std::string, std::vector<std::string>> article_ids;
+	for (const auto& guid : guids) {
+		// skip dummy articles
+		if (guid.empty()) {
+			continue;
+		}
+		const auto separator = guid.find(ID_SEPARATOR);
+		const std::string feed_id = guid.substr(0, separator);
+		auto& ids = article_ids[feed_id];
+		if (ids.empty()) {
+			feed_ids.push_back(feed_id);
+		}
+		ids.push_back(guid.substr(separator + sizeof(ID_SEPARATOR) - 1));
+	}
+
+	bool success = true;
+	for (const auto& feed_id : feed_ids) {
+		const bool feed_success = mark_in_batches(article_ids[feed_id],
+				NEWSBLUR_MARK_READ_BATCH_SIZE,
+		[&](const std::vector<std::string>& batch) {
+			std::string post_data = "feed_id=" + feed_id;
+			for (const auto& article_id : batch) {
+				post_data += "&story_id=" + article_id;
+			}
+			json_object* query_result = query_api("/reader/mark_story_as_read",
+					&post_data, HTTPMethod::POST);
+			return request_successfull(query_result);
+		});
+		if (!feed_success) {
+			success = false;
+		}
+	}
+	return success;
+}
+
 bool NewsBlurApi::update_article_flags(const std::string& /* oldflags */,
 	const std::string& /* newflags */,
 	const std::string& /* guid */)
@@ -257,6 +300,13 @@ rsspp::Feed NewsBlurApi::fetch_feed(const std::string& id)
 		id);
 
 	for (unsigned int i = 1; i <= min_pages; i++) {
+		// The pages fetched so far still tell what's new
+		if (i > 1 && !budget.allows(RequestBudget::Kind::READ)) {
+			LOG(Level::INFO,
+				"NewsBlurApi::fetch_feed: out of requests after %u page(s)",
+				i - 1);
+			break;
+		}
 		std::string page = std::to_string(i);
 
 		json_object* query_result = query_api(
@@ -368,7 +418,16 @@ json_object* NewsBlurApi::query_api(const std::string& endpoint,
 	const HTTPMethod method /* = GET */)
 {
 	std::string url = api_location + endpoint;
-	std::string data = utils::retrieve_url(url, cfg, "", body, method);
+	const auto handle = handles.acquire();
+	utils::ConditionalRequest request;
+	request.on_header = [this](const std::string& header) {
+		budget.read_header(header);
+	};
+	budget.spend(method == HTTPMethod::GET
+		? RequestBudget::Kind::READ
+		: RequestBudget::Kind::WRITE);
+	std::string data = utils::retrieve_url(url, *handle, cfg, "", body, method,
+			&request);
 
 	json_object* result = json_tokener_parse(data.c_str());
 	if (!result)
@@ -378,4 +437,26 @@ json_object* NewsBlurApi::query_api(const std::string& endpoint,
 	return result;
 }
 
+json_object* NewsBlurApi::query_api_revalidated(const std::string& endpoint)
+{
+	const std::string url = api_location + endpoint;
+	const auto handle = handles.acquire();
+	const std::string data = revalidate(url,
+	[&](utils::ConditionalRequest& request) {
+		request.on_header = [this](const std::string& header) {
+			budget.read_header(header);
+		};
+		budget.spend(RequestBudget::Kind::READ);
+		return utils::retrieve_url(url, *handle, cfg, "", nullptr,
+				HTTPMethod::GET, &request);
+	});
+
+	json_object* result = json_tokener_parse(data.c_str());
+	if (!result)
+		LOG(Level::WARN,
+			"NewsBlurApi::query_api_revalidated: request to %s failed",
+			url);
+	return result;
+}
+
 } // namespace newsboat
@@ -13,6 +13,9 @@
 
 #define OCNEWS_API "/index.php/apps/news/api/v1-2/"
 
+// How many items a single items/read/multiple request marks read
+#define OCNEWS_MARK_READ_BATCH_SIZE 500
+
 namespace newsboat {
 
 typedef std::unique_ptr<json_object, decltype(*json_object_put)> JsonUptr;
@@ -181,15 +184,18 @@ bool OcNewsApi::mark_article_read(const std::string& guid, bool read)
 
 bool OcNewsApi::mark_articles_read(const std::vector<std::string>& guids)
 {
-	std::vector<std::string> ids;
-	for (const auto& guid : guids) {
-		ids.push_back(guid.substr(0, guid.find_first_of(":")));
-	}
+	return mark_in_batches(guids, OCNEWS_MARK_READ_BATCH_SIZE,
+	[this](const std::vector<std::string>& batch) {
+		std::vector<std::string> ids;
+		for (const auto& guid : batch) {
+			ids.push_back(guid.substr(0, guid.find_first_of(":")));
+		}
 
-	const std::string query = "items/read/multiple";
-	const std::string id_array = strprintf::fmt("[%s]", utils::join(ids, ","));
-	const std::string parameters = strprintf::fmt(R"({"items": %s})", id_array);
-	return this->query(query, nullptr, parameters);
+		const std::string query = "items/read/multiple";
+		const std::string id_array = strprintf::fmt("[%s]", utils::join(ids, ","));
+		const std::string parameters = strprintf::fmt(R"({"items": %s})", id_array);
+		return this->query(query, nullptr, parameters);
+	});
 }
 
 bool OcNewsApi::update_article_flags(const std::string& oldflags,
@@ -334,7 +340,8 @@ bool OcNewsApi::query(const std::string& query,
 	json_object** result,
 	const std::string& post)
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 
 	std::string url = server + OCNEWS_API + query;
 	curl_easy_setopt(handle.ptr(), CURLOPT_URL, url.c_str());
@@ -1,5 +1,6 @@
 #include "oldreaderapi.h"
 
+#include <cinttypes>
 #include <cstring>
 #include <curl/curl.h>
 #include <json.h>
@@ -22,6 +23,9 @@
 #define OLDREADER_API_EDIT_TAG_URL OLDREADER_API_PREFIX "edit-tag"
 #define OLDREADER_API_TOKEN_URL OLDREADER_API_PREFIX "token"
 
+// How many articles a single edit-tag request marks read
+#define OLDREADER_MARK_READ_BATCH_SIZE 250
+
 // for reference, see https://github.com/theoldreader/api
 
 namespace newsboat {
@@ -48,7 +52,8 @@ static size_t my_write_data(void* buffer, size_t size, size_t nmemb,
 
 std::string OldReaderApi::retrieve_auth()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	Credentials cred = get_credentials("oldreader", "The Old Reader");
 	if (cred.user.empty() || cred.pass.empty()) {
 		return "";
@@ -96,7 +101,8 @@ std::vector<TaggedFeedUrl> OldReaderApi::get_subscribed_urls()
 	std::vector<TaggedFeedUrl> urls;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
@@ -239,6 +245,32 @@ bool OldReaderApi::mark_article_read(const std::string& guid, bool read)
 	return mark_article_read_with_token(guid, read, token);
 }
 
+bool OldReaderApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	const std::string token = get_new_token();
+	return mark_in_batches(guids, OLDREADER_MARK_READ_BATCH_SIZE,
+	[&](const std::vector<std::string>& batch) {
+		std::string postcontent;
+		for (const auto& guid : batch) {
+			postcontent += "i=" + guid + "&";
+		}
+		postcontent += strprintf::fmt(
+				"a=user/-/state/com.google/read&r=user/-/state/"
+				"com.google/kept-unread&ac=edit&T=%s",
+				token);
+
+		const std::string result = post_content(OLDREADER_API_EDIT_TAG_URL, postcontent);
+
+		LOG(Level::DEBUG,
+			"OldReaderApi::mark_articles_read: %" PRIu64 " articles, "
+			"result = %s",
+			static_cast<uint64_t>(batch.size()),
+			result);
+
+		return result == "OK";
+	});
+}
+
 bool OldReaderApi::mark_article_read_with_token(const std::string& guid,
 	bool read,
 	const std::string& token)
@@ -274,7 +306,8 @@ bool OldReaderApi::mark_article_read_with_token(const std::string& guid,
 
 std::string OldReaderApi::get_new_token()
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	std::string result;
 	curl_slist* custom_headers{};
 
@@ -367,7 +400,8 @@ std::string OldReaderApi::post_content(const std::string& url,
 	std::string result;
 	curl_slist* custom_headers{};
 
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	utils::set_common_curl_options(handle, cfg);
 	add_custom_headers(&custom_headers);
 	curl_easy_setopt(handle.ptr(), CURLOPT_HTTPHEADER, custom_headers);
@@ -1,9 +1,10 @@
 #include "opml.h"
 
-#include <algorithm>
-#include <cassert>
 #include <cinttypes>
 #include <cstring>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "rssfeed.h"
 
@@ -26,7 +27,7 @@ xmlDocPtr opml::generate(const FeedContainer& feedcontainer)
 	xmlNodePtr body = xmlNewTextChild(
 			opml_node, nullptr, (const xmlChar*)"body", nullptr);
 
-	for (const auto& feed : feedcontainer.get_all_feeds()) {
+	for (const auto& feed : *feedcontainer.get_feeds_snapshot()) {
 		if (!utils::is_special_url(feed->rssurl())) {
 			std::string rssurl = feed->rssurl();
 			std::string link = feed->link();
@@ -54,136 +55,164 @@ xmlDocPtr opml::generate(const FeedContainer& feedcontainer)
 	return root;
 }
 
-void rec_find_rss_outlines(
-	FileUrlReader& urlcfg,
-	xmlNode* node,
-	std::string tag)
+namespace {
+
+std::string attribute(xmlTextReaderPtr reader, const char* name)
+{
+	xmlChar* value = xmlTextReaderGetAttribute(reader, (const xmlChar*)name);
+	if (value == nullptr) {
+		return "";
+	}
+	const std::string result((const char*)value);
+	xmlFree(value);
+	return result;
+}
+
+/// The URL that the urls file should have for \a outline, or an empty one
+/// if it isn't a feed.
+std::string feed_url(const opml::Outline& outline)
+{
+	const std::string& url = outline.xml_url.empty() ? outline.url :
+		outline.xml_url;
+	if (url.empty()) {
+		return "";
+	}
+	LOG(Level::DEBUG, "opml::import: found RSS outline with url = %s", url);
+
+	std::string nurl = url;
+
+	// Liferea uses a pipe to signal feeds read from the output of a program
+	// in its OPMLs. Convert them to our syntax.
+	if (url[0] == '|') {
+		nurl = strprintf::fmt("exec:%s", url.substr(1));
+		LOG(Level::DEBUG,
+			"opml::import: liferea-style url %s converted to %s",
+			url,
+			nurl);
+	}
+
+	// Handle OPML filters.
+	if (!outline.filtercmd.empty()) {
+		LOG(Level::DEBUG,
+			"opml::import: adding filter command %s to url %s",
+			outline.filtercmd,
+			nurl);
+		nurl.insert(0, strprintf::fmt("filter:%s:", outline.filtercmd));
+	}
+
+	// Filters and scripts may have arguments, so, quote them when needed.
+	return utils::quote_if_necessary(nurl);
+}
+
+}
+
+bool opml::read_outlines(xmlTextReaderPtr reader, const OutlineVisitor& visit)
 {
-	while (node) {
-		std::string newtag = tag;
-
-		if (strcmp((const char*)node->name, "outline") == 0) {
-			char* url_p = (char*)xmlGetProp(
-					node, (const xmlChar*)"xmlUrl");
-			if (!url_p) {
-				url_p = (char*)xmlGetProp(
-						node, (const xmlChar*)"url");
+	if (reader == nullptr) {
+		return false;
+	}
+
+	// The tags of the elements that are open inside the body, innermost
+	// last; the body is at depth 1, right inside the root
+	const int body_depth = 1;
+	bool in_body = false;
+	std::vector<std::string> tags;
+	bool read_anything = false;
+	int ret;
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		read_anything = true;
+		const int type = xmlTextReaderNodeType(reader);
+		const int depth = xmlTextReaderDepth(reader);
+		if (type == XML_READER_TYPE_END_ELEMENT) {
+			if (in_body && depth > body_depth) {
+				tags.pop_back();
+			} else if (depth == body_depth) {
+				in_body = false;
 			}
+			continue;
+		}
+		if (type != XML_READER_TYPE_ELEMENT) {
+			continue;
+		}
 
-			if (url_p) {
-				const std::string url(url_p);
-				xmlFree(url_p);
-
-				LOG(Level::DEBUG,
-					"opml::import: found RSS outline with "
-					"url = "
-					"%s",
-					url);
-
-				std::string nurl = std::string(url);
-
-				// Liferea uses a pipe to signal feeds read from
-				// the output of a program in its OPMLs. Convert
-				// them to our syntax.
-				if (url.length() >= 1 && url[0] == '|') {
-					nurl = strprintf::fmt(
-							"exec:%s", url.substr(1));
-					LOG(Level::DEBUG,
-						"opml::import: liferea-style "
-						"url %s converted to %s",
-						url,
-						nurl);
-				}
-
-				// Handle OPML filters.
-				char* filtercmd = (char*)xmlGetProp(
-						node, (const xmlChar*)"filtercmd");
-				if (filtercmd) {
-					LOG(Level::DEBUG,
-						"opml::import: adding filter "
-						"command %s to url %s",
-						filtercmd,
-						nurl);
-					nurl.insert(0,
-						strprintf::fmt("filter:%s:",
-							filtercmd));
-					xmlFree(filtercmd);
-				}
-
-				// Filters and scripts may have arguments, so,
-				// quote them when needed.
-				const std::string quoted_url = utils::quote_if_necessary(nurl);
-
-				LOG(Level::DEBUG,
-					"opml::import: size = %" PRIu64,
-					static_cast<uint64_t>(urlcfg.get_urls().size()));
-
-				auto& urls = urlcfg.get_urls();
-				if (std::find(urls.begin(), urls.end(), quoted_url) == urls.end()) {
-					LOG(Level::DEBUG, "opml::import: added url = %s", quoted_url);
-					urls.push_back(quoted_url);
-					if (tag.length() > 0) {
-						LOG(Level::DEBUG,
-							"opml::import: appending tag %s to url %s",
-							tag,
-							quoted_url);
-						urlcfg.get_tags(quoted_url).push_back(tag);
-					}
-				} else {
-					LOG(Level::DEBUG,
-						"opml::import: url = %s is already in list",
-						quoted_url);
-				}
-			} else {
-				char* text = (char*)xmlGetProp(
-						node, (const xmlChar*)"text");
-				if (!text) {
-					text = (char*)xmlGetProp(
-							node, (const xmlChar*)"title");
-				}
-				if (text) {
-					if (newtag.length() > 0) {
-						newtag.append("/");
-					}
-					newtag.append(text);
-					xmlFree(text);
-				}
+		const char* name = (const char*)xmlTextReaderConstLocalName(reader);
+		const bool empty = xmlTextReaderIsEmptyElement(reader) == 1;
+		if (!in_body) {
+			if (depth == body_depth && strcmp(name, "body") == 0 && !empty) {
+				LOG(Level::DEBUG, "opml::read_outlines: found body");
+				in_body = true;
 			}
+			continue;
 		}
-		rec_find_rss_outlines(urlcfg, node->children, newtag);
 
-		node = node->next;
+		const std::string tag = tags.empty() ? "" : tags.back();
+		std::string child_tag = tag;
+		if (strcmp(name, "outline") == 0) {
+			Outline outline;
+			outline.type = attribute(reader, "type");
+			outline.xml_url = attribute(reader, "xmlUrl");
+			outline.url = attribute(reader, "url");
+			outline.text = attribute(reader, "text");
+			outline.title = attribute(reader, "title");
+			outline.filtercmd = attribute(reader, "filtercmd");
+			child_tag = visit(outline, tag);
+		}
+		if (!empty) {
+			tags.push_back(child_tag);
+		}
 	}
+	return ret == 0 && read_anything;
 }
 
 nonstd::optional<std::string> opml::import(
 	const std::string& filename,
 	FileUrlReader& urlcfg)
 {
-	xmlDoc* doc = xmlReadFile(filename.c_str(), nullptr, 0);
-	if (doc == nullptr) {
+	auto& urls = urlcfg.get_urls();
+	std::unordered_set<std::string> known(urls.begin(), urls.end());
+
+	// Nothing is added unless the whole file could be read
+	std::vector<std::pair<std::string, std::string>> added;
+	xmlTextReaderPtr reader = xmlReaderForFile(filename.c_str(), nullptr, 0);
+	const bool complete = read_outlines(reader, [&](const Outline& outline,
+	const std::string& tag) {
+		const std::string url = feed_url(outline);
+		if (!url.empty()) {
+			if (known.insert(url).second) {
+				LOG(Level::DEBUG, "opml::import: added url = %s", url);
+				added.emplace_back(url, tag);
+			} else {
+				LOG(Level::DEBUG, "opml::import: url = %s is already in list", url);
+			}
+			return tag;
+		}
+
+		const std::string& text = outline.text.empty() ? outline.title :
+			outline.text;
+		if (text.empty()) {
+			return tag;
+		}
+		return tag.empty() ? text : tag + "/" + text;
+	});
+	if (reader != nullptr) {
+		xmlFreeTextReader(reader);
+	}
+	if (!complete) {
 		return strprintf::fmt(_("Error: failed to parse OPML file \"%s\""), filename);
 	}
 
-	nonstd::optional<std::string> error_message;
-
-	xmlNode* root = xmlDocGetRootElement(doc);
-	for (xmlNode* node = root->children; node != nullptr;
-		node = node->next) {
-		if (strcmp((const char*)node->name, "body") == 0) {
-			LOG(Level::DEBUG, "opml::import: found body");
-			rec_find_rss_outlines(urlcfg, node->children, "");
-
-			error_message = urlcfg.write_config();
-			if (error_message.has_value()) {
-				break;
-			}
+	LOG(Level::DEBUG,
+		"opml::import: adding %" PRIu64 " of the urls",
+		static_cast<uint64_t>(added.size()));
+	urls.reserve(urls.size() + added.size());
+	for (const auto& entry : added) {
+		urls.push_back(entry.first);
+		if (!entry.second.empty()) {
+			urlcfg.get_tags(entry.first).push_back(entry.second);
 		}
 	}
 
-	xmlFreeDoc(doc);
-
-	return error_message;
+	return urlcfg.write_config();
 }
 
 } // namespace newsboat
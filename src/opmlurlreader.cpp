@@ -1,7 +1,9 @@
 #include "opmlurlreader.h"
 
-#include <cstring>
+#include <cinttypes>
+#include <libxml/xmlreader.h>
 
+#include "opml.h"
 #include "utils.h"
 
 namespace newsboat {
@@ -24,86 +26,64 @@ nonstd::optional<utils::ReadTextFileError> OpmlUrlReader::reload()
 		LOG(Level::DEBUG,
 			"OpmlUrlReader::reload: downloading `%s'",
 			url);
-		std::string urlcontent = utils::retrieve_url(url, cfg);
+		CachedOpml& cached = cache[url];
+		const std::string urlcontent = utils::retrieve_url(url, handle, cfg, "",
+				nullptr, utils::HTTPMethod::GET, &cached.request);
+
+		if (cached.request.not_modified) {
+			LOG(Level::DEBUG,
+				"OpmlUrlReader::reload: `%s' didn't change, using the %" PRIu64
+				" feeds it had last time",
+				url,
+				static_cast<uint64_t>(cached.feeds.size()));
+			for (const auto& feed : cached.feeds) {
+				add_feed(feed.first, feed.second);
+			}
+			continue;
+		}
 
-		xmlDoc* doc =
-			xmlParseMemory(urlcontent.c_str(), urlcontent.length());
+		cached.feeds.clear();
+		xmlTextReaderPtr reader = xmlReaderForMemory(urlcontent.c_str(),
+				urlcontent.length(), url.c_str(), nullptr, 0);
+		const bool complete = opml::read_outlines(reader,
+		[&](const opml::Outline& outline, const std::string& tag) {
+			if (outline.type == "rss") {
+				if (!outline.xml_url.empty()) {
+					cached.feeds.emplace_back(outline.xml_url, tag);
+				}
+				return tag;
+			}
+			if (outline.title.empty()) {
+				return tag;
+			}
+			return tag.empty() ? outline.title : tag + "/" + outline.title;
+		});
+		if (reader != nullptr) {
+			xmlFreeTextReader(reader);
+		}
 
-		if (doc == nullptr) {
+		if (!complete) {
 			LOG(Level::ERROR,
 				"OpmlUrlReader::reload: parsing XML file `%s'"
 				"failed", url);
+			cache.erase(url);
 			continue;
 		}
 
-		xmlNode* root = xmlDocGetRootElement(doc);
-
-		if (root) {
-			for (xmlNode* node = root->children; node != nullptr;
-				node = node->next) {
-				if (strcmp((const char*)node->name, "body") ==
-					0) {
-					LOG(Level::DEBUG,
-						"OpmlUrlReader::reload: found "
-						"body");
-					rec_find_rss_outlines(
-						node->children, "");
-				}
-			}
+		for (const auto& feed : cached.feeds) {
+			add_feed(feed.first, feed.second);
 		}
-
-		xmlFreeDoc(doc);
 	}
 
 	return {};
 }
 
-void OpmlUrlReader::handle_node(xmlNode* node, const std::string& tag)
+void OpmlUrlReader::add_feed(const std::string& url, const std::string& tag)
 {
-	if (node) {
-		char* rssurl =
-			(char*)xmlGetProp(node, (const xmlChar*)"xmlUrl");
-		if (rssurl && strlen(rssurl) > 0) {
-			std::string theurl(rssurl);
-			urls.push_back(theurl);
-			if (tag.length() > 0) {
-				std::vector<std::string> tmptags;
-				tmptags.push_back(tag);
-				tags[theurl] = tmptags;
-				alltags.insert(tag);
-			}
-		}
-		if (rssurl) {
-			xmlFree(rssurl);
-		}
-	}
-}
-
-void OpmlUrlReader::rec_find_rss_outlines(xmlNode* node, std::string tag)
-{
-	while (node) {
-		char* type = (char*)xmlGetProp(node, (const xmlChar*)"type");
-
-		std::string newtag = tag;
-
-		if (strcmp((const char*)node->name, "outline") == 0) {
-			if (type && strcmp(type, "rss") == 0) {
-				handle_node(node, tag);
-				xmlFree(type);
-			} else {
-				char* text = (char*)xmlGetProp(
-						node, (const xmlChar*)"title");
-				if (text) {
-					if (newtag.length() > 0) {
-						newtag.append("/");
-					}
-					newtag.append(text);
-					xmlFree(text);
-				}
-			}
-		}
-		rec_find_rss_outlines(node->children, newtag);
-		node = node->next;
+	urls.push_back(url);
+	if (tag.length() > 0) {
+		tags[url] = {tag};
+		alltags.insert(tag);
 	}
 }
 
@@ -1,5 +1,6 @@
 #include "pbcontroller.h"
 
+#include <chrono>
 #include <cinttypes>
 #include <cstdint>
 #include <cstdio>
@@ -9,10 +10,13 @@
 #include <iostream>
 #include <pwd.h>
 #include <signal.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
 
 #include "config.h"
 #include "configcontainer.h"
@@ -22,7 +26,6 @@
 #include "matcherexception.h"
 #include "nullconfigactionhandler.h"
 #include "pbview.h"
-#include "poddlthread.h"
 #include "queueloader.h"
 #include "strprintf.h"
 #include "utils.h"
@@ -36,6 +39,38 @@ static void ctrl_c_action(int sig)
 	::exit(EXIT_FAILURE);
 }
 
+static volatile sig_atomic_t daemon_stop_requested = 0;
+
+static void daemon_stop_action(int /* sig */)
+{
+	daemon_stop_requested = 1;
+}
+
+/// Keeps background downloads out of the way of everything else: the
+/// process gets the lowest CPU priority and, on Linux, idle I/O priority,
+/// which the download thread inherits.
+static void lower_priority()
+{
+#ifdef __linux__
+	// ioprio_set() has no wrapper in glibc; the constants are from
+	// linux/ioprio.h
+	const int IOPRIO_WHO_PROCESS = 1;
+	const int IOPRIO_CLASS_IDLE = 3;
+	const int IOPRIO_CLASS_SHIFT = 13;
+	if (::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+			IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+		LOG(Level::WARN,
+			"lower_priority: can't set idle I/O priority: %s",
+			std::strerror(errno));
+	}
+#endif
+	if (::setpriority(PRIO_PROCESS, 0, 19) != 0) {
+		LOG(Level::WARN,
+			"lower_priority: can't lower CPU priority: %s",
+			std::strerror(errno));
+	}
+}
+
 namespace podboat {
 
 /**
@@ -178,7 +213,7 @@ void PbController::initialize(int argc, char* argv[])
 
 	::signal(SIGINT, ctrl_c_action);
 
-	static const char getopt_str[] = "C:q:d:l:havV";
+	static const char getopt_str[] = "C:q:d:l:haDvV";
 	static const struct option longopts[] = {
 		{"config-file", required_argument, 0, 'C'},
 		{"queue-file", required_argument, 0, 'q'},
@@ -186,6 +221,7 @@ void PbController::initialize(int argc, char* argv[])
 		{"log-level", required_argument, 0, 'l'},
 		{"help", no_argument, 0, 'h'},
 		{"autodownload", no_argument, 0, 'a'},
+		{"daemon", no_argument, 0, 'D'},
 		{"version", no_argument, 0, 'v'},
 		{0, 0, 0, 0}
 	};
@@ -206,6 +242,9 @@ void PbController::initialize(int argc, char* argv[])
 		case 'a':
 			automatic_dl = true;
 			break;
+		case 'D':
+			daemon = true;
+			break;
 		case 'd':
 			logger::set_logfile(optarg);
 			break;
@@ -259,6 +298,7 @@ void PbController::initialize(int argc, char* argv[])
 
 	cfgparser.register_handler("bind-key", keys);
 	cfgparser.register_handler("unbind-key", keys);
+	cfgparser.register_handler("download-speed-schedule", schedule);
 
 	NullConfigActionHandler null_cah;
 	cfgparser.register_handler("macro", null_cah);
@@ -295,8 +335,11 @@ int PbController::run(PbView& v)
 
 	v.set_keymap(&keys);
 
+	downloader.reset(new DownloadManager(cfg, schedule));
+
 	v.run(automatic_dl, cfg.get_configvalue_as_bool("wrap-scroll"));
 
+	downloader.reset();
 	Stfl::reset();
 
 	std::cout << _("Cleaning up queue...");
@@ -309,6 +352,83 @@ int PbController::run(PbView& v)
 	return EXIT_SUCCESS;
 }
 
+int PbController::run_daemon()
+{
+	max_dls = cfg.get_configvalue_as_int("max-downloads");
+
+	std::cout << _("done.") << std::endl;
+
+	::signal(SIGINT, daemon_stop_action);
+	::signal(SIGTERM, daemon_stop_action);
+	lower_priority();
+
+	ql.reset(new QueueLoader(queue_file, cfg, []() {}));
+	downloader.reset(new DownloadManager(cfg, schedule));
+
+	// What was last said about each download, by URL
+	std::unordered_map<std::string, DlStatus> reported;
+	while (!daemon_stop_requested) {
+		// The queue points into `downloads_`, which reload() reassigns;
+		// it doesn't while anything is being downloaded
+		downloader->clear_queue();
+		ql->reload(downloads_);
+
+		for (auto& download : downloads_) {
+			// Left incomplete the last time
+			if (download.status() == DlStatus::ALREADY_DOWNLOADED
+				&& ::access((download.filename()
+						+ ConfigContainer::PARTIAL_FILE_SUFFIX).c_str(), F_OK) == 0) {
+				download.set_status(DlStatus::QUEUED);
+			}
+		}
+		start_downloads();
+
+		for (const auto& download : downloads_) {
+			const DlStatus status = download.status();
+			const auto last = reported.insert({download.url(), status});
+			// Only what happened since the daemon started is news
+			if (last.second || last.first->second == status) {
+				continue;
+			}
+			last.first->second = status;
+			switch (status) {
+			case DlStatus::READY:
+				std::cout << strprintf::fmt(_("Downloaded %s"),
+						download.filename())
+					<< std::endl;
+				break;
+			case DlStatus::FAILED:
+			case DlStatus::RENAME_FAILED:
+				std::cout << strprintf::fmt(_("Failed to download %s: %s"),
+						download.url(),
+						download.status_msg())
+					<< std::endl;
+				break;
+			default:
+				break;
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+
+	std::cout << _("Cleaning up queue...");
+	std::cout.flush();
+
+	// Interrupted downloads keep their partial files, and resume next time
+	downloader.reset();
+	for (auto& download : downloads_) {
+		if (download.status() == DlStatus::DOWNLOADING) {
+			download.set_status(DlStatus::ALREADY_DOWNLOADED);
+		}
+	}
+	ql->reload(downloads_);
+
+	std::cout << _("done.") << std::endl;
+
+	return EXIT_SUCCESS;
+}
+
 void PbController::print_usage(const char* argv0)
 {
 	auto msg = strprintf::fmt(
@@ -339,6 +459,12 @@ void PbController::print_usage(const char* argv0)
 			_s("use <queuefile> as queue file")
 		},
 		{'a', "autodownload", "", _s("start download on startup")},
+		{
+			'D',
+			"daemon",
+			"",
+			_s("download queued files in the background, without a user interface")
+		},
 		{
 			'l',
 			"log-level",
@@ -394,6 +520,9 @@ unsigned int PbController::get_maxdownloads()
 
 void PbController::purge_queue()
 {
+	if (downloader != nullptr) {
+		downloader->clear_queue();
+	}
 	if (ql != nullptr) {
 		ql->reload(downloads_, true);
 	}
@@ -412,34 +541,34 @@ double PbController::get_total_kbps()
 
 void PbController::start_downloads()
 {
-	int dl2start = get_maxdownloads() - downloads_in_progress();
 	for (auto& download : downloads_) {
-		if (dl2start == 0) {
-			break;
-		}
-
 		if (download.status() == DlStatus::QUEUED) {
-			start_download(download);
-			--dl2start;
+			downloader->enqueue(download);
 		}
 	}
 }
 
+void PbController::stop_automatic_downloads()
+{
+	downloader->clear_queue();
+}
+
 void PbController::start_download(Download& item)
 {
-	std::thread t{PodDlThread(&item, &cfg)};
-	t.detach();
+	downloader->start_now(item);
 }
 
 void PbController::increase_parallel_downloads()
 {
 	++max_dls;
+	downloader->set_max_downloads(max_dls);
 }
 
 void PbController::decrease_parallel_downloads()
 {
 	if (max_dls > 1) {
 		--max_dls;
+		downloader->set_max_downloads(max_dls);
 	}
 }
 
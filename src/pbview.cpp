@@ -1,5 +1,7 @@
 #include "pbview.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
@@ -23,6 +25,17 @@ using namespace newsboat;
 
 namespace podboat {
 
+namespace {
+
+/// How many lines past the screen are handed to STFL, on each side of the
+/// cursor
+const std::uint32_t MIN_SCROLL_MARGIN = 64;
+
+/// How often the list is drawn again at most while downloads are running
+const std::chrono::milliseconds MIN_REDRAW_INTERVAL(250);
+
+}
+
 PbView::PbView(PbController* c)
 	: update_view(true)
 	, ctrl(c)
@@ -55,48 +68,23 @@ void PbView::run(bool auto_download, bool wrap_scroll)
 
 	set_dllist_keymap_hint();
 
+	// The download threads ask for updates far more often than anyone can
+	// read them, so they're shown at most every so often. The effects of
+	// keys are shown right away.
+	auto last_draw = std::chrono::steady_clock::now() - MIN_REDRAW_INTERVAL;
+	bool key_pressed = true;
 	do {
-		if (update_view) {
-			const double total_kbps = ctrl->get_total_kbps();
-			const auto speed = get_speed_human_readable(total_kbps);
-
-			auto title = strprintf::fmt(
-					_("Queue (%u downloads in progress, %u total) - %.2f %s total"),
-					static_cast<unsigned int>(ctrl->downloads_in_progress()),
-					static_cast<unsigned int>(ctrl->downloads().size()),
-					speed.first,
-					speed.second);
-
-			if (ctrl->get_maxdownloads() > 1) {
-				title += strprintf::fmt(_(" - %u parallel downloads"), ctrl->get_maxdownloads());
-			}
-
-			dllist_form.set("head", title);
-
-			LOG(Level::DEBUG,
-				"PbView::run: updating view... "
-				"downloads().size() "
-				"= %" PRIu64,
-				static_cast<uint64_t>(ctrl->downloads().size()));
-
-			ListFormatter listfmt;
-			const std::string line_format =
-				ctrl->get_cfgcont()->get_configvalue("podlist-format");
-
-			dllist_form.run(-3); // compute all widget dimensions
-			const unsigned int width = downloads_list.get_width();
-
-			unsigned int i = 0;
-			for (const auto& dl : ctrl->downloads()) {
-				auto lbuf = format_line(line_format, dl, i, width);
-				listfmt.add_line(lbuf);
-				i++;
-			}
-
-			downloads_list.stfl_replace_lines(listfmt);
-
+		const auto since_draw = std::chrono::steady_clock::now() - last_draw;
+		if (update_view && (key_pressed || since_draw >= MIN_REDRAW_INTERVAL)) {
 			update_view = false;
+			draw_downloads();
+			last_draw = std::chrono::steady_clock::now();
+		} else if (!downloads_list.window_covers_viewport()) {
+			// The cursor has scrolled out of the lines that were handed to
+			// STFL
+			draw_downloads();
 		}
+		key_pressed = false;
 
 		// If there's no status message, we know there's no error to show
 		// Thus, it's safe to replace with the download's status
@@ -105,7 +93,15 @@ void PbView::run(bool auto_download, bool wrap_scroll)
 			dllist_form.set("msg", ctrl->downloads()[idx].status_msg());
 		}
 
-		const char* event = dllist_form.run(500);
+		int timeout = 500;
+		if (update_view) {
+			const auto until_draw = MIN_REDRAW_INTERVAL
+				- (std::chrono::steady_clock::now() - last_draw);
+			timeout = std::max<int>(1, std::min<int>(timeout,
+						std::chrono::duration_cast<std::chrono::milliseconds>(
+							until_draw).count()));
+		}
+		const char* event = dllist_form.run(timeout);
 
 		if (auto_download) {
 			if (ctrl->get_maxdownloads() >
@@ -118,6 +114,7 @@ void PbView::run(bool auto_download, bool wrap_scroll)
 			continue;
 		}
 
+		key_pressed = true;
 		if (strcmp(event, "RESIZE") == 0) {
 			handle_resize();
 			continue;
@@ -156,6 +153,9 @@ void PbView::run(bool auto_download, bool wrap_scroll)
 			break;
 		case OP_PB_TOGGLE_DLALL:
 			auto_download = !auto_download;
+			if (!auto_download) {
+				ctrl->stop_automatic_downloads();
+			}
 			break;
 		case OP_HARDQUIT:
 		case OP_QUIT:
@@ -263,6 +263,49 @@ void PbView::run(bool auto_download, bool wrap_scroll)
 	} while (!quit);
 }
 
+void PbView::draw_downloads()
+{
+	const auto& downloads = ctrl->downloads();
+	const double total_kbps = ctrl->get_total_kbps();
+	const auto speed = get_speed_human_readable(total_kbps);
+
+	auto title = strprintf::fmt(
+			_("Queue (%u downloads in progress, %u total) - %.2f %s total"),
+			static_cast<unsigned int>(ctrl->downloads_in_progress()),
+			static_cast<unsigned int>(downloads.size()),
+			speed.first,
+			speed.second);
+
+	if (ctrl->get_maxdownloads() > 1) {
+		title += strprintf::fmt(_(" - %u parallel downloads"), ctrl->get_maxdownloads());
+	}
+
+	dllist_form.set("head", title);
+
+	LOG(Level::DEBUG,
+		"PbView::draw_downloads: updating view... "
+		"downloads().size() "
+		"= %" PRIu64,
+		static_cast<uint64_t>(downloads.size()));
+
+	const std::string line_format =
+		ctrl->get_cfgcont()->get_configvalue("podlist-format");
+
+	dllist_form.run(-3); // compute all widget dimensions
+	const unsigned int width = downloads_list.get_width();
+
+	// Only the downloads around the cursor are formatted; of those, only
+	// the lines that changed are handed to STFL again
+	const auto window = downloads_list.window_around_cursor(downloads.size(),
+			MIN_SCROLL_MARGIN);
+	ListFormatter listfmt;
+	for (std::uint32_t i = window.first; i < window.second; ++i) {
+		listfmt.add_line(format_line(line_format, downloads[i], i, width));
+	}
+
+	downloads_list.stfl_replace_window(listfmt, window.first, downloads.size());
+}
+
 void PbView::handle_resize()
 {
 	std::vector<std::reference_wrapper<newsboat::Stfl::Form>> forms = {dllist_form, help_form};
@@ -0,0 +1,315 @@
+#include "processrunner.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+/// How often run() checks on programs that closed their standard output,
+/// but haven't exited yet.
+const int REAP_INTERVAL_MS = 50;
+
+const std::size_t READ_CHUNK_SIZE = 65536;
+
+void close_fd(int& fd)
+{
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+void set_cloexec(int fd)
+{
+	::fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+void set_nonblocking(int fd)
+{
+	::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+}
+
+ProcessRunner::ProcessRunner(unsigned int max_processes)
+	: max_processes(max_processes)
+	, finished(false)
+{
+	if (::pipe(wake_pipe) == -1) {
+		LOG(Level::ERROR, "ProcessRunner: couldn't create the wake-up pipe");
+		wake_pipe[0] = -1;
+		wake_pipe[1] = -1;
+		return;
+	}
+	for (const int fd : wake_pipe) {
+		set_cloexec(fd);
+		set_nonblocking(fd);
+	}
+}
+
+ProcessRunner::~ProcessRunner()
+{
+	for (auto& process : running) {
+		close_fd(process.stdin_fd);
+		close_fd(process.stdout_fd);
+		::kill(process.pid, SIGKILL);
+		::waitpid(process.pid, nullptr, 0);
+	}
+	close_fd(wake_pipe[0]);
+	close_fd(wake_pipe[1]);
+}
+
+void ProcessRunner::add(std::vector<std::string> argv,
+	nonstd::optional<std::string> input,
+	Callback done)
+{
+	Process process;
+	process.argv = std::move(argv);
+	process.input = std::move(input);
+	process.done = std::move(done);
+	{
+		std::lock_guard<std::mutex> guard(queue_mutex);
+		queued.push_back(std::move(process));
+	}
+	wake_up();
+}
+
+void ProcessRunner::finish()
+{
+	{
+		std::lock_guard<std::mutex> guard(queue_mutex);
+		finished = true;
+	}
+	wake_up();
+}
+
+void ProcessRunner::run()
+{
+	LOG(Level::DEBUG, "ProcessRunner::run: started");
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> guard(queue_mutex);
+			start_queued_unlocked();
+			if (running.empty() && failed.empty() && queued.empty() && finished) {
+				break;
+			}
+		}
+		std::vector<Callback> done = std::move(failed);
+		failed.clear();
+		for (auto& callback : done) {
+			callback(-1, "");
+		}
+		if (!running.empty() || done.empty()) {
+			wait_for_activity();
+		}
+		reap();
+	}
+	LOG(Level::DEBUG, "ProcessRunner::run: finished");
+}
+
+void ProcessRunner::start_queued_unlocked()
+{
+	while (!queued.empty()
+		&& (max_processes == 0 || running.size() < max_processes)) {
+		Process process = std::move(queued.front());
+		queued.pop_front();
+		if (spawn(process)) {
+			running.push_back(std::move(process));
+		} else {
+			LOG(Level::ERROR,
+				"ProcessRunner::start_queued_unlocked: couldn't start %s",
+				process.argv.empty() ? std::string() : process.argv[0]);
+			failed.push_back(std::move(process.done));
+		}
+	}
+}
+
+bool ProcessRunner::spawn(Process& process)
+{
+	if (process.argv.empty()) {
+		return false;
+	}
+
+	int out[2];
+	if (::pipe(out) == -1) {
+		return false;
+	}
+	int in[2] = {-1, -1};
+	if (process.input && ::pipe(in) == -1) {
+		::close(out[0]);
+		::close(out[1]);
+		return false;
+	}
+	for (const int fd : {
+			out[0], out[1], in[0], in[1]
+		}) {
+		if (fd != -1) {
+			set_cloexec(fd);
+		}
+	}
+
+	// Nothing but async-signal-safe calls happen after fork, so everything
+	// the child needs is prepared here
+	std::vector<char*> argv;
+	for (auto& arg : process.argv) {
+		argv.push_back(&arg[0]);
+	}
+	argv.push_back(nullptr);
+	const int devnull = ::open("/dev/null", O_WRONLY);
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		if (in[0] != -1) {
+			::dup2(in[0], STDIN_FILENO);
+		}
+		::dup2(out[1], STDOUT_FILENO);
+		if (devnull != -1) {
+			::dup2(devnull, STDERR_FILENO);
+		}
+		::execvp(argv[0], argv.data());
+		::_exit(127);
+	}
+
+	if (devnull != -1) {
+		::close(devnull);
+	}
+	::close(out[1]);
+	if (in[0] != -1) {
+		::close(in[0]);
+	}
+	if (pid == -1) {
+		::close(out[0]);
+		close_fd(in[1]);
+		return false;
+	}
+
+	process.pid = pid;
+	process.stdout_fd = out[0];
+	set_nonblocking(process.stdout_fd);
+	process.stdin_fd = in[1];
+	if (process.stdin_fd != -1) {
+		set_nonblocking(process.stdin_fd);
+		if (process.input->empty()) {
+			close_fd(process.stdin_fd);
+		}
+	}
+	return true;
+}
+
+void ProcessRunner::wait_for_activity()
+{
+	std::vector<pollfd> fds;
+	std::vector<Process*> owners;
+	fds.push_back(pollfd{wake_pipe[0], POLLIN, 0});
+	owners.push_back(nullptr);
+	bool exiting = false;
+	for (auto& process : running) {
+		if (process.stdout_fd != -1) {
+			fds.push_back(pollfd{process.stdout_fd, POLLIN, 0});
+			owners.push_back(&process);
+		} else {
+			exiting = true;
+		}
+		if (process.stdin_fd != -1) {
+			fds.push_back(pollfd{process.stdin_fd, POLLOUT, 0});
+			owners.push_back(&process);
+		}
+	}
+
+	if (::poll(fds.data(), fds.size(), exiting ? REAP_INTERVAL_MS : -1) <= 0) {
+		return;
+	}
+
+	if (fds[0].revents != 0) {
+		char buffer[64];
+		while (::read(wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+		}
+	}
+	for (std::size_t i = 1; i < fds.size(); ++i) {
+		if (fds[i].revents == 0) {
+			continue;
+		}
+		if (fds[i].fd == owners[i]->stdout_fd) {
+			read_output(*owners[i]);
+		} else {
+			write_input(*owners[i]);
+		}
+	}
+}
+
+void ProcessRunner::read_output(Process& process)
+{
+	char buffer[READ_CHUNK_SIZE];
+	for (;;) {
+		const ssize_t got = ::read(process.stdout_fd, buffer, sizeof(buffer));
+		if (got > 0) {
+			process.output.append(buffer, got);
+		} else if (got == -1 && errno == EINTR) {
+			continue;
+		} else {
+			if (got == 0 || errno != EAGAIN) {
+				close_fd(process.stdout_fd);
+			}
+			return;
+		}
+	}
+}
+
+void ProcessRunner::write_input(Process& process)
+{
+	const std::string& input = *process.input;
+	while (process.written < input.size()) {
+		const ssize_t wrote = ::write(process.stdin_fd,
+				input.data() + process.written, input.size() - process.written);
+		if (wrote > 0) {
+			process.written += wrote;
+		} else if (wrote == -1 && errno == EINTR) {
+			continue;
+		} else {
+			if (errno != EAGAIN) {
+				// The program doesn't read the rest, e.g. it exited
+				close_fd(process.stdin_fd);
+			}
+			return;
+		}
+	}
+	close_fd(process.stdin_fd);
+}
+
+void ProcessRunner::reap()
+{
+	for (auto process = running.begin(); process != running.end(); ) {
+		int status = 0;
+		if (process->stdout_fd != -1
+			|| ::waitpid(process->pid, &status, WNOHANG) != process->pid) {
+			++process;
+			continue;
+		}
+		close_fd(process->stdin_fd);
+		const int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+		Callback done = std::move(process->done);
+		std::string output = std::move(process->output);
+		process = running.erase(process);
+		done(exit_status, std::move(output));
+	}
+}
+
+void ProcessRunner::wake_up()
+{
+	const char byte = 0;
+	if (::write(wake_pipe[1], &byte, 1) < 0) {
+		// The pipe is full, so run() wakes up anyway
+	}
+}
+
+} // namespace newsboat
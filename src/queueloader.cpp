@@ -7,7 +7,9 @@
 #include <fstream>
 #include <iostream>
 #include <libgen.h>
+#include <sstream>
 #include <unistd.h>
+#include <unordered_set>
 
 #include "config.h"
 #include "configcontainer.h"
@@ -30,7 +32,7 @@ QueueLoader::QueueLoader(const std::string& filepath,
 }
 
 void QueueLoader::reload(std::vector<Download>& downloads,
-	bool also_remove_finished) const
+	bool also_remove_finished)
 {
 	CategorizedDownloads categorized_downloads;
 	const auto res = categorize_downloads(downloads, also_remove_finished);
@@ -39,8 +41,30 @@ void QueueLoader::reload(std::vector<Download>& downloads,
 	}
 	categorized_downloads = res.value();
 
-	update_from_queue_file(categorized_downloads);
-	write_queue_file(categorized_downloads);
+	// If the file is as the last call left it, everything in it is in
+	// `downloads` already
+	const auto stamp = FileStamp::of(queuefile);
+	if (stamp != loaded_stamp) {
+		std::ifstream f(queuefile);
+		std::ostringstream contents;
+		if (f.is_open()) {
+			contents << f.rdbuf();
+		}
+		loaded_stamp = stamp;
+		loaded_contents = contents.str();
+		update_from_queue_file(categorized_downloads, loaded_contents);
+	}
+
+	const std::string contents = format_queue_file(categorized_downloads);
+	if (contents != loaded_contents) {
+		std::fstream f(queuefile, std::fstream::out);
+		if (f.is_open()) {
+			f << contents;
+			f.close();
+			loaded_stamp = FileStamp::of(queuefile);
+			loaded_contents = contents;
+		}
+	}
 	if (cfg.get_configvalue_as_bool("delete-played-files")) {
 		delete_played_files(categorized_downloads);
 	}
@@ -102,13 +126,18 @@ nonstd::optional<QueueLoader::CategorizedDownloads> QueueLoader::categorize_down
 	return result;
 }
 
-void QueueLoader::update_from_queue_file(CategorizedDownloads& downloads) const
+void QueueLoader::update_from_queue_file(CategorizedDownloads& downloads,
+	const std::string& contents) const
 {
-	std::fstream f(queuefile, std::fstream::in);
-	if (!f.is_open()) {
-		return;
+	std::unordered_set<std::string> known_urls;
+	for (const auto& dl : downloads.to_keep) {
+		known_urls.insert(dl.url());
+	}
+	for (const auto& dl : downloads.to_delete) {
+		known_urls.insert(dl.url());
 	}
 
+	std::istringstream f(contents);
 	bool comments_ignored = false;
 	for (std::string line; std::getline(f, line); ) {
 		if (line.empty()) {
@@ -119,7 +148,6 @@ void QueueLoader::update_from_queue_file(CategorizedDownloads& downloads) const
 			"QueueLoader::reload: loaded `%s' from queue file",
 			line);
 		const std::vector<std::string> fields = utils::tokenize_quoted(line);
-		bool url_found = false;
 
 		if (fields.empty()) {
 			if (!comments_ignored) {
@@ -137,27 +165,11 @@ void QueueLoader::update_from_queue_file(CategorizedDownloads& downloads) const
 			continue;
 		}
 
-		for (const auto& dl : downloads.to_keep) {
-			if (fields[0] == dl.url()) {
-				LOG(Level::INFO,
-					"QueueLoader::reload: found `%s' in old vector",
-					fields[0]);
-				url_found = true;
-				break;
-			}
-		}
-
-		for (const auto& dl : downloads.to_delete) {
-			if (fields[0] == dl.url()) {
-				LOG(Level::INFO,
-					"QueueLoader::reload: found `%s' in scheduled for deletion vector",
-					fields[0]);
-				url_found = true;
-				break;
-			}
-		}
-
-		if (url_found) {
+		// Also skips the later of two lines with the same URL
+		if (!known_urls.insert(fields[0]).second) {
+			LOG(Level::INFO,
+				"QueueLoader::reload: found `%s' in old vector",
+				fields[0]);
 			continue;
 		}
 
@@ -203,13 +215,10 @@ void QueueLoader::update_from_queue_file(CategorizedDownloads& downloads) const
 	}
 }
 
-void QueueLoader::write_queue_file(const CategorizedDownloads& downloads) const
+std::string QueueLoader::format_queue_file(const CategorizedDownloads&
+	downloads)
 {
-	std::fstream f(queuefile, std::fstream::out);
-	if (!f.is_open()) {
-		return;
-	}
-
+	std::ostringstream f;
 	for (const auto& dl : downloads.to_keep) {
 		f << dl.url() << " " << utils::quote(dl.filename());
 		switch (dl.status()) {
@@ -235,8 +244,9 @@ void QueueLoader::write_queue_file(const CategorizedDownloads& downloads) const
 		case DlStatus::RENAME_FAILED:
 			break;
 		}
-		f << std::endl;
+		f << '\n';
 	}
+	return f.str();
 }
 
 void QueueLoader::delete_played_files(const CategorizedDownloads& downloads)
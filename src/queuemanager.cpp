@@ -1,9 +1,11 @@
 #include "queuemanager.h"
 
+#include <cinttypes>
 #include <fstream>
 #include <libxml/uri.h>
 
 #include "fmtstrformatter.h"
+#include "logger.h"
 #include "rssfeed.h"
 #include "utils.h"
 
@@ -20,37 +22,71 @@ EnqueueResult QueueManager::enqueue_url(std::shared_ptr<RssItem> item,
 	const std::string& url = item->enclosure_url();
 	const std::string filename = generate_enqueue_filename(item, feed);
 
-	std::fstream f;
-	f.open(queue_file, std::fstream::in);
-	if (f.is_open()) {
-		do {
-			std::string line;
-			getline(f, line);
-			if (!f.eof() && !line.empty()) {
-				const auto fields = utils::tokenize_quoted(line);
-				if (fields.size() >= 1 && fields[0] == url) {
-					return {EnqueueStatus::URL_QUEUED_ALREADY, url};
-				}
-				if (fields.size() >= 2 && fields[1] == filename) {
-					return {EnqueueStatus::OUTPUT_FILENAME_USED_ALREADY, filename};
-				}
-			}
-		} while (!f.eof());
-		f.close();
+	std::lock_guard<std::mutex> guard(index_mtx);
+	update_index();
+	if (queued_urls.count(url) != 0) {
+		return {EnqueueStatus::URL_QUEUED_ALREADY, url};
+	}
+	if (queued_filenames.count(filename) != 0) {
+		return {EnqueueStatus::OUTPUT_FILENAME_USED_ALREADY, filename};
 	}
 
+	const std::string line = url + " " + utils::quote(filename) + "\n";
+	std::fstream f;
 	f.open(queue_file, std::fstream::app | std::fstream::out);
 	if (!f.is_open()) {
 		return {EnqueueStatus::QUEUE_FILE_OPEN_ERROR, queue_file};
 	}
-	f << url << " " << utils::quote(filename) << std::endl;
+	f << line;
 	f.close();
 
 	item->set_enqueued(true);
 
+	queued_urls.insert(url);
+	queued_filenames.insert(filename);
+	// Unless someone else wrote to the file too, the index is up to date
+	// with what's in it now
+	const auto stamp = FileStamp::of(queue_file);
+	if (stamp.size() == indexed_stamp.size() + line.size()) {
+		indexed_stamp = stamp;
+	} else {
+		indexed_stamp = FileStamp();
+		queued_urls.clear();
+		queued_filenames.clear();
+	}
+
 	return {EnqueueStatus::QUEUED_SUCCESSFULLY, ""};
 }
 
+void QueueManager::update_index()
+{
+	const auto stamp = FileStamp::of(queue_file);
+	if (stamp == indexed_stamp) {
+		return;
+	}
+
+	queued_urls.clear();
+	queued_filenames.clear();
+	std::ifstream f(queue_file);
+	for (std::string line; std::getline(f, line); ) {
+		if (line.empty()) {
+			continue;
+		}
+		const auto fields = utils::tokenize_quoted(line);
+		if (fields.size() >= 1) {
+			queued_urls.insert(fields[0]);
+		}
+		if (fields.size() >= 2) {
+			queued_filenames.insert(fields[1]);
+		}
+	}
+	indexed_stamp = stamp;
+	LOG(Level::DEBUG,
+		"QueueManager::update_index: %" PRIu64 " URLs in %s",
+		static_cast<uint64_t>(queued_urls.size()),
+		queue_file);
+}
+
 std::string get_hostname_from_url(const std::string& url)
 {
 	xmlURIPtr uri = xmlParseURI(url.c_str());
@@ -116,8 +152,14 @@ std::string QueueManager::generate_enqueue_filename(
 
 EnqueueResult QueueManager::autoenqueue(std::shared_ptr<RssFeed> feed)
 {
-	std::lock_guard<std::mutex> lock(feed->item_mutex);
-	for (const auto& item : feed->items()) {
+	const auto lock = feed->lock_items_for_reading();
+	return autoenqueue(feed, feed->items());
+}
+
+EnqueueResult QueueManager::autoenqueue(std::shared_ptr<RssFeed> feed,
+	const std::vector<std::shared_ptr<RssItem>>& items)
+{
+	for (const auto& item : items) {
 		if (item->enqueued() || item->enclosure_url().empty()) {
 			continue;
 		}
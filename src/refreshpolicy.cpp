@@ -0,0 +1,87 @@
+#include "refreshpolicy.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace newsboat {
+
+time_t RefreshHints::parse_ttl(const std::string& ttl)
+{
+	const long minutes = std::strtol(ttl.c_str(), nullptr, 10);
+	return minutes > 0 ? static_cast<time_t>(minutes) * 60 : 0;
+}
+
+time_t RefreshHints::parse_update_period(const std::string& period,
+	const std::string& frequency)
+{
+	time_t seconds = 0;
+	if (period == "hourly") {
+		seconds = 60 * 60;
+	} else if (period == "daily") {
+		seconds = 24 * 60 * 60;
+	} else if (period == "weekly") {
+		seconds = 7 * 24 * 60 * 60;
+	} else if (period == "monthly") {
+		seconds = 30 * 24 * 60 * 60;
+	} else if (period == "yearly") {
+		seconds = 365 * 24 * 60 * 60;
+	} else {
+		return 0;
+	}
+
+	// The Syndication module makes 1 the default frequency
+	const long times = std::strtol(frequency.c_str(), nullptr, 10);
+	if (times > 1) {
+		seconds /= times;
+	}
+	return seconds;
+}
+
+RefreshPolicy::RefreshPolicy(time_t min_interval, time_t max_interval)
+	: min_interval(min_interval)
+	, max_interval(std::max(min_interval, max_interval))
+{
+}
+
+time_t RefreshPolicy::next_check(const RefreshHints& hints,
+	time_t observed_interval,
+	time_t now) const
+{
+	if (hints.pushed) {
+		return now + max_interval;
+	}
+
+	// Checking at half the update interval means most updates are seen
+	// within a quarter of it on average
+	time_t interval = observed_interval > 0 ? observed_interval / 2 : 0;
+	interval = std::max(interval, hints.ttl);
+	interval = std::max(interval, hints.update_period);
+	interval = std::min(std::max(interval, min_interval), max_interval);
+
+	time_t result = now + interval;
+	// The server knows best when its own copy changes, but a broken clock
+	// on its side shouldn't keep the feed from being checked for days
+	const time_t latest = now + max_interval;
+	if (hints.expires > result) {
+		result = std::min(hints.expires, latest);
+	}
+	if (hints.retry_after > result) {
+		result = std::min(hints.retry_after, latest);
+	}
+	return result;
+}
+
+time_t RefreshPolicy::retry_delay(unsigned int failures, time_t first,
+	time_t longest)
+{
+	if (failures < 2) {
+		return 0;
+	}
+	time_t delay = first;
+	for (unsigned int i = 2; i < failures && delay < longest; ++i) {
+		delay *= 2;
+	}
+	return std::min(delay, longest);
+}
+
+} // namespace newsboat
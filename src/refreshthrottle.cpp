@@ -0,0 +1,115 @@
+#include "refreshthrottle.h"
+
+#include <utility>
+
+namespace newsboat {
+
+RefreshThrottle::RefreshThrottle(Refresh refresh, unsigned int per_second)
+	: refresh(std::move(refresh))
+	, per_second(per_second)
+	, dirty(false)
+	, stopping(false)
+	// Long enough ago for the first request to refresh right away
+	, last_refresh(Clock::now() - std::chrono::seconds(1))
+{
+}
+
+RefreshThrottle::~RefreshThrottle()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+		dirty = false;
+	}
+	wakeup.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void RefreshThrottle::set_rate(unsigned int rate)
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		per_second = rate;
+	}
+	wakeup.notify_one();
+}
+
+void RefreshThrottle::request()
+{
+	request(false);
+}
+
+void RefreshThrottle::request_in_background()
+{
+	request(true);
+}
+
+void RefreshThrottle::request(bool in_background)
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		if (stopping) {
+			return;
+		}
+		const auto now = Clock::now();
+		if (in_background || dirty || now - last_refresh < interval()) {
+			// Somebody refreshed a moment ago; the worker catches up with
+			// this request once the interval is over
+			dirty = true;
+			if (!worker.joinable()) {
+				worker = std::thread(&RefreshThrottle::run, this);
+			}
+			wakeup.notify_one();
+			return;
+		}
+		last_refresh = now;
+	}
+	refresh();
+}
+
+bool RefreshThrottle::pending()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return dirty;
+}
+
+void RefreshThrottle::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		wakeup.wait(lock, [this]() {
+			return stopping || dirty;
+		});
+		if (stopping) {
+			return;
+		}
+
+		// Woken up early by set_rate() or a request, which doesn't change
+		// when the refresh is due
+		while (!stopping && Clock::now() < last_refresh + interval()) {
+			wakeup.wait_until(lock, last_refresh + interval());
+		}
+		if (stopping) {
+			return;
+		}
+
+		dirty = false;
+		last_refresh = Clock::now();
+		lock.unlock();
+		refresh();
+		lock.lock();
+	}
+}
+
+RefreshThrottle::Clock::duration RefreshThrottle::interval() const
+{
+	if (per_second == 0) {
+		return Clock::duration::zero();
+	}
+	return std::chrono::duration_cast<Clock::duration>(
+			std::chrono::seconds(1)) / per_second;
+}
+
+} // namespace newsboat
@@ -1,19 +1,48 @@
 #include "regexmanager.h"
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <stack>
+#include <thread>
 
 #include "config.h"
+#include "configexception.h"
 #include "confighandlerexception.h"
 #include "configparser.h"
+#include "executor.h"
 #include "logger.h"
+#include "rssfeed.h"
+#include "rssitem.h"
 #include "strprintf.h"
 #include "utils.h"
 
 namespace newsboat {
 
+namespace {
+
+std::uint64_t next_rules_revision()
+{
+	static std::atomic<std::uint64_t> last(0);
+	return ++last;
+}
+
+std::string command_line(const std::string& action,
+	const std::vector<std::string>& params)
+{
+	std::string line = action;
+	for (const auto& param : params) {
+		line.append(" ");
+		line.append(utils::quote(param));
+	}
+	return line;
+}
+
+}
+
 RegexManager::RegexManager()
+	: rules_revision(next_rules_revision())
 {
 	// this creates the entries in the map. we need them there to have the
 	// "all" location work.
@@ -40,12 +69,14 @@ void RegexManager::handle_action(const std::string& action,
 		throw ConfigHandlerException(
 			ActionHandlerStatus::INVALID_COMMAND);
 	}
-	std::string line = action;
-	for (const auto& param : params) {
-		line.append(" ");
-		line.append(utils::quote(param));
-	}
-	cheat_store_for_dump_config.push_back(line);
+	cheat_store_for_dump_config.push_back(command_line(action, params));
+	literal_rules_by_location.clear();
+	rules_revision = next_rules_revision();
+}
+
+std::uint64_t RegexManager::revision() const
+{
+	return rules_revision;
 }
 
 int RegexManager::article_matches(Matchable* item)
@@ -58,6 +89,25 @@ int RegexManager::article_matches(Matchable* item)
 	return -1;
 }
 
+int RegexManager::article_matches(RssItem* item)
+{
+	if (article_rules_vary) {
+		return article_matches(static_cast<Matchable*>(item));
+	}
+
+	const auto feed = item->get_feedptr();
+	const std::array<std::uint64_t, 3> stamp{{
+			item->revision(), feed != nullptr ? feed->revision() : 0, 0
+		}};
+	auto& memo = item->highlight_memo();
+	if (memo.rules != rules_revision || memo.stamp != stamp) {
+		memo.id = article_matches(static_cast<Matchable*>(item));
+		memo.rules = rules_revision;
+		memo.stamp = stamp;
+	}
+	return memo.id;
+}
+
 int RegexManager::feed_matches(Matchable* feed)
 {
 	for (const auto& Matcher : matchers_feed) {
@@ -68,6 +118,22 @@ int RegexManager::feed_matches(Matchable* feed)
 	return -1;
 }
 
+int RegexManager::feed_matches(RssFeed* feed)
+{
+	std::array<std::uint64_t, 3> stamp{{feed->revision(), 0, 0}};
+	if (feed_rules_count) {
+		stamp[1] = feed->unread_item_count();
+		stamp[2] = feed->total_item_count();
+	}
+	auto& memo = feed->highlight_memo();
+	if (memo.rules != rules_revision || memo.stamp != stamp) {
+		memo.id = feed_matches(static_cast<Matchable*>(feed));
+		memo.rules = rules_revision;
+		memo.stamp = stamp;
+	}
+	return memo.id;
+}
+
 void RegexManager::remove_last_regex(const std::string& location)
 {
 	auto& regexes = locations[location];
@@ -76,6 +142,8 @@ void RegexManager::remove_last_regex(const std::string& location)
 	}
 
 	regexes.pop_back();
+	literal_rules_by_location.clear();
+	rules_revision = next_rules_revision();
 }
 
 std::map<size_t, std::string> RegexManager::extract_style_tags(std::string& str)
@@ -147,27 +215,47 @@ void RegexManager::merge_style_tag(std::map<size_t, std::string>& tags,
 		return;
 	}
 
-	// Find the latest tag occurring before `end`.
-	// It is important that looping executes in ascending order of location.
+	// Find the latest tag occurring before `end`
 	std::string latest_tag = "</>";
-	for (const auto& location_tag : tags) {
-		size_t location = location_tag.first;
-		if (location > end) {
-			break;
-		}
-		latest_tag = location_tag.second;
+	auto after_end = tags.upper_bound(end);
+	if (after_end != tags.begin()) {
+		latest_tag = std::prev(after_end)->second;
 	}
 	tags[start] = tag;
 	tags[end] = latest_tag;
 
 	// Remove any old tags between the start and end marker
-	for (auto it = tags.begin(); it != tags.end(); ) {
-		if (it->first > start && it->first < end) {
-			it = tags.erase(it);
-		} else {
-			++it;
+	tags.erase(tags.upper_bound(start), tags.lower_bound(end));
+}
+
+void RegexManager::set_multi_pattern(bool enabled)
+{
+	multi_pattern = enabled;
+}
+
+std::shared_ptr<const RegexManager::LiteralRules> RegexManager::literal_rules(
+	const std::string& location)
+{
+	const auto cached = literal_rules_by_location.find(location);
+	if (cached != literal_rules_by_location.end()) {
+		return cached->second;
+	}
+
+	const auto& regexes = locations[location];
+	std::vector<std::string> literals;
+	std::vector<unsigned int> rules;
+	for (unsigned int i = 0; i < regexes.size(); ++i) {
+		const auto& regex = regexes[i].first;
+		if (regex != nullptr && LiteralSet::is_literal(regex->pattern())) {
+			literals.push_back(regex->pattern());
+			rules.push_back(i);
 		}
 	}
+
+	auto result = std::make_shared<LiteralRules>(literals);
+	result->rules = std::move(rules);
+	literal_rules_by_location[location] = result;
+	return result;
 }
 
 void RegexManager::quote_and_highlight(std::string& str,
@@ -177,28 +265,54 @@ void RegexManager::quote_and_highlight(std::string& str,
 
 	auto tag_locations = extract_style_tags(str);
 
+	// Occurrences of the rules that are found through a LiteralSet, in the
+	// same order the regex loop below would find them in
+	std::vector<std::vector<std::pair<std::size_t, std::size_t>>> found;
+	std::vector<bool> is_literal(regexes.size(), false);
+	if (multi_pattern) {
+		const auto rules = literal_rules(location);
+		found.resize(regexes.size());
+		for (const auto rule : rules->rules) {
+			is_literal[rule] = true;
+		}
+		// A literal's occurrences end in the same order as they start, so
+		// this picks the leftmost ones that don't overlap
+		for (const auto& match : rules->literals.find_all(str)) {
+			auto& occurrences = found[rules->rules[match.literal]];
+			if (occurrences.empty() || match.start >= occurrences.back().second) {
+				occurrences.emplace_back(match.start, match.end);
+			}
+		}
+	}
+
 	for (unsigned int i = 0; i < regexes.size(); ++i) {
 		const auto& regex = regexes[i].first;
 		if (regex == nullptr) {
 			continue;
 		}
-		unsigned int offset = 0;
+		if (is_literal[i]) {
+			const std::string marker = strprintf::fmt("<%u>", i);
+			for (const auto& occurrence : found[i]) {
+				merge_style_tag(tag_locations, marker, occurrence.first,
+					occurrence.second);
+			}
+			continue;
+		}
+		const std::string marker = strprintf::fmt("<%u>", i);
+		std::size_t offset = 0;
 		int eflags = 0;
 		while (offset < str.length()) {
-			const auto matches = regex->matches(str.substr(offset), 1, eflags);
+			const auto matches = regex->matches(str, offset, 1, eflags);
 			eflags |= REG_NOTBOL; // Don't match beginning-of-line operator (^) in following checks
 			if (matches.empty()) {
 				break;
 			}
 			const auto& match = matches[0];
 			if (match.first != match.second) {
-				const std::string marker = strprintf::fmt("<%u>", i);
-				const int match_start = offset + match.first;
-				const int match_end = offset + match.second;
-				merge_style_tag(tag_locations, marker, match_start, match_end);
-				offset = match_end;
+				merge_style_tag(tag_locations, marker, match.first, match.second);
+				offset = match.second;
 			} else {
-				offset++;
+				offset = match.first + 1;
 			}
 		}
 	}
@@ -220,13 +334,17 @@ void RegexManager::handle_highlight_action(const std::vector<std::string>&
 				_("`%s' is an invalid dialog type"), location));
 	}
 
-	std::string errorMessage;
-	auto regex = Regex::compile(params[1], REG_EXTENDED | REG_ICASE, errorMessage);
-	if (regex == nullptr) {
-		throw ConfigHandlerException(strprintf::fmt(
-				_("`%s' is not a valid regular expression: %s"),
-				params[1],
-				errorMessage));
+	std::shared_ptr<const Regex> regex;
+	if (!deferring) {
+		std::string errorMessage;
+		regex = Regex::compile_shared(params[1], REG_EXTENDED | REG_ICASE,
+				errorMessage);
+		if (regex == nullptr) {
+			throw ConfigHandlerException(strprintf::fmt(
+					_("`%s' is not a valid regular expression: %s"),
+					params[1],
+					errorMessage));
+		}
 	}
 	std::string colorstr;
 	if (params[2] != "default") {
@@ -272,6 +390,7 @@ void RegexManager::handle_highlight_action(const std::vector<std::string>&
 			}
 		}
 	}
+	DeferredRegex pending{params[1], command_line("highlight", params), {}};
 	if (location != "all") {
 		LOG(Level::DEBUG,
 			"RegexManager::handle_action: adding rx = %s "
@@ -279,9 +398,9 @@ void RegexManager::handle_highlight_action(const std::vector<std::string>&
 			params[1],
 			colorstr,
 			location);
-		locations[location].push_back({std::move(regex), colorstr});
+		pending.rules.emplace_back(location, locations[location].size());
+		locations[location].push_back({regex, colorstr});
 	} else {
-		std::shared_ptr<Regex> sharedRegex(std::move(regex));
 		for (auto& location : locations) {
 			LOG(Level::DEBUG,
 				"RegexManager::handle_action: adding "
@@ -290,9 +409,61 @@ void RegexManager::handle_highlight_action(const std::vector<std::string>&
 				params[1],
 				colorstr,
 				location.first);
-			location.second.push_back({sharedRegex, colorstr});
+			pending.rules.emplace_back(location.first, location.second.size());
+			location.second.push_back({regex, colorstr});
+		}
+	}
+	if (deferring) {
+		deferred.push_back(std::move(pending));
+	}
+}
+
+void RegexManager::defer_compiling()
+{
+	deferring = true;
+}
+
+void RegexManager::compile_deferred()
+{
+	deferring = false;
+	std::vector<DeferredRegex> batch;
+	batch.swap(deferred);
+	if (batch.empty()) {
+		return;
+	}
+
+	std::vector<std::shared_ptr<const Regex>> regexes(batch.size());
+	std::vector<std::string> errors(batch.size());
+	std::atomic<std::size_t> next(0);
+	const unsigned int threads = std::min<std::size_t>(batch.size(),
+			std::max(1u, std::thread::hardware_concurrency()));
+	Executor::instance().run_workers(Executor::Pool::CPU,
+		Executor::Priority::HIGH, threads, [&]() {
+		for (std::size_t i = next++; i < batch.size(); i = next++) {
+			regexes[i] = Regex::compile_shared(batch[i].pattern,
+					REG_EXTENDED | REG_ICASE, errors[i]);
+		}
+	});
+	LOG(Level::DEBUG,
+		"RegexManager::compile_deferred: compiled %u regexes on %u threads",
+		static_cast<unsigned int>(batch.size()),
+		threads);
+
+	for (std::size_t i = 0; i < batch.size(); ++i) {
+		if (regexes[i] == nullptr) {
+			throw ConfigException(strprintf::fmt(
+					_("Error while processing command `%s': %s"),
+					batch[i].command,
+					strprintf::fmt(_("`%s' is not a valid regular expression: %s"),
+						batch[i].pattern,
+						errors[i])));
+		}
+		for (const auto& rule : batch[i].rules) {
+			locations[rule.first][rule.second].first = regexes[i];
 		}
 	}
+	literal_rules_by_location.clear();
+	rules_revision = next_rules_revision();
 }
 
 void RegexManager::handle_highlight_item_action(const std::string& action,
@@ -359,11 +530,18 @@ void RegexManager::handle_highlight_item_action(const std::string& action,
 		locations["articlelist"].push_back({nullptr, colorstr});
 		matchers_article.push_back(
 			std::pair<std::shared_ptr<Matcher>, int>(m, pos));
+		article_rules_vary = article_rules_vary
+			|| m->uses_attribute(MatchableAttribute::AGE)
+			|| m->uses_attribute(MatchableAttribute::UNREAD_COUNT)
+			|| m->uses_attribute(MatchableAttribute::TOTAL_COUNT);
 	} else if (action == "highlight-feed") {
 		int pos = locations["feedlist"].size();
 		locations["feedlist"].push_back({nullptr, colorstr});
 		matchers_feed.push_back(
 			std::pair<std::shared_ptr<Matcher>, int>(m, pos));
+		feed_rules_count = feed_rules_count
+			|| m->uses_attribute(MatchableAttribute::UNREAD_COUNT)
+			|| m->uses_attribute(MatchableAttribute::TOTAL_COUNT);
 	} else {
 		throw ConfigHandlerException(
 			ActionHandlerStatus::INVALID_COMMAND);
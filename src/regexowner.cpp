@@ -1,11 +1,41 @@
 #include "regexowner.h"
 
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <vector>
 
 namespace newsboat {
 
-Regex::Regex(const regex_t& r)
+namespace {
+
+/// How many of the most recently requested shared regexes are kept while
+/// nobody uses them
+const std::size_t RECENTLY_USED = 64;
+
+struct SharedRegexes {
+	std::mutex mtx;
+	std::map<std::pair<std::string, int>, std::weak_ptr<const Regex>> interned;
+	/// Size of `interned` that triggers the next sweep of expired entries
+	std::size_t next_sweep = 2 * RECENTLY_USED;
+	/// Most recently requested last
+	std::deque<std::shared_ptr<const Regex>> recent;
+};
+
+SharedRegexes& shared_regexes()
+{
+	// Never destroyed, so that regexes held by other statics can still
+	// be released at exit
+	static SharedRegexes* instance = new SharedRegexes;
+	return *instance;
+}
+
+}
+
+Regex::Regex(const regex_t& r, const std::string& pattern)
 	: regex(r)
+	, pattern_(pattern)
 {
 }
 
@@ -27,7 +57,70 @@ std::unique_ptr<Regex> Regex::compile(const std::string& reg_expression,
 		error.assign(buf.begin(), buf.end());
 		return nullptr;
 	}
-	return std::unique_ptr<Regex>(new Regex(regex));
+	return std::unique_ptr<Regex>(new Regex(regex, reg_expression));
+}
+
+std::shared_ptr<const Regex> Regex::compile_shared(
+	const std::string& reg_expression, int regcomp_flags, std::string& error)
+{
+	auto& shared = shared_regexes();
+	const auto key = std::make_pair(reg_expression, regcomp_flags);
+
+	std::shared_ptr<const Regex> regex;
+	{
+		std::lock_guard<std::mutex> guard(shared.mtx);
+		const auto it = shared.interned.find(key);
+		if (it != shared.interned.end()) {
+			regex = it->second.lock();
+		}
+	}
+	// Compiled without holding the lock, so that several threads can
+	// compile different patterns at once
+	if (regex == nullptr) {
+		regex = compile(reg_expression, regcomp_flags, error);
+		if (regex == nullptr) {
+			return nullptr;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(shared.mtx);
+	auto& interned = shared.interned[key];
+	const auto other = interned.lock();
+	if (other != nullptr) {
+		// Someone else compiled it meanwhile
+		regex = other;
+	} else {
+		interned = regex;
+
+		if (shared.interned.size() >= shared.next_sweep) {
+			for (auto it = shared.interned.begin(); it != shared.interned.end();) {
+				if (it->second.expired()) {
+					it = shared.interned.erase(it);
+				} else {
+					++it;
+				}
+			}
+			shared.next_sweep = std::max(2 * RECENTLY_USED,
+					2 * shared.interned.size());
+		}
+	}
+
+	auto& recent = shared.recent;
+	const auto previous = std::find(recent.begin(), recent.end(), regex);
+	if (previous != recent.end()) {
+		recent.erase(previous);
+	}
+	recent.push_back(regex);
+	if (recent.size() > RECENTLY_USED) {
+		recent.pop_front();
+	}
+
+	return regex;
+}
+
+bool Regex::is_match(const std::string& input) const
+{
+	return regexec(&regex, input.c_str(), 0, nullptr, 0) == 0;
 }
 
 std::vector<std::pair<int, int>> Regex::matches(const std::string& input,
@@ -48,4 +141,37 @@ std::vector<std::pair<int, int>> Regex::matches(const std::string& input,
 	return {};
 }
 
+std::vector<std::pair<int, int>> Regex::matches(const std::string& input,
+		std::size_t offset, int max_matches, int flags) const
+{
+	if (offset > input.length()) {
+		return {};
+	}
+#ifdef REG_STARTEND
+	std::vector<regmatch_t> regMatches(std::max(max_matches, 1));
+	regMatches[0].rm_so = offset;
+	regMatches[0].rm_eo = input.length();
+	if (regexec(&regex, input.c_str(), max_matches, regMatches.data(),
+			flags | REG_STARTEND) == 0) {
+		std::vector<std::pair<int, int>> results;
+		for (int i = 0; i < max_matches; ++i) {
+			const auto& regMatch = regMatches[i];
+			if (regMatch.rm_so < 0 || regMatch.rm_eo < 0) {
+				break;
+			}
+			results.push_back({regMatch.rm_so, regMatch.rm_eo});
+		}
+		return results;
+	}
+	return {};
+#else
+	auto results = matches(input.substr(offset), max_matches, flags);
+	for (auto& result : results) {
+		result.first += offset;
+		result.second += offset;
+	}
+	return results;
+#endif
+}
+
 } // namespace newsboat
@@ -0,0 +1,193 @@
+#include "reloaddaemon.h"
+
+#include <csignal>
+#include <iostream>
+
+#include "config.h"
+#include "controller.h"
+#include "logger.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+/// How long to wait for clients at a time, which is also how late a
+/// stop request or the end of a reload is noticed.
+const int POLL_TIMEOUT_MS = 1000;
+
+const std::string ANSWER_OK = "OK\n";
+const std::string ANSWER_ERROR = "ERR\n";
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void stop_action(int /* sig */)
+{
+	stop_requested = 1;
+}
+
+time_t reload_interval(ConfigContainer& cfg)
+{
+	const time_t minutes = cfg.get_configvalue_as_int("reload-time");
+	return 60 * (minutes > 0 ? minutes : 1);
+}
+
+}
+
+ReloadDaemon::ReloadDaemon(Controller& ctrl, ConfigContainer& cfg,
+	const std::string& socket_path)
+	: ctrl(ctrl)
+	, cfg(cfg)
+	, socket(socket_path)
+	, reload_done(false)
+	, reloading(false)
+	, next_reload(time(nullptr))
+	, stopping(false)
+{
+	if (cfg.get_configvalue_as_bool("suppress-first-reload")) {
+		next_reload += reload_interval(cfg);
+	}
+}
+
+ReloadDaemon::~ReloadDaemon()
+{
+	if (reload_thread.joinable()) {
+		reload_thread.join();
+	}
+}
+
+std::string ReloadDaemon::socket_path(const std::string& cache_file)
+{
+	return cache_file + ".sock";
+}
+
+int ReloadDaemon::run()
+{
+	stop_requested = 0;
+	::signal(SIGINT, stop_action);
+	::signal(SIGTERM, stop_action);
+
+	std::cout << _("Running as a daemon; press Ctrl-C to stop.")
+		<< std::endl;
+
+	bool compacting = true;
+	while (!stopping && !stop_requested) {
+		for (const auto& request : socket.poll(POLL_TIMEOUT_MS)) {
+			handle(request);
+		}
+		if (reloading && reload_done) {
+			finish_reload();
+			compacting = true;
+		}
+
+		if (!reloading && cfg.get_configvalue_as_bool("auto-reload")
+			&& next_reload <= time(nullptr)) {
+			start_reload();
+		}
+		// Between reloads, the cache is compacted one small step at a time
+		if (!reloading && compacting) {
+			compacting = ctrl.get_reloader()->compact_cache();
+		}
+	}
+
+	LOG(Level::INFO, "ReloadDaemon::run: stopping");
+	if (reloading) {
+		std::cout << _("Waiting for the reload to finish...") << std::endl;
+		finish_reload();
+	}
+	return EXIT_SUCCESS;
+}
+
+nonstd::optional<int> ReloadDaemon::forward_commands(
+	const std::string& socket_path,
+	const std::vector<std::string>& cmds)
+{
+	int result = EXIT_SUCCESS;
+	bool first = true;
+	for (const auto& cmd : cmds) {
+		std::string answer;
+		if (!ControlSocket::send(socket_path, cmd, answer)) {
+			if (first) {
+				return nonstd::nullopt;
+			}
+			std::cerr << strprintf::fmt(_("%s: %s: the daemon didn't answer"),
+					PROGRAM_NAME,
+					cmd)
+				<< std::endl;
+			return EXIT_FAILURE;
+		}
+		first = false;
+
+		LOG(Level::DEBUG,
+			"ReloadDaemon::forward_commands: `%s' was answered with `%s'",
+			cmd,
+			answer);
+		if (answer.compare(0, ANSWER_OK.size(), ANSWER_OK) == 0) {
+			std::cout << answer.substr(ANSWER_OK.size());
+		} else {
+			const auto error = answer.compare(0, ANSWER_ERROR.size(),
+					ANSWER_ERROR) == 0 ? answer.substr(ANSWER_ERROR.size()) : answer;
+			std::cerr << error;
+			result = EXIT_FAILURE;
+			break;
+		}
+	}
+	std::cout.flush();
+	return result;
+}
+
+void ReloadDaemon::handle(const ControlSocket::Request& request)
+{
+	LOG(Level::DEBUG, "ReloadDaemon::handle: `%s'", request.command);
+	if (request.command == "reload") {
+		// Joins the reload that's running, if there is one
+		waiting.push_back(request);
+		if (!reloading) {
+			start_reload();
+		}
+	} else if (request.command == "print-unread") {
+		socket.reply(request, ANSWER_OK + unread_message());
+	} else if (request.command == "stats") {
+		socket.reply(request, ANSWER_OK + ctrl.runtime_stats().dump(2) + "\n");
+	} else if (request.command == "quit") {
+		stopping = true;
+		socket.reply(request, ANSWER_OK);
+	} else {
+		socket.reply(request, ANSWER_ERROR + strprintf::fmt(
+				_("%s: %s: unknown command"),
+				PROGRAM_NAME,
+				request.command) + "\n");
+	}
+}
+
+void ReloadDaemon::start_reload()
+{
+	LOG(Level::INFO, "ReloadDaemon::start_reload: reloading");
+	reloading = true;
+	reload_done = false;
+	reload_thread = std::thread([this]() {
+		ctrl.get_reloader()->reload_all(true, true);
+		reload_done = true;
+	});
+}
+
+void ReloadDaemon::finish_reload()
+{
+	reload_thread.join();
+	reloading = false;
+	next_reload = time(nullptr) + reload_interval(cfg);
+	LOG(Level::INFO, "ReloadDaemon::finish_reload: %s", unread_message());
+
+	for (const auto& request : waiting) {
+		socket.reply(request, ANSWER_OK);
+	}
+	waiting.clear();
+}
+
+std::string ReloadDaemon::unread_message() const
+{
+	return strprintf::fmt(_("%u unread articles"),
+			ctrl.unread_counts().articles) + "\n";
+}
+
+} // namespace newsboat
@@ -1,43 +1,184 @@
 #include "reloader.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <ncurses.h>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "cachewriter.h"
 #include "controller.h"
 #include "curlhandle.h"
 #include "dbexception.h"
+#include "executor.h"
+#include "fetchgroups.h"
+#include "fetchresults.h"
 #include "fmtstrformatter.h"
 #include "matcherexception.h"
+#include "multidownloader.h"
+#include "processrunner.h"
+#include "reloadorder.h"
 #include "reloadthread.h"
+#include "remoteapi.h"
 #include "rss/exception.h"
+#include "rss/parser.h"
 #include "rssfeed.h"
 #include "rssparser.h"
+#include "runtimestats.h"
 #include "scopemeasure.h"
+#include "sharedfetchcache.h"
+#include "tracelog.h"
 #include "utils.h"
 #include "view.h"
+#include "websubrelay.h"
+#include "workerpool.h"
 
 namespace newsboat {
 
-Reloader::Reloader(Controller* c, Cache* cc, ConfigContainer* cfg)
+namespace {
+
+const unsigned int SEARCH_INDEX_BATCH_SIZE = 500;
+
+/// How far back the articles go that tell which feeds the user reads; see
+/// ReloadOrder.
+const time_t READ_HISTORY_DAYS = 30;
+
+/// With `download-timeout-adaptive`, a feed's downloads are given this many
+/// times as long as they usually take, but at least the minimum.
+const std::int64_t ADAPTIVE_TIMEOUT_FACTOR = 4;
+const std::int64_t ADAPTIVE_TIMEOUT_MIN_MS = 10000;
+
+/// Pages given back per Reloader::compact_cache() call; 4 MiB with the
+/// default page size, which SQLite frees in a few milliseconds.
+const unsigned int COMPACTION_STEP_PAGES = 1024;
+
+/// Articles moved or compressed per Reloader::compact_cache() call.
+const unsigned int COMPRESSION_BATCH_SIZE = 200;
+
+/// Feeds that are due this close to a periodic reload are reloaded along
+/// with it rather than on the next one; the schedule is only accurate to the
+/// minute anyway.
+const time_t NEXT_CHECK_SLACK = 60;
+
+/// Responses in `shared-fetch-cache-dir` that no instance fetched or
+/// revalidated for this long are removed.
+const time_t SHARED_RESPONSES_KEPT = 7 * 24 * 60 * 60;
+
+/// Adds what \a handle downloaded last time to RuntimeStats.
+void add_downloaded_bytes(CurlHandle& handle)
+{
+	double bytes = 0;
+	if (curl_easy_getinfo(handle.ptr(), CURLINFO_SIZE_DOWNLOAD,
+			&bytes) == CURLE_OK) {
+		RuntimeStats::add(RuntimeStats::Counter::BYTES_DOWNLOADED,
+			static_cast<std::int64_t>(bytes));
+	}
+}
+
+/// Whether curl is told to use a proxy by the environment.
+/// \brief The IP family to try a failed transfer again over, for
+/// `download-hedge-ip-family`; CURL_IPRESOLVE_WHATEVER if it's not worth it.
+///
+/// Only transfers that broke off after having connected are tried again.
+/// curl already tries both families while connecting, and a server that
+/// doesn't answer at all shouldn't hold the reload up twice.
+long hedge_ip_family(CURL* handle, CURLcode result)
+{
+	switch (result) {
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_RECV_ERROR:
+	case CURLE_SEND_ERROR:
+	case CURLE_GOT_NOTHING:
+	case CURLE_PARTIAL_FILE:
+		break;
+	default:
+		return CURL_IPRESOLVE_WHATEVER;
+	}
+	double connect_time = 0;
+	char* ip = nullptr;
+	if (curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME, &connect_time) != CURLE_OK
+		|| connect_time <= 0
+		|| curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &ip) != CURLE_OK
+		|| ip == nullptr || *ip == '\0') {
+		return CURL_IPRESOLVE_WHATEVER;
+	}
+	return std::strchr(ip, ':') != nullptr ? CURL_IPRESOLVE_V4 :
+		CURL_IPRESOLVE_V6;
+}
+
+bool proxy_in_environment()
+{
+	for (const char* var : {
+			"http_proxy", "https_proxy", "HTTPS_PROXY", "all_proxy", "ALL_PROXY"
+		}) {
+		const char* value = ::getenv(var);
+		if (value != nullptr && *value != '\0') {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+Reloader::Reloader(Controller* c, Cache* cc, ConfigContainer* cfg,
+	const std::string& connection_cache_file)
 	: ctrl(c)
 	, rsscache(cc)
 	, cfg(cfg)
+	, connection_cache_file(connection_cache_file)
+	, connection_cache_loaded(false)
+	, indexing_for_search(false)
+	, settings_dirty(false)
 {
 }
 
 void Reloader::spawn_reloadthread()
 {
+	cfg->on_change([this](const std::string& key) {
+		if (key == "auto-reload" || key == "reload-time"
+			|| key == "websub-relay-dir") {
+			std::lock_guard<std::mutex> guard(settings_mtx);
+			settings_dirty = true;
+			settings_changed.notify_one();
+		}
+	});
 	std::thread t{ReloadThread(ctrl, cfg)};
 	t.detach();
 }
 
+bool Reloader::wait_for_settings(time_t until)
+{
+	std::unique_lock<std::mutex> lock(settings_mtx);
+	const auto dirty = [this]() {
+		return settings_dirty;
+	};
+	if (until == 0) {
+		settings_changed.wait(lock, dirty);
+	} else {
+		settings_changed.wait_until(lock,
+			std::chrono::system_clock::from_time_t(until), dirty);
+	}
+	const bool changed = settings_dirty;
+	settings_dirty = false;
+	return changed;
+}
+
 void Reloader::start_reload_all_thread(const std::vector<int>& indexes)
 {
 	LOG(Level::INFO, "starting reload all thread");
-	std::thread t([=]() {
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::HIGH,
+	[=]() {
 		LOG(Level::DEBUG,
 			"Reloader::start_reload_all_thread: inside thread, reloading all "
 			"feeds...");
@@ -50,7 +191,125 @@ void Reloader::start_reload_all_thread(const std::vector<int>& indexes)
 			unlock_reload_mutex();
 		}
 	});
-	t.detach();
+}
+
+void Reloader::start_scheduled_reload_thread()
+{
+	LOG(Level::INFO, "starting scheduled reload thread");
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::NORMAL,
+	[=]() {
+		if (trylock_reload_mutex()) {
+			reload_all(false, true);
+			unlock_reload_mutex();
+		}
+	});
+}
+
+void Reloader::start_subscriptions_refresh_thread(bool then_reload)
+{
+	LOG(Level::INFO, "starting subscriptions refresh thread");
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::NORMAL,
+	[=]() {
+		std::lock_guard<std::mutex> guard(reload_mutex);
+		try {
+			ctrl->reload_urls_file();
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"Reloader::start_subscriptions_refresh_thread: couldn't "
+				"update the feed list: %s",
+				e.what());
+		}
+		if (then_reload) {
+			reload_all();
+		}
+	});
+}
+
+bool Reloader::compact_cache()
+{
+	{
+		std::unique_lock<std::mutex> lock(reload_mutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			// Don't slow the reload down; we'll get another chance
+			return true;
+		}
+	}
+	// Moving and compressing articles frees pages, so only compact once
+	// they're done
+	return rsscache->split_stored_content(COMPRESSION_BATCH_SIZE)
+		|| rsscache->compress_stored_content(COMPRESSION_BATCH_SIZE)
+		|| rsscache->compact(COMPACTION_STEP_PAGES);
+}
+
+bool Reloader::reload_pushed()
+{
+	const std::string dir = cfg->get_configvalue("websub-relay-dir");
+	if (dir.empty()) {
+		return false;
+	}
+	// During a reload, the notifications wait in the relay's file
+	std::unique_lock<std::mutex> lock(reload_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return true;
+	}
+
+	const auto topics = WebSubRelay(dir).take_pushed();
+	if (topics.empty()) {
+		return true;
+	}
+	const std::unordered_set<std::string> pushed(topics.begin(), topics.end());
+
+	std::unordered_set<std::string> feedurls(pushed);
+	try {
+		for (const auto& feed : rsscache->fetch_websub_hubs()) {
+			if (pushed.count(feed.second.second) > 0) {
+				feedurls.insert(feed.first);
+			}
+		}
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Reloader::reload_pushed: couldn't read the WebSub hubs: %s",
+			e.what());
+	}
+
+	std::vector<int> positions;
+	const auto num_feeds = ctrl->get_feedcontainer()->feeds_size();
+	for (unsigned int i = 0; i < num_feeds; ++i) {
+		const auto feed = ctrl->get_feedcontainer()->get_feed(i);
+		if (feed && !feed->is_query_feed() && feedurls.count(feed->rssurl()) > 0) {
+			feed->reset_status();
+			positions.push_back(i);
+		}
+	}
+	LOG(Level::INFO,
+		"Reloader::reload_pushed: %u topic(s) pushed, reloading %u feed(s)",
+		static_cast<unsigned int>(topics.size()),
+		static_cast<unsigned int>(positions.size()));
+	if (!positions.empty()) {
+		reload_indexes(positions);
+	}
+	return true;
+}
+
+void Reloader::update_websub_subscriptions()
+{
+	const std::string dir = cfg->get_configvalue("websub-relay-dir");
+	if (dir.empty()) {
+		return;
+	}
+	std::vector<std::pair<std::string, std::string>> hubs;
+	try {
+		for (const auto& feed : rsscache->fetch_websub_hubs()) {
+			hubs.push_back(feed.second);
+		}
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Reloader::update_websub_subscriptions: couldn't read the WebSub "
+			"hubs: %s",
+			e.what());
+		return;
+	}
+	WebSubRelay(dir).write_subscriptions(std::move(hubs));
 }
 
 bool Reloader::trylock_reload_mutex()
@@ -68,15 +327,31 @@ void Reloader::reload(unsigned int pos,
 	bool unattended)
 {
 	CurlHandle handle;
-	reload(pos, handle, show_progress, unattended);
+	RefreshHints hints;
+	const time_t reload_start = time(nullptr);
+	load_cookies();
+	RuntimeStats::add(RuntimeStats::Counter::FEEDS_IN_FLIGHT);
+	reload(pos, handle, show_progress, unattended, nullptr, &hints);
+	RuntimeStats::add(RuntimeStats::Counter::FEEDS_IN_FLIGHT, -1);
+	add_downloaded_bytes(handle);
+	curl_share.save_cookies();
+
+	const auto feed = ctrl->get_feedcontainer()->get_feed(pos);
+	if (feed && !feed->is_query_feed()) {
+		schedule_next_checks({{feed->rssurl(), hints}}, reload_start);
+		record_failures({{feed->rssurl(), 0}}, reload_start);
+	}
 }
 
 void Reloader::reload(unsigned int pos,
 	CurlHandle& easyhandle,
 	bool show_progress,
-	bool unattended)
+	bool unattended,
+	CacheWriter* writer,
+	RefreshHints* hints)
 {
 	LOG(Level::DEBUG, "Reloader::reload: pos = %u", pos);
+	easyhandle.set_share(curl_share);
 	std::shared_ptr<RssFeed> oldfeed = ctrl->get_feedcontainer()->get_feed(pos);
 	if (oldfeed) {
 		// Query feed reloading should be handled by the calling functions
@@ -86,129 +361,905 @@ void Reloader::reload(unsigned int pos,
 			return;
 		}
 
-		std::string errmsg;
 		std::shared_ptr<AutoDiscardMessage> message_lifetime;
 		if (!unattended) {
-			const std::string progress = show_progress ?
-				strprintf::fmt("(%u/%u) ", ++reload_progress, reload_progress_max) :
-				"";
-			message_lifetime = ctrl->get_view()->get_statusline().show_message_until_finished(
-					strprintf::fmt(_("%sLoading %s..."),
-						progress,
-						utils::censor_url(oldfeed->rssurl())));
-		}
-
-		const bool ignore_dl =
-			(cfg->get_configvalue("ignore-mode") == "download");
-
-		RssParser parser(oldfeed->rssurl(),
-			rsscache,
-			cfg,
-			ignore_dl ? ctrl->get_ignores() : nullptr,
-			ctrl->get_api());
-		parser.set_easyhandle(&easyhandle);
+			message_lifetime = show_loading_message(*oldfeed, show_progress);
+		}
+
+		const auto parser = make_parser(*oldfeed);
+		parser->set_easyhandle(&easyhandle);
 		LOG(Level::DEBUG, "Reloader::reload: created parser");
-		try {
+		const std::string errmsg = catch_reload_errors(*oldfeed, [&]() {
 			const auto inner_message_lifetime = message_lifetime;
 			message_lifetime.reset();
 			oldfeed->set_status(DlStatus::DURING_DOWNLOAD);
-			std::shared_ptr<RssFeed> newfeed = parser.parse();
-			if (newfeed != nullptr) {
-				ctrl->replace_feed(
-					oldfeed, newfeed, pos, unattended);
-				if (newfeed->total_item_count() == 0) {
-					LOG(Level::DEBUG,
-						"Reloader::reload: feed is empty");
-				}
-			}
-			oldfeed->set_status(DlStatus::SUCCESS);
-		} catch (const DbException& e) {
-			errmsg = strprintf::fmt(
-					_("Error while retrieving %s: %s"),
-					utils::censor_url(oldfeed->rssurl()),
-					e.what());
-		} catch (const std::string& emsg) {
-			errmsg = strprintf::fmt(
-					_("Error while retrieving %s: %s"),
-					utils::censor_url(oldfeed->rssurl()),
-					emsg);
-		} catch (rsspp::Exception& e) {
-			errmsg = strprintf::fmt(
-					_("Error while retrieving %s: %s"),
-					utils::censor_url(oldfeed->rssurl()),
-					e.what());
+			store_feed(pos, oldfeed, parser->parse(), unattended, writer);
+		});
+		if (hints != nullptr) {
+			*hints = parser->refresh_hints();
 		}
 		if (!errmsg.empty()) {
-			oldfeed->set_status(DlStatus::DL_ERROR);
-			ctrl->get_view()->get_statusline().show_error(errmsg);
-			LOG(Level::USERERROR, "%s", errmsg);
+			report_reload_error(*oldfeed, errmsg);
 		}
 	} else {
 		ctrl->get_view()->get_statusline().show_error(_("Error: invalid feed!"));
 	}
 }
 
-void Reloader::partition_reload_to_threads(
-	std::function<void(unsigned int start, unsigned int end)> handle_range,
-	unsigned int num_feeds)
+std::shared_ptr<AutoDiscardMessage> Reloader::show_loading_message(
+	const RssFeed& feed, bool show_progress)
+{
+	const std::string progress = show_progress ?
+		strprintf::fmt("(%u/%u) ", ++reload_progress, reload_progress_max) :
+		"";
+	return ctrl->get_view()->get_statusline().show_message_until_finished(
+			strprintf::fmt(_("%sLoading %s..."),
+				progress,
+				utils::censor_url(feed.rssurl())));
+}
+
+std::unique_ptr<RssParser> Reloader::make_parser(const RssFeed& feed)
+{
+	const bool ignore_dl =
+		(cfg->snapshot().ignore_mode == IgnoreMode::DOWNLOAD);
+
+	return std::unique_ptr<RssParser>(new RssParser(feed.rssurl(),
+				rsscache,
+				cfg,
+				ignore_dl ? ctrl->get_ignores() : nullptr,
+				ctrl->get_api()));
+}
+
+std::string Reloader::catch_reload_errors(const RssFeed& feed,
+	const std::function<void()>& action)
+{
+	try {
+		action();
+	} catch (const DbException& e) {
+		return strprintf::fmt(
+				_("Error while retrieving %s: %s"),
+				utils::censor_url(feed.rssurl()),
+				e.what());
+	} catch (const std::string& emsg) {
+		return strprintf::fmt(
+				_("Error while retrieving %s: %s"),
+				utils::censor_url(feed.rssurl()),
+				emsg);
+	} catch (rsspp::Exception& e) {
+		return strprintf::fmt(
+				_("Error while retrieving %s: %s"),
+				utils::censor_url(feed.rssurl()),
+				e.what());
+	}
+	return "";
+}
+
+void Reloader::store_feed(unsigned int pos,
+	std::shared_ptr<RssFeed> oldfeed,
+	std::shared_ptr<RssFeed> newfeed,
+	bool unattended,
+	CacheWriter* writer)
+{
+	if (newfeed != nullptr && fetch_results) {
+		time_t lastmodified = 0;
+		std::string etag;
+		rsscache->fetch_lastmodified(oldfeed->rssurl(), lastmodified, etag);
+		fetch_results->add(*newfeed, lastmodified, etag);
+	}
+	if (newfeed != nullptr && writer != nullptr) {
+		// The writer sets the status once the feed is stored
+		writer->push(FeedUpdate{oldfeed, newfeed, pos, unattended});
+		return;
+	}
+	if (newfeed != nullptr) {
+		ctrl->replace_feed(
+			oldfeed, newfeed, pos, unattended);
+		if (newfeed->total_item_count() == 0) {
+			LOG(Level::DEBUG,
+				"Reloader::store_feed: feed is empty");
+		}
+	}
+	oldfeed->set_status(DlStatus::SUCCESS);
+}
+
+void Reloader::report_reload_error(RssFeed& feed, const std::string& errmsg)
+{
+	if (report) {
+		report->add_error(feed.rssurl(), errmsg);
+	}
+	feed.set_status(DlStatus::DL_ERROR);
+	ctrl->get_view()->get_statusline().show_error(errmsg);
+	LOG(Level::USERERROR, "%s", errmsg);
+}
+
+void Reloader::schedule_next_checks(
+	const std::unordered_map<std::string, RefreshHints>& hints,
+	time_t reload_start)
+{
+	if (!cfg->get_configvalue_as_bool("reload-adaptive")) {
+		return;
+	}
+
+	const time_t min_interval =
+		60 * std::max(1, cfg->get_configvalue_as_int("reload-time"));
+	const time_t max_interval =
+		60 * std::max(0, cfg->get_configvalue_as_int("reload-adaptive-max-time"));
+	const RefreshPolicy policy(min_interval, max_interval);
+
+	std::unordered_map<std::string, std::pair<std::string, std::string>>
+	websub_hubs;
+	if (!cfg->get_configvalue("websub-relay-dir").empty()) {
+		try {
+			websub_hubs = rsscache->fetch_websub_hubs();
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"Reloader::schedule_next_checks: couldn't read the WebSub "
+				"hubs: %s",
+				e.what());
+		}
+	}
+
+	std::unordered_map<std::string, time_t> next_checks;
+	for (const auto& feed : hints) {
+		RefreshHints feed_hints = feed.second;
+		feed_hints.pushed = websub_hubs.count(feed.first) > 0;
+		try {
+			next_checks[feed.first] = policy.next_check(feed_hints,
+					rsscache->estimate_update_interval(feed.first),
+					reload_start);
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"Reloader::schedule_next_checks: couldn't look at %s: %s",
+				feed.first,
+				e.what());
+		}
+	}
+	rsscache->update_next_checks(next_checks);
+}
+
+void Reloader::record_failures(
+	const std::unordered_map<std::string, long>& http_statuses,
+	time_t reload_start)
+{
+	const time_t first =
+		60 * std::max(1, cfg->get_configvalue_as_int("reload-time"));
+	const time_t longest =
+		60 * std::max(0, cfg->get_configvalue_as_int("reload-backoff-max-time"));
+
+	std::unordered_map<std::string, FeedFailures> before;
+	try {
+		before = rsscache->fetch_failures();
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Reloader::record_failures: couldn't read the failures: %s",
+			e.what());
+		return;
+	}
+
+	std::unordered_map<std::string, FeedFailures> failures;
+	for (const auto& http_status : http_statuses) {
+		const auto feed = ctrl->get_feedcontainer()->get_feed_by_url(
+				http_status.first);
+		if (feed == nullptr) {
+			continue;
+		}
+		const auto previous = before.find(http_status.first);
+		if (feed->get_dl_status() == DlStatus::SUCCESS) {
+			if (previous != before.end()) {
+				failures[http_status.first] = FeedFailures();
+			}
+			continue;
+		}
+		if (feed->get_dl_status() != DlStatus::DL_ERROR) {
+			continue;
+		}
+
+		FeedFailures& failure = failures[http_status.first];
+		failure.count = previous != before.end() ? previous->second.count + 1 : 1;
+		failure.retry_at = reload_start + RefreshPolicy::retry_delay(failure.count,
+				first, longest);
+		failure.gone = http_status.second == 410;
+		if (failure.gone) {
+			LOG(Level::USERERROR,
+				"%s is gone (HTTP 410), so it's left out of reloads until it's "
+				"reloaded on its own",
+				utils::censor_url(http_status.first));
+		}
+	}
+	rsscache->update_failures(failures);
+}
+
+void Reloader::write_feed(const FeedUpdate& update)
+{
+	const std::string errmsg = catch_reload_errors(*update.oldfeed, [&]() {
+		RuntimeStatsTimer timer(RuntimeStats::Counter::DATABASE_NS);
+		const auto start = std::chrono::steady_clock::now();
+		const unsigned int added = ctrl->replace_feed(update.oldfeed,
+				update.newfeed, update.pos, update.unattended);
+		if (report) {
+			report->add_write(update.oldfeed->rssurl(),
+				std::chrono::steady_clock::now() - start, added);
+		}
+		update.oldfeed->set_status(DlStatus::SUCCESS);
+	});
+	if (!errmsg.empty()) {
+		report_reload_error(*update.oldfeed, errmsg);
+	}
+}
+
+/// A feed that reload_feeds() is working on. Passed from one thread to the
+/// next as the reload goes on, but only ever used by one of them at a time.
+struct Reloader::PendingReload {
+	explicit PendingReload(unsigned int pos)
+		: pos(pos)
+		, attempts(0)
+		, download_time(0)
+		, expected_time(0)
+		, ip_resolve(CURL_IPRESOLVE_WHATEVER)
+	{
+	}
+
+	const unsigned int pos;
+	std::shared_ptr<RssFeed> oldfeed;
+	std::unique_ptr<RssParser> parser;
+	/// Left as it is for feeds reloaded without a parser of their own.
+	RefreshHints hints;
+	CurlHandle handle;
+	std::unique_ptr<rsspp::Transfer> transfer;
+	unsigned int attempts;
+	/// Milliseconds spent fetching the feed, over all attempts.
+	std::int64_t download_time;
+	/// How long reloading the feed usually takes; 0 if it isn't known.
+	std::int64_t expected_time;
+	/// CURLOPT_IPRESOLVE of the feed's transfers; only changed once the
+	/// feed was tried again over the other IP family.
+	long ip_resolve;
+	std::shared_ptr<AutoDiscardMessage> message_lifetime;
+	/// The HTTP status of the last download; 0 if there was none.
+	long http_status = 0;
+	/// The feeds that are fetched from the same place, which get what
+	/// this one downloads instead of downloading it themselves.
+	std::vector<PendingReload*> followers;
+};
+
+void Reloader::load_cookies()
+{
+	const std::string cookie_cache = cfg->get_configvalue("cookie-cache");
+	if (!cookie_cache.empty()) {
+		// Read again for every reload, since the remote APIs keep their
+		// logins in the file too
+		curl_share.load_cookies(cookie_cache);
+	}
+}
+
+void Reloader::reload_feeds(const std::vector<unsigned int>& positions,
+	bool unattended)
 {
+	const unsigned int num_feeds = positions.size();
+	if (num_feeds == 0) {
+		return;
+	}
+
 	int num_threads = cfg->get_configvalue_as_int("reload-threads");
 	// TODO: change to std::clamp in C++17
 	const int min_threads = 1;
 	const int max_threads = num_feeds;
 	num_threads = std::max(min_threads, std::min(num_threads, max_threads));
+	// Parsing is bound by the CPU rather than the network, so it doesn't
+	// take as many threads as there are feeds being fetched
+	int num_parsers = cfg->get_configvalue_as_int("reload-parse-threads");
+	if (num_parsers <= 0) {
+		num_parsers = std::thread::hardware_concurrency();
+	}
+	num_parsers = std::max(min_threads, std::min(num_parsers, max_threads));
+	const unsigned int max_downloads =
+		std::max(0, cfg->get_configvalue_as_int("reload-max-downloads"));
+	const unsigned int retries =
+		std::max(1, cfg->get_configvalue_as_int("download-retries"));
 
-	LOG(Level::DEBUG, "Reloader::partition_reload_to_threads: starting with reload...");
+	LOG(Level::DEBUG,
+		"Reloader::reload_feeds: reloading %u feed(s) with %d fetcher(s) "
+		"and %d parser(s), downloading up to %u at once",
+		num_feeds,
+		num_threads,
+		num_parsers,
+		max_downloads);
 	reload_progress = 0;
 	reload_progress_max = num_feeds;
-	if (num_threads == 1) {
-		handle_range(0, num_feeds - 1);
-	} else {
-		std::vector<std::pair<unsigned int, unsigned int>> partitions =
-				utils::partition_indexes(0, num_feeds - 1, num_threads);
-		std::vector<std::thread> threads;
-		LOG(Level::DEBUG,
-			"Reloader::partition_reload_to_threads: starting reload threads...");
-		for (int i = 0; i < num_threads - 1; i++) {
-			auto range = partitions[i];
-			threads.emplace_back([=]() {
-				handle_range(range.first, range.second);
+	const time_t reload_start = time(nullptr);
+	const std::string report_file = cfg->get_configvalue("reload-report-file");
+	if (!report_file.empty()) {
+		report.reset(new ReloadReport);
+	}
+	const std::string fetch_shard = cfg->get_configvalue("fetch-shard");
+	const std::string fetch_results_dir = cfg->get_configvalue("fetch-results-dir");
+	if (!fetch_shard.empty() && !fetch_results_dir.empty()) {
+		fetch_results.reset(new FetchResults(fetch_results_dir));
+	}
+
+	RemoteApi* api = ctrl->get_api();
+	if (api != nullptr) {
+		api->begin_reload();
+	}
+
+	// Behind a proxy, the address a transfer connects to is the proxy's
+	const bool connection_cache = cfg->get_configvalue_as_bool("connection-cache")
+		&& !connection_cache_file.empty();
+	const bool proxied = cfg->get_configvalue_as_bool("use-proxy")
+		|| proxy_in_environment();
+	const bool saved_addresses = connection_cache && !proxied;
+	if (connection_cache && !connection_cache_loaded) {
+		curl_share.load(connection_cache_file);
+		connection_cache_loaded = true;
+	}
+	load_cookies();
+	rsscache->preload_validators();
+
+	const std::int64_t max_timeout_ms = 1000 * static_cast<std::int64_t>(
+			cfg->get_configvalue_as_int("download-timeout"));
+	const bool adaptive_timeout = max_timeout_ms > 0
+		&& cfg->get_configvalue_as_bool("download-timeout-adaptive");
+	const bool hedge = !proxied
+		&& cfg->get_configvalue_as_bool("download-hedge-ip-family");
+
+	// Downloads finish in bursts, so let every parser and fetcher have a
+	// couple of feeds waiting before it gets blocked on the writer.
+	CacheWriter writer(*rsscache, [this](const FeedUpdate& update) {
+		write_feed(update);
+	}, 2 * (num_threads + num_parsers));
+	MultiDownloader downloader(max_downloads,
+		std::max(0, cfg->get_configvalue_as_int("reload-max-downloads-per-host")),
+		std::chrono::milliseconds(
+			std::max(0, cfg->get_configvalue_as_int("reload-host-delay"))));
+	WorkerPool fetchers(num_threads);
+	WorkerPool parsers(num_parsers);
+	ProcessRunner plugins(
+		std::max(0, cfg->get_configvalue_as_int("reload-plugin-processes")));
+	std::thread plugin_thread([&]() {
+		plugins.run();
+	});
+
+	std::atomic<unsigned int> remaining(num_feeds);
+	RuntimeStats::add(RuntimeStats::Counter::FEEDS_QUEUED, num_feeds);
+	const auto feed_done = [&]() {
+		RuntimeStats::add(RuntimeStats::Counter::FEEDS_IN_FLIGHT, -1);
+		if (--remaining == 0) {
+			downloader.finish();
+			plugins.finish();
+		}
+	};
+
+	// Hands what the feed downloaded to the feeds that are fetched from the
+	// same place, or the error it got if \a errmsg isn't empty
+	const auto finish_followers = [&](PendingReload* feed,
+	const std::string& errmsg) {
+		for (PendingReload* follower : feed->followers) {
+			follower->hints = feed->hints;
+			follower->http_status = feed->http_status;
+			std::string error = errmsg;
+			if (error.empty()) {
+				error = catch_reload_errors(*follower->oldfeed, [&]() {
+					auto newfeed = follower->parser->parse_same_as(*feed->parser);
+					// So that the next request for the group can be a
+					// conditional one
+					time_t lastmodified = 0;
+					std::string etag;
+					rsscache->fetch_lastmodified(feed->oldfeed->rssurl(), lastmodified,
+						etag);
+					rsscache->update_lastmodified(follower->oldfeed->rssurl(),
+						lastmodified, etag);
+					rsscache->update_body_hash(follower->oldfeed->rssurl(),
+						rsscache->fetch_body_hash(feed->oldfeed->rssurl()));
+					store_feed(follower->pos, follower->oldfeed, newfeed, unattended,
+						&writer);
+				});
+			}
+			if (!error.empty()) {
+				report_reload_error(*follower->oldfeed, error);
+			}
+			feed_done();
+		}
+	};
+
+	// Sets the feed's handle up and queues it on the downloader; once the
+	// transfer is over, one of the parsers takes over the feed. Feeds that
+	// aren't downloaded that way are fetched and parsed by the fetchers.
+	std::function<void(PendingReload*)> download;
+	download = [&](PendingReload* feed) {
+		feed->transfer.reset(new rsspp::Transfer);
+		const std::string errmsg = catch_reload_errors(*feed->oldfeed, [&]() {
+			feed->parser->prepare_download(feed->handle, *feed->transfer);
+		});
+		if (!errmsg.empty()) {
+			feed->message_lifetime.reset();
+			report_reload_error(*feed->oldfeed, errmsg);
+			finish_followers(feed, errmsg);
+			feed_done();
+			return;
+		}
+		if (feed->ip_resolve != CURL_IPRESOLVE_WHATEVER) {
+			curl_easy_setopt(feed->handle.ptr(), CURLOPT_IPRESOLVE, feed->ip_resolve);
+		} else if (saved_addresses) {
+			curl_share.use_saved_address(feed->handle.ptr(), feed->oldfeed->rssurl());
+		}
+		if (adaptive_timeout && feed->expected_time > 0) {
+			const std::int64_t timeout_ms = std::min(max_timeout_ms,
+					std::max(ADAPTIVE_TIMEOUT_MIN_MS,
+						ADAPTIVE_TIMEOUT_FACTOR * feed->expected_time));
+			curl_easy_setopt(feed->handle.ptr(), CURLOPT_TIMEOUT_MS,
+				static_cast<long>(timeout_ms));
+		}
+
+		downloader.add(feed->handle, [&, feed](CURLcode result) {
+			double seconds = 0;
+			if (curl_easy_getinfo(feed->handle.ptr(), CURLINFO_TOTAL_TIME,
+					&seconds) == CURLE_OK) {
+				feed->download_time += static_cast<std::int64_t>(seconds * 1000);
+				if (TraceLog::enabled()) {
+					const auto end = TraceLog::Clock::now();
+					TraceLog::add("download",
+						end - std::chrono::duration_cast<TraceLog::Clock::duration>(
+							std::chrono::duration<double>(seconds)),
+						end, feed->oldfeed->rssurl());
+				}
+			}
+			if (report) {
+				report->add_download(feed->oldfeed->rssurl(), feed->handle.ptr());
+			}
+			curl_easy_getinfo(feed->handle.ptr(), CURLINFO_RESPONSE_CODE,
+				&feed->http_status);
+			add_downloaded_bytes(feed->handle);
+			if (saved_addresses && result == CURLE_OK) {
+				curl_share.remember_address(feed->handle.ptr());
+			}
+			const long family = hedge && feed->ip_resolve == CURL_IPRESOLVE_WHATEVER
+				? hedge_ip_family(feed->handle.ptr(), result)
+				: CURL_IPRESOLVE_WHATEVER;
+			if (family != CURL_IPRESOLVE_WHATEVER) {
+				LOG(Level::INFO,
+					"Reloader::reload_feeds: trying %s again over IPv%d: %s",
+					feed->oldfeed->rssurl(),
+					family == CURL_IPRESOLVE_V4 ? 4 : 6,
+					curl_easy_strerror(result));
+				feed->ip_resolve = family;
+				feed->handle.reset();
+				parsers.push([&, feed]() {
+					download(feed);
+				});
+				return;
+			}
+			parsers.push([&, feed, result]() {
+				bool retry = false;
+				const std::string parse_error = catch_reload_errors(*feed->oldfeed,
+				[&]() {
+					const auto parse_start = std::chrono::steady_clock::now();
+					auto newfeed = feed->parser->parse_download(feed->handle,
+							*feed->transfer, result);
+					RuntimeStats::add(RuntimeStats::Counter::PARSE_NS,
+						std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::now() - parse_start).count());
+					TraceLog::add("parse", parse_start, std::chrono::steady_clock::now(),
+						feed->oldfeed->rssurl());
+					if (report) {
+						report->add_parse(feed->oldfeed->rssurl(),
+							std::chrono::steady_clock::now() - parse_start,
+							feed->parser->body_unchanged());
+					}
+					if (newfeed == nullptr && !feed->parser->body_unchanged()
+						&& ++feed->attempts < retries) {
+						retry = true;
+						return;
+					}
+					store_feed(feed->pos, feed->oldfeed, newfeed, unattended,
+						&writer);
+				});
+				if (retry) {
+					download(feed);
+					return;
+				}
+				feed->hints = feed->parser->refresh_hints();
+				feed->transfer.reset();
+				feed->message_lifetime.reset();
+				if (!parse_error.empty()) {
+					report_reload_error(*feed->oldfeed, parse_error);
+				}
+				finish_followers(feed, parse_error);
+				feed_done();
 			});
+		}, utils::host_of(feed->oldfeed->rssurl()));
+	};
+
+	// Gets the script of an `exec:` or `filter:` feed going on the plugin
+	// runner; once it exits, one of the parsers parses what it wrote.
+	const auto run_plugin = [&](PendingReload* feed) {
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::string> argv;
+		nonstd::optional<std::string> input;
+		const std::string errmsg = catch_reload_errors(*feed->oldfeed, [&]() {
+			feed->parser->prepare_plugin(argv, input);
+		});
+		if (!errmsg.empty()) {
+			feed->message_lifetime.reset();
+			report_reload_error(*feed->oldfeed, errmsg);
+			feed_done();
+			return;
+		}
+
+		plugins.add(std::move(argv), std::move(input), [&, feed,
+		start](int status, std::string output) {
+			feed->download_time +=
+				std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start).count();
+			if (status != 0) {
+				LOG(Level::INFO,
+					"Reloader::reload_feeds: the script of %s exited with %d",
+					feed->oldfeed->rssurl(),
+					status);
+			}
+			const auto shared_output = std::make_shared<std::string>(std::move(output));
+			parsers.push([&, feed, shared_output]() {
+				const std::string parse_error = catch_reload_errors(*feed->oldfeed,
+				[&]() {
+					const auto parse_start = std::chrono::steady_clock::now();
+					auto newfeed = feed->parser->parse_plugin_output(*shared_output);
+					RuntimeStats::add(RuntimeStats::Counter::PARSE_NS,
+						std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::now() - parse_start).count());
+					TraceLog::add("parse", parse_start, std::chrono::steady_clock::now(),
+						feed->oldfeed->rssurl());
+					if (report) {
+						report->add_parse(feed->oldfeed->rssurl(),
+							std::chrono::steady_clock::now() - parse_start, false);
+					}
+					store_feed(feed->pos, feed->oldfeed, newfeed, unattended,
+						&writer);
+				});
+				feed->message_lifetime.reset();
+				if (!parse_error.empty()) {
+					report_reload_error(*feed->oldfeed, parse_error);
+				}
+				feed_done();
+			});
+		});
+	};
+
+	const auto download_times = rsscache->fetch_download_times();
+	std::vector<std::unique_ptr<PendingReload>> feeds;
+	std::vector<std::string> feedurls;
+	for (const auto pos : positions) {
+		std::unique_ptr<PendingReload> feed(new PendingReload(pos));
+		feed->handle.set_share(curl_share);
+		feed->oldfeed = ctrl->get_feedcontainer()->get_feed(pos);
+		feedurls.push_back(feed->oldfeed ? feed->oldfeed->rssurl() : "");
+		const auto time = download_times.find(feedurls.back());
+		if (time != download_times.end()) {
+			feed->expected_time = time->second;
+		}
+		feeds.push_back(std::move(feed));
+	}
+	// Feeds fetched from the same place share one download. Remote APIs
+	// list every feed once, and fetch them in their own ways.
+	std::vector<std::string> locations;
+	for (const auto& feed : feeds) {
+		std::string location;
+		if (api == nullptr && feed->oldfeed && !feed->oldfeed->is_query_feed()
+			&& utils::is_http_url(feed->oldfeed->rssurl())) {
+			time_t since = 0;
+			rsscache->fetch_moved_url(feed->oldfeed->rssurl(), location, since);
+			if (location.empty()) {
+				location = feed->oldfeed->rssurl();
+			}
+		}
+		locations.push_back(location);
+	}
+	const FetchGroups fetch_groups(locations);
+	for (std::size_t i = 0; i < feeds.size(); ++i) {
+		for (const auto follower : fetch_groups.followers(i)) {
+			feeds[i]->followers.push_back(feeds[follower].get());
+		}
+	}
+
+	View* view = ctrl->get_view();
+	const ReloadOrder reload_order(
+		view != nullptr ? view->feeds_in_view() : std::unordered_set<std::string>(),
+		rsscache->fetch_read_counts(reload_start - READ_HISTORY_DAYS * 86400),
+		download_times);
+
+	// Gets the followers of the feed ready for what it downloads. The
+	// request is a conditional one only if they all got the same answer to
+	// it last time.
+	const auto share_download = [&](PendingReload* feed) {
+		feed->parser->keep_parsed_feed();
+		time_t lastmodified = 0;
+		std::string etag;
+		rsscache->fetch_lastmodified(feed->oldfeed->rssurl(), lastmodified, etag);
+		const auto body_hash = rsscache->fetch_body_hash(feed->oldfeed->rssurl());
+		for (PendingReload* follower : feed->followers) {
+			RuntimeStats::add(RuntimeStats::Counter::FEEDS_QUEUED, -1);
+			RuntimeStats::add(RuntimeStats::Counter::FEEDS_IN_FLIGHT);
+			follower->parser = make_parser(*follower->oldfeed);
+			follower->oldfeed->set_status(DlStatus::DURING_DOWNLOAD);
+			time_t follower_lastmodified = 0;
+			std::string follower_etag;
+			rsscache->fetch_lastmodified(follower->oldfeed->rssurl(),
+				follower_lastmodified, follower_etag);
+			if (follower_lastmodified != lastmodified || follower_etag != etag
+				|| rsscache->fetch_body_hash(follower->oldfeed->rssurl()) != body_hash) {
+				feed->parser->send_unconditional_request();
+			}
 		}
 		LOG(Level::DEBUG,
-			"Reloader::partition_reload_to_threads: starting my own reload...");
-		handle_range(partitions[num_threads - 1].first,
-			partitions[num_threads - 1].second);
-		LOG(Level::DEBUG,
-			"Reloader::partition_reload_to_threads: joining other threads...");
-		for (size_t i = 0; i < threads.size(); i++) {
-			threads[i].join();
+			"Reloader::reload_feeds: %s is downloaded for %" PRIu64 " more feed(s)",
+			feed->oldfeed->rssurl(),
+			static_cast<uint64_t>(feed->followers.size()));
+	};
+
+	std::function<void(PendingReload*)> fetch;
+	fetch = [&](PendingReload* feed) {
+		RuntimeStats::add(RuntimeStats::Counter::FEEDS_QUEUED, -1);
+		RuntimeStats::add(RuntimeStats::Counter::FEEDS_IN_FLIGHT);
+		if (feed->oldfeed && !feed->oldfeed->is_query_feed()) {
+			feed->parser = make_parser(*feed->oldfeed);
+		}
+		if (!feed->followers.empty()) {
+			if (!feed->parser || !feed->parser->downloads_over_http()) {
+				// Nothing to share; they're reloaded on their own
+				for (PendingReload* follower : feed->followers) {
+					fetchers.push([&, follower]() {
+						fetch(follower);
+					});
+				}
+				feed->followers.clear();
+			} else {
+				share_download(feed);
+			}
+		}
+		if (feed->parser && feed->parser->runs_plugin()) {
+			if (!unattended) {
+				feed->message_lifetime = show_loading_message(*feed->oldfeed, true);
+			}
+			feed->oldfeed->set_status(DlStatus::DURING_DOWNLOAD);
+			run_plugin(feed);
+			return;
+		}
+		if (!feed->parser || !feed->parser->downloads_over_http()) {
+			// Nothing to download here, or not in a way the downloader
+			// can do it
+			const auto start = std::chrono::steady_clock::now();
+			reload(feed->pos, feed->handle, true, unattended, &writer,
+				&feed->hints);
+			add_downloaded_bytes(feed->handle);
+			if (feed->parser) {
+				const auto elapsed = std::chrono::steady_clock::now() - start;
+				feed->download_time =
+					std::chrono::duration_cast<std::chrono::milliseconds>(
+						elapsed).count();
+				// Fetching isn't told apart from parsing here
+				if (report) {
+					report->add_parse(feed->oldfeed->rssurl(), elapsed, false);
+				}
+			}
+			feed_done();
+			return;
+		}
+
+		if (feed->parser->defers_fetch()) {
+			store_feed(feed->pos, feed->oldfeed, nullptr, unattended, &writer);
+			finish_followers(feed, "");
+			feed_done();
+			return;
+		}
+
+		// Another instance on the host may have fetched it just now
+		bool shared = false;
+		const std::string shared_error = catch_reload_errors(*feed->oldfeed,
+		[&]() {
+			std::shared_ptr<RssFeed> newfeed;
+			shared = feed->parser->parse_shared(newfeed);
+			if (shared) {
+				store_feed(feed->pos, feed->oldfeed, newfeed, unattended, &writer);
+			}
+		});
+		if (shared || !shared_error.empty()) {
+			feed->hints = feed->parser->refresh_hints();
+			if (!shared_error.empty()) {
+				report_reload_error(*feed->oldfeed, shared_error);
+			}
+			finish_followers(feed, shared_error);
+			feed_done();
+			return;
+		}
+
+		if (!unattended) {
+			feed->message_lifetime = show_loading_message(*feed->oldfeed, true);
+		}
+		feed->oldfeed->set_status(DlStatus::DURING_DOWNLOAD);
+		download(feed);
+	};
+
+	for (const auto i : reload_order.sort(feedurls)) {
+		if (fetch_groups.is_follower(i)) {
+			continue;
+		}
+		PendingReload* feed = feeds[i].get();
+		fetchers.push([&, feed]() {
+			fetch(feed);
+		});
+	}
+
+	LOG(Level::DEBUG, "Reloader::reload_feeds: running the downloads...");
+	downloader.run();
+	LOG(Level::DEBUG,
+		"Reloader::reload_feeds: waiting for the workers and the cache writer...");
+	plugin_thread.join();
+	fetchers.finish();
+	parsers.finish();
+	writer.finish();
+	if (api != nullptr) {
+		api->end_reload();
+	}
+
+	std::unordered_map<std::string, std::int64_t> measured_times;
+	std::unordered_map<std::string, RefreshHints> hints;
+	std::unordered_map<std::string, long> http_statuses;
+	for (const auto& feed : feeds) {
+		if (feed->oldfeed && feed->download_time > 0) {
+			measured_times[feed->oldfeed->rssurl()] += feed->download_time;
+		}
+		if (feed->parser) {
+			hints[feed->oldfeed->rssurl()] = feed->hints;
+			http_statuses[feed->oldfeed->rssurl()] = feed->http_status;
+		}
+	}
+	rsscache->update_download_times(measured_times);
+	rsscache->flush_validators();
+	if (connection_cache) {
+		curl_share.save(connection_cache_file);
+	}
+	curl_share.save_cookies();
+	schedule_next_checks(hints, reload_start);
+	record_failures(http_statuses, reload_start);
+	update_websub_subscriptions();
+	const std::string shared_dir = cfg->get_configvalue("shared-fetch-cache-dir");
+	if (!shared_dir.empty()) {
+		SharedFetchCache(shared_dir, 0).remove_unused(SHARED_RESPONSES_KEPT);
+	}
+
+	if (report) {
+		report->write(report_file);
+		report.reset();
+	}
+	if (fetch_results) {
+		fetch_results->write(fetch_shard);
+		fetch_results.reset();
+	}
+}
+
+void Reloader::apply_fetch_results(bool unattended)
+{
+	ScopeMeasure m("Reloader::apply_fetch_results");
+	FetchResults results(cfg->get_configvalue("fetch-results-dir"));
+
+	FeedContainer* feeds = ctrl->get_feedcontainer();
+	std::unordered_map<std::string, unsigned int> positions;
+	for (unsigned int i = 0; i < feeds->feeds_size(); ++i) {
+		const auto feed = feeds->get_feed(i);
+		if (feed && !feed->is_query_feed()) {
+			positions[feed->rssurl()] = i;
+		}
+	}
+
+	unsigned int applied = 0;
+	for (const auto& path : results.list_files()) {
+		for (const auto& result : FetchResults::read(path, rsscache)) {
+			const auto pos = positions.find(result.feed->rssurl());
+			if (pos == positions.end()) {
+				// Not subscribed to here
+				continue;
+			}
+			const auto oldfeed = feeds->get_feed(pos->second);
+			const std::string errmsg = catch_reload_errors(*oldfeed, [&]() {
+				rsscache->remove_old_deleted_items(result.feed.get());
+				rsscache->update_lastmodified(oldfeed->rssurl(), result.lastmodified,
+					result.etag);
+				ctrl->replace_feed(oldfeed, result.feed, pos->second, unattended);
+				oldfeed->set_status(DlStatus::SUCCESS);
+				++applied;
+			});
+			if (!errmsg.empty()) {
+				report_reload_error(*oldfeed, errmsg);
+			}
+		}
+		if (std::remove(path.c_str()) != 0) {
+			LOG(Level::ERROR,
+				"Reloader::apply_fetch_results: couldn't remove %s: %s",
+				path,
+				std::strerror(errno));
 		}
 	}
+	rsscache->flush_validators();
+	LOG(Level::INFO,
+		"Reloader::apply_fetch_results: applied %u feed(s)",
+		applied);
 }
 
-void Reloader::reload_all(bool unattended)
+void Reloader::reload_all(bool unattended, bool only_due)
 {
 	ScopeMeasure sm("Reloader::reload_all");
 
-	const auto unread_feeds =
-		ctrl->get_feedcontainer()->unread_feed_count();
-	const auto unread_articles =
-		ctrl->get_feedcontainer()->unread_item_count();
+	const auto unread_before = ctrl->unread_counts();
 
-	ctrl->get_feedcontainer()->reset_feeds_status();
 	const auto num_feeds = ctrl->get_feedcontainer()->feeds_size();
+	std::vector<unsigned int> positions;
+	// Skipped feeds keep their status, so a failed one stays marked
+	std::unordered_map<std::string, time_t> next_checks;
+	std::unordered_map<std::string, FeedFailures> failures;
+	try {
+		if (only_due && cfg->get_configvalue_as_bool("reload-adaptive")) {
+			next_checks = rsscache->fetch_next_checks();
+		}
+		failures = rsscache->fetch_failures();
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"Reloader::reload_all: couldn't read the schedule, reloading "
+			"everything: %s",
+			e.what());
+	}
+	const time_t due = time(nullptr) + NEXT_CHECK_SLACK;
+	unsigned int shard_index = 0;
+	unsigned int shard_count = 0;
+	const std::string fetch_shard = cfg->get_configvalue("fetch-shard");
+	if (!fetch_shard.empty()
+		&& !FetchResults::parse_shard(fetch_shard, shard_index, shard_count)) {
+		LOG(Level::USERERROR,
+			"Reloader::reload_all: fetch-shard isn't like 1/4, reloading "
+			"everything: %s",
+			fetch_shard);
+	}
+	for (unsigned int i = 0; i < num_feeds; ++i) {
+		const auto feed = ctrl->get_feedcontainer()->get_feed(i);
+		if (feed && shard_count != 0
+			&& !FetchResults::in_shard(feed->rssurl(), shard_index, shard_count)) {
+			// Another worker reloads it
+			continue;
+		}
+		if (feed) {
+			const auto failure = failures.find(feed->rssurl());
+			if (failure != failures.end() && (failure->second.gone
+					|| (only_due && failure->second.retry_at > due))) {
+				continue;
+			}
+			const auto next_check = next_checks.find(feed->rssurl());
+			if (next_check != next_checks.end() && next_check->second > due) {
+				continue;
+			}
+			feed->reset_status();
+		}
+		positions.push_back(i);
+	}
+	LOG(Level::INFO,
+		"Reloader::reload_all: %" PRIu64 " of %u feed(s) are due",
+		static_cast<uint64_t>(positions.size()),
+		num_feeds);
+	if (fetch_shard.empty() && !cfg->get_configvalue("fetch-results-dir").empty()) {
+		apply_fetch_results(unattended);
+	} else {
+		reload_feeds(positions, unattended);
+	}
 
-	partition_reload_to_threads([=](unsigned int start, unsigned int end) {
-		reload_range(start, end, unattended);
-	}, num_feeds);
+	// Articles cached by older versions are indexed in the background;
+	// query feeds don't need them to be
+	start_search_index_backfill();
 
-	// refresh query feeds (update and sort)
+	// refresh query feeds (update and sort), looking only at the articles
+	// of the feeds that were replaced
 	LOG(Level::DEBUG, "Reloader::reload_all: refresh query feeds");
-	for (const auto& feed : ctrl->get_feedcontainer()->get_all_feeds()) {
+	const auto replaced_feedurls =
+		ctrl->get_feedcontainer()->take_replaced_feedurls();
+	for (const auto& feed : *ctrl->get_feedcontainer()->get_feeds_snapshot()) {
 		if (feed->is_query_feed()) {
 			try {
-				ctrl->get_view()->prepare_query_feed(feed);
+				ctrl->get_view()->prepare_query_feed(feed, &replaced_feedurls);
 				feed->set_status(DlStatus::SUCCESS);
 			} catch (const MatcherException& /* e */) {
 				feed->set_status(DlStatus::DL_ERROR);
@@ -220,62 +1271,18 @@ void Reloader::reload_all(bool unattended)
 	ctrl->update_feedlist();
 	ctrl->get_view()->force_redraw();
 
-	notify_reload_finished(unread_feeds, unread_articles);
+	notify_reload_finished(unread_before.feeds, unread_before.articles);
 }
 
 void Reloader::reload_indexes(const std::vector<int>& indexes, bool unattended)
 {
 	ScopeMeasure m1("Reloader::reload_indexes");
-	const auto unread_feeds =
-		ctrl->get_feedcontainer()->unread_feed_count();
-	const auto unread_articles =
-		ctrl->get_feedcontainer()->unread_item_count();
+	const auto unread_before = ctrl->unread_counts();
 
-	partition_reload_to_threads([&](unsigned int start, unsigned int end) {
-		for (auto i = start; i <= end; ++i) {
-			reload(indexes[i], true, unattended);
-		}
-	}, indexes.size());
+	reload_feeds(std::vector<unsigned int>(indexes.begin(), indexes.end()),
+		unattended);
 
-	notify_reload_finished(unread_feeds, unread_articles);
-}
-
-void Reloader::reload_range(unsigned int start,
-	unsigned int end,
-	bool unattended)
-{
-	std::vector<unsigned int> v;
-	for (unsigned int i = start; i <= end; ++i) {
-		v.push_back(i);
-	}
-
-	auto extract = [](std::string& s, const std::string& url) {
-		size_t p = url.find("//");
-		p = (p == std::string::npos) ? 0 : p + 2;
-		std::string suff(url.substr(p));
-		p = suff.find('/');
-		s = suff.substr(0, p);
-	};
-
-	const auto feeds = ctrl->get_feedcontainer()->get_all_feeds();
-
-	std::sort(v.begin(), v.end(), [&](unsigned int a, unsigned int b) {
-		std::string domain1, domain2;
-		extract(domain1, feeds[a]->rssurl());
-		extract(domain2, feeds[b]->rssurl());
-		std::reverse(domain1.begin(), domain1.end());
-		std::reverse(domain2.begin(), domain2.end());
-		return domain1 < domain2;
-	});
-
-	CurlHandle easyhandle;
-
-	for (const auto& i : v) {
-		LOG(Level::DEBUG,
-			"Reloader::reload_range: reloading feed #%u",
-			i);
-		reload(i, easyhandle, true, unattended);
-	}
+	notify_reload_finished(unread_before.feeds, unread_before.articles);
 }
 
 void Reloader::notify(const std::string& msg)
@@ -303,13 +1310,37 @@ void Reloader::notify(const std::string& msg)
 	}
 }
 
+void Reloader::start_search_index_backfill()
+{
+	if (indexing_for_search.exchange(true)) {
+		return;
+	}
+	Executor::instance().submit(Executor::Pool::CPU, Executor::Priority::LOW,
+	[=]() {
+		index_search_batch();
+	});
+}
+
+void Reloader::index_search_batch()
+{
+	if (rsscache->index_items_for_search(SEARCH_INDEX_BATCH_SIZE)) {
+		indexing_for_search = false;
+		return;
+	}
+	// Queue the next batch behind whatever else is waiting, so the cache
+	// is free for everything else in between
+	Executor::instance().submit(Executor::Pool::CPU, Executor::Priority::LOW,
+	[=]() {
+		index_search_batch();
+	});
+}
+
 void Reloader::notify_reload_finished(unsigned int unread_feeds_before,
 	unsigned int unread_articles_before)
 {
-	const auto unread_feeds =
-		ctrl->get_feedcontainer()->unread_feed_count();
-	const auto unread_articles =
-		ctrl->get_feedcontainer()->unread_item_count();
+	const auto unread = ctrl->unread_counts();
+	const auto unread_feeds = unread.feeds;
+	const auto unread_articles = unread.articles;
 	const bool notify_always = cfg->get_configvalue_as_bool("notify-always");
 
 	if (notify_always || unread_feeds > unread_feeds_before ||
@@ -0,0 +1,50 @@
+#include "reloadorder.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+namespace newsboat {
+
+ReloadOrder::ReloadOrder(std::unordered_set<std::string> in_view,
+	std::unordered_map<std::string, std::int64_t> read_counts,
+	std::unordered_map<std::string, std::int64_t> download_times)
+	: in_view(std::move(in_view))
+	, read_counts(std::move(read_counts))
+	, download_times(std::move(download_times))
+{
+}
+
+std::vector<std::size_t> ReloadOrder::sort(
+	const std::vector<std::string>& feedurls) const
+{
+	// Negated, so that the feeds sort in ascending order of their keys
+	std::vector<std::tuple<bool, std::int64_t, std::int64_t>> keys;
+	keys.reserve(feedurls.size());
+	for (const auto& feedurl : feedurls) {
+		const bool hidden = in_view.count(feedurl) == 0;
+		keys.emplace_back(hidden,
+			hidden ? -lookup(read_counts, feedurl) : 0,
+			-lookup(download_times, feedurl));
+	}
+
+	std::vector<std::size_t> order(feedurls.size());
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a,
+	std::size_t b) {
+		return keys[a] < keys[b];
+	});
+	return order;
+}
+
+std::int64_t ReloadOrder::lookup(
+	const std::unordered_map<std::string, std::int64_t>& values,
+	const std::string& feedurl) const
+{
+	const auto value = values.find(feedurl);
+	return value != values.end() ? value->second : 0;
+}
+
+} // namespace newsboat
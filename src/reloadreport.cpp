@@ -0,0 +1,225 @@
+#include "reloadreport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+double to_ms(std::chrono::steady_clock::duration time)
+{
+	return std::chrono::duration<double, std::milli>(time).count();
+}
+
+/// The nearest-rank percentiles of \a values, which are sorted on the way.
+nlohmann::json percentiles(std::vector<double>& values)
+{
+	std::sort(values.begin(), values.end());
+	const auto rank = [&](double p) {
+		const auto n = static_cast<std::size_t>(std::ceil(p * values.size()));
+		return values[std::max<std::size_t>(n, 1) - 1];
+	};
+	return nlohmann::json{
+		{"count", values.size()},
+		{"p50", rank(0.5)},
+		{"p90", rank(0.9)},
+		{"p99", rank(0.99)},
+		{"max", values.back()},
+	};
+}
+
+}
+
+ReloadReport::ReloadReport()
+	: started(std::chrono::system_clock::now())
+	, started_steady(std::chrono::steady_clock::now())
+{
+}
+
+void ReloadReport::add_download(const std::string& url, CURL* handle)
+{
+	long status = 0;
+	double namelookup = 0;
+	double connect = 0;
+	double appconnect = 0;
+	double starttransfer = 0;
+	double total = 0;
+	double size = 0;
+	curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+	curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME, &namelookup);
+	curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME, &connect);
+	curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME, &appconnect);
+	curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME, &starttransfer);
+	curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME, &total);
+	curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD, &size);
+
+	std::lock_guard<std::mutex> guard(mtx);
+	Feed& feed = feed_unlocked(url);
+	// curl's times all count from the start of the transfer; a reused
+	// connection took no time to set up. Only the last attempt counts.
+	feed.http_status = status;
+	feed.dns = 1000 * namelookup;
+	feed.connect = 1000 * std::max(0.0, connect - namelookup);
+	feed.tls = appconnect > 0 ? 1000 * std::max(0.0, appconnect - connect) : -1;
+	feed.ttfb = 1000 * starttransfer;
+	feed.transfer = 1000 * std::max(0.0, total - starttransfer);
+	feed.bytes += static_cast<std::uint64_t>(size);
+	++feed.downloads;
+}
+
+void ReloadReport::add_parse(const std::string& url,
+	std::chrono::steady_clock::duration time, bool unchanged)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	Feed& feed = feed_unlocked(url);
+	feed.parse = std::max(0.0, feed.parse) + to_ms(time);
+	feed.body_unchanged = unchanged;
+}
+
+void ReloadReport::add_write(const std::string& url,
+	std::chrono::steady_clock::duration time, unsigned int articles_added)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	Feed& feed = feed_unlocked(url);
+	feed.write = std::max(0.0, feed.write) + to_ms(time);
+	feed.articles_added += articles_added;
+}
+
+void ReloadReport::add_error(const std::string& url, const std::string& message)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	feed_unlocked(url).error = message;
+}
+
+ReloadReport::Feed& ReloadReport::feed_unlocked(const std::string& url)
+{
+	const auto position = positions.find(url);
+	if (position != positions.end()) {
+		return feeds[position->second].second;
+	}
+	positions[url] = feeds.size();
+	feeds.emplace_back(url, Feed());
+	return feeds.back().second;
+}
+
+nlohmann::json ReloadReport::to_json() const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+
+	const std::vector<std::pair<std::string, double Feed::*>> durations = {
+		{"dns_ms", &Feed::dns},
+		{"connect_ms", &Feed::connect},
+		{"tls_ms", &Feed::tls},
+		{"ttfb_ms", &Feed::ttfb},
+		{"transfer_ms", &Feed::transfer},
+		{"parse_ms", &Feed::parse},
+		{"write_ms", &Feed::write},
+	};
+
+	nlohmann::json entries = nlohmann::json::array();
+	std::unordered_map<std::string, std::vector<double>> measured;
+	std::vector<double> sizes;
+	unsigned int errors = 0;
+	unsigned int not_modified = 0;
+	unsigned int unchanged = 0;
+	unsigned int added = 0;
+	std::uint64_t bytes = 0;
+	for (const auto& entry : feeds) {
+		const Feed& feed = entry.second;
+		nlohmann::json json = {{"url", entry.first}};
+		if (feed.downloads > 0) {
+			json["http_status"] = feed.http_status;
+			json["downloads"] = feed.downloads;
+			json["bytes"] = feed.bytes;
+			sizes.push_back(feed.bytes);
+		}
+		for (const auto& duration : durations) {
+			const double value = feed.*duration.second;
+			if (value >= 0) {
+				json[duration.first] = value;
+				measured[duration.first].push_back(value);
+			}
+		}
+		json["not_modified"] = feed.http_status == 304;
+		json["body_unchanged"] = feed.body_unchanged;
+		json["articles_added"] = feed.articles_added;
+		if (!feed.error.empty()) {
+			json["error"] = feed.error;
+			++errors;
+		}
+		entries.push_back(std::move(json));
+
+		not_modified += feed.http_status == 304 ? 1 : 0;
+		unchanged += feed.body_unchanged ? 1 : 0;
+		added += feed.articles_added;
+		bytes += feed.bytes;
+	}
+
+	nlohmann::json distribution = nlohmann::json::object();
+	for (const auto& duration : durations) {
+		auto values = measured.find(duration.first);
+		if (values != measured.end()) {
+			distribution[duration.first] = percentiles(values->second);
+		}
+	}
+	if (!sizes.empty()) {
+		distribution["bytes"] = percentiles(sizes);
+	}
+
+	const auto duration = std::chrono::steady_clock::now() - started_steady;
+	return nlohmann::json{
+		{
+			"summary", {
+				{
+					"started",
+					std::chrono::system_clock::to_time_t(started)
+				},
+				{"duration_ms", to_ms(duration)},
+				{"feeds", feeds.size()},
+				{"errors", errors},
+				{"not_modified", not_modified},
+				{"body_unchanged", unchanged},
+				{"bytes", bytes},
+				{"articles_added", added},
+				{"percentiles", distribution},
+			}
+		},
+		{"feeds", entries},
+	};
+}
+
+bool ReloadReport::write(const std::string& path) const
+{
+	const std::string report = to_json().dump(2);
+	if (path == "-") {
+		std::cout << report << std::endl;
+		return true;
+	}
+
+	// Whoever reads the report never sees half of it
+	const std::string tmp = path + ".tmp";
+	{
+		std::ofstream f(tmp);
+		f << report << '\n';
+		f.close();
+		if (!f) {
+			LOG(Level::ERROR, "ReloadReport::write: couldn't write %s", tmp);
+			std::remove(tmp.c_str());
+			return false;
+		}
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		LOG(Level::ERROR, "ReloadReport::write: couldn't replace %s", path);
+		std::remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace newsboat
@@ -1,12 +1,16 @@
 #include "reloadthread.h"
 
+#include <algorithm>
 #include <cinttypes>
-#include <unistd.h>
 
 #include "logger.h"
+#include "reloader.h"
 
 namespace newsboat {
 
+/// How often the feeds the WebSub relay pushed are looked for.
+static const time_t WEBSUB_POLL_SECONDS = 10;
+
 ReloadThread::ReloadThread(Controller* c, ConfigContainer* cf)
 	: ctrl(c)
 	, oldtime(0)
@@ -26,38 +30,63 @@ ReloadThread::~ReloadThread() {}
 
 void ReloadThread::operator()()
 {
-	for (;;) {
-		oldtime = time(nullptr);
-		LOG(Level::INFO, "ReloadThread: starting reload");
-
+	Reloader* reloader = ctrl->get_reloader();
+	bool auto_reload = false;
+	bool relayed = false;
+	const auto read_settings = [&]() {
 		waittime_sec = 60 * cfg->get_configvalue_as_int("reload-time");
 		if (waittime_sec == 0) {
 			waittime_sec = 60;
 		}
+		auto_reload = cfg->get_configvalue_as_bool("auto-reload");
+		relayed = auto_reload
+			&& !cfg->get_configvalue("websub-relay-dir").empty();
+	};
+	read_settings();
 
-		if (cfg->get_configvalue_as_bool("auto-reload")) {
+	// Between reloads, the cache is compacted one small step per second
+	// until there's nothing left to do, and the feeds the WebSub relay
+	// pushed are reloaded every few seconds. Other than for that, the
+	// thread sleeps until the next reload or until the settings change.
+	bool compacting = true;
+	time_t next_push_check = 0;
+	for (;;) {
+		const time_t now = time(nullptr);
+		if (auto_reload && oldtime + waittime_sec <= now) {
+			oldtime = now;
+			LOG(Level::INFO, "ReloadThread: starting reload");
 			if (suppressed_first) {
-				ctrl->get_reloader()->start_reload_all_thread();
+				reloader->start_scheduled_reload_thread();
 			} else {
 				suppressed_first = true;
 				if (!cfg->get_configvalue_as_bool(
 						"suppress-first-reload")) {
-					ctrl->get_reloader()
-					->start_reload_all_thread();
+					reloader->start_scheduled_reload_thread();
 				}
 			}
-		} else {
-			// if auto-reload is disabled, we poll every 60 seconds whether it changed.
-			waittime_sec = 60;
+			compacting = true;
+		}
+		if (relayed && next_push_check <= now) {
+			reloader->reload_pushed();
+			next_push_check = time(nullptr) + WEBSUB_POLL_SECONDS;
+		}
+		if (compacting) {
+			compacting = reloader->compact_cache();
 		}
 
-		time_t seconds_to_wait = 0;
-		if ((oldtime + waittime_sec) > time(nullptr))
-			seconds_to_wait =
-				oldtime + waittime_sec - time(nullptr);
-
-		while (seconds_to_wait > 0) {
-			seconds_to_wait = ::sleep(seconds_to_wait);
+		time_t wake = auto_reload ? oldtime + waittime_sec : 0;
+		const auto wake_by = [&wake](time_t when) {
+			wake = wake == 0 ? when : std::min(wake, when);
+		};
+		if (relayed) {
+			wake_by(next_push_check);
+		}
+		if (compacting) {
+			wake_by(time(nullptr) + 1);
+		}
+		if (reloader->wait_for_settings(wake)) {
+			LOG(Level::DEBUG, "ReloadThread: the settings changed");
+			read_settings();
 		}
 	}
 }
@@ -1,10 +1,14 @@
 #include "remoteapi.h"
 
+#include <algorithm>
 #include <fstream>
 #include <glob.h>
 #include <iostream>
 #include <unistd.h>
 
+#include "cache.h"
+#include "dbexception.h"
+#include "logger.h"
 #include "utils.h"
 
 namespace newsboat {
@@ -20,6 +24,115 @@ bool RemoteApi::mark_articles_read(const std::vector<std::string>& guids)
 	return success;
 }
 
+std::vector<TaggedFeedUrl> RemoteApi::subscriptions()
+{
+	stored_subscriptions_used = false;
+	if (subscription_cache == nullptr) {
+		return get_subscribed_urls();
+	}
+
+	if (stored_subscriptions_usable) {
+		stored_subscriptions_usable = false;
+		try {
+			auto stored = subscription_cache->fetch_subscriptions(
+					subscription_source);
+			if (!stored.empty()) {
+				stored_subscriptions_used = true;
+				return stored;
+			}
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"RemoteApi::subscriptions: couldn't read the stored list: %s",
+				e.what());
+		}
+	}
+
+	const auto urls = get_subscribed_urls();
+	// An empty list is more likely a failed request than an empty account
+	if (!urls.empty()) {
+		try {
+			subscription_cache->store_subscriptions(subscription_source, urls);
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"RemoteApi::subscriptions: couldn't store the list: %s",
+				e.what());
+		}
+	}
+	return urls;
+}
+
+void RemoteApi::cache_subscriptions(Cache* cache, const std::string& source,
+	bool use_stored)
+{
+	subscription_cache = cache;
+	subscription_source = source;
+	stored_subscriptions_usable = use_stored;
+}
+
+std::string RemoteApi::revalidate(const std::string& url,
+	const std::function<std::string(utils::ConditionalRequest& request)>& fetch)
+{
+	utils::ConditionalRequest request;
+	if (subscription_cache == nullptr) {
+		return fetch(request);
+	}
+
+	StoredResponse stored;
+	bool have_stored = false;
+	try {
+		have_stored = subscription_cache->fetch_remote_response(url, stored);
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"RemoteApi::revalidate: couldn't read the stored answer: %s",
+			e.what());
+	}
+	if (have_stored) {
+		request.last_modified = stored.last_modified;
+		request.etag = stored.etag;
+	}
+
+	std::string body = fetch(request);
+	if (request.not_modified && have_stored) {
+		LOG(Level::DEBUG,
+			"RemoteApi::revalidate: %s didn't change",
+			utils::censor_url(url));
+		return std::move(stored.body);
+	}
+
+	// Servers that don't send validators aren't asked conditionally, so
+	// there's no point in keeping their answers
+	if (!body.empty() && (request.last_modified != 0 || !request.etag.empty())) {
+		StoredResponse response;
+		response.last_modified = request.last_modified;
+		response.etag = request.etag;
+		response.body = body;
+		try {
+			subscription_cache->store_remote_response(url, response);
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"RemoteApi::revalidate: couldn't store the answer: %s",
+				e.what());
+		}
+	}
+	return body;
+}
+
+bool RemoteApi::mark_in_batches(const std::vector<std::string>& guids,
+	std::size_t batch_size,
+	const std::function<bool(const std::vector<std::string>&)>& mark)
+{
+	bool success = true;
+	for (std::size_t begin = 0; begin < guids.size(); begin += batch_size) {
+		const auto end = std::min(guids.size(), begin + batch_size);
+		const std::vector<std::string> batch(guids.begin() + begin,
+			guids.begin() + end);
+		if (!mark(batch)) {
+			success = false;
+		}
+	}
+	return success;
+}
+
 const std::string RemoteApi::read_password(const std::string& file)
 {
 	glob_t exp;
@@ -0,0 +1,255 @@
+#include "remoteoutbox.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "cache.h"
+#include "dbexception.h"
+#include "logger.h"
+#include "remoteapi.h"
+
+namespace newsboat {
+
+const unsigned int RemoteOutbox::BATCH_SIZE;
+const unsigned int RemoteOutbox::MAX_ATTEMPTS;
+
+RemoteOutbox::RemoteOutbox(Cache& cache, RemoteApi& api)
+	: cache(cache)
+	, api(api)
+	, queued(false)
+	, stopping(false)
+{
+}
+
+RemoteOutbox::~RemoteOutbox()
+{
+	stop();
+}
+
+void RemoteOutbox::mark_article_read(const std::string& guid, bool read)
+{
+	try {
+		cache.queue_remote_read(guid, read);
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"RemoteOutbox::mark_article_read: couldn't queue, sending "
+			"right away: %s",
+			e.what());
+		api.mark_article_read(guid, read);
+		return;
+	}
+	notify();
+}
+
+void RemoteOutbox::mark_articles_read(const std::vector<std::string>& guids)
+{
+	try {
+		cache.queue_remote_reads(guids, true);
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"RemoteOutbox::mark_articles_read: couldn't queue, sending "
+			"right away: %s",
+			e.what());
+		api.mark_articles_read(guids);
+		return;
+	}
+	notify();
+}
+
+void RemoteOutbox::update_article_flags(const std::string& oldflags,
+	const std::string& newflags,
+	const std::string& guid)
+{
+	try {
+		cache.queue_remote_flags(guid, oldflags, newflags);
+	} catch (const DbException& e) {
+		LOG(Level::ERROR,
+			"RemoteOutbox::update_article_flags: couldn't queue, sending "
+			"right away: %s",
+			e.what());
+		api.update_article_flags(oldflags, newflags, guid);
+		return;
+	}
+	notify();
+}
+
+void RemoteOutbox::start()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	if (!worker.joinable() && !stopping) {
+		worker = std::thread(&RemoteOutbox::run, this);
+	}
+}
+
+void RemoteOutbox::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+	}
+	wakeup.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+bool RemoteOutbox::send_queued()
+{
+	while (true) {
+		// Whatever's left is sent once the quota starts over, rather than
+		// counted as failed
+		if (!api.request_budget().allows(RequestBudget::Kind::WRITE)) {
+			LOG(Level::INFO,
+				"RemoteOutbox::send_queued: the server takes no more requests "
+				"for now");
+			return false;
+		}
+
+		std::vector<OutboxEntry> entries;
+		try {
+			entries = cache.fetch_remote_outbox(BATCH_SIZE);
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"RemoteOutbox::send_queued: couldn't read the queue: %s",
+				e.what());
+			return false;
+		}
+		if (entries.empty()) {
+			return true;
+		}
+
+		std::vector<OutboxEntry> sent;
+		std::vector<OutboxEntry> failed;
+		try {
+			// Articles marked read are what piles up, e.g. from going
+			// through a feed, so they're sent in one batch request
+			std::vector<OutboxEntry> marked_read;
+			for (const auto& entry : entries) {
+				bool success = true;
+				if (entry.has_read && !entry.read) {
+					success = api.mark_article_read(entry.guid, false);
+				}
+				if (success && entry.has_flags) {
+					success = api.update_article_flags(entry.oldflags,
+							entry.flags, entry.guid);
+				}
+
+				if (!success) {
+					failed.push_back(entry);
+				} else if (entry.has_read && entry.read) {
+					marked_read.push_back(entry);
+				} else {
+					sent.push_back(entry);
+				}
+			}
+
+			if (!marked_read.empty()) {
+				std::vector<std::string> guids;
+				for (const auto& entry : marked_read) {
+					guids.push_back(entry.guid);
+				}
+				auto& result = api.mark_articles_read(guids) ? sent : failed;
+				result.insert(result.end(), marked_read.begin(),
+					marked_read.end());
+			}
+		} catch (const std::exception& e) {
+			LOG(Level::ERROR,
+				"RemoteOutbox::send_queued: sending failed: %s",
+				e.what());
+			sent.clear();
+			failed = entries;
+		}
+
+		LOG(Level::DEBUG,
+			"RemoteOutbox::send_queued: sent %u change(s), %u failed",
+			static_cast<unsigned int>(sent.size()),
+			static_cast<unsigned int>(failed.size()));
+		try {
+			cache.remove_sent_outbox_entries(sent);
+			// Only the server turning changes down counts as a failed
+			// attempt. If nothing got through, it's more likely that it
+			// couldn't be reached, e.g. while offline, and the changes wait
+			// for however long that takes.
+			if (!failed.empty() && !sent.empty()) {
+				cache.count_outbox_failures(failed, MAX_ATTEMPTS);
+			}
+		} catch (const DbException& e) {
+			LOG(Level::ERROR,
+				"RemoteOutbox::send_queued: couldn't update the queue: %s",
+				e.what());
+			return false;
+		}
+
+		if (!failed.empty()) {
+			return false;
+		}
+		if (entries.size() < BATCH_SIZE) {
+			return true;
+		}
+	}
+}
+
+RemoteOutbox::Clock::duration RemoteOutbox::retry_delay(unsigned int failures)
+{
+	const auto first = std::chrono::seconds(30);
+	const auto longest = std::chrono::minutes(30);
+	auto delay = Clock::duration(first);
+	for (unsigned int i = 1; i < failures && delay < longest; ++i) {
+		delay *= 2;
+	}
+	return std::min<Clock::duration>(delay, longest);
+}
+
+void RemoteOutbox::notify()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		queued = true;
+	}
+	wakeup.notify_one();
+}
+
+void RemoteOutbox::run()
+{
+	unsigned int failures = 0;
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		queued = false;
+		lock.unlock();
+		const bool sent = send_queued();
+		lock.lock();
+		failures = sent ? 0 : failures + 1;
+
+		if (stopping) {
+			// Changes that came in while sending go out before quitting,
+			// unless the server can't be reached
+			if (failures > 0 || !queued) {
+				return;
+			}
+			continue;
+		}
+
+		if (failures == 0) {
+			wakeup.wait(lock, [this]() {
+				return stopping || queued;
+			});
+			// Changes tend to come in quick succession, e.g. while going
+			// through a list of articles, and are sent together
+			wakeup.wait_for(lock, std::chrono::seconds(1), [this]() {
+				return stopping;
+			});
+		} else {
+			const Clock::duration quota_wait = std::chrono::seconds(
+					api.request_budget().wait_time(RequestBudget::Kind::WRITE));
+			wakeup.wait_for(lock, std::max(retry_delay(failures), quota_wait),
+			[this]() {
+				return stopping;
+			});
+			if (stopping) {
+				return;
+			}
+		}
+	}
+}
+
+} // namespace newsboat
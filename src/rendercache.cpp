@@ -0,0 +1,138 @@
+#include "rendercache.h"
+
+#include "rssfeed.h"
+#include "rssitem.h"
+
+namespace newsboat {
+
+namespace {
+
+/// Same as the default of `article-render-memory-limit`.
+const std::size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+std::uint64_t feed_revision_of(const std::shared_ptr<RssItem>& item)
+{
+	const auto feed = item->get_feedptr();
+	return feed != nullptr ? feed->revision() : 0;
+}
+
+}
+
+bool RenderCache::Options::operator==(const Options& other) const
+{
+	return text_width == other.text_width
+		&& window_width == other.window_width
+		&& renderer == other.renderer
+		&& rules_revision == other.rules_revision;
+}
+
+RenderCache::RenderCache(std::size_t max_bytes)
+	: max_bytes(max_bytes)
+	, total_bytes(0)
+{
+}
+
+RenderCache& RenderCache::shared()
+{
+	static RenderCache instance(DEFAULT_MAX_BYTES);
+	return instance;
+}
+
+void RenderCache::set_max_bytes(std::size_t limit)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	max_bytes = limit;
+	evict_unlocked();
+}
+
+nonstd::optional<RenderCache::Rendered> RenderCache::get(
+	const std::shared_ptr<RssItem>& item, const Options& options)
+{
+	const std::uint64_t revision = item->revision();
+	const std::uint64_t feed_revision = feed_revision_of(item);
+
+	std::lock_guard<std::mutex> guard(mtx);
+	const auto it = index.find(item.get());
+	if (it == index.end()) {
+		return nonstd::nullopt;
+	}
+	const Entry& entry = *it->second;
+	if (entry.item.lock() != item) {
+		// The item it was rendered from is gone
+		erase_unlocked(item.get());
+		return nonstd::nullopt;
+	}
+	if (entry.revision != revision
+		|| entry.feed_revision != feed_revision
+		|| entry.base != item->get_base()
+		|| !(entry.options == options)) {
+		return nonstd::nullopt;
+	}
+	entries.splice(entries.begin(), entries, it->second);
+	return entry.rendered;
+}
+
+void RenderCache::put(const std::shared_ptr<RssItem>& item,
+	const Options& options, const Rendered& rendered)
+{
+	Entry entry{item.get(), item, item->revision(), feed_revision_of(item),
+		item->get_base(), options, rendered};
+
+	std::lock_guard<std::mutex> guard(mtx);
+	erase_unlocked(item.get());
+	if (max_bytes == 0) {
+		return;
+	}
+	total_bytes += size_of(entry);
+	entries.push_front(std::move(entry));
+	index[item.get()] = entries.begin();
+	evict_unlocked();
+}
+
+std::size_t RenderCache::size() const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return entries.size();
+}
+
+std::size_t RenderCache::bytes() const
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return total_bytes;
+}
+
+std::size_t RenderCache::size_of(const Entry& entry)
+{
+	std::size_t size = sizeof(Entry) + entry.base.capacity()
+		+ entry.options.renderer.capacity() + entry.rendered.text.capacity()
+		+ entry.rendered.links.capacity() * sizeof(LinkPair);
+	for (const auto& link : entry.rendered.links) {
+		size += link.first.capacity();
+	}
+	return size;
+}
+
+void RenderCache::erase_unlocked(const RssItem* item)
+{
+	const auto it = index.find(item);
+	if (it == index.end()) {
+		return;
+	}
+	total_bytes -= size_of(*it->second);
+	entries.erase(it->second);
+	index.erase(it);
+}
+
+void RenderCache::evict_unlocked()
+{
+	// Unlike DescriptionLru, a view that's bigger than the limit on its own
+	// isn't kept either
+	while (total_bytes > max_bytes && !entries.empty()) {
+		const auto& victim = entries.back();
+		total_bytes -= size_of(victim);
+		index.erase(victim.key);
+		entries.pop_back();
+	}
+}
+
+} // namespace newsboat
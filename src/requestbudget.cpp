@@ -0,0 +1,173 @@
+#include "requestbudget.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <curl/curl.h>
+#include <strings.h>
+
+#include "logger.h"
+#include "utils.h"
+
+namespace newsboat {
+
+namespace {
+
+/// How long to wait after a 429 that doesn't say
+const time_t DEFAULT_RETRY_AFTER = 60;
+/// When a quota is assumed to start over if the server doesn't say
+const time_t DEFAULT_RESET_AFTER = 60 * 60;
+/// Times above this are dates rather than numbers of seconds
+const time_t EARLIEST_DATE = 1000000000;
+
+/// Whether \a header is the header named \a name (which ends in a colon),
+/// and if so, sets \a value to its value.
+bool header_value(const std::string& header, const char* name,
+	std::string& value)
+{
+	const std::size_t length = std::strlen(name);
+	if (strncasecmp(header.c_str(), name, length) != 0) {
+		return false;
+	}
+	value = header.substr(length);
+	utils::trim(value);
+	return true;
+}
+
+bool is_number(const std::string& value)
+{
+	return !value.empty() && std::isdigit(static_cast<unsigned char>(value[0]));
+}
+
+unsigned long to_number(const std::string& value)
+{
+	return std::strtoul(value.c_str(), nullptr, 10);
+}
+
+}
+
+void RequestBudget::read_header(const std::string& header)
+{
+	const time_t now = time(nullptr);
+	std::string value;
+	std::lock_guard<std::mutex> guard(mtx);
+
+	if (header.compare(0, 5, "HTTP/") == 0) {
+		const auto code_start = header.find(' ');
+		const long status = code_start == std::string::npos ? 0 :
+			std::strtol(header.c_str() + code_start, nullptr, 10);
+		too_many_requests = status == 429;
+		if (too_many_requests) {
+			blocked_until = std::max(blocked_until, now + DEFAULT_RETRY_AFTER);
+			LOG(Level::WARN, "RequestBudget: the server got too many requests");
+		}
+	} else if (header_value(header, "Retry-After:", value)) {
+		if (too_many_requests) {
+			const time_t until = is_number(value)
+				? now + static_cast<time_t>(to_number(value))
+				: curl_getdate(value.c_str(), nullptr);
+			if (until > now) {
+				blocked_until = until;
+			}
+		}
+	} else if (header_value(header, "X-Reader-Zone1-Usage:", value)) {
+		reads.used = to_number(value);
+	} else if (header_value(header, "X-Reader-Zone1-Limit:", value)) {
+		reads.limit = to_number(value);
+	} else if (header_value(header, "X-Reader-Zone2-Usage:", value)) {
+		writes.used = to_number(value);
+		separate_writes = true;
+	} else if (header_value(header, "X-Reader-Zone2-Limit:", value)) {
+		writes.limit = to_number(value);
+		separate_writes = true;
+	} else if (header_value(header, "X-Reader-Limits-Reset-After:", value)
+		&& is_number(value)) {
+		reset_at = now + static_cast<time_t>(to_number(value));
+	} else if (header_value(header, "X-RateLimit-Limit:", value)) {
+		reads.limit = to_number(value);
+		if (pending_remaining >= 0) {
+			reads.used = reads.limit - std::min<unsigned long>(reads.limit,
+					pending_remaining);
+			pending_remaining = -1;
+		}
+	} else if (header_value(header, "X-RateLimit-Remaining:", value)) {
+		const unsigned long left = to_number(value);
+		if (reads.limit == 0) {
+			pending_remaining = static_cast<long>(left);
+		} else {
+			reads.used = reads.limit - std::min(reads.limit, left);
+		}
+	} else if (header_value(header, "X-RateLimit-Reset:", value)
+		&& is_number(value)) {
+		const time_t reset = static_cast<time_t>(to_number(value));
+		reset_at = reset >= EARLIEST_DATE ? reset : now + reset;
+	} else {
+		return;
+	}
+
+	if (reset_at == 0 && (reads.limit != 0 || writes.limit != 0)) {
+		reset_at = now + DEFAULT_RESET_AFTER;
+	}
+}
+
+void RequestBudget::spend(Kind kind)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	start_over(time(nullptr));
+	if (kind == Kind::WRITE && separate_writes) {
+		++writes.used;
+	} else {
+		++reads.used;
+	}
+}
+
+bool RequestBudget::allows(Kind kind) const
+{
+	return wait_time(kind) == 0;
+}
+
+time_t RequestBudget::wait_time(Kind kind) const
+{
+	const time_t now = time(nullptr);
+	std::lock_guard<std::mutex> guard(mtx);
+	start_over(now);
+
+	time_t wait = std::max<time_t>(0, blocked_until - now);
+	if (remaining(kind) == 0) {
+		wait = std::max(wait, std::max<time_t>(1, reset_at - now));
+	}
+	return wait;
+}
+
+void RequestBudget::start_over(time_t now) const
+{
+	if (reset_at != 0 && now >= reset_at) {
+		LOG(Level::DEBUG, "RequestBudget: the quota starts over");
+		reads.used = 0;
+		writes.used = 0;
+		reset_at = 0;
+	}
+}
+
+const RequestBudget::Quota& RequestBudget::quota(Kind kind) const
+{
+	return kind == Kind::WRITE && separate_writes ? writes : reads;
+}
+
+unsigned long RequestBudget::remaining(Kind kind) const
+{
+	const Quota& q = quota(kind);
+	if (q.limit == 0) {
+		return ULONG_MAX;
+	}
+	unsigned long limit = q.limit;
+	if (kind == Kind::READ && !separate_writes) {
+		// The rest is kept for writes
+		limit -= std::max(1UL, q.limit / 10);
+	}
+	return q.used >= limit ? 0 : limit - q.used;
+}
+
+} // namespace newsboat
@@ -5,6 +5,7 @@
 #include <cinttypes>
 #include <cstring>
 #include <curl/curl.h>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <langinfo.h>
@@ -19,23 +20,214 @@
 #include "confighandlerexception.h"
 #include "dbexception.h"
 #include "htmlrenderer.h"
+#include "keyedsort.h"
 #include "logger.h"
 #include "scopemeasure.h"
 #include "strprintf.h"
+#include "tagindex.h"
 #include "tagsouppullparser.h"
+#include "titleindex.h"
 #include "utils.h"
 
 namespace newsboat {
 
+namespace {
+
+/// Guards the lists of feeds that count each article, and what the feeds
+/// report to UnreadGuids and TagIndex, so that the counts agree with the
+/// articles' unread flags.
+std::mutex unread_counts_mutex;
+
+bool has_hidden_tag(const std::vector<std::string>& tags)
+{
+	return std::any_of(tags.begin(),
+			tags.end(),
+	[](const std::string& tag) {
+		return tag.substr(0, 1) == "!";
+	});
+}
+
+/// Returns the items of \a feed that aren't deleted and match \a m, in
+/// order.
+std::vector<std::shared_ptr<RssItem>> matching_items(Matcher& m,
+	const std::shared_ptr<RssFeed>& feed)
+{
+	std::vector<std::shared_ptr<RssItem>> candidates;
+	std::vector<Matchable*> batch;
+	for (const auto& item : feed->items()) {
+		if (!item->deleted()) {
+			candidates.push_back(item);
+			batch.push_back(item.get());
+		}
+	}
+
+	const auto matched = m.matches(batch);
+	std::vector<std::shared_ptr<RssItem>> result;
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		if (matched[i]) {
+			result.push_back(candidates[i]);
+		}
+	}
+	return result;
+}
+
+/// \brief The feeds of \a feeds whose articles query feeds with \a matchers
+/// have to look at.
+///
+/// Those are all but the query feeds, except that feeds that aren't
+/// loaded yet are looked up in the cache first, which has all of their
+/// articles, so that those without any matches stay unloaded.
+std::vector<std::shared_ptr<RssFeed>> feeds_to_match(Cache* ch,
+	const std::vector<Matcher*>& matchers,
+	const std::vector<std::shared_ptr<RssFeed>>& feeds)
+{
+	nonstd::optional<std::unordered_set<std::string>> candidates;
+	const bool all_loaded = std::all_of(feeds.begin(), feeds.end(),
+	[](const std::shared_ptr<RssFeed>& feed) {
+		return feed->is_query_feed() || feed->items_loaded();
+	});
+	if (ch != nullptr && !all_loaded) {
+		candidates = std::unordered_set<std::string>();
+		for (const auto matcher : matchers) {
+			const auto condition = matcher->sql_condition();
+			if (!condition) {
+				candidates = nonstd::nullopt;
+				break;
+			}
+			const auto feedurls = ch->feeds_with_matches(*condition);
+			candidates->insert(feedurls.begin(), feedurls.end());
+		}
+	}
+
+	std::vector<std::shared_ptr<RssFeed>> result;
+	for (const auto& feed : feeds) {
+		if (feed->is_query_feed()) {
+			// don't fetch items from other query feeds!
+			continue;
+		}
+		if (candidates && !feed->items_loaded()
+			&& candidates->count(feed->rssurl()) == 0) {
+			continue;
+		}
+		result.push_back(feed);
+	}
+	return result;
+}
+
+using ItemComparator = std::function<bool(const std::shared_ptr<RssItem>&,
+		const std::shared_ptr<RssItem>&)>;
+
+// The orders of the sort keys that the comparators below and
+// RssFeed::sort_unlocked() share
+
+bool titles_in_order(const std::string& a, const std::string& b,
+	SortDirection sd)
+{
+	const auto cmp = utils::strnaturalcmp(a, b);
+	return sd == SortDirection::DESC ? (cmp > 0) : (cmp < 0);
+}
+
+bool strings_in_order(const std::string& a, const std::string& b,
+	SortDirection sd)
+{
+	const auto cmp = strcmp(a.c_str(), b.c_str());
+	return sd == SortDirection::DESC ? (cmp > 0) : (cmp < 0);
+}
+
+bool dates_in_order(time_t a, time_t b, SortDirection sd)
+{
+	// date is descending by default
+	return sd == SortDirection::ASC ? (a > b) : (a < b);
+}
+
+/// Returns the order that \a sort_strategy puts articles in, or an empty
+/// function if it shuffles them.
+ItemComparator item_comparator(const ArticleSortStrategy& sort_strategy)
+{
+	switch (sort_strategy.sm) {
+	case ArtSortMethod::TITLE:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return titles_in_order(utils::utf8_to_locale(a->title()),
+					utils::utf8_to_locale(b->title()), sort_strategy.sd);
+		};
+	case ArtSortMethod::FLAGS:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return strings_in_order(a->flags(), b->flags(), sort_strategy.sd);
+		};
+	case ArtSortMethod::AUTHOR:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return strings_in_order(utils::utf8_to_locale(a->author()),
+					utils::utf8_to_locale(b->author()), sort_strategy.sd);
+		};
+	case ArtSortMethod::LINK:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return strings_in_order(a->link(), b->link(), sort_strategy.sd);
+		};
+	case ArtSortMethod::GUID:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return strings_in_order(a->guid(), b->guid(), sort_strategy.sd);
+		};
+	case ArtSortMethod::DATE:
+		return [=](const std::shared_ptr<RssItem>& a,
+		const std::shared_ptr<RssItem>& b) {
+			return dates_in_order(a->pubDate_timestamp(), b->pubDate_timestamp(),
+					sort_strategy.sd);
+		};
+	case ArtSortMethod::RANDOM:
+		break;
+	}
+	return ItemComparator();
+}
+
+}
+
+void UnreadGuids::add(const std::string& guid)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	++counts[guid];
+}
+
+void UnreadGuids::remove(const std::string& guid)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto it = counts.find(guid);
+	if (it != counts.end() && --it->second == 0) {
+		counts.erase(it);
+	}
+}
+
+unsigned int UnreadGuids::size() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return counts.size();
+}
+
 RssFeed::RssFeed(Cache* c, const std::string& rssurl)
 	: pubDate_(0)
 	, rssurl_(rssurl)
+	, items_loaded_(true)
+	, unread_items_loaded_(false)
+	, unread_count_(0)
+	, summary_unread_count_(0)
+	, summaries_reported_(false)
+	, unread_guids_(nullptr)
+	, tag_index_(nullptr)
+	, title_index_(nullptr)
+	, reported_unread_(0)
+	, hidden_(false)
+	, query_items_collected(false)
 	, ch(c)
 	, search_feed(false)
 	, is_rtl_(false)
 	, idx(0)
 	, order(0)
 	, status_(DlStatus::SUCCESS)
+	, revision_(0)
 {
 	if (utils::is_query_url(rssurl_)) {
 		/* Query string looks like this:
@@ -77,18 +269,353 @@ RssFeed::RssFeed(Cache* c, const std::string& rssurl)
 
 RssFeed::~RssFeed()
 {
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	report_all_unread(false);
+	if (tag_index_ != nullptr) {
+		tag_index_->remove_feed(this);
+	}
+	for (const auto& item : items_) {
+		auto& feeds = item->counting_feeds_;
+		feeds.erase(std::remove(feeds.begin(), feeds.end(), this), feeds.end());
+		if (title_index_ != nullptr) {
+			title_index_->remove_item(item.get());
+		}
+	}
 }
 
-unsigned int RssFeed::unread_item_count() const
+void RssFeed::set_item_summaries(std::vector<ItemSummary> summaries)
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
-	return std::count_if(items_.begin(),
-			items_.end(),
-	[](const std::shared_ptr<RssItem>& item) {
-		return item->unread();
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	if (summaries_reported_) {
+		report_summaries(false);
+	}
+	item_summaries_ = std::move(summaries);
+	summary_unread_count_ = std::count_if(item_summaries_.begin(),
+			item_summaries_.end(),
+	[](const ItemSummary& summary) {
+		return summary.unread;
+	});
+	summaries_reported_ = true;
+	report_summaries(true);
+	items_loaded_ = false;
+	report_unread_count();
+}
+
+std::vector<ItemSummary> RssFeed::item_summaries() const
+{
+	if (!items_loaded_) {
+		std::lock_guard<std::mutex> lock(unread_counts_mutex);
+		if (!unread_items_loaded_) {
+			return item_summaries_;
+		}
+
+		// The articles that were read in may have changed since
+		std::unordered_map<std::string, const RssItem*> loaded;
+		for (const auto& item : items_) {
+			loaded[item->guid()] = item.get();
+		}
+		std::vector<ItemSummary> summaries;
+		summaries.reserve(item_summaries_.size());
+		for (const auto& summary : item_summaries_) {
+			const auto it = loaded.find(summary.guid);
+			if (it == loaded.end()) {
+				summaries.push_back(summary);
+			} else if (!it->second->deleted()) {
+				const RssItem& item = *it->second;
+				summaries.push_back({item.guid(), item.pubDate_timestamp(),
+						item.unread(), item.flags()});
+			}
+		}
+		return summaries;
+	}
+
+	std::vector<ItemSummary> summaries;
+	summaries.reserve(items_.size());
+	for (const auto& item : items_) {
+		if (!item->deleted()) {
+			summaries.push_back({item->guid(), item->pubDate_timestamp(),
+					item->unread(), item->flags()});
+		}
+	}
+	return summaries;
+}
+
+void RssFeed::add_item(std::shared_ptr<RssItem> item)
+{
+	items_.push_back(item);
+	guid_index_.add(items_, items_.size() - 1);
+	count_item(item);
+}
+
+void RssFeed::add_items(const std::vector<std::shared_ptr<RssItem>>& items)
+{
+	for (const auto& item : items) {
+		add_item(item);
+	}
+}
+
+void RssFeed::erase_items(std::vector<std::shared_ptr<RssItem>>::iterator
+	begin,
+	std::vector<std::shared_ptr<RssItem>>::iterator end)
+{
+	for (auto it = begin; it != end; ++it) {
+		uncount_item(*it);
+	}
+	items_.erase(begin, end);
+	guid_index_.invalidate();
+}
+
+void RssFeed::erase_item(std::vector<std::shared_ptr<RssItem>>::iterator pos)
+{
+	uncount_item(*pos);
+	items_.erase(pos);
+	guid_index_.invalidate();
+}
+
+void RssFeed::load_items_if_needed()
+{
+	if (items_loaded_) {
+		return;
+	}
+	std::call_once(items_load_once_, [this]() {
+		LOG(Level::DEBUG,
+			"RssFeed::load_items_if_needed: loading items of %s",
+			rssurl_);
+		if (unread_items_loaded_) {
+			std::unordered_set<std::string> loaded;
+			for (const auto& item : items_) {
+				loaded.insert(item->guid());
+			}
+			ch->fetch_items(*this, false, &loaded);
+		} else {
+			ch->fetch_items(*this);
+		}
+		items_loaded_ = true;
+		unread_items_loaded_ = false;
+		unreport_summaries();
 	});
 }
 
+void RssFeed::load_unread_items_if_needed()
+{
+	if (items_loaded_ || unread_items_loaded_) {
+		return;
+	}
+	std::call_once(unread_items_load_once_, [this]() {
+		LOG(Level::DEBUG,
+			"RssFeed::load_unread_items_if_needed: loading unread items of %s",
+			rssurl_);
+		ch->fetch_items(*this, true);
+		unread_items_loaded_ = true;
+		unreport_summaries();
+	});
+}
+
+SharedLock RssFeed::lock_items_for_reading(bool unread_only)
+{
+	if (!items_loaded_ && !(unread_only && unread_items_loaded_)) {
+		std::lock_guard<SharedMutex> lock(item_mutex);
+		if (unread_only) {
+			load_unread_items_if_needed();
+		} else {
+			load_items_if_needed();
+		}
+	}
+	// Nothing unloads the articles again
+	return SharedLock(item_mutex);
+}
+
+void RssFeed::unreport_summaries()
+{
+	// The items were reported as they were added
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	if (summaries_reported_) {
+		report_summaries(false);
+		summaries_reported_ = false;
+	}
+	report_unread_count();
+}
+
+void RssFeed::count_item(const std::shared_ptr<RssItem>& item)
+{
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	item->counting_feeds_.push_back(this);
+	if (item->unread_) {
+		count_unread(item->guid(), true);
+	}
+	if (title_index_ != nullptr) {
+		title_index_->add_item(item);
+	}
+}
+
+void RssFeed::uncount_item(const std::shared_ptr<RssItem>& item)
+{
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	auto& feeds = item->counting_feeds_;
+	const auto it = std::find(feeds.begin(), feeds.end(), this);
+	if (it == feeds.end()) {
+		return;
+	}
+	feeds.erase(it);
+	if (item->unread_) {
+		count_unread(item->guid(), false);
+	}
+	if (title_index_ != nullptr) {
+		title_index_->remove_item(item.get());
+	}
+}
+
+void RssFeed::count_unread(const std::string& guid, bool unread)
+{
+	if (unread) {
+		++unread_count_;
+	} else {
+		--unread_count_;
+	}
+	report_unread(guid, unread);
+	report_unread_count();
+}
+
+void RssFeed::report_unread_count()
+{
+	if (tag_index_ == nullptr) {
+		return;
+	}
+	const auto count = unread_item_count();
+	if (count != reported_unread_) {
+		reported_unread_ = count;
+		tag_index_->set_unread(this, count);
+	}
+}
+
+void RssFeed::report_unread(const std::string& guid, bool unread)
+{
+	if (unread_guids_ == nullptr || hidden()) {
+		return;
+	}
+	if (unread) {
+		unread_guids_->add(guid);
+	} else {
+		unread_guids_->remove(guid);
+	}
+}
+
+void RssFeed::report_all_unread(bool unread)
+{
+	if (unread_guids_ == nullptr || hidden()) {
+		return;
+	}
+	for (const auto& item : items_) {
+		if (item->unread_) {
+			report_unread(item->guid(), unread);
+		}
+	}
+	if (summaries_reported_) {
+		report_summaries(unread);
+	}
+}
+
+void RssFeed::report_summaries(bool unread)
+{
+	for (const auto& summary : item_summaries_) {
+		if (summary.unread) {
+			report_unread(summary.guid, unread);
+		}
+	}
+}
+
+RssFeed::MemoryUsage RssFeed::memory_usage() const
+{
+	MemoryUsage usage{0, 0, 0, 0};
+	const SharedLock lock(item_mutex);
+	for (const auto& item : items_) {
+		const auto item_usage = item->memory_usage();
+		usage.item_bytes += item_usage.item_bytes;
+		usage.description_bytes += item_usage.description_bytes;
+	}
+	usage.index_bytes = items_.capacity() * sizeof(items_[0])
+		+ guid_index_.bytes();
+
+	std::lock_guard<std::mutex> lock2(unread_counts_mutex);
+	usage.summary_bytes = item_summaries_.capacity() * sizeof(ItemSummary);
+	for (const auto& summary : item_summaries_) {
+		usage.summary_bytes += summary.guid.capacity()
+			+ summary.flags.capacity();
+	}
+	return usage;
+}
+
+void RssFeed::set_unread_guids(UnreadGuids* guids)
+{
+	std::lock_guard<SharedMutex> lock(item_mutex);
+	std::lock_guard<std::mutex> lock2(unread_counts_mutex);
+	if (guids == unread_guids_) {
+		return;
+	}
+	report_all_unread(false);
+	unread_guids_ = guids;
+	report_all_unread(true);
+}
+
+void RssFeed::set_tag_index(TagIndex* index)
+{
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	if (tag_index_ != nullptr) {
+		tag_index_->remove_feed(this);
+	}
+	tag_index_ = index;
+	if (tag_index_ != nullptr) {
+		reported_unread_ = unread_item_count();
+		tag_index_->add_feed(this, tags_, reported_unread_);
+	}
+}
+
+void RssFeed::set_title_index(TitleIndex* index)
+{
+	std::lock_guard<SharedMutex> lock(item_mutex);
+	std::lock_guard<std::mutex> lock2(unread_counts_mutex);
+	if (index == title_index_) {
+		return;
+	}
+	for (const auto& item : items_) {
+		if (title_index_ != nullptr) {
+			title_index_->remove_item(item.get());
+		}
+		if (index != nullptr) {
+			index->add_item(item);
+		}
+	}
+	title_index_ = index;
+}
+
+void RssFeed::set_item_unread(RssItem& item, bool unread)
+{
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	if (item.unread_ == unread) {
+		return;
+	}
+	item.unread_ = unread;
+	for (const auto feed : item.counting_feeds_) {
+		feed->count_unread(item.guid(), unread);
+	}
+}
+
+void RssFeed::set_items_unread(
+	const std::vector<std::shared_ptr<RssItem>>& items, bool unread)
+{
+	std::lock_guard<std::mutex> lock(unread_counts_mutex);
+	for (const auto& item : items) {
+		if (item->unread_ == unread) {
+			continue;
+		}
+		item->unread_ = unread;
+		++item->revision_;
+		for (const auto feed : item->counting_feeds_) {
+			feed->count_unread(item->guid(), unread);
+		}
+	}
+}
+
 bool RssFeed::matches_tag(const std::string& tag)
 {
 	return std::find_if(
@@ -107,21 +634,31 @@ std::string RssFeed::get_firsttag()
 	return "";
 }
 
-std::string RssFeed::get_tags() const
+void RssFeed::set_tags(const std::vector<std::string>& tags)
 {
-	std::string tags;
+	std::lock_guard<SharedMutex> lock(item_mutex);
+	std::lock_guard<std::mutex> lock2(unread_counts_mutex);
+	const bool was_hidden = hidden_;
+	if (!was_hidden && has_hidden_tag(tags)) {
+		report_all_unread(false);
+	}
+	tags_ = tags;
+	hidden_ = has_hidden_tag(tags_);
+	if (was_hidden && !hidden_) {
+		report_all_unread(true);
+	}
+	if (tag_index_ != nullptr) {
+		tag_index_->add_feed(this, tags_, reported_unread_);
+	}
+
+	visible_tags_.clear();
 	for (const auto& t : tags_) {
 		if (t.substr(0, 1) != "~" && t.substr(0, 1) != "!") {
-			tags.append(t);
-			tags.append(" ");
+			visible_tags_.append(t);
+			visible_tags_.append(" ");
 		}
 	}
-	return tags;
-}
-
-void RssFeed::set_tags(const std::vector<std::string>& tags)
-{
-	tags_ = tags;
+	++revision_;
 }
 
 std::string RssFeed::title() const
@@ -140,33 +677,34 @@ std::string RssFeed::title() const
 		: utils::utf8_to_locale(title_);
 }
 
-bool RssFeed::hidden() const
-{
-	return std::any_of(tags_.begin(),
-			tags_.end(),
-	[](const std::string& tag) {
-		return tag.substr(0, 1) == "!";
-	});
-}
-
 std::shared_ptr<RssItem> RssFeed::get_item_by_guid(const std::string& guid)
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	const auto lock = lock_items_for_reading();
 	return get_item_by_guid_unlocked(guid);
 }
 
 std::shared_ptr<RssItem> RssFeed::get_item_by_guid_unlocked(
 	const std::string& guid)
 {
-	auto it = items_guid_map.find(guid);
-	if (it != items_guid_map.end()) {
-		return it->second;
+	load_items_if_needed();
+	std::size_t pos;
+	{
+		std::lock_guard<std::mutex> lock(guid_index_mutex_);
+		pos = guid_index_.find(items_, guid);
+		if (pos == GuidIndex::npos) {
+			// The articles may have been reordered through items()
+			guid_index_.invalidate();
+			pos = guid_index_.find(items_, guid);
+		}
+	}
+	if (pos != GuidIndex::npos) {
+		return items_[pos];
 	}
 	LOG(Level::DEBUG,
 		"RssFeed::get_item_by_guid_unlocked: hit dummy item!");
 	LOG(Level::DEBUG,
-		"RssFeed::get_item_by_guid_unlocked: items_guid_map.size = %" PRIu64,
-		static_cast<uint64_t>(items_guid_map.size()));
+		"RssFeed::get_item_by_guid_unlocked: guid_index_.size = %" PRIu64,
+		static_cast<uint64_t>(guid_index_.size()));
 
 	// should never happen!
 	return std::shared_ptr<RssItem>(new RssItem(ch));
@@ -175,31 +713,54 @@ std::shared_ptr<RssItem> RssFeed::get_item_by_guid_unlocked(
 nonstd::optional<std::string> RssFeed::attribute_value(const std::string&
 	attribname) const
 {
-	if (attribname == "feedtitle") {
+	return attribute_value_by_id(attribute_id(attribname), attribname);
+}
+
+nonstd::optional<std::string> RssFeed::attribute_value_by_id(
+	MatchableAttribute id, const std::string& /* attribname */) const
+{
+	switch (id) {
+	case MatchableAttribute::FEEDTITLE:
 		return title();
-	} else if (attribname == "description") {
+	case MatchableAttribute::DESCRIPTION:
 		return utils::utf8_to_locale(description());
-	} else if (attribname == "feedlink") {
+	case MatchableAttribute::FEEDLINK:
 		return link();
-	} else if (attribname == "feeddate") {
+	case MatchableAttribute::FEEDDATE:
 		return pubDate();
-	} else if (attribname == "rssurl") {
+	case MatchableAttribute::RSSURL:
 		return rssurl();
-	} else if (attribname == "unread_count") {
+	case MatchableAttribute::UNREAD_COUNT:
 		return std::to_string(unread_item_count());
-	} else if (attribname == "total_count") {
-		return std::to_string(items_.size());
-	} else if (attribname == "tags") {
+	case MatchableAttribute::TOTAL_COUNT:
+		return std::to_string(total_item_count());
+	case MatchableAttribute::TAGS:
 		return get_tags();
-	} else if (attribname == "feedindex") {
+	case MatchableAttribute::FEEDINDEX:
 		return std::to_string(idx);
+	default:
+		return nonstd::nullopt;
+	}
+}
+
+nonstd::optional<std::int64_t> RssFeed::attribute_number_by_id(
+	MatchableAttribute id, std::time_t /* now */) const
+{
+	switch (id) {
+	case MatchableAttribute::UNREAD_COUNT:
+		return unread_item_count();
+	case MatchableAttribute::TOTAL_COUNT:
+		return total_item_count();
+	case MatchableAttribute::FEEDINDEX:
+		return idx;
+	default:
+		return nonstd::nullopt;
 	}
-	return nonstd::nullopt;
 }
 
 void RssFeed::update_items(std::vector<std::shared_ptr<RssFeed>> feeds)
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	if (query.empty()) {
 		return;
 	}
@@ -210,132 +771,244 @@ void RssFeed::update_items(std::vector<std::shared_ptr<RssFeed>> feeds)
 
 	Matcher m(query);
 
+	for (const auto& item : items_) {
+		uncount_item(item);
+	}
 	items_.clear();
-	items_guid_map.clear();
+	guid_index_.invalidate();
+
+	for (const auto& feed : feeds_to_match(ch, {&m}, feeds)) {
+		for (const auto& item : matching_items(m, feed)) {
+			item->set_feedptr(feed);
+			add_item(item);
+		}
+	}
+
+	sm.stopover("matching");
 
+	finish_query_items();
+
+	sm.stopover("sorting");
+}
+
+void RssFeed::update_query_feeds(
+	const std::vector<std::shared_ptr<RssFeed>>& feeds)
+{
+	ScopeMeasure sm("RssFeed::update_query_feeds");
+
+	std::vector<std::shared_ptr<RssFeed>> query_feeds;
+	std::vector<std::unique_ptr<Matcher>> owned_matchers;
+	std::vector<Matcher*> matchers;
+	Cache* ch = nullptr;
 	for (const auto& feed : feeds) {
-		if (feed->is_query_feed()) {
-			// don't fetch items from other query feeds!
-			continue;
+		if (feed->is_query_feed() && !feed->query.empty()) {
+			query_feeds.push_back(feed);
+			owned_matchers.emplace_back(new Matcher(feed->query));
+			matchers.push_back(owned_matchers.back().get());
+			ch = feed->ch;
 		}
+	}
+	if (query_feeds.empty()) {
+		return;
+	}
+
+	// The articles of all feeds are collected once, for all the queries
+	std::vector<std::shared_ptr<RssFeed>> item_feeds;
+	std::vector<std::shared_ptr<RssItem>> candidates;
+	std::vector<Matchable*> batch;
+	for (const auto& feed : feeds_to_match(ch, matchers, feeds)) {
 		for (const auto& item : feed->items()) {
-			if (!item->deleted() && m.matches(item.get())) {
-				LOG(Level::DEBUG, "RssFeed::update_items: Matcher matches!");
-				item->set_feedptr(feed);
-				items_.push_back(item);
-				items_guid_map[item->guid()] = item;
+			if (!item->deleted()) {
+				item_feeds.push_back(feed);
+				candidates.push_back(item);
+				batch.push_back(item.get());
 			}
 		}
 	}
 
+	sm.stopover("collecting");
+
+	std::vector<std::exception_ptr> errors;
+	const auto matched = Matcher::matches_all(matchers, batch, errors);
+
 	sm.stopover("matching");
 
+	// Serially, since the items keep track of the feeds that count them
+	for (std::size_t q = 0; q < query_feeds.size(); ++q) {
+		auto& query_feed = *query_feeds[q];
+		std::lock_guard<SharedMutex> lock(query_feed.item_mutex);
+		LOG(Level::DEBUG, "RssFeed::update_query_feeds: query = `%s'",
+			query_feed.query);
+		for (const auto& item : query_feed.items_) {
+			query_feed.uncount_item(item);
+		}
+		query_feed.items_.clear();
+		query_feed.guid_index_.invalidate();
+		for (std::size_t i = 0; i < candidates.size(); ++i) {
+			if (matched[q][i]) {
+				candidates[i]->set_feedptr(item_feeds[i]);
+				query_feed.add_item(candidates[i]);
+			}
+		}
+		query_feed.finish_query_items();
+	}
+
+	sm.stopover("distributing");
+
+	for (const auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+void RssFeed::finish_query_items()
+{
 	std::sort(items_.begin(), items_.end());
+	guid_index_.invalidate();
+	query_items_collected = true;
+	sorted_by = nonstd::nullopt;
+}
 
-	sm.stopover("sorting");
+bool RssFeed::update_items(const std::vector<std::shared_ptr<RssFeed>>& feeds,
+	const std::unordered_set<std::string>& replaced_feedurls,
+	const ArticleSortStrategy& sort_strategy)
+{
+	std::lock_guard<SharedMutex> lock(item_mutex);
+	if (query.empty() || !query_items_collected) {
+		return false;
+	}
+
+	LOG(Level::DEBUG,
+		"RssFeed::update_items: query = `%s', %" PRIu64 " feed(s) replaced",
+		query,
+		static_cast<uint64_t>(replaced_feedurls.size()));
+
+	ScopeMeasure sm("RssFeed::update_items (incremental)");
+
+	Matcher m(query);
+
+	const auto was_replaced = [&](const std::shared_ptr<RssItem>& item) {
+		return replaced_feedurls.count(item->feedurl()) > 0;
+	};
+	for (const auto& item : items_) {
+		if (was_replaced(item)) {
+			uncount_item(item);
+		}
+	}
+	items_.erase(std::remove_if(items_.begin(), items_.end(), was_replaced),
+		items_.end());
+	guid_index_.invalidate();
+
+	sm.stopover("removing");
+
+	const auto old_size = items_.size();
+	for (const auto& feed : feeds) {
+		if (feed->is_query_feed() || replaced_feedurls.count(feed->rssurl()) == 0) {
+			continue;
+		}
+		for (const auto& item : matching_items(m, feed)) {
+			item->set_feedptr(feed);
+			add_item(item);
+		}
+	}
+
+	sm.stopover("matching");
+
+	const auto compare = item_comparator(sort_strategy);
+	if (sorted_by && *sorted_by == sort_strategy && compare) {
+		const auto middle = items_.begin() + old_size;
+		std::stable_sort(middle, items_.end(), compare);
+		std::inplace_merge(items_.begin(), middle, items_.end(), compare);
+		guid_index_.invalidate();
+	} else {
+		sort_unlocked(sort_strategy);
+	}
+
+	sm.stopover("merging");
+
+	return true;
 }
 
 void RssFeed::sort(const ArticleSortStrategy& sort_strategy)
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	sort_unlocked(sort_strategy);
 }
 
 void RssFeed::sort_unlocked(const ArticleSortStrategy& sort_strategy)
 {
+	guid_index_.invalidate();
+
+	// Each article's key is read once, rather than for every comparison
+	using Item = std::shared_ptr<RssItem>;
+	const auto sd = sort_strategy.sd;
+	const auto by_string = [=](const std::string* a, const std::string* b) {
+		return strings_in_order(*a, *b, sd);
+	};
 	switch (sort_strategy.sm) {
 	case ArtSortMethod::TITLE:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			const auto left = utils::utf8_to_locale(a->title());
-			const auto right = utils::utf8_to_locale(b->title());
-			const auto cmp = utils::strnaturalcmp(left, right);
-			return sort_strategy.sd == SortDirection::DESC ? (cmp > 0) : (cmp < 0);
+		keyedsort::sort_by_key<std::string>(items_, [](const Item& item) {
+			return utils::utf8_to_locale(item->title());
+		}, [=](const std::string& a, const std::string& b) {
+			return titles_in_order(a, b, sd);
 		});
-		break;
-	case ArtSortMethod::FLAGS:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			return sort_strategy.sd ==
-				SortDirection::DESC
-				? (strcmp(a->flags().c_str(),
-						b->flags().c_str()) > 0)
-				: (strcmp(a->flags().c_str(),
-						b->flags().c_str()) < 0);
-		});
-		break;
+		sorted_by = sort_strategy;
+		return;
 	case ArtSortMethod::AUTHOR:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			const auto author_a = utils::utf8_to_locale(a->author());
-			const auto author_b = utils::utf8_to_locale(b->author());
-			const auto cmp = strcmp(author_a.c_str(), author_b.c_str());
-			return sort_strategy.sd == SortDirection::DESC ? (cmp > 0) : (cmp < 0);
-		});
-		break;
-	case ArtSortMethod::LINK:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			return sort_strategy.sd ==
-				SortDirection::DESC
-				? (strcmp(a->link().c_str(),
-						b->link().c_str()) > 0)
-				: (strcmp(a->link().c_str(),
-						b->link().c_str()) < 0);
-		});
-		break;
-	case ArtSortMethod::GUID:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			return sort_strategy.sd ==
-				SortDirection::DESC
-				? (strcmp(a->guid().c_str(),
-						b->guid().c_str()) > 0)
-				: (strcmp(a->guid().c_str(),
-						b->guid().c_str()) < 0);
+		keyedsort::sort_by_key<std::string>(items_, [](const Item& item) {
+			return utils::utf8_to_locale(item->author());
+		}, [=](const std::string& a, const std::string& b) {
+			return strings_in_order(a, b, sd);
 		});
-		break;
+		sorted_by = sort_strategy;
+		return;
 	case ArtSortMethod::DATE:
-		std::stable_sort(items_.begin(),
-			items_.end(),
-			[&](const std::shared_ptr<RssItem>& a,
-		const std::shared_ptr<RssItem>& b) {
-			// date is descending by default
-			return sort_strategy.sd == SortDirection::ASC
-				? (a->pubDate_timestamp() >
-					b->pubDate_timestamp())
-				: (a->pubDate_timestamp() <
-					b->pubDate_timestamp());
+		keyedsort::sort_by_key<time_t>(items_, [](const Item& item) {
+			return item->pubDate_timestamp();
+		}, [=](time_t a, time_t b) {
+			return dates_in_order(a, b, sd);
 		});
-		break;
+		sorted_by = sort_strategy;
+		return;
+	// These are kept by the articles, so the keys point to them
+	case ArtSortMethod::FLAGS:
+		keyedsort::sort_by_key<const std::string*>(items_,
+		[](const Item& item) {
+			return &item->flags();
+		}, by_string);
+		sorted_by = sort_strategy;
+		return;
+	case ArtSortMethod::LINK:
+		keyedsort::sort_by_key<const std::string*>(items_,
+		[](const Item& item) {
+			return &item->link();
+		}, by_string);
+		sorted_by = sort_strategy;
+		return;
+	case ArtSortMethod::GUID:
+		keyedsort::sort_by_key<const std::string*>(items_,
+		[](const Item& item) {
+			return &item->guid();
+		}, by_string);
+		sorted_by = sort_strategy;
+		return;
 	case ArtSortMethod::RANDOM:
-		std::random_shuffle(items_.begin(), items_.end());
 		break;
 	}
+
+	std::random_shuffle(items_.begin(), items_.end());
+	sorted_by = nonstd::nullopt;
 }
 
 void RssFeed::purge_deleted_items()
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	ScopeMeasure m1("RssFeed::purge_deleted_items");
 
-	// Purge in items_guid_map
-	{
-		std::lock_guard<std::mutex> lock2(items_guid_map_mutex);
-		for (const auto& item : items_) {
-			if (item->deleted()) {
-				items_guid_map.erase(item->guid());
-			}
+	for (const auto& item : items_) {
+		if (item->deleted()) {
+			uncount_item(item);
 		}
 	}
 
@@ -345,11 +1018,12 @@ void RssFeed::purge_deleted_items()
 		return item->deleted();
 	}),
 	items_.end());
+	guid_index_.invalidate();
 }
 
 void RssFeed::set_feedptrs(std::shared_ptr<RssFeed> self)
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	for (const auto& item : items_) {
 		item->set_feedptr(self);
 	}
@@ -374,7 +1048,7 @@ std::string RssFeed::get_status()
 
 void RssFeed::unload()
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	for (const auto& item : items_) {
 		item->unload();
 	}
@@ -382,16 +1056,25 @@ void RssFeed::unload()
 
 void RssFeed::load()
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
+	std::lock_guard<SharedMutex> lock(item_mutex);
 	ch->fetch_descriptions(this);
 }
 
 void RssFeed::mark_all_items_read()
 {
-	std::lock_guard<std::mutex> lock(item_mutex);
-	for (const auto& item : items_) {
-		item->set_unread_nowrite(false);
+	std::lock_guard<SharedMutex> lock(item_mutex);
+	{
+		std::lock_guard<std::mutex> lock2(unread_counts_mutex);
+		if (summaries_reported_) {
+			report_summaries(false);
+		}
+		for (auto& summary : item_summaries_) {
+			summary.unread = false;
+		}
+		summary_unread_count_ = 0;
+		report_unread_count();
 	}
+	set_items_unread(items_, false);
 }
 
 } // namespace newsboat
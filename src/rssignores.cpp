@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cinttypes>
 #include <cstring>
 #include <curl/curl.h>
 #include <functional>
@@ -52,15 +53,23 @@ void RssIgnores::handle_action(const std::string& action,
 			std::string errorMessage;
 			const std::string pattern = ignore_rssurl.substr(prefix_len,
 					ignore_rssurl.length() - prefix_len);
-			const auto regex = Regex::compile(pattern, REG_EXTENDED | REG_ICASE, errorMessage);
+			auto regex = Regex::compile_shared(pattern, REG_EXTENDED | REG_ICASE,
+					errorMessage);
 			if (regex == nullptr) {
 				throw ConfigHandlerException(strprintf::fmt(
 						_("`%s' is not a valid regular expression: %s"),
 						pattern, errorMessage));
 			}
+			ignores_by_regex.push_back(RegexRule{std::move(regex), m});
+		} else if (ignore_rssurl == "*") {
+			ignores_for_all_feeds.push_back(m);
+		} else {
+			ignores_by_feedurl[ignore_rssurl].push_back(m);
 		}
 
 		ignores.push_back(FeedUrlExprPair(ignore_rssurl, m));
+		std::lock_guard<std::mutex> guard(matchers_mtx);
+		matchers_by_feedurl.clear();
 	} else if (action == "always-download") {
 		if (params.empty()) {
 			throw ConfigHandlerException(ActionHandlerStatus::TOO_FEW_PARAMS);
@@ -107,33 +116,130 @@ void RssIgnores::dump_config(std::vector<std::string>& config_output) const
 
 bool RssIgnores::matches(RssItem* item)
 {
-	const int prefix_len = REGEX_PREFIX.length();
-	for (const auto& ign : ignores) {
-		bool matched = false;
-		LOG(Level::DEBUG,
-			"RssIgnores::matches: ign.first = `%s' item->feedurl = `%s'",
-			ign.first,
-			item->feedurl());
-
-		if (!ign.first.compare(0, prefix_len, REGEX_PREFIX)) {
-			const std::string pattern = ign.first.substr(prefix_len, ign.first.length() - prefix_len);
-			std::string errorMessage;
-			const auto regex = Regex::compile(pattern, REG_EXTENDED | REG_ICASE, errorMessage);
-			const auto matches = regex->matches(item->feedurl(), 1, 0);
-			matched = !matches.empty();
-		} else {
-			matched = ign.first == "*" || item->feedurl() == ign.first;
-		}
+	if (ignores.empty()) {
+		return false;
+	}
 
-		if (matched && ign.second->matches(item)) {
+	const auto matchers = matchers_for(item->feedurl());
+	for (const auto& matcher : *matchers) {
+		if (matcher->matches(item)) {
 			LOG(Level::DEBUG,
-				"RssIgnores::matches: found match");
+				"RssIgnores::matches: `%s' matches an item of `%s'",
+				matcher->get_expression(),
+				item->feedurl());
 			return true;
 		}
 	}
 	return false;
 }
 
+std::vector<bool> RssIgnores::matches(
+	const std::vector<std::shared_ptr<RssItem>>& items)
+{
+	std::vector<bool> ignored(items.size(), false);
+	if (ignores.empty()) {
+		return ignored;
+	}
+
+	std::unordered_map<std::string, std::vector<std::size_t>> by_feedurl;
+	for (std::size_t i = 0; i < items.size(); ++i) {
+		by_feedurl[items[i]->feedurl()].push_back(i);
+	}
+
+	for (const auto& feed : by_feedurl) {
+		// Indices into `items` that no rule has ignored yet
+		std::vector<std::size_t> pending = feed.second;
+		const auto matchers = matchers_for(feed.first);
+		for (const auto& matcher : *matchers) {
+			if (pending.empty()) {
+				break;
+			}
+
+			std::vector<Matchable*> batch;
+			batch.reserve(pending.size());
+			for (const auto i : pending) {
+				batch.push_back(items[i].get());
+			}
+			const auto matched = matcher->matches(batch);
+
+			std::vector<std::size_t> still_pending;
+			for (std::size_t n = 0; n < pending.size(); ++n) {
+				if (matched[n]) {
+					ignored[pending[n]] = true;
+				} else {
+					still_pending.push_back(pending[n]);
+				}
+			}
+			LOG(Level::DEBUG,
+				"RssIgnores::matches: `%s' matches %" PRIu64 " item(s) of `%s'",
+				matcher->get_expression(),
+				static_cast<uint64_t>(pending.size() - still_pending.size()),
+				feed.first);
+			pending.swap(still_pending);
+		}
+	}
+
+	return ignored;
+}
+
+std::vector<std::pair<std::string, std::string>> RssIgnores::sql_conditions()
+{
+	std::vector<std::pair<std::string, std::string>> result;
+	for (const auto& ignore : ignores) {
+		if (ignore.first.compare(0, REGEX_PREFIX.length(), REGEX_PREFIX) == 0) {
+			continue;
+		}
+		const auto condition = ignore.second->sql_condition();
+		if (condition.has_value()) {
+			result.emplace_back(ignore.first, condition.value());
+		}
+	}
+	return result;
+}
+
+bool RssIgnores::uses_attribute(const std::string& feedurl,
+	MatchableAttribute attribute)
+{
+	if (ignores.empty()) {
+		return false;
+	}
+
+	const auto matchers = matchers_for(feedurl);
+	return std::any_of(matchers->begin(), matchers->end(),
+	[&](const std::shared_ptr<Matcher>& matcher) {
+		return matcher->uses_attribute(attribute);
+	});
+}
+
+std::shared_ptr<const RssIgnores::Matchers> RssIgnores::matchers_for(
+	const std::string& feedurl)
+{
+	std::lock_guard<std::mutex> guard(matchers_mtx);
+	const auto cached = matchers_by_feedurl.find(feedurl);
+	if (cached != matchers_by_feedurl.end()) {
+		return cached->second;
+	}
+
+	auto matchers = std::make_shared<Matchers>(ignores_for_all_feeds);
+	const auto by_feedurl = ignores_by_feedurl.find(feedurl);
+	if (by_feedurl != ignores_by_feedurl.end()) {
+		matchers->insert(matchers->end(), by_feedurl->second.begin(),
+			by_feedurl->second.end());
+	}
+	for (const auto& rule : ignores_by_regex) {
+		if (!rule.regex->matches(feedurl, 1, 0).empty()) {
+			matchers->push_back(rule.matcher);
+		}
+	}
+	LOG(Level::DEBUG,
+		"RssIgnores::matchers_for: %" PRIu64 " rule(s) apply to `%s'",
+		static_cast<uint64_t>(matchers->size()),
+		feedurl);
+
+	matchers_by_feedurl[feedurl] = matchers;
+	return matchers;
+}
+
 bool RssIgnores::matches_lastmodified(const std::string& url)
 {
 	return std::find_if(ignores_lastmodified.begin(),
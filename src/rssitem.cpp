@@ -3,18 +3,63 @@
 #include <algorithm>
 #include <cinttypes>
 #include <langinfo.h>
+#include <unordered_map>
 
 #include "cache.h"
+#include "contenttext.h"
 #include "dbexception.h"
+#include "descriptionlru.h"
 #include "rssfeed.h"
-#include "scopemeasure.h"
+#include "scopestats.h"
 #include "strprintf.h"
 #include "utils.h"
 
 namespace newsboat {
 
+namespace {
+
+/// \brief Returns the copy of \a text that every article shares.
+///
+/// Copies that no article uses anymore are dropped as the pool grows.
+std::shared_ptr<const std::string> intern(const std::string& text)
+{
+	static const auto empty = std::make_shared<const std::string>();
+	if (text.empty()) {
+		return empty;
+	}
+
+	static std::mutex mtx;
+	static std::unordered_map<std::string, std::weak_ptr<const std::string>>
+		pool;
+	static std::size_t prune_at = 1024;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	auto& entry = pool[text];
+	auto shared = entry.lock();
+	if (!shared) {
+		shared = std::make_shared<const std::string>(text);
+		entry = shared;
+	}
+
+	if (pool.size() >= prune_at) {
+		for (auto it = pool.begin(); it != pool.end();) {
+			if (it->second.expired()) {
+				it = pool.erase(it);
+			} else {
+				++it;
+			}
+		}
+		prune_at = std::max<std::size_t>(1024, 2 * pool.size());
+	}
+	return shared;
+}
+
+}
+
 RssItem::RssItem(Cache* c)
-	: ch(c)
+	: author_(intern(""))
+	, feedurl_(intern(""))
+	, ch(c)
 	, idx(0)
 	, size_(0)
 	, pubDate_(0)
@@ -22,10 +67,16 @@ RssItem::RssItem(Cache* c)
 	, enqueued_(false)
 	, deleted_(0)
 	, override_unread_(false)
+	, description_in_cache_(false)
+	, revision_(0)
+	, row_id_(0)
 {
 }
 
-RssItem::~RssItem() {}
+RssItem::~RssItem()
+{
+	DescriptionLru::shared().erase(this);
+}
 
 // RssItem setters
 
@@ -33,24 +84,147 @@ void RssItem::set_title(const std::string& t)
 {
 	title_ = utils::consolidate_whitespace(t);
 	utils::trim(title_);
+	++revision_;
 }
 
-void RssItem::set_link(const std::string& l)
+void RssItem::set_link(std::string l)
 {
-	link_ = l;
+	link_ = std::move(l);
 	utils::trim(link_);
+	++revision_;
 }
 
 void RssItem::set_author(const std::string& a)
 {
-	author_ = a;
+	if (*author_ != a) {
+		author_ = intern(a);
+	}
+	++revision_;
+}
+
+void RssItem::set_feedurl(const std::string& f)
+{
+	if (*feedurl_ != f) {
+		feedurl_ = intern(f);
+	}
 }
 
-void RssItem::set_description(const std::string& content,
+void RssItem::set_description(std::string content, std::string mime_type)
+{
+	std::lock_guard<std::mutex> guard(state_mutex);
+	description_ = Description{std::move(content), std::move(mime_type)};
+	++revision_;
+}
+
+void RssItem::set_description_from_cache(const std::string& content,
 	const std::string& mime_type)
 {
-	std::lock_guard<std::mutex> guard(description_mutex);
-	description_ = {content, mime_type};
+	{
+		std::lock_guard<std::mutex> guard(state_mutex);
+		description_.reset();
+		description_in_cache_ = true;
+	}
+	DescriptionLru::shared().put(this, {content, mime_type});
+}
+
+bool RssItem::description_loaded() const
+{
+	{
+		std::lock_guard<std::mutex> guard(state_mutex);
+		if (description_.has_value()) {
+			return true;
+		}
+	}
+	return DescriptionLru::shared().contains(this);
+}
+
+void RssItem::unload()
+{
+	{
+		std::lock_guard<std::mutex> guard(state_mutex);
+		description_.reset();
+		description_in_cache_ = true;
+	}
+	DescriptionLru::shared().erase(this);
+}
+
+RssItem::MemoryUsage RssItem::memory_usage() const
+{
+	MemoryUsage usage;
+	usage.item_bytes = sizeof(RssItem) + title_.capacity() + link_.capacity()
+		+ guid_.capacity() + enclosure_url_.capacity()
+		+ enclosure_type_.capacity() + flags_.capacity() + oldflags_.capacity()
+		+ base.capacity();
+	std::lock_guard<std::mutex> guard(state_mutex);
+	usage.description_bytes = 0;
+	if (description_.has_value()) {
+		usage.description_bytes = description_->text.capacity()
+			+ description_->mime.capacity();
+		if (description_->plain_text != nullptr) {
+			usage.description_bytes += description_->plain_text->capacity();
+		}
+	}
+	return usage;
+}
+
+Description RssItem::description() const
+{
+	{
+		std::lock_guard<std::mutex> guard(state_mutex);
+		if (description_.has_value()) {
+			return description_.value();
+		}
+		if (ch == nullptr || !description_in_cache_) {
+			return {"", ""};
+		}
+	}
+
+	auto& lru = DescriptionLru::shared();
+	const auto loaded = lru.get(this);
+	if (loaded.has_value()) {
+		return loaded.value();
+	}
+
+	// Not holding the lock: the cache might be busy with a reload
+	const auto descriptions = ch->fetch_descriptions({guid_});
+	const auto description = descriptions.find(guid_);
+	if (description == descriptions.end()) {
+		std::lock_guard<std::mutex> guard(state_mutex);
+		description_in_cache_ = false;
+		return description_.value_or(Description{"", ""});
+	}
+	lru.put(this, description->second);
+	return description->second;
+}
+
+std::shared_ptr<const std::string> RssItem::plain_text() const
+{
+	{
+		std::lock_guard<std::mutex> guard(state_mutex);
+		if (description_.has_value()) {
+			if (description_->plain_text == nullptr) {
+				description_->plain_text = std::make_shared<const std::string>(
+						content_text(description_->text, description_->mime));
+			}
+			return description_->plain_text;
+		}
+	}
+
+	auto& lru = DescriptionLru::shared();
+	const auto loaded = lru.get(this);
+	if (loaded.has_value()) {
+		if (loaded->plain_text != nullptr) {
+			return loaded->plain_text;
+		}
+		const auto text = std::make_shared<const std::string>(
+				content_text(loaded->text, loaded->mime));
+		lru.set_plain_text(this, text);
+		return text;
+	}
+	// Not loaded: the cache has the text already, and reading it doesn't
+	// load the description
+	return std::make_shared<const std::string>(
+			ch != nullptr ? ch->fetch_content_text(*this) : "");
 }
 
 void RssItem::set_size(unsigned int size)
@@ -77,22 +251,26 @@ std::string RssItem::length() const
 void RssItem::set_pubDate(time_t t)
 {
 	pubDate_ = t;
+	++revision_;
 }
 
-void RssItem::set_guid(const std::string& g)
+void RssItem::set_guid(std::string g)
 {
-	guid_ = g;
+	guid_ = std::move(g);
+	++revision_;
 }
 
 void RssItem::set_unread_nowrite(bool u)
 {
-	unread_ = u;
+	RssFeed::set_item_unread(*this, u);
+	++revision_;
 }
 
 void RssItem::set_unread_nowrite_notify(bool u, bool notify)
 {
-	unread_ = u;
-	std::shared_ptr<RssFeed> feedptr = feedptr_.lock();
+	RssFeed::set_item_unread(*this, u);
+	++revision_;
+	std::shared_ptr<RssFeed> feedptr = get_feedptr();
 	if (feedptr && notify) {
 		feedptr->get_item_by_guid(guid_)->set_unread_nowrite(
 			unread_); // notify parent feed
@@ -103,20 +281,22 @@ void RssItem::set_unread(bool u)
 {
 	if (unread_ != u) {
 		bool old_u = unread_;
-		unread_ = u;
-		std::shared_ptr<RssFeed> feedptr = feedptr_.lock();
+		RssFeed::set_item_unread(*this, u);
+		++revision_;
+		std::shared_ptr<RssFeed> feedptr = get_feedptr();
 		if (feedptr)
 			feedptr->get_item_by_guid(guid_)->set_unread_nowrite(
 				unread_); // notify parent feed
 		try {
 			if (ch) {
 				ch->update_rssitem_unread_and_enqueued(
-					this, feedurl_);
+					this, *feedurl_);
 			}
 		} catch (const DbException& e) {
 			// if the update failed, restore the old unread flag and
 			// rethrow the exception
-			unread_ = old_u;
+			RssFeed::set_item_unread(*this, old_u);
+			++revision_;
 			throw;
 		}
 	}
@@ -127,64 +307,91 @@ std::string RssItem::pubDate() const
 	return utils::mt_strf_localtime(_("%a, %d %b %Y %T %z"), pubDate_);
 }
 
-void RssItem::set_enclosure_url(const std::string& url)
+void RssItem::set_enclosure_url(std::string url)
 {
-	enclosure_url_ = url;
+	enclosure_url_ = std::move(url);
+	++revision_;
 }
 
-void RssItem::set_enclosure_type(const std::string& type)
+void RssItem::set_enclosure_type(std::string type)
 {
-	enclosure_type_ = type;
+	enclosure_type_ = std::move(type);
+	++revision_;
 }
 
 nonstd::optional<std::string> RssItem::attribute_value(const std::string&
 	attribname) const
 {
-	if (attribname == "title") {
+	return attribute_value_by_id(attribute_id(attribname), attribname);
+}
+
+nonstd::optional<std::string> RssItem::attribute_value_by_id(
+	MatchableAttribute id, const std::string& attribname) const
+{
+	switch (id) {
+	case MatchableAttribute::TITLE:
 		return utils::utf8_to_locale(title());
-	} else if (attribname == "link") {
+	case MatchableAttribute::LINK:
 		return link();
-	} else if (attribname == "author") {
+	case MatchableAttribute::AUTHOR:
 		return utils::utf8_to_locale(author());
-	} else if (attribname == "content") {
-		ScopeMeasure sm("RssItem::attribute_value(\"content\")");
-		std::lock_guard<std::mutex> guard(description_mutex);
-		if (description_.has_value()) {
-			const std::string content = description_.value().text;
-			return utils::utf8_to_locale(content);
-		} else if (ch) {
-			std::string description = ch->fetch_description(*this);
-			return utils::utf8_to_locale(description);
-		}
-		return "";
-	} else if (attribname == "date") {
+	case MatchableAttribute::CONTENT: {
+		SCOPE_STATS("RssItem::attribute_value(\"content\")");
+		// Matched against the text without the markup
+		return utils::utf8_to_locale(*plain_text());
+	}
+	case MatchableAttribute::DATE:
 		return pubDate();
-	} else if (attribname == "guid") {
+	case MatchableAttribute::GUID:
 		return guid();
-	} else if (attribname == "unread") {
+	case MatchableAttribute::UNREAD:
 		return unread_ ? "yes" : "no";
-	} else if (attribname == "enclosure_url") {
+	case MatchableAttribute::ENCLOSURE_URL:
 		return enclosure_url();
-	} else if (attribname == "enclosure_type") {
+	case MatchableAttribute::ENCLOSURE_TYPE:
 		return enclosure_type();
-	} else if (attribname == "flags") {
+	case MatchableAttribute::FLAGS:
 		return flags();
-	} else if (attribname == "age")
+	case MatchableAttribute::AGE:
 		return std::to_string(
 				(time(nullptr) - pubDate_timestamp()) / 86400);
-	else if (attribname == "articleindex") {
+	case MatchableAttribute::ARTICLEINDEX:
 		return std::to_string(idx);
+	default:
+		break;
 	}
 
 	// if we have a feed, then forward the request
-	std::shared_ptr<RssFeed> feedptr = feedptr_.lock();
+	std::shared_ptr<RssFeed> feedptr = get_feedptr();
 	if (feedptr) {
-		return feedptr->RssFeed::attribute_value(attribname);
+		return feedptr->RssFeed::attribute_value_by_id(id, attribname);
 	}
 
 	return nonstd::nullopt;
 }
 
+nonstd::optional<std::int64_t> RssItem::attribute_number_by_id(
+	MatchableAttribute id, std::time_t now) const
+{
+	switch (id) {
+	case MatchableAttribute::AGE:
+		return (now - pubDate_timestamp()) / 86400;
+	case MatchableAttribute::ARTICLEINDEX:
+		return idx;
+	case MatchableAttribute::UNREAD_COUNT:
+	case MatchableAttribute::TOTAL_COUNT:
+	case MatchableAttribute::FEEDINDEX: {
+		std::shared_ptr<RssFeed> feedptr = get_feedptr();
+		if (feedptr) {
+			return feedptr->RssFeed::attribute_number_by_id(id, now);
+		}
+		return nonstd::nullopt;
+	}
+	default:
+		return nonstd::nullopt;
+	}
+}
+
 void RssItem::update_flags()
 {
 	if (ch) {
@@ -197,6 +404,7 @@ void RssItem::set_flags(const std::string& ff)
 	oldflags_ = flags_;
 	flags_ = ff;
 	sort_flags();
+	++revision_;
 }
 
 void RssItem::sort_flags()
@@ -217,12 +425,22 @@ void RssItem::sort_flags()
 
 void RssItem::set_feedptr(std::shared_ptr<RssFeed> ptr)
 {
+	std::lock_guard<std::mutex> guard(state_mutex);
 	feedptr_ = std::weak_ptr<RssFeed>(ptr);
+	++revision_;
 }
 
 void RssItem::set_feedptr(const std::weak_ptr<RssFeed>& ptr)
 {
+	std::lock_guard<std::mutex> guard(state_mutex);
 	feedptr_ = ptr;
+	++revision_;
+}
+
+std::shared_ptr<RssFeed> RssItem::get_feedptr() const
+{
+	std::lock_guard<std::mutex> guard(state_mutex);
+	return feedptr_.lock();
 }
 
 } // namespace newsboat
@@ -4,9 +4,11 @@
 #include <cerrno>
 #include <cinttypes>
 #include <cstring>
+#include <ctime>
 #include <curl/curl.h>
 #include <sstream>
 
+#include "arena.h"
 #include "cache.h"
 #include "config.h"
 #include "configcontainer.h"
@@ -22,12 +24,22 @@
 #include "rss/rssparser.h"
 #include "rssfeed.h"
 #include "rssignores.h"
+#include "sharedfetchcache.h"
 #include "strprintf.h"
+#include "tracelog.h"
 #include "ttrssapi.h"
 #include "utils.h"
 
 namespace newsboat {
 
+namespace {
+
+/// How long a feed is fetched from where it moved to before the original
+/// URL is asked again whether the move still stands.
+const time_t MOVED_REVALIDATE_INTERVAL = 7 * 24 * 60 * 60;
+
+}
+
 RssParser::RssParser(const std::string& uri,
 	Cache* c,
 	ConfigContainer* cfg,
@@ -38,6 +50,9 @@ RssParser::RssParser(const std::string& uri,
 	, cfgcont(cfg)
 	, ign(ii)
 	, api(a)
+	, unchanged(false)
+	, keep_parsed(false)
+	, unconditional(false)
 	, easyhandle(0)
 {
 	is_ttrss = cfgcont->get_configvalue("urls-source") == "ttrss";
@@ -45,19 +60,127 @@ RssParser::RssParser(const std::string& uri,
 	is_ocnews = cfgcont->get_configvalue("urls-source") == "ocnews";
 	is_miniflux = cfgcont->get_configvalue("urls-source") == "miniflux";
 	is_freshrss = cfgcont->get_configvalue("urls-source") == "freshrss";
+
+	// What remote APIs send depends on who's asking
+	const std::string shared_dir = cfgcont->get_configvalue(
+			"shared-fetch-cache-dir");
+	if (!shared_dir.empty() && api == nullptr) {
+		shared_cache.reset(new SharedFetchCache(shared_dir,
+				60 * std::max(0,
+					cfgcont->get_configvalue_as_int("shared-fetch-cache-max-age"))));
+	}
 }
 
 RssParser::~RssParser() {}
 
 std::shared_ptr<RssFeed> RssParser::parse()
 {
+	if (defers_fetch()) {
+		return nullptr;
+	}
 	retrieve_uri(my_uri);
+	return make_feed();
+}
+
+bool RssParser::downloads_over_http() const
+{
+	return !is_ttrss && !is_newsblur && !is_ocnews && !is_miniflux
+		&& !is_freshrss && utils::is_http_url(my_uri);
+}
+
+bool RssParser::defers_fetch() const
+{
+	if (api == nullptr) {
+		return false;
+	}
+	const time_t wait = api->request_budget().wait_time(
+			RequestBudget::Kind::READ);
+	if (wait == 0) {
+		return false;
+	}
+	LOG(Level::INFO,
+		"RssParser::defers_fetch: out of requests for %" PRId64 " second(s), "
+		"not fetching %s",
+		static_cast<int64_t>(wait),
+		my_uri);
+	return true;
+}
 
+bool RssParser::runs_plugin() const
+{
+	return !is_ttrss && !is_newsblur && !is_ocnews && !is_miniflux
+		&& !is_freshrss
+		&& (utils::is_exec_url(my_uri) || utils::is_filter_url(my_uri));
+}
+
+void RssParser::prepare_plugin(std::vector<std::string>& argv,
+	nonstd::optional<std::string>& input)
+{
+	if (utils::is_exec_url(my_uri)) {
+		argv = {"sh", "-c", my_uri.substr(5)};
+		input = nonstd::nullopt;
+	} else {
+		const auto parts = utils::extract_filter(my_uri);
+		argv = {"/bin/sh", "-c", std::string(parts.script_name)};
+		input = utils::retrieve_url(std::string(parts.url), cfgcont);
+	}
+}
+
+std::shared_ptr<RssFeed> RssParser::parse_plugin_output(
+	const std::string& output)
+{
+	rsspp::Parser p;
+	p.set_streaming(parses_streaming());
+	p.set_max_items(parsed_items_limit());
+	f = p.parse_buffer(output);
+	LOG(Level::DEBUG,
+		"RssParser::parse_plugin_output: %s, valid = %s",
+		my_uri,
+		(f.rss_version != rsspp::Feed::Version::UNKNOWN) ? "true" : "false");
+	return make_feed();
+}
+
+void RssParser::prepare_download(CurlHandle& handle,
+	rsspp::Transfer& transfer)
+{
+	start_download(my_uri, handle, transfer);
+}
+
+std::shared_ptr<RssFeed> RssParser::parse_download(CurlHandle& handle,
+	rsspp::Transfer& transfer,
+	CURLcode result)
+{
+	finish_download(my_uri, handle, transfer, result);
+	return make_feed();
+}
+
+bool RssParser::parse_shared(std::shared_ptr<RssFeed>& feed)
+{
+	if (!take_shared_response(my_uri)) {
+		return false;
+	}
+	feed = make_feed();
+	return true;
+}
+
+std::shared_ptr<RssFeed> RssParser::parse_same_as(const RssParser& source)
+{
+	f = source.f;
+	hints = source.hints;
+	unchanged = source.unchanged;
+	return make_feed();
+}
+
+std::shared_ptr<RssFeed> RssParser::make_feed()
+{
 	if (f.rss_version == rsspp::Feed::Version::UNKNOWN) {
 		return nullptr;
 	}
 
 	std::shared_ptr<RssFeed> feed(new RssFeed(ch, my_uri));
+	hints.ttl = RefreshHints::parse_ttl(f.ttl);
+	hints.update_period = RefreshHints::parse_update_period(f.update_period,
+			f.update_frequency);
 
 	/*
 	 * After parsing is done, we fill our feed object with title,
@@ -70,7 +193,19 @@ std::shared_ptr<RssFeed> RssParser::parse()
 	 */
 
 	fill_feed_fields(feed);
-	fill_feed_items(feed);
+	if (keep_parsed) {
+		fill_feed_items(feed, f.items);
+	} else {
+		// The items aren't needed once they're made into articles
+		fill_feed_items(feed, std::move(f.items));
+		f.items.clear();
+	}
+
+	if (!cfgcont->get_configvalue("websub-relay-dir").empty()) {
+		// Hubs know a feed by its "self" link, which can differ from the
+		// URL it was fetched from
+		ch->update_websub_hub(my_uri, f.hub, f.self.empty() ? my_uri : f.self);
+	}
 
 	ch->remove_old_deleted_items(feed.get());
 
@@ -85,16 +220,14 @@ time_t RssParser::parse_date(const std::string& datestr)
 			"RssParser::parse_date: encountered t == -1, trying "
 			"out "
 			"W3CDTF parser...");
-		t = curl_getdate(
-				rsspp::RssParser::w3cdtf_to_rfc822(datestr).c_str(),
-				nullptr);
-	}
-	if (t == -1) {
-		LOG(Level::INFO,
-			"RssParser::parse_date: still t == -1, setting to "
-			"current "
-			"time");
-		t = ::time(nullptr);
+		t = rsspp::RssParser::parse_w3cdtf(datestr);
+		if (t == 0) {
+			LOG(Level::INFO,
+				"RssParser::parse_date: still no date, setting to "
+				"current "
+				"time");
+			t = ::time(nullptr);
+		}
 	}
 	return t;
 }
@@ -185,8 +318,43 @@ void RssParser::retrieve_uri(const std::string& uri)
 
 void RssParser::download_http(const std::string& uri)
 {
+	if (take_shared_response(uri)) {
+		return;
+	}
+
 	unsigned int retrycount =
 		cfgcont->get_configvalue_as_int("download-retries");
+
+	for (unsigned int i = 0; i < retrycount
+		&& f.rss_version == rsspp::Feed::Version::UNKNOWN && !unchanged; i++) {
+		rsspp::Transfer transfer;
+		if (easyhandle) {
+			start_download(uri, *easyhandle, transfer);
+			const CURLcode ret = perform(*easyhandle);
+			finish_download(uri, *easyhandle, transfer, ret);
+		} else {
+			CurlHandle handle;
+			start_download(uri, handle, transfer);
+			const CURLcode ret = perform(handle);
+			finish_download(uri, handle, transfer, ret);
+		}
+	}
+	LOG(Level::DEBUG,
+		"RssParser::parse: http URL %s, valid: %s",
+		uri,
+		(f.rss_version != rsspp::Feed::Version::UNKNOWN) ? "true" : "false");
+}
+
+CURLcode RssParser::perform(CurlHandle& handle) const
+{
+	const auto start = TraceLog::Clock::now();
+	const CURLcode ret = curl_easy_perform(handle.ptr());
+	TraceLog::add("download", start, TraceLog::Clock::now(), my_uri);
+	return ret;
+}
+
+std::unique_ptr<rsspp::Parser> RssParser::make_http_parser() const
+{
 	std::string proxy;
 	std::string proxy_auth;
 	std::string proxy_type;
@@ -197,83 +365,182 @@ void RssParser::download_http(const std::string& uri)
 		proxy_type = cfgcont->get_configvalue("proxy-type");
 	}
 
-	for (unsigned int i = 0; i < retrycount
-		&& f.rss_version == rsspp::Feed::Version::UNKNOWN; i++) {
-		std::string useragent = utils::get_useragent(cfgcont);
-		LOG(Level::DEBUG,
-			"RssParser::download_http: user-agent = %s",
-			useragent);
-		rsspp::Parser p(cfgcont->get_configvalue_as_int(
-				"download-timeout"),
+	std::string useragent = utils::get_useragent(cfgcont);
+	LOG(Level::DEBUG,
+		"RssParser::make_http_parser: user-agent = %s",
+		useragent);
+	std::unique_ptr<rsspp::Parser> parser(new rsspp::Parser(
+			cfgcont->get_configvalue_as_int("download-timeout"),
 			useragent,
 			proxy,
 			proxy_auth,
 			utils::get_proxy_type(proxy_type),
-			cfgcont->get_configvalue_as_bool(
-				"ssl-verifypeer"));
-		time_t lm = 0;
-		std::string etag;
-		if (!ign || !ign->matches_lastmodified(uri)) {
-			ch->fetch_lastmodified(uri, lm, etag);
-		}
-		if (easyhandle) {
-			f = p.parse_url(uri,
-					*easyhandle,
-					lm,
-					etag,
-					api,
-					cfgcont->get_configvalue("cookie-cache"));
-		} else {
-			f = p.parse_url(uri,
-					lm,
-					etag,
-					api,
-					cfgcont->get_configvalue("cookie-cache"));
-		}
-		LOG(Level::DEBUG,
-			"RssParser::download_http: lm = %" PRId64 " etag = %s",
-			// On GCC, `time_t` is `long int`, which is at least 32 bits
-			// long according to the spec. On x86_64, it's actually 64
-			// bits. Thus, casting to int64_t is either a no-op, or an
-			// up-cast which are always safe.
-			static_cast<int64_t>(p.get_last_modified()),
-			p.get_etag());
-		if (p.get_last_modified() != 0 ||
-			p.get_etag().length() > 0) {
-			LOG(Level::DEBUG,
-				"RssParser::download_http: "
-				"lastmodified "
-				"old: %" PRId64 " new: %" PRId64,
-				// On GCC, `time_t` is `long int`, which is at least 32
-				// bits long according to the spec. On x86_64, it's
-				// actually 64 bits. Thus, casting to int64_t is either
-				// a no-op, or an up-cast which are always safe.
-				static_cast<int64_t>(lm),
-				static_cast<int64_t>(p.get_last_modified()));
-			LOG(Level::DEBUG,
-				"RssParser::download_http: etag old: "
-				"%s "
-				"new %s",
-				etag,
-				p.get_etag());
-			ch->update_lastmodified(uri,
-				(p.get_last_modified() != lm)
-				? p.get_last_modified()
-				: 0,
-				(etag != p.get_etag()) ? p.get_etag()
-				: "");
+			cfgcont->get_configvalue_as_bool("ssl-verifypeer")));
+	parser->set_streaming(parses_streaming());
+	parser->set_max_items(parsed_items_limit());
+	parser->set_connect_timeout(std::max(0,
+			cfgcont->get_configvalue_as_int("download-connect-timeout")));
+	// A feed whose Last-Modified can't be trusted can't be revalidated
+	if (shared_cache && (!ign || !ign->matches_lastmodified(my_uri))) {
+		parser->set_shared_cache(shared_cache.get());
+	}
+	return parser;
+}
+
+std::string RssParser::fetched_url(const std::string& uri) const
+{
+	std::string moved_url;
+	time_t moved_since = 0;
+	ch->fetch_moved_url(uri, moved_url, moved_since);
+	const bool moved = !moved_url.empty()
+		&& time(nullptr) - moved_since < MOVED_REVALIDATE_INTERVAL;
+	return moved ? moved_url : uri;
+}
+
+bool RssParser::take_shared_response(const std::string& uri)
+{
+	if (!shared_cache) {
+		return false;
+	}
+	rsspp::Transfer transfer;
+	transfer.url = fetched_url(uri);
+	if (!unconditional) {
+		transfer.sent_body_hash = ch->fetch_body_hash(uri);
+	}
+	if (!make_http_parser()->parse_shared(transfer, f)) {
+		return false;
+	}
+	hints.expires = 0;
+	hints.retry_after = 0;
+	unchanged = transfer.body_unchanged();
+	if (f.rss_version != rsspp::Feed::Version::UNKNOWN) {
+		ch->update_body_hash(uri, transfer.body_hash);
+	}
+	return true;
+}
+
+bool RssParser::parses_streaming() const
+{
+	return cfgcont->get_configvalue("feed-parser") == "streaming";
+}
+
+unsigned int RssParser::parsed_items_limit() const
+{
+	// Cache::externalize_rssfeed() keeps the first `max-items` articles in
+	// the order of the feed, so the ones after them are never stored
+	return ign == nullptr ? cfgcont->snapshot().max_items : 0;
+}
+
+void RssParser::start_download(const std::string& uri,
+	CurlHandle& handle,
+	rsspp::Transfer& transfer)
+{
+	time_t lm = 0;
+	std::string etag;
+	std::uint64_t body_hash = 0;
+	if (!unconditional && (!ign || !ign->matches_lastmodified(uri))) {
+		ch->fetch_lastmodified(uri, lm, etag);
+		body_hash = ch->fetch_body_hash(uri);
+	}
+	make_http_parser()->prepare_transfer(fetched_url(uri),
+		handle,
+		transfer,
+		lm,
+		etag,
+		api,
+		cfgcont->get_configvalue("cookie-cache"));
+	transfer.sent_body_hash = body_hash;
+}
+
+void RssParser::finish_download(const std::string& uri,
+	CurlHandle& handle,
+	rsspp::Transfer& transfer,
+	CURLcode result)
+{
+	// Cache-Control takes precedence over Expires
+	hints.expires = transfer.max_age >= 0
+		? time(nullptr) + transfer.max_age
+		: transfer.expires;
+	hints.retry_after = transfer.retry_after;
+
+	unchanged = false;
+	const auto p = make_http_parser();
+	std::string moved_url;
+	time_t moved_since = 0;
+	ch->fetch_moved_url(uri, moved_url, moved_since);
+	const bool fetched_moved = transfer.url != uri;
+	try {
+		f = p->finish_transfer(uri,
+				handle,
+				transfer,
+				result,
+				cfgcont->get_configvalue("cookie-cache"));
+	} catch (const rsspp::Exception&) {
+		if (fetched_moved) {
+			// Maybe the feed moved back; the original URL tells next time
+			ch->update_moved_url(uri, "", 0);
 		}
+		throw;
+	}
+	if (!transfer.moved_to.empty()) {
+		// A move from where the feed moved to doesn't restart the wait
+		// for asking the original URL again
+		ch->update_moved_url(uri, transfer.moved_to,
+			fetched_moved ? moved_since : time(nullptr));
+	} else if (!fetched_moved && !moved_url.empty()) {
+		LOG(Level::INFO,
+			"RssParser::finish_download: %s doesn't redirect to %s anymore",
+			uri,
+			moved_url);
+		ch->update_moved_url(uri, "", 0);
 	}
+	unchanged = transfer.body_unchanged();
+	if (f.rss_version != rsspp::Feed::Version::UNKNOWN) {
+		ch->update_body_hash(uri, transfer.body_hash);
+	}
+
+	const time_t lm = transfer.sent_lastmodified;
+	const std::string& etag = transfer.sent_etag;
 	LOG(Level::DEBUG,
-		"RssParser::parse: http URL %s, valid: %s",
-		uri,
-		(f.rss_version != rsspp::Feed::Version::UNKNOWN) ? "true" : "false");
+		"RssParser::finish_download: lm = %" PRId64 " etag = %s",
+		// On GCC, `time_t` is `long int`, which is at least 32 bits
+		// long according to the spec. On x86_64, it's actually 64
+		// bits. Thus, casting to int64_t is either a no-op, or an
+		// up-cast which are always safe.
+		static_cast<int64_t>(p->get_last_modified()),
+		p->get_etag());
+	if (p->get_last_modified() != 0 ||
+		p->get_etag().length() > 0) {
+		LOG(Level::DEBUG,
+			"RssParser::finish_download: "
+			"lastmodified "
+			"old: %" PRId64 " new: %" PRId64,
+			// On GCC, `time_t` is `long int`, which is at least 32
+			// bits long according to the spec. On x86_64, it's
+			// actually 64 bits. Thus, casting to int64_t is either
+			// a no-op, or an up-cast which are always safe.
+			static_cast<int64_t>(lm),
+			static_cast<int64_t>(p->get_last_modified()));
+		LOG(Level::DEBUG,
+			"RssParser::finish_download: etag old: "
+			"%s "
+			"new %s",
+			etag,
+			p->get_etag());
+		ch->update_lastmodified(uri,
+			(p->get_last_modified() != lm)
+			? p->get_last_modified()
+			: 0,
+			(etag != p->get_etag()) ? p->get_etag()
+			: "");
+	}
 }
 
 void RssParser::get_execplugin(const std::string& plugin)
 {
 	std::string buf = utils::get_command_output(plugin);
 	rsspp::Parser p;
+	p.set_streaming(parses_streaming());
 	f = p.parse_buffer(buf);
 	LOG(Level::DEBUG,
 		"RssParser::parse: execplugin %s, valid = %s",
@@ -307,6 +574,7 @@ void RssParser::download_filterplugin(const std::string& filter,
 		filter,
 		result);
 	rsspp::Parser p;
+	p.set_streaming(parses_streaming());
 	f = p.parse_buffer(result);
 	LOG(Level::DEBUG,
 		"RssParser::parse: filterplugin %s, valid = %s",
@@ -330,7 +598,9 @@ void RssParser::fill_feed_fields(std::shared_ptr<RssFeed> feed)
 
 	feed->set_link(utils::absolute_url(my_uri, f.link));
 
-	if (!f.pubDate.empty()) {
+	if (f.pubDate_ts != 0) {
+		feed->set_pubDate(f.pubDate_ts);
+	} else if (!f.pubDate.empty()) {
 		feed->set_pubDate(parse_date(f.pubDate));
 	} else {
 		feed->set_pubDate(::time(nullptr));
@@ -344,25 +614,52 @@ void RssParser::fill_feed_fields(std::shared_ptr<RssFeed> feed)
 		feed->link());
 }
 
-void RssParser::fill_feed_items(std::shared_ptr<RssFeed> feed)
+void RssParser::fill_feed_items(std::shared_ptr<RssFeed> feed,
+	std::vector<rsspp::Item> items)
 {
 	/*
 	 * we iterate over all items of a feed, create an RssItem object for
 	 * each item, and fill it with the appropriate values from the data
 	 * structure.
+	 *
+	 * The items only live until the feed is merged into the cache, so
+	 * they're put next to each other, and freed together with the last.
 	 */
-	for (const auto& item : f.items) {
-		std::shared_ptr<RssItem> x(new RssItem(ch));
+	const ArenaAllocator<RssItem> allocator(std::make_shared<Arena>());
 
-		set_item_title(feed, x, item);
+	/*
+	 * Unless an `ignore-article` rule looks at the content, the rules are
+	 * evaluated before it's made, so ignored items are never rendered (or
+	 * their pages downloaded). The title is made before the rules only if
+	 * one of them looks at it.
+	 */
+	const bool ignore_early = ign != nullptr
+		&& !ign->uses_attribute(feed->rssurl(), MatchableAttribute::CONTENT);
+	const bool title_first = !ignore_early
+		|| ign->uses_attribute(feed->rssurl(), MatchableAttribute::TITLE);
+	const unsigned int max_items = cfgcont->snapshot().max_items;
+
+	for (auto& item : items) {
+		if (max_items != 0 && feed->total_item_count() >= max_items) {
+			LOG(Level::DEBUG,
+				"RssParser::fill_feed_items: reached max-items = %u",
+				max_items);
+			break;
+		}
+
+		auto x = std::allocate_shared<RssItem>(allocator, ch);
+
+		// Made first, since it's made of fields the rest move out of item
+		const bool has_guid = !item.guid.empty();
+		std::string guid = get_guid(item);
 
 		if (!item.link.empty()) {
 			x->set_link(
 				utils::absolute_url(feed->link(), item.link));
 		}
 
-		if (x->link().empty() && item.guid_isPermaLink) {
-			x->set_link(item.guid);
+		if (x->link().empty() && item.guid_isPermaLink && has_guid) {
+			x->set_link(guid);
 		}
 
 		set_item_author(x, item);
@@ -433,20 +730,36 @@ void RssParser::fill_feed_items(std::shared_ptr<RssFeed> feed)
 			}
 		}
 
-		set_item_content(x, item);
-
-		if (!item.pubDate.empty()) {
+		if (item.pubDate_ts != 0) {
+			x->set_pubDate(item.pubDate_ts);
+		} else if (!item.pubDate.empty()) {
 			x->set_pubDate(parse_date(item.pubDate));
 		} else {
 			x->set_pubDate(::time(nullptr));
 		}
 
-		x->set_guid(get_guid(item));
+		x->set_guid(std::move(guid));
 
-		x->set_base(item.base);
+		x->set_base(std::move(item.base));
 
 		set_item_enclosure(x, item);
 
+		// The fallback title is made of the link, so this comes after it
+		if (title_first) {
+			set_item_title(feed, x, item);
+		}
+		if (ignore_early && ign->matches(x.get())) {
+			LOG(Level::INFO,
+				"RssParser::parse: ignored article link = `%s'",
+				x->link());
+			continue;
+		}
+		if (!title_first) {
+			set_item_title(feed, x, item);
+		}
+
+		set_item_content(x, item);
+
 		LOG(Level::DEBUG,
 			"RssParser::parse: item title = `%s' link = `%s' "
 			"pubDate "
@@ -461,19 +774,16 @@ void RssParser::fill_feed_items(std::shared_ptr<RssFeed> feed)
 			static_cast<int64_t>(x->pubDate_timestamp()),
 			x->description().text);
 
-		add_item_to_feed(feed, x);
+		add_item_to_feed(feed, x, !ignore_early);
 	}
 }
 
 void RssParser::set_item_title(std::shared_ptr<RssFeed> feed,
 	std::shared_ptr<RssItem> x,
-	const rsspp::Item& item)
+	rsspp::Item& item)
 {
-	std::string title = item.title;
-
-	if (item.title.empty()) {
-		title = utils::make_title(item.link);
-	}
+	std::string title = item.title.empty() ? utils::make_title(item.link) :
+		std::move(item.title);
 
 	if (is_html_type(item.title_type)) {
 		x->set_title(render_xhtml_title(title, feed->link()));
@@ -484,7 +794,7 @@ void RssParser::set_item_title(std::shared_ptr<RssFeed> feed,
 }
 
 void RssParser::set_item_author(std::shared_ptr<RssItem> x,
-	const rsspp::Item& item)
+	rsspp::Item& item)
 {
 	/*
 	 * some feeds only have a feed-wide managingEditor, which we use as an
@@ -502,17 +812,17 @@ void RssParser::set_item_author(std::shared_ptr<RssItem> x,
 }
 
 void RssParser::set_item_content(std::shared_ptr<RssItem> x,
-	const rsspp::Item& item)
+	rsspp::Item& item)
 {
 	handle_content_encoded(x, item);
 
 	handle_itunes_summary(x, item);
 
 	if (x->description().text.empty()) {
-		x->set_description(item.description, item.description_mime_type);
+		x->set_description(std::move(item.description),
+			std::move(item.description_mime_type));
 	} else {
-		if (cfgcont->get_configvalue_as_bool(
-				"always-display-description") &&
+		if (cfgcont->snapshot().always_display_description &&
 			!item.description.empty())
 			x->set_description(
 				x->description().text + "<hr>" + item.description, "text/html");
@@ -521,11 +831,11 @@ void RssParser::set_item_content(std::shared_ptr<RssItem> x,
 	/* if it's still empty and we shall download the full page, then we do
 	 * so. */
 	if (x->description().text.empty() &&
-		cfgcont->get_configvalue_as_bool("download-full-page") &&
+		cfgcont->snapshot().download_full_page &&
 		!x->link().empty()) {
 
 		CurlHandle handle;
-		const std::string content = utils::retrieve_url(x->link(), handle, cfgcont, "", nullptr,
+		std::string content = utils::retrieve_url(x->link(), handle, cfgcont, "", nullptr,
 				HTTPMethod::GET);
 		std::string content_mime_type;
 
@@ -541,7 +851,7 @@ void RssParser::set_item_content(std::shared_ptr<RssItem> x,
 			content_mime_type = "application/octet-stream";
 		}
 
-		x->set_description(content, content_mime_type);
+		x->set_description(std::move(content), std::move(content_mime_type));
 	}
 
 	LOG(Level::DEBUG,
@@ -549,7 +859,7 @@ void RssParser::set_item_content(std::shared_ptr<RssItem> x,
 		x->description().text);
 }
 
-std::string RssParser::get_guid(const rsspp::Item& item) const
+std::string RssParser::get_guid(rsspp::Item& item) const
 {
 	/*
 	 * We try to find a GUID (some unique identifier) for an item. If the
@@ -559,9 +869,14 @@ std::string RssParser::get_guid(const rsspp::Item& item) const
 	 * duplicates when the title or the link changes.
 	 */
 	if (!item.guid.empty()) {
-		return item.guid;
+		return std::move(item.guid);
 	} else if (!item.link.empty() && !item.pubDate.empty()) {
 		return item.link + item.pubDate;
+	} else if (!item.link.empty() && item.pubDate_ts != 0) {
+		// W3CDTF dates used to be turned into RFC 822 text before they got
+		// here; that text is still what the GUID is made of, so that the
+		// same article keeps getting the same GUID
+		return item.link + rsspp::RssParser::format_rfc822(item.pubDate_ts);
 	} else if (!item.link.empty()) {
 		return item.link;
 	} else if (!item.title.empty()) {
@@ -572,39 +887,39 @@ std::string RssParser::get_guid(const rsspp::Item& item) const
 }
 
 void RssParser::set_item_enclosure(std::shared_ptr<RssItem> x,
-	const rsspp::Item& item)
+	rsspp::Item& item)
 {
 	std::string enclosure_url;
 	std::string enclosure_type;
 	bool found_valid_enclosure = false;
 
-	for (const auto& enclosure : item.enclosures) {
+	for (auto& enclosure : item.enclosures) {
 		if (utils::is_valid_podcast_type(enclosure.type)) {
 			found_valid_enclosure = true;
-			enclosure_url = enclosure.url;
-			enclosure_type = enclosure.type;
+			enclosure_url = std::move(enclosure.url);
+			enclosure_type = std::move(enclosure.type);
 		} else if (!found_valid_enclosure) {
-			enclosure_url = enclosure.url;
-			enclosure_type = enclosure.type;
+			enclosure_url = std::move(enclosure.url);
+			enclosure_type = std::move(enclosure.type);
 		}
 	}
 
-	x->set_enclosure_url(enclosure_url);
-	x->set_enclosure_type(enclosure_type);
 	LOG(Level::DEBUG,
 		"RssParser::parse: found enclosure_url: %s",
 		enclosure_url);
 	LOG(Level::DEBUG,
 		"RssParser::parse: found enclosure_type: %s",
 		enclosure_type);
+	x->set_enclosure_url(std::move(enclosure_url));
+	x->set_enclosure_type(std::move(enclosure_type));
 }
 
 void RssParser::add_item_to_feed(std::shared_ptr<RssFeed> feed,
-	std::shared_ptr<RssItem> item)
+	std::shared_ptr<RssItem> item, bool check_ignores)
 {
 	// only add item to feed if it isn't on the ignore list or if there is
 	// no ignore list
-	if (!ign || !ign->matches(item.get())) {
+	if (!check_ignores || !ign || !ign->matches(item.get())) {
 		feed->add_item(item);
 		LOG(Level::INFO,
 			"RssParser::parse: added article title = `%s' link = "
@@ -624,7 +939,7 @@ void RssParser::add_item_to_feed(std::shared_ptr<RssFeed> feed,
 }
 
 void RssParser::handle_content_encoded(std::shared_ptr<RssItem> x,
-	const rsspp::Item& item) const
+	rsspp::Item& item) const
 {
 	if (!x->description().text.empty()) {
 		return;
@@ -633,7 +948,7 @@ void RssParser::handle_content_encoded(std::shared_ptr<RssItem> x,
 	/* here we handle content:encoded tags that are an extension but very
 	 * widespread */
 	if (!item.content_encoded.empty()) {
-		x->set_description(item.content_encoded, "text/html");
+		x->set_description(std::move(item.content_encoded), "text/html");
 	} else {
 		LOG(Level::DEBUG,
 			"RssParser::parse: found no content:encoded");
@@ -647,12 +962,11 @@ void RssParser::handle_itunes_summary(std::shared_ptr<RssItem> x,
 		return;
 	}
 
-	std::string summary = item.itunes_summary;
-	if (!summary.empty()) {
+	if (!item.itunes_summary.empty()) {
 		std::string desc = "<ituneshack>";
-		desc.append(summary);
+		desc.append(item.itunes_summary);
 		desc.append("</ituneshack>");
-		x->set_description(desc, "text/html");
+		x->set_description(std::move(desc), "text/html");
 	}
 }
 
@@ -705,10 +1019,31 @@ void RssParser::fetch_miniflux(const std::string& feed_id)
 {
 	MinifluxApi* mapi = dynamic_cast<MinifluxApi*>(api);
 	if (mapi) {
+		// Asked like plain feeds are, whether the articles changed since
+		// they were stored
+		utils::ConditionalRequest request;
+		const bool conditional = !ign || !ign->matches_lastmodified(feed_id);
+		if (conditional) {
+			ch->fetch_lastmodified(feed_id, request.last_modified,
+				request.etag);
+		}
+		const time_t sent_lastmodified = request.last_modified;
+		const std::string sent_etag = request.etag;
+
 		if (easyhandle) {
-			f = mapi->fetch_feed(feed_id, *easyhandle);
+			f = mapi->fetch_feed(feed_id, *easyhandle, &request);
 		} else {
-			f = mapi->fetch_feed(feed_id);
+			CurlHandle handle;
+			f = mapi->fetch_feed(feed_id, handle, &request);
+		}
+
+		unchanged = request.not_modified;
+		if (conditional && !unchanged
+			&& f.rss_version != rsspp::Feed::Version::UNKNOWN) {
+			ch->update_lastmodified(feed_id,
+				request.last_modified != sent_lastmodified
+				? request.last_modified : 0,
+				request.etag != sent_etag ? request.etag : "");
 		}
 	}
 	LOG(Level::INFO,
@@ -0,0 +1,148 @@
+#include "runtimestats.h"
+
+#include <cinttypes>
+#include <fstream>
+#include <unistd.h>
+
+#include "config.h"
+#include "scopestats.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+double ms(std::int64_t ns)
+{
+	return ns / 1e6;
+}
+
+double percent(std::int64_t part, std::int64_t whole)
+{
+	return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+/// Adds the values of \a object to \a result, a line each, indented by
+/// \a depth levels; nested objects are headings of their own.
+void report_object(const nlohmann::json& object, unsigned int depth,
+	std::string& result)
+{
+	const std::string indent(2 * depth, ' ');
+	for (auto it = object.begin(); it != object.end(); ++it) {
+		std::string label = it.key();
+		for (auto& c : label) {
+			if (c == '_') {
+				c = ' ';
+			}
+		}
+
+		const auto& value = it.value();
+		if (value.is_object()) {
+			result += indent + label + ":\n";
+			report_object(value, depth + 1, result);
+		} else if (value.is_number_float()) {
+			result += strprintf::fmt("%s%-30s %14.1f\n", indent, label,
+					value.get<double>());
+		} else if (value.is_number()) {
+			result += strprintf::fmt("%s%-30s %14" PRId64 "\n", indent, label,
+					value.get<std::int64_t>());
+		}
+	}
+}
+
+}
+
+std::array<std::atomic<std::int64_t>, RuntimeStats::COUNTERS>
+RuntimeStats::counters;
+
+void RuntimeStats::reset()
+{
+	for (auto& counter : counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+nlohmann::json RuntimeStats::snapshot()
+{
+	const auto reused = get(Counter::STATEMENTS_REUSED);
+	const auto prepared = get(Counter::STATEMENTS_PREPARED);
+
+	nlohmann::json scopes = nlohmann::json::array();
+	for (const auto& entry : ScopeStats::summaries()) {
+		scopes.push_back({
+			{"name", entry.first},
+			{"count", entry.second.count},
+			{"total_ms", ms(entry.second.total.count())},
+			{"p99_ms", ms(entry.second.p99.count())},
+		});
+	}
+
+	return nlohmann::json{
+		{
+			"caches", {
+				{
+					"statements", {
+						{"hits", reused},
+						{"misses", prepared},
+						{"hit_rate_percent", percent(reused, reused + prepared)},
+					}
+				},
+			}
+		},
+		{
+			"reload", {
+				{"feeds_in_flight", get(Counter::FEEDS_IN_FLIGHT)},
+				{"feeds_queued", get(Counter::FEEDS_QUEUED)},
+				{"bytes_downloaded", get(Counter::BYTES_DOWNLOADED)},
+			}
+		},
+		{
+			"time_ms", {
+				{"parse", ms(get(Counter::PARSE_NS))},
+				{"database", ms(get(Counter::DATABASE_NS))},
+				{"ui", ms(get(Counter::UI_NS))},
+			}
+		},
+		{"matcher", {{"evaluations", get(Counter::MATCHER_EVALUATIONS)}}},
+		{"scopes", scopes},
+	};
+}
+
+std::size_t RuntimeStats::resident_bytes()
+{
+	// The second field is the number of resident pages
+	std::ifstream statm("/proc/self/statm");
+	std::size_t pages = 0;
+	std::size_t resident = 0;
+	if (!(statm >> pages >> resident)) {
+		return 0;
+	}
+	const long page_size = ::sysconf(_SC_PAGESIZE);
+	return page_size > 0 ? resident * page_size : 0;
+}
+
+std::string RuntimeStats::report(const nlohmann::json& snapshot)
+{
+	std::string result;
+	report_object(snapshot, 0, result);
+
+	result += "\n";
+	const auto scopes = snapshot.find("scopes");
+	if (scopes == snapshot.end() || scopes->empty()) {
+		result += _("Scopes aren't timed; set `profile` to `yes` and restart.");
+		result += "\n";
+		return result;
+	}
+	result += strprintf::fmt("%12s %10s %12s  %s\n",
+			"total (ms)", "runs", "p99 (ms)", "scope");
+	for (const auto& scope : *scopes) {
+		result += strprintf::fmt("%12.1f %10" PRIu64 " %12.3f  %s\n",
+				scope["total_ms"].get<double>(),
+				scope["count"].get<std::uint64_t>(),
+				scope["p99_ms"].get<double>(),
+				scope["name"].get<std::string>());
+	}
+	return result;
+}
+
+} // namespace newsboat
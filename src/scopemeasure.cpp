@@ -1,15 +1,33 @@
 #include "scopemeasure.h"
 
+#include "scopestats.h"
+#include "tracelog.h"
+
 namespace newsboat {
 
 ScopeMeasure::ScopeMeasure(const std::string& func)
 	: rs_object(scopemeasure::bridged::create(func))
+	, func(func)
+	, start(std::chrono::steady_clock::now())
+{
+}
+
+ScopeMeasure::~ScopeMeasure()
 {
+	const auto end = std::chrono::steady_clock::now();
+	if (ScopeStats::enabled()) {
+		ScopeStats::named(func).add(end - start);
+	}
+	TraceLog::add(func, start, end);
 }
 
 void ScopeMeasure::stopover(const std::string& son)
 {
 	scopemeasure::bridged::stopover(*rs_object, son);
+	if (ScopeStats::enabled()) {
+		ScopeStats::named(func + " (stop over `" + son + "')").add(
+			std::chrono::steady_clock::now() - start);
+	}
 }
 
 } // namespace newsboat
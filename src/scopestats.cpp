@@ -0,0 +1,168 @@
+#include "scopestats.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "logger.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+// The registry is never destroyed, so that instances which are destroyed
+// at exit can still remove themselves from it
+
+std::mutex& registry_mutex()
+{
+	static std::mutex* mtx = new std::mutex;
+	return *mtx;
+}
+
+/// Every ScopeStats that exists, for summaries()
+std::vector<ScopeStats*>& registry()
+{
+	static std::vector<ScopeStats*>* instances = new std::vector<ScopeStats*>;
+	return *instances;
+}
+
+double seconds(std::chrono::nanoseconds duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+}
+
+std::atomic<bool> ScopeStats::enabled_(false);
+
+ScopeStats::ScopeStats(const char* name)
+	: name_(name)
+	, count(0)
+	, total_ns(0)
+{
+	for (auto& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+
+	std::lock_guard<std::mutex> guard(registry_mutex());
+	registry().push_back(this);
+}
+
+ScopeStats::~ScopeStats()
+{
+	std::lock_guard<std::mutex> guard(registry_mutex());
+	auto& instances = registry();
+	instances.erase(std::remove(instances.begin(), instances.end(), this),
+		instances.end());
+}
+
+ScopeStats& ScopeStats::named(const std::string& name)
+{
+	static std::mutex* mtx = new std::mutex;
+	static auto instances =
+		new std::map<std::string, std::unique_ptr<ScopeStats>>;
+
+	std::lock_guard<std::mutex> guard(*mtx);
+	auto it = instances->find(name);
+	if (it == instances->end()) {
+		it = instances->emplace(name, nullptr).first;
+		// The key stays put for as long as the map exists
+		it->second.reset(new ScopeStats(it->first.c_str()));
+	}
+	return *it->second;
+}
+
+void ScopeStats::set_enabled(bool enabled)
+{
+	enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void ScopeStats::add(std::chrono::nanoseconds duration)
+{
+	const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(0,
+				duration.count()));
+	std::size_t bucket = 0;
+	while (bucket + 1 < BUCKETS && (ns >> bucket) != 0) {
+		++bucket;
+	}
+
+	count.fetch_add(1, std::memory_order_relaxed);
+	total_ns.fetch_add(ns, std::memory_order_relaxed);
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+ScopeStats::Summary ScopeStats::summary() const
+{
+	Summary result;
+	result.count = count.load(std::memory_order_relaxed);
+	result.total = std::chrono::nanoseconds(total_ns.load(
+				std::memory_order_relaxed));
+	result.p99 = std::chrono::nanoseconds(0);
+
+	// The bucket that holds the run below which 99% of the runs fall
+	const std::uint64_t rank = result.count - result.count / 100;
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < BUCKETS && result.count > 0; ++i) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			result.p99 = std::chrono::nanoseconds(
+					i == 0 ? 0 : (std::uint64_t(1) << i) - 1);
+			break;
+		}
+	}
+
+	return result;
+}
+
+std::vector<std::pair<std::string, ScopeStats::Summary>>
+ScopeStats::summaries()
+{
+	std::vector<std::pair<std::string, Summary>> result;
+	{
+		std::lock_guard<std::mutex> guard(registry_mutex());
+		for (const auto stats : registry()) {
+			const auto summary = stats->summary();
+			if (summary.count > 0) {
+				result.emplace_back(stats->name_, summary);
+			}
+		}
+	}
+
+	std::stable_sort(result.begin(), result.end(),
+		[](const std::pair<std::string, Summary>& a,
+	const std::pair<std::string, Summary>& b) {
+		return a.second.total > b.second.total;
+	});
+	return result;
+}
+
+std::string ScopeStats::report()
+{
+	std::string result = strprintf::fmt("%12s %10s %12s %12s  %s\n",
+			"total (s)", "runs", "mean (s)", "p99 (s)", "scope");
+	for (const auto& entry : summaries()) {
+		const auto& summary = entry.second;
+		result += strprintf::fmt("%12.6f %10" PRIu64 " %12.6f %12.6f  %s\n",
+				seconds(summary.total),
+				summary.count,
+				seconds(summary.total) / summary.count,
+				seconds(summary.p99),
+				entry.first);
+	}
+	return result;
+}
+
+void ScopeStats::log_all()
+{
+	const auto entries = summaries();
+	if (entries.empty()) {
+		return;
+	}
+	LOG(Level::DEBUG, "ScopeStats::log_all: time spent per scope:\n%s",
+		report());
+}
+
+} // namespace newsboat
@@ -0,0 +1,277 @@
+#include "sharedfetchcache.h"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "file_system.h"
+#include "logger.h"
+#include "strprintf.h"
+
+namespace newsboat {
+
+namespace {
+
+/// FNV-1a, the hash that rsspp::Transfer::body_hash is.
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+std::uint64_t hash_of(const std::string& data)
+{
+	std::uint64_t hash = FNV_OFFSET_BASIS;
+	for (const char c : data) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+std::string hex(std::uint64_t value)
+{
+	return strprintf::fmt("%016" PRIx64, value);
+}
+
+/// \brief Whether files in the directory \a path can't be replaced by
+/// users other than their owner.
+///
+/// A directory that others may write to has to be sticky, like /tmp is;
+/// otherwise anyone could rename their own files over ours. The
+/// subdirectories are in the shared directory, so whoever made them could
+/// have made them symlinks instead; only the configured one may be.
+bool is_safe_directory(const std::string& path, bool is_subdir = true)
+{
+	struct stat sb;
+	const int result = is_subdir ? ::lstat(path.c_str(), &sb)
+		: ::stat(path.c_str(), &sb);
+	if (result != 0 || !S_ISDIR(sb.st_mode)) {
+		return false;
+	}
+	if ((sb.st_mode & (S_IWGRP | S_IWOTH)) != 0
+		&& (sb.st_mode & S_ISVTX) == 0) {
+		LOG(Level::ERROR,
+			"SharedFetchCache: not using %s: others may write to it, but it "
+			"isn't sticky (chmod +t)",
+			path);
+		return false;
+	}
+	return true;
+}
+
+/// Writes all of \a contents to \a fd.
+bool write_all(int fd, const std::string& contents)
+{
+	const char* data = contents.data();
+	std::size_t left = contents.size();
+	while (left > 0) {
+		const ssize_t written = ::write(fd, data, left);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		left -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+}
+
+SharedFetchCache::SharedFetchCache(const std::string& dir, time_t max_age)
+	: dir(dir)
+	, max_age(max_age)
+{
+}
+
+bool SharedFetchCache::shares(const std::string& url)
+{
+	const auto scheme_end = url.find("://");
+	if (scheme_end == std::string::npos) {
+		return false;
+	}
+	const auto authority_start = scheme_end + 3;
+	const auto authority_end = url.find_first_of("/?#", authority_start);
+	return url.substr(authority_start, authority_end - authority_start)
+		.find('@') == std::string::npos;
+}
+
+bool SharedFetchCache::lookup(const std::string& url,
+	Response& response) const
+{
+	if (!is_safe_directory(dir, false) || !is_safe_directory(dir + "/urls")) {
+		return false;
+	}
+	std::ifstream file(url_path(url));
+	std::string stored_url;
+	std::string body_hash;
+	if (!std::getline(file, stored_url) || stored_url != url) {
+		// Not there, or another URL with the same hash
+		return false;
+	}
+	file >> response.fetched >> response.lastmodified >> body_hash;
+	file.ignore();
+	std::getline(file, response.charset);
+	std::getline(file, response.etag);
+	if (!file) {
+		return false;
+	}
+	response.body_hash = std::strtoull(body_hash.c_str(), nullptr, 16);
+	// Asking whether a body that's gone is current gets nothing to parse
+	return ::access(body_path(response.body_hash).c_str(), R_OK) == 0;
+}
+
+bool SharedFetchCache::is_fresh(const Response& response) const
+{
+	return response.fetched != 0 && time(nullptr) - response.fetched < max_age;
+}
+
+bool SharedFetchCache::read_body(const Response& response,
+	std::string& body) const
+{
+	if (!is_safe_directory(dir, false)
+		|| !is_safe_directory(dir + "/bodies")) {
+		return false;
+	}
+	std::ifstream file(body_path(response.body_hash), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	body = contents.str();
+	// A body that's cut short, or a hash collision
+	return hash_of(body) == response.body_hash;
+}
+
+void SharedFetchCache::store(const std::string& url, Response response,
+	const std::string& body)
+{
+	response.fetched = time(nullptr);
+	response.body_hash = hash_of(body);
+	const std::string path = body_path(response.body_hash);
+	// Other URLs may have the same body already. When another user stored
+	// it, we may not touch it, but it's there all the same.
+	if (::utime(path.c_str(), nullptr) != 0 && errno == ENOENT
+		&& !replace_file(path, body)) {
+		return;
+	}
+	revalidate(url, response);
+}
+
+void SharedFetchCache::revalidate(const std::string& url, Response response)
+{
+	response.fetched = time(nullptr);
+	::utime(body_path(response.body_hash).c_str(), nullptr);
+	replace_file(url_path(url), strprintf::fmt("%s\n%" PRId64 " %" PRId64 " %s\n%s\n%s\n",
+			url,
+			static_cast<int64_t>(response.fetched),
+			static_cast<int64_t>(response.lastmodified),
+			hex(response.body_hash),
+			response.charset,
+			response.etag));
+	LOG(Level::DEBUG, "SharedFetchCache::revalidate: shared %s", url);
+}
+
+void SharedFetchCache::remove_unused(time_t age)
+{
+	const time_t oldest = time(nullptr) - age;
+	unsigned int removed = 0;
+	for (const std::string subdir : {
+			"/urls", "/bodies"
+		}) {
+		const std::string path_start = dir + subdir + "/";
+		for (const auto& name : file_system::list_directory(dir + subdir, false)) {
+			const std::string path = path_start + name;
+			struct stat sb;
+			if (::stat(path.c_str(), &sb) == 0 && sb.st_mtime < oldest
+				&& ::unlink(path.c_str()) == 0) {
+				++removed;
+			}
+		}
+	}
+	if (removed > 0) {
+		LOG(Level::INFO,
+			"SharedFetchCache::remove_unused: removed %u file(s)",
+			removed);
+	}
+}
+
+std::string SharedFetchCache::url_path(const std::string& url) const
+{
+	return dir + "/urls/" + hex(hash_of(url));
+}
+
+std::string SharedFetchCache::body_path(std::uint64_t body_hash) const
+{
+	return dir + "/bodies/" + hex(body_hash);
+}
+
+bool SharedFetchCache::replace_file(const std::string& path,
+	const std::string& contents) const
+{
+	const auto subdir = path.substr(0, path.rfind('/'));
+	// The directory itself is made by whoever sets up the sharing, with
+	// the permissions they choose
+	if (::mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+		LOG(Level::ERROR, "SharedFetchCache: couldn't create %s: %s", dir,
+			std::strerror(errno));
+		return false;
+	}
+	struct stat dir_sb;
+	if (!is_safe_directory(dir, false) || ::stat(dir.c_str(), &dir_sb) != 0) {
+		return false;
+	}
+	if (::mkdir(subdir.c_str(), 0777) == 0) {
+		// Under the umask, only we could write to it; it's shared just
+		// like the directory is
+		::chmod(subdir.c_str(), dir_sb.st_mode & 07777);
+	} else if (errno != EEXIST) {
+		LOG(Level::ERROR, "SharedFetchCache: couldn't create %s: %s", subdir,
+			std::strerror(errno));
+		return false;
+	}
+	if (!is_safe_directory(subdir)) {
+		return false;
+	}
+
+	// Several instances may write the same file at once; the last one wins.
+	// mkstemp() makes a file that nobody could have put there, not even a
+	// symlink.
+	std::string tmp = path + ".XXXXXX";
+	const int fd = ::mkstemp(&tmp[0]);
+	if (fd == -1) {
+		LOG(Level::ERROR, "SharedFetchCache: couldn't create a file in %s: %s",
+			subdir, std::strerror(errno));
+		return false;
+	}
+	const bool written = ::fchmod(fd, 0644) == 0 && write_all(fd, contents);
+	if (::close(fd) != 0 || !written) {
+		LOG(Level::ERROR, "SharedFetchCache: couldn't write %s", tmp);
+		::unlink(tmp.c_str());
+		return false;
+	}
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		// In a sticky directory, that's what becomes of another user's
+		// file, which they keep up to date themselves
+		if (errno == EPERM || errno == EACCES) {
+			LOG(Level::DEBUG, "SharedFetchCache: %s is another user's", path);
+		} else {
+			LOG(Level::ERROR, "SharedFetchCache: couldn't replace %s: %s", path,
+				std::strerror(errno));
+		}
+		::unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace newsboat
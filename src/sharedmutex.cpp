@@ -0,0 +1,29 @@
+#include "sharedmutex.h"
+
+#include <system_error>
+
+namespace newsboat {
+
+SharedMutex::SharedMutex()
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+	// glibc lets readers in ahead of waiting writers by default
+	pthread_rwlockattr_setkind_np(&attr,
+		PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	const int error = pthread_rwlock_init(&rwlock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+	if (error != 0) {
+		throw std::system_error(error, std::generic_category(),
+			"SharedMutex: couldn't create the lock");
+	}
+}
+
+SharedMutex::~SharedMutex()
+{
+	pthread_rwlock_destroy(&rwlock);
+}
+
+} // namespace newsboat
@@ -0,0 +1,123 @@
+#include "speedschedule.h"
+
+#include <cstdio>
+#include <ctime>
+
+#include "config.h"
+#include "confighandlerexception.h"
+#include "configparser.h"
+#include "strprintf.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace podboat {
+
+namespace {
+
+const unsigned int MINUTES_PER_DAY = 24 * 60;
+
+/// Parses "HH:MM" into minutes of the day; "24:00" is the end of the day.
+bool parse_time(const std::string& time, unsigned int& minute)
+{
+	unsigned int hours = 0;
+	unsigned int minutes = 0;
+	char rest = 0;
+	if (std::sscanf(time.c_str(), "%2u:%2u%c", &hours, &minutes, &rest) != 2
+		|| minutes > 59 || hours > 24 || (hours == 24 && minutes != 0)) {
+		return false;
+	}
+	minute = hours * 60 + minutes;
+	return true;
+}
+
+void throw_invalid_time(const std::string& time)
+{
+	throw ConfigHandlerException(strprintf::fmt(
+			_("`%s' is not a valid time of day (expected HH:MM)"),
+			time));
+}
+
+std::string format_time(unsigned int minute)
+{
+	return strprintf::fmt("%02u:%02u", minute / 60, minute % 60);
+}
+
+} // namespace
+
+void SpeedSchedule::handle_action(const std::string& action,
+	const std::vector<std::string>& params)
+{
+	if (action != "download-speed-schedule") {
+		throw ConfigHandlerException(ActionHandlerStatus::INVALID_COMMAND);
+	}
+	if (params.size() < 3) {
+		throw ConfigHandlerException(ActionHandlerStatus::TOO_FEW_PARAMS);
+	}
+	if (params.size() > 3) {
+		throw ConfigHandlerException(ActionHandlerStatus::TOO_MANY_PARAMS);
+	}
+
+	Period period;
+	if (!parse_time(params[0], period.start)) {
+		throw_invalid_time(params[0]);
+	}
+	if (!parse_time(params[1], period.end)) {
+		throw_invalid_time(params[1]);
+	}
+	period.start %= MINUTES_PER_DAY;
+	if (period.start == period.end) {
+		throw ConfigHandlerException(strprintf::fmt(
+				_("the period from %s to %s is empty"),
+				params[0],
+				params[1]));
+	}
+
+	const std::string& kbps = params[2];
+	if (kbps.empty() || kbps.find_first_not_of("0123456789") != std::string::npos) {
+		throw ConfigHandlerException(strprintf::fmt(
+				_("`%s' is not a valid speed (expected KB/s)"),
+				kbps));
+	}
+	period.kbps = utils::to_u(kbps);
+
+	periods.push_back(period);
+}
+
+void SpeedSchedule::dump_config(std::vector<std::string>& config_output) const
+{
+	for (const auto& period : periods) {
+		config_output.push_back(strprintf::fmt("download-speed-schedule %s %s %u",
+				format_time(period.start),
+				format_time(period.end),
+				period.kbps));
+	}
+}
+
+nonstd::optional<unsigned int> SpeedSchedule::limit_at(unsigned int minute)
+const
+{
+	minute %= MINUTES_PER_DAY;
+	for (auto period = periods.rbegin(); period != periods.rend(); ++period) {
+		const bool covered = period->start < period->end
+			? period->start <= minute && minute < period->end
+			: period->start <= minute || minute < period->end;
+		if (covered) {
+			return period->kbps;
+		}
+	}
+	return {};
+}
+
+nonstd::optional<unsigned int> SpeedSchedule::current_limit() const
+{
+	if (periods.empty()) {
+		return {};
+	}
+	const std::time_t now = std::time(nullptr);
+	std::tm local;
+	localtime_r(&now, &local);
+	return limit_at(local.tm_hour * 60 + local.tm_min);
+}
+
+} // namespace podboat
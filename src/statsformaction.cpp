@@ -0,0 +1,97 @@
+#include "statsformaction.h"
+
+#include <sstream>
+
+#include "config.h"
+#include "controller.h"
+#include "listformatter.h"
+#include "runtimestats.h"
+#include "strprintf.h"
+#include "utils.h"
+#include "view.h"
+
+namespace newsboat {
+
+StatsFormAction::StatsFormAction(View* vv,
+	std::string formstr,
+	ConfigContainer* cfg)
+	: FormAction(vv, formstr, cfg)
+	, textview("statstext", FormAction::f)
+{
+}
+
+bool StatsFormAction::process_operation(Operation op,
+	bool /* automatic */,
+	std::vector<std::string>* /* args */)
+{
+	switch (op) {
+	case OP_SK_UP:
+		textview.scroll_up();
+		break;
+	case OP_SK_DOWN:
+		textview.scroll_down();
+		break;
+	case OP_SK_HOME:
+		textview.scroll_to_top();
+		break;
+	case OP_SK_END:
+		textview.scroll_to_bottom();
+		break;
+	case OP_SK_PGUP:
+		textview.scroll_page_up();
+		break;
+	case OP_SK_PGDOWN:
+		textview.scroll_page_down();
+		break;
+	case OP_QUIT:
+		v->pop_current_formaction();
+		break;
+	case OP_HARDQUIT:
+		while (v->formaction_stack_size() > 0) {
+			v->pop_current_formaction();
+		}
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+void StatsFormAction::prepare()
+{
+	if (do_redraw) {
+		recalculate_widget_dimensions();
+		set_value("head", strprintf::fmt(_("%s %s - Statistics"), PROGRAM_NAME,
+				utils::program_version()));
+
+		ListFormatter listfmt;
+		std::istringstream lines(report);
+		std::string line;
+		while (std::getline(lines, line)) {
+			listfmt.add_line(utils::quote_for_stfl(line));
+		}
+		textview.stfl_replace_lines(listfmt.get_lines_count(),
+			listfmt.format_list());
+
+		do_redraw = false;
+	}
+}
+
+void StatsFormAction::init()
+{
+	report = RuntimeStats::report(v->get_ctrl()->runtime_stats());
+	set_keymap_hints();
+}
+
+const std::vector<KeyMapHintEntry>& StatsFormAction::get_keymap_hint() const
+{
+	static const std::vector<KeyMapHintEntry> hints = {{OP_QUIT, _("Quit")}};
+	return hints;
+}
+
+std::string StatsFormAction::title()
+{
+	return _("Statistics");
+}
+
+} // namespace newsboat
@@ -1,72 +1,161 @@
 #include "statusline.h"
 
 #include <algorithm>
+#include <vector>
 
 namespace newsboat {
 
 StatusLine::StatusLine(IStatus& s)
-	: next_message_id(0)
+	: pending(nullptr)
+	, next_message_id(0)
+	, ui_thread(std::this_thread::get_id())
 	, active_message(0)
+	, shown_is_error(false)
 	, iStatus(s)
 {
 }
 
-void StatusLine::show_message(const std::string& message)
+StatusLine::~StatusLine()
 {
-	std::lock_guard<std::mutex> guard(m);
+	Update* update = pending.exchange(nullptr);
+	while (update != nullptr) {
+		Update* const next = update->next;
+		delete update;
+		update = next;
+	}
+}
 
-	iStatus.set_status(message);
-	active_message = 0;
+void StatusLine::show_message(const std::string& message)
+{
+	push(Update::Kind::MESSAGE, 0, message);
 }
 
 void StatusLine::show_error(const std::string& message)
 {
-	std::lock_guard<std::mutex> guard(m);
-
-	iStatus.show_error(message);
-	active_message = 0;
+	push(Update::Kind::ERROR, 0, message);
 }
 
 std::shared_ptr<AutoDiscardMessage> StatusLine::show_message_until_finished(
 	const std::string& message)
 {
-	std::lock_guard<std::mutex> guard(m);
-
 	// Make sure we don't store an active message with ID 0.  This allows us to
 	// only restore a message in `mark_finished()` if the last status was set
 	// using `show_message_until_finished()`.
-	if (next_message_id == 0) {
-		next_message_id++;
-	}
-	active_messages.push_back(std::make_pair(next_message_id, message));
-	iStatus.set_status(message);
-	active_message = next_message_id;
 	// It is highly unlikely for `next_message_id` (an std::uint32_t) to wrap
 	// around as that would require over 4 billion updates to the status.
 	// If it does wrap around, the worst that can happen is that an existing
 	// status is removed from the `active_messages` list a bit too early.
-	next_message_id++;
-	return std::make_shared<AutoDiscardMessage>(*this, active_message);
+	std::uint32_t message_id = next_message_id++;
+	if (message_id == 0) {
+		message_id = next_message_id++;
+	}
+	push(Update::Kind::UNTIL_FINISHED, message_id, message);
+	return std::make_shared<AutoDiscardMessage>(*this, message_id);
 }
 
 void StatusLine::mark_finished(std::uint32_t message_id)
 {
+	push(Update::Kind::FINISHED, message_id);
+}
+
+void StatusLine::update_message(std::uint32_t message_id,
+	const std::string& message)
+{
+	push(Update::Kind::CHANGED, message_id, message);
+}
+
+void StatusLine::push(Update::Kind kind, std::uint32_t message_id,
+	const std::string& text)
+{
+	Update* const update = new Update{kind, message_id, text, nullptr};
+	update->next = pending.load(std::memory_order_relaxed);
+	while (!pending.compare_exchange_weak(update->next, update,
+			std::memory_order_release, std::memory_order_relaxed)) {
+	}
+
+	if (std::this_thread::get_id() == ui_thread) {
+		drain();
+	} else {
+		iStatus.messages_pending();
+	}
+}
+
+void StatusLine::drain()
+{
+	// Taken before the queue is, so that updates from two drains can't be
+	// applied out of order
 	std::lock_guard<std::mutex> guard(m);
+	Update* newest_first = pending.exchange(nullptr, std::memory_order_acquire);
+	if (newest_first == nullptr) {
+		return;
+	}
+	std::vector<Update*> updates;
+	for (Update* update = newest_first; update != nullptr;
+		update = update->next) {
+		updates.push_back(update);
+	}
 
-	active_messages.erase(
-		std::remove_if(active_messages.begin(),
-	active_messages.end(), [&](std::pair<std::uint32_t, std::string> x) {
-		return x.first == message_id;
-	}));
+	bool changed = false;
+	for (auto it = updates.rbegin(); it != updates.rend(); ++it) {
+		changed = apply(**it) || changed;
+		delete *it;
+	}
+	if (changed) {
+		if (shown_is_error) {
+			iStatus.show_error(shown);
+		} else {
+			iStatus.set_status(shown);
+		}
+	}
+}
 
-	if (active_message == message_id) {
+bool StatusLine::apply(const Update& update)
+{
+	switch (update.kind) {
+	case Update::Kind::MESSAGE:
+	case Update::Kind::ERROR:
+		shown = update.text;
+		shown_is_error = update.kind == Update::Kind::ERROR;
+		active_message = 0;
+		return true;
+	case Update::Kind::UNTIL_FINISHED:
+		active_messages.push_back(std::make_pair(update.message_id,
+				update.text));
+		shown = update.text;
+		shown_is_error = false;
+		active_message = update.message_id;
+		return true;
+	case Update::Kind::FINISHED:
+		active_messages.erase(
+			std::remove_if(active_messages.begin(), active_messages.end(),
+		[&](const std::pair<std::uint32_t, std::string>& x) {
+			return x.first == update.message_id;
+		}), active_messages.end());
+		if (active_message != update.message_id) {
+			return false;
+		}
 		if (active_messages.empty()) {
-			iStatus.set_status("");
+			shown.clear();
 		} else {
 			active_message = active_messages.back().first;
-			iStatus.set_status(active_messages.back().second);
+			shown = active_messages.back().second;
+		}
+		shown_is_error = false;
+		return true;
+	case Update::Kind::CHANGED:
+		for (auto& active : active_messages) {
+			if (active.first == update.message_id) {
+				active.second = update.text;
+			}
 		}
+		if (active_message != update.message_id) {
+			return false;
+		}
+		shown = update.text;
+		shown_is_error = false;
+		return true;
 	}
+	return false;
 }
 
 AutoDiscardMessage::AutoDiscardMessage(StatusLine& s, std::uint32_t m_id)
@@ -80,4 +169,9 @@ AutoDiscardMessage::~AutoDiscardMessage()
 	status_line.mark_finished(message_id);
 }
 
+void AutoDiscardMessage::update(const std::string& message)
+{
+	status_line.update_message(message_id, message);
+}
+
 } // namespace newsboat
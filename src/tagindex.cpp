@@ -0,0 +1,109 @@
+#include "tagindex.h"
+
+#include <algorithm>
+
+namespace newsboat {
+
+void TagIndex::add_feed(const RssFeed* feed,
+	const std::vector<std::string>& tags,
+	unsigned int unread)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = feeds.find(feed);
+	if (it != feeds.end()) {
+		count(it->second, false);
+	} else {
+		it = feeds.emplace(feed, FeedEntry()).first;
+	}
+
+	auto& entry = it->second;
+	entry.tag_ids.clear();
+	for (const auto& tag : tags) {
+		const auto id = intern(tag);
+		// A feed that lists a tag twice still counts once
+		if (std::find(entry.tag_ids.begin(), entry.tag_ids.end(), id) ==
+			entry.tag_ids.end()) {
+			entry.tag_ids.push_back(id);
+		}
+	}
+	entry.unread = unread;
+	count(entry, true);
+}
+
+void TagIndex::remove_feed(const RssFeed* feed)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto it = feeds.find(feed);
+	if (it != feeds.end()) {
+		count(it->second, false);
+		feeds.erase(it);
+	}
+}
+
+void TagIndex::set_unread(const RssFeed* feed, unsigned int unread)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto it = feeds.find(feed);
+	if (it != feeds.end()) {
+		count(it->second, false);
+		it->second.unread = unread;
+		count(it->second, true);
+	}
+}
+
+unsigned int TagIndex::feed_count(const std::string& tag) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto tag_counts = find(tag);
+	return tag_counts ? tag_counts->feeds : 0;
+}
+
+unsigned int TagIndex::unread_feed_count(const std::string& tag) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto tag_counts = find(tag);
+	return tag_counts ? tag_counts->unread_feeds : 0;
+}
+
+unsigned int TagIndex::unread_item_count(const std::string& tag) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto tag_counts = find(tag);
+	return tag_counts ? tag_counts->unread_items : 0;
+}
+
+unsigned int TagIndex::intern(const std::string& tag)
+{
+	const auto it = tag_ids.find(tag);
+	if (it != tag_ids.end()) {
+		return it->second;
+	}
+	const unsigned int id = counts.size();
+	tag_ids.emplace(tag, id);
+	counts.push_back(TagCounts{0, 0, 0});
+	return id;
+}
+
+const TagIndex::TagCounts* TagIndex::find(const std::string& tag) const
+{
+	const auto it = tag_ids.find(tag);
+	return it != tag_ids.end() ? &counts[it->second] : nullptr;
+}
+
+void TagIndex::count(const FeedEntry& entry, bool add)
+{
+	for (const auto id : entry.tag_ids) {
+		auto& tag_counts = counts[id];
+		if (add) {
+			tag_counts.feeds += 1;
+			tag_counts.unread_feeds += entry.unread > 0 ? 1 : 0;
+			tag_counts.unread_items += entry.unread;
+		} else {
+			tag_counts.feeds -= 1;
+			tag_counts.unread_feeds -= entry.unread > 0 ? 1 : 0;
+			tag_counts.unread_items -= entry.unread;
+		}
+	}
+}
+
+} // namespace newsboat
@@ -5,13 +5,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <cwchar>
-#include <iostream>
-#include <istream>
-#include <sstream>
+#include <iterator>
 #include <stdexcept>
+#include <strings.h>
 
+#include "bytescan.h"
 #include "config.h"
 #include "logger.h"
+#include "perfecthash.h"
 #include "utils.h"
 
 namespace newsboat {
@@ -20,16 +21,88 @@ namespace newsboat {
  * This method implements an "XML" pull parser. In reality, it's more liberal
  * than any XML pull parser, as it basically accepts everything that even only
  * remotely looks like XML. We use this parser for the HTML renderer.
+ *
+ * The input is gone through in place: tag names, attributes and text are
+ * only copied once they're handed out, and entities are decoded while
+ * doing so.
  */
 
+struct TagSoupPullParser::Piece {
+	const char* data;
+	std::size_t size;
+
+	char operator[](std::size_t i) const
+	{
+		return data[i];
+	}
+
+	Piece substr(std::size_t from, std::size_t count) const
+	{
+		return {data + from, count};
+	}
+
+	std::size_t find(char c, std::size_t from) const
+	{
+		if (from >= size) {
+			return std::string::npos;
+		}
+		const void* found = std::memchr(data + from, c, size - from);
+		if (found == nullptr) {
+			return std::string::npos;
+		}
+		return static_cast<const char*>(found) - data;
+	}
+
+	std::size_t find_first_of(const char* chars, std::size_t from) const
+	{
+		if (from >= size) {
+			return std::string::npos;
+		}
+		const std::size_t found = bytescan::find_first_of(data + from,
+				size - from, chars);
+		return found == std::string::npos ? found : from + found;
+	}
+
+	std::size_t find_first_not_of(const char* chars, std::size_t from) const
+	{
+		for (std::size_t i = from; i < size; ++i) {
+			if (std::strchr(chars, data[i]) == nullptr || data[i] == '\0') {
+				return i;
+			}
+		}
+		return std::string::npos;
+	}
+};
+
+TagSoupPullParser::TagSoupPullParser(const std::string& source)
+	: input(source.data())
+	, input_size(source.size())
+	, pos(0)
+	, at_eof(false)
+	, skip_inline_images(false)
+	, current_event(Event::START_DOCUMENT)
+{
+}
+
 TagSoupPullParser::TagSoupPullParser(std::istream& is)
-	: inputstream(is)
+	: owned_input(std::istreambuf_iterator<char>(is),
+		std::istreambuf_iterator<char>())
+	, input(owned_input.data())
+	, input_size(owned_input.size())
+	, pos(0)
+	, at_eof(false)
+	, skip_inline_images(false)
 	, current_event(Event::START_DOCUMENT)
 {
 }
 
 TagSoupPullParser::~TagSoupPullParser() {}
 
+void TagSoupPullParser::set_skip_inline_images(bool skip)
+{
+	skip_inline_images = skip;
+}
+
 nonstd::optional<std::string> TagSoupPullParser::get_attribute_value(
 	const std::string& name) const
 {
@@ -46,7 +119,7 @@ TagSoupPullParser::Event TagSoupPullParser::get_event_type() const
 	return current_event;
 }
 
-std::string TagSoupPullParser::get_text() const
+const std::string& TagSoupPullParser::get_text() const
 {
 	return text;
 }
@@ -59,27 +132,25 @@ TagSoupPullParser::Event TagSoupPullParser::next()
 	 * event.
 	 */
 	attributes.clear();
-	text = "";
+	text.clear();
 
-	if (inputstream.eof()) {
+	if (at_eof) {
 		current_event = Event::END_DOCUMENT;
 	}
 
 	switch (current_event) {
 	case Event::START_DOCUMENT:
 	case Event::START_TAG:
-	case Event::END_TAG: {
-		char c = 0;
-		inputstream.read(&c, 1);
-		if (inputstream.eof()) {
+	case Event::END_TAG:
+		if (pos >= input_size) {
+			at_eof = true;
 			current_event = Event::END_DOCUMENT;
-		} else if (c == '<') {
+		} else if (input[pos++] == '<') {
 			handle_tag();
 		} else {
-			handle_text(c);
+			handle_text();
 		}
 		break;
-	}
 	case Event::TEXT:
 		handle_tag();
 		break;
@@ -89,40 +160,53 @@ TagSoupPullParser::Event TagSoupPullParser::next()
 	return get_event_type();
 }
 
-void TagSoupPullParser::add_attribute(std::string s)
+TagSoupPullParser::Piece TagSoupPullParser::read_until(char delimiter,
+	bool& found)
 {
-	if (s.length() > 0 && s[s.length() - 1] == '/') {
-		s.erase(s.length() - 1, 1);
+	// Same as std::getline(): the delimiter is skipped, and running out of
+	// input sets at_eof
+	const Piece rest{input + pos, input_size - pos};
+	const std::size_t end = rest.find(delimiter, 0);
+	found = end != std::string::npos;
+	if (!found) {
+		pos = input_size;
+		at_eof = true;
+		return rest;
 	}
-	if (s.length() == 0) {
+	pos += end + 1;
+	return rest.substr(0, end);
+}
+
+void TagSoupPullParser::add_attribute(Piece s)
+{
+	if (s.size > 0 && s[s.size - 1] == '/') {
+		s.size--;
+	}
+	if (s.size == 0) {
 		return;
 	}
-	std::string::size_type equalpos = s.find_first_of("=", 0);
+	const std::size_t equalpos = s.find('=', 0);
 	std::string attribname, attribvalue;
 
-	if (equalpos != std::string::npos) {
-		attribname = s.substr(0, equalpos);
-		attribvalue =
-			s.substr(equalpos + 1, s.length() - (equalpos + 1));
-	} else {
-		attribname = attribvalue = s;
-	}
-	attribvalue = decode_attribute(attribvalue);
+	attribname.assign(s.data, equalpos != std::string::npos ? equalpos : s.size);
 	std::transform(attribname.begin(),
 		attribname.end(),
 		attribname.begin(),
 		::tolower);
-	attributes.push_back(Attribute(attribname, attribvalue));
-}
-
-nonstd::optional<std::string> TagSoupPullParser::read_tag()
-{
-	std::string s;
-	getline(inputstream, s, '>');
-	if (inputstream.eof()) {
-		return nonstd::nullopt;
+	if (equalpos != std::string::npos) {
+		const Piece value = s.substr(equalpos + 1, s.size - (equalpos + 1));
+		nonstd::optional<std::string> header;
+		if (skip_inline_images && attribname == "src"
+			&& strcasecmp(text.c_str(), "img") == 0) {
+			header = data_uri_header(value);
+		}
+		attribvalue = header.has_value() ? header.value() :
+			decode_attribute(value);
+	} else {
+		attribvalue = decode_attribute(s);
 	}
-	return s;
+	attributes.push_back(Attribute(std::move(attribname),
+			std::move(attribvalue)));
 }
 
 TagSoupPullParser::Event TagSoupPullParser::determine_tag_type()
@@ -134,24 +218,35 @@ TagSoupPullParser::Event TagSoupPullParser::determine_tag_type()
 	return Event::START_TAG;
 }
 
-std::string TagSoupPullParser::decode_attribute(const std::string& s)
+nonstd::optional<std::string> TagSoupPullParser::data_uri_header(Piece s)
 {
-	std::string s1 = s;
-	if ((s1[0] == '"' && s1[s1.length() - 1] == '"') ||
-		(s1[0] == '\'' && s1[s1.length() - 1] == '\'')) {
-		if (s1.length() > 0) {
-			s1.erase(0, 1);
-		}
-		if (s1.length() > 0) {
-			s1.erase(s1.length() - 1, 1);
-		}
+	const std::size_t start = s.size > 0 && (s[0] == '"' || s[0] == '\'') ? 1 : 0;
+	if (s.size - start < 5 || strncasecmp(s.data + start, "data:", 5) != 0) {
+		return nonstd::nullopt;
+	}
+	const std::size_t comma = s.find(',', start);
+	if (comma == std::string::npos) {
+		return nonstd::nullopt;
 	}
-	return decode_entities(s1);
+	return std::string(s.data + start, comma + 1 - start);
 }
 
-std::string TagSoupPullParser::decode_entities(const std::string& s)
+std::string TagSoupPullParser::decode_attribute(Piece s)
 {
+	if (s.size > 0 && ((s[0] == '"' && s[s.size - 1] == '"') ||
+			(s[0] == '\'' && s[s.size - 1] == '\''))) {
+		s = s.substr(1, s.size - 1);
+		if (s.size > 0) {
+			s.size--;
+		}
+	}
 	std::string result;
+	decode_entities(s, result);
+	return result;
+}
+
+void TagSoupPullParser::decode_entities(Piece s, std::string& result)
+{
 	std::string encoded_entity;
 	size_t offset = 0;
 	size_t ampersand_offset;
@@ -161,7 +256,7 @@ std::string TagSoupPullParser::decode_entities(const std::string& s)
 		if (semicolon_offset == std::string::npos) {
 			break;
 		}
-		result.append(s, offset, ampersand_offset - offset);
+		result.append(s.data + offset, ampersand_offset - offset);
 		encoded_entity = decode_entity(s.substr(ampersand_offset + 1,
 					semicolon_offset - ampersand_offset - 1));
 		if (!encoded_entity.empty()) {
@@ -172,13 +267,14 @@ std::string TagSoupPullParser::decode_entities(const std::string& s)
 			offset = ampersand_offset + 1;
 		}
 	}
-	if (s.size() > offset) {
-		result.append(s, offset, std::string::npos);
+	if (s.size > offset) {
+		result.append(s.data + offset, s.size - offset);
 	}
-	return result;
 }
 
-static struct {
+namespace {
+
+constexpr struct {
 	const char* entity;
 	unsigned int value;
 } entity_table[] = {
@@ -440,30 +536,38 @@ static struct {
 	{"clubs", 9827},
 	{"hearts", 9829},
 	{"diams", 9830},
-	{0, 0}
 };
 
-std::string TagSoupPullParser::decode_entity(std::string s)
-{
-	LOG(Level::DEBUG,
-		"TagSoupPullParser::decode_entity: decoding '%s'...",
-		s);
+struct EntityNames {
+	static constexpr std::size_t count = sizeof(entity_table) / sizeof(entity_table[0]);
+	static constexpr std::size_t slots = 2048;
+	static constexpr std::uint32_t seed = 2188489722u;
+	static constexpr bool fold_case = false;
+	static constexpr const char* at(std::size_t i)
+	{
+		return entity_table[i].entity;
+	}
+};
+static_assert(perfect_hash::is_perfect<EntityNames>(),
+	"two entity names share a slot, pick another EntityNames::seed");
+
+}
 
+std::string TagSoupPullParser::decode_entity(Piece s)
+{
 	mbstate_t mb_state;
 	::memset(&mb_state, 0, sizeof(mb_state));
 
-	if (s.length() > 1 && s[0] == '#') {
+	if (s.size > 1 && s[0] == '#') {
 		std::string result;
 		unsigned int wc;
 		char mbc[MB_LEN_MAX + 1];
 		mbc[0] = '\0';
 		if (s[1] == 'x') {
-			s.erase(0, 2);
-			std::istringstream is(s);
-			is >> std::hex >> wc;
+			const std::string digits(s.data + 2, s.size - 2);
+			wc = std::strtoul(digits.c_str(), nullptr, 16);
 		} else {
-			s.erase(0, 1);
-			wc = utils::to_u(s);
+			wc = utils::to_u(std::string(s.data + 1, s.size - 1));
 		}
 		// convert some windows entities according to the spec
 		// https://html.spec.whatwg.org/multipage/parsing.html#numeric-character-reference-end-state
@@ -565,31 +669,31 @@ std::string TagSoupPullParser::decode_entity(std::string s)
 			mbc);
 		return result;
 	} else {
-		for (unsigned int i = 0; entity_table[i].entity; ++i) {
-			if (s == entity_table[i].entity) {
-				char mbc[MB_LEN_MAX];
-				const int pos = wcrtomb(mbc, entity_table[i].value, &mb_state);
-				if (pos == -1) {
-					return std::string();
-				} else {
-					return std::string(mbc, pos);
-				}
+		static const perfect_hash::Table<EntityNames> entities;
+		const int i = entities.find(s.data, s.size);
+		if (i >= 0) {
+			char mbc[MB_LEN_MAX];
+			const int pos = wcrtomb(mbc, entity_table[i].value, &mb_state);
+			if (pos == -1) {
+				return std::string();
+			} else {
+				return std::string(mbc, pos);
 			}
 		}
 	}
 	return "";
 }
 
-void TagSoupPullParser::parse_tag(const std::string& tagstr)
+void TagSoupPullParser::parse_tag(Piece tagstr)
 {
-	std::string::size_type last_pos =
-		tagstr.find_first_not_of(" \r\n\t", 0);
-	std::string::size_type pos = tagstr.find_first_of(" \r\n\t", last_pos);
+	std::size_t last_pos = tagstr.find_first_not_of(" \r\n\t", 0);
+	std::size_t pos = tagstr.find_first_of(" \r\n\t", last_pos);
 	unsigned int count = 0;
 
 	LOG(Level::DEBUG,
-		"parse_tag: parsing '%s', pos = %" PRIu64 ", last_pos = %" PRIu64,
-		tagstr,
+		"parse_tag: parsing %" PRIu64 " byte(s), pos = %" PRIu64
+		", last_pos = %" PRIu64,
+		static_cast<uint64_t>(tagstr.size),
 		static_cast<uint64_t>(pos),
 		static_cast<uint64_t>(last_pos));
 
@@ -597,57 +701,32 @@ void TagSoupPullParser::parse_tag(const std::string& tagstr)
 		if (count == 0) {
 			// first token: tag name
 			if (pos == std::string::npos) {
-				pos = tagstr.length();
+				pos = tagstr.size;
 			}
-			text = tagstr.substr(last_pos, pos - last_pos);
+			text.assign(tagstr.data + last_pos, pos - last_pos);
 			if (text[text.length() - 1] == '/') {
 				// a kludge for <br/>
 				text.pop_back();
 			}
-			LOG(Level::DEBUG, "parse_tag: tag name = %s", text);
 		} else {
 			pos = tagstr.find_first_of("= ", last_pos);
-			std::string attr;
-			if (pos != std::string::npos) {
-				LOG(Level::DEBUG,
-					"parse_tag: found = or space");
-				if (tagstr[pos] == '=') {
-					LOG(Level::DEBUG, "parse_tag: found =");
-					if (tagstr[pos + 1] == '\'' ||
-						tagstr[pos + 1] == '"') {
-						pos = tagstr.find_first_of(
-								tagstr[pos + 1],
-								pos + 2);
-						if (pos != std::string::npos) {
-							pos++;
-						}
-						LOG(Level::DEBUG,
-							"parse_tag: finding "
-							"ending "
-							"quote, pos = %" PRIu64,
-							static_cast<uint64_t>(pos));
-					} else {
-						pos = tagstr.find_first_of(
-								" \r\n\t", pos + 1);
-						LOG(Level::DEBUG,
-							"parse_tag: finding "
-							"end of "
-							"unquoted attribute");
+			if (pos != std::string::npos && tagstr[pos] == '=') {
+				if (pos + 1 < tagstr.size &&
+					(tagstr[pos + 1] == '\'' || tagstr[pos + 1] == '"')) {
+					// find the ending quote
+					pos = tagstr.find(tagstr[pos + 1], pos + 2);
+					if (pos != std::string::npos) {
+						pos++;
 					}
+				} else {
+					// find the end of the unquoted attribute
+					pos = tagstr.find_first_of(" \r\n\t", pos + 1);
 				}
 			}
 			if (pos == std::string::npos) {
-				LOG(Level::DEBUG,
-					"parse_tag: found end of string, "
-					"correcting end position");
-				pos = tagstr.length();
+				pos = tagstr.size;
 			}
-			attr = tagstr.substr(last_pos, pos - last_pos);
-			LOG(Level::DEBUG,
-				"parse_tag: extracted attribute is '%s', "
-				"adding",
-				attr);
-			add_attribute(attr);
+			add_attribute(tagstr.substr(last_pos, pos - last_pos));
 		}
 		last_pos = tagstr.find_first_not_of(" \r\n\t", pos);
 		count++;
@@ -656,22 +735,23 @@ void TagSoupPullParser::parse_tag(const std::string& tagstr)
 
 void TagSoupPullParser::handle_tag()
 {
-	auto s = read_tag();
-	if (s.has_value()) {
-		parse_tag(s.value());
+	bool found = false;
+	const Piece tag = read_until('>', found);
+	if (found) {
+		parse_tag(tag);
 		current_event = determine_tag_type();
 	} else {
 		current_event = Event::END_DOCUMENT;
 	}
 }
 
-void TagSoupPullParser::handle_text(char c)
+void TagSoupPullParser::handle_text()
 {
-	text.push_back(c);
-	std::string tmp;
-	getline(inputstream, tmp, '<');
-	text.append(tmp);
-	text = decode_entities(text);
+	// The first character was read by next() already
+	const std::size_t start = pos - 1;
+	bool found = false;
+	const Piece rest = read_until('<', found);
+	decode_entities({input + start, rest.size + 1}, text);
 	utils::remove_soft_hyphens(text);
 	current_event = Event::TEXT;
 }
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <cinttypes>
 #include <limits.h>
+#include <utility>
 
 #include "htmlrenderer.h"
 #include "regexmanager.h"
@@ -15,22 +16,21 @@ namespace newsboat {
 
 void TextFormatter::add_line(LineType type, std::string line)
 {
-	LOG(Level::DEBUG,
-		"TextFormatter::add_line: `%s' (line type %u)",
-		line,
-		static_cast<unsigned int>(type));
-
-	auto clean_line = utils::wstr2str(
-			utils::clean_nonprintable_characters(utils::str2wstr(line)));
-	lines.push_back(std::make_pair(type, clean_line));
+	if (!utils::is_printable_ascii(line)) {
+		line = utils::clean_nonprintable_characters(line);
+	}
+	lines.emplace_back(type, std::move(line));
 }
 
 void TextFormatter::add_lines(
-	const std::vector<std::pair<LineType, std::string>>& lines)
+	std::vector<std::pair<LineType, std::string>> new_lines)
 {
-	for (const auto& line : lines) {
-		add_line(line.first,
-			utils::replace_all(line.second, "\t", "        "));
+	lines.reserve(lines.size() + new_lines.size());
+	for (auto& line : new_lines) {
+		if (line.second.find('\t') != std::string::npos) {
+			line.second = utils::replace_all(line.second, "\t", "        ");
+		}
+		add_line(line.first, std::move(line.second));
 	}
 }
 
@@ -41,14 +41,16 @@ bool iswhitespace(const std::string& input)
 	});
 };
 
-std::vector<std::string> wrap_line(const std::string& line, const size_t width,
-	bool raw)
+/// Passes the lines that \a line wraps into to \a store_line, one by one.
+template<typename Sink>
+void wrap_line(const std::string& line, const size_t width, bool raw,
+	Sink& store_line)
 {
 	if (line.empty()) {
-		return {""};
+		store_line("");
+		return;
 	}
 
-	std::vector<std::string> result;
 	std::vector<std::string> words = utils::tokenize_spaced(line);
 
 	std::string prefix;
@@ -88,7 +90,7 @@ std::vector<std::string> wrap_line(const std::string& line, const size_t width,
 				substr_with_width(word, space_left);
 			curline.append(part);
 			word.erase(0, part.length());
-			result.push_back(curline);
+			store_line(std::move(curline));
 			curline = prefix;
 			if (part.empty()) {
 				// discard the current word
@@ -100,7 +102,7 @@ std::vector<std::string> wrap_line(const std::string& line, const size_t width,
 		}
 
 		if ((curline_width + word_width) > width) {
-			result.push_back(curline);
+			store_line(std::move(curline));
 			if (iswhitespace(word)) {
 				curline = prefix;
 			} else {
@@ -112,13 +114,14 @@ std::vector<std::string> wrap_line(const std::string& line, const size_t width,
 	}
 
 	if (curline != prefix) {
-		result.push_back(curline);
+		store_line(std::move(curline));
 	}
-
-	return result;
 }
 
-std::vector<std::string> format_text_plain_helper(
+/// Passes the formatted lines to \a store_line as they're produced, so
+/// that they don't have to be collected first.
+template<typename Sink>
+void format_lines(
 	const std::vector<std::pair<LineType, std::string>>& lines,
 	RegexManager* rxman,
 	const std::string& location,
@@ -126,7 +129,8 @@ std::vector<std::string> format_text_plain_helper(
 	const size_t wrap_width,
 	// if non-zero, softwrappable lines are wrapped at this width
 	const size_t total_width,
-	bool raw = false)
+	bool raw,
+	Sink&& store_line)
 {
 	LOG(Level::DEBUG,
 		"TextFormatter::format_text_plain: rxman = %p, location = "
@@ -139,26 +143,10 @@ std::vector<std::string> format_text_plain_helper(
 		static_cast<uint64_t>(total_width),
 		static_cast<uint64_t>(lines.size()));
 
-	std::vector<std::string> format_cache;
-
-	auto store_line = [&format_cache](std::string line) {
-		format_cache.push_back(line);
-
-		LOG(Level::DEBUG,
-			"TextFormatter::format_text_plain: stored `%s'",
-			line);
-	};
-
 	for (const auto& line : lines) {
 		const auto type = line.first;
 		auto text = line.second;
 
-		LOG(Level::DEBUG,
-			"TextFormatter::format_text_plain: got line `%s' type "
-			"%u",
-			text,
-			static_cast<unsigned int>(type));
-
 		if (rxman && type != LineType::hr) {
 			rxman->quote_and_highlight(text, location);
 		}
@@ -170,9 +158,7 @@ std::vector<std::string> format_text_plain_helper(
 				continue;
 			}
 			text = utils::consolidate_whitespace(text);
-			for (const auto& line : wrap_line(text, wrap_width, raw)) {
-				store_line(line);
-			}
+			wrap_line(text, wrap_width, raw, store_line);
 			break;
 
 		case LineType::softwrappable:
@@ -181,17 +167,14 @@ std::vector<std::string> format_text_plain_helper(
 				continue;
 			}
 			if (total_width == 0) {
-				store_line(text);
+				store_line(std::move(text));
 			} else {
-				for (const auto& line :
-					wrap_line(text, total_width, raw)) {
-					store_line(line);
-				}
+				wrap_line(text, total_width, raw, store_line);
 			}
 			break;
 
 		case LineType::nonwrappable:
-			store_line(text);
+			store_line(std::move(text));
 			break;
 
 		case LineType::hr:
@@ -199,8 +182,6 @@ std::vector<std::string> format_text_plain_helper(
 			break;
 		}
 	}
-
-	return format_cache;
 }
 
 std::pair<std::string, std::size_t> TextFormatter::format_text_to_list(
@@ -209,21 +190,20 @@ std::pair<std::string, std::size_t> TextFormatter::format_text_to_list(
 	const size_t wrap_width,
 	const size_t total_width)
 {
-	auto formatted = format_text_plain_helper(
-			lines, rxman, location, wrap_width, total_width);
-
 	auto format_cache = std::string("{list");
-	for (auto& line : formatted) {
+	std::size_t line_count = 0;
+	format_lines(lines, rxman, location, wrap_width, total_width, false,
+	[&](std::string line) {
+		++line_count;
 		if (line != "") {
 			utils::trim_end(line);
-			format_cache.append(strprintf::fmt(
-					"{listitem text:%s}", Stfl::quote(line)));
+			format_cache.append("{listitem text:");
+			format_cache.append(Stfl::quote(line));
+			format_cache.push_back('}');
 		}
-	}
+	});
 	format_cache.push_back('}');
 
-	auto line_count = formatted.size();
-
 	return {format_cache, line_count};
 }
 
@@ -231,11 +211,11 @@ std::string TextFormatter::format_text_plain(const size_t width,
 	const size_t total_width)
 {
 	std::string result;
-	auto formatted = format_text_plain_helper(
-			lines, nullptr, "", width, total_width, true);
-	for (const auto& line : formatted) {
-		result += line + "\n";
-	}
+	format_lines(lines, nullptr, "", width, total_width, true,
+	[&result](const std::string& line) {
+		result.append(line);
+		result.push_back('\n');
+	});
 
 	return result;
 }
@@ -6,11 +6,20 @@
 
 namespace newsboat {
 
+namespace {
+
+/// How many lines above and below the screen STFL gets at least
+const std::uint32_t MIN_WINDOW_MARGIN = 64;
+
+}
+
 TextviewWidget::TextviewWidget(const std::string& textview_name,
 	Stfl::Form& form)
 	: textview_name(textview_name)
 	, form(form)
 	, num_lines(0)
+	, window_start(0)
+	, window_size(0)
 {
 }
 
@@ -18,27 +27,99 @@ void TextviewWidget::stfl_replace_textview(std::uint32_t number_of_lines,
 	std::string stfl)
 {
 	num_lines = number_of_lines;
+	text.clear();
+	items.clear();
+	window_start = 0;
+	window_size = 0;
 	form.modify(textview_name, "replace", stfl);
 }
 
 void TextviewWidget::stfl_replace_lines(std::uint32_t number_of_lines,
 	std::string stfl)
 {
+	std::uint32_t offset = get_scroll_offset();
+	if (number_of_lines == 0) {
+		offset = 0;
+	} else if (offset > number_of_lines - 1) {
+		offset = number_of_lines - 1;
+	}
+
 	num_lines = number_of_lines;
-	form.modify(textview_name, "replace_inner", stfl);
+	text = std::move(stfl);
+	index_items();
+	replace_window(offset);
+	form.set(textview_name + "_offset", std::to_string(offset - window_start));
+}
 
-	if (num_lines == 0) {
-		set_scroll_offset(0);
-	} else {
-		const std::uint32_t max_offset = num_lines - 1;
-		const std::uint32_t current_offset = get_scroll_offset();
+void TextviewWidget::index_items()
+{
+	items.clear();
+	const std::string prefix = "{list";
+	if (text.compare(0, prefix.size(), prefix) != 0) {
+		return;
+	}
 
-		if (current_offset > max_offset) {
-			set_scroll_offset(max_offset);
+	// Stfl::quote() puts everything that could be taken for a brace in
+	// quotes, so the first closing brace outside of them ends the item
+	std::size_t pos = prefix.size();
+	while (pos < text.size() && text[pos] == '{') {
+		const std::size_t start = pos;
+		while (++pos < text.size() && text[pos] != '}') {
+			if (text[pos] == '"' || text[pos] == '\'') {
+				pos = text.find(text[pos], pos + 1);
+				if (pos == std::string::npos) {
+					items.clear();
+					return;
+				}
+			}
 		}
+		if (pos == text.size()) {
+			items.clear();
+			return;
+		}
+		++pos;
+		items.emplace_back(start, pos);
+	}
+	if (text.compare(pos, std::string::npos, "}") != 0) {
+		items.clear();
 	}
 }
 
+bool TextviewWidget::window_covers(std::uint32_t offset)
+{
+	const std::uint32_t lines = items.size();
+	const std::uint32_t viewport_end = std::min(offset + get_height(), lines);
+	return offset >= window_start
+		&& viewport_end <= window_start + window_size;
+}
+
+void TextviewWidget::replace_window(std::uint32_t offset)
+{
+	const std::uint32_t lines = items.size();
+	const std::uint32_t height = get_height();
+	const std::uint32_t margin = std::max(MIN_WINDOW_MARGIN, height);
+
+	if (lines <= 2 * margin + height) {
+		window_start = 0;
+		window_size = lines;
+		form.modify(textview_name, "replace_inner", text);
+		return;
+	}
+
+	window_start = offset > margin ? offset - margin : 0;
+	window_start = std::min(window_start, lines - (2 * margin + height));
+	window_size = 2 * margin + height;
+
+	const std::size_t first = items[window_start].first;
+	const std::size_t last = items[window_start + window_size - 1].second;
+	std::string window;
+	window.reserve(last - first + 6);
+	window.append("{list");
+	window.append(text, first, last - first);
+	window.append("}");
+	form.modify(textview_name, "replace_inner", window);
+}
+
 void TextviewWidget::scroll_up()
 {
 	const std::uint32_t offset = get_scroll_offset();
@@ -107,14 +188,19 @@ std::uint32_t TextviewWidget::get_scroll_offset()
 {
 	const std::string offset = form.get(textview_name + "_offset");
 	if (!offset.empty()) {
-		return std::max(0, std::stoi(offset));
+		return window_start + std::max(0, std::stoi(offset));
 	}
-	return 0;
+	return window_start;
 }
 
 void TextviewWidget::set_scroll_offset(std::uint32_t offset)
 {
-	form.set(textview_name + "_offset", std::to_string(offset));
+	if (!window_covers(offset)) {
+		replace_window(offset);
+	}
+	const std::uint32_t stfl_offset = offset > window_start
+		? offset - window_start : 0;
+	form.set(textview_name + "_offset", std::to_string(stfl_offset));
 }
 
 std::uint32_t TextviewWidget::get_width()
@@ -127,4 +213,14 @@ std::uint32_t TextviewWidget::get_height()
 	return utils::to_u(form.get(textview_name + ":h"));
 }
 
+std::uint32_t TextviewWidget::get_window_start()
+{
+	return window_start;
+}
+
+std::uint32_t TextviewWidget::get_window_size()
+{
+	return window_size;
+}
+
 } // namespace newsboat
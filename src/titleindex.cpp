@@ -0,0 +1,179 @@
+#include "titleindex.h"
+
+#include <algorithm>
+
+#include "rssitem.h"
+
+namespace newsboat {
+
+namespace {
+
+char fold(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+std::string folded(const std::string& text)
+{
+	std::string result(text);
+	std::transform(result.begin(), result.end(), result.begin(), fold);
+	return result;
+}
+
+std::uint32_t trigram_at(const std::string& folded_text, std::size_t pos)
+{
+	return static_cast<unsigned char>(folded_text[pos]) << 16
+		| static_cast<unsigned char>(folded_text[pos + 1]) << 8
+		| static_cast<unsigned char>(folded_text[pos + 2]);
+}
+
+bool contains(const std::string& text, const std::string& folded_query)
+{
+	return folded(text).find(folded_query) != std::string::npos;
+}
+
+}
+
+void TitleIndex::add_trigrams(const std::string& text,
+	std::vector<std::uint32_t>& trigrams)
+{
+	const auto folded_text = folded(text);
+	for (std::size_t pos = 0; pos + 3 <= folded_text.size(); ++pos) {
+		trigrams.push_back(trigram_at(folded_text, pos));
+	}
+}
+
+void TitleIndex::add_item(const std::shared_ptr<RssItem>& item)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto it = slots.find(item.get());
+	if (it != slots.end()) {
+		++entries[it->second].refs;
+		return;
+	}
+
+	Entry entry;
+	entry.item = item;
+	entry.key = item.get();
+	entry.refs = 1;
+	add_trigrams(item->title(), entry.trigrams);
+	add_trigrams(item->author(), entry.trigrams);
+	std::sort(entry.trigrams.begin(), entry.trigrams.end());
+	entry.trigrams.erase(std::unique(entry.trigrams.begin(),
+			entry.trigrams.end()), entry.trigrams.end());
+
+	const auto slot = static_cast<std::uint32_t>(entries.size());
+	for (const auto trigram : entry.trigrams) {
+		postings[trigram].push_back(slot);
+	}
+	total_postings += entry.trigrams.size();
+	slots.emplace(item.get(), slot);
+	entries.push_back(std::move(entry));
+}
+
+void TitleIndex::remove_item(const RssItem* item)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto it = slots.find(item);
+	if (it == slots.end()) {
+		return;
+	}
+	auto& entry = entries[it->second];
+	if (--entry.refs > 0) {
+		return;
+	}
+	entry.item.reset();
+	stale_postings += entry.trigrams.size();
+	slots.erase(it);
+	compact_if_needed();
+}
+
+void TitleIndex::compact_if_needed()
+{
+	if (stale_postings * 2 <= total_postings && entries.size() <= 2 * slots.size()) {
+		return;
+	}
+
+	std::vector<Entry> live;
+	live.reserve(slots.size());
+	postings.clear();
+	slots.clear();
+	for (auto& entry : entries) {
+		if (entry.refs == 0) {
+			continue;
+		}
+		const auto slot = static_cast<std::uint32_t>(live.size());
+		for (const auto trigram : entry.trigrams) {
+			postings[trigram].push_back(slot);
+		}
+		slots.emplace(entry.key, slot);
+		live.push_back(std::move(entry));
+	}
+	entries = std::move(live);
+	total_postings -= stale_postings;
+	stale_postings = 0;
+}
+
+std::vector<std::shared_ptr<RssItem>> TitleIndex::search(
+	const std::string& query) const
+{
+	const auto folded_query = folded(query);
+	std::vector<std::uint32_t> trigrams;
+	add_trigrams(folded_query, trigrams);
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+		trigrams.end());
+
+	std::lock_guard<std::mutex> lock(mtx);
+	std::vector<std::uint32_t> candidates;
+	if (trigrams.empty()) {
+		for (std::uint32_t slot = 0; slot < entries.size(); ++slot) {
+			candidates.push_back(slot);
+		}
+	} else {
+		std::vector<const std::vector<std::uint32_t>*> lists;
+		for (const auto trigram : trigrams) {
+			const auto it = postings.find(trigram);
+			if (it == postings.end()) {
+				return {};
+			}
+			lists.push_back(&it->second);
+		}
+		std::sort(lists.begin(), lists.end(),
+			[](const std::vector<std::uint32_t>* a,
+		const std::vector<std::uint32_t>* b) {
+			return a->size() < b->size();
+		});
+		for (const auto slot : *lists[0]) {
+			const bool in_all = std::all_of(lists.begin() + 1, lists.end(),
+			[slot](const std::vector<std::uint32_t>* list) {
+				return std::binary_search(list->begin(), list->end(), slot);
+			});
+			if (in_all) {
+				candidates.push_back(slot);
+			}
+		}
+	}
+
+	// Having all of the trigrams doesn't mean having them in a row
+	std::vector<std::shared_ptr<RssItem>> result;
+	for (const auto slot : candidates) {
+		const auto item = entries[slot].item.lock();
+		if (item == nullptr || item->deleted()) {
+			continue;
+		}
+		if (contains(item->title(), folded_query) ||
+			contains(item->author(), folded_query)) {
+			result.push_back(item);
+		}
+	}
+	return result;
+}
+
+std::size_t TitleIndex::size() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return slots.size();
+}
+
+} // namespace newsboat
@@ -0,0 +1,130 @@
+#include "tracelog.h"
+
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+#include "3rd-party/json.hpp"
+#include "logger.h"
+
+namespace newsboat {
+
+namespace {
+
+struct Span {
+	std::string name;
+	std::string detail;
+	TraceLog::Clock::time_point begin;
+	TraceLog::Clock::duration duration;
+	unsigned int thread;
+};
+
+struct Recording {
+	std::mutex mtx;
+	std::string path;
+	TraceLog::Clock::time_point start;
+	std::vector<Span> spans;
+	std::size_t dropped = 0;
+};
+
+// Never destroyed, so that threads still running at exit can record
+Recording& recording()
+{
+	static Recording* instance = new Recording;
+	return *instance;
+}
+
+/// A small number for the calling thread, which viewers show as its name.
+unsigned int thread_number()
+{
+	static std::atomic<unsigned int> threads(0);
+	thread_local const unsigned int number = ++threads;
+	return number;
+}
+
+double microseconds(TraceLog::Clock::duration duration)
+{
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}
+
+const std::size_t TraceLog::MAX_SPANS;
+std::atomic<bool> TraceLog::enabled_(false);
+
+void TraceLog::start(const std::string& path)
+{
+	auto& rec = recording();
+	std::lock_guard<std::mutex> guard(rec.mtx);
+	rec.path = path;
+	rec.start = Clock::now();
+	rec.spans.clear();
+	rec.dropped = 0;
+	enabled_.store(true);
+	LOG(Level::INFO, "TraceLog::start: tracing to %s", path);
+}
+
+void TraceLog::add(const std::string& name, Clock::time_point begin,
+	Clock::time_point end, const std::string& detail)
+{
+	if (!enabled()) {
+		return;
+	}
+	const unsigned int thread = thread_number();
+	auto& rec = recording();
+	std::lock_guard<std::mutex> guard(rec.mtx);
+	if (rec.spans.size() >= MAX_SPANS) {
+		++rec.dropped;
+		return;
+	}
+	rec.spans.push_back(Span{name, detail, begin, end - begin, thread});
+}
+
+bool TraceLog::finish()
+{
+	if (!enabled_.exchange(false)) {
+		return true;
+	}
+	auto& rec = recording();
+	std::lock_guard<std::mutex> guard(rec.mtx);
+	if (rec.dropped > 0) {
+		LOG(Level::WARN,
+			"TraceLog::finish: dropped %u span(s) past the first %u",
+			static_cast<unsigned int>(rec.dropped),
+			static_cast<unsigned int>(MAX_SPANS));
+	}
+
+	const int pid = ::getpid();
+	nlohmann::json events = nlohmann::json::array();
+	for (const auto& span : rec.spans) {
+		nlohmann::json event = {
+			{"name", span.name},
+			{"ph", "X"},
+			{"ts", microseconds(span.begin - rec.start)},
+			{"dur", microseconds(span.duration)},
+			{"pid", pid},
+			{"tid", span.thread},
+		};
+		if (!span.detail.empty()) {
+			event["args"] = {{"detail", span.detail}};
+		}
+		events.push_back(std::move(event));
+	}
+	rec.spans.clear();
+
+	std::ofstream file(rec.path, std::ios::binary | std::ios::trunc);
+	file << nlohmann::json{
+		{"traceEvents", std::move(events)},
+		{"displayTimeUnit", "ms"},
+	}.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+	file.close();
+	if (!file) {
+		LOG(Level::ERROR, "TraceLog::finish: couldn't write %s", rec.path);
+		return false;
+	}
+	LOG(Level::INFO, "TraceLog::finish: wrote %s", rec.path);
+	return true;
+}
+
+} // namespace newsboat
@@ -1,13 +1,17 @@
 #include "ttrssapi.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <cstdlib>
 #include <cstring>
 #include <thread>
 #include <time.h>
 
 #include "3rd-party/json.hpp"
 #include "curlhandle.h"
+#include "executor.h"
+#include "jsonstream.h"
 #include "logger.h"
 #include "remoteapi.h"
 #include "rss/feed.h"
@@ -16,6 +20,17 @@
 
 using json = nlohmann::json;
 
+// How many articles a single updateArticle request marks read
+#define TTRSS_MARK_READ_BATCH_SIZE 200
+// How many headlines a page of an incremental fetch holds (the most that
+// TT-RSS hands out at once), and how many pages a feed gets at most
+#define TTRSS_HEADLINES_PAGE_SIZE 200
+#define TTRSS_HEADLINES_MAX_PAGES 10
+// How many pages of unread headlines fetch_unread_guids() reads at most
+#define TTRSS_UNREAD_MAX_PAGES 100
+// How many categories' feeds are asked for at once
+#define TTRSS_CATEGORY_REQUESTS 4
+
 namespace newsboat {
 
 TtRssApi::TtRssApi(ConfigContainer* c)
@@ -127,7 +142,8 @@ json TtRssApi::run_op(const std::string& op,
 	const std::map<std::string, std::string>& args,
 	bool try_login /* = true */)
 {
-	CurlHandle handle;
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
 	return TtRssApi::run_op(op, args, handle, try_login);
 }
 
@@ -136,38 +152,7 @@ json TtRssApi::run_op(const std::string& op,
 	CurlHandle& cached_handle,
 	bool try_login /* = true */)
 {
-	std::string url =
-		strprintf::fmt("%s/api/", cfg->get_configvalue("ttrss-url"));
-
-	// First build the request payload
-	std::string req_data;
-	{
-		json requestparam;
-
-		requestparam["op"] = op;
-		if (!sid.empty()) {
-			requestparam["sid"] = sid;
-		}
-
-		// Note: We are violating the upstream-api's types here by
-		// packing all information
-		//       into strings. If things start to break, this would be a
-		//       good place to start.
-		for (const auto& arg : args) {
-			requestparam[arg.first] = arg.second;
-		}
-
-		req_data = requestparam.dump();
-	}
-
-	std::string result = utils::retrieve_url(
-			url, cached_handle, cfg, auth_info, &req_data, utils::HTTPMethod::POST);
-
-	LOG(Level::DEBUG,
-		"TtRssApi::run_op(%s,...): post=%s reply = %s",
-		op,
-		req_data,
-		result);
+	const std::string result = send_op(op, args, cached_handle);
 
 	json reply;
 	try {
@@ -218,6 +203,96 @@ json TtRssApi::run_op(const std::string& op,
 	return content;
 }
 
+bool TtRssApi::run_list_op(const std::string& op,
+	const std::map<std::string, std::string>& args,
+	CurlHandle& cached_handle,
+	const std::function<void(json& element)>& on_element,
+	bool try_login /* = true */)
+{
+	const std::string result = send_op(op, args, cached_handle);
+
+	// On success, the content is the list, and doesn't stay in the reply
+	json reply;
+	if (!stream_json_array(result, "content", on_element, reply)) {
+		LOG(Level::ERROR,
+			"TtRssApi::run_list_op: reply failed to parse: %s",
+			result);
+		return false;
+	}
+
+	int status;
+	try {
+		status = reply.at("status");
+	} catch (json::exception& e) {
+		LOG(Level::ERROR,
+			"TtRssApi::run_list_op: no status code: %s",
+			e.what());
+		return false;
+	}
+
+	if (status == 0) {
+		if (reply.contains("content")) {
+			LOG(Level::ERROR,
+				"TtRssApi::run_list_op: content is not an array");
+			return false;
+		}
+		return true;
+	}
+
+	json error;
+	if (reply.contains("content") && reply["content"].is_object()) {
+		error = reply["content"]["error"];
+	}
+	if (error == "NOT_LOGGED_IN" && try_login) {
+		return authenticate()
+			&& run_list_op(op, args, cached_handle, on_element, false);
+	}
+	LOG(Level::ERROR,
+		"TtRssApi::run_list_op: status: %d, error: '%s'",
+		status,
+		error.dump());
+	return false;
+}
+
+std::string TtRssApi::send_op(const std::string& op,
+	const std::map<std::string, std::string>& args,
+	CurlHandle& cached_handle)
+{
+	std::string url =
+		strprintf::fmt("%s/api/", cfg->get_configvalue("ttrss-url"));
+
+	// First build the request payload
+	std::string req_data;
+	{
+		json requestparam;
+
+		requestparam["op"] = op;
+		if (!sid.empty()) {
+			requestparam["sid"] = sid;
+		}
+
+		// Note: We are violating the upstream-api's types here by
+		// packing all information
+		//       into strings. If things start to break, this would be a
+		//       good place to start.
+		for (const auto& arg : args) {
+			requestparam[arg.first] = arg.second;
+		}
+
+		req_data = requestparam.dump();
+	}
+
+	std::string result = utils::retrieve_url(
+			url, cached_handle, cfg, auth_info, &req_data, utils::HTTPMethod::POST);
+
+	LOG(Level::DEBUG,
+		"TtRssApi::send_op(%s,...): post=%s reply = %s",
+		op,
+		req_data,
+		result);
+	return result;
+}
+
 TaggedFeedUrl TtRssApi::feed_from_json(const json& jfeed,
 	const std::vector<std::string>& addtags)
 {
@@ -255,12 +330,23 @@ std::vector<TaggedFeedUrl> TtRssApi::get_subscribed_urls()
 {
 	std::vector<TaggedFeedUrl> feeds;
 
-	json categories =
-		run_op("getCategories", std::map<std::string, std::string>());
+	// The categories come in while the API level is looked up, and the
+	// feeds are asked for
+	json categories;
+	std::thread categories_request([&]() {
+		categories = run_op("getCategories",
+				std::map<std::string, std::string>());
+	});
 
 	if (query_api_level() >= 2) {
 		// getFeeds with cat_id -3 since 1.5.0, so at least since
 		// api-level 2
+		std::map<std::string, std::string> args;
+		// All feeds, excluding virtual feeds (e.g. Labels and such)
+		args["cat_id"] = "-3";
+		json feedlist = run_op("getFeeds", args);
+		categories_request.join();
+
 		std::map<int, std::string> category_names;
 		for (const auto& cat : categories) {
 			std::string cat_name = cat["title"];
@@ -268,11 +354,6 @@ std::vector<TaggedFeedUrl> TtRssApi::get_subscribed_urls()
 			category_names[cat_id] = cat_name;
 		}
 
-		std::map<std::string, std::string> args;
-		// All feeds, excluding virtual feeds (e.g. Labels and such)
-		args["cat_id"] = "-3";
-		json feedlist = run_op("getFeeds", args);
-
 		if (feedlist.is_null()) {
 			LOG(Level::ERROR,
 				"TtRssApi::get_subscribed_urls: Failed to "
@@ -290,21 +371,40 @@ std::vector<TaggedFeedUrl> TtRssApi::get_subscribed_urls()
 		}
 
 	} else {
-		try {
-			// first fetch feeds within no category
-			fetch_feeds_per_category(json(nullptr), feeds);
-
-			// then fetch the feeds of all categories
-			for (const auto& i : categories) {
-				fetch_feeds_per_category(i, feeds);
+		categories_request.join();
+
+		// The feeds of each category are asked for in parallel, a few
+		// categories at a time, and listed in the order of the categories
+		std::vector<json> category_list(categories.begin(), categories.end());
+		std::vector<std::vector<TaggedFeedUrl>> category_feeds(
+			category_list.size());
+		std::atomic<std::size_t> next(0);
+		std::atomic<bool> failed(false);
+		const auto fetch_categories = [&]() {
+			for (std::size_t i = next++; i < category_list.size(); i = next++) {
+				try {
+					fetch_feeds_per_category(category_list[i], category_feeds[i]);
+				} catch (json::exception& e) {
+					LOG(Level::ERROR,
+						"TtRssApi::get_subscribed_urls:"
+						" Failed to determine subscribed urls: %s",
+						e.what());
+					failed = true;
+				}
 			}
-		} catch (json::exception& e) {
-			LOG(Level::ERROR,
-				"TtRssApi::get_subscribed_urls:"
-				" Failed to determine subscribed urls: %s",
-				e.what());
+		};
+
+		const std::size_t threads = std::min<std::size_t>(
+				TTRSS_CATEGORY_REQUESTS, category_list.size());
+		Executor::instance().run_workers(Executor::Pool::IO,
+			Executor::Priority::NORMAL, threads, fetch_categories);
+
+		if (failed) {
 			return std::vector<TaggedFeedUrl>();
 		}
+		for (auto& category : category_feeds) {
+			feeds.insert(feeds.end(), category.begin(), category.end());
+		}
 	}
 
 	return feeds;
@@ -328,16 +428,29 @@ bool TtRssApi::mark_article_read(const std::string& guid, bool read)
 {
 	// Do this in a thread, as we don't care about the result enough to wait
 	// for it.
-	std::thread t{[=]()
-	{
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
 		LOG(Level::DEBUG,
 			"TtRssApi::mark_article_read: inside thread, marking "
 			"thread as read...");
 
 		// Call the TtRssApi's update_article function as a thread.
 		this->update_article(guid, 2, read ? 0 : 1);
-	}};
-	t.detach();
+	});
+	return true;
+}
+
+bool TtRssApi::mark_articles_read(const std::vector<std::string>& guids)
+{
+	// Like mark_article_read(), do this in a thread
+	Executor::instance().submit(Executor::Pool::IO, Executor::Priority::LOW,
+	[=]() {
+		// updateArticle takes a comma-separated list of IDs
+		mark_in_batches(guids, TTRSS_MARK_READ_BATCH_SIZE,
+		[this](const std::vector<std::string>& batch) {
+			return this->update_article(utils::join(batch, ","), 2, 0);
+		});
+	});
 	return true;
 }
 
@@ -364,96 +477,150 @@ bool TtRssApi::update_article_flags(const std::string& oldflags,
 	return success;
 }
 
-rsspp::Feed TtRssApi::fetch_feed(const std::string& id)
-{
-	CurlHandle handle;
-	return fetch_feed(id, handle);
-}
-
-rsspp::Feed TtRssApi::fetch_feed(const std::string& id, CurlHandle& cached_handle)
+/// Builds an article from \a headline, moving its strings out of it, and
+/// raises \a newest_id to its id if that's higher.
+static rsspp::Item parse_headline(json& headline, int& newest_id)
 {
-	rsspp::Feed f;
+	rsspp::Item item;
 
-	f.rss_version = rsspp::Feed::TTRSS_JSON;
+	if (!headline["title"].is_null()) {
+		item.title = std::move(headline["title"].get_ref<std::string&>());
+	}
 
-	std::map<std::string, std::string> args;
-	args["feed_id"] = id;
-	args["show_content"] = "1";
-	args["include_attachments"] = "1";
-	json content = run_op("getHeadlines", args, cached_handle, true);
+	if (!headline["link"].is_null()) {
+		item.link = std::move(headline["link"].get_ref<std::string&>());
+	}
 
-	if (content.is_null()) {
-		return f;
+	if (!headline["author"].is_null()) {
+		item.author = std::move(headline["author"].get_ref<std::string&>());
 	}
 
-	if (!content.is_array()) {
-		LOG(Level::ERROR,
-			"TtRssApi::fetch_feed: content is not an array");
-		return f;
+	if (!headline["content"].is_null()) {
+		item.content_encoded =
+			std::move(headline["content"].get_ref<std::string&>());
 	}
 
-	LOG(Level::DEBUG,
-		"TtRssApi::fetch_feed: %" PRIu64 " items",
-		static_cast<uint64_t>(content.size()));
+	if (!headline["attachments"].is_null()) {
+		for (json& a : headline["attachments"]) {
+			if (!a["content_url"].is_null() && !a["content_type"].is_null()) {
+				item.enclosures.push_back(
+				rsspp::Enclosure {
+					std::move(a["content_url"].get_ref<std::string&>()),
+					std::move(a["content_type"].get_ref<std::string&>()),
+				}
+				);
+				break;
+			}
+		}
+	}
 
-	try {
-		for (const auto& item_obj : content) {
-			rsspp::Item item;
+	int id = headline["id"];
+	item.guid = strprintf::fmt("%d", id);
+	newest_id = std::max(newest_id, id);
 
-			if (!item_obj["title"].is_null()) {
-				item.title = item_obj["title"];
-			}
+	bool unread = headline["unread"];
+	if (unread) {
+		item.labels.push_back("ttrss:unread");
+	} else {
+		item.labels.push_back("ttrss:read");
+	}
 
-			if (!item_obj["link"].is_null()) {
-				item.link = item_obj["link"];
-			}
+	int updated_time = headline["updated"];
+	time_t updated = static_cast<time_t>(updated_time);
 
-			if (!item_obj["author"].is_null()) {
-				item.author = item_obj["author"];
-			}
+	item.pubDate = utils::mt_strf_localtime(
+			"%a, %d %b %Y %H:%M:%S %z",
+			updated);
+	item.pubDate_ts = updated;
 
-			if (!item_obj["content"].is_null()) {
-				item.content_encoded = item_obj["content"];
-			}
+	return item;
+}
 
-			if (!item_obj["attachments"].is_null()) {
-				for (const json& a : item_obj["attachments"]) {
-					if (!a["content_url"].is_null() && !a["content_type"].is_null()) {
-						item.enclosures.push_back(
-						rsspp::Enclosure {
-							a["content_url"],
-							a["content_type"],
-						}
-						);
-						break;
-					}
-				}
-			}
+rsspp::Feed TtRssApi::fetch_feed(const std::string& id)
+{
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+	return fetch_feed(id, handle);
+}
 
-			int id = item_obj["id"];
-			item.guid = strprintf::fmt("%d", id);
+rsspp::Feed TtRssApi::fetch_feed(const std::string& id, CurlHandle& cached_handle)
+{
+	rsspp::Feed f;
 
-			bool unread = item_obj["unread"];
-			if (unread) {
-				item.labels.push_back("ttrss:unread");
-			} else {
-				item.labels.push_back("ttrss:read");
-			}
+	f.rss_version = rsspp::Feed::TTRSS_JSON;
 
-			int updated_time = item_obj["updated"];
-			time_t updated = static_cast<time_t>(updated_time);
+	// Special feeds and categories (negative ids) are always fetched as a
+	// whole: old articles can show up in them, e.g. when they're starred
+	int since_id = 0;
+	const bool incremental =
+		cfg->get_configvalue_as_bool("ttrss-incremental-sync")
+		&& std::atoi(id.c_str()) > 0;
+	if (incremental) {
+		std::lock_guard<std::mutex> guard(newest_ids_lock);
+		const auto newest = newest_ids.find(id);
+		if (newest != newest_ids.end()) {
+			since_id = newest->second;
+		}
+	}
 
-			item.pubDate = utils::mt_strf_localtime(
-					"%a, %d %b %Y %H:%M:%S %z",
-					updated);
-			item.pubDate_ts = updated;
+	std::map<std::string, std::string> args;
+	args["feed_id"] = id;
+	args["show_content"] = "1";
+	args["include_attachments"] = "1";
 
-			f.items.push_back(item);
+	int newest_id = since_id;
+	std::size_t page_items = 0;
+	const auto fetch_headlines = [&]() {
+		page_items = 0;
+		try {
+			const bool fetched = run_list_op("getHeadlines", args, cached_handle,
+			[&](json& headline) {
+				f.items.push_back(parse_headline(headline, newest_id));
+				++page_items;
+			});
+			if (!fetched) {
+				return false;
+			}
+		} catch (json::exception& e) {
+			LOG(Level::ERROR,
+				"Exception occurred while parsing feeed: ",
+				e.what());
 		}
-	} catch (json::exception& e) {
-		LOG(Level::ERROR,
-			"Exception occurred while parsing feeed: ",
-			e.what());
+		LOG(Level::DEBUG,
+			"TtRssApi::fetch_feed: %" PRIu64 " items",
+			static_cast<uint64_t>(page_items));
+		return true;
+	};
+
+	if (since_id == 0) {
+		if (!fetch_headlines()) {
+			return f;
+		}
+	} else {
+		// Only what came in since the last reload, a page at a time. A page
+		// can repeat an article of the one before if new ones arrived in
+		// between; merging the feed drops the copy.
+		args["since_id"] = std::to_string(since_id);
+		args["limit"] = std::to_string(TTRSS_HEADLINES_PAGE_SIZE);
+		for (unsigned int page = 0; page < TTRSS_HEADLINES_MAX_PAGES; ++page) {
+			args["skip"] = std::to_string(page * TTRSS_HEADLINES_PAGE_SIZE);
+			if (!fetch_headlines()) {
+				return f;
+			}
+			if (page_items < TTRSS_HEADLINES_PAGE_SIZE) {
+				break;
+			}
+		}
+		LOG(Level::DEBUG,
+			"TtRssApi::fetch_feed: %" PRIu64 " new items since %d",
+			static_cast<uint64_t>(f.items.size()),
+			since_id);
+	}
+
+	if (incremental && newest_id > since_id) {
+		std::lock_guard<std::mutex> guard(newest_ids_lock);
+		int& newest = newest_ids[id];
+		newest = std::max(newest, newest_id);
 	}
 
 	std::sort(f.items.begin(),
@@ -465,6 +632,51 @@ rsspp::Feed TtRssApi::fetch_feed(const std::string& id, CurlHandle& cached_handl
 	return f;
 }
 
+bool TtRssApi::fetch_unread_guids(std::vector<std::string>& guids)
+{
+	const auto pooled = handles.acquire();
+	CurlHandle& handle = *pooled;
+
+	// Feed -4 has all the articles; the headlines come without content
+	std::map<std::string, std::string> args;
+	args["feed_id"] = "-4";
+	args["view_mode"] = "unread";
+	args["limit"] = std::to_string(TTRSS_HEADLINES_PAGE_SIZE);
+	for (unsigned int page = 0; page < TTRSS_UNREAD_MAX_PAGES; ++page) {
+		args["skip"] = std::to_string(page * TTRSS_HEADLINES_PAGE_SIZE);
+		std::size_t page_items = 0;
+		try {
+			const bool fetched = run_list_op("getHeadlines", args, handle,
+			[&](json& headline) {
+				const int id = headline["id"];
+				guids.push_back(strprintf::fmt("%d", id));
+				++page_items;
+			});
+			if (!fetched) {
+				return false;
+			}
+		} catch (json::exception& e) {
+			LOG(Level::ERROR,
+				"TtRssApi::fetch_unread_guids: Exception occurred while "
+				"parsing the headlines: %s",
+				e.what());
+			return false;
+		}
+		if (page_items < TTRSS_HEADLINES_PAGE_SIZE) {
+			LOG(Level::DEBUG,
+				"TtRssApi::fetch_unread_guids: %" PRIu64 " unread articles",
+				static_cast<uint64_t>(guids.size()));
+			return true;
+		}
+	}
+
+	LOG(Level::WARN,
+		"TtRssApi::fetch_unread_guids: more than %u pages of unread "
+		"articles, giving up",
+		TTRSS_UNREAD_MAX_PAGES);
+	return false;
+}
+
 void TtRssApi::fetch_feeds_per_category(const json& cat,
 	std::vector<TaggedFeedUrl>& feeds)
 {
@@ -22,12 +22,14 @@
 #include <sstream>
 #include <stfl.h>
 #include <string>
+#include <strings.h>
 #include <sys/param.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <unistd.h>
 #include <unordered_set>
 
+#include "bytescan.h"
 #include "config.h"
 #include "curlhandle.h"
 #include "htmlrenderer.h"
@@ -124,6 +126,9 @@ std::vector<std::string> utils::tokenize_spaced(const std::string& str,
 
 std::string utils::consolidate_whitespace(const std::string& str)
 {
+	if (bytescan::is_consolidated(str.data(), str.size())) {
+		return str;
+	}
 	return std::string(utils::bridged::consolidate_whitespace(str));
 }
 
@@ -173,14 +178,54 @@ std::string utils::translit(const std::string& tocode, const std::string& fromco
 	return std::string(utils::bridged::translit(tocode, fromcode));
 }
 
+static bool is_utf8_encoding_name(const char* code)
+{
+	return strcasecmp(code, "utf-8") == 0 || strcasecmp(code, "utf8") == 0;
+}
+
+static bool is_ascii_encoding_name(const char* code)
+{
+	// glibc calls ASCII "ANSI_X3.4-1968" in the C locale
+	return strcasecmp(code, "us-ascii") == 0 || strcasecmp(code, "ascii") == 0
+		|| strcasecmp(code, "ANSI_X3.4-1968") == 0;
+}
+
+/// Whether converting \a text from \a fromcode to \a tocode would only copy
+/// it, which spares the trip through Rust and iconv.
+static bool is_conversion_a_copy(const std::string& text, const char* tocode,
+	const char* fromcode)
+{
+	if (is_utf8_encoding_name(tocode) && is_utf8_encoding_name(fromcode)) {
+		return bytescan::is_valid_utf8(text.data(), text.size());
+	}
+	const bool ascii_compatible =
+		(is_utf8_encoding_name(tocode) || is_ascii_encoding_name(tocode))
+		&& (is_utf8_encoding_name(fromcode) || is_ascii_encoding_name(fromcode));
+	return ascii_compatible && bytescan::is_ascii(text.data(), text.size());
+}
+
+bool utils::is_utf8_compatible_charset(const std::string& charset)
+{
+	return is_utf8_encoding_name(charset.c_str())
+		|| is_ascii_encoding_name(charset.c_str());
+}
+
 std::string utils::utf8_to_locale(const std::string& text)
 {
+	if (is_conversion_a_copy(text, nl_langinfo(CODESET), "utf-8")) {
+		return text;
+	}
+
 	const auto result = utils::bridged::utf8_to_locale(text);
 	return std::string(reinterpret_cast<const char*>(result.data()), result.size());
 }
 
 std::string utils::locale_to_utf8(const std::string& text)
 {
+	if (is_conversion_a_copy(text, "utf-8", nl_langinfo(CODESET))) {
+		return text;
+	}
+
 	const auto text_slice =
 		rust::Slice<const unsigned char>(
 			reinterpret_cast<const unsigned char*>(text.c_str()),
@@ -191,6 +236,10 @@ std::string utils::locale_to_utf8(const std::string& text)
 std::string utils::convert_text(const std::string& text, const std::string& tocode,
 	const std::string& fromcode)
 {
+	if (is_conversion_a_copy(text, tocode.c_str(), fromcode.c_str())) {
+		return text;
+	}
+
 	const auto text_slice =
 		rust::Slice<const unsigned char>(
 			reinterpret_cast<const unsigned char*>(text.c_str()),
@@ -270,10 +319,22 @@ std::string utils::retrieve_url(const std::string& url,
 
 namespace {
 
+/// The most that's reserved for a body up front; a server could claim any
+/// Content-Length.
+const std::size_t MAX_RESERVED_BODY_SIZE = 64 * 1024 * 1024;
+
 struct HeaderValues {
 	std::string charset;
-
-	HeaderValues()
+	time_t last_modified;
+	std::string etag;
+	/// Where the body goes, so that it can be made room for once its size
+	/// is known
+	std::string* body;
+	/// Gets every header if it's set
+	std::function<void(const std::string&)> on_header;
+
+	explicit HeaderValues(std::string* body)
+		: body(body)
 	{
 		reset();
 	}
@@ -281,6 +342,8 @@ struct HeaderValues {
 	void reset()
 	{
 		charset = "utf-8";
+		last_modified = 0;
+		etag.clear();
 	}
 };
 
@@ -290,10 +353,26 @@ static size_t handle_headers(void* ptr, size_t size, size_t nmemb, void* data)
 {
 	const auto header = std::string(reinterpret_cast<const char*>(ptr), size * nmemb);
 	HeaderValues* values = static_cast<HeaderValues*>(data);
+	if (values->on_header) {
+		values->on_header(header);
+	}
 
 	if (header.find("HTTP/") == 0) {
 		// Reset headers if a new response is detected (there might be multiple responses per request in case of a redirect)
 		values->reset();
+	} else if (strncasecmp(header.c_str(), "Last-Modified:", 14) == 0) {
+		const time_t t = curl_getdate(header.substr(14).c_str(), nullptr);
+		values->last_modified = t == -1 ? 0 : t;
+	} else if (strncasecmp(header.c_str(), "ETag:", 5) == 0) {
+		values->etag = header.substr(5);
+		utils::trim(values->etag);
+	} else if (strncasecmp(header.c_str(), "Content-Length:", 15) == 0) {
+		// Saves growing the body a chunk at a time. If it's compressed,
+		// this is the compressed size, which is still a start.
+		const unsigned long long length = std::strtoull(header.c_str() + 15,
+				nullptr, 10);
+		values->body->reserve(std::min<unsigned long long>(length,
+				MAX_RESERVED_BODY_SIZE));
 	} else if (header.find("Content-Type:") == 0) {
 		const std::string key = "charset=";
 		const auto charset_index = header.find(key);
@@ -317,7 +396,8 @@ std::string utils::retrieve_url(const std::string& url,
 	ConfigContainer* cfgcont,
 	const std::string& authinfo,
 	const std::string* body,
-	const HTTPMethod method /* = GET */)
+	const HTTPMethod method /* = GET */,
+	ConditionalRequest* request /* = nullptr */)
 {
 	std::string buf;
 
@@ -326,7 +406,10 @@ std::string utils::retrieve_url(const std::string& url,
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_WRITEFUNCTION, my_write_data);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_WRITEDATA, &buf);
 
-	HeaderValues hdrs;
+	HeaderValues hdrs(&buf);
+	if (request != nullptr) {
+		hdrs.on_header = request->on_header;
+	}
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_HEADERDATA, &hdrs);
 	curl_easy_setopt(easyhandle.ptr(), CURLOPT_HEADERFUNCTION, handle_headers);
 
@@ -354,6 +437,28 @@ std::string utils::retrieve_url(const std::string& url,
 		curl_easy_setopt(easyhandle.ptr(), CURLOPT_USERPWD, authinfo.c_str());
 	}
 
+	curl_slist* headers = nullptr;
+	if (request != nullptr) {
+		for (const auto& header : request->headers) {
+			headers = curl_slist_append(headers, header.c_str());
+		}
+		if (!request->etag.empty()) {
+			const auto header = strprintf::fmt("If-None-Match: %s", request->etag);
+			headers = curl_slist_append(headers, header.c_str());
+		}
+		if (headers != nullptr) {
+			curl_easy_setopt(easyhandle.ptr(), CURLOPT_HTTPHEADER, headers);
+		}
+		if (request->last_modified != 0) {
+			curl_easy_setopt(easyhandle.ptr(),
+				CURLOPT_TIMECONDITION,
+				CURL_TIMECOND_IFMODSINCE);
+			curl_easy_setopt(easyhandle.ptr(), CURLOPT_TIMEVALUE,
+				static_cast<long>(request->last_modified));
+		}
+		request->not_modified = false;
+	}
+
 	// Error handling as per https://curl.se/libcurl/c/CURLOPT_ERRORBUFFER.html
 	char errbuf[CURL_ERROR_SIZE];
 	// Please note that we clobber CURLOPT_ERRORBUFFER here in case of cached handles
@@ -384,6 +489,30 @@ std::string utils::retrieve_url(const std::string& url,
 		LOG(Level::DEBUG, "%s: %s", logprefix.str(), buf);
 	}
 
+	if (request != nullptr) {
+		if (headers != nullptr) {
+			curl_easy_setopt(easyhandle.ptr(), CURLOPT_HTTPHEADER, NULL);
+			curl_slist_free_all(headers);
+		}
+		curl_easy_setopt(easyhandle.ptr(), CURLOPT_TIMECONDITION,
+			CURL_TIMECOND_NONE);
+
+		if (res == CURLE_OK) {
+			long status = 0;
+			long unmet = 0;
+			curl_easy_getinfo(easyhandle.ptr(), CURLINFO_RESPONSE_CODE, &status);
+			curl_easy_getinfo(easyhandle.ptr(), CURLINFO_CONDITION_UNMET, &unmet);
+			request->not_modified = status == 304 || unmet != 0;
+			if (request->not_modified) {
+				LOG(Level::DEBUG, "%s: not modified", logprefix.str());
+				buf = "";
+			} else {
+				request->last_modified = hdrs.last_modified;
+				request->etag = hdrs.etag;
+			}
+		}
+	}
+
 	// Reset ERRORBUFFER: has to be valid for the whole lifetime of the handle
 	// NULL is the default value of this property according to man (3) CURLOPT_ERRORBUFFER
 	// See the clobbering note above.
@@ -420,6 +549,9 @@ std::string utils::replace_all(std::string str,
 	const std::string& from,
 	const std::string& to)
 {
+	if (!from.empty() && str.find(from) == std::string::npos) {
+		return str;
+	}
 	return std::string(utils::bridged::replace_all(str, from, to));
 }
 
@@ -527,15 +659,59 @@ std::vector<std::pair<unsigned int, unsigned int>> utils::partition_indexes(
 	return partitions;
 }
 
+std::size_t utils::strwidth(const std::string& str)
+{
+	if (is_printable_ascii(str)) {
+		return str.size();
+	}
+	return utils::bridged::strwidth(str);
+}
+
+std::size_t utils::strwidth_stfl(const std::string& str)
+{
+	if (!is_printable_ascii(str)) {
+		return utils::bridged::strwidth_stfl(str);
+	}
+
+	// Same as the Rust implementation, with every character being 1 wide
+	std::size_t width = 0;
+	std::size_t pos = 0;
+	while (true) {
+		const std::size_t tag_start = str.find('<', pos);
+		if (tag_start == std::string::npos) {
+			width += str.size() - pos;
+			break;
+		}
+		width += tag_start - pos;
+		const std::size_t tag_end = str.find('>', tag_start);
+		if (tag_end == std::string::npos) {
+			// '<' without closing '>' so ignore rest of string
+			break;
+		}
+		if (tag_end == tag_start + 1) {
+			// Found "<>" which stfl uses to encode a literal '<'
+			width += 1;
+		}
+		pos = tag_end + 1;
+	}
+	return width;
+}
+
 std::string utils::substr_with_width(const std::string& str,
 	const size_t max_width)
 {
+	if (is_printable_ascii(str)) {
+		return str.substr(0, max_width);
+	}
 	return std::string(utils::bridged::substr_with_width(str, max_width));
 }
 
 std::string utils::substr_with_width_stfl(const std::string& str,
 	const size_t max_width)
 {
+	if (is_printable_ascii(str) && str.find('<') == std::string::npos) {
+		return str.substr(0, max_width);
+	}
 	return std::string(utils::bridged::substr_with_width_stfl(str, max_width));
 }
 
@@ -561,19 +737,55 @@ std::string utils::censor_url(const std::string& url)
 	return std::string(utils::bridged::censor_url(url));
 }
 
+std::string utils::host_of(const std::string& url)
+{
+	std::string::size_type start = url.find("//");
+	start = (start == std::string::npos) ? 0 : start + 2;
+	const auto end = url.find_first_of("/?#", start);
+	std::string host = url.substr(start,
+			end == std::string::npos ? std::string::npos : end - start);
+	const auto at = host.rfind('@');
+	if (at != std::string::npos) {
+		host.erase(0, at + 1);
+	}
+	std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+	return host;
+}
+
 std::string utils::quote_for_stfl(std::string str)
 {
+	if (str.find('<') == std::string::npos) {
+		return str;
+	}
 	return std::string(utils::bridged::quote_for_stfl(str));
 }
 
 void utils::trim(std::string& str)
 {
-	str = std::string(utils::bridged::trim(str));
+	// The ASCII characters that Rust's char::is_whitespace() is true for.
+	// If the text starts and ends with ASCII after those, no other Unicode
+	// whitespace can be at its ends, and Rust wouldn't trim any more.
+	const char* const ascii_whitespace = " \t\n\v\f\r";
+	const auto first = str.find_first_not_of(ascii_whitespace);
+	if (first == std::string::npos) {
+		str.clear();
+		return;
+	}
+	const auto last = str.find_last_not_of(ascii_whitespace);
+	if (static_cast<unsigned char>(str[first]) >= 0x80
+		|| static_cast<unsigned char>(str[last]) >= 0x80) {
+		str = std::string(utils::bridged::trim(str));
+		return;
+	}
+	str.erase(last + 1);
+	str.erase(0, first);
 }
 
 void utils::trim_end(std::string& str)
 {
-	str = std::string(utils::bridged::trim_end(str));
+	// Neither byte is ever part of a longer UTF-8 sequence
+	const auto last = str.find_last_not_of("\r\n");
+	str.erase(last == std::string::npos ? 0 : last + 1);
 }
 
 std::string utils::quote(const std::string& str)
@@ -583,6 +795,9 @@ std::string utils::quote(const std::string& str)
 
 std::string utils::quote_if_necessary(const std::string& str)
 {
+	if (str.find(' ') == std::string::npos) {
+		return str;
+	}
 	return std::string(utils::bridged::quote_if_necessary(str));
 }
 
@@ -632,12 +847,7 @@ void utils::set_common_curl_options(CurlHandle& handle, ConfigContainer* cfg)
 		const std::string cookie_cache =
 			cfg->get_configvalue("cookie-cache");
 		if (cookie_cache != "") {
-			curl_easy_setopt(handle.ptr(),
-				CURLOPT_COOKIEFILE,
-				cookie_cache.c_str());
-			curl_easy_setopt(handle.ptr(),
-				CURLOPT_COOKIEJAR,
-				cookie_cache.c_str());
+			handle.use_cookies(cookie_cache);
 		}
 
 		curl_easy_setopt(handle.ptr(),
@@ -730,6 +940,63 @@ std::wstring utils::clean_nonprintable_characters(std::wstring text)
 	return text;
 }
 
+std::string utils::clean_nonprintable_characters(const std::string& text)
+{
+	if (is_printable_ascii(text)) {
+		return text;
+	}
+	if (std::strcmp(nl_langinfo(CODESET), "UTF-8") != 0) {
+		return wstr2str(clean_nonprintable_characters(str2wstr(text)));
+	}
+
+	// U+FFFD REPLACEMENT CHARACTER
+	const char replacement[] = "\xEF\xBF\xBD";
+
+	std::string result;
+	result.reserve(text.size());
+	mbstate_t mb_state;
+	::memset(&mb_state, 0, sizeof(mb_state));
+
+	const char* pos = text.data();
+	const char* const end = text.data() + text.size();
+	// The wide conversion went through a C string, which ends at the first
+	// NUL
+	while (pos < end && *pos != '\0') {
+		const unsigned char c = *pos;
+		if (c < 0x80) {
+			if (iswprint(c)) {
+				result.push_back(c);
+			} else {
+				result.append(replacement);
+			}
+			++pos;
+			continue;
+		}
+
+		wchar_t wc;
+		const std::size_t length = mbrtowc(&wc, pos, end - pos, &mb_state);
+		if (length == static_cast<std::size_t>(-1)
+			|| length == static_cast<std::size_t>(-2)) {
+			result.append(replacement);
+			::memset(&mb_state, 0, sizeof(mb_state));
+			++pos;
+			continue;
+		}
+		if (iswprint(wc)) {
+			result.append(pos, length);
+		} else {
+			result.append(replacement);
+		}
+		pos += length;
+	}
+	return result;
+}
+
+bool utils::is_printable_ascii(const std::string& text)
+{
+	return bytescan::is_printable_ascii(text.data(), text.size());
+}
+
 /* Like mkdir(), but creates ancestors (parent directories) if they don't
  * exist. */
 int utils::mkdir_parents(const std::string& p, mode_t mode)
@@ -805,6 +1072,9 @@ nonstd::expected<std::vector<std::string>, utils::ReadTextFileError> utils::read
 
 void utils::remove_soft_hyphens(std::string& text)
 {
+	if (bytescan::find_soft_hyphen(text.data(), text.size()) == std::string::npos) {
+		return;
+	}
 	rust::String tmp(text);
 	utils::bridged::remove_soft_hyphens(tmp);
 	text = std::string(tmp);
@@ -1,11 +1,16 @@
 #include "view.h"
 
 #include <assert.h>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <dirent.h>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <grp.h>
 #include <iomanip>
 #include <iostream>
@@ -16,6 +21,7 @@
 #include <string.h>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <thread>
 #include <time.h>
 #include <unistd.h>
 
@@ -47,22 +53,95 @@ extern "C" {
 #include "itemlistformaction.h"
 #include "itemview.h"
 #include "itemviewformaction.h"
+#include "jobprogress.h"
 #include "keymap.h"
 #include "logger.h"
 #include "matcherexception.h"
 #include "regexmanager.h"
 #include "reloadthread.h"
 #include "rssfeed.h"
+#include "runtimestats.h"
 #include "selectformaction.h"
 #include "selecttag.h"
+#include "stats.h"
+#include "statsformaction.h"
 #include "strprintf.h"
+#include "tracelog.h"
 #include "urlview.h"
 #include "urlviewformaction.h"
 #include "utils.h"
 #include "searchresultslistformaction.h"
 
 namespace {
-bool ctrl_c_hit = false;
+std::atomic<bool> ctrl_c_hit(false);
+
+/// How long View::run_job() waits for a job before it shows that it's
+/// running, and how often it looks at the keyboard after that, in
+/// milliseconds. Most jobs are done before anything is shown.
+const unsigned int JOB_QUIET_TIME = 200;
+const unsigned int JOB_POLL_INTERVAL = 100;
+
+/// How often a second the status line is drawn at most when messages come
+/// in quickly, like they do during a reload.
+const unsigned int STATUS_REDRAWS_PER_SECOND = 20;
+
+/// \brief Takes the next key off the input queue if it's there already,
+/// and names it the way STFL does.
+///
+/// Only keys with simple names are taken: printable characters other than
+/// space, and the cursor keys. Anything else is put back, and an empty
+/// string is returned.
+std::string take_queued_key(wint_t& ch, bool& is_function_key)
+{
+	wtimeout(stdscr, 0);
+	const int rc = wget_wch(stdscr, &ch);
+	wtimeout(stdscr, -1);
+	if (rc == ERR) {
+		return {};
+	}
+
+	is_function_key = rc == KEY_CODE_YES;
+	if (is_function_key) {
+		switch (ch) {
+		case KEY_UP:
+			return "UP";
+		case KEY_DOWN:
+			return "DOWN";
+		case KEY_PPAGE:
+			return "PPAGE";
+		case KEY_NPAGE:
+			return "NPAGE";
+		case KEY_HOME:
+			return "HOME";
+		case KEY_END:
+			return "END";
+		}
+	} else if (ch > L' ' && ch != 0x7f) {
+		return newsboat::utils::wstr2str(std::wstring(1, ch));
+	}
+
+	if (is_function_key) {
+		ungetch(ch);
+	} else {
+		unget_wch(ch);
+	}
+	return {};
+}
+
+std::string job_status(const std::string& message,
+	const newsboat::JobProgress& progress, std::chrono::seconds elapsed)
+{
+	if (progress.is_cancelled()) {
+		return newsboat::strprintf::fmt(_("%s cancelling..."), message);
+	}
+	const int percent = progress.percent_done();
+	if (percent >= 0) {
+		return newsboat::strprintf::fmt(_("%s %d%% (press ESC to cancel)"),
+				message, percent);
+	}
+	return newsboat::strprintf::fmt(_("%s %us (press ESC to cancel)"),
+			message, static_cast<unsigned int>(elapsed.count()));
+}
 }
 
 namespace newsboat {
@@ -80,6 +159,9 @@ View::View(Controller* c)
 	, rsscache(nullptr)
 	, filters(ctrl->get_filtercontainer())
 	, colorman(ctrl->get_colormanager())
+	, feedlist_refresh(std::bind(&Controller::update_feedlist, c), 0)
+	, status_redraw(std::bind(&View::redraw_status, this),
+		  STATUS_REDRAWS_PER_SECOND)
 {
 	if (getenv("ESCDELAY") == nullptr) {
 		set_escdelay(25);
@@ -113,12 +195,33 @@ std::shared_ptr<FormAction> View::get_current_formaction()
 
 void View::set_status(const std::string& msg)
 {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+
+		auto fa = get_current_formaction();
+		if (fa == nullptr
+			|| std::dynamic_pointer_cast<EmptyFormAction>(fa) != nullptr) {
+			return;
+		}
+		fa->set_value("msg", msg);
+	}
+	status_redraw.request();
+}
+
+void View::messages_pending()
+{
+	status_redraw.request_in_background();
+}
+
+void View::redraw_status()
+{
+	status_line.drain();
+
 	std::lock_guard<std::mutex> lock(mtx);
 
 	auto fa = get_current_formaction();
 	if (fa != nullptr
 		&& std::dynamic_pointer_cast<EmptyFormAction>(fa) == nullptr) {
-		fa->set_value("msg", msg);
 		fa->draw_form();
 	}
 }
@@ -133,6 +236,72 @@ StatusLine& View::get_statusline()
 	return status_line;
 }
 
+bool View::run_job(const std::string& message,
+	const std::function<void(JobProgress&)>& job)
+{
+	JobProgress progress;
+	std::exception_ptr error;
+	std::mutex finished_mtx;
+	std::condition_variable job_finished;
+	bool finished = false;
+
+	std::thread worker([&]() {
+		try {
+			job(progress);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(finished_mtx);
+		finished = true;
+		job_finished.notify_one();
+	});
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto fa = get_current_formaction();
+	bool done = false;
+	{
+		std::unique_lock<std::mutex> lock(finished_mtx);
+		const auto has_finished = [&]() {
+			return finished;
+		};
+		if (fa == nullptr) {
+			// There's nothing to draw the progress on
+			job_finished.wait(lock, has_finished);
+			done = true;
+		} else {
+			done = job_finished.wait_for(lock,
+					std::chrono::milliseconds(JOB_QUIET_TIME), has_finished);
+		}
+	}
+
+	if (!done) {
+		const auto message_lifetime = status_line.show_message_until_finished(
+				message);
+		while (!done) {
+			const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+					std::chrono::steady_clock::now() - start);
+			message_lifetime->update(job_status(message, progress, elapsed));
+
+			const std::string event = fa->draw_form_wait_for_event(JOB_POLL_INTERVAL);
+			if (event == "RESIZE") {
+				handle_resize();
+			} else if (event == "ESC" || take_ctrl_c()) {
+				LOG(Level::DEBUG, "View::run_job: cancelling `%s'", message);
+				progress.cancel();
+			}
+
+			std::lock_guard<std::mutex> lock(finished_mtx);
+			done = finished;
+		}
+	}
+
+	worker.join();
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return !progress.is_cancelled();
+}
+
 bool View::run_commands(const std::vector<MacroCmd>& commands)
 {
 	for (auto command : commands) {
@@ -181,10 +350,14 @@ int View::run()
 		std::shared_ptr<FormAction> fa = get_current_formaction();
 
 		// we signal "oh, you will receive an operation soon"
-		fa->prepare();
+		{
+			RuntimeStatsTimer timer(RuntimeStats::Counter::UI_NS);
+			TraceSpan span("redraw: prepare");
+			fa->prepare();
+		}
 
 		// we then receive the event and ignore timeouts.
-		const std::string event = fa->draw_form_wait_for_event(INT_MAX);
+		const std::string event = fa->draw_form_wait_for_event(fa->wait_time());
 
 		if (ctrl_c_hit) {
 			ctrl_c_hit = false;
@@ -237,6 +410,10 @@ int View::run()
 			// now we handle the operation to the
 			// formaction.
 			fa->process_op(op);
+
+			if (op > OP_SK_MIN && op < OP_SK_MAX) {
+				process_queued_movements(fa);
+			}
 		}
 	}
 
@@ -246,6 +423,31 @@ int View::run()
 	return EXIT_SUCCESS;
 }
 
+void View::process_queued_movements(std::shared_ptr<FormAction> fa)
+{
+	while (!is_inside_qna && fa == get_current_formaction()) {
+		wint_t ch = 0;
+		bool is_function_key = false;
+		const std::string event = take_queued_key(ch, is_function_key);
+		if (event.empty()) {
+			return;
+		}
+
+		const Operation op = keys->get_operation(event, fa->id());
+		if (op <= OP_SK_MIN || op >= OP_SK_MAX) {
+			if (is_function_key) {
+				ungetch(ch);
+			} else {
+				unget_wch(ch);
+			}
+			return;
+		}
+		LOG(Level::DEBUG, "View::process_queued_movements: event = %s op = %u",
+			event, op);
+		fa->process_op(op);
+	}
+}
+
 std::string View::run_modal(std::shared_ptr<FormAction> f,
 	const std::string& value)
 {
@@ -268,7 +470,7 @@ std::string View::run_modal(std::shared_ptr<FormAction> f,
 
 		fa->prepare();
 
-		const std::string event = fa->draw_form_wait_for_event(INT_MAX);
+		const std::string event = fa->draw_form_wait_for_event(fa->wait_time());
 		LOG(Level::DEBUG, "View::run: event = %s", event);
 		if (event.empty() || event == "TIMEOUT") {
 			continue;
@@ -424,6 +626,21 @@ void View::update_visible_feeds(std::vector<std::shared_ptr<RssFeed>> feeds)
 	}
 }
 
+std::unordered_set<std::string> View::feeds_in_view()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	std::unordered_set<std::string> feedurls;
+	if (feedlist_form != nullptr) {
+		for (const auto& feed : feedlist_form->feeds_on_screen()) {
+			feedurls.insert(feed->rssurl());
+		}
+	}
+	if (!opened_feedurl.empty()) {
+		feedurls.insert(opened_feedurl);
+	}
+	return feedurls;
+}
+
 void View::set_feedlist(std::vector<std::shared_ptr<RssFeed>> feeds)
 {
 	try {
@@ -444,6 +661,15 @@ void View::set_feedlist(std::vector<std::shared_ptr<RssFeed>> feeds)
 	}
 }
 
+void View::request_feedlist_update()
+{
+	if (cfg != nullptr) {
+		feedlist_refresh.set_rate(
+			cfg->get_configvalue_as_int("feedlist-refresh-rate"));
+	}
+	feedlist_refresh.request();
+}
+
 void View::set_tags(const std::vector<std::string>& t)
 {
 	tags = t;
@@ -494,6 +720,10 @@ std::shared_ptr<ItemListFormAction> View::push_itemlist(
 		itemlist->init();
 		formaction_stack.push_back(itemlist);
 		current_formaction = formaction_stack_size() - 1;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			opened_feedurl = feed->rssurl();
+		}
 		return itemlist;
 	} else {
 		status_line.show_error(_("Error: feed contains no items!"));
@@ -596,6 +826,16 @@ void View::push_help()
 	current_formaction = formaction_stack_size() - 1;
 }
 
+void View::push_stats()
+{
+	auto statsview = std::make_shared<StatsFormAction>(this, stats_str, cfg);
+	apply_colors(statsview);
+	statsview->set_parent_formaction(get_current_formaction());
+	statsview->init();
+	formaction_stack.push_back(statsview);
+	current_formaction = formaction_stack_size() - 1;
+}
+
 void View::push_urlview(const std::vector<LinkPair>& links,
 	std::shared_ptr<RssFeed>& feed)
 {
@@ -959,7 +1199,8 @@ bool View::get_prev_feed(ItemListFormAction& itemlist)
 	return false;
 }
 
-void View::prepare_query_feed(std::shared_ptr<RssFeed> feed)
+void View::prepare_query_feed(std::shared_ptr<RssFeed> feed,
+	const std::unordered_set<std::string>* replaced_feedurls)
 {
 	if (feed->is_query_feed()) {
 		LOG(Level::DEBUG,
@@ -968,8 +1209,13 @@ void View::prepare_query_feed(std::shared_ptr<RssFeed> feed)
 
 		const std::shared_ptr<AutoDiscardMessage> message =
 			status_line.show_message_until_finished(_("Updating query feed..."));
-		feed->update_items(ctrl->get_feedcontainer()->get_all_feeds());
-		feed->sort(cfg->get_article_sort_strategy());
+		const auto feeds = ctrl->get_feedcontainer()->get_feeds_snapshot();
+		const auto sort_strategy = cfg->get_article_sort_strategy();
+		if (replaced_feedurls == nullptr
+			|| !feed->update_items(*feeds, *replaced_feedurls, sort_strategy)) {
+			feed->update_items(*feeds);
+			feed->sort(sort_strategy);
+		}
 		notify_itemlist_change(feed);
 	}
 }
@@ -1271,4 +1517,9 @@ void View::ctrl_c_action(int /* sig */)
 	ctrl_c_hit = true;
 }
 
+bool View::take_ctrl_c()
+{
+	return ctrl_c_hit.exchange(false);
+}
+
 } // namespace newsboat
@@ -0,0 +1,110 @@
+#include "websubrelay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_set>
+
+#include "logger.h"
+#include "utils.h"
+
+namespace newsboat {
+
+/// Adds the lines of \a filename that aren't empty to \a lines.
+static void read_lines(const std::string& filename,
+	std::vector<std::string>& lines)
+{
+	std::ifstream file(filename);
+	std::string line;
+	while (std::getline(file, line)) {
+		utils::trim(line);
+		if (!line.empty()) {
+			lines.push_back(line);
+		}
+	}
+}
+
+WebSubRelay::WebSubRelay(const std::string& dir)
+	: dir(dir)
+{
+}
+
+void WebSubRelay::write_subscriptions(
+	std::vector<std::pair<std::string, std::string>> hubs)
+{
+	std::sort(hubs.begin(), hubs.end());
+	std::ostringstream contents;
+	for (const auto& hub : hubs) {
+		contents << hub.first << ' ' << hub.second << '\n';
+	}
+
+	const std::string filename = dir + "/subscriptions";
+	{
+		std::ifstream current(filename);
+		std::ostringstream current_contents;
+		current_contents << current.rdbuf();
+		if (current && current_contents.str() == contents.str()) {
+			return;
+		}
+	}
+
+	// The relay may read the file at any time, so it's replaced at once
+	const std::string tempname = filename + ".new";
+	{
+		std::ofstream file(tempname, std::ios::trunc);
+		file << contents.str();
+		if (!file) {
+			LOG(Level::ERROR,
+				"WebSubRelay::write_subscriptions: couldn't write %s",
+				tempname);
+			return;
+		}
+	}
+	if (std::rename(tempname.c_str(), filename.c_str()) != 0) {
+		LOG(Level::ERROR,
+			"WebSubRelay::write_subscriptions: couldn't replace %s: %s",
+			filename,
+			std::strerror(errno));
+		::unlink(tempname.c_str());
+		return;
+	}
+	LOG(Level::INFO,
+		"WebSubRelay::write_subscriptions: listed %u feed(s)",
+		static_cast<unsigned int>(hubs.size()));
+}
+
+std::vector<std::string> WebSubRelay::take_pushed()
+{
+	const std::string filename = dir + "/pushed";
+	const std::string taken = filename + ".taken";
+
+	// The relay creates the file again for the next notification, so none
+	// is lost while this one is read. What's left from a call that didn't
+	// get to finish is read first.
+	std::vector<std::string> lines;
+	read_lines(taken, lines);
+	if (std::rename(filename.c_str(), taken.c_str()) == 0) {
+		read_lines(taken, lines);
+	} else if (errno != ENOENT) {
+		LOG(Level::ERROR,
+			"WebSubRelay::take_pushed: couldn't take %s: %s",
+			filename,
+			std::strerror(errno));
+	}
+	::unlink(taken.c_str());
+
+	std::vector<std::string> topics;
+	std::unordered_set<std::string> seen;
+	for (auto& line : lines) {
+		if (seen.insert(line).second) {
+			topics.push_back(std::move(line));
+		}
+	}
+	return topics;
+}
+
+} // namespace newsboat
@@ -0,0 +1,77 @@
+#include "workerpool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "logger.h"
+
+namespace newsboat {
+
+WorkerPool::WorkerPool(unsigned int threads)
+	: finished(false)
+	, stopped(false)
+{
+	threads = std::max(threads, 1u);
+	for (unsigned int i = 0; i < threads; ++i) {
+		workers.emplace_back(&WorkerPool::run, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	finish();
+}
+
+void WorkerPool::push(Job job)
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		if (stopped) {
+			LOG(Level::ERROR, "WorkerPool::push: pool is stopped, dropping job");
+			return;
+		}
+		queue.push_back(std::move(job));
+	}
+	queue_not_empty.notify_one();
+}
+
+void WorkerPool::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		finished = true;
+	}
+	queue_not_empty.notify_all();
+
+	for (auto& worker : workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(queue_mutex);
+	stopped = true;
+}
+
+void WorkerPool::run()
+{
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			queue_not_empty.wait(lock, [this]() {
+				return !queue.empty() || finished;
+			});
+			if (queue.empty()) {
+				// Finished and drained; whoever is still running a job
+				// takes care of the jobs it pushes
+				break;
+			}
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+		job();
+	}
+}
+
+} // namespace newsboat
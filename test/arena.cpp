@@ -0,0 +1,85 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("Arena::allocate() returns aligned memory from as few blocks as "
+	"it can",
+	"[Arena]")
+{
+	Arena arena(1024);
+	REQUIRE(arena.block_count() == 0);
+
+	std::vector<char*> pieces;
+	for (std::size_t alignment = 1; alignment <= alignof(std::max_align_t);
+		alignment *= 2) {
+		INFO("alignment " << alignment);
+		auto piece = static_cast<char*>(arena.allocate(3, alignment));
+		REQUIRE(reinterpret_cast<std::uintptr_t>(piece) % alignment == 0);
+		pieces.push_back(piece);
+	}
+	REQUIRE(arena.block_count() == 1);
+
+	// The pieces don't overlap
+	for (std::size_t i = 1; i < pieces.size(); ++i) {
+		REQUIRE(pieces[i] >= pieces[i - 1] + 3);
+	}
+
+	SECTION("a new block is started once the last one is full") {
+		for (int i = 0; i < 100; ++i) {
+			arena.allocate(100, 8);
+		}
+		REQUIRE(arena.block_count() > 1);
+		REQUIRE(arena.block_count() < 20);
+	}
+
+	SECTION("allocations bigger than a block get one of their own") {
+		auto big = static_cast<char*>(arena.allocate(4096, 8));
+		std::fill(big, big + 4096, 'x');
+		REQUIRE(arena.block_count() == 2);
+	}
+}
+
+TEST_CASE("Objects made with ArenaAllocator keep their arena alive until "
+	"the last of them goes",
+	"[Arena]")
+{
+	std::weak_ptr<Arena> weak_arena;
+	std::shared_ptr<std::string> first;
+	std::shared_ptr<std::string> second;
+	{
+		const auto arena = std::make_shared<Arena>();
+		weak_arena = arena;
+		const ArenaAllocator<std::string> allocator(arena);
+		first = std::allocate_shared<std::string>(allocator,
+				"a string that's too long to fit in the object itself");
+		second = std::allocate_shared<std::string>(allocator, "another");
+		REQUIRE(arena->block_count() == 1);
+	}
+
+	REQUIRE_FALSE(weak_arena.expired());
+	first.reset();
+	REQUIRE_FALSE(weak_arena.expired());
+	REQUIRE(*second == "another");
+	second.reset();
+	REQUIRE(weak_arena.expired());
+}
+
+TEST_CASE("Containers can get their memory from an ArenaAllocator", "[Arena]")
+{
+	const ArenaAllocator<int> allocator(std::make_shared<Arena>());
+	std::vector<int, ArenaAllocator<int>> numbers(allocator);
+	for (int i = 0; i < 1000; ++i) {
+		numbers.push_back(i);
+	}
+	REQUIRE(numbers[999] == 999);
+	REQUIRE(numbers.get_allocator() == allocator);
+}
@@ -0,0 +1,150 @@
+#include "articleexporter.h"
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unistd.h>
+
+#include "3rd-party/catch.hpp"
+#include "3rd-party/json.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "itemrenderer.h"
+#include "jobprogress.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+#include "test_helpers/tempdir.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::shared_ptr<RssItem> make_item(Cache* rsscache,
+	const std::shared_ptr<RssFeed>& feed, unsigned int i)
+{
+	auto item = std::make_shared<RssItem>(rsscache);
+	item->set_feedptr(feed);
+	item->set_guid("guid-" + std::to_string(i));
+	item->set_title("Article " + std::to_string(i));
+	item->set_author("Ada");
+	item->set_link("https://example.com/" + std::to_string(i));
+	// Sun Sep 30 19:34:25 UTC 2018
+	item->set_pubDate(1538336065);
+	item->set_description("<p>Article number " + std::to_string(i) + "</p>",
+		"text/html");
+	return item;
+}
+
+std::string read_file(const std::string& path)
+{
+	std::ifstream f(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f),
+			std::istreambuf_iterator<char>());
+}
+
+} // anonymous namespace
+
+TEST_CASE("ArticleExporter::write_files() writes what `save` would, in every "
+	"file", "[ArticleExporter]")
+{
+	test_helpers::TempDir tmp;
+	ConfigContainer cfg;
+	cfg.set_configvalue("text-width", "80");
+	Cache rsscache(":memory:", &cfg);
+	const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+
+	std::vector<ArticleExporter::File> files;
+	// More than a batch
+	for (unsigned int i = 0; i < 300; ++i) {
+		files.emplace_back(tmp.get_path() + "/" + std::to_string(i) + ".txt",
+			make_item(&rsscache, feed, i));
+	}
+	files.emplace_back(tmp.get_path() + "/missing/dir.txt",
+		make_item(&rsscache, feed, 300));
+
+	ArticleExporter exporter(cfg, 4);
+	JobProgress progress;
+	const auto failed = exporter.write_files(files, progress);
+	REQUIRE(failed == std::vector<std::string>({tmp.get_path() + "/missing/dir.txt"}));
+	REQUIRE(progress.percent_done() == 100);
+
+	for (const unsigned int i : {
+			0, 1, 255, 256, 299
+		}) {
+		REQUIRE(read_file(files[i].first) ==
+			item_renderer::to_plain_text(cfg, files[i].second) + "\n");
+	}
+}
+
+TEST_CASE("ArticleExporter::write_archive() writes all articles to one file, "
+	"in order", "[ArticleExporter]")
+{
+	test_helpers::TempDir tmp;
+	const std::string path = tmp.get_path() + "/feed.jsonl";
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (unsigned int i = 0; i < 10; ++i) {
+		items.push_back(make_item(&rsscache, feed, i));
+	}
+	ArticleExporter exporter(cfg, 3);
+
+	SECTION("as JSON lines") {
+		JobProgress progress;
+		REQUIRE(exporter.write_archive(path, ArticleExporter::Archive::JSONL,
+				items, progress));
+
+		std::ifstream f(path);
+		std::string line;
+		unsigned int i = 0;
+		while (std::getline(f, line)) {
+			const auto entry = nlohmann::json::parse(line);
+			REQUIRE(entry["guid"] == "guid-" + std::to_string(i));
+			REQUIRE(entry["title"] == "Article " + std::to_string(i));
+			REQUIRE(entry["date"] == 1538336065);
+			REQUIRE(entry["text"].get<std::string>().find("Article number "
+					+ std::to_string(i)) != std::string::npos);
+			++i;
+		}
+		REQUIRE(i == items.size());
+	}
+
+	SECTION("nothing is written if it's cancelled") {
+		JobProgress progress;
+		progress.cancel();
+		REQUIRE_FALSE(exporter.write_archive(path, ArticleExporter::Archive::MBOX,
+				items, progress));
+		REQUIRE(::access(path.c_str(), F_OK) != 0);
+		REQUIRE(::access((path + ".tmp").c_str(), F_OK) != 0);
+	}
+}
+
+TEST_CASE("ArticleExporter::archive_entry() makes mboxrd messages",
+	"[ArticleExporter]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+	const auto item = make_item(&rsscache, feed, 1);
+	item->set_title("Two\nlines");
+
+	const auto entry = ArticleExporter::archive_entry(
+			ArticleExporter::Archive::MBOX, *item,
+			"First line\nFrom here on\n>From the past\n");
+	REQUIRE(entry == "From newsboat Sun Sep 30 19:34:25 2018\n"
+		"From: Ada\n"
+		"Subject: Two lines\n"
+		"Date: Sun, 30 Sep 2018 19:34:25 +0000\n"
+		"Message-ID: <guid-1>\n"
+		"X-Newsboat-Feed: \n"
+		"X-Newsboat-Link: https://example.com/1\n"
+		"MIME-Version: 1.0\n"
+		"Content-Type: text/plain; charset=UTF-8\n"
+		"Content-Transfer-Encoding: 8bit\n"
+		"\n"
+		"First line\n"
+		">From here on\n"
+		">>From the past\n"
+		"\n");
+}
@@ -0,0 +1,161 @@
+#include "articleprerenderer.h"
+
+#include <chrono>
+#include <thread>
+
+#include "3rd-party/catch.hpp"
+#include "configcontainer.h"
+#include "regexmanager.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::shared_ptr<RssItem> create_item(const std::string& title)
+{
+	auto item = std::make_shared<RssItem>(nullptr);
+	item->set_title(title);
+	item->set_description("<p>Hello, <a href=\"https://example.com/\">world</a>!</p>",
+		"text/html");
+	item->set_enclosure_url("https://example.com/episode.mp3");
+	item->set_enclosure_type("audio/mpeg");
+	return item;
+}
+
+bool wait_for(RenderCache& cache, const std::shared_ptr<RssItem>& item,
+	const RenderCache::Options& options)
+{
+	for (int i = 0; i < 500; ++i) {
+		if (cache.get(item, options).has_value()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+}
+
+TEST_CASE("ArticlePrerenderer puts the same views into the cache as the "
+	"article view renders",
+	"[ArticlePrerenderer]")
+{
+	ConfigContainer cfg;
+	RegexManager rxman;
+	rxman.handle_action("highlight", {"article", "world", "red"});
+	RenderCache cache(1024 * 1024);
+	const RenderCache::Options options{60, 65, "internal", rxman.revision()};
+
+	const auto first = create_item("First");
+	const auto second = create_item("Second");
+
+	{
+		ArticlePrerenderer prerenderer(cfg, cache);
+		prerenderer.prerender({first, second}, options, rxman);
+
+		REQUIRE(wait_for(cache, first, options));
+		REQUIRE(wait_for(cache, second, options));
+	}
+
+	for (const auto& item : {
+			first, second
+		}) {
+		const auto expected = ArticlePrerenderer::render(cfg, item, options,
+				&rxman);
+		const auto view = cache.get(item, options).value();
+		REQUIRE(view.text == expected.text);
+		REQUIRE(view.num_lines == expected.num_lines);
+		REQUIRE(view.links == expected.links);
+	}
+}
+
+TEST_CASE("ArticlePrerenderer::render() puts the enclosure link first",
+	"[ArticlePrerenderer]")
+{
+	ConfigContainer cfg;
+	RegexManager rxman;
+	const RenderCache::Options options{60, 65, "internal", rxman.revision()};
+
+	const auto rendered = ArticlePrerenderer::render(cfg, create_item("Title"),
+			options, &rxman);
+
+	REQUIRE(rendered.links.size() == 2);
+	REQUIRE(rendered.links[0] ==
+		LinkPair("https://example.com/episode.mp3", LinkType::AUDIO));
+	REQUIRE(rendered.links[1] ==
+		LinkPair("https://example.com/", LinkType::HREF));
+}
+
+TEST_CASE("ArticlePrerenderer doesn't run external HTML renderers",
+	"[ArticlePrerenderer]")
+{
+	ConfigContainer cfg;
+	RegexManager rxman;
+	RenderCache cache(1024 * 1024);
+	const RenderCache::Options options{60, 65, "cat", rxman.revision()};
+	const auto item = create_item("Title");
+
+	{
+		ArticlePrerenderer prerenderer(cfg, cache);
+		prerenderer.prerender({item}, options, rxman);
+	}
+
+	REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("ArticlePrerenderer::render() can render just the start of the body",
+	"[ArticlePrerenderer]")
+{
+	ConfigContainer cfg;
+	RegexManager rxman;
+	const RenderCache::Options options{60, 65, "internal", rxman.revision()};
+
+	auto item = std::make_shared<RssItem>(nullptr);
+	std::string description;
+	for (int i = 0; i < 100; ++i) {
+		description += "<p>Paragraph é " + std::to_string(i) + "</p>";
+	}
+	item->set_description(description, "text/html");
+
+	const auto whole = ArticlePrerenderer::render(cfg, item, options, &rxman);
+	const auto start = ArticlePrerenderer::render(cfg, item, options, &rxman,
+			description.size() / 2);
+	REQUIRE(start.num_lines < whole.num_lines);
+	REQUIRE(start.num_lines > 0);
+	REQUIRE(whole.text.compare(0, start.text.size() / 2, start.text, 0,
+			start.text.size() / 2) == 0);
+}
+
+TEST_CASE("ArticlePrerenderer::render_next() keeps the view for "
+	"take_rendered()", "[ArticlePrerenderer]")
+{
+	ConfigContainer cfg;
+	RegexManager rxman;
+	// Has no room for anything
+	RenderCache cache(0);
+	const RenderCache::Options options{60, 65, "internal", rxman.revision()};
+	const auto item = create_item("Title");
+	const auto other = create_item("Other");
+
+	ArticlePrerenderer prerenderer(cfg, cache);
+	REQUIRE_FALSE(prerenderer.take_rendered(item, options).has_value());
+
+	prerenderer.render_next(item, options, rxman);
+	nonstd::optional<RenderCache::Rendered> view;
+	for (int i = 0; i < 500 && !view.has_value(); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		REQUIRE_FALSE(prerenderer.take_rendered(other, options).has_value());
+		view = prerenderer.take_rendered(item, options);
+	}
+	REQUIRE(view.has_value());
+
+	const auto expected = ArticlePrerenderer::render(cfg, item, options, &rxman);
+	REQUIRE(view.value().text == expected.text);
+	REQUIRE(view.value().links == expected.links);
+
+	SECTION("the view is only handed out once") {
+		REQUIRE_FALSE(prerenderer.take_rendered(item, options).has_value());
+	}
+}
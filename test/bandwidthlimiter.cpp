@@ -0,0 +1,96 @@
+#include "bandwidthlimiter.h"
+
+#include <chrono>
+
+#include "3rd-party/catch.hpp"
+
+using namespace podboat;
+
+namespace {
+
+CURL* const FIRST = reinterpret_cast<CURL*>(0x1);
+CURL* const SECOND = reinterpret_cast<CURL*>(0x2);
+
+} // namespace
+
+TEST_CASE("BandwidthLimiter without a limit never pauses anything",
+	"[BandwidthLimiter]")
+{
+	BandwidthLimiter limiter;
+
+	for (int i = 0; i < 100; ++i) {
+		REQUIRE(limiter.take(FIRST, 1024 * 1024));
+	}
+	REQUIRE_FALSE(limiter.has_paused());
+}
+
+TEST_CASE("BandwidthLimiter pauses transfers once a second's worth of data arrived",
+	"[BandwidthLimiter]")
+{
+	BandwidthLimiter limiter(1000);
+
+	REQUIRE(limiter.take(FIRST, 600));
+	// The bucket goes into debt for the last chunk
+	REQUIRE(limiter.take(SECOND, 600));
+	REQUIRE_FALSE(limiter.take(FIRST, 100));
+	REQUIRE_FALSE(limiter.take(SECOND, 100));
+	REQUIRE_FALSE(limiter.take(FIRST, 100));
+	REQUIRE(limiter.has_paused());
+
+	SECTION("the paused transfers go on once the debt is paid off") {
+		const auto start = BandwidthLimiter::Clock::now();
+		REQUIRE(limiter.resumable(start).empty());
+
+		const auto resumed = limiter.resumable(start + std::chrono::milliseconds(300));
+		REQUIRE(resumed.size() == 2);
+		REQUIRE(resumed[0] == FIRST);
+		REQUIRE(resumed[1] == SECOND);
+		REQUIRE_FALSE(limiter.has_paused());
+	}
+
+	SECTION("forgotten transfers aren't resumed") {
+		limiter.forget(FIRST);
+
+		const auto later = BandwidthLimiter::Clock::now() + std::chrono::seconds(1);
+		const auto resumed = limiter.resumable(later);
+		REQUIRE(resumed.size() == 1);
+		REQUIRE(resumed[0] == SECOND);
+	}
+}
+
+TEST_CASE("BandwidthLimiter doesn't save up more than a second's worth",
+	"[BandwidthLimiter]")
+{
+	BandwidthLimiter limiter(1000);
+
+	const auto later = BandwidthLimiter::Clock::now() + std::chrono::seconds(10);
+	limiter.resumable(later);
+
+	REQUIRE(limiter.take(FIRST, 1000));
+	REQUIRE_FALSE(limiter.take(FIRST, 1));
+}
+
+TEST_CASE("BandwidthLimiter lets paused transfers go on once the limit is removed",
+	"[BandwidthLimiter]")
+{
+	BandwidthLimiter limiter(10);
+
+	REQUIRE(limiter.take(FIRST, 100));
+	REQUIRE_FALSE(limiter.take(FIRST, 100));
+
+	limiter.set_limit(0);
+
+	REQUIRE(limiter.resumable(BandwidthLimiter::Clock::now()).size() == 1);
+	REQUIRE(limiter.take(FIRST, 100));
+}
+
+TEST_CASE("BandwidthLimiter starts a newly set limit with a second's worth",
+	"[BandwidthLimiter]")
+{
+	BandwidthLimiter limiter;
+
+	limiter.set_limit(1000);
+
+	REQUIRE(limiter.take(FIRST, 1000));
+	REQUIRE_FALSE(limiter.take(FIRST, 1));
+}
@@ -0,0 +1,49 @@
+#include "bloomfilter.h"
+
+#include <string>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("BloomFilter contains everything that was added to it",
+	"[BloomFilter]")
+{
+	BloomFilter filter(1000);
+	REQUIRE(filter.capacity() == 1000);
+	REQUIRE_FALSE(filter.may_contain("guid-0"));
+
+	for (unsigned int i = 0; i < 1000; ++i) {
+		filter.add("guid-" + std::to_string(i));
+	}
+	REQUIRE(filter.size() == 1000);
+	for (unsigned int i = 0; i < 1000; ++i) {
+		REQUIRE(filter.may_contain("guid-" + std::to_string(i)));
+	}
+}
+
+TEST_CASE("BloomFilter is rarely wrong about strings that weren't added to "
+	"it, while it's within its capacity", "[BloomFilter]")
+{
+	BloomFilter filter(10000);
+	for (unsigned int i = 0; i < 10000; ++i) {
+		filter.add("http://example.com/article/" + std::to_string(i));
+	}
+
+	unsigned int false_positives = 0;
+	for (unsigned int i = 10000; i < 20000; ++i) {
+		if (filter.may_contain("http://example.com/article/" + std::to_string(i))) {
+			++false_positives;
+		}
+	}
+	// About 1% is expected
+	REQUIRE(false_positives < 300);
+}
+
+TEST_CASE("An empty BloomFilter contains nothing", "[BloomFilter]")
+{
+	const BloomFilter filter;
+	REQUIRE(filter.size() == 0);
+	REQUIRE_FALSE(filter.may_contain(""));
+	REQUIRE_FALSE(filter.may_contain("guid"));
+}
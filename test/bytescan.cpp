@@ -0,0 +1,194 @@
+#include "bytescan.h"
+
+#include <string>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+std::size_t find_first_of(const std::string& text, const char* chars)
+{
+	return bytescan::find_first_of(text.data(), text.size(), chars);
+}
+
+std::size_t find_soft_hyphen(const std::string& text)
+{
+	return bytescan::find_soft_hyphen(text.data(), text.size());
+}
+
+bool is_consolidated(const std::string& text)
+{
+	return bytescan::is_consolidated(text.data(), text.size());
+}
+
+}
+
+TEST_CASE("bytescan::find_first_of() finds the first of the given bytes",
+	"[bytescan]")
+{
+	REQUIRE(find_first_of("", " \t") == std::string::npos);
+	REQUIRE(find_first_of("abc", "") == std::string::npos);
+	REQUIRE(find_first_of("name=value", "= ") == 4);
+	REQUIRE(find_first_of("attribute-that-is-long value", "= ") == 22);
+	REQUIRE(find_first_of("no-such-bytes-in-here", "= ") == std::string::npos);
+
+	SECTION("NUL in the text isn't matched by the end of the set") {
+		REQUIRE(find_first_of(std::string("a\0b\0c d", 7), " ") == 5);
+	}
+
+	SECTION("finds the byte at any position, in the 8-byte words and the "
+		"tail") {
+		for (std::size_t length = 1; length <= 19; ++length) {
+			for (std::size_t position = 0; position < length; ++position) {
+				std::string text(length, 'x');
+				text[position] = '\n';
+				if (position + 1 < length) {
+					text[position + 1] = ' ';
+				}
+				INFO("length " << length << ", position " << position);
+				REQUIRE(find_first_of(text, " \r\n\t") == position);
+			}
+		}
+	}
+}
+
+TEST_CASE("bytescan::is_ascii() is false if any byte has its top bit set",
+	"[bytescan]")
+{
+	REQUIRE(bytescan::is_ascii("", 0));
+
+	for (std::size_t length = 1; length <= 19; ++length) {
+		for (std::size_t position = 0; position < length; ++position) {
+			std::string text(length, '\x7f');
+			INFO("length " << length << ", position " << position);
+			REQUIRE(bytescan::is_ascii(text.data(), text.size()));
+			text[position] = '\x80';
+			REQUIRE_FALSE(bytescan::is_ascii(text.data(), text.size()));
+		}
+	}
+}
+
+TEST_CASE("bytescan::is_valid_utf8() checks UTF-8 as RFC 3629 defines it",
+	"[bytescan]")
+{
+	const auto is_valid = [](const std::string& text) {
+		return bytescan::is_valid_utf8(text.data(), text.size());
+	};
+
+	REQUIRE(is_valid(""));
+	REQUIRE(is_valid("plain ASCII text that is longer than a word"));
+	REQUIRE(is_valid(std::string("\0", 1)));
+	REQUIRE(is_valid("\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82"));
+	REQUIRE(is_valid("\xc2\x80"));
+	REQUIRE(is_valid("\xe0\xa0\x80"));
+	REQUIRE(is_valid("\xed\x9f\xbf"));
+	REQUIRE(is_valid("\xef\xbf\xbf"));
+	REQUIRE(is_valid("\xf0\x90\x80\x80"));
+	REQUIRE(is_valid("\xf4\x8f\xbf\xbf"));
+
+	// Stray continuation bytes and bytes that never appear
+	REQUIRE_FALSE(is_valid("\x80"));
+	REQUIRE_FALSE(is_valid("abcdefgh\xbf"));
+	REQUIRE_FALSE(is_valid("\xff"));
+	// Overlong encodings
+	REQUIRE_FALSE(is_valid("\xc0\xaf"));
+	REQUIRE_FALSE(is_valid("\xc1\xbf"));
+	REQUIRE_FALSE(is_valid("\xe0\x9f\xbf"));
+	REQUIRE_FALSE(is_valid("\xf0\x8f\xbf\xbf"));
+	// Surrogates and code points past U+10FFFF
+	REQUIRE_FALSE(is_valid("\xed\xa0\x80"));
+	REQUIRE_FALSE(is_valid("\xf4\x90\x80\x80"));
+	REQUIRE_FALSE(is_valid("\xf5\x80\x80\x80"));
+	// Truncated sequences
+	REQUIRE_FALSE(is_valid("\xd0"));
+	REQUIRE_FALSE(is_valid("\xe2\x80"));
+	REQUIRE_FALSE(is_valid("abcdefgh\xf0\x90\x80"));
+	REQUIRE_FALSE(is_valid("\xe2\x80z"));
+}
+
+TEST_CASE("bytescan::find_soft_hyphen() finds U+00AD", "[bytescan]")
+{
+	REQUIRE(find_soft_hyphen("") == std::string::npos);
+	REQUIRE(find_soft_hyphen("hyphen") == std::string::npos);
+	REQUIRE(find_soft_hyphen("hy\xC2\xADphen") == 2);
+	// U+00A0 and U+00C2 share the first byte, U+0100 has 0xAD in second place
+	REQUIRE(find_soft_hyphen("\xC2\xA0\xC3\x82\xC4\xAD\xC2\xAD") == 6);
+	// Only the first byte of the sequence
+	REQUIRE(find_soft_hyphen("hyphen\xC2") == std::string::npos);
+}
+
+TEST_CASE("bytescan::is_printable_ascii() is true only if every byte is in "
+	"' ' to '~'",
+	"[bytescan]")
+{
+	REQUIRE(bytescan::is_printable_ascii("", 0));
+
+	for (std::size_t length = 1; length <= 19; ++length) {
+		for (std::size_t position = 0; position < length; ++position) {
+			for (int byte = 0; byte < 256; ++byte) {
+				std::string text(length, 'x');
+				text[position] = static_cast<char>(byte);
+				const bool printable = byte >= 0x20 && byte <= 0x7e;
+				if (bytescan::is_printable_ascii(text.data(), text.size())
+					!= printable) {
+					FAIL("length " << length << ", byte " << byte
+						<< " at position " << position);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("bytescan::is_consolidated() is true for text that "
+	"consolidate_whitespace() wouldn't change",
+	"[bytescan]")
+{
+	REQUIRE(is_consolidated(""));
+	REQUIRE(is_consolidated("word"));
+	REQUIRE(is_consolidated("a few words separated by single spaces"));
+	REQUIRE(is_consolidated("   leading spaces are kept"));
+	REQUIRE(is_consolidated("a trailing space is kept "));
+	// "Привет, мир", "Hello, world" in Russian
+	REQUIRE(is_consolidated("\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, "
+			"\xd0\xbc\xd0\xb8\xd1\x80"));
+
+	REQUIRE_FALSE(is_consolidated(" "));
+	REQUIRE_FALSE(is_consolidated("    "));
+	REQUIRE_FALSE(is_consolidated("two  spaces"));
+	REQUIRE_FALSE(is_consolidated("trailing spaces  "));
+	REQUIRE_FALSE(is_consolidated("a\ttab"));
+	REQUIRE_FALSE(is_consolidated("\tleading tab"));
+	REQUIRE_FALSE(is_consolidated("a\nnewline"));
+	REQUIRE_FALSE(is_consolidated("a\rcarriage return"));
+	REQUIRE_FALSE(is_consolidated("no-break\xC2\xA0space"));
+	REQUIRE_FALSE(is_consolidated("ideographic\xE3\x80\x80space"));
+
+	SECTION("finds two spaces in a row anywhere, within and across 8-byte "
+		"words") {
+		for (std::size_t length = 3; length <= 27; ++length) {
+			for (std::size_t position = 1; position + 1 < length; ++position) {
+				std::string text(length, 'x');
+				text[position] = ' ';
+				text[position + 1] = ' ';
+				INFO("length " << length << ", position " << position);
+				REQUIRE_FALSE(is_consolidated(text));
+
+				text[position + 1] = 'x';
+				REQUIRE(is_consolidated(text));
+			}
+		}
+	}
+
+	SECTION("finds a tab anywhere") {
+		for (std::size_t length = 2; length <= 27; ++length) {
+			for (std::size_t position = 1; position < length; ++position) {
+				std::string text(length, 'x');
+				text[position] = '\t';
+				INFO("length " << length << ", position " << position);
+				REQUIRE_FALSE(is_consolidated(text));
+			}
+		}
+	}
+}
@@ -1,9 +1,14 @@
 #include "cache.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
+#include <stdexcept>
 
 #include "3rd-party/catch.hpp"
 #include "configcontainer.h"
+#include "dbexception.h"
+#include "jobprogress.h"
 #include "rssfeed.h"
 #include "rssignores.h"
 #include "rssparser.h"
@@ -75,6 +80,34 @@ TEST_CASE("Cleaning old articles works", "[Cache]")
 	REQUIRE(feed->items().size() == 1);
 }
 
+TEST_CASE("Cleaning old articles deletes more of them than fit in a batch",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	std::unique_ptr<ConfigContainer> cfg(new ConfigContainer());
+	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), cfg.get()));
+	const std::string feedurl = "http://example.com/feed.xml";
+	auto feed = std::make_shared<RssFeed>(rsscache.get(), feedurl);
+	for (int i = 0; i < 2500; ++i) {
+		auto item = std::make_shared<RssItem>(rsscache.get());
+		item->set_guid("old-" + std::to_string(i));
+		item->set_pubDate(1000000000 + i);
+		feed->add_item(item);
+	}
+	auto item = std::make_shared<RssItem>(rsscache.get());
+	item->set_guid("new");
+	item->set_pubDate(time(nullptr));
+	feed->add_item(item);
+	rsscache->externalize_rssfeed(feed, false);
+
+	cfg.reset(new ConfigContainer());
+	cfg->set_configvalue("keep-articles-days", "42");
+	rsscache.reset(new Cache(dbfile.get_path(), cfg.get()));
+	feed = rsscache->internalize_rssfeed(feedurl, nullptr);
+	REQUIRE(feed->items().size() == 1);
+	REQUIRE(feed->items()[0]->guid() == "new");
+}
+
 TEST_CASE("Last-Modified and ETag values are persisted to DB", "[Cache]")
 {
 	std::unique_ptr<ConfigContainer> cfg(new ConfigContainer());
@@ -124,6 +157,282 @@ TEST_CASE("Last-Modified and ETag values are persisted to DB", "[Cache]")
 	}
 }
 
+TEST_CASE("update_download_times() averages the new times with the stored "
+	"ones", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	REQUIRE(rsscache.fetch_download_times().empty());
+
+	rsscache.update_download_times({
+		{feedurl, 3000},
+		{"http://example.com/unknown", 10}
+	});
+	auto times = rsscache.fetch_download_times();
+	REQUIRE(times.size() == 1);
+	REQUIRE(times[feedurl] == 3000);
+
+	rsscache.update_download_times({{feedurl, 1000}});
+	times = rsscache.fetch_download_times();
+	REQUIRE(times[feedurl] == 2000);
+}
+
+TEST_CASE("fetch_read_counts() counts the read articles published since "
+	"the given time", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	const auto feed = parser.parse();
+	rsscache.externalize_rssfeed(feed, false);
+
+	REQUIRE(rsscache.fetch_read_counts(0).empty());
+
+	feed->items()[0]->set_unread(false);
+	feed->items()[1]->set_unread(false);
+	auto counts = rsscache.fetch_read_counts(0);
+	REQUIRE(counts.size() == 1);
+	REQUIRE(counts[feedurl] == 2);
+
+	const time_t newest = std::max(feed->items()[0]->pubDate_timestamp(),
+			feed->items()[1]->pubDate_timestamp());
+	REQUIRE(rsscache.fetch_read_counts(newest + 1).empty());
+}
+
+TEST_CASE("externalize_rssfeed() returns how many articles are new",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssParser parser("file://data/rss.xml", &rsscache, &cfg, nullptr);
+	const auto feed = parser.parse();
+	REQUIRE(feed->total_item_count() > 0);
+
+	REQUIRE(rsscache.externalize_rssfeed(feed, false) ==
+		feed->total_item_count());
+	REQUIRE(rsscache.externalize_rssfeed(feed, false) == 0);
+
+	feed->items()[0]->set_title("A different title");
+	REQUIRE(rsscache.externalize_rssfeed(feed, false) == 0);
+}
+
+TEST_CASE("fetch_unread_guids() lists the unread articles of each feed",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	REQUIRE(feed->total_item_count() > 1);
+	auto guids = rsscache.fetch_unread_guids();
+	REQUIRE(guids.size() == 1);
+	REQUIRE(guids[feedurl].size() == feed->total_item_count());
+
+	const auto read = feed->items()[0];
+	read->set_unread(false);
+	guids = rsscache.fetch_unread_guids();
+	REQUIRE(guids[feedurl].size() == feed->total_item_count() - 1);
+	REQUIRE(std::find(guids[feedurl].begin(), guids[feedurl].end(),
+			read->guid()) == guids[feedurl].end());
+
+	rsscache.mark_all_read(feedurl);
+	REQUIRE(rsscache.fetch_unread_guids().empty());
+}
+
+TEST_CASE("update_next_checks() stores when to check the feeds next",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	REQUIRE(rsscache.fetch_next_checks().empty());
+
+	rsscache.update_next_checks({
+		{feedurl, 1500000000},
+		{"http://example.com/unknown", 10}
+	});
+	auto next_checks = rsscache.fetch_next_checks();
+	REQUIRE(next_checks.size() == 1);
+	REQUIRE(next_checks[feedurl] == 1500000000);
+
+	rsscache.update_next_checks({{feedurl, 0}});
+	REQUIRE(rsscache.fetch_next_checks().empty());
+}
+
+TEST_CASE("update_failures() stores how the feeds have been failing",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	REQUIRE(rsscache.fetch_failures().empty());
+
+	FeedFailures failures;
+	failures.count = 3;
+	failures.retry_at = 1500000000;
+	failures.gone = true;
+	rsscache.update_failures({
+		{feedurl, failures},
+		{"http://example.com/unknown", failures}
+	});
+	auto stored = rsscache.fetch_failures();
+	REQUIRE(stored.size() == 1);
+	REQUIRE(stored[feedurl].count == 3);
+	REQUIRE(stored[feedurl].retry_at == 1500000000);
+	REQUIRE(stored[feedurl].gone);
+
+	rsscache.update_failures({{feedurl, FeedFailures()}});
+	REQUIRE(rsscache.fetch_failures().empty());
+}
+
+TEST_CASE("update_body_hash() stores the hash of the feed's last body",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	REQUIRE(rsscache.fetch_body_hash(feedurl) == 0);
+
+	// Needs all 64 bits, which SQLite stores as a negative number
+	const std::uint64_t hash = 0xcbf29ce484222325ULL;
+	rsscache.update_body_hash(feedurl, hash);
+	rsscache.update_body_hash("http://example.com/unknown", 42);
+	REQUIRE(rsscache.fetch_body_hash(feedurl) == hash);
+	REQUIRE(rsscache.fetch_body_hash("http://example.com/unknown") == 0);
+}
+
+TEST_CASE("update_moved_url() stores where the feed moved to", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	std::string url = "left over";
+	time_t since = 1;
+	rsscache.fetch_moved_url(feedurl, url, since);
+	REQUIRE(url.empty());
+	REQUIRE(since == 0);
+
+	rsscache.update_moved_url(feedurl, "https://example.com/new.xml", 1000);
+	rsscache.fetch_moved_url(feedurl, url, since);
+	REQUIRE(url == "https://example.com/new.xml");
+	REQUIRE(since == 1000);
+
+	SECTION("it's kept in memory between preload_validators() and "
+		"flush_validators()") {
+		rsscache.preload_validators();
+		rsscache.fetch_moved_url(feedurl, url, since);
+		REQUIRE(url == "https://example.com/new.xml");
+
+		rsscache.update_moved_url(feedurl, "https://example.org/newer.xml", 2000);
+		rsscache.fetch_moved_url(feedurl, url, since);
+		REQUIRE(url == "https://example.org/newer.xml");
+		REQUIRE(since == 2000);
+
+		rsscache.flush_validators();
+		rsscache.fetch_moved_url(feedurl, url, since);
+		REQUIRE(url == "https://example.org/newer.xml");
+		REQUIRE(since == 2000);
+	}
+
+	SECTION("an empty URL forgets the move") {
+		rsscache.update_moved_url(feedurl, "", 3000);
+		rsscache.fetch_moved_url(feedurl, url, since);
+		REQUIRE(url.empty());
+		REQUIRE(since == 0);
+	}
+}
+
+TEST_CASE("Between preload_validators() and flush_validators(), updates of "
+	"the validators are kept in memory", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+	rsscache.update_lastmodified(feedurl, 1000, "first");
+
+	rsscache.preload_validators();
+
+	time_t last_modified = 0;
+	std::string etag;
+	rsscache.fetch_lastmodified(feedurl, last_modified, etag);
+	REQUIRE(last_modified == 1000);
+	REQUIRE(etag == "first");
+	rsscache.fetch_lastmodified("http://example.com/unknown", last_modified, etag);
+	REQUIRE(last_modified == 0);
+	REQUIRE(etag.empty());
+
+	// 0 leaves the time as it is
+	rsscache.update_lastmodified(feedurl, 0, "second");
+	rsscache.update_body_hash(feedurl, 42);
+	rsscache.fetch_lastmodified(feedurl, last_modified, etag);
+	REQUIRE(last_modified == 1000);
+	REQUIRE(etag == "second");
+	REQUIRE(rsscache.fetch_body_hash(feedurl) == 42);
+
+	rsscache.flush_validators();
+
+	rsscache.fetch_lastmodified(feedurl, last_modified, etag);
+	REQUIRE(last_modified == 1000);
+	REQUIRE(etag == "second");
+	REQUIRE(rsscache.fetch_body_hash(feedurl) == 42);
+
+	// Back to writing them right away
+	rsscache.update_lastmodified(feedurl, 2000, "");
+	rsscache.fetch_lastmodified(feedurl, last_modified, etag);
+	REQUIRE(last_modified == 2000);
+	REQUIRE(etag == "second");
+}
+
+TEST_CASE("estimate_update_interval() averages the time between the latest "
+	"articles", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "http://example.com/feed.xml";
+	auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+
+	const auto add_item = [&](const std::string& guid, time_t pubDate) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(guid);
+		item->set_feedurl(feedurl);
+		item->set_pubDate(pubDate);
+		feed->add_item(item);
+	};
+
+	add_item("first", 1000000);
+	rsscache.externalize_rssfeed(feed, false);
+	REQUIRE(rsscache.estimate_update_interval(feedurl) == 0);
+
+	add_item("second", 1000000 + 3600);
+	add_item("third", 1000000 + 3 * 3600);
+	rsscache.externalize_rssfeed(feed, false);
+	REQUIRE(rsscache.estimate_update_interval(feedurl) == 3 * 3600 / 2);
+
+	REQUIRE(rsscache.estimate_update_interval("http://example.com/none") == 0);
+}
+
 TEST_CASE("mark_all_read marks all items in the feed read", "[Cache]")
 {
 	std::shared_ptr<RssFeed> feed, test_feed;
@@ -263,6 +572,15 @@ TEST_CASE(
 		}
 	}
 
+	SECTION("cleanup-on-quit set to \"no\" returns the feeds that are no "
+		"longer configured") {
+		cfg->set_configvalue("cleanup-on-quit", "no");
+		feeds.erase(feeds.cbegin(), feeds.cbegin() + 1);
+
+		const auto unreachable = rsscache->cleanup_cache(feeds);
+		REQUIRE(unreachable == std::vector<std::string> {feedurls[0]});
+	}
+
 	SECTION("cleanup-on-quit set to \"yes\"") {
 		cfg->set_configvalue("cleanup-on-quit", "yes");
 
@@ -484,6 +802,78 @@ TEST_CASE("mark_items_read_by_guid marks items with given GUIDs as unread ",
 	}
 }
 
+TEST_CASE("sync_unread_by_guid makes the articles of the given feeds unread "
+	"exactly if they're listed, unless a change to them is queued",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	std::shared_ptr<RssFeed> feed = parser.parse();
+	REQUIRE(feed->unread_item_count() == 8);
+	rsscache.externalize_rssfeed(feed, false);
+
+	const auto guid = [&](unsigned int index) {
+		return feed->items()[index]->guid();
+	};
+	rsscache.mark_items_read_by_guid({guid(0), guid(1)});
+
+	SECTION("listed articles become unread, the others read") {
+		rsscache.sync_unread_by_guid({feedurl}, {guid(0), guid(2), "elsewhere"});
+
+		const auto read = rsscache.get_read_item_guids();
+		REQUIRE(read.size() == 6);
+		REQUIRE(std::find(read.begin(), read.end(), guid(0)) == read.end());
+		REQUIRE(std::find(read.begin(), read.end(), guid(2)) == read.end());
+		REQUIRE(std::find(read.begin(), read.end(), guid(1)) != read.end());
+	}
+
+	SECTION("queued changes win") {
+		rsscache.queue_remote_read(guid(0), true);
+		rsscache.queue_remote_read(guid(3), false);
+		rsscache.sync_unread_by_guid({feedurl}, {});
+
+		const auto read = rsscache.get_read_item_guids();
+		REQUIRE(read.size() == 7);
+		REQUIRE(std::find(read.begin(), read.end(), guid(3)) == read.end());
+	}
+
+	SECTION("other feeds are left alone") {
+		rsscache.sync_unread_by_guid({"https://example.com/feed.xml"}, {});
+
+		REQUIRE(rsscache.get_read_item_guids().size() == 2);
+	}
+}
+
+TEST_CASE("queue_remote_reads queues each article like queue_remote_read",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	rsscache.queue_remote_flags("a", "", "s");
+	rsscache.queue_remote_read("b", true);
+	rsscache.queue_remote_reads({"a", "b", "c"}, false);
+	rsscache.queue_remote_reads({}, true);
+
+	auto entries = rsscache.fetch_remote_outbox(10);
+	REQUIRE(entries.size() == 3);
+	std::sort(entries.begin(), entries.end(),
+	[](const OutboxEntry& a, const OutboxEntry& b) {
+		return a.guid < b.guid;
+	});
+	for (const auto& entry : entries) {
+		INFO("Checking " << entry.guid);
+		REQUIRE(entry.has_read);
+		REQUIRE_FALSE(entry.read);
+	}
+	REQUIRE(entries[0].has_flags);
+	REQUIRE(entries[0].flags == "s");
+	REQUIRE(entries[1].revision > 0);
+	REQUIRE_FALSE(entries[2].has_flags);
+}
+
 TEST_CASE(
 	"remove_old_deleted_items removes deleted items that belong to the given "
 	"feed, but aren't mentioned in the given RssFeed object",
@@ -572,6 +962,71 @@ TEST_CASE("search_for_items finds all items with matching title or content",
 	}
 }
 
+TEST_CASE("Searches and content filters match the text of articles rather "
+	"than their markup", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "http://example.com/feed.xml";
+	const auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+	const auto item = std::make_shared<RssItem>(&rsscache);
+	item->set_guid("html");
+	item->set_title("Menu");
+	item->set_feedurl(feedurl);
+	item->set_description("<p class=\"special\">fish &amp; <b>chips</b></p>"
+		"<p>today</p>", "text/html");
+	feed->add_item(item);
+	rsscache.externalize_rssfeed(feed, false);
+
+	RssIgnores ign;
+	REQUIRE(rsscache.search_for_items("fish & chips", "", ign).size() == 1);
+	REQUIRE(rsscache.search_for_items("chips today", "", ign).size() == 1);
+	REQUIRE(rsscache.search_for_items("special", "", ign).empty());
+	REQUIRE(rsscache.search_in_items("class=", {"html"}).empty());
+
+	const auto stored = rsscache.internalize_rssfeed(feedurl, nullptr);
+	REQUIRE(stored->total_item_count() == 1);
+	REQUIRE(rsscache.fetch_content_text(*stored->items()[0])
+		== "fish & chips today");
+	REQUIRE(rsscache.fetch_description(*stored->items()[0])
+		== "<p class=\"special\">fish &amp; <b>chips</b></p><p>today</p>");
+}
+
+TEST_CASE("search_for_items and search_in_items give up once their job is "
+	"cancelled", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "http://example.com/feed.xml";
+	const auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+	std::unordered_set<std::string> guids;
+	for (int i = 0; i < 2000; ++i) {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("guid-" + std::to_string(i));
+		item->set_title("Article " + std::to_string(i));
+		item->set_feedurl(feedurl);
+		feed->add_item(item);
+		guids.insert(item->guid());
+	}
+	rsscache.externalize_rssfeed(feed, false);
+
+	RssIgnores ign;
+	JobProgress progress;
+	REQUIRE(rsscache.search_for_items("Article", "", ign, &progress).size()
+		== 2000);
+
+	progress.cancel();
+	REQUIRE_THROWS_AS(rsscache.search_for_items("Article", "", ign, &progress),
+		DbException);
+	REQUIRE_THROWS_AS(rsscache.search_in_items("Article", guids, &progress),
+		DbException);
+
+	SECTION("the cache works as before afterwards") {
+		REQUIRE(rsscache.search_for_items("Article 1999", "", ign).size() == 1);
+		REQUIRE(rsscache.search_in_items("Article", guids).size() == 2000);
+	}
+}
+
 TEST_CASE("update_rssitem_flags dumps `rss_item` object's flags to DB",
 	"[Cache]")
 {
@@ -730,6 +1185,150 @@ TEST_CASE(
 	}
 }
 
+TEST_CASE("externalize_rssfeed stores quotes and percent signs verbatim",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	const std::string feedurl = "http://example.com/it's%s.xml";
+	auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+	feed->set_title("Bobby's \"feed\" 100%");
+
+	auto item = std::make_shared<RssItem>(&rsscache);
+	item->set_guid("guid with ' and %q");
+	item->set_title("Don't panic; 50% off");
+	item->set_description("<p>'quoted' \"text\" %d%%</p>", "text/html");
+	item->set_feedurl(feedurl);
+	feed->add_item(item);
+
+	rsscache.externalize_rssfeed(feed, false);
+	// Run it twice, so the second pass goes through the UPDATE statements
+	rsscache.externalize_rssfeed(feed, false);
+
+	const auto restored = rsscache.internalize_rssfeed(feedurl, nullptr);
+	REQUIRE(restored->title_raw() == "Bobby's \"feed\" 100%");
+	REQUIRE(restored->total_item_count() == 1);
+
+	const auto restored_item = restored->items()[0];
+	REQUIRE(restored_item->guid() == "guid with ' and %q");
+	REQUIRE(restored_item->title() == "Don't panic; 50% off");
+	REQUIRE(rsscache.fetch_description(*restored_item) ==
+		"<p>'quoted' \"text\" %d%%</p>");
+}
+
+TEST_CASE("Writes made inside nested ScopeTransactions are committed when "
+	"the outermost one ends",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), &cfg));
+
+	const std::vector<std::string> feedurls = {
+		"file://data/rss.xml",
+		"file://data/atom10_1.xml",
+	};
+
+	{
+		ScopeTransaction outer(*rsscache);
+		for (const auto& feedurl : feedurls) {
+			ScopeTransaction inner(*rsscache);
+			RssParser parser(feedurl, rsscache.get(), &cfg, nullptr);
+			rsscache->externalize_rssfeed(parser.parse(), false);
+		}
+	}
+
+	rsscache.reset(new Cache(dbfile.get_path(), &cfg));
+	for (const auto& feedurl : feedurls) {
+		const auto feed = rsscache->internalize_rssfeed(feedurl, nullptr);
+		REQUIRE(feed->total_item_count() > 0);
+	}
+}
+
+TEST_CASE("A ScopeTransaction that ends with an exception undoes what was "
+	"written during it",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), &cfg));
+
+	const auto kept = "file://data/rss.xml";
+	const auto undone = "file://data/atom10_1.xml";
+	const auto store = [&](const std::string& feedurl) {
+		RssParser parser(feedurl, rsscache.get(), &cfg, nullptr);
+		rsscache->externalize_rssfeed(parser.parse(), false);
+	};
+
+	SECTION("a nested one only undoes its own writes") {
+		ScopeTransaction outer(*rsscache);
+		store(kept);
+		try {
+			ScopeTransaction inner(*rsscache);
+			store(undone);
+			throw std::runtime_error("failed");
+		} catch (const std::runtime_error&) {
+		}
+	}
+
+	SECTION("the outermost one undoes all of them") {
+		store(kept);
+		try {
+			ScopeTransaction outer(*rsscache);
+			rsscache->mark_all_read(kept);
+			store(undone);
+			throw std::runtime_error("failed");
+		} catch (const std::runtime_error&) {
+		}
+	}
+
+	rsscache.reset(new Cache(dbfile.get_path(), &cfg));
+	const auto feed = rsscache->internalize_rssfeed(kept, nullptr);
+	REQUIRE(feed->total_item_count() == 8);
+	REQUIRE(feed->unread_item_count() > 0);
+	REQUIRE(rsscache->internalize_rssfeed(undone, nullptr)->total_item_count()
+		== 0);
+}
+
+TEST_CASE("With `cache-wal` enabled, reads see feeds written earlier and "
+	"uncommitted writes of the same thread",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	cfg.set_configvalue("cache-wal", "yes");
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	auto feed = parser.parse();
+	REQUIRE(feed->total_item_count() == 8);
+
+	SECTION("after the write is committed") {
+		rsscache.externalize_rssfeed(feed, false);
+
+		const auto stored = rsscache.internalize_rssfeed(feedurl, nullptr);
+		REQUIRE(stored->total_item_count() == 8);
+
+		const auto guid = stored->items()[0]->guid();
+		REQUIRE(rsscache.fetch_description(*stored->items()[0])
+			== feed->get_item_by_guid(guid)->description().text);
+
+		RssIgnores ign;
+		REQUIRE(rsscache.search_for_items("Botox", feedurl, ign).size()
+			== 1);
+	}
+
+	SECTION("inside a transaction on the same thread") {
+		ScopeTransaction transaction(rsscache);
+		rsscache.externalize_rssfeed(feed, false);
+
+		const auto stored = rsscache.internalize_rssfeed(feedurl, nullptr);
+		REQUIRE(stored->total_item_count() == 8);
+	}
+}
+
 TEST_CASE("externalize_rssfeed doesn't store more than `max-items` items",
 	"[Cache]")
 {
@@ -737,11 +1336,12 @@ TEST_CASE("externalize_rssfeed doesn't store more than `max-items` items",
 	std::unique_ptr<ConfigContainer> cfg(new ConfigContainer());
 	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), cfg.get()));
 
-	cfg->set_configvalue("max-items", "3");
 	const auto feedurl = "file://data/rss.xml";
 	RssParser parser(feedurl, rsscache.get(), cfg.get(), nullptr);
 	auto feed = parser.parse();
 	REQUIRE(feed->total_item_count() == 8);
+	// Set only now, since RssParser doesn't parse beyond it either
+	cfg->set_configvalue("max-items", "3");
 	rsscache->externalize_rssfeed(feed, false);
 
 	cfg.reset(new ConfigContainer());
@@ -750,6 +1350,31 @@ TEST_CASE("externalize_rssfeed doesn't store more than `max-items` items",
 	REQUIRE(feed->total_item_count() == 3);
 }
 
+TEST_CASE("RssParser parses only the first `max-items` items, which are the "
+	"ones externalize_rssfeed would store", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feedurl = "file://data/rss.xml";
+
+	RssParser all_parser(feedurl, &rsscache, &cfg, nullptr);
+	const auto all = all_parser.parse();
+
+	cfg.set_configvalue("max-items", "3");
+	for (const std::string parser_type : {
+			"streaming", "tree"
+		}) {
+		INFO("feed-parser " << parser_type);
+		cfg.set_configvalue("feed-parser", parser_type);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		const auto feed = parser.parse();
+		REQUIRE(feed->total_item_count() == 3);
+		for (unsigned int i = 0; i < 3; ++i) {
+			REQUIRE(feed->items()[i]->guid() == all->items()[i]->guid());
+		}
+	}
+}
+
 TEST_CASE("externalize_rssfeed does nothing if it's passed a query feed",
 	"[Cache]")
 {
@@ -906,25 +1531,241 @@ TEST_CASE(
 	}
 }
 
-TEST_CASE(
-	"externalize_rssfeed does not create an entry in rss_feed table "
-	"when passed a query feed",
+TEST_CASE("merge_rssfeed returns the feed that internalize_rssfeed would "
+	"read back after externalize_rssfeed",
 	"[Cache]")
 {
-	test_helpers::TempFile dbfile;
 	ConfigContainer cfg;
-	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), &cfg));
+	const std::string feedurl = "http://example.com/feed.xml";
+	RssIgnores ign;
+	ign.handle_action("ignore-article", {"*", "title =~ \"ignored\""});
+
+	const auto make_item = [&](Cache& rsscache, const std::string& guid,
+	const std::string& title, time_t pubDate) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(guid);
+		item->set_title(title);
+		item->set_link("http://example.com/" + guid);
+		item->set_description("<p>" + title + "</p>", "text/html");
+		item->set_pubDate(pubDate);
+		item->set_feedurl(feedurl);
+		return item;
+	};
 
-	auto feed = std::make_shared<RssFeed>(rsscache.get(),
-			"query:All unread:unread = \"yes\"");
+	// Stores the feed as it was, and then reads it back like the feed
+	// list would
+	const auto old_feed = [&](Cache& rsscache) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		feed->set_title("Feed");
+		feed->add_item(make_item(rsscache, "kept", "Kept", 1000));
+		feed->add_item(make_item(rsscache, "read", "Read", 1100));
+		feed->add_item(make_item(rsscache, "flagged", "Flagged", 1200));
+		feed->add_item(make_item(rsscache, "deleted", "Deleted", 1300));
+		feed->add_item(make_item(rsscache, "hidden", "An ignored one", 1400));
+		feed->add_item(make_item(rsscache, "gone", "Not in the feed anymore",
+				900));
+		rsscache.externalize_rssfeed(feed, false);
 
-	REQUIRE_NOTHROW(rsscache->externalize_rssfeed(feed, false));
+		auto stored = rsscache.internalize_rssfeed(feedurl, &ign);
+		stored->get_item_by_guid("read")->set_unread(false);
+		stored->get_item_by_guid("flagged")->set_flags("ab");
+		stored->get_item_by_guid("flagged")->update_flags();
+		stored->get_item_by_guid("deleted")->set_deleted(true);
+		rsscache.mark_item_deleted("deleted", true);
+		return stored;
+	};
 
-	// Getting rid of `Cache` instance to make sure it doesn't hold the
-	// database anymore and did everything it wanted to
-	rsscache.reset();
+	const auto new_feed = [&](Cache& rsscache) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		feed->set_title("Feed, renamed");
+		feed->set_link("http://example.com/");
+		feed->add_item(make_item(rsscache, "new", "New", 2000));
+		feed->add_item(make_item(rsscache, "kept", "Kept", 3000));
+		feed->add_item(make_item(rsscache, "read", "Read, changed", 1100));
+		feed->add_item(make_item(rsscache, "flagged", "Flagged", 1200));
+		feed->add_item(make_item(rsscache, "deleted", "Deleted", 1300));
+		feed->add_item(make_item(rsscache, "hidden", "Shown now", 1400));
+		feed->add_item(make_item(rsscache, "new-ignored", "New but ignored",
+				1500));
+		return feed;
+	};
 
-	// This struct is a bit of machinery that'll ensure that we let go of
+	const auto require_same = [](RssFeed& merged, RssFeed& expected) {
+		REQUIRE(merged.title_raw() == expected.title_raw());
+		REQUIRE(merged.link() == expected.link());
+		REQUIRE(merged.total_item_count() == expected.total_item_count());
+		for (unsigned int i = 0; i < expected.total_item_count(); ++i) {
+			const auto& actual = merged.items()[i];
+			const auto& item = expected.items()[i];
+			INFO("item " << item->guid());
+			REQUIRE(actual->guid() == item->guid());
+			REQUIRE(actual->title() == item->title());
+			REQUIRE(actual->link() == item->link());
+			REQUIRE(actual->pubDate_timestamp() == item->pubDate_timestamp());
+			REQUIRE(actual->unread() == item->unread());
+			REQUIRE(actual->flags() == item->flags());
+			REQUIRE(actual->enqueued() == item->enqueued());
+			REQUIRE(actual->size() == item->size());
+			REQUIRE(actual->feedurl() == item->feedurl());
+			REQUIRE(actual->description().text == item->description().text);
+		}
+	};
+
+	for (const bool reset_unread : {false, true}) {
+		INFO("reset_unread " << reset_unread);
+		Cache merging(":memory:", &cfg);
+		auto merged = merging.merge_rssfeed(old_feed(merging),
+				new_feed(merging), reset_unread, &ign);
+
+		Cache writing(":memory:", &cfg);
+		old_feed(writing);
+		writing.externalize_rssfeed(new_feed(writing), reset_unread);
+		auto expected = writing.internalize_rssfeed(feedurl, &ign);
+
+		REQUIRE(expected->total_item_count() == 6);
+		require_same(*merged, *expected);
+		REQUIRE(merged->items()[0]->get_feedptr() == merged);
+
+		// What was stored is the same too
+		auto reread = merging.internalize_rssfeed(feedurl, &ign);
+		require_same(*reread, *expected);
+	}
+}
+
+TEST_CASE("merge_rssfeed reuses the articles that didn't change",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "http://example.com/feed.xml";
+
+	const auto make_feed = [&](const std::string& changed_title) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		for (const std::string guid : {
+				"unchanged", "changed", "gone"
+			}) {
+			if (guid == "gone" && changed_title != "Changed") {
+				continue;
+			}
+			auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid(guid);
+			item->set_title(guid == "changed" ? changed_title : guid);
+			item->set_link("http://example.com/" + guid);
+			item->set_description("<p>" + guid + "</p>", "text/html");
+			item->set_pubDate(1000);
+			item->set_feedurl(feedurl);
+			feed->add_item(item);
+		}
+		return feed;
+	};
+
+	rsscache.externalize_rssfeed(make_feed("Changed"), false);
+	const auto oldfeed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto unchanged = oldfeed->get_item_by_guid("unchanged");
+	const auto changed = oldfeed->get_item_by_guid("changed");
+	const auto gone = oldfeed->get_item_by_guid("gone");
+	changed->set_unread(false);
+
+	const auto merged = rsscache.merge_rssfeed(oldfeed,
+			make_feed("Changed again"), false, nullptr);
+
+	REQUIRE(merged->total_item_count() == 3);
+	REQUIRE(merged->get_item_by_guid("unchanged") == unchanged);
+	REQUIRE(merged->get_item_by_guid("gone") == gone);
+	REQUIRE(unchanged->get_feedptr() == merged);
+
+	const auto replaced = merged->get_item_by_guid("changed");
+	REQUIRE(replaced != changed);
+	REQUIRE(replaced->title() == "Changed again");
+	REQUIRE_FALSE(replaced->unread());
+}
+
+TEST_CASE("merge_rssfeed reports what it did to each article", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::string feedurl = "http://example.com/feed.xml";
+
+	const auto make_feed = [&](const std::string& changed_title) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		for (const std::string guid : {
+				"unchanged", "changed"
+			}) {
+			auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid(guid);
+			const std::string title = guid == "changed" ? changed_title : guid;
+			item->set_title(title);
+			item->set_link("http://example.com/" + guid);
+			item->set_description("<p>" + title + "</p>", "text/html");
+			item->set_pubDate(1000);
+			item->set_feedurl(feedurl);
+			feed->add_item(item);
+		}
+		return feed;
+	};
+	const auto kinds = [](const ItemChanges& changes,
+	const std::string& guid) {
+		std::vector<ItemChange::Kind> result;
+		for (const auto& change : changes) {
+			REQUIRE(change.feedurl == "http://example.com/feed.xml");
+			if (change.guid == guid) {
+				result.push_back(change.kind);
+			}
+		}
+		return result;
+	};
+
+	ItemChanges changes;
+	rsscache.externalize_rssfeed(make_feed("Changed"), false, &changes);
+	REQUIRE(changes.size() == 2);
+	REQUIRE(kinds(changes, "unchanged") ==
+		std::vector<ItemChange::Kind>({ItemChange::Kind::ADDED}));
+	REQUIRE(kinds(changes, "changed") ==
+		std::vector<ItemChange::Kind>({ItemChange::Kind::ADDED}));
+
+	SECTION("storing the same feed again changes nothing") {
+		changes.clear();
+		rsscache.externalize_rssfeed(make_feed("Changed"), false, &changes);
+		REQUIRE(changes.empty());
+	}
+
+	SECTION("an article that changed is reported along with its unread flag") {
+		const auto oldfeed = rsscache.internalize_rssfeed(feedurl, nullptr);
+		oldfeed->get_item_by_guid("changed")->set_unread(false);
+
+		changes.clear();
+		rsscache.merge_rssfeed(oldfeed, make_feed("Changed again"), true,
+			nullptr, nullptr, &changes);
+
+		REQUIRE(kinds(changes, "unchanged").empty());
+		const auto changed = kinds(changes, "changed");
+		REQUIRE(changed.size() == 2);
+		REQUIRE(std::count(changed.begin(), changed.end(),
+				ItemChange::Kind::CHANGED) == 1);
+		REQUIRE(std::count(changed.begin(), changed.end(),
+				ItemChange::Kind::UNREAD) == 1);
+	}
+}
+
+TEST_CASE(
+	"externalize_rssfeed does not create an entry in rss_feed table "
+	"when passed a query feed",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	std::unique_ptr<Cache> rsscache(new Cache(dbfile.get_path(), &cfg));
+
+	auto feed = std::make_shared<RssFeed>(rsscache.get(),
+			"query:All unread:unread = \"yes\"");
+
+	REQUIRE_NOTHROW(rsscache->externalize_rssfeed(feed, false));
+
+	// Getting rid of `Cache` instance to make sure it doesn't hold the
+	// database anymore and did everything it wanted to
+	rsscache.reset();
+
+	// This struct is a bit of machinery that'll ensure that we let go of
 	// SQLite3 handle even if the test fails
 	struct sqlite_deleter {
 		void operator()(sqlite3* db)
@@ -1029,6 +1870,37 @@ TEST_CASE("search_in_items returns items that contain given substring",
 	}
 }
 
+TEST_CASE("search_in_items only looks at the articles with the given guids",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssParser parser("file://data/rss.xml", &rsscache, &cfg, nullptr);
+	std::shared_ptr<RssFeed> feed = parser.parse();
+	rsscache.externalize_rssfeed(feed, false);
+
+	const std::string matching_guid =
+		"http://www.blogger.com/feeds/33750310/posts/full/"
+		"115822000722667899";
+	const std::unordered_set<std::string> all_guids{
+		matching_guid,
+		"http://www.blogger.com/feeds/33750310/posts/full/"
+		"115720132609158191",
+		"http://example.com/not-in-the-cache",
+	};
+	REQUIRE(rsscache.search_in_items("Botox", all_guids)
+		== std::unordered_set<std::string> {matching_guid});
+
+	const std::unordered_set<std::string> other_guids{
+		"http://www.blogger.com/feeds/33750310/posts/full/"
+		"115720132609158191",
+	};
+	REQUIRE(rsscache.search_in_items("Botox", other_guids).empty());
+
+	// The set of one search doesn't leak into the next
+	REQUIRE(rsscache.search_in_items("Botox", all_guids).size() == 1);
+}
+
 TEST_CASE("search_in_items returns empty set if input set is empty", "[Cache]")
 {
 	ConfigContainer cfg;
@@ -1061,3 +1933,1045 @@ TEST_CASE("Ignoring articles in search", "[Cache]")
 	REQUIRE(search_items.size() == 0 );
 	REQUIRE(no_ignore_items.size() == 1);
 }
+
+TEST_CASE("search_for_items leaves out articles ignored by rules that can "
+	"be checked in SQL", "[Cache]")
+{
+	ConfigContainer cfg{};
+	Cache rsscache(":memory:", &cfg);
+
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	auto feed = parser.parse();
+	rsscache.externalize_rssfeed(feed, false);
+	const auto read_guid = feed->items()[0]->guid();
+	feed->items()[0]->set_unread(false);
+	const auto enqueued_guid = feed->items()[1]->guid();
+
+	const auto guids_found = [&](RssIgnores& ign) {
+		std::unordered_set<std::string> guids;
+		for (const auto& item : rsscache.search_for_items("blogger", "", ign)) {
+			guids.insert(item->guid());
+		}
+		return guids;
+	};
+
+	SECTION("rules for all feeds") {
+		RssIgnores ign;
+		ign.handle_action("ignore-article", {"*", "unread = \"no\""});
+		const auto guids = guids_found(ign);
+		REQUIRE(guids.size() == 7);
+		REQUIRE(guids.count(read_guid) == 0);
+	}
+
+	SECTION("rules for a single feed") {
+		RssIgnores ign;
+		ign.handle_action("ignore-article", {
+			"https://example.com/other.xml", "unread = \"no\""
+		});
+		ign.handle_action("ignore-article", {
+			feedurl, "guid = \"" + enqueued_guid + "\" or age < 0"
+		});
+		const auto guids = guids_found(ign);
+		REQUIRE(guids.size() == 7);
+		REQUIRE(guids.count(enqueued_guid) == 0);
+	}
+
+	SECTION("rules that need the in-memory matcher are still applied") {
+		RssIgnores ign;
+		ign.handle_action("ignore-article", {"*", "age > 0 and title =~ \"Botox\""});
+		REQUIRE(guids_found(ign).size() == 7);
+	}
+}
+
+TEST_CASE("search_for_items uses the search index for substrings and falls "
+	"back to scanning for short queries",
+	"[Cache]")
+{
+	ConfigContainer cfg{};
+	Cache rsscache(":memory:", &cfg);
+
+	RssParser parser("file://data/rss.xml", &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	RssIgnores ign;
+	// Matches in the middle of a word, in any case, like LIKE did
+	REQUIRE(rsscache.search_for_items("otox center", "", ign).size() == 1);
+	REQUIRE(rsscache.search_for_items("\"quoted\" OR", "", ign).empty());
+	// Too short for the trigram index
+	REQUIRE(rsscache.search_for_items("!!", "", ign).size() == 1);
+
+	std::unordered_set<std::string> guids;
+	for (const auto& item : rsscache.search_for_items("blogger", "", ign)) {
+		guids.insert(item->guid());
+	}
+	REQUIRE(guids.size() == 8);
+	REQUIRE(rsscache.search_in_items("Lidl", guids).size() == 1);
+}
+
+TEST_CASE("index_items_for_search adds articles stored before the index "
+	"existed",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg{};
+	const auto feedurl = "file://data/rss.xml";
+
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	// Make the cache look like it was just upgraded from a version without
+	// the search index
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	REQUIRE(sqlite3_exec(db,
+			"INSERT INTO rss_item_fts(rss_item_fts) VALUES ('delete-all');"
+			"UPDATE search_index SET indexed_up_to = 0, "
+			"backfill_end = (SELECT MAX(id) FROM rss_item);",
+			nullptr, nullptr, nullptr) == SQLITE_OK);
+	sqlite3_close(db);
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	RssIgnores ign;
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).size() == 1);
+
+	unsigned int batches = 1;
+	while (!rsscache.index_items_for_search(3)) {
+		++batches;
+	}
+	REQUIRE(batches == 3);
+	REQUIRE(rsscache.index_items_for_search(3));
+
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).size() == 1);
+	REQUIRE(rsscache.search_for_items("Botox", feedurl, ign).size() == 1);
+
+	// Deleting backfilled articles keeps the index consistent
+	rsscache.mark_all_read(feedurl);
+	rsscache.cleanup_cache({}, true);
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).empty());
+}
+
+TEST_CASE("The search index is built anew if its bookkeeping is gone",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg{};
+	const auto feedurl = "file://data/rss.xml";
+
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	// That's what a SQLite without FTS5 leaves behind
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	REQUIRE(sqlite3_exec(db,
+			"DROP TRIGGER rss_item_fts_insert;"
+			"DROP TRIGGER rss_item_fts_delete;"
+			"DROP TRIGGER rss_item_fts_update;"
+			"DROP TABLE search_index;",
+			nullptr, nullptr, nullptr) == SQLITE_OK);
+	sqlite3_close(db);
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	while (!rsscache.index_items_for_search(100)) {
+	}
+	RssIgnores ign;
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).size() == 1);
+
+	// The triggers are back
+	rsscache.mark_all_read(feedurl);
+	rsscache.cleanup_cache({}, true);
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).empty());
+}
+
+TEST_CASE("internalize_rssfeed_lazily reads items on first use", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	auto parsed = parser.parse();
+	parsed->items()[0]->set_unread_nowrite(false);
+	rsscache.externalize_rssfeed(parsed, false);
+
+	const auto full = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto lazy = rsscache.internalize_rssfeed_lazily(feedurl);
+
+	REQUIRE_FALSE(lazy->items_loaded());
+	REQUIRE(lazy->title_raw() == full->title_raw());
+	REQUIRE(lazy->total_item_count() == 8);
+	REQUIRE(lazy->unread_item_count() == 7);
+	REQUIRE_FALSE(lazy->items_loaded());
+
+	const auto& items = lazy->items();
+	REQUIRE(lazy->items_loaded());
+	REQUIRE(items.size() == full->items().size());
+	for (unsigned int i = 0; i < items.size(); ++i) {
+		REQUIRE(items[i]->guid() == full->items()[i]->guid());
+		REQUIRE(items[i]->title() == full->items()[i]->title());
+		REQUIRE(items[i]->get_feedptr() == lazy);
+	}
+	REQUIRE(lazy->unread_item_count() == 7);
+}
+
+TEST_CASE("A lazy feed can read its unread and flagged items before the "
+	"rest", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	auto parsed = parser.parse();
+	for (unsigned int i = 0; i < 3; ++i) {
+		parsed->items()[i]->set_unread_nowrite(false);
+	}
+	rsscache.externalize_rssfeed(parsed, false);
+	parsed->items()[0]->set_flags("a");
+	rsscache.update_rssitem_flags(parsed->items()[0].get());
+
+	const auto full = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto lazy = rsscache.internalize_rssfeed_lazily(feedurl);
+
+	// Five unread ones, and a flagged one that's read
+	REQUIRE(lazy->unread_items().size() == 6);
+	REQUIRE_FALSE(lazy->items_loaded());
+	REQUIRE(lazy->total_item_count() == 8);
+	REQUIRE(lazy->unread_item_count() == 5);
+
+	lazy->unread_items()[1]->set_unread(false);
+	REQUIRE(lazy->unread_item_count() == 4);
+	{
+		const SharedLock lock(lazy->item_mutex);
+		const auto summaries = lazy->item_summaries();
+		REQUIRE(summaries.size() == 8);
+		REQUIRE(std::count_if(summaries.begin(), summaries.end(),
+		[](const ItemSummary& summary) {
+			return summary.unread;
+		}) == 4);
+	}
+
+	const auto& items = lazy->items();
+	REQUIRE(lazy->items_loaded());
+	REQUIRE(items.size() == full->items().size());
+	for (unsigned int i = 0; i < items.size(); ++i) {
+		REQUIRE(items[i]->guid() == full->items()[i]->guid());
+	}
+	REQUIRE(lazy->unread_item_count() == 4);
+}
+
+TEST_CASE("Query feeds only read the lazy feeds that the cache has matches "
+	"in", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const auto with_read = "file://data/rss.xml";
+	const auto all_unread = "file://data/atom10_1.xml";
+	for (const auto& feedurl : {
+			with_read, all_unread
+		}) {
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		auto parsed = parser.parse();
+		if (feedurl == with_read) {
+			parsed->items()[1]->set_unread_nowrite(false);
+		}
+		rsscache.externalize_rssfeed(parsed, false);
+	}
+
+	const std::vector<std::shared_ptr<RssFeed>> feeds = {
+		rsscache.internalize_rssfeed_lazily(with_read),
+		rsscache.internalize_rssfeed_lazily(all_unread),
+	};
+	RssFeed query(&rsscache, "query:Read:unread = \"no\"");
+	query.update_items(feeds);
+
+	REQUIRE(query.items().size() == 1);
+	REQUIRE(query.items()[0]->guid() == feeds[0]->items()[1]->guid());
+	REQUIRE(feeds[0]->items_loaded());
+	REQUIRE_FALSE(feeds[1]->items_loaded());
+
+	SECTION("loaded feeds are matched as they are in memory") {
+		feeds[0]->items()[0]->set_unread_nowrite(false);
+		query.update_items(feeds);
+		REQUIRE(query.items().size() == 2);
+		REQUIRE_FALSE(feeds[1]->items_loaded());
+	}
+}
+
+TEST_CASE("internalize_rssfeed_lazily trims feeds to `max-items` items",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	cfg.set_configvalue("max-items", "3");
+	const auto lazy = rsscache.internalize_rssfeed_lazily(feedurl);
+	REQUIRE(lazy->total_item_count() == 3);
+	REQUIRE(lazy->items().size() == 3);
+	REQUIRE(rsscache.internalize_rssfeed(feedurl, nullptr)->total_item_count()
+		== 3);
+}
+
+TEST_CASE("internalize_rssfeeds reads the same feeds as internalize_rssfeed",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	const std::vector<std::string> stored = {
+		"file://data/rss.xml",
+		"file://data/atom10_1.xml",
+		"file://data/rss20_1.xml",
+	};
+	for (const auto& url : stored) {
+		RssParser parser(url, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	// The third stored feed isn't requested, and one requested feed isn't
+	// stored
+	const std::vector<std::string> urls = {
+		"file://data/atom10_1.xml",
+		"http://example.com/not-in-cache.xml",
+		"query:Unread:unread = \"yes\"",
+		"file://data/rss.xml",
+		"file://data/atom10_1.xml",
+	};
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (const auto& url : urls) {
+		feeds.push_back(std::make_shared<RssFeed>(&rsscache, url));
+	}
+
+	RssIgnores ign;
+	ign.handle_action("ignore-article", {"*", "title =~ \"Botox\""});
+	unsigned int done = 0;
+	rsscache.internalize_rssfeeds(feeds, &ign, [&]() {
+		++done;
+	});
+	REQUIRE(done == urls.size());
+
+	for (unsigned int i = 0; i < urls.size(); ++i) {
+		const auto expected = rsscache.internalize_rssfeed(urls[i], &ign);
+		REQUIRE(feeds[i]->title_raw() == expected->title_raw());
+		REQUIRE(feeds[i]->link() == expected->link());
+		REQUIRE(feeds[i]->total_item_count() == expected->total_item_count());
+		for (unsigned int j = 0; j < expected->total_item_count(); ++j) {
+			const auto item = feeds[i]->items()[j];
+			REQUIRE(item->guid() == expected->items()[j]->guid());
+			REQUIRE(item->get_feedptr() == feeds[i]);
+		}
+	}
+	REQUIRE(feeds[3]->total_item_count() == 7);
+	// Duplicate urls get their own copies of the items
+	REQUIRE(feeds[0]->items()[0] != feeds[4]->items()[0]);
+}
+
+TEST_CASE("Hot rss_item queries are answered from indexes", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+	}
+
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	const auto query_plan = [&](const std::string& sql) {
+		const std::string explain = "EXPLAIN QUERY PLAN " + sql;
+		sqlite3_stmt* stmt = nullptr;
+		std::string plan;
+		REQUIRE(sqlite3_prepare_v2(db, explain.c_str(), -1, &stmt, nullptr)
+			== SQLITE_OK);
+		while (sqlite3_step(stmt) == SQLITE_ROW) {
+			plan += reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+			plan += "\n";
+		}
+		sqlite3_finalize(stmt);
+		return plan;
+	};
+
+	SECTION("items of a single feed") {
+		const auto plan = query_plan(
+				"SELECT guid, title, author, url, pubDate, length(content), "
+				"unread, "
+				"feedurl, enclosure_url, enclosure_type, enqueued, flags, base "
+				"FROM rss_item "
+				"WHERE feed_id = ? "
+				"AND deleted = 0 "
+				"ORDER BY pubDate DESC, id DESC;");
+		REQUIRE(plan.find("idx_rss_item_feed_id_pubdate") != std::string::npos);
+		REQUIRE(plan.find("TEMP B-TREE") == std::string::npos);
+	}
+
+	SECTION("summaries of a feed's items") {
+		const auto plan = query_plan(
+				"SELECT guid, pubDate, unread, flags "
+				"FROM rss_item "
+				"WHERE feed_id = ? "
+				"AND deleted = 0 "
+				"ORDER BY pubDate DESC, id DESC;");
+		REQUIRE(plan.find("COVERING INDEX idx_rss_item_feed_id_pubdate")
+			!= std::string::npos);
+	}
+
+	SECTION("items of all feeds") {
+		const auto plan = query_plan(
+				"SELECT guid, title, author, url, pubDate, length(content), "
+				"unread, "
+				"feedurl, enclosure_url, enclosure_type, enqueued, flags, base "
+				"FROM rss_item "
+				"WHERE deleted = 0 "
+				"ORDER BY feed_id, pubDate DESC, id DESC;");
+		REQUIRE(plan.find("idx_rss_item_feed_id_pubdate") != std::string::npos);
+		REQUIRE(plan.find("TEMP B-TREE") == std::string::npos);
+	}
+
+	SECTION("read items") {
+		const auto plan = query_plan("SELECT guid FROM rss_item WHERE unread = 0;");
+		REQUIRE(plan.find("COVERING INDEX idx_rss_item_unread_guid")
+			!= std::string::npos);
+	}
+
+	sqlite3_close(db);
+}
+
+TEST_CASE("Articles refer to their feed by its id", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	const std::string feedurl = "file://data/rss.xml";
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	const auto count = [&](const std::string& sql) {
+		sqlite3_stmt* stmt = nullptr;
+		REQUIRE(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr)
+			== SQLITE_OK);
+		REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+		const auto result = sqlite3_column_int64(stmt, 0);
+		sqlite3_finalize(stmt);
+		return result;
+	};
+
+	REQUIRE(count("SELECT COUNT(*) FROM rss_item") > 0);
+	REQUIRE(count("SELECT COUNT(*) FROM rss_item "
+			"JOIN rss_feed_id ON rss_feed_id.id = rss_item.feed_id "
+			"WHERE rss_feed_id.rssurl = rss_item.feedurl")
+		== count("SELECT COUNT(*) FROM rss_item"));
+
+	SECTION("rows that only name the URL are given the id") {
+		REQUIRE(sqlite3_exec(db,
+				"INSERT INTO rss_item (guid, title, author, url, feedurl, "
+				"pubDate, content, unread) "
+				"VALUES ('other', '', '', '', 'https://example.com/other.xml', "
+				"0, '', 1);"
+				"UPDATE rss_item SET feedurl = 'https://example.com/moved.xml' "
+				"WHERE guid != 'other';",
+				nullptr, nullptr, nullptr) == SQLITE_OK);
+		REQUIRE(count("SELECT COUNT(*) FROM rss_item "
+				"JOIN rss_feed_id ON rss_feed_id.id = rss_item.feed_id "
+				"WHERE rss_feed_id.rssurl = rss_item.feedurl")
+			== count("SELECT COUNT(*) FROM rss_item"));
+		REQUIRE(count("SELECT COUNT(*) FROM rss_feed_id") == 3);
+	}
+
+	sqlite3_close(db);
+
+	SECTION("the feed is read back by its id") {
+		Cache rsscache(dbfile.get_path(), &cfg);
+		const auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+		REQUIRE(feed->total_item_count() > 0);
+	}
+}
+
+TEST_CASE("Articles read from the cache are updated by their row id",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+	const std::string feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	const auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	REQUIRE(feed->total_item_count() > 0);
+	const auto item = feed->items()[0];
+	REQUIRE(item->row_id() != 0);
+	for (const auto& other : feed->items()) {
+		if (other != item) {
+			REQUIRE(other->row_id() != item->row_id());
+		}
+	}
+
+	// Nothing but the id leads to the row after this
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	const std::string rename = "UPDATE rss_item SET guid = 'renamed' "
+		"WHERE id = " + std::to_string(item->row_id()) + ";";
+	REQUIRE(sqlite3_exec(db, rename.c_str(), nullptr, nullptr, nullptr)
+		== SQLITE_OK);
+
+	item->set_unread_nowrite(false);
+	rsscache.update_rssitem_unread_and_enqueued(item.get(), feedurl);
+	item->set_flags("ab");
+	rsscache.update_rssitem_flags(item.get());
+	rsscache.mark_item_deleted(*item, true);
+
+	sqlite3_stmt* stmt = nullptr;
+	REQUIRE(sqlite3_prepare_v2(db,
+			"SELECT unread, flags, deleted FROM rss_item "
+			"WHERE guid = 'renamed';", -1, &stmt, nullptr) == SQLITE_OK);
+	REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+	REQUIRE(sqlite3_column_int(stmt, 0) == 0);
+	REQUIRE(std::string(reinterpret_cast<const char*>(
+				sqlite3_column_text(stmt, 1))) == "ab");
+	REQUIRE(sqlite3_column_int(stmt, 2) == 1);
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+}
+
+TEST_CASE("compact() returns free pages of the cache file step by step",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	auto feed = std::make_shared<RssFeed>(&rsscache, "http://example.com/");
+	for (unsigned int i = 0; i < 100; ++i) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("guid-" + std::to_string(i));
+		item->set_title("Article " + std::to_string(i));
+		item->set_description(std::string(4000, 'x'), "text/plain");
+		item->set_feedurl(feed->rssurl());
+		feed->add_item(item);
+	}
+	rsscache.externalize_rssfeed(feed, false);
+	while (rsscache.compact(1000)) {
+	}
+	REQUIRE_FALSE(rsscache.compact(1));
+
+	// The feed isn't in the urls file anymore, so its items get deleted
+	rsscache.cleanup_cache({}, true);
+
+	unsigned int steps = 1;
+	while (rsscache.compact(1)) {
+		++steps;
+	}
+	REQUIRE(steps > 1);
+	REQUIRE_FALSE(rsscache.compact(1));
+}
+
+TEST_CASE("Article contents are stored compressed if "
+	"`cache-compress-content` is enabled",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	cfg.set_configvalue("cache-compress-content", "yes");
+	const auto feedurl = "file://data/rss.xml";
+
+	std::map<std::string, std::string> descriptions;
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		const auto feed = parser.parse();
+		for (const auto& item : feed->items()) {
+			descriptions[item->guid()] = item->description().text;
+		}
+		rsscache.externalize_rssfeed(feed, false);
+	}
+
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	sqlite3_stmt* stmt = nullptr;
+	REQUIRE(sqlite3_prepare_v2(db,
+			"SELECT count(*) FROM rss_content WHERE typeof(content) = 'blob';",
+			-1, &stmt, nullptr) == SQLITE_OK);
+	REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+	const int compressed = sqlite3_column_int(stmt, 0);
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+	REQUIRE(compressed > 0);
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	RssIgnores ign;
+	const auto feed = rsscache.internalize_rssfeed(feedurl, &ign);
+	REQUIRE(feed->total_item_count() == descriptions.size());
+	for (const auto& item : feed->items()) {
+		const auto& text = descriptions[item->guid()];
+		REQUIRE(rsscache.fetch_description(*item) == text);
+		// Same as SQLite's length() of the uncompressed text
+		const auto characters = std::count_if(text.begin(), text.end(),
+		[](char c) {
+			return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+		});
+		REQUIRE(item->size() == characters);
+	}
+
+	// Both through the search index and by scanning the table
+	REQUIRE(rsscache.search_for_items("Botox", "", ign).size() == 1);
+	REQUIRE(rsscache.search_for_items("ox", "", ign).size() >= 1);
+}
+
+TEST_CASE("compress_stored_content compresses articles stored before "
+	"`cache-compress-content` was enabled",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	const std::string feedurl = "http://example.com/";
+
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		for (unsigned int i = 0; i < 60; ++i) {
+			auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid("guid-" + std::to_string(i));
+			item->set_title("Article " + std::to_string(i));
+			item->set_description("<p>Article " + std::to_string(i)
+				+ "</p><footer>Brought to you by the example.com "
+				"editorial team. Subscribe to our newsletter!</footer>",
+				"text/html");
+			item->set_feedurl(feedurl);
+			feed->add_item(item);
+		}
+		rsscache.externalize_rssfeed(feed, false);
+
+		REQUIRE_FALSE(rsscache.compress_stored_content(10));
+	}
+
+	// Make half of the articles look like they were stored by a version
+	// that kept contents in rss_item
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	// The search index triggers need this; nothing is compressed yet
+	sqlite3_create_function(db, "newsboat_content", 1, SQLITE_UTF8, nullptr,
+	[](sqlite3_context* context, int, sqlite3_value** argv) {
+		sqlite3_result_value(context, argv[0]);
+	}, nullptr, nullptr);
+	REQUIRE(sqlite3_exec(db,
+			"UPDATE rss_item SET content = "
+			" (SELECT content FROM rss_content WHERE id = content_id), "
+			" content_id = NULL "
+			"WHERE id % 2 = 0;",
+			nullptr, nullptr, nullptr) == SQLITE_OK);
+	sqlite3_close(db);
+
+	cfg.set_configvalue("cache-compress-content", "yes");
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	unsigned int batches = 1;
+	while (rsscache.compress_stored_content(25)) {
+		++batches;
+	}
+	// The 30 old-style articles, then all 60 contents (half of which
+	// aren't referred to anymore, but are still around)
+	REQUIRE(batches == 4);
+	REQUIRE_FALSE(rsscache.compress_stored_content(25));
+
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	sqlite3_stmt* stmt = nullptr;
+	REQUIRE(sqlite3_prepare_v2(db,
+			"SELECT "
+			" (SELECT count(*) FROM rss_item "
+			"  WHERE typeof(content) = 'text' AND content != '') "
+			" + (SELECT count(*) FROM rss_content "
+			"  WHERE typeof(content) = 'text'), "
+			" (SELECT count(*) FROM content_dictionary);",
+			-1, &stmt, nullptr) == SQLITE_OK);
+	REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+	REQUIRE(sqlite3_column_int(stmt, 0) == 0);
+	REQUIRE(sqlite3_column_int(stmt, 1) == 1);
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	RssIgnores ign;
+	const auto feed = rsscache.internalize_rssfeed(feedurl, &ign);
+	REQUIRE(feed->total_item_count() == 60);
+	const auto item = feed->get_item_by_guid("guid-42");
+	REQUIRE(rsscache.fetch_description(*item) == "<p>Article 42</p><footer>"
+		"Brought to you by the example.com editorial team. Subscribe to our "
+		"newsletter!</footer>");
+	REQUIRE(rsscache.search_for_items("Article 42", "", ign).size() == 1);
+}
+
+TEST_CASE("split_stored_content moves contents out of rss_item and stores "
+	"their lengths", "[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	const std::string feedurl = "http://example.com/";
+
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+		for (unsigned int i = 0; i < 60; ++i) {
+			auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid("guid-" + std::to_string(i));
+			item->set_description("<p>Caf\xc3\xa9 " + std::to_string(i) + "</p>",
+				"text/html");
+			item->set_feedurl(feedurl);
+			feed->add_item(item);
+		}
+		rsscache.externalize_rssfeed(feed, false);
+	}
+
+	// Make half of the articles look like they were stored by a version
+	// that kept contents in rss_item, and none have their length stored
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	sqlite3_create_function(db, "newsboat_content", 1, SQLITE_UTF8, nullptr,
+	[](sqlite3_context* context, int, sqlite3_value** argv) {
+		sqlite3_result_value(context, argv[0]);
+	}, nullptr, nullptr);
+	REQUIRE(sqlite3_exec(db,
+			"UPDATE rss_item SET content = "
+			" (SELECT content FROM rss_content WHERE id = content_id), "
+			" content_id = NULL "
+			"WHERE id % 2 = 0;"
+			"UPDATE rss_item SET content_length = NULL;",
+			nullptr, nullptr, nullptr) == SQLITE_OK);
+	sqlite3_close(db);
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	unsigned int batches = 1;
+	while (rsscache.split_stored_content(25)) {
+		++batches;
+	}
+	REQUIRE(batches == 3);
+	REQUIRE_FALSE(rsscache.split_stored_content(25));
+
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	sqlite3_stmt* stmt = nullptr;
+	REQUIRE(sqlite3_prepare_v2(db,
+			"SELECT count(*) FROM rss_item "
+			"WHERE content_id IS NULL OR content != '' "
+			"OR content_length IS NULL;",
+			-1, &stmt, nullptr) == SQLITE_OK);
+	REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+	REQUIRE(sqlite3_column_int(stmt, 0) == 0);
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	RssIgnores ign;
+	const auto feed = rsscache.internalize_rssfeed(feedurl, &ign);
+	REQUIRE(feed->total_item_count() == 60);
+	const auto item = feed->get_item_by_guid("guid-42");
+	REQUIRE(rsscache.fetch_description(*item) == "<p>Caf\xc3\xa9 42</p>");
+	REQUIRE(item->size() == 14);
+	REQUIRE(rsscache.search_for_items("Caf\xc3\xa9 42", "", ign).size() == 1);
+}
+
+TEST_CASE("externalize_rssfeed only writes articles that changed",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	const std::string feedurl = "http://example.com/";
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	auto feed = std::make_shared<RssFeed>(&rsscache, feedurl);
+	for (unsigned int i = 0; i < 3; ++i) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("guid-" + std::to_string(i));
+		item->set_title("Article " + std::to_string(i));
+		item->set_author("Author");
+		item->set_description("<p>Article " + std::to_string(i) + "</p>",
+			"text/html");
+		item->set_feedurl(feedurl);
+		feed->add_item(item);
+	}
+	rsscache.externalize_rssfeed(feed, false);
+
+	// Change the rows behind the cache's back, so that we can tell which
+	// ones are written again
+	sqlite3* db = nullptr;
+	REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+	REQUIRE(sqlite3_exec(db,
+			"UPDATE rss_item SET author = 'untouched';"
+			"UPDATE rss_item SET item_hash = NULL WHERE guid = 'guid-2';",
+			nullptr, nullptr, nullptr) == SQLITE_OK);
+
+	feed->items()[1]->set_title("Article 1, corrected");
+	rsscache.externalize_rssfeed(feed, false);
+
+	const auto author_of = [&](const std::string& guid) {
+		sqlite3_stmt* stmt = nullptr;
+		REQUIRE(sqlite3_prepare_v2(db,
+				"SELECT author FROM rss_item WHERE guid = ?;",
+				-1, &stmt, nullptr) == SQLITE_OK);
+		sqlite3_bind_text(stmt, 1, guid.c_str(), -1, SQLITE_TRANSIENT);
+		REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+		const std::string author =
+			reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+		sqlite3_finalize(stmt);
+		return author;
+	};
+	REQUIRE(author_of("guid-0") == "untouched");
+	REQUIRE(author_of("guid-1") == "Author");
+	// Stored without a hash, like articles from before it was kept
+	REQUIRE(author_of("guid-2") == "Author");
+	sqlite3_close(db);
+
+	RssIgnores ign;
+	const auto stored = rsscache.internalize_rssfeed(feedurl, &ign);
+	REQUIRE(stored->total_item_count() == 3);
+	REQUIRE(stored->get_item_by_guid("guid-1")->title()
+		== "Article 1, corrected");
+}
+
+TEST_CASE("Articles with the same content share a single copy of it",
+	"[Cache]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	const std::string text = "<p>The same article, republished by a planet</p>";
+
+	const auto count_contents = [&]() {
+		sqlite3* db = nullptr;
+		REQUIRE(sqlite3_open(dbfile.get_path().c_str(), &db) == SQLITE_OK);
+		sqlite3_stmt* stmt = nullptr;
+		REQUIRE(sqlite3_prepare_v2(db, "SELECT count(*) FROM rss_content;",
+				-1, &stmt, nullptr) == SQLITE_OK);
+		REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+		const int count = sqlite3_column_int(stmt, 0);
+		sqlite3_finalize(stmt);
+		sqlite3_close(db);
+		return count;
+	};
+
+	Cache rsscache(dbfile.get_path(), &cfg);
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (const std::string url : {
+			"http://example.com/blog", "http://example.com/planet"
+		}) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, url);
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(url + "#1");
+		item->set_title("Republished");
+		item->set_description(text, "text/html");
+		item->set_feedurl(url);
+		feed->add_item(item);
+		rsscache.externalize_rssfeed(feed, false);
+		feeds.push_back(feed);
+	}
+	REQUIRE(count_contents() == 1);
+
+	RssIgnores ign;
+	for (const auto& feed : feeds) {
+		const auto loaded = rsscache.internalize_rssfeed(feed->rssurl(), &ign);
+		REQUIRE(loaded->total_item_count() == 1);
+		REQUIRE(rsscache.fetch_description(*loaded->items()[0]) == text);
+		REQUIRE(loaded->items()[0]->size() == text.length());
+	}
+	REQUIRE(rsscache.search_for_items("planet", "", ign).size() == 2);
+
+	SECTION("content that nobody refers to anymore is removed on cleanup") {
+		feeds.pop_back();
+		rsscache.cleanup_cache(feeds, true);
+		REQUIRE(count_contents() == 1);
+
+		rsscache.cleanup_cache({}, true);
+		REQUIRE(count_contents() == 0);
+	}
+}
+
+TEST_CASE("store_subscriptions() keeps the list of each source, in order, "
+	"until it's replaced", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	REQUIRE(rsscache.fetch_subscriptions("ttrss").empty());
+
+	const std::vector<std::pair<std::string, std::vector<std::string>>> lists[] = {
+		{
+			{"https://example.com/b.xml#2", {"~B", "news", "tech"}},
+			{"https://example.com/a.xml#1", {}},
+		},
+		{
+			{"https://example.com/c.xml#3", {"~C"}},
+		},
+	};
+	rsscache.store_subscriptions("ttrss", lists[0]);
+	rsscache.store_subscriptions("miniflux", lists[1]);
+	REQUIRE(rsscache.fetch_subscriptions("ttrss") == lists[0]);
+	REQUIRE(rsscache.fetch_subscriptions("miniflux") == lists[1]);
+
+	rsscache.store_subscriptions("ttrss", lists[1]);
+	REQUIRE(rsscache.fetch_subscriptions("ttrss") == lists[1]);
+}
+
+TEST_CASE("store_remote_response() keeps the last answer for each URL",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	StoredResponse stored;
+	REQUIRE_FALSE(rsscache.fetch_remote_response("https://example.com/a",
+			stored));
+
+	StoredResponse response;
+	response.last_modified = 1234567890;
+	response.etag = "\"abc\"";
+	response.body = "{\"feeds\": []}";
+	rsscache.store_remote_response("https://example.com/a", response);
+	response.etag = "\"def\"";
+	response.body = "{}";
+	rsscache.store_remote_response("https://example.com/b", response);
+
+	REQUIRE(rsscache.fetch_remote_response("https://example.com/a", stored));
+	REQUIRE(stored.last_modified == 1234567890);
+	REQUIRE(stored.etag == "\"abc\"");
+	REQUIRE(stored.body == "{\"feeds\": []}");
+
+	response.last_modified = 0;
+	rsscache.store_remote_response("https://example.com/a", response);
+	REQUIRE(rsscache.fetch_remote_response("https://example.com/a", stored));
+	REQUIRE(stored.last_modified == 0);
+	REQUIRE(stored.etag == "\"def\"");
+	REQUIRE(stored.body == "{}");
+}
+
+TEST_CASE("update_websub_hub() records each feed's hub until it's gone",
+	"[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	REQUIRE(rsscache.fetch_websub_hubs().empty());
+
+	rsscache.update_websub_hub("https://example.com/a.xml",
+		"https://hub.example.org/", "https://example.com/a.xml");
+	rsscache.update_websub_hub("https://example.com/b.xml",
+		"https://hub.example.org/", "https://example.com/feeds/b");
+	rsscache.update_websub_hub("https://example.com/a.xml",
+		"https://other.example.org/", "https://example.com/a.xml");
+	rsscache.update_websub_hub("https://example.com/c.xml", "", "");
+
+	auto hubs = rsscache.fetch_websub_hubs();
+	REQUIRE(hubs.size() == 2);
+	REQUIRE(hubs["https://example.com/a.xml"] == std::make_pair(
+			std::string("https://other.example.org/"),
+			std::string("https://example.com/a.xml")));
+	REQUIRE(hubs["https://example.com/b.xml"].second
+		== "https://example.com/feeds/b");
+
+	rsscache.update_websub_hub("https://example.com/a.xml", "", "");
+	REQUIRE(rsscache.fetch_websub_hubs().size() == 1);
+}
+
+TEST_CASE("cache-page-size applies to new cache files right away, and to "
+	"older ones after do_vacuum()", "[Cache]")
+{
+	const auto page_size = [](const std::string& path) {
+		sqlite3* db = nullptr;
+		REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+		int size = 0;
+		REQUIRE(sqlite3_exec(db, "PRAGMA page_size;",
+		[](void* data, int, char** argv, char**) -> int {
+			*static_cast<int*>(data) = std::atoi(argv[0]);
+			return 0;
+		}, &size, nullptr) == SQLITE_OK);
+		sqlite3_close(db);
+		return size;
+	};
+
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	cfg.set_configvalue("cache-page-size", "16384");
+
+	SECTION("new files") {
+		{
+			Cache rsscache(dbfile.get_path(), &cfg);
+		}
+		REQUIRE(page_size(dbfile.get_path()) == 16384);
+	}
+
+	SECTION("older files, in either journal mode") {
+		for (const std::string wal : {
+				"no", "yes"
+			}) {
+			test_helpers::TempFile older_file;
+			ConfigContainer old_cfg;
+			old_cfg.set_configvalue("cache-wal", wal);
+			cfg.set_configvalue("cache-wal", wal);
+			{
+				Cache rsscache(older_file.get_path(), &old_cfg);
+			}
+			REQUIRE(page_size(older_file.get_path()) == 4096);
+
+			Cache rsscache(older_file.get_path(), &cfg);
+			REQUIRE(page_size(older_file.get_path()) == 4096);
+			rsscache.do_vacuum();
+			REQUIRE(page_size(older_file.get_path()) == 16384);
+		}
+	}
+
+	SECTION("sizes SQLite doesn't take are ignored") {
+		cfg.set_configvalue("cache-page-size", "10000");
+		{
+			Cache rsscache(dbfile.get_path(), &cfg);
+			rsscache.do_vacuum();
+		}
+		REQUIRE(page_size(dbfile.get_path()) == 4096);
+	}
+}
+
+TEST_CASE("mark_items_read_by_guid() and for_each_read_item_guid() go "
+	"together, chunk by chunk", "[Cache]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feed = std::make_shared<RssFeed>(&rsscache, "http://example.com/feed");
+	for (const std::string guid : {
+			"a", "b", "c", "d"
+		}) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(guid);
+		item->set_unread_nowrite(true);
+		item->set_feedurl(feed->rssurl());
+		feed->add_item(item);
+	}
+	rsscache.externalize_rssfeed(feed, false);
+
+	const auto read_guids = [&]() {
+		std::vector<std::string> guids;
+		rsscache.for_each_read_item_guid([&](const std::string& guid) {
+			guids.push_back(guid);
+		});
+		std::sort(guids.begin(), guids.end());
+		return guids;
+	};
+	REQUIRE(read_guids().empty());
+
+	{
+		ScopeTransaction transaction(rsscache);
+		rsscache.mark_items_read_by_guid({"a", "unknown"});
+		rsscache.mark_items_read_by_guid({"c"});
+		rsscache.mark_items_read_by_guid({});
+	}
+	REQUIRE(read_guids() == std::vector<std::string>({"a", "c"}));
+	REQUIRE(rsscache.get_read_item_guids().size() == 2);
+}
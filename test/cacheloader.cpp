@@ -0,0 +1,95 @@
+#include "cacheloader.h"
+
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+#include "rssparser.h"
+#include "test_helpers/tempfile.h"
+
+using namespace newsboat;
+
+TEST_CASE("CacheLoader returns feeds in the order of the urls", "[CacheLoader]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+	cfg.set_configvalue("cache-wal", "yes");
+	Cache rsscache(dbfile.get_path(), &cfg);
+
+	const std::vector<std::string> stored = {
+		"file://data/rss.xml",
+		"file://data/atom10_1.xml",
+	};
+	for (const auto& url : stored) {
+		RssParser parser(url, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	std::vector<std::string> urls;
+	for (unsigned int i = 0; i < 10; ++i) {
+		urls.push_back(stored[i % 2]);
+		urls.push_back("http://example.com/" + std::to_string(i));
+	}
+
+	CacheLoader loader(rsscache, nullptr, 4);
+	// Catch's assertions aren't thread-safe, so only record the calls here
+	std::vector<unsigned int> reported;
+	std::vector<unsigned int> totals;
+	const auto feeds = loader.load(urls,
+	[&](unsigned int loaded, unsigned int total) {
+		reported.push_back(loaded);
+		totals.push_back(total);
+	});
+
+	REQUIRE(feeds.size() == urls.size());
+	for (unsigned int i = 0; i < urls.size(); ++i) {
+		REQUIRE(feeds[i]->rssurl() == urls[i]);
+		if (i % 2 == 0) {
+			REQUIRE(feeds[i]->total_item_count() > 0);
+		} else {
+			REQUIRE(feeds[i]->total_item_count() == 0);
+		}
+	}
+
+	REQUIRE(reported.size() == urls.size());
+	for (unsigned int i = 0; i < reported.size(); ++i) {
+		REQUIRE(reported[i] == i + 1);
+		REQUIRE(totals[i] == urls.size());
+	}
+	REQUIRE(loader.failed_url().empty());
+}
+
+TEST_CASE("CacheLoader returns nothing if there are no urls", "[CacheLoader]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	CacheLoader loader(rsscache, nullptr, 4);
+	unsigned int calls = 0;
+	const auto feeds = loader.load({}, [&](unsigned int, unsigned int) {
+		++calls;
+	});
+	REQUIRE(feeds.empty());
+	REQUIRE(calls == 0);
+}
+
+TEST_CASE("CacheLoader can load feeds lazily", "[CacheLoader]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	const auto url = "file://data/rss.xml";
+	RssParser parser(url, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	CacheLoader loader(rsscache, nullptr, 2, true);
+	const auto feeds = loader.load({url, "http://example.com/"});
+
+	REQUIRE(feeds.size() == 2);
+	REQUIRE_FALSE(feeds[0]->items_loaded());
+	REQUIRE(feeds[0]->total_item_count() == 8);
+	REQUIRE(feeds[1]->total_item_count() == 0);
+}
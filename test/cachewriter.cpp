@@ -0,0 +1,95 @@
+#include "cachewriter.h"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+
+using namespace newsboat;
+
+TEST_CASE("CacheWriter hands every pushed update to the handler",
+	"[CacheWriter]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	std::vector<unsigned int> written;
+	CacheWriter writer(rsscache, [&](const FeedUpdate& update) {
+		written.push_back(update.pos);
+	}, 2);
+
+	for (unsigned int i = 0; i < 10; ++i) {
+		auto feed = std::make_shared<RssFeed>(&rsscache,
+				"http://example.com/" + std::to_string(i));
+		writer.push(FeedUpdate{feed, feed, i, true});
+	}
+	writer.finish();
+
+	REQUIRE(written.size() == 10);
+	for (unsigned int i = 0; i < written.size(); ++i) {
+		REQUIRE(written[i] == i);
+	}
+}
+
+TEST_CASE("CacheWriter accepts updates from several threads at once",
+	"[CacheWriter]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	std::set<unsigned int> written;
+	std::atomic<unsigned int> handler_calls(0);
+	CacheWriter writer(rsscache, [&](const FeedUpdate& update) {
+		// Only the writer thread calls the handler, so no locking is needed
+		written.insert(update.pos);
+		++handler_calls;
+	}, 1);
+
+	const unsigned int threads_count = 4;
+	const unsigned int updates_per_thread = 25;
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < threads_count; ++t) {
+		threads.emplace_back([&, t]() {
+			for (unsigned int i = 0; i < updates_per_thread; ++i) {
+				const unsigned int pos = t * updates_per_thread + i;
+				auto feed = std::make_shared<RssFeed>(&rsscache,
+						"http://example.com/" + std::to_string(pos));
+				writer.push(FeedUpdate{feed, feed, pos, true});
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	writer.finish();
+
+	REQUIRE(handler_calls == threads_count * updates_per_thread);
+	REQUIRE(written.size() == threads_count * updates_per_thread);
+}
+
+TEST_CASE("CacheWriter keeps going if the handler throws", "[CacheWriter]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	unsigned int handled = 0;
+	CacheWriter writer(rsscache, [&](const FeedUpdate& update) {
+		++handled;
+		if (update.pos == 0) {
+			throw std::runtime_error("write failed");
+		}
+	}, 4);
+
+	auto feed = std::make_shared<RssFeed>(&rsscache, "http://example.com/");
+	writer.push(FeedUpdate{feed, feed, 0, true});
+	writer.push(FeedUpdate{feed, feed, 1, true});
+	writer.finish();
+
+	REQUIRE(handled == 2);
+}
@@ -712,6 +712,25 @@ TEST_CASE(
 	}
 }
 
+TEST_CASE("Collects the module and loglevel of each --log-module",
+	"[CliArgsParser]")
+{
+	test_helpers::Opts opts = {
+		"newsboat",
+		"--log-module=reloader:6",
+		"--log-module",
+		"cache:3"
+	};
+	CliArgsParser args(opts.argc(), opts.argv());
+
+	const auto modules = args.log_modules();
+	REQUIRE(modules.size() == 2);
+	REQUIRE(modules[0].first == "reloader");
+	REQUIRE(modules[0].second == Level::DEBUG);
+	REQUIRE(modules[1].first == "cache");
+	REQUIRE(modules[1].second == Level::ERROR);
+}
+
 TEST_CASE(
 	"Sets `display_msg` and asks to exit with failure if argument to "
 	"-l/--log-level is outside of [1; 6]",
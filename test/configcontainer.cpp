@@ -708,3 +708,76 @@ TEST_CASE("get_article_sort_strategy() returns ascending direction "
 		REQUIRE(cfg.get_article_sort_strategy().sd == SortDirection::ASC);
 	}
 }
+
+TEST_CASE("snapshot() holds the default values of its settings",
+	"[ConfigContainer]")
+{
+	ConfigContainer cfg;
+	const auto& snapshot = cfg.snapshot();
+
+	REQUIRE(snapshot.max_items == 0);
+	REQUIRE(snapshot.keep_articles_days == 0);
+	REQUIRE(snapshot.ignore_mode == IgnoreMode::DOWNLOAD);
+	REQUIRE(snapshot.show_read_articles);
+	REQUIRE_FALSE(snapshot.always_display_description);
+	REQUIRE_FALSE(snapshot.download_full_page);
+	REQUIRE(snapshot.datetime_format == "%b %d");
+}
+
+TEST_CASE("snapshot() follows changes to the settings", "[ConfigContainer]")
+{
+	ConfigContainer cfg;
+	const auto& old_snapshot = cfg.snapshot();
+
+	SECTION("set_configvalue()") {
+		cfg.set_configvalue("max-items", "100");
+		cfg.set_configvalue("ignore-mode", "display");
+		cfg.set_configvalue("datetime-format", "%F");
+
+		REQUIRE(cfg.snapshot().max_items == 100);
+		REQUIRE(cfg.snapshot().ignore_mode == IgnoreMode::DISPLAY);
+		REQUIRE(cfg.snapshot().datetime_format == "%F");
+
+		// The snapshot that was replaced is still there, unchanged
+		REQUIRE(old_snapshot.max_items == 0);
+		REQUIRE(old_snapshot.datetime_format == "%b %d");
+	}
+
+	SECTION("handle_action()") {
+		cfg.handle_action("keep-articles-days", {"30"});
+		REQUIRE(cfg.snapshot().keep_articles_days == 30);
+	}
+
+	SECTION("toggle() and reset_to_default()") {
+		cfg.toggle("show-read-articles");
+		REQUIRE_FALSE(cfg.snapshot().show_read_articles);
+
+		cfg.reset_to_default("show-read-articles");
+		REQUIRE(cfg.snapshot().show_read_articles);
+	}
+
+	SECTION("Other settings don't replace the snapshot") {
+		cfg.set_configvalue("browser", "firefox");
+		REQUIRE(&cfg.snapshot() == &old_snapshot);
+	}
+}
+
+TEST_CASE("on_change() listeners are told which settings changed",
+	"[ConfigContainer]")
+{
+	ConfigContainer cfg;
+	std::vector<std::string> changed;
+	cfg.on_change([&changed](const std::string& key) {
+		changed.push_back(key);
+	});
+
+	cfg.set_configvalue("reload-time", "30");
+	cfg.handle_action("auto-reload", {"yes"});
+	cfg.toggle("auto-reload");
+	cfg.reset_to_default("reload-time");
+
+	const std::vector<std::string> expected = {
+		"reload-time", "auto-reload", "auto-reload", "reload-time"
+	};
+	REQUIRE(changed == expected);
+}
@@ -0,0 +1,108 @@
+#include "contentcodec.h"
+
+#include <stdexcept>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+std::string article(unsigned int n)
+{
+	return "<div class=\"entry-content\"><p>Posted by the editorial team</p>"
+		"<p>Article number " + std::to_string(n) + " talks about things.</p>"
+		"<footer><a href=\"https://example.com/subscribe\">Subscribe to "
+		"our newsletter</a></footer></div>";
+}
+
+}
+
+TEST_CASE("ContentCodec::decompress returns what compress() was given",
+	"[ContentCodec]")
+{
+	ContentCodec codec;
+	const std::string text = "Ünïcödé all over " + std::string(500, 'a');
+
+	SECTION("without a dictionary") {
+		const auto data = codec.compress(text);
+		REQUIRE(data.length() < text.length());
+		REQUIRE(codec.decompress(data.data(), data.length()) == text);
+	}
+
+	SECTION("with a dictionary") {
+		codec.add_dictionary(1, "all over the place");
+		const auto data = codec.compress(text, 1);
+		REQUIRE(codec.decompress(data.data(), data.length()) == text);
+	}
+
+	SECTION("empty text") {
+		const auto data = codec.compress("");
+		REQUIRE(codec.decompress(data.data(), data.length()).empty());
+	}
+}
+
+TEST_CASE("ContentCodec reports the length of compressed text without "
+	"decompressing it",
+	"[ContentCodec]")
+{
+	ContentCodec codec;
+	const std::string text = "Größe";
+	const auto data = codec.compress(text);
+
+	REQUIRE(ContentCodec::decompressed_size(data.data(), data.length()) == 7);
+	REQUIRE(ContentCodec::decompressed_length(data.data(), data.length()) == 5);
+	REQUIRE(ContentCodec::decompressed_size(text.data(), text.length()) == 0);
+}
+
+TEST_CASE("ContentCodec::decompress throws on data it can't decompress",
+	"[ContentCodec]")
+{
+	ContentCodec codec;
+
+	SECTION("not compressed at all") {
+		const std::string text = "plain text";
+		REQUIRE_THROWS_AS(codec.decompress(text.data(), text.length()),
+			std::runtime_error);
+	}
+
+	SECTION("unknown dictionary") {
+		ContentCodec other;
+		other.add_dictionary(7, "dictionary");
+		const auto data = other.compress("some text", 7);
+		REQUIRE_THROWS_AS(codec.decompress(data.data(), data.length()),
+			std::runtime_error);
+	}
+
+	SECTION("truncated") {
+		const auto data = codec.compress(std::string(1000, 'z'));
+		REQUIRE_THROWS_AS(codec.decompress(data.data(), data.length() - 1),
+			std::runtime_error);
+	}
+}
+
+TEST_CASE("ContentCodec::train_dictionary picks up text shared by samples",
+	"[ContentCodec]")
+{
+	std::vector<std::string> samples;
+	for (unsigned int i = 0; i < 20; ++i) {
+		samples.push_back(article(i));
+	}
+
+	const auto dictionary = ContentCodec::train_dictionary(samples, 1024);
+	REQUIRE_FALSE(dictionary.empty());
+	REQUIRE(dictionary.length() <= 1024);
+	REQUIRE(dictionary.find("Subscribe to our newsletter") != std::string::npos);
+
+	ContentCodec codec;
+	codec.add_dictionary(1, dictionary);
+	const auto text = article(100);
+	const auto with_dictionary = codec.compress(text, 1);
+	REQUIRE(with_dictionary.length() < codec.compress(text).length());
+	REQUIRE(codec.decompress(with_dictionary.data(), with_dictionary.length())
+		== text);
+
+	SECTION("nothing in common") {
+		REQUIRE(ContentCodec::train_dictionary({"abc", "xyz"}, 1024).empty());
+	}
+}
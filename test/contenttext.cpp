@@ -0,0 +1,42 @@
+#include "contenttext.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("content_text() strips the markup off HTML content",
+	"[content_text]")
+{
+	REQUIRE(content_text("<p>Hello, <b>world</b>!</p>", "text/html")
+		== "Hello, world!");
+	REQUIRE(content_text("Tom &amp; Jerry &lt;3", "html") == "Tom & Jerry <3");
+
+	SECTION("an empty type is taken as HTML") {
+		REQUIRE(content_text("<i>an</i> article", "") == "an article");
+	}
+
+	SECTION("block-level tags keep words apart") {
+		REQUIRE(content_text("<p>one</p><p>two</p>three<br/>four",
+				"text/html") == "one two three four");
+		REQUIRE(content_text("<ul><li>a</li><li>b</li></ul>", "text/html")
+			== "a b");
+	}
+
+	SECTION("scripts and styles aren't text") {
+		REQUIRE(content_text("<style>p { color: red; }</style>shown"
+				"<script>var hidden = 1;</script>", "text/html") == "shown");
+	}
+
+	SECTION("attributes are left out") {
+		REQUIRE(content_text("<a href=\"https://example.com\">link</a>",
+				"application/xhtml+xml") == "link");
+	}
+}
+
+TEST_CASE("content_text() leaves content of other types alone",
+	"[content_text]")
+{
+	const std::string text = "<p>not a tag</p> &amp;";
+	REQUIRE(content_text(text, "text/plain") == text);
+	REQUIRE(content_text("plain", "text/html") == "plain");
+}
@@ -1,15 +1,21 @@
 #include "controller.h"
 
+#include <fstream>
 #include <string>
 #include <unistd.h>
 
+#include "cliargsparser.h"
 #include "configpaths.h"
 #include "cache.h"
+#include "feedsnapshot.h"
 #include "utils.h"
+#include "rssfeed.h"
 #include "rssitem.h"
+#include "rssparser.h"
 #include "3rd-party/catch.hpp"
 #include "test_helpers/tempdir.h"
 #include "test_helpers/envvar.h"
+#include "test_helpers/opts.h"
 
 using namespace newsboat;
 
@@ -46,3 +52,46 @@ TEST_CASE("write_item correctly parses path", "[Controller]")
 	REQUIRE(::access(std::string(home_dir + name).c_str(), R_OK) == 0);
 	REQUIRE(::access(std::string(save_path + name).c_str(), R_OK) == 0);
 }
+
+TEST_CASE("The cleanup that a quit starts in the background leaves a "
+	"snapshot for the next start", "[Controller]")
+{
+	test_helpers::TempDir tmp;
+	test_helpers::EnvVar home("HOME");
+	home.set(tmp.get_path());
+	const auto feedurl = "file://data/rss.xml";
+	const auto url_file = tmp.get_path() + "urls";
+	const auto config_file = tmp.get_path() + "config";
+	const auto cache_file = tmp.get_path() + "cache.db";
+	std::ofstream(url_file) << feedurl << std::endl;
+	// With cleanup-on-quit and cleanup-in-background left at their
+	// defaults, quitting leaves the cleanup to `newsboat --cleanup`
+	std::ofstream(config_file) << "lazy-load-articles yes" << std::endl;
+
+	{
+		ConfigContainer cfg;
+		Cache rsscache(cache_file, &cfg);
+		RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+		rsscache.externalize_rssfeed(parser.parse(), false);
+	}
+
+	{
+		test_helpers::Opts opts({"newsboat", "--cleanup", "-u", url_file,
+				"-c", cache_file, "-C", config_file});
+		CliArgsParser args(opts.argc(), opts.argv());
+		ConfigPaths paths;
+		REQUIRE(paths.initialized());
+		paths.process_args(args);
+		Controller c(paths);
+		REQUIRE(c.run(args) == EXIT_SUCCESS);
+	}
+
+	ConfigContainer cfg;
+	Cache rsscache(cache_file, &cfg);
+	const FeedSnapshot snapshot(cache_file + ".snapshot",
+		rsscache.snapshot_token());
+	REQUIRE(snapshot.valid());
+	const auto feed = snapshot.make_feed(rsscache, feedurl);
+	REQUIRE(feed != nullptr);
+	REQUIRE(feed->total_item_count() == 8);
+}
@@ -0,0 +1,118 @@
+#include "controlsocket.h"
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempfile.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// Polls until a command arrives, for a few seconds at most.
+std::vector<ControlSocket::Request> wait_for_requests(ControlSocket& socket)
+{
+	for (int i = 0; i < 50; ++i) {
+		const auto requests = socket.poll(100);
+		if (!requests.empty()) {
+			return requests;
+		}
+	}
+	return {};
+}
+
+}
+
+TEST_CASE("ControlSocket::send() fails if nobody listens", "[ControlSocket]")
+{
+	test_helpers::TempFile tmp;
+
+	std::string answer;
+	REQUIRE_FALSE(ControlSocket::send(tmp.get_path(), "reload", answer));
+}
+
+TEST_CASE("ControlSocket passes a command and its answer on",
+	"[ControlSocket]")
+{
+	test_helpers::TempFile tmp;
+	ControlSocket socket(tmp.get_path());
+
+	struct stat sb;
+	REQUIRE(::stat(tmp.get_path().c_str(), &sb) == 0);
+	REQUIRE((sb.st_mode & 0077) == 0);
+
+	std::string answer;
+	auto client = std::async(std::launch::async, [&]() {
+		return ControlSocket::send(tmp.get_path(), "print-unread", answer);
+	});
+
+	const auto requests = wait_for_requests(socket);
+	REQUIRE(requests.size() == 1);
+	REQUIRE(requests[0].command == "print-unread");
+
+	// The client keeps waiting until it's answered
+	REQUIRE(client.wait_for(std::chrono::milliseconds(100)) ==
+		std::future_status::timeout);
+
+	socket.reply(requests[0], "OK\n42 unread articles\n");
+	REQUIRE(client.get());
+	REQUIRE(answer == "OK\n42 unread articles\n");
+}
+
+TEST_CASE("ControlSocket answers several waiting clients separately",
+	"[ControlSocket]")
+{
+	test_helpers::TempFile tmp;
+	ControlSocket socket(tmp.get_path());
+
+	std::string first_answer;
+	std::string second_answer;
+	auto first = std::async(std::launch::async, [&]() {
+		return ControlSocket::send(tmp.get_path(), "reload", first_answer);
+	});
+	auto second = std::async(std::launch::async, [&]() {
+		return ControlSocket::send(tmp.get_path(), "reload", second_answer);
+	});
+
+	std::vector<ControlSocket::Request> requests;
+	while (requests.size() < 2) {
+		const auto arrived = wait_for_requests(socket);
+		REQUIRE_FALSE(arrived.empty());
+		requests.insert(requests.end(), arrived.begin(), arrived.end());
+	}
+	REQUIRE(requests[0].client != requests[1].client);
+
+	socket.reply(requests[1], "second\n");
+	socket.reply(requests[0], "first\n");
+	REQUIRE(first.get());
+	REQUIRE(second.get());
+	const bool one_each = (first_answer == "first\n"
+			&& second_answer == "second\n")
+		|| (first_answer == "second\n" && second_answer == "first\n");
+	REQUIRE(one_each);
+}
+
+TEST_CASE("ControlSocket removes the socket when it's destroyed",
+	"[ControlSocket]")
+{
+	test_helpers::TempFile tmp;
+	{
+		ControlSocket socket(tmp.get_path());
+		REQUIRE(::access(tmp.get_path().c_str(), F_OK) == 0);
+	}
+	REQUIRE(::access(tmp.get_path().c_str(), F_OK) != 0);
+
+	std::string answer;
+	REQUIRE_FALSE(ControlSocket::send(tmp.get_path(), "reload", answer));
+}
+
+TEST_CASE("ControlSocket throws if the path is too long", "[ControlSocket]")
+{
+	const std::string path = "/tmp/" + std::string(200, 'x');
+	REQUIRE_THROWS_AS(ControlSocket(path), std::runtime_error);
+}
@@ -0,0 +1,88 @@
+#include "curlhandlepool.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace {
+
+size_t append_to_string(char* data, size_t size, size_t nmemb, void* userp)
+{
+	static_cast<std::string*>(userp)->append(data, size * nmemb);
+	return size * nmemb;
+}
+
+} // namespace
+
+TEST_CASE("CurlHandlePool hands out the handles it got back, with their "
+	"options reset", "[CurlHandlePool]")
+{
+	CurlHandlePool pool;
+	CURL* first = nullptr;
+	{
+		const auto handle = pool.acquire();
+		first = handle->ptr();
+		curl_easy_setopt(handle->ptr(), CURLOPT_PRIVATE, "leftover");
+	}
+	REQUIRE(pool.idle_count() == 1);
+
+	const auto handle = pool.acquire();
+	REQUIRE(handle->ptr() == first);
+	REQUIRE(pool.idle_count() == 0);
+
+	char* leftover = nullptr;
+	curl_easy_getinfo(handle->ptr(), CURLINFO_PRIVATE, &leftover);
+	REQUIRE(leftover == nullptr);
+
+	SECTION("handles in use aren't handed out twice") {
+		const auto other = pool.acquire();
+		REQUIRE(other->ptr() != handle->ptr());
+	}
+}
+
+TEST_CASE("CurlHandlePool keeps only so many idle handles", "[CurlHandlePool]")
+{
+	CurlHandlePool pool(2);
+	{
+		std::vector<CurlHandlePool::Lease> leases;
+		for (int i = 0; i < 5; ++i) {
+			leases.push_back(pool.acquire());
+		}
+	}
+	REQUIRE(pool.idle_count() == 2);
+}
+
+TEST_CASE("CurlHandlePool's handles can transfer from several threads at once",
+	"[CurlHandlePool]")
+{
+	const std::string url = "file://" + utils::getcwd() + "/data/rss.xml";
+
+	CurlHandlePool pool;
+	std::vector<std::string> bodies(4);
+	std::vector<std::thread> threads;
+	for (auto& body : bodies) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 2; ++i) {
+				body.clear();
+				const auto handle = pool.acquire();
+				curl_easy_setopt(handle->ptr(), CURLOPT_URL, url.c_str());
+				curl_easy_setopt(handle->ptr(), CURLOPT_WRITEFUNCTION,
+					append_to_string);
+				curl_easy_setopt(handle->ptr(), CURLOPT_WRITEDATA, &body);
+				curl_easy_perform(handle->ptr());
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (const auto& body : bodies) {
+		REQUIRE(body.find("<rss") != std::string::npos);
+	}
+}
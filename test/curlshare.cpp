@@ -0,0 +1,236 @@
+#include "curlshare.h"
+
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "3rd-party/catch.hpp"
+#include "3rd-party/json.hpp"
+#include "curlhandle.h"
+#include "test_helpers/replayserver.h"
+#include "test_helpers/tempfile.h"
+#include "utils.h"
+
+using namespace newsboat;
+using test_helpers::ReplayArchive;
+using test_helpers::ReplayServer;
+
+namespace {
+
+size_t append_to_string(char* data, size_t size, size_t nmemb, void* userp)
+{
+	static_cast<std::string*>(userp)->append(data, size * nmemb);
+	return size * nmemb;
+}
+
+std::string fetch(CurlHandle& handle, const std::string& url)
+{
+	std::string body;
+	curl_easy_setopt(handle.ptr(), CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEFUNCTION, append_to_string);
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, &body);
+	if (curl_easy_perform(handle.ptr()) != CURLE_OK) {
+		return "";
+	}
+	return body;
+}
+
+ReplayArchive feed_archive()
+{
+	ReplayArchive::Response response;
+	response.url = "http://feeds.invalid/feed.xml";
+	response.body = "<rss version=\"2.0\"><channel></channel></rss>";
+
+	ReplayArchive archive;
+	archive.responses.push_back(response);
+	return archive;
+}
+
+/// The port of a URL like http://127.0.0.1:port/path.
+long port_of(const std::string& url)
+{
+	const auto colon = url.rfind(':');
+	return std::stol(url.substr(colon + 1));
+}
+
+/// \a url with its host replaced by \a host.
+std::string with_host(const std::string& url, const std::string& host)
+{
+	return "http://" + host + url.substr(url.rfind(':'));
+}
+
+void write_address(const std::string& path, long port, time_t expires)
+{
+	std::ofstream f(path);
+	f << nlohmann::json{
+		{
+			"hosts", {
+				{
+					{"host", "feeds.invalid"},
+					{"port", port},
+					{"address", "127.0.0.1"},
+					{"expires", expires},
+				}
+			}
+		},
+	}.dump();
+}
+
+} // namespace
+
+TEST_CASE("Handles that use a CurlShare can transfer from several threads "
+	"at once, and keep using it after reset()", "[CurlShare]")
+{
+	const std::string url = "file://" + utils::getcwd() + "/data/rss.xml";
+
+	CurlShare share;
+	std::vector<std::string> bodies(4);
+	std::vector<std::thread> threads;
+	for (auto& body : bodies) {
+		threads.emplace_back([&]() {
+			CurlHandle handle;
+			handle.set_share(share);
+			if (fetch(handle, url).empty()) {
+				return;
+			}
+			handle.reset();
+			body = fetch(handle, url);
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (const auto& body : bodies) {
+		REQUIRE(body.find("<rss") != std::string::npos);
+	}
+}
+
+TEST_CASE("use_saved_address() makes the handle connect to the address "
+	"that load() read for the host", "[CurlShare]")
+{
+	ReplayServer server(feed_archive());
+	const std::string url = server.url_for(0);
+	test_helpers::TempFile connections;
+
+	CurlShare share;
+	CurlHandle handle;
+	handle.set_share(share);
+
+	SECTION("Addresses that haven't expired are used") {
+		write_address(connections.get_path(), port_of(url), ::time(nullptr) + 60);
+		share.load(connections.get_path());
+		share.use_saved_address(handle.ptr(), with_host(url, "feeds.invalid"));
+
+		const auto body = fetch(handle, with_host(url, "feeds.invalid"));
+		REQUIRE(body.find("<rss") != std::string::npos);
+	}
+
+	SECTION("Expired addresses are ignored") {
+		write_address(connections.get_path(), port_of(url), ::time(nullptr) - 60);
+		share.load(connections.get_path());
+		share.use_saved_address(handle.ptr(), with_host(url, "feeds.invalid"));
+
+		REQUIRE(fetch(handle, with_host(url, "feeds.invalid")).empty());
+	}
+
+	SECTION("A missing file is ignored") {
+		share.load(connections.get_path());
+		share.use_saved_address(handle.ptr(), with_host(url, "feeds.invalid"));
+
+		REQUIRE(fetch(handle, with_host(url, "feeds.invalid")).empty());
+	}
+}
+
+TEST_CASE("save() writes the addresses that remember_address() noted",
+	"[CurlShare]")
+{
+	ReplayServer server(feed_archive());
+	const std::string url = with_host(server.url_for(0), "localhost");
+	test_helpers::TempFile connections;
+
+	CurlShare share;
+	CurlHandle handle;
+	handle.set_share(share);
+	curl_easy_setopt(handle.ptr(), CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+	REQUIRE_FALSE(fetch(handle, url).empty());
+	share.remember_address(handle.ptr());
+	REQUIRE(share.save(connections.get_path()));
+
+	std::ifstream f(connections.get_path());
+	nlohmann::json saved;
+	f >> saved;
+	REQUIRE(saved["hosts"].size() == 1);
+	const auto& host = saved["hosts"][0];
+	REQUIRE(host["host"] == "localhost");
+	REQUIRE(host["address"] == "127.0.0.1");
+	REQUIRE(host["port"] == port_of(url));
+	REQUIRE(host["expires"].get<time_t>() > ::time(nullptr));
+}
+
+TEST_CASE("save() writes a file only the user can read, without following "
+	"links someone put next to it", "[CurlShare]")
+{
+	test_helpers::TempFile connections;
+	test_helpers::TempFile target;
+	{
+		std::ofstream f(target.get_path());
+		f << "untouched\n";
+	}
+	const std::string planted = connections.get_path() + ".tmp";
+	REQUIRE(::symlink(target.get_path().c_str(), planted.c_str()) == 0);
+
+	CurlShare share;
+	REQUIRE(share.save(connections.get_path()));
+
+	struct stat st;
+	REQUIRE(::lstat(connections.get_path().c_str(), &st) == 0);
+	REQUIRE(S_ISREG(st.st_mode));
+	REQUIRE((st.st_mode & 0777) == 0600);
+
+	std::ifstream f(target.get_path());
+	const std::string contents((std::istreambuf_iterator<char>(f)),
+		std::istreambuf_iterator<char>());
+	REQUIRE(contents == "untouched\n");
+
+	::unlink(planted.c_str());
+}
+
+TEST_CASE("save_cookies() writes the cookies load_cookies() read, for handles "
+	"that keep theirs in the share", "[CurlShare]")
+{
+	test_helpers::TempFile cookies;
+	{
+		std::ofstream f(cookies.get_path());
+		f << "# Netscape HTTP Cookie File\n"
+			"example.com\tFALSE\t/\tFALSE\t0\tsession\tabc\n";
+	}
+
+	CurlShare share;
+	REQUIRE_FALSE(share.keeps_cookies());
+	share.load_cookies(cookies.get_path());
+	REQUIRE(share.keeps_cookies());
+
+	CurlHandle handle;
+	handle.set_share(share);
+	handle.use_cookies(cookies.get_path());
+	curl_slist* list = nullptr;
+	curl_easy_getinfo(handle.ptr(), CURLINFO_COOKIELIST, &list);
+	REQUIRE(list != nullptr);
+	REQUIRE(std::string(list->data).find("\tsession\tabc") != std::string::npos);
+	REQUIRE(list->next == nullptr);
+	curl_slist_free_all(list);
+
+	std::ofstream(cookies.get_path(), std::ios::trunc);
+	share.save_cookies();
+
+	std::ifstream f(cookies.get_path());
+	const std::string contents((std::istreambuf_iterator<char>(f)),
+		std::istreambuf_iterator<char>());
+	REQUIRE(contents.find("\tsession\tabc") != std::string::npos);
+}
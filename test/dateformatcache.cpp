@@ -0,0 +1,92 @@
+#include "dateformatcache.h"
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/envvar.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+TEST_CASE("DateFormatCache formats the same as mt_strf_localtime()",
+	"[DateFormatCache]")
+{
+	test_helpers::TzEnvVar tzEnv;
+	tzEnv.set("Asia/Kolkata");
+
+	DateFormatCache cache;
+
+	for (const std::string format : {
+			"%b %d", "%H:%M", "%Y-%m-%d %T", "%c", "%s"
+		}) {
+		for (const time_t t : {
+				time_t(0), time_t(59), time_t(60), time_t(1234567890),
+				time_t(1234567899), time_t(-1), time_t(-61)
+			}) {
+			INFO("format: " << format << ", t: " << t);
+			REQUIRE(cache.format(format, t) == utils::mt_strf_localtime(format, t));
+		}
+	}
+}
+
+TEST_CASE("DateFormatCache shares an entry between timestamps that the "
+	"format doesn't tell apart",
+	"[DateFormatCache]")
+{
+	DateFormatCache cache;
+
+	SECTION("without seconds, timestamps of the same minute share one") {
+		cache.format("%H:%M", 1234567860);
+		cache.format("%H:%M", 1234567899);
+		REQUIRE(cache.size() == 1);
+
+		cache.format("%H:%M", 1234567920);
+		REQUIRE(cache.size() == 2);
+	}
+
+	SECTION("with seconds, each timestamp gets its own") {
+		cache.format("%H:%M:%S", 1234567860);
+		cache.format("%H:%M:%S", 1234567861);
+		REQUIRE(cache.size() == 2);
+	}
+
+	SECTION("a new format drops what was formatted with the old one") {
+		cache.format("%H:%M", 1234567860);
+		cache.format("%H:%M", 1234567920);
+		REQUIRE(cache.size() == 2);
+
+		REQUIRE(cache.format("%b %d", 1234567860) ==
+			utils::mt_strf_localtime("%b %d", 1234567860));
+		REQUIRE(cache.size() == 1);
+	}
+}
+
+TEST_CASE("DateFormatCache starts over once it holds max_entries",
+	"[DateFormatCache]")
+{
+	DateFormatCache cache(2);
+
+	cache.format("%T", 1);
+	cache.format("%T", 2);
+	REQUIRE(cache.size() == 2);
+
+	REQUIRE(cache.format("%T", 3) == utils::mt_strf_localtime("%T", 3));
+	REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("DateFormatCache::resolution_of() is 1 only for formats that show "
+	"seconds",
+	"[DateFormatCache]")
+{
+	REQUIRE(DateFormatCache::resolution_of("%b %d") == 60);
+	REQUIRE(DateFormatCache::resolution_of("%H:%M") == 60);
+	REQUIRE(DateFormatCache::resolution_of("%%S") == 60);
+	REQUIRE(DateFormatCache::resolution_of("") == 60);
+	REQUIRE(DateFormatCache::resolution_of("%") == 60);
+
+	REQUIRE(DateFormatCache::resolution_of("%S") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%T") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%c") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%s") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%Ec") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%OS") == 1);
+	REQUIRE(DateFormatCache::resolution_of("%_2S") == 1);
+}
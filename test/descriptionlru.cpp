@@ -0,0 +1,111 @@
+#include "descriptionlru.h"
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+#include "rssparser.h"
+
+using namespace newsboat;
+
+TEST_CASE("DescriptionLru drops the least recently used descriptions once "
+	"it's full",
+	"[DescriptionLru]")
+{
+	RssItem first(nullptr);
+	RssItem second(nullptr);
+	RssItem third(nullptr);
+	const Description description{std::string(1000, 'x'), "text/plain"};
+
+	// Room for two descriptions, but not for three
+	DescriptionLru lru(2500 + 2 * sizeof(Description) + 2 * sizeof(void*));
+	lru.put(&first, description);
+	lru.put(&second, description);
+	REQUIRE(lru.get(&first).has_value());
+
+	lru.put(&third, description);
+	REQUIRE(lru.contains(&first));
+	REQUIRE_FALSE(lru.contains(&second));
+	REQUIRE(lru.contains(&third));
+
+	REQUIRE_FALSE(lru.get(&second).has_value());
+	const auto stats = lru.stats();
+	REQUIRE(stats.hits == 1);
+	REQUIRE(stats.misses == 1);
+	REQUIRE(stats.evictions == 1);
+	REQUIRE(stats.entries == 2);
+
+	SECTION("erase() forgets a description") {
+		lru.erase(&first);
+		REQUIRE_FALSE(lru.contains(&first));
+		REQUIRE(lru.stats().entries == 1);
+	}
+
+	SECTION("lowering the limit evicts right away") {
+		lru.set_max_bytes(1);
+		REQUIRE(lru.stats().entries == 1);
+		REQUIRE(lru.contains(&third));
+	}
+
+	SECTION("a limit of 0 keeps everything") {
+		lru.set_max_bytes(0);
+		lru.put(&second, description);
+		REQUIRE(lru.stats().entries == 3);
+	}
+}
+
+TEST_CASE("DescriptionLru keeps the plain text along with a description",
+	"[DescriptionLru]")
+{
+	RssItem item(nullptr);
+	RssItem other(nullptr);
+	DescriptionLru lru(0);
+	lru.put(&item, {"<p>text</p>", "text/html"});
+	const auto bytes = lru.stats().bytes;
+
+	lru.set_plain_text(&item, std::make_shared<const std::string>("text"));
+	lru.set_plain_text(&other, std::make_shared<const std::string>("other"));
+
+	const auto description = lru.get(&item);
+	REQUIRE(description.has_value());
+	REQUIRE(description->plain_text != nullptr);
+	REQUIRE(*description->plain_text == "text");
+	REQUIRE(lru.stats().bytes > bytes);
+	REQUIRE_FALSE(lru.contains(&other));
+
+	SECTION("a new description comes without it") {
+		lru.put(&item, {"<p>changed</p>", "text/html"});
+		REQUIRE(lru.get(&item)->plain_text == nullptr);
+	}
+}
+
+TEST_CASE("Articles read their descriptions again after they were evicted",
+	"[DescriptionLru]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	auto& lru = DescriptionLru::shared();
+	const auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto items = feed->items();
+	const auto first = items[0]->description().text;
+	REQUIRE_FALSE(first.empty());
+	REQUIRE(items[0]->description_loaded());
+
+	lru.set_max_bytes(1);
+	for (const auto& item : items) {
+		item->description();
+	}
+	REQUIRE_FALSE(items[0]->description_loaded());
+	REQUIRE(items[0]->description().text == first);
+	lru.set_max_bytes(0);
+
+	// Descriptions that didn't come from the cache are never evicted
+	RssItem item(&rsscache);
+	item.set_description("Not in the cache", "text/plain");
+	REQUIRE_FALSE(lru.contains(&item));
+	REQUIRE(item.description().text == "Not in the cache");
+}
@@ -0,0 +1,77 @@
+#include "descriptionprefetcher.h"
+
+#include <chrono>
+#include <thread>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+#include "rssparser.h"
+
+using namespace newsboat;
+
+TEST_CASE("DescriptionPrefetcher reads descriptions of unloaded items",
+	"[DescriptionPrefetcher]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	const auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto items = feed->items();
+	REQUIRE(items.size() == 8);
+	for (const auto& item : items) {
+		REQUIRE_FALSE(item->description_loaded());
+	}
+
+	DescriptionPrefetcher prefetcher(&rsscache);
+	prefetcher.prefetch({items[2], items[5]});
+
+	const auto deadline = std::chrono::steady_clock::now()
+		+ std::chrono::seconds(10);
+	while (!(items[2]->description_loaded() && items[5]->description_loaded())
+		&& std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	REQUIRE(items[2]->description_loaded());
+	REQUIRE(items[5]->description_loaded());
+	REQUIRE(items[2]->description().text
+		== rsscache.fetch_description(*items[2]));
+	REQUIRE_FALSE(items[0]->description_loaded());
+}
+
+TEST_CASE("Unloaded items read their description from the cache on demand",
+	"[DescriptionPrefetcher]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feedurl = "file://data/rss.xml";
+	RssParser parser(feedurl, &rsscache, &cfg, nullptr);
+	rsscache.externalize_rssfeed(parser.parse(), false);
+
+	const auto feed = rsscache.internalize_rssfeed(feedurl, nullptr);
+	const auto item = feed->items()[0];
+	const auto expected = rsscache.fetch_description(*item);
+	REQUIRE_FALSE(expected.empty());
+
+	REQUIRE(item->description().text == expected);
+	REQUIRE(item->description_loaded());
+
+	item->unload();
+	REQUIRE_FALSE(item->description_loaded());
+	REQUIRE(item->description().text == expected);
+}
+
+TEST_CASE("DescriptionPrefetcher without a cache doesn't read anything",
+	"[DescriptionPrefetcher]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto item = std::make_shared<RssItem>(&rsscache);
+
+	DescriptionPrefetcher prefetcher(nullptr);
+	REQUIRE_NOTHROW(prefetcher.prefetch({item}));
+}
@@ -184,3 +184,44 @@ TEST_CASE("status_text() does not contain obvious copy-paste errors",
 		REQUIRE(status_values.size() == status_texts.size());
 	}
 }
+
+TEST_CASE("Copies of a Download have the same state", "[Download]")
+{
+	int calls = 0;
+	Download d([&calls]() {
+		++calls;
+	});
+	d.set_url("https://example.com/episode.mp3");
+	d.set_filename("episode.mp3");
+	d.set_offset(100);
+	d.set_progress(50, 200);
+	d.set_kbps(12.5);
+	d.set_status(DlStatus::FAILED, "timeout");
+
+	auto check = [](const Download& copy) {
+		REQUIRE(copy.url() == "https://example.com/episode.mp3");
+		REQUIRE(copy.filename() == "episode.mp3");
+		REQUIRE(copy.current_size() == 150);
+		REQUIRE(copy.total_size() == 300);
+		REQUIRE(copy.kbps() == 12.5);
+		REQUIRE(copy.status() == DlStatus::FAILED);
+		REQUIRE(copy.status_msg() == "timeout");
+	};
+
+	SECTION("copy-constructed") {
+		Download copy(d);
+		check(copy);
+
+		copy.set_status(DlStatus::QUEUED);
+		REQUIRE(calls == 3);
+	}
+
+	SECTION("copy-assigned") {
+		Download copy([]() {});
+		copy = d;
+		check(copy);
+
+		copy.set_status(DlStatus::QUEUED);
+		REQUIRE(calls == 3);
+	}
+}
@@ -0,0 +1,117 @@
+#include "downloadmanager.h"
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "configcontainer.h"
+#include "test_helpers/tempdir.h"
+#include "utils.h"
+
+using namespace podboat;
+
+namespace {
+
+/// Waits up to ten seconds for \a dl to get \a status.
+bool wait_for_status(const Download& dl, DlStatus status)
+{
+	for (int i = 0; i < 1000; ++i) {
+		if (dl.status() == status) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+std::string file_contents(const std::string& path)
+{
+	std::ifstream file(path);
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+void set_up(Download& dl, const std::string& file,
+	const test_helpers::TempDir& tmp)
+{
+	dl.set_url("file://" + newsboat::utils::getcwd() + "/data/" + file);
+	dl.set_filename(tmp.get_path() + file);
+}
+
+} // namespace
+
+TEST_CASE("DownloadManager performs the queued downloads", "[DownloadManager]")
+{
+	test_helpers::TempDir tmp;
+	newsboat::ConfigContainer cfg;
+	cfg.set_configvalue("max-downloads", "2");
+
+	const std::vector<std::string> files = {
+		"rss.xml", "atom10_1.xml", "rss20_1.xml"
+	};
+	std::deque<Download> downloads;
+	for (const auto& file : files) {
+		downloads.emplace_back([]() {});
+		set_up(downloads.back(), file, tmp);
+	}
+	downloads.emplace_back([]() {});
+	set_up(downloads.back(), "no-such-file.xml", tmp);
+
+	SpeedSchedule schedule;
+	DownloadManager manager(cfg, schedule);
+	for (auto& dl : downloads) {
+		manager.enqueue(dl);
+	}
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		INFO("download of " << files[i]);
+		REQUIRE(wait_for_status(downloads[i], DlStatus::READY));
+		REQUIRE(file_contents(downloads[i].filename())
+			== file_contents("data/" + files[i]));
+	}
+	REQUIRE(wait_for_status(downloads[3], DlStatus::FAILED));
+}
+
+TEST_CASE("DownloadManager skips downloads that aren't queued anymore",
+	"[DownloadManager]")
+{
+	test_helpers::TempDir tmp;
+	newsboat::ConfigContainer cfg;
+
+	Download skipped([]() {});
+	set_up(skipped, "rss.xml", tmp);
+	skipped.set_status(DlStatus::DELETED);
+	Download queued([]() {});
+	set_up(queued, "atom10_1.xml", tmp);
+
+	SpeedSchedule schedule;
+	DownloadManager manager(cfg, schedule);
+	manager.enqueue(skipped);
+	manager.enqueue(queued);
+
+	REQUIRE(wait_for_status(queued, DlStatus::READY));
+	REQUIRE(skipped.status() == DlStatus::DELETED);
+}
+
+TEST_CASE("DownloadManager starts downloads by hand whatever their status",
+	"[DownloadManager]")
+{
+	test_helpers::TempDir tmp;
+	newsboat::ConfigContainer cfg;
+
+	Download dl([]() {});
+	set_up(dl, "rss.xml", tmp);
+	dl.set_status(DlStatus::FAILED);
+
+	SpeedSchedule schedule;
+	DownloadManager manager(cfg, schedule);
+	manager.start_now(dl);
+
+	REQUIRE(wait_for_status(dl, DlStatus::READY));
+}
@@ -0,0 +1,71 @@
+#include "downloadsegments.h"
+
+#include <fstream>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempfile.h"
+
+using namespace podboat;
+
+TEST_CASE("DownloadSegments::split() divides the file into contiguous "
+	"segments that aren't too small",
+	"[DownloadSegments]")
+{
+	SECTION("as many segments as asked for") {
+		const auto segments = DownloadSegments::split(1003, 4, 100);
+		REQUIRE(segments.size() == 1003);
+		REQUIRE(segments.segments.size() == 4);
+		REQUIRE(segments.segments[0].start == 0);
+		REQUIRE(segments.segments[0].end == 250);
+		REQUIRE(segments.segments[3].start == 750);
+		REQUIRE(segments.segments[3].end == 1003);
+		REQUIRE(segments.downloaded() == 0);
+		REQUIRE_FALSE(segments.complete());
+	}
+
+	SECTION("fewer segments if they'd be too small") {
+		REQUIRE(DownloadSegments::split(1000, 8, 300).segments.size() == 3);
+		REQUIRE(DownloadSegments::split(100, 8, 300).segments.size() == 1);
+	}
+
+	SECTION("nothing to split") {
+		REQUIRE(DownloadSegments::split(0, 4, 100).segments.empty());
+	}
+}
+
+TEST_CASE("DownloadSegments keeps how far each segment got across save() "
+	"and load()",
+	"[DownloadSegments]")
+{
+	test_helpers::TempFile state;
+
+	auto segments = DownloadSegments::split(1000, 2, 100);
+	segments.segments[0].done = 500;
+	segments.segments[1].done = 20;
+	REQUIRE(segments.save(state.get_path()));
+
+	DownloadSegments loaded;
+	REQUIRE(loaded.load(state.get_path(), 1000));
+	REQUIRE(loaded.size() == 1000);
+	REQUIRE(loaded.segments.size() == 2);
+	REQUIRE(loaded.segments[1].start == 500);
+	REQUIRE(loaded.segments[1].done == 20);
+	REQUIRE(loaded.downloaded() == 520);
+	REQUIRE_FALSE(loaded.complete());
+
+	SECTION("not for a file of another size") {
+		DownloadSegments other;
+		REQUIRE_FALSE(other.load(state.get_path(), 1001));
+	}
+
+	SECTION("not if the state is broken") {
+		std::ofstream(state.get_path()) << "segments 1 1000\n0 400 0\n500 1000 0\n";
+		DownloadSegments broken;
+		REQUIRE_FALSE(broken.load(state.get_path(), 1000));
+	}
+
+	SECTION("complete once every segment is") {
+		loaded.segments[1].done = 500;
+		REQUIRE(loaded.complete());
+	}
+}
@@ -0,0 +1,189 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+/// Keeps the threads of a pool busy until it's released
+class Blocker {
+public:
+	Executor::Job job()
+	{
+		return [this]() {
+			std::unique_lock<std::mutex> lock(mtx);
+			++blocked;
+			changed.notify_all();
+			changed.wait(lock, [this]() {
+				return released;
+			});
+			--blocked;
+			changed.notify_all();
+		};
+	}
+
+	void wait_until_blocked(unsigned int threads)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		changed.wait(lock, [&]() {
+			return blocked == threads;
+		});
+	}
+
+	void release()
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		released = true;
+		changed.notify_all();
+		changed.wait(lock, [this]() {
+			return blocked == 0;
+		});
+	}
+
+private:
+	std::mutex mtx;
+	std::condition_variable changed;
+	unsigned int blocked = 0;
+	bool released = false;
+};
+
+/// Sets the limit of a pool for as long as it's around
+class MaxThreads {
+public:
+	MaxThreads(Executor::Pool pool, unsigned int threads)
+		: pool(pool)
+		, previous(Executor::instance().max_threads(pool))
+	{
+		Executor::instance().set_max_threads(pool, threads);
+	}
+
+	~MaxThreads()
+	{
+		Executor::instance().set_max_threads(pool, previous);
+	}
+
+private:
+	const Executor::Pool pool;
+	const unsigned int previous;
+};
+
+} // anonymous namespace
+
+TEST_CASE("Executor runs submitted jobs on its own threads, higher priorities "
+	"first", "[Executor]")
+{
+	auto& executor = Executor::instance();
+	const MaxThreads limit(Executor::Pool::IO, 1);
+
+	Blocker blocker;
+	executor.submit(Executor::Pool::IO, Executor::Priority::HIGH, blocker.job());
+	blocker.wait_until_blocked(1);
+
+	std::mutex mtx;
+	std::condition_variable all_done;
+	std::vector<int> order;
+	std::set<std::thread::id> threads;
+	const auto record = [&](int id) {
+		return [&, id]() {
+			std::lock_guard<std::mutex> lock(mtx);
+			order.push_back(id);
+			threads.insert(std::this_thread::get_id());
+			all_done.notify_all();
+		};
+	};
+	executor.submit(Executor::Pool::IO, Executor::Priority::LOW, record(3));
+	executor.submit(Executor::Pool::IO, Executor::Priority::NORMAL, record(2));
+	executor.submit(Executor::Pool::IO, Executor::Priority::HIGH, record(1));
+	executor.submit(Executor::Pool::IO, Executor::Priority::NORMAL, []() {
+		throw std::runtime_error("dropped");
+	});
+	executor.submit(Executor::Pool::IO, Executor::Priority::LOW, record(4));
+	blocker.release();
+
+	std::unique_lock<std::mutex> lock(mtx);
+	all_done.wait(lock, [&]() {
+		return order.size() == 4;
+	});
+	REQUIRE(order == std::vector<int>({1, 2, 3, 4}));
+	REQUIRE(threads.size() == 1);
+	REQUIRE(threads.count(std::this_thread::get_id()) == 0);
+}
+
+TEST_CASE("Executor::run_workers() runs the worker on several threads at "
+	"once, and waits for all of them", "[Executor]")
+{
+	auto& executor = Executor::instance();
+	const MaxThreads limit(Executor::Pool::CPU, 4);
+
+	std::mutex mtx;
+	std::condition_variable all_started;
+	std::set<std::thread::id> threads;
+	std::atomic<unsigned int> done(0);
+	executor.run_workers(Executor::Pool::CPU, Executor::Priority::NORMAL, 3,
+	[&]() {
+		std::unique_lock<std::mutex> lock(mtx);
+		threads.insert(std::this_thread::get_id());
+		all_started.notify_all();
+		// Give up after a while, in case the pool was busy elsewhere
+		all_started.wait_for(lock, std::chrono::seconds(5), [&]() {
+			return threads.size() == 3;
+		});
+		++done;
+	});
+
+	REQUIRE(threads.size() == 3);
+	REQUIRE(threads.count(std::this_thread::get_id()) == 1);
+	REQUIRE(done == 3);
+}
+
+TEST_CASE("Executor::run_workers() doesn't wait for a pool that is busy",
+	"[Executor]")
+{
+	auto& executor = Executor::instance();
+	const MaxThreads limit(Executor::Pool::CPU, 1);
+
+	Blocker blocker;
+	executor.submit(Executor::Pool::CPU, Executor::Priority::HIGH, blocker.job());
+	blocker.wait_until_blocked(1);
+
+	std::atomic<unsigned int> next(0);
+	std::atomic<unsigned int> runs(0);
+	std::vector<bool> seen(100, false);
+	executor.run_workers(Executor::Pool::CPU, Executor::Priority::NORMAL, 4,
+	[&]() {
+		++runs;
+		for (unsigned int i = next++; i < seen.size(); i = next++) {
+			seen[i] = true;
+		}
+	});
+	REQUIRE(runs == 1);
+	REQUIRE(std::find(seen.begin(), seen.end(), false) == seen.end());
+
+	blocker.release();
+	// The copies that were skipped come before this, and never run the
+	// worker
+	std::mutex mtx;
+	std::condition_variable finished;
+	bool after_copies = false;
+	executor.submit(Executor::Pool::CPU, Executor::Priority::LOW, [&]() {
+		std::lock_guard<std::mutex> lock(mtx);
+		after_copies = true;
+		finished.notify_all();
+	});
+	std::unique_lock<std::mutex> lock(mtx);
+	finished.wait(lock, [&]() {
+		return after_copies;
+	});
+	REQUIRE(runs == 1);
+}
@@ -64,6 +64,43 @@ TEST_CASE("get_all_feeds() returns copy of FeedContainer's feed vector",
 	REQUIRE(feedcontainer.get_all_feeds() == feeds);
 }
 
+TEST_CASE("get_feeds_snapshot() returns a list that later changes don't "
+	"affect",
+	"[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	REQUIRE(feedcontainer.get_feeds_snapshot()->empty());
+
+	const auto feeds = get_five_empty_feeds(&rsscache);
+	feedcontainer.set_feeds(feeds);
+	const auto before = feedcontainer.get_feeds_snapshot();
+	REQUIRE(*before == feeds);
+	REQUIRE(feedcontainer.get_feeds_snapshot() == before);
+
+	SECTION("add_feed()") {
+		feedcontainer.add_feed(std::make_shared<RssFeed>(&rsscache, ""));
+		REQUIRE(feedcontainer.get_feeds_snapshot()->size() == 6);
+	}
+
+	SECTION("replace_feed()") {
+		const auto replacement = std::make_shared<RssFeed>(&rsscache, "");
+		feedcontainer.replace_feed(2, replacement);
+		REQUIRE((*feedcontainer.get_feeds_snapshot())[2] == replacement);
+	}
+
+	SECTION("sort_feeds()") {
+		FeedSortStrategy strategy;
+		strategy.sm = FeedSortMethod::NONE;
+		strategy.sd = SortDirection::ASC;
+		feedcontainer.sort_feeds(strategy);
+		REQUIRE(feedcontainer.get_feeds_snapshot() != before);
+	}
+
+	REQUIRE(*before == feeds);
+}
+
 TEST_CASE("add_feed() adds specific feed to its \"feeds\" vector",
 	"[FeedContainer]")
 {
@@ -159,6 +196,51 @@ TEST_CASE(
 	REQUIRE(feed == nullptr);
 }
 
+TEST_CASE("get_feed_by_url() finds feeds after they are added, sorted and "
+	"replaced",
+	"[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (int i = 0; i < 3; ++i) {
+		feeds.push_back(std::make_shared<RssFeed>(&rsscache,
+				"url/" + std::to_string(i)));
+		feeds.back()->set_order(2 - i);
+	}
+	feedcontainer.set_feeds(feeds);
+
+	SECTION("adding") {
+		const auto feed = std::make_shared<RssFeed>(&rsscache, "url/new");
+		feedcontainer.add_feed(feed);
+		REQUIRE(feedcontainer.get_feed_by_url("url/new") == feed);
+
+		// The first feed with the URL is the one that's found
+		feedcontainer.add_feed(std::make_shared<RssFeed>(&rsscache, "url/0"));
+		REQUIRE(feedcontainer.get_feed_by_url("url/0") == feeds[0]);
+	}
+
+	SECTION("sorting") {
+		cfg.set_configvalue("feed-sort-order", "none-desc");
+		feedcontainer.sort_feeds(cfg.get_feed_sort_strategy());
+		REQUIRE(feedcontainer.get_feed(0) == feeds[2]);
+		REQUIRE(feedcontainer.get_feed_by_url("url/0") == feeds[0]);
+		REQUIRE(feedcontainer.get_feed_by_url("url/2") == feeds[2]);
+	}
+
+	SECTION("replacing") {
+		const auto same_url = std::make_shared<RssFeed>(&rsscache, "url/1");
+		feedcontainer.replace_feed(1, same_url);
+		REQUIRE(feedcontainer.get_feed_by_url("url/1") == same_url);
+
+		const auto other_url = std::make_shared<RssFeed>(&rsscache, "url/other");
+		feedcontainer.replace_feed(1, other_url);
+		REQUIRE(feedcontainer.get_feed_by_url("url/other") == other_url);
+		REQUIRE(feedcontainer.get_feed_by_url("url/1") == nullptr);
+	}
+}
+
 TEST_CASE("get_feed() returns nullptr if pos is out of range",
 	"[FeedContainer]")
 {
@@ -906,6 +988,43 @@ TEST_CASE("mark_all_feed_items_read() marks all of feed's items as read",
 	}
 }
 
+TEST_CASE("mark_all_feed_items_read() of a query feed updates the unread "
+	"counts of the feeds the articles are from", "[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	std::vector<std::shared_ptr<RssFeed>> feeds;
+	for (int i = 0; i < 5; ++i) {
+		const auto feed = std::make_shared<RssFeed>(&rsscache,
+				"https://example.com/" + std::to_string(i));
+		feeds.push_back(feed);
+		for (int j = 0; j < 2; ++j) {
+			const auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid(feed->rssurl() + std::to_string(j));
+			item->set_feedurl(feed->rssurl());
+			item->set_unread_nowrite(true);
+			feed->add_item(item);
+			item->set_feedptr(feed);
+		}
+	}
+	const auto query_feed = std::make_shared<RssFeed>(&rsscache,
+			"query:all:unread = \"yes\"");
+	feeds.push_back(query_feed);
+	feedcontainer.set_feeds(feeds);
+	feedcontainer.populate_query_feeds();
+	REQUIRE(query_feed->total_item_count() == 10);
+	REQUIRE(feedcontainer.unread_item_count() == 10);
+
+	feedcontainer.mark_all_feed_items_read(query_feed);
+
+	REQUIRE(query_feed->unread_item_count() == 0);
+	for (unsigned int i = 0; i < 5; ++i) {
+		REQUIRE(feeds[i]->unread_item_count() == 0);
+	}
+	REQUIRE(feedcontainer.unread_item_count() == 0);
+}
+
 TEST_CASE("mark_all_feeds_read() marks all items in all feeds as read",
 	"[FeedContainer]")
 {
@@ -1090,6 +1209,92 @@ TEST_CASE("unread_item_count() returns number of distinct unread items "
 	}
 }
 
+TEST_CASE("unread_item_count() follows articles that are read, and feeds "
+	"that are hidden, replaced or lazily loaded",
+	"[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feeds = get_five_empty_feeds(&rsscache);
+
+	// The first two feeds share their articles, as aggregators do
+	for (int j = 0; j < 2; ++j) {
+		for (int i = 0; i < 3; ++i) {
+			const auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid("shared" + std::to_string(i));
+			feeds[j]->add_item(item);
+		}
+	}
+	feedcontainer.set_feeds(feeds);
+	REQUIRE(feedcontainer.unread_item_count() == 3);
+
+	SECTION("an article counts until it's read in every feed") {
+		feeds[0]->get_item_by_guid("shared0")->set_unread_nowrite(false);
+		REQUIRE(feedcontainer.unread_item_count() == 3);
+		feeds[1]->get_item_by_guid("shared0")->set_unread_nowrite(false);
+		REQUIRE(feedcontainer.unread_item_count() == 2);
+
+		feedcontainer.mark_all_feeds_read();
+		REQUIRE(feedcontainer.unread_item_count() == 0);
+	}
+
+	SECTION("articles that are added to a feed count") {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("new");
+		feeds[2]->add_item(item);
+		REQUIRE(feedcontainer.unread_item_count() == 4);
+		feeds[2]->erase_item(feeds[2]->items().begin());
+		REQUIRE(feedcontainer.unread_item_count() == 3);
+	}
+
+	SECTION("hiding and showing a feed") {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("hidden");
+		feeds[2]->add_item(item);
+		feeds[2]->set_tags({"!hidden"});
+		REQUIRE(feedcontainer.unread_item_count() == 3);
+
+		// Reads of hidden articles aren't counted twice
+		item->set_unread_nowrite(false);
+		item->set_unread_nowrite(true);
+		feeds[2]->set_tags({"shown"});
+		REQUIRE(feedcontainer.unread_item_count() == 4);
+	}
+
+	SECTION("replacing a feed") {
+		const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid("replacement");
+		feed->add_item(item);
+		feedcontainer.replace_feed(0, feed);
+		REQUIRE(feedcontainer.unread_item_count() == 4);
+		feedcontainer.replace_feed(1, std::make_shared<RssFeed>(&rsscache, ""));
+		REQUIRE(feedcontainer.unread_item_count() == 1);
+
+		// The feed that was replaced doesn't report to the container anymore
+		feeds[1]->items()[0]->set_unread_nowrite(false);
+		feeds[1]->items()[0]->set_unread_nowrite(true);
+		REQUIRE(feedcontainer.unread_item_count() == 1);
+	}
+
+	SECTION("feeds whose items aren't loaded count their summaries") {
+		const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+		feed->set_item_summaries({
+			{"summary0", 0, true, ""},
+			{"shared1", 0, true, ""},
+			{"summary2", 0, false, ""},
+		});
+		REQUIRE(feed->unread_item_count() == 2);
+		feedcontainer.add_feed(feed);
+		REQUIRE(feedcontainer.unread_item_count() == 4);
+
+		feed->mark_all_items_read();
+		REQUIRE(feed->unread_item_count() == 0);
+		REQUIRE(feedcontainer.unread_item_count() == 3);
+	}
+}
+
 TEST_CASE("get_unread_feed_count_per_tag returns 0 if there are no feeds "
 	"with given tag",
 	"[FeedContainer]")
@@ -1384,6 +1589,61 @@ TEST_CASE("get_unread_item_count_per_tag returns the number of unread items "
 	}
 }
 
+TEST_CASE("Counts per tag follow the feeds' tags and unread articles",
+	"[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto feeds = get_five_empty_feeds(&rsscache);
+	feedcontainer.set_feeds(feeds);
+	for (int i = 0; i < 3; ++i) {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(std::to_string(i));
+		feeds[0]->add_item(item);
+	}
+	feeds[0]->set_tags({"news"});
+	feeds[1]->set_tags({"news", "tech"});
+
+	REQUIRE(feedcontainer.get_feed_count_per_tag("news") == 2);
+	REQUIRE(feedcontainer.get_unread_feed_count_per_tag("news") == 1);
+	REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 3);
+
+	SECTION("reading articles") {
+		feeds[0]->get_item_by_guid("0")->set_unread_nowrite(false);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 2);
+		feeds[0]->mark_all_items_read();
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 0);
+		REQUIRE(feedcontainer.get_unread_feed_count_per_tag("news") == 0);
+	}
+
+	SECTION("adding articles") {
+		feeds[1]->add_item(std::make_shared<RssItem>(&rsscache));
+		REQUIRE(feedcontainer.get_unread_feed_count_per_tag("news") == 2);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 4);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("tech") == 1);
+	}
+
+	SECTION("changing tags") {
+		feeds[0]->set_tags({"tech"});
+		REQUIRE(feedcontainer.get_feed_count_per_tag("news") == 1);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 0);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("tech") == 3);
+	}
+
+	SECTION("replacing a feed") {
+		const auto feed = std::make_shared<RssFeed>(&rsscache, "");
+		feed->set_tags({"news"});
+		feedcontainer.replace_feed(0, feed);
+		REQUIRE(feedcontainer.get_feed_count_per_tag("news") == 2);
+		REQUIRE(feedcontainer.get_unread_item_count_per_tag("news") == 0);
+
+		// The feed that was replaced doesn't count anymore
+		feeds[0]->set_tags({"tech"});
+		REQUIRE(feedcontainer.get_feed_count_per_tag("tech") == 1);
+	}
+}
+
 TEST_CASE("replace_feed() puts given feed into the specified position",
 	"[FeedContainer]")
 {
@@ -1409,3 +1669,24 @@ TEST_CASE("replace_feed() puts given feed into the specified position",
 	REQUIRE(feed_before_replacement != feed_after_replacement);
 	REQUIRE(feed_after_replacement == first_feed);
 }
+
+TEST_CASE("take_replaced_feedurls() returns the URLs of the feeds replaced "
+	"since the last call", "[FeedContainer]")
+{
+	FeedContainer feedcontainer;
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	feedcontainer.set_feeds(get_five_empty_feeds(&rsscache));
+
+	REQUIRE(feedcontainer.take_replaced_feedurls().empty());
+
+	const std::string url = "http://example.com/feed.xml";
+	feedcontainer.replace_feed(1, std::make_shared<RssFeed>(&rsscache, url));
+	feedcontainer.replace_feed(1, std::make_shared<RssFeed>(&rsscache, url));
+
+	const auto replaced = feedcontainer.take_replaced_feedurls();
+	REQUIRE(replaced.size() == 1);
+	REQUIRE(replaced.count(url) == 1);
+	REQUIRE(feedcontainer.take_replaced_feedurls().empty());
+}
@@ -0,0 +1,130 @@
+#include "feedsnapshot.h"
+
+#include <fstream>
+#include <memory>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+#include "test_helpers/tempdir.h"
+#include "test_helpers/tempfile.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::shared_ptr<RssFeed> make_feed(Cache* rsscache)
+{
+	auto feed = std::make_shared<RssFeed>(rsscache, "http://example.com/feed");
+	feed->set_title("Example");
+	feed->set_link("http://example.com/");
+	for (int i = 0; i < 3; ++i) {
+		auto item = std::make_shared<RssItem>(rsscache);
+		item->set_guid("guid" + std::to_string(i));
+		item->set_pubDate(1000 + i);
+		item->set_unread_nowrite(i != 1);
+		feed->add_item(item);
+	}
+	feed->items()[2]->set_flags("a");
+	return feed;
+}
+
+} // anonymous namespace
+
+TEST_CASE("FeedSnapshot makes the feeds it was written with, newest article "
+	"first", "[FeedSnapshot]")
+{
+	test_helpers::TempDir tmp;
+	const std::string path = tmp.get_path() + "/cache.db.snapshot";
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const std::vector<std::shared_ptr<RssFeed>> feeds = {
+		make_feed(&rsscache),
+		std::make_shared<RssFeed>(&rsscache, "query:Unread:unread = \"yes\""),
+	};
+
+	REQUIRE(FeedSnapshot::write(path, "token", feeds));
+
+	SECTION("with the token it was written for") {
+		FeedSnapshot snapshot(path, "token");
+		REQUIRE(snapshot.valid());
+
+		const auto feed = snapshot.make_feed(rsscache, "http://example.com/feed");
+		REQUIRE(feed != nullptr);
+		REQUIRE_FALSE(feed->items_loaded());
+		REQUIRE(feed->title_raw() == "Example");
+		REQUIRE(feed->link() == "http://example.com/");
+		REQUIRE(feed->total_item_count() == 3);
+		REQUIRE(feed->unread_item_count() == 2);
+
+		const auto summaries = feed->item_summaries();
+		REQUIRE(summaries.size() == 3);
+		REQUIRE(summaries[0].guid == "guid2");
+		REQUIRE(summaries[0].pubDate == 1002);
+		REQUIRE(summaries[0].flags == "a");
+		REQUIRE(summaries[1].guid == "guid1");
+		REQUIRE_FALSE(summaries[1].unread);
+		REQUIRE(summaries[2].guid == "guid0");
+		REQUIRE(summaries[2].unread);
+
+		SECTION("query feeds are left out") {
+			REQUIRE(snapshot.make_feed(rsscache,
+					"query:Unread:unread = \"yes\"") == nullptr);
+		}
+
+		SECTION("feeds it doesn't have are made from the cache instead") {
+			REQUIRE(snapshot.make_feed(rsscache, "http://example.org/") == nullptr);
+		}
+	}
+
+	SECTION("with another token") {
+		FeedSnapshot snapshot(path, "other");
+		REQUIRE_FALSE(snapshot.valid());
+		REQUIRE(snapshot.make_feed(rsscache, "http://example.com/feed") == nullptr);
+	}
+
+	SECTION("with no token") {
+		REQUIRE_FALSE(FeedSnapshot(path, "").valid());
+	}
+
+	SECTION("that was cut short") {
+		std::string contents;
+		{
+			std::ifstream in(path, std::ios::binary);
+			contents.assign(std::istreambuf_iterator<char>(in),
+				std::istreambuf_iterator<char>());
+		}
+		std::ofstream(path, std::ios::binary | std::ios::trunc)
+				<< contents.substr(0, contents.size() - 1);
+		REQUIRE_FALSE(FeedSnapshot(path, "token").valid());
+	}
+}
+
+TEST_CASE("FeedSnapshot isn't valid if there is no file", "[FeedSnapshot]")
+{
+	test_helpers::TempDir tmp;
+	REQUIRE_FALSE(FeedSnapshot(tmp.get_path() + "/missing", "token").valid());
+}
+
+TEST_CASE("Cache hands out the snapshot token only to the next one to open it",
+	"[FeedSnapshot]")
+{
+	test_helpers::TempFile dbfile;
+	ConfigContainer cfg;
+
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		REQUIRE(rsscache.snapshot_token().empty());
+		rsscache.set_snapshot_token("token");
+	}
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		REQUIRE(rsscache.snapshot_token() == "token");
+	}
+	{
+		Cache rsscache(dbfile.get_path(), &cfg);
+		REQUIRE(rsscache.snapshot_token().empty());
+	}
+}
@@ -0,0 +1,63 @@
+#include "fetchgroups.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("canonical_url() leaves out what servers don't tell apart",
+	"[FetchGroups]")
+{
+	const std::string feed = "example.com/feed";
+	REQUIRE(FetchGroups::canonical_url("http://example.com/feed") == feed);
+	REQUIRE(FetchGroups::canonical_url("https://example.com/feed/") == feed);
+	REQUIRE(FetchGroups::canonical_url("HTTPS://Example.COM:443/feed") == feed);
+	REQUIRE(FetchGroups::canonical_url("http://example.com:80/feed#top") == feed);
+	REQUIRE(FetchGroups::canonical_url(
+			"https://example.com/feed?utm_source=rss&fbclid=1") == feed);
+
+	SECTION("what's left of the query, the path and the user are kept") {
+		REQUIRE(FetchGroups::canonical_url(
+				"https://example.com/feed?utm_medium=x&tag=c%2B%2B&page=2")
+			== "example.com/feed?tag=c%2B%2B&page=2");
+		REQUIRE(FetchGroups::canonical_url("https://example.com/Feed")
+			== "example.com/Feed");
+		REQUIRE(FetchGroups::canonical_url("https://Me@example.com:8080/")
+			== "Me@example.com:8080");
+	}
+
+	SECTION("URLs that aren't HTTP have none") {
+		REQUIRE(FetchGroups::canonical_url("exec:~/bin/feed.sh").empty());
+		REQUIRE(FetchGroups::canonical_url("file:///tmp/feed.xml").empty());
+		REQUIRE(FetchGroups::canonical_url("").empty());
+	}
+}
+
+TEST_CASE("FetchGroups has the first feed over HTTPS fetch for the others",
+	"[FetchGroups]")
+{
+	const FetchGroups groups({
+		"http://example.com/feed",
+		"http://other.example.com/feed",
+		"https://example.com/feed/",
+		"",
+		"http://example.com/feed?utm_source=newsletter",
+		"https://example.com/feed",
+		"",
+	});
+
+	REQUIRE(groups.followers(2) == std::vector<std::size_t>({0, 4, 5}));
+	REQUIRE_FALSE(groups.is_follower(2));
+	for (const std::size_t follower : {
+			0, 4, 5
+		}) {
+		REQUIRE(groups.is_follower(follower));
+		REQUIRE(groups.followers(follower).empty());
+	}
+
+	for (const std::size_t alone : {
+			1, 3, 6
+		}) {
+		REQUIRE_FALSE(groups.is_follower(alone));
+		REQUIRE(groups.followers(alone).empty());
+	}
+}
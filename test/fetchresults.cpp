@@ -0,0 +1,117 @@
+#include "fetchresults.h"
+
+#include <memory>
+#include <string>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+#include "test_helpers/tempdir.h"
+
+using namespace newsboat;
+
+TEST_CASE("FetchResults::parse_shard() reads \"<index>/<count>\"",
+	"[FetchResults]")
+{
+	unsigned int index = 0;
+	unsigned int count = 0;
+	REQUIRE(FetchResults::parse_shard("2/4", index, count));
+	REQUIRE(index == 2);
+	REQUIRE(count == 4);
+	REQUIRE(FetchResults::parse_shard("1/1", index, count));
+	REQUIRE(index == 1);
+	REQUIRE(count == 1);
+
+	for (const std::string spec : {
+			"", "2", "0/4", "5/4", "2/0", "/4", "2/", "-1/4", "2/4/8", " 2/4"
+		}) {
+		REQUIRE_FALSE(FetchResults::parse_shard(spec, index, count));
+	}
+}
+
+TEST_CASE("FetchResults::in_shard() puts every feed in exactly one shard",
+	"[FetchResults]")
+{
+	unsigned int in_first = 0;
+	for (unsigned int i = 0; i < 100; ++i) {
+		const std::string url = "https://example.com/feed" + std::to_string(i);
+		unsigned int shards = 0;
+		for (unsigned int index = 1; index <= 3; ++index) {
+			if (FetchResults::in_shard(url, index, 3)) {
+				++shards;
+			}
+		}
+		REQUIRE(shards == 1);
+		REQUIRE(FetchResults::in_shard(url, 1, 1));
+		if (FetchResults::in_shard(url, 1, 3)) {
+			++in_first;
+		}
+	}
+	// Roughly a third, not none or all of them
+	REQUIRE(in_first > 10);
+	REQUIRE(in_first < 60);
+}
+
+TEST_CASE("FetchResults gives the coordinator the feeds a worker added",
+	"[FetchResults]")
+{
+	test_helpers::TempDir tmp;
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	FetchResults worker(tmp.get_path());
+	const FetchResults coordinator(tmp.get_path());
+
+	REQUIRE(worker.write("1/2"));
+	REQUIRE(coordinator.list_files().empty());
+
+	auto feed = std::make_shared<RssFeed>(&rsscache,
+			"https://example.com/feed.xml");
+	feed->set_title("Example");
+	feed->set_link("https://example.com/");
+	feed->set_rtl(true);
+	auto item = std::make_shared<RssItem>(&rsscache);
+	item->set_guid("first");
+	item->set_title("First");
+	item->set_link("https://example.com/first");
+	item->set_author("Someone");
+	item->set_description("<p>Hello</p>", "text/html");
+	item->set_pubDate(1600000000);
+	item->set_enclosure_url("https://example.com/first.mp3");
+	item->set_enclosure_type("audio/mpeg");
+	item->set_feedurl(feed->rssurl());
+	feed->add_item(item);
+	worker.add(*feed, 1500000000, "\"v1\"");
+
+	REQUIRE(worker.write("1/2"));
+	const auto files = coordinator.list_files();
+	REQUIRE(files.size() == 1);
+
+	const auto results = FetchResults::read(files[0], &rsscache);
+	REQUIRE(results.size() == 1);
+	REQUIRE(results[0].lastmodified == 1500000000);
+	REQUIRE(results[0].etag == "\"v1\"");
+	const auto& result = results[0].feed;
+	REQUIRE(result->rssurl() == "https://example.com/feed.xml");
+	REQUIRE(result->title_raw() == "Example");
+	REQUIRE(result->link() == "https://example.com/");
+	REQUIRE(result->is_rtl());
+	REQUIRE(result->total_item_count() == 1);
+	const auto read_item = result->items()[0];
+	REQUIRE(read_item->guid() == "first");
+	REQUIRE(read_item->title() == "First");
+	REQUIRE(read_item->link() == "https://example.com/first");
+	REQUIRE(read_item->author() == "Someone");
+	REQUIRE(read_item->description().text == "<p>Hello</p>");
+	REQUIRE(read_item->description().mime == "text/html");
+	REQUIRE(read_item->pubDate_timestamp() == 1600000000);
+	REQUIRE(read_item->enclosure_url() == "https://example.com/first.mp3");
+	REQUIRE(read_item->enclosure_type() == "audio/mpeg");
+	REQUIRE(read_item->feedurl() == "https://example.com/feed.xml");
+
+	SECTION("nothing is written if nothing was added since") {
+		REQUIRE(worker.write("1/2"));
+		REQUIRE(coordinator.list_files().size() == 1);
+	}
+}
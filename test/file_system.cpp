@@ -1,7 +1,11 @@
-#include "3rd-party/catch.hpp"
-
 #include "file_system.h"
 
+#include <fstream>
+#include <unistd.h>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempdir.h"
+
 using namespace newsboat::file_system;
 
 TEST_CASE("mode_suffix", "[file_system]")
@@ -65,3 +69,27 @@ TEST_CASE("permissions_string", "[file_system]")
 	REQUIRE(permissions_string(0754) == "rwxr-xr--");
 	REQUIRE(permissions_string(0156) == "--xr-xrw-");
 }
+
+TEST_CASE("list_directory() returns the sorted names in a directory",
+	"[file_system]")
+{
+	test_helpers::TempDir tmp;
+	const std::string dir = tmp.get_path();
+	REQUIRE(::mkdir((dir + "b-dir").c_str(), 0700) == 0);
+	REQUIRE(::mkdir((dir + "d-dir").c_str(), 0700) == 0);
+	std::ofstream(dir + "c-file") << "content";
+	std::ofstream(dir + "a-file") << "content";
+	REQUIRE(::symlink("b-dir", (dir + "e-link").c_str()) == 0);
+
+	REQUIRE(list_directory(dir, false) == std::vector<std::string>({
+		"a-file", "b-dir", "c-file", "d-dir", "e-link"}));
+
+	SECTION("symlinks to directories aren't directories") {
+		REQUIRE(list_directory(dir, true) == std::vector<std::string>({
+			"b-dir", "d-dir"}));
+	}
+
+	SECTION("a directory that can't be read is empty") {
+		REQUIRE(list_directory(dir + "no-such-dir", false).empty());
+	}
+}
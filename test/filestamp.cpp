@@ -0,0 +1,41 @@
+#include "filestamp.h"
+
+#include <fstream>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempfile.h"
+
+using namespace newsboat;
+
+TEST_CASE("FileStamp of a file that doesn't exist equals the default one",
+	"[FileStamp]")
+{
+	test_helpers::TempFile tmp;
+
+	const auto stamp = FileStamp::of(tmp.get_path());
+	REQUIRE_FALSE(stamp.exists());
+	REQUIRE(stamp == FileStamp());
+}
+
+TEST_CASE("FileStamp changes along with the file", "[FileStamp]")
+{
+	test_helpers::TempFile tmp;
+	{
+		std::ofstream f(tmp.get_path());
+		f << "hello";
+	}
+
+	const auto stamp = FileStamp::of(tmp.get_path());
+	REQUIRE(stamp.exists());
+	REQUIRE(stamp.size() == 5);
+	REQUIRE(FileStamp::of(tmp.get_path()) == stamp);
+
+	{
+		std::ofstream f(tmp.get_path(), std::ofstream::app);
+		f << ", world";
+	}
+
+	const auto changed = FileStamp::of(tmp.get_path());
+	REQUIRE(changed != stamp);
+	REQUIRE(changed.size() == 12);
+}
@@ -0,0 +1,129 @@
+#include "filewriter.h"
+
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempfile.h"
+
+using namespace podboat;
+
+namespace {
+
+std::string file_contents(const std::string& path)
+{
+	std::ifstream file(path);
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+std::uint64_t file_size(const std::string& path)
+{
+	struct stat sb;
+	REQUIRE(::stat(path.c_str(), &sb) == 0);
+	return sb.st_size;
+}
+
+} // namespace
+
+TEST_CASE("FileWriter writes everything it's given, in order", "[FileWriter]")
+{
+	test_helpers::TempFile tmp;
+	FileWriter writer;
+	REQUIRE(writer.open(tmp.get_path(), false));
+
+	std::string expected;
+	// Small chunks that don't add up to the buffer's size, and one that's
+	// bigger than the buffer
+	for (int i = 0; i < 1000; ++i) {
+		const std::string chunk(1000 + i, 'a' + i % 26);
+		REQUIRE(writer.write(chunk.data(), chunk.size()));
+		expected += chunk;
+	}
+	const std::string big(FileWriter::BUFFER_SIZE * 2 + 1, 'z');
+	REQUIRE(writer.write(big.data(), big.size()));
+	expected += big;
+	REQUIRE(writer.write("end", 3));
+	expected += "end";
+
+	REQUIRE(writer.close(false));
+	REQUIRE_FALSE(writer.is_open());
+	REQUIRE(file_contents(tmp.get_path()) == expected);
+}
+
+TEST_CASE("FileWriter appends to a file, or truncates it", "[FileWriter]")
+{
+	test_helpers::TempFile tmp;
+	{
+		std::ofstream f(tmp.get_path());
+		f << "Hello, ";
+	}
+
+	FileWriter writer;
+
+	SECTION("appending") {
+		REQUIRE(writer.open(tmp.get_path(), true));
+		REQUIRE(writer.write("world!", 6));
+		REQUIRE(writer.close(true));
+		REQUIRE(file_contents(tmp.get_path()) == "Hello, world!");
+	}
+
+	SECTION("truncating") {
+		REQUIRE(writer.open(tmp.get_path(), false));
+		REQUIRE(writer.write("world!", 6));
+		REQUIRE(writer.close(true));
+		REQUIRE(file_contents(tmp.get_path()) == "world!");
+	}
+}
+
+TEST_CASE("FileWriter::reserve() doesn't change the size of the file",
+	"[FileWriter]")
+{
+	test_helpers::TempFile tmp;
+	FileWriter writer;
+	REQUIRE(writer.open(tmp.get_path(), false));
+	REQUIRE(writer.write("data", 4));
+
+	writer.reserve(10 * 1024 * 1024);
+
+	REQUIRE(writer.close(false));
+	REQUIRE(file_size(tmp.get_path()) == 4);
+}
+
+TEST_CASE("FileWriter writes what's left when it goes away", "[FileWriter]")
+{
+	test_helpers::TempFile tmp;
+	{
+		FileWriter writer;
+		REQUIRE(writer.open(tmp.get_path(), false));
+		REQUIRE(writer.write("data", 4));
+	}
+	REQUIRE(file_contents(tmp.get_path()) == "data");
+}
+
+TEST_CASE("FileWriter::open() fails if the file can't be created",
+	"[FileWriter]")
+{
+	FileWriter writer;
+	REQUIRE_FALSE(writer.open("/dev/null/impossible", false));
+	REQUIRE_FALSE(writer.is_open());
+}
+
+TEST_CASE("FileWriter reports a write that failed in the background",
+	"[FileWriter]")
+{
+	FileWriter writer;
+	if (!writer.open("/dev/full", false)) {
+		WARN("/dev/full isn't there; skipping");
+		return;
+	}
+	const std::string chunk(FileWriter::BUFFER_SIZE, 'x');
+	// The first buffer is only handed over; its failure turns up later
+	REQUIRE(writer.write(chunk.data(), chunk.size()));
+	REQUIRE_FALSE(writer.close(false));
+	REQUIRE(errno == ENOSPC);
+}
@@ -406,3 +406,31 @@ TEST_CASE("Center Text formatting",
 	REQUIRE(fmt.do_format("%=3T", 0) == "wha");
 	REQUIRE(fmt.do_format("%=0T", 20) == "      whatever      ");
 }
+
+TEST_CASE("do_format() formats a template the same as its format string",
+	"[FmtStrFormatter]")
+{
+	FmtStrFormatter fmt;
+	fmt.register_fmt('a', "AAA");
+	fmt.register_fmt('b', "BBB");
+
+	const std::string format = "<%a> <%5b> | %-5a%%";
+	const FmtStrTemplate tmpl(format);
+	REQUIRE(tmpl.get_format() == format);
+	REQUIRE(fmt.do_format(tmpl) == fmt.do_format(format));
+	REQUIRE(fmt.do_format(tmpl) == "<AAA> <  BBB> | AAA  %");
+
+	SECTION("the template can be formatted with other values") {
+		fmt.register_fmt('a', "A");
+		REQUIRE(fmt.do_format(tmpl) == "<A> <  BBB> | A    %");
+	}
+
+	SECTION("set_format() replaces the format string") {
+		FmtStrTemplate other;
+		REQUIRE(fmt.do_format(other) == "");
+
+		other.set_format("%b%a");
+		REQUIRE(other.get_format() == "%b%a");
+		REQUIRE(fmt.do_format(other) == "BBBAAA");
+	}
+}
@@ -0,0 +1,71 @@
+#include "guidindex.h"
+
+#include <algorithm>
+#include <string>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::shared_ptr<RssItem> make_item(Cache* rsscache, const std::string& guid)
+{
+	auto item = std::make_shared<RssItem>(rsscache);
+	item->set_guid(guid);
+	return item;
+}
+
+}
+
+TEST_CASE("GuidIndex finds the positions of articles by guid", "[GuidIndex]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	GuidIndex::Items items;
+	GuidIndex index;
+	REQUIRE(index.find(items, "missing") == GuidIndex::npos);
+
+	for (int i = 0; i < 100; ++i) {
+		items.push_back(make_item(&rsscache, "guid " + std::to_string(i)));
+		index.add(items, items.size() - 1);
+	}
+	REQUIRE(index.size() == 100);
+	for (std::size_t i = 0; i < 100; ++i) {
+		REQUIRE(index.find(items, "guid " + std::to_string(i)) == i);
+	}
+	REQUIRE(index.find(items, "guid 100") == GuidIndex::npos);
+
+	SECTION("the last of the articles with the same guid is found") {
+		items.push_back(make_item(&rsscache, "guid 7"));
+		index.add(items, items.size() - 1);
+		REQUIRE(index.size() == 100);
+		REQUIRE(index.find(items, "guid 7") == 100);
+	}
+
+	SECTION("positions are found again after invalidate()") {
+		std::reverse(items.begin(), items.end());
+		items.pop_back();
+		index.invalidate();
+
+		REQUIRE(index.find(items, "guid 0") == GuidIndex::npos);
+		REQUIRE(index.find(items, "guid 99") == 0);
+		REQUIRE(index.find(items, "guid 1") == 98);
+		REQUIRE(index.size() == 99);
+
+		items.push_back(make_item(&rsscache, "new"));
+		index.add(items, items.size() - 1);
+		REQUIRE(index.find(items, "new") == 99);
+	}
+
+	SECTION("articles added while invalidated are found") {
+		index.invalidate();
+		items.push_back(make_item(&rsscache, "new"));
+		index.add(items, items.size() - 1);
+		REQUIRE(index.find(items, "new") == 100);
+	}
+}
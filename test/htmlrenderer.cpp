@@ -232,6 +232,41 @@ TEST_CASE("links with different URLs have different numbers", "[HtmlRenderer]")
 	REQUIRE(links[1].second == LinkType::HREF);
 }
 
+TEST_CASE("links that were in the list before rendering keep their numbers, "
+	"and are reused", "[HtmlRenderer]")
+{
+	HtmlRenderer r;
+
+	std::vector<std::pair<LineType, std::string>> lines;
+	std::vector<LinkPair> links = {
+		{"http://example.com/feed", LinkType::HREF},
+	};
+
+	std::string input;
+	for (unsigned int i = 0; i < 500; ++i) {
+		input += strprintf::fmt("<a href='http://example.com/%u'>%u</a> ", i % 250, i);
+	}
+	input += "<a href='http://example.com/feed'>The feed</a>";
+
+	REQUIRE_NOTHROW(r.render(input, lines, links, url));
+	REQUIRE(links.size() == 251);
+	REQUIRE(links[0].first == "http://example.com/feed");
+	REQUIRE(links[1].first == "http://example.com/0");
+	REQUIRE(links[250].first == "http://example.com/249");
+	REQUIRE_FALSE(lines.empty());
+	REQUIRE(lines[0].second.find("<u>499</>[251]") != std::string::npos);
+	REQUIRE(lines[0].second.find("<u>The feed</>[1]") != std::string::npos);
+
+	SECTION("rendering again starts over") {
+		std::vector<LinkPair> other_links;
+		lines.clear();
+		REQUIRE_NOTHROW(r.render("<a href='http://example.com/0'>0</a>", lines,
+				other_links, url));
+		REQUIRE(other_links.size() == 1);
+		REQUIRE(lines[0].second.find("[1]") != std::string::npos);
+	}
+}
+
 TEST_CASE("link without `href' is neither highlighted nor added to links list",
 	"[HtmlRenderer]")
 {
@@ -1194,6 +1229,31 @@ TEST_CASE("tables with `border' have borders", "[HtmlRenderer]")
 	REQUIRE(links.size() == 0);
 }
 
+TEST_CASE("lines of table cells wider than the cap are wrapped",
+	"[HtmlRenderer]")
+{
+	HtmlRenderer r(false, 5);
+	std::vector<std::pair<LineType, std::string>> lines;
+	std::vector<LinkPair> links;
+
+	const std::string input =
+		"<table border='1'>"
+		"<tr>"
+		"<td>hello world</td>"
+		"<td>hi</td>"
+		"</tr>"
+		"</table>";
+
+	REQUIRE_NOTHROW(r.render(input, lines, links, url));
+	REQUIRE(lines.size() == 5);
+	REQUIRE(lines[0] == p(LineType::nonwrappable, "+-----+--+"));
+	REQUIRE(lines[1] == p(LineType::nonwrappable, "|hello|hi|"));
+	REQUIRE(lines[2] == p(LineType::nonwrappable, "| worl|  |"));
+	REQUIRE(lines[3] == p(LineType::nonwrappable, "|d    |  |"));
+	REQUIRE(lines[4] == p(LineType::nonwrappable, "+-----+--+"));
+	REQUIRE(links.size() == 0);
+}
+
 TEST_CASE("if document ends before </table> is found, table is rendered anyway",
 	"[HtmlRenderer]")
 {
@@ -0,0 +1,58 @@
+#include "itemchangelog.h"
+
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("ItemChangeLog calls its subscribers in the order they subscribed",
+	"[ItemChangeLog]")
+{
+	ItemChangeLog log;
+	std::vector<std::string> calls;
+	log.subscribe([&](const ItemChanges& changes) {
+		calls.push_back("first: " + changes.at(0).guid);
+	});
+	log.subscribe([&](const ItemChanges& changes) {
+		calls.push_back("second: " + changes.at(0).guid);
+	});
+
+	log.publish({{"guid", "http://example.com/feed.xml", ItemChange::Kind::ADDED}});
+
+	REQUIRE(calls == std::vector<std::string>({"first: guid", "second: guid"}));
+}
+
+TEST_CASE("ItemChangeLog doesn't publish reloads that changed nothing",
+	"[ItemChangeLog]")
+{
+	ItemChangeLog log;
+	unsigned int calls = 0;
+	log.subscribe([&](const ItemChanges&) {
+		++calls;
+	});
+
+	log.publish({});
+
+	REQUIRE(calls == 0);
+}
+
+TEST_CASE("ItemChangeLog subscribers may subscribe others", "[ItemChangeLog]")
+{
+	ItemChangeLog log;
+	unsigned int late_calls = 0;
+	log.subscribe([&](const ItemChanges&) {
+		log.subscribe([&](const ItemChanges&) {
+			++late_calls;
+		});
+	});
+
+	const ItemChanges changes = {
+		{"guid", "http://example.com/feed.xml", ItemChange::Kind::CHANGED}
+	};
+	log.publish(changes);
+	REQUIRE(late_calls == 0);
+	log.publish(changes);
+	REQUIRE(late_calls == 1);
+}
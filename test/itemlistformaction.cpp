@@ -926,3 +926,124 @@ TEST_CASE("OP_OPENINBROWSER does not result in itemlist invalidation",
 		REQUIRE(item3->unread());
 	}
 }
+
+TEST_CASE("With articlelist-viewport-only, the cursor can be moved past the "
+	"rows that were formatted", "[ItemListFormAction]")
+{
+	ConfigPaths paths;
+	Controller c(paths);
+	test_helpers::TempFile articleFile;
+	newsboat::View v(&c);
+	ConfigContainer cfg;
+	cfg.set_configvalue(
+		"external-url-viewer", "tee > " + articleFile.get_path());
+	cfg.set_configvalue("articlelist-viewport-only", "yes");
+	Cache rsscache(":memory:", &cfg);
+
+	KeyMap k(KM_NEWSBOAT);
+	v.set_keymap(&k);
+
+	v.set_config_container(&cfg);
+	c.set_view(&v);
+
+	std::shared_ptr<RssFeed> feed = std::make_shared<RssFeed>(&rsscache, "");
+	for (int i = 0; i < 500; ++i) {
+		std::shared_ptr<RssItem> item = std::make_shared<RssItem>(&rsscache);
+		item->set_title("Article_" + std::to_string(i));
+		feed->add_item(item);
+	}
+
+	std::shared_ptr<ItemListFormAction> itemlist = v.push_itemlist(feed);
+	for (int i = 0; i < 300; ++i) {
+		itemlist->prepare();
+		REQUIRE_NOTHROW(itemlist->process_op(OP_NEXT));
+	}
+	itemlist->prepare();
+	itemlist->process_op(OP_SHOWURLS);
+	Stfl::reset();
+
+	std::ifstream fileStream(articleFile.get_path());
+	std::string line;
+	std::getline(fileStream, line);
+	REQUIRE(line == "Title: Article_300");
+}
+
+TEST_CASE("invalidate_items() updates the visibility of just the given items",
+	"[ItemListFormAction]")
+{
+	ConfigPaths paths;
+	Controller c(paths);
+	test_helpers::TempFile articleFile;
+	newsboat::View v(&c);
+	ConfigContainer cfg;
+	cfg.set_configvalue(
+		"external-url-viewer", "tee > " + articleFile.get_path());
+	cfg.set_configvalue("show-read-articles", "no");
+	Cache rsscache(":memory:", &cfg);
+
+	KeyMap k(KM_NEWSBOAT);
+	v.set_keymap(&k);
+
+	v.set_config_container(&cfg);
+	c.set_view(&v);
+
+	std::shared_ptr<RssFeed> feed = std::make_shared<RssFeed>(&rsscache, "");
+	std::vector<std::shared_ptr<RssItem>> items;
+	for (int i = 0; i < 4; ++i) {
+		std::shared_ptr<RssItem> item = std::make_shared<RssItem>(&rsscache);
+		item->set_title("Article_" + std::to_string(i));
+		item->set_guid("guid_" + std::to_string(i));
+		feed->add_item(item);
+		items.push_back(item);
+	}
+
+	std::shared_ptr<ItemListFormAction> itemlist = v.push_itemlist(feed);
+	itemlist->prepare();
+
+	const auto title_at = [&](unsigned int steps) {
+		for (unsigned int i = 0; i < steps; ++i) {
+			itemlist->process_op(OP_NEXT);
+		}
+		itemlist->process_op(OP_SHOWURLS);
+		std::ifstream fileStream(articleFile.get_path());
+		std::string line;
+		std::getline(fileStream, line);
+		return line;
+	};
+
+	SECTION("an item that was marked read disappears") {
+		items[1]->set_unread(false);
+		itemlist->invalidate_items({items[1]});
+		itemlist->prepare();
+		Stfl::reset();
+
+		REQUIRE(title_at(0) == "Title: Article_0");
+		REQUIRE(title_at(1) == "Title: Article_2");
+		REQUIRE(title_at(1) == "Title: Article_3");
+	}
+
+	SECTION("an item that was marked unread comes back") {
+		items[2]->set_unread(false);
+		itemlist->invalidate_list();
+		itemlist->prepare();
+
+		items[2]->set_unread(true);
+		itemlist->invalidate_items({items[2]});
+		itemlist->prepare();
+		Stfl::reset();
+
+		REQUIRE(title_at(0) == "Title: Article_0");
+		REQUIRE(title_at(2) == "Title: Article_2");
+	}
+
+	SECTION("the cursor stays on the same item") {
+		itemlist->process_op(OP_NEXT);
+		itemlist->process_op(OP_NEXT);
+		items[0]->set_unread(false);
+		itemlist->invalidate_items({items[0]});
+		itemlist->prepare();
+		Stfl::reset();
+
+		REQUIRE(title_at(0) == "Title: Article_2");
+	}
+}
@@ -0,0 +1,78 @@
+#include "jsonstream.h"
+
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+using json = nlohmann::json;
+
+TEST_CASE("stream_json_array() hands out the elements of the array one by "
+	"one, and the rest of the object as a whole", "[JsonStream]")
+{
+	const std::string input = R"({
+		"id": "user/-/state/com.google/reading-list",
+		"items": [
+			{"id": "a", "title": "First", "tags": ["x", {"y": [1, 2]}]},
+			"just a string",
+			[3, 4],
+			null
+		],
+		"continuation": "abc",
+		"nested": {"items": [5, 6]}
+	})";
+
+	std::vector<json> elements;
+	json rest;
+	REQUIRE(stream_json_array(input, "items", [&](json& element) {
+		elements.push_back(std::move(element));
+	}, rest));
+
+	REQUIRE(elements.size() == 4);
+	REQUIRE(elements[0] == json::parse(
+			R"({"id": "a", "title": "First", "tags": ["x", {"y": [1, 2]}]})"));
+	REQUIRE(elements[1] == "just a string");
+	REQUIRE(elements[2] == json::parse("[3, 4]"));
+	REQUIRE(elements[3].is_null());
+
+	REQUIRE(rest == json::parse(R"({
+		"id": "user/-/state/com.google/reading-list",
+		"continuation": "abc",
+		"nested": {"items": [5, 6]}
+	})"));
+}
+
+TEST_CASE("stream_json_array() leaves values under the key that aren't "
+	"arrays in the rest", "[JsonStream]")
+{
+	unsigned int elements = 0;
+	const auto count = [&](json&) {
+		++elements;
+	};
+	json rest;
+
+	SECTION("an object") {
+		REQUIRE(stream_json_array(R"({"status": 1, "content": {"error": "NOT_LOGGED_IN"}})",
+				"content", count, rest));
+		REQUIRE(rest["content"]["error"] == "NOT_LOGGED_IN");
+		REQUIRE(rest["status"] == 1);
+	}
+
+	SECTION("no object at all") {
+		REQUIRE(stream_json_array("[1, 2, 3]", "content", count, rest));
+		REQUIRE(rest == json::parse("[1, 2, 3]"));
+	}
+
+	REQUIRE(elements == 0);
+}
+
+TEST_CASE("stream_json_array() returns false for input that isn't JSON",
+	"[JsonStream]")
+{
+	json rest;
+	const auto ignore = [](json&) {};
+	REQUIRE_FALSE(stream_json_array("", "items", ignore, rest));
+	REQUIRE_FALSE(stream_json_array(R"({"items": [1, 2)", "items", ignore, rest));
+	REQUIRE_FALSE(stream_json_array("<html></html>", "items", ignore, rest));
+}
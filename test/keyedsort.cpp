@@ -0,0 +1,77 @@
+#include "keyedsort.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+/// A value to sort by, and the position it started at
+using Entry = std::pair<unsigned int, std::size_t>;
+
+std::vector<Entry> make_entries(std::size_t count)
+{
+	std::vector<Entry> entries;
+	unsigned int value = 12345;
+	for (std::size_t i = 0; i < count; ++i) {
+		// Few distinct values, so that there are many ties
+		value = value * 1103515245 + 12345;
+		entries.emplace_back((value >> 16) % 97, i);
+	}
+	return entries;
+}
+
+void require_sorted_stably(const std::vector<Entry>& entries)
+{
+	for (std::size_t i = 1; i < entries.size(); ++i) {
+		const auto& a = entries[i - 1];
+		const auto& b = entries[i];
+		if (a.first > b.first || (a.first == b.first && a.second > b.second)) {
+			FAIL("out of order at " << i);
+		}
+	}
+}
+
+}
+
+TEST_CASE("keyedsort::stable_sort() keeps equal entries in their order",
+	"[keyedsort]")
+{
+	const auto by_value = [](const Entry& a, const Entry& b) {
+		return a.first < b.first;
+	};
+
+	for (const std::size_t count : {
+			std::size_t(0), std::size_t(1), std::size_t(100),
+			keyedsort::PARALLEL_THRESHOLD - 1, keyedsort::PARALLEL_THRESHOLD,
+			keyedsort::PARALLEL_THRESHOLD * 5 + 3
+		}) {
+		INFO("count " << count);
+		auto entries = make_entries(count);
+		keyedsort::stable_sort(entries, by_value);
+		REQUIRE(entries.size() == count);
+		require_sorted_stably(entries);
+	}
+}
+
+TEST_CASE("keyedsort::sort_by_key() reads each key once and sorts by it",
+	"[keyedsort]")
+{
+	std::vector<std::string> words = {"pear", "fig", "apple", "kiwi", "plum"};
+	std::size_t key_reads = 0;
+
+	keyedsort::sort_by_key<std::size_t>(words,
+	[&](const std::string& word) {
+		++key_reads;
+		return word.length();
+	}, [](std::size_t a, std::size_t b) {
+		return a < b;
+	});
+
+	REQUIRE(key_reads == 5);
+	REQUIRE(words == std::vector<std::string>({"fig", "pear", "kiwi", "plum", "apple"}));
+}
@@ -29,6 +29,37 @@ TEST_CASE("get_operation()", "[KeyMap]")
 	}
 }
 
+TEST_CASE("get_operation() sees bindings that change after it was called",
+	"[KeyMap]")
+{
+	KeyMap k(KM_NEWSBOAT);
+
+	REQUIRE(k.get_operation("u", "article") == OP_SHOWURLS);
+	REQUIRE(k.get_operation("ä", "article") == OP_NIL);
+	REQUIRE(k.get_operation("^X", "article") == OP_NIL);
+
+	k.set_key(OP_OPEN, "ä", "article");
+	k.set_key(OP_QUIT, "^X", "all");
+	k.set_key(OP_RELOAD, "u", "feedlist");
+	REQUIRE(k.get_operation("ä", "article") == OP_OPEN);
+	REQUIRE(k.get_operation("ä", "feedlist") == OP_NIL);
+	REQUIRE(k.get_operation("^X", "article") == OP_QUIT);
+	REQUIRE(k.get_operation("^X", "urlview") == OP_QUIT);
+	REQUIRE(k.get_operation("u", "article") == OP_SHOWURLS);
+	REQUIRE(k.get_operation("u", "feedlist") == OP_RELOAD);
+
+	SECTION("unset_all_keys() leaves only the internal keys") {
+		k.unset_all_keys("article");
+		REQUIRE(k.get_operation("u", "article") == OP_NIL);
+		REQUIRE(k.get_operation("ä", "article") == OP_NIL);
+		REQUIRE(k.get_operation("u", "feedlist") == OP_RELOAD);
+	}
+
+	SECTION("unknown contexts have no bindings") {
+		REQUIRE(k.get_operation("u", "no-such-context") == OP_NIL);
+	}
+}
+
 TEST_CASE("unset_key() and set_key()", "[KeyMap]")
 {
 	KeyMap k(KM_NEWSBOAT);
@@ -72,3 +72,27 @@ TEST_CASE("format_list() uses regex manager if one is passed",
 
 	REQUIRE(fmt.format_list() == expected);
 }
+
+TEST_CASE("format_line() formats a line again once it or the highlighting "
+	"rules changed", "[ListFormatter]")
+{
+	RegexManager rxmgr;
+	ListFormatter fmt(&rxmgr, "article");
+
+	fmt.add_line("Highlight me please!");
+	fmt.add_line("Leave me be");
+	REQUIRE(fmt.format_line(0) == "\"Highlight me please!\"");
+	REQUIRE(fmt.format_line(1) == "\"Leave me be\"");
+
+	rxmgr.handle_action(
+		"highlight", {"article", "please", "green", "default"});
+	REQUIRE(fmt.format_line(0) == "\"Highlight me <0>please</>!\"");
+
+	fmt.set_line(1, "Don't, please");
+	REQUIRE(fmt.format_line(1) == "\"Don't, <0>please</>\"");
+	REQUIRE(fmt.format_list() ==
+		"{list"
+		"{listitem text:\"Highlight me <0>please</>!\"}"
+		"{listitem text:\"Don't, <0>please</>\"}"
+		"}");
+}
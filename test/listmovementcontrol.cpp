@@ -393,3 +393,53 @@ TEST_CASE("move_page_down() moves down by `list height` lines, and respects `wra
 		}
 	}
 }
+
+TEST_CASE("window_around_cursor() covers the screen wherever it's scrolled to",
+	"[ListMovementControl]")
+{
+	auto list_movement = ListMovementControl<ListStub>(dummyFormName, dummyForm, 0);
+	ListStub& list = list_movement;
+	list.height = 10;
+	list.num_lines = 1000;
+
+	SECTION("the window is the whole list if it's short") {
+		list.num_lines = 15;
+		list_movement.set_position(7);
+
+		const auto window = list_movement.window_around_cursor(15, 20);
+		REQUIRE(window.first == 0);
+		REQUIRE(window.second == 15);
+	}
+
+	SECTION("the window reaches a screen and a margin beyond the cursor") {
+		list_movement.set_position(500);
+
+		const auto window = list_movement.window_around_cursor(1000, 20);
+		REQUIRE(window.first == 500 - 30);
+		REQUIRE(window.second == 500 + 30);
+		REQUIRE(window.first <= list.scroll_offset);
+		REQUIRE(window.second >= list.scroll_offset + list.height);
+	}
+
+	SECTION("the margin is at least a screen") {
+		list_movement.set_position(500);
+
+		const auto window = list_movement.window_around_cursor(1000, 0);
+		REQUIRE(window.first == 500 - 20);
+		REQUIRE(window.second == 500 + 20);
+	}
+
+	SECTION("the window stops at the ends of the list") {
+		list_movement.set_position(995);
+
+		const auto window = list_movement.window_around_cursor(1000, 20);
+		REQUIRE(window.first == 995 - 30);
+		REQUIRE(window.second == 1000);
+	}
+
+	SECTION("an empty list has an empty window") {
+		const auto window = list_movement.window_around_cursor(0, 20);
+		REQUIRE(window.first == 0);
+		REQUIRE(window.second == 0);
+	}
+}
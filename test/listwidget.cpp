@@ -117,3 +117,92 @@ TEST_CASE("stfl_replace_list() makes sure `position < num_lines`", "[ListWidget]
 		}
 	}
 }
+
+TEST_CASE("stfl_replace_window() keeps positions relative to the whole list",
+	"[ListWidget]")
+{
+	const std::uint32_t scrolloff = 0;
+	Stfl::Form listForm(stflListForm);
+
+	ListFormatter fmt;
+	for (int i = 10; i < 20; ++i) {
+		fmt.add_line("line " + std::to_string(i));
+	}
+
+	ListWidget listWidget("list-name", listForm, scrolloff);
+
+	GIVEN("a window of lines 10 to 19 out of 100") {
+		listWidget.stfl_replace_window(fmt, 10, 100);
+
+		THEN("the widget knows about all 100 lines") {
+			REQUIRE(listWidget.get_num_lines() == 100);
+			REQUIRE(listWidget.get_window_start() == 10);
+			REQUIRE(listWidget.get_window_size() == 10);
+		}
+
+		WHEN("the cursor is moved into the window") {
+			listWidget.set_position(15);
+
+			THEN("STFL gets the position within the window") {
+				REQUIRE(listWidget.get_position() == 15);
+				REQUIRE(listForm.get("list-name_pos") == "5");
+			}
+		}
+
+		WHEN("the cursor is moved past the last line") {
+			listWidget.set_position(99);
+			listWidget.stfl_replace_window(fmt, 10, 50);
+
+			THEN("the position is changed to the last line of the list") {
+				REQUIRE(listWidget.get_position() == 49);
+			}
+		}
+
+		WHEN("the window is replaced by the whole list") {
+			listWidget.set_position(15);
+			fmt.clear();
+			for (int i = 0; i < 20; ++i) {
+				fmt.add_line("line " + std::to_string(i));
+			}
+			listWidget.stfl_replace_lines(fmt);
+
+			THEN("STFL gets the position within the whole list") {
+				REQUIRE(listWidget.get_position() == 15);
+				REQUIRE(listWidget.get_window_start() == 0);
+				REQUIRE(listForm.get("list-name_pos") == "15");
+			}
+		}
+	}
+}
+
+TEST_CASE("window_covers_viewport() tells if the lines on screen were handed "
+	"to STFL", "[ListWidget]")
+{
+	const std::uint32_t scrolloff = 0;
+	Stfl::Form listForm(stflListForm);
+
+	ListFormatter fmt;
+	for (int i = 0; i < 10; ++i) {
+		fmt.add_line("line " + std::to_string(i));
+	}
+
+	ListWidget listWidget("list-name", listForm, scrolloff);
+
+	SECTION("a whole list covers the screen") {
+		listWidget.stfl_replace_lines(fmt);
+		REQUIRE(listWidget.window_covers_viewport());
+	}
+
+	SECTION("a window that starts below the screen doesn't") {
+		listWidget.stfl_replace_window(fmt, 10, 100);
+		REQUIRE_FALSE(listWidget.window_covers_viewport());
+	}
+
+	SECTION("a window doesn't once the cursor leaves it") {
+		listWidget.stfl_replace_window(fmt, 0, 100);
+		REQUIRE(listWidget.window_covers_viewport());
+
+		listWidget.set_position(50);
+		REQUIRE_FALSE(listWidget.window_covers_viewport());
+	}
+}
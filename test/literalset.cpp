@@ -0,0 +1,55 @@
+#include "literalset.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("LiteralSet::find_all() finds every occurrence of every literal, "
+	"ordered by their ends", "[LiteralSet]")
+{
+	const LiteralSet set({"he", "she", "hers", "his"});
+
+	const auto matches = set.find_all("ushers and HIS");
+	REQUIRE(matches.size() == 4);
+
+	REQUIRE(matches[0].literal == 1);
+	REQUIRE(matches[0].start == 1);
+	REQUIRE(matches[0].end == 4);
+
+	REQUIRE(matches[1].literal == 0);
+	REQUIRE(matches[1].start == 2);
+	REQUIRE(matches[1].end == 4);
+
+	REQUIRE(matches[2].literal == 2);
+	REQUIRE(matches[2].start == 2);
+	REQUIRE(matches[2].end == 6);
+
+	REQUIRE(matches[3].literal == 3);
+	REQUIRE(matches[3].start == 11);
+	REQUIRE(matches[3].end == 14);
+
+	REQUIRE(set.find_all("").empty());
+	REQUIRE(LiteralSet({}).find_all("anything").empty());
+}
+
+TEST_CASE("LiteralSet::find_all() reports overlapping occurrences of the "
+	"same literal", "[LiteralSet]")
+{
+	const LiteralSet set({"aa"});
+	REQUIRE(set.find_all("aaaa").size() == 3);
+}
+
+TEST_CASE("LiteralSet::is_literal() accepts patterns without special "
+	"characters", "[LiteralSet]")
+{
+	REQUIRE(LiteralSet::is_literal("newsboat"));
+	REQUIRE(LiteralSet::is_literal("Breaking news: 2 dead, 3-4 hurt!"));
+
+	REQUIRE_FALSE(LiteralSet::is_literal(""));
+	for (const auto& pattern : {
+			"a.b", "[ab]", "(a)", "a*", "a+", "a?", "a{2}", "a|b", "^a", "a$",
+			"a\\b", "caf\xc3\xa9", "tab\there"
+		}) {
+		REQUIRE_FALSE(LiteralSet::is_literal(pattern));
+	}
+}
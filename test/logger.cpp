@@ -0,0 +1,73 @@
+#include "logger.h"
+
+#include "3rd-party/catch.hpp"
+
+#include "test_helpers/loggerresetter.h"
+
+using namespace newsboat;
+
+namespace {
+
+unsigned int evaluated = 0;
+
+std::string count_evaluation()
+{
+	++evaluated;
+	return "argument";
+}
+
+}
+
+TEST_CASE("LOG() doesn't evaluate its arguments unless the level is enabled",
+	"[Logger]")
+{
+	test_helpers::LoggerResetter logReset;
+	evaluated = 0;
+
+	LOG(Level::DEBUG, "%s", count_evaluation());
+	REQUIRE(evaluated == 0);
+
+	logger::set_loglevel(Level::INFO);
+	LOG(Level::DEBUG, "%s", count_evaluation());
+	REQUIRE(evaluated == 0);
+	LOG(Level::INFO, "%s", count_evaluation());
+	REQUIRE(evaluated == 1);
+
+	// USERERROR messages always go to the error log
+	logger::unset_loglevel();
+	LOG(Level::USERERROR, "%s", count_evaluation());
+	REQUIRE(evaluated == 2);
+}
+
+TEST_CASE("A module's own loglevel overrides the global one", "[Logger]")
+{
+	test_helpers::LoggerResetter logReset;
+	evaluated = 0;
+
+	// This file is the "logger" module
+	logger::set_module_loglevel("logger", Level::DEBUG);
+	LOG(Level::DEBUG, "%s", count_evaluation());
+	logger::set_module_loglevel("reloader", Level::DEBUG);
+	logger::set_module_loglevel("logger", Level::ERROR);
+	logger::set_loglevel(Level::DEBUG);
+	LOG(Level::WARN, "%s", count_evaluation());
+	logger::unset_module_loglevel("reloader");
+	logger::unset_module_loglevel("logger");
+	LOG(Level::WARN, "%s", count_evaluation());
+
+	REQUIRE(evaluated == 2);
+}
+
+TEST_CASE("module_loglevel() names modules after the file, without its "
+	"directory and extension", "[Logger]")
+{
+	auto& level = logger::module_loglevel("src/some/module.cpp");
+	REQUIRE(&level == &logger::module_loglevel("include/module.h"));
+	REQUIRE(&level != &logger::module_loglevel("src/other.cpp"));
+
+	REQUIRE(level.load() == logger::GLOBAL_LOGLEVEL);
+	logger::set_module_loglevel("module", Level::INFO);
+	REQUIRE(level.load() == static_cast<std::int64_t>(Level::INFO));
+	logger::unset_module_loglevel("module");
+	REQUIRE(level.load() == logger::GLOBAL_LOGLEVEL);
+}
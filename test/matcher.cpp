@@ -2,6 +2,8 @@
 
 #include "3rd-party/catch.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 
 #include "matchable.h"
@@ -645,6 +647,306 @@ TEST_CASE("Operator `between` checks if field's value is in given range",
 	}
 }
 
+TEST_CASE("Matcher looks attributes up by their ids", "[Matcher]")
+{
+	class IdMatchable : public Matchable {
+	public:
+		nonstd::optional<std::string> attribute_value(const std::string&)
+		const override
+		{
+			return nonstd::nullopt;
+		}
+
+		nonstd::optional<std::string> attribute_value_by_id(
+			MatchableAttribute id, const std::string& attr) const override
+		{
+			if (id == MatchableAttribute::TITLE) {
+				return std::string("title");
+			} else if (id == MatchableAttribute::UNKNOWN && attr == "custom") {
+				return std::string("custom");
+			}
+			return nonstd::nullopt;
+		}
+	};
+
+	IdMatchable item;
+	Matcher m;
+
+	REQUIRE(m.parse("title = \"title\""));
+	REQUIRE(m.matches(&item));
+
+	SECTION("the name of attributes without an id is passed along") {
+		REQUIRE(m.parse("custom = \"custom\" and title =~ \"^t\""));
+		REQUIRE(m.matches(&item));
+	}
+}
+
+TEST_CASE("Matcher compares the numbers of attributes that have them",
+	"[Matcher]")
+{
+	class NumberMatchable : public Matchable {
+	public:
+		nonstd::optional<std::string> attribute_value(const std::string& attr)
+		const override
+		{
+			if (attr == "age") {
+				return std::string("this isn't used");
+			}
+			return std::string("12");
+		}
+
+		nonstd::optional<std::int64_t> attribute_number_by_id(
+			MatchableAttribute id, std::time_t now) const override
+		{
+			if (id == MatchableAttribute::AGE) {
+				ages_asked.push_back(now);
+				return 30;
+			} else if (id == MatchableAttribute::ARTICLEINDEX) {
+				return std::int64_t(1) << 40;
+			}
+			return nonstd::nullopt;
+		}
+
+		mutable std::vector<std::time_t> ages_asked;
+	};
+
+	NumberMatchable item;
+	Matcher m;
+
+	REQUIRE(m.parse("age > 29 and age < 31 and age between 30:30"));
+	REQUIRE(m.matches(&item));
+	REQUIRE(m.parse("age >= \"31\""));
+	REQUIRE_FALSE(m.matches(&item));
+
+	SECTION("numbers beyond the range of int are clamped like parsed ones") {
+		REQUIRE(m.parse("articleindex >= 2147483647"));
+		REQUIRE(m.matches(&item));
+	}
+
+	SECTION("attributes without a number are parsed") {
+		REQUIRE(m.parse("title between 11:13 and title <= 12"));
+		REQUIRE(m.matches(&item));
+	}
+
+	SECTION("a batch counts every age up to the same time") {
+		NumberMatchable other;
+		REQUIRE(m.parse("age > 0"));
+		item.ages_asked.clear();
+		REQUIRE(m.matches({&item, &other}) == std::vector<bool>({true, true}));
+		REQUIRE(item.ages_asked.size() == 1);
+		REQUIRE(other.ages_asked == item.ages_asked);
+	}
+}
+
+TEST_CASE("matches() can match a batch of items at once", "[Matcher]")
+{
+	MatcherMockMatchable small({{"answer", "1"}});
+	MatcherMockMatchable large({{"answer", "100"}});
+	MatcherMockMatchable other({{"question", "why"}});
+
+	Matcher m("answer > 42");
+
+	REQUIRE(m.matches(std::vector<Matchable*>()).empty());
+	REQUIRE(m.matches({&small, &large, nullptr, &large})
+		== std::vector<bool>({false, true, false, true}));
+
+	SECTION("throws if an item lacks an attribute, like matches() would") {
+		REQUIRE_THROWS_AS(m.matches({&large, &other}), MatcherException);
+	}
+}
+
+TEST_CASE("matches() gives the same answers for large batches, which are "
+	"split between threads", "[Matcher]")
+{
+	std::vector<MatcherMockMatchable> items;
+	for (int i = 0; i < 20000; ++i) {
+		items.push_back(MatcherMockMatchable({
+			{"answer", std::to_string(i % 100)},
+			{"question", i % 3 == 0 ? "why" : "how"}
+		}));
+	}
+	std::vector<Matchable*> batch;
+	for (auto& item : items) {
+		batch.push_back(&item);
+	}
+
+	Matcher m("answer > 42 or question =~ \"^w\"");
+	const auto matched = m.matches(batch);
+	REQUIRE(matched.size() == batch.size());
+	for (std::size_t i = 0; i < batch.size(); ++i) {
+		INFO("item " << i);
+		REQUIRE(matched[i] == m.matches(batch[i]));
+	}
+
+	SECTION("throws for the first item that a single thread would throw for") {
+		MatcherMockMatchable no_question({{"answer", "1"}});
+		MatcherMockMatchable no_answer({{"question", "how"}});
+		batch[5000] = &no_question;
+		batch[15000] = &no_answer;
+		try {
+			m.matches(batch);
+			FAIL("matches() didn't throw");
+		} catch (const MatcherException& e) {
+			REQUIRE(e.info() == "question");
+		}
+	}
+
+	SECTION("leaves items unmatched once cancelled") {
+		const std::atomic<bool> cancel(true);
+		const auto cancelled = m.matches(batch, &cancel);
+		REQUIRE(cancelled.size() == batch.size());
+		REQUIRE(std::find(cancelled.begin(), cancelled.end(), true) ==
+			cancelled.end());
+	}
+}
+
+TEST_CASE("matches_all() matches a batch against several expressions at "
+	"once", "[Matcher]")
+{
+	class CountingMatchable : public MatcherMockMatchable {
+	public:
+		CountingMatchable(const std::string& content)
+			: MatcherMockMatchable({{"content", content}})
+			, reads(0)
+		{
+		}
+
+		nonstd::optional<std::string> attribute_value(const std::string& attr)
+		const override
+		{
+			++reads;
+			return MatcherMockMatchable::attribute_value(attr);
+		}
+
+		mutable unsigned int reads;
+	};
+
+	CountingMatchable small("1");
+	CountingMatchable large("70");
+	Matcher high("content =~ \"^[5-9]\"");
+	Matcher one("content = \"1\"");
+	Matcher missing("question = \"why\"");
+	std::vector<std::exception_ptr> errors;
+
+	SECTION("gives what matches() gives for each, reading every attribute "
+		"once") {
+		const auto matched = Matcher::matches_all({&high, &one},
+		{&small, nullptr, &large}, errors);
+		REQUIRE(matched == std::vector<std::vector<bool>>({
+			{false, false, true},
+			{true, false, false},
+		}));
+		REQUIRE(errors == std::vector<std::exception_ptr>(2, nullptr));
+		REQUIRE(small.reads == 1);
+		REQUIRE(large.reads == 1);
+	}
+
+	SECTION("keeps the errors of one expression from the others") {
+		const auto matched = Matcher::matches_all({&missing, &high},
+		{&small, &large}, errors);
+		REQUIRE(matched == std::vector<std::vector<bool>>({
+			{false, false},
+			{false, true},
+		}));
+		REQUIRE(errors[0] != nullptr);
+		REQUIRE_THROWS_AS(std::rethrow_exception(errors[0]), MatcherException);
+		REQUIRE(errors[1] == nullptr);
+	}
+
+	SECTION("gives the same answers for large batches, which are split "
+		"between threads") {
+		std::vector<CountingMatchable> items;
+		for (int i = 0; i < 20000; ++i) {
+			items.emplace_back(std::to_string(i % 100));
+		}
+		std::vector<Matchable*> batch;
+		for (auto& item : items) {
+			batch.push_back(&item);
+		}
+		const auto matched = Matcher::matches_all({&high, &one}, batch,
+				errors);
+		REQUIRE(matched[0] == high.matches(batch));
+		REQUIRE(matched[1] == one.matches(batch));
+	}
+}
+
+TEST_CASE("Matcher checks cheap attributes before expensive ones", "[Matcher]")
+{
+	class CountingMatchable : public Matchable {
+	public:
+		nonstd::optional<std::string> attribute_value(const std::string& attr)
+		const override
+		{
+			requested.push_back(attr);
+			if (attr == "unread") {
+				return std::string("no");
+			} else if (attr == "content") {
+				return std::string("foo bar");
+			} else if (attr == "title") {
+				return std::string("foo");
+			}
+			return nonstd::nullopt;
+		}
+
+		mutable std::vector<std::string> requested;
+	};
+
+	CountingMatchable item;
+	Matcher m;
+
+	SECTION("`and` doesn't read the content if the flag already fails") {
+		REQUIRE(m.parse("content =~ \"foo\" and unread = \"yes\""));
+		REQUIRE_FALSE(m.matches(&item));
+		REQUIRE(item.requested == std::vector<std::string>({"unread"}));
+	}
+
+	SECTION("`or` doesn't read the content if the title already matches") {
+		REQUIRE(m.parse("content =~ \"foo\" or title = \"foo\""));
+		REQUIRE(m.matches(&item));
+		REQUIRE(item.requested == std::vector<std::string>({"title"}));
+	}
+
+	SECTION("the result doesn't depend on the order") {
+		REQUIRE(m.parse("(title = \"foo\" or unread = \"yes\") and content # \"bar\""));
+		REQUIRE(m.matches(&item));
+		REQUIRE(m.parse("unread = \"yes\" or (content # \"baz\" and title = \"foo\")"));
+		REQUIRE_FALSE(m.matches(&item));
+	}
+}
+
+TEST_CASE("sql_condition() translates expressions on stored item "
+	"attributes", "[Matcher]")
+{
+	Matcher m;
+
+	REQUIRE(m.parse("unread = \"yes\""));
+	REQUIRE(m.sql_condition() == std::string("(rss_item.unread = 1)"));
+
+	REQUIRE(m.parse("unread != \"maybe\" and flags = \"a'b\""));
+	REQUIRE(m.sql_condition()
+		== std::string("((NOT 0) AND (IFNULL(rss_item.flags, '') = 'a''b'))"));
+
+	REQUIRE(m.parse("age between 7:3 or guid != \"x\""));
+	const auto condition = m.sql_condition();
+	REQUIRE(condition.has_value());
+	REQUIRE(condition.value().find("BETWEEN 3 AND 7") != std::string::npos);
+	REQUIRE(condition.value().find("(rss_item.guid != 'x')") != std::string::npos);
+
+	SECTION("returns nullopt if any part can't be translated") {
+		for (const auto& expr : {
+				"title = \"foo\"",
+				"link =~ \"example\"",
+				"flags # \"a\"",
+				"age = 3",
+				"unread = \"yes\" and content =~ \"foo\"",
+				"unknown = 1"
+			}) {
+			REQUIRE(m.parse(expr));
+			REQUIRE_FALSE(m.sql_condition().has_value());
+		}
+	}
+}
+
 TEST_CASE("get_expression() returns previously parsed expression", "[Matcher]")
 {
 	Matcher m("AAAA between 1:30000");
@@ -851,6 +1153,21 @@ TEST_CASE("Whitespace before and/or is not required", "[Matcher]")
 	REQUIRE(m.matches(&mock));
 }
 
+TEST_CASE("uses_attribute() tells whether the expression looks at an "
+	"attribute",
+	"[Matcher]")
+{
+	Matcher m("title =~ \"foo\" and (age < 3 or unread = \"yes\")");
+
+	REQUIRE(m.uses_attribute(MatchableAttribute::TITLE));
+	REQUIRE(m.uses_attribute(MatchableAttribute::AGE));
+	REQUIRE(m.uses_attribute(MatchableAttribute::UNREAD));
+	REQUIRE_FALSE(m.uses_attribute(MatchableAttribute::AUTHOR));
+	REQUIRE_FALSE(m.uses_attribute(MatchableAttribute::UNREAD_COUNT));
+
+	REQUIRE_FALSE(Matcher().uses_attribute(MatchableAttribute::TITLE));
+}
+
 TEST_CASE("string_to_num() converts numeric prefix of the string to int",
 	"[Matcher]")
 {
@@ -0,0 +1,156 @@
+#include "multidownloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "curlhandle.h"
+#include "rss/feed.h"
+#include "rss/parser.h"
+#include "utils.h"
+
+using namespace newsboat;
+
+namespace {
+
+size_t append_to_string(char* data, size_t size, size_t nmemb, void* userp)
+{
+	static_cast<std::string*>(userp)->append(data, size * nmemb);
+	return size * nmemb;
+}
+
+void set_up(CurlHandle& handle, const std::string& url, std::string& body)
+{
+	curl_easy_setopt(handle.ptr(), CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEFUNCTION, append_to_string);
+	curl_easy_setopt(handle.ptr(), CURLOPT_WRITEDATA, &body);
+}
+
+} // namespace
+
+TEST_CASE("MultiDownloader reports the result of every transfer",
+	"[MultiDownloader]")
+{
+	const std::string data_dir = "file://" + utils::getcwd() + "/data/";
+	const std::vector<std::string> files = {
+		"rss.xml", "atom10_1.xml", "rss20_1.xml", "no-such-file.xml"
+	};
+
+	// Fewer slots than transfers, so some of them have to wait their turn
+	MultiDownloader downloader(2);
+	std::vector<CurlHandle> handles(files.size());
+	std::vector<std::string> bodies(files.size());
+	std::map<std::string, CURLcode> results;
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		set_up(handles[i], data_dir + files[i], bodies[i]);
+		const std::string file = files[i];
+		downloader.add(handles[i], [&, file](CURLcode result) {
+			results[file] = result;
+			if (results.size() == files.size()) {
+				downloader.finish();
+			}
+		});
+	}
+	downloader.run();
+
+	REQUIRE(results.size() == files.size());
+	REQUIRE(results["rss.xml"] == CURLE_OK);
+	REQUIRE(results["atom10_1.xml"] == CURLE_OK);
+	REQUIRE(results["rss20_1.xml"] == CURLE_OK);
+	REQUIRE(results["no-such-file.xml"] != CURLE_OK);
+	REQUIRE(bodies[0].find("<rss") != std::string::npos);
+	REQUIRE(bodies[1].find("<feed") != std::string::npos);
+	REQUIRE(bodies[3].empty());
+}
+
+TEST_CASE("MultiDownloader takes transfers added by other threads and by "
+	"callbacks while it runs", "[MultiDownloader]")
+{
+	const std::string url = "file://" + utils::getcwd() + "/data/rss.xml";
+
+	MultiDownloader downloader(0);
+	CurlHandle first;
+	CurlHandle second;
+	std::string first_body;
+	std::string second_body;
+	set_up(first, url, first_body);
+
+	std::thread adder([&]() {
+		downloader.add(first, [&](CURLcode result) {
+			REQUIRE(result == CURLE_OK);
+			set_up(second, url, second_body);
+			downloader.add(second, [&](CURLcode result) {
+				REQUIRE(result == CURLE_OK);
+				downloader.finish();
+			});
+		});
+	});
+	downloader.run();
+	adder.join();
+
+	REQUIRE_FALSE(first_body.empty());
+	REQUIRE(second_body == first_body);
+}
+
+TEST_CASE("rsspp::Parser parses a transfer that MultiDownloader performed",
+	"[MultiDownloader]")
+{
+	const std::string url = "file://" + utils::getcwd() + "/data/rss.xml";
+
+	rsspp::Parser parser;
+	CurlHandle handle;
+	rsspp::Transfer transfer;
+	parser.prepare_transfer(url, handle, transfer);
+
+	MultiDownloader downloader(1);
+	CURLcode transfer_result = CURLE_FAILED_INIT;
+	downloader.add(handle, [&](CURLcode result) {
+		transfer_result = result;
+		downloader.finish();
+	});
+	downloader.run();
+
+	const rsspp::Feed feed = parser.finish_transfer(url, handle, transfer,
+			transfer_result);
+	REQUIRE(feed.rss_version == rsspp::Feed::Version::RSS_2_0);
+	REQUIRE(feed.items.size() == 8);
+}
+
+TEST_CASE("MultiDownloader spaces out transfers to the same host, but not "
+	"the ones to other hosts", "[MultiDownloader]")
+{
+	using Clock = std::chrono::steady_clock;
+	const std::string url = "file://" + utils::getcwd() + "/data/rss.xml";
+	const auto delay = std::chrono::milliseconds(50);
+
+	MultiDownloader downloader(0, 1, delay);
+	std::vector<CurlHandle> handles(4);
+	std::vector<std::string> bodies(handles.size());
+	std::vector<std::string> finished;
+	std::vector<Clock::time_point> finished_at;
+	const std::vector<std::string> hosts = {"a", "a", "a", "b"};
+	for (unsigned int i = 0; i < handles.size(); ++i) {
+		set_up(handles[i], url, bodies[i]);
+		const std::string host = hosts[i];
+		downloader.add(handles[i], [&, host](CURLcode result) {
+			REQUIRE(result == CURLE_OK);
+			finished.push_back(host);
+			finished_at.push_back(Clock::now());
+			if (finished.size() == handles.size()) {
+				downloader.finish();
+			}
+		}, host);
+	}
+	const auto start = Clock::now();
+	downloader.run();
+
+	REQUIRE(finished.size() == 4);
+	// Both hosts' first transfers can start right away
+	REQUIRE(finished.back() == "a");
+	REQUIRE(std::count(finished.begin(), finished.begin() + 2, "b") == 1);
+	REQUIRE(finished_at.back() - start >= 2 * delay);
+}
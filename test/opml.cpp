@@ -1,5 +1,6 @@
 #include "opml.h"
 
+#include <fstream>
 #include <libxml/xmlsave.h>
 
 #include "3rd-party/catch.hpp"
@@ -274,6 +275,31 @@ TEST_CASE("import() skips URLs that are already present in UrlReader",
 	}
 }
 
+TEST_CASE("import() doesn't add anything from an OPML file that is cut short",
+	"[Opml]")
+{
+	test_helpers::TempFile urlsFile;
+	test_helpers::TempFile opmlFile;
+
+	test_helpers::copy_file("data/test-urls.txt", urlsFile.get_path());
+	{
+		std::ofstream opml(opmlFile.get_path());
+		opml << "<?xml version=\"1.0\"?>\n"
+			"<opml version=\"1.0\"><body>\n"
+			"<outline text=\"Folder\">\n"
+			"<outline type=\"rss\" xmlUrl=\"https://example.com/new.xml\"/>\n"
+			"<outline type=\"rss\" xmlUrl=\"https://exa";
+	}
+
+	FileUrlReader urlcfg(urlsFile.get_path());
+	urlcfg.reload();
+	const auto urls = urlcfg.get_urls();
+
+	const auto error = opml::import(opmlFile.get_path(), urlcfg);
+	REQUIRE(error.has_value());
+	REQUIRE(urlcfg.get_urls() == urls);
+}
+
 // falls back to "url" if "xmlUrl" is absent
 
 // skips an entry if xmlUrl/url is absent
@@ -6,6 +6,7 @@
 
 #include "3rd-party/catch.hpp"
 #include "test_helpers/misc.h"
+#include "test_helpers/replayserver.h"
 #include "test_helpers/tempfile.h"
 #include "utils.h"
 
@@ -198,3 +199,42 @@ TEST_CASE("OpmlUrlReader::reload() skips things that can't be parsed",
 	tags.insert(alltags.cbegin(), alltags.cend());
 	REQUIRE(tags == expected_tags);
 }
+
+TEST_CASE("OpmlUrlReader::reload() uses the feeds it read last time if the "
+	"OPML file didn't change", "[OpmlUrlReader]")
+{
+	test_helpers::ReplayArchive::Response response;
+	response.url = "http://example.com/feeds.opml";
+	response.headers = {
+		{"Content-Type", "text/x-opml"},
+		{"ETag", "\"1\""},
+	};
+	response.body = "<?xml version=\"1.0\"?>\n"
+		"<opml version=\"1.0\"><body>\n"
+		"<outline type=\"rss\" xmlUrl=\"https://example.com/feed.xml\"/>\n"
+		"<outline title=\"Blogs\">\n"
+		"<outline type=\"rss\" xmlUrl=\"https://blogs.example.com/rss\"/>\n"
+		"</outline>\n"
+		"</body></opml>\n";
+	test_helpers::ReplayArchive archive;
+	archive.responses.push_back(response);
+	test_helpers::ReplayServer server(archive);
+
+	ConfigContainer cfg;
+	cfg.set_configvalue("opml-url", server.url_for(0));
+	OpmlUrlReader reader(&cfg);
+
+	const std::vector<std::string> expected = {
+		"https://example.com/feed.xml",
+		"https://blogs.example.com/rss",
+	};
+	for (int reload = 0; reload < 2; ++reload) {
+		INFO("reload #" << reload);
+		REQUIRE_NOTHROW(reader.reload());
+		REQUIRE(reader.get_urls() == expected);
+		REQUIRE(reader.get_tags(expected[0]).empty());
+		REQUIRE(reader.get_tags(expected[1]) == std::vector<std::string>{"Blogs"});
+		REQUIRE(reader.get_alltags() == std::vector<std::string>{"Blogs"});
+	}
+	REQUIRE(server.requests() == 2);
+}
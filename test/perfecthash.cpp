@@ -0,0 +1,92 @@
+#include "perfecthash.h"
+
+#include <cstring>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+constexpr const char* colors[] = {"red", "green", "blue", "cyan", "magenta"};
+
+template<bool FoldCase, std::uint32_t Seed>
+struct Colors {
+	static constexpr std::size_t count = sizeof(colors) / sizeof(colors[0]);
+	static constexpr std::size_t slots = 16;
+	static constexpr std::uint32_t seed = Seed;
+	static constexpr bool fold_case = FoldCase;
+	static constexpr const char* at(std::size_t i)
+	{
+		return colors[i];
+	}
+};
+
+// Found by trying seeds until the names got a slot each
+using CaseSensitive = Colors<false, 2166136262u>;
+using CaseInsensitive = Colors<true, 2166136262u>;
+static_assert(perfect_hash::is_perfect<CaseSensitive>(),
+	"seed doesn't work for the test names");
+
+/// Names that only differ in case, which share a slot when case is folded
+struct SameFolded {
+	static constexpr std::size_t count = 2;
+	static constexpr std::size_t slots = 16;
+	static constexpr std::uint32_t seed = 0;
+	static constexpr bool fold_case = true;
+	static constexpr const char* at(std::size_t i)
+	{
+		return i == 0 ? "name" : "NAME";
+	}
+};
+
+int find(const perfect_hash::Table<CaseSensitive>& table, const char* s)
+{
+	return table.find(s, std::strlen(s));
+}
+
+}
+
+TEST_CASE("perfect_hash::Table finds each of its names", "[perfect_hash]")
+{
+	const perfect_hash::Table<CaseSensitive> table;
+
+	for (std::size_t i = 0; i < CaseSensitive::count; ++i) {
+		INFO("name: " << colors[i]);
+		REQUIRE(find(table, colors[i]) == static_cast<int>(i));
+	}
+}
+
+TEST_CASE("perfect_hash::Table finds nothing for other strings",
+	"[perfect_hash]")
+{
+	const perfect_hash::Table<CaseSensitive> table;
+
+	REQUIRE(find(table, "") == -1);
+	REQUIRE(find(table, "re") == -1);
+	REQUIRE(find(table, "reds") == -1);
+	REQUIRE(find(table, "Red") == -1);
+	REQUIRE(find(table, "yellow") == -1);
+	REQUIRE(find(table, "magentas") == -1);
+	REQUIRE(table.find("red\0", 4) == -1);
+}
+
+TEST_CASE("perfect_hash::Table ignores ASCII case if asked to",
+	"[perfect_hash]")
+{
+	static_assert(perfect_hash::is_perfect<CaseInsensitive>(),
+		"seed doesn't work for the test names");
+	const perfect_hash::Table<CaseInsensitive> table;
+
+	REQUIRE(table.find("RED", 3) == 0);
+	REQUIRE(table.find("Green", 5) == 1);
+	REQUIRE(table.find("bLuE", 4) == 2);
+	REQUIRE(table.find("REDS", 4) == -1);
+}
+
+TEST_CASE("perfect_hash::is_perfect() is false if two names share a slot",
+	"[perfect_hash]")
+{
+	REQUIRE_FALSE(perfect_hash::is_perfect<SameFolded>());
+	REQUIRE(perfect_hash::max_length<SameFolded>() == 4);
+}
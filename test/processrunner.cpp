@@ -0,0 +1,105 @@
+#include "processrunner.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempdir.h"
+
+using namespace newsboat;
+
+namespace {
+
+struct Result {
+	int status = -2;
+	std::string output;
+};
+
+/// Runs every one of \a commands through `sh -c` on a ProcessRunner, with
+/// the matching \a inputs if there are any.
+std::vector<Result> run_all(const std::vector<std::string>& commands,
+	unsigned int max_processes,
+	const std::vector<std::string>& inputs = {})
+{
+	std::vector<Result> results(commands.size());
+	ProcessRunner runner(max_processes);
+	std::thread thread([&]() {
+		runner.run();
+	});
+	for (std::size_t i = 0; i < commands.size(); ++i) {
+		nonstd::optional<std::string> input;
+		if (i < inputs.size()) {
+			input = inputs[i];
+		}
+		runner.add({"sh", "-c", commands[i]}, input, [&results, i](int status,
+		std::string output) {
+			results[i].status = status;
+			results[i].output = output;
+		});
+	}
+	runner.finish();
+	thread.join();
+	return results;
+}
+
+} // namespace
+
+TEST_CASE("ProcessRunner collects the output and the exit status of every "
+	"program", "[ProcessRunner]")
+{
+	const auto results = run_all({"echo one", "printf two; exit 3"}, 0);
+
+	REQUIRE(results[0].status == 0);
+	REQUIRE(results[0].output == "one\n");
+	REQUIRE(results[1].status == 3);
+	REQUIRE(results[1].output == "two");
+}
+
+TEST_CASE("ProcessRunner writes the input to the program's standard input",
+	"[ProcessRunner]")
+{
+	// More than a pipe holds, so it has to be written as the program reads
+	const std::string big(1 << 20, 'x');
+	const auto results = run_all({"tr x y", "wc -c", "cat"}, 0,
+	{big, "", "abc"});
+
+	REQUIRE(results[0].output == std::string(1 << 20, 'y'));
+	REQUIRE(results[1].output.find('0') != std::string::npos);
+	REQUIRE(results[2].output == "abc");
+}
+
+TEST_CASE("ProcessRunner runs no more programs at once than it's allowed to",
+	"[ProcessRunner]")
+{
+	test_helpers::TempDir dir;
+	// Every program marks that it's running with a file, and fails if it
+	// finds the mark of another one
+	const std::string check = "cd '" + dir.get_path() + "' && "
+		"[ -z \"$(ls)\" ] && touch $$ && sleep 0.1 && rm $$";
+	const auto results = run_all({check, check, check}, 1);
+
+	for (const auto& result : results) {
+		REQUIRE(result.status == 0);
+	}
+}
+
+TEST_CASE("ProcessRunner reports programs that can't be run",
+	"[ProcessRunner]")
+{
+	std::vector<Result> results(1);
+	ProcessRunner runner(0);
+	std::thread thread([&]() {
+		runner.run();
+	});
+	runner.add({"/nonexistent/program"}, nonstd::nullopt, [&](int status,
+	std::string output) {
+		results[0].status = status;
+		results[0].output = output;
+	});
+	runner.finish();
+	thread.join();
+
+	REQUIRE(results[0].status == 127);
+	REQUIRE(results[0].output.empty());
+}
@@ -9,6 +9,7 @@
 
 #include "configcontainer.h"
 #include "download.h"
+#include "filestamp.h"
 
 using namespace newsboat;
 using namespace podboat;
@@ -570,6 +571,51 @@ TEST_CASE("reload() removes empty lines from the queue file", "[QueueLoader]")
 		test_helpers::file_contents("data/queue-file-with-empty-lines-removed"));
 }
 
+TEST_CASE("reload() only writes the queue file if its contents change",
+	"[QueueLoader]")
+{
+	test_helpers::TempFile queueFile;
+	test_helpers::copy_file("data/nonempty-queue-file", queueFile.get_path());
+
+	auto empty_callback = []() {};
+	ConfigContainer cfg;
+	QueueLoader queue_loader(queueFile.get_path(), cfg, empty_callback);
+
+	std::vector<Download> downloads;
+	queue_loader.reload(downloads);
+	const auto contents = test_helpers::file_contents(queueFile.get_path());
+	const auto stamp = FileStamp::of(queueFile.get_path());
+
+	SECTION("nothing changed") {
+		queue_loader.reload(downloads);
+
+		REQUIRE(FileStamp::of(queueFile.get_path()) == stamp);
+		REQUIRE(downloads.size() == 5);
+	}
+
+	SECTION("a download changed its status") {
+		downloads[0].set_status(DlStatus::DELETED);
+		queue_loader.reload(downloads);
+
+		REQUIRE(downloads.size() == 4);
+		const auto new_contents = test_helpers::file_contents(queueFile.get_path());
+		REQUIRE(new_contents.size() == contents.size() - 1);
+		REQUIRE(new_contents[0] == contents[1]);
+	}
+
+	SECTION("lines were appended to the file in the meantime") {
+		{
+			std::ofstream f(queueFile.get_path(), std::ofstream::app);
+			f << "https://example.com/new.mp3 \"new.mp3\"\n";
+		}
+		queue_loader.reload(downloads);
+
+		REQUIRE(downloads.size() == 6);
+		REQUIRE(downloads[5].url() == "https://example.com/new.mp3");
+		REQUIRE(downloads[5].filename() == "new.mp3");
+	}
+}
+
 TEST_CASE("No exceptions are thrown if reload() can't read the queue file",
 	"[QueueLoader]")
 {
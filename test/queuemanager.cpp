@@ -1,5 +1,7 @@
 #include "queuemanager.h"
 
+#include <fstream>
+
 #include "3rd-party/catch.hpp"
 #include "test_helpers/chmod.h"
 #include "test_helpers/envvar.h"
@@ -203,6 +205,52 @@ SCENARIO("enqueue_url() errors if the filename is already used", "[QueueManager]
 	}
 }
 
+TEST_CASE("enqueue_url() notices that the queue file was changed by someone else",
+	"[QueueManager]")
+{
+	ConfigContainer cfg;
+	Cache cache(":memory:", &cfg);
+
+	auto item = std::make_shared<RssItem>(&cache);
+	const std::string enclosure_url("https://example.com/podcast.mp3");
+	item->set_enclosure_url(enclosure_url);
+	item->set_enclosure_type("audio/mpeg");
+
+	auto feed = std::make_shared<RssFeed>(&cache, "https://example.com/news.atom");
+
+	test_helpers::TempFile queue_file;
+	QueueManager manager(&cfg, queue_file.get_path());
+
+	REQUIRE(manager.enqueue_url(item, feed).status ==
+		EnqueueStatus::QUEUED_SUCCESSFULLY);
+
+	SECTION("an entry that was removed can be queued again") {
+		// As Podboat does when the episode is deleted from its queue
+		{
+			std::ofstream f(queue_file.get_path(), std::ofstream::trunc);
+		}
+
+		REQUIRE(manager.enqueue_url(item, feed).status ==
+			EnqueueStatus::QUEUED_SUCCESSFULLY);
+		REQUIRE(test_helpers::file_contents(queue_file.get_path()).size() == 2);
+	}
+
+	SECTION("an entry that was appended is found") {
+		auto item2 = std::make_shared<RssItem>(&cache);
+		const std::string enclosure_url2("https://example.com/another.mp3");
+		item2->set_enclosure_url(enclosure_url2);
+		item2->set_enclosure_type("audio/mpeg");
+		{
+			std::ofstream f(queue_file.get_path(), std::ofstream::app);
+			f << enclosure_url2 << " \"elsewhere.mp3\"\n";
+		}
+
+		const auto result = manager.enqueue_url(item2, feed);
+		REQUIRE(result.status == EnqueueStatus::URL_QUEUED_ALREADY);
+		REQUIRE(result.extra_info == enclosure_url2);
+	}
+}
+
 SCENARIO("enqueue_url() errors if the queue file can't be opened for writing",
 	"[QueueManager]")
 {
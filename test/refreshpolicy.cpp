@@ -0,0 +1,107 @@
+#include "refreshpolicy.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("parse_ttl() turns minutes into seconds", "[RefreshPolicy]")
+{
+	REQUIRE(RefreshHints::parse_ttl("60") == 3600);
+	REQUIRE(RefreshHints::parse_ttl(" 5") == 300);
+	REQUIRE(RefreshHints::parse_ttl("") == 0);
+	REQUIRE(RefreshHints::parse_ttl("soon") == 0);
+	REQUIRE(RefreshHints::parse_ttl("-10") == 0);
+}
+
+TEST_CASE("parse_update_period() divides the period by the frequency",
+	"[RefreshPolicy]")
+{
+	REQUIRE(RefreshHints::parse_update_period("hourly", "") == 3600);
+	REQUIRE(RefreshHints::parse_update_period("daily", "1") == 86400);
+	REQUIRE(RefreshHints::parse_update_period("daily", "2") == 43200);
+	REQUIRE(RefreshHints::parse_update_period("weekly", "0") == 604800);
+	REQUIRE(RefreshHints::parse_update_period("fortnightly", "1") == 0);
+	REQUIRE(RefreshHints::parse_update_period("", "") == 0);
+}
+
+TEST_CASE("next_check() follows how often the feed updates",
+	"[RefreshPolicy]")
+{
+	const time_t now = 1000000;
+	const RefreshPolicy policy(600, 86400);
+	const RefreshHints none;
+
+	SECTION("Unknown feeds are checked as often as allowed") {
+		REQUIRE(policy.next_check(none, 0, now) == now + 600);
+	}
+
+	SECTION("Feeds are checked twice per update interval") {
+		REQUIRE(policy.next_check(none, 7200, now) == now + 3600);
+	}
+
+	SECTION("The interval is kept within the limits") {
+		REQUIRE(policy.next_check(none, 60, now) == now + 600);
+		REQUIRE(policy.next_check(none, 10 * 86400, now) == now + 86400);
+	}
+}
+
+TEST_CASE("next_check() honors what the publisher asks for",
+	"[RefreshPolicy]")
+{
+	const time_t now = 1000000;
+	const RefreshPolicy policy(600, 86400);
+
+	SECTION("ttl and updatePeriod only make checks less frequent") {
+		RefreshHints hints;
+		hints.ttl = 7200;
+		REQUIRE(policy.next_check(hints, 0, now) == now + 7200);
+		REQUIRE(policy.next_check(hints, 8 * 3600, now) == now + 4 * 3600);
+
+		hints.ttl = 0;
+		hints.update_period = 43200;
+		REQUIRE(policy.next_check(hints, 3600, now) == now + 43200);
+	}
+
+	SECTION("Expires and Retry-After postpone the check") {
+		RefreshHints hints;
+		hints.expires = now + 5000;
+		REQUIRE(policy.next_check(hints, 0, now) == now + 5000);
+
+		hints.retry_after = now + 9000;
+		REQUIRE(policy.next_check(hints, 0, now) == now + 9000);
+	}
+
+	SECTION("Times that already passed are ignored") {
+		RefreshHints hints;
+		hints.expires = now - 100;
+		hints.retry_after = now + 10;
+		REQUIRE(policy.next_check(hints, 0, now) == now + 600);
+	}
+
+	SECTION("Nothing postpones the check past the maximum") {
+		RefreshHints hints;
+		hints.retry_after = now + 30 * 86400;
+		REQUIRE(policy.next_check(hints, 0, now) == now + 86400);
+	}
+
+	SECTION("Feeds whose updates are pushed are checked at the maximum") {
+		RefreshHints hints;
+		hints.pushed = true;
+		REQUIRE(policy.next_check(hints, 3600, now) == now + 86400);
+	}
+}
+
+TEST_CASE("retry_delay() doubles the wait for every failure after the first",
+	"[RefreshPolicy]")
+{
+	REQUIRE(RefreshPolicy::retry_delay(0, 600, 86400) == 0);
+	REQUIRE(RefreshPolicy::retry_delay(1, 600, 86400) == 0);
+	REQUIRE(RefreshPolicy::retry_delay(2, 600, 86400) == 600);
+	REQUIRE(RefreshPolicy::retry_delay(3, 600, 86400) == 1200);
+	REQUIRE(RefreshPolicy::retry_delay(5, 600, 86400) == 4800);
+	REQUIRE(RefreshPolicy::retry_delay(100, 600, 86400) == 86400);
+
+	SECTION("A limit of 0 means no wait at all") {
+		REQUIRE(RefreshPolicy::retry_delay(10, 600, 0) == 0);
+	}
+}
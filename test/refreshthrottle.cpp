@@ -0,0 +1,119 @@
+#include "refreshthrottle.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+namespace {
+
+void wait_until_idle(RefreshThrottle& throttle)
+{
+	for (int i = 0; i < 500 && throttle.pending(); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+}
+
+TEST_CASE("RefreshThrottle refreshes right away after a quiet spell",
+	"[RefreshThrottle]")
+{
+	unsigned int refreshes = 0;
+	RefreshThrottle throttle([&]() {
+		++refreshes;
+	}, 10);
+
+	throttle.request();
+
+	REQUIRE(refreshes == 1);
+	REQUIRE_FALSE(throttle.pending());
+}
+
+TEST_CASE("RefreshThrottle::request_in_background() leaves the refresh to "
+	"its thread", "[RefreshThrottle]")
+{
+	std::atomic<unsigned int> refreshes(0);
+	std::atomic<bool> on_caller(false);
+	const auto caller = std::this_thread::get_id();
+	RefreshThrottle throttle([&]() {
+		on_caller = on_caller || std::this_thread::get_id() == caller;
+		++refreshes;
+	}, 10);
+
+	throttle.request_in_background();
+	for (int i = 0; i < 500 && refreshes == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	REQUIRE(refreshes == 1);
+	REQUIRE_FALSE(on_caller);
+}
+
+TEST_CASE("RefreshThrottle merges requests that come in too quickly",
+	"[RefreshThrottle]")
+{
+	std::atomic<unsigned int> refreshes(0);
+	RefreshThrottle throttle([&]() {
+		++refreshes;
+	}, 1);
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([&]() {
+			for (int j = 0; j < 50; ++j) {
+				throttle.request();
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	SECTION("the first request refreshes, and the rest are left for later") {
+		REQUIRE(refreshes == 1);
+		REQUIRE(throttle.pending());
+	}
+
+	SECTION("the rest are handled by a single refresh") {
+		wait_until_idle(throttle);
+		REQUIRE_FALSE(throttle.pending());
+		REQUIRE(refreshes == 2);
+	}
+}
+
+TEST_CASE("RefreshThrottle with a rate of 0 refreshes on every request",
+	"[RefreshThrottle]")
+{
+	unsigned int refreshes = 0;
+	RefreshThrottle throttle([&]() {
+		++refreshes;
+	}, 0);
+
+	for (int i = 0; i < 10; ++i) {
+		throttle.request();
+	}
+
+	REQUIRE(refreshes == 10);
+	REQUIRE_FALSE(throttle.pending());
+}
+
+TEST_CASE("RefreshThrottle drops the pending refresh when destroyed",
+	"[RefreshThrottle]")
+{
+	std::atomic<unsigned int> refreshes(0);
+	{
+		RefreshThrottle throttle([&]() {
+			++refreshes;
+		}, 1);
+		throttle.request();
+		throttle.request();
+		REQUIRE(throttle.pending());
+	}
+
+	REQUIRE(refreshes == 1);
+}
@@ -2,9 +2,12 @@
 
 #include "3rd-party/catch.hpp"
 
+#include "configexception.h"
 #include "confighandlerexception.h"
 #include "matchable.h"
 #include "matcherexception.h"
+#include "rssfeed.h"
+#include "rssitem.h"
 
 using namespace newsboat;
 
@@ -83,6 +86,37 @@ TEST_CASE("RegexManager highlights according to definition", "[RegexManager]")
 	}
 }
 
+TEST_CASE("compile_deferred() compiles the regexes of `highlight' at once",
+	"[RegexManager]")
+{
+	RegexManager rxman;
+	rxman.defer_compiling();
+	rxman.handle_action("highlight", {"all", "foo", "blue"});
+	rxman.handle_action("highlight", {"article", "bar", "red"});
+
+	SECTION("the rules work once they're compiled") {
+		rxman.compile_deferred();
+		std::string input = "foo bar";
+		rxman.quote_and_highlight(input, "article");
+		REQUIRE(input == "<0>foo</> <1>bar</>");
+		input = "foo bar";
+		rxman.quote_and_highlight(input, "feedlist");
+		REQUIRE(input == "<0>foo</> bar");
+	}
+
+	SECTION("colors are still checked right away") {
+		REQUIRE_THROWS_AS(
+			rxman.handle_action("highlight", {"article", "baz", "no-color"}),
+			ConfigHandlerException);
+	}
+
+	SECTION("invalid regexes are reported by compile_deferred()") {
+		REQUIRE_NOTHROW(
+			rxman.handle_action("highlight", {"article", "(baz", "red"}));
+		REQUIRE_THROWS_AS(rxman.compile_deferred(), ConfigException);
+	}
+}
+
 TEST_CASE("quote_and_highlight() only matches `^` at the start of the line",
 	"[RegexManager]")
 {
@@ -158,6 +192,42 @@ TEST_CASE("`highlight all` adds rules for all locations", "[RegexManager]")
 	}
 }
 
+TEST_CASE("quote_and_highlight() highlights the same with either engine",
+	"[RegexManager]")
+{
+	const std::vector<std::string> inputs = {
+		"Newsboat is a newsreader; newsboat NEWSBOAT",
+		"nnnewsboat, the news, <b>newsboat</b>",
+		"",
+	};
+
+	for (const auto& input : inputs) {
+		std::vector<std::string> results;
+		for (const bool multi_pattern : {
+				false, true
+			}) {
+			RegexManager rxman;
+			rxman.set_multi_pattern(multi_pattern);
+			rxman.handle_action("highlight", {"article", "newsboat", "red"});
+			rxman.handle_action("highlight", {"article", "new[s]", "blue"});
+			rxman.handle_action("highlight", {"article", "news", "green"});
+			rxman.handle_action("highlight", {"all", "boat is", "yellow"});
+
+			std::string text = input;
+			rxman.quote_and_highlight(text, "article");
+			results.push_back(text);
+
+			SECTION("rules removed later are taken into account") {
+				rxman.remove_last_regex("article");
+				text = input;
+				rxman.quote_and_highlight(text, "article");
+				REQUIRE(text.find("<3>") == std::string::npos);
+			}
+		}
+		REQUIRE(results[0] == results[1]);
+	}
+}
+
 TEST_CASE("RegexManager does not hang on regexes that can match empty strings",
 	"[RegexManager]")
 {
@@ -596,6 +666,78 @@ TEST_CASE("RegexManager::feed_matches returns -1 if there are no Matcher "
 	}
 }
 
+TEST_CASE("RegexManager::article_matches remembers the result for an RssItem "
+	"until the item or the rules change",
+	"[RegexManager]")
+{
+	RegexManager rxman;
+	auto feed = std::make_shared<RssFeed>(nullptr, "https://example.com/feed");
+	auto item = std::make_shared<RssItem>(nullptr);
+	item->set_title("Hello world");
+	item->set_feedptr(feed);
+	feed->add_item(item);
+
+	rxman.handle_action("highlight-article", {"title =~ \"Hello\"", "red", "green"});
+	rxman.handle_action("highlight-article", {"feedtitle == \"Feed\"", "red", "green"});
+
+	REQUIRE(rxman.article_matches(item.get()) == 0);
+	REQUIRE(item->highlight_memo().id == 0);
+
+	SECTION("a change to the item is noticed") {
+		item->set_title("Goodbye");
+		REQUIRE(rxman.article_matches(item.get()) == -1);
+	}
+
+	SECTION("a change to its feed is noticed") {
+		item->set_title("Goodbye");
+		REQUIRE(rxman.article_matches(item.get()) == -1);
+		feed->set_title("Feed");
+		REQUIRE(rxman.article_matches(item.get()) == 1);
+	}
+
+	SECTION("a new rule is noticed") {
+		item->set_title("Goodbye");
+		REQUIRE(rxman.article_matches(item.get()) == -1);
+		rxman.handle_action("highlight-article", {"title == \"Goodbye\"", "red", "green"});
+		REQUIRE(rxman.article_matches(item.get()) == 2);
+	}
+
+	SECTION("the result of another RegexManager isn't reused") {
+		RegexManager other;
+		REQUIRE(other.article_matches(item.get()) == -1);
+	}
+
+	SECTION("rules with `age` are matched every time") {
+		RegexManager aged;
+		aged.handle_action("highlight-article", {"age > 1", "red", "green"});
+		item->set_pubDate(time(nullptr));
+		REQUIRE(aged.article_matches(item.get()) == -1);
+		REQUIRE(item->highlight_memo().id == 0);
+	}
+}
+
+TEST_CASE("RegexManager::feed_matches remembers the result for an RssFeed "
+	"until the feed, its article counts or the rules change",
+	"[RegexManager]")
+{
+	RegexManager rxman;
+	auto feed = std::make_shared<RssFeed>(nullptr, "https://example.com/feed");
+	auto item = std::make_shared<RssItem>(nullptr);
+	item->set_unread_nowrite(true);
+	feed->add_item(item);
+
+	rxman.handle_action("highlight-feed", {"feedtitle == \"World\"", "red", "green"});
+	rxman.handle_action("highlight-feed", {"unread_count > 0", "red", "green"});
+
+	REQUIRE(rxman.feed_matches(feed.get()) == 1);
+
+	item->set_unread_nowrite(false);
+	REQUIRE(rxman.feed_matches(feed.get()) == -1);
+
+	feed->set_title("World");
+	REQUIRE(rxman.feed_matches(feed.get()) == 0);
+}
+
 TEST_CASE("RegexManager::remove_last_regex removes last added `highlight` rule",
 	"[RegexManager]")
 {
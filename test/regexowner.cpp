@@ -78,6 +78,38 @@ TEST_CASE("Regex returns no more results than available", "[Regex]")
 	REQUIRE(matches[0].second == 3);
 }
 
+TEST_CASE("Regex::matches() with an offset skips the start of the input, but "
+	"returns positions from its beginning",
+	"[Regex]")
+{
+	std::string errorMessage;
+	auto regex = Regex::compile("a(b+)", REG_EXTENDED, errorMessage);
+	REQUIRE(errorMessage == "");
+	REQUIRE(regex);
+
+	const std::string input = "abb xx abbb";
+
+	auto matches = regex->matches(input, 0, 2, 0);
+	REQUIRE(matches.size() == 2);
+	REQUIRE(matches[0] == std::make_pair(0, 3));
+	REQUIRE(matches[1] == std::make_pair(1, 3));
+
+	matches = regex->matches(input, 1, 2, 0);
+	REQUIRE(matches.size() == 2);
+	REQUIRE(matches[0] == std::make_pair(7, 11));
+	REQUIRE(matches[1] == std::make_pair(8, 11));
+
+	REQUIRE(regex->matches(input, 8, 1, 0).empty());
+	REQUIRE(regex->matches(input, input.length(), 1, 0).empty());
+	REQUIRE(regex->matches(input, input.length() + 1, 1, 0).empty());
+
+	SECTION("with REG_NOTBOL, ^ doesn't match at the offset") {
+		auto anchored = Regex::compile("^x", REG_EXTENDED, errorMessage);
+		REQUIRE(anchored);
+		REQUIRE(anchored->matches(input, 4, 1, REG_NOTBOL).empty());
+	}
+}
+
 TEST_CASE("Regex returns error on invalid regex", "[Regex]")
 {
 	std::string errorMessage;
@@ -90,3 +122,27 @@ TEST_CASE("Regex returns error on invalid regex", "[Regex]")
 
 	REQUIRE_FALSE(regex);
 }
+
+TEST_CASE("Regex::compile_shared() returns the same instance for the same "
+	"pattern and flags", "[Regex]")
+{
+	std::string errorMessage;
+	const auto first = Regex::compile_shared("ab+c", REG_EXTENDED, errorMessage);
+	REQUIRE(first);
+	REQUIRE(first == Regex::compile_shared("ab+c", REG_EXTENDED, errorMessage));
+	REQUIRE(first != Regex::compile_shared("ab+c", REG_EXTENDED | REG_ICASE,
+			errorMessage));
+	REQUIRE(first != Regex::compile_shared("ab+", REG_EXTENDED, errorMessage));
+	REQUIRE(errorMessage.empty());
+
+	REQUIRE(first->is_match("xxabbbcxx"));
+	REQUIRE_FALSE(first->is_match("ac"));
+
+	SECTION("invalid patterns are reported every time") {
+		for (int i = 0; i < 2; ++i) {
+			errorMessage.clear();
+			REQUIRE_FALSE(Regex::compile_shared("(abc", REG_EXTENDED, errorMessage));
+			REQUIRE_FALSE(errorMessage.empty());
+		}
+	}
+}
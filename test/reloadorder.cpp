@@ -0,0 +1,58 @@
+#include "reloadorder.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("ReloadOrder starts with the feeds in view, then the ones that "
+	"are read, most read first", "[ReloadOrder]")
+{
+	const ReloadOrder order({"http://in-view.example.com"}, {
+		{"http://in-view.example.com", 1},
+		{"http://rarely-read.example.com", 2},
+		{"http://often-read.example.com", 20},
+	}, {});
+
+	const std::vector<std::size_t> expected = {2, 3, 1, 0};
+	REQUIRE(order.sort({
+		"http://never-read.example.com",
+		"http://rarely-read.example.com",
+		"http://in-view.example.com",
+		"http://often-read.example.com",
+	}) == expected);
+}
+
+TEST_CASE("ReloadOrder starts the feeds that took the longest first, "
+	"otherwise", "[ReloadOrder]")
+{
+	const ReloadOrder order({"http://a.example.com", "http://b.example.com"}, {
+		{"http://c.example.com", 5},
+		{"http://d.example.com", 5},
+	}, {
+		{"http://b.example.com", 1000},
+		{"http://d.example.com", 3000},
+		{"http://f.example.com", 10},
+	});
+
+	const std::vector<std::size_t> expected = {1, 0, 3, 2, 5, 4};
+	REQUIRE(order.sort({
+		"http://a.example.com",
+		"http://b.example.com",
+		"http://c.example.com",
+		"http://d.example.com",
+		"http://e.example.com",
+		"http://f.example.com",
+	}) == expected);
+}
+
+TEST_CASE("ReloadOrder keeps the order of feeds it knows nothing about",
+	"[ReloadOrder]")
+{
+	const ReloadOrder order({}, {}, {});
+	const std::vector<std::size_t> expected = {0, 1, 2};
+	REQUIRE(order.sort({
+		"http://c.example.com",
+		"http://a.example.com",
+		"http://b.example.com",
+	}) == expected);
+}
@@ -0,0 +1,84 @@
+#include "reloadreport.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempfile.h"
+
+using namespace newsboat;
+
+TEST_CASE("ReloadReport lists the feeds in the order they were reported on",
+	"[ReloadReport]")
+{
+	ReloadReport report;
+	report.add_parse("http://example.com/b", std::chrono::milliseconds(5),
+		false);
+	report.add_write("http://example.com/a", std::chrono::milliseconds(2), 3);
+	report.add_write("http://example.com/b", std::chrono::milliseconds(1), 4);
+	report.add_error("http://example.com/c", "Connection refused");
+
+	const auto json = report.to_json();
+	const auto& feeds = json["feeds"];
+	REQUIRE(feeds.size() == 3);
+	REQUIRE(feeds[0]["url"] == "http://example.com/b");
+	REQUIRE(feeds[0]["parse_ms"] == Approx(5));
+	REQUIRE(feeds[0]["write_ms"] == Approx(1));
+	REQUIRE(feeds[0]["articles_added"] == 4);
+	REQUIRE(feeds[0].count("error") == 0);
+	// Without a download, there's nothing to say about it
+	REQUIRE(feeds[0].count("http_status") == 0);
+	REQUIRE(feeds[0].count("dns_ms") == 0);
+
+	REQUIRE(feeds[1]["url"] == "http://example.com/a");
+	REQUIRE(feeds[1].count("parse_ms") == 0);
+	REQUIRE(feeds[2]["error"] == "Connection refused");
+
+	const auto& summary = json["summary"];
+	REQUIRE(summary["feeds"] == 3);
+	REQUIRE(summary["errors"] == 1);
+	REQUIRE(summary["articles_added"] == 7);
+	REQUIRE(summary["percentiles"]["write_ms"]["count"] == 2);
+	REQUIRE(summary["percentiles"]["parse_ms"]["count"] == 1);
+	REQUIRE(summary["percentiles"].count("dns_ms") == 0);
+}
+
+TEST_CASE("ReloadReport gives nearest-rank percentiles of the durations",
+	"[ReloadReport]")
+{
+	ReloadReport report;
+	for (int i = 1; i <= 100; ++i) {
+		report.add_parse("http://example.com/" + std::to_string(i),
+			std::chrono::milliseconds(i), i % 10 == 0);
+	}
+
+	const auto summary = report.to_json()["summary"];
+	const auto& parse = summary["percentiles"]["parse_ms"];
+	REQUIRE(parse["count"] == 100);
+	REQUIRE(parse["p50"] == Approx(50));
+	REQUIRE(parse["p90"] == Approx(90));
+	REQUIRE(parse["p99"] == Approx(99));
+	REQUIRE(parse["max"] == Approx(100));
+	REQUIRE(summary["body_unchanged"] == 10);
+}
+
+TEST_CASE("ReloadReport::write() replaces the file with the report",
+	"[ReloadReport]")
+{
+	test_helpers::TempFile tmp;
+	{
+		std::ofstream f(tmp.get_path());
+		f << "an older report that is much longer than the new one";
+	}
+
+	ReloadReport report;
+	report.add_write("http://example.com/", std::chrono::milliseconds(1), 1);
+	REQUIRE(report.write(tmp.get_path()));
+
+	std::ifstream f(tmp.get_path());
+	std::stringstream contents;
+	contents << f.rdbuf();
+	const auto json = nlohmann::json::parse(contents.str());
+	REQUIRE(json["feeds"].size() == 1);
+	REQUIRE(json["feeds"][0]["articles_added"] == 1);
+}
@@ -4,6 +4,7 @@
 
 #include "3rd-party/catch.hpp"
 
+#include "cache.h"
 #include "configparser.h"
 
 using namespace newsboat;
@@ -26,6 +27,7 @@ public:
 	{
 		return get_credentials(scope, name).pass;
 	}
+	using RemoteApi::mark_in_batches;
 	bool authenticate()
 	{
 		throw 0;
@@ -122,3 +124,159 @@ TEST_CASE("eval_password() returns the first line of command's output",
 	// following test will wait for user input and block tests
 	// REQUIRE(RemoteApi->eval_password("read password") == "");
 }
+
+TEST_CASE("mark_in_batches() marks the guids in batches of at most the given "
+	"size",
+	"[RemoteApi]")
+{
+	const std::vector<std::string> guids = {"a", "b", "c", "d", "e"};
+	std::vector<std::vector<std::string>> batches;
+	bool fail_second = false;
+	const auto mark = [&](const std::vector<std::string>& batch) {
+		batches.push_back(batch);
+		return !(fail_second && batches.size() == 2);
+	};
+	const std::vector<std::vector<std::string>> expected = {
+		{"a", "b"}, {"c", "d"}, {"e"}
+	};
+
+	SECTION("succeeds if every batch does") {
+		REQUIRE(test_api::mark_in_batches(guids, 2, mark));
+		REQUIRE(batches == expected);
+	}
+
+	SECTION("goes on after a batch fails, and then fails") {
+		fail_second = true;
+		REQUIRE_FALSE(test_api::mark_in_batches(guids, 2, mark));
+		REQUIRE(batches == expected);
+	}
+
+	SECTION("makes no calls without guids") {
+		REQUIRE(test_api::mark_in_batches({}, 2, mark));
+		REQUIRE(batches.empty());
+	}
+}
+
+TEST_CASE("subscriptions() starts with the stored list, if it's allowed to, "
+	"and stores what the server says", "[RemoteApi]")
+{
+	class subscriptions_api : public test_api {
+	public:
+		explicit subscriptions_api(ConfigContainer* c)
+			: test_api(c)
+		{
+		}
+		std::vector<TaggedFeedUrl> get_subscribed_urls() override
+		{
+			++requests;
+			return from_server;
+		}
+
+		std::vector<TaggedFeedUrl> from_server;
+		unsigned int requests = 0;
+	};
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	subscriptions_api api(&cfg);
+	const std::vector<TaggedFeedUrl> stored = {{"http://example.com/old", {"~Old"}}};
+	api.from_server = {{"http://example.com/new", {"~New", "tag"}}};
+
+	SECTION("without a cache, the server is asked every time") {
+		REQUIRE(api.subscriptions() == api.from_server);
+		REQUIRE(api.subscriptions() == api.from_server);
+		REQUIRE(api.requests == 2);
+		REQUIRE_FALSE(api.subscriptions_were_cached());
+	}
+
+	SECTION("the stored list is used once") {
+		rsscache.store_subscriptions("test", stored);
+		api.cache_subscriptions(&rsscache, "test", true);
+
+		REQUIRE(api.subscriptions() == stored);
+		REQUIRE(api.subscriptions_were_cached());
+		REQUIRE(api.requests == 0);
+
+		REQUIRE(api.subscriptions() == api.from_server);
+		REQUIRE_FALSE(api.subscriptions_were_cached());
+		REQUIRE(rsscache.fetch_subscriptions("test") == api.from_server);
+	}
+
+	SECTION("the stored list isn't used if it mustn't be") {
+		rsscache.store_subscriptions("test", stored);
+		api.cache_subscriptions(&rsscache, "test", false);
+
+		REQUIRE(api.subscriptions() == api.from_server);
+		REQUIRE(api.requests == 1);
+		REQUIRE(rsscache.fetch_subscriptions("test") == api.from_server);
+	}
+
+	SECTION("the server is asked if nothing was stored, and an empty answer "
+		"doesn't replace the stored list") {
+		api.cache_subscriptions(&rsscache, "test", true);
+		REQUIRE(api.subscriptions() == api.from_server);
+		REQUIRE(api.requests == 1);
+
+		api.from_server.clear();
+		REQUIRE(api.subscriptions().empty());
+		REQUIRE(rsscache.fetch_subscriptions("test").size() == 1);
+	}
+}
+
+TEST_CASE("revalidate() sends the validators of the stored answer, and "
+	"returns that answer if the server says it didn't change", "[RemoteApi]")
+{
+	class revalidating_api : public test_api {
+	public:
+		explicit revalidating_api(ConfigContainer* c)
+			: test_api(c)
+		{
+		}
+		using RemoteApi::revalidate;
+	};
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	revalidating_api api(&cfg);
+	const std::string url = "https://example.com/v1/feeds";
+
+	utils::ConditionalRequest sent;
+	const auto answer = [&](const std::string& etag, bool not_modified,
+	const std::string& body) {
+		return [&sent, etag, not_modified, body](
+		utils::ConditionalRequest& request) {
+			sent = request;
+			request.etag = etag;
+			request.not_modified = not_modified;
+			return body;
+		};
+	};
+
+	SECTION("without a cache, nothing is kept") {
+		REQUIRE(api.revalidate(url, answer("\"v1\"", false, "[1]")) == "[1]");
+		REQUIRE(api.revalidate(url, answer("\"v1\"", false, "[1]")) == "[1]");
+		REQUIRE(sent.etag.empty());
+	}
+
+	SECTION("with a cache") {
+		api.cache_subscriptions(&rsscache, "test", false);
+
+		REQUIRE(api.revalidate(url, answer("\"v1\"", false, "[1]")) == "[1]");
+		REQUIRE(sent.etag.empty());
+
+		REQUIRE(api.revalidate(url, answer("", true, "")) == "[1]");
+		REQUIRE(sent.etag == "\"v1\"");
+
+		REQUIRE(api.revalidate(url, answer("\"v2\"", false, "[2]")) == "[2]");
+		REQUIRE(sent.etag == "\"v1\"");
+		REQUIRE(api.revalidate(url, answer("", true, "")) == "[2]");
+		REQUIRE(sent.etag == "\"v2\"");
+
+		SECTION("answers without validators aren't kept") {
+			const std::string other = "https://example.com/v1/categories";
+			REQUIRE(api.revalidate(other, answer("", false, "[3]")) == "[3]");
+			StoredResponse stored;
+			REQUIRE_FALSE(rsscache.fetch_remote_response(other, stored));
+		}
+	}
+}
@@ -0,0 +1,218 @@
+#include "remoteoutbox.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "remoteapi.h"
+
+using namespace newsboat;
+
+namespace {
+
+/// Records what it's asked to send
+class RecordingApi : public RemoteApi {
+public:
+	explicit RecordingApi(ConfigContainer* c)
+		: RemoteApi(c)
+	{
+	}
+	bool authenticate() override
+	{
+		return true;
+	}
+	std::vector<TaggedFeedUrl> get_subscribed_urls() override
+	{
+		return {};
+	}
+	void add_custom_headers(curl_slist**) override
+	{
+	}
+	bool mark_all_read(const std::string&) override
+	{
+		return true;
+	}
+	bool mark_article_read(const std::string& guid, bool read) override
+	{
+		calls.push_back(guid + (read ? " read" : " unread"));
+		return succeed && guid != rejected;
+	}
+	bool mark_articles_read(const std::vector<std::string>& guids) override
+	{
+		std::string call = "batch";
+		for (const auto& guid : guids) {
+			call += " " + guid;
+		}
+		calls.push_back(call);
+		if (while_sending) {
+			while_sending();
+		}
+		return succeed;
+	}
+	bool update_article_flags(const std::string& oldflags,
+		const std::string& newflags,
+		const std::string& guid) override
+	{
+		calls.push_back(guid + " flags " + oldflags + "->" + newflags);
+		return succeed;
+	}
+
+	std::vector<std::string> calls;
+	bool succeed = true;
+	/// The article whose changes the server turns down
+	std::string rejected;
+	std::function<void()> while_sending;
+};
+
+}
+
+TEST_CASE("RemoteOutbox merges the changes to each article and sends the "
+	"articles marked read in one batch",
+	"[RemoteOutbox]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RecordingApi api(&cfg);
+	RemoteOutbox outbox(rsscache, api);
+
+	outbox.mark_article_read("a", true);
+	outbox.mark_article_read("b", true);
+	outbox.mark_article_read("b", false);
+	outbox.mark_article_read("c", false);
+	outbox.mark_article_read("c", true);
+	outbox.update_article_flags("", "s", "d");
+	outbox.update_article_flags("s", "sx", "d");
+	outbox.mark_articles_read({"e", "a"});
+	REQUIRE(api.calls.empty());
+
+	REQUIRE(outbox.send_queued());
+	REQUIRE(api.calls == std::vector<std::string>({
+		"b unread",
+		"d flags ->sx",
+		"batch a c e",
+	}));
+
+	SECTION("nothing is left to send") {
+		api.calls.clear();
+		REQUIRE(outbox.send_queued());
+		REQUIRE(api.calls.empty());
+		REQUIRE(rsscache.fetch_remote_outbox(10).empty());
+	}
+}
+
+TEST_CASE("RemoteOutbox keeps the changes while the server can't be "
+	"reached",
+	"[RemoteOutbox]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RecordingApi api(&cfg);
+	RemoteOutbox outbox(rsscache, api);
+
+	outbox.mark_article_read("a", false);
+	outbox.mark_article_read("b", true);
+	api.succeed = false;
+	for (unsigned int i = 0; i < 2 * RemoteOutbox::MAX_ATTEMPTS; ++i) {
+		REQUIRE_FALSE(outbox.send_queued());
+	}
+
+	const auto queued = rsscache.fetch_remote_outbox(10);
+	REQUIRE(queued.size() == 2);
+	REQUIRE(queued[0].attempts == 0);
+	REQUIRE(queued[1].attempts == 0);
+
+	api.succeed = true;
+	REQUIRE(outbox.send_queued());
+	REQUIRE(rsscache.fetch_remote_outbox(10).empty());
+}
+
+TEST_CASE("RemoteOutbox drops a change that the server turned down too often",
+	"[RemoteOutbox]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RecordingApi api(&cfg);
+	RemoteOutbox outbox(rsscache, api);
+
+	api.rejected = "a";
+	outbox.mark_article_read("a", false);
+	for (unsigned int i = 1; i <= RemoteOutbox::MAX_ATTEMPTS; ++i) {
+		// Something the server takes, so that it's known to be there
+		outbox.mark_article_read("b", true);
+		REQUIRE_FALSE(outbox.send_queued());
+
+		const auto queued = rsscache.fetch_remote_outbox(10);
+		if (i < RemoteOutbox::MAX_ATTEMPTS) {
+			REQUIRE(queued.size() == 1);
+			REQUIRE(queued[0].guid == "a");
+			REQUIRE(queued[0].attempts == i);
+		} else {
+			REQUIRE(queued.empty());
+		}
+	}
+}
+
+TEST_CASE("RemoteOutbox sends a change that comes in while an older one of "
+	"the same article is being sent",
+	"[RemoteOutbox]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RecordingApi api(&cfg);
+	RemoteOutbox outbox(rsscache, api);
+
+	outbox.update_article_flags("", "s", "a");
+	outbox.mark_article_read("a", true);
+	api.while_sending = [&]() {
+		api.while_sending = nullptr;
+		outbox.mark_article_read("a", false);
+	};
+
+	REQUIRE(outbox.send_queued());
+	REQUIRE(api.calls == std::vector<std::string>({
+		"a flags ->s",
+		"batch a",
+	}));
+
+	// The flags were sent already, so they don't change anymore
+	api.calls.clear();
+	REQUIRE(outbox.send_queued());
+	REQUIRE(api.calls == std::vector<std::string>({
+		"a unread",
+		"a flags s->s",
+	}));
+	REQUIRE(rsscache.fetch_remote_outbox(10).empty());
+}
+
+TEST_CASE("RemoteOutbox sends what's queued before its thread stops",
+	"[RemoteOutbox]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RecordingApi api(&cfg);
+	RemoteOutbox outbox(rsscache, api);
+
+	outbox.mark_article_read("left from last time", true);
+	outbox.start();
+	outbox.mark_article_read("a", false);
+	outbox.stop();
+
+	REQUIRE(rsscache.fetch_remote_outbox(10).empty());
+	REQUIRE(api.calls.size() >= 2);
+}
+
+TEST_CASE("RemoteOutbox waits longer after each failure, up to half an hour",
+	"[RemoteOutbox]")
+{
+	using std::chrono::minutes;
+	using std::chrono::seconds;
+
+	REQUIRE(RemoteOutbox::retry_delay(1) == seconds(30));
+	REQUIRE(RemoteOutbox::retry_delay(2) == minutes(1));
+	REQUIRE(RemoteOutbox::retry_delay(3) == minutes(2));
+	REQUIRE(RemoteOutbox::retry_delay(7) == minutes(30));
+	REQUIRE(RemoteOutbox::retry_delay(100) == minutes(30));
+}
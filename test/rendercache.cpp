@@ -0,0 +1,120 @@
+#include "rendercache.h"
+
+#include "3rd-party/catch.hpp"
+#include "rssfeed.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+RenderCache::Options options(unsigned int width)
+{
+	return {width, width + 5, "internal", 1};
+}
+
+RenderCache::Rendered rendered(const std::string& text)
+{
+	return {text, 1, {LinkPair("https://example.com/", LinkType::HREF)}};
+}
+
+}
+
+TEST_CASE("RenderCache hands out a view only while the item and options "
+	"are the same",
+	"[RenderCache]")
+{
+	RenderCache cache(1024 * 1024);
+	auto feed = std::make_shared<RssFeed>(nullptr, "https://example.com/feed");
+	auto item = std::make_shared<RssItem>(nullptr);
+	item->set_feedptr(feed);
+
+	REQUIRE_FALSE(cache.get(item, options(80)).has_value());
+
+	cache.put(item, options(80), rendered("text"));
+	const auto view = cache.get(item, options(80));
+	REQUIRE(view.has_value());
+	REQUIRE(view.value().text == "text");
+	REQUIRE(view.value().num_lines == 1);
+	REQUIRE(view.value().links.size() == 1);
+
+	SECTION("other options miss") {
+		REQUIRE_FALSE(cache.get(item, options(100)).has_value());
+
+		auto other_renderer = options(80);
+		other_renderer.renderer = "w3m -dump -T text/html";
+		REQUIRE_FALSE(cache.get(item, other_renderer).has_value());
+
+		auto other_rules = options(80);
+		other_rules.rules_revision = 2;
+		REQUIRE_FALSE(cache.get(item, other_rules).has_value());
+	}
+
+	SECTION("a change to the item misses") {
+		item->set_title("New title");
+		REQUIRE_FALSE(cache.get(item, options(80)).has_value());
+	}
+
+	SECTION("a change to its feed misses") {
+		feed->set_title("New title");
+		REQUIRE_FALSE(cache.get(item, options(80)).has_value());
+	}
+
+	SECTION("a new view replaces the old one") {
+		cache.put(item, options(100), rendered("wider"));
+		REQUIRE(cache.size() == 1);
+		REQUIRE_FALSE(cache.get(item, options(80)).has_value());
+		REQUIRE(cache.get(item, options(100)).value().text == "wider");
+	}
+}
+
+TEST_CASE("RenderCache doesn't hand out the view of an item that's gone",
+	"[RenderCache]")
+{
+	RenderCache cache(1024 * 1024);
+	auto item = std::make_shared<RssItem>(nullptr);
+	const RssItem* address = item.get();
+	cache.put(item, options(80), rendered("text"));
+
+	item.reset();
+	auto successor = std::make_shared<RssItem>(nullptr);
+	if (successor.get() == address) {
+		REQUIRE_FALSE(cache.get(successor, options(80)).has_value());
+	}
+	REQUIRE(cache.size() == 1);
+
+	cache.put(successor, options(80), rendered("other"));
+	REQUIRE(cache.get(successor, options(80)).value().text == "other");
+}
+
+TEST_CASE("RenderCache drops the least recently used views once it's full",
+	"[RenderCache]")
+{
+	auto first = std::make_shared<RssItem>(nullptr);
+	auto second = std::make_shared<RssItem>(nullptr);
+	auto third = std::make_shared<RssItem>(nullptr);
+	const std::string text(1000, 'x');
+
+	// Room for two views, but not for three
+	RenderCache cache(2 * 1000 + 1000);
+	cache.put(first, options(80), rendered(text));
+	cache.put(second, options(80), rendered(text));
+	REQUIRE(cache.size() == 2);
+
+	REQUIRE(cache.get(first, options(80)).has_value());
+	cache.put(third, options(80), rendered(text));
+
+	REQUIRE(cache.size() == 2);
+	REQUIRE(cache.get(first, options(80)).has_value());
+	REQUIRE_FALSE(cache.get(second, options(80)).has_value());
+	REQUIRE(cache.get(third, options(80)).has_value());
+
+	SECTION("a limit of 0 keeps nothing") {
+		cache.set_max_bytes(0);
+		REQUIRE(cache.size() == 0);
+		REQUIRE(cache.bytes() == 0);
+
+		cache.put(first, options(80), rendered(text));
+		REQUIRE(cache.size() == 0);
+	}
+}
@@ -0,0 +1,168 @@
+#include "test_helpers/replayserver.h"
+
+#include <curl/curl.h>
+#include <string>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempdir.h"
+
+using namespace test_helpers;
+
+namespace {
+
+ReplayArchive example_archive()
+{
+	ReplayArchive::Response response;
+	response.url = "https://example.com/feed.xml";
+	response.headers = {
+		{"Content-Type", "application/rss+xml"},
+		{"ETag", "\"v1\""},
+	};
+	response.body = "<rss version=\"2.0\"><channel></channel></rss>";
+
+	ReplayArchive archive;
+	archive.responses.push_back(response);
+	return archive;
+}
+
+size_t append(char* buffer, size_t size, size_t nmemb, void* userdata)
+{
+	static_cast<std::string*>(userdata)->append(buffer, size * nmemb);
+	return size * nmemb;
+}
+
+/// Downloads \a url with \a handle, and returns the HTTP status.
+long get(CURL* handle, const std::string& url, std::string& body,
+	const std::vector<std::string>& headers = {})
+{
+	curl_slist* list = nullptr;
+	for (const auto& header : headers) {
+		list = curl_slist_append(list, header.c_str());
+	}
+	body.clear();
+	curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle, CURLOPT_HTTPHEADER, list);
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, append);
+	curl_easy_setopt(handle, CURLOPT_WRITEDATA, &body);
+	long status = 0;
+	if (curl_easy_perform(handle) == CURLE_OK) {
+		curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+	}
+	curl_easy_setopt(handle, CURLOPT_HTTPHEADER, nullptr);
+	curl_slist_free_all(list);
+	return status;
+}
+
+}
+
+TEST_CASE("ReplayServer serves the recorded responses", "[ReplayServer]")
+{
+	ReplayServer server(example_archive());
+	CURL* handle = curl_easy_init();
+	std::string body;
+
+	SECTION("at the URL given for the original one") {
+		const auto url = server.url_for("https://example.com/feed.xml");
+		REQUIRE(get(handle, url, body) == 200);
+		REQUIRE(body == example_archive().responses[0].body);
+
+		char* content_type = nullptr;
+		curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &content_type);
+		REQUIRE(content_type != nullptr);
+		REQUIRE(std::string(content_type) == "application/rss+xml");
+	}
+
+	SECTION("and 404 for anything else") {
+		REQUIRE(get(handle, server.url_for(0) + "1", body) == 404);
+		REQUIRE(get(handle, server.url_for(0) + "/x", body) == 404);
+	}
+
+	SECTION("throws if asked for a URL that wasn't recorded") {
+		REQUIRE_THROWS_AS(server.url_for("https://example.org/"),
+			std::out_of_range);
+	}
+
+	curl_easy_cleanup(handle);
+}
+
+TEST_CASE("ReplayServer answers matching conditional requests with 304",
+	"[ReplayServer]")
+{
+	ReplayServer server(example_archive());
+	CURL* handle = curl_easy_init();
+	std::string body;
+
+	REQUIRE(get(handle, server.url_for(0), body,
+	{"If-None-Match: \"v1\""}) == 304);
+	REQUIRE(body.empty());
+
+	REQUIRE(get(handle, server.url_for(0), body,
+	{"If-None-Match: \"v0\""}) == 200);
+	REQUIRE_FALSE(body.empty());
+
+	curl_easy_cleanup(handle);
+}
+
+TEST_CASE("ReplayServer keeps connections alive", "[ReplayServer]")
+{
+	ReplayServer server(example_archive());
+	CURL* handle = curl_easy_init();
+	std::string body;
+
+	REQUIRE(get(handle, server.url_for(0), body) == 200);
+	REQUIRE(get(handle, server.url_for(0), body) == 200);
+	REQUIRE(server.requests() == 2);
+	REQUIRE(server.connections() == 1);
+
+	curl_easy_cleanup(handle);
+}
+
+TEST_CASE("ReplayServer waits for the configured latency", "[ReplayServer]")
+{
+	ReplayServer::Options options;
+	options.latency = std::chrono::milliseconds(200);
+	ReplayServer server(example_archive(), options);
+	CURL* handle = curl_easy_init();
+	std::string body;
+
+	const auto start = std::chrono::steady_clock::now();
+	REQUIRE(get(handle, server.url_for(0), body) == 200);
+	REQUIRE(std::chrono::steady_clock::now() - start >= options.latency);
+
+	curl_easy_cleanup(handle);
+}
+
+TEST_CASE("ReplayArchive can be recorded, saved and loaded again",
+	"[ReplayServer]")
+{
+	ReplayServer server(example_archive());
+	const auto url = server.url_for(0);
+
+	ReplayArchive recorded;
+	REQUIRE(recorded.record(url));
+	REQUIRE(recorded.record(url + "1"));
+	REQUIRE_FALSE(recorded.record("http://127.0.0.1:1/"));
+
+	TempDir tmp;
+	recorded.save(tmp.get_path());
+	const auto archive = ReplayArchive::load(tmp.get_path());
+	REQUIRE(archive.responses.size() == 2);
+
+	const auto& response = archive.responses[0];
+	REQUIRE(response.url == url);
+	REQUIRE(response.status == 200);
+	REQUIRE(response.body == example_archive().responses[0].body);
+	// The server's ETag was used to record how long a 304 takes
+	REQUIRE(response.not_modified_total.count() >= 0);
+	bool has_etag = false;
+	for (const auto& header : response.headers) {
+		REQUIRE(header.first != "Content-Length");
+		has_etag = has_etag || (header.first == "ETag"
+				&& header.second == "\"v1\"");
+	}
+	REQUIRE(has_etag);
+
+	REQUIRE(archive.responses[1].status == 404);
+	REQUIRE(archive.responses[1].not_modified_total.count() < 0);
+}
@@ -0,0 +1,88 @@
+#include "requestbudget.h"
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("RequestBudget allows everything until the server says otherwise",
+	"[RequestBudget]")
+{
+	RequestBudget budget;
+	for (int i = 0; i < 1000; ++i) {
+		budget.spend(RequestBudget::Kind::READ);
+	}
+	REQUIRE(budget.allows(RequestBudget::Kind::READ));
+	REQUIRE(budget.allows(RequestBudget::Kind::WRITE));
+	REQUIRE(budget.wait_time(RequestBudget::Kind::READ) == 0);
+}
+
+TEST_CASE("RequestBudget counts Inoreader's zones apart", "[RequestBudget]")
+{
+	RequestBudget budget;
+	budget.read_header("HTTP/2 200\r\n");
+	budget.read_header("x-reader-zone1-usage: 98\r\n");
+	budget.read_header("x-reader-zone1-limit: 100\r\n");
+	budget.read_header("x-reader-zone2-usage: 10\r\n");
+	budget.read_header("x-reader-zone2-limit: 100\r\n");
+	budget.read_header("x-reader-limits-reset-after: 3600\r\n");
+
+	REQUIRE(budget.allows(RequestBudget::Kind::READ));
+	budget.spend(RequestBudget::Kind::READ);
+	REQUIRE(budget.allows(RequestBudget::Kind::READ));
+	budget.spend(RequestBudget::Kind::READ);
+	REQUIRE_FALSE(budget.allows(RequestBudget::Kind::READ));
+	REQUIRE(budget.wait_time(RequestBudget::Kind::READ) > 3500);
+	REQUIRE(budget.allows(RequestBudget::Kind::WRITE));
+
+	SECTION("the zones start over when the server says") {
+		budget.read_header("X-Reader-Limits-Reset-After: 0\r\n");
+		REQUIRE(budget.allows(RequestBudget::Kind::READ));
+	}
+}
+
+TEST_CASE("RequestBudget keeps some of a shared quota for writes",
+	"[RequestBudget]")
+{
+	RequestBudget budget;
+	budget.read_header("X-RateLimit-Remaining: 15\r\n");
+	budget.read_header("X-RateLimit-Limit: 100\r\n");
+	budget.read_header("X-RateLimit-Reset: 600\r\n");
+
+	for (int i = 0; i < 5; ++i) {
+		REQUIRE(budget.allows(RequestBudget::Kind::READ));
+		budget.spend(RequestBudget::Kind::READ);
+	}
+	REQUIRE_FALSE(budget.allows(RequestBudget::Kind::READ));
+	for (int i = 0; i < 10; ++i) {
+		REQUIRE(budget.allows(RequestBudget::Kind::WRITE));
+		budget.spend(RequestBudget::Kind::WRITE);
+	}
+	REQUIRE_FALSE(budget.allows(RequestBudget::Kind::WRITE));
+	REQUIRE(budget.wait_time(RequestBudget::Kind::WRITE) > 500);
+}
+
+TEST_CASE("RequestBudget waits as long as a 429 response says",
+	"[RequestBudget]")
+{
+	RequestBudget budget;
+
+	SECTION("Retry-After only counts along with a 429") {
+		budget.read_header("HTTP/1.1 503 Service Unavailable\r\n");
+		budget.read_header("Retry-After: 120\r\n");
+		REQUIRE(budget.allows(RequestBudget::Kind::READ));
+	}
+
+	SECTION("in seconds") {
+		budget.read_header("HTTP/1.1 429 Too Many Requests\r\n");
+		budget.read_header("Retry-After: 120\r\n");
+		REQUIRE_FALSE(budget.allows(RequestBudget::Kind::READ));
+		REQUIRE_FALSE(budget.allows(RequestBudget::Kind::WRITE));
+		REQUIRE(budget.wait_time(RequestBudget::Kind::WRITE) > 100);
+		REQUIRE(budget.wait_time(RequestBudget::Kind::WRITE) <= 120);
+	}
+
+	SECTION("for a while if it doesn't say") {
+		budget.read_header("HTTP/1.1 429 Too Many Requests\r\n");
+		REQUIRE_FALSE(budget.allows(RequestBudget::Kind::READ));
+	}
+}
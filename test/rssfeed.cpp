@@ -1,5 +1,7 @@
 #include "rssfeed.h"
 
+#include <algorithm>
+
 #include "3rd-party/catch.hpp"
 #include "cache.h"
 #include "configcontainer.h"
@@ -209,6 +211,62 @@ TEST_CASE("RssFeed::sort() correctly sorts articles", "[RssFeed]")
 	}
 }
 
+TEST_CASE("RssFeed::update_items() only looks at the articles of replaced "
+	"feeds when told which ones they are", "[RssFeed]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+
+	const auto make_feed = [&](const std::string& url,
+	const std::vector<std::pair<std::string, time_t>>& articles) {
+		auto feed = std::make_shared<RssFeed>(&rsscache, url);
+		for (const auto& article : articles) {
+			const auto item = std::make_shared<RssItem>(&rsscache);
+			item->set_guid(article.first);
+			item->set_title(article.first);
+			item->set_feedurl(url);
+			item->set_pubDate(article.second);
+			feed->add_item(item);
+		}
+		return feed;
+	};
+
+	const std::string first_url = "http://example.com/first.xml";
+	const std::string second_url = "http://example.com/second.xml";
+	std::vector<std::shared_ptr<RssFeed>> feeds = {
+		make_feed(first_url, {{"news 1", 100}, {"other 1", 200}}),
+		make_feed(second_url, {{"news 2", 300}}),
+	};
+	auto query = std::make_shared<RssFeed>(&rsscache,
+			"query:News:title =~ \"news\"");
+
+	ArticleSortStrategy by_date;
+	by_date.sm = ArtSortMethod::DATE;
+	by_date.sd = SortDirection::DESC;
+
+	REQUIRE_FALSE(query->update_items(feeds, {first_url}, by_date));
+	REQUIRE(query->total_item_count() == 0);
+
+	query->update_items(feeds);
+	query->sort(by_date);
+	REQUIRE(query->total_item_count() == 2);
+
+	// One of the articles is gone, two new ones match
+	feeds[0] = make_feed(first_url, {
+		{"other 1", 200}, {"news 3", 400}, {"news 4", 50}
+	});
+	REQUIRE(query->update_items(feeds, {first_url}, by_date));
+
+	const auto articles = query->items();
+	REQUIRE(articles.size() == 3);
+	REQUIRE(articles[0]->title() == "news 4");
+	REQUIRE(articles[1]->title() == "news 2");
+	REQUIRE(articles[2]->title() == "news 3");
+	REQUIRE(query->get_item_by_guid("news 1")->guid().empty());
+	REQUIRE(query->get_item_by_guid("news 3")->guid() == "news 3");
+	REQUIRE(articles[2]->get_feedptr() == feeds[0]);
+}
+
 TEST_CASE("RssFeed::unread_item_count() returns number of unread articles",
 	"[RssFeed]")
 {
@@ -239,6 +297,109 @@ TEST_CASE("RssFeed::unread_item_count() returns number of unread articles",
 	REQUIRE(f.unread_item_count() == 0);
 }
 
+TEST_CASE("RssFeed::memory_usage() adds up the articles, their descriptions "
+	"and the indexes over them", "[RssFeed]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssFeed f(&rsscache, "");
+
+	const auto empty = f.memory_usage();
+	REQUIRE(empty.item_bytes == 0);
+	REQUIRE(empty.description_bytes == 0);
+	REQUIRE(empty.summary_bytes == 0);
+
+	const std::string description(1000, 'x');
+	for (int i = 0; i < 10; ++i) {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(std::to_string(i));
+		item->set_description(description, "text/html");
+		f.add_item(item);
+	}
+	REQUIRE(f.get_item_by_guid("5") != nullptr);
+
+	const auto usage = f.memory_usage();
+	REQUIRE(usage.item_bytes >= 10 * sizeof(RssItem));
+	REQUIRE(usage.description_bytes >= 10 * description.size());
+	REQUIRE(usage.index_bytes >= 10 * sizeof(std::shared_ptr<RssItem>));
+	REQUIRE(usage.summary_bytes == 0);
+}
+
+TEST_CASE("RssFeed::unread_item_count() follows articles as they are added "
+	"and removed, and shared with other feeds",
+	"[RssFeed]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feed = std::make_shared<RssFeed>(&rsscache, "http://example.com/");
+	for (int i = 0; i < 6; ++i) {
+		const auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_guid(std::to_string(i));
+		item->set_title("Article " + std::to_string(i));
+		item->set_feedurl(feed->rssurl());
+		item->set_unread_nowrite(i % 2 == 0);
+		feed->add_item(item);
+	}
+	REQUIRE(feed->unread_item_count() == 3);
+
+	SECTION("erasing articles") {
+		feed->erase_item(feed->items().begin());
+		REQUIRE(feed->unread_item_count() == 2);
+		feed->erase_items(feed->items().begin(), feed->items().begin() + 2);
+		REQUIRE(feed->unread_item_count() == 1);
+
+		std::vector<std::shared_ptr<RssItem>> items;
+		items.push_back(std::make_shared<RssItem>(&rsscache));
+		items.push_back(std::make_shared<RssItem>(&rsscache));
+		feed->set_items(items);
+		REQUIRE(feed->unread_item_count() == 2);
+	}
+
+	SECTION("erased articles don't count anymore when they are read") {
+		const auto item = feed->items()[0];
+		feed->erase_item(feed->items().begin());
+		item->set_unread_nowrite(false);
+		item->set_unread_nowrite(true);
+		REQUIRE(feed->unread_item_count() == 2);
+	}
+
+	SECTION("purging deleted articles") {
+		feed->items()[0]->set_deleted(true);
+		feed->items()[1]->set_deleted(true);
+		feed->purge_deleted_items();
+		REQUIRE(feed->unread_item_count() == 2);
+	}
+
+	SECTION("marking all articles read") {
+		feed->mark_all_items_read();
+		REQUIRE(feed->unread_item_count() == 0);
+	}
+
+	SECTION("articles that are also in a query feed count in both") {
+		RssFeed query(&rsscache, "query:Articles:title =~ \"Article [0-3]\"");
+		query.update_items({feed});
+		REQUIRE(query.unread_item_count() == 2);
+
+		feed->get_item_by_guid("0")->set_unread_nowrite(false);
+		REQUIRE(feed->unread_item_count() == 2);
+		REQUIRE(query.unread_item_count() == 1);
+
+		const auto& items = query.items();
+		const auto third = std::find_if(items.begin(), items.end(),
+		[](const std::shared_ptr<RssItem>& item) {
+			return item->guid() == "3";
+		});
+		REQUIRE(third != items.end());
+		(*third)->set_unread_nowrite(true);
+		REQUIRE(feed->unread_item_count() == 3);
+		REQUIRE(query.unread_item_count() == 2);
+
+		query.update_items({});
+		REQUIRE(query.unread_item_count() == 0);
+		REQUIRE(feed->unread_item_count() == 3);
+	}
+}
+
 TEST_CASE("RssFeed::matches_tag() returns true if article has a specified tag",
 	"[RssFeed]")
 {
@@ -569,3 +730,39 @@ TEST_CASE("RssFeed contains a number of matchable attributes", "[RssFeed]")
 		check(100500);
 	}
 }
+
+TEST_CASE("RssFeed::revision() changes whenever what the feed list shows "
+	"does", "[RssFeed]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssFeed f(&rsscache, "https://example.com/feed.xml");
+
+	auto revision = f.revision();
+	const auto changed = [&]() {
+		const auto previous = revision;
+		revision = f.revision();
+		return revision != previous;
+	};
+
+	f.set_title("Title");
+	REQUIRE(changed());
+	f.set_description("Description");
+	REQUIRE(changed());
+	f.set_link("https://example.com/");
+	REQUIRE(changed());
+	f.set_tags({"tag", "~Another title"});
+	REQUIRE(changed());
+	f.set_status(DlStatus::DURING_DOWNLOAD);
+	REQUIRE(changed());
+	f.reset_status();
+	REQUIRE(changed());
+
+	f.set_pubDate(42);
+	REQUIRE(changed());
+	f.set_index(3);
+	REQUIRE(changed());
+
+	f.set_index(3);
+	REQUIRE_FALSE(changed());
+}
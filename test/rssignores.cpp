@@ -287,3 +287,101 @@ TEST_CASE("RssIgnores::matches() returns true if given RssItem matches any "
 		REQUIRE(ignores.matches(&item));
 	}
 }
+
+TEST_CASE("RssIgnores::matches() takes rules added after an earlier call "
+	"into account", "[RssIgnores]")
+{
+	RssIgnores ignores;
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssItem item(&rsscache);
+	item.set_title("Updates");
+	item.set_feedurl("https://example.com/feed.xml");
+
+	ignores.handle_action("ignore-article", {"regex:example\\.org", "title = \"Updates\""});
+	REQUIRE_FALSE(ignores.matches(&item));
+
+	ignores.handle_action("ignore-article", {"regex:example\\.com", "title = \"Updates\""});
+	REQUIRE(ignores.matches(&item));
+}
+
+TEST_CASE("RssIgnores::matches() only applies a regex: rule to the feeds it "
+	"matches", "[RssIgnores]")
+{
+	RssIgnores ignores;
+	ignores.handle_action("ignore-article", {"regex:^https://example\\.com/", "author = \"John Doe\""});
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	RssItem matching(&rsscache);
+	matching.set_author("John Doe");
+	matching.set_feedurl("https://example.com/feed.xml");
+	RssItem other_feed(&rsscache);
+	other_feed.set_author("John Doe");
+	other_feed.set_feedurl("https://example.org/feed.xml");
+
+	// Twice, to go through both the first look at a feed and the later ones
+	for (int i = 0; i < 2; ++i) {
+		REQUIRE(ignores.matches(&matching));
+		REQUIRE_FALSE(ignores.matches(&other_feed));
+	}
+}
+
+TEST_CASE("RssIgnores::matches() checks a batch of items from several feeds "
+	"at once", "[RssIgnores]")
+{
+	RssIgnores ignores;
+	ignores.handle_action("ignore-article", {"*", "title = \"Spam\""});
+	ignores.handle_action("ignore-article", {"https://example.com/feed.xml", "author = \"John Doe\""});
+
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto make_item = [&](const std::string& feedurl,
+	const std::string& title, const std::string& author) {
+		auto item = std::make_shared<RssItem>(&rsscache);
+		item->set_feedurl(feedurl);
+		item->set_title(title);
+		item->set_author(author);
+		return item;
+	};
+
+	const std::vector<std::shared_ptr<RssItem>> items = {
+		make_item("https://example.com/feed.xml", "Spam", "Jane Doe"),
+		make_item("https://example.com/feed.xml", "News", "John Doe"),
+		make_item("https://example.org/feed.xml", "News", "John Doe"),
+		make_item("https://example.com/feed.xml", "News", "Jane Doe"),
+		make_item("https://example.org/feed.xml", "Spam", "Jane Doe"),
+	};
+
+	const std::vector<bool> expected = {true, true, false, false, true};
+	REQUIRE(ignores.matches(items) == expected);
+	for (std::size_t i = 0; i < items.size(); ++i) {
+		REQUIRE(ignores.matches(items[i].get()) == expected[i]);
+	}
+}
+
+TEST_CASE("RssIgnores::uses_attribute() looks only at the rules that apply "
+	"to a feed", "[RssIgnores]")
+{
+	RssIgnores ignores;
+	REQUIRE_FALSE(ignores.uses_attribute("https://example.com/feed.xml",
+			MatchableAttribute::TITLE));
+
+	ignores.handle_action("ignore-article", {"*", "author = \"John Doe\""});
+	ignores.handle_action("ignore-article", {"https://example.com/feed.xml", "title =~ \"Ad\" or content =~ \"sponsored\""});
+
+	REQUIRE(ignores.uses_attribute("https://example.com/feed.xml",
+			MatchableAttribute::AUTHOR));
+	REQUIRE(ignores.uses_attribute("https://example.com/feed.xml",
+			MatchableAttribute::CONTENT));
+	REQUIRE(ignores.uses_attribute("https://example.com/feed.xml",
+			MatchableAttribute::TITLE));
+	REQUIRE_FALSE(ignores.uses_attribute("https://example.com/feed.xml",
+			MatchableAttribute::LINK));
+
+	REQUIRE(ignores.uses_attribute("https://example.org/feed.xml",
+			MatchableAttribute::AUTHOR));
+	REQUIRE_FALSE(ignores.uses_attribute("https://example.org/feed.xml",
+			MatchableAttribute::CONTENT));
+}
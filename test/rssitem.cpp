@@ -251,6 +251,77 @@ TEST_CASE("RssItem contains a number of matchable attributes", "[RssItem]")
 	}
 }
 
+TEST_CASE("attribute_value_by_id() returns the same values as "
+	"attribute_value()", "[RssItem]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feed = std::make_shared<RssFeed>(&rsscache, "https://example.com/feed");
+	auto item = std::make_shared<RssItem>(&rsscache);
+	item->set_title("Example title");
+	item->set_link("https://example.com/item");
+	item->set_author("Jane Doe");
+	item->set_guid("guid");
+	item->set_flags("ab");
+	item->set_index(5);
+	feed->set_title("Example feed");
+	feed->set_index(7);
+	feed->add_item(item);
+	item->set_feedptr(feed);
+
+	for (const auto& attr : {
+			"title", "link", "author", "guid", "unread", "flags",
+			"articleindex", "feedtitle", "rssurl", "total_count", "feedindex",
+			"no-such-attribute"
+		}) {
+		const auto id = Matchable::attribute_id(attr);
+		REQUIRE(item->attribute_value_by_id(id, attr) == item->attribute_value(attr));
+	}
+
+	REQUIRE(Matchable::attribute_id("no-such-attribute")
+		== MatchableAttribute::UNKNOWN);
+	REQUIRE(item->attribute_value("no-such-attribute") == nonstd::nullopt);
+}
+
+TEST_CASE("attribute_number_by_id() returns the numbers that "
+	"attribute_value() formats", "[RssItem]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	auto feed = std::make_shared<RssFeed>(&rsscache, "https://example.com/feed");
+	auto item = std::make_shared<RssItem>(&rsscache);
+	item->set_guid("guid");
+	item->set_index(5);
+	item->set_unread_nowrite(true);
+	item->set_pubDate(1000000);
+	feed->set_index(7);
+	feed->add_item(item);
+	item->set_feedptr(feed);
+
+	const time_t now = 1000000 + 3 * 86400 + 5;
+	const auto number = [&](const std::string& attr) {
+		return item->attribute_number_by_id(Matchable::attribute_id(attr), now);
+	};
+	REQUIRE(number("age") == 3);
+	REQUIRE(number("articleindex") == 5);
+	REQUIRE(number("unread_count") == 1);
+	REQUIRE(number("total_count") == 1);
+	REQUIRE(number("feedindex") == 7);
+
+	for (const auto& attr : {
+			"articleindex", "unread_count", "total_count", "feedindex"
+		}) {
+		INFO("attr = " << attr);
+		REQUIRE(item->attribute_value(attr) == std::to_string(number(attr).value()));
+	}
+
+	SECTION("attributes that aren't numbers have none") {
+		REQUIRE(number("title") == nonstd::nullopt);
+		REQUIRE(number("date") == nonstd::nullopt);
+		REQUIRE(number("no-such-attribute") == nonstd::nullopt);
+	}
+}
+
 TEST_CASE("set_title() removes superfluous whitespace", "[RssItem]")
 {
 	ConfigContainer cfg;
@@ -275,3 +346,91 @@ TEST_CASE("set_title() removes superfluous whitespace", "[RssItem]")
 		REQUIRE(item.title() == "lorem ipsum");
 	}
 }
+
+TEST_CASE("RssItem::revision() changes whenever a matchable attribute does",
+	"[RssItem]")
+{
+	RssItem item(nullptr);
+
+	auto revision = item.revision();
+	const auto changed = [&]() {
+		const auto previous = revision;
+		revision = item.revision();
+		return revision != previous;
+	};
+
+	item.set_title("Title");
+	REQUIRE(changed());
+	item.set_link("https://example.com/");
+	REQUIRE(changed());
+	item.set_author("Author");
+	REQUIRE(changed());
+	item.set_description("Content", "text/plain");
+	REQUIRE(changed());
+	item.set_pubDate(42);
+	REQUIRE(changed());
+	item.set_guid("guid");
+	REQUIRE(changed());
+	item.set_unread_nowrite(false);
+	REQUIRE(changed());
+	item.set_enclosure_url("https://example.com/a.mp3");
+	REQUIRE(changed());
+	item.set_enclosure_type("audio/mpeg");
+	REQUIRE(changed());
+	item.set_flags("ab");
+	REQUIRE(changed());
+	item.set_index(5);
+	REQUIRE(changed());
+
+	item.set_index(5);
+	REQUIRE_FALSE(changed());
+}
+
+TEST_CASE("Articles share their feed URL and author instead of copying them",
+	"[RssItem]")
+{
+	RssItem first(nullptr);
+	RssItem second(nullptr);
+	REQUIRE(first.feedurl().empty());
+	REQUIRE(first.author().empty());
+
+	first.set_feedurl("https://example.com/a-long-enough-feed-url.xml");
+	second.set_feedurl(std::string("https://example.com/") +
+		"a-long-enough-feed-url.xml");
+	REQUIRE(&first.feedurl() == &second.feedurl());
+
+	second.set_feedurl("https://example.com/another-feed.xml");
+	REQUIRE(first.feedurl() == "https://example.com/a-long-enough-feed-url.xml");
+	REQUIRE(second.feedurl() == "https://example.com/another-feed.xml");
+
+	first.set_author("Jane Doe");
+	second.set_author("John Doe");
+	REQUIRE(first.author() == "Jane Doe");
+	REQUIRE(second.author() == "John Doe");
+	second.set_author("");
+	REQUIRE(second.author().empty());
+}
+
+TEST_CASE("Flags kept in the same word don't change each other", "[RssItem]")
+{
+	RssItem item(nullptr);
+	REQUIRE(item.unread());
+	REQUIRE_FALSE(item.enqueued());
+	REQUIRE_FALSE(item.deleted());
+	REQUIRE_FALSE(item.override_unread());
+
+	item.set_enqueued(true);
+	item.set_deleted(true);
+	item.set_unread_nowrite(false);
+	REQUIRE_FALSE(item.unread());
+	REQUIRE(item.enqueued());
+	REQUIRE(item.deleted());
+	REQUIRE_FALSE(item.override_unread());
+
+	item.set_override_unread(true);
+	item.set_deleted(false);
+	REQUIRE_FALSE(item.unread());
+	REQUIRE(item.enqueued());
+	REQUIRE_FALSE(item.deleted());
+	REQUIRE(item.override_unread());
+}
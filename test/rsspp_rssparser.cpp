@@ -97,3 +97,91 @@ TEST_CASE(
 			expected);
 	}
 }
+
+TEST_CASE("parse_w3cdtf() returns the time since the epoch",
+	"[rsspp::RssParser]")
+{
+	SECTION("timezones") {
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2008-12-30T13:03:15Z") ==
+			1230642195);
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2008-12-30T15:03:15+02:00") ==
+			1230642195);
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2008-12-30T05:03:15-0800") ==
+			1230642195);
+	}
+
+	SECTION("fractions of a second are ignored") {
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2008-12-30T13:03:15.123Z") ==
+			1230642195);
+	}
+
+	SECTION("dates before 1970") {
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("1969-12-31T23:59:59Z") == -1);
+	}
+
+	SECTION("leap days") {
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2000-03-01") -
+			rsspp::RssParser::parse_w3cdtf("2000-02-28") == 2 * 86400);
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("1900-03-01") -
+			rsspp::RssParser::parse_w3cdtf("1900-02-28") == 86400);
+	}
+
+	SECTION("invalid dates") {
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("") == 0);
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("foobar") == 0);
+		REQUIRE(rsspp::RssParser::parse_w3cdtf("2008-13-01") == 0);
+	}
+}
+
+TEST_CASE("parse_rfc822() returns the time since the epoch",
+	"[rsspp::RssParser]")
+{
+	SECTION("numeric timezones") {
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 13:03:15 +0000") == 1230642195);
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 15:03:15 +0200") == 1230642195);
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 05:03:15 -0800") == 1230642195);
+	}
+
+	SECTION("named timezones") {
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 13:03:15 GMT") == 1230642195);
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 08:03:15 EST") == 1230642195);
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 05:03:15 pst") == 1230642195);
+	}
+
+	SECTION("without the day of the week, seconds, or timezone") {
+		REQUIRE(rsspp::RssParser::parse_rfc822("30 Dec 2008 13:03:15") ==
+			1230642195);
+		REQUIRE(rsspp::RssParser::parse_rfc822("Tue, 30 Dec 2008 13:03 GMT") ==
+			1230642180);
+	}
+
+	SECTION("full month names and surrounding whitespace") {
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"\n  Tuesday, 30 December 2008 13:03:15 +0000  ") ==
+			1230642195);
+	}
+
+	SECTION("dates left to curl_getdate()") {
+		REQUIRE(rsspp::RssParser::parse_rfc822("") == 0);
+		REQUIRE(rsspp::RssParser::parse_rfc822("Tue, 30 Dec 08 13:03:15 GMT") ==
+			0);
+		REQUIRE(rsspp::RssParser::parse_rfc822(
+				"Tue, 30 Dec 2008 13:03:15 +0000 (UTC)") == 0);
+		REQUIRE(rsspp::RssParser::parse_rfc822("2008-12-30T13:03:15Z") == 0);
+	}
+}
+
+TEST_CASE("format_rfc822() writes the time in UTC", "[rsspp::RssParser]")
+{
+	test_helpers::TzEnvVar tzEnv;
+	tzEnv.set("Australia/Sydney");
+
+	REQUIRE(rsspp::RssParser::format_rfc822(1230642195) ==
+		"Tue, 30 Dec 2008 13:03:15 +0000");
+}
@@ -0,0 +1,314 @@
+#include "rss/streamparser.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "3rd-party/catch.hpp"
+#include "curlhandle.h"
+#include "rss/exception.h"
+#include "rss/parser.h"
+
+namespace {
+
+rsspp::Feed parse(const std::string& buffer, bool streaming)
+{
+	rsspp::Parser p;
+	p.set_streaming(streaming);
+	return p.parse_buffer(buffer, "http://example.com/feed.xml");
+}
+
+std::string read_file(const std::string& filename)
+{
+	std::ifstream file(filename);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+void require_same_items(const rsspp::Item& actual,
+	const rsspp::Item& expected)
+{
+	REQUIRE(actual.title == expected.title);
+	REQUIRE(actual.title_type == expected.title_type);
+	REQUIRE(actual.link == expected.link);
+	REQUIRE(actual.description == expected.description);
+	REQUIRE(actual.description_mime_type == expected.description_mime_type);
+	REQUIRE(actual.author == expected.author);
+	REQUIRE(actual.author_email == expected.author_email);
+	REQUIRE(actual.pubDate == expected.pubDate);
+	REQUIRE(actual.pubDate_ts == expected.pubDate_ts);
+	REQUIRE(actual.guid == expected.guid);
+	REQUIRE(actual.guid_isPermaLink == expected.guid_isPermaLink);
+	REQUIRE(actual.enclosures.size() == expected.enclosures.size());
+	for (std::size_t i = 0; i < actual.enclosures.size(); ++i) {
+		REQUIRE(actual.enclosures[i].url == expected.enclosures[i].url);
+		REQUIRE(actual.enclosures[i].type == expected.enclosures[i].type);
+	}
+	REQUIRE(actual.content_encoded == expected.content_encoded);
+	REQUIRE(actual.itunes_summary == expected.itunes_summary);
+	REQUIRE(actual.base == expected.base);
+	REQUIRE(actual.labels == expected.labels);
+}
+
+void require_same_feeds(const rsspp::Feed& actual,
+	const rsspp::Feed& expected)
+{
+	REQUIRE(actual.encoding == expected.encoding);
+	REQUIRE(actual.rss_version == expected.rss_version);
+	REQUIRE(actual.title == expected.title);
+	REQUIRE(actual.title_type == expected.title_type);
+	REQUIRE(actual.description == expected.description);
+	REQUIRE(actual.link == expected.link);
+	REQUIRE(actual.language == expected.language);
+	REQUIRE(actual.managingeditor == expected.managingeditor);
+	REQUIRE(actual.dc_creator == expected.dc_creator);
+	REQUIRE(actual.pubDate == expected.pubDate);
+	REQUIRE(actual.pubDate_ts == expected.pubDate_ts);
+	REQUIRE(actual.ttl == expected.ttl);
+	REQUIRE(actual.update_period == expected.update_period);
+	REQUIRE(actual.update_frequency == expected.update_frequency);
+	REQUIRE(actual.hub == expected.hub);
+	REQUIRE(actual.self == expected.self);
+	REQUIRE(actual.items.size() == expected.items.size());
+	for (std::size_t i = 0; i < actual.items.size(); ++i) {
+		INFO("item " << i);
+		require_same_items(actual.items[i], expected.items[i]);
+	}
+}
+
+/// Parses \a buffer both ways, and checks that they agree, including on the
+/// exception if there is one.
+void require_same_as_tree(const std::string& buffer)
+{
+	std::string tree_error;
+	rsspp::Feed tree;
+	try {
+		tree = parse(buffer, false);
+	} catch (const rsspp::Exception& e) {
+		tree_error = e.what();
+	}
+
+	std::string stream_error;
+	rsspp::Feed stream;
+	try {
+		stream = parse(buffer, true);
+	} catch (const rsspp::Exception& e) {
+		stream_error = e.what();
+	}
+
+	REQUIRE(stream_error == tree_error);
+	require_same_feeds(stream, tree);
+}
+
+}
+
+TEST_CASE("Streaming makes the same feeds as the tree from the test data",
+	"[rsspp::StreamParser]")
+{
+	const char* files[] = {
+		"data/atom10_1.xml",
+		"data/atom10_2.xml",
+		"data/atom10_feed_authors.xml",
+		"data/items_without_titles.xml",
+		"data/rss.xml",
+		"data/rss091_1.xml",
+		"data/rss092_1.xml",
+		"data/rss10_1.xml",
+		"data/rss20_1.xml",
+		"data/rss20_2.xml",
+		"data/rss_091_with_empty_author.xml",
+		"data/rss_092_with_empty_author.xml",
+		"data/rss_094_with_empty_author.xml",
+	};
+	for (const char* file : files) {
+		INFO(file);
+		const std::string contents = read_file(file);
+		REQUIRE_FALSE(contents.empty());
+		require_same_as_tree(contents);
+	}
+}
+
+TEST_CASE("Streaming serializes Atom XHTML content like the tree",
+	"[rsspp::StreamParser]")
+{
+	const std::string head =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+		"<feed xmlns=\"http://www.w3.org/2005/Atom\""
+		" xmlns:x=\"http://www.w3.org/1999/xhtml\"><entry><title>T</title>";
+	const std::string tail = "</entry></feed>";
+
+	SECTION("markup, entities and empty elements") {
+		require_same_as_tree(head +
+			"<content type=\"xhtml\"><div xmlns=\"http://www.w3.org/1999/xhtml\">"
+			"<p class=\"a&amp;b\" title='\"q\" &lt;'>Caf\xc3\xa9 &amp; &lt;tea&gt;"
+			"</p><br/><img src=\"x.png\" alt=\"\"/></div></content>" + tail);
+	}
+
+	SECTION("CDATA, comments and processing instructions") {
+		require_same_as_tree(head +
+			"<content type=\"xhtml\"><div><![CDATA[a < b]]><![CDATA[ & c]]>"
+			"<!-- note --><?pi data?><?pi?>text</div></content>" + tail);
+	}
+
+	SECTION("prefixed elements and attributes with whitespace") {
+		require_same_as_tree(head +
+			"<summary type=\"xhtml\"><x:div x:id=\"a&#10;b&#9;c&#13;\">"
+			"line\r\nbreak<x:span>inner</x:span></x:div></summary>" + tail);
+	}
+
+	SECTION("an undeclared prefix") {
+		require_same_as_tree(head +
+			"<content type=\"xhtml\"><div><y:p>text</y:p></div></content>" + tail);
+	}
+}
+
+TEST_CASE("Streaming writes non-ASCII attributes like the tree, depending on "
+	"the encoding",
+	"[rsspp::StreamParser]")
+{
+	const std::string body =
+		"<feed xmlns=\"http://www.w3.org/2005/Atom\"><entry><title>T</title>"
+		"<content type=\"xhtml\"><div title=\"Caf\xc3\xa9\">Caf\xc3\xa9</div>"
+		"</content></entry></feed>";
+
+	require_same_as_tree(body);
+	require_same_as_tree("<?xml version=\"1.0\" encoding=\"UTF-8\"?>" + body);
+}
+
+TEST_CASE("Streaming expands entities from the internal subset like the tree",
+	"[rsspp::StreamParser]")
+{
+	const std::string doctype =
+		"<?xml version=\"1.0\"?><!DOCTYPE rss ["
+		"<!ENTITY who \"Jane &amp; John\">"
+		"<!ATTLIST guid isPermaLink CDATA \"false\">"
+		"]>";
+
+	require_same_as_tree(doctype +
+		"<rss version=\"2.0\"><channel><title>By &who;</title>"
+		"<item><title>&who; &#233;</title><guid>id</guid>"
+		"<enclosure url=\"a.mp3?x=1&amp;y=&who;\" type=\"audio/mpeg\"/>"
+		"</item></channel></rss>");
+}
+
+TEST_CASE("Streaming keeps what the tree keeps of a document that's cut short",
+	"[rsspp::StreamParser]")
+{
+	const std::string body =
+		"<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>Feed"
+		"</title><item><title>First</title><link>http://example.com/1</link>"
+		"</item><item><title>Second</title><description>Cut";
+
+	for (std::size_t length = 40; length <= body.length(); ++length) {
+		INFO("length " << length);
+		require_same_as_tree(body.substr(0, length));
+	}
+}
+
+TEST_CASE("Streaming throws the same exceptions as the tree",
+	"[rsspp::StreamParser]")
+{
+	require_same_as_tree("<rss><channel/></rss>");
+	require_same_as_tree("<rss version=\"3.0\"><channel/></rss>");
+	require_same_as_tree("<rss version=\"2.0\"></rss>");
+	require_same_as_tree("<html><body/></html>");
+	require_same_as_tree("<feed><title>No namespace</title></feed>");
+	require_same_as_tree("not XML at all");
+
+	REQUIRE_THROWS_AS(parse("<html><body/></html>", true), rsspp::Exception);
+}
+
+TEST_CASE("Streaming decodes a transfer from the charset in the headers",
+	"[rsspp::StreamParser]")
+{
+	const std::string body =
+		"<?xml version=\"1.0\"?><rss version=\"2.0\"><channel>"
+		"<title>Caf\xe9</title><item><description>&lt;b&gt;Cr\xe8me&lt;/b&gt;"
+		"</description></item></channel></rss>";
+
+	newsboat::CurlHandle handle;
+	rsspp::Transfer transfer;
+	rsspp::Parser p;
+	p.prepare_transfer("http://example.com/feed.xml", handle, transfer);
+	REQUIRE(transfer.stream != nullptr);
+	transfer.charset = "ISO-8859-1";
+	REQUIRE(transfer.append_body(body.c_str(), body.length()));
+
+	const rsspp::Feed f = p.finish_transfer("http://example.com/feed.xml",
+			handle, transfer, CURLE_OK);
+
+	REQUIRE(f.title == "Caf\xc3\xa9");
+	REQUIRE(f.items.size() == 1);
+	REQUIRE(f.items[0].description == "<b>Cr\xc3\xa8me</b>");
+}
+
+TEST_CASE("Both parsers take the WebSub hub and the \"self\" link from "
+	"Atom and RSS 2.0 feeds", "[rsspp::StreamParser]")
+{
+	const std::string atom =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+		"<feed xmlns=\"http://www.w3.org/2005/Atom\"><title>T</title>"
+		"<link rel=\"alternate\" href=\"https://example.com/\"/>"
+		"<link rel=\"hub\" href=\"https://hub.example.org/\"/>"
+		"<link rel=\"self\" href=\"https://example.com/feed.atom\"/>"
+		"</feed>";
+	const std::string rss =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+		"<rss version=\"2.0\" xmlns:atom=\"http://www.w3.org/2005/Atom\">"
+		"<channel><title>T</title><link>https://example.com/</link>"
+		"<atom:link rel=\"hub\" href=\"https://hub.example.org/\"/>"
+		"<atom:link rel=\"self\" href=\"https://example.com/feed.rss\"/>"
+		"</channel></rss>";
+
+	for (const bool streaming : {
+			false, true
+		}) {
+		INFO("streaming " << streaming);
+		const rsspp::Feed from_atom = parse(atom, streaming);
+		REQUIRE(from_atom.link == "https://example.com/");
+		REQUIRE(from_atom.hub == "https://hub.example.org/");
+		REQUIRE(from_atom.self == "https://example.com/feed.atom");
+
+		const rsspp::Feed from_rss = parse(rss, streaming);
+		REQUIRE(from_rss.link == "https://example.com/");
+		REQUIRE(from_rss.hub == "https://hub.example.org/");
+		REQUIRE(from_rss.self == "https://example.com/feed.rss");
+	}
+}
+
+TEST_CASE("StreamParser reads only the first max_items items, and all of the "
+	"rest of the feed", "[rsspp::StreamParser]")
+{
+	const std::string atom =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+		"<feed xmlns=\"http://www.w3.org/2005/Atom\">"
+		"<entry><id>1</id><title>One</title></entry>"
+		"<entry><id>2</id><title>Two</title></entry>"
+		"<entry><id>3</id><title>Three</title></entry>"
+		"<title>T</title>"
+		"</feed>";
+	const std::string rdf =
+		"<?xml version=\"1.0\"?>"
+		"<rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\" "
+		"xmlns=\"http://purl.org/rss/1.0/\">"
+		"<channel rdf:about=\"https://example.com/\"><title>T</title></channel>"
+		"<item rdf:about=\"https://example.com/1\"><title>One</title></item>"
+		"<item rdf:about=\"https://example.com/2\"><title>Two</title></item>"
+		"<item rdf:about=\"https://example.com/3\"><title>Three</title></item>"
+		"</rdf:RDF>";
+
+	rsspp::Parser p;
+	p.set_max_items(2);
+
+	const rsspp::Feed from_atom = p.parse_buffer(atom, "http://example.com/");
+	REQUIRE(from_atom.title == "T");
+	REQUIRE(from_atom.items.size() == 2);
+	REQUIRE(from_atom.items[0].guid == "1");
+	REQUIRE(from_atom.items[1].title == "Two");
+
+	const rsspp::Feed from_rdf = p.parse_buffer(rdf, "http://example.com/");
+	REQUIRE(from_rdf.items.size() == 2);
+	REQUIRE(from_rdf.items[0].guid == "https://example.com/1");
+	REQUIRE(from_rdf.items[1].guid == "https://example.com/2");
+}
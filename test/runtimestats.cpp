@@ -0,0 +1,73 @@
+#include "runtimestats.h"
+
+#include "3rd-party/catch.hpp"
+
+#include <string>
+
+using namespace newsboat;
+
+TEST_CASE("RuntimeStats::add() adds to a counter, and reset() clears all "
+	"of them", "[RuntimeStats]")
+{
+	RuntimeStats::reset();
+
+	RuntimeStats::add(RuntimeStats::Counter::FEEDS_QUEUED, 5);
+	RuntimeStats::add(RuntimeStats::Counter::FEEDS_QUEUED, -2);
+	RuntimeStats::add(RuntimeStats::Counter::MATCHER_EVALUATIONS);
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::FEEDS_QUEUED) == 3);
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::MATCHER_EVALUATIONS) == 1);
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::BYTES_DOWNLOADED) == 0);
+
+	RuntimeStats::reset();
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::FEEDS_QUEUED) == 0);
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::MATCHER_EVALUATIONS) == 0);
+}
+
+TEST_CASE("RuntimeStatsTimer adds the time of its scope to a counter",
+	"[RuntimeStats]")
+{
+	RuntimeStats::reset();
+	{
+		RuntimeStatsTimer timer(RuntimeStats::Counter::UI_NS);
+	}
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::UI_NS) >= 0);
+	REQUIRE(RuntimeStats::get(RuntimeStats::Counter::PARSE_NS) == 0);
+}
+
+TEST_CASE("RuntimeStats::snapshot() includes the counters and the hit rate "
+	"of the statement registry", "[RuntimeStats]")
+{
+	RuntimeStats::reset();
+	RuntimeStats::add(RuntimeStats::Counter::STATEMENTS_REUSED, 3);
+	RuntimeStats::add(RuntimeStats::Counter::STATEMENTS_PREPARED, 1);
+	RuntimeStats::add(RuntimeStats::Counter::BYTES_DOWNLOADED, 1024);
+
+	const auto snapshot = RuntimeStats::snapshot();
+	const auto& statements = snapshot["caches"]["statements"];
+	REQUIRE(statements["hits"].get<std::int64_t>() == 3);
+	REQUIRE(statements["misses"].get<std::int64_t>() == 1);
+	REQUIRE(statements["hit_rate_percent"].get<double>() == Approx(75.0));
+	REQUIRE(snapshot["reload"]["bytes_downloaded"].get<std::int64_t>() == 1024);
+	REQUIRE(snapshot["matcher"]["evaluations"].get<std::int64_t>() == 0);
+	REQUIRE(snapshot["scopes"].is_array());
+
+	RuntimeStats::reset();
+}
+
+TEST_CASE("RuntimeStats::report() puts a value on each line, under the "
+	"heading of its group", "[RuntimeStats]")
+{
+	const nlohmann::json snapshot = {
+		{"reload", {{"bytes_downloaded", 4096}}},
+		{"time_ms", {{"parse", 12.5}}},
+		{"scopes", nlohmann::json::array()},
+	};
+
+	const std::string report = RuntimeStats::report(snapshot);
+	REQUIRE(report.find("reload:\n") != std::string::npos);
+	REQUIRE(report.find("bytes downloaded") != std::string::npos);
+	REQUIRE(report.find("4096\n") != std::string::npos);
+	REQUIRE(report.find("time ms:\n") != std::string::npos);
+	REQUIRE(report.find("12.5\n") != std::string::npos);
+	REQUIRE(report.find("Scopes aren't timed") != std::string::npos);
+}
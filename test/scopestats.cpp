@@ -0,0 +1,138 @@
+#include "scopestats.h"
+
+#include "3rd-party/catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "scopemeasure.h"
+
+using namespace newsboat;
+
+namespace {
+
+class EnabledScopeStats {
+public:
+	explicit EnabledScopeStats(bool enabled)
+		: was_enabled(ScopeStats::enabled())
+	{
+		ScopeStats::set_enabled(enabled);
+	}
+	~EnabledScopeStats()
+	{
+		ScopeStats::set_enabled(was_enabled);
+	}
+
+private:
+	const bool was_enabled;
+};
+
+}
+
+TEST_CASE("ScopeStatsTimer only records the scope while statistics are "
+	"enabled", "[ScopeStats]")
+{
+	ScopeStats stats("test");
+
+	{
+		EnabledScopeStats disabled(false);
+		ScopeStatsTimer timer(stats);
+	}
+	REQUIRE(stats.summary().count == 0);
+
+	{
+		EnabledScopeStats enabled(true);
+		for (int i = 0; i < 3; ++i) {
+			ScopeStatsTimer timer(stats);
+		}
+	}
+	REQUIRE(stats.summary().count == 3);
+}
+
+TEST_CASE("ScopeStats::summary() adds up the durations and bounds "
+	"the 99th percentile", "[ScopeStats]")
+{
+	using std::chrono::nanoseconds;
+
+	ScopeStats stats("test");
+	REQUIRE(stats.summary().count == 0);
+	REQUIRE(stats.summary().p99 == nanoseconds(0));
+
+	for (int i = 0; i < 99; ++i) {
+		stats.add(nanoseconds(100));
+	}
+	stats.add(nanoseconds(1000000));
+
+	const auto summary = stats.summary();
+	REQUIRE(summary.count == 100);
+	REQUIRE(summary.total == nanoseconds(99 * 100 + 1000000));
+	REQUIRE(summary.p99 >= nanoseconds(100));
+	REQUIRE(summary.p99 < nanoseconds(200));
+
+	SECTION("the slowest run counts once it's more than 1% of them") {
+		stats.add(nanoseconds(1000000));
+
+		REQUIRE(stats.summary().p99 >= nanoseconds(1000000));
+		REQUIRE(stats.summary().p99 < nanoseconds(2000000));
+	}
+}
+
+TEST_CASE("ScopeStats::named() returns the same instance for the same name",
+	"[ScopeStats]")
+{
+	auto& first = ScopeStats::named("ScopeStats test: named");
+	auto& second = ScopeStats::named(std::string("ScopeStats test: ") + "named");
+	REQUIRE(&first == &second);
+	REQUIRE(&first != &ScopeStats::named("ScopeStats test: other"));
+}
+
+TEST_CASE("ScopeStats::summaries() lists the scopes that ran, the one "
+	"that took longest first", "[ScopeStats]")
+{
+	using std::chrono::nanoseconds;
+
+	ScopeStats never_ran("ScopeStats test: never ran");
+	ScopeStats fast("ScopeStats test: fast");
+	ScopeStats slow("ScopeStats test: slow");
+	fast.add(nanoseconds(10));
+	slow.add(nanoseconds(1000000000000));
+
+	const auto summaries = ScopeStats::summaries();
+	REQUIRE_FALSE(summaries.empty());
+	REQUIRE(summaries.front().first == "ScopeStats test: slow");
+
+	std::vector<std::string> names;
+	for (const auto& entry : summaries) {
+		names.push_back(entry.first);
+	}
+	const auto position = [&](const std::string& name) {
+		return std::find(names.begin(), names.end(), name) - names.begin();
+	};
+	REQUIRE(position("ScopeStats test: fast") < static_cast<long>(names.size()));
+	REQUIRE(position("ScopeStats test: never ran")
+		== static_cast<long>(names.size()));
+
+	const auto report = ScopeStats::report();
+	REQUIRE(report.find("ScopeStats test: slow") < report.find("ScopeStats test: fast"));
+}
+
+TEST_CASE("ScopeMeasure adds its time to ScopeStats::named() while enabled",
+	"[ScopeStats]")
+{
+	auto& stats = ScopeStats::named("ScopeStats test: measured");
+	const auto before = stats.summary().count;
+
+	{
+		EnabledScopeStats enabled(true);
+		ScopeMeasure measure("ScopeStats test: measured");
+		measure.stopover("halfway");
+	}
+	{
+		EnabledScopeStats disabled(false);
+		ScopeMeasure measure("ScopeStats test: measured");
+	}
+
+	REQUIRE(stats.summary().count == before + 1);
+	REQUIRE(ScopeStats::named(
+			"ScopeStats test: measured (stop over `halfway')").summary().count == 1);
+}
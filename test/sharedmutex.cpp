@@ -0,0 +1,68 @@
+#include "sharedmutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("SharedMutex lets several readers in at once", "[SharedMutex]")
+{
+	SharedMutex mtx;
+	std::atomic<unsigned int> inside(0);
+	std::atomic<unsigned int> most_inside(0);
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i) {
+		readers.emplace_back([&]() {
+			const SharedLock lock(mtx);
+			const unsigned int now = ++inside;
+			unsigned int most = most_inside;
+			while (now > most && !most_inside.compare_exchange_weak(most, now)) {
+			}
+			// Wait for the others, for a while
+			const auto until = std::chrono::steady_clock::now()
+				+ std::chrono::seconds(5);
+			while (most_inside < 4 && std::chrono::steady_clock::now() < until) {
+				std::this_thread::yield();
+			}
+			--inside;
+		});
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	REQUIRE(most_inside == 4);
+}
+
+TEST_CASE("SharedMutex keeps readers and other writers out while it's held "
+	"for writing", "[SharedMutex]")
+{
+	SharedMutex mtx;
+	std::unique_lock<SharedMutex> writer(mtx);
+	REQUIRE_FALSE(mtx.try_lock());
+
+	std::atomic<bool> read(false);
+	std::thread reader([&]() {
+		const SharedLock lock(mtx);
+		read = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	REQUIRE_FALSE(read);
+
+	writer.unlock();
+	reader.join();
+	REQUIRE(read);
+
+	{
+		const SharedLock lock(mtx);
+		REQUIRE_FALSE(mtx.try_lock());
+	}
+	REQUIRE(mtx.try_lock());
+	mtx.unlock();
+}
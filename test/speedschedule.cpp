@@ -0,0 +1,91 @@
+#include "speedschedule.h"
+
+#include "3rd-party/catch.hpp"
+#include "confighandlerexception.h"
+
+using namespace podboat;
+
+TEST_CASE("SpeedSchedule::handle_action handles `download-speed-schedule`",
+	"[SpeedSchedule]")
+{
+	SpeedSchedule schedule;
+
+	const auto action = "download-speed-schedule";
+
+	SECTION("Throws ConfigHandlerException unless there are 3 parameters") {
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:00"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:00", "200", "300"}),
+			newsboat::ConfigHandlerException);
+	}
+
+	SECTION("Throws ConfigHandlerException on invalid times and speeds") {
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"8", "18:00", "200"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:60", "200"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "25:00", "200"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:00am", "200"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "08:00", "200"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:00", "fast"}),
+			newsboat::ConfigHandlerException);
+		REQUIRE_THROWS_AS(schedule.handle_action(action, {"08:00", "18:00", "-1"}),
+			newsboat::ConfigHandlerException);
+	}
+
+	SECTION("Throws ConfigHandlerException on other commands") {
+		REQUIRE_THROWS_AS(schedule.handle_action("download-speed", {"08:00", "18:00", "200"}),
+			newsboat::ConfigHandlerException);
+	}
+
+	SECTION("Dumps the periods it was given") {
+		REQUIRE_NOTHROW(schedule.handle_action(action, {"8:00", "18:30", "200"}));
+		REQUIRE_NOTHROW(schedule.handle_action(action, {"22:00", "24:00", "0"}));
+
+		std::vector<std::string> config;
+		schedule.dump_config(config);
+		REQUIRE(config == std::vector<std::string>({
+			"download-speed-schedule 08:00 18:30 200",
+			"download-speed-schedule 22:00 24:00 0",
+		}));
+	}
+}
+
+TEST_CASE("SpeedSchedule::limit_at() returns the limit of the period covering the time",
+	"[SpeedSchedule]")
+{
+	SpeedSchedule schedule;
+	const auto action = "download-speed-schedule";
+
+	REQUIRE_FALSE(schedule.limit_at(0));
+
+	schedule.handle_action(action, {"08:00", "18:00", "200"});
+	REQUIRE_FALSE(schedule.limit_at(7 * 60 + 59));
+	REQUIRE(schedule.limit_at(8 * 60) == 200u);
+	REQUIRE(schedule.limit_at(17 * 60 + 59) == 200u);
+	REQUIRE_FALSE(schedule.limit_at(18 * 60));
+
+	SECTION("periods may go on past midnight") {
+		schedule.handle_action(action, {"23:00", "06:00", "1000"});
+		REQUIRE(schedule.limit_at(23 * 60) == 1000u);
+		REQUIRE(schedule.limit_at(0) == 1000u);
+		REQUIRE(schedule.limit_at(5 * 60 + 59) == 1000u);
+		REQUIRE_FALSE(schedule.limit_at(6 * 60));
+	}
+
+	SECTION("the last of overlapping periods wins") {
+		schedule.handle_action(action, {"12:00", "13:00", "50"});
+		REQUIRE(schedule.limit_at(11 * 60) == 200u);
+		REQUIRE(schedule.limit_at(12 * 60 + 30) == 50u);
+		REQUIRE(schedule.limit_at(13 * 60) == 200u);
+	}
+
+	SECTION("a period may cover the whole day") {
+		schedule.handle_action(action, {"00:00", "24:00", "10"});
+		REQUIRE(schedule.limit_at(0) == 10u);
+		REQUIRE(schedule.limit_at(24 * 60 - 1) == 10u);
+	}
+}
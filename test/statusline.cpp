@@ -1,5 +1,7 @@
 #include "statusline.h"
 
+#include <thread>
+
 #include "3rd-party/catch.hpp"
 
 using namespace newsboat;
@@ -8,21 +10,31 @@ class StatusTester : public IStatus {
 public:
 	StatusTester()
 		: last_string_was_error(false)
+		, updates(0)
+		, notifications(0)
 	{
 	}
 	void set_status(const std::string& message) override
 	{
 		last_message = message;
 		last_string_was_error = false;
+		++updates;
 	}
 	void show_error(const std::string& message) override
 	{
 		last_message = message;
 		last_string_was_error = true;
+		++updates;
+	}
+	void messages_pending() override
+	{
+		++notifications;
 	}
 
 	std::string last_message;
 	bool last_string_was_error;
+	unsigned int updates;
+	unsigned int notifications;
 };
 
 TEST_CASE("StatusLine passes status messages to registered IStatus implementation",
@@ -225,3 +237,72 @@ TEST_CASE("show_message_until_finished() will restore old message when lifetime
 		}
 	}
 }
+
+TEST_CASE("A message of show_message_until_finished() can be updated while "
+	"it's shown", "[StatusLine]")
+{
+	StatusTester status_message_handler;
+	StatusLine status_line(status_message_handler);
+
+	auto older = status_line.show_message_until_finished("Searching...");
+	older->update("Searching... 10%");
+	REQUIRE(status_message_handler.last_message == "Searching... 10%");
+
+	auto newer = status_line.show_message_until_finished("Loading...");
+	older->update("Searching... 20%");
+	REQUIRE(status_message_handler.last_message == "Loading...");
+
+	newer.reset();
+	REQUIRE(status_message_handler.last_message == "Searching... 20%");
+}
+
+TEST_CASE("StatusLine queues messages from other threads until drain() is "
+	"called, and shows only the last one", "[StatusLine]")
+{
+	StatusTester status_message_handler;
+	StatusLine status_line(status_message_handler);
+
+	std::thread worker([&]() {
+		auto progress = status_line.show_message_until_finished("Reloading 1/3...");
+		progress->update("Reloading 2/3...");
+		progress->update("Reloading 3/3...");
+		progress.reset();
+		status_line.show_error("Reloading failed");
+	});
+	worker.join();
+
+	REQUIRE(status_message_handler.notifications == 5);
+	REQUIRE(status_message_handler.updates == 0);
+
+	status_line.drain();
+	REQUIRE(status_message_handler.updates == 1);
+	REQUIRE(status_message_handler.last_message == "Reloading failed");
+	REQUIRE(status_message_handler.last_string_was_error);
+
+	status_line.drain();
+	REQUIRE(status_message_handler.updates == 1);
+}
+
+TEST_CASE("StatusLine::drain() doesn't touch the status if the queued "
+	"messages don't change it", "[StatusLine]")
+{
+	StatusTester status_message_handler;
+	StatusLine status_line(status_message_handler);
+	auto shown = status_line.show_message_until_finished("Loading...");
+	auto hidden = status_line.show_message_until_finished("Searching...");
+	shown.swap(hidden);
+	REQUIRE(status_message_handler.updates == 2);
+
+	std::thread worker([&]() {
+		// Neither is the message that's shown
+		hidden->update("Loading... 50%");
+	});
+	worker.join();
+	status_line.drain();
+
+	REQUIRE(status_message_handler.updates == 2);
+	REQUIRE(status_message_handler.last_message == "Searching...");
+
+	shown.reset();
+	REQUIRE(status_message_handler.last_message == "Loading... 50%");
+}
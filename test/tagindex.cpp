@@ -0,0 +1,59 @@
+#include "tagindex.h"
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "rssfeed.h"
+
+using namespace newsboat;
+
+TEST_CASE("TagIndex counts the feeds with each tag, and their unread articles",
+	"[TagIndex]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const RssFeed first(&rsscache, "");
+	const RssFeed second(&rsscache, "");
+
+	TagIndex index;
+	REQUIRE(index.feed_count("news") == 0);
+
+	index.add_feed(&first, {"news", "tech", "news"}, 3);
+	index.add_feed(&second, {"news"}, 0);
+	REQUIRE(index.feed_count("news") == 2);
+	REQUIRE(index.unread_feed_count("news") == 1);
+	REQUIRE(index.unread_item_count("news") == 3);
+	REQUIRE(index.feed_count("tech") == 1);
+	REQUIRE(index.feed_count("unknown") == 0);
+	REQUIRE(index.unread_item_count("unknown") == 0);
+
+	SECTION("unread counts") {
+		index.set_unread(&second, 2);
+		REQUIRE(index.unread_feed_count("news") == 2);
+		REQUIRE(index.unread_item_count("news") == 5);
+		REQUIRE(index.unread_item_count("tech") == 3);
+
+		index.set_unread(&first, 0);
+		REQUIRE(index.unread_feed_count("news") == 1);
+		REQUIRE(index.unread_feed_count("tech") == 0);
+	}
+
+	SECTION("adding a feed again replaces its tags") {
+		index.add_feed(&first, {"tech"}, 1);
+		REQUIRE(index.feed_count("news") == 1);
+		REQUIRE(index.unread_item_count("news") == 0);
+		REQUIRE(index.unread_item_count("tech") == 1);
+	}
+
+	SECTION("removing feeds") {
+		index.remove_feed(&first);
+		REQUIRE(index.feed_count("news") == 1);
+		REQUIRE(index.feed_count("tech") == 0);
+		REQUIRE(index.unread_item_count("news") == 0);
+
+		index.remove_feed(&first);
+		index.set_unread(&first, 10);
+		REQUIRE(index.feed_count("tech") == 0);
+		REQUIRE(index.unread_item_count("tech") == 0);
+	}
+}
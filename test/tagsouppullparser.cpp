@@ -1,6 +1,8 @@
 #include "tagsouppullparser.h"
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "3rd-party/catch.hpp"
 
@@ -299,3 +301,82 @@ TEST_CASE("TagSoupPullParser ignores unknown and invalid entities",
 		REQUIRE(e == TagSoupPullParser::Event::END_DOCUMENT);
 	}
 }
+
+TEST_CASE("TagSoupPullParser produces the same events from a string as from "
+	"a stream",
+	"[TagSoupPullParser]")
+{
+	const auto events_of = [](TagSoupPullParser& xpp) {
+		std::vector<std::string> events;
+		for (auto e = xpp.next(); e != TagSoupPullParser::Event::END_DOCUMENT;
+			e = xpp.next()) {
+			std::string event = std::to_string(static_cast<int>(e)) + ":" +
+				xpp.get_text();
+			for (const std::string name : {
+					"href", "title", "checked"
+				}) {
+				const auto value = xpp.get_attribute_value(name);
+				if (value.has_value()) {
+					event += " " + name + "=" + value.value();
+				}
+			}
+			events.push_back(event);
+		}
+		return events;
+	};
+
+	const std::vector<std::string> inputs = {
+		"",
+		"just text",
+		"<p>text &amp; more</p>trailing",
+		"<a href='https://example.com/?a=1&amp;b=2' title=\"x y\" checked>",
+		"<br/><unterminated tag",
+		"text then a lone <",
+		std::string("with\0nul", 8),
+	};
+	for (const auto& input : inputs) {
+		INFO("input: " << input);
+		std::istringstream input_stream(input);
+		TagSoupPullParser from_stream(input_stream);
+		TagSoupPullParser from_string(input);
+
+		const auto expected = events_of(from_stream);
+		REQUIRE(events_of(from_string) == expected);
+		REQUIRE(from_string.get_event_type() ==
+			TagSoupPullParser::Event::END_DOCUMENT);
+	}
+}
+
+TEST_CASE("TagSoupPullParser can skip the data of inline images",
+	"[TagSoupPullParser]")
+{
+	const std::string data(100000, 'A');
+	const std::string input = "<img src=\"data:image/png;base64," + data +
+		"\" alt='x'><IMG SRC=data:image/gif;base64," + data + ">"
+		"<a href=\"data:text/plain,hello\">"
+		"<img src=\"https://example.com/a.png\">";
+
+	TagSoupPullParser xpp(input);
+	xpp.set_skip_inline_images(true);
+
+	REQUIRE(xpp.next() == TagSoupPullParser::Event::START_TAG);
+	REQUIRE(xpp.get_attribute_value("src") == "data:image/png;base64,");
+	REQUIRE(xpp.get_attribute_value("alt") == "x");
+
+	REQUIRE(xpp.next() == TagSoupPullParser::Event::START_TAG);
+	REQUIRE(xpp.get_attribute_value("src") == "data:image/gif;base64,");
+
+	SECTION("only the src of images is cut short") {
+		REQUIRE(xpp.next() == TagSoupPullParser::Event::START_TAG);
+		REQUIRE(xpp.get_attribute_value("href") == "data:text/plain,hello");
+
+		REQUIRE(xpp.next() == TagSoupPullParser::Event::START_TAG);
+		REQUIRE(xpp.get_attribute_value("src") == "https://example.com/a.png");
+	}
+
+	SECTION("the data is kept by default") {
+		TagSoupPullParser full(input);
+		REQUIRE(full.next() == TagSoupPullParser::Event::START_TAG);
+		REQUIRE(full.get_attribute_value("src") == "data:image/png;base64," + data);
+	}
+}
@@ -0,0 +1,510 @@
+#include "replayserver.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <curl/curl.h>
+#include <fstream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "3rd-party/json.hpp"
+
+namespace {
+
+/* Headers that describe the transfer rather than the body; curl has
+ * already undone the encodings, and the server sends its own length. */
+bool is_transfer_header(const std::string& name)
+{
+	for (const char* header : {
+			"Connection", "Content-Encoding", "Content-Length", "Keep-Alive",
+			"Transfer-Encoding"
+		}) {
+		if (::strcasecmp(name.c_str(), header) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string trim(const std::string& str)
+{
+	const auto begin = str.find_first_not_of(" \t\r\n");
+	if (begin == std::string::npos) {
+		return "";
+	}
+	const auto end = str.find_last_not_of(" \t\r\n");
+	return str.substr(begin, end - begin + 1);
+}
+
+/* The value of header \a name among \a headers, or "" */
+std::string find_header(
+	const std::vector<std::pair<std::string, std::string>>& headers,
+	const std::string& name)
+{
+	for (const auto& header : headers) {
+		if (::strcasecmp(header.first.c_str(), name.c_str()) == 0) {
+			return header.second;
+		}
+	}
+	return "";
+}
+
+std::string reason_phrase(long status)
+{
+	switch (status) {
+	case 200:
+		return "OK";
+	case 304:
+		return "Not Modified";
+	case 404:
+		return "Not Found";
+	case 410:
+		return "Gone";
+	case 500:
+		return "Internal Server Error";
+	default:
+		return "Status " + std::to_string(status);
+	}
+}
+
+struct Download {
+	std::vector<std::pair<std::string, std::string>> headers;
+	std::string body;
+};
+
+size_t collect_header(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+	auto download = static_cast<Download*>(userdata);
+	const std::string line(buffer, size * nitems);
+	if (line.compare(0, 5, "HTTP/") == 0) {
+		// Starts the headers of a response; those of redirects don't count
+		download->headers.clear();
+	} else {
+		const auto colon = line.find(':');
+		if (colon != std::string::npos) {
+			const auto name = trim(line.substr(0, colon));
+			if (!is_transfer_header(name)) {
+				download->headers.emplace_back(name, trim(line.substr(colon + 1)));
+			}
+		}
+	}
+	return size * nitems;
+}
+
+size_t collect_body(char* buffer, size_t size, size_t nmemb, void* userdata)
+{
+	static_cast<Download*>(userdata)->body.append(buffer, size * nmemb);
+	return size * nmemb;
+}
+
+std::chrono::milliseconds curl_time(CURL* handle, CURLINFO info)
+{
+	double seconds = 0;
+	curl_easy_getinfo(handle, info, &seconds);
+	return std::chrono::milliseconds(static_cast<long>(1000 * seconds));
+}
+
+std::string read_file(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("ReplayArchive: couldn't read " + path);
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+void write_file(const std::string& path, const std::string& contents)
+{
+	std::ofstream file(path, std::ios::binary);
+	file << contents;
+	file.close();
+	if (!file) {
+		throw std::runtime_error("ReplayArchive: couldn't write " + path);
+	}
+}
+
+}
+
+test_helpers::ReplayArchive test_helpers::ReplayArchive::load(
+	const std::string& dir)
+{
+	ReplayArchive archive;
+	const auto index = nlohmann::json::parse(read_file(dir + "/index.json"));
+	for (const auto& entry : index.at("responses")) {
+		Response response;
+		response.url = entry.at("url").get<std::string>();
+		response.status = entry.at("status").get<long>();
+		for (const auto& header : entry.at("headers")) {
+			response.headers.emplace_back(header.at(0).get<std::string>(),
+				header.at(1).get<std::string>());
+		}
+		response.body = read_file(dir + "/" + entry.at("body").get<std::string>());
+		response.ttfb = std::chrono::milliseconds(
+				entry.at("ttfb_ms").get<long>());
+		response.total = std::chrono::milliseconds(
+				entry.at("total_ms").get<long>());
+		response.not_modified_total = std::chrono::milliseconds(
+				entry.value("not_modified_total_ms", -1L));
+		archive.responses.push_back(std::move(response));
+	}
+	return archive;
+}
+
+void test_helpers::ReplayArchive::save(const std::string& dir) const
+{
+	nlohmann::json entries = nlohmann::json::array();
+	for (std::size_t i = 0; i < responses.size(); ++i) {
+		const auto& response = responses[i];
+		const std::string body = std::to_string(i) + ".body";
+		write_file(dir + "/" + body, response.body);
+
+		nlohmann::json entry = {
+			{"url", response.url},
+			{"status", response.status},
+			{"headers", response.headers},
+			{"body", body},
+			{"ttfb_ms", response.ttfb.count()},
+			{"total_ms", response.total.count()},
+		};
+		if (response.not_modified_total.count() >= 0) {
+			entry["not_modified_total_ms"] = response.not_modified_total.count();
+		}
+		entries.push_back(std::move(entry));
+	}
+	write_file(dir + "/index.json",
+		nlohmann::json{{"responses", entries}}.dump(2) + "\n");
+}
+
+bool test_helpers::ReplayArchive::record(const std::string& url)
+{
+	CURL* handle = curl_easy_init();
+	if (handle == nullptr) {
+		return false;
+	}
+
+	Download download;
+	curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(handle, CURLOPT_TIMEOUT, 60L);
+	curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, collect_header);
+	curl_easy_setopt(handle, CURLOPT_HEADERDATA, &download);
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, collect_body);
+	curl_easy_setopt(handle, CURLOPT_WRITEDATA, &download);
+	if (curl_easy_perform(handle) != CURLE_OK) {
+		curl_easy_cleanup(handle);
+		return false;
+	}
+
+	Response response;
+	response.url = url;
+	curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+	response.ttfb = curl_time(handle, CURLINFO_STARTTRANSFER_TIME);
+	response.total = curl_time(handle, CURLINFO_TOTAL_TIME);
+	response.headers = std::move(download.headers);
+	response.body = std::move(download.body);
+
+	const auto etag = find_header(response.headers, "ETag");
+	const auto last_modified = find_header(response.headers, "Last-Modified");
+	if (!etag.empty() || !last_modified.empty()) {
+		curl_slist* conditions = nullptr;
+		if (!etag.empty()) {
+			conditions = curl_slist_append(conditions,
+					("If-None-Match: " + etag).c_str());
+		}
+		if (!last_modified.empty()) {
+			conditions = curl_slist_append(conditions,
+					("If-Modified-Since: " + last_modified).c_str());
+		}
+		Download ignored;
+		curl_easy_setopt(handle, CURLOPT_HTTPHEADER, conditions);
+		curl_easy_setopt(handle, CURLOPT_HEADERDATA, &ignored);
+		curl_easy_setopt(handle, CURLOPT_WRITEDATA, &ignored);
+		long status = 0;
+		if (curl_easy_perform(handle) == CURLE_OK
+			&& curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status) == CURLE_OK
+			&& status == 304) {
+			response.not_modified_total = curl_time(handle, CURLINFO_TOTAL_TIME);
+		}
+		curl_easy_setopt(handle, CURLOPT_HTTPHEADER, nullptr);
+		curl_slist_free_all(conditions);
+	}
+	curl_easy_cleanup(handle);
+
+	responses.push_back(std::move(response));
+	return true;
+}
+
+test_helpers::ReplayServer::ReplayServer(ReplayArchive archive_,
+	Options options_)
+	: archive(std::move(archive_))
+	, options(options_)
+	, listen_fd(-1)
+	, stop_pipe{-1, -1}
+	, port(0)
+	, request_count(0)
+	, connection_count(0)
+{
+	if (::pipe(stop_pipe) != 0) {
+		throw std::runtime_error("ReplayServer: couldn't create a pipe");
+	}
+
+	listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (listen_fd == -1
+		|| ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address),
+			sizeof(address)) != 0
+		|| ::listen(listen_fd, SOMAXCONN) != 0
+		|| ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address),
+			&length) != 0) {
+		const std::string error = std::strerror(errno);
+		if (listen_fd != -1) {
+			::close(listen_fd);
+		}
+		::close(stop_pipe[0]);
+		::close(stop_pipe[1]);
+		throw std::runtime_error("ReplayServer: couldn't listen: " + error);
+	}
+	port = ntohs(address.sin_port);
+
+	acceptor = std::thread(&ReplayServer::accept_connections, this);
+}
+
+test_helpers::ReplayServer::ReplayServer(ReplayArchive archive_)
+	: ReplayServer(std::move(archive_), Options())
+{
+}
+
+test_helpers::ReplayServer::~ReplayServer()
+{
+	::close(stop_pipe[1]);
+	acceptor.join();
+	// No new threads are started once the acceptor is gone
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	::close(listen_fd);
+	::close(stop_pipe[0]);
+}
+
+std::string test_helpers::ReplayServer::url_for(const std::string& url) const
+{
+	for (std::size_t i = 0; i < archive.responses.size(); ++i) {
+		if (archive.responses[i].url == url) {
+			return url_for(i);
+		}
+	}
+	throw std::out_of_range("ReplayServer: no response recorded for " + url);
+}
+
+std::string test_helpers::ReplayServer::url_for(std::size_t index) const
+{
+	return "http://127.0.0.1:" + std::to_string(port) + "/" +
+		std::to_string(index);
+}
+
+std::uint64_t test_helpers::ReplayServer::requests() const
+{
+	return request_count.load();
+}
+
+std::uint64_t test_helpers::ReplayServer::connections() const
+{
+	return connection_count.load();
+}
+
+void test_helpers::ReplayServer::accept_connections()
+{
+	while (true) {
+		pollfd fds[2] = {{listen_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+		if (::poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		if (fds[1].revents != 0) {
+			return;
+		}
+		const int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd == -1) {
+			continue;
+		}
+		++connection_count;
+		std::lock_guard<std::mutex> guard(threads_mtx);
+		threads.emplace_back(&ReplayServer::serve, this, fd);
+	}
+}
+
+void test_helpers::ReplayServer::serve(int fd)
+{
+	std::string received;
+	char buffer[4096];
+	bool open = true;
+	while (open) {
+		pollfd fds[2] = {{fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+		if (::poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (fds[1].revents != 0) {
+			break;
+		}
+		const ssize_t bytes = ::recv(fd, buffer, sizeof(buffer), 0);
+		if (bytes <= 0) {
+			break;
+		}
+		received.append(buffer, bytes);
+
+		// Only GET requests are expected, so there are no bodies to skip
+		std::size_t end;
+		while (open && (end = received.find("\r\n\r\n")) != std::string::npos) {
+			const std::string request = received.substr(0, end + 2);
+			received.erase(0, end + 4);
+			open = respond(fd, request);
+		}
+	}
+	::close(fd);
+}
+
+bool test_helpers::ReplayServer::wait(std::chrono::milliseconds duration) const
+{
+	if (duration.count() <= 0) {
+		return true;
+	}
+	pollfd fds[1] = {{stop_pipe[0], POLLIN, 0}};
+	return ::poll(fds, 1, duration.count()) == 0;
+}
+
+bool test_helpers::ReplayServer::send_all(int fd, const std::string& data) const
+{
+	std::size_t sent = 0;
+	while (sent < data.size()) {
+		const ssize_t bytes = ::send(fd, data.data() + sent, data.size() - sent,
+				MSG_NOSIGNAL);
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytes <= 0) {
+			return false;
+		}
+		sent += bytes;
+	}
+	return true;
+}
+
+bool test_helpers::ReplayServer::respond(int fd, const std::string& request)
+{
+	++request_count;
+
+	std::istringstream lines(request);
+	std::string request_line;
+	std::getline(lines, request_line);
+	std::istringstream words(request_line);
+	std::string method;
+	std::string path;
+	std::string version;
+	words >> method >> path >> version;
+
+	std::vector<std::pair<std::string, std::string>> headers;
+	std::string line;
+	while (std::getline(lines, line)) {
+		const auto colon = line.find(':');
+		if (colon != std::string::npos) {
+			headers.emplace_back(trim(line.substr(0, colon)),
+				trim(line.substr(colon + 1)));
+		}
+	}
+	const auto connection = find_header(headers, "Connection");
+	const bool keep_alive = version == "HTTP/1.1"
+		? ::strcasecmp(connection.c_str(), "close") != 0
+		: ::strcasecmp(connection.c_str(), "keep-alive") == 0;
+
+	std::size_t index = archive.responses.size();
+	if (path.size() > 1 && path[0] == '/'
+		&& path.find_first_not_of("0123456789", 1) == std::string::npos) {
+		index = std::stoul(path.substr(1));
+	}
+	if (index >= archive.responses.size()) {
+		const std::string body = "Not Found\n";
+		return send_all(fd, "HTTP/1.1 404 Not Found\r\n"
+				"Content-Type: text/plain\r\n"
+				"Content-Length: " + std::to_string(body.size()) + "\r\n"
+				"\r\n" + body) && keep_alive;
+	}
+	const auto& response = archive.responses[index];
+
+	const auto etag = find_header(response.headers, "ETag");
+	const auto last_modified = find_header(response.headers, "Last-Modified");
+	const auto if_none_match = find_header(headers, "If-None-Match");
+	const auto if_modified_since = find_header(headers, "If-Modified-Since");
+	const bool not_modified = response.status == 200
+		&& ((!etag.empty() && if_none_match.find(etag) != std::string::npos)
+			|| (!last_modified.empty() && if_modified_since == last_modified));
+
+	std::string head;
+	if (not_modified) {
+		const auto recorded = std::max(response.not_modified_total,
+				std::chrono::milliseconds(0));
+		if (!wait(options.latency
+				+ (options.recorded_timing ? recorded : std::chrono::milliseconds(0)))) {
+			return false;
+		}
+		head = "HTTP/1.1 304 Not Modified\r\n";
+		if (!etag.empty()) {
+			head += "ETag: " + etag + "\r\n";
+		}
+		if (!last_modified.empty()) {
+			head += "Last-Modified: " + last_modified + "\r\n";
+		}
+		return send_all(fd, head + "\r\n") && keep_alive;
+	}
+
+	if (!wait(options.latency
+			+ (options.recorded_timing ? response.ttfb : std::chrono::milliseconds(0)))) {
+		return false;
+	}
+	head = "HTTP/1.1 " + std::to_string(response.status) + " " +
+		reason_phrase(response.status) + "\r\n";
+	for (const auto& header : response.headers) {
+		head += header.first + ": " + header.second + "\r\n";
+	}
+	head += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+	head += "\r\n";
+	if (!send_all(fd, head)) {
+		return false;
+	}
+
+	// A slow server is emulated by sending the body a piece at a time
+	const auto transfer = response.total - response.ttfb;
+	const std::size_t pieces = options.recorded_timing && transfer.count() > 0
+		? 10 : 1;
+	const std::size_t piece_size = (response.body.size() + pieces - 1) / pieces;
+	for (std::size_t offset = 0; offset < response.body.size();
+		offset += piece_size) {
+		if (offset > 0 && !wait(transfer / pieces)) {
+			return false;
+		}
+		if (!send_all(fd, response.body.substr(offset, piece_size))) {
+			return false;
+		}
+	}
+	return keep_alive;
+}
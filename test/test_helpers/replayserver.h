@@ -0,0 +1,119 @@
+#ifndef NEWSBOAT_TEST_HELPERS_REPLAYSERVER_H_
+#define NEWSBOAT_TEST_HELPERS_REPLAYSERVER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace test_helpers {
+
+/* Responses of feed servers, recorded so that they can be served again by
+ * a ReplayServer.
+ *
+ * An archive is a directory with an index.json that lists the responses,
+ * and a file with the body of each of them. */
+class ReplayArchive {
+public:
+	struct Response {
+		std::string url;
+		long status = 200;
+		/* Without the headers that describe the transfer rather than the
+		 * body, like Content-Length; the server adds its own. */
+		std::vector<std::pair<std::string, std::string>> headers;
+		std::string body;
+		/* How long the server took to send the headers, and the whole
+		 * response. */
+		std::chrono::milliseconds ttfb{0};
+		std::chrono::milliseconds total{0};
+		/* How long the server took to answer a conditional request with
+		 * 304 Not Modified; negative if the response has no validators, or
+		 * the server didn't answer with 304. */
+		std::chrono::milliseconds not_modified_total{-1};
+	};
+
+	ReplayArchive() = default;
+
+	/* Reads the archive in directory \a dir. Throws std::runtime_error if
+	 * it can't. */
+	static ReplayArchive load(const std::string& dir);
+	/* Writes the archive to directory \a dir, which has to exist. Throws
+	 * std::runtime_error if it can't. */
+	void save(const std::string& dir) const;
+
+	/* Downloads \a url with curl, following redirects, and adds the
+	 * response under \a url. If it has an ETag or a Last-Modified date, it's
+	 * then requested again with them, to see how long a 304 takes. Returns
+	 * false if the download failed. */
+	bool record(const std::string& url);
+
+	std::vector<Response> responses;
+};
+
+/* A local HTTP/1.1 server that answers with the responses of a
+ * ReplayArchive, so that reloads can be measured without the network.
+ *
+ * It listens on a random port of 127.0.0.1, and serves the archive's n-th
+ * response at /n; url_for() gives that URL. Conditional requests that match
+ * the response's ETag or Last-Modified date are answered with 304 Not
+ * Modified, and unknown paths with 404. Connections are kept alive.
+ *
+ * Each connection is served by a thread of its own, until the server is
+ * destroyed. */
+class ReplayServer {
+public:
+	struct Options {
+		/* Waited before every response */
+		std::chrono::milliseconds latency{0};
+		/* Whether to also take as long as the recorded server did: the
+		 * headers are sent after the recorded time to first byte, and the
+		 * rest of the body is spread over the rest of the recorded time. */
+		bool recorded_timing = false;
+	};
+
+	ReplayServer(ReplayArchive archive, Options options);
+	explicit ReplayServer(ReplayArchive archive);
+	ReplayServer(const ReplayServer&) = delete;
+	ReplayServer& operator=(const ReplayServer&) = delete;
+	~ReplayServer();
+
+	/* The local URL of the response recorded for \a url. Throws
+	 * std::out_of_range if the archive doesn't have it. */
+	std::string url_for(const std::string& url) const;
+	std::string url_for(std::size_t index) const;
+
+	std::uint64_t requests() const;
+	std::uint64_t connections() const;
+
+private:
+	void accept_connections();
+	void serve(int fd);
+	/* Waits for \a duration, or until the server is stopped. Returns false
+	 * in the latter case. */
+	bool wait(std::chrono::milliseconds duration) const;
+	/* Writes all of \a data, or returns false. */
+	bool send_all(int fd, const std::string& data) const;
+	bool respond(int fd, const std::string& request);
+
+	const ReplayArchive archive;
+	const Options options;
+	int listen_fd;
+	/* Closing the write end wakes up all threads, and stops them */
+	int stop_pipe[2];
+	unsigned short port;
+
+	std::thread acceptor;
+	std::mutex threads_mtx;
+	std::vector<std::thread> threads;
+
+	std::atomic<std::uint64_t> request_count;
+	std::atomic<std::uint64_t> connection_count;
+};
+
+} // namespace test_helpers
+
+#endif /* NEWSBOAT_TEST_HELPERS_REPLAYSERVER_H_ */
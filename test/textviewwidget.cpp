@@ -3,6 +3,7 @@
 #include "3rd-party/catch.hpp"
 #include "listformatter.h"
 #include "stflpp.h"
+#include "strprintf.h"
 
 using namespace newsboat;
 
@@ -137,3 +138,75 @@ TEST_CASE("Basic movements work as expected", "[TextviewWidget]")
 		REQUIRE(widget.get_scroll_offset() == 9);
 	}
 }
+
+TEST_CASE("Only the lines around the scroll offset of a long text are handed "
+	"to STFL", "[TextviewWidget]")
+{
+	Stfl::Form form(stflTextviewForm);
+	TextviewWidget widget(widgetName, form);
+
+	form.run(-3);
+	Stfl::reset();
+
+	REQUIRE(widget.get_height() == 5);
+
+	ListFormatter listfmt;
+	for (int i = 0; i < 1000; ++i) {
+		listfmt.add_line(strprintf::fmt("line-%04d {with} \"quotes\" 'in it'", i));
+	}
+	widget.stfl_replace_lines(listfmt.get_lines_count(), listfmt.format_list());
+
+	REQUIRE(widget.get_window_start() == 0);
+	REQUIRE(widget.get_window_size() < 1000);
+
+	const auto stfl_has_line = [&](int line) {
+		const std::string text = form.dump(widgetName, "", 0);
+		return text.find(strprintf::fmt("line-%04d", line)) != std::string::npos;
+	};
+
+	REQUIRE(stfl_has_line(0));
+	REQUIRE_FALSE(stfl_has_line(500));
+
+	SECTION("scrolling moves the window along") {
+		widget.set_scroll_offset(500);
+		REQUIRE(widget.get_scroll_offset() == 500);
+		REQUIRE(widget.get_window_start() <= 500);
+		REQUIRE(widget.get_window_start() + widget.get_window_size() >= 505);
+		REQUIRE(stfl_has_line(500));
+		REQUIRE(stfl_has_line(504));
+		REQUIRE_FALSE(stfl_has_line(0));
+
+		widget.scroll_page_down();
+		REQUIRE(widget.get_scroll_offset() == 504);
+
+		widget.scroll_to_top();
+		REQUIRE(widget.get_scroll_offset() == 0);
+		REQUIRE(stfl_has_line(0));
+	}
+
+	SECTION("scrolling to the bottom shows the last lines") {
+		widget.scroll_to_bottom();
+		REQUIRE(widget.get_scroll_offset() == 996);
+		REQUIRE(stfl_has_line(999));
+		REQUIRE(widget.get_window_start() + widget.get_window_size() == 1000);
+	}
+
+	SECTION("replacing the text keeps the scroll offset") {
+		widget.set_scroll_offset(700);
+		listfmt.add_line("line-1000");
+		widget.stfl_replace_lines(listfmt.get_lines_count(), listfmt.format_list());
+		REQUIRE(widget.get_scroll_offset() == 700);
+		REQUIRE(stfl_has_line(700));
+	}
+
+	SECTION("a shorter text moves the offset to its last line") {
+		widget.set_scroll_offset(700);
+		listfmt.clear();
+		for (int i = 0; i < 300; ++i) {
+			listfmt.add_line(strprintf::fmt("line-%04d", i));
+		}
+		widget.stfl_replace_lines(listfmt.get_lines_count(), listfmt.format_list());
+		REQUIRE(widget.get_scroll_offset() == 299);
+		REQUIRE(stfl_has_line(299));
+	}
+}
@@ -0,0 +1,135 @@
+#include "titleindex.h"
+
+#include <memory>
+
+#include "3rd-party/catch.hpp"
+#include "cache.h"
+#include "configcontainer.h"
+#include "feedcontainer.h"
+#include "rssfeed.h"
+#include "rssitem.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::shared_ptr<RssItem> make_item(Cache* rsscache, const std::string& title,
+	const std::string& author = "")
+{
+	const auto item = std::make_shared<RssItem>(rsscache);
+	item->set_guid(title);
+	item->set_title(title);
+	item->set_author(author);
+	return item;
+}
+
+} // anonymous namespace
+
+TEST_CASE("TitleIndex finds substrings of titles and authors, ignoring the "
+	"case of ASCII letters", "[TitleIndex]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto rust = make_item(&rsscache, "Rust 1.50 released",
+			"The Rust Team");
+	const auto trust = make_item(&rsscache, "Trust in the Process", "Ada");
+	const auto cafe = make_item(&rsscache, "Café opening", "Ådne");
+
+	TitleIndex index;
+	index.add_item(rust);
+	index.add_item(trust);
+	index.add_item(cafe);
+	REQUIRE(index.size() == 3);
+
+	using Items = std::vector<std::shared_ptr<RssItem>>;
+	REQUIRE(index.search("rust") == Items({rust, trust}));
+	REQUIRE(index.search("RUST 1") == Items({rust}));
+	REQUIRE(index.search("team") == Items({rust}));
+	REQUIRE(index.search("process") == Items({trust}));
+	REQUIRE(index.search("afé") == Items({cafe}));
+	REQUIRE(index.search("rusty").empty());
+
+	SECTION("having the trigrams of the query isn't enough") {
+		REQUIRE(index.search("rustrust").empty());
+	}
+
+	SECTION("queries shorter than a trigram look at every article") {
+		REQUIRE(index.search("") == Items({rust, trust, cafe}));
+		REQUIRE(index.search("In") == Items({trust, cafe}));
+		REQUIRE(index.search("Å") == Items({cafe}));
+	}
+
+	SECTION("the title and the author don't run into each other") {
+		REQUIRE(index.search("essada").empty());
+	}
+
+	SECTION("deleted articles are left out") {
+		trust->set_deleted(true);
+		REQUIRE(index.search("rust") == Items({rust}));
+	}
+}
+
+TEST_CASE("TitleIndex keeps an article until everyone who added it removed "
+	"it", "[TitleIndex]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	const auto first = make_item(&rsscache, "First article");
+	const auto second = make_item(&rsscache, "Second article");
+
+	TitleIndex index;
+	index.add_item(first);
+	index.add_item(first);
+	index.add_item(second);
+
+	index.remove_item(first.get());
+	REQUIRE(index.search("article").size() == 2);
+	index.remove_item(first.get());
+	REQUIRE(index.size() == 1);
+	REQUIRE(index.search("article") ==
+		std::vector<std::shared_ptr<RssItem>>({second}));
+
+	SECTION("articles added after some were removed are found too") {
+		const auto third = make_item(&rsscache, "Third article");
+		index.add_item(third);
+		index.add_item(first);
+		REQUIRE(index.search("article") ==
+			std::vector<std::shared_ptr<RssItem>>({second, third, first}));
+	}
+
+	SECTION("removing an article that isn't there does nothing") {
+		const auto other = make_item(&rsscache, "Other article");
+		index.remove_item(other.get());
+		REQUIRE(index.size() == 1);
+	}
+}
+
+TEST_CASE("FeedContainer::search_titles() sees the articles as the feeds get "
+	"and lose them", "[TitleIndex]")
+{
+	ConfigContainer cfg;
+	Cache rsscache(":memory:", &cfg);
+	FeedContainer feedcontainer;
+	const auto feed = std::make_shared<RssFeed>(&rsscache, "http://example.com");
+	const auto before = make_item(&rsscache, "Added before the feed");
+	feed->add_item(before);
+	feedcontainer.add_feed(feed);
+	REQUIRE(feedcontainer.search_titles("added").size() == 1);
+
+	const auto after = make_item(&rsscache, "Added after the feed");
+	feed->add_item(after);
+	REQUIRE(feedcontainer.search_titles("added").size() == 2);
+
+	feed->erase_item(feed->items().begin());
+	REQUIRE(feedcontainer.search_titles("added") ==
+		std::vector<std::shared_ptr<RssItem>>({after}));
+
+	SECTION("a replaced feed takes its articles with it") {
+		const auto replacement = std::make_shared<RssFeed>(&rsscache,
+				"http://example.com");
+		replacement->add_item(make_item(&rsscache, "Something else"));
+		feedcontainer.replace_feed(0, replacement);
+		REQUIRE(feedcontainer.search_titles("added").empty());
+		REQUIRE(feedcontainer.search_titles("else").size() == 1);
+	}
+}
@@ -0,0 +1,92 @@
+#include "tracelog.h"
+
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "3rd-party/catch.hpp"
+#include "3rd-party/json.hpp"
+#include "test_helpers/tempdir.h"
+
+using namespace newsboat;
+
+namespace {
+
+nlohmann::json read_trace(const std::string& path)
+{
+	std::ifstream file(path);
+	return nlohmann::json::parse(file);
+}
+
+}
+
+TEST_CASE("TraceLog writes the spans in the Chrome trace event format",
+	"[TraceLog]")
+{
+	test_helpers::TempDir tmp;
+	const std::string path = tmp.get_path() + "trace.json";
+
+	TraceLog::start(path);
+	REQUIRE(TraceLog::enabled());
+	const auto begin = TraceLog::Clock::now();
+	TraceLog::add("download", begin, begin + std::chrono::milliseconds(3),
+		"https://example.com/feed.xml");
+	{
+		TraceSpan span("redraw");
+	}
+	std::thread([]() {
+		TraceSpan span("parse");
+	}).join();
+	REQUIRE(TraceLog::finish());
+	REQUIRE_FALSE(TraceLog::enabled());
+
+	const auto trace = read_trace(path);
+	const auto& events = trace.at("traceEvents");
+	REQUIRE(events.size() == 3);
+
+	const auto& download = events[0];
+	REQUIRE(download.at("name") == "download");
+	REQUIRE(download.at("ph") == "X");
+	REQUIRE(download.at("dur").get<double>() == Approx(3000));
+	REQUIRE(download.at("args").at("detail") == "https://example.com/feed.xml");
+
+	REQUIRE(events[1].at("name") == "redraw");
+	REQUIRE(events[1].count("args") == 0);
+	REQUIRE(events[1].at("tid") == download.at("tid"));
+	REQUIRE(events[2].at("name") == "parse");
+	REQUIRE(events[2].at("tid") != download.at("tid"));
+
+	SECTION("nothing is recorded once it's finished") {
+		TraceLog::add("late", begin, begin);
+		REQUIRE(TraceLog::finish());
+		REQUIRE(read_trace(path).at("traceEvents").size() == 3);
+	}
+}
+
+TEST_CASE("TracedMutex records waits for it, but not free locks",
+	"[TraceLog]")
+{
+	test_helpers::TempDir tmp;
+	const std::string path = tmp.get_path() + "trace.json";
+	TracedMutex<std::mutex> mtx("lock wait");
+
+	TraceLog::start(path);
+	{
+		std::lock_guard<TracedMutex<std::mutex>> guard(mtx);
+	}
+	{
+		std::unique_lock<TracedMutex<std::mutex>> held(mtx);
+		std::thread waiter([&]() {
+			std::lock_guard<TracedMutex<std::mutex>> guard(mtx);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		held.unlock();
+		waiter.join();
+	}
+	REQUIRE(TraceLog::finish());
+
+	const auto events = read_trace(path).at("traceEvents");
+	REQUIRE(events.size() == 1);
+	REQUIRE(events[0].at("name") == "lock wait");
+	REQUIRE(events[0].at("dur").get<double>() > 0);
+}
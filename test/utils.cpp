@@ -687,6 +687,7 @@ TEST_CASE("replace_all()", "[utils]")
 	REQUIRE(utils::replace_all("this is a normal test text", " t", " T") ==
 		"this is a normal Test Text");
 	REQUIRE(utils::replace_all("o o o", "o", "<o>") == "<o> <o> <o>");
+	REQUIRE(utils::replace_all("abc", "", "-") == "-a-b-c-");
 }
 
 TEST_CASE("replace_all() with from/to pairs", "[utils]")
@@ -815,6 +816,16 @@ TEST_CASE("partition_index()", "[utils]")
 	}
 }
 
+TEST_CASE("host_of() returns the server part of a URL, without credentials",
+	"[utils]")
+{
+	REQUIRE(utils::host_of("https://Example.com/feed.xml") == "example.com");
+	REQUIRE(utils::host_of("http://user:pw@example.com:8080?x=1") ==
+		"example.com:8080");
+	REQUIRE(utils::host_of("example.com/path#frag") == "example.com");
+	REQUIRE(utils::host_of("") == "");
+}
+
 TEST_CASE("censor_url()", "[utils]")
 {
 	REQUIRE(utils::censor_url("") == "");
@@ -945,6 +956,78 @@ TEST_CASE("strwidth_stfl()", "[utils]")
 	REQUIRE(utils::strwidth_stfl("ＡＢＣＤＥＦ") == 12);
 }
 
+TEST_CASE("strwidth() and strwidth_stfl() measure ASCII text by its length",
+	"[utils]")
+{
+	const std::vector<std::string> inputs = {
+		"plain text that is longer than eight bytes",
+		"a<b>c",
+		"<>",
+		"tail without closing bracket <b",
+		"<b>bold</b> and <>less",
+	};
+	for (const auto& input : inputs) {
+		INFO("input: " << input);
+		REQUIRE(utils::strwidth(input) == input.size());
+		// The same text with a wide character in front goes through the
+		// generic implementation
+		const auto wide = utils::wstr2str(L"\uF91F") + input;
+		REQUIRE(utils::strwidth_stfl(wide) == 2 + utils::strwidth_stfl(input));
+	}
+}
+
+TEST_CASE("is_printable_ascii()", "[utils]")
+{
+	REQUIRE(utils::is_printable_ascii(""));
+	REQUIRE(utils::is_printable_ascii(" !\"09AZaz{|}~"));
+	REQUIRE_FALSE(utils::is_printable_ascii("tab\t"));
+	REQUIRE_FALSE(utils::is_printable_ascii("\xd0\x9f"));
+}
+
+TEST_CASE("clean_nonprintable_characters() replaces non-printable characters "
+	"with U+FFFD",
+	"[utils]")
+{
+	test_helpers::LcCtypeEnvVar lc_ctype;
+	if (::setlocale(LC_CTYPE, "en_US.UTF-8") == nullptr) {
+		WARN("Couldn't set locale en_US.UTF-8; test skipped.");
+		return;
+	}
+	lc_ctype.set("en_US.UTF-8");
+
+	const std::string replacement = "\xEF\xBF\xBD";
+
+	REQUIRE(utils::clean_nonprintable_characters(std::string()) == "");
+	REQUIRE(utils::clean_nonprintable_characters(std::string("hello")) == "hello");
+	REQUIRE(utils::clean_nonprintable_characters(std::string("a\tb\x1b")) ==
+		"a" + replacement + "b" + replacement);
+	// "Привет", "Hello" in Russian
+	const std::string russian = "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82";
+	REQUIRE(utils::clean_nonprintable_characters(russian) == russian);
+	// Invalid and truncated sequences
+	REQUIRE(utils::clean_nonprintable_characters(std::string("a\xffz")) ==
+		"a" + replacement + "z");
+	REQUIRE(utils::clean_nonprintable_characters(std::string("a\xd0")) ==
+		"a" + replacement);
+	// Everything after a NUL is dropped
+	REQUIRE(utils::clean_nonprintable_characters(std::string("ab\0cd", 5)) == "ab");
+
+	SECTION("gives the same result as the wide string version") {
+		const std::vector<std::string> inputs = {
+			"plain",
+			"tab\tand\x7f delete",
+			russian + "\x01" + russian,
+			"\xe2\x80\x8b zero-width space and \xc2\x85 next line",
+		};
+		for (const auto& input : inputs) {
+			INFO("input: " << input);
+			REQUIRE(utils::clean_nonprintable_characters(input) ==
+				utils::wstr2str(utils::clean_nonprintable_characters(
+						utils::str2wstr(input))));
+		}
+	}
+}
+
 TEST_CASE("is_http_url()", "[utils]")
 {
 	REQUIRE(utils::is_http_url("http://example.com"));
@@ -994,6 +1077,22 @@ TEST_CASE("trim()", "[utils]")
 	str = "     \n";
 	utils::trim(str);
 	REQUIRE(str == "");
+
+	SECTION("Unicode whitespace is trimmed too") {
+		str = "\u00a0\t\u3000 abc\u00e9 \u2028";
+		utils::trim(str);
+		REQUIRE(str == "abc\u00e9");
+
+		str = "\u00e9\u00a0";
+		utils::trim(str);
+		REQUIRE(str == "\u00e9");
+	}
+
+	SECTION("Non-whitespace non-ASCII text at the ends is kept") {
+		str = " \u00e9 abc \u00e9\n";
+		utils::trim(str);
+		REQUIRE(str == "\u00e9 abc \u00e9");
+	}
 }
 
 TEST_CASE("trim_end()", "[utils]")
@@ -1001,6 +1100,14 @@ TEST_CASE("trim_end()", "[utils]")
 	std::string str = "quux\n";
 	utils::trim_end(str);
 	REQUIRE(str == "quux");
+
+	str = " quux \r\n\n";
+	utils::trim_end(str);
+	REQUIRE(str == " quux ");
+
+	str = "\r\n";
+	utils::trim_end(str);
+	REQUIRE(str == "");
 }
 
 TEST_CASE("utils::make_title extracts possible title from URL", "[utils]")
@@ -2010,6 +2117,45 @@ TEST_CASE("convert_text() returns input string if fromcode and tocode are the sa
 	verify_convert_text(input, "UTF-8", "UTF-8", expected);
 }
 
+TEST_CASE("convert_text() returns valid UTF-8 unchanged when converting it "
+	"to UTF-8",
+	"[utils]")
+{
+	// "Привет", "Hello" in Russian
+	std::vector<unsigned char> input = {
+		0xd0, 0x9f, 0xd1, 0x80, 0xd0, 0xb8, 0xd0, 0xb2, 0xd0, 0xb5, 0xd1, 0x82,
+	};
+
+	verify_convert_text(input, "UTF-8", "UTF-8", input);
+	verify_convert_text(input, "utf-8", "UTF-8", input);
+	verify_convert_text(input, "UTF-8", "utf8", input);
+}
+
+TEST_CASE("convert_text() returns ASCII text unchanged when converting "
+	"between ASCII and UTF-8",
+	"[utils]")
+{
+	const std::vector<unsigned char> input = {'p', 'l', 'a', 'i', 'n', '\n'};
+
+	verify_convert_text(input, "UTF-8", "US-ASCII", input);
+	verify_convert_text(input, "ASCII", "UTF-8", input);
+	verify_convert_text(input, "UTF-8", "ANSI_X3.4-1968", input);
+}
+
+TEST_CASE("is_utf8_compatible_charset() is true for UTF-8 and ASCII",
+	"[utils]")
+{
+	REQUIRE(utils::is_utf8_compatible_charset("utf-8"));
+	REQUIRE(utils::is_utf8_compatible_charset("UTF-8"));
+	REQUIRE(utils::is_utf8_compatible_charset("utf8"));
+	REQUIRE(utils::is_utf8_compatible_charset("us-ascii"));
+	REQUIRE(utils::is_utf8_compatible_charset("ASCII"));
+
+	REQUIRE_FALSE(utils::is_utf8_compatible_charset(""));
+	REQUIRE_FALSE(utils::is_utf8_compatible_charset("ISO-8859-1"));
+	REQUIRE_FALSE(utils::is_utf8_compatible_charset("UTF-16"));
+}
+
 TEST_CASE("convert_text() replaces incomplete multibyte sequences with a question mark: utf8 to utf16le",
 	"[utils]")
 {
@@ -1,11 +1,14 @@
 #include "view.h"
 
+#include <stdexcept>
 #include <string>
+#include <thread>
 
 #include "3rd-party/catch.hpp"
 #include "controller.h"
 #include "configpaths.h"
 #include "cache.h"
+#include "jobprogress.h"
 
 using namespace newsboat;
 
@@ -40,4 +43,28 @@ TEST_CASE("get_filename_suggestion() normalizes filenames for saving articles",
 	REQUIRE(v.get_filename_suggestion(
 			example_ru).compare("Инженеры из MIT.txt") == 0);
 	REQUIRE(v.get_filename_suggestion(example_fr).compare("Les mathématiques.txt") == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("run_job() runs the job on another thread, and rethrows what it "
+	"throws", "[View]")
+{
+	ConfigPaths paths{};
+	Controller c(paths);
+	newsboat::View v(&c);
+
+	const auto caller = std::this_thread::get_id();
+	std::thread::id runner;
+	int percent = 0;
+	REQUIRE(v.run_job("Working...", [&](JobProgress& progress) {
+		runner = std::this_thread::get_id();
+		progress.set_total(2);
+		progress.advance(1);
+		percent = progress.percent_done();
+	}));
+	REQUIRE(runner != caller);
+	REQUIRE(percent == 50);
+
+	REQUIRE_THROWS_AS(v.run_job("Failing...", [](JobProgress&) {
+		throw std::runtime_error("no luck");
+	}), std::runtime_error);
+}
@@ -0,0 +1,91 @@
+#include "websubrelay.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "3rd-party/catch.hpp"
+#include "test_helpers/tempdir.h"
+
+using namespace newsboat;
+
+namespace {
+
+std::string read_file(const std::string& filename)
+{
+	std::ifstream file(filename);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+void append_line(const std::string& filename, const std::string& line)
+{
+	std::ofstream file(filename, std::ios::app);
+	file << line << '\n';
+}
+
+}
+
+TEST_CASE("WebSubRelay lists the hubs and topics sorted, and leaves the file "
+	"alone if they didn't change", "[WebSubRelay]")
+{
+	test_helpers::TempDir tmp;
+	WebSubRelay relay(tmp.get_path());
+	const std::string filename = tmp.get_path() + "/subscriptions";
+
+	relay.write_subscriptions({
+		{"https://hub.example.org/", "https://example.com/b.xml"},
+		{"https://hub.example.org/", "https://example.com/a.xml"},
+	});
+	REQUIRE(read_file(filename) ==
+		"https://hub.example.org/ https://example.com/a.xml\n"
+		"https://hub.example.org/ https://example.com/b.xml\n");
+
+	struct stat before;
+	REQUIRE(::stat(filename.c_str(), &before) == 0);
+	relay.write_subscriptions({
+		{"https://hub.example.org/", "https://example.com/a.xml"},
+		{"https://hub.example.org/", "https://example.com/b.xml"},
+	});
+	struct stat after;
+	REQUIRE(::stat(filename.c_str(), &after) == 0);
+	REQUIRE(after.st_ino == before.st_ino);
+
+	relay.write_subscriptions({
+		{"https://hub.example.org/", "https://example.com/a.xml"},
+	});
+	REQUIRE(read_file(filename) ==
+		"https://hub.example.org/ https://example.com/a.xml\n");
+}
+
+TEST_CASE("WebSubRelay takes each pushed topic once", "[WebSubRelay]")
+{
+	test_helpers::TempDir tmp;
+	WebSubRelay relay(tmp.get_path());
+	const std::string filename = tmp.get_path() + "/pushed";
+
+	REQUIRE(relay.take_pushed().empty());
+
+	append_line(filename, "https://example.com/a.xml");
+	append_line(filename, "");
+	append_line(filename, "https://example.com/b.xml");
+	append_line(filename, "https://example.com/a.xml");
+	REQUIRE(relay.take_pushed() == std::vector<std::string>({
+		"https://example.com/a.xml",
+		"https://example.com/b.xml",
+	}));
+	REQUIRE(::access(filename.c_str(), F_OK) != 0);
+	REQUIRE(relay.take_pushed().empty());
+
+	SECTION("what's left from an unfinished call is taken too") {
+		append_line(filename + ".taken", "https://example.com/c.xml");
+		append_line(filename, "https://example.com/d.xml");
+		REQUIRE(relay.take_pushed() == std::vector<std::string>({
+			"https://example.com/c.xml",
+			"https://example.com/d.xml",
+		}));
+	}
+}
@@ -0,0 +1,55 @@
+#include "workerpool.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "3rd-party/catch.hpp"
+
+using namespace newsboat;
+
+TEST_CASE("WorkerPool runs every job before finish() returns", "[WorkerPool]")
+{
+	WorkerPool pool(4);
+	std::atomic<unsigned int> done(0);
+	for (unsigned int i = 0; i < 100; ++i) {
+		pool.push([&]() {
+			++done;
+		});
+	}
+	pool.finish();
+
+	REQUIRE(done == 100);
+}
+
+TEST_CASE("WorkerPool runs jobs that other jobs push", "[WorkerPool]")
+{
+	WorkerPool pool(3);
+	std::mutex mtx;
+	std::set<std::thread::id> threads;
+	std::atomic<unsigned int> done(0);
+
+	std::function<void(unsigned int)> countdown;
+	countdown = [&](unsigned int left) {
+		{
+			std::lock_guard<std::mutex> guard(mtx);
+			threads.insert(std::this_thread::get_id());
+		}
+		++done;
+		if (left > 0) {
+			pool.push([&, left]() {
+				countdown(left - 1);
+			});
+		}
+	};
+	for (unsigned int i = 0; i < 5; ++i) {
+		pool.push([&]() {
+			countdown(9);
+		});
+	}
+	pool.finish();
+
+	REQUIRE(done == 50);
+	REQUIRE(threads.count(std::this_thread::get_id()) == 0);
+}